@@ -0,0 +1,88 @@
+#!/usr/bin/env bash
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Library Public License as published by
+# the Free Software Foundation; either version 2, or (at your option)
+# any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Library Public License for more details.
+#
+
+source $CEPH_ROOT/qa/standalone/ceph-helpers.sh
+
+function run() {
+    local dir=$1
+    shift
+
+    export CEPH_MON="127.0.0.1:7182" # git grep '\<7182\>' : there must be only one
+    export CEPH_ARGS
+    CEPH_ARGS+="--fsid=$(uuidgen) --auth-supported=none "
+    CEPH_ARGS+="--mon-host=$CEPH_MON "
+    export max_active=2
+    export objects=200
+
+    local funcs=${@:-$(set | sed -n -e 's/^\(TEST_[0-9a-z_]*\) .*/\1/p')}
+    for func in $funcs ; do
+        setup $dir || return 1
+        $func $dir || return 1
+        teardown $dir || return 1
+    done
+}
+
+# Backfill of many small objects: every object pushed counts against
+# osd_recovery_max_active, however many of them share a push message.
+function TEST_backfill_small_objects_max_active() {
+    local dir=$1
+    local poolname=test
+
+    run_mon $dir a || return 1
+    run_mgr $dir x || return 1
+    export CEPH_ARGS
+    local osd_args="--osd_recovery_max_active=$max_active "
+    osd_args+="--osd_recovery_sleep=0 --osd_max_push_objects=10 "
+    run_osd $dir 0 $osd_args || return 1
+    run_osd $dir 1 $osd_args || return 1
+
+    create_pool $poolname 1 1
+    ceph osd pool set $poolname size 1 --yes-i-really-mean-it
+    wait_for_clean || return 1
+
+    dd if=/dev/urandom of=$dir/datafile bs=4k count=1
+    for i in $(seq 1 $objects)
+    do
+        rados -p $poolname put obj$i $dir/datafile
+    done
+
+    ceph osd pool set $poolname size 2
+    sleep 5
+    wait_for_clean || return 1
+
+    local primary=$(get_primary $poolname obj1)
+    local log=$dir/osd.${primary}.log
+    local started=$(grep -c "start_recovery_op pg.*backfill" $log)
+    if [ "$started" -lt "$objects" ]; then
+        echo "expected $objects objects backfilled, found $started"
+        return 1
+    fi
+
+    # the count logged is the number active before this one started
+    local most=$(grep "start_recovery_op pg.*backfill" $log | \
+        sed -n 's/.* (\([0-9]*\)\/[0-9]* rops)$/\1/p' | sort -n | tail -1)
+    if [ "$most" -ge "$max_active" ]; then
+        echo "started a recovery op with $most of $max_active already active"
+        return 1
+    fi
+
+    delete_pool $poolname
+    rm -f $dir/datafile
+    kill_daemons $dir || return 1
+}
+
+main osd-backfill-max-active "$@"
+
+# Local Variables:
+# compile-command: "make -j4 && ../qa/run-standalone.sh osd-backfill-max-active.sh"
+# End:
@@ -49,12 +49,25 @@ export PATH=/sbin:$PATH
 : ${VERBOSE:=false}
 : ${CEPH_ERASURE_CODE_BENCHMARK:=ceph_erasure_code_benchmark}
 : ${PLUGIN_DIRECTORY:=/usr/lib/ceph/erasure-code}
-: ${PLUGINS:=isa jerasure}
+: ${PLUGINS:=isa jerasure shec clay}
 : ${TECHNIQUES:=vandermonde cauchy}
 : ${TOTAL_SIZE:=$((1024 * 1024))}
 : ${SIZE:=4096}
 : ${PARAMETERS:=--parameter jerasure-per-chunk-alignment=true}
 
+# the technique parameter of each plugin for each technique, a plugin
+# without one does not implement it and the serie is skipped
+isa2technique_vandermonde=reed_sol_van
+isa2technique_cauchy=cauchy
+jerasure2technique_vandermonde=reed_sol_van
+jerasure2technique_cauchy=cauchy_good
+shec2technique_vandermonde=multiple
+clay2technique_vandermonde=reed_sol_van
+clay2technique_cauchy=cauchy_good
+
+# additional parameters of each plugin
+shec2parameters="--parameter c=1"
+
 function bench_header() {
     echo -e "seconds\tKB\tplugin\tk\tm\twork.\titer.\tsize\teras.\tcommand."
 }
@@ -114,12 +127,16 @@ function bench_run() {
     for technique in ${TECHNIQUES} ; do
         for plugin in ${PLUGINS} ; do
             eval technique_parameter=\$${plugin}2technique_${technique}
+            if [ -z "$technique_parameter" ] ; then
+                continue
+            fi
+            eval plugin_parameters=\$${plugin}2parameters
             echo "serie encode_${technique}_${plugin}"
             for k in $ks ; do
                 for m in ${k2ms[$k]} ; do
                     bench $plugin $k $m encode $(($TOTAL_SIZE / $SIZE)) $SIZE 0 \
                         --parameter packetsize=$(packetsize $k $w $VECTOR_WORDSIZE $SIZE) \
-                        ${PARAMETERS} \
+                        ${PARAMETERS} ${plugin_parameters} \
                         --parameter technique=$technique_parameter
 
                 done
@@ -129,6 +146,10 @@ function bench_run() {
     for technique in ${TECHNIQUES} ; do
         for plugin in ${PLUGINS} ; do
             eval technique_parameter=\$${plugin}2technique_${technique}
+            if [ -z "$technique_parameter" ] ; then
+                continue
+            fi
+            eval plugin_parameters=\$${plugin}2parameters
             echo "serie decode_${technique}_${plugin}"
             for k in $ks ; do
                 for m in ${k2ms[$k]} ; do
@@ -136,7 +157,7 @@ function bench_run() {
                     for erasures in $(seq 1 $m) ; do
                         bench $plugin $k $m decode $(($TOTAL_SIZE / $SIZE)) $SIZE $erasures \
                             --parameter packetsize=$(packetsize $k $w $VECTOR_WORDSIZE  $SIZE) \
-                            ${PARAMETERS} \
+                            ${PARAMETERS} ${plugin_parameters} \
                             --parameter technique=$technique_parameter
                     done
                 done
@@ -32,6 +32,30 @@ $(function() {
 	    lines: { show: true },
 	});
     }
+    if (typeof encode_vandermonde_shec != 'undefined') {
+        encode.push({
+	    data: encode_vandermonde_shec,
+            label: "SHEC, Vandermonde",
+	    points: { show: true },
+	    lines: { show: true },
+	});
+    }
+    if (typeof encode_vandermonde_clay != 'undefined') {
+        encode.push({
+	    data: encode_vandermonde_clay,
+            label: "CLAY, Vandermonde",
+	    points: { show: true },
+	    lines: { show: true },
+	});
+    }
+    if (typeof encode_cauchy_clay != 'undefined') {
+        encode.push({
+	    data: encode_cauchy_clay,
+            label: "CLAY, Cauchy",
+	    points: { show: true },
+	    lines: { show: true },
+	});
+    }
     $.plot("#encode", encode, {
 	xaxis: {
 	    mode: "categories",
@@ -72,6 +96,30 @@ $(function() {
 	    lines: { show: true },
 	});
     }
+    if (typeof decode_vandermonde_shec != 'undefined') {
+        decode.push({
+	    data: decode_vandermonde_shec,
+            label: "SHEC, Vandermonde",
+	    points: { show: true },
+	    lines: { show: true },
+	});
+    }
+    if (typeof decode_vandermonde_clay != 'undefined') {
+        decode.push({
+	    data: decode_vandermonde_clay,
+            label: "CLAY, Vandermonde",
+	    points: { show: true },
+	    lines: { show: true },
+	});
+    }
+    if (typeof decode_cauchy_clay != 'undefined') {
+        decode.push({
+	    data: decode_cauchy_clay,
+            label: "CLAY, Cauchy",
+	    points: { show: true },
+	    lines: { show: true },
+	});
+    }
     $.plot("#decode", decode, {
 	xaxis: {
 	    mode: "categories",
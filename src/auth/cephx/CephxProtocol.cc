@@ -19,10 +19,90 @@
 #include "common/debug.h"
 #include "include/buffer.h"
 
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
 #define dout_subsys ceph_subsys_auth
 #undef dout_prefix
 #define dout_prefix *_dout << "cephx: "
 
+namespace {
+
+/*
+ * Service tickets already decrypted by cephx_verify_authorizer().  Clients
+ * keep presenting the same ticket until they renew it, so a reconnecting
+ * client only costs the decryption of its CephXAuthorize.  A hit needs both
+ * the same ticket blob and the same service secret, so it yields exactly
+ * what decrypting the blob again would.
+ */
+class ServiceTicketCache {
+  struct Entry {
+    std::string key;
+    bufferptr secret;
+    CephXServiceTicketInfo info;
+  };
+
+  std::mutex lock;
+  std::list<Entry> lru;  // most recently used first
+  std::unordered_map<std::string, std::list<Entry>::iterator> entries;
+
+  static std::string make_key(uint32_t service_id,
+			      const CephXTicketBlob& ticket) {
+    std::string key;
+    key.reserve(sizeof(service_id) + sizeof(ticket.secret_id) +
+		ticket.blob.length());
+    key.append((const char*)&service_id, sizeof(service_id));
+    key.append((const char*)&ticket.secret_id, sizeof(ticket.secret_id));
+    for (auto& p : ticket.blob.buffers()) {
+      key.append(p.c_str(), p.length());
+    }
+    return key;
+  }
+
+public:
+  bool get(uint32_t service_id, const CephXTicketBlob& ticket,
+	   const CryptoKey& secret, CephXServiceTicketInfo *info) {
+    auto key = make_key(service_id, ticket);
+    std::lock_guard l{lock};
+    auto p = entries.find(key);
+    if (p == entries.end()) {
+      return false;
+    }
+    const bufferptr& s = secret.get_secret();
+    const bufferptr& cached = p->second->secret;
+    if (s.length() != cached.length() ||
+	memcmp(s.c_str(), cached.c_str(), s.length()) != 0) {
+      return false;
+    }
+    lru.splice(lru.begin(), lru, p->second);
+    *info = p->second->info;
+    return true;
+  }
+
+  void put(uint32_t service_id, const CephXTicketBlob& ticket,
+	   const CryptoKey& secret, const CephXServiceTicketInfo& info,
+	   size_t max) {
+    auto key = make_key(service_id, ticket);
+    std::lock_guard l{lock};
+    auto p = entries.find(key);
+    if (p != entries.end()) {
+      lru.erase(p->second);
+      entries.erase(p);
+    }
+    lru.push_front(Entry{key, secret.get_secret(), info});
+    entries.emplace(std::move(key), lru.begin());
+    while (lru.size() > max) {
+      entries.erase(lru.back().key);
+      lru.pop_back();
+    }
+  }
+};
+
+ServiceTicketCache service_ticket_cache;
+
+} // anonymous namespace
+
 
 
 void cephx_calc_client_server_challenge(CephContext *cct, CryptoKey& secret, uint64_t server_challenge, 
@@ -437,10 +517,21 @@ bool cephx_verify_authorizer(CephContext *cct, const KeyStore& keys,
     }
   }
   std::string error;
-  if (!service_secret.get_secret().length())
+  const auto cache_size =
+    cct->_conf.get_val<uint64_t>("cephx_service_ticket_cache_size");
+  if (!service_secret.get_secret().length()) {
     error = "invalid key";  // Bad key?
-  else
+  } else if (cache_size &&
+	     service_ticket_cache.get(service_id, ticket, service_secret,
+				      &ticket_info)) {
+    ldout(cct, 20) << "verify_authorizer found ticket in cache" << dendl;
+  } else {
     decode_decrypt_enc_bl(cct, ticket_info, service_secret, ticket.blob, error);
+    if (error.empty() && cache_size) {
+      service_ticket_cache.put(service_id, ticket, service_secret, ticket_info,
+			       cache_size);
+    }
+  }
   if (!error.empty()) {
     ldout(cct, 0) << "verify_authorizer could not decrypt ticket info: error: "
       << error << dendl;
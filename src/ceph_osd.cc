@@ -587,8 +587,15 @@ flushjournal_out:
 
   ms_cluster->set_default_policy(Messenger::Policy::stateless_server(0));
   ms_cluster->set_policy(entity_name_t::TYPE_MON, Messenger::Policy::lossy_client(0));
-  ms_cluster->set_policy(entity_name_t::TYPE_OSD,
-			 Messenger::Policy::lossless_peer(osd_required));
+  {
+    // replication traffic carries the bulk of the data
+    auto p = Messenger::Policy::lossless_peer(osd_required);
+    p.send_coalesce_max = g_conf().get_val<Option::size_t>(
+      "ms_async_send_coalesce_max");
+    p.send_zerocopy_min = g_conf().get_val<Option::size_t>(
+      "ms_async_send_zerocopy_min");
+    ms_cluster->set_policy(entity_name_t::TYPE_OSD, p);
+  }
   ms_cluster->set_policy(entity_name_t::TYPE_CLIENT,
 			 Messenger::Policy::stateless_server(0));
 
@@ -50,6 +50,7 @@
 #include "messages/MClientCaps.h"
 #include "messages/MClientLease.h"
 #include "messages/MClientQuota.h"
+#include "messages/MClientCapsBatch.h"
 #include "messages/MClientReclaim.h"
 #include "messages/MClientReclaimReply.h"
 #include "messages/MClientReconnect.h"
@@ -98,6 +99,7 @@
 #include "include/stat.h"
 
 #include "include/cephfs/ceph_statx.h"
+#include "include/cephfs/libcephfs.h"
 
 #if HAVE_GETGROUPLIST
 #include <grp.h>
@@ -271,6 +273,9 @@ Client::Client(Messenger *m, MonClient *mc, Objecter *objecter_)
     interrupt_finisher(m->cct),
     remount_finisher(m->cct),
     objecter_finisher(m->cct),
+    async_io_tp(m->cct, "Client::async_io_tp", "cfs_aio",
+		m->cct->_conf.get_val<int64_t>("client_async_io_threads"),
+		"client_async_io_threads"),
     m_command_hook(this),
     fscid(0)
 {
@@ -303,6 +308,7 @@ Client::Client(Messenger *m, MonClient *mc, Objecter *objecter_)
 				  true));
   objecter_finisher.start();
   filer.reset(new Filer(objecter, &objecter_finisher));
+  async_io_wq.reset(new ContextWQ("Client::async_io_wq", 0, &async_io_tp));
   objecter->enable_blacklist_events();
 }
 
@@ -546,6 +552,8 @@ void Client::_finish_init()
 	       << cpp_strerror(-ret) << dendl;
   }
 
+  async_io_tp.start();
+
   client_lock.Lock();
   initialized = true;
   client_lock.Unlock();
@@ -589,6 +597,10 @@ void Client::shutdown()
     remount_finisher.stop();
   }
 
+  // let queued async I/O complete; it needs the cache
+  async_io_wq->drain();
+  async_io_tp.stop();
+
   objectcacher->stop();  // outside of client_lock! this does a join.
 
   client_lock.Lock();
@@ -1583,8 +1595,10 @@ int Client::verify_reply_trace(int r,
   if (extra_bl.length() >= 8) {
     // if the extra bufferlist has a buffer, we assume its the created inode
     // and that this request to create succeeded in actually creating
-    // the inode (won the race with other create requests)
-    decode(created_ino, extra_bl);
+    // the inode (won the race with other create requests).  delegated
+    // inos may follow it.
+    auto bl_p = extra_bl.cbegin();
+    decode(created_ino, bl_p);
     got_created_ino = true;
     ldout(cct, 10) << "make_request created ino " << created_ino << dendl;
   }
@@ -2104,6 +2118,7 @@ void Client::handle_client_session(const MConstRef<MClientSession>& m)
 	break;
       }
       session->mds_features = std::move(m->supported_features);
+      session->delegated_inos.clear();
 
       renew_caps(session);
       session->state = MetaSession::STATE_OPEN;
@@ -2205,6 +2220,12 @@ void Client::send_request(MetaRequest *request, MetaSession *session,
   mds_rank_t mds = session->mds_num;
   ldout(cct, 10) << __func__ << " rebuilding request " << request->get_tid()
 		 << " for mds." << mds << dendl;
+  if (!request->got_unsafe && is_create_operation(request) &&
+      request->deleg_ino_mds != mds) {
+    // name the new inode ourselves, from the inos this mds delegated to us
+    request->head.ino = session->take_delegated_ino();
+    request->deleg_ino_mds = mds;
+  }
   auto r = build_client_request(request);
   if (request->dentry()) {
     r->set_dentry_wanted();
@@ -2333,6 +2354,13 @@ bool Client::is_dir_operation(MetaRequest *req)
   return false;
 }
 
+bool Client::is_create_operation(MetaRequest *req)
+{
+  int op = req->get_op();
+  return op == CEPH_MDS_OP_CREATE || op == CEPH_MDS_OP_MKNOD ||
+	 op == CEPH_MDS_OP_MKDIR || op == CEPH_MDS_OP_SYMLINK;
+}
+
 void Client::handle_client_reply(const MConstRef<MClientReply>& reply)
 {
   mds_rank_t mds_num = mds_rank_t(reply->get_source().num());
@@ -2384,6 +2412,25 @@ void Client::handle_client_reply(const MConstRef<MClientReply>& reply)
   request->reply = reply;
   insert_trace(request, session);
 
+  // the created ino is followed by more inos delegated to us
+  if (is_create_operation(request) &&
+      session->mds_features.test(CEPHFS_FEATURE_DELEG_INO) &&
+      reply->get_extra_bl().length() > sizeof(inodeno_t)) {
+    inodeno_t created_ino;
+    interval_set<inodeno_t> inos;
+    try {
+      auto p = reply->get_extra_bl().cbegin();
+      decode(created_ino, p);
+      decode(inos, p);
+      ldout(cct, 10) << __func__ << " mds." << mds_num << " delegated "
+		     << inos << dendl;
+      session->delegated_inos.union_of(inos);
+    } catch (const buffer::error& e) {
+      lderr(cct) << __func__ << " failed to decode delegated inos from mds."
+		 << mds_num << dendl;
+    }
+  }
+
   // Handle unsafe reply
   if (!is_safe) {
     request->got_unsafe = true;
@@ -2606,6 +2653,9 @@ bool Client::ms_dispatch2(const MessageRef &m)
   case CEPH_MSG_CLIENT_CAPS:
     handle_caps(ref_cast<MClientCaps>(m));
     break;
+  case CEPH_MSG_CLIENT_CAPS_BATCH:
+    handle_caps_batch(ref_cast<MClientCapsBatch>(m));
+    break;
   case CEPH_MSG_CLIENT_LEASE:
     handle_lease(ref_cast<MClientLease>(m));
     break;
@@ -2773,6 +2823,7 @@ void Client::send_reconnect(MetaSession *session)
   session->readonly = false;
 
   session->release.reset();
+  session->delegated_inos.clear();
 
   // reset my cap seq number
   session->seq = 0;
@@ -4802,6 +4853,18 @@ void Client::handle_quota(const MConstRef<MClientQuota>& m)
   }
 }
 
+void Client::handle_caps_batch(const MConstRef<MClientCapsBatch>& m)
+{
+  ldout(cct, 10) << __func__ << " " << *m << " from mds." << m->get_source()
+		 << dendl;
+  for (auto& caps : m->caps) {
+    // the batched messages were never on the wire on their own
+    caps->set_src(m->get_source());
+    caps->set_connection(m->get_connection());
+    handle_caps(caps);
+  }
+}
+
 void Client::handle_caps(const MConstRef<MClientCaps>& m)
 {
   mds_rank_t mds = mds_rank_t(m->get_source().num());
@@ -8978,7 +9041,7 @@ int Client::uninline_data(Inode *in, Context *onfinish)
 
 int Client::read(int fd, char *buf, loff_t size, loff_t offset)
 {
-  std::lock_guard lock(client_lock);
+  std::unique_lock lock(client_lock);
   tout(cct) << "read" << std::endl;
   tout(cct) << fd << std::endl;
   tout(cct) << size << std::endl;
@@ -8999,6 +9062,9 @@ int Client::read(int fd, char *buf, loff_t size, loff_t offset)
   size = std::min(size, (loff_t)INT_MAX);
   int r = _read(f, offset, size, &bl);
   ldout(cct, 3) << "read(" << fd << ", " << (void*)buf << ", " << size << ", " << offset << ") = " << r << dendl;
+  lock.unlock();
+
+  // bl is ours alone; copy it out without holding up other callers
   if (r >= 0) {
     bl.copy(0, bl.length(), buf);
     r = bl.length();
@@ -9337,9 +9403,25 @@ int Client::pwritev(int fd, const struct iovec *iov, int iovcnt, int64_t offset)
   return _preadv_pwritev(fd, iov, iovcnt, offset, true);
 }
 
+void Client::copy_bufferlist_to_iovec(const struct iovec *iov, unsigned iovcnt,
+				      bufferlist *bl, int64_t r)
+{
+  // one pass over the bufferlist, straight into the caller's iovecs
+  auto p = bl->cbegin();
+  for (unsigned j = 0, resid = r; j < iovcnt && resid > 0; j++) {
+    /*
+     * This piece of code aims to handle the case that bufferlist does not have enough data
+     * to fill in the iov
+     */
+    unsigned len = std::min<uint64_t>(resid, iov[j].iov_len);
+    p.copy(len, (char *)iov[j].iov_base);
+    resid -= len;
+  }
+}
+
 int64_t Client::_preadv_pwritev_locked(Fh *fh, const struct iovec *iov,
 				   unsigned iovcnt, int64_t offset, bool write,
-				   bool clamp_to_int)
+				   bool clamp_to_int, bufferlist *read_bl)
 {
 #if defined(__linux__) && defined(O_PATH)
     if (fh->flags & O_PATH)
@@ -9363,34 +9445,16 @@ int64_t Client::_preadv_pwritev_locked(Fh *fh, const struct iovec *iov,
         ldout(cct, 3) << "pwritev(" << fh << ", \"...\", " << totallen << ", " << offset << ") = " << w << dendl;
         return w;
     } else {
-        bufferlist bl;
-        int64_t r = _read(fh, offset, totallen, &bl);
+        // the caller copies read_bl into iov after dropping client_lock
+        int64_t r = _read(fh, offset, totallen, read_bl);
         ldout(cct, 3) << "preadv(" << fh << ", " <<  offset << ") = " << r << dendl;
-        if (r <= 0)
-          return r;
-
-        int bufoff = 0;
-        for (unsigned j = 0, resid = r; j < iovcnt && resid > 0; j++) {
-               /*
-                * This piece of code aims to handle the case that bufferlist does not have enough data 
-                * to fill in the iov 
-                */
-               if (resid < iov[j].iov_len) {
-                    bl.copy(bufoff, resid, (char *)iov[j].iov_base);
-                    break;
-               } else {
-                    bl.copy(bufoff, iov[j].iov_len, (char *)iov[j].iov_base);
-               }
-               resid -= iov[j].iov_len;
-               bufoff += iov[j].iov_len;
-        }
-        return r;  
+        return r;
     }
 }
 
 int Client::_preadv_pwritev(int fd, const struct iovec *iov, unsigned iovcnt, int64_t offset, bool write)
 {
-    std::lock_guard lock(client_lock);
+    std::unique_lock lock(client_lock);
     tout(cct) << fd << std::endl;
     tout(cct) << offset << std::endl;
 
@@ -9400,7 +9464,12 @@ int Client::_preadv_pwritev(int fd, const struct iovec *iov, unsigned iovcnt, in
     Fh *fh = get_filehandle(fd);
     if (!fh)
         return -EBADF;
-    return _preadv_pwritev_locked(fh, iov, iovcnt, offset, write, true);
+    bufferlist bl;
+    int64_t r = _preadv_pwritev_locked(fh, iov, iovcnt, offset, write, true, &bl);
+    lock.unlock();
+    if (!write && r > 0)
+      copy_bufferlist_to_iovec(iov, iovcnt, &bl, r);
+    return r;
 }
 
 int64_t Client::_write(Fh *f, int64_t offset, uint64_t size, const char *buf,
@@ -13341,15 +13410,45 @@ int64_t Client::ll_writev(struct Fh *fh, const struct iovec *iov, int iovcnt, in
   std::lock_guard lock(client_lock);
   if (unmounting)
    return -ENOTCONN;
-  return _preadv_pwritev_locked(fh, iov, iovcnt, off, true, false);
+  return _preadv_pwritev_locked(fh, iov, iovcnt, off, true, false, nullptr);
 }
 
 int64_t Client::ll_readv(struct Fh *fh, const struct iovec *iov, int iovcnt, int64_t off)
 {
-  std::lock_guard lock(client_lock);
+  std::unique_lock lock(client_lock);
   if (unmounting)
    return -ENOTCONN;
-  return _preadv_pwritev_locked(fh, iov, iovcnt, off, false, false);
+  bufferlist bl;
+  int64_t r = _preadv_pwritev_locked(fh, iov, iovcnt, off, false, false, &bl);
+  lock.unlock();
+  if (r > 0)
+    copy_bufferlist_to_iovec(iov, iovcnt, &bl, r);
+  return r;
+}
+
+int64_t Client::ll_nonblocking_readv_writev(struct ceph_ll_io_info *io_info)
+{
+  {
+    std::lock_guard lock(client_lock);
+    if (unmounting)
+      return -ENOTCONN;
+  }
+  ldout(cct, 3) << __func__ << " " << io_info->fh << " "
+		<< (io_info->write ? "write" : "read") << " off " << io_info->off
+		<< " iovcnt " << io_info->iovcnt << dendl;
+
+  // ll_readv/ll_writev drop client_lock while waiting on the OSDs, so
+  // the pool's threads keep several of these in flight at once
+  async_io_wq->queue(new FunctionContext([this, io_info](int r) {
+	if (io_info->write)
+	  io_info->result = ll_writev(io_info->fh, io_info->iov,
+				      io_info->iovcnt, io_info->off);
+	else
+	  io_info->result = ll_readv(io_info->fh, io_info->iov,
+				     io_info->iovcnt, io_info->off);
+	io_info->callback(io_info);
+      }));
+  return 0;
 }
 
 int Client::ll_flush(Fh *fh)
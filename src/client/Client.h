@@ -20,6 +20,7 @@
 #include "common/Finisher.h"
 #include "common/Mutex.h"
 #include "common/Timer.h"
+#include "common/WorkQueue.h"
 #include "common/cmdparse.h"
 #include "common/compiler_extensions.h"
 #include "include/cephfs/ceph_statx.h"
@@ -118,6 +119,7 @@ class Dentry;
 struct SnapRealm;
 struct Fh;
 struct CapSnap;
+struct ceph_ll_io_info;
 
 struct MetaRequest;
 class ceph_lock_state_t;
@@ -575,6 +577,7 @@ public:
   int ll_read(Fh *fh, loff_t off, loff_t len, bufferlist *bl);
   int ll_write(Fh *fh, loff_t off, loff_t len, const char *data);
   int64_t ll_readv(struct Fh *fh, const struct iovec *iov, int iovcnt, int64_t off);
+  int64_t ll_nonblocking_readv_writev(struct ceph_ll_io_info *io_info);
   int64_t ll_writev(struct Fh *fh, const struct iovec *iov, int iovcnt, int64_t off);
   loff_t ll_lseek(Fh *fh, loff_t offset, int whence);
   int ll_flush(Fh *fh);
@@ -663,6 +666,7 @@ public:
   void handle_quota(const MConstRef<MClientQuota>& m);
   void handle_snap(const MConstRef<MClientSnap>& m);
   void handle_caps(const MConstRef<MClientCaps>& m);
+  void handle_caps_batch(const MConstRef<MClientCapsBatch>& m);
   void handle_cap_import(MetaSession *session, Inode *in, const MConstRef<MClientCaps>& m);
   void handle_cap_export(MetaSession *session, Inode *in, const MConstRef<MClientCaps>& m);
   void handle_cap_trunc(MetaSession *session, Inode *in, const MConstRef<MClientCaps>& m);
@@ -816,6 +820,7 @@ protected:
   void handle_client_request_forward(const MConstRef<MClientRequestForward>& reply);
   void handle_client_reply(const MConstRef<MClientReply>& reply);
   bool is_dir_operation(MetaRequest *request);
+  bool is_create_operation(MetaRequest *request);
 
   // fake inode number for 32-bits ino_t
   void _assign_faked_ino(Inode *in);
@@ -1110,7 +1115,10 @@ private:
   int64_t _write(Fh *fh, int64_t offset, uint64_t size, const char *buf,
           const struct iovec *iov, int iovcnt);
   int64_t _preadv_pwritev_locked(Fh *f, const struct iovec *iov,
-	      unsigned iovcnt, int64_t offset, bool write, bool clamp_to_int);
+	      unsigned iovcnt, int64_t offset, bool write, bool clamp_to_int,
+	      bufferlist *read_bl);
+  static void copy_bufferlist_to_iovec(const struct iovec *iov, unsigned iovcnt,
+				       bufferlist *bl, int64_t r);
   int _preadv_pwritev(int fd, const struct iovec *iov, unsigned iovcnt, int64_t offset, bool write);
   int _flush(Fh *fh);
   int _fsync(Fh *fh, bool syncdataonly);
@@ -1205,6 +1213,8 @@ private:
   Finisher interrupt_finisher;
   Finisher remount_finisher;
   Finisher objecter_finisher;
+  ThreadPool async_io_tp;
+  std::unique_ptr<ContextWQ> async_io_wq;
 
   Context *tick_event = nullptr;
   utime_t last_cap_renew;
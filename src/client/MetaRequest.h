@@ -47,6 +47,7 @@ public:
   __u32    sent_on_mseq;       // mseq at last submission of this request
   int      num_fwd;            // # of times i've been forwarded
   int      retry_attempt;
+  mds_rank_t deleg_ino_mds;      // whose delegated ino is in head.ino
   std::atomic<uint64_t> ref = { 1 };
   
   ceph::cref_t<MClientReply> reply;         // the reply
@@ -81,7 +82,7 @@ public:
     other_inode_drop(0), other_inode_unless(0),
     regetattr_mask(0),
     mds(-1), resend_mds(-1), send_to_auth(false), sent_on_mseq(0),
-    num_fwd(0), retry_attempt(0),
+    num_fwd(0), retry_attempt(0), deleg_ino_mds(-1),
     reply(0),
     kick(false), success(false), dirp(NULL),
     got_unsafe(false), item(this), unsafe_item(this),
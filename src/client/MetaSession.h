@@ -54,6 +54,10 @@ struct MetaSession {
   std::set<ceph_tid_t> flushing_caps_tids;
   std::set<Inode*> early_flushing_caps;
 
+  // inos the mds lets us choose for the inodes we create (not persisted
+  // by the mds, so dropped whenever the session is (re)established)
+  interval_set<inodeno_t> delegated_inos;
+
   ceph::ref_t<MClientCapRelease> release;
 
   MetaSession(mds_rank_t mds_num, ConnectionRef con,
@@ -68,6 +72,14 @@ struct MetaSession {
 
   void dump(Formatter *f) const;
 
+  inodeno_t take_delegated_ino() {
+    if (delegated_inos.empty())
+      return 0;
+    inodeno_t ino = delegated_inos.range_start();
+    delegated_inos.erase(ino);
+    return ino;
+  }
+
   void enqueue_cap_release(inodeno_t ino, uint64_t cap_id, ceph_seq_t iseq,
       ceph_seq_t mseq, epoch_t osd_barrier);
 };
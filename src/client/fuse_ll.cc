@@ -593,6 +593,42 @@ static void fuse_ll_open(fuse_req_t req, fuse_ino_t ino,
   cfuse->iput(in); // iput required
 }
 
+#if FUSE_VERSION >= FUSE_MAKE_VERSION(2, 9)
+/*
+ * Hand the segments of a read to libfuse as they are, which writes them
+ * out as an iovec, instead of flattening the bufferlist into one more
+ * copy first.
+ */
+static void fuse_ll_reply_bl(fuse_req_t req, const bufferlist& bl)
+{
+  size_t n = std::max<size_t>(1, bl.get_num_buffers());
+  auto bufv = static_cast<fuse_bufvec*>(
+    malloc(sizeof(fuse_bufvec) + (n - 1) * sizeof(fuse_buf)));
+  if (!bufv) {
+    fuse_reply_err(req, ENOMEM);
+    return;
+  }
+  bufv->count = 0;
+  bufv->idx = 0;
+  bufv->off = 0;
+  for (const auto& p : bl.buffers()) {
+    if (!p.length())
+      continue;
+    fuse_buf& b = bufv->buf[bufv->count++];
+    b.size = p.length();
+    b.flags = static_cast<fuse_buf_flags>(0);
+    b.mem = const_cast<char*>(p.c_str());
+    b.fd = -1;
+    b.pos = 0;
+  }
+  if (bufv->count == 0)
+    fuse_reply_buf(req, NULL, 0);
+  else
+    fuse_reply_data(req, bufv, FUSE_BUF_NO_SPLICE);
+  free(bufv);
+}
+#endif
+
 static void fuse_ll_read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
 			 struct fuse_file_info *fi)
 {
@@ -600,10 +636,15 @@ static void fuse_ll_read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
   Fh *fh = reinterpret_cast<Fh*>(fi->fh);
   bufferlist bl;
   int r = cfuse->client->ll_read(fh, off, size, &bl);
-  if (r >= 0)
+  if (r >= 0) {
+#if FUSE_VERSION >= FUSE_MAKE_VERSION(2, 9)
+    fuse_ll_reply_bl(req, bl);
+#else
     fuse_reply_buf(req, bl.c_str(), bl.length());
-  else
+#endif
+  } else {
     fuse_reply_err(req, -r);
+  }
 }
 
 static void fuse_ll_write(fuse_req_t req, fuse_ino_t ino, const char *buf,
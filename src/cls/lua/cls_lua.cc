@@ -5,6 +5,9 @@
 #include <setjmp.h>
 #include <string>
 #include <sstream>
+#include <list>
+#include <mutex>
+#include <unordered_map>
 #include <lua.hpp>
 #include "include/types.h"
 #include "objclass/objclass.h"
@@ -825,6 +828,91 @@ static int unpack_json_command(lua_State *L, struct clslua_hctx *ctx,
   return 0;
 }
 
+/*
+ * Cache of compiled chunks, keyed by the script text.
+ *
+ * Every call still runs in a fresh Lua state, but a script that has been seen
+ * before is loaded from its precompiled bytecode instead of being parsed and
+ * compiled again. The cache is shared by all the PGs of the OSD and bounded by
+ * the total size of the cached scripts and bytecode.
+ */
+#define CLSLUA_CHUNK_CACHE_MAX_BYTES (8 << 20)
+
+struct clslua_chunk_cache {
+  struct entry {
+    std::string bytecode;
+    std::list<std::string>::iterator lru_it;
+  };
+
+  std::mutex lock;
+  std::list<std::string> lru; /* front is most recently used */
+  std::unordered_map<std::string, entry> chunks;
+  size_t bytes = 0;
+
+  bool get(const std::string& script, std::string *bytecode) {
+    std::lock_guard<std::mutex> l(lock);
+    auto it = chunks.find(script);
+    if (it == chunks.end())
+      return false;
+    lru.splice(lru.begin(), lru, it->second.lru_it);
+    *bytecode = it->second.bytecode;
+    return true;
+  }
+
+  void put(const std::string& script, std::string&& bytecode) {
+    size_t size = script.size() + bytecode.size();
+    if (size > CLSLUA_CHUNK_CACHE_MAX_BYTES)
+      return;
+    std::lock_guard<std::mutex> l(lock);
+    if (chunks.count(script))
+      return;
+    while (bytes + size > CLSLUA_CHUNK_CACHE_MAX_BYTES) {
+      auto victim = chunks.find(lru.back());
+      bytes -= victim->first.size() + victim->second.bytecode.size();
+      chunks.erase(victim);
+      lru.pop_back();
+    }
+    lru.push_front(script);
+    chunks[script] = entry{std::move(bytecode), lru.begin()};
+    bytes += size;
+  }
+};
+
+static clslua_chunk_cache chunk_cache;
+
+static int clslua_dump_writer(lua_State *L, const void *p, size_t sz, void *ud)
+{
+  static_cast<std::string*>(ud)->append(static_cast<const char*>(p), sz);
+  return 0;
+}
+
+/*
+ * Load and compile the script (or reuse its cached bytecode), leaving the
+ * chunk on the stack. Returns non-zero with the error message on the stack on
+ * failure, like luaL_loadstring.
+ */
+static int clslua_load_chunk(lua_State *L, const std::string& script)
+{
+  std::string bytecode;
+  if (chunk_cache.get(script, &bytecode))
+    return luaL_loadbufferx(L, bytecode.data(), bytecode.size(),
+        script.c_str(), "b");
+
+  int ret = luaL_loadstring(L, script.c_str());
+  if (ret)
+    return ret;
+
+  /* keep debug info so error messages still carry line numbers */
+#if LUA_VERSION_NUM >= 503
+  if (lua_dump(L, clslua_dump_writer, &bytecode, 0) == 0)
+#else
+  if (lua_dump(L, clslua_dump_writer, &bytecode) == 0)
+#endif
+    chunk_cache.put(script, std::move(bytecode));
+
+  return 0;
+}
+
 /*
  * Runs the script, and calls handler.
  */
@@ -875,7 +963,7 @@ static int clslua_eval(lua_State *L)
 
         ctx->script.swap(op.script);
         ctx->handler.swap(op.handler);
-        ctx->input = op.input;
+        ctx->input.claim(op.input);
       }
       break;
 
@@ -898,7 +986,7 @@ static int clslua_eval(lua_State *L)
   lua_settable(L, LUA_REGISTRYINDEX);
 
   /* load and compile chunk */
-  if (luaL_loadstring(L, ctx->script.c_str()))
+  if (clslua_load_chunk(L, ctx->script))
     return lua_error(L);
 
   /* execute chunk */
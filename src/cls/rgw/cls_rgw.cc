@@ -24,13 +24,15 @@ CLS_NAME(rgw)
 #define BI_BUCKET_LOG_INDEX           1
 #define BI_BUCKET_OBJ_INSTANCE_INDEX  2
 #define BI_BUCKET_OLH_DATA_INDEX      3
+#define BI_BUCKET_RESHARD_LOG_INDEX   4
 
-#define BI_BUCKET_LAST_INDEX          4
+#define BI_BUCKET_LAST_INDEX          5
 
 static std::string bucket_index_prefixes[] = { "", /* special handling for the objs list index */
                                           "0_",     /* bucket log index */
                                           "1000_",  /* obj instance index */
                                           "1001_",  /* olh data index */
+                                          "2000_",  /* reshard log index */
 
                                           /* this must be the last index */
                                           "9999_",};
@@ -95,6 +97,12 @@ static void bi_log_prefix(string& key)
   key.append(bucket_index_prefixes[BI_BUCKET_LOG_INDEX]);
 }
 
+static void reshard_log_prefix(string& key)
+{
+  key = BI_PREFIX_CHAR;
+  key.append(bucket_index_prefixes[BI_BUCKET_RESHARD_LOG_INDEX]);
+}
+
 static void bi_log_index_key(cls_method_context_t hctx, string& key, string& id, uint64_t index_ver)
 {
   bi_log_prefix(key);
@@ -400,6 +408,36 @@ static int read_bucket_header(cls_method_context_t hctx,
   return 0;
 }
 
+/*
+ * while the bucket is resharded without blocking writes, remember the
+ * names of the objects whose entries change, so the reshard can copy them
+ * again after copying the whole shard, see RGWBucketReshard
+ */
+static int reshard_log_change(cls_method_context_t hctx,
+			      const rgw_bucket_dir_header& header,
+			      const string& name)
+{
+  if (!header.new_instance.reshard_logging()) {
+    return 0;
+  }
+  string key;
+  reshard_log_prefix(key);
+  key.append(name);
+  bufferlist empty;
+  return cls_cxx_map_set_val(hctx, key, &empty);
+}
+
+static int reshard_log_change(cls_method_context_t hctx, const string& name)
+{
+  rgw_bucket_dir_header header;
+  int rc = read_bucket_header(hctx, &header);
+  if (rc < 0) {
+    CLS_LOG(1, "ERROR: %s(): failed to read header\n", __func__);
+    return rc;
+  }
+  return reshard_log_change(hctx, header, name);
+}
+
 int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
 {
   auto iter = in->cbegin();
@@ -849,6 +887,11 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
     return -EINVAL;
   }
 
+  rc = reshard_log_change(hctx, header, op.key.name);
+  if (rc < 0) {
+    return rc;
+  }
+
   rgw_bucket_dir_entry entry;
   bool ondisk = true;
 
@@ -1421,11 +1464,16 @@ static int rgw_bucket_link_olh(cls_method_context_t hctx, bufferlist *in, buffer
     return -EINVAL;
   }
 
+  int ret = reshard_log_change(hctx, op.key.name);
+  if (ret < 0) {
+    return ret;
+  }
+
   BIVerObjEntry obj(hctx, op.key);
   BIOLHEntry olh(hctx, op.key);
 
   /* read instance entry */
-  int ret = obj.init(op.delete_marker);
+  ret = obj.init(op.delete_marker);
   bool existed = (ret == 0);
   if (ret == -ENOENT && op.delete_marker) {
     ret = 0;
@@ -1610,6 +1658,11 @@ static int rgw_bucket_unlink_instance(cls_method_context_t hctx, bufferlist *in,
     return -EINVAL;
   }
 
+  int ret = reshard_log_change(hctx, op.key.name);
+  if (ret < 0) {
+    return ret;
+  }
+
   cls_rgw_obj_key dest_key = op.key;
   if (dest_key.instance == "null") {
     dest_key.instance.clear();
@@ -1618,7 +1671,7 @@ static int rgw_bucket_unlink_instance(cls_method_context_t hctx, bufferlist *in,
   BIVerObjEntry obj(hctx, dest_key);
   BIOLHEntry olh(hctx, dest_key);
 
-  int ret = obj.init();
+  ret = obj.init();
   if (ret == -ENOENT) {
     return 0; /* already removed */
   }
@@ -1866,11 +1919,16 @@ static int rgw_bucket_clear_olh(cls_method_context_t hctx, bufferlist *in, buffe
     return -EINVAL;
   }
 
+  int ret = reshard_log_change(hctx, op.key.name);
+  if (ret < 0) {
+    return ret;
+  }
+
   /* read olh entry */
   rgw_bucket_olh_entry olh_data_entry;
   string olh_data_key;
   encode_olh_data_key(op.key, &olh_data_key);
-  int ret = read_index_entry(hctx, olh_data_key, &olh_data_entry);
+  ret = read_index_entry(hctx, olh_data_key, &olh_data_entry);
   if (ret < 0 && ret != -ENOENT) {
     CLS_LOG(0, "ERROR: read_index_entry() olh_key=%s ret=%d", olh_data_key.c_str(), ret);
     return ret;
@@ -1947,6 +2005,11 @@ int rgw_dir_suggest_changes(cls_method_context_t hctx,
       return -EINVAL;
     }
 
+    rc = reshard_log_change(hctx, header, cur_change.key.name);
+    if (rc < 0) {
+      return rc;
+    }
+
     bufferlist cur_disk_bl;
     string cur_change_key;
     encode_obj_index_key(cur_change.key, &cur_change_key);
@@ -2868,6 +2931,64 @@ static int rgw_bi_log_stop(cls_method_context_t hctx, bufferlist *in, bufferlist
   return write_bucket_header(hctx, &header);
 }
 
+static int rgw_bi_reshard_log_list(cls_method_context_t hctx, bufferlist *in,
+				   bufferlist *out)
+{
+  auto in_iter = in->cbegin();
+
+  rgw_cls_reshard_log_list_op op;
+  try {
+    decode(op, in_iter);
+  } catch (buffer::error& err) {
+    CLS_LOG(1, "ERROR: %s(): failed to decode request\n", __func__);
+    return -EINVAL;
+  }
+
+  string prefix;
+  reshard_log_prefix(prefix);
+  string start_after = prefix + op.marker;
+#define MAX_RESHARD_LOG_ENTRIES 1000
+  uint32_t max = std::min<uint32_t>(op.max, MAX_RESHARD_LOG_ENTRIES);
+
+  map<string, bufferlist> keys;
+  rgw_cls_reshard_log_list_ret op_ret;
+  int ret = cls_cxx_map_get_vals(hctx, start_after, prefix, max, &keys,
+				 &op_ret.is_truncated);
+  if (ret < 0) {
+    return ret;
+  }
+  for (auto& k : keys) {
+    op_ret.names.push_back(k.first.substr(prefix.size()));
+  }
+
+  encode(op_ret, *out);
+  return 0;
+}
+
+static int rgw_bi_reshard_log_trim(cls_method_context_t hctx, bufferlist *in,
+				   bufferlist *out)
+{
+  auto in_iter = in->cbegin();
+
+  rgw_cls_reshard_log_trim_op op;
+  try {
+    decode(op, in_iter);
+  } catch (buffer::error& err) {
+    CLS_LOG(1, "ERROR: %s(): failed to decode request\n", __func__);
+    return -EINVAL;
+  }
+
+  string prefix;
+  reshard_log_prefix(prefix);
+  for (auto& name : op.names) {
+    int ret = cls_cxx_map_remove_key(hctx, prefix + name);
+    if (ret < 0 && ret != -ENOENT) {
+      return ret;
+    }
+  }
+  return 0;
+}
+
 
 static void usage_record_prefix_by_time(uint64_t epoch, string& key)
 {
@@ -3530,6 +3651,376 @@ static int rgw_cls_gc_remove(cls_method_context_t hctx, bufferlist *in, bufferli
   return gc_remove(hctx, op.tags);
 }
 
+/*
+ * gc queue
+ *
+ * The chains are appended to the data of the gc object, each one framed
+ * by a magic and the length of the encoded cls_rgw_gc_obj_info, while the
+ * head is kept in an xattr. Removing a batch of processed entries only
+ * moves the front of the queue, so unlike the omap index it does not leave
+ * tombstones behind. Tags deferred after they were queued are tracked in
+ * the head, as the queued entries are never updated in place.
+ */
+#define GC_QUEUE_HEAD_ATTR "rgw.gc_queue"
+#define GC_QUEUE_ENTRY_MAGIC 0x67637165 /* "gcqe" */
+#define GC_QUEUE_ENTRY_OVERHEAD (2 * sizeof(uint32_t))
+#define GC_QUEUE_READ_CHUNK (128 * 1024)
+#define GC_QUEUE_LIST_MAX_BYTES (4 * 1024 * 1024)
+
+static int gc_queue_read_head(cls_method_context_t hctx, cls_rgw_gc_queue_head *head)
+{
+  bufferlist bl;
+  int ret = cls_cxx_getxattr(hctx, GC_QUEUE_HEAD_ATTR, &bl);
+  if (ret == -ENODATA) {
+    return -ENOENT;
+  }
+  if (ret < 0) {
+    return ret;
+  }
+  try {
+    auto iter = bl.cbegin();
+    decode(*head, iter);
+  } catch (buffer::error& err) {
+    CLS_LOG(0, "ERROR: %s(): failed to decode gc queue head", __func__);
+    return -EIO;
+  }
+  return 0;
+}
+
+static int gc_queue_write_head(cls_method_context_t hctx, const cls_rgw_gc_queue_head& head)
+{
+  bufferlist bl;
+  encode(head, bl);
+  return cls_cxx_setxattr(hctx, GC_QUEUE_HEAD_ATTR, &bl);
+}
+
+/* write bl at position pos, wrapping around the end of the ring */
+static int gc_queue_write(cls_method_context_t hctx, const cls_rgw_gc_queue_head& head,
+                          uint64_t pos, bufferlist& bl)
+{
+  uint64_t ofs = pos % head.max_size;
+  uint64_t len = bl.length();
+  if (ofs + len <= head.max_size) {
+    return cls_cxx_write(hctx, ofs, len, &bl);
+  }
+  uint64_t first_len = head.max_size - ofs;
+  bufferlist first, second;
+  first.substr_of(bl, 0, first_len);
+  second.substr_of(bl, first_len, len - first_len);
+  int ret = cls_cxx_write(hctx, ofs, first_len, &first);
+  if (ret < 0) {
+    return ret;
+  }
+  return cls_cxx_write(hctx, 0, second.length(), &second);
+}
+
+/* append len bytes read at position pos to bl */
+static int gc_queue_read(cls_method_context_t hctx, const cls_rgw_gc_queue_head& head,
+                         uint64_t pos, uint64_t len, bufferlist *bl)
+{
+  while (len > 0) {
+    uint64_t ofs = pos % head.max_size;
+    uint64_t chunk = std::min(len, head.max_size - ofs);
+    bufferlist data;
+    int ret = cls_cxx_read(hctx, ofs, chunk, &data);
+    if (ret < 0) {
+      return ret;
+    }
+    if (data.length() != chunk) {
+      CLS_LOG(0, "ERROR: %s(): short read at ofs=%llu", __func__, (unsigned long long)ofs);
+      return -EIO;
+    }
+    bl->claim_append(data);
+    pos += chunk;
+    len -= chunk;
+  }
+  return 0;
+}
+
+/* iterates over the entries of [pos, head.tail), reading ahead in chunks */
+struct gc_queue_reader {
+  cls_method_context_t hctx;
+  const cls_rgw_gc_queue_head& head;
+  uint64_t pos;		///< position of the next entry
+  bufferlist buf;	///< the data read ahead from pos
+
+  gc_queue_reader(cls_method_context_t hctx, const cls_rgw_gc_queue_head& head,
+                  uint64_t pos) : hctx(hctx), head(head), pos(pos) {}
+
+  bool end() const { return pos >= head.tail; }
+
+  int fill(uint64_t len) {
+    if (buf.length() >= len) {
+      return 0;
+    }
+    uint64_t start = pos + buf.length();
+    uint64_t want = std::max<uint64_t>(len - buf.length(), GC_QUEUE_READ_CHUNK);
+    want = std::min(want, head.tail - start);
+    if (buf.length() + want < len) {
+      CLS_LOG(0, "ERROR: gc queue entry at pos=%llu runs past the tail",
+              (unsigned long long)pos);
+      return -EIO;
+    }
+    return gc_queue_read(hctx, head, start, want, &buf);
+  }
+
+  int next(cls_rgw_gc_obj_info *info) {
+    int ret = fill(GC_QUEUE_ENTRY_OVERHEAD);
+    if (ret < 0) {
+      return ret;
+    }
+    uint32_t magic, len;
+    auto iter = buf.cbegin();
+    decode(magic, iter);
+    decode(len, iter);
+    if (magic != GC_QUEUE_ENTRY_MAGIC) {
+      CLS_LOG(0, "ERROR: bad gc queue entry magic at pos=%llu", (unsigned long long)pos);
+      return -EIO;
+    }
+    ret = fill(GC_QUEUE_ENTRY_OVERHEAD + len);
+    if (ret < 0) {
+      return ret;
+    }
+    bufferlist data;
+    buf.splice(0, GC_QUEUE_ENTRY_OVERHEAD);
+    buf.splice(0, len, &data);
+    pos += GC_QUEUE_ENTRY_OVERHEAD + len;
+    return gc_record_decode(data, *info);
+  }
+};
+
+static int rgw_cls_gc_queue_init(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  auto in_iter = in->cbegin();
+
+  cls_rgw_gc_queue_init_op op;
+  try {
+    decode(op, in_iter);
+  } catch (buffer::error& err) {
+    CLS_LOG(1, "ERROR: rgw_cls_gc_queue_init(): failed to decode entry\n");
+    return -EINVAL;
+  }
+
+  if (op.size == 0) {
+    return -EINVAL;
+  }
+
+  cls_rgw_gc_queue_head head;
+  int ret = gc_queue_read_head(hctx, &head);
+  if (ret == 0) {
+    /* every gateway initializes the queue on startup */
+    return 0;
+  }
+  if (ret != -ENOENT) {
+    return ret;
+  }
+
+  head.max_size = op.size;
+  return gc_queue_write_head(hctx, head);
+}
+
+static int rgw_cls_gc_queue_enqueue(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  auto in_iter = in->cbegin();
+
+  cls_rgw_gc_set_entry_op op;
+  try {
+    decode(op, in_iter);
+  } catch (buffer::error& err) {
+    CLS_LOG(1, "ERROR: rgw_cls_gc_queue_enqueue(): failed to decode entry\n");
+    return -EINVAL;
+  }
+
+  cls_rgw_gc_queue_head head;
+  int ret = gc_queue_read_head(hctx, &head);
+  if (ret < 0) {
+    return ret;
+  }
+
+  op.info.time = ceph::real_clock::now();
+  op.info.time += make_timespan(op.expiration_secs);
+
+  bufferlist data;
+  encode(op.info, data);
+  bufferlist bl;
+  encode((uint32_t)GC_QUEUE_ENTRY_MAGIC, bl);
+  encode((uint32_t)data.length(), bl);
+  bl.claim_append(data);
+
+  if (head.used() + bl.length() > head.max_size) {
+    /* the omap index is still processed, fall back to it rather than
+     * failing the caller */
+    CLS_LOG(5, "gc queue is full, adding tag=%s to the omap index",
+            op.info.tag.c_str());
+    return gc_update_entry(hctx, op.expiration_secs, op.info);
+  }
+
+  ret = gc_queue_write(hctx, head, head.tail, bl);
+  if (ret < 0) {
+    return ret;
+  }
+  head.tail += bl.length();
+  return gc_queue_write_head(hctx, head);
+}
+
+static int rgw_cls_gc_queue_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  auto in_iter = in->cbegin();
+
+  cls_rgw_gc_list_op op;
+  try {
+    decode(op, in_iter);
+  } catch (buffer::error& err) {
+    CLS_LOG(1, "ERROR: rgw_cls_gc_queue_list(): failed to decode entry\n");
+    return -EINVAL;
+  }
+
+  cls_rgw_gc_queue_head head;
+  int ret = gc_queue_read_head(hctx, &head);
+  if (ret < 0) {
+    return ret;
+  }
+
+  uint64_t pos = head.front;
+  if (!op.marker.empty()) {
+    string err;
+    pos = strict_strtoll(op.marker.c_str(), 10, &err);
+    if (!err.empty() || pos > head.tail) {
+      CLS_LOG(1, "ERROR: rgw_cls_gc_queue_list(): bad marker=%s\n", op.marker.c_str());
+      return -EINVAL;
+    }
+    /* the entries before the marker might have been removed meanwhile */
+    pos = std::max(pos, head.front);
+  }
+
+  uint32_t max = (op.max ? op.max : GC_LIST_ENTRIES_DEFAULT);
+  auto now = ceph::real_clock::now();
+  cls_rgw_gc_list_ret op_ret;
+  op_ret.truncated = false;
+  uint64_t bytes = 0;
+  gc_queue_reader reader(hctx, head, pos);
+  while (!reader.end()) {
+    if (op_ret.entries.size() >= max || bytes >= GC_QUEUE_LIST_MAX_BYTES) {
+      op_ret.truncated = true;
+      break;
+    }
+    cls_rgw_gc_obj_info info;
+    ret = reader.next(&info);
+    if (ret < 0) {
+      return ret;
+    }
+    /* the entries are queued in the order they expire, deferred ones aside */
+    if (op.expired_only && info.time > now) {
+      break;
+    }
+    auto d = head.deferred.find(info.tag);
+    if (d != head.deferred.end() && d->second > info.time) {
+      info.time = d->second;
+    }
+    bytes += reader.pos - pos;
+    pos = reader.pos;
+    op_ret.entries.push_back(std::move(info));
+  }
+  op_ret.next_marker = std::to_string(pos);
+
+  encode(op_ret, *out);
+  return 0;
+}
+
+static int rgw_cls_gc_queue_remove(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  auto in_iter = in->cbegin();
+
+  cls_rgw_gc_queue_remove_op op;
+  try {
+    decode(op, in_iter);
+  } catch (buffer::error& err) {
+    CLS_LOG(1, "ERROR: rgw_cls_gc_queue_remove(): failed to decode entry\n");
+    return -EINVAL;
+  }
+
+  cls_rgw_gc_queue_head head;
+  int ret = gc_queue_read_head(hctx, &head);
+  if (ret < 0) {
+    return ret;
+  }
+
+  string err;
+  uint64_t end = strict_strtoll(op.end_marker.c_str(), 10, &err);
+  if (!err.empty() || end > head.tail) {
+    CLS_LOG(1, "ERROR: rgw_cls_gc_queue_remove(): bad marker=%s\n", op.end_marker.c_str());
+    return -EINVAL;
+  }
+  if (end <= head.front) {
+    return 0;
+  }
+
+  if (!head.deferred.empty()) {
+    /* drop the deferrals of the removed entries, unless the entry was
+     * queued before the tag got deferred and the caller queued it again */
+    auto now = ceph::real_clock::now();
+    gc_queue_reader reader(hctx, head, head.front);
+    while (reader.pos < end) {
+      cls_rgw_gc_obj_info info;
+      ret = reader.next(&info);
+      if (ret < 0) {
+        return ret;
+      }
+      auto d = head.deferred.find(info.tag);
+      if (d != head.deferred.end() && info.time >= d->second) {
+        head.deferred.erase(d);
+      }
+    }
+    if (reader.pos != end) {
+      CLS_LOG(1, "ERROR: rgw_cls_gc_queue_remove(): marker=%s is not an entry boundary\n",
+              op.end_marker.c_str());
+      return -EINVAL;
+    }
+    /* the deferrals that expired are moot, whether or not their tags are
+     * still queued */
+    for (auto d = head.deferred.begin(); d != head.deferred.end();) {
+      if (d->second <= now) {
+        d = head.deferred.erase(d);
+      } else {
+        ++d;
+      }
+    }
+  }
+
+  head.front = end;
+  return gc_queue_write_head(hctx, head);
+}
+
+static int rgw_cls_gc_queue_defer_entry(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  auto in_iter = in->cbegin();
+
+  cls_rgw_gc_defer_entry_op op;
+  try {
+    decode(op, in_iter);
+  } catch (buffer::error& err) {
+    CLS_LOG(1, "ERROR: rgw_cls_gc_queue_defer_entry(): failed to decode entry\n");
+    return -EINVAL;
+  }
+
+  /* the tag might have gone to the omap index when the queue was full */
+  int ret = gc_defer_entry(hctx, op.tag, op.expiration_secs);
+  if (ret != -ENOENT) {
+    return ret;
+  }
+
+  cls_rgw_gc_queue_head head;
+  ret = gc_queue_read_head(hctx, &head);
+  if (ret < 0) {
+    return ret;
+  }
+
+  auto& t = head.deferred[op.tag];
+  t = ceph::real_clock::now();
+  t += make_timespan(op.expiration_secs);
+  return gc_queue_write_head(hctx, head);
+}
+
 static int rgw_cls_lc_get_entry(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
 {
   auto in_iter = in->cbegin();
@@ -3952,6 +4443,8 @@ CLS_INIT(rgw)
   cls_method_handle_t h_rgw_bi_log_list_op;
   cls_method_handle_t h_rgw_bi_log_resync_op;
   cls_method_handle_t h_rgw_bi_log_stop_op;
+  cls_method_handle_t h_rgw_bi_reshard_log_list_op;
+  cls_method_handle_t h_rgw_bi_reshard_log_trim_op;
   cls_method_handle_t h_rgw_dir_suggest_changes;
   cls_method_handle_t h_rgw_user_usage_log_add;
   cls_method_handle_t h_rgw_user_usage_log_read;
@@ -3960,6 +4453,11 @@ CLS_INIT(rgw)
   cls_method_handle_t h_rgw_gc_set_entry;
   cls_method_handle_t h_rgw_gc_list;
   cls_method_handle_t h_rgw_gc_remove;
+  cls_method_handle_t h_rgw_gc_queue_init;
+  cls_method_handle_t h_rgw_gc_queue_enqueue;
+  cls_method_handle_t h_rgw_gc_queue_list;
+  cls_method_handle_t h_rgw_gc_queue_remove;
+  cls_method_handle_t h_rgw_gc_queue_defer_entry;
   cls_method_handle_t h_rgw_lc_get_entry;
   cls_method_handle_t h_rgw_lc_set_entry;
   cls_method_handle_t h_rgw_lc_rm_entry;
@@ -4009,6 +4507,8 @@ CLS_INIT(rgw)
 
   cls_register_cxx_method(h_class, RGW_BI_LOG_RESYNC, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bi_log_resync, &h_rgw_bi_log_resync_op);
   cls_register_cxx_method(h_class, RGW_BI_LOG_STOP, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bi_log_stop, &h_rgw_bi_log_stop_op);
+  cls_register_cxx_method(h_class, RGW_BI_RESHARD_LOG_LIST, CLS_METHOD_RD, rgw_bi_reshard_log_list, &h_rgw_bi_reshard_log_list_op);
+  cls_register_cxx_method(h_class, RGW_BI_RESHARD_LOG_TRIM, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bi_reshard_log_trim, &h_rgw_bi_reshard_log_trim_op);
 
   /* usage logging */
   cls_register_cxx_method(h_class, RGW_USER_USAGE_LOG_ADD, CLS_METHOD_RD | CLS_METHOD_WR, rgw_user_usage_log_add, &h_rgw_user_usage_log_add);
@@ -4021,6 +4521,11 @@ CLS_INIT(rgw)
   cls_register_cxx_method(h_class, RGW_GC_DEFER_ENTRY, CLS_METHOD_RD | CLS_METHOD_WR, rgw_cls_gc_defer_entry, &h_rgw_gc_set_entry);
   cls_register_cxx_method(h_class, RGW_GC_LIST, CLS_METHOD_RD, rgw_cls_gc_list, &h_rgw_gc_list);
   cls_register_cxx_method(h_class, RGW_GC_REMOVE, CLS_METHOD_RD | CLS_METHOD_WR, rgw_cls_gc_remove, &h_rgw_gc_remove);
+  cls_register_cxx_method(h_class, RGW_GC_QUEUE_INIT, CLS_METHOD_RD | CLS_METHOD_WR, rgw_cls_gc_queue_init, &h_rgw_gc_queue_init);
+  cls_register_cxx_method(h_class, RGW_GC_QUEUE_ENQUEUE, CLS_METHOD_RD | CLS_METHOD_WR, rgw_cls_gc_queue_enqueue, &h_rgw_gc_queue_enqueue);
+  cls_register_cxx_method(h_class, RGW_GC_QUEUE_LIST, CLS_METHOD_RD, rgw_cls_gc_queue_list, &h_rgw_gc_queue_list);
+  cls_register_cxx_method(h_class, RGW_GC_QUEUE_REMOVE, CLS_METHOD_RD | CLS_METHOD_WR, rgw_cls_gc_queue_remove, &h_rgw_gc_queue_remove);
+  cls_register_cxx_method(h_class, RGW_GC_QUEUE_DEFER_ENTRY, CLS_METHOD_RD | CLS_METHOD_WR, rgw_cls_gc_queue_defer_entry, &h_rgw_gc_queue_defer_entry);
 
   /* lifecycle bucket list */
   cls_register_cxx_method(h_class, RGW_LC_GET_ENTRY, CLS_METHOD_RD, rgw_cls_lc_get_entry, &h_rgw_lc_get_entry);
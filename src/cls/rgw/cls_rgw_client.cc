@@ -359,15 +359,53 @@ int cls_rgw_bi_list(librados::IoCtx& io_ctx, const string oid,
   return 0;
 }
 
-int cls_rgw_bucket_link_olh(librados::IoCtx& io_ctx, librados::ObjectWriteOperation& op,
-                            const string& oid, const cls_rgw_obj_key& key, bufferlist& olh_tag,
-                            bool delete_marker, const string& op_tag, rgw_bucket_dir_entry_meta *meta,
-                            uint64_t olh_epoch, ceph::real_time unmod_since, bool high_precision_time, bool log_op, rgw_zone_set& zones_trace)
+int cls_rgw_reshard_log_list(librados::IoCtx& io_ctx, const string& oid,
+                             const string& marker, uint32_t max,
+                             list<string> *names, bool *is_truncated)
 {
   bufferlist in, out;
+  rgw_cls_reshard_log_list_op call;
+  call.marker = marker;
+  call.max = max;
+  encode(call, in);
+  int r = io_ctx.exec(oid, RGW_CLASS, RGW_BI_RESHARD_LOG_LIST, in, out);
+  if (r < 0)
+    return r;
+
+  rgw_cls_reshard_log_list_ret op_ret;
+  auto iter = out.cbegin();
+  try {
+    decode(op_ret, iter);
+  } catch (buffer::error& err) {
+    return -EIO;
+  }
+
+  names->swap(op_ret.names);
+  *is_truncated = op_ret.is_truncated;
+
+  return 0;
+}
+
+void cls_rgw_reshard_log_trim(librados::ObjectWriteOperation& op,
+                              const list<string>& names)
+{
+  bufferlist in;
+  rgw_cls_reshard_log_trim_op call;
+  call.names = names;
+  encode(call, in);
+  op.exec(RGW_CLASS, RGW_BI_RESHARD_LOG_TRIM, in);
+}
+
+void cls_rgw_bucket_link_olh(librados::ObjectWriteOperation& op, const cls_rgw_obj_key& key,
+                             const bufferlist& olh_tag, bool delete_marker, const string& op_tag,
+                             const rgw_bucket_dir_entry_meta *meta, uint64_t olh_epoch,
+                             ceph::real_time unmod_since, bool high_precision_time, bool log_op,
+                             const rgw_zone_set& zones_trace)
+{
+  bufferlist in;
   rgw_cls_link_olh_op call;
   call.key = key;
-  call.olh_tag = string(olh_tag.c_str(), olh_tag.length());
+  call.olh_tag = olh_tag.to_str();
   call.op_tag = op_tag;
   call.delete_marker = delete_marker;
   if (meta) {
@@ -380,6 +418,15 @@ int cls_rgw_bucket_link_olh(librados::IoCtx& io_ctx, librados::ObjectWriteOperat
   call.zones_trace = zones_trace;
   encode(call, in);
   op.exec(RGW_CLASS, RGW_BUCKET_LINK_OLH, in);
+}
+
+int cls_rgw_bucket_link_olh(librados::IoCtx& io_ctx, librados::ObjectWriteOperation& op,
+                            const string& oid, const cls_rgw_obj_key& key, bufferlist& olh_tag,
+                            bool delete_marker, const string& op_tag, rgw_bucket_dir_entry_meta *meta,
+                            uint64_t olh_epoch, ceph::real_time unmod_since, bool high_precision_time, bool log_op, rgw_zone_set& zones_trace)
+{
+  cls_rgw_bucket_link_olh(op, key, olh_tag, delete_marker, op_tag, meta, olh_epoch,
+                          unmod_since, high_precision_time, log_op, zones_trace);
   int r = io_ctx.operate(oid, &op);
   if (r < 0)
     return r;
@@ -387,12 +434,12 @@ int cls_rgw_bucket_link_olh(librados::IoCtx& io_ctx, librados::ObjectWriteOperat
   return 0;
 }
 
-int cls_rgw_bucket_unlink_instance(librados::IoCtx& io_ctx, librados::ObjectWriteOperation& op,
-                                   const string& oid,
-                                   const cls_rgw_obj_key& key, const string& op_tag,
-                                   const string& olh_tag, uint64_t olh_epoch, bool log_op, rgw_zone_set& zones_trace)
+void cls_rgw_bucket_unlink_instance(librados::ObjectWriteOperation& op,
+                                    const cls_rgw_obj_key& key, const string& op_tag,
+                                    const string& olh_tag, uint64_t olh_epoch, bool log_op,
+                                    const rgw_zone_set& zones_trace)
 {
-  bufferlist in, out;
+  bufferlist in;
   rgw_cls_unlink_instance_op call;
   call.key = key;
   call.op_tag = op_tag;
@@ -402,6 +449,14 @@ int cls_rgw_bucket_unlink_instance(librados::IoCtx& io_ctx, librados::ObjectWrit
   call.zones_trace = zones_trace;
   encode(call, in);
   op.exec(RGW_CLASS, RGW_BUCKET_UNLINK_INSTANCE, in);
+}
+
+int cls_rgw_bucket_unlink_instance(librados::IoCtx& io_ctx, librados::ObjectWriteOperation& op,
+                                   const string& oid,
+                                   const cls_rgw_obj_key& key, const string& op_tag,
+                                   const string& olh_tag, uint64_t olh_epoch, bool log_op, rgw_zone_set& zones_trace)
+{
+  cls_rgw_bucket_unlink_instance(op, key, op_tag, olh_tag, olh_epoch, log_op, zones_trace);
   int r = io_ctx.operate(oid, &op);
   if (r < 0)
     return r;
@@ -409,6 +464,19 @@ int cls_rgw_bucket_unlink_instance(librados::IoCtx& io_ctx, librados::ObjectWrit
   return 0;
 }
 
+void cls_rgw_get_olh_log(librados::ObjectReadOperation& op, const cls_rgw_obj_key& olh, uint64_t ver_marker,
+                         const string& olh_tag, rgw_cls_read_olh_log_ret& log_ret, int& op_ret)
+{
+  bufferlist in;
+  rgw_cls_read_olh_log_op call;
+  call.olh = olh;
+  call.ver_marker = ver_marker;
+  call.olh_tag = olh_tag;
+  encode(call, in);
+  op.exec(RGW_CLASS, RGW_BUCKET_READ_OLH_LOG, in,
+          new ClsBucketIndexOpCtx<rgw_cls_read_olh_log_ret>(&log_ret, &op_ret));
+}
+
 int cls_rgw_get_olh_log(IoCtx& io_ctx, string& oid, librados::ObjectReadOperation& op, const cls_rgw_obj_key& olh, uint64_t ver_marker,
                         const string& olh_tag,
                         map<uint64_t, vector<rgw_bucket_olh_log_entry> > *log, bool *is_truncated)
@@ -756,6 +824,76 @@ void cls_rgw_gc_remove(librados::ObjectWriteOperation& op, const vector<string>&
   op.exec(RGW_CLASS, RGW_GC_REMOVE, in);
 }
 
+void cls_rgw_gc_queue_init(ObjectWriteOperation& op, uint64_t size)
+{
+  bufferlist in;
+  cls_rgw_gc_queue_init_op call;
+  call.size = size;
+  encode(call, in);
+  op.exec(RGW_CLASS, RGW_GC_QUEUE_INIT, in);
+}
+
+void cls_rgw_gc_queue_enqueue(ObjectWriteOperation& op, uint32_t expiration_secs,
+                              const cls_rgw_gc_obj_info& info)
+{
+  bufferlist in;
+  cls_rgw_gc_set_entry_op call;
+  call.expiration_secs = expiration_secs;
+  call.info = info;
+  encode(call, in);
+  op.exec(RGW_CLASS, RGW_GC_QUEUE_ENQUEUE, in);
+}
+
+void cls_rgw_gc_queue_defer_entry(ObjectWriteOperation& op, uint32_t expiration_secs,
+                                  const string& tag)
+{
+  bufferlist in;
+  cls_rgw_gc_defer_entry_op call;
+  call.expiration_secs = expiration_secs;
+  call.tag = tag;
+  encode(call, in);
+  op.exec(RGW_CLASS, RGW_GC_QUEUE_DEFER_ENTRY, in);
+}
+
+int cls_rgw_gc_queue_list(IoCtx& io_ctx, const string& oid, const string& marker,
+                          uint32_t max, bool expired_only, list<cls_rgw_gc_obj_info>& entries,
+                          bool *truncated, string& next_marker)
+{
+  bufferlist in, out;
+  cls_rgw_gc_list_op call;
+  call.marker = marker;
+  call.max = max;
+  call.expired_only = expired_only;
+  encode(call, in);
+  int r = io_ctx.exec(oid, RGW_CLASS, RGW_GC_QUEUE_LIST, in, out);
+  if (r < 0)
+    return r;
+
+  cls_rgw_gc_list_ret ret;
+  try {
+    auto iter = out.cbegin();
+    decode(ret, iter);
+  } catch (buffer::error& err) {
+    return -EIO;
+  }
+
+  entries.swap(ret.entries);
+
+  if (truncated)
+    *truncated = ret.truncated;
+  next_marker = std::move(ret.next_marker);
+  return r;
+}
+
+void cls_rgw_gc_queue_remove(ObjectWriteOperation& op, const string& end_marker)
+{
+  bufferlist in;
+  cls_rgw_gc_queue_remove_op call;
+  call.end_marker = end_marker;
+  encode(call, in);
+  op.exec(RGW_CLASS, RGW_GC_QUEUE_REMOVE, in);
+}
+
 int cls_rgw_lc_get_head(IoCtx& io_ctx, const string& oid, cls_rgw_lc_obj_head& head)
 {
   bufferlist in, out;
@@ -372,14 +372,33 @@ int cls_rgw_bi_list(librados::IoCtx& io_ctx, const string oid,
                    const string& name, const string& marker, uint32_t max,
                    list<rgw_cls_bi_entry> *entries, bool *is_truncated);
 
-
+/* the names of the objects changed while a shard is in reshard logging */
+int cls_rgw_reshard_log_list(librados::IoCtx& io_ctx, const string& oid,
+                             const string& marker, uint32_t max,
+                             list<string> *names, bool *is_truncated);
+void cls_rgw_reshard_log_trim(librados::ObjectWriteOperation& op,
+                              const list<string>& names);
+
+
+void cls_rgw_bucket_link_olh(librados::ObjectWriteOperation& op, const cls_rgw_obj_key& key,
+                             const bufferlist& olh_tag, bool delete_marker, const string& op_tag,
+                             const rgw_bucket_dir_entry_meta *meta, uint64_t olh_epoch,
+                             ceph::real_time unmod_since, bool high_precision_time, bool log_op,
+                             const rgw_zone_set& zones_trace);
 int cls_rgw_bucket_link_olh(librados::IoCtx& io_ctx, librados::ObjectWriteOperation& op,
                             const string& oid, const cls_rgw_obj_key& key, bufferlist& olh_tag,
                             bool delete_marker, const string& op_tag, rgw_bucket_dir_entry_meta *meta,
                             uint64_t olh_epoch, ceph::real_time unmod_since, bool high_precision_time, bool log_op, rgw_zone_set& zones_trace);
+void cls_rgw_bucket_unlink_instance(librados::ObjectWriteOperation& op,
+                                    const cls_rgw_obj_key& key, const string& op_tag,
+                                    const string& olh_tag, uint64_t olh_epoch, bool log_op,
+                                    const rgw_zone_set& zones_trace);
 int cls_rgw_bucket_unlink_instance(librados::IoCtx& io_ctx, librados::ObjectWriteOperation& op,
                                    const string& oid, const cls_rgw_obj_key& key, const string& op_tag,
                                    const string& olh_tag, uint64_t olh_epoch, bool log_op, rgw_zone_set& zones_trace);
+/* the result and op_ret are filled in when the read op completes */
+void cls_rgw_get_olh_log(librados::ObjectReadOperation& op, const cls_rgw_obj_key& olh, uint64_t ver_marker,
+                         const string& olh_tag, rgw_cls_read_olh_log_ret& log_ret, int& op_ret);
 int cls_rgw_get_olh_log(librados::IoCtx& io_ctx, string& oid, librados::ObjectReadOperation& op, const cls_rgw_obj_key& olh, uint64_t ver_marker,
                         const string& olh_tag,
                         map<uint64_t, vector<rgw_bucket_olh_log_entry> > *log, bool *is_truncated);
@@ -554,6 +573,17 @@ int cls_rgw_gc_list(librados::IoCtx& io_ctx, string& oid, string& marker, uint32
 
 void cls_rgw_gc_remove(librados::ObjectWriteOperation& op, const vector<string>& tags);
 
+/* gc queue, keeping the chains in the object data instead of omap */
+void cls_rgw_gc_queue_init(librados::ObjectWriteOperation& op, uint64_t size);
+void cls_rgw_gc_queue_enqueue(librados::ObjectWriteOperation& op, uint32_t expiration_secs,
+                              const cls_rgw_gc_obj_info& info);
+void cls_rgw_gc_queue_defer_entry(librados::ObjectWriteOperation& op, uint32_t expiration_secs,
+                                  const string& tag);
+int cls_rgw_gc_queue_list(librados::IoCtx& io_ctx, const string& oid, const string& marker,
+                          uint32_t max, bool expired_only, list<cls_rgw_gc_obj_info>& entries,
+                          bool *truncated, string& next_marker);
+void cls_rgw_gc_queue_remove(librados::ObjectWriteOperation& op, const string& end_marker);
+
 /* lifecycle */
 int cls_rgw_lc_get_head(librados::IoCtx& io_ctx, const string& oid, cls_rgw_lc_obj_head& head);
 int cls_rgw_lc_put_head(librados::IoCtx& io_ctx, const string& oid, cls_rgw_lc_obj_head& head);
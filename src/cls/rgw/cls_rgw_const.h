@@ -39,6 +39,9 @@
 #define RGW_BI_LOG_RESYNC "bi_log_resync"
 #define RGW_BI_LOG_STOP "bi_log_stop"
 
+#define RGW_BI_RESHARD_LOG_LIST "bi_reshard_log_list"
+#define RGW_BI_RESHARD_LOG_TRIM "bi_reshard_log_trim"
+
 /* usage logging */
 #define RGW_USER_USAGE_LOG_ADD "user_usage_log_add"
 #define RGW_USER_USAGE_LOG_READ "user_usage_log_read"
@@ -50,6 +53,11 @@
 #define RGW_GC_DEFER_ENTRY "gc_defer_entry"
 #define RGW_GC_LIST "gc_list"
 #define RGW_GC_REMOVE "gc_remove"
+#define RGW_GC_QUEUE_INIT "gc_queue_init"
+#define RGW_GC_QUEUE_ENQUEUE "gc_queue_enqueue"
+#define RGW_GC_QUEUE_LIST "gc_queue_list"
+#define RGW_GC_QUEUE_REMOVE "gc_queue_remove"
+#define RGW_GC_QUEUE_DEFER_ENTRY "gc_queue_defer_entry"
 
 /* lifecycle bucket list */
 #define RGW_LC_GET_ENTRY "lc_get_entry"
@@ -641,6 +641,8 @@ enum cls_rgw_reshard_status {
   CLS_RGW_RESHARD_NOT_RESHARDING  = 0,
   CLS_RGW_RESHARD_IN_PROGRESS     = 1,
   CLS_RGW_RESHARD_DONE            = 2,
+  // the shard takes writes, which are logged for the reshard to replay
+  CLS_RGW_RESHARD_LOGGING         = 3,
 };
 
 static inline std::string to_string(const enum cls_rgw_reshard_status status)
@@ -655,6 +657,9 @@ static inline std::string to_string(const enum cls_rgw_reshard_status status)
   case CLS_RGW_RESHARD_DONE:
     return "done";
     break;
+  case CLS_RGW_RESHARD_LOGGING:
+    return "logging";
+    break;
   default:
     break;
   };
@@ -698,12 +703,17 @@ struct cls_rgw_bucket_instance_entry {
     num_shards = new_num_shards;
   }
 
+  // writes to the shard are blocked
   bool resharding() const {
-    return reshard_status != CLS_RGW_RESHARD_NOT_RESHARDING;
+    return reshard_status != CLS_RGW_RESHARD_NOT_RESHARDING &&
+      reshard_status != CLS_RGW_RESHARD_LOGGING;
   }
   bool resharding_in_progress() const {
     return reshard_status == CLS_RGW_RESHARD_IN_PROGRESS;
   }
+  bool reshard_logging() const {
+    return reshard_status == CLS_RGW_RESHARD_LOGGING;
+  }
 };
 WRITE_CLASS_ENCODER(cls_rgw_bucket_instance_entry)
 
@@ -1099,6 +1109,41 @@ struct cls_rgw_gc_obj_info
 };
 WRITE_CLASS_ENCODER(cls_rgw_gc_obj_info)
 
+/*
+ * The gc queue keeps the chains in the data of the gc object, as a ring
+ * buffer of max_size bytes. Positions only ever grow, the offset of an
+ * entry in the object is its position modulo max_size.
+ */
+struct cls_rgw_gc_queue_head
+{
+  uint64_t max_size = 0;
+  uint64_t front = 0;	///< position of the oldest entry
+  uint64_t tail = 0;	///< position the next entry is written at
+  /// expiration of the tags deferred after they were queued
+  map<string, ceph::real_time> deferred;
+
+  uint64_t used() const { return tail - front; }
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(max_size, bl);
+    encode(front, bl);
+    encode(tail, bl);
+    encode(deferred, bl);
+    ENCODE_FINISH(bl);
+  }
+
+  void decode(bufferlist::const_iterator& bl) {
+    DECODE_START(1, bl);
+    decode(max_size, bl);
+    decode(front, bl);
+    decode(tail, bl);
+    decode(deferred, bl);
+    DECODE_FINISH(bl);
+  }
+};
+WRITE_CLASS_ENCODER(cls_rgw_gc_queue_head)
+
 struct cls_rgw_lc_obj_head
 {
   time_t start_date = 0;
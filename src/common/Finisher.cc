@@ -1,6 +1,8 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab
 
+#include <algorithm>
+
 #include "Finisher.h"
 
 #define dout_subsys ceph_subsys_finisher
@@ -26,10 +28,39 @@ void Finisher::stop()
   ldout(cct, 10) << __func__ << " finish" << dendl;
 }
 
+void Finisher::_push(queue_item_t *first, queue_item_t *last, size_t n)
+{
+  last->next = finisher_queue.load(std::memory_order_relaxed);
+  while (!finisher_queue.compare_exchange_weak(last->next, first)) {
+    // last->next now holds the current head, try again
+  }
+  if (logger)
+    logger->inc(l_finisher_queue_len, n);
+  // pairs with the store in finisher_thread_entry(): either it sees our
+  // items before it sleeps, or we see it sleeping and wake it up
+  if (finisher_sleeping.load()) {
+    std::lock_guard l(finisher_lock);
+    finisher_cond.notify_one();
+  }
+}
+
+void Finisher::_take_queue()
+{
+  auto item = finisher_queue.exchange(nullptr);
+  for (; item; ) {
+    in_progress_queue.emplace_back(item->c, item->r);
+    auto next = item->next;
+    delete item;
+    item = next;
+  }
+  // the queue was newest first
+  std::reverse(in_progress_queue.begin(), in_progress_queue.end());
+}
+
 void Finisher::wait_for_empty()
 {
   std::unique_lock ul(finisher_lock);
-  while (!finisher_queue.empty() || finisher_running) {
+  while (finisher_queue.load() || finisher_running) {
     ldout(cct, 10) << "wait_for_empty waiting" << dendl;
     finisher_empty_wait = true;
     finisher_empty_cond.wait(ul);
@@ -47,12 +78,11 @@ void *Finisher::finisher_thread_entry()
   uint64_t count = 0;
   while (!finisher_stop) {
     /// Every time we are woken up, we process the queue until it is empty.
-    while (!finisher_queue.empty()) {
-      // To reduce lock contention, we swap out the queue to process.
-      // This way other threads can submit new contexts to complete
-      // while we are working.
-      in_progress_queue.swap(finisher_queue);
+    while (finisher_queue.load()) {
+      // Take everything queued so far in one go; submitters never
+      // block on us, they just push onto the new, empty queue.
       finisher_running = true;
+      _take_queue();
       ul.unlock();
       ldout(cct, 10) << "finisher_thread doing " << in_progress_queue << dendl;
 
@@ -83,7 +113,11 @@ void *Finisher::finisher_thread_entry()
       break;
     
     ldout(cct, 10) << "finisher_thread sleeping" << dendl;
-    finisher_cond.wait(ul);
+    finisher_sleeping = true;
+    if (!finisher_queue.load()) {
+      finisher_cond.wait(ul);
+    }
+    finisher_sleeping = false;
   }
   // If we are exiting, we signal the thread waiting in stop(),
   // otherwise it would never unblock
@@ -94,3 +128,33 @@ void *Finisher::finisher_thread_entry()
   return 0;
 }
 
+ShardedFinisher::ShardedFinisher(CephContext *cct, const std::string& name,
+				 const std::string& tn, unsigned num_shards)
+{
+  ceph_assert(num_shards > 0);
+  for (unsigned i = 0; i < num_shards; i++) {
+    finishers.emplace_back(new Finisher(cct, name + "-" + std::to_string(i),
+					tn + std::to_string(i)));
+  }
+}
+
+void ShardedFinisher::start()
+{
+  for (auto& f : finishers) {
+    f->start();
+  }
+}
+
+void ShardedFinisher::stop()
+{
+  for (auto& f : finishers) {
+    f->stop();
+  }
+}
+
+void ShardedFinisher::wait_for_empty()
+{
+  for (auto& f : finishers) {
+    f->wait_for_empty();
+  }
+}
@@ -34,19 +34,27 @@ enum {
 /** @brief Asynchronous cleanup class.
  * Finisher asynchronously completes Contexts, which are simple classes
  * representing callbacks, in a dedicated worker thread. Enqueuing
- * contexts to complete is thread-safe.
+ * contexts to complete is thread-safe, and does not take a lock unless
+ * the worker is asleep.
  */
 class Finisher {
   CephContext *cct;
-  ceph::mutex finisher_lock; ///< Protects access to queues and finisher_running.
+  ceph::mutex finisher_lock; ///< Protects the conditions and finisher_running.
   ceph::condition_variable finisher_cond; ///< Signaled when there is something to process.
   ceph::condition_variable finisher_empty_cond; ///< Signaled when the finisher has nothing more to process.
   bool         finisher_stop; ///< Set when the finisher should stop.
   bool         finisher_running; ///< True when the finisher is currently executing contexts.
   bool	       finisher_empty_wait; ///< True mean someone wait finisher empty.
+  std::atomic<bool> finisher_sleeping = {false}; ///< True when the worker waits on finisher_cond.
 
-  /// Queue for contexts for which complete(0) will be called.
-  std::vector<std::pair<Context*,int>> finisher_queue;
+  struct queue_item_t {
+    Context *c;
+    int r;
+    queue_item_t *next;
+  };
+  /// Contexts for which complete(r) will be called, pushed by any
+  /// thread and taken all at once by the worker. Newest first.
+  std::atomic<queue_item_t*> finisher_queue = {nullptr};
   std::vector<std::pair<Context*,int>> in_progress_queue;
 
   std::string thread_name;
@@ -56,6 +64,26 @@ class Finisher {
   PerfCounters *logger;
 
   void *finisher_thread_entry();
+  /// push the chain first..last of n items, first being the newest
+  void _push(queue_item_t *first, queue_item_t *last, size_t n);
+  void _take_queue();
+
+  template<typename C>
+  void _queue_all(C& ls) {
+    queue_item_t *first = nullptr, *last = nullptr;
+    size_t n = 0;
+    for (auto i : ls) {
+      first = new queue_item_t{i, 0, first};
+      if (!last) {
+	last = first;
+      }
+      n++;
+    }
+    if (n) {
+      _push(first, last, n);
+    }
+    ls.clear();
+  }
 
   struct FinisherThread : public Thread {
     Finisher *fin;
@@ -66,57 +94,18 @@ class Finisher {
  public:
   /// Add a context to complete, optionally specifying a parameter for the complete function.
   void queue(Context *c, int r = 0) {
-    std::unique_lock ul(finisher_lock);
-    bool was_empty = finisher_queue.empty();
-    finisher_queue.push_back(std::make_pair(c, r));
-    if (was_empty) {
-      finisher_cond.notify_one();
-    }
-    if (logger)
-      logger->inc(l_finisher_queue_len);
+    auto item = new queue_item_t{c, r, nullptr};
+    _push(item, item, 1);
   }
 
   void queue(std::list<Context*>& ls) {
-    {
-      std::unique_lock ul(finisher_lock);
-      if (finisher_queue.empty()) {
-	finisher_cond.notify_all();
-      }
-      for (auto i : ls) {
-	finisher_queue.push_back(std::make_pair(i, 0));
-      }
-      if (logger)
-	logger->inc(l_finisher_queue_len, ls.size());
-    }
-    ls.clear();
+    _queue_all(ls);
   }
   void queue(std::deque<Context*>& ls) {
-    {
-      std::unique_lock ul(finisher_lock);
-      if (finisher_queue.empty()) {
-	finisher_cond.notify_all();
-      }
-      for (auto i : ls) {
-	finisher_queue.push_back(std::make_pair(i, 0));
-      }
-      if (logger)
-	logger->inc(l_finisher_queue_len, ls.size());
-    }
-    ls.clear();
+    _queue_all(ls);
   }
   void queue(std::vector<Context*>& ls) {
-    {
-      std::unique_lock ul(finisher_lock);
-      if (finisher_queue.empty()) {
-	finisher_cond.notify_all();
-      }
-      for (auto i : ls) {
-	finisher_queue.push_back(std::make_pair(i, 0));
-      }
-      if (logger)
-	logger->inc(l_finisher_queue_len, ls.size());
-    }
-    ls.clear();
+    _queue_all(ls);
   }
 
   /// Start the worker thread.
@@ -160,6 +149,11 @@ class Finisher {
   }
 
   ~Finisher() {
+    for (auto item = finisher_queue.load(); item; ) {
+      auto next = item->next;
+      delete item;
+      item = next;
+    }
     if (logger && cct) {
       cct->get_perfcounters_collection()->remove(logger);
       delete logger;
@@ -167,6 +161,35 @@ class Finisher {
   }
 };
 
+/** @brief A set of Finishers that complete Contexts in parallel.
+ * Contexts queued with the same key, e.g. an object or an IoCtx, are
+ * completed in order by the same worker, while contexts with different
+ * keys may run concurrently.
+ */
+class ShardedFinisher {
+  std::vector<std::unique_ptr<Finisher>> finishers;
+
+public:
+  /// Named shards log their queue length as finisher-<name>-<i>.
+  ShardedFinisher(CephContext *cct, const std::string& name,
+		  const std::string& tn, unsigned num_shards);
+
+  unsigned get_num_shards() const {
+    return finishers.size();
+  }
+  Finisher& get_shard(uint64_t key) {
+    // keys are often pointers, mix the low bits in
+    return *finishers[(key * 0x9e3779b97f4a7c15ull >> 32) % finishers.size()];
+  }
+  void queue(uint64_t key, Context *c, int r = 0) {
+    get_shard(key).queue(c, r);
+  }
+
+  void start();
+  void stop();
+  void wait_for_empty();
+};
+
 /// Context that is completed asynchronously on the supplied finisher.
 class C_OnFinisher : public Context {
   Context *con;
@@ -313,6 +313,13 @@ namespace PriorityCache
     }
   }
 
+  void Manager::shift_bins()
+  {
+    for (auto &l : caches) {
+      l.second->shift_bins();
+    }
+  }
+
   void Manager::balance_priority(int64_t *mem_avail, Priority pri)
   {
     std::unordered_map<std::string, std::shared_ptr<PriCache>> tmp_caches = caches;
@@ -100,6 +100,10 @@ namespace PriorityCache {
 
     // Get the name of this cache.
     virtual std::string get_cache_name() const = 0;
+
+    /* Start a new age interval.  Caches that tell recently used items from
+     * old ones may request memory for them at different priorities. */
+    virtual void shift_bins() {}
   };
 
   class Manager {
@@ -140,6 +144,7 @@ namespace PriorityCache {
     void clear();
     void tune_memory();
     void balance();
+    void shift_bins();
 
   private:
     void balance_priority(int64_t *mem_avail, Priority pri);
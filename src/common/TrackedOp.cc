@@ -22,39 +22,73 @@ static ostream& _prefix(std::ostream* _dout)
   return *_dout << "-- op tracker -- ";
 }
 
+void OpHistoryServiceThread::insert_op(const utime_t& now, TrackedOpRef op)
+{
+  // the queue owns the reference until entry() picks the op up
+  TrackedOp *o = op.detach();
+  o->history_stamp = now;
+  o->history_next = _external_queue.load(std::memory_order_relaxed);
+  while (!_external_queue.compare_exchange_weak(o->history_next, o,
+						std::memory_order_release,
+						std::memory_order_relaxed))
+    ;
+}
+
+void OpHistoryServiceThread::drop_queue(TrackedOp *op)
+{
+  while (op) {
+    TrackedOp *next = op->history_next;
+    op->history_next = nullptr;
+    TrackedOpRef ref(op, /* add_ref = */ false);
+    op = next;
+  }
+}
+
+OpHistoryServiceThread::~OpHistoryServiceThread()
+{
+  drop_queue(_external_queue.exchange(nullptr, std::memory_order_acquire));
+}
+
 void OpHistoryServiceThread::break_thread() {
-  queue_spinlock.lock();
-  _external_queue.clear();
   _break_thread = true;
-  queue_spinlock.unlock();
+  drop_queue(_external_queue.exchange(nullptr, std::memory_order_acquire));
 }
 
 void* OpHistoryServiceThread::entry() {
   int sleep_time = 1000;
-  list<pair<utime_t, TrackedOpRef>> internal_queue;
   while (1) {
-    queue_spinlock.lock();
     if (_break_thread) {
-      queue_spinlock.unlock();
       break;
     }
-    internal_queue.swap(_external_queue);
-    queue_spinlock.unlock();
-    if (internal_queue.empty()) {
+    TrackedOp *op = _external_queue.exchange(nullptr,
+					     std::memory_order_acquire);
+    if (!op) {
       usleep(sleep_time);
       if (sleep_time < 128000) {
         sleep_time <<= 2;
       }
-    } else {
-      sleep_time = 1000;
+      continue;
     }
-
-    while (!internal_queue.empty()) {
-      pair<utime_t, TrackedOpRef> op = internal_queue.front();
-      _ophistory->_insert_delayed(op.first, op.second);
-      internal_queue.pop_front();
+    sleep_time = 1000;
+
+    // restore the order the ops were inserted in
+    TrackedOp *oldest = nullptr;
+    while (op) {
+      TrackedOp *next = op->history_next;
+      op->history_next = oldest;
+      oldest = op;
+      op = next;
+    }
+    while (oldest) {
+      TrackedOp *next = oldest->history_next;
+      oldest->history_next = nullptr;
+      TrackedOpRef ref(oldest, /* add_ref = */ false);
+      _ophistory->_insert_delayed(oldest->history_stamp, ref);
+      oldest = next;
     }
   }
+  // anything queued after break_thread() drained the queue
+  drop_queue(_external_queue.exchange(nullptr, std::memory_order_acquire));
   return nullptr;
 }
 
@@ -434,6 +468,23 @@ void OpTracker::get_age_ms_histogram(pow2_hist_t *h)
 #undef dout_context
 #define dout_context tracker->cct
 
+void TrackedOp::mark_event(op_event_t event, utime_t stamp)
+{
+  if (!state)
+    return;
+
+  {
+    std::lock_guard l(lock);
+    events.emplace_back(stamp, event);
+  }
+  dout(6) << " seq: " << seq
+	  << ", time: " << stamp
+	  << ", event: " << op_event_name(event)
+	  << ", op: " << get_desc()
+	  << dendl;
+  _event_marked();
+}
+
 void TrackedOp::mark_event(std::string_view event, utime_t stamp)
 {
   if (!state)
@@ -15,6 +15,7 @@
 #define TRACKEDREQUEST_H_
 
 #include <atomic>
+#include <boost/container/small_vector.hpp>
 #include "common/histogram.h"
 #include "common/RWLock.h"
 #include "common/Thread.h"
@@ -30,24 +31,53 @@ class OpHistory;
 
 typedef boost::intrusive_ptr<TrackedOp> TrackedOpRef;
 
+/// the events marked on the hot path, recorded without building a std::string
+enum class op_event_t : uint8_t {
+  initiated,
+  header_read,
+  throttled,
+  all_read,
+  dispatched,
+  queued_for_pg,
+  reached_pg,
+  started,
+  commit_sent,
+  done,
+  dynamic,	///< any other event, its name is kept with the event
+};
+
+inline const char *op_event_name(op_event_t event) {
+  switch (event) {
+  case op_event_t::initiated: return "initiated";
+  case op_event_t::header_read: return "header_read";
+  case op_event_t::throttled: return "throttled";
+  case op_event_t::all_read: return "all_read";
+  case op_event_t::dispatched: return "dispatched";
+  case op_event_t::queued_for_pg: return "queued_for_pg";
+  case op_event_t::reached_pg: return "reached_pg";
+  case op_event_t::started: return "started";
+  case op_event_t::commit_sent: return "commit_sent";
+  case op_event_t::done: return "done";
+  default: return "";
+  }
+}
+
 class OpHistoryServiceThread : public Thread
 {
 private:
-  std::list<std::pair<utime_t, TrackedOpRef>> _external_queue;
+  /// ops handed over by insert_op(), newest first, linked by history_next
+  std::atomic<TrackedOp*> _external_queue = {nullptr};
   OpHistory* _ophistory;
-  mutable ceph::spinlock queue_spinlock;
-  bool _break_thread;
+  std::atomic<bool> _break_thread;
+  void drop_queue(TrackedOp *op);
 public:
   explicit OpHistoryServiceThread(OpHistory* parent)
     : _ophistory(parent),
       _break_thread(false) { }
+  ~OpHistoryServiceThread() override;
 
   void break_thread();
-  void insert_op(const utime_t& now, TrackedOpRef op) {
-    queue_spinlock.lock();
-    _external_queue.emplace_back(now, op);
-    queue_spinlock.unlock();
-  }
+  void insert_op(const utime_t& now, TrackedOpRef op);
 
   void *entry() override;
 };
@@ -192,10 +222,11 @@ public:
     retval->tracking_start();
 
     if (is_tracking()) {
-      retval->mark_event("header_read", params->get_recv_stamp());
-      retval->mark_event("throttled", params->get_throttle_stamp());
-      retval->mark_event("all_read", params->get_recv_complete_stamp());
-      retval->mark_event("dispatched", params->get_dispatch_stamp());
+      retval->mark_event(op_event_t::header_read, params->get_recv_stamp());
+      retval->mark_event(op_event_t::throttled, params->get_throttle_stamp());
+      retval->mark_event(op_event_t::all_read,
+			 params->get_recv_complete_stamp());
+      retval->mark_event(op_event_t::dispatched, params->get_dispatch_stamp());
     }
 
     return retval;
@@ -206,9 +237,13 @@ public:
 class TrackedOp : public boost::intrusive::list_base_hook<> {
 private:
   friend class OpHistory;
+  friend class OpHistoryServiceThread;
   friend class OpTracker;
 
   boost::intrusive::list_member_hook<> tracker_item;
+  /// while queued for the OpHistoryServiceThread
+  TrackedOp *history_next = nullptr;
+  utime_t history_stamp;
 
 public:
   typedef boost::intrusive::list<
@@ -234,25 +269,35 @@ protected:
 
   struct Event {
     utime_t stamp;
-    std::string str;
+    op_event_t id;
+    std::string str;	///< only set for op_event_t::dynamic
+
+    Event(utime_t t, op_event_t id) : stamp(t), id(id) {}
+    Event(utime_t t, std::string_view s)
+      : stamp(t), id(op_event_t::dynamic), str(s) {}
 
-    Event(utime_t t, std::string_view s) : stamp(t), str(s) {}
+    std::string_view name() const {
+      return id == op_event_t::dynamic ? std::string_view(str) :
+	std::string_view(op_event_name(id));
+    }
 
     int compare(const char *s) const {
-      return str.compare(s);
+      return name().compare(s);
     }
 
     const char *c_str() const {
-      return str.c_str();
+      return id == op_event_t::dynamic ? str.c_str() : op_event_name(id);
     }
 
     void dump(ceph::Formatter *f) const {
       f->dump_stream("time") << stamp;
-      f->dump_string("event", str);
+      f->dump_string("event", name());
     }
   };
 
-  std::vector<Event> events;    ///< std::list of events and their times
+  /// events and their times, the first OPTRACKER_PREALLOC_EVENTS are
+  /// stored inline so marking them does not allocate
+  boost::container::small_vector<Event, OPTRACKER_PREALLOC_EVENTS> events;
   mutable ceph::mutex lock = ceph::make_mutex("TrackedOp::lock"); ///< to protect the events list
   uint64_t seq = 0;        ///< a unique value std::set by the OpTracker
 
@@ -272,9 +317,7 @@ protected:
   TrackedOp(OpTracker *_tracker, const utime_t& initiated) :
     tracker(_tracker),
     initiated_at(initiated)
-  {
-    events.reserve(OPTRACKER_PREALLOC_EVENTS);
-  }
+  {}
 
   /// output any type-specific data you want to get when dump() is called
   virtual void _dump(ceph::Formatter *f) const {}
@@ -309,7 +352,7 @@ public:
 	break;
 
       case STATE_LIVE:
-	mark_event("done");
+	mark_event(op_event_t::done);
 	tracker->unregister_inflight_op(this);
 	_unregistered();
 	if (!tracker->is_tracking()) {
@@ -359,13 +402,14 @@ public:
 
   double get_duration() const {
     std::lock_guard l(lock);
-    if (!events.empty() && events.rbegin()->compare("done") == 0)
+    if (!events.empty() && events.rbegin()->id == op_event_t::done)
       return events.rbegin()->stamp - get_initiated();
     else
       return ceph_clock_now() - get_initiated();
   }
 
   void mark_event(std::string_view event, utime_t stamp=ceph_clock_now());
+  void mark_event(op_event_t event, utime_t stamp=ceph_clock_now());
 
   void mark_nowarn() {
     warn_interval_multiplier = 0;
@@ -373,14 +417,14 @@ public:
 
   virtual std::string_view state_string() const {
     std::lock_guard l(lock);
-    return events.empty() ? std::string_view() : std::string_view(events.rbegin()->str);
+    return events.empty() ? std::string_view() : events.rbegin()->name();
   }
 
   void dump(utime_t now, ceph::Formatter *f) const;
 
   void tracking_start() {
     if (tracker->register_inflight_op(this)) {
-      events.emplace_back(initiated_at, "initiated");
+      events.emplace_back(initiated_at, op_event_t::initiated);
       state = STATE_LIVE;
     }
   }
@@ -273,6 +273,7 @@ void ShardedThreadPool::shardedthreadpool_worker(uint32_t thread_index)
   ss << name << " thread " << (void *)pthread_self();
   heartbeat_handle_d *hb = cct->get_heartbeat_map()->add_worker(ss.str(), pthread_self());
 
+  wq->_thread_start(thread_index);
   while (!stop_threads) {
     if (pause_threads) {
       std::unique_lock ul(shardedpool_lock);
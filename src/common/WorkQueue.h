@@ -657,6 +657,8 @@ public:
     BaseShardedWQ(time_t ti, time_t sti):timeout_interval(ti), suicide_interval(sti) {}
     virtual ~BaseShardedWQ() {}
 
+    /// called once by each thread before it starts processing
+    virtual void _thread_start(uint32_t thread_index) {}
     virtual void _process(uint32_t thread_index, ceph::heartbeat_handle_d *hb ) = 0;
     virtual void return_waiting_threads() = 0;
     virtual void stop_return_waiting_threads() = 0;
@@ -136,3 +136,68 @@ void compressible_bloom_filter::generate_test_instances(std::list<compressible_b
   ls.back()->compress(20);
   ls.back()->insert("boogggg");
 }
+
+
+void blocked_bloom_filter::encode(bufferlist& bl) const
+{
+  ENCODE_START(1, 1, bl);
+  encode((uint64_t)insert_count_, bl);
+  encode((uint64_t)target_element_count_, bl);
+  encode(random_seed_, bl);
+  // the words, little-endian; their count gives the block count
+  bufferptr bp(block_count_ * block_bytes);
+  ceph_le32 *w = reinterpret_cast<ceph_le32*>(bp.c_str());
+  for (std::size_t i = 0; i < block_count_ * words_per_block; ++i) {
+    w[i] = table_[i];
+  }
+  encode(bp, bl);
+  ENCODE_FINISH(bl);
+}
+
+void blocked_bloom_filter::decode(bufferlist::const_iterator& p)
+{
+  DECODE_START(1, p);
+  uint64_t v;
+  decode(v, p);
+  insert_count_ = v;
+  decode(v, p);
+  target_element_count_ = v;
+  decode(random_seed_, p);
+  bufferlist t;
+  decode(t, p);
+  std::size_t blocks = t.length() / block_bytes;
+  if (t.length() % block_bytes || (blocks & (blocks - 1))) {
+    throw buffer::malformed_input("bad blocked_bloom_filter table size");
+  }
+
+  release();
+  block_count_ = blocks;
+  init();
+  const ceph_le32 *w = reinterpret_cast<const ceph_le32*>(t.c_str());
+  for (std::size_t i = 0; i < block_count_ * words_per_block; ++i) {
+    table_[i] = w[i];
+  }
+
+  DECODE_FINISH(p);
+}
+
+void blocked_bloom_filter::dump(Formatter *f) const
+{
+  f->dump_unsigned("block_count", block_count_);
+  f->dump_unsigned("insert_count", insert_count_);
+  f->dump_unsigned("target_element_count", target_element_count_);
+  f->dump_unsigned("random_seed", random_seed_);
+  f->dump_float("density", density());
+}
+
+void blocked_bloom_filter::generate_test_instances(std::list<blocked_bloom_filter*>& ls)
+{
+  ls.push_back(new blocked_bloom_filter);
+  ls.push_back(new blocked_bloom_filter(10, .5, 1));
+  ls.back()->insert(1);
+  ls.back()->insert(2);
+  ls.push_back(new blocked_bloom_filter(500, .01, 1));
+  for (uint32_t i = 0; i < 100; ++i)
+    ls.back()->insert(i);
+  ls.back()->fold();
+}
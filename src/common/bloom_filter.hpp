@@ -623,6 +623,231 @@ public:
 };
 WRITE_CLASS_ENCODER(compressible_bloom_filter)
 
+
+/**
+ * bloom filter that keeps all the bits of a key in one 32-byte block
+ *
+ * Each key sets one bit in each of the eight 32-bit words of a single
+ * block, so a probe touches one cache line and the eight word tests are
+ * independent, which lets the compiler vectorize them.  The block count is
+ * a power of two so that seal-time compression can fold the upper half of
+ * the table onto the lower half without rehashing.
+ */
+class blocked_bloom_filter
+{
+public:
+  static const std::size_t words_per_block = 8;
+  static const std::size_t block_bytes = words_per_block * sizeof(uint32_t);
+
+  blocked_bloom_filter() {}
+
+  blocked_bloom_filter(std::size_t predicted_inserted_element_count,
+		       double false_positive_probability,
+		       uint64_t random_seed)
+    : target_element_count_(predicted_inserted_element_count),
+      random_seed_(random_seed)
+  {
+    ceph_assert(false_positive_probability > 0.0);
+    // size as for a classic filter with words_per_block hash functions
+    double bits = -(double)words_per_block * predicted_inserted_element_count /
+      std::log(1.0 - std::pow(false_positive_probability,
+			      1.0 / words_per_block));
+    block_count_ = 1;
+    while (block_count_ * block_bytes * bits_per_char < bits) {
+      block_count_ <<= 1;
+    }
+    init();
+  }
+
+  blocked_bloom_filter(const blocked_bloom_filter& o)
+  {
+    *this = o;
+  }
+
+  blocked_bloom_filter& operator=(const blocked_bloom_filter& o)
+  {
+    if (this != &o) {
+      release();
+      block_count_ = o.block_count_;
+      insert_count_ = o.insert_count_;
+      target_element_count_ = o.target_element_count_;
+      random_seed_ = o.random_seed_;
+      init();
+      if (table_) {
+	std::copy_n(o.table_, block_count_ * words_per_block, table_);
+      }
+    }
+    return *this;
+  }
+
+  ~blocked_bloom_filter()
+  {
+    release();
+  }
+
+  void clear()
+  {
+    if (table_)
+      std::fill_n(table_, block_count_ * words_per_block, 0);
+    insert_count_ = 0;
+  }
+
+  /**
+   * insert a u32 into the set
+   *
+   * @param val integer value to insert; it is remixed, so even
+   *            consecutive values are fine
+   */
+  void insert(uint32_t val)
+  {
+    ceph_assert(table_);
+    uint64_t h = hash(val);
+    uint32_t* block = get_block(h);
+    for (std::size_t i = 0; i < words_per_block; ++i) {
+      block[i] |= mask_bit(h, i);
+    }
+    ++insert_count_;
+  }
+
+  /**
+   * check if a u32 is contained by set
+   *
+   * @param val integer value to query
+   * @returns true if value is (probably) in the set, false if it definitely is not
+   */
+  bool contains(uint32_t val) const
+  {
+    if (!table_)
+      return false;
+    uint64_t h = hash(val);
+    const uint32_t* block = get_block(h);
+    uint32_t missing = 0;
+    for (std::size_t i = 0; i < words_per_block; ++i) {
+      missing |= mask_bit(h, i) & ~block[i];
+    }
+    return missing == 0;
+  }
+
+  std::size_t size() const
+  {
+    return block_count_ * block_bytes * bits_per_char;
+  }
+
+  std::size_t element_count() const
+  {
+    return insert_count_;
+  }
+
+  bool is_full() const
+  {
+    return insert_count_ >= target_element_count_;
+  }
+
+  /// fraction of the bits that are set
+  double density() const
+  {
+    if (!table_)
+      return 0.0;
+    std::size_t set = 0;
+    for (std::size_t i = 0; i < block_count_ * words_per_block; ++i) {
+      set += __builtin_popcount(table_[i]);
+    }
+    return (double)set / (double)size();
+  }
+
+  double approx_unique_element_count() const
+  {
+    // invert the expected fill of a filter with words_per_block hashes
+    double d = density();
+    if (d >= 1.0)
+      return insert_count_;
+    return -(double)size() / words_per_block * std::log(1.0 - d);
+  }
+
+  /**
+   * halve the table by or-ing its upper half onto its lower half
+   *
+   * @returns false if the table cannot shrink any further
+   */
+  bool fold()
+  {
+    if (block_count_ <= 1)
+      return false;
+    std::size_t half = block_count_ / 2;
+    uint32_t* t = allocate(half);
+    for (std::size_t i = 0; i < half * words_per_block; ++i) {
+      t[i] = table_[i] | table_[i + half * words_per_block];
+    }
+    release();
+    table_ = t;
+    block_count_ = half;
+    return true;
+  }
+
+private:
+  uint32_t* table_ = nullptr;       ///< block_count_ blocks of words_per_block words
+  std::size_t block_count_ = 0;     ///< always a power of two, or 0
+  std::size_t insert_count_ = 0;
+  std::size_t target_element_count_ = 0;
+  uint64_t random_seed_ = 0;
+
+  static uint32_t* allocate(std::size_t blocks)
+  {
+    return reinterpret_cast<uint32_t*>(
+      mempool::bloom_filter::alloc_byte.allocate(blocks * block_bytes));
+  }
+
+  void init()
+  {
+    if (block_count_) {
+      table_ = allocate(block_count_);
+      std::fill_n(table_, block_count_ * words_per_block, 0);
+    }
+  }
+
+  void release()
+  {
+    if (table_) {
+      mempool::bloom_filter::alloc_byte.deallocate(
+	reinterpret_cast<unsigned char*>(table_), block_count_ * block_bytes);
+      table_ = nullptr;
+    }
+  }
+
+  uint64_t hash(uint32_t val) const
+  {
+    // murmur3 fmix64: the high half picks the block, the low half the bits
+    uint64_t h = (((uint64_t)val << 32) | val) ^ random_seed_;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+  }
+
+  uint32_t* get_block(uint64_t h) const
+  {
+    return table_ + ((h >> 32) & (block_count_ - 1)) * words_per_block;
+  }
+
+  static uint32_t mask_bit(uint64_t h, std::size_t i)
+  {
+    static const uint32_t salt[words_per_block] = {
+      0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d,
+      0x705495c7, 0x2df1424b, 0x9efc4947, 0x5c6bfb31
+    };
+    return 1u << (((uint32_t)h * salt[i]) >> 27);
+  }
+
+public:
+  void encode(ceph::buffer::list& bl) const;
+  void decode(ceph::buffer::list::const_iterator& bl);
+  void dump(ceph::Formatter *f) const;
+  static void generate_test_instances(std::list<blocked_bloom_filter*>& ls);
+};
+WRITE_CLASS_ENCODER(blocked_bloom_filter)
+
 #endif
 
 
@@ -12,11 +12,15 @@
  * 
  */
 
+#include <array>
 #include <atomic>
 #include <errno.h>
 #include <limits.h>
 
 #include <sys/uio.h>
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#endif
 
 #include "include/ceph_assert.h"
 #include "include/types.h"
@@ -159,28 +163,119 @@ static ceph::spinlock debug_lock;
   };
 
 #ifndef __CYGWIN__
+namespace {
+  /*
+   * Aligned buffers of a few pages are what the O_DIRECT write path
+   * rebuilds every misaligned client write into, and they are freed as
+   * soon as the write is on disk.  Keep the freed blocks on the thread,
+   * by page count, instead of going back to posix_memalign each time.
+   * Like the ptr_node cache below, a block freed after the reaper ran
+   * just goes back to the allocator.  An OSD runs hundreds of threads, so
+   * each keeps little, and what is kept shows up in buffer_anon.
+   */
+  constexpr unsigned PAGE_POOL_MAX_PAGES = 16;
+  constexpr unsigned PAGE_POOL_DEPTH = 4;
+  constexpr size_t PAGE_POOL_MAX_BYTES = 256 << 10;
+  struct page_pool_t {
+    void* blocks[PAGE_POOL_MAX_PAGES][PAGE_POOL_DEPTH];
+    unsigned num[PAGE_POOL_MAX_PAGES];
+    size_t bytes;
+  };
+  thread_local page_pool_t page_pool;
+  thread_local bool page_pool_armed = false;
+  thread_local bool page_pool_dead = false;
+
+  void page_pool_account(ssize_t blocks, ssize_t bytes) {
+    mempool::get_pool(mempool::mempool_buffer_anon).adjust_count(blocks, bytes);
+  }
+
+  struct page_pool_reaper_t {
+    void arm() {
+      page_pool_armed = true;
+    }
+    ~page_pool_reaper_t() {
+      ssize_t blocks = 0;
+      for (unsigned i = 0; i < PAGE_POOL_MAX_PAGES; ++i) {
+	while (page_pool.num[i] > 0) {
+	  ::free(page_pool.blocks[i][--page_pool.num[i]]);
+	  ++blocks;
+	}
+      }
+      page_pool_account(-blocks, -(ssize_t)page_pool.bytes);
+      page_pool.bytes = 0;
+      page_pool_dead = true;
+    }
+  };
+  thread_local page_pool_reaper_t page_pool_reaper;
+
+  /// pages to allocate for a pooled raw_posix_aligned, or 0 if not pooled
+  unsigned page_pool_pages(unsigned len, unsigned align) {
+    if (len == 0 || align > CEPH_PAGE_SIZE ||
+	len > PAGE_POOL_MAX_PAGES * CEPH_PAGE_SIZE) {
+      return 0;
+    }
+    return (len + CEPH_PAGE_SIZE - 1) >> CEPH_PAGE_SHIFT;
+  }
+
+  char* page_pool_get(unsigned pages) {
+    auto& n = page_pool.num[pages - 1];
+    if (n == 0) {
+      return nullptr;
+    }
+    page_pool.bytes -= pages * CEPH_PAGE_SIZE;
+    page_pool_account(-1, -(ssize_t)(pages * CEPH_PAGE_SIZE));
+    return static_cast<char*>(page_pool.blocks[pages - 1][--n]);
+  }
+
+  bool page_pool_put(char* p, unsigned pages) {
+    size_t bytes = pages * CEPH_PAGE_SIZE;
+    auto& n = page_pool.num[pages - 1];
+    if (page_pool_dead || n == PAGE_POOL_DEPTH ||
+	page_pool.bytes + bytes > PAGE_POOL_MAX_BYTES) {
+      return false;
+    }
+    if (!page_pool_armed) {
+      // registers the reaper with this thread's exit
+      page_pool_reaper.arm();
+    }
+    page_pool.blocks[pages - 1][n++] = p;
+    page_pool.bytes += bytes;
+    page_pool_account(1, bytes);
+    return true;
+  }
+}
+
   class buffer::raw_posix_aligned : public buffer::raw {
     unsigned align;
+    unsigned pool_pages;
   public:
     MEMPOOL_CLASS_HELPERS();
 
     raw_posix_aligned(unsigned l, unsigned _align) : raw(l) {
       align = _align;
       ceph_assert((align >= sizeof(void *)) && (align & (align - 1)) == 0);
+      pool_pages = page_pool_pages(len, align);
+      size_t alloc_len = pool_pages ? pool_pages * CEPH_PAGE_SIZE : len;
+      data = pool_pages ? page_pool_get(pool_pages) : nullptr;
+      if (!data) {
 #ifdef DARWIN
-      data = (char *) valloc(len);
+	data = (char *) valloc(alloc_len);
 #else
-      int r = ::posix_memalign((void**)(void*)&data, align, len);
-      if (r)
-	throw bad_alloc();
+	int r = ::posix_memalign((void**)(void*)&data,
+				 pool_pages ? CEPH_PAGE_SIZE : align,
+				 alloc_len);
+	if (r)
+	  throw bad_alloc();
 #endif /* DARWIN */
-      if (!data)
-	throw bad_alloc();
+	if (!data)
+	  throw bad_alloc();
+      }
       bdout << "raw_posix_aligned " << this << " alloc " << (void *)data
 	    << " l=" << l << ", align=" << align << bendl;
     }
     ~raw_posix_aligned() override {
-      ::free(data);
+      if (!pool_pages || !page_pool_put(data, pool_pages))
+	::free(data);
       bdout << "raw_posix_aligned " << this << " free " << (void *)data << bendl;
     }
     raw* clone_empty() override {
@@ -1166,13 +1261,65 @@ static ceph::spinlock debug_lock;
       rebuild(ptr_node::create(buffer::create(_len)));
   }
 
+namespace {
+  /*
+   * A rebuild for the device this large will not be read back before it
+   * is written, so write it around the cache rather than evicting
+   * everything else to make room for it.
+   */
+  constexpr size_t STREAMING_COPY_MIN = 256 << 10;
+
+  void streaming_copy(char* dst, const char* src, size_t len)
+  {
+#if defined(__x86_64__)
+    size_t head = -reinterpret_cast<uintptr_t>(dst) & 15;
+    if (head >= len) {
+      memcpy(dst, src, len);
+      return;
+    }
+    memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    len -= head;
+    for (; len >= 64; dst += 64, src += 64, len -= 64) {
+      auto s = reinterpret_cast<const __m128i*>(src);
+      auto d = reinterpret_cast<__m128i*>(dst);
+      __m128i a = _mm_loadu_si128(s);
+      __m128i b = _mm_loadu_si128(s + 1);
+      __m128i c = _mm_loadu_si128(s + 2);
+      __m128i e = _mm_loadu_si128(s + 3);
+      _mm_stream_si128(d, a);
+      _mm_stream_si128(d + 1, b);
+      _mm_stream_si128(d + 2, c);
+      _mm_stream_si128(d + 3, e);
+    }
+    _mm_sfence();
+#endif
+    memcpy(dst, src, len);
+  }
+}
+
   void buffer::list::rebuild(
     std::unique_ptr<buffer::ptr_node, buffer::ptr_node::disposer> nb)
+  {
+    _rebuild(std::move(nb), false);
+  }
+
+  void buffer::list::_rebuild(
+    std::unique_ptr<buffer::ptr_node, buffer::ptr_node::disposer> nb,
+    bool streaming)
   {
     unsigned pos = 0;
-    for (auto& node : _buffers) {
-      nb->copy_in(pos, node.length(), node.c_str(), false);
-      pos += node.length();
+    if (streaming && _len >= STREAMING_COPY_MIN && nb->length() >= _len) {
+      for (auto& node : _buffers) {
+	streaming_copy(nb->c_str() + pos, node.c_str(), node.length());
+	pos += node.length();
+      }
+    } else {
+      for (auto& node : _buffers) {
+	nb->copy_in(pos, node.length(), node.c_str(), false);
+	pos += node.length();
+      }
     }
     _memcopy_count += pos;
     _carriage = &always_empty_bptr;
@@ -1193,6 +1340,23 @@ static ceph::spinlock debug_lock;
   bool buffer::list::rebuild_aligned_size_and_memory(unsigned align_size,
 						    unsigned align_memory,
 						    unsigned max_buffers)
+  {
+    return _rebuild_aligned_size_and_memory(align_size, align_memory,
+					    max_buffers, false);
+  }
+
+  bool buffer::list::rebuild_aligned_for_device(unsigned align_size,
+					       unsigned align_memory,
+					       unsigned max_buffers)
+  {
+    return _rebuild_aligned_size_and_memory(align_size, align_memory,
+					    max_buffers, true);
+  }
+
+  bool buffer::list::_rebuild_aligned_size_and_memory(unsigned align_size,
+						     unsigned align_memory,
+						     unsigned max_buffers,
+						     bool streaming)
   {
     unsigned old_memcopy_count = _memcopy_count;
 
@@ -1235,9 +1399,10 @@ static ceph::spinlock debug_lock;
   	      !p->is_n_align_sized(align_size) ||
   	      (offset % align_size)));
       if (!(unaligned.is_contiguous() && unaligned._buffers.front().is_aligned(align_memory))) {
-        unaligned.rebuild(
+        unaligned._rebuild(
           ptr_node::create(
-            buffer::create_aligned(unaligned._len, align_memory)));
+            buffer::create_aligned(unaligned._len, align_memory)),
+          streaming);
         _memcopy_count += unaligned._len;
       }
       _buffers.insert_after(p_prev, *ptr_node::create(unaligned._buffers.front()).release());
@@ -1988,8 +2153,32 @@ __u32 buffer::list::crc32c(__u32 crc) const
   int cache_hits = 0;
   int cache_adjusts = 0;
 
+  /*
+   * Short segments are not worth caching a crc for; hash runs of them
+   * together so ceph_crc32c_segments() can interleave them, instead of
+   * one short call plus a trip through the raw's crc spinlock per ptr.
+   */
+  const unsigned STITCH_MAX_SEGMENT = CEPH_PAGE_SIZE;
+  std::array<ceph_crc32c_segment, 64> run;
+  unsigned run_len = 0;
+  auto flush_run = [&] {
+    if (run_len) {
+      crc = ceph_crc32c_segments(crc, run.data(), run_len);
+      cache_misses += run_len;
+      run_len = 0;
+    }
+  };
+
   for (const auto& node : _buffers) {
     if (node.length()) {
+      if (node.length() < STITCH_MAX_SEGMENT) {
+	run[run_len++] = {(unsigned char*)node.c_str(), node.length()};
+	if (run_len == run.size()) {
+	  flush_run();
+	}
+	continue;
+      }
+      flush_run();
       raw* const r = node.get_raw();
       pair<size_t, size_t> ofs(node.offset(), node.offset() + node.length());
       pair<uint32_t, uint32_t> ccrc;
@@ -2018,6 +2207,7 @@ __u32 buffer::list::crc32c(__u32 crc) const
       }
     }
   }
+  flush_run();
 
   if (buffer_track_crc) {
     if (cache_adjusts)
@@ -2156,6 +2346,64 @@ buffer::list buffer::list::static_from_string(string& s) {
   // const makes me generally sad.
 }
 
+namespace {
+  /*
+   * Every bufferptr that goes into a bufferlist gets its own ptr_node,
+   * so encoding a message costs as many small allocations as it has
+   * segments, and they are all freed again once the message is sent.
+   * Keep the freed nodes around on the thread instead of handing them
+   * back to the allocator.
+   *
+   * The storage is trivially destructible, so a node freed by another
+   * thread_local's destructor after the reaper ran is still safe: it
+   * just goes back to the allocator.
+   */
+  constexpr unsigned PTR_NODE_CACHE_SIZE = 64;
+  thread_local void* ptr_node_cache[PTR_NODE_CACHE_SIZE];
+  thread_local unsigned ptr_node_cache_num = 0;
+  enum class cache_state_t : uint8_t { UNUSED, ARMED, DEAD };
+  thread_local cache_state_t ptr_node_cache_state = cache_state_t::UNUSED;
+
+  struct ptr_node_cache_reaper_t {
+    void arm() {
+      ptr_node_cache_state = cache_state_t::ARMED;
+    }
+    ~ptr_node_cache_reaper_t() {
+      while (ptr_node_cache_num > 0) {
+	::operator delete(ptr_node_cache[--ptr_node_cache_num]);
+      }
+      ptr_node_cache_state = cache_state_t::DEAD;
+    }
+  };
+  thread_local ptr_node_cache_reaper_t ptr_node_cache_reaper;
+}
+
+void* buffer::ptr_node::operator new(const size_t size)
+{
+  if (likely(size == sizeof(ptr_node) && ptr_node_cache_num > 0)) {
+    return ptr_node_cache[--ptr_node_cache_num];
+  }
+  return ::operator new(size);
+}
+
+void buffer::ptr_node::operator delete(void* const p)
+{
+  if (likely(ptr_node_cache_num < PTR_NODE_CACHE_SIZE)) {
+    switch (ptr_node_cache_state) {
+    case cache_state_t::UNUSED:
+      // registers the reaper with this thread's exit
+      ptr_node_cache_reaper.arm();
+      [[fallthrough]];
+    case cache_state_t::ARMED:
+      ptr_node_cache[ptr_node_cache_num++] = p;
+      return;
+    case cache_state_t::DEAD:
+      break;
+    }
+  }
+  ::operator delete(p);
+}
+
 bool buffer::ptr_node::dispose_if_hypercombined(
   buffer::ptr_node* const delete_this)
 {
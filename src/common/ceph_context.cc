@@ -142,16 +142,24 @@ public:
       this,
       "get mempool stats");
     ceph_assert(r == 0);
+    r = cct->get_admin_socket()->register_command(
+      "dump_mempool_sites",
+      "dump_mempool_sites",
+      this,
+      "dump call sites of sampled mempool allocations still in use");
+    ceph_assert(r == 0);
   }
   ~MempoolObs() override {
     cct->_conf.remove_observer(this);
     cct->get_admin_socket()->unregister_command("dump_mempools");
+    cct->get_admin_socket()->unregister_command("dump_mempool_sites");
   }
 
   // md_config_obs_t
   const char** get_tracked_conf_keys() const override {
     static const char *KEYS[] = {
       "mempool_debug",
+      "mempool_sample_rate",
       NULL
     };
     return KEYS;
@@ -163,6 +171,10 @@ public:
     if (changed.count("mempool_debug")) {
       mempool::set_debug_mode(cct->_conf->mempool_debug);
     }
+    if (changed.count("mempool_sample_rate")) {
+      mempool::set_sample_rate(
+	cct->_conf.get_val<uint64_t>("mempool_sample_rate"));
+    }
   }
 
   // AdminSocketHook
@@ -176,6 +188,14 @@ public:
       f->flush(out);
       return true;
     }
+    if (command == "dump_mempool_sites") {
+      std::unique_ptr<Formatter> f(Formatter::create(format));
+      f->open_object_section("mempool_sites");
+      mempool::dump_sites(f.get());
+      f->close_section();
+      f->flush(out);
+      return true;
+    }
     return false;
   }
 };
@@ -464,6 +484,12 @@ void CephContext::do_command(std::string_view command, const cmdmap_t& cmdmap,
   if (command == "abort" && _conf->debug_asok_assert_abort) {
    ceph_abort();
   }
+  if (command == "perf binary dump") {
+    // no formatting at all; see PerfCountersCollectionImpl::encode_binary
+    delete f;
+    _perf_counters_collection->encode_binary(*out);
+    return;
+  }
   if (command == "perfcounters_dump" || command == "1" ||
       command == "perf dump") {
     std::string logger;
@@ -487,6 +513,9 @@ void CephContext::do_command(std::string_view command, const cmdmap_t& cmdmap,
   else if (command == "perf histogram schema") {
     _perf_counters_collection->dump_formatted_histograms(f, true);
   }
+  else if (command == "perf binary schema") {
+    _perf_counters_collection->dump_binary_schema(f);
+  }
   else if (command == "perf reset") {
     std::string var;
     std::string section(command);
@@ -663,6 +692,8 @@ CephContext::CephContext(uint32_t module_type_,
   _admin_socket->register_command("2", "2", _admin_hook, "");
   _admin_socket->register_command("perf schema", "perf schema", _admin_hook, "dump perfcounters schema");
   _admin_socket->register_command("perf histogram schema", "perf histogram schema", _admin_hook, "dump perf histogram schema");
+  _admin_socket->register_command("perf binary schema", "perf binary schema", _admin_hook, "dump the counter layout of 'perf binary dump'");
+  _admin_socket->register_command("perf binary dump", "perf binary dump", _admin_hook, "dump perfcounters values in compact binary form");
   _admin_socket->register_command("perf reset", "perf reset name=var,type=CephString", _admin_hook, "perf reset <name>: perf reset all or one perfcounter name");
   _admin_socket->register_command("config show", "config show", _admin_hook, "dump current config settings");
   _admin_socket->register_command("config help", "config help name=var,type=CephString,req=false", _admin_hook, "get config setting schema and descriptions");
@@ -1,6 +1,8 @@
 
 #include "include/types.h"
 
+#include <string.h>
+
 /*
  * Robert Jenkin's hash function.
  * http://burtleburtle.net/bob/hash/evahash.html
@@ -19,6 +21,22 @@
 		c = c - a;  c = c - b;  c = c ^ (b >> 15);	\
 	} while (0)
 
+/*
+ * Load the little-endian word rjenkins mixes in. On little-endian hosts
+ * this is a single (unaligned) load instead of four byte loads and shifts.
+ */
+static inline __u32 rjenkins_load32(const unsigned char *k)
+{
+#if defined(CEPH_LITTLE_ENDIAN)
+	__u32 v;
+	memcpy(&v, k, sizeof(v));
+	return v;
+#else
+	return k[0] + ((__u32)k[1] << 8) + ((__u32)k[2] << 16) +
+	       ((__u32)k[3] << 24);
+#endif
+}
+
 unsigned ceph_str_hash_rjenkins(const char *str, unsigned length)
 {
 	const unsigned char *k = (const unsigned char *)str;
@@ -33,12 +51,9 @@ unsigned ceph_str_hash_rjenkins(const char *str, unsigned length)
 
 	/* handle most of the key */
 	while (len >= 12) {
-		a = a + (k[0] + ((__u32)k[1] << 8) + ((__u32)k[2] << 16) +
-			 ((__u32)k[3] << 24));
-		b = b + (k[4] + ((__u32)k[5] << 8) + ((__u32)k[6] << 16) +
-			 ((__u32)k[7] << 24));
-		c = c + (k[8] + ((__u32)k[9] << 8) + ((__u32)k[10] << 16) +
-			 ((__u32)k[11] << 24));
+		a = a + rjenkins_load32(k);
+		b = b + rjenkins_load32(k + 4);
+		c = c + rjenkins_load32(k + 8);
 		mix(a, b, c);
 		k = k + 12;
 		len = len - 12;
@@ -15,8 +15,14 @@
 #ifndef CEPH_CONFIG_CACHER_H
 #define CEPH_CONFIG_CACHER_H
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 #include "common/config_obs.h"
 #include "common/config.h"
+#include "common/config_proxy.h"
+#include "common/ceph_mutex.h"
 
 template <typename ValueT>
 class md_config_cacher_t : public md_config_obs_t {
@@ -55,5 +61,67 @@ public:
   }
 };
 
+/**
+ * a consistent, lock-free view of a group of options
+ *
+ * ValueT is a plain struct of the cached values, providing
+ *
+ *   explicit ValueT(const ConfigProxy& conf);  // reads the values
+ *   static const char** get_tracked_conf_keys();
+ *
+ * Reading through operator->() costs a single atomic load. A change to
+ * any of the tracked options builds a new ValueT and publishes it, RCU
+ * style. Readers never say when they are done with a snapshot, so the
+ * replaced ones are only freed with the cacher; options change rarely
+ * enough for that to be cheap.
+ */
+template <typename ValueT>
+class md_config_snapshot_t : public md_config_obs_t {
+  ConfigProxy& conf;
+  std::atomic<const ValueT*> current = {nullptr};
+  ceph::mutex retired_lock =
+    ceph::make_mutex("md_config_snapshot_t::retired_lock");
+  std::vector<std::unique_ptr<const ValueT>> retired;
+
+  void publish(const ValueT* fresh) {
+    auto old = current.exchange(fresh, std::memory_order_acq_rel);
+    if (old) {
+      std::lock_guard l(retired_lock);
+      retired.emplace_back(old);
+    }
+  }
+
+  const char** get_tracked_conf_keys() const override {
+    return ValueT::get_tracked_conf_keys();
+  }
+
+  void handle_conf_change(const ConfigProxy& conf,
+                          const std::set<std::string>& changed) override {
+    publish(new ValueT(conf));
+  }
+
+public:
+  explicit md_config_snapshot_t(ConfigProxy& conf)
+    : conf(conf) {
+    conf.add_observer(this);
+    publish(new ValueT(conf));
+  }
+
+  ~md_config_snapshot_t() {
+    conf.remove_observer(this);
+    delete current.load();
+  }
+
+  const ValueT* get() const {
+    return current.load(std::memory_order_acquire);
+  }
+  const ValueT* operator->() const {
+    return get();
+  }
+  const ValueT& operator*() const {
+    return *get();
+  }
+};
+
 #endif // CEPH_CONFIG_CACHER_H
 
@@ -1,6 +1,9 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab
 
+#include <algorithm>
+#include <climits>
+
 #include "include/crc32c.h"
 #include "arch/probe.h"
 #include "arch/intel.h"
@@ -238,3 +241,142 @@ uint32_t ceph_crc32c_zeros(uint32_t crc, unsigned len)
     crc = ceph_crc32c(crc, nullptr, remainder);
   return crc;
 }
+
+
+typedef void (*crc32c_3way_func_t)(uint32_t crc[3],
+				   unsigned char const *buffer[3],
+				   unsigned len);
+
+static crc32c_3way_func_t choose_crc32c_3way()
+{
+  ceph_arch_probe();
+#if defined(__x86_64__)
+  if (ceph_arch_intel_sse42) {
+    return ceph_crc32c_intel_fast_3way;
+  }
+#elif defined(__aarch64__) && defined(HAVE_ARMV8_CRC)
+  if (ceph_arch_aarch64_crc32) {
+    return ceph_crc32c_aarch64_3way;
+  }
+#endif
+  return nullptr;
+}
+
+static crc32c_3way_func_t crc32c_3way = choose_crc32c_3way();
+
+// below this, the two shifts that join the streams cost more than the
+// parallelism buys
+static constexpr uint64_t CRC32C_STITCH_MIN = 1024;
+
+namespace {
+  // a read position in an array of segments
+  struct segment_cursor {
+    ceph_crc32c_segment const *segs;
+    unsigned n;
+    unsigned i = 0;
+    unsigned off = 0;
+
+    segment_cursor(ceph_crc32c_segment const *segs, unsigned n)
+      : segs(segs), n(n) {
+      skip_empty();
+    }
+    unsigned avail() const {
+      return i < n ? segs[i].length - off : 0;
+    }
+    unsigned char const *data() const {
+      return segs[i].data + off;
+    }
+    void advance(uint64_t len) {
+      while (len > 0) {
+	const unsigned l = std::min<uint64_t>(len, avail());
+	off += l;
+	len -= l;
+	skip_empty();
+      }
+    }
+  private:
+    void skip_empty() {
+      while (i < n && off == segs[i].length) {
+	i++;
+	off = 0;
+      }
+    }
+  };
+}
+
+uint32_t ceph_crc32c_segments(uint32_t crc,
+			      ceph_crc32c_segment const *segs,
+			      unsigned n)
+{
+  uint64_t total = 0;
+  for (unsigned i = 0; i < n; i++) {
+    total += segs[i].length;
+  }
+  if (!crc32c_3way || n < 2 || total < CRC32C_STITCH_MIN ||
+      total / 3 > UINT_MAX) {
+    for (unsigned i = 0; i < n; i++) {
+      crc = ceph_crc32c(crc, segs[i].data, segs[i].length);
+    }
+    return crc;
+  }
+
+  /*
+   * hash three equal thirds independently, the first one seeded with
+   * crc and the others with 0, then join them with
+   *
+   *   crc32c(A|B, v) = crc32c(B, 0) ^ crc32c(0*len(B), crc32c(A, v))
+   *
+   * where the second term is the table-driven ceph_crc32c_zeros().
+   */
+  const unsigned stream_len = (total / 3) & ~7ull;
+  segment_cursor cur[3] = {{segs, n}, {segs, n}, {segs, n}};
+  cur[1].advance(stream_len);
+  cur[2].advance(2ull * stream_len);
+  uint32_t crcs[3] = {crc, 0, 0};
+  unsigned left[3] = {stream_len, stream_len, stream_len};
+
+  auto finish_piece = [&](int k, unsigned len) {
+    crcs[k] = ceph_crc32c(crcs[k], cur[k].data(), len);
+    cur[k].advance(len);
+    left[k] -= len;
+  };
+  for (;;) {
+    unsigned step = UINT_MAX;
+    for (int k = 0; k < 3; k++) {
+      step = std::min(step, std::min(cur[k].avail(), left[k]));
+    }
+    if (step >= 8) {
+      step &= ~7u;
+      unsigned char const *p[3] = {cur[0].data(), cur[1].data(), cur[2].data()};
+      crc32c_3way(crcs, p, step);
+      for (int k = 0; k < 3; k++) {
+	cur[k].advance(step);
+	left[k] -= step;
+      }
+      continue;
+    }
+    if (!left[0] || !left[1] || !left[2]) {
+      // one stream is done; the others are at most a few bytes behind
+      for (int k = 0; k < 3; k++) {
+	while (left[k]) {
+	  finish_piece(k, std::min(cur[k].avail(), left[k]));
+	}
+      }
+      break;
+    }
+    // step past the segment ends that are too close for a full word
+    for (int k = 0; k < 3; k++) {
+      const unsigned l = std::min(cur[k].avail(), left[k]);
+      if (l < 8) {
+	finish_piece(k, l);
+      }
+    }
+  }
+  crc = ceph_crc32c_zeros(crcs[0], stream_len) ^ crcs[1];
+  crc = ceph_crc32c_zeros(crc, stream_len) ^ crcs[2];
+  // whatever did not divide evenly into the streams
+  for (; cur[2].avail(); cur[2].advance(cur[2].avail())) {
+    crc = ceph_crc32c(crc, cur[2].data(), cur[2].avail());
+  }
+  return crc;
+}
@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include "acconfig.h"
 #include "include/int_types.h"
 #include "common/crc32c_aarch64.h"
@@ -270,3 +272,23 @@ uint32_t ceph_crc32c_aarch64(uint32_t crc, unsigned char const *buffer, unsigned
 	}
 	return crc;
 }
+
+void ceph_crc32c_aarch64_3way(uint32_t crc[3], unsigned char const *buffer[3], unsigned len)
+{
+	uint32_t crc0 = crc[0], crc1 = crc[1], crc2 = crc[2];
+	uint64_t v0, v1, v2;
+	unsigned i;
+
+	/* same interleave as CRC32C3X8, but over streams at unrelated addresses */
+	for (i = 0; i < len; i += 8) {
+		memcpy(&v0, buffer[0] + i, sizeof(v0));
+		memcpy(&v1, buffer[1] + i, sizeof(v1));
+		memcpy(&v2, buffer[2] + i, sizeof(v2));
+		CRC32CX(crc0, v0);
+		CRC32CX(crc1, v1);
+		CRC32CX(crc2, v2);
+	}
+	crc[0] = crc0;
+	crc[1] = crc1;
+	crc[2] = crc2;
+}
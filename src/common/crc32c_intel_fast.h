@@ -12,6 +12,9 @@ extern int ceph_crc32c_intel_fast_exists(void);
 
 extern uint32_t ceph_crc32c_intel_fast(uint32_t crc, unsigned char const *buffer, unsigned len);
 
+/* advance three independent crcs over len bytes each; len is a multiple of 8 */
+extern void ceph_crc32c_intel_fast_3way(uint32_t crc[3], unsigned char const *buffer[3], unsigned len);
+
 #else
 
 static inline uint32_t ceph_crc32c_intel_fast(uint32_t crc, unsigned char const *buffer, unsigned len)
@@ -19,6 +22,10 @@ static inline uint32_t ceph_crc32c_intel_fast(uint32_t crc, unsigned char const
 	return 0;
 }
 
+static inline void ceph_crc32c_intel_fast_3way(uint32_t crc[3], unsigned char const *buffer[3], unsigned len)
+{
+}
+
 #endif
 
 #ifdef __cplusplus
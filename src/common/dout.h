@@ -168,6 +168,23 @@ struct is_dynamic<dynamic_marker_t<T>> : public std::true_type {};
     _dout_cct->_log->submit_entry(std::move(_dout_e));                  \
   }                                                                     \
   } while (0)
+
+// f is a callable taking a std::ostream&. It is invoked by the log thread
+// only if the entry is written out, so it must capture by value.
+#define dout_deferred_impl(cct, sub, v, f)				\
+  do {									\
+  const bool should_gather = [&](const auto cctX) {			\
+    if constexpr (ceph::dout::is_dynamic<decltype(sub)>::value ||	\
+		  ceph::dout::is_dynamic<decltype(v)>::value) {		\
+      return cctX->_conf->subsys.should_gather(sub, v);			\
+    } else {								\
+      return (cctX->_conf->subsys.template should_gather<sub, v>());	\
+    }									\
+  }(cct);								\
+  if (should_gather) {							\
+    (cct)->_log->submit_entry(ceph::logging::DeferredEntry(v, sub, f));	\
+  }									\
+  } while (0)
 #endif	// WITH_SEASTAR
 
 #define lsubdout(cct, sub, v)  dout_impl(cct, ceph_subsys_##sub, v) dout_prefix
@@ -179,6 +196,15 @@ struct is_dynamic<dynamic_marker_t<T>> : public std::true_type {};
     dout_impl(pdpp->get_cct(), ceph::dout::need_dynamic(pdpp->get_subsys()), v) \
       pdpp->gen_prefix(*_dout)
 
+// no dout_prefix: the prefix usually refers to state which will be gone
+// by the time the entry is rendered
+#ifdef WITH_SEASTAR
+#define ldout_deferred(cct, v, f) \
+  dout_impl(cct, dout_subsys, v) (f)(*_dout); *_dout << dendl_impl
+#else
+#define ldout_deferred(cct, v, f) dout_deferred_impl(cct, dout_subsys, v, f)
+#endif
+
 #define lgeneric_subdout(cct, sub, v) dout_impl(cct, ceph_subsys_##sub, v) *_dout
 #define lgeneric_dout(cct, v) dout_impl(cct, ceph_subsys_, v) *_dout
 #define lgeneric_derr(cct) dout_impl(cct, ceph_subsys_, -1) *_dout
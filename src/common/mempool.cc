@@ -12,6 +12,14 @@
  *
  */
 
+#include "acconfig.h"
+#ifdef HAVE_EXECINFO_H
+#include <execinfo.h>
+#endif
+#include <algorithm>
+#include <array>
+#include <random>
+
 #include "include/mempool.h"
 #include "include/demangle.h"
 
@@ -19,6 +27,9 @@
 // default to debug_mode off
 bool mempool::debug_mode = false;
 
+// default to sampling off
+unsigned mempool::sample_rate = 0;
+
 // --------------------------------------------------------------
 
 mempool::pool_t& mempool::get_pool(mempool::pool_index_t ix)
@@ -61,6 +72,160 @@ void mempool::set_debug_mode(bool d)
   debug_mode = d;
 }
 
+// --------------------------------------------------------------
+// allocation site sampling
+
+namespace {
+
+struct site_t {
+  mempool::pool_index_t pool;
+  std::vector<void*> frames;
+  size_t sampled = 0;     // allocations sampled here, ever
+  size_t live_items = 0;  // ... and not freed yet
+  size_t live_bytes = 0;
+};
+
+struct sample_t {
+  uint64_t site;
+  size_t bytes;
+};
+
+struct sampler_t {
+  static constexpr unsigned max_frames = 16;
+  static constexpr unsigned filter_bits = 16;
+
+  std::mutex lock;
+  std::unordered_map<uint64_t, site_t> sites;   // by backtrace hash
+  std::unordered_map<void*, sample_t> live;
+  // how many live samples hash to each slot, so that freeing an object
+  // which was never sampled does not need the lock
+  std::array<std::atomic<uint32_t>, 1 << filter_bits> filter = {};
+
+  static unsigned slot(void *p) {
+    return (std::hash<void*>{}(p) >> 4) & ((1 << filter_bits) - 1);
+  }
+};
+
+sampler_t& get_sampler()
+{
+  // leaked on purpose, pools are still in use while statics are destroyed
+  static sampler_t *sampler = new sampler_t;
+  return *sampler;
+}
+
+}
+
+void mempool::set_sample_rate(unsigned n)
+{
+  auto& sampler = get_sampler();
+  std::lock_guard l(sampler.lock);
+  sample_rate = n;
+  if (!n) {
+    // frees are not tracked any more, the samples would go stale
+    sampler.sites.clear();
+    sampler.live.clear();
+    for (auto& count : sampler.filter) {
+      count = 0;
+    }
+  }
+}
+
+unsigned mempool::sample_allocation(pool_index_t ix, void *p, size_t bytes)
+{
+  void *frames[sampler_t::max_frames];
+#ifdef HAVE_EXECINFO_H
+  const int num_frames = backtrace(frames, sampler_t::max_frames);
+#else
+  const int num_frames = 0;
+#endif
+  uint64_t id = ix;
+  for (int i = 0; i < num_frames; i++) {
+    id = id * 1099511628211ull ^ (uint64_t)frames[i];
+  }
+
+  auto& sampler = get_sampler();
+  {
+    std::lock_guard l(sampler.lock);
+    if (sample_rate) {
+      auto [site, inserted] = sampler.sites.try_emplace(id);
+      if (inserted) {
+	site->second.pool = ix;
+	site->second.frames.assign(frames, frames + num_frames);
+      }
+      site->second.sampled++;
+      site->second.live_items++;
+      site->second.live_bytes += bytes;
+      sampler.live[p] = sample_t{id, bytes};
+      sampler.filter[sampler_t::slot(p)]++;
+    }
+  }
+  // a random stride keeps us from locking onto allocation patterns that
+  // repeat with the period of the sample rate
+  static thread_local std::minstd_rand rng(std::random_device{}());
+  const unsigned rate = std::max(sample_rate, 1u);
+  return std::uniform_int_distribution<unsigned>(0, 2 * (rate - 1))(rng);
+}
+
+void mempool::sample_deallocation(void *p)
+{
+  auto& sampler = get_sampler();
+  auto& count = sampler.filter[sampler_t::slot(p)];
+  if (count.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+  std::lock_guard l(sampler.lock);
+  auto sample = sampler.live.find(p);
+  if (sample == sampler.live.end()) {
+    return;
+  }
+  auto& site = sampler.sites[sample->second.site];
+  site.live_items--;
+  site.live_bytes -= sample->second.bytes;
+  sampler.live.erase(sample);
+  count--;
+}
+
+void mempool::dump_sites(ceph::Formatter *f)
+{
+  auto& sampler = get_sampler();
+  std::vector<site_t> sites;
+  unsigned rate;
+  {
+    std::lock_guard l(sampler.lock);
+    rate = sample_rate;
+    for (auto& [id, site] : sampler.sites) {
+      if (site.live_items) {
+	sites.push_back(site);
+      }
+    }
+  }
+  std::sort(sites.begin(), sites.end(), [](auto& a, auto& b) {
+    return a.live_bytes > b.live_bytes;
+  });
+  f->dump_unsigned("sample_rate", rate);
+  f->open_array_section("sites");
+  for (auto& site : sites) {
+    f->open_object_section("site");
+    f->dump_string("pool", get_pool_name(site.pool));
+    f->dump_unsigned("sampled", site.sampled);
+    f->dump_unsigned("live_samples", site.live_items);
+    f->dump_unsigned("live_sampled_bytes", site.live_bytes);
+    f->dump_unsigned("estimated_bytes", site.live_bytes * rate);
+    f->open_array_section("backtrace");
+#ifdef HAVE_EXECINFO_H
+    char **symbols = backtrace_symbols(site.frames.data(), site.frames.size());
+    // skip sample_allocation() and the allocator it was called from
+    for (size_t i = 2; symbols && i < site.frames.size(); i++) {
+      f->dump_string("frame", symbols[i]);
+    }
+    free(symbols);
+#endif
+    f->close_section();
+    f->close_section();
+  }
+  f->close_section();
+}
+
 // --------------------------------------------------------------
 // pool_t
 
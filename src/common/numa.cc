@@ -134,6 +134,71 @@ int get_numa_node_cpu_set(
   return r;
 }
 
+static int read_sysfs_line(const std::string& fn, char *buf, size_t len)
+{
+  int fd = ::open(fn.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return -errno;
+  }
+  int r = safe_read(fd, buf, len - 1);
+  ::close(fd);
+  if (r < 0) {
+    return r;
+  }
+  buf[r] = 0;
+  while (r > 0 && ::isspace(buf[--r])) {
+    buf[r] = 0;
+  }
+  return 0;
+}
+
+int get_cpu_llc_cpu_set(
+  int cpu,
+  size_t *cpu_set_size,
+  cpu_set_t *cpu_set)
+{
+  // the cache with the highest level is the last-level cache
+  std::string base = "/sys/devices/system/cpu/cpu" + stringify(cpu) +
+    "/cache/index";
+  int best_level = -1;
+  std::string best;
+  char buf[1024];
+  for (int i = 0; ; ++i) {
+    std::string dir = base + stringify(i);
+    if (read_sysfs_line(dir + "/level", buf, sizeof(buf)) < 0) {
+      break;
+    }
+    int level = atoi(buf);
+    if (level > best_level) {
+      best_level = level;
+      best = dir;
+    }
+  }
+  if (best_level < 0) {
+    return -ENOENT;
+  }
+  int r = read_sysfs_line(best + "/shared_cpu_list", buf, sizeof(buf));
+  if (r < 0) {
+    return r;
+  }
+  return parse_cpu_set_list(buf, cpu_set_size, cpu_set);
+}
+
+int get_cpu_llc_domain(int cpu)
+{
+  size_t size;
+  cpu_set_t cpu_set;
+  if (get_cpu_llc_cpu_set(cpu, &size, &cpu_set) < 0) {
+    return -1;
+  }
+  for (size_t i = 0; i < size; ++i) {
+    if (CPU_ISSET(i, &cpu_set)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
 #elif defined(__FreeBSD__)
 
 int parse_cpu_set_list(const char *s,
@@ -162,4 +227,16 @@ int get_numa_node_cpu_set(int node,
   return -ENOTSUP;
 }
 
+int get_cpu_llc_cpu_set(int cpu,
+			size_t *cpu_set_size,
+			cpu_set_t *cpu_set)
+{
+  return -ENOTSUP;
+}
+
+int get_cpu_llc_domain(int cpu)
+{
+  return -1;
+}
+
 #endif
@@ -19,3 +19,11 @@ std::set<int> cpu_set_to_set(size_t cpu_set_size,
 int get_numa_node_cpu_set(int node,
 			  size_t *cpu_set_size,
 			  cpu_set_t *cpu_set);
+
+/// the CPUs sharing the last-level cache with cpu
+int get_cpu_llc_cpu_set(int cpu,
+			size_t *cpu_set_size,
+			cpu_set_t *cpu_set);
+/// the lowest CPU sharing the last-level cache with cpu, which names that
+/// cache domain; -1 if unknown
+int get_cpu_llc_domain(int cpu);
@@ -24,6 +24,39 @@ const std::string BENCH_LASTRUN_METADATA = "benchmark_last_metadata";
 const std::string BENCH_PREFIX = "benchmark_data";
 const std::string BENCH_OBJ_NAME = BENCH_PREFIX + "_%s_%d_object%d";
 
+void bench_latency_hist::add(double seconds)
+{
+  int exp;
+  double mant = std::frexp(seconds * 1000000, &exp);
+  int idx = 0;
+  if (exp > MAGNITUDES) {
+    idx = counts.size() - 1;
+  } else if (exp > 0) {
+    // seconds is mant * 2^exp us, with mant in [0.5, 1)
+    int sub = std::min((int)((mant * 2 - 1) * SUB_BUCKETS), SUB_BUCKETS - 1);
+    idx = (exp - 1) * SUB_BUCKETS + sub;
+  }
+  ++counts[idx];
+  ++total;
+}
+
+double bench_latency_hist::percentile(double p) const
+{
+  if (!total)
+    return 0;
+  uint64_t rank = std::max<uint64_t>(1, std::ceil(p / 100 * total));
+  uint64_t seen = 0;
+  unsigned idx = 0;
+  for (; idx < counts.size() - 1; ++idx) {
+    seen += counts[idx];
+    if (seen >= rank)
+      break;
+  }
+  int m = idx / SUB_BUCKETS;
+  int sub = idx % SUB_BUCKETS;
+  return std::ldexp(1.0 + (double)(sub + 1) / SUB_BUCKETS, m) / 1000000;
+}
+
 static char cached_hostname[30] = {0};
 int cached_pid = 0;
 
@@ -283,6 +316,7 @@ int ObjBencher::aio_bench(
   data.max_latency = 0;
   data.avg_latency = 0;
   data.latency_diff_sum = 0;
+  data.latency_hist.clear();
   data.object_contents = contentsChars;
   lock.unlock();
 
@@ -500,6 +534,7 @@ int ObjBencher::write_bench(int secondsToRun,
     }
     data.cur_latency = mono_clock::now() - start_times[slot];
     total_latency += data.cur_latency.count();
+    data.latency_hist.add(data.cur_latency.count());
     if( data.cur_latency.count() > data.max_latency)
       data.max_latency = data.cur_latency.count();
     if (data.cur_latency.count() < data.min_latency)
@@ -546,6 +581,7 @@ int ObjBencher::write_bench(int secondsToRun,
     }
     data.cur_latency = mono_clock::now() - start_times[slot];
     total_latency += data.cur_latency.count();
+    data.latency_hist.add(data.cur_latency.count());
     if (data.cur_latency.count() > data.max_latency)
       data.max_latency = data.cur_latency.count();
     if (data.cur_latency.count() < data.min_latency)
@@ -606,7 +642,11 @@ int ObjBencher::write_bench(int secondsToRun,
        << "Average Latency(s):     " << data.avg_latency << std::endl
        << "Stddev Latency(s):      " << latency_stddev << std::endl
        << "Max latency(s):         " << data.max_latency << std::endl
-       << "Min latency(s):         " << data.min_latency << std::endl;
+       << "Min latency(s):         " << data.min_latency << std::endl
+       << "Latency p50(s):         " << data.latency_hist.percentile(50) << std::endl
+       << "Latency p90(s):         " << data.latency_hist.percentile(90) << std::endl
+       << "Latency p99(s):         " << data.latency_hist.percentile(99) << std::endl
+       << "Latency p99.9(s):       " << data.latency_hist.percentile(99.9) << std::endl;
   } else {
     formatter->dump_format("total_time_run", "%f", timePassed.count());
     formatter->dump_format("total_writes_made", "%d", data.finished);
@@ -624,6 +664,10 @@ int ObjBencher::write_bench(int secondsToRun,
     formatter->dump_format("stddev_latency", "%f", latency_stddev);
     formatter->dump_format("max_latency", "%f", data.max_latency);
     formatter->dump_format("min_latency", "%f", data.min_latency);
+    formatter->dump_format("latency_p50", "%f", data.latency_hist.percentile(50));
+    formatter->dump_format("latency_p90", "%f", data.latency_hist.percentile(90));
+    formatter->dump_format("latency_p99", "%f", data.latency_hist.percentile(99));
+    formatter->dump_format("latency_p999", "%f", data.latency_hist.percentile(99.9));
   }
   //write object size/number data for read benchmarks
   encode(data.object_size, b_write);
@@ -764,6 +808,7 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
       goto ERR;
     }
     total_latency += data.cur_latency.count();
+    data.latency_hist.add(data.cur_latency.count());
     if (data.cur_latency.count() > data.max_latency)
       data.max_latency = data.cur_latency.count();
     if (data.cur_latency.count() < data.min_latency)
@@ -802,6 +847,7 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
     }
     data.cur_latency = mono_clock::now() - start_times[slot];
     total_latency += data.cur_latency.count();
+    data.latency_hist.add(data.cur_latency.count());
     if (data.cur_latency.count() > data.max_latency)
       data.max_latency = data.cur_latency.count();
     if (data.cur_latency.count() < data.min_latency)
@@ -853,7 +899,11 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
        << "Min IOPS:             " << data.idata.min_iops << std::endl
        << "Average Latency(s):   " << data.avg_latency << std::endl
        << "Max latency(s):       " << data.max_latency << std::endl
-       << "Min latency(s):       " << data.min_latency << std::endl;
+       << "Min latency(s):       " << data.min_latency << std::endl
+       << "Latency p50(s):       " << data.latency_hist.percentile(50) << std::endl
+       << "Latency p90(s):       " << data.latency_hist.percentile(90) << std::endl
+       << "Latency p99(s):       " << data.latency_hist.percentile(99) << std::endl
+       << "Latency p99.9(s):     " << data.latency_hist.percentile(99.9) << std::endl;
   } else {
     formatter->dump_format("total_time_run", "%f", timePassed.count());
     formatter->dump_format("total_reads_made", "%d", data.finished);
@@ -867,6 +917,10 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
     formatter->dump_format("average_latency", "%f", data.avg_latency);
     formatter->dump_format("max_latency", "%f", data.max_latency);
     formatter->dump_format("min_latency", "%f", data.min_latency);
+    formatter->dump_format("latency_p50", "%f", data.latency_hist.percentile(50));
+    formatter->dump_format("latency_p90", "%f", data.latency_hist.percentile(90));
+    formatter->dump_format("latency_p99", "%f", data.latency_hist.percentile(99));
+    formatter->dump_format("latency_p999", "%f", data.latency_hist.percentile(99.9));
   }
 
   completions_done();
@@ -988,6 +1042,7 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
     }
 
     total_latency += data.cur_latency.count();
+    data.latency_hist.add(data.cur_latency.count());
     if (data.cur_latency.count() > data.max_latency)
       data.max_latency = data.cur_latency.count();
     if (data.cur_latency.count() < data.min_latency)
@@ -1043,6 +1098,7 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
     }
     data.cur_latency = mono_clock::now() - start_times[slot];
     total_latency += data.cur_latency.count();
+    data.latency_hist.add(data.cur_latency.count());
     if (data.cur_latency.count() > data.max_latency)
       data.max_latency = data.cur_latency.count();
     if (data.cur_latency.count() < data.min_latency)
@@ -1094,7 +1150,11 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
        << "Min IOPS:             " << data.idata.min_iops << std::endl
        << "Average Latency(s):   " << data.avg_latency << std::endl
        << "Max latency(s):       " << data.max_latency << std::endl
-       << "Min latency(s):       " << data.min_latency << std::endl;
+       << "Min latency(s):       " << data.min_latency << std::endl
+       << "Latency p50(s):       " << data.latency_hist.percentile(50) << std::endl
+       << "Latency p90(s):       " << data.latency_hist.percentile(90) << std::endl
+       << "Latency p99(s):       " << data.latency_hist.percentile(99) << std::endl
+       << "Latency p99.9(s):     " << data.latency_hist.percentile(99.9) << std::endl;
   } else {
     formatter->dump_format("total_time_run", "%f", timePassed.count());
     formatter->dump_format("total_reads_made", "%d", data.finished);
@@ -1108,6 +1168,10 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
     formatter->dump_format("average_latency", "%f", data.avg_latency);
     formatter->dump_format("max_latency", "%f", data.max_latency);
     formatter->dump_format("min_latency", "%f", data.min_latency);
+    formatter->dump_format("latency_p50", "%f", data.latency_hist.percentile(50));
+    formatter->dump_format("latency_p90", "%f", data.latency_hist.percentile(90));
+    formatter->dump_format("latency_p99", "%f", data.latency_hist.percentile(99));
+    formatter->dump_format("latency_p999", "%f", data.latency_hist.percentile(99.9));
   }
   completions_done();
 
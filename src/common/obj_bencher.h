@@ -18,6 +18,7 @@
 #include "common/ceph_context.h"
 #include "common/Formatter.h"
 #include "ceph_time.h"
+#include <array>
 #include <cfloat>
 
 using ceph::mono_clock;
@@ -35,6 +36,25 @@ struct bench_interval_data {
   double iops_diff_sum = 0;
 };
 
+/**
+ * Log-linear histogram of op latencies, from 1us to about 1000s in buckets
+ * of 1/32 of a power of two, so percentiles are exact to about 3%.
+ */
+struct bench_latency_hist {
+  static constexpr int SUB_BUCKETS = 32;
+  static constexpr int MAGNITUDES = 30;
+  std::array<uint64_t, SUB_BUCKETS * MAGNITUDES> counts = {};
+  uint64_t total = 0;
+
+  void clear() {
+    counts.fill(0);
+    total = 0;
+  }
+  void add(double seconds);
+  /// upper bound in seconds of the latency of the p-th percentile op
+  double percentile(double p) const;
+};
+
 struct bench_data {
   bool done; //is the benchmark is done
   uint64_t object_size; //the size of the objects
@@ -49,6 +69,7 @@ struct bench_data {
   double avg_latency;
   struct bench_interval_data idata; // data that is updated by time intervals and not by events
   double latency_diff_sum;
+  bench_latency_hist latency_hist;
   std::chrono::duration<double> cur_latency; //latency of last completed transaction - in seconds by default
   mono_time start_time; //start time for benchmark - use the monotonic clock as we'll measure the passage of time
   char *object_contents; //pointer to the contents written to each object
@@ -773,6 +773,13 @@ std::vector<Option> get_global_options() {
     .set_flag(Option::FLAG_NO_MON_UPDATE)
     .set_description(""),
 
+    Option("mempool_sample_rate", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Record the call site of 1 in this many mempool allocations")
+    .set_long_description("Sampled allocations are tracked until they are freed, and the call sites holding the most memory are reported by the dump_mempool_sites admin socket command. 0 disables sampling.")
+    .add_see_also("mempool_debug"),
+
     Option("key", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("")
     .set_description("Authentication key")
@@ -1084,6 +1091,72 @@ std::vector<Option> get_global_options() {
     .set_description("Maximum threadpool size of AsyncMessenger")
     .add_see_also("ms_async_op_threads"),
 
+    Option("ms_async_affinity_cores", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("")
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("CPUs to pin AsyncMessenger workers to")
+    .set_long_description("A CPU list such as 0-3,24-27. Worker N is pinned to "
+                          "the Nth CPU of the list, wrapping around if there are "
+                          "more workers than CPUs. Pick CPUs that serve the "
+                          "NIC's receive queue interrupts. Empty leaves workers "
+                          "unpinned.")
+    .add_see_also("ms_async_op_threads")
+    .add_see_also("ms_async_affinity_incoming_cpu"),
+
+    Option("ms_async_affinity_incoming_cpu", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Serve accepted connections from a worker near the CPU receiving their packets")
+    .set_long_description("Uses SO_INCOMING_CPU to find the CPU handling an "
+                          "accepted connection's NIC queue and hands the "
+                          "connection to a worker pinned to that CPU, or else "
+                          "to one sharing its last-level cache. Needs "
+                          "ms_async_affinity_cores.")
+    .add_see_also("ms_async_affinity_cores"),
+
+    Option("ms_async_cork_max_bytes", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(64_K)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Pack queued messages into socket writes of up to this size")
+    .set_long_description("When several messages are queued on a msgr2 "
+                          "connection their frames are sent with one "
+                          "syscall until this many bytes have accumulated. "
+                          "0 sends every message on its own.")
+    .add_see_also("ms_async_cork_us"),
+
+    Option("ms_async_cork_us", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Hold back messages on a busy connection for up to this many microseconds")
+    .set_long_description("If a msgr2 connection flushed less than this long "
+                          "ago, the next write waits this long so that more "
+                          "messages can join it. Trades latency for fewer "
+                          "syscalls on connections carrying bursts of small "
+                          "messages. 0 disables it.")
+    .add_see_also("ms_async_cork_max_bytes"),
+
+    Option("ms_async_send_coalesce_max", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(4_K)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Copy outgoing buffers up to this size into one before sending")
+    .set_long_description("Applies to OSD data connections on the posix stack. "
+                          "Headers, footers and small payload fragments are "
+                          "gathered into a per-connection buffer so that a "
+                          "message costs a few iovecs instead of one per "
+                          "fragment. 0 disables coalescing.")
+    .add_see_also("ms_async_send_zerocopy_min"),
+
+    Option("ms_async_send_zerocopy_min", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Send outgoing buffers at least this large with MSG_ZEROCOPY")
+    .set_long_description("Applies to OSD data connections on the posix stack "
+                          "when the kernel supports SO_ZEROCOPY (Linux 4.14+). "
+                          "Zero-copy only pays off for large buffers, since "
+                          "each send must be acknowledged through the socket "
+                          "error queue before its memory is released; 64K or "
+                          "more is a reasonable start. 0 disables it.")
+    .add_see_also("ms_async_send_coalesce_max"),
+
     Option("ms_async_rdma_device_name", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("")
     .set_description(""),
@@ -1305,11 +1378,25 @@ std::vector<Option> get_global_options() {
     .add_see_also("mon_osdmap_full_prune_txsize"),
     /* -- mon: osdmap prune (end) -- */
 
+    Option("mon_osdmap_full_compression", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("none")
+    .set_enum_allowed({"none", "snappy", "zlib", "zstd", "lz4"})
+    .add_service("mon")
+    .set_description("compression algorithm for full osdmaps kept in the mon store")
+    .set_long_description("Full osdmaps written to the store are compressed with this algorithm once every monitor in the quorum can read them back. Maps that do not shrink are stored as-is. Tools reading the store directly (e.g. ceph-monstore-tool) do not decompress them.")
+    .add_see_also("mon_osdmap_full_prune_enabled"),
+
     Option("mon_osd_cache_size", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(500)
     .add_service("mon")
     .set_description("maximum number of OSDMaps to cache in memory"),
 
+    Option("mon_osdmap_client_skip_to_latest", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .add_service("mon")
+    .set_description("send the latest full OSDMap to clients whose map predates the oldest committed one")
+    .set_long_description("Instead of a full map of the first committed epoch followed by all incrementals since, clients that have fallen behind the trimmed history get only the current full map. This bounds the map traffic of a reconnecting client fleet. OSDs always receive the complete history."),
+
     Option("mon_cpu_threads", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(4)
     .add_service("mon")
@@ -2052,6 +2139,12 @@ std::vector<Option> get_global_options() {
     .add_service("mon")
     .set_description(""),
 
+    Option("paxos_join_pending_proposals", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .add_service("mon")
+    .set_description("add every service's pending changes to a paxos proposal when it starts")
+    .set_long_description("When a paxos round starts, services that are still waiting out paxos_propose_interval before proposing their changes add them to the same transaction instead of waiting for a later round."),
+
     Option("paxos_min", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(500)
     .add_service("mon")
@@ -2142,6 +2235,11 @@ std::vector<Option> get_global_options() {
     .set_default(true)
     .set_description(""),
 
+    Option("cephx_service_ticket_cache_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(4096)
+    .set_description("Number of decrypted service tickets a daemon keeps for verifying authorizers")
+    .set_long_description("Clients present the same service ticket on every connection until it is renewed, so remembering the decrypted tickets saves a decryption per reconnect.  0 disables the cache."),
+
     Option("auth_mon_ticket_ttl", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(12_hr)
     .set_description(""),
@@ -2228,6 +2326,12 @@ std::vector<Option> get_global_options() {
     .set_default(1024)
     .set_description("Max in-flight operations"),
 
+    Option("objecter_inflight_ops_per_osd", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Max in-flight operations to a single OSD, 0 for no limit")
+    .set_long_description("New operations to an OSD with this many operations in flight wait for some of them to complete instead of taking more of the objecter_inflight_ops budget. This keeps one slow OSD from stalling I/O to all the others.")
+    .add_see_also("objecter_inflight_ops"),
+
     Option("objecter_completion_locks_per_session", Option::TYPE_UINT, Option::LEVEL_DEV)
     .set_default(32)
     .set_description(""),
@@ -2244,6 +2348,28 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description(""),
 
+    Option("objecter_hedged_read_percentile", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0.0)
+    .set_min_max(0.0, 100.0)
+    .set_description("Latency percentile after which a read is also sent to a replica")
+    .set_long_description("A read on a replicated pool that is still outstanding after this percentile of recent read latencies is sent to a replica as well and completed by whichever reply arrives first.  Replicas refuse reads of objects with uncommitted writes, which are then answered by the primary alone.  0 disables hedged reads.")
+    .add_see_also("objecter_hedged_read_min_delay"),
+
+    Option("objecter_hedged_read_min_delay", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0.002)
+    .set_min(0.0)
+    .set_description("Minimum seconds a read is outstanding before it is hedged")
+    .add_see_also("objecter_hedged_read_percentile"),
+
+    Option("objecter_localize_reads_policy", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("crush")
+    .set_enum_allowed({"crush", "latency"})
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("How reads flagged to be localized pick a replica")
+    .set_long_description("'crush' sends a localized read to the replica closest to crush_location in the CRUSH hierarchy.  'latency' sends it to the acting OSD whose replies have had the lowest moving average latency; OSDs not yet heard from are tried first and 1 in 16 reads goes to a random one to keep the averages current.  Only reads that already allow replicas, such as librbd snapshot and parent reads, are affected.")
+    .add_see_also("crush_location")
+    .add_see_also("rbd_localize_snap_reads"),
+
     Option("filer_max_purge_ops", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(10)
     .set_description("Max in-flight operations for purging a striped range (e.g., MDS journal)"),
@@ -2301,6 +2427,15 @@ std::vector<Option> get_global_options() {
     .set_flag(Option::FLAG_STARTUP)
     .set_description("automatically set affinity to numa node when storage and network match"),
 
+    Option("osd_op_thread_affinity_llc", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("pin each op shard's threads to the last-level cache domain of its messenger worker")
+    .set_long_description("Shard N runs on the CPUs sharing a last-level "
+                          "cache with the Nth CPU of ms_async_affinity_cores, "
+                          "so that ops stay on the socket that received them.")
+    .add_see_also("ms_async_affinity_cores"),
+
     Option("osd_numa_node", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(-1)
     .set_flag(Option::FLAG_STARTUP)
@@ -2616,7 +2751,7 @@ std::vector<Option> get_global_options() {
 
     Option("osd_tier_default_cache_hit_set_type", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("bloom")
-    .set_enum_allowed({"bloom", "explicit_hash", "explicit_object"})
+    .set_enum_allowed({"bloom", "blocked_bloom", "explicit_hash", "explicit_object"})
     .set_flag(Option::FLAG_RUNTIME)
     .set_description(""),
 
@@ -2747,6 +2882,40 @@ std::vector<Option> get_global_options() {
     .set_long_description("the threshold between high priority ops that use strict priority ordering and low priority ops that use a fairness algorithm that may or may not incorporate priority")
     .add_see_also("osd_op_queue"),
 
+    Option("osd_op_queue_work_stealing", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("let idle op shard threads process items queued on busier shards")
+    .set_long_description("PGs are statically hashed onto op shards, so a few hot PGs can keep one shard's threads busy while the others idle.  With this enabled an idle thread takes the next queued item of the most backed up shard and runs it under that shard's lock and PG slots, which keeps per-PG ordering intact.")
+    .add_see_also("osd_op_queue_steal_min_depth")
+    .add_see_also("osd_op_queue_steal_interval"),
+
+    Option("osd_op_queue_steal_min_depth", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(4)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("minimum number of queued items before a shard's work may be stolen")
+    .add_see_also("osd_op_queue_work_stealing"),
+
+    Option("osd_op_queue_steal_interval", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(.005)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("seconds an idle op shard thread waits before looking at other shards again")
+    .add_see_also("osd_op_queue_work_stealing"),
+
+    Option("osd_op_thread_spin_usec", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("microseconds an idle op shard thread polls its queue before blocking")
+    .set_long_description("Waking a blocked op thread costs a futex sleep and wakeup per op, which shows on fast NVMe devices.  With this set, one idle thread per shard polls the queue for up to this long before blocking.  The budget shrinks while the shard stays idle, down to an eighth of this value, and grows back when polling finds work.  0 disables polling.")
+    .add_see_also("osd_op_num_threads_per_shard"),
+
+    Option("osd_op_pg_batch_max", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("most ops an op shard thread runs for a pg in one pg lock hold")
+    .set_long_description("Small object workloads queue many ops for the same pg at once, and every op shard thread that dequeues one of them blocks on that pg's lock in turn.  With this above 1, a thread holding a pg lock for a client op also runs the ops the other threads of its shard dequeue for that pg meanwhile, up to this many, while those threads go on to other work.  1 runs one op per pg lock hold.")
+    .add_see_also("osd_op_num_threads_per_shard"),
+
     Option("osd_op_queue_mclock_client_op_res", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(1000.0)
     .set_description("mclock reservation of client operator requests")
@@ -3083,6 +3252,40 @@ std::vector<Option> get_global_options() {
     .add_see_also("osd_op_queue_mclock_scrub_wgt")
     .add_see_also("osd_op_queue_mclock_scrub_lim"),
 
+    Option("osd_mclock_profile", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("custom")
+    .set_enum_allowed( { "custom", "high_client_ops", "balanced", "high_recovery_ops" } )
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("derive the mclock op class settings from the capacity of the device")
+    .set_long_description("With osd_op_queue 'mclock_opclass' or 'mclock_client', any profile other than 'custom' replaces the osd_op_queue_mclock_* reservations, weights and limits of client, recovery, scrub, snap trim and pg delete work with fractions of the capacity of the object store, which is measured when the OSD starts unless osd_mclock_max_capacity_iops and osd_mclock_max_capacity_bandwidth are set.  Recovery, backfill and snap trimming are then paced by the scheduler alone and osd_recovery_sleep and osd_snap_trim_sleep are ignored.")
+    .add_see_also("osd_op_queue")
+    .add_see_also("osd_mclock_max_capacity_iops")
+    .add_see_also("osd_mclock_max_capacity_bandwidth"),
+
+    Option("osd_mclock_max_capacity_iops", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0.0)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("small write ops/s the object store can sustain; 0 to measure at startup")
+    .add_see_also("osd_mclock_profile"),
+
+    Option("osd_mclock_max_capacity_bandwidth", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0.0)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("bytes/s of large writes the object store can sustain; 0 to measure at startup")
+    .add_see_also("osd_mclock_profile"),
+
+    Option("osd_mclock_bench_ops", Option::TYPE_UINT, Option::LEVEL_DEV)
+    .set_default(1000)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("number of 4 KiB writes used to measure osd_mclock_max_capacity_iops")
+    .add_see_also("osd_mclock_max_capacity_iops"),
+
+    Option("osd_mclock_bench_bytes", Option::TYPE_SIZE, Option::LEVEL_DEV)
+    .set_default(64_M)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("bytes written in 4 MiB blocks to measure osd_mclock_max_capacity_bandwidth")
+    .add_see_also("osd_mclock_max_capacity_bandwidth"),
+
     Option("osd_op_queue_mclock_pg_delete_res", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(0.0)
     .set_description("mclock reservation of pg delete work")
@@ -3211,6 +3414,30 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description(""),
 
+    Option("osd_ec_parity_delta_writes", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Update parity with a delta for small EC overwrites")
+    .set_long_description("When a write to an erasure coded pool with "
+                          "overwrites enabled changes few enough data chunks "
+                          "of a stripe, read only those chunks and the coding "
+                          "chunks and fold the difference into the parity, "
+                          "instead of reading the whole stripe to encode it "
+                          "again. Only used with plugins that support it "
+                          "(jerasure reed_sol_van and reed_sol_r6_op, isa) and "
+                          "when all the shards of the object are available.")
+    .add_see_also("osd_pool_default_erasure_code_profile"),
+
+    Option("osd_ec_stripe_cache_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Bytes of recently written stripes each EC PG primary keeps")
+    .set_long_description("The primary of a PG in an erasure coded pool with "
+                          "overwrites enabled keeps the last stripe written "
+                          "to recently written objects, so that sequential "
+                          "appends smaller than the stripe width do not have "
+                          "to read the partial stripe back from the shards. "
+                          "0 disables it.")
+    .add_see_also("osd_pool_erasure_code_stripe_unit"),
+
     Option("osd_recover_clone_overlap_limit", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(10)
     .set_description(""),
@@ -3256,7 +3483,9 @@ std::vector<Option> get_global_options() {
 
     Option("osd_snap_trim_sleep", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(0)
-    .set_description(""),
+    .set_description("Time in seconds to sleep before next snap trim batch")
+    .set_long_description("Ignored when an osd_mclock_profile is in effect; snap trimming is then paced by the scheduler's snap trim class.")
+    .add_see_also("osd_mclock_profile"),
 
     Option("osd_scrub_invalid_stats", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
@@ -3452,6 +3681,37 @@ std::vector<Option> get_global_options() {
     .set_default(0)
     .set_description("Duration to inject a delay during scrubbing"),
 
+    Option("osd_scrub_pacing", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Adapt scrub chunk size and sleep to client load")
+    .set_long_description("Once per tick the OSD compares the average client op latency and the object store commit latency against osd_scrub_pacing_client_latency and osd_scrub_pacing_store_latency.  While either is above its target the scrub pace is halved; otherwise it recovers step by step.  At full pace scrub uses osd_scrub_chunk_max and osd_scrub_sleep; as the pace drops chunks shrink towards osd_scrub_chunk_min and up to osd_scrub_pacing_max_sleep is added between chunks.")
+    .add_see_also("osd_scrub_pacing_client_latency")
+    .add_see_also("osd_scrub_pacing_store_latency")
+    .add_see_also("osd_scrub_pacing_max_sleep"),
+
+    Option("osd_scrub_pacing_client_latency", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(.05)
+    .set_description("Client op latency (seconds) above which scrub backs off")
+    .set_long_description("0 ignores client op latency.")
+    .add_see_also("osd_scrub_pacing"),
+
+    Option("osd_scrub_pacing_store_latency", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(.02)
+    .set_description("Object store commit latency (seconds) above which scrub backs off")
+    .set_long_description("0 ignores object store latency.")
+    .add_see_also("osd_scrub_pacing"),
+
+    Option("osd_scrub_pacing_max_sleep", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(1.0)
+    .set_description("Longest delay (seconds) scrub pacing adds between chunks")
+    .add_see_also("osd_scrub_pacing"),
+
+    Option("osd_deep_scrub_checkpoint_interval", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("How often (seconds) a deep scrub records its progress")
+    .set_long_description("A deep scrub interrupted by a restart or an interval change resumes from the last recorded position instead of starting over, as long as no deep scrub has completed since and it began less than osd_deep_scrub_interval ago.  0 disables checkpoints.")
+    .add_see_also("osd_deep_scrub_interval"),
+
     Option("osd_scrub_auto_repair", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description("Automatically repair damaged objects detected during scrub"),
@@ -3478,6 +3738,12 @@ std::vector<Option> get_global_options() {
     .set_default(512_K)
     .set_description("Number of bytes to read from an object at a time during deep scrub"),
 
+    Option("osd_deep_scrub_store_csum", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Derive deep scrub data digests from the object store's checksums")
+    .set_long_description("With BlueStore and crc32c checksums, the data digest of whole checksum chunks is computed from the stored checksums while the read still verifies the data against them, saving the OSD's own pass over the data.  Compressed blobs, other checksum types and partial chunks fall back to a normal read.")
+    .add_see_also("bluestore_csum_type"),
+
     Option("osd_deep_scrub_keys", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(1024)
     .set_description("Number of keys to read from an object at a time during deep scrub"),
@@ -3552,6 +3818,22 @@ std::vector<Option> get_global_options() {
     .add_see_also("osd_min_pg_log_entries")
     .add_see_also("osd_pg_log_dups_tracked"),
 
+    Option("osd_target_pg_log_entries_per_osd", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(3000 * 100)
+    .set_description("target number of PG log entries across all PGs of an OSD")
+    .set_long_description("The budget is spread evenly over the PGs of the OSD, so the logs of clean PGs shrink from osd_min_pg_log_entries down to osd_target_pg_log_entries_min as the OSD takes on more PGs. 0 gives each PG osd_min_pg_log_entries.")
+    .add_service("osd")
+    .add_see_also("osd_min_pg_log_entries")
+    .add_see_also("osd_target_pg_log_entries_min"),
+
+    Option("osd_target_pg_log_entries_min", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(500)
+    .set_description("fewest PG log entries osd_target_pg_log_entries_per_osd leaves a clean PG")
+    .set_long_description("Keeps logs long enough for short outages to be recovered from the log rather than by backfill, however many PGs share the budget. A value above osd_min_pg_log_entries has no effect.")
+    .add_service("osd")
+    .add_see_also("osd_target_pg_log_entries_per_osd")
+    .add_see_also("osd_min_pg_log_entries"),
+
     Option("osd_pg_log_dups_tracked", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(3000)
     .set_description("how many versions back to track in order to detect duplicate ops; this is combined with both the regular pg log entries and additional minimal dup detection entries")
@@ -3562,9 +3844,10 @@ std::vector<Option> get_global_options() {
     Option("osd_object_clean_region_max_num_intervals", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(10)
     .set_description("number of intervals in clean_offsets")
-    .set_long_description("partial recovery uses multiple intervals to record the clean part of the object"
-        "when the number of intervals is greater than osd_object_clean_region_max_num_intervals, minimum interval will be trimmed"
-        "(0 will recovery the entire object data interval)")
+    .set_long_description("partial recovery uses multiple intervals to record the clean part of the object. "
+        "When the number of intervals is greater than osd_object_clean_region_max_num_intervals, the smallest interval is trimmed "
+        "(0 recovers the entire object data interval). Raising it keeps recovery of objects with many small scattered "
+        "overwrites, such as rbd images, limited to the dirty extents.")
     .add_service("osd"),
 
     Option("osd_force_recovery_pg_log_entries_factor", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
@@ -3872,6 +4155,13 @@ std::vector<Option> get_global_options() {
     .set_default("binned_lru")
     .set_description(""),
 
+    Option("rocksdb_cache_age_bins", Option::TYPE_UINT, Option::LEVEL_DEV)
+    .set_default(12)
+    .set_flag(Option::FLAG_RUNTIME)
+    .add_see_also({"rocksdb_cache_type", "bluestore_cache_autotune_interval"})
+    .set_description("Number of cache autotune intervals a binned_lru block cache entry stays at medium priority")
+    .set_long_description("When the cache autotuner balances memory, binned_lru block cache entries used since the previous balance are requested at the same priority as the onode and buffer caches, entries used within this many intervals at the priority below, and older entries below that.  Indexes and filters in the high priority pool are always requested first."),
+
     Option("rocksdb_block_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(4_K)
     .set_description(""),
@@ -3880,6 +4170,12 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description(""),
 
+    Option("rocksdb_trace_file", Option::TYPE_STR, Option::LEVEL_DEV)
+    .set_default("")
+    .set_description("Append a trace of the submitted transactions to this file")
+    .set_long_description("For every op of every transaction, the trace records the op type, the key prefix, a hash and the length of the key and the length of the value, but neither keys nor values. The trace can be replayed against any key/value store with ceph-kvstore-tool replay. The file is opened when the store is opened.")
+    .add_see_also("bluestore_rocksdb_options"),
+
     Option("rocksdb_collect_compaction_stats", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description(""),
@@ -3949,6 +4245,25 @@ std::vector<Option> get_global_options() {
     .set_default(3)
     .set_description("Priority to use for recovery operations if not specified for the pool"),
 
+    Option("osd_load_pgs_threads", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Number of threads reading pg info and logs when the OSD starts")
+    .set_long_description("0 uses one thread per cpu core. 1 reads the pgs one after the other."),
+
+    Option("osd_peering_msg_batch_pgs", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Number of pgs whose peering messages are combined into one message per peer osd")
+    .set_long_description("After a map change every pg sends its own pg query, notify and info messages to its peers.  With a value above 1, the messages of the pgs of one op shard are held back and sent together, one MOSDPGQuery, MOSDPGNotify or MOSDPGInfo per peer osd, once that many pgs have queued messages, the shard has no more work queued, or osd_peering_msg_batch_max_delay has passed.")
+    .add_see_also("osd_peering_msg_batch_max_delay"),
+
+    Option("osd_peering_msg_batch_max_delay", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0.005)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Maximum time (in seconds) a batched peering message waits while the op shard is busy")
+    .add_see_also("osd_peering_msg_batch_pgs"),
+
     Option("osd_peering_op_priority", Option::TYPE_UINT, Option::LEVEL_DEV)
     .set_default(255)
     .set_description(""),
@@ -4123,6 +4438,15 @@ std::vector<Option> get_global_options() {
     .set_default(64_K)
     .set_description(""),
 
+    Option("memstore_page_hugepages", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("allocate the memstore_page_set pages from huge page backed memory")
+    .set_long_description("Pages are carved from 2MB chunks that are mapped "
+                          "with transparent huge pages. Freed pages are "
+                          "reused, but the memory is never returned to the "
+                          "system.")
+    .add_see_also("memstore_page_set"),
+
     Option("objectstore_blackhole", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description(""),
@@ -4158,6 +4482,22 @@ std::vector<Option> get_global_options() {
     .set_default(16)
     .set_description(""),
 
+    Option("bdev_ioring", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Enables Linux io_uring API instead of libaio")
+    .set_long_description("Falls back to libaio if ceph was built without "
+                          "liburing or the running kernel does not support "
+                          "io_uring."),
+
+    Option("bdev_ioring_sqthread_poll", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Use a kernel submission polling thread (IORING_SETUP_SQPOLL) with io_uring")
+    .set_long_description("A kernel thread polls the submission queue, so "
+                          "submitting IO does not need a syscall as long as "
+                          "the thread is busy.  Requires CAP_SYS_ADMIN on "
+                          "older kernels.")
+    .add_see_also("bdev_ioring"),
+
     Option("bdev_block_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(4_K)
     .set_description(""),
@@ -4198,6 +4538,17 @@ std::vector<Option> get_global_options() {
     .set_default(1_M)
     .set_description(""),
 
+    Option("bluefs_readahead_max", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(4_M)
+    .set_description("Max async readahead window for sequential BlueFS readers on rotational devices; 0 disables")
+    .set_long_description("Once a reader has issued bluefs_readahead_trigger_requests back-to-back reads, the next window is read asynchronously, starting at bluefs_max_prefetch and doubling up to this size. Random readers never read ahead.")
+    .add_see_also("bluefs_max_prefetch"),
+
+    Option("bluefs_readahead_trigger_requests", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(4)
+    .set_description("Sequential reads that must be observed on a BlueFS reader before readahead starts")
+    .add_see_also("bluefs_readahead_max"),
+
     Option("bluefs_min_log_runway", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(1_M)
     .set_description(""),
@@ -4297,6 +4648,12 @@ std::vector<Option> get_global_options() {
     .set_default("0x1")
     .set_description("A hexadecimal bit mask of the cores to run on. Note the core numbering can change between platforms and should be determined beforehand"),
 
+    Option("bluestore_spdk_shm_id", Option::TYPE_INT, Option::LEVEL_DEV)
+    .set_default(-1)
+    .set_description("Shared memory id of the SPDK environment")
+    .set_long_description("OSDs on one node that set the same non-negative id run SPDK in multi-process mode and can share an NVMe controller, each on its own namespace (given as ns:<id> next to the transport id in the block file) and with its own I/O queues. -1 runs SPDK alone in this process.")
+    .add_see_also("bluestore_spdk_mem"),
+
     Option("bluestore_spdk_max_io_completion", Option::TYPE_UINT, Option::LEVEL_DEV)
     .set_default(0)
     .set_description("Maximal I/Os to be batched completed while checking queue pair completions, 0 means let spdk library determine it"),
@@ -4451,6 +4808,12 @@ std::vector<Option> get_global_options() {
     .set_description("Default value of bluestore_compression_min_blob_size for non-rotational (solid state) media")
     .add_see_also("bluestore_compression_min_blob_size"),
 
+    Option("bluestore_compression_threads", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Threads compressing the blobs of a single write in parallel")
+    .set_long_description("A write split into several blobs has them compressed by this many helper threads as well as the submitting one, so large writes to compressed pools (or offload accelerators such as QAT) are not serialized blob by blob. 0 compresses them one after the other in the submitting thread."),
+
     Option("bluestore_compression_max_blob_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(0)
     .set_flag(Option::FLAG_RUNTIME)
@@ -4523,6 +4886,11 @@ std::vector<Option> get_global_options() {
     .set_default(256)
     .set_description("Preallocated buffer for inline shards"),
 
+    Option("bluestore_extent_map_lazy_decode", Option::TYPE_BOOL, Option::LEVEL_DEV)
+    .set_default(true)
+    .set_description("Decode only the extents a read touches instead of whole extent map shards")
+    .set_long_description("Reads index the encoded shard and build lextents and blobs on demand; the shard is decoded in full the first time a write or other non-read path needs it."),
+
     Option("bluestore_cache_trim_interval", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(.05)
     .set_description("How frequently we trim the bluestore cache"),
@@ -4531,6 +4899,22 @@ std::vector<Option> get_global_options() {
     .set_default(64)
     .set_description("Max pinned cache entries we consider before giving up"),
 
+    Option("bluestore_cache_trim_batch_onodes", Option::TYPE_UINT, Option::LEVEL_DEV)
+    .set_default(256)
+    .set_description("Max onodes a cache shard trims before dropping its lock")
+    .set_long_description("Cache shards are trimmed in steps of at most this many onodes, releasing the shard lock in between, to avoid latency spikes when the cache shrinks. 0 trims in a single pass."),
+
+    Option("bluestore_cache_trim_batch_bytes", Option::TYPE_SIZE, Option::LEVEL_DEV)
+    .set_default(8_M)
+    .set_description("Max buffer bytes a cache shard trims before dropping its lock")
+    .set_long_description("Cache shards are trimmed in steps of at most this many buffer bytes, releasing the shard lock in between, to avoid latency spikes when the cache shrinks. 0 trims in a single pass."),
+
+    Option("bluestore_cache_shard_min_ratio", Option::TYPE_FLOAT, Option::LEVEL_DEV)
+    .set_default(.5)
+    .set_min_max(0.0, 1.0)
+    .set_description("Fraction of the even per-shard cache share that every shard keeps")
+    .set_long_description("The rest of the onode and buffer cache budget is divided between the cache shards in proportion to their recent onode lookups and buffer IO, so busy shards get a bigger share. 1 divides the cache evenly."),
+
     Option("bluestore_cache_type", Option::TYPE_STR, Option::LEVEL_DEV)
     .set_default("2q")
     .set_enum_allowed({"2q", "lru"})
@@ -4569,6 +4953,12 @@ std::vector<Option> get_global_options() {
     .add_see_also("bluestore_cache_size")
     .set_description("Ratio of bluestore cache to devote to kv database (rocksdb)"),
 
+    Option("bluestore_cache_decompressed_ratio", Option::TYPE_FLOAT, Option::LEVEL_DEV)
+    .set_default(.05)
+    .add_see_also("bluestore_cache_size")
+    .set_description("Ratio of bluestore cache to devote to decompressed blobs")
+    .set_long_description("Taken out of the share left for object data. Whole decompressed blobs are kept here instead of in the per-object buffer cache so that repeated reads of compressed data skip the checksum and decompression. 0 disables it."),
+
     Option("bluestore_cache_autotune", Option::TYPE_BOOL, Option::LEVEL_DEV)
     .set_default(true)
     .add_see_also("bluestore_cache_size")
@@ -4587,10 +4977,35 @@ std::vector<Option> get_global_options() {
 
     Option("bluestore_allocator", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("bitmap")
-    .set_enum_allowed({"bitmap", "stupid"})
+    .set_enum_allowed({"bitmap", "stupid", "avl"})
     .set_description("Allocator policy")
     .set_long_description("Allocator to use for bluestore.  Stupid should only be used for testing."),
 
+    Option("bluestore_alloc_snapshot", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Save the allocator state on clean umount and load it on mount")
+    .set_long_description("Rebuilding the allocator from the freelist walks all of it, which makes mounting large, fragmented devices slow. With this set, a clean umount writes the free extents to the kv store and the next mount loads them instead. The snapshot is dropped as soon as the store is opened for writing, so after a crash, or if the device or bluefs layout changed, the freelist is used as before."),
+
+    Option("bluestore_avl_alloc_bf_threshold", Option::TYPE_UINT, Option::LEVEL_DEV)
+    .set_default(131072)
+    .set_description("Sets threshold at which shrinking max free chunk size triggers enabling best-fit mode.")
+    .set_long_description("AVL allocator works in two modes: near-fit and best-fit. By default, it uses very fast near-fit mode, "
+                          "in which it tries to fit a new block near the last allocated block of similar size. The second mode "
+                          "is much slower best-fit mode, in which it tries to find an exact match for the requested allocation. "
+                          "This mode is used when either the device gets fragmented or when it is low on free space. "
+                          "When the largest free block is smaller than 'bluestore_avl_alloc_bf_threshold', best-fit mode is used.")
+    .add_see_also("bluestore_avl_alloc_bf_free_pct"),
+
+    Option("bluestore_avl_alloc_bf_free_pct", Option::TYPE_UINT, Option::LEVEL_DEV)
+    .set_default(4)
+    .set_description("Sets threshold at which shrinking free space (in %, integer) triggers enabling best-fit mode.")
+    .set_long_description("AVL allocator works in two modes: near-fit and best-fit. By default, it uses very fast near-fit mode, "
+                          "in which it tries to fit a new block near the last allocated block of similar size. The second mode "
+                          "is much slower best-fit mode, in which it tries to find an exact match for the requested allocation. "
+                          "This mode is used when either the device gets fragmented or when it is low on free space. "
+                          "When free space is smaller than 'bluestore_avl_alloc_bf_free_pct', best-fit mode is used.")
+    .add_see_also("bluestore_avl_alloc_bf_threshold"),
+
     Option("bluestore_freelist_blocks_per_key", Option::TYPE_SIZE, Option::LEVEL_DEV)
     .set_default(128)
     .set_description("Block (and bits) per database key"),
@@ -4617,7 +5032,13 @@ std::vector<Option> get_global_options() {
 
     Option("bluestore_rocksdb_cfs", Option::TYPE_STR, Option::LEVEL_DEV)
     .set_default("M= P= L=")
-    .set_description("List of whitespace-separate key/value pairs where key is CF name and value is CF options"),
+    .set_description("List of whitespace-separate key/value pairs where key is CF name and value is CF options")
+    .set_long_description("A CF name of the form 'X(n)' or 'X(n,l-h)' spreads prefix X over n column families X-0..X-(n-1), placing each key by the rjenkins hash of its bytes [l, h) (the whole key by default).  Each shard gets its own memtables and compaction, configured by the options string.  Sharding is fixed when the store is created; a different definition on an existing store is ignored."),
+
+    Option("bluestore_omap_readahead", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(2_M)
+    .set_description("Read-ahead for omap iterators used for bulk reads")
+    .set_long_description("Iterators start reading ahead this much of the key/value store once they are asked for a batch of entries; 0 disables read-ahead."),
 
     Option("bluestore_fsck_on_mount", Option::TYPE_BOOL, Option::LEVEL_DEV)
     .set_default(false)
@@ -4643,15 +5064,24 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description("Run deep fsck after mkfs"),
 
-    Option("bluestore_sync_submit_transaction", Option::TYPE_BOOL, Option::LEVEL_DEV)
+    Option("bluestore_sync_submit_transaction", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
-    .set_description("Try to submit metadata transaction to rocksdb in queuing thread context"),
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Try to submit metadata transaction to rocksdb in queuing thread context")
+    .set_long_description("By default every transaction is submitted to rocksdb by the single kv_sync thread, which caps the commit rate of fast devices.  With this enabled, a transaction is submitted by the thread that queued it, so transactions of different sequencers are written to rocksdb in parallel and the kv_sync thread is only left with the flush and the final synchronous commit.  Ordering is kept per sequencer: a transaction still goes through the kv_sync thread if an earlier one in its sequencer did or has unstable ios.  Adding enable_pipelined_write=true to bluestore_rocksdb_options lets rocksdb overlap the WAL and memtable writes of those concurrent submitters.")
+    .add_see_also("bluestore_rocksdb_options"),
 
     Option("bluestore_fsck_read_bytes_cap", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(64_M)
     .set_flag(Option::FLAG_RUNTIME)
     .set_description("Maximum bytes read at once by deep fsck"),
 
+    Option("bluestore_fsck_read_threads", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Threads reading object data during deep fsck")
+    .set_long_description("Deep fsck reads (and so verifies the checksums of) every object's data, which dominates its run time on large devices. With a non-zero value those reads are handed to this many threads while the metadata walk carries on. 0 reads each object in the walking thread.")
+    .add_see_also("bluestore_fsck_read_bytes_cap"),
+
     Option("bluestore_throttle_bytes", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(64_M)
     .set_flag(Option::FLAG_RUNTIME)
@@ -4696,6 +5126,13 @@ std::vector<Option> get_global_options() {
     .set_description("Default bluestore_deferred_batch_ops for non-rotational (solid state) media")
     .add_see_also("bluestore_deferred_batch_ops"),
 
+    Option("bluestore_deferred_aggregate", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Merge pending deferred writes of all sequencers into one offset-sorted submission on rotational media")
+    .set_long_description("When the deferred queue is flushed, the pending batches of every sequencer that has no deferred io in flight are submitted together, sorted by device offset, with adjacent writes coalesced into larger ios.")
+    .add_see_also("bluestore_deferred_batch_ops_hdd"),
+
     Option("bluestore_nid_prealloc", Option::TYPE_INT, Option::LEVEL_DEV)
     .set_default(1024)
     .set_description("Number of unique object ids to preallocate at a time"),
@@ -4809,6 +5246,19 @@ std::vector<Option> get_global_options() {
     .set_default(1)
     .set_description("log omap iteration operation if it's slower than this age (seconds)"),
 
+    Option("bluestore_op_events_sample", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Record the transaction states of 1 in this many tracked ops as op events (0 disables)")
+    .set_long_description("The states then show up next to the OSD's own events in dump_ops_in_flight and dump_historic_ops, including the retained slow ops. Each recorded state takes the op's lock and an allocation on the transaction path, so this is off by default; set it to a large value to sample the states in production.")
+    .add_see_also("osd_op_history_slow_op_threshold"),
+
+    Option("bluestore_inline_data_max", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Keep the data of objects no larger than this in their onode (0 disables)")
+    .set_long_description("The data of a small object that has no extents yet is stored in its onode in the key/value store instead of in an allocation of bluestore_min_alloc_size, so reading it takes no extra device read.  It moves to regular extents once a write or zero goes past this size.  Onodes with inline data need a release that knows about it to be decoded, so an OSD cannot be downgraded once it has written any.  Inline bytes count as allocated and stored in statfs and in pool usage.")
+    .add_see_also("bluestore_min_alloc_size"),
+
     Option("bluestore_debug_enforce_settings", Option::TYPE_STR, Option::LEVEL_DEV)
     .set_default("default")
     .set_enum_allowed({"default", "hdd", "ssd"})
@@ -5295,6 +5745,17 @@ std::vector<Option> get_global_options() {
     .set_default(0)
     .set_description(""),
 
+    Option("rados_aio_finisher_threads", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1)
+    .set_min(1)
+    .set_description("Number of threads completing aio callbacks")
+    .set_long_description("With more than one thread, the callbacks of different IoCtxs may run concurrently, while those of the same IoCtx still run one at a time and in order."),
+
+    Option("rados_striper_lock_lease", Option::TYPE_SECS, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Keep the shared lock on a striped object for this long after an operation")
+    .set_long_description("Every read and write on a striped object takes a shared lock on its first rados object and releases it when done. When this is non-zero, libradosstriper takes the lock as a lease of this duration instead, and reuses it for further operations on the same object during the first half of the lease, saving the lock and unlock round trips. The lease is renewed for as long as an operation using it runs. A lease held by one client makes removals and truncations of the object by other clients fail with EBUSY until it expires. 0 disables leases."),
+
     Option("rados_tracing", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description(""),
@@ -5482,6 +5943,23 @@ std::vector<Option> get_rgw_options() {
     .set_default(1000)
     .set_description("Max number of objects in a single multi-object delete request"),
 
+    Option("rgw_multi_obj_del_threads", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(8)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Number of threads running the deletes of multi-object delete requests")
+    .set_long_description(
+        "The objects of a multi-object delete request are deleted on a pool "
+        "of this many threads shared by all the requests, so that the index "
+        "and head object round trips of different objects overlap. 0 deletes "
+        "them one after the other on the request's thread.")
+    .add_see_also("rgw_multi_obj_del_max_aio"),
+
+    Option("rgw_multi_obj_del_max_aio", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(16)
+    .set_min(1)
+    .set_description("Max number of deletes of a multi-object delete request in flight at once")
+    .add_see_also("rgw_multi_obj_del_threads"),
+
     Option("rgw_website_routing_rules_max_num", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(50)
     .set_description("Max number of website routing rules in a single request"),
@@ -5504,6 +5982,18 @@ std::vector<Option> get_rgw_options() {
         "need to be atomic, and anything larger than this would require more than a single "
         "operation."),
 
+    Option("rgw_compression_block_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Size of the blocks uploaded data is compressed in")
+    .set_long_description(
+        "Compressed objects are stored as a series of independently compressed "
+        "blocks, and a ranged read only decompresses the blocks it overlaps. When "
+        "non-zero, blocks are cut at this many bytes of uncompressed data, rather "
+        "than at each rgw_max_chunk_size of input. Smaller blocks make small "
+        "ranged reads of compressed objects cheaper at the cost of compression "
+        "ratio and of a larger block index in the object's attributes.")
+    .add_see_also("rgw_max_chunk_size"),
+
     Option("rgw_put_obj_min_window_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(16_M)
     .set_description("The minimum RADOS write window size (in bytes).")
@@ -5520,6 +6010,26 @@ std::vector<Option> get_rgw_options() {
     .set_long_description("The window size may be dynamically adjusted, but will not surpass this value.")
     .add_see_also({"rgw_put_obj_min_window_size", "rgw_max_chunk_size"}),
 
+    Option("rgw_put_obj_filter_threads", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Number of threads that compress and encrypt uploaded data")
+    .set_long_description(
+        "When non-zero, the compression and encryption of object uploads is handed "
+        "to a pool of this many threads, shared by all requests, so that several "
+        "chunks of an upload are processed at the same time. When zero, each "
+        "request compresses and encrypts its data on its own thread.")
+    .add_see_also({"rgw_put_obj_filter_window", "rgw_max_chunk_size"}),
+
+    Option("rgw_put_obj_filter_window", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(4)
+    .set_min(1)
+    .set_description("Chunks of an upload compressed or encrypted at the same time")
+    .set_long_description(
+        "The number of rgw_max_chunk_size chunks of a single upload that may be "
+        "waiting on the rgw_put_obj_filter_threads pool at once.")
+    .add_see_also({"rgw_put_obj_filter_threads", "rgw_max_chunk_size"}),
+
     Option("rgw_max_put_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(5_G)
     .set_description("Max size (in bytes) of regular (non multi-part) object upload.")
@@ -5614,6 +6124,32 @@ std::vector<Option> get_rgw_options() {
         "When full, the RGW metadata cache evicts least recently used entries.")
     .add_see_also("rgw_cache_enabled"),
 
+    Option("rgw_datacache_enabled", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Enable the local object data cache")
+    .set_long_description(
+        "Keep copies of the tail stripes read by GET requests in files under "
+        "rgw_datacache_path, typically on a local SSD or NVMe device, and serve "
+        "rereads of the same stripes from there instead of from RADOS.")
+    .add_see_also("rgw_datacache_path")
+    .add_see_also("rgw_datacache_size"),
+
+    Option("rgw_datacache_path", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("/var/cache/ceph/rgw_datacache")
+    .set_description("Directory holding the local object data cache")
+    .set_long_description(
+        "The directory is created if needed and emptied when the gateway starts, "
+        "it must not be shared between gateways.")
+    .add_see_also("rgw_datacache_enabled"),
+
+    Option("rgw_datacache_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(1_G)
+    .set_description("Maximum size of the local object data cache")
+    .set_long_description(
+        "Once the cached stripes reach this size the least recently read ones "
+        "are evicted.")
+    .add_see_also("rgw_datacache_enabled"),
+
     Option("rgw_socket_path", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("")
     .set_description("RGW FastCGI socket path (for FastCGI over Unix domain sockets).")
@@ -5684,6 +6220,26 @@ std::vector<Option> get_rgw_options() {
           "concurrency of lifecycle maintenance, but requires multiple RGW processes "
           "running on the zone to be utilized."),
 
+    Option("rgw_lc_max_worker", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(3)
+    .set_min(1)
+    .set_description("Number of lifecycle worker threads")
+    .set_long_description(
+          "Number of threads processing the lifecycle data shards in parallel, each one "
+          "taking a bucket at a time. The buckets are also shared with the lifecycle "
+          "threads of the other RGW processes of the zone.")
+    .add_see_also({"rgw_lc_max_objs", "rgw_lc_max_wp_worker"}),
+
+    Option("rgw_lc_max_wp_worker", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(3)
+    .set_min(1)
+    .set_description("Number of threads processing the index shards of a bucket")
+    .set_long_description(
+          "Number of threads each lifecycle worker uses to process the index shards of "
+          "a bucket in parallel. Workers with no bucket left to take help with the index "
+          "shards of the buckets still being processed.")
+    .add_see_also({"rgw_lc_max_worker"}),
+
     Option("rgw_lc_max_rules", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(1000)
     .set_description("Max number of lifecycle rules set on one bucket")
@@ -6044,6 +6600,33 @@ std::vector<Option> get_rgw_options() {
     .set_default(10)
     .set_description(""),
 
+    Option("rgw_nfs_readdir_attr_ttl", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("How long (in seconds) the attributes of a listed object stand in for a stat")
+    .set_long_description(
+        "When non-zero, readdir keeps the size, mtime and etag of each object "
+        "of the listing on its file handle, and a lookup of it within this "
+        "many seconds uses them rather than heading the object. Unix "
+        "attributes (mode, owner) are not part of the listing, so the "
+        "defaults are reported for objects not looked up before. 0 disables."),
+
+    Option("rgw_nfs_negative_cache_ttl", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("How long (in seconds) a failed lookup of an object is remembered")
+    .set_long_description(
+        "When non-zero, a lookup of a name that was not found is failed "
+        "without asking RADOS again for this many seconds, unless it was "
+        "created through this gateway meanwhile. Objects created by other "
+        "clients may be missed for as long. 0 disables.")
+    .add_see_also("rgw_nfs_negative_cache_size"),
+
+    Option("rgw_nfs_negative_cache_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(10000)
+    .set_min(1)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Number of failed lookups remembered")
+    .add_see_also("rgw_nfs_negative_cache_ttl"),
+
     Option("rgw_rados_pool_autoscale_bias", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(4.0)
     .set_min_max(0.01, 100000.0)
@@ -6185,7 +6768,7 @@ std::vector<Option> get_rgw_options() {
     .set_default(false)
     .set_description("Enable ops log")
     .add_see_also({"rgw_log_nonexistent_bucket", "rgw_log_object_name", "rgw_ops_log_rados",
-               "rgw_ops_log_socket_path"}),
+               "rgw_ops_log_socket_path", "rgw_ops_log_file_path"}),
 
     Option("rgw_enable_usage_log", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
@@ -6217,6 +6800,54 @@ std::vector<Option> get_rgw_options() {
         "listener needs to clear data (by reading it) quickly enough.")
     .add_see_also({"rgw_enable_ops_log", "rgw_ops_log_socket_path"}),
 
+    Option("rgw_ops_log_batch_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(64_K)
+    .set_description("Ops log data batched before it is written to RADOS")
+    .set_long_description(
+        "When non-zero, ops log entries are appended to their RADOS log objects in "
+        "batches, once this many bytes of them are pending or rgw_ops_log_flush_interval "
+        "passed, rather than with a write per request. Pending entries are lost if "
+        "RGW does not shut down cleanly.")
+    .add_see_also({"rgw_ops_log_rados", "rgw_ops_log_flush_interval"}),
+
+    Option("rgw_ops_log_flush_interval", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(1.0)
+    .set_min(0.1)
+    .set_description("Seconds between flushes of the batched ops log")
+    .add_see_also({"rgw_ops_log_batch_size", "rgw_ops_log_file_path"}),
+
+    Option("rgw_ops_log_file_path", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("")
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("File that ops log entries are appended to")
+    .set_long_description(
+        "If set, RGW also writes the ops log to this file, one JSON entry per line, "
+        "every rgw_ops_log_flush_interval.")
+    .add_see_also({"rgw_enable_ops_log", "rgw_ops_log_flush_interval"}),
+
+    Option("rgw_pubsub_push_batch_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1)
+    .set_min(1)
+    .set_description("Maximum number of events pushed to an endpoint in one message")
+    .set_long_description(
+        "While the pubsub sync module waits for an endpoint to accept a push, the "
+        "events for the same endpoint and topic gather and are then sent together, "
+        "as an array of up to this many events (\"Records\" for S3 notifications). "
+        "With 1, every event is pushed as a message of its own, and pushes to the "
+        "same endpoint are not serialized.")
+    .add_see_also({"rgw_pubsub_push_max_retries"}),
+
+    Option("rgw_pubsub_push_max_retries", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(3)
+    .set_description("Retries of a failed push to a pubsub endpoint")
+    .add_see_also({"rgw_pubsub_push_retry_backoff", "rgw_pubsub_push_batch_size"}),
+
+    Option("rgw_pubsub_push_retry_backoff", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(1.0)
+    .set_description("Seconds before the first retry of a failed push")
+    .set_long_description("The delay doubles with every further retry.")
+    .add_see_also({"rgw_pubsub_push_max_retries"}),
+
     Option("rgw_fcgi_socket_backlog", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(1024)
     .set_description("FastCGI socket connection backlog")
@@ -6312,6 +6943,27 @@ std::vector<Option> get_rgw_options() {
     .set_description("Max number of keys to remove from garbage collector log in a single operation")
     .add_see_also({"rgw_gc_max_objs", "rgw_gc_obj_min_wait", "rgw_gc_processor_max_time", "rgw_gc_max_concurrent_io"}),
 
+    Option("rgw_gc_max_queue_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(131071_K)
+    .set_description("Maximum size of the queue of a garbage collector shard")
+    .set_long_description(
+        "The garbage collector appends the chains of tail objects to the data of its "
+        "shard objects rather than to their omap, which leaves no tombstones behind "
+        "once the chains are processed. When a queue is full its chains go to the omap "
+        "of the shard instead. The size is set when the queue is first created and "
+        "must not exceed osd_max_object_size.")
+    .add_see_also({"rgw_gc_max_objs", "rgw_gc_queue_batch_size", "osd_max_object_size"}),
+
+    Option("rgw_gc_queue_batch_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1000)
+    .set_min(1)
+    .set_description("Number of garbage collector queue entries processed at once")
+    .set_long_description(
+        "The tail objects of a batch are deleted with up to rgw_gc_max_concurrent_io "
+        "operations in flight, after which the whole batch is removed from the queue "
+        "with a single operation.")
+    .add_see_also({"rgw_gc_max_queue_size", "rgw_gc_max_concurrent_io"}),
+
     Option("rgw_s3_success_create_obj_status", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(0)
     .set_description("HTTP return code override for object creation")
@@ -6407,6 +7059,44 @@ std::vector<Option> get_rgw_options() {
         "the rgw_curl_low_speed_limit for the library to consider it too slow and abort. "
         "Set it zero to disable this."),
 
+    Option("rgw_http_client_max_idle_connections", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(64)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Max number of idle connections each HTTP client manager keeps for reuse")
+    .set_long_description(
+        "Connections to other zones, Keystone, OPA and the like are kept "
+        "alive after a request for the next one to the same endpoint, up to "
+        "this many per manager. The oldest idle connection is closed when "
+        "there are more."),
+
+    Option("rgw_http_client_max_host_connections", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Max number of connections each HTTP client manager opens to one endpoint")
+    .set_long_description(
+        "Requests above this are queued until a connection to the endpoint "
+        "is free. 0 means no limit."),
+
+    Option("rgw_http_client_share_sessions", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Share the DNS and TLS session caches of all HTTP client requests")
+    .set_long_description(
+        "When true, a new connection to an endpoint resumes the TLS session "
+        "of an earlier one to it where the server allows, rather than doing a "
+        "full handshake."),
+
+    Option("rgw_sync_http2", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Multiplex multisite sync requests over HTTP/2")
+    .set_long_description(
+        "When true, the requests of the coroutine managers that drive "
+        "multisite sync are sent over HTTP/2 to endpoints that negotiate it "
+        "through TLS, and share a single connection per endpoint. Plain HTTP "
+        "endpoints keep using HTTP/1.1. Requires libcurl 7.47 or later "
+        "built with HTTP/2 support."),
+
     Option("rgw_copy_obj_progress", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description("Send progress report through copy operation")
@@ -6457,6 +7147,18 @@ std::vector<Option> get_rgw_options() {
     .set_long_description(
         "Length of time for bucket stats to be cached within RGW instance."),
 
+    Option("rgw_quota_stats_notify_interval", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_min(0)
+    .set_description("Seconds between pushes of quota stats to the other gateways")
+    .set_long_description(
+        "When non-zero, each gateway batches its changes to bucket and user stats and "
+        "sends them to the other gateways of the zone with a single notification this "
+        "often. With the stats of the others applied to their caches, gateways skip the "
+        "early refresh of cached stats, which reads the index headers of all bucket "
+        "shards, and only fetch them again once rgw_bucket_quota_ttl expires.")
+    .add_see_also({"rgw_bucket_quota_ttl", "rgw_user_quota_bucket_sync_interval"}),
+
     Option("rgw_bucket_quota_soft_threshold", Option::TYPE_FLOAT, Option::LEVEL_BASIC)
     .set_default(0.95)
     .set_description("RGW quota soft threshold")
@@ -6551,6 +7253,16 @@ std::vector<Option> get_rgw_options() {
     .set_default(10000)
     .set_description("Max number of parts in multipart upload"),
 
+    Option("rgw_multipart_list_max_aio", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(16)
+    .set_min(1)
+    .set_description("Max number of part list pages read concurrently when completing a multipart upload")
+    .set_long_description(
+        "When the parts of an upload are numbered from 1 without gaps, the pages "
+        "of the part list are read ahead in parallel instead of one after the "
+        "other.")
+    .add_see_also("rgw_multipart_part_upload_limit"),
+
     Option("rgw_max_slo_entries", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(1000)
     .set_description("Max number of entries in Swift Static Large Object manifest"),
@@ -6623,6 +7335,27 @@ std::vector<Option> get_rgw_options() {
     .set_default(120)
     .set_description(""),
 
+    Option("rgw_bucket_sync_spawn_window", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(20)
+    .set_min(1)
+    .set_description("Initial number of objects to sync concurrently per bucket shard")
+    .set_long_description(
+        "The number of objects that a bucket shard sync fetches from the source "
+        "zone at the same time when it starts. The window then adapts to the "
+        "replication latency, but never drops below this value.")
+    .add_see_also("rgw_bucket_sync_spawn_window_max"),
+
+    Option("rgw_bucket_sync_spawn_window_max", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(128)
+    .set_min(1)
+    .set_description("Maximum number of objects to sync concurrently per bucket shard")
+    .set_long_description(
+        "The bucket shard sync window grows up to this value while the average "
+        "object replication latency stays close to the best one seen, and "
+        "shrinks back when it rises. Setting it to rgw_bucket_sync_spawn_window "
+        "disables the adaptation.")
+    .add_see_also("rgw_bucket_sync_spawn_window"),
+
     Option("rgw_sync_log_trim_interval", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(1200)
     .set_description("Sync log trim interval")
@@ -6751,6 +7484,28 @@ std::vector<Option> get_rgw_options() {
     .add_tag("performance")
     .add_service("rgw"),
 
+    Option("rgw_reshard_copy_threads", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(4)
+    .set_min(1)
+    .set_description("Number of source bucket index shards copied in parallel during resharding")
+    .set_long_description(
+        "The outstanding I/O of each copier is bounded by rgw_reshard_max_aio. "
+        "A verbose reshard from radosgw-admin always uses a single copier.")
+    .add_tag("performance")
+    .add_service("rgw")
+    .add_see_also("rgw_reshard_max_aio"),
+
+    Option("rgw_reshard_online", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Keep accepting writes while a bucket index is resharded")
+    .set_long_description(
+        "The index shards log the objects changed while their entries are "
+        "copied, and the reshard copies those objects again before it "
+        "switches to the new shards. Writes are only blocked for the last "
+        "pass over the logs. When disabled, writes are blocked for the whole "
+        "reshard.")
+    .add_service("rgw"),
+
     Option("rgw_trust_forwarded_https", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description("Trust Forwarded and X-Forwarded-Proto headers")
@@ -6861,6 +7616,48 @@ std::vector<Option> get_rgw_options() {
 			  "of RGW instances under heavy use. If you would like "
 			  "to turn off cache expiry, set this value to zero."),
 
+    Option("rgw_cache_lease_interval", Option::TYPE_UINT,
+	   Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Number of seconds a cache entry is used before it "
+		     "is revalidated. Zero disables leases.")
+    .add_tag("performance")
+    .add_service("rgw")
+    .set_long_description("By default every metadata write is pushed to "
+			  "all the other RGW instances through the control "
+			  "objects, so the cost of a write grows with the "
+			  "number of gateways. With a lease, a cache entry "
+			  "that is older than this is checked against the "
+			  "version of its rados object, and only re-read if "
+			  "that changed. Writes are then announced as "
+			  "batched invalidations instead, and the other "
+			  "gateways may serve the previous version until "
+			  "the batch reaches them or the lease ends.")
+    .add_see_also("rgw_cache_invalidate_batch_interval"),
+
+    Option("rgw_cache_invalidate_batch_interval", Option::TYPE_UINT,
+	   Option::LEVEL_ADVANCED)
+    .set_default(500)
+    .set_description("Milliseconds the cache invalidations of local writes "
+		     "are collected before they are sent to the other RGW "
+		     "instances, if rgw_cache_lease_interval is set.")
+    .add_service("rgw")
+    .add_see_also("rgw_cache_lease_interval"),
+
+    Option("rgw_cache_invalidate_batch", Option::TYPE_BOOL,
+	   Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Send the collected cache invalidations as one "
+		     "notification rather than one per object.")
+    .add_service("rgw")
+    .set_long_description("Gateways of releases before batched "
+			  "invalidations reject such notifications and keep "
+			  "their stale entries, so only enable this once "
+			  "every RGW instance of the zone runs a release "
+			  "that has rgw_cache_lease_interval.")
+    .add_see_also("rgw_cache_lease_interval")
+    .add_see_also("rgw_cache_invalidate_batch_interval"),
+
     Option("rgw_inject_notify_timeout_probability", Option::TYPE_FLOAT,
 	   Option::LEVEL_DEV)
     .set_default(0)
@@ -7022,6 +7819,40 @@ std::vector<Option> get_rgw_options() {
     .add_see_also("rgw_dmclock_metadata_res")
     .add_see_also("rgw_dmclock_metadata_wgt"),
 
+    Option("rgw_dmclock_tenant_qos", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Schedule the requests of buckets and users by their own QoS")
+    .set_long_description(
+        "With the dmclock scheduler of the beast frontend, the data and "
+        "metadata requests of the buckets and users that have a QoS set with "
+        "'radosgw-admin qos set' are also scheduled as dmclock clients of their "
+        "own, once they are authenticated. The bucket's QoS takes precedence "
+        "over that of the user.")
+    .add_see_also("rgw_scheduler_type")
+    .add_see_also("rgw_dmclock_tenant_max_requests")
+    .add_see_also("rgw_dmclock_tenant_exchange_interval"),
+
+    Option("rgw_dmclock_tenant_max_requests", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(256)
+    .set_min(0)
+    .set_description("Maximum number of concurrent requests of the buckets and users with a QoS")
+    .set_long_description(
+        "The weights of the bucket and user QoS only apply when their requests "
+        "have to wait for each other. 0 means no limit, leaving only the "
+        "reservations and limits.")
+    .add_see_also("rgw_dmclock_tenant_qos"),
+
+    Option("rgw_dmclock_tenant_exchange_interval", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(10)
+    .set_min(1)
+    .set_description("Seconds between exchanges of the bucket and user request rates between gateways")
+    .set_long_description(
+        "Gateways share their request rates for the buckets and users with a "
+        "QoS through an object in the zone's log pool. Each gateway applies "
+        "the part of the reservation and limit that matches its share of the "
+        "requests, so that they hold for the whole zone.")
+    .add_see_also("rgw_dmclock_tenant_qos"),
+
   });
 }
 
@@ -7077,7 +7908,11 @@ static std::vector<Option> get_rbd_options() {
 
     Option("rbd_op_threads", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(1)
-    .set_description("number of threads to utilize for internal processing"),
+    .set_description("number of threads to utilize for internal processing")
+    .set_long_description("with rbd_non_blocking_aio, these threads also "
+                          "dispatch the IO of the images. writes to "
+                          "overlapping extents are sent in the order they "
+                          "were queued"),
 
     Option("rbd_op_thread_timeout", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(60)
@@ -7126,11 +7961,72 @@ static std::vector<Option> get_rbd_options() {
     .set_default(false)
     .set_description("whether to block writes to the cache before the aio_write call completes"),
 
+    Option("rbd_parent_cache_enabled", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("whether to read clone parents through the local immutable object cache daemon")
+    .set_long_description("parent objects the daemon does not have yet are read "
+                          "from the cluster while it copies them in")
+    .add_see_also("immutable_object_cache_sock"),
+
+    Option("rbd_persistent_cache_enabled", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("whether to log writes to a local persistent cache")
+    .set_long_description("writes are acknowledged once they are in a log "
+                          "file on the client and written back to the image "
+                          "in the background. until they are written back, "
+                          "the image can only be locked by the same host. "
+                          "not used with journaling")
+    .add_see_also("rbd_persistent_cache_path"),
+
+    Option("rbd_persistent_cache_path", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("")
+    .set_description("directory of the persistent cache logs, on local SSD or PMEM")
+    .set_long_description("must be set for the persistent cache to be enabled. "
+                          "the logs hold data that is not in the image yet, so "
+                          "this should not be a directory that is cleaned up "
+                          "on reboot")
+    .add_see_also("rbd_persistent_cache_enabled"),
+
+    Option("rbd_persistent_cache_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(1_G)
+    .set_min(1_M)
+    .set_description("size of the persistent cache log of an image"),
+
+    Option("rbd_persistent_cache_max_in_flight", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(32)
+    .set_min(1)
+    .set_description("maximum number of persistent cache log entries written back at once"),
+
     Option("rbd_concurrent_management_ops", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(10)
     .set_min(1)
     .set_description("how many operations can be in flight for a management operation like deleting or resizing an image"),
 
+    Option("rbd_deep_copy_concurrent_objects", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("how many objects can be copied at once by a deep copy or a live migration")
+    .set_long_description("If set to 0, rbd_concurrent_management_ops is used.")
+    .add_see_also("rbd_concurrent_management_ops"),
+
+    Option("rbd_deep_copy_shared_concurrent_objects", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("how many objects can be copied at once by all the deep copies of a client")
+    .set_long_description("The budget is shared by all the deep copies and "
+                          "live migrations running on the same client, such "
+                          "as all the image syncs of an rbd-mirror pool "
+                          "replayer. If set to 0, only the per image "
+                          "rbd_deep_copy_concurrent_objects limit applies.")
+    .add_see_also("rbd_deep_copy_concurrent_objects")
+    .add_see_also("rbd_deep_copy_shared_bps_limit"),
+
+    Option("rbd_deep_copy_shared_bps_limit", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("the desired limit of bytes per second copied by all the deep copies of a client")
+    .set_long_description("Every object copy is charged a full object, so "
+                          "sparse objects are copied slower than the limit. "
+                          "If set to 0, the copy rate is not limited.")
+    .add_see_also("rbd_deep_copy_shared_concurrent_objects"),
+
     Option("rbd_balance_snap_reads", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description("distribute snap read requests to random OSD"),
@@ -7318,7 +8214,8 @@ static std::vector<Option> get_rbd_options() {
 
     Option("rbd_journal_object_max_in_flight_appends", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(0)
-    .set_description("maximum number of in-flight appends per journal object"),
+    .set_description("maximum number of in-flight appends per journal object")
+    .set_long_description("0 means unlimited, so every event is sent as soon as it is flushed. Otherwise the events recorded while this many appends are in flight are sent together once one completes, so the batches grow with the load and the OSD latency."),
 
     Option("rbd_journal_pool", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("")
@@ -7407,7 +8304,8 @@ static std::vector<Option> get_rbd_options() {
     Option("rbd_io_scheduler_simple_max_delay", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(0)
     .set_min(0)
-    .set_description("maximum io delay (in milliseconds) for simple io scheduler (if set to 0 dalay is calculated based on latency stats)"),
+    .set_description("maximum io delay (in milliseconds) for simple io scheduler (if set to 0 dalay is calculated based on latency stats)")
+    .set_long_description("If set to 0, writes are delayed by up to half the average latency of the recent writes, scaled down when only a few objects have writes in flight."),
   });
 }
 
@@ -7550,6 +8448,16 @@ static std::vector<Option> get_immutable_object_cache_options() {
     Option("immutable_object_cache_watermark", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(0.1)
     .set_description("immutable object cache water mark"),
+
+    Option("immutable_object_cache_max_pool_ratio", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(1.0)
+    .set_min_max(0.0, 1.0)
+    .set_description("fraction of the immutable object cache a single pool may use"),
+
+    Option("immutable_object_cache_promote_bps", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("immutable object cache promotion rate limit in bytes per second")
+    .set_long_description("Lookups that would start a promotion while the budget is used up are read from rados without being cached. 0 means unlimited."),
   });
 }
 
@@ -7606,6 +8514,12 @@ std::vector<Option> get_mds_options() {
     .set_default(16384)
     .set_description("number of directory entries to read in one RADOS operation"),
 
+    Option("mds_dir_prefetch_frags", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(4)
+    .set_min(0)
+    .set_description("number of following dirfrags to fetch along with the one a readdir is waiting for")
+    .set_long_description("When readdir has to fetch a fragment of a fragmented directory from RADOS, the fragments after it are fetched in parallel, so that listing a large directory after a failover does not load one fragment at a time."),
+
     Option("mds_decay_halflife", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(5)
     .set_description("rate of decay for temperature counters on each directory for balancing"),
@@ -7686,10 +8600,23 @@ std::vector<Option> get_mds_options() {
     .set_default(5)
     .set_description("minimum interval between scatter lock updates"),
 
+    Option("mds_scatter_nudge_max_per_tick", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1000)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("maximum number of dirty scatter locks flushed per tick (0 is unlimited)")
+    .set_long_description("Directories whose dirstat or rstat changes were not propagated right away are flushed to their parents on the MDS tick, deepest first.  This bounds how many of them are journaled in one tick; the rest wait for the next one.")
+    .add_see_also("mds_scatter_nudge_interval")
+    .add_see_also("mds_dirstat_min_interval"),
+
     Option("mds_client_prealloc_inos", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(1000)
     .set_description("number of unused inodes to pre-allocate to clients for file creation"),
 
+    Option("mds_client_delegate_inos", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(64)
+    .set_description("number of preallocated inode numbers delegated to a client")
+    .set_long_description("Clients that support it choose the inode numbers of the files they create from these, so the number is known before the MDS replies. At most half of mds_client_prealloc_inos are delegated. 0 disables delegation."),
+
     Option("mds_early_reply", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description("additional reply to clients that metadata requests are complete but not yet durable"),
@@ -7718,6 +8645,17 @@ std::vector<Option> get_mds_options() {
     .set_default(0)
     .set_description("size in bytes of each MDS log segment"),
 
+    Option("mds_log_stripe_count", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1)
+    .set_min(1)
+    .set_description("number of objects each MDS journal write is striped over")
+    .set_long_description("Only applies to journals created (or reformatted) after it is set. The stripe unit is the object size divided by this count, and is ignored unless it is a multiple of 64 KiB."),
+
+    Option("mds_log_group_commit_max_events", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(128)
+    .set_min(1)
+    .set_description("maximum number of queued events the MDS appends to the journal before flushing them together"),
+
     Option("mds_log_max_segments", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(128)
     .set_description("maximum number of segments which may be untrimmed"),
@@ -7794,7 +8732,19 @@ std::vector<Option> get_mds_options() {
 
     Option("mds_bal_mode", Option::TYPE_INT, Option::LEVEL_DEV)
     .set_default(0)
-    .set_description(""),
+    .set_description("how the balancer computes the load of a rank")
+    .set_long_description("0: mostly metadata popularity; 1: request rate and queue length; 2: CPU usage; 3: request rate times mean reply latency, plus CPU share and queue length."),
+
+    Option("mds_bal_import_cooldown", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(20)
+    .set_min(0)
+    .set_description("seconds an imported subtree is kept before the balancer may export it again")
+    .set_long_description("Stops subtrees from bouncing between ranks when their loads swing. 0 disables the cooldown."),
+
+    Option("mds_bal_max_export_entries", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("largest subtree (in recursive entries) the balancer exports in one piece")
+    .set_long_description("Bigger subtrees are searched for smaller pieces to export instead, because migrating them costs too much. 0 means no limit."),
 
     Option("mds_bal_min_rebalance", Option::TYPE_FLOAT, Option::LEVEL_DEV)
     .set_default(.1)
@@ -7872,6 +8822,11 @@ std::vector<Option> get_mds_options() {
     .set_default(0)
     .set_description(""),
 
+    Option("mds_oft_prefetch_by_dirfrag", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("load open file table inodes during rejoin by fetching their parent dirfrags")
+    .set_long_description("When the parent directory of an inode in the open file table is already cached, fetch the parent dirfrag once for all of its open children instead of looking up each inode by backtrace."),
+
     Option("mds_max_export_size", Option::TYPE_SIZE, Option::LEVEL_DEV)
     .set_default(20_M)
     .set_description(""),
@@ -7996,6 +8951,14 @@ std::vector<Option> get_mds_options() {
     .set_default(0.5)
     .set_description("number of parallel purge operations performed per PG"),
 
+    Option("mds_purge_op_latency_target", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0.5)
+    .set_min(0.0)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("purge op latency in seconds above which the purge queue backs off (0 disables)")
+    .set_long_description("While purge ops take longer than this, the purge queue lowers the number of ops it keeps in flight, and raises it again by one per purged item up to the limit from mds_max_purge_ops and mds_max_purge_ops_per_pg once they are faster.")
+    .add_see_also("mds_max_purge_ops_per_pg"),
+
     Option("mds_purge_queue_busy_flush_period", Option::TYPE_FLOAT, Option::LEVEL_DEV)
     .set_default(1.0)
     .set_description(""),
@@ -8012,6 +8975,18 @@ std::vector<Option> get_mds_options() {
     .set_default(5)
     .set_description("maximum number of scrub operations performed in parallel"),
 
+    Option("mds_scrub_pacing_max_ops_in_progress", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("most scrub operations performed in parallel while client latency allows")
+    .set_long_description("When this is above mds_max_scrub_ops_in_progress, the MDS raises its scrub concurrency by mds_max_scrub_ops_in_progress every tick, up to this value, while the average client reply latency stays under mds_scrub_pacing_client_latency, and halves it (but not below mds_max_scrub_ops_in_progress) while it does not.  Scrub then also works on several directories at once instead of finishing each one first.")
+    .add_see_also("mds_max_scrub_ops_in_progress")
+    .add_see_also("mds_scrub_pacing_client_latency"),
+
+    Option("mds_scrub_pacing_client_latency", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0.05)
+    .set_description("client reply latency (seconds) above which scrub backs off")
+    .add_see_also("mds_scrub_pacing_max_ops_in_progress"),
+
     Option("mds_damage_table_max_entries", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(10000)
     .set_description("maximum number of damage table entries"),
@@ -8050,6 +9025,16 @@ std::vector<Option> get_mds_options() {
      .set_default(5)
      .set_description("number of consecutive failed remount attempts for invalidating kernel dcache after which client would abort."),
 
+    Option("mds_cap_messages_per_batch", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+     .set_default(256)
+     .set_description("maximum number of cap grants and revokes sent to a client in one message")
+     .set_long_description("Cap messages generated for a client session while the MDS is busy are sent together as one message, to clients that support it. A value of 0 or 1 sends each cap message on its own."),
+
+    Option("mds_batch_getattr_lookup", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+     .set_default(true)
+     .set_description("answer identical concurrent getattr and lookup requests together")
+     .set_long_description("When several getattr (or lookup) requests with the same mask are in flight for the same inode (or dentry), only the first one traverses the path and acquires locks; the others are answered along with it."),
+
     Option("mds_dump_cache_threshold_formatter", Option::TYPE_SIZE, Option::LEVEL_DEV)
      .set_default(1_G)
      .set_description("threshold for cache usage to disallow \"dump cache\" operation to formatter")
@@ -8138,6 +9123,12 @@ std::vector<Option> get_mds_client_options() {
     .set_default(true)
     .set_description("show quota usage for statfs (df)"),
 
+    Option("client_async_io_threads", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(4)
+    .set_min(1)
+    .set_description("number of threads running ceph_ll_nonblocking_readv_writev() I/O")
+    .set_long_description("This is the number of asynchronous reads and writes that can be in flight at once."),
+
     Option("client_oc", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description("enable object caching"),
@@ -8299,6 +9290,11 @@ std::vector<Option> get_mds_client_options() {
     Option("crimson_debug_pg_always_active", Option::TYPE_BOOL, Option::LEVEL_DEV)
     .set_default(true)
     .set_description("remove me once crimson peering works"),
+
+    Option("crimson_cyanstore_journal", Option::TYPE_BOOL, Option::LEVEL_DEV)
+    .set_default(false)
+    .set_description("Log CyanStore transactions to a journal in osd_data")
+    .set_long_description("Each transaction is appended with direct I/O before it commits, and replayed over the last snapshot at mount, so the store survives a crash of crimson-osd."),
   });
 }
 
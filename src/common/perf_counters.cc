@@ -16,6 +16,9 @@
 #include "common/perf_counters.h"
 #include "common/dout.h"
 #include "common/valgrind.h"
+#include "include/buffer.h"
+#include "include/crc32c.h"
+#include "include/encoding.h"
 
 using std::ostringstream;
 
@@ -51,6 +54,7 @@ void PerfCountersCollectionImpl::add(PerfCounters *l)
 
     by_path[path] = {&data, l};
   }
+  update_schema_version();
 }
 
 void PerfCountersCollectionImpl::remove(PerfCounters *l)
@@ -68,6 +72,7 @@ void PerfCountersCollectionImpl::remove(PerfCounters *l)
   perf_counters_set_t::iterator i = m_loggers.find(l);
   ceph_assert(i != m_loggers.end());
   m_loggers.erase(i);
+  update_schema_version();
 }
 
 void PerfCountersCollectionImpl::clear()
@@ -80,6 +85,31 @@ void PerfCountersCollectionImpl::clear()
   }
 
   by_path.clear();
+  update_schema_version();
+}
+
+/**
+ * Derive the version from the schema itself rather than counting changes,
+ * so that a daemon that restarts with other counters can't come back with
+ * the version a poller already holds the schema of.  The number of
+ * counters goes in the upper half, a crc32c of their names and types in
+ * the lower one.
+ */
+void PerfCountersCollectionImpl::update_schema_version()
+{
+  uint32_t crc = -1;
+  uint32_t n = 0;
+  for (auto& [path, ref] : by_path) {
+    if (ref.data->type & PERFCOUNTER_HISTOGRAM) {
+      continue;
+    }
+    crc = ceph_crc32c(crc, (const unsigned char*)path.c_str(),
+		      path.size() + 1);
+    uint32_t type = ref.data->type;
+    crc = ceph_crc32c(crc, (const unsigned char*)&type, sizeof(type));
+    ++n;
+  }
+  m_schema_version = ((uint64_t)n << 32) | crc;
 }
 
 bool PerfCountersCollectionImpl::reset(const std::string &name)
@@ -146,8 +176,115 @@ void PerfCountersCollectionImpl::with_counters(std::function<void(
   fn(by_path);
 }
 
+void PerfCountersCollectionImpl::dump_binary_schema(Formatter *f) const
+{
+  f->open_object_section("perf_binary_schema");
+  f->dump_unsigned("version", m_schema_version);
+  f->open_array_section("counters");
+  for (auto& [path, ref] : by_path) {
+    if (ref.data->type & PERFCOUNTER_HISTOGRAM) {
+      continue;
+    }
+    f->open_object_section("counter");
+    f->dump_string("name", path);
+    f->dump_unsigned("type", ref.data->type);
+    f->dump_unsigned("values",
+		     (ref.data->type & PERFCOUNTER_LONGRUNAVG) ? 2 : 1);
+    f->close_section();
+  }
+  f->close_section();
+  f->close_section();
+}
+
+/// unsigned LEB128, so that the many small or zero counters take a byte
+static void append_varint(bufferlist& bl, uint64_t v)
+{
+  char buf[10];
+  unsigned n = 0;
+  do {
+    uint8_t b = v & 0x7f;
+    v >>= 7;
+    if (v) {
+      b |= 0x80;
+    }
+    buf[n++] = b;
+  } while (v);
+  bl.append(buf, n);
+}
+
+/**
+ * Layout: the schema version (le64), the number of counters (le32), then
+ * for each counter of the schema its value, or its sum and count if it is
+ * a long running average, as varints.  Time counters are in nanoseconds.
+ */
+void PerfCountersCollectionImpl::encode_binary(bufferlist& bl) const
+{
+  using ceph::encode;
+  encode(m_schema_version, bl);
+  uint32_t n = 0;
+  for (auto& i : by_path) {
+    if (!(i.second.data->type & PERFCOUNTER_HISTOGRAM)) {
+      ++n;
+    }
+  }
+  encode(n, bl);
+  for (auto& [path, ref] : by_path) {
+    const auto& data = *ref.data;
+    if (data.type & PERFCOUNTER_HISTOGRAM) {
+      continue;
+    }
+    if (data.type & PERFCOUNTER_LONGRUNAVG) {
+      auto a = data.read_avg();
+      append_varint(bl, a.first);
+      append_varint(bl, a.second);
+    } else {
+      append_varint(bl, data.read_u64());
+    }
+  }
+}
+
 // ---------------------------
 
+/// the shard of the calling thread, for sharded counters
+static unsigned perf_shard()
+{
+  static std::atomic<unsigned> next_shard = { 0 };
+  thread_local unsigned shard = next_shard++ % PerfCounters::SHARDS;
+  return shard;
+}
+
+/// add to a counter, which is sharded or not
+static void add_to(PerfCounters::perf_counter_data_any_d& data, uint64_t amt)
+{
+  auto [u64, avgcount, avgcount2] = [&data] {
+    if (data.shards) {
+      auto& s = data.shards[perf_shard()];
+      return std::tie(s.u64, s.avgcount, s.avgcount2);
+    }
+    return std::tie(data.u64, data.avgcount, data.avgcount2);
+  }();
+  if (data.type & PERFCOUNTER_LONGRUNAVG) {
+    avgcount++;
+    u64 += amt;
+    avgcount2++;
+  } else {
+    u64 += amt;
+  }
+}
+
+/// overwrite a counter; a sharded one keeps the value in its first shard
+static void store_to(PerfCounters::perf_counter_data_any_d& data, uint64_t v)
+{
+  if (!data.shards) {
+    data.u64 = v;
+    return;
+  }
+  data.shards[0].u64 = v;
+  for (unsigned i = 1; i < PerfCounters::SHARDS; i++) {
+    data.shards[i].u64 = 0;
+  }
+}
+
 PerfCounters::~PerfCounters()
 {
 }
@@ -164,13 +301,7 @@ void PerfCounters::inc(int idx, uint64_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_U64))
     return;
-  if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount++;
-    data.u64 += amt;
-    data.avgcount2++;
-  } else {
-    data.u64 += amt;
-  }
+  add_to(data, amt);
 }
 
 void PerfCounters::dec(int idx, uint64_t amt)
@@ -186,7 +317,12 @@ void PerfCounters::dec(int idx, uint64_t amt)
   ceph_assert(!(data.type & PERFCOUNTER_LONGRUNAVG));
   if (!(data.type & PERFCOUNTER_U64))
     return;
-  data.u64 -= amt;
+  if (data.shards) {
+    // the shards wrap around, their sum does not
+    data.shards[perf_shard()].u64 -= amt;
+  } else {
+    data.u64 -= amt;
+  }
 }
 
 void PerfCounters::set(int idx, uint64_t amt)
@@ -205,11 +341,12 @@ void PerfCounters::set(int idx, uint64_t amt)
   ANNOTATE_BENIGN_RACE_SIZED(&data.u64, sizeof(data.u64),
                              "perf counter atomic");
   if (data.type & PERFCOUNTER_LONGRUNAVG) {
+    ceph_assert(!data.shards);
     data.avgcount++;
     data.u64 = amt;
     data.avgcount2++;
   } else {
-    data.u64 = amt;
+    store_to(data, amt);
   }
 }
 
@@ -225,7 +362,7 @@ uint64_t PerfCounters::get(int idx) const
   const perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_U64))
     return 0;
-  return data.u64;
+  return data.read_u64();
 }
 
 void PerfCounters::tinc(int idx, utime_t amt)
@@ -240,13 +377,7 @@ void PerfCounters::tinc(int idx, utime_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
-  if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount++;
-    data.u64 += amt.to_nsec();
-    data.avgcount2++;
-  } else {
-    data.u64 += amt.to_nsec();
-  }
+  add_to(data, amt.to_nsec());
 }
 
 void PerfCounters::tinc(int idx, ceph::timespan amt)
@@ -261,13 +392,7 @@ void PerfCounters::tinc(int idx, ceph::timespan amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
-  if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount++;
-    data.u64 += amt.count();
-    data.avgcount2++;
-  } else {
-    data.u64 += amt.count();
-  }
+  add_to(data, amt.count());
 }
 
 void PerfCounters::tset(int idx, utime_t amt)
@@ -282,7 +407,7 @@ void PerfCounters::tset(int idx, utime_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
-  data.u64 = amt.to_nsec();
+  store_to(data, amt.to_nsec());
   if (data.type & PERFCOUNTER_LONGRUNAVG)
     ceph_abort();
 }
@@ -299,7 +424,7 @@ utime_t PerfCounters::tget(int idx) const
   const perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return utime_t();
-  uint64_t v = data.u64;
+  uint64_t v = data.read_u64();
   return utime_t(v / 1000000000ull, v % 1000000000ull);
 }
 
@@ -317,7 +442,11 @@ void PerfCounters::hinc(int idx, int64_t x, int64_t y)
   ceph_assert(data.type == (PERFCOUNTER_HISTOGRAM | PERFCOUNTER_COUNTER | PERFCOUNTER_U64));
   ceph_assert(data.histogram);
 
-  data.histogram->inc(x, y);
+  if (auto shard = data.histogram_shards.empty() ? 0 : perf_shard(); shard) {
+    data.histogram_shards[shard - 1]->inc(x, y);
+  } else {
+    data.histogram->inc(x, y);
+  }
 }
 
 pair<uint64_t, uint64_t> PerfCounters::get_tavg_ns(int idx) const
@@ -444,10 +573,14 @@ void PerfCounters::dump_formatted_generic(Formatter *f, bool schema,
         ceph_assert(d->type == (PERFCOUNTER_HISTOGRAM | PERFCOUNTER_COUNTER | PERFCOUNTER_U64));
         ceph_assert(d->histogram);
         f->open_object_section(d->name);
-        d->histogram->dump_formatted(f);
+        if (d->histogram_shards.empty()) {
+          d->histogram->dump_formatted(f);
+        } else {
+          d->read_histogram()->dump_formatted(f);
+        }
         f->close_section();
       } else {
-	uint64_t v = d->u64;
+	uint64_t v = d->read_u64();
 	if (d->type & PERFCOUNTER_U64) {
 	  f->dump_unsigned(d->name, v);
 	} else if (d->type & PERFCOUNTER_TIME) {
@@ -567,6 +700,15 @@ void PerfCountersBuilder::add_impl(
   data.type = (enum perfcounter_type_d)ty;
   data.unit = (enum unit_t) unit;
   data.histogram = std::move(histogram);
+  if (sharded) {
+    data.shards.reset(new PerfCounters::shard_t[PerfCounters::SHARDS]);
+    if (data.histogram) {
+      for (unsigned i = 1; i < PerfCounters::SHARDS; i++) {
+        data.histogram_shards.emplace_back(
+          std::make_unique<PerfHistogram<>>(*data.histogram));
+      }
+    }
+  }
 }
 
 PerfCounters *PerfCountersBuilder::create_perf_counters()
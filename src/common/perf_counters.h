@@ -109,6 +109,13 @@ public:
     prio_default = prio_;
   }
 
+  /// spread the updates of the counters added from now on over
+  /// PerfCounters::SHARDS cache lines, and sum them up only when read
+  void set_sharded(bool s)
+  {
+    sharded = s;
+  }
+
   PerfCounters* create_perf_counters();
 private:
   PerfCountersBuilder(const PerfCountersBuilder &rhs);
@@ -120,6 +127,7 @@ private:
   PerfCounters *m_perf_counters;
 
   int prio_default = 0;
+  bool sharded = false;
 };
 
 /*
@@ -150,6 +158,16 @@ private:
 class PerfCounters
 {
 public:
+  /// the number of slots a sharded counter is split into; threads are
+  /// assigned to them round robin
+  static constexpr unsigned SHARDS = 16;
+
+  struct alignas(64) shard_t {
+    std::atomic<uint64_t> u64 = { 0 };
+    std::atomic<uint64_t> avgcount = { 0 };
+    std::atomic<uint64_t> avgcount2 = { 0 };
+  };
+
   /** Represents a PerfCounters data element. */
   struct perf_counter_data_any_d {
     perf_counter_data_any_d()
@@ -165,13 +183,13 @@ public:
         nick(other.nick),
 	 type(other.type),
 	 unit(other.unit),
-	 u64(other.u64.load()) {
+	 u64(other.read_u64()) {
       auto a = other.read_avg();
       u64 = a.first;
       avgcount = a.second;
       avgcount2 = a.second;
       if (other.histogram) {
-        histogram.reset(new PerfHistogram<>(*other.histogram));
+        histogram = other.read_histogram();
       }
     }
 
@@ -185,6 +203,10 @@ public:
     std::atomic<uint64_t> avgcount = { 0 };
     std::atomic<uint64_t> avgcount2 = { 0 };
     std::unique_ptr<PerfHistogram<>> histogram;
+    /// set for sharded counters, which then leave u64 and avgcount alone
+    std::unique_ptr<shard_t[]> shards;
+    /// the other SHARDS - 1 slots of a sharded histogram
+    std::vector<std::unique_ptr<PerfHistogram<>>> histogram_shards;
 
     void reset()
     {
@@ -192,16 +214,64 @@ public:
 	    u64 = 0;
 	    avgcount = 0;
 	    avgcount2 = 0;
+	    if (shards) {
+	      for (unsigned i = 0; i < SHARDS; i++) {
+		shards[i].u64 = 0;
+		shards[i].avgcount = 0;
+		shards[i].avgcount2 = 0;
+	      }
+	    }
       }
       if (histogram) {
         histogram->reset();
       }
+      for (auto& h : histogram_shards) {
+        h->reset();
+      }
+    }
+
+    uint64_t read_u64() const {
+      if (!shards) {
+	return u64;
+      }
+      uint64_t sum = 0;
+      for (unsigned i = 0; i < SHARDS; i++) {
+	sum += shards[i].u64;
+      }
+      return sum;
     }
 
     // read <sum, count> safely by making sure the post- and pre-count
     // are identical; in other words the whole loop needs to be run
     // without any intervening calls to inc, set, or tinc.
     std::pair<uint64_t,uint64_t> read_avg() const {
+      if (shards) {
+	// each shard is consistent on its own
+	uint64_t sum = 0, count = 0;
+	for (unsigned i = 0; i < SHARDS; i++) {
+	  auto a = read_avg(shards[i].u64, shards[i].avgcount,
+			    shards[i].avgcount2);
+	  sum += a.first;
+	  count += a.second;
+	}
+	return { sum, count };
+      }
+      return read_avg(u64, avgcount, avgcount2);
+    }
+
+    std::unique_ptr<PerfHistogram<>> read_histogram() const {
+      auto h = std::make_unique<PerfHistogram<>>(*histogram);
+      for (auto& s : histogram_shards) {
+	h->merge(*s);
+      }
+      return h;
+    }
+
+  private:
+    static std::pair<uint64_t,uint64_t> read_avg(
+      const std::atomic<uint64_t>& u64,
+      const std::atomic<uint64_t>& avgcount,
+      const std::atomic<uint64_t>& avgcount2) {
       uint64_t sum, count;
       do {
 	count = avgcount2;
@@ -345,14 +415,25 @@ public:
 
   void with_counters(std::function<void(const CounterMap &)>) const;
 
+  /**
+   * Compact form of the non-histogram counters, for frequent polling.
+   * The schema lists the counters in the order encode_binary() emits them,
+   * along with a version derived from the counters, so that it changes
+   * whenever counters come or go, in this process or across restarts.
+   */
+  void dump_binary_schema(ceph::Formatter *f) const;
+  void encode_binary(ceph::bufferlist& bl) const;
+
 private:
   void dump_formatted_generic(ceph::Formatter *f, bool schema, bool histograms,
                               const std::string &logger = "",
                               const std::string &counter = "") const;
+  void update_schema_version();
 
   perf_counters_set_t m_loggers;
 
   CounterMap by_path; 
+  uint64_t m_schema_version = 0;
 };
 
 
@@ -51,6 +51,16 @@ void PerfCountersCollection::with_counters(std::function<void(const PerfCounters
   std::lock_guard lck(m_lock);
   perf_impl.with_counters(fn);
 }
+void PerfCountersCollection::dump_binary_schema(ceph::Formatter *f) const
+{
+  std::lock_guard lck(m_lock);
+  perf_impl.dump_binary_schema(f);
+}
+void PerfCountersCollection::encode_binary(ceph::bufferlist& bl) const
+{
+  std::lock_guard lck(m_lock);
+  perf_impl.encode_binary(bl);
+}
 void PerfCountersDeleter::operator()(PerfCounters* p) noexcept
 {
   if (cct)
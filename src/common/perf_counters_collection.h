@@ -29,6 +29,9 @@ public:
 
   void with_counters(std::function<void(const PerfCountersCollectionImpl::CounterMap &)>) const;
 
+  void dump_binary_schema(ceph::Formatter *f) const;
+  void encode_binary(ceph::bufferlist& bl) const;
+
   friend class PerfCountersCollectionTest;
 };
 
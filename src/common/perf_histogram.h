@@ -99,6 +99,14 @@ public:
     }
   }
 
+  /// Add the counts of a histogram with the same axes
+  void merge(const PerfHistogram &other) {
+    auto size = get_raw_size();
+    for (int64_t i = 0; i < size; i++) {
+      m_rawData[i] += other.m_rawData[i].load();
+    }
+  }
+
   /// Set all histogram values to 0
   void reset() {
     auto size = get_raw_size();
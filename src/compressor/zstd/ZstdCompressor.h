@@ -18,6 +18,8 @@
 #define ZSTD_STATIC_LINKING_ONLY
 #include "zstd/lib/zstd.h"
 
+#include <memory>
+
 #include "include/buffer.h"
 #include "include/encoding.h"
 #include "compressor/Compressor.h"
@@ -25,11 +27,32 @@
 #define COMPRESSION_LEVEL 5
 
 class ZstdCompressor : public Compressor {
+  // creating a stream allocates and initializes its tables, which costs
+  // more than compressing a small blob does, so each thread keeps one of
+  // each kind and resets it for every call
+  struct CStreamDeleter {
+    void operator()(ZSTD_CStream *s) { ZSTD_freeCStream(s); }
+  };
+  struct DStreamDeleter {
+    void operator()(ZSTD_DStream *s) { ZSTD_freeDStream(s); }
+  };
+
+  static ZSTD_CStream *get_cstream() {
+    thread_local std::unique_ptr<ZSTD_CStream, CStreamDeleter> s{
+      ZSTD_createCStream()};
+    return s.get();
+  }
+  static ZSTD_DStream *get_dstream() {
+    thread_local std::unique_ptr<ZSTD_DStream, DStreamDeleter> s{
+      ZSTD_createDStream()};
+    return s.get();
+  }
+
  public:
   ZstdCompressor() : Compressor(COMP_ALG_ZSTD, "zstd") {}
 
   int compress(const bufferlist &src, bufferlist &dst) override {
-    ZSTD_CStream *s = ZSTD_createCStream();
+    ZSTD_CStream *s = get_cstream();
     ZSTD_initCStream_srcSize(s, COMPRESSION_LEVEL, src.length());
     auto p = src.begin();
     size_t left = src.length();
@@ -55,8 +78,6 @@ class ZstdCompressor : public Compressor {
     }
     ceph_assert(p.end());
 
-    ZSTD_freeCStream(s);
-
     // prefix with decompressed length
     encode((uint32_t)src.length(), dst);
     dst.append(outptr, 0, outbuf.pos);
@@ -83,7 +104,7 @@ class ZstdCompressor : public Compressor {
     outbuf.dst = dstptr.c_str();
     outbuf.size = dstptr.length();
     outbuf.pos = 0;
-    ZSTD_DStream *s = ZSTD_createDStream();
+    ZSTD_DStream *s = get_dstream();
     ZSTD_initDStream(s);
     while (compressed_len > 0) {
       if (p.end()) {
@@ -96,7 +117,6 @@ class ZstdCompressor : public Compressor {
       ZSTD_decompressStream(s, &outbuf, &inbuf);
       compressed_len -= inbuf.size;
     }
-    ZSTD_freeDStream(s);
 
     dst.append(dstptr, 0, outbuf.pos);
     return 0;
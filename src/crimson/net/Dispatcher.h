@@ -31,6 +31,14 @@ class Dispatcher {
     return seastar::make_ready_future<>();
   }
 
+  // the shard whose dispatcher should handle this message. The connection
+  // stays on its own shard; the message is handed over without copying, so
+  // a remote ms_dispatch() must be done with it once its future resolves.
+  virtual seastar::shard_id ms_dispatch_shard(const Connection& conn,
+                                              const Message& m) const {
+    return seastar::engine().cpu_id();
+  }
+
   virtual seastar::future<> ms_handle_accept(ConnectionRef conn) {
     return seastar::make_ready_future<>();
   }
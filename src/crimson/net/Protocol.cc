@@ -31,6 +31,24 @@ Protocol::~Protocol()
   ceph_assert(pending_dispatch.is_closed());
 }
 
+seastar::future<> Protocol::dispatch(MessageRef msg)
+{
+  auto target = dispatcher.ms_dispatch_shard(conn, *msg);
+  if (target == seastar::engine().cpu_id()) {
+    return dispatcher.ms_dispatch(&conn, std::move(msg));
+  }
+  // the refcounts of Connection and Message are not atomic in seastar
+  // builds, so both travel as foreign_ptr and are released back here
+  return seastar::smp::submit_to(target,
+    [&dispatcher = dispatcher,
+     conn = seastar::make_foreign(conn.shared_from_this()),
+     msg = seastar::make_foreign(std::move(msg))] () mutable {
+      auto local = dispatcher.get_local_shard();
+      return local->ms_dispatch(conn.get(), MessageRef{msg.get().get()})
+        .finally([conn = std::move(conn), msg = std::move(msg)] {});
+    });
+}
+
 bool Protocol::is_connected() const
 {
   return write_state == write_state_t::open;
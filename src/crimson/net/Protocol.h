@@ -40,6 +40,9 @@ class Protocol {
 
   virtual void trigger_close() = 0;
 
+  // hand a received message to the dispatcher, on the shard it asks for
+  seastar::future<> dispatch(MessageRef msg);
+
   virtual ceph::bufferlist do_sweep_messages(
       const std::deque<MessageRef>& msgs,
       size_t num_msgs,
@@ -57,9 +57,11 @@ seastar::future<bool> SocketConnection::is_connected()
 seastar::future<> SocketConnection::send(MessageRef msg)
 {
   logger().debug("{} --> {} === {}", messenger, get_peer_addr(), *msg);
-  // Cannot send msg from another core now, its ref counter can be contaminated!
-  ceph_assert(seastar::engine().cpu_id() == shard_id());
-  return seastar::smp::submit_to(shard_id(), [this, msg=std::move(msg)] {
+  // the ref counter is not atomic, so a message sent from another core,
+  // e.g. a reply from a remote ms_dispatch(), must be handed over whole
+  ceph_assert(seastar::engine().cpu_id() == shard_id() ||
+              msg->get_nref() == 1);
+  return seastar::smp::submit_to(shard_id(), [this, msg=std::move(msg)] () mutable {
     return protocol->send(std::move(msg));
   });
 }
@@ -0,0 +1,140 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "cyan_journal.h"
+
+#include <fmt/format.h>
+#include <seastar/core/do_with.hh>
+#include <seastar/core/reactor.hh>
+
+#include "include/byteorder.h"
+#include "include/crc32c.h"
+#include "include/intarith.h"
+#include "crimson/common/log.h"
+
+namespace {
+  seastar::logger& logger() {
+    return ceph::get_logger(ceph_subsys_filestore);
+  }
+
+  constexpr uint32_t JOURNAL_MAGIC = 0x6379616e;  // "cyan"
+
+  struct record_header_t {
+    ceph_le32 magic;
+    ceph_le32 crc;      ///< crc32c of the payload
+    ceph_le64 seq;
+    ceph_le64 len;      ///< payload length, excluding the padding
+  } __attribute__ ((packed));
+}
+
+namespace ceph::os {
+
+CyanJournal::CyanJournal(const std::string& fn)
+  : fn{fn}
+{}
+
+seastar::future<> CyanJournal::replay(uint64_t from_seq, replay_func_t&& f)
+{
+  seq = from_seq;
+  const auto flags = seastar::open_flags::rw | seastar::open_flags::create;
+  return seastar::open_file_dma(fn, flags).then([this] (seastar::file f) {
+    file = std::move(f);
+    return file.size();
+  }).then([this] (uint64_t size) {
+    if (size == 0) {
+      return seastar::make_ready_future<seastar::temporary_buffer<char>>();
+    }
+    return file.dma_read_bulk<char>(0, size);
+  }).then([from_seq, f=std::move(f), this]
+	  (seastar::temporary_buffer<char> buf) {
+    const uint64_t align = file.disk_write_dma_alignment();
+    uint64_t pos = 0;
+    unsigned replayed = 0;
+    while (pos + sizeof(record_header_t) <= buf.size()) {
+      record_header_t h;
+      memcpy(&h, buf.get() + pos, sizeof(h));
+      const uint64_t len = h.len;
+      if (h.magic != JOURNAL_MAGIC ||
+	  pos + sizeof(h) + len > buf.size()) {
+	break;
+      }
+      auto p = reinterpret_cast<const unsigned char*>(buf.get() + pos + sizeof(h));
+      if (ceph_crc32c(-1, p, len) != h.crc) {
+	logger().warn("{} bad crc at {}, discarding the tail", fn, pos);
+	break;
+      }
+      // records older than from_seq are already in the snapshot
+      if (h.seq >= from_seq) {
+	if (h.seq != seq) {
+	  break;
+	}
+	ceph::bufferlist bl;
+	bl.append(reinterpret_cast<const char*>(p), len);
+	f(std::move(bl));
+	seq++;
+	replayed++;
+      }
+      pos = p2roundup(pos + sizeof(h) + len, align);
+    }
+    logger().info("{} replayed {} records, next seq {}", fn, replayed, seq);
+    write_pos = pos;
+    // so a stale record past a torn one is never mistaken for a new one
+    return file.truncate(write_pos);
+  });
+}
+
+seastar::future<> CyanJournal::append(ceph::bufferlist&& bl)
+{
+  return seastar::with_semaphore(write_lock, 1, [bl=std::move(bl), this] {
+    record_header_t h;
+    h.magic = JOURNAL_MAGIC;
+    h.crc = bl.crc32c(-1);
+    h.seq = seq++;
+    h.len = bl.length();
+    const uint64_t len = p2roundup<uint64_t>(sizeof(h) + bl.length(),
+					     file.disk_write_dma_alignment());
+    auto buf = seastar::temporary_buffer<char>::aligned(
+      file.memory_dma_alignment(), len);
+    char* p = buf.get_write();
+    memcpy(p, &h, sizeof(h));
+    bl.begin().copy(bl.length(), p + sizeof(h));
+    memset(p + sizeof(h) + bl.length(), 0, len - sizeof(h) - bl.length());
+    const uint64_t pos = write_pos;
+    write_pos += len;
+    return seastar::do_with(std::move(buf), [pos, this] (auto& buf) {
+      return file.dma_write(pos, buf.get(), buf.size())
+	.then([&buf, this] (size_t written) {
+	  if (written != buf.size()) {
+	    throw std::runtime_error(fmt::format("{}: short write", fn));
+	  }
+	  return file.flush();
+	});
+    });
+  });
+}
+
+seastar::future<uint64_t> CyanJournal::sync()
+{
+  return seastar::with_semaphore(write_lock, 1, [this] {
+    return seq;
+  });
+}
+
+seastar::future<> CyanJournal::reset()
+{
+  return seastar::with_semaphore(write_lock, 1, [this] {
+    write_pos = 0;
+    return file.truncate(0).then([this] {
+      return file.flush();
+    });
+  });
+}
+
+seastar::future<> CyanJournal::close()
+{
+  return seastar::with_semaphore(write_lock, 1, [this] {
+    return file.close();
+  });
+}
+
+}
@@ -0,0 +1,49 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include <seastar/core/file.hh>
+#include <seastar/core/future.hh>
+#include <seastar/core/semaphore.hh>
+
+#include "include/buffer.h"
+
+namespace ceph::os {
+
+/**
+ * an append-only log of encoded transactions
+ *
+ * Records are written with O_DIRECT through seastar's DMA file API, each
+ * one starting on a write-alignment boundary, and appended in the order
+ * append() is called. A record is durable once the returned future
+ * resolves; replay() stops at the first torn or corrupt record.
+ */
+class CyanJournal {
+public:
+  using replay_func_t = std::function<void(ceph::bufferlist&&)>;
+
+  explicit CyanJournal(const std::string& fn);
+
+  /// open the log, feeding every record with seq >= from_seq to f
+  seastar::future<> replay(uint64_t from_seq, replay_func_t&& f);
+  seastar::future<> append(ceph::bufferlist&& bl);
+  /// wait for the appends issued so far, @return the seq of the next one
+  seastar::future<uint64_t> sync();
+  /// drop all records, once their effects are persisted elsewhere
+  seastar::future<> reset();
+  seastar::future<> close();
+
+private:
+  const std::string fn;
+  seastar::file file;
+  // keeps the records in submission order
+  seastar::semaphore write_lock{1};
+  uint64_t write_pos = 0;
+  uint64_t seq = 0;
+};
+
+}
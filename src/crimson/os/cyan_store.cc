@@ -2,10 +2,13 @@
 
 #include <fmt/format.h>
 #include <fmt/ostream.h>
+#include <seastar/core/reactor.hh>
 
 #include "common/safe_io.h"
 #include "crimson/common/buffer_io.h"
+#include "crimson/common/config_proxy.h"
 #include "crimson/os/cyan_collection.h"
+#include "crimson/os/cyan_journal.h"
 #include "crimson/os/cyan_object.h"
 #include "os/Transaction.h"
 
@@ -21,11 +24,56 @@ using ObjectRef = boost::intrusive_ptr<Object>;
 
 CyanStore::CyanStore(const std::string& path)
   : path{path}
-{}
+{
+  if (ceph::common::local_conf().get_val<bool>("crimson_cyanstore_journal")) {
+    journal = std::make_unique<CyanJournal>(path + "/journal");
+  }
+}
 
 CyanStore::~CyanStore() = default;
 
 seastar::future<> CyanStore::mount()
+{
+  ceph::bufferlist bl;
+  std::string err;
+  uint64_t from_seq = 0;
+  if (int r = bl.read_file((path + "/snapshot").c_str(), &err); r == 0) {
+    auto p = bl.cbegin();
+    DECODE_START(1, p);
+    ceph::decode(from_seq, p);
+    uint32_t n;
+    ceph::decode(n, p);
+    while (n--) {
+      coll_t coll;
+      ceph::decode(coll, p);
+      CollectionRef c{new Collection{coll}};
+      c->decode(p);
+      coll_map[coll] = c;
+      used_bytes += c->used_bytes();
+    }
+    DECODE_FINISH(p);
+  } else if (r == -ENOENT) {
+    // a store which was never unmounted since mkfs, or one written before
+    // snapshots went into a single file
+    load_collections();
+    if (std::string seq; read_meta("journal_seq", &seq) == 0) {
+      from_seq = std::stoull(seq);
+    }
+  } else {
+    throw std::runtime_error("read_file");
+  }
+  if (!journal) {
+    return seastar::now();
+  }
+  return journal->replay(from_seq, [this] (ceph::bufferlist&& bl) {
+    Transaction t;
+    auto p = bl.cbegin();
+    t.decode(p);
+    apply_transaction(t);
+  });
+}
+
+void CyanStore::load_collections()
 {
   ceph::bufferlist bl;
   std::string fn = path + "/collections";
@@ -50,26 +98,43 @@ seastar::future<> CyanStore::mount()
     coll_map[coll] = c;
     used_bytes += c->used_bytes();
   }
-  return seastar::now();
 }
 
 seastar::future<> CyanStore::umount()
 {
-  return seastar::do_with(std::set<coll_t>{}, [this](auto& collections) {
-    return seastar::do_for_each(coll_map, [&collections, this](auto& coll) {
-      auto& [col, ch] = coll;
-      collections.insert(col);
-      ceph::bufferlist bl;
-      ceph_assert(ch);
-      ch->encode(bl);
-      std::string fn = fmt::format("{}/{}", path, col);
-      return ceph::buffer::write_file(std::move(bl), fn);
-    }).then([&collections, this] {
-      ceph::bufferlist bl;
-      ceph::encode(collections, bl);
-      std::string fn = fmt::format("{}/collections", path);
-      return ceph::buffer::write_file(std::move(bl), fn);
+  return (journal ? journal->sync() : seastar::make_ready_future<uint64_t>(0))
+    .then([this] (uint64_t seq) {
+      return write_snapshot(seq).then([this] {
+	if (!journal) {
+	  return seastar::now();
+	}
+	return journal->reset().then([this] {
+	  return journal->close();
+	});
+      });
     });
+}
+
+seastar::future<> CyanStore::write_snapshot(uint64_t seq)
+{
+  // the journal position and every collection go into one file which
+  // replaces the old one by rename, so that a crash leaves either
+  // snapshot whole and the journal records after it
+  ceph::bufferlist bl;
+  ENCODE_START(1, 1, bl);
+  ceph::encode(seq, bl);
+  ceph::encode(static_cast<uint32_t>(coll_map.size()), bl);
+  for (auto& [col, ch] : coll_map) {
+    ceph_assert(ch);
+    ceph::encode(col, bl);
+    ch->encode(bl);
+  }
+  ENCODE_FINISH(bl);
+  std::string tmp = path + "/snapshot.tmp";
+  return ceph::buffer::write_file(std::move(bl), tmp).then([tmp, this] {
+    return seastar::rename_file(tmp, path + "/snapshot");
+  }).then([this] {
+    return seastar::sync_directory(path);
   });
 }
 
@@ -89,13 +154,14 @@ seastar::future<> CyanStore::mkfs()
     }
   }
 
-  std::string fn = path + "/collections";
-  ceph::bufferlist bl;
-  std::set<coll_t> collections;
-  ceph::encode(collections, bl);
-  return ceph::buffer::write_file(std::move(bl), fn).then([this] {
+  // also replaces the snapshot of any store which lived here before
+  return write_snapshot(0).then([this] {
     write_meta("type", "memstore");
-    return seastar::now();
+    if (!journal) {
+      return seastar::now();
+    }
+    // drop the records of any store which lived here before
+    return ceph::buffer::write_file({}, path + "/journal");
   });
 }
 
@@ -252,6 +318,34 @@ CyanStore::omap_get_values(
 
 seastar::future<> CyanStore::do_transaction(CollectionRef ch,
                                             Transaction&& t)
+{
+  ceph::bufferlist bl;
+  if (journal) {
+    t.encode(bl);
+  }
+  apply_transaction(t);
+  for (auto i : {
+      t.get_on_applied(),
+      t.get_on_applied_sync()}) {
+    if (i) {
+      i->complete(0);
+    }
+  }
+  auto on_commit = t.get_on_commit();
+  if (!journal) {
+    if (on_commit) {
+      on_commit->complete(0);
+    }
+    return seastar::now();
+  }
+  return journal->append(std::move(bl)).then([on_commit] {
+    if (on_commit) {
+      on_commit->complete(0);
+    }
+  });
+}
+
+void CyanStore::apply_transaction(Transaction& t)
 {
   int r = 0;
   try {
@@ -384,15 +478,6 @@ seastar::future<> CyanStore::do_transaction(CollectionRef ch,
     logger().error("{}", str.str());
     ceph_assert(r == 0);
   }
-  for (auto i : {
-      t.get_on_applied(),
-      t.get_on_commit(),
-      t.get_on_applied_sync()}) {
-    if (i) {
-      i->complete(0);
-    }
-  }
-  return seastar::now();
 }
 
 int CyanStore::_remove(const coll_t& cid, const ghobject_t& oid)
@@ -565,11 +650,15 @@ int CyanStore::_create_collection(const coll_t& cid, int bits)
   auto result = coll_map.insert(std::make_pair(cid, CollectionRef()));
   if (!result.second)
     return -EEXIST;
-  auto p = new_coll_map.find(cid);
-  assert(p != new_coll_map.end());
-  result.first->second = p->second;
+  if (auto p = new_coll_map.find(cid); p != new_coll_map.end()) {
+    result.first->second = p->second;
+    new_coll_map.erase(p);
+  } else {
+    // replaying the journal, nobody called create_new_collection()
+    assert(journal);
+    result.first->second = new Collection{cid};
+  }
   result.first->second->bits = bits;
-  new_coll_map.erase(p);
   return 0;
 }
 
@@ -21,6 +21,7 @@
 namespace ceph::os {
 
 class Collection;
+class CyanJournal;
 class Transaction;
 
 // a just-enough store for reading/writing the superblock
@@ -32,6 +33,9 @@ class CyanStore final : public FuturizedStore {
   std::map<coll_t,CollectionRef> new_coll_map;
   uint64_t used_bytes = 0;
   uuid_d osd_fsid;
+  // present if crimson_cyanstore_journal is set: transactions are logged
+  // before they commit, and replayed over the last snapshot at mount
+  std::unique_ptr<CyanJournal> journal;
 
 public:
 
@@ -84,6 +88,11 @@ public:
   uuid_d get_fsid() const final;
 
 private:
+  /// read the collections the way umount() wrote them before snapshots
+  void load_collections();
+  /// persist every collection, as of journal record seq
+  seastar::future<> write_snapshot(uint64_t seq);
+  void apply_transaction(Transaction& t);
   int _remove(const coll_t& cid, const ghobject_t& oid);
   int _touch(const coll_t& cid, const ghobject_t& oid);
   int _write(const coll_t& cid, const ghobject_t& oid,
@@ -0,0 +1,80 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include <unordered_map>
+#include <seastar/core/future.hh>
+#include <seastar/core/shared_future.hh>
+
+/// One stage of the op pipeline. Ops with the same key go through it one
+/// at a time, in the order they entered it, while ops with different keys
+/// do not wait for each other. Keying by connection keeps a client's ops in
+/// order, keying by object lets a PG keep many ops in flight.
+template<class K, class Hash = std::hash<K>>
+class OrderedStage {
+  struct slot_t {
+    // resolves once the last op that entered, and all the ops before it,
+    // have left
+    seastar::shared_future<> last = seastar::make_ready_future<>();
+    unsigned users = 0;
+  };
+  std::unordered_map<K, slot_t, Hash> slots;
+
+public:
+  /// an op's place in the stage; it leaves on exit() or when destroyed
+  class ticket {
+    friend class OrderedStage;
+    OrderedStage* stage = nullptr;
+    K key;
+    seastar::promise<> left;
+  public:
+    ticket() = default;
+    ticket(const ticket&) = delete;
+    ticket& operator=(const ticket&) = delete;
+    ticket(ticket&& other) noexcept
+      : stage(std::exchange(other.stage, nullptr)),
+	key(std::move(other.key)),
+	left(std::move(other.left)) {}
+    ~ticket() {
+      exit();
+    }
+    void exit() {
+      if (stage) {
+	std::exchange(stage, nullptr)->_exit(key, left);
+      }
+    }
+  };
+
+  /// queue the op behind the ones holding `key`. the op is placed in line
+  /// right away; the returned future resolves when its turn comes
+  seastar::future<> enter(const K& key, ticket& t) {
+    t.exit();
+    auto& slot = slots[key];
+    ++slot.users;
+    t.stage = this;
+    t.key = key;
+    t.left = seastar::promise<>();
+    auto prev = slot.last;
+    // an op leaving early, e.g. on error, must not let its successors
+    // overtake the ops still ahead of it
+    slot.last = prev.get_future().then(
+      [left = t.left.get_future()]() mutable {
+	return std::move(left);
+      });
+    return prev.get_future();
+  }
+
+  size_t size() const {
+    return slots.size();
+  }
+
+private:
+  void _exit(const K& key, seastar::promise<>& left) {
+    left.set_value();
+    auto found = slots.find(key);
+    if (--found->second.users == 0) {
+      slots.erase(found);
+    }
+  }
+};
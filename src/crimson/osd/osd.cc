@@ -329,6 +329,7 @@ seastar::future<> OSD::load_pgs()
         return load_pg(pgid).then([pgid, this](auto&& pg) {
           logger().info("load_pgs: loaded {}", pgid);
           pgs.emplace(pgid, std::move(pg));
+          shard_services.set_num_pgs(pgs.size());
           return seastar::now();
         });
       } else if (coll.is_temp(&pgid)) {
@@ -652,6 +653,7 @@ seastar::future<Ref<PG>> OSD::handle_pg_create_info(
 
 	  logger().info("{} new pg {}", __func__, *pg);
 	  pgs.emplace(info->pgid, pg);
+	  shard_services.set_num_pgs(pgs.size());
 	  return seastar::when_all_succeed(
 	    pg->get_need_up_thru() ? _send_alive() : seastar::now(),
 	    shard_services.dispatch_context(
@@ -850,18 +852,26 @@ seastar::future<> OSD::committed_osd_maps(version_t first,
 seastar::future<> OSD::handle_osd_op(ceph::net::Connection* conn,
                                      Ref<MOSDOp> m)
 {
-  return wait_for_map(m->get_map_epoch()).then([=](epoch_t epoch) {
-    if (auto found = pgs.find(m->get_spg()); found != pgs.end()) {
-      return found->second->handle_op(conn, std::move(m));
-    } else if (osdmap->is_up_acting_osd_shard(m->get_spg(), whoami)) {
-      logger().info("no pg, should exist e{}, will wait", epoch);
-      // todo, wait for peering, etc
-      return seastar::now();
-    } else {
-      logger().info("no pg, shouldn't exist e{}, dropping", epoch);
-      // todo: share map with client
-      return seastar::now();
-    }
+  using ticket_t = decltype(wait_for_map_stage)::ticket;
+  return seastar::do_with(ticket_t{}, [=](ticket_t& ticket) {
+    return wait_for_map_stage.enter(conn, ticket).then([=] {
+      return wait_for_map(m->get_map_epoch());
+    }).then([=, &ticket](epoch_t epoch) {
+      if (auto found = pgs.find(m->get_spg()); found != pgs.end()) {
+        auto handled = found->second->handle_op(conn, m);
+        // the pg has queued the op on its object by now
+        ticket.exit();
+        return handled;
+      } else if (osdmap->is_up_acting_osd_shard(m->get_spg(), whoami)) {
+        logger().info("no pg, should exist e{}, will wait", epoch);
+        // todo, wait for peering, etc
+        return seastar::now();
+      } else {
+        logger().info("no pg, shouldn't exist e{}, dropping", epoch);
+        // todo: share map with client
+        return seastar::now();
+      }
+    });
   });
 }
 
@@ -1058,7 +1068,8 @@ void OSD::check_osdmap_features()
 
 seastar::future<> OSD::consume_map(epoch_t epoch)
 {
-  // todo: m-to-n: broadcast this news to all shards
+  // todo: m-to-n: broadcast this news to the shards owning the pgs, see
+  // ShardServices::pg_to_shard()
   return seastar::parallel_for_each(pgs.begin(), pgs.end(), [=](auto& pg) {
     return advance_pg_to(pg.second, epoch);
   }).then([epoch, this] {
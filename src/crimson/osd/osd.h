@@ -19,6 +19,7 @@
 #include "crimson/mgr/client.h"
 #include "crimson/net/Dispatcher.h"
 #include "crimson/osd/chained_dispatchers.h"
+#include "crimson/osd/ordered_stage.h"
 #include "crimson/osd/osdmap_service.h"
 #include "crimson/osd/state.h"
 #include "crimson/osd/shard_services.h"
@@ -226,6 +227,9 @@ private:
   waiting_peering_t waiting_peering;
   // wait for an osdmap whose epoch is greater or equal to given epoch
   seastar::future<epoch_t> wait_for_map(epoch_t epoch);
+  // a client's ops reach their pgs in the order they were sent, even if
+  // some of them have to wait for a newer map
+  OrderedStage<ceph::net::Connection*> wait_for_map_stage;
   seastar::future<> consume_map(epoch_t epoch);
 
   std::map<spg_t, seastar::shared_future<Ref<PG>>> pgs_creating;
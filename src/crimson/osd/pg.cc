@@ -98,6 +98,11 @@ PG::PG(
     new RecoverablePredicate());
 }
 
+uint64_t PG::get_target_pg_log_entries() const
+{
+  return shard_services.get_target_pg_log_entries();
+}
+
 bool PG::try_flush_or_schedule_async() {
 // FIXME once there's a good way to schedule an "async" peering event
 #if 0
@@ -359,32 +364,47 @@ seastar::future<bufferlist> PG::do_pgnls(bufferlist& indata,
   });
 }
 
-seastar::future<Ref<MOSDOpReply>> PG::do_osd_ops(Ref<MOSDOp> m)
+seastar::future<Ref<MOSDOpReply>> PG::do_osd_ops(
+  Ref<MOSDOp> m,
+  const hobject_t& oid,
+  object_stage_t::ticket& ticket)
 {
-  return seastar::do_with(std::move(m), ceph::os::Transaction{},
-                          [this](auto& m, auto& txn) {
-    const auto oid = m->get_snapid() == CEPH_SNAPDIR ? m->get_hobj().get_head()
-                                                     : m->get_hobj();
-    return backend->get_object_state(oid).then([m,&txn,this](auto os) {
+  return seastar::do_with(ceph::os::Transaction{}, seastar::future<>{seastar::now()},
+                          [m,&oid,&ticket,this](auto& txn, auto& committed) {
+    return backend->get_object_state(oid).then([m,&txn,&committed,this](auto os) {
       // TODO: issue requests in parallel if they don't write,
       // with writes being basically a synchronization barrier
       return seastar::do_for_each(std::begin(m->ops), std::end(m->ops),
                                   [m,&txn,this,pos=os.get()](OSDOp& osd_op) {
         return do_osd_op(*pos, osd_op, txn);
-      }).then([&txn,m,this,os=std::move(os)]() mutable {
+      }).then([&txn,&committed,m,this,os=std::move(os)]() mutable {
         // XXX: the entire lambda could be scheduled conditionally. ::if_then()?
-        return txn.empty() ? seastar::now()
-                           : backend->mutate_object(std::move(os), std::move(txn), *m);
+        if (txn.empty()) {
+          return seastar::now();
+        }
+        seastar::promise<> on_commit;
+        committed = on_commit.get_future();
+        txn.register_on_commit(new LambdaContext(
+          [on_commit=std::move(on_commit)]() mutable {
+            on_commit.set_value();
+        }));
+        return backend->mutate_object(std::move(os), std::move(txn), *m);
       });
+    }).then([&ticket,&committed] {
+      // the next op on this object sees our updates already, it does not
+      // need to wait for the commit as well
+      ticket.exit();
+      return std::move(committed);
     }).then([m,this] {
       auto reply = make_message<MOSDOpReply>(m.get(), 0, get_osdmap_epoch(),
                                              0, false);
       reply->add_flags(CEPH_OSD_FLAG_ACK | CEPH_OSD_FLAG_ONDISK);
       return seastar::make_ready_future<Ref<MOSDOpReply>>(std::move(reply));
-    }).handle_exception_type([=](const object_not_found& dne) {
+    }).handle_exception_type([=,&ticket](const object_not_found& dne) {
       logger().debug("got object_not_found for {}", oid);
 
       backend->evict_object_state(oid);
+      ticket.exit();
       auto reply = make_message<MOSDOpReply>(m.get(), -ENOENT, get_osdmap_epoch(),
                                              0, false);
       reply->set_enoent_reply_versions(peering_state.get_info().last_update,
@@ -397,12 +417,21 @@ seastar::future<Ref<MOSDOpReply>> PG::do_osd_ops(Ref<MOSDOp> m)
 seastar::future<> PG::handle_op(ceph::net::Connection* conn,
                                 Ref<MOSDOp> m)
 {
-  return wait_for_active().then([conn, m, this] {
-    if (m->finish_decode()) {
-      m->clear_payload();
-    }
-    return do_osd_ops(m);
-  }).then([conn](Ref<MOSDOpReply> reply) {
-    return conn->send(reply);
+  if (m->finish_decode()) {
+    m->clear_payload();
+  }
+  auto oid = m->get_snapid() == CEPH_SNAPDIR ? m->get_hobj().get_head()
+                                             : m->get_hobj();
+  return seastar::do_with(std::move(oid), object_stage_t::ticket{},
+                          [conn, m, this](auto& oid, auto& ticket) {
+    // wait-for-active, get-object-context and process all run in the
+    // object's turn; the commit is waited for outside of it
+    return object_stage.enter(oid, ticket).then([this] {
+      return wait_for_active();
+    }).then([m, &oid, &ticket, this] {
+      return do_osd_ops(m, oid, ticket);
+    }).then([conn](Ref<MOSDOpReply> reply) {
+      return conn->send(reply);
+    });
   });
 }
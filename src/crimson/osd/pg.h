@@ -14,6 +14,7 @@
 #include "common/dout.h"
 #include "crimson/net/Fwd.h"
 #include "os/Transaction.h"
+#include "crimson/osd/ordered_stage.h"
 #include "crimson/osd/shard_services.h"
 #include "osd/osd_types.h"
 #include "osd/osd_internal_types.h"
@@ -124,6 +125,8 @@ public:
     return 0;
   }
 
+  uint64_t get_target_pg_log_entries() const final;
+
   void send_cluster_message(
     int osd, Message *m,
     epoch_t epoch, bool share_map_update=false) final {
@@ -403,6 +406,8 @@ public:
   void handle_advance_map(cached_map_t next_map, PeeringCtx &rctx);
   void handle_activate_map(PeeringCtx &rctx);
   void handle_initialize(PeeringCtx &rctx);
+  /// the op is queued on its object before this returns, so ops handed
+  /// over in order are processed in that order
   seastar::future<> handle_op(ceph::net::Connection* conn,
 			      Ref<MOSDOp> m);
   void print(std::ostream& os) const;
@@ -411,7 +416,11 @@ private:
   void do_peering_event(
     const boost::statechart::event_base &evt,
     PeeringCtx &rctx);
-  seastar::future<Ref<MOSDOpReply>> do_osd_ops(Ref<MOSDOp> m);
+  using object_stage_t = OrderedStage<hobject_t>;
+  seastar::future<Ref<MOSDOpReply>> do_osd_ops(
+    Ref<MOSDOp> m,
+    const hobject_t& oid,
+    object_stage_t::ticket& ticket);
   seastar::future<> do_osd_op(
     ObjectState& os,
     OSDOp& op,
@@ -431,6 +440,11 @@ private:
   seastar::shared_promise<> active_promise;
   seastar::future<> wait_for_active();
 
+  /// client ops on one object are processed one at a time and in order;
+  /// an op leaves once the store has applied its updates, not when they
+  /// are committed
+  object_stage_t object_stage;
+
   friend std::ostream& operator<<(std::ostream&, const PG& pg);
 };
 
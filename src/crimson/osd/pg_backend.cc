@@ -5,7 +5,9 @@
 #include <boost/range/adaptor/transformed.hpp>
 #include <boost/range/algorithm/copy.hpp>
 #include <fmt/ostream.h>
+#include <seastar/core/future-util.hh>
 #include <seastar/core/print.hh>
+#include <seastar/core/reactor.hh>
 
 #include "messages/MOSDOp.h"
 
@@ -182,7 +184,33 @@ PGBackend::mutate_object(
     // reset cached ObjectState without enforcing eviction
     os->oi = object_info_t(os->oi.soid);
   }
-  return store->do_transaction(coll, std::move(txn));
+  return submit_transaction(std::move(txn));
+}
+
+seastar::future<>
+PGBackend::submit_transaction(ceph::os::Transaction&& txn)
+{
+  pending_txn.append(txn);
+  if (!pending_applied) {
+    pending_applied.emplace();
+    // flush once the ops already runnable have had a chance to join
+    (void)seastar::later().then([this] {
+      auto txn = std::move(pending_txn);
+      pending_txn = ceph::os::Transaction{};
+      auto applied = std::move(*pending_applied);
+      pending_applied.reset();
+      logger().trace("submit_transaction: num_ops={}", txn.get_num_ops());
+      // the store applies the updates before do_transaction() returns; the
+      // commit reaches every op through its own on_commit callback
+      auto committed = store->do_transaction(coll, std::move(txn));
+      applied.set_value();
+      return committed;
+    }).handle_exception([](auto eptr) {
+      logger().error("submit_transaction: {}", eptr);
+      ceph_abort();
+    });
+  }
+  return pending_applied->get_shared_future();
 }
 
 seastar::future<>
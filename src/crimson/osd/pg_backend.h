@@ -5,8 +5,10 @@
 
 #include <map>
 #include <memory>
+#include <optional>
 #include <string>
 #include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <seastar/core/shared_future.hh>
 
 #include "crimson/os/futurized_store.h"
 #include "crimson/os/cyan_collection.h"
@@ -47,6 +49,8 @@ public:
     ObjectState& os,
     const OSDOp& osd_op,
     ceph::os::Transaction& trans);
+  /// the returned future resolves once the store has applied the op's
+  /// updates; register an on_commit callback in txn to learn of the commit
   seastar::future<> mutate_object(
     cached_os_t&& os,
     ceph::os::Transaction&& txn,
@@ -71,4 +75,10 @@ private:
 					    size_t length,
 					    uint32_t flags) = 0;
   bool maybe_create_new_object(ObjectState& os, ceph::os::Transaction& txn);
+
+  // transactions of the ops that get ready in the same reactor task are
+  // handed to the store as one
+  ceph::os::Transaction pending_txn;
+  std::optional<seastar::shared_promise<>> pending_applied;
+  seastar::future<> submit_transaction(ceph::os::Transaction&& txn);
 };
@@ -3,8 +3,11 @@
 
 #include "crimson/osd/shard_services.h"
 
+#include <algorithm>
+
 #include "osd/osd_perf_counters.h"
 #include "osd/PeeringState.h"
+#include "crimson/common/config_proxy.h"
 #include "crimson/osd/osdmap_service.h"
 #include "crimson/os/cyan_store.h"
 #include "crimson/mgr/client.h"
@@ -24,6 +27,8 @@ namespace {
   }
 }
 
+using ceph::common::local_conf;
+
 namespace ceph::osd {
 
 ShardServices::ShardServices(
@@ -114,6 +119,18 @@ seastar::future<> ShardServices::dispatch_context(
     });
 }
 
+uint64_t ShardServices::get_target_pg_log_entries() const
+{
+  auto target = local_conf()->osd_target_pg_log_entries_per_osd;
+  uint64_t most = local_conf()->osd_min_pg_log_entries;
+  if (num_pgs > 0 && target > 0) {
+    uint64_t least = std::min<uint64_t>(
+      local_conf()->osd_target_pg_log_entries_min, most);
+    return std::clamp<uint64_t>(target / num_pgs, least, most);
+  }
+  return most;
+}
+
 void ShardServices::queue_want_pg_temp(pg_t pgid,
 				    const vector<int>& want,
 				    bool forced)
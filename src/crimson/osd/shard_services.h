@@ -5,6 +5,7 @@
 
 #include <boost/intrusive_ptr.hpp>
 #include <seastar/core/future.hh>
+#include <seastar/core/smp.hh>
 
 #include "msg/MessageRef.h"
 #include "crimson/os/cyan_collection.h"
@@ -68,6 +69,12 @@ public:
     return &cct;
   }
 
+  /// the reactor which owns a PG once PGs are spread over all cores, using
+  /// the same hash as OSD::get_shard() in the classic OSD
+  static seastar::shard_id pg_to_shard(spg_t pgid) {
+    return pgid.hash_to_shard(seastar::smp::count);
+  }
+
   // Loggers
   PerfCounters &get_recoverystate_perf_logger() {
     return *recoverystate_perf;
@@ -125,6 +132,17 @@ public:
     return osdmap;
   }
 
+  // PG log budget
+private:
+  unsigned num_pgs = 0;
+public:
+  void set_num_pgs(unsigned n) {
+    num_pgs = n;
+  }
+  /// the number of log entries a clean PG keeps, see
+  /// OSDService::get_target_pg_log_entries()
+  uint64_t get_target_pg_log_entries() const;
+
   // PG Created State
 private:
   set<pg_t> pg_created;
@@ -11,16 +11,10 @@ namespace ceph::thread {
 ThreadPool::ThreadPool(size_t n_threads,
                        size_t queue_sz,
                        unsigned cpu_id)
-  : queue_size{round_up_to(queue_sz, seastar::smp::count)},
-    pending{queue_size}
-{
-  for (size_t i = 0; i < n_threads; i++) {
-    threads.emplace_back([this, cpu_id] {
-      pin(cpu_id);
-      loop();
-    });
-  }
-}
+  : n_threads{n_threads},
+    queue_sz{queue_sz},
+    cpu_id{cpu_id}
+{}
 
 ThreadPool::~ThreadPool()
 {
@@ -39,7 +33,18 @@ void ThreadPool::pin(unsigned cpu_id)
   ceph_assert(r == 0);
 }
 
-void ThreadPool::loop()
+WorkItem* ThreadPool::pop_pending(size_t home)
+{
+  WorkItem* work_item = nullptr;
+  for (size_t i = 0; i < pending.size(); i++) {
+    if (pending[(home + i) % pending.size()]->pop(work_item)) {
+      break;
+    }
+  }
+  return work_item;
+}
+
+void ThreadPool::loop(size_t home)
 {
   for (;;) {
     WorkItem* work_item = nullptr;
@@ -47,8 +52,9 @@ void ThreadPool::loop()
       std::unique_lock lock{mutex};
       cond.wait_for(lock,
                     ceph::net::conf.threadpool_empty_queue_max_wait,
-                    [this, &work_item] {
-        return pending.pop(work_item) || is_stopping();
+                    [this, home, &work_item] {
+        work_item = pop_pending(home);
+        return work_item || is_stopping();
       });
     }
     if (work_item) {
@@ -61,7 +67,17 @@ void ThreadPool::loop()
 
 seastar::future<> ThreadPool::start()
 {
+  queue_size = round_up_to(queue_sz, seastar::smp::count);
   auto slots_per_shard = queue_size / seastar::smp::count;
+  for (unsigned i = 0; i < seastar::smp::count; i++) {
+    pending.emplace_back(std::make_unique<pending_queue_t>(slots_per_shard));
+  }
+  for (size_t i = 0; i < n_threads; i++) {
+    threads.emplace_back([this, i] {
+      pin(cpu_id);
+      loop(i % pending.size());
+    });
+  }
   return submit_queue.start(slots_per_shard);
 }
 
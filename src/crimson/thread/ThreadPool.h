@@ -8,13 +8,13 @@
 #include <type_traits>
 #include <boost/lockfree/queue.hpp>
 #include <boost/optional.hpp>
+#include <seastar/core/alien.hh>
 #include <seastar/core/future.hh>
 #include <seastar/core/gate.hh>
+#include <seastar/core/reactor.hh>
 #include <seastar/core/semaphore.hh>
 #include <seastar/core/sharded.hh>
 
-#include "Condition.h"
-
 namespace ceph::thread {
 
 struct WorkItem {
@@ -26,10 +26,14 @@ template<typename Func, typename T = std::invoke_result_t<Func>>
 struct Task final : WorkItem {
   Func func;
   seastar::future_state<T> state;
-  ceph::thread::Condition on_done;
+  // the shard which submitted this task, it is woken up through its alien
+  // message queue, so no fd is needed per task
+  const seastar::shard_id shard;
+  seastar::promise<> on_done;
 public:
   explicit Task(Func&& f)
-    : func(std::move(f))
+    : func(std::move(f)),
+      shard(seastar::engine().cpu_id())
   {}
   void process() override {
     try {
@@ -37,10 +41,12 @@ public:
     } catch (...) {
       state.set_exception(std::current_exception());
     }
-    on_done.notify();
+    seastar::alien::run_on(shard, [this] {
+      on_done.set_value();
+    });
   }
   seastar::future<T> get_future() {
-    return on_done.wait().then([this] {
+    return on_done.get_future().then([this] {
       return seastar::make_ready_future<T>(state.get0(std::move(state).get()));
     });
   }
@@ -64,10 +70,17 @@ class ThreadPool {
   std::condition_variable cond;
   std::vector<std::thread> threads;
   seastar::sharded<SubmitQueue> submit_queue;
-  const size_t queue_size;
-  boost::lockfree::queue<WorkItem*> pending;
+  const size_t n_threads;
+  const size_t queue_sz;
+  const unsigned cpu_id;
+  size_t queue_size = 0;
+  // one pending queue per shard, so shards do not contend on a single
+  // queue; a thread prefers its own queue and steals from the others
+  using pending_queue_t = boost::lockfree::queue<WorkItem*>;
+  std::vector<std::unique_ptr<pending_queue_t>> pending;
 
-  void loop();
+  void loop(size_t home);
+  WorkItem* pop_pending(size_t home);
   bool is_stopping() const {
     return stopping.load(std::memory_order_relaxed);
   }
@@ -84,9 +97,8 @@ public:
    *                 multiple of the number of cores.
    * @param n_threads the number of threads in this thread pool.
    * @param cpu the CPU core to which this thread pool is assigned
-   * @note each @c Task has its own ceph::thread::Condition, which possesses
-   * possesses an fd, so we should keep the size of queue under a reasonable
-   * limit.
+   * @note the threads are spawned by start(), once the number of shards
+   * is known.
    */
   ThreadPool(size_t n_threads, size_t queue_sz, unsigned cpu);
   ~ThreadPool();
@@ -104,7 +116,7 @@ public:
           .then([packaged=std::move(packaged), this] {
             auto task = new Task{std::move(packaged)};
             auto fut = task->get_future();
-            pending.push(task);
+            pending[seastar::engine().cpu_id() % pending.size()]->push(task);
             cond.notify_one();
             return fut.finally([task, this] {
               local_free_slots().signal();
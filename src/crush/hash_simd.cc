@@ -0,0 +1,158 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "crush/hash_simd.h"
+#include "arch/probe.h"
+#include "arch/intel.h"
+#include "arch/arm.h"
+
+#if defined(__x86_64__)
+# include <immintrin.h>
+# define HAVE_CRUSH_HASH_AVX2
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+# include <arm_neon.h>
+# define HAVE_CRUSH_HASH_NEON
+#endif
+
+/*
+ * The lanes run exactly the 32-bit arithmetic of crush_hashmix() in
+ * hash.c (wrapping subtraction, xor, logical shifts), so every lane is
+ * bit-identical to crush_hash32_rjenkins1_3().
+ */
+
+#define crush_hash_seed 1315423911
+
+#define crush_hashmix_v(SUB, XOR, SHR, SHL, a, b, c) do {	\
+    a = SUB(a, b);  a = SUB(a, c);  a = XOR(a, SHR(c, 13));	\
+    b = SUB(b, c);  b = SUB(b, a);  b = XOR(b, SHL(a, 8));	\
+    c = SUB(c, a);  c = SUB(c, b);  c = XOR(c, SHR(b, 13));	\
+    a = SUB(a, b);  a = SUB(a, c);  a = XOR(a, SHR(c, 12));	\
+    b = SUB(b, c);  b = SUB(b, a);  b = XOR(b, SHL(a, 16));	\
+    c = SUB(c, a);  c = SUB(c, b);  c = XOR(c, SHR(b, 5));	\
+    a = SUB(a, b);  a = SUB(a, c);  a = XOR(a, SHR(c, 3));	\
+    b = SUB(b, c);  b = SUB(b, a);  b = XOR(b, SHL(a, 10));	\
+    c = SUB(c, a);  c = SUB(c, b);  c = XOR(c, SHR(b, 15));	\
+  } while (0)
+
+#define crush_hash32_rjenkins1_3_v(SUB, XOR, SHR, SHL, SET1, a, b, c, hash) \
+  do {									\
+    auto x = SET1(231232);						\
+    auto y = SET1(1232);						\
+    hash = XOR(XOR(XOR(SET1(crush_hash_seed), a), b), c);		\
+    crush_hashmix_v(SUB, XOR, SHR, SHL, a, b, hash);			\
+    crush_hashmix_v(SUB, XOR, SHR, SHL, c, x, hash);			\
+    crush_hashmix_v(SUB, XOR, SHR, SHL, y, a, hash);			\
+    crush_hashmix_v(SUB, XOR, SHR, SHL, b, x, hash);			\
+    crush_hashmix_v(SUB, XOR, SHR, SHL, y, c, hash);			\
+  } while (0)
+
+// scalar tail for the lanes that do not fill a vector
+static inline __u32 hash_rjenkins1_3_one(__u32 a, __u32 b, __u32 c)
+{
+#define SUB1(p, q) ((p) - (q))
+#define XOR1(p, q) ((p) ^ (q))
+#define SHR1(p, n) ((p) >> (n))
+#define SHL1(p, n) ((p) << (n))
+#define SET1_1(v) ((__u32)(v))
+  __u32 hash;
+  crush_hash32_rjenkins1_3_v(SUB1, XOR1, SHR1, SHL1, SET1_1, a, b, c, hash);
+  return hash;
+#undef SUB1
+#undef XOR1
+#undef SHR1
+#undef SHL1
+#undef SET1_1
+}
+
+#ifdef HAVE_CRUSH_HASH_AVX2
+
+__attribute__((target("avx2")))
+static void hash_rjenkins1_3_batch_avx2(__u32 a, const __s32 *ids, __u32 c,
+					unsigned n, __u32 *out)
+{
+#define SUB8(p, q) _mm256_sub_epi32(p, q)
+#define XOR8(p, q) _mm256_xor_si256(p, q)
+#define SHR8(p, n) _mm256_srli_epi32(p, n)
+#define SHL8(p, n) _mm256_slli_epi32(p, n)
+#define SET8(v) _mm256_set1_epi32((int)(v))
+  unsigned i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i va = SET8(a);
+    __m256i vb = _mm256_loadu_si256((const __m256i *)(ids + i));
+    __m256i vc = SET8(c);
+    __m256i hash;
+    crush_hash32_rjenkins1_3_v(SUB8, XOR8, SHR8, SHL8, SET8, va, vb, vc, hash);
+    _mm256_storeu_si256((__m256i *)(out + i), hash);
+  }
+  for (; i < n; ++i) {
+    out[i] = hash_rjenkins1_3_one(a, ids[i], c);
+  }
+#undef SUB8
+#undef XOR8
+#undef SHR8
+#undef SHL8
+#undef SET8
+}
+
+#endif // HAVE_CRUSH_HASH_AVX2
+
+#ifdef HAVE_CRUSH_HASH_NEON
+
+static void hash_rjenkins1_3_batch_neon(__u32 a, const __s32 *ids, __u32 c,
+					unsigned n, __u32 *out)
+{
+#define SUB4(p, q) vsubq_u32(p, q)
+#define XOR4(p, q) veorq_u32(p, q)
+#define SHR4(p, n) vshrq_n_u32(p, n)
+#define SHL4(p, n) vshlq_n_u32(p, n)
+#define SET4(v) vdupq_n_u32((__u32)(v))
+  unsigned i = 0;
+  for (; i + 4 <= n; i += 4) {
+    uint32x4_t va = SET4(a);
+    uint32x4_t vb = vld1q_u32((const __u32 *)(ids + i));
+    uint32x4_t vc = SET4(c);
+    uint32x4_t hash;
+    crush_hash32_rjenkins1_3_v(SUB4, XOR4, SHR4, SHL4, SET4, va, vb, vc, hash);
+    vst1q_u32(out + i, hash);
+  }
+  for (; i < n; ++i) {
+    out[i] = hash_rjenkins1_3_one(a, ids[i], c);
+  }
+#undef SUB4
+#undef XOR4
+#undef SHR4
+#undef SHL4
+#undef SET4
+}
+
+#endif // HAVE_CRUSH_HASH_NEON
+
+/*
+ * choose best implementation based on the CPU architecture.
+ */
+crush_hash32_rjenkins1_3_batch_func_t crush_choose_hash_batch(void)
+{
+  // make sure we've probed cpu features; this might depend on the
+  // link order of this file relative to arch/probe.cc.
+  ceph_arch_probe();
+
+#if defined(HAVE_CRUSH_HASH_AVX2)
+  if (ceph_arch_intel_avx2) {
+    return hash_rjenkins1_3_batch_avx2;
+  }
+#elif defined(HAVE_CRUSH_HASH_NEON)
+  if (ceph_arch_neon) {
+    return hash_rjenkins1_3_batch_neon;
+  }
+#endif
+  // default: hash one item at a time in mapper.c
+  return nullptr;
+}
+
+/*
+ * static global
+ *
+ * As with ceph_crc32c_func, the value only depends on the CPU we run on.
+ */
+crush_hash32_rjenkins1_3_batch_func_t crush_hash32_rjenkins1_3_batch =
+  crush_choose_hash_batch();
@@ -0,0 +1,38 @@
+#ifndef CEPH_CRUSH_HASH_SIMD_H
+#define CEPH_CRUSH_HASH_SIMD_H
+
+/*
+ * Batched crush_hash32_rjenkins1_3() for the straw2 inner loop.
+ *
+ * Userspace only: the kernel client keeps using the scalar path in
+ * mapper.c.
+ */
+
+#include "crush_compat.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* how many items bucket_straw2_choose() hashes per call */
+#define CRUSH_HASH_BATCH 64
+
+/*
+ * out[i] = crush_hash32_rjenkins1_3(a, ids[i], c) for i in [0, n)
+ */
+typedef void (*crush_hash32_rjenkins1_3_batch_func_t)(
+	__u32 a, const __s32 *ids, __u32 c, unsigned n, __u32 *out);
+
+/*
+ * the best batched implementation for this CPU, or NULL when there is
+ * no vector unit worth using and callers should hash item by item.
+ */
+extern crush_hash32_rjenkins1_3_batch_func_t crush_hash32_rjenkins1_3_batch;
+
+extern crush_hash32_rjenkins1_3_batch_func_t crush_choose_hash_batch(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -21,6 +21,7 @@
 # include "crush_compat.h"
 # include "crush.h"
 # include "hash.h"
+# include "hash_simd.h"
 #endif
 #include "crush_ln_table.h"
 #include "mapper.h"
@@ -358,6 +359,47 @@ static inline __s64 generate_exponential_distribution(int type, int x, int y, in
 	return div64_s64(ln, weight);
 }
 
+#ifndef __KERNEL__
+/*
+ * Same as the loop in bucket_straw2_choose(), but with the rjenkins1
+ * hashes of CRUSH_HASH_BATCH items computed at a time by a vector
+ * kernel.  crush_ln() and the division stay scalar, so the draws (and
+ * the tie-breaking in favour of the first item) are exactly those of
+ * the item-by-item loop.
+ */
+static int bucket_straw2_choose_batch(const struct crush_bucket_straw2 *bucket,
+				      int x, int r, const __u32 *weights,
+				      const __s32 *ids)
+{
+	unsigned int i, j, n, high = 0;
+	__s64 draw, high_draw = 0;
+	__u32 u[CRUSH_HASH_BATCH];
+
+	for (i = 0; i < bucket->h.size; i += n) {
+		n = bucket->h.size - i;
+		if (n > CRUSH_HASH_BATCH)
+			n = CRUSH_HASH_BATCH;
+		crush_hash32_rjenkins1_3_batch(x, ids + i, r, n, u);
+		for (j = 0; j < n; j++) {
+			if (weights[i + j]) {
+				__s64 ln = crush_ln(u[j] & 0xffff) -
+					0x1000000000000ll;
+				draw = div64_s64(ln, weights[i + j]);
+			} else {
+				draw = S64_MIN;
+			}
+
+			if (i + j == 0 || draw > high_draw) {
+				high = i + j;
+				high_draw = draw;
+			}
+		}
+	}
+
+	return bucket->h.items[high];
+}
+#endif
+
 static int bucket_straw2_choose(const struct crush_bucket_straw2 *bucket,
 				int x, int r, const struct crush_choose_arg *arg,
                                 int position)
@@ -366,6 +408,11 @@ static int bucket_straw2_choose(const struct crush_bucket_straw2 *bucket,
 	__s64 draw, high_draw = 0;
         __u32 *weights = get_choose_arg_weights(bucket, arg, position);
         __s32 *ids = get_choose_arg_ids(bucket, arg);
+#ifndef __KERNEL__
+	if (bucket->h.hash == CRUSH_HASH_RJENKINS1 &&
+	    crush_hash32_rjenkins1_3_batch)
+		return bucket_straw2_choose_batch(bucket, x, r, weights, ids);
+#endif
 	for (i = 0; i < bucket->h.size; i++) {
                 dprintk("weight 0x%x item %d\n", weights[i], ids[i]);
 		if (weights[i]) {
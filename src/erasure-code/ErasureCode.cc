@@ -359,4 +359,29 @@ int ErasureCode::decode_concat(const map<int, bufferlist> &chunks,
   }
   return r;
 }
+
+void ErasureCode::encode_delta(const bufferptr &old_data,
+			       const bufferptr &new_data,
+			       bufferptr *delta)
+{
+  ceph_assert(old_data.length() == new_data.length());
+  unsigned len = old_data.length();
+  if (delta->length() != len) {
+    *delta = buffer::create_aligned(len, SIMD_ALIGN);
+  }
+  // all the linear codes we support work over GF(2^w), where the
+  // difference is a plain xor
+  const char *o = old_data.c_str();
+  const char *n = new_data.c_str();
+  char *d = delta->c_str();
+  for (unsigned i = 0; i < len; i++) {
+    d[i] = o[i] ^ n[i];
+  }
+}
+
+int ErasureCode::apply_delta(const map<int, bufferptr> &deltas,
+			     map<int, bufferptr> *parity)
+{
+  return -ENOTSUP;
+}
 }
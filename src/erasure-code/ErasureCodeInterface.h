@@ -459,6 +459,45 @@ namespace ceph {
      */
     virtual int decode_concat(const std::map<int, bufferlist> &chunks,
 			      bufferlist *decoded) = 0;
+
+    /**
+     * Return true if every coding chunk is a linear combination of
+     * the data chunks, so that a change to some of the data chunks
+     * can be folded into the coding chunks with **apply_delta**
+     * without reading the rest of the stripe.
+     *
+     * @return **true** if **encode_delta** and **apply_delta** are implemented
+     */
+    virtual bool supports_parity_delta() const = 0;
+
+    /**
+     * Compute in **delta** the difference between the **old_data**
+     * and **new_data** content of the same region of a data chunk.
+     * The three buffers have the same length.
+     *
+     * @param [in] old_data the current content of the region
+     * @param [in] new_data the content about to be written
+     * @param [out] delta the difference, to be passed to **apply_delta**
+     */
+    virtual void encode_delta(const bufferptr &old_data,
+			      const bufferptr &new_data,
+			      bufferptr *delta) = 0;
+
+    /**
+     * Update in place the coding chunks found in **parity** with the
+     * **deltas** computed by **encode_delta** for some data chunks.
+     * Both maps are keyed by chunk index and all buffers cover the
+     * same region of their chunk. Data chunks missing from **deltas**
+     * are unchanged.
+     *
+     * Returns 0 on success.
+     *
+     * @param [in] deltas map data chunk indexes to their delta
+     * @param [in,out] parity map coding chunk indexes to their content
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int apply_delta(const std::map<int, bufferptr> &deltas,
+			    std::map<int, bufferptr> *parity) = 0;
   };
 
   typedef std::shared_ptr<ErasureCodeInterface> ErasureCodeInterfaceRef;
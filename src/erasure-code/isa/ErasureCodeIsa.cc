@@ -132,6 +132,38 @@ ErasureCodeIsaDefault::isa_encode(char **data,
 
 // -----------------------------------------------------------------------------
 
+int
+ErasureCodeIsaDefault::apply_delta(const map<int, bufferptr> &deltas,
+                                   map<int, bufferptr> *parity)
+{
+  for (auto &&p : *parity) {
+    int i = p.first - k;
+    ceph_assert(i >= 0 && i < m);
+    unsigned char *coding = (unsigned char*) p.second.c_str();
+    for (auto &&d : deltas) {
+      int j = d.first;
+      ceph_assert(j >= 0 && j < k);
+      ceph_assert(d.second.length() == p.second.length());
+      unsigned char *delta = (unsigned char*) d.second.c_str();
+      int len = d.second.length();
+      if (m == 1) {
+        // isa_encode uses a plain xor for a single parity chunk whatever
+        // the matrix is
+        for (int l = 0; l < len; l++)
+          coding[l] ^= delta[l];
+      } else {
+        // the tables hold 32 bytes per coefficient, one row of k
+        // coefficients per coding chunk
+        ec_encode_data_update(len, k, 1, j, &encode_tbls[i * k * 32],
+                              delta, &coding);
+      }
+    }
+  }
+  return 0;
+}
+
+// -----------------------------------------------------------------------------
+
 bool
 ErasureCodeIsaDefault::erasure_contains(int *erasures, int i)
 {
@@ -39,6 +39,7 @@ using std::map;
 using std::set;
 
 using ceph::bufferlist;
+using ceph::bufferptr;
 using ceph::ErasureCodeProfile;
 
 static ostream& _prefix(std::ostream* _dout)
@@ -137,6 +138,45 @@ int ErasureCodeJerasure::decode_chunks(const set<int> &want_to_read,
   return jerasure_decode(erasures, data, coding, blocksize);
 }
 
+int ErasureCodeJerasure::matrix_apply_delta(const int *matrix,
+					    const map<int, bufferptr> &deltas,
+					    map<int, bufferptr> *parity)
+{
+  // coding chunk i is the sum over j of matrix[i*k+j] * data chunk j,
+  // so each delta contributes its own product to every coding chunk
+  for (auto &&p : *parity) {
+    int i = p.first - k;
+    ceph_assert(i >= 0 && i < m);
+    char *coding = p.second.c_str();
+    for (auto &&d : deltas) {
+      int j = d.first;
+      ceph_assert(j >= 0 && j < k);
+      ceph_assert(d.second.length() == p.second.length());
+      int multby = matrix[i * k + j];
+      char *delta = const_cast<char*>(d.second.c_str());
+      int len = d.second.length();
+      if (multby == 1) {
+	galois_region_xor(delta, coding, len);
+	continue;
+      }
+      switch (w) {
+      case 8:
+	galois_w08_region_multiply(delta, multby, len, coding, 1);
+	break;
+      case 16:
+	galois_w16_region_multiply(delta, multby, len, coding, 1);
+	break;
+      case 32:
+	galois_w32_region_multiply(delta, multby, len, coding, 1);
+	break;
+      default:
+	return -ENOTSUP;
+      }
+    }
+  }
+  return 0;
+}
+
 bool ErasureCodeJerasure::is_prime(int value)
 {
   int prime55[] = {
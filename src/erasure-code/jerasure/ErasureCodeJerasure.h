@@ -77,6 +77,9 @@ public:
   static bool is_prime(int value);
 protected:
   virtual int parse(ceph::ErasureCodeProfile &profile, std::ostream *ss);
+  int matrix_apply_delta(const int *matrix,
+			 const std::map<int, ceph::bufferptr> &deltas,
+			 std::map<int, ceph::bufferptr> *parity);
 };
 class ErasureCodeJerasureReedSolomonVandermonde : public ErasureCodeJerasure {
 public:
@@ -95,6 +98,14 @@ public:
       free(matrix);
   }
 
+  bool supports_parity_delta() const override {
+    return true;
+  }
+  int apply_delta(const std::map<int, ceph::bufferptr> &deltas,
+		  std::map<int, ceph::bufferptr> *parity) override {
+    return matrix_apply_delta(matrix, deltas, parity);
+  }
+
   void jerasure_encode(char **data,
                                char **coding,
                                int blocksize) override;
@@ -124,6 +135,14 @@ public:
       free(matrix);
   }
 
+  bool supports_parity_delta() const override {
+    return true;
+  }
+  int apply_delta(const std::map<int, ceph::bufferptr> &deltas,
+		  std::map<int, ceph::bufferptr> *parity) override {
+    return matrix_apply_delta(matrix, deltas, parity);
+  }
+
   void jerasure_encode(char **data,
                                char **coding,
                                int blocksize) override;
@@ -415,6 +415,10 @@ inline namespace v14_2_0 {
 
     static ptr_node* copy_hypercombined(const ptr_node& copy_this);
 
+    // recycled through a small per-thread free list, see buffer.cc
+    static void* operator new(size_t size);
+    static void operator delete(void* p);
+
   private:
     template <class... Args>
     ptr_node(Args&&... args) : ptr(std::forward<Args>(args)...) {
@@ -678,6 +682,13 @@ inline namespace v14_2_0 {
     unsigned _len;
     unsigned _memcopy_count; //the total of memcopy using rebuild().
 
+    void _rebuild(std::unique_ptr<ptr_node, ptr_node::disposer> nb,
+		  bool streaming);
+    bool _rebuild_aligned_size_and_memory(unsigned align_size,
+					  unsigned align_memory,
+					  unsigned max_buffers,
+					  bool streaming);
+
     template <bool is_const>
     class CEPH_BUFFER_API iterator_impl {
     protected:
@@ -1101,6 +1112,11 @@ inline namespace v14_2_0 {
     bool rebuild_aligned_size_and_memory(unsigned align_size,
 					 unsigned align_memory,
 					 unsigned max_buffers = 0);
+    // the same, for a list that goes to the device without being read
+    // again: large rebuilds bypass the cpu cache.
+    bool rebuild_aligned_for_device(unsigned align_size,
+				    unsigned align_memory,
+				    unsigned max_buffers = 0);
     bool rebuild_page_aligned();
 
     void reserve(size_t prealloc);
@@ -1635,6 +1635,37 @@ int64_t ceph_ll_readv(struct ceph_mount_info *cmount, struct Fh *fh,
 		      const struct iovec *iov, int iovcnt, int64_t off);
 int64_t ceph_ll_writev(struct ceph_mount_info *cmount, struct Fh *fh,
 		       const struct iovec *iov, int iovcnt, int64_t off);
+
+/**
+ * An asynchronous vectored read or write, see
+ * ceph_ll_nonblocking_readv_writev().
+ */
+struct ceph_ll_io_info {
+  /* called once the I/O is done, with result set */
+  void (*callback)(struct ceph_ll_io_info *cb_info);
+  void *priv;			/* for the caller's use */
+  struct Fh *fh;
+  const struct iovec *iov;
+  int iovcnt;
+  int64_t off;
+  int64_t result;		/* bytes read/written, or negative error code */
+  bool write;
+};
+
+/**
+ * Start a vectored read or write without waiting for it.
+ *
+ * The I/O is run by one of client_async_io_threads threads, so up to that
+ * many of them are in flight at once.  io_info, the iovecs and the buffers
+ * they point to must stay valid, and the file handle open, until
+ * io_info->callback is called from that thread.
+ *
+ * @param cmount the ceph mount handle to use.
+ * @param io_info what to do, and how to report completion.
+ * @returns 0 if the I/O was queued, or a negative error code.
+ */
+int64_t ceph_ll_nonblocking_readv_writev(struct ceph_mount_info *cmount,
+					 struct ceph_ll_io_info *io_info);
 int ceph_ll_close(struct ceph_mount_info *cmount, struct Fh* filehandle);
 int ceph_ll_iclose(struct ceph_mount_info *cmount, struct Inode *in, int mode);
 /**
@@ -50,6 +50,28 @@ static inline uint32_t ceph_crc32c(uint32_t crc, unsigned char const *data, unsi
   return ceph_crc32c_func(crc, data, length);
 }
 
+struct ceph_crc32c_segment {
+  unsigned char const *data;
+  unsigned length;
+};
+
+/**
+ * calculate crc32c over the concatenation of several buffers
+ *
+ * Gives the same result as chaining ceph_crc32c() over the segments in
+ * turn.  If the CPU has a crc32c instruction, the data is cut into three
+ * streams that are hashed in parallel and then combined, so the
+ * instruction pipeline stays full even when the segments are too short
+ * for the interleaving ceph_crc32c_func does on its own.
+ *
+ * @param crc initial value
+ * @param segs segments; their data pointers must not be NULL
+ * @param n number of segments
+ */
+uint32_t ceph_crc32c_segments(uint32_t crc,
+			      struct ceph_crc32c_segment const *segs,
+			      unsigned n);
+
 #ifdef __cplusplus
 }
 #endif
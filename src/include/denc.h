@@ -24,6 +24,7 @@
 #ifndef _ENC_DEC_H
 #define _ENC_DEC_H
 
+#include <algorithm>
 #include <array>
 #include <cstring>
 #include <map>
@@ -1593,13 +1594,24 @@ inline std::enable_if_t<traits::supported && traits::need_contiguous> decode(
 {
   if (p.end())
     throw ceph::buffer::end_of_buffer();
-  // ensure we get a contigous buffer... until the end of the
-  // ceph::buffer::list.  we don't really know how much we'll need here,
-  // unfortunately.  hopefully it is already contiguous and we're just
-  // bumping the raw ref and initializing the ptr tmp fields.
+  const auto remaining = p.get_bl().length() - p.get_off();
   ceph::buffer::ptr tmp;
   auto t = p;
-  t.copy_shallow(p.get_bl().length() - p.get_off(), tmp);
+  if constexpr (traits::bounded && !traits::featured) {
+    // like decode_nohead(), a bounded type never needs more than its
+    // bound, so only that much has to be contiguous.  this keeps the
+    // small fixed-size types cheap to decode from the middle of a
+    // fragmented ceph::buffer::list.
+    size_t len = 0;
+    traits::bound_encode(o, len);
+    t.copy_shallow(std::min<size_t>(len, remaining), tmp);
+  } else {
+    // ensure we get a contigous buffer... until the end of the
+    // ceph::buffer::list.  we don't really know how much we'll need here,
+    // unfortunately.  hopefully it is already contiguous and we're just
+    // bumping the raw ref and initializing the ptr tmp fields.
+    t.copy_shallow(remaining, tmp);
+  }
   auto cp = std::cbegin(tmp);
   traits::decode(o, cp);
   p.advance(cp.get_offset());
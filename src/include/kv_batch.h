@@ -0,0 +1,88 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_KV_BATCH_H
+#define CEPH_KV_BATCH_H
+
+#include <algorithm>
+#include <string_view>
+#include <vector>
+
+#include "include/buffer.h"
+
+/**
+ * A run of key/value pairs copied back to back into one buffer.
+ *
+ * Filled by the iterators' next_batch() so that bulk omap readers pay a
+ * single copy per entry instead of a std::string and a bufferlist each.
+ * Keys and values are handed out as views into the arena; they stay valid
+ * until the next append() or clear().
+ */
+struct kv_batch_t {
+  struct entry_t {
+    uint32_t key_off;
+    uint32_t key_len;
+    uint32_t val_off;
+    uint32_t val_len;
+  };
+
+  ceph::buffer::ptr arena;
+  uint32_t used = 0;            ///< bytes of the arena holding entries
+  std::vector<entry_t> entries;
+
+  static constexpr size_t min_arena = 64 << 10;
+
+  void clear() {
+    arena = ceph::buffer::ptr();
+    used = 0;
+    entries.clear();
+  }
+  size_t size() const {
+    return entries.size();
+  }
+  bool empty() const {
+    return entries.empty();
+  }
+
+  std::string_view key(size_t i) const {
+    const entry_t& e = entries[i];
+    return std::string_view(arena.c_str() + e.key_off, e.key_len);
+  }
+  std::string_view value(size_t i) const {
+    const entry_t& e = entries[i];
+    return std::string_view(arena.c_str() + e.val_off, e.val_len);
+  }
+  /// the value as a buffer sharing the arena, without copying
+  ceph::buffer::ptr value_ptr(size_t i) const {
+    const entry_t& e = entries[i];
+    return ceph::buffer::ptr(arena, e.val_off, e.val_len);
+  }
+
+  /// copy an entry in unless that takes the batch past max_bytes; the
+  /// first entry always fits so that a large value cannot stall a scan
+  bool append(const char *k, size_t klen, const char *v, size_t vlen,
+	      size_t max_bytes) {
+    size_t need = klen + vlen;
+    if (!entries.empty() && used + need > max_bytes) {
+      return false;
+    }
+    if (used + need > arena.length()) {
+      // grow geometrically; callers pass generous limits
+      size_t len = std::max<size_t>(arena.length() * 2, min_arena);
+      len = std::max<size_t>(std::min(len, max_bytes), used + need);
+      ceph::buffer::ptr p = ceph::buffer::create(len);
+      if (used) {
+	p.copy_in(0, used, arena.c_str());
+      }
+      arena = std::move(p);
+    }
+    arena.copy_in(used, klen, k);
+    arena.copy_in(used + klen, vlen, v);
+    entries.push_back(entry_t{used, (uint32_t)klen,
+			      (uint32_t)(used + klen), (uint32_t)vlen});
+    used += need;
+    return true;
+  }
+};
+
+#endif
@@ -138,6 +138,21 @@ Note that you cannot easily query per-type, primarily because debug
 mode is optional and you should not rely on that information being
 available.
 
+Allocation sites
+----------------
+
+Neither of the above says which code path is holding the memory.  For
+that, allocation sampling can be turned on with
+
+  mempool::set_sample_rate(n);
+
+after which a backtrace is taken for one in every n allocations made
+through a mempool allocator, and the sampled objects are tracked until
+they are freed.  mempool::dump_sites(f) reports the call sites of the
+live samples, largest first, with their bytes scaled back up by n.
+Each sampled free costs a hash lookup; once sampling is off again
+(n = 0) the cost is a single branch.
+
 */
 
 namespace mempool {
@@ -180,6 +195,27 @@ enum pool_index_t {
 extern bool debug_mode;
 extern void set_debug_mode(bool d);
 
+// --------------------------------------------------------------
+// allocation site sampling
+
+extern unsigned sample_rate;   // 1 in sample_rate allocations, 0 = off
+extern void set_sample_rate(unsigned n);
+
+inline thread_local unsigned sample_countdown = 0;
+
+// remember where p was allocated; returns the number of allocations to
+// skip before the next sample, sample_rate on average
+unsigned sample_allocation(pool_index_t ix, void *p, size_t bytes);
+void sample_deallocation(void *p);
+
+inline void maybe_sample_allocation(pool_index_t ix, void *p, size_t bytes) {
+  if (sample_countdown-- == 0) {
+    sample_countdown = sample_allocation(ix, p, bytes);
+  }
+}
+
+void dump_sites(ceph::Formatter *f);
+
 // --------------------------------------------------------------
 class pool_t;
 
@@ -323,6 +359,9 @@ public:
       type->items += n;
     }
     T* r = reinterpret_cast<T*>(new char[total]);
+    if (__builtin_expect(sample_rate, 0)) {
+      maybe_sample_allocation(pool_ix, r, total);
+    }
     return r;
   }
 
@@ -334,6 +373,9 @@ public:
     if (type) {
       type->items -= n;
     }
+    if (__builtin_expect(sample_rate, 0)) {
+      sample_deallocation(p);
+    }
     delete[] reinterpret_cast<char*>(p);
   }
 
@@ -350,6 +392,9 @@ public:
     if (rc)
       throw std::bad_alloc();
     T* r = reinterpret_cast<T*>(ptr);
+    if (__builtin_expect(sample_rate, 0)) {
+      maybe_sample_allocation(pool_ix, r, total);
+    }
     return r;
   }
 
@@ -361,6 +406,9 @@ public:
     if (type) {
       type->items -= n;
     }
+    if (__builtin_expect(sample_rate, 0)) {
+      sample_deallocation(p);
+    }
     ::free(p);
   }
 
@@ -519,16 +519,11 @@ struct shard_id_t {
 
   const static shard_id_t NO_SHARD;
 
-  void encode(ceph::buffer::list &bl) const {
-    using ceph::encode;
-    encode(id, bl);
-  }
-  void decode(ceph::buffer::list::const_iterator &bl) {
-    using ceph::decode;
-    decode(id, bl);
+  DENC(shard_id_t, v, p) {
+    denc(v.id, p);
   }
 };
-WRITE_CLASS_ENCODER(shard_id_t)
+WRITE_CLASS_DENC_BOUNDED(shard_id_t)
 WRITE_EQ_OPERATORS_1(shard_id_t, id)
 WRITE_CMP_OPERATORS_1(shard_id_t, id)
 std::ostream &operator<<(std::ostream &lhs, const shard_id_t &rhs);
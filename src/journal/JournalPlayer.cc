@@ -635,6 +635,7 @@ void JournalPlayer::fetch(uint64_t object_num) {
     m_ioctx, m_object_oid_prefix, object_num, m_journal_metadata->get_timer(),
     m_journal_metadata->get_timer_lock(), m_journal_metadata->get_order(),
     m_max_fetch_bytes));
+  object_player->enable_read_ahead(&m_async_op_tracker);
 
   auto splay_width = m_journal_metadata->get_splay_width();
   m_object_players[object_num % splay_width] = object_player;
@@ -3,6 +3,7 @@
 
 #include "journal/ObjectPlayer.h"
 #include "journal/Utils.h"
+#include "common/AsyncOpTracker.h"
 #include "common/Timer.h"
 #include <limits>
 
@@ -33,6 +34,7 @@ ObjectPlayer::~ObjectPlayer() {
     Mutex::Locker timer_locker(m_timer_lock);
     Mutex::Locker locker(m_lock);
     ceph_assert(!m_fetch_in_progress);
+    ceph_assert(!m_read_ahead_in_progress);
     ceph_assert(m_watch_ctx == nullptr);
   }
 }
@@ -45,12 +47,25 @@ void ObjectPlayer::fetch(Context *on_finish) {
   m_fetch_in_progress = true;
 
   C_Fetch *context = new C_Fetch(this, on_finish);
+  if (m_read_ahead_in_progress) {
+    ldout(m_cct, 20) << __func__ << ": waiting for read-ahead" << dendl;
+    ceph_assert(m_read_ahead_fetch == nullptr);
+    m_read_ahead_fetch = context;
+    return;
+  }
+
+  read(m_read_off, &context->read_bl, context);
+}
+
+void ObjectPlayer::read(uint32_t off, bufferlist *bl, Context *on_finish) {
+  ceph_assert(m_lock.is_locked());
+
   librados::ObjectReadOperation op;
-  op.read(m_read_off, m_max_fetch_bytes, &context->read_bl, NULL);
+  op.read(off, m_max_fetch_bytes, bl, NULL);
   op.set_op_flags2(CEPH_OSD_OP_FLAG_FADVISE_DONTNEED);
 
   librados::AioCompletion *rados_completion =
-    librados::Rados::aio_create_completion(context, utils::rados_ctx_callback,
+    librados::Rados::aio_create_completion(on_finish, utils::rados_ctx_callback,
                                            NULL);
   int r = m_ioctx.aio_operate(m_oid, rados_completion, &op, 0, NULL);
   ceph_assert(r == 0);
@@ -120,11 +135,30 @@ int ObjectPlayer::handle_fetch_complete(int r, const bufferlist &bl,
 
   Mutex::Locker locker(m_lock);
   ceph_assert(m_fetch_in_progress);
+  return decode_fetched(bl, false, refetch);
+}
+
+int ObjectPlayer::decode_fetched(const bufferlist &bl, bool read_ahead,
+                                 bool *refetch) {
+  ceph_assert(m_lock.is_locked());
   m_read_off += bl.length();
   m_read_bl.append(bl);
   m_refetch_state = REFETCH_STATE_REQUIRED;
 
   bool full_fetch = (m_max_fetch_bytes == 2U << m_order);
+
+  // a full chunk implies a backlog: start reading the next one before
+  // decoding this one. a chunk read ahead does not start another, so at
+  // most one chunk beyond what the player asked for is held in memory
+  if (!read_ahead && !full_fetch && bl.length() == m_max_fetch_bytes &&
+      m_read_ahead_op_tracker != nullptr && !m_read_ahead_in_progress) {
+    ldout(m_cct, 20) << __func__ << ": " << m_oid << " reading ahead at "
+                     << m_read_off << dendl;
+    m_read_ahead_in_progress = true;
+    m_read_ahead_off = m_read_off;
+    C_ReadAhead *context = new C_ReadAhead(this, m_read_ahead_op_tracker);
+    read(m_read_ahead_off, &context->read_bl, context);
+  }
   bool partial_entry = false;
   bool invalid = false;
   uint32_t invalid_start_off = 0;
@@ -214,6 +248,34 @@ int ObjectPlayer::handle_fetch_complete(int r, const bufferlist &bl,
   return 0;
 }
 
+void ObjectPlayer::handle_read_ahead(int r, bufferlist &bl) {
+  ldout(m_cct, 10) << __func__ << ": " << m_oid << ", r=" << r << ", len="
+                   << bl.length() << dendl;
+
+  C_Fetch *fetch_ctx = nullptr;
+  {
+    Mutex::Locker locker(m_lock);
+    ceph_assert(m_read_ahead_in_progress);
+    ceph_assert(m_read_off == m_read_ahead_off);
+    m_read_ahead_in_progress = false;
+    std::swap(fetch_ctx, m_read_ahead_fetch);
+
+    if (fetch_ctx == nullptr) {
+      // decode now so the entries are ready when the player gets to them.
+      // on failure nothing was consumed and the next fetch reads it again
+      if (r >= 0 && bl.length() > 0) {
+        bool refetch = false;
+        decode_fetched(bl, true, &refetch);
+      }
+      return;
+    }
+  }
+
+  // a fetch issued while the read-ahead was in flight completes with it
+  fetch_ctx->read_bl.claim(bl);
+  fetch_ctx->complete(r);
+}
+
 void ObjectPlayer::clear_invalid_range(uint32_t off, uint32_t len) {
   // possibly remove previously partial record region
   InvalidRanges decode_range;
@@ -308,4 +370,18 @@ void ObjectPlayer::C_WatchFetch::finish(int r) {
   object_player->handle_watch_fetched(r);
 }
 
+ObjectPlayer::C_ReadAhead::C_ReadAhead(ObjectPlayer *o,
+                                       AsyncOpTracker *async_op_tracker)
+  : object_player(o), async_op_tracker(async_op_tracker) {
+  async_op_tracker->start_op();
+}
+
+void ObjectPlayer::C_ReadAhead::finish(int r) {
+  object_player->handle_read_ahead(r, read_bl);
+
+  // the player must be released before its owner can shut down
+  object_player.reset();
+  async_op_tracker->finish_op();
+}
+
 } // namespace journal
@@ -18,6 +18,7 @@
 #include <boost/unordered_map.hpp>
 #include "include/ceph_assert.h"
 
+class AsyncOpTracker;
 class SafeTimer;
 
 namespace journal {
@@ -83,6 +84,14 @@ public:
     m_max_fetch_bytes = max_fetch_bytes;
   }
 
+  /// read the next chunk while the last one is decoded and replayed, as
+  /// long as fetches keep returning full chunks. read-aheads in flight are
+  /// registered with the tracker.
+  inline void enable_read_ahead(AsyncOpTracker *async_op_tracker) {
+    Mutex::Locker locker(m_lock);
+    m_read_ahead_op_tracker = async_op_tracker;
+  }
+
 private:
   typedef std::pair<uint64_t, uint64_t> EntryKey;
   typedef boost::unordered_map<EntryKey, Entries::iterator> EntryKeys;
@@ -101,6 +110,13 @@ private:
     }
     void finish(int r) override;
   };
+  struct C_ReadAhead : public Context {
+    ObjectPlayerPtr object_player;
+    AsyncOpTracker *async_op_tracker;
+    bufferlist read_bl;
+    C_ReadAhead(ObjectPlayer *o, AsyncOpTracker *async_op_tracker);
+    void finish(int r) override;
+  };
 
   librados::IoCtx m_ioctx;
   uint64_t m_object_num;
@@ -122,6 +138,11 @@ private:
   uint32_t m_read_off = 0;
   uint32_t m_read_bl_off = 0;
 
+  AsyncOpTracker *m_read_ahead_op_tracker = nullptr;
+  bool m_read_ahead_in_progress = false;
+  uint32_t m_read_ahead_off = 0;
+  C_Fetch *m_read_ahead_fetch = nullptr;
+
   Entries m_entries;
   EntryKeys m_entry_keys;
   InvalidRanges m_invalid_ranges;
@@ -131,7 +152,10 @@ private:
   bool m_unwatched = false;
   RefetchState m_refetch_state = REFETCH_STATE_IMMEDIATE;
 
+  void read(uint32_t off, bufferlist *bl, Context *on_finish);
   int handle_fetch_complete(int r, const bufferlist &bl, bool *refetch);
+  int decode_fetched(const bufferlist &bl, bool read_ahead, bool *refetch);
+  void handle_read_ahead(int r, bufferlist &bl);
 
   void clear_invalid_range(uint32_t off, uint32_t len);
 
@@ -412,10 +412,12 @@ void ObjectRecorder::send_appends_aio() {
     client::guard_append(&op, m_soft_max_size);
     auto append_buffers = &m_in_flight_appends[append_tid];
 
+    // send the batch as a single append op -- the payloads are only
+    // referenced, not copied, and go out as one vectored write
+    bufferlist append_bl;
     for (auto it = m_pending_buffers.begin(); it != m_pending_buffers.end(); ) {
       ldout(m_cct, 20) << __func__ << ": flushing " << *it->first << dendl;
-      op.append(it->second);
-      op.set_op_flags2(CEPH_OSD_OP_FLAG_FADVISE_DONTNEED);
+      append_bl.append(it->second);
       m_aio_sent_size += it->second.length();
       append_buffers->push_back(*it);
       it = m_pending_buffers.erase(it);
@@ -423,6 +425,8 @@ void ObjectRecorder::send_appends_aio() {
         break;
       }
     }
+    op.append(append_bl);
+    op.set_op_flags2(CEPH_OSD_OP_FLAG_FADVISE_DONTNEED);
     rados_completion = librados::Rados::aio_create_completion(
         new C_AppendFlush(this, append_tid), nullptr,
         utils::rados_ctx_callback);
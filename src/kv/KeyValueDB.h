@@ -10,6 +10,7 @@
 #include <string>
 #include <boost/scoped_ptr.hpp>
 #include "include/encoding.h"
+#include "include/kv_batch.h"
 #include "common/Formatter.h"
 #include "common/perf_counters.h"
 #include "common/PriorityCache.h"
@@ -217,6 +218,25 @@ public:
     virtual std::string key() = 0;
     virtual ceph::buffer::list value() = 0;
     virtual int status() = 0;
+    /// copy up to max entries from the current position into batch,
+    /// stopping before end (if not empty) or once max_bytes are used,
+    /// and advance past them
+    virtual int next_batch(const std::string &end, size_t max,
+			   size_t max_bytes, kv_batch_t *batch) {
+      for (size_t n = 0; n < max && valid(); ++n) {
+	std::string k = key();
+	if (!end.empty() && k >= end) {
+	  break;
+	}
+	ceph::buffer::list v = value();
+	if (!batch->append(k.data(), k.size(), v.c_str(), v.length(),
+			   max_bytes)) {
+	  break;
+	}
+	next();
+      }
+      return status();
+    }
     virtual ~SimplestIteratorImpl() {}
   };
 
@@ -270,11 +290,29 @@ public:
     virtual size_t value_size() {
       return 0;
     }
+    /// next_batch() for the keys under prefix
+    virtual int next_batch(const std::string &prefix, const std::string &end,
+			   size_t max, size_t max_bytes, kv_batch_t *batch) {
+      for (size_t n = 0; n < max && valid() && raw_key_is_prefixed(prefix);
+	   ++n) {
+	std::string k = key();
+	if (!end.empty() && k >= end) {
+	  break;
+	}
+	ceph::buffer::list v = value();
+	if (!batch->append(k.data(), k.size(), v.c_str(), v.length(),
+			   max_bytes)) {
+	  break;
+	}
+	next();
+      }
+      return status();
+    }
     virtual ~WholeSpaceIteratorImpl() { }
   };
   typedef std::shared_ptr< WholeSpaceIteratorImpl > WholeSpaceIterator;
 
-private:
+protected:
   // This class filters a WholeSpaceIterator by a prefix.
   class PrefixIteratorImpl : public IteratorImpl {
     const std::string prefix;
@@ -322,6 +360,10 @@ private:
     int status() override {
       return generic_iter->status();
     }
+    int next_batch(const std::string &end, size_t max, size_t max_bytes,
+		   kv_batch_t *batch) override {
+      return generic_iter->next_batch(prefix, end, max, max_bytes, batch);
+    }
   };
 public:
 
@@ -331,6 +373,21 @@ public:
       prefix,
       get_wholespace_iterator());
   }
+  /// iterator for long sequential scans, reading ahead readahead bytes
+  /// where the store supports it
+  virtual Iterator get_iterator(const std::string &prefix, size_t readahead) {
+    return get_iterator(prefix);
+  }
+  /// iterator that is only used on keys in [lower, upper) of prefix.
+  /// Stores that support it stop at the bounds instead of stepping over
+  /// whatever lies past them, such as the deleted keys of other objects.
+  /// Nothing outside the bounds is guaranteed to be visible.
+  virtual Iterator get_bounded_iterator(const std::string &prefix,
+					const std::string &lower,
+					const std::string &upper,
+					size_t readahead = 0) {
+    return readahead ? get_iterator(prefix, readahead) : get_iterator(prefix);
+  }
 
   void add_column_family(const std::string& cf_name, void *handle) {
     cf_handles.insert(std::make_pair(cf_name, handle));
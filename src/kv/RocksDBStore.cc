@@ -4,6 +4,7 @@
 #include <set>
 #include <map>
 #include <string>
+#include <string_view>
 #include <memory>
 #include <errno.h>
 #include <unistd.h>
@@ -25,6 +26,7 @@ using std::string;
 #include "include/str_list.h"
 #include "include/stringify.h"
 #include "include/str_map.h"
+#include "include/ceph_hash.h"
 #include "KeyValueDB.h"
 #include "RocksDBStore.h"
 
@@ -35,6 +37,10 @@ using std::string;
 #undef dout_prefix
 #define dout_prefix *_dout << "rocksdb: "
 
+// sharding definitions are kept in the default column family so that a
+// reopen routes keys exactly as they were written
+static const string SHARDING_PREFIX = "_cf_sharding";
+
 static bufferlist to_bufferlist(rocksdb::Slice in) {
   bufferlist bl;
   bl.append(bufferptr(in.data(), in.size()));
@@ -77,6 +83,9 @@ public:
     for (auto& p : store.cf_handles) {
       names.erase(p.first);
     }
+    for (auto& p : store.cf_shards) {
+      names.erase(p.first);
+    }
     for (auto& p : names) {
       store.assoc_name += '.';
       store.assoc_name += p.first;
@@ -310,6 +319,144 @@ int RocksDBStore::install_cf_mergeop(
   return 0;
 }
 
+rocksdb::ColumnFamilyHandle *RocksDBStore::prefix_shards::get(
+  const char *key, size_t keylen) const
+{
+  uint32_t l = std::min<size_t>(hash_l, keylen);
+  uint32_t h = std::min<size_t>(hash_h, keylen);
+  uint32_t hash = ceph_str_hash_rjenkins(key + l, h - l);
+  return handles[hash % handles.size()];
+}
+
+int RocksDBStore::parse_sharded_cf(
+  const string& name,
+  string *prefix,
+  unsigned *count,
+  prefix_shards *shards)
+{
+  // prefix(count) or prefix(count,l-h)
+  size_t open = name.find('(');
+  if (open == string::npos) {
+    *prefix = name;
+    return 0;
+  }
+  if (open == 0 || name.back() != ')') {
+    return -EINVAL;
+  }
+  *prefix = name.substr(0, open);
+  string args = name.substr(open + 1, name.size() - open - 2);
+  string range;
+  size_t comma = args.find(',');
+  if (comma != string::npos) {
+    range = args.substr(comma + 1);
+    args.resize(comma);
+  }
+  string err;
+  *count = strict_strtol(args.c_str(), 10, &err);
+  if (!err.empty() || *count == 0) {
+    return -EINVAL;
+  }
+  shards->hash_l = 0;
+  shards->hash_h = UINT32_MAX;
+  if (!range.empty()) {
+    size_t dash = range.find('-');
+    if (dash == string::npos) {
+      return -EINVAL;
+    }
+    shards->hash_l = strict_strtol(range.substr(0, dash).c_str(), 10, &err);
+    if (!err.empty()) {
+      return -EINVAL;
+    }
+    if (dash + 1 < range.size()) {
+      shards->hash_h = strict_strtol(range.substr(dash + 1).c_str(), 10, &err);
+      if (!err.empty() || shards->hash_h <= shards->hash_l) {
+	return -EINVAL;
+      }
+    }
+  }
+  return 1;
+}
+
+string RocksDBStore::sharded_cf_name(const string& prefix, unsigned i)
+{
+  return prefix + "-" + stringify(i);
+}
+
+bool RocksDBStore::split_sharded_cf_name(
+  const string& name,
+  string *prefix,
+  unsigned *i)
+{
+  size_t dash = name.rfind('-');
+  if (dash == string::npos || dash == 0 || dash + 1 == name.size()) {
+    return false;
+  }
+  string err;
+  *i = strict_strtol(name.substr(dash + 1).c_str(), 10, &err);
+  if (!err.empty()) {
+    return false;
+  }
+  *prefix = name.substr(0, dash);
+  return true;
+}
+
+int RocksDBStore::load_sharding(
+  const vector<string>& existing_cfs,
+  const std::vector<rocksdb::ColumnFamilyHandle*>& handles,
+  const vector<ColumnFamily>* cfs)
+{
+  for (unsigned i = 0; i < existing_cfs.size(); ++i) {
+    if (existing_cfs[i] == rocksdb::kDefaultColumnFamilyName) {
+      continue;
+    }
+    string prefix;
+    unsigned n;
+    string def;
+    if (!split_sharded_cf_name(existing_cfs[i], &prefix, &n) ||
+	!db->Get(rocksdb::ReadOptions(), default_cf,
+		 combine_strings(SHARDING_PREFIX, prefix), &def).ok()) {
+      add_column_family(existing_cfs[i], static_cast<void*>(handles[i]));
+      continue;
+    }
+    auto& shards = cf_shards[prefix];
+    if (shards.handles.empty()) {
+      string p;
+      unsigned count;
+      if (parse_sharded_cf(def, &p, &count, &shards) != 1 || p != prefix) {
+	derr << __func__ << " bad sharding definition '" << def
+	     << "' for prefix " << prefix << dendl;
+	return -EINVAL;
+      }
+      shards.handles.resize(count);
+      if (cfs) {
+	for (auto& c : *cfs) {
+	  if (c.name != def && c.name.compare(0, prefix.size() + 1,
+					      prefix + "(") == 0) {
+	    dout(1) << __func__ << " prefix " << prefix << " sharded as "
+		    << def << ", ignoring requested " << c.name << dendl;
+	  }
+	}
+      }
+    }
+    if (n >= shards.handles.size() || shards.handles[n]) {
+      derr << __func__ << " unexpected column family " << existing_cfs[i]
+	   << " for sharding " << def << dendl;
+      return -EINVAL;
+    }
+    shards.handles[n] = handles[i];
+  }
+  for (auto& p : cf_shards) {
+    for (unsigned i = 0; i < p.second.handles.size(); ++i) {
+      if (!p.second.handles[i]) {
+	derr << __func__ << " missing column family "
+	     << sharded_cf_name(p.first, i) << dendl;
+	return -EINVAL;
+      }
+    }
+  }
+  return 0;
+}
+
 int RocksDBStore::create_and_open(ostream &out,
 				  const vector<ColumnFamily>& cfs)
 {
@@ -482,9 +629,20 @@ int RocksDBStore::do_open(ostream &out,
       derr << status.ToString() << dendl;
       return -EINVAL;
     }
+    default_cf = db->DefaultColumnFamily();
     // create and open column families
     if (cfs) {
       for (auto& p : *cfs) {
+	string prefix;
+	unsigned count = 1;
+	prefix_shards shards;
+	r = parse_sharded_cf(p.name, &prefix, &count, &shards);
+	if (r < 0) {
+	  derr << __func__ << " invalid column family sharding: "
+	       << p.name << dendl;
+	  return r;
+	}
+	bool sharded = r > 0;
 	// copy default CF settings, block cache, merge operators as
 	// the base for new CF
 	rocksdb::ColumnFamilyOptions cf_opt(opt);
@@ -496,19 +654,35 @@ int RocksDBStore::do_open(ostream &out,
 	       << p.name << dendl;
 	  return -EINVAL;
 	}
-	install_cf_mergeop(p.name, &cf_opt);
-	rocksdb::ColumnFamilyHandle *cf;
-	status = db->CreateColumnFamily(cf_opt, p.name, &cf);
-	if (!status.ok()) {
-	  derr << __func__ << " Failed to create rocksdb column family: "
-	       << p.name << dendl;
-	  return -EINVAL;
+	install_cf_mergeop(prefix, &cf_opt);
+	for (unsigned i = 0; i < count; ++i) {
+	  string name = sharded ? sharded_cf_name(prefix, i) : prefix;
+	  rocksdb::ColumnFamilyHandle *cf;
+	  status = db->CreateColumnFamily(cf_opt, name, &cf);
+	  if (!status.ok()) {
+	    derr << __func__ << " Failed to create rocksdb column family: "
+		 << name << dendl;
+	    return -EINVAL;
+	  }
+	  if (sharded) {
+	    shards.handles.push_back(cf);
+	  } else {
+	    // store the new CF handle
+	    add_column_family(name, static_cast<void*>(cf));
+	  }
+	}
+	if (sharded) {
+	  status = db->Put(rocksdb::WriteOptions(), default_cf,
+			   combine_strings(SHARDING_PREFIX, prefix), p.name);
+	  if (!status.ok()) {
+	    derr << __func__ << " failed to store sharding " << p.name
+		 << ": " << status.ToString() << dendl;
+	    return -EIO;
+	  }
+	  cf_shards[prefix] = std::move(shards);
 	}
-	// store the new CF handle
-	add_column_family(p.name, static_cast<void*>(cf));
       }
     }
-    default_cf = db->DefaultColumnFamily();
   } else {
     std::vector<string> existing_cfs;
     status = rocksdb::DB::ListColumnFamilies(
@@ -537,9 +711,16 @@ int RocksDBStore::do_open(ostream &out,
 	// the base for new CF
 	rocksdb::ColumnFamilyOptions cf_opt(opt);
 	bool found = false;
+	// shards "prefix-i" take the options of "prefix(count...)"
+	string shard_prefix;
+	unsigned shard;
+	bool maybe_shard = split_sharded_cf_name(n, &shard_prefix, &shard);
 	if (cfs) {
 	  for (auto& i : *cfs) {
-	    if (i.name == n) {
+	    if (i.name == n ||
+		(maybe_shard &&
+		 i.name.compare(0, shard_prefix.size() + 1,
+				shard_prefix + "(") == 0)) {
 	      found = true;
 	      status = rocksdb::GetColumnFamilyOptionsFromString(
 		cf_opt, i.option, &cf_opt);
@@ -553,6 +734,9 @@ int RocksDBStore::do_open(ostream &out,
 	}
 	if (n != rocksdb::kDefaultColumnFamilyName) {
 	  install_cf_mergeop(n, &cf_opt);
+	  if (maybe_shard && !cf_opt.merge_operator) {
+	    install_cf_mergeop(shard_prefix, &cf_opt);
+	  }
 	}
 	column_families.push_back(rocksdb::ColumnFamilyDescriptor(n, cf_opt));
 	if (!found && n != rocksdb::kDefaultColumnFamilyName) {
@@ -577,10 +761,13 @@ int RocksDBStore::do_open(ostream &out,
 	if (existing_cfs[i] == rocksdb::kDefaultColumnFamilyName) {
 	  default_cf = handles[i];
 	  must_close_default_cf = true;
-	} else {
-	  add_column_family(existing_cfs[i], static_cast<void*>(handles[i]));
 	}
       }
+      ceph_assert(default_cf != nullptr);
+      r = load_sharding(existing_cfs, handles, cfs);
+      if (r < 0) {
+	return r;
+      }
     }
   }
   ceph_assert(default_cf != nullptr);
@@ -604,6 +791,16 @@ int RocksDBStore::do_open(ostream &out,
   logger = plb.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
 
+  auto trace_file = cct->_conf.get_val<std::string>("rocksdb_trace_file");
+  if (!trace_file.empty() && !open_readonly) {
+    trace.open(trace_file, std::ios::out | std::ios::app);
+    if (trace) {
+      tracing = true;
+    } else {
+      derr << __func__ << " failed to open trace file " << trace_file << dendl;
+    }
+  }
+
   if (compact_on_mount) {
     derr << "Compacting rocksdb store..." << dendl;
     compact();
@@ -634,6 +831,14 @@ RocksDBStore::~RocksDBStore()
       static_cast<rocksdb::ColumnFamilyHandle*>(p.second));
     p.second = nullptr;
   }
+  for (auto& p : cf_shards) {
+    for (auto& cf : p.second.handles) {
+      if (cf) {
+	db->DestroyColumnFamilyHandle(cf);
+	cf = nullptr;
+      }
+    }
+  }
   if (must_close_default_cf) {
     db->DestroyColumnFamilyHandle(default_cf);
     must_close_default_cf = false;
@@ -662,6 +867,12 @@ void RocksDBStore::close()
 
   if (logger)
     cct->get_perfcounters_collection()->remove(logger);
+
+  if (tracing) {
+    Mutex::Locker l(trace_lock);
+    trace.close();
+    tracing = false;
+  }
 }
 
 int RocksDBStore::repair(std::ostream &out)
@@ -694,6 +905,7 @@ void RocksDBStore::split_stats(const std::string &s, char delim, std::vector<std
 int64_t RocksDBStore::estimate_prefix_size(const string& prefix)
 {
   auto cf = get_cf_handle(prefix);
+  auto shards = get_cf_shards(prefix);
   uint64_t size = 0;
   uint8_t flags =
     //rocksdb::DB::INCLUDE_MEMTABLES |  // do not include memtables...
@@ -703,6 +915,15 @@ int64_t RocksDBStore::estimate_prefix_size(const string& prefix)
     string limit("\xff\xff\xff\xff");
     rocksdb::Range r(start, limit);
     db->GetApproximateSizes(cf, &r, 1, &size, flags);
+  } else if (shards) {
+    string start(1, '\x00');
+    string limit("\xff\xff\xff\xff");
+    rocksdb::Range r(start, limit);
+    for (auto h : shards->handles) {
+      uint64_t s = 0;
+      db->GetApproximateSizes(h, &r, 1, &s, flags);
+      size += s;
+    }
   } else {
     string limit = prefix + "\xff\xff\xff\xff";
     rocksdb::Range r(prefix, limit);
@@ -793,6 +1014,9 @@ int RocksDBStore::submit_common(rocksdb::WriteOptions& woptions, KeyValueDB::Tra
     _t->bat.Iterate(&rocks_txc);
     derr << __func__ << " error: " << s.ToString() << " code = " << s.code()
          << " Rocksdb transaction: " << rocks_txc.seen << dendl;
+  } else if (tracing && !_t->trace_ops.empty()) {
+    Mutex::Locker l(trace_lock);
+    trace << "txn " << (woptions.sync ? 1 : 0) << "\n" << _t->trace_ops;
   }
 
   if (g_conf()->rocksdb_perf) {
@@ -853,6 +1077,33 @@ RocksDBStore::RocksDBTransactionImpl::RocksDBTransactionImpl(RocksDBStore *_db)
   db = _db;
 }
 
+/*
+ * One line per op: the op, the prefix, a hash and the length of the key,
+ * and the length of the value if there is one. Keys are only hashed, and
+ * values never logged, so that traces can be shared.
+ */
+void RocksDBStore::RocksDBTransactionImpl::trace_op(
+  const char *op,
+  const string &prefix,
+  const char *k, size_t keylen,
+  int64_t vallen)
+{
+  if (!db->tracing)
+    return;
+  char buf[64];
+  size_t h = std::hash<std::string_view>{}(std::string_view(k, keylen));
+  int n = snprintf(buf, sizeof(buf), " %016llx %zu", (unsigned long long)h,
+		   keylen);
+  trace_ops.append(op);
+  trace_ops.push_back(' ');
+  trace_ops.append(prefix);
+  trace_ops.append(buf, n);
+  if (vallen >= 0) {
+    trace_ops.append(" " + std::to_string(vallen));
+  }
+  trace_ops.push_back('\n');
+}
+
 void RocksDBStore::RocksDBTransactionImpl::put_bat(
   rocksdb::WriteBatch& bat,
   rocksdb::ColumnFamilyHandle *cf,
@@ -879,7 +1130,8 @@ void RocksDBStore::RocksDBTransactionImpl::set(
   const string &k,
   const bufferlist &to_set_bl)
 {
-  auto cf = db->get_cf_handle(prefix);
+  trace_op("set", prefix, k.data(), k.size(), to_set_bl.length());
+  auto cf = db->get_cf_handle(prefix, k);
   if (cf) {
     put_bat(bat, cf, k, to_set_bl);
   } else {
@@ -893,7 +1145,8 @@ void RocksDBStore::RocksDBTransactionImpl::set(
   const char *k, size_t keylen,
   const bufferlist &to_set_bl)
 {
-  auto cf = db->get_cf_handle(prefix);
+  trace_op("set", prefix, k, keylen, to_set_bl.length());
+  auto cf = db->get_cf_handle(prefix, k, keylen);
   if (cf) {
     string key(k, keylen);  // fixme?
     put_bat(bat, cf, key, to_set_bl);
@@ -907,7 +1160,8 @@ void RocksDBStore::RocksDBTransactionImpl::set(
 void RocksDBStore::RocksDBTransactionImpl::rmkey(const string &prefix,
 					         const string &k)
 {
-  auto cf = db->get_cf_handle(prefix);
+  trace_op("rm", prefix, k.data(), k.size());
+  auto cf = db->get_cf_handle(prefix, k);
   if (cf) {
     bat.Delete(cf, rocksdb::Slice(k));
   } else {
@@ -919,7 +1173,8 @@ void RocksDBStore::RocksDBTransactionImpl::rmkey(const string &prefix,
 					         const char *k,
 						 size_t keylen)
 {
-  auto cf = db->get_cf_handle(prefix);
+  trace_op("rm", prefix, k, keylen);
+  auto cf = db->get_cf_handle(prefix, k, keylen);
   if (cf) {
     bat.Delete(cf, rocksdb::Slice(k, keylen));
   } else {
@@ -932,7 +1187,8 @@ void RocksDBStore::RocksDBTransactionImpl::rmkey(const string &prefix,
 void RocksDBStore::RocksDBTransactionImpl::rm_single_key(const string &prefix,
 					                 const string &k)
 {
-  auto cf = db->get_cf_handle(prefix);
+  trace_op("rm_single", prefix, k.data(), k.size());
+  auto cf = db->get_cf_handle(prefix, k);
   if (cf) {
     bat.SingleDelete(cf, k);
   } else {
@@ -942,6 +1198,11 @@ void RocksDBStore::RocksDBTransactionImpl::rm_single_key(const string &prefix,
 
 void RocksDBStore::RocksDBTransactionImpl::rmkeys_by_prefix(const string &prefix)
 {
+  trace_op("rm_prefix", prefix, nullptr, 0);
+  if (auto shards = db->get_cf_shards(prefix); shards) {
+    rm_sharded_range(*shards, prefix, string(), string("\xff\xff\xff\xff"));
+    return;
+  }
   auto cf = db->get_cf_handle(prefix);
   if (cf) {
     if (db->enable_rmrange) {
@@ -1015,6 +1276,11 @@ void RocksDBStore::RocksDBTransactionImpl::rm_range_keys(const string &prefix,
                                                          const string &start,
                                                          const string &end)
 {
+  trace_op("rm_range", prefix, start.data(), start.size());
+  if (auto shards = db->get_cf_shards(prefix); shards) {
+    rm_sharded_range(*shards, prefix, start, end);
+    return;
+  }
   auto cf = db->get_cf_handle(prefix);
   if (cf) {
     if (db->enable_rmrange) {
@@ -1097,12 +1363,55 @@ void RocksDBStore::RocksDBTransactionImpl::rm_range_keys(const string &prefix,
   }
 }
 
+void RocksDBStore::RocksDBTransactionImpl::rm_sharded_range(
+  const prefix_shards& shards,
+  const string &prefix,
+  const string &start,
+  const string &end)
+{
+  // a key range spans every shard of the prefix
+  if (db->enable_rmrange && !db->max_items_rmrange) {
+    for (auto cf : shards.handles) {
+      bat.DeleteRange(cf, rocksdb::Slice(start), rocksdb::Slice(end));
+    }
+    return;
+  }
+  uint64_t cnt = db->max_items_rmrange;
+  if (db->enable_rmrange) {
+    bat.SetSavePoint();
+  }
+  auto it = db->get_iterator(prefix);
+  it->lower_bound(start);
+  while (it->valid()) {
+    string k = it->key();
+    if (k >= end) {
+      break;
+    }
+    if (db->enable_rmrange) {
+      if (!cnt) {
+	bat.RollbackToSavePoint();
+	for (auto cf : shards.handles) {
+	  bat.DeleteRange(cf, rocksdb::Slice(start), rocksdb::Slice(end));
+	}
+	return;
+      }
+      --cnt;
+    }
+    bat.Delete(shards.get(k.data(), k.size()), rocksdb::Slice(k));
+    it->next();
+  }
+  if (db->enable_rmrange) {
+    bat.PopSavePoint();
+  }
+}
+
 void RocksDBStore::RocksDBTransactionImpl::merge(
   const string &prefix,
   const string &k,
   const bufferlist &to_set_bl)
 {
-  auto cf = db->get_cf_handle(prefix);
+  trace_op("merge", prefix, k.data(), k.size(), to_set_bl.length());
+  auto cf = db->get_cf_handle(prefix, k);
   if (cf) {
     // bufferlist::c_str() is non-constant, so we can't call c_str()
     if (to_set_bl.is_contiguous() && to_set_bl.length() > 0) {
@@ -1144,33 +1453,38 @@ int RocksDBStore::get(
 {
   utime_t start = ceph_clock_now();
   auto cf = get_cf_handle(prefix);
-  if (cf) {
+  auto shards = get_cf_shards(prefix);
+  // one MultiGet looks the keys up under a single version and lets rocksdb
+  // share the memtable and block cache lookups between them
+  std::vector<rocksdb::ColumnFamilyHandle*> cfs;
+  std::vector<string> combined;
+  std::vector<rocksdb::Slice> slices;
+  cfs.reserve(keys.size());
+  slices.reserve(keys.size());
+  if (cf || shards) {
     for (auto& key : keys) {
-      std::string value;
-      auto status = db->Get(rocksdb::ReadOptions(),
-			    cf,
-			    rocksdb::Slice(key),
-			    &value);
-      if (status.ok()) {
-	(*out)[key].append(value);
-      } else if (status.IsIOError()) {
-	ceph_abort_msg(status.getState());
-      }
+      cfs.push_back(shards ? shards->get(key.data(), key.size()) : cf);
+      slices.emplace_back(key);
     }
   } else {
+    combined.reserve(keys.size());
     for (auto& key : keys) {
-      std::string value;
-      string k = combine_strings(prefix, key);
-      auto status = db->Get(rocksdb::ReadOptions(),
-			    default_cf,
-			    rocksdb::Slice(k),
-			    &value);
-      if (status.ok()) {
-	(*out)[key].append(value);
-      } else if (status.IsIOError()) {
-	ceph_abort_msg(status.getState());
-      }
+      combined.push_back(combine_strings(prefix, key));
+      cfs.push_back(default_cf);
+      slices.emplace_back(combined.back());
+    }
+  }
+  std::vector<std::string> values;
+  auto statuses = db->MultiGet(rocksdb::ReadOptions(), cfs, slices, &values);
+  size_t i = 0;
+  for (auto& key : keys) {
+    auto& status = statuses[i];
+    if (status.ok()) {
+      (*out)[key].append(values[i]);
+    } else if (status.IsIOError()) {
+      ceph_abort_msg(status.getState());
     }
+    ++i;
   }
   utime_t lat = ceph_clock_now() - start;
   logger->inc(l_rocksdb_gets);
@@ -1188,7 +1502,7 @@ int RocksDBStore::get(
   int r = 0;
   string value;
   rocksdb::Status s;
-  auto cf = get_cf_handle(prefix);
+  auto cf = get_cf_handle(prefix, key);
   if (cf) {
     s = db->Get(rocksdb::ReadOptions(),
 		cf,
@@ -1225,7 +1539,7 @@ int RocksDBStore::get(
   int r = 0;
   string value;
   rocksdb::Status s;
-  auto cf = get_cf_handle(prefix);
+  auto cf = get_cf_handle(prefix, key, keylen);
   if (cf) {
     s = db->Get(rocksdb::ReadOptions(),
 		cf,
@@ -1283,6 +1597,11 @@ void RocksDBStore::compact()
       static_cast<rocksdb::ColumnFamilyHandle*>(cf.second),
       nullptr, nullptr);
   }
+  for (auto& p : cf_shards) {
+    for (auto cf : p.second.handles) {
+      db->CompactRange(options, cf, nullptr, nullptr);
+    }
+  }
 }
 
 
@@ -1367,6 +1686,39 @@ void RocksDBStore::compact_range(const string& start, const string& end)
   rocksdb::Slice cstart(start);
   rocksdb::Slice cend(end);
   db->CompactRange(options, &cstart, &cend);
+  // keys of the prefixes that live in column families of their own are
+  // stored without the prefix; compact the part of [start, end) they hold
+  auto compact_cfs = [&](const string& prefix,
+			 const std::vector<rocksdb::ColumnFamilyHandle*>& cfs) {
+    string first = combine_strings(prefix, string());
+    string last = past_prefix(prefix);
+    if (end <= first || start >= last) {
+      return;
+    }
+    // anything strictly between first and last leads with first
+    string lo, hi;
+    rocksdb::Slice slo, shi;
+    if (start > first) {
+      lo = start.substr(first.size());
+      slo = rocksdb::Slice(lo);
+    }
+    if (end < last) {
+      hi = end.substr(first.size());
+      shi = rocksdb::Slice(hi);
+    }
+    for (auto cf : cfs) {
+      db->CompactRange(options, cf,
+		       lo.empty() ? nullptr : &slo,
+		       end < last ? &shi : nullptr);
+    }
+  };
+  for (auto& cf : cf_handles) {
+    compact_cfs(cf.first,
+		{static_cast<rocksdb::ColumnFamilyHandle*>(cf.second)});
+  }
+  for (auto& p : cf_shards) {
+    compact_cfs(p.first, p.second.handles);
+  }
 }
 
 RocksDBStore::RocksDBWholeSpaceIteratorImpl::~RocksDBWholeSpaceIteratorImpl()
@@ -1491,6 +1843,35 @@ int RocksDBStore::RocksDBWholeSpaceIteratorImpl::status()
   return dbiter->status().ok() ? 0 : -1;
 }
 
+int RocksDBStore::RocksDBWholeSpaceIteratorImpl::next_batch(
+  const string &prefix,
+  const string &end,
+  size_t max,
+  size_t max_bytes,
+  kv_batch_t *batch)
+{
+  // copy straight out of the iterator's slices, skipping "prefix\0"
+  rocksdb::Slice end_slice(end);
+  for (size_t n = 0; n < max && dbiter->Valid(); ++n) {
+    rocksdb::Slice k = dbiter->key();
+    if (k.size() <= prefix.length() || k[prefix.length()] != '\0' ||
+	memcmp(k.data(), prefix.c_str(), prefix.length()) != 0) {
+      break;
+    }
+    k.remove_prefix(prefix.length() + 1);
+    if (!end.empty() && k.compare(end_slice) >= 0) {
+      break;
+    }
+    rocksdb::Slice v = dbiter->value();
+    if (!batch->append(k.data(), k.size(), v.data(), v.size(), max_bytes)) {
+      break;
+    }
+    dbiter->Next();
+  }
+  ceph_assert(!dbiter->status().IsIOError());
+  return dbiter->status().ok() ? 0 : -1;
+}
+
 string RocksDBStore::past_prefix(const string &prefix)
 {
   string limit = prefix;
@@ -1508,10 +1889,13 @@ class CFIteratorImpl : public KeyValueDB::IteratorImpl {
 protected:
   string prefix;
   rocksdb::Iterator *dbiter;
+  std::unique_ptr<RocksDBStore::IteratorBounds> bounds;
 public:
-  explicit CFIteratorImpl(const std::string& p,
-				 rocksdb::Iterator *iter)
-    : prefix(p), dbiter(iter) { }
+  explicit CFIteratorImpl(
+    const std::string& p,
+    rocksdb::Iterator *iter,
+    std::unique_ptr<RocksDBStore::IteratorBounds> b = nullptr)
+    : prefix(p), dbiter(iter), bounds(std::move(b)) { }
   ~CFIteratorImpl() {
     delete dbiter;
   }
@@ -1567,17 +1951,222 @@ public:
   int status() override {
     return dbiter->status().ok() ? 0 : -1;
   }
+  int next_batch(const string &end, size_t max, size_t max_bytes,
+		 kv_batch_t *batch) override {
+    rocksdb::Slice end_slice(end);
+    for (size_t n = 0; n < max && dbiter->Valid(); ++n) {
+      rocksdb::Slice k = dbiter->key();
+      if (!end.empty() && k.compare(end_slice) >= 0) {
+	break;
+      }
+      rocksdb::Slice v = dbiter->value();
+      if (!batch->append(k.data(), k.size(), v.data(), v.size(), max_bytes)) {
+	break;
+      }
+      dbiter->Next();
+    }
+    return dbiter->status().ok() ? 0 : -1;
+  }
+};
+
+// Walks a hash sharded prefix in key order by merging one iterator per
+// shard.  A key lives in exactly one shard, so there are no ties to break.
+class ShardMergeIteratorImpl : public KeyValueDB::IteratorImpl {
+  string prefix;
+  const rocksdb::Comparator *comparator;
+  // outlives iters, which refer to it
+  std::unique_ptr<RocksDBStore::IteratorBounds> bounds;
+  std::vector<std::unique_ptr<rocksdb::Iterator>> iters;
+  int cur = -1;
+  bool forward = true;
+
+  void pick() {
+    cur = -1;
+    for (unsigned i = 0; i < iters.size(); ++i) {
+      if (!iters[i]->Valid()) {
+	continue;
+      }
+      if (cur < 0) {
+	cur = i;
+	continue;
+      }
+      int c = comparator->Compare(iters[i]->key(), iters[cur]->key());
+      if (forward ? c < 0 : c > 0) {
+	cur = i;
+      }
+    }
+  }
+public:
+  ShardMergeIteratorImpl(const std::string& p,
+			 rocksdb::DB *db,
+			 const rocksdb::ReadOptions& ro,
+			 const std::vector<rocksdb::ColumnFamilyHandle*>& handles,
+			 std::unique_ptr<RocksDBStore::IteratorBounds> b = nullptr)
+    : prefix(p), comparator(handles.front()->GetComparator()),
+      bounds(std::move(b)) {
+    for (auto cf : handles) {
+      iters.emplace_back(db->NewIterator(ro, cf));
+    }
+  }
+
+  int seek_to_first() override {
+    for (auto& it : iters) {
+      it->SeekToFirst();
+    }
+    forward = true;
+    pick();
+    return status();
+  }
+  int seek_to_last() override {
+    for (auto& it : iters) {
+      it->SeekToLast();
+    }
+    forward = false;
+    pick();
+    return status();
+  }
+  int upper_bound(const string &after) override {
+    lower_bound(after);
+    if (valid() && (key() == after)) {
+      next();
+    }
+    return status();
+  }
+  int lower_bound(const string &to) override {
+    rocksdb::Slice slice_bound(to);
+    for (auto& it : iters) {
+      it->Seek(slice_bound);
+    }
+    forward = true;
+    pick();
+    return status();
+  }
+  int next() override {
+    if (!valid()) {
+      return status();
+    }
+    if (!forward) {
+      // the other shards sit before the current key; move them past it
+      string k = iters[cur]->key().ToString();
+      for (unsigned i = 0; i < iters.size(); ++i) {
+	if ((int)i != cur) {
+	  iters[i]->Seek(k);
+	}
+      }
+      forward = true;
+    }
+    iters[cur]->Next();
+    pick();
+    return status();
+  }
+  int prev() override {
+    if (!valid()) {
+      return status();
+    }
+    if (forward) {
+      // the other shards sit after the current key; move them before it
+      string k = iters[cur]->key().ToString();
+      for (unsigned i = 0; i < iters.size(); ++i) {
+	if ((int)i == cur) {
+	  continue;
+	}
+	iters[i]->Seek(k);
+	if (iters[i]->Valid()) {
+	  iters[i]->Prev();
+	} else {
+	  iters[i]->SeekToLast();
+	}
+      }
+      forward = false;
+    }
+    iters[cur]->Prev();
+    pick();
+    return status();
+  }
+  bool valid() override {
+    return cur >= 0 && iters[cur]->Valid();
+  }
+  string key() override {
+    return iters[cur]->key().ToString();
+  }
+  std::pair<std::string, std::string> raw_key() override {
+    return make_pair(prefix, key());
+  }
+  bufferlist value() override {
+    return to_bufferlist(iters[cur]->value());
+  }
+  bufferptr value_as_ptr() override {
+    rocksdb::Slice val = iters[cur]->value();
+    return bufferptr(val.data(), val.size());
+  }
+  int status() override {
+    for (auto& it : iters) {
+      if (!it->status().ok()) {
+	return -1;
+      }
+    }
+    return 0;
+  }
 };
 
 KeyValueDB::Iterator RocksDBStore::get_iterator(const std::string& prefix)
 {
+  return get_iterator(prefix, 0);
+}
+
+KeyValueDB::Iterator RocksDBStore::get_iterator(const std::string& prefix,
+						size_t readahead)
+{
+  rocksdb::ReadOptions ro;
+  ro.readahead_size = readahead;
+  if (auto shards = get_cf_shards(prefix); shards) {
+    return std::make_shared<ShardMergeIteratorImpl>(
+      prefix, db, ro, shards->handles);
+  }
   rocksdb::ColumnFamilyHandle *cf_handle =
     static_cast<rocksdb::ColumnFamilyHandle*>(get_cf_handle(prefix));
   if (cf_handle) {
     return std::make_shared<CFIteratorImpl>(
       prefix,
-      db->NewIterator(rocksdb::ReadOptions(), cf_handle));
+      db->NewIterator(ro, cf_handle));
   } else {
-    return KeyValueDB::get_iterator(prefix);
+    return std::make_shared<PrefixIteratorImpl>(
+      prefix,
+      std::make_shared<RocksDBWholeSpaceIteratorImpl>(
+	db->NewIterator(ro, default_cf)));
+  }
+}
+
+KeyValueDB::Iterator RocksDBStore::get_bounded_iterator(
+  const std::string& prefix,
+  const std::string& lower,
+  const std::string& upper,
+  size_t readahead)
+{
+  rocksdb::ReadOptions ro;
+  ro.readahead_size = readahead;
+  if (auto shards = get_cf_shards(prefix); shards) {
+    auto bounds = std::make_unique<IteratorBounds>(lower, upper);
+    bounds->apply(&ro);
+    return std::make_shared<ShardMergeIteratorImpl>(
+      prefix, db, ro, shards->handles, std::move(bounds));
   }
+  rocksdb::ColumnFamilyHandle *cf_handle =
+    static_cast<rocksdb::ColumnFamilyHandle*>(get_cf_handle(prefix));
+  if (cf_handle) {
+    auto bounds = std::make_unique<IteratorBounds>(lower, upper);
+    bounds->apply(&ro);
+    return std::make_shared<CFIteratorImpl>(
+      prefix, db->NewIterator(ro, cf_handle), std::move(bounds));
+  }
+  // keys of the default column family lead with their prefix
+  auto bounds = std::make_unique<IteratorBounds>(
+    combine_strings(prefix, lower),
+    upper.empty() ? past_prefix(prefix) : combine_strings(prefix, upper));
+  bounds->apply(&ro);
+  rocksdb::Iterator *dbiter = db->NewIterator(ro, default_cf);
+  return std::make_shared<PrefixIteratorImpl>(
+    prefix,
+    std::make_shared<RocksDBWholeSpaceIteratorImpl>(
+      dbiter, std::move(bounds)));
 }
@@ -10,6 +10,7 @@
 #include <map>
 #include <string>
 #include <memory>
+#include <fstream>
 #include <boost/scoped_ptr.hpp>
 #include "rocksdb/write_batch.h"
 #include "rocksdb/perf_context.h"
@@ -87,6 +88,31 @@ class RocksDBStore : public KeyValueDB {
   bool must_close_default_cf = false;
   rocksdb::ColumnFamilyHandle *default_cf = nullptr;
 
+  /// a prefix spread over several column families by key hash
+  struct prefix_shards {
+    uint32_t hash_l = 0;           ///< first key byte hashed
+    uint32_t hash_h = UINT32_MAX;  ///< one past the last key byte hashed
+    std::vector<rocksdb::ColumnFamilyHandle*> handles;
+
+    rocksdb::ColumnFamilyHandle *get(const char *key, size_t keylen) const;
+  };
+  /// sharded prefixes; unsharded column families live in cf_handles
+  std::unordered_map<std::string, prefix_shards> cf_shards;
+
+  /// parse "prefix(count[,l-h])"; 1 if sharded, 0 if plain, <0 on error
+  static int parse_sharded_cf(const string& name,
+			      string *prefix,
+			      unsigned *count,
+			      prefix_shards *shards);
+  static string sharded_cf_name(const string& prefix, unsigned i);
+  /// split "prefix-i" into its parts; false if it is not a shard name
+  static bool split_sharded_cf_name(const string& name,
+				    string *prefix,
+				    unsigned *i);
+  int load_sharding(const vector<string>& existing_cfs,
+		    const std::vector<rocksdb::ColumnFamilyHandle*>& handles,
+		    const vector<ColumnFamily>* cfs);
+
   int submit_common(rocksdb::WriteOptions& woptions, KeyValueDB::Transaction t);
   int install_cf_mergeop(const string &cf_name, rocksdb::ColumnFamilyOptions *cf_opt);
   int create_db_dir();
@@ -121,6 +147,12 @@ public:
   bool disableWAL;
   bool enable_rmrange;
   const uint64_t max_items_rmrange;
+
+  /// transaction trace, see rocksdb_trace_file
+  Mutex trace_lock;
+  std::ofstream trace;
+  bool tracing = false;
+
   void compact() override;
 
   void compact_async() override {
@@ -161,7 +193,8 @@ public:
     compact_on_mount(false),
     disableWAL(false),
     enable_rmrange(cct->_conf->rocksdb_enable_rmrange),
-    max_items_rmrange(cct->_conf.get_val<uint64_t>("rocksdb_max_items_rmrange"))
+    max_items_rmrange(cct->_conf.get_val<uint64_t>("rocksdb_max_items_rmrange")),
+    trace_lock("RocksDBStore::trace_lock")
   {}
 
   ~RocksDBStore() override;
@@ -188,6 +221,29 @@ public:
     else
       return static_cast<rocksdb::ColumnFamilyHandle*>(iter->second);
   }
+  /// column family holding a key, for sharded and unsharded prefixes
+  rocksdb::ColumnFamilyHandle *get_cf_handle(const std::string& prefix,
+					     const char *key, size_t keylen) {
+    if (!cf_shards.empty()) {
+      auto p = cf_shards.find(prefix);
+      if (p != cf_shards.end()) {
+	return p->second.get(key, keylen);
+      }
+    }
+    return get_cf_handle(prefix);
+  }
+  rocksdb::ColumnFamilyHandle *get_cf_handle(const std::string& prefix,
+					     const std::string& key) {
+    return get_cf_handle(prefix, key.data(), key.size());
+  }
+  /// hash shards of a prefix, or nullptr if it is not sharded
+  const prefix_shards *get_cf_shards(const std::string& prefix) const {
+    if (cf_shards.empty()) {
+      return nullptr;
+    }
+    auto p = cf_shards.find(prefix);
+    return p == cf_shards.end() ? nullptr : &p->second;
+  }
   int repair(std::ostream &out) override;
   void split_stats(const std::string &s, char delim, std::vector<std::string> &elems);
   void get_statistics(Formatter *f) override;
@@ -294,14 +350,23 @@ public:
   public:
     rocksdb::WriteBatch bat;
     RocksDBStore *db;
+    /// trace lines of the ops, if the store is tracing
+    std::string trace_ops;
 
     explicit RocksDBTransactionImpl(RocksDBStore *_db);
   private:
+    void trace_op(const char *op, const string &prefix,
+		  const char *k, size_t keylen, int64_t vallen = -1);
     void put_bat(
       rocksdb::WriteBatch& bat,
       rocksdb::ColumnFamilyHandle *cf,
       const string &k,
       const bufferlist &to_set_bl);
+    void rm_sharded_range(
+      const prefix_shards& shards,
+      const string &prefix,
+      const string &start,
+      const string &end);
   public:
     void set(
       const string &prefix,
@@ -358,13 +423,34 @@ public:
     bufferlist *out) override;
 
 
+  /// keys an iterator was created for; rocksdb refers to them for as
+  /// long as the iterator lives
+  struct IteratorBounds {
+    std::string lower, upper;
+    rocksdb::Slice lower_slice, upper_slice;
+
+    IteratorBounds(std::string l, std::string u)
+      : lower(std::move(l)), upper(std::move(u)),
+	lower_slice(lower), upper_slice(upper) {}
+    void apply(rocksdb::ReadOptions *ro) const {
+      ro->iterate_lower_bound = &lower_slice;
+      // an empty upper bound means the end of the column family
+      if (!upper.empty()) {
+	ro->iterate_upper_bound = &upper_slice;
+      }
+    }
+  };
+
   class RocksDBWholeSpaceIteratorImpl :
     public KeyValueDB::WholeSpaceIteratorImpl {
   protected:
     rocksdb::Iterator *dbiter;
+    std::unique_ptr<IteratorBounds> bounds;
   public:
-    explicit RocksDBWholeSpaceIteratorImpl(rocksdb::Iterator *iter) :
-      dbiter(iter) { }
+    explicit RocksDBWholeSpaceIteratorImpl(
+      rocksdb::Iterator *iter,
+      std::unique_ptr<IteratorBounds> b = nullptr) :
+      dbiter(iter), bounds(std::move(b)) { }
     //virtual ~RocksDBWholeSpaceIteratorImpl() { }
     ~RocksDBWholeSpaceIteratorImpl() override;
 
@@ -385,9 +471,16 @@ public:
     int status() override;
     size_t key_size() override;
     size_t value_size() override;
+    int next_batch(const string &prefix, const string &end,
+		   size_t max, size_t max_bytes, kv_batch_t *batch) override;
   };
 
   Iterator get_iterator(const std::string& prefix) override;
+  Iterator get_iterator(const std::string& prefix, size_t readahead) override;
+  Iterator get_bounded_iterator(const std::string& prefix,
+				const std::string& lower,
+				const std::string& upper,
+				size_t readahead = 0) override;
 
   /// Utility
   static string combine_strings(const string &prefix, const string &value) {
@@ -16,6 +16,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
+#include <algorithm>
 
 #define dout_context cct
 #define dout_subsys ceph_subsys_rocksdb
@@ -114,6 +115,7 @@ BinnedLRUCacheShard::BinnedLRUCacheShard(size_t capacity, bool strict_capacity_l
   lru_.next = &lru_;
   lru_.prev = &lru_;
   lru_low_pri_ = &lru_;
+  age_bins_.push_front(std::make_shared<uint64_t>(0));
   SetCapacity(capacity);
 }
 
@@ -187,6 +189,30 @@ size_t BinnedLRUCacheShard::GetHighPriPoolUsage() const {
   return high_pri_pool_usage_;
 }
 
+size_t BinnedLRUCacheShard::GetLRUUsage() const {
+  std::lock_guard<std::mutex> l(mutex_);
+  return lru_usage_;
+}
+
+void BinnedLRUCacheShard::ShiftBins(uint32_t max_bins) {
+  std::lock_guard<std::mutex> l(mutex_);
+  age_bins_.push_front(std::make_shared<uint64_t>(0));
+  // entries still holding a dropped bin just stop being counted in any bin
+  while (age_bins_.size() > std::max<uint32_t>(max_bins, 1)) {
+    age_bins_.pop_back();
+  }
+}
+
+uint64_t BinnedLRUCacheShard::SumBins(uint32_t start, uint32_t end) const {
+  std::lock_guard<std::mutex> l(mutex_);
+  uint64_t bytes = 0;
+  end = std::min<uint32_t>(end, age_bins_.size());
+  for (uint32_t i = start; i < end; i++) {
+    bytes += *age_bins_[i];
+  }
+  return bytes;
+}
+
 void BinnedLRUCacheShard::LRU_Remove(BinnedLRUHandle* e) {
   ceph_assert(e->next != nullptr);
   ceph_assert(e->prev != nullptr);
@@ -197,6 +223,10 @@ void BinnedLRUCacheShard::LRU_Remove(BinnedLRUHandle* e) {
   e->prev->next = e->next;
   e->prev = e->next = nullptr;
   lru_usage_ -= e->charge;
+  if (e->age_bin) {
+    *e->age_bin -= e->charge;
+    e->age_bin.reset();
+  }
   if (e->InHighPriPool()) {
     ceph_assert(high_pri_pool_usage_ >= e->charge);
     high_pri_pool_usage_ -= e->charge;
@@ -224,13 +254,17 @@ void BinnedLRUCacheShard::LRU_Insert(BinnedLRUHandle* e) {
     e->next->prev = e;
     e->SetInHighPriPool(false);
     lru_low_pri_ = e;
+    e->age_bin = age_bins_.front();
+    *e->age_bin += e->charge;
   }
   lru_usage_ += e->charge;
 }
 
 void BinnedLRUCacheShard::MaintainPoolSize() {
   while (high_pri_pool_usage_ > high_pri_pool_capacity_) {
-    // Overflow last entry in high-pri pool to low-pri pool.
+    // Overflow last entry in high-pri pool to low-pri pool.  It is the
+    // least recently used high-pri entry, so leave it out of the age bins
+    // and let it count as old.
     lru_low_pri_ = lru_low_pri_->next;
     ceph_assert(lru_low_pri_ != &lru_);
     lru_low_pri_->SetInHighPriPool(false);
@@ -549,6 +583,22 @@ size_t BinnedLRUCache::GetHighPriPoolUsage() const {
   return usage;
 }
 
+size_t BinnedLRUCache::GetLRUUsage() const {
+  size_t usage = 0;
+  for (int s = 0; s < num_shards_; s++) {
+    usage += shards_[s].GetLRUUsage();
+  }
+  return usage;
+}
+
+uint64_t BinnedLRUCache::SumBins(uint32_t start, uint32_t end) const {
+  uint64_t bytes = 0;
+  for (int s = 0; s < num_shards_; s++) {
+    bytes += shards_[s].SumBins(start, end);
+  }
+  return bytes;
+}
+
 // PriCache
 
 int64_t BinnedLRUCache::request_cache_bytes(PriorityCache::Priority pri, uint64_t total_cache) const
@@ -563,11 +613,26 @@ int64_t BinnedLRUCache::request_cache_bytes(PriorityCache::Priority pri, uint64_
       request = GetHighPriPoolUsage();
       break;
     }
-  // All other cache items are currently shoved into the PRI1 priority. 
+  // PRI1 is for pinned items and items used in the current age bin
   case PriorityCache::Priority::PRI1:
     {
       request = GetUsage();
+      request -= GetLRUUsage();
+      request += SumBins(0, 1);
+      break;
+    }
+  // PRI2 is for items last used within rocksdb_cache_age_bins intervals
+  case PriorityCache::Priority::PRI2:
+    {
+      request = SumBins(1, UINT32_MAX);
+      break;
+    }
+  // PRI3 is for everything older than that
+  case PriorityCache::Priority::PRI3:
+    {
+      request = GetLRUUsage();
       request -= GetHighPriPoolUsage();
+      request -= SumBins(0, UINT32_MAX);
       break;
     }
   default:
@@ -600,6 +665,14 @@ int64_t BinnedLRUCache::commit_cache_size(uint64_t total_bytes)
   return new_bytes;
 }
 
+void BinnedLRUCache::shift_bins()
+{
+  uint32_t max_bins = cct->_conf.get_val<uint64_t>("rocksdb_cache_age_bins");
+  for (int s = 0; s < num_shards_; s++) {
+    shards_[s].ShiftBins(max_bins);
+  }
+}
+
 std::shared_ptr<rocksdb::Cache> NewBinnedLRUCache(
     CephContext *c, 
     size_t capacity,
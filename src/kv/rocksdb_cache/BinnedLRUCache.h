@@ -12,6 +12,8 @@
 
 #include <string>
 #include <mutex>
+#include <deque>
+#include <memory>
 
 #include "ShardedCache.h"
 #include "common/autovector.h"
@@ -75,6 +77,10 @@ struct BinnedLRUHandle {
 
   char* key_data = nullptr;  // Beginning of key
 
+  // Age bin this entry was charged to when it was last put on the LRU list;
+  // null while the entry is pinned or in the high-pri pool.
+  std::shared_ptr<uint64_t> age_bin;
+
   rocksdb::Slice key() const {
     // For cheaper lookups, we allow a temporary Handle object
     // to store a pointer to a key in "value".
@@ -224,6 +230,16 @@ class alignas(CACHE_LINE_SIZE) BinnedLRUCacheShard : public CacheShard {
   // Retrieves high pri pool usage
   size_t GetHighPriPoolUsage() const;
 
+  // Retrieves usage of the LRU list (entries that are not pinned)
+  size_t GetLRUUsage() const;
+
+  // Start a new age bin, keeping at most max_bins of them.  Entries in bins
+  // that fall off the end are still on the LRU list but no longer binned.
+  void ShiftBins(uint32_t max_bins);
+
+  // Sum of the low-pri LRU bytes in age bins [start, end), newest first
+  uint64_t SumBins(uint32_t start, uint32_t end) const;
+
  private:
   void LRU_Remove(BinnedLRUHandle* e);
   void LRU_Insert(BinnedLRUHandle* e);
@@ -266,6 +282,10 @@ class alignas(CACHE_LINE_SIZE) BinnedLRUCacheShard : public CacheShard {
   // Pointer to head of low-pri pool in LRU list.
   BinnedLRUHandle* lru_low_pri_;
 
+  // Bytes of low-pri LRU entries by the interval they were last used in.
+  // age_bins_.front() is the current bin.
+  std::deque<std::shared_ptr<uint64_t>> age_bins_;
+
   // ------------^^^^^^^^^^^^^-----------
   // Not frequently modified data members
   // ------------------------------------
@@ -312,11 +332,16 @@ class BinnedLRUCache : public ShardedCache {
   double GetHighPriPoolRatio() const;
   // Retrieves high pri pool usage
   size_t GetHighPriPoolUsage() const;
+  // Retrieves usage of the LRU lists (entries that are not pinned)
+  size_t GetLRUUsage() const;
+  // Sum of the low-pri LRU bytes in age bins [start, end)
+  uint64_t SumBins(uint32_t start, uint32_t end) const;
 
   // PriorityCache
   virtual int64_t request_cache_bytes(
       PriorityCache::Priority pri, uint64_t total_cache) const;
   virtual int64_t commit_cache_size(uint64_t total_cache);
+  virtual void shift_bins();
   virtual int64_t get_committed_size() const {
     return GetCapacity();
   }
@@ -1710,6 +1710,14 @@ extern "C" int64_t ceph_ll_writev(class ceph_mount_info *cmount,
   return (cmount->get_client()->ll_writev(fh, iov, iovcnt, off));
 }
 
+extern "C" int64_t ceph_ll_nonblocking_readv_writev(class ceph_mount_info *cmount,
+						    struct ceph_ll_io_info *io_info)
+{
+  if (!cmount->is_mounted())
+    return -ENOTCONN;
+  return (cmount->get_client()->ll_nonblocking_readv_writev(io_info));
+}
+
 extern "C" int ceph_ll_close(class ceph_mount_info *cmount, Fh* fh)
 {
   return (cmount->get_client()->ll_release(fh));
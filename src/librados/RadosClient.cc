@@ -322,6 +322,11 @@ int librados::RadosClient::connect()
   timer.init();
 
   finisher.start();
+  if (auto n = conf.get_val<uint64_t>("rados_aio_finisher_threads"); n > 1) {
+    aio_finisher = std::make_unique<ShardedFinisher>(
+      cct, "radosclient-aio", "fn-rados-aio", n);
+    aio_finisher->start();
+  }
 
   state = CONNECTED;
   instance_id = monclient.get_global_id();
@@ -376,6 +381,13 @@ void librados::RadosClient::shutdown()
   if (need_objecter) {
     objecter->shutdown();
   }
+  // only now that the objecter is down nothing queues aio completions
+  // anymore, so the finisher can go away
+  if (aio_finisher) {
+    aio_finisher->wait_for_empty();
+    aio_finisher->stop();
+    aio_finisher.reset();
+  }
   mgrclient.shutdown();
 
   monclient.shutdown();
@@ -16,6 +16,7 @@
 
 #include "common/config_fwd.h"
 #include "common/Cond.h"
+#include "common/Finisher.h"
 #include "common/Mutex.h"
 #include "common/RWLock.h"
 #include "common/Timer.h"
@@ -87,6 +88,18 @@ private:
 
 public:
   Finisher finisher;
+  /// only with rados_aio_finisher_threads > 1, otherwise aio completions
+  /// go through finisher like everything else
+  std::unique_ptr<ShardedFinisher> aio_finisher;
+
+  /// complete an aio callback, in order with the others of the same IoCtx
+  void queue_aio_completion(IoCtxImpl *io, Context *c, int r = 0) {
+    if (aio_finisher) {
+      aio_finisher->queue(reinterpret_cast<uintptr_t>(io), c, r);
+    } else {
+      finisher.queue(c, r);
+    }
+  }
 
   explicit RadosClient(CephContext *cct_);
   ~RadosClient() override;
@@ -14,6 +14,9 @@
 #ifndef LIBRADOS_ASIO_H
 #define LIBRADOS_ASIO_H
 
+#include <atomic>
+#include <vector>
+
 #include "include/rados/librados.hpp"
 #include "common/async/completion.h"
 
@@ -90,6 +93,50 @@ struct AsyncOp : Invoker<Result> {
   }
 };
 
+/// State of a batch of write operations, stored as the user data of the
+/// Completion they share. The submitting function holds one extra reference
+/// so the handler can't run before every operation is submitted.
+struct AsyncBatch {
+  using Signature = void(boost::system::error_code);
+  using Completion = ceph::async::Completion<Signature, AsyncBatch>;
+
+  std::vector<unique_aio_completion_ptr> aio_completions;
+  std::atomic<size_t> pending;
+  std::atomic<int> result{0};
+
+  explicit AsyncBatch(size_t count) : pending(count + 1) {
+    aio_completions.reserve(count);
+  }
+
+  /// records the result of one operation, returning true for the last one.
+  /// the first error wins
+  bool finish_one(int ret) {
+    if (ret < 0) {
+      int expected = 0;
+      result.compare_exchange_strong(expected, ret);
+    }
+    return --pending == 0;
+  }
+
+  boost::system::error_code get_error_code() const {
+    boost::system::error_code ec;
+    if (int ret = result; ret < 0) {
+      ec.assign(-ret, boost::system::system_category());
+    }
+    return ec;
+  }
+
+  static void aio_dispatch(completion_t cb, void *arg) {
+    auto c = static_cast<Completion*>(arg);
+    if (c->user_data.finish_one(rados_aio_get_return_value(cb))) {
+      // reclaim ownership of the completion
+      auto p = std::unique_ptr<Completion>{c};
+      auto ec = p->user_data.get_error_code();
+      ceph::async::dispatch(std::move(p), ec);
+    }
+  }
+};
+
 } // namespace detail
 
 
@@ -185,6 +232,42 @@ auto async_operate(ExecutionContext& ctx, IoCtx& io, const std::string& oid,
   return init.result.get();
 }
 
+/// Calls IoCtx::aio_operate() for each of the given objects and write
+/// operations, and arranges for a given handler with signature
+/// (boost::system::error_code) to be called once all of them complete.
+/// The error code is that of the first operation to fail, if any.
+template <typename ExecutionContext, typename CompletionToken>
+auto async_operate(ExecutionContext& ctx, IoCtx& io,
+                   const std::vector<std::pair<std::string,
+                                               ObjectWriteOperation*>>& ops,
+                   int flags, CompletionToken &&token)
+{
+  using Batch = detail::AsyncBatch;
+  using Signature = typename Batch::Signature;
+  boost::asio::async_completion<CompletionToken, Signature> init(token);
+  auto p = Batch::Completion::create(ctx.get_executor(),
+                                     init.completion_handler, ops.size());
+  auto& batch = p->user_data;
+
+  for (const auto& [oid, write_op] : ops) {
+    auto& c = batch.aio_completions.emplace_back(
+        Rados::aio_create_completion(p.get(), nullptr, Batch::aio_dispatch));
+    int ret = io.aio_operate(oid, c.get(), write_op, flags);
+    if (ret < 0) {
+      // can't be the last one, we still hold our own reference
+      batch.finish_one(ret);
+    }
+  }
+  if (batch.finish_one(0)) {
+    // nothing was submitted, or everything completed already
+    auto ec = batch.get_error_code();
+    ceph::async::post(std::move(p), ec);
+  } else {
+    p.release(); // release ownership until completion
+  }
+  return init.result.get();
+}
+
 /// Calls IoCtx::aio_notify() and arranges for the AioCompletion to call a
 /// given handler with signature (boost::system::error_code, bufferlist).
 template <typename ExecutionContext, typename CompletionToken>
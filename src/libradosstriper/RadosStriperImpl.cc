@@ -25,6 +25,7 @@
 #include "include/types.h"
 #include "include/uuid.h"
 #include "include/ceph_fs.h"
+#include "include/Context.h"
 #include "common/dout.h"
 #include "common/strtol.h"
 #include "osdc/Striper.h"
@@ -50,7 +51,8 @@
  * However, a certain number of safety guards have been put to make the interface closer
  * to atomicity :
  *  - each data operation takes a shared lock on the first rados object for the
- *    whole time of the operation
+ *    whole time of the operation. With rados_striper_lock_lease set, the lock is
+ *    a lease that subsequent operations on the same object may reuse
  *  - the remove and trunc operations take an exclusive lock on the first rados object
  *    for the whole time of the operation
  * This makes sure that no removal/truncation of a striped object occurs while
@@ -251,6 +253,8 @@ struct WriteCompletionData : CompletionData {
   librados::AioCompletion *m_unlockCompletion;
   /// return code of write completion, to be remembered until unlocking happened
   int m_writeRc;
+  /// whether the lock was kept as a lease, so no unlocking happened
+  bool m_lockKept;
   /// constructor
   WriteCompletionData(libradosstriper::RadosStriperImpl * striper,
 		      const std::string& soid,
@@ -274,7 +278,7 @@ WriteCompletionData::WriteCompletionData
  librados::AioCompletionImpl *userCompletion,
  int n) :
   CompletionData(striper, soid, lockCookie, userCompletion, n), m_safe(0),
-  m_unlockCompletion(0), m_writeRc(0) {
+  m_unlockCompletion(0), m_writeRc(0), m_lockKept(false) {
   if (userCompletion) {
     m_safe = new librados::IoCtxImpl::C_aio_Complete(userCompletion);
   }
@@ -439,7 +443,19 @@ struct RadosRemoveCompletionData : RefCountedObject {
 
 libradosstriper::RadosStriperImpl::RadosStriperImpl(librados::IoCtx& ioctx, librados::IoCtxImpl *ioctx_impl) :
   m_refCnt(0),lock("RadosStriper Refcont", false, false), m_radosCluster(ioctx), m_ioCtx(ioctx), m_ioCtxImpl(ioctx_impl),
-  m_layout(default_file_layout) {}
+  m_layout(default_file_layout), m_leaseLock("RadosStriper Leases") {}
+
+libradosstriper::RadosStriperImpl::~RadosStriperImpl()
+{
+  if (m_leaseTimer) {
+    Mutex::Locker l(m_leaseLock);
+    m_leaseTimer->shutdown();
+  }
+  // give up the leases we still hold, ignore return codes as we cannot do much
+  for (auto& [soid, lease] : m_leases) {
+    m_ioCtx.unlock(getObjectId(soid, 0), RADOS_LOCK_NAME, lease.cookie);
+  }
+}
 
 ///////////////////////// layout /////////////////////////////
 
@@ -624,11 +640,18 @@ static void rados_read_aio_unlock_complete(rados_striper_multi_completion_t c, v
 static void striper_read_aio_req_complete(rados_striper_multi_completion_t c, void *arg)
 {
   auto cdata = reinterpret_cast<ReadCompletionData*>(arg);
+  libradosstriper::MultiAioCompletionImpl *comp =
+    reinterpret_cast<libradosstriper::MultiAioCompletionImpl*>(c);
+  if (cdata->m_striper->releaseLeasedLock(cdata->m_soid, cdata->m_lockCookie)) {
+    // the lock is kept for later operations, so we are done
+    cdata->complete_read(comp->rval);
+    cdata->complete_unlock(0);
+    cdata->put();
+    return;
+  }
   // launch the async unlocking of the object
   cdata->m_striper->aio_unlockObject(cdata->m_soid, cdata->m_lockCookie, cdata->m_unlockCompletion);
   // complete the read part in parallel
-  libradosstriper::MultiAioCompletionImpl *comp =
-    reinterpret_cast<libradosstriper::MultiAioCompletionImpl*>(c);
   cdata->complete_read(comp->rval);
 }
 
@@ -992,6 +1015,8 @@ int libradosstriper::RadosStriperImpl::aio_remove(const std::string& soid,
 						  librados::AioCompletionImpl *c,
 						  int flags)
 {
+  // our own lease would prevent the exclusive lock
+  dropLeasedLock(soid);
   // the RemoveCompletionData object will lock the given soid for the duration
   // of the removal
   std::string lockCookie = getUUID();
@@ -1088,6 +1113,8 @@ int libradosstriper::RadosStriperImpl::internal_aio_remove(
 
 int libradosstriper::RadosStriperImpl::trunc(const std::string& soid, uint64_t size)
 {
+  // our own lease would prevent the exclusive lock
+  dropLeasedLock(soid);
   // lock the object in exclusive mode
   std::string firstObjOid = getObjectId(soid, 0);
   librados::ObjectWriteOperation op;
@@ -1125,9 +1152,23 @@ std::string libradosstriper::RadosStriperImpl::getObjectId(const object_t& soid,
   return s.str();
 }
 
+bool libradosstriper::RadosStriperImpl::releaseLeasedLock(const std::string& soid,
+							  const std::string& lockCookie)
+{
+  Mutex::Locker l(m_leaseLock);
+  auto it = m_leases.find(soid);
+  if (it == m_leases.end() || it->second.cookie != lockCookie)
+    return false;
+  it->second.refs--;
+  return true;
+}
+
 void libradosstriper::RadosStriperImpl::unlockObject(const std::string& soid,
 						     const std::string& lockCookie)
 {
+  // keep the lock if it is a current lease
+  if (releaseLeasedLock(soid, lockCookie))
+    return;
   // unlock the shared lock on the first rados object
   std::string firstObjOid = getObjectId(soid, 0);
   m_ioCtx.unlock(firstObjOid, RADOS_LOCK_NAME, lockCookie);
@@ -1154,11 +1195,21 @@ static void rados_write_aio_unlock_complete(rados_striper_multi_completion_t c,
 static void striper_write_aio_req_complete(rados_striper_multi_completion_t c, void *arg)
 {
   auto cdata = reinterpret_cast<WriteCompletionData*>(arg);
+  libradosstriper::MultiAioCompletionImpl *comp =
+    reinterpret_cast<libradosstriper::MultiAioCompletionImpl*>(c);
+  if (cdata->m_striper->releaseLeasedLock(cdata->m_soid, cdata->m_lockCookie)) {
+    // the lock is kept for later operations, so there is nothing to unlock
+    // and we release the reference of the unlock callback ourselves
+    cdata->m_lockKept = true;
+    cdata->complete_write(comp->rval);
+    cdata->complete_unlock(0);
+    cdata->put();
+    cdata->put();
+    return;
+  }
   // launch the async unlocking of the object
   cdata->m_striper->aio_unlockObject(cdata->m_soid, cdata->m_lockCookie, cdata->m_unlockCompletion);
   // complete the write part in parallel
-  libradosstriper::MultiAioCompletionImpl *comp =
-    reinterpret_cast<libradosstriper::MultiAioCompletionImpl*>(c);
   cdata->complete_write(comp->rval);
   cdata->put();
 }
@@ -1199,7 +1250,8 @@ int libradosstriper::RadosStriperImpl::write_in_open_object(const std::string& s
     c->wait_for_complete_and_cb();
     c->wait_for_safe_and_cb();
     // wait for the unlocking
-    unlock_completion->wait_for_complete();
+    if (!cdata->m_lockKept)
+      unlock_completion->wait_for_complete();
     // return result
     rc = c->get_return_value();
   }
@@ -1370,6 +1422,122 @@ int libradosstriper::RadosStriperImpl::internal_get_layout_and_size(
   return 0;
 }
 
+int libradosstriper::RadosStriperImpl::lockStripedObject(const std::string& soid,
+							  std::string *lockCookie)
+{
+  auto lease = cct()->_conf.get_val<std::chrono::seconds>("rados_striper_lock_lease");
+  auto now = ceph::coarse_mono_clock::now();
+  std::string renewCookie;
+  if (lease.count() > 0) {
+    // reuse the lease we hold if it is still young enough, renew it otherwise.
+    // It is only reused during its first half, so that the operations using
+    // it get to renew it before the OSD expires it
+    Mutex::Locker l(m_leaseLock);
+    auto it = m_leases.find(soid);
+    if (it != m_leases.end()) {
+      if (now < it->second.renewed + lease / 2) {
+	it->second.refs++;
+	*lockCookie = it->second.cookie;
+	return 0;
+      }
+      renewCookie = it->second.cookie;
+    }
+  }
+  // check and lock must be atomic and are thus done within a single operation
+  librados::ObjectWriteOperation op;
+  op.assert_exists();
+  *lockCookie = renewCookie.empty() ? getUUID() : renewCookie;
+  utime_t dur = utime_t(lease.count(), 0);
+  rados::cls::lock::lock(&op, RADOS_LOCK_NAME, LOCK_SHARED, *lockCookie, "Tag", "", dur,
+			 renewCookie.empty() ? 0 : LOCK_FLAG_MAY_RENEW);
+  int rc = m_ioCtx.operate(getObjectId(soid, 0), &op);
+  if (rc || lease.count() == 0)
+    return rc;
+  // remember the lease
+  Mutex::Locker l(m_leaseLock);
+  auto& held = m_leases[soid];
+  if (held.cookie.empty() || held.cookie == *lockCookie) {
+    held.cookie = *lockCookie;
+    held.renewed = now;
+    held.refs++;
+  }
+  // otherwise another operation took a lease meanwhile, and ours will be
+  // unlocked when done as its cookie is not the lease's
+  if (!m_leaseRenewal) {
+    scheduleLeaseRenewal(lease);
+  }
+  return 0;
+}
+
+void libradosstriper::RadosStriperImpl::scheduleLeaseRenewal(std::chrono::seconds lease)
+{
+  ceph_assert(m_leaseLock.is_locked());
+  if (!m_leaseTimer) {
+    m_leaseTimer.reset(new SafeTimer(cct(), m_leaseLock, true));
+    m_leaseTimer->init();
+  }
+  m_leaseRenewal = new FunctionContext([this](int r) {
+      m_leaseRenewal = nullptr;
+      renewLeases();
+    });
+  m_leaseTimer->add_event_after(lease.count() / 4.0, m_leaseRenewal);
+}
+
+void libradosstriper::RadosStriperImpl::renewLeases()
+{
+  ceph_assert(m_leaseLock.is_locked());
+  auto lease = cct()->_conf.get_val<std::chrono::seconds>("rados_striper_lock_lease");
+  auto now = ceph::coarse_mono_clock::now();
+  for (auto it = m_leases.begin(); it != m_leases.end(); ) {
+    auto& held = it->second;
+    if (held.refs == 0) {
+      // not in use, the next operation renews it. Forget it once the OSD
+      // has expired it
+      if (lease.count() == 0 || held.renewed + lease <= now)
+	it = m_leases.erase(it);
+      else
+	++it;
+      continue;
+    }
+    if (lease.count() > 0 && held.renewed + lease / 2 <= now) {
+      // an operation that is still running must not lose the lock. We can
+      // hardly wait here, so only log failures
+      ldout(cct(), 10) << "RadosStriperImpl : renewing lease on " << it->first << dendl;
+      librados::ObjectWriteOperation op;
+      rados::cls::lock::lock(&op, RADOS_LOCK_NAME, LOCK_SHARED, held.cookie, "Tag", "",
+			     utime_t(lease.count(), 0), LOCK_FLAG_MAY_RENEW);
+      librados::AioCompletion *c =
+	librados::Rados::aio_create_completion(nullptr, nullptr, nullptr);
+      m_ioCtx.aio_operate(getObjectId(it->first, 0), c, &op);
+      c->release();
+      held.renewed = now;
+    }
+    ++it;
+  }
+  if (!m_leases.empty() && lease.count() > 0) {
+    scheduleLeaseRenewal(lease);
+  }
+}
+
+void libradosstriper::RadosStriperImpl::dropLeasedLock(const std::string& soid)
+{
+  std::string lockCookie;
+  {
+    Mutex::Locker l(m_leaseLock);
+    auto it = m_leases.find(soid);
+    if (it == m_leases.end())
+      return;
+    // operations still using the lock will unlock it when done
+    if (it->second.refs == 0)
+      lockCookie = it->second.cookie;
+    m_leases.erase(it);
+  }
+  if (!lockCookie.empty()) {
+    // ignore return code as we cannot do much
+    m_ioCtx.unlock(getObjectId(soid, 0), RADOS_LOCK_NAME, lockCookie);
+  }
+}
+
 int libradosstriper::RadosStriperImpl::openStripedObjectForRead(
   const std::string& soid,
   ceph_file_layout *layout,
@@ -1377,18 +1545,12 @@ int libradosstriper::RadosStriperImpl::openStripedObjectForRead(
   std::string *lockCookie)
 {
   // take a lock the first rados object, if it exists and gets its size
-  // check, lock and size reading must be atomic and are thus done within a single operation
-  librados::ObjectWriteOperation op;
-  op.assert_exists();
-  *lockCookie = getUUID();
-  utime_t dur = utime_t();
-  rados::cls::lock::lock(&op, RADOS_LOCK_NAME, LOCK_SHARED, *lockCookie, "Tag", "", dur, 0);
-  std::string firstObjOid = getObjectId(soid, 0);
-  int rc = m_ioCtx.operate(firstObjOid, &op);
+  int rc = lockStripedObject(soid, lockCookie);
   if (rc) {
     // error case (including -ENOENT)
     return rc;
   }
+  std::string firstObjOid = getObjectId(soid, 0);
   rc = internal_get_layout_and_size(firstObjOid, layout, size);
   if (rc) {
     unlockObject(soid, *lockCookie);
@@ -1406,14 +1568,8 @@ int libradosstriper::RadosStriperImpl::openStripedObjectForWrite(const std::stri
 								 bool isFileSizeAbsolute)
 {
   // take a lock the first rados object, if it exists
-  // check and lock must be atomic and are thus done within a single operation
-  librados::ObjectWriteOperation op;
-  op.assert_exists();
-  *lockCookie = getUUID();
-  utime_t dur = utime_t();
-  rados::cls::lock::lock(&op, RADOS_LOCK_NAME, LOCK_SHARED, *lockCookie, "Tag", "", dur, 0);
+  int rc = lockStripedObject(soid, lockCookie);
   std::string firstObjOid = getObjectId(soid, 0);
-  int rc = m_ioCtx.operate(firstObjOid, &op);
   if (rc) {
     if (rc == -ENOENT) {
       // object does not exist, delegate to createEmptyStripedObject
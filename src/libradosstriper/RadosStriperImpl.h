@@ -15,6 +15,8 @@
 #ifndef CEPH_LIBRADOSSTRIPER_RADOSSTRIPERIMPL_H
 #define CEPH_LIBRADOSSTRIPER_RADOSSTRIPERIMPL_H
 
+#include <map>
+#include <memory>
 #include <string>
 
 #include "include/rados/librados.h"
@@ -26,6 +28,8 @@
 #include "librados/IoCtxImpl.h"
 #include "librados/AioCompletionImpl.h"
 #include "common/RefCountedObj.h"
+#include "common/Timer.h"
+#include "common/ceph_time.h"
 
 namespace libradosstriper {
 
@@ -51,7 +55,7 @@ struct RadosStriperImpl {
    */
   RadosStriperImpl(librados::IoCtx& ioctx, librados::IoCtxImpl *ioctx_impl);
   /// Destructor
-  ~RadosStriperImpl() {};
+  ~RadosStriperImpl();
 
   // configuration
   int setObjectLayoutStripeUnit(unsigned int stripe_unit);
@@ -131,6 +135,14 @@ struct RadosStriperImpl {
   std::string getObjectId(const object_t& soid, long long unsigned objectno);
 
   // opening and closing of striped objects
+  /**
+   * releases a shared lock taken when opening a striped object.
+   * If the lock is a lease that is still current, it is kept for later
+   * operations and true is returned. Otherwise it has to be unlocked
+   * and false is returned
+   */
+  bool releaseLeasedLock(const std::string& soid,
+			 const std::string& lockCookie);
   void unlockObject(const std::string& soid,
 		    const std::string& lockCookie);
   void aio_unlockObject(const std::string& soid,
@@ -170,6 +182,30 @@ struct RadosStriperImpl {
 				   ceph_file_layout *layout,
 				   uint64_t *size);
 
+  /**
+   * takes a shared lock on the first rados object of an existing striped
+   * object, reusing the current lease on it if there is one
+   * @return 0 if the lock was taken. -errcode otherwise, in particular
+   * -ENOENT if the striped object does not exist
+   */
+  int lockStripedObject(const std::string& soid,
+			std::string *lockCookie);
+
+  /**
+   * forgets the lease on a striped object, if any, so that it can be
+   * exclusively locked. The lock is dropped once no operation uses it
+   */
+  void dropLeasedLock(const std::string& soid);
+
+  /// schedules renewLeases, with m_leaseLock held
+  void scheduleLeaseRenewal(std::chrono::seconds lease);
+  /**
+   * renews the leases of operations that are still running, so that they
+   * keep the lock however long they take. Runs every quarter of a lease,
+   * with m_leaseLock held
+   */
+  void renewLeases();
+
   int internal_aio_remove(const std::string& soid,
 			  MultiAioCompletionImplPtr multi_completion,
 			  int flags=0);
@@ -269,6 +305,20 @@ struct RadosStriperImpl {
 
   // Default layout
   ceph_file_layout m_layout;
+
+  /// shared lock kept on a striped object across operations
+  struct LockLease {
+    std::string cookie;
+    /// when the lock was last taken or renewed
+    ceph::coarse_mono_time renewed;
+    /// number of operations using the lock
+    unsigned refs = 0;
+  };
+  Mutex m_leaseLock;
+  std::map<std::string, LockLease> m_leases;
+  /// renews the leases in use; created with the first lease
+  std::unique_ptr<SafeTimer> m_leaseTimer;
+  Context *m_leaseRenewal = nullptr;
 };
 }
 #endif
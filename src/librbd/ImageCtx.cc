@@ -24,6 +24,7 @@
 #include "librbd/operation/ResizeRequest.h"
 #include "librbd/Types.h"
 #include "librbd/Utils.h"
+#include "librbd/cache/WriteLogImageCache.h"
 #include "librbd/exclusive_lock/AutomaticPolicy.h"
 #include "librbd/exclusive_lock/StandardPolicy.h"
 #include "librbd/io/AioCompletion.h"
@@ -820,6 +821,10 @@ public:
     return new Journal<ImageCtx>(*this);
   }
 
+  cache::ImageCache *ImageCtx::create_image_cache() {
+    return new cache::WriteLogImageCache<ImageCtx>(*this);
+  }
+
   void ImageCtx::set_image_name(const std::string &image_name) {
     // update the name so rename can be invoked repeatedly
     RWLock::RLocker owner_locker(owner_lock);
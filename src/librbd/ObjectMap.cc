@@ -288,6 +288,7 @@ void ObjectMap<I>::handle_detained_aio_update(BlockGuardCell *cell, int r,
 
   typename UpdateGuard::BlockOperations block_ops;
   m_update_guard->release(cell, &block_ops);
+  coalesce_update_operations(&block_ops);
 
   {
     RWLock::RLocker image_locker(m_image_ctx.image_lock);
@@ -300,6 +301,50 @@ void ObjectMap<I>::handle_detained_aio_update(BlockGuardCell *cell, int r,
   on_finish->complete(r);
 }
 
+template <typename I>
+void ObjectMap<I>::coalesce_update_operations(
+    std::list<UpdateOperation> *ops) {
+  if (ops->size() < 2) {
+    return;
+  }
+
+  // only merge consecutive operations so that an update is never moved
+  // ahead of an earlier, overlapping one for a different state
+  CephContext *cct = m_image_ctx.cct;
+  auto prev_it = ops->begin();
+  for (auto it = std::next(prev_it); it != ops->end(); ) {
+    auto &prev_op = *prev_it;
+    auto &op = *it;
+    if (op.new_state != prev_op.new_state ||
+        op.current_state != prev_op.current_state ||
+        op.ignore_enoent != prev_op.ignore_enoent ||
+        (op.start_object_no != prev_op.end_object_no &&
+         op.end_object_no != prev_op.start_object_no)) {
+      prev_it = it++;
+      continue;
+    }
+
+    ldout(cct, 20) << "coalescing object map update: "
+                   << "start=" << op.start_object_no << ", "
+                   << "end=" << op.end_object_no << " into "
+                   << "start=" << prev_op.start_object_no << ", "
+                   << "end=" << prev_op.end_object_no << dendl;
+    prev_op.start_object_no = std::min(prev_op.start_object_no,
+                                       op.start_object_no);
+    prev_op.end_object_no = std::max(prev_op.end_object_no,
+                                     op.end_object_no);
+
+    Context *prev_on_finish = prev_op.on_finish;
+    Context *on_finish = op.on_finish;
+    prev_op.on_finish = new FunctionContext(
+      [prev_on_finish, on_finish](int r) {
+        prev_on_finish->complete(r);
+        on_finish->complete(r);
+      });
+    it = ops->erase(it);
+  }
+}
+
 template <typename I>
 void ObjectMap<I>::aio_update(uint64_t snap_id, uint64_t start_object_no,
                               uint64_t end_object_no, uint8_t new_state,
@@ -12,6 +12,7 @@
 #include "common/RWLock.h"
 #include "librbd/Utils.h"
 #include <boost/optional.hpp>
+#include <list>
 
 class Context;
 namespace ZTracer { struct Trace; }
@@ -154,6 +155,7 @@ private:
   void detained_aio_update(UpdateOperation &&update_operation);
   void handle_detained_aio_update(BlockGuardCell *cell, int r,
                                   Context *on_finish);
+  void coalesce_update_operations(std::list<UpdateOperation> *ops);
 
   void aio_update(uint64_t snap_id, uint64_t start_object_no,
                   uint64_t end_object_no, uint8_t new_state,
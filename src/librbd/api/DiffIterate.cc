@@ -308,7 +308,10 @@ int DiffIterate<I>::execute() {
   BitVector<2> object_diff_state;
   {
     RWLock::RLocker image_locker(m_image_ctx.image_lock);
-    if (m_whole_object && (m_image_ctx.features & RBD_FEATURE_FAST_DIFF) != 0) {
+    // an incremental diff only needs to list the snapshots of the objects
+    // the object map reports as changed since the start snapshot
+    if ((m_whole_object || from_snap_id != 0) &&
+        (m_image_ctx.features & RBD_FEATURE_FAST_DIFF) != 0) {
       r = diff_object_map(from_snap_id, end_snap_id, &object_diff_state);
       if (r < 0) {
         ldout(cct, 5) << "fast diff disabled" << dendl;
@@ -370,7 +373,9 @@ int DiffIterate<I>::execute() {
 
       if (fast_diff_enabled) {
         const uint64_t object_no = p->second.front().objectno;
-        if (object_diff_state[object_no] != OBJECT_DIFF_STATE_NONE) {
+        if (object_diff_state[object_no] == OBJECT_DIFF_STATE_NONE) {
+          continue;
+        } else if (m_whole_object) {
           bool updated = (object_diff_state[object_no] ==
                             OBJECT_DIFF_STATE_UPDATED);
           for (std::vector<ObjectExtent>::iterator q = p->second.begin();
@@ -380,18 +385,19 @@ int DiffIterate<I>::execute() {
               return r;
             }
           }
+          continue;
         }
-      } else {
-        C_DiffObject *diff_object = new C_DiffObject(m_image_ctx, head_ctx,
-                                                     diff_context,
-                                                     p->first.name, off,
-                                                     p->second);
-        diff_object->send();
-
-        if (diff_context.throttle.pending_error()) {
-          r = diff_context.throttle.wait_for_ret();
-          return r;
-        }
+      }
+
+      C_DiffObject *diff_object = new C_DiffObject(m_image_ctx, head_ctx,
+                                                   diff_context,
+                                                   p->first.name, off,
+                                                   p->second);
+      diff_object->send();
+
+      if (diff_context.throttle.pending_error()) {
+        r = diff_context.throttle.wait_for_ret();
+        return r;
       }
     }
 
@@ -0,0 +1,167 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "librbd/cache/ParentCacheObjectDispatch.h"
+#include "include/Context.h"
+#include "common/dout.h"
+#include "common/errno.h"
+#include "common/safe_io.h"
+#include "librbd/ImageCtx.h"
+#include "librbd/Utils.h"
+#include "librbd/io/ObjectDispatchSpec.h"
+#include "librbd/io/ObjectDispatcher.h"
+#include "tools/immutable_object_cache/CacheClient.h"
+#include "tools/immutable_object_cache/Types.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+#define dout_subsys ceph_subsys_rbd
+#undef dout_prefix
+#define dout_prefix *_dout << "librbd::cache::ParentCacheObjectDispatch: " \
+                           << this << " " << __func__ << ": "
+
+using namespace ceph::immutable_obj_cache;
+
+namespace librbd {
+namespace cache {
+
+using librbd::util::data_object_name;
+
+template <typename I>
+ParentCacheObjectDispatch<I>::ParentCacheObjectDispatch(I* image_ctx)
+  : m_image_ctx(image_ctx) {
+}
+
+template <typename I>
+ParentCacheObjectDispatch<I>::~ParentCacheObjectDispatch() {
+}
+
+template <typename I>
+void ParentCacheObjectDispatch<I>::init() {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 5) << dendl;
+
+  auto sock_path = m_image_ctx->config.template get_val<std::string>(
+    "immutable_object_cache_sock");
+  m_cache_client = std::make_unique<CacheClient>(sock_path, cct);
+  m_cache_client->run();
+
+  int r = m_cache_client->connect();
+  if (r < 0) {
+    // parent reads go to RADOS
+    ldout(cct, 5) << "failed to connect to the immutable object cache at "
+                  << sock_path << dendl;
+    m_cache_client.reset();
+  } else {
+    bool registered = false;
+    auto ctx = new FunctionContext([&registered](int r) {
+        registered = (r != 0);
+      });
+    r = m_cache_client->register_client(ctx);
+    if (r < 0) {
+      delete ctx;
+    }
+    if (r < 0 || !registered) {
+      ldout(cct, 5) << "failed to register with the immutable object cache"
+                    << dendl;
+      m_cache_client.reset();
+    }
+  }
+
+  // add ourself to the IO object dispatcher chain
+  m_image_ctx->io_object_dispatcher->register_object_dispatch(this);
+}
+
+template <typename I>
+void ParentCacheObjectDispatch<I>::shut_down(Context* on_finish) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 5) << dendl;
+
+  if (m_cache_client) {
+    m_cache_client->close();
+  }
+  on_finish->complete(0);
+}
+
+template <typename I>
+bool ParentCacheObjectDispatch<I>::read(
+    uint64_t object_no, uint64_t object_off, uint64_t object_len,
+    librados::snap_t snap_id, int op_flags, const ZTracer::Trace &parent_trace,
+    ceph::bufferlist* read_data, io::ExtentMap* extent_map,
+    int* object_dispatch_flags, io::DispatchResult* dispatch_result,
+    Context** on_finish, Context* on_dispatched) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << data_object_name(m_image_ctx, object_no) << " "
+                 << object_off << "~" << object_len << dendl;
+
+  if (!m_cache_client || !m_cache_client->is_session_work()) {
+    return false;
+  }
+
+  auto ctx = make_gen_lambda_context<ObjectCacheRequest*>(
+    [this, object_off, object_len, read_data, dispatch_result,
+     on_dispatched](ObjectCacheRequest* ack) {
+      handle_read_cache(ack, object_off, object_len, read_data,
+                        dispatch_result, on_dispatched);
+    });
+  m_cache_client->lookup_object(m_image_ctx->data_ctx.get_namespace(),
+                                m_image_ctx->data_ctx.get_id(),
+                                static_cast<uint64_t>(snap_id),
+                                data_object_name(m_image_ctx, object_no),
+                                ctx.release());
+  return true;
+}
+
+template <typename I>
+void ParentCacheObjectDispatch<I>::handle_read_cache(
+    ObjectCacheRequest* ack, uint64_t object_off, uint64_t object_len,
+    ceph::bufferlist* read_data, io::DispatchResult* dispatch_result,
+    Context* on_dispatched) {
+  auto cct = m_image_ctx->cct;
+
+  if (ack->type == RBDSC_READ_REPLY) {
+    auto reply = static_cast<ObjectCacheReadReplyData*>(ack);
+    int r = read_object(reply->cache_path, object_off, object_len, read_data);
+    if (r >= 0) {
+      *dispatch_result = io::DISPATCH_RESULT_COMPLETE;
+      on_dispatched->complete(r);
+      return;
+    }
+    ldout(cct, 5) << "failed to read " << reply->cache_path << ": "
+                  << cpp_strerror(r) << dendl;
+    read_data->clear();
+  }
+
+  // not promoted yet, or the daemon went away
+  ldout(cct, 20) << "reading from RADOS" << dendl;
+  *dispatch_result = io::DISPATCH_RESULT_CONTINUE;
+  on_dispatched->complete(0);
+}
+
+template <typename I>
+int ParentCacheObjectDispatch<I>::read_object(const std::string &file_path,
+                                              uint64_t object_off,
+                                              uint64_t object_len,
+                                              ceph::bufferlist* read_data) {
+  int fd = ::open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return -errno;
+  }
+
+  // the cached object ends where the RADOS object does
+  bufferptr bp(buffer::create(object_len));
+  ssize_t r = safe_pread(fd, bp.c_str(), object_len, object_off);
+  VOID_TEMP_FAILURE_RETRY(::close(fd));
+  if (r < 0) {
+    return r;
+  }
+
+  bp.set_length(r);
+  read_data->push_back(std::move(bp));
+  return r;
+}
+
+} // namespace cache
+} // namespace librbd
+
+template class librbd::cache::ParentCacheObjectDispatch<librbd::ImageCtx>;
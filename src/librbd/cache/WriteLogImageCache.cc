@@ -0,0 +1,1004 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "WriteLogImageCache.h"
+#include "include/Context.h"
+#include "include/encoding.h"
+#include "include/intarith.h"
+#include "include/stringify.h"
+#include "common/dout.h"
+#include "common/errno.h"
+#include "common/hostname.h"
+#include "common/safe_io.h"
+#include "common/WorkQueue.h"
+#include "cls/rbd/cls_rbd_client.h"
+#include "librbd/ImageCtx.h"
+#include "librbd/Utils.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <tuple>
+
+#define dout_subsys ceph_subsys_rbd
+#undef dout_prefix
+#define dout_prefix *_dout << "librbd::cache::WriteLogImageCache: " << this \
+                           << " " <<  __func__ << ": "
+
+namespace librbd {
+namespace cache {
+
+namespace {
+
+/// image metadata key naming the host and log of an image's dirty data
+const std::string STATE_KEY(".rbd_persistent_cache_state");
+
+const uint64_t SUPERBLOCK_MAGIC = 0x31676f6c77646272ULL; // "rbdwlog1"
+const uint32_t ENTRY_MAGIC = 0x676f6c77;                 // "wlog"
+const uint64_t SUPERBLOCK_SIZE = 4096;
+const uint64_t HEADER_SIZE = 64;
+const uint64_t ALIGNMENT = 512;
+
+struct SuperBlock {
+  uint64_t ring_size = 0;
+  uint64_t tail = 0;
+  uint64_t first_seq = 1;
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(ring_size, bl);
+    encode(tail, bl);
+    encode(first_seq, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(bufferlist::const_iterator& it) {
+    DECODE_START(1, it);
+    decode(ring_size, it);
+    decode(tail, it);
+    decode(first_seq, it);
+    DECODE_FINISH(it);
+  }
+};
+WRITE_CLASS_ENCODER(SuperBlock)
+
+struct EntryHeader {
+  uint64_t seq = 0;
+  uint64_t image_off = 0;
+  uint64_t length = 0;
+  uint32_t data_crc = 0;
+};
+
+void encode_header(const EntryHeader &header, bufferlist *bl) {
+  using ceph::encode;
+  bufferlist fields;
+  encode(header.seq, fields);
+  encode(header.image_off, fields);
+  encode(header.length, fields);
+  encode(header.data_crc, fields);
+
+  encode(ENTRY_MAGIC, *bl);
+  encode(fields.crc32c(0), *bl);
+  bl->claim_append(fields);
+  bl->append_zero(HEADER_SIZE - bl->length());
+}
+
+bool decode_header(bufferlist &bl, EntryHeader *header) {
+  using ceph::decode;
+  try {
+    auto it = bl.cbegin();
+    uint32_t magic, crc;
+    decode(magic, it);
+    decode(crc, it);
+    if (magic != ENTRY_MAGIC) {
+      return false;
+    }
+    bufferlist fields;
+    fields.substr_of(bl, it.get_off(), 3 * sizeof(uint64_t) + sizeof(uint32_t));
+    if (fields.crc32c(0) != crc) {
+      return false;
+    }
+    auto fit = fields.cbegin();
+    decode(header->seq, fit);
+    decode(header->image_off, fit);
+    decode(header->length, fit);
+    decode(header->data_crc, fit);
+  } catch (const buffer::error &err) {
+    return false;
+  }
+  return true;
+}
+
+/// lays the data read from the log over what was read from the image
+struct C_ReadOverlay : public Context {
+  bufferlist read_bl;
+  std::vector<std::pair<uint64_t, bufferlist>> overlays;
+  uint64_t length;
+  bufferlist *out_bl;
+  Context *on_finish;
+
+  C_ReadOverlay(uint64_t length, bufferlist *out_bl, Context *on_finish)
+    : length(length), out_bl(out_bl), on_finish(on_finish) {
+  }
+
+  void finish(int r) override {
+    if (r >= 0) {
+      if (read_bl.length() < length) {
+        read_bl.append_zero(length - read_bl.length());
+      }
+      char *buf = read_bl.c_str();
+      for (auto &overlay : overlays) {
+        overlay.second.copy(0, overlay.second.length(), buf + overlay.first);
+      }
+      out_bl->claim_append(read_bl);
+    }
+    on_finish->complete(r);
+  }
+};
+
+} // anonymous namespace
+
+template <typename I>
+WriteLogImageCache<I>::WriteLogImageCache(I &image_ctx)
+  : m_image_ctx(image_ctx), m_image_writeback(image_ctx),
+    m_max_in_flight(image_ctx.config.template get_val<uint64_t>(
+      "rbd_persistent_cache_max_in_flight")),
+    m_append_thread(this), m_destage_thread(this),
+    m_lock(util::unique_lock_name(
+      "librbd::cache::WriteLogImageCache::m_lock", this)) {
+}
+
+template <typename I>
+WriteLogImageCache<I>::~WriteLogImageCache() {
+  if (m_fd >= 0) {
+    VOID_TEMP_FAILURE_RETRY(::close(m_fd));
+  }
+}
+
+template <typename I>
+uint64_t WriteLogImageCache<I>::physical(uint64_t pos) const {
+  return SUPERBLOCK_SIZE + pos % m_ring_size;
+}
+
+template <typename I>
+uint64_t WriteLogImageCache<I>::entry_size(uint64_t length) const {
+  return HEADER_SIZE + round_up_to(length, ALIGNMENT);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::aio_read(Extents &&image_extents, bufferlist *bl,
+                                     int fadvise_flags, Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "image_extents=" << image_extents << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  uint64_t length = 0;
+  for (auto &extent : image_extents) {
+    length += extent.second;
+  }
+  auto ctx = new C_ReadOverlay(length, bl, on_finish);
+
+  // where in the read buffer, and where in the log
+  std::vector<std::tuple<uint64_t, uint64_t, uint64_t>> pieces;
+  uint64_t pin_seq = 0;
+  uint64_t covered = 0;
+  {
+    Mutex::Locker locker(m_lock);
+    uint64_t buf_off = 0;
+    for (auto &extent : image_extents) {
+      uint64_t off = extent.first;
+      uint64_t end = off + extent.second;
+      auto it = m_index.lower_bound(off);
+      if (it != m_index.begin()) {
+        auto prev = std::prev(it);
+        if (prev->first + prev->second.length > off) {
+          it = prev;
+        }
+      }
+      for (; it != m_index.end() && it->first < end; ++it) {
+        uint64_t start = std::max(off, it->first);
+        uint64_t stop = std::min(end, it->first + it->second.length);
+        pieces.emplace_back(buf_off + (start - off),
+                            it->second.data_pos + (start - it->first),
+                            stop - start);
+        if (pin_seq == 0 || it->second.seq < pin_seq) {
+          pin_seq = it->second.seq;
+        }
+        covered += stop - start;
+      }
+      buf_off += extent.second;
+    }
+    if (!pieces.empty()) {
+      // keeps the log space of the pieces from being reused
+      m_read_pins.insert(pin_seq);
+    }
+  }
+
+  int r = 0;
+  for (auto &[buf_off, data_pos, piece_len] : pieces) {
+    bufferptr bp(piece_len);
+    r = safe_pread_exact(m_fd, bp.c_str(), bp.length(), physical(data_pos));
+    if (r < 0) {
+      lderr(cct) << "failed to read from " << m_path << ": "
+                 << cpp_strerror(r) << dendl;
+      break;
+    }
+    bufferlist data;
+    data.push_back(std::move(bp));
+    ctx->overlays.emplace_back(buf_off, std::move(data));
+  }
+  if (!pieces.empty()) {
+    Mutex::Locker locker(m_lock);
+    m_read_pins.erase(m_read_pins.find(pin_seq));
+    m_destage_cond.Signal();
+  }
+  if (r < 0) {
+    ctx->on_finish = nullptr;
+    delete ctx;
+    m_image_ctx.op_work_queue->queue(on_finish, r);
+    return;
+  }
+
+  if (covered == length) {
+    m_image_ctx.op_work_queue->queue(ctx, 0);
+    return;
+  }
+  m_image_writeback.aio_read(std::move(image_extents), &ctx->read_bl,
+                             fadvise_flags, ctx);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::aio_write(Extents &&image_extents,
+                                      bufferlist&& bl,
+                                      int fadvise_flags,
+                                      Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "image_extents=" << image_extents << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  bool large = false;
+  for (auto &extent : image_extents) {
+    if (entry_size(extent.second) > m_ring_size / 4) {
+      large = true;
+      break;
+    }
+  }
+  if (large) {
+    // not worth the log space, write it after what is logged
+    auto ctx = new FunctionContext(
+      [this, image_extents=std::move(image_extents), bl=std::move(bl),
+       fadvise_flags, on_finish](int r) mutable {
+        if (r < 0) {
+          on_finish->complete(r);
+          return;
+        }
+        m_image_writeback.aio_write(std::move(image_extents), std::move(bl),
+                                    fadvise_flags, on_finish);
+      });
+    aio_flush(io::FLUSH_SOURCE_INTERNAL, ctx);
+    return;
+  }
+
+  Mutex::Locker locker(m_lock);
+  m_pending.push_back({Append::WRITE, std::move(image_extents), std::move(bl),
+                       on_finish});
+  m_append_cond.Signal();
+}
+
+template <typename I>
+void WriteLogImageCache<I>::aio_discard(uint64_t offset, uint64_t length,
+                                        uint32_t discard_granularity_bytes,
+                                        Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "offset=" << offset << ", "
+                 << "length=" << length << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  auto ctx = new FunctionContext(
+    [this, offset, length, discard_granularity_bytes, on_finish](int r) {
+      if (r < 0) {
+        on_finish->complete(r);
+        return;
+      }
+      m_image_writeback.aio_discard(offset, length, discard_granularity_bytes,
+                                    on_finish);
+    });
+  aio_flush(io::FLUSH_SOURCE_INTERNAL, ctx);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::aio_flush(io::FlushSource flush_source,
+                                      Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "flush_source=" << flush_source << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  // the writes acked so far are in the log already, a user flush only has
+  // to wait for those still being appended. all other flushes write the
+  // log back to the image
+  Mutex::Locker locker(m_lock);
+  m_pending.push_back({flush_source == io::FLUSH_SOURCE_USER ?
+                         Append::FLUSH : Append::WRITEBACK,
+                       {}, {}, on_finish});
+  m_append_cond.Signal();
+}
+
+template <typename I>
+void WriteLogImageCache<I>::aio_writesame(uint64_t offset, uint64_t length,
+                                          bufferlist&& bl, int fadvise_flags,
+                                          Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "offset=" << offset << ", "
+                 << "length=" << length << ", "
+                 << "data_len=" << bl.length() << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  auto ctx = new FunctionContext(
+    [this, offset, length, bl=std::move(bl), fadvise_flags,
+     on_finish](int r) mutable {
+      if (r < 0) {
+        on_finish->complete(r);
+        return;
+      }
+      m_image_writeback.aio_writesame(offset, length, std::move(bl),
+                                      fadvise_flags, on_finish);
+    });
+  aio_flush(io::FLUSH_SOURCE_INTERNAL, ctx);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::aio_compare_and_write(Extents &&image_extents,
+                                                  bufferlist&& cmp_bl,
+                                                  bufferlist&& bl,
+                                                  uint64_t *mismatch_offset,
+                                                  int fadvise_flags,
+                                                  Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "image_extents=" << image_extents << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  auto ctx = new FunctionContext(
+    [this, image_extents=std::move(image_extents), cmp_bl=std::move(cmp_bl),
+     bl=std::move(bl), mismatch_offset, fadvise_flags,
+     on_finish](int r) mutable {
+      if (r < 0) {
+        on_finish->complete(r);
+        return;
+      }
+      m_image_writeback.aio_compare_and_write(
+        std::move(image_extents), std::move(cmp_bl), std::move(bl),
+        mismatch_offset, fadvise_flags, on_finish);
+    });
+  aio_flush(io::FLUSH_SOURCE_INTERNAL, ctx);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::init(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << dendl;
+
+  // opening and scanning the log, and the metadata updates, are synchronous
+  m_image_ctx.op_work_queue->queue(new FunctionContext(
+    [this, on_finish](int r) {
+      on_finish->complete(do_init());
+    }), 0);
+}
+
+template <typename I>
+int WriteLogImageCache<I>::read_state(std::string *state) {
+  return cls_client::metadata_get(&m_image_ctx.md_ctx, m_image_ctx.header_oid,
+                                  STATE_KEY, state);
+}
+
+template <typename I>
+int WriteLogImageCache<I>::do_init() {
+  CephContext *cct = m_image_ctx.cct;
+
+  auto dir = m_image_ctx.config.template get_val<std::string>(
+    "rbd_persistent_cache_path");
+  if (dir.empty()) {
+    lderr(cct) << "rbd_persistent_cache_path is not set" << dendl;
+    return -EINVAL;
+  }
+  m_path = dir + "/rbd-wlog." +
+    stringify(m_image_ctx.md_ctx.get_id()) + "." + m_image_ctx.id;
+  const std::string local_state = ceph_get_hostname() + ":" + m_path;
+
+  std::string state;
+  int r = read_state(&state);
+  if (r == -ENOENT) {
+    // nothing was left to write back, a log of an earlier run is stale
+    r = create_log();
+  } else if (r < 0) {
+    lderr(cct) << "failed to read the persistent cache state: "
+               << cpp_strerror(r) << dendl;
+    return r;
+  } else if (state != local_state) {
+    lderr(cct) << "image has data that was not written back in the "
+               << "persistent cache " << state << dendl;
+    return -EROFS;
+  } else {
+    r = recover_log();
+  }
+  if (r < 0) {
+    if (m_fd >= 0) {
+      VOID_TEMP_FAILURE_RETRY(::close(m_fd));
+      m_fd = -1;
+    }
+    return r;
+  }
+
+  if (state.empty()) {
+    // the log is only found again through the image
+    bufferlist bl;
+    bl.append(local_state);
+    r = cls_client::metadata_set(&m_image_ctx.md_ctx, m_image_ctx.header_oid,
+                                 {{STATE_KEY, bl}});
+    if (r < 0) {
+      lderr(cct) << "failed to set the persistent cache state: "
+                 << cpp_strerror(r) << dendl;
+      VOID_TEMP_FAILURE_RETRY(::close(m_fd));
+      m_fd = -1;
+      ::unlink(m_path.c_str());
+      return r;
+    }
+  }
+
+  ldout(cct, 5) << "log " << m_path << " with " << m_entries.size()
+                << " entries to write back" << dendl;
+  m_append_thread.create("wlog_append");
+  m_destage_thread.create("wlog_destage");
+  return 0;
+}
+
+template <typename I>
+int WriteLogImageCache<I>::create_log() {
+  CephContext *cct = m_image_ctx.cct;
+
+  uint64_t size = m_image_ctx.config.template get_val<Option::size_t>(
+    "rbd_persistent_cache_size");
+  m_ring_size = (size - SUPERBLOCK_SIZE) / ALIGNMENT * ALIGNMENT;
+
+  m_fd = ::open(m_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (m_fd < 0) {
+    int r = -errno;
+    lderr(cct) << "failed to create " << m_path << ": " << cpp_strerror(r)
+               << dendl;
+    return r;
+  }
+  if (::ftruncate(m_fd, SUPERBLOCK_SIZE + m_ring_size) < 0) {
+    int r = -errno;
+    lderr(cct) << "failed to size " << m_path << ": " << cpp_strerror(r)
+               << dendl;
+    return r;
+  }
+  return write_superblock(0, 1);
+}
+
+template <typename I>
+int WriteLogImageCache<I>::recover_log() {
+  CephContext *cct = m_image_ctx.cct;
+
+  m_fd = ::open(m_path.c_str(), O_RDWR | O_CLOEXEC);
+  if (m_fd < 0) {
+    int r = -errno;
+    lderr(cct) << "failed to open " << m_path << ", the data in it that was "
+               << "not written back is lost: " << cpp_strerror(r) << dendl;
+    return r;
+  }
+
+  using ceph::decode;
+  SuperBlock sb;
+  bufferptr bp(SUPERBLOCK_SIZE);
+  int r = safe_pread_exact(m_fd, bp.c_str(), bp.length(), 0);
+  if (r < 0) {
+    lderr(cct) << "failed to read the superblock of " << m_path << ": "
+               << cpp_strerror(r) << dendl;
+    return r;
+  }
+  try {
+    bufferlist bl;
+    bl.push_back(std::move(bp));
+    auto it = bl.cbegin();
+    uint64_t magic;
+    uint32_t crc;
+    bufferlist payload;
+    decode(magic, it);
+    decode(crc, it);
+    decode(payload, it);
+    if (magic != SUPERBLOCK_MAGIC || payload.crc32c(0) != crc) {
+      throw buffer::malformed_input("bad superblock");
+    }
+    auto pit = payload.cbegin();
+    decode(sb, pit);
+  } catch (const buffer::error &err) {
+    lderr(cct) << "invalid superblock in " << m_path << ": " << err.what()
+               << dendl;
+    return -EINVAL;
+  }
+
+  m_ring_size = sb.ring_size;
+  m_tail = sb.tail;
+
+  uint64_t pos = sb.tail;
+  uint64_t seq = sb.first_seq;
+  bool skipped = false;
+  while (pos + HEADER_SIZE - m_tail <= m_ring_size) {
+    uint64_t room = m_ring_size - pos % m_ring_size;
+    EntryHeader header;
+    bool valid = false;
+    if (room >= HEADER_SIZE) {
+      bufferptr hp(HEADER_SIZE);
+      r = safe_pread_exact(m_fd, hp.c_str(), hp.length(), physical(pos));
+      if (r < 0) {
+        lderr(cct) << "failed to read " << m_path << ": " << cpp_strerror(r)
+                   << dendl;
+        return r;
+      }
+      bufferlist hbl;
+      hbl.push_back(std::move(hp));
+      valid = (decode_header(hbl, &header) && header.seq == seq &&
+               entry_size(header.length) <= room &&
+               pos + entry_size(header.length) - m_tail <= m_ring_size);
+    }
+    if (valid) {
+      bufferptr dp(header.length);
+      r = safe_pread_exact(m_fd, dp.c_str(), dp.length(),
+                           physical(pos + HEADER_SIZE));
+      if (r < 0) {
+        lderr(cct) << "failed to read " << m_path << ": " << cpp_strerror(r)
+                   << dendl;
+        return r;
+      }
+      bufferlist data;
+      data.push_back(std::move(dp));
+      valid = (data.crc32c(0) == header.data_crc);
+    }
+    if (!valid) {
+      if (skipped || pos % m_ring_size == 0) {
+        break;
+      }
+      // an entry that did not fit before the end of the ring starts over
+      // at its beginning
+      pos = round_up_to(pos, m_ring_size);
+      skipped = true;
+      continue;
+    }
+
+    skipped = false;
+    LogEntry entry{seq, pos, pos + entry_size(header.length), header.image_off,
+                   header.length};
+    m_entries.push_back(entry);
+    index_insert(entry.image_off, entry.length, entry.pos + HEADER_SIZE, seq);
+    pos = entry.end;
+    ++seq;
+  }
+
+  // pos may be past a gap that was skipped in vain
+  m_head = m_entries.empty() ? sb.tail : m_entries.back().end;
+  m_head_seq = seq;
+  m_destage_seq = sb.first_seq;
+  return 0;
+}
+
+template <typename I>
+int WriteLogImageCache<I>::write_superblock(uint64_t tail, uint64_t first_seq) {
+  using ceph::encode;
+  SuperBlock sb;
+  sb.ring_size = m_ring_size;
+  sb.tail = tail;
+  sb.first_seq = first_seq;
+
+  bufferlist payload;
+  encode(sb, payload);
+  bufferlist bl;
+  encode(SUPERBLOCK_MAGIC, bl);
+  encode(payload.crc32c(0), bl);
+  encode(payload, bl);
+  bl.append_zero(SUPERBLOCK_SIZE - bl.length());
+
+  int r = bl.write_fd(m_fd, 0);
+  if (r == 0 && ::fdatasync(m_fd) < 0) {
+    r = -errno;
+  }
+  if (r < 0) {
+    lderr(m_image_ctx.cct) << "failed to write the superblock of " << m_path
+                           << ": " << cpp_strerror(r) << dendl;
+  }
+  return r;
+}
+
+template <typename I>
+void WriteLogImageCache<I>::shut_down(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << dendl;
+
+  auto ctx = new FunctionContext([this, on_finish](int r) {
+      m_image_ctx.op_work_queue->queue(new FunctionContext(
+        [this, r, on_finish](int) {
+          do_shut_down(r, on_finish);
+        }), 0);
+    });
+  aio_flush(io::FLUSH_SOURCE_SHUTDOWN, ctx);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::do_shut_down(int r, Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+
+  {
+    Mutex::Locker locker(m_lock);
+    m_stopping = true;
+    m_append_cond.Signal();
+    m_destage_cond.Signal();
+  }
+  m_append_thread.join();
+  m_destage_thread.join();
+
+  bool clean = (r >= 0 && m_entries.empty() && m_pending.empty());
+  VOID_TEMP_FAILURE_RETRY(::close(m_fd));
+  m_fd = -1;
+
+  if (!clean) {
+    lderr(cct) << "log " << m_path << " still has " << m_entries.size()
+               << " entries that were not written back" << dendl;
+    on_finish->complete(r < 0 ? r : -EIO);
+    return;
+  }
+
+  // the state goes first, a log without it is discarded
+  r = cls_client::metadata_remove(&m_image_ctx.md_ctx, m_image_ctx.header_oid,
+                                  STATE_KEY);
+  if (r < 0) {
+    lderr(cct) << "failed to clear the persistent cache state: "
+               << cpp_strerror(r) << dendl;
+    on_finish->complete(r);
+    return;
+  }
+  ::unlink(m_path.c_str());
+  on_finish->complete(0);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::invalidate(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << dendl;
+
+  // the log only has dirty data, which can't be dropped
+  flush(on_finish);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::flush(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << dendl;
+
+  aio_flush(io::FLUSH_SOURCE_INTERNAL, on_finish);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::index_insert(uint64_t off, uint64_t len,
+                                         uint64_t data_pos, uint64_t seq) {
+  ceph_assert(m_lock.is_locked());
+
+  uint64_t end = off + len;
+  auto it = m_index.lower_bound(off);
+  if (it != m_index.begin()) {
+    auto prev = std::prev(it);
+    if (prev->first + prev->second.length > off) {
+      it = prev;
+    }
+  }
+  while (it != m_index.end() && it->first < end) {
+    uint64_t piece_off = it->first;
+    Piece piece = it->second;
+    uint64_t piece_end = piece_off + piece.length;
+    it = m_index.erase(it);
+    if (piece_off < off) {
+      m_index[piece_off] = {off - piece_off, piece.data_pos, piece.seq};
+    }
+    if (piece_end > end) {
+      m_index[end] = {piece_end - end, piece.data_pos + (end - piece_off),
+                      piece.seq};
+    }
+  }
+  m_index[off] = {len, data_pos, seq};
+}
+
+template <typename I>
+void WriteLogImageCache<I>::index_remove(const LogEntry &entry) {
+  ceph_assert(m_lock.is_locked());
+
+  // only what later entries did not overwrite is still indexed
+  uint64_t end = entry.image_off + entry.length;
+  auto it = m_index.lower_bound(entry.image_off);
+  if (it != m_index.begin()) {
+    auto prev = std::prev(it);
+    if (prev->first + prev->second.length > entry.image_off) {
+      it = prev;
+    }
+  }
+  while (it != m_index.end() && it->first < end) {
+    if (it->second.seq == entry.seq) {
+      it = m_index.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+template <typename I>
+void WriteLogImageCache<I>::append_entry() {
+  CephContext *cct = m_image_ctx.cct;
+
+  Mutex::Locker locker(m_lock);
+  while (true) {
+    if (m_pending.empty()) {
+      if (m_stopping) {
+        break;
+      }
+      m_append_cond.Wait(m_lock);
+      continue;
+    }
+
+    // place as many of the pending writes as fit in the free log space,
+    // all of them are flushed at once
+    std::list<Append> batch;
+    std::list<std::pair<uint64_t, Context*>> writeback_waiters;
+    std::vector<LogEntry> entries;
+    std::vector<std::pair<uint64_t, bufferlist>> segments;
+    uint64_t head = m_head;
+    uint64_t seq = m_head_seq;
+    while (!m_pending.empty()) {
+      auto &append = m_pending.front();
+      if (append.type == Append::WRITE) {
+        std::vector<LogEntry> append_entries;
+        uint64_t pos = head;
+        bool fits = true;
+        for (auto &extent : append.image_extents) {
+          uint64_t size = entry_size(extent.second);
+          if (m_ring_size - pos % m_ring_size < size) {
+            pos = round_up_to(pos, m_ring_size);
+          }
+          if (pos + size - m_tail > m_ring_size) {
+            fits = false;
+            break;
+          }
+          append_entries.push_back({seq + append_entries.size(), pos,
+                                    pos + size, extent.first, extent.second});
+          pos += size;
+        }
+        if (!fits) {
+          break;
+        }
+
+        uint64_t bl_off = 0;
+        for (auto &entry : append_entries) {
+          bufferlist data;
+          data.substr_of(append.bl, bl_off, entry.length);
+          bl_off += entry.length;
+
+          EntryHeader header;
+          header.seq = entry.seq;
+          header.image_off = entry.image_off;
+          header.length = entry.length;
+          header.data_crc = data.crc32c(0);
+
+          bufferlist bl;
+          encode_header(header, &bl);
+          bl.claim_append(data);
+          bl.append_zero(entry.end - entry.pos - bl.length());
+
+          if (!segments.empty() &&
+              segments.back().first + segments.back().second.length() ==
+                physical(entry.pos)) {
+            segments.back().second.claim_append(bl);
+          } else {
+            segments.emplace_back(physical(entry.pos), std::move(bl));
+          }
+          entries.push_back(entry);
+        }
+        head = pos;
+        seq += append_entries.size();
+      } else if (append.type == Append::WRITEBACK) {
+        writeback_waiters.emplace_back(seq - 1, append.on_finish);
+      }
+      batch.push_back(std::move(append));
+      m_pending.pop_front();
+    }
+
+    if (batch.empty()) {
+      if (m_destage_error < 0) {
+        // the log won't drain
+        auto on_finish = m_pending.front().on_finish;
+        m_pending.pop_front();
+        m_lock.Unlock();
+        on_finish->complete(m_destage_error);
+        m_lock.Lock();
+        continue;
+      }
+      ldout(cct, 20) << "log full, waiting for write back" << dendl;
+      m_destage_cond.Signal();
+      m_append_cond.Wait(m_lock);
+      continue;
+    }
+
+    int r = 0;
+    if (!segments.empty()) {
+      m_lock.Unlock();
+      for (auto &segment : segments) {
+        r = segment.second.write_fd(m_fd, segment.first);
+        if (r < 0) {
+          break;
+        }
+      }
+      if (r == 0 && ::fdatasync(m_fd) < 0) {
+        r = -errno;
+      }
+      m_lock.Lock();
+    }
+
+    if (r < 0) {
+      lderr(cct) << "failed to append to " << m_path << ": "
+                 << cpp_strerror(r) << dendl;
+    } else {
+      m_head = head;
+      m_head_seq = seq;
+      for (auto &entry : entries) {
+        index_insert(entry.image_off, entry.length, entry.pos + HEADER_SIZE,
+                     entry.seq);
+        m_entries.push_back(entry);
+      }
+      m_writeback_waiters.splice(m_writeback_waiters.end(), writeback_waiters);
+      m_destage_cond.Signal();
+    }
+
+    m_lock.Unlock();
+    for (auto &append : batch) {
+      if (append.type != Append::WRITEBACK || r < 0) {
+        append.on_finish->complete(r);
+      }
+    }
+    m_lock.Lock();
+  }
+}
+
+template <typename I>
+void WriteLogImageCache<I>::destage_entry() {
+  CephContext *cct = m_image_ctx.cct;
+
+  Mutex::Locker locker(m_lock);
+  while (true) {
+    // free the log space of the entries at the front that were written
+    // back, unless a read still copies from it
+    bool retired = false;
+    while (!m_entries.empty() && m_entries.front().destaged &&
+           (m_read_pins.empty() ||
+            m_entries.front().seq < *m_read_pins.begin())) {
+      index_remove(m_entries.front());
+      m_entries.pop_front();
+      retired = true;
+    }
+    if (retired) {
+      uint64_t tail = m_entries.empty() ? m_head : m_entries.front().pos;
+      uint64_t first_seq = m_entries.empty() ? m_head_seq :
+                                               m_entries.front().seq;
+      m_lock.Unlock();
+      int r = write_superblock(tail, first_seq);
+      m_lock.Lock();
+      if (r < 0) {
+        if (m_destage_error == 0) {
+          m_destage_error = r;
+        }
+      } else {
+        m_tail = tail;
+        m_append_cond.Signal();
+      }
+    }
+
+    uint64_t first_seq = m_entries.empty() ? m_head_seq :
+                                             m_entries.front().seq;
+    std::list<std::pair<Context*, int>> finished;
+    for (auto it = m_writeback_waiters.begin();
+         it != m_writeback_waiters.end(); ) {
+      if (it->first < first_seq || m_destage_error < 0) {
+        finished.emplace_back(it->second, m_destage_error);
+        it = m_writeback_waiters.erase(it);
+      } else {
+        ++it;
+      }
+    }
+
+    if (m_stopping && m_in_flight == 0) {
+      break;
+    }
+
+    // write back the entries in order, never one over another in flight
+    std::vector<LogEntry> start;
+    while (m_destage_error == 0 && m_in_flight < m_max_in_flight &&
+           !m_entries.empty() &&
+           m_destage_seq - m_entries.front().seq < m_entries.size()) {
+      auto &entry = m_entries[m_destage_seq - m_entries.front().seq];
+      bool overlaps = false;
+      for (auto &in_flight : m_destaging) {
+        if (entry.image_off < in_flight.second.first + in_flight.second.second &&
+            in_flight.second.first < entry.image_off + entry.length) {
+          overlaps = true;
+          break;
+        }
+      }
+      if (overlaps) {
+        break;
+      }
+      entry.destaging = true;
+      m_destaging[entry.seq] = {entry.image_off, entry.length};
+      ++m_in_flight;
+      ++m_destage_seq;
+      start.push_back(entry);
+    }
+
+    if (finished.empty() && start.empty()) {
+      m_destage_cond.Wait(m_lock);
+      continue;
+    }
+
+    m_lock.Unlock();
+    for (auto &f : finished) {
+      if (f.second < 0) {
+        f.first->complete(f.second);
+      } else {
+        writeback(f.first);
+      }
+    }
+    for (auto &entry : start) {
+      ldout(cct, 20) << "seq=" << entry.seq << ", "
+                     << entry.image_off << "~" << entry.length << dendl;
+      bufferptr bp(entry.length);
+      int r = safe_pread_exact(m_fd, bp.c_str(), bp.length(),
+                               physical(entry.pos + HEADER_SIZE));
+      if (r < 0) {
+        handle_destage(entry.seq, r);
+        continue;
+      }
+      bufferlist bl;
+      bl.push_back(std::move(bp));
+      m_image_writeback.aio_write(
+        {{entry.image_off, entry.length}}, std::move(bl), 0,
+        new FunctionContext([this, seq=entry.seq](int r) {
+            handle_destage(seq, r);
+          }));
+    }
+    m_lock.Lock();
+  }
+}
+
+template <typename I>
+void WriteLogImageCache<I>::handle_destage(uint64_t seq, int r) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "seq=" << seq << ", r=" << r << dendl;
+
+  Mutex::Locker locker(m_lock);
+  m_destaging.erase(seq);
+  --m_in_flight;
+
+  auto &entry = m_entries[seq - m_entries.front().seq];
+  entry.destaging = false;
+  if (r < 0) {
+    lderr(cct) << "failed to write back log entry " << seq << ": "
+               << cpp_strerror(r) << dendl;
+    if (m_destage_error == 0) {
+      m_destage_error = r;
+    }
+  } else {
+    entry.destaged = true;
+  }
+  m_destage_cond.Signal();
+}
+
+template <typename I>
+void WriteLogImageCache<I>::writeback(Context *on_finish) {
+  // everything up to the flush is in the image, make it stable there
+  m_image_writeback.aio_flush(on_finish);
+}
+
+} // namespace cache
+} // namespace librbd
+
+template class librbd::cache::WriteLogImageCache<librbd::ImageCtx>;
@@ -0,0 +1,169 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_LIBRBD_CACHE_WRITE_LOG_IMAGE_CACHE
+#define CEPH_LIBRBD_CACHE_WRITE_LOG_IMAGE_CACHE
+
+#include "ImageCache.h"
+#include "ImageWriteback.h"
+#include "include/buffer.h"
+#include "common/Cond.h"
+#include "common/Mutex.h"
+#include "common/Thread.h"
+#include <deque>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+
+namespace librbd {
+
+struct ImageCtx;
+
+namespace cache {
+
+/**
+ * Client-side, persistent write-back cache. Writes are appended to a log
+ * file on local SSD or PMEM and acked once it is flushed, then written
+ * back to the image in log order by a background thread.
+ *
+ * The log is a superblock followed by a ring of entries, each a header
+ * and the data of one image extent. The superblock holds where the oldest
+ * entry that was not written back yet starts; it is updated, and the ring
+ * space freed, once entries were written back. On init, the entries after
+ * it with consecutive sequence numbers and valid checksums are recovered.
+ *
+ * Discards, write-sames and compare-and-writes write the log back first
+ * and then pass through.
+ */
+template <typename ImageCtxT = librbd::ImageCtx>
+class WriteLogImageCache : public ImageCache {
+public:
+  static WriteLogImageCache* create(ImageCtxT &image_ctx) {
+    return new WriteLogImageCache(image_ctx);
+  }
+
+  explicit WriteLogImageCache(ImageCtxT &image_ctx);
+  ~WriteLogImageCache() override;
+
+  /// client AIO methods
+  void aio_read(Extents&& image_extents, ceph::bufferlist *bl,
+                int fadvise_flags, Context *on_finish) override;
+  void aio_write(Extents&& image_extents, ceph::bufferlist&& bl,
+                 int fadvise_flags, Context *on_finish) override;
+  void aio_discard(uint64_t offset, uint64_t length,
+                   uint32_t discard_granularity_bytes,
+                   Context *on_finish) override;
+  void aio_flush(io::FlushSource flush_source, Context *on_finish) override;
+  void aio_writesame(uint64_t offset, uint64_t length,
+                     ceph::bufferlist&& bl,
+                     int fadvise_flags, Context *on_finish) override;
+  void aio_compare_and_write(Extents&& image_extents,
+                             ceph::bufferlist&& cmp_bl, ceph::bufferlist&& bl,
+                             uint64_t *mismatch_offset,int fadvise_flags,
+                             Context *on_finish) override;
+
+  /// internal state methods
+  void init(Context *on_finish) override;
+  void shut_down(Context *on_finish) override;
+
+  void invalidate(Context *on_finish) override;
+  void flush(Context *on_finish) override;
+
+private:
+  /// an entry of the log, from the header to the end of its padded data
+  struct LogEntry {
+    uint64_t seq;
+    uint64_t pos;       ///< logical log offset of the header
+    uint64_t end;       ///< logical log offset past the entry
+    uint64_t image_off;
+    uint64_t length;
+    bool destaging = false;
+    bool destaged = false;
+  };
+
+  /// a range of the image whose latest data is in the log
+  struct Piece {
+    uint64_t length;
+    uint64_t data_pos;  ///< logical log offset of its first byte
+    uint64_t seq;       ///< of the entry it is from
+  };
+
+  /// a write, or a flush, waiting for the append thread
+  struct Append {
+    enum Type { WRITE, FLUSH, WRITEBACK };
+
+    Type type;
+    Extents image_extents;
+    ceph::bufferlist bl;
+    Context *on_finish;
+  };
+
+  uint64_t physical(uint64_t pos) const;
+  uint64_t entry_size(uint64_t length) const;
+
+  int read_state(std::string *state);
+  int do_init();
+  int create_log();
+  int recover_log();
+  int write_superblock(uint64_t tail, uint64_t first_seq);
+  void do_shut_down(int r, Context *on_finish);
+
+  void index_insert(uint64_t off, uint64_t len, uint64_t data_pos,
+                    uint64_t seq);
+  void index_remove(const LogEntry &entry);
+
+  void append_entry();
+  void destage_entry();
+  void handle_destage(uint64_t seq, int r);
+
+  void writeback(Context *on_finish);
+
+  template <void (WriteLogImageCache::*Fn)()>
+  class Worker : public Thread {
+  public:
+    explicit Worker(WriteLogImageCache *cache) : m_cache(cache) {}
+    void *entry() override {
+      (m_cache->*Fn)();
+      return nullptr;
+    }
+  private:
+    WriteLogImageCache *m_cache;
+  };
+
+  ImageCtxT &m_image_ctx;
+  ImageWriteback<ImageCtxT> m_image_writeback;
+
+  std::string m_path;
+  int m_fd = -1;
+  uint64_t m_ring_size = 0;   ///< bytes of the log after the superblock
+  uint64_t m_max_in_flight;
+
+  Worker<&WriteLogImageCache::append_entry> m_append_thread;
+  Worker<&WriteLogImageCache::destage_entry> m_destage_thread;
+
+  Mutex m_lock;
+  Cond m_append_cond;
+  Cond m_destage_cond;
+
+  std::deque<Append> m_pending;
+  uint64_t m_head = 0;        ///< logical log offset of the next entry
+  uint64_t m_head_seq = 1;    ///< sequence number of the next entry
+  uint64_t m_tail = 0;        ///< as of the persisted superblock
+  std::deque<LogEntry> m_entries;
+  std::map<uint64_t, Piece> m_index;
+  uint64_t m_in_flight = 0;
+  uint64_t m_destage_seq = 1; ///< next entry to write back
+  std::map<uint64_t, std::pair<uint64_t, uint64_t>> m_destaging;
+  std::multiset<uint64_t> m_read_pins; ///< oldest entry each read copies from
+  std::list<std::pair<uint64_t, Context*>> m_writeback_waiters;
+  int m_destage_error = 0;
+  bool m_stopping = false;
+};
+
+} // namespace cache
+} // namespace librbd
+
+extern template class librbd::cache::WriteLogImageCache<librbd::ImageCtx>;
+
+#endif // CEPH_LIBRBD_CACHE_WRITE_LOG_IMAGE_CACHE
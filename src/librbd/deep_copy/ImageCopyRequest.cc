@@ -3,11 +3,13 @@
 
 #include "ImageCopyRequest.h"
 #include "ObjectCopyRequest.h"
+#include "ObjectCopyThrottler.h"
 #include "common/errno.h"
 #include "librbd/Utils.h"
 #include "librbd/deep_copy/Utils.h"
 #include "librbd/image/CloseRequest.h"
 #include "librbd/image/OpenRequest.h"
+#include "librbd/object_map/DiffRequest.h"
 #include "osdc/Striper.h"
 
 #define dout_subsys ceph_subsys_rbd
@@ -48,7 +50,7 @@ void ImageCopyRequest<I>::send() {
     return;
   }
 
-  send_object_copies();
+  compute_diff();
 }
 
 template <typename I>
@@ -59,6 +61,52 @@ void ImageCopyRequest<I>::cancel() {
   m_canceled = true;
 }
 
+template <typename I>
+void ImageCopyRequest<I>::compute_diff() {
+  bool fast_diff;
+  bool same_layout;
+  {
+    RWLock::RLocker src_image_locker(m_src_image_ctx->image_lock);
+    fast_diff = ((m_src_image_ctx->features & RBD_FEATURE_FAST_DIFF) != 0);
+    same_layout = (
+      m_src_image_ctx->layout.object_size ==
+        m_dst_image_ctx->layout.object_size &&
+      m_src_image_ctx->layout.stripe_unit ==
+        m_dst_image_ctx->layout.stripe_unit &&
+      m_src_image_ctx->layout.stripe_count ==
+        m_dst_image_ctx->layout.stripe_count);
+  }
+
+  // an incremental copy only needs to look at the objects that changed
+  // since the start snapshot
+  if (m_snap_id_start == 0 || m_flatten || !fast_diff || !same_layout) {
+    send_object_copies();
+    return;
+  }
+
+  ldout(m_cct, 20) << dendl;
+
+  auto ctx = create_context_callback<
+    ImageCopyRequest<I>, &ImageCopyRequest<I>::handle_compute_diff>(this);
+  auto req = object_map::DiffRequest<I>::create(
+    m_src_image_ctx, m_snap_id_start, m_snap_id_end, &m_object_diff_state,
+    ctx);
+  req->send();
+}
+
+template <typename I>
+void ImageCopyRequest<I>::handle_compute_diff(int r) {
+  ldout(m_cct, 20) << "r=" << r << dendl;
+
+  if (r < 0) {
+    ldout(m_cct, 5) << "fast-diff optimization disabled: "
+                    << cpp_strerror(r) << dendl;
+    m_object_diff_state.clear();
+  }
+
+  send_object_copies();
+}
+
 template <typename I>
 void ImageCopyRequest<I>::send_object_copies() {
   m_object_no = 0;
@@ -79,12 +127,19 @@ void ImageCopyRequest<I>::send_object_copies() {
   ldout(m_cct, 20) << "start_object=" << m_object_no << ", "
                    << "end_object=" << m_end_object_no << dendl;
 
+  uint64_t max_ops = m_src_image_ctx->config.template get_val<uint64_t>(
+    "rbd_deep_copy_concurrent_objects");
+  if (max_ops == 0) {
+    max_ops = m_src_image_ctx->config.template get_val<uint64_t>(
+      "rbd_concurrent_management_ops");
+  }
+
+  m_throttler = ObjectCopyThrottler::get_instance(m_cct);
+
   bool complete;
   {
     Mutex::Locker locker(m_lock);
-    for (uint64_t i = 0;
-         i < m_src_image_ctx->config.template get_val<uint64_t>("rbd_concurrent_management_ops");
-         ++i) {
+    for (uint64_t i = 0; i < max_ops; ++i) {
       send_next_object_copy();
       if (m_ret_val < 0 && m_current_ops == 0) {
         break;
@@ -107,6 +162,13 @@ void ImageCopyRequest<I>::send_next_object_copy() {
     m_ret_val = -ECANCELED;
   }
 
+  // objects that did not change since the start snapshot are already there
+  while (m_object_no < m_end_object_no &&
+         m_object_no < m_object_diff_state.size() &&
+         m_object_diff_state[m_object_no] == object_map::DIFF_STATE_NONE) {
+    m_copied_objects.push(m_object_no++);
+  }
+
   if (m_ret_val < 0 || m_object_no >= m_end_object_no) {
     return;
   }
@@ -117,12 +179,45 @@ void ImageCopyRequest<I>::send_next_object_copy() {
 
   ++m_current_ops;
 
+  // each copy is charged a full object against the shared bandwidth limit
   Context *ctx = new FunctionContext(
     [this, ono](int r) {
-      handle_object_copy(ono, r);
+      handle_throttle_object_copy(ono);
+    });
+  if (m_throttler->start_op(m_dst_image_ctx->layout.object_size, ctx)) {
+    delete ctx;
+    send_object_copy(ono);
+  }
+}
+
+template <typename I>
+void ImageCopyRequest<I>::handle_throttle_object_copy(uint64_t object_no) {
+  ldout(m_cct, 20) << "object_no=" << object_no << dendl;
+
+  int r = 0;
+  {
+    Mutex::Locker locker(m_lock);
+    if (m_canceled || m_ret_val < 0) {
+      r = -ECANCELED;
+    }
+  }
+
+  if (r < 0) {
+    handle_object_copy(object_no, r);
+    return;
+  }
+
+  send_object_copy(object_no);
+}
+
+template <typename I>
+void ImageCopyRequest<I>::send_object_copy(uint64_t object_no) {
+  Context *ctx = new FunctionContext(
+    [this, object_no](int r) {
+      handle_object_copy(object_no, r);
     });
   ObjectCopyRequest<I> *req = ObjectCopyRequest<I>::create(
-      m_src_image_ctx, m_dst_image_ctx, m_snap_map, ono, m_flatten, ctx);
+      m_src_image_ctx, m_dst_image_ctx, m_snap_map, object_no, m_flatten, ctx);
   req->send();
 }
 
@@ -130,6 +225,8 @@ template <typename I>
 void ImageCopyRequest<I>::handle_object_copy(uint64_t object_no, int r) {
   ldout(m_cct, 20) << "object_no=" << object_no << ", r=" << r << dendl;
 
+  m_throttler->finish_op();
+
   bool complete;
   {
     Mutex::Locker locker(m_lock);
@@ -6,6 +6,7 @@
 
 #include "include/int_types.h"
 #include "include/rados/librados.hpp"
+#include "common/bit_vector.hpp"
 #include "common/Mutex.h"
 #include "common/RefCountedObj.h"
 #include "librbd/Types.h"
@@ -25,6 +26,8 @@ class ProgressContext;
 
 namespace deep_copy {
 
+class ObjectCopyThrottler;
+
 template <typename ImageCtxT = ImageCtx>
 class ImageCopyRequest : public RefCountedObject {
 public:
@@ -55,10 +58,17 @@ private:
    * @verbatim
    *
    * <start>
-   *    |      . . . . .
-   *    |      .       .  (parallel execution of
-   *    v      v       .   multiple objects at once)
-   * COPY_OBJECT . . . .
+   *    |
+   *    v
+   * COMPUTE_DIFF (skip if not incremental or
+   *    |          fast-diff is disabled)
+   *    |      . . . . . . . .
+   *    |      .             .  (parallel execution of
+   *    v      v             .   multiple objects at once)
+   * THROTTLE_OBJECT_COPY    .  (wait for the budget shared
+   *    |                    .   by all the deep copies)
+   *    v                    .
+   * COPY_OBJECT . . . . . . .
    *    |
    *    v
    * <finish>
@@ -83,14 +93,22 @@ private:
   uint64_t m_object_no = 0;
   uint64_t m_end_object_no = 0;
   uint64_t m_current_ops = 0;
+  ObjectCopyThrottler *m_throttler = nullptr;
   std::priority_queue<
     uint64_t, std::vector<uint64_t>, std::greater<uint64_t>> m_copied_objects;
   bool m_updating_progress = false;
   SnapMap m_snap_map;
   int m_ret_val = 0;
 
+  BitVector<2> m_object_diff_state;
+
+  void compute_diff();
+  void handle_compute_diff(int r);
+
   void send_object_copies();
   void send_next_object_copy();
+  void handle_throttle_object_copy(uint64_t object_no);
+  void send_object_copy(uint64_t object_no);
   void handle_object_copy(uint64_t object_no, int r);
 
   void finish(int r);
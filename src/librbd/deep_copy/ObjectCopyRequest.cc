@@ -810,6 +810,8 @@ void ObjectCopyRequest<I>::merge_write_ops() {
     for (auto &copy_op : copy_ops) {
       uint64_t src_offset = copy_op.src_offset;
       uint64_t dst_offset = copy_op.dst_offset;
+      uint64_t buffer_offset = 0;
+      bufferlist out_bl;
       for (auto &e : copy_op.src_extent_map) {
         uint64_t zero_len = e.first - src_offset;
         if (zero_len > 0) {
@@ -820,10 +822,24 @@ void ObjectCopyRequest<I>::merge_write_ops() {
           src_offset += zero_len;
           dst_offset += zero_len;
         }
-        copy_op.dst_extent_map[dst_offset] = e.second;
+
+        // copy extents of written zeros as holes, like sparse reads return
+        bufferlist tmpbl;
+        tmpbl.substr_of(copy_op.out_bl, buffer_offset, e.second);
+        buffer_offset += e.second;
+        if (tmpbl.is_zero()) {
+          ldout(m_cct, 20) << "src_snap_seq=" << src_snap_seq
+                           << ", inserting zero " << dst_offset << "~"
+                           << e.second << " (zeroed data)" << dendl;
+          m_dst_zero_interval[src_snap_seq].insert(dst_offset, e.second);
+        } else {
+          copy_op.dst_extent_map[dst_offset] = e.second;
+          out_bl.claim_append(tmpbl);
+        }
         src_offset += e.second;
         dst_offset += e.second;
       }
+      copy_op.out_bl = std::move(out_bl);
       if (dst_offset < copy_op.dst_offset + copy_op.length) {
         uint64_t zero_len = copy_op.dst_offset + copy_op.length - dst_offset;
         ldout(m_cct, 20) << "src_snap_seq=" << src_snap_seq
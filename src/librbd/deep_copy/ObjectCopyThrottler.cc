@@ -0,0 +1,131 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "librbd/deep_copy/ObjectCopyThrottler.h"
+#include "common/Throttle.h"
+#include "common/WorkQueue.h"
+#include "common/dout.h"
+#include "librbd/ImageCtx.h"
+
+#define dout_subsys ceph_subsys_rbd
+#undef dout_prefix
+#define dout_prefix *_dout << "librbd::deep_copy::ObjectCopyThrottler: " \
+                           << this << " " << __func__ << ": "
+
+namespace librbd {
+namespace deep_copy {
+
+namespace {
+
+// the throttler (with its timer) does not fit in a CephContext singleton
+// slot, so the singleton only owns it
+struct ObjectCopyThrottlerSingleton {
+  std::unique_ptr<ObjectCopyThrottler> throttler;
+
+  explicit ObjectCopyThrottlerSingleton(CephContext *cct)
+    : throttler(new ObjectCopyThrottler(cct)) {
+  }
+};
+
+} // anonymous namespace
+
+ObjectCopyThrottler *ObjectCopyThrottler::get_instance(CephContext *cct) {
+  auto &singleton =
+    cct->lookup_or_create_singleton_object<ObjectCopyThrottlerSingleton>(
+      "librbd::deep_copy::object_copy_throttler", false, cct);
+  return singleton.throttler.get();
+}
+
+ObjectCopyThrottler::ObjectCopyThrottler(CephContext *cct)
+  : m_cct(cct),
+    m_timer_lock("librbd::deep_copy::ObjectCopyThrottler::m_timer_lock"),
+    m_timer(cct, m_timer_lock, true),
+    m_lock("librbd::deep_copy::ObjectCopyThrottler::m_lock") {
+  ThreadPool *thread_pool;
+  ImageCtx::get_thread_pool_instance(cct, &thread_pool, &m_work_queue);
+
+  m_timer.init();
+  m_bps_throttle.reset(new TokenBucketThrottle(
+    cct, "librbd::deep_copy::bps_throttle", 0, 0, &m_timer, &m_timer_lock));
+}
+
+ObjectCopyThrottler::~ObjectCopyThrottler() {
+  // cancels the token bucket timer events
+  m_bps_throttle.reset();
+
+  Mutex::Locker timer_locker(m_timer_lock);
+  m_timer.shutdown();
+}
+
+void ObjectCopyThrottler::refresh_config() {
+  ceph_assert(m_lock.is_locked());
+
+  m_max_ops = m_cct->_conf.get_val<uint64_t>(
+    "rbd_deep_copy_shared_concurrent_objects");
+
+  uint64_t bps_limit = m_cct->_conf.get_val<uint64_t>(
+    "rbd_deep_copy_shared_bps_limit");
+  if (bps_limit != m_bps_limit) {
+    ldout(m_cct, 10) << "bps_limit=" << bps_limit << dendl;
+    m_bps_limit = bps_limit;
+    m_bps_throttle->set_limit(bps_limit, 0);
+  }
+}
+
+bool ObjectCopyThrottler::start_op(uint64_t bytes, Context *on_start) {
+  {
+    Mutex::Locker locker(m_lock);
+    refresh_config();
+
+    if (m_max_ops > 0 && (m_current_ops >= m_max_ops || !m_waiters.empty())) {
+      ldout(m_cct, 20) << "waiting: current_ops=" << m_current_ops << dendl;
+      m_waiters.push_back({bytes, on_start});
+      return false;
+    }
+    ++m_current_ops;
+  }
+
+  return !throttle_bytes(bytes, on_start);
+}
+
+void ObjectCopyThrottler::finish_op() {
+  Waiter waiter;
+  {
+    Mutex::Locker locker(m_lock);
+    ceph_assert(m_current_ops > 0);
+    --m_current_ops;
+
+    refresh_config();
+    if (m_waiters.empty() ||
+        (m_max_ops > 0 && m_current_ops >= m_max_ops)) {
+      return;
+    }
+
+    waiter = m_waiters.front();
+    m_waiters.pop_front();
+    ++m_current_ops;
+  }
+
+  if (!throttle_bytes(waiter.bytes, waiter.on_start)) {
+    m_work_queue->queue(waiter.on_start, 0);
+  }
+}
+
+bool ObjectCopyThrottler::throttle_bytes(uint64_t bytes, Context *on_start) {
+  // never blocks while no limit is set
+  if (bytes == 0) {
+    return false;
+  }
+  return m_bps_throttle->get<
+    ObjectCopyThrottler, Context,
+    &ObjectCopyThrottler::handle_bytes_ready>(bytes, this, on_start, 0);
+}
+
+void ObjectCopyThrottler::handle_bytes_ready(int r, Context *on_start,
+                                             uint64_t flag) {
+  // invoked from the timer thread with the timer lock held
+  m_work_queue->queue(on_start, 0);
+}
+
+} // namespace deep_copy
+} // namespace librbd
@@ -0,0 +1,73 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_LIBRBD_DEEP_COPY_OBJECT_COPY_THROTTLER_H
+#define CEPH_LIBRBD_DEEP_COPY_OBJECT_COPY_THROTTLER_H
+
+#include "include/int_types.h"
+#include "common/Mutex.h"
+#include "common/Timer.h"
+#include <list>
+#include <memory>
+
+class CephContext;
+class Context;
+class ContextWQ;
+class TokenBucketThrottle;
+
+namespace librbd {
+namespace deep_copy {
+
+/**
+ * Object copy budget shared by all the deep copies running against one
+ * CephContext (i.e. all the image syncs of an rbd-mirror pool replayer).
+ * At most rbd_deep_copy_shared_concurrent_objects object copies are in
+ * flight at once, and their aggregate rate is limited to
+ * rbd_deep_copy_shared_bps_limit bytes per second. Each image copy still
+ * applies its own rbd_deep_copy_concurrent_objects limit on top.
+ */
+class ObjectCopyThrottler {
+public:
+  static ObjectCopyThrottler *get_instance(CephContext *cct);
+
+  explicit ObjectCopyThrottler(CephContext *cct);
+  ~ObjectCopyThrottler();
+
+  /**
+   * Returns true if an object copy of (up to) the given size may start
+   * right away. Otherwise false is returned and on_start is completed from
+   * the librbd work queue once the copy may start. Every started copy must
+   * be followed by a finish_op() call.
+   */
+  bool start_op(uint64_t bytes, Context *on_start);
+  void finish_op();
+
+private:
+  struct Waiter {
+    uint64_t bytes;
+    Context *on_start;
+  };
+
+  CephContext *m_cct;
+  ContextWQ *m_work_queue;
+
+  Mutex m_timer_lock;
+  SafeTimer m_timer;
+  std::unique_ptr<TokenBucketThrottle> m_bps_throttle;
+
+  Mutex m_lock;
+  uint64_t m_max_ops = 0;
+  uint64_t m_current_ops = 0;
+  uint64_t m_bps_limit = 0;
+  std::list<Waiter> m_waiters;
+
+  void refresh_config();
+  bool throttle_bytes(uint64_t bytes, Context *on_start);
+  void handle_bytes_ready(int r, Context *on_start, uint64_t flag);
+
+};
+
+} // namespace deep_copy
+} // namespace librbd
+
+#endif // CEPH_LIBRBD_DEEP_COPY_OBJECT_COPY_THROTTLER_H
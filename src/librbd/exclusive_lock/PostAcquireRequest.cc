@@ -15,6 +15,7 @@
 #include "librbd/Journal.h"
 #include "librbd/ObjectMap.h"
 #include "librbd/Utils.h"
+#include "librbd/cache/ImageCache.h"
 #include "librbd/image/RefreshRequest.h"
 #include "librbd/journal/Policy.h"
 
@@ -114,8 +115,10 @@ void PostAcquireRequest<I>::send_open_journal() {
                        !m_image_ctx.get_journal_policy()->journal_disabled());
   }
   if (!journal_enabled) {
+    // the image cache writes back behind the journal's back, so it is only
+    // used without one
     apply();
-    finish();
+    send_init_image_cache();
     return;
   }
 
@@ -176,6 +179,55 @@ void PostAcquireRequest<I>::handle_allocate_journal_tag(int r) {
   finish();
 }
 
+template <typename I>
+void PostAcquireRequest<I>::send_init_image_cache() {
+  if (!m_image_ctx.config.template get_val<bool>(
+        "rbd_persistent_cache_enabled")) {
+    finish();
+    return;
+  }
+
+  CephContext *cct = m_image_ctx.cct;
+  if (m_image_ctx.config.template get_val<std::string>(
+        "rbd_persistent_cache_path").empty()) {
+    lderr(cct) << "rbd_persistent_cache_path is not set, not enabling the "
+               << "persistent cache" << dendl;
+    finish();
+    return;
+  }
+
+  ldout(cct, 10) << dendl;
+
+  ceph_assert(m_image_ctx.image_cache == nullptr);
+  using klass = PostAcquireRequest<I>;
+  Context *ctx = create_context_callback<
+    klass, &klass::handle_init_image_cache>(this);
+  m_image_cache = m_image_ctx.create_image_cache();
+  m_image_cache->init(ctx);
+}
+
+template <typename I>
+void PostAcquireRequest<I>::handle_init_image_cache(int r) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 10) << "r=" << r << dendl;
+
+  if (r < 0) {
+    lderr(cct) << "failed to init image cache: " << cpp_strerror(r) << dendl;
+    delete m_image_cache;
+    m_image_cache = nullptr;
+
+    save_result(r);
+    send_close_object_map();
+    return;
+  }
+
+  {
+    RWLock::WLocker image_locker(m_image_ctx.image_lock);
+    m_image_ctx.image_cache = m_image_cache;
+  }
+  finish();
+}
+
 template <typename I>
 void PostAcquireRequest<I>::send_close_journal() {
   CephContext *cct = m_image_ctx.cct;
@@ -40,22 +40,22 @@ private:
    * OPEN_OBJECT_MAP (skip if
    *      |           disabled)
    *      v
-   * OPEN_JOURNAL (skip if
-   *      |   *     disabled)
-   *      |   *
-   *      |   * * * * * * * *
-   *      v                 *
-   *  ALLOCATE_JOURNAL_TAG  *
-   *      |            *    *
-   *      |            *    *
-   *      |            v    v
-   *      |         CLOSE_JOURNAL
-   *      |               |
-   *      |               v
-   *      |         CLOSE_OBJECT_MAP
-   *      |               |
-   *      v               |
-   *  <finish> <----------/
+   * OPEN_JOURNAL (skip if * * * * * * * * * * * *
+   *      |   *     disabled)                    *
+   *      |   *                                  v
+   *      |   * * * * * * * *         INIT_IMAGE_CACHE (skip if
+   *      v                 *                |   *    disabled)
+   *  ALLOCATE_JOURNAL_TAG  *                |   *
+   *      |            *    *                |   *
+   *      |            *    *                |   *
+   *      |            v    v                |   *
+   *      |         CLOSE_JOURNAL            |   *
+   *      |               |                  |   *
+   *      |               v                  |   *
+   *      |         CLOSE_OBJECT_MAP < * * * | * *
+   *      |               |                  |
+   *      v               |                  |
+   *  <finish> <----------/------------------/
    *
    * @endverbatim
    */
@@ -69,6 +69,7 @@ private:
 
   decltype(m_image_ctx.object_map) m_object_map;
   decltype(m_image_ctx.journal) m_journal;
+  decltype(m_image_ctx.image_cache) m_image_cache = nullptr;
 
   bool m_prepare_lock_completed = false;
   int m_error_result;
@@ -85,6 +86,9 @@ private:
   void send_open_object_map();
   void handle_open_object_map(int r);
 
+  void send_init_image_cache();
+  void handle_init_image_cache(int r);
+
   void send_close_journal();
   void handle_close_journal(int r);
 
@@ -11,6 +11,7 @@
 #include "librbd/Journal.h"
 #include "librbd/ObjectMap.h"
 #include "librbd/Utils.h"
+#include "librbd/cache/ImageCache.h"
 #include "librbd/io/ImageRequestWQ.h"
 #include "librbd/io/ObjectDispatcher.h"
 
@@ -157,6 +158,51 @@ void PreReleaseRequest<I>::handle_wait_for_ops(int r) {
   CephContext *cct = m_image_ctx.cct;
   ldout(cct, 10) << dendl;
 
+  send_shut_down_image_cache();
+}
+
+template <typename I>
+void PreReleaseRequest<I>::send_shut_down_image_cache() {
+  CephContext *cct = m_image_ctx.cct;
+
+  decltype(m_image_ctx.image_cache) image_cache;
+  {
+    RWLock::RLocker image_locker(m_image_ctx.image_lock);
+    image_cache = m_image_ctx.image_cache;
+  }
+  if (image_cache == nullptr) {
+    send_invalidate_cache();
+    return;
+  }
+
+  ldout(cct, 10) << dendl;
+
+  Context *ctx = create_context_callback<
+      PreReleaseRequest<I>,
+      &PreReleaseRequest<I>::handle_shut_down_image_cache>(this);
+  image_cache->shut_down(ctx);
+}
+
+template <typename I>
+void PreReleaseRequest<I>::handle_shut_down_image_cache(int r) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 10) << "r=" << r << dendl;
+
+  if (r < 0) {
+    // the data that was not written back stays in the local log, the image
+    // can't be locked elsewhere until it is
+    lderr(cct) << "failed to shut down image cache: " << cpp_strerror(r)
+               << dendl;
+  }
+
+  decltype(m_image_ctx.image_cache) image_cache;
+  {
+    RWLock::WLocker image_locker(m_image_ctx.image_lock);
+    image_cache = m_image_ctx.image_cache;
+    m_image_ctx.image_cache = nullptr;
+  }
+  delete image_cache;
+
   send_invalidate_cache();
 }
 
@@ -8,6 +8,7 @@
 #include "librbd/ImageCtx.h"
 #include "librbd/Utils.h"
 #include "librbd/cache/ObjectCacherObjectDispatch.h"
+#include "librbd/cache/ParentCacheObjectDispatch.h"
 #include "librbd/cache/WriteAroundObjectDispatch.h"
 #include "librbd/image/CloseRequest.h"
 #include "librbd/image/RefreshRequest.h"
@@ -517,6 +518,16 @@ Context *OpenRequest<I>::handle_refresh(int *result) {
 
 template <typename I>
 Context *OpenRequest<I>::send_init_cache(int *result) {
+  if (m_image_ctx->child != nullptr &&
+      m_image_ctx->config.template get_val<bool>("rbd_parent_cache_enabled")) {
+    // clone parents are shared through the local immutable object cache
+    CephContext *cct = m_image_ctx->cct;
+    ldout(cct, 10) << this << " " << __func__ << ": parent cache" << dendl;
+
+    auto cache = cache::ParentCacheObjectDispatch<I>::create(m_image_ctx);
+    cache->init();
+  }
+
   // cache is disabled or parent image context
   if (!m_image_ctx->cache || m_image_ctx->child != nullptr) {
     return send_register_watch(result);
@@ -130,6 +130,10 @@ public:
 
   bool is_write_op() const;
 
+  const Extents &get_image_extents() const {
+    return m_image_extents;
+  }
+
   void start_op();
 
   bool tokens_requested(uint64_t flag, uint64_t *tokens);
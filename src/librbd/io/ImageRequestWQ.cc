@@ -2,6 +2,7 @@
 // vim: ts=8 sw=2 smarttab
 
 #include "librbd/io/ImageRequestWQ.h"
+#include "librbd/BlockGuard.h"
 #include "common/errno.h"
 #include "common/zipkin_trace.h"
 #include "common/Cond.h"
@@ -16,6 +17,7 @@
 #include "librbd/io/ImageRequest.h"
 #include "librbd/io/ImageDispatchSpec.h"
 #include "common/EventTrace.h"
+#include <limits>
 
 #define dout_subsys ceph_subsys_rbd
 #undef dout_prefix
@@ -27,6 +29,27 @@ namespace io {
 
 namespace {
 
+template <typename I>
+bool get_block_extent(ImageDispatchSpec<I> *req, BlockExtent *block_extent) {
+  // flushes are ordered by starting their op when they are dequeued
+  if (!req->is_write_op()) {
+    return false;
+  }
+
+  uint64_t start = std::numeric_limits<uint64_t>::max();
+  uint64_t end = 0;
+  for (auto &extent : req->get_image_extents()) {
+    start = std::min(start, extent.first);
+    end = std::max(end, extent.first + extent.second);
+  }
+  if (start >= end) {
+    return false;
+  }
+
+  *block_extent = {start, end};
+  return true;
+}
+
 template <typename I>
 void flush_image(I& image_ctx, Context* on_finish) {
   auto aio_comp = librbd::io::AioCompletion::create_and_start(
@@ -93,7 +116,10 @@ ImageRequestWQ<I>::ImageRequestWQ(I *image_ctx, const string &name,
 				  time_t ti, ThreadPool *tp)
   : ThreadPool::PointerWQ<ImageDispatchSpec<I> >(name, ti, 0, tp),
     m_image_ctx(*image_ctx),
-    m_lock(util::unique_lock_name("ImageRequestWQ<I>::m_lock", this)) {
+    m_lock(util::unique_lock_name("ImageRequestWQ<I>::m_lock", this)),
+    m_write_guard_lock(util::unique_lock_name(
+      "ImageRequestWQ<I>::m_write_guard_lock", this)),
+    m_write_guard(new WriteGuard(image_ctx->cct)) {
   CephContext *cct = m_image_ctx.cct;
   ldout(cct, 5) << "ictx=" << image_ctx << dendl;
 
@@ -115,6 +141,7 @@ ImageRequestWQ<I>::~ImageRequestWQ() {
   for (auto t : m_throttles) {
     delete t.second;
   }
+  delete m_write_guard;
 }
 
 template <typename I>
@@ -791,15 +818,84 @@ void ImageRequestWQ<I>::process(ImageDispatchSpec<I> *req) {
   ldout(cct, 20) << "ictx=" << &m_image_ctx << ", "
                  << "req=" << req << dendl;
 
-  req->send();
+  BlockGuardCell *cell = nullptr;
+  if (detain_write(req, &cell)) {
+    // sent by the thread that sends the overlapping write ahead of it
+    return;
+  }
 
-  finish_queued_io(req);
-  if (req->is_write_op()) {
-    finish_in_flight_write();
+  send_io(req, cell);
+}
+
+template <typename I>
+bool ImageRequestWQ<I>::detain_write(ImageDispatchSpec<I> *req,
+                                     BlockGuardCell **cell) {
+  *cell = nullptr;
+
+  BlockExtent block_extent;
+  if (!get_block_extent(req, &block_extent)) {
+    return false;
   }
-  delete req;
 
-  finish_in_flight_io();
+  Mutex::Locker locker(m_write_guard_lock);
+  int r = m_write_guard->detain(block_extent, &req, cell);
+  ceph_assert(r >= 0);
+  if (r > 0) {
+    CephContext *cct = m_image_ctx.cct;
+    ldout(cct, 20) << "delaying write behind in-flight overlapping write: "
+                   << "req=" << req << dendl;
+    return true;
+  }
+  return false;
+}
+
+template <typename I>
+void ImageRequestWQ<I>::release_write(
+    BlockGuardCell *cell,
+    std::list<std::pair<ImageDispatchSpec<I> *, BlockGuardCell *>> *ready) {
+  // the released writes are detained again in their queued order before
+  // any other write can take their place
+  Mutex::Locker locker(m_write_guard_lock);
+  typename WriteGuard::BlockOperations block_ops;
+  m_write_guard->release(cell, &block_ops);
+
+  for (auto req : block_ops) {
+    BlockExtent block_extent;
+    bool guarded = get_block_extent(req, &block_extent);
+    ceph_assert(guarded);
+
+    BlockGuardCell *req_cell;
+    int r = m_write_guard->detain(block_extent, &req, &req_cell);
+    ceph_assert(r >= 0);
+    if (r == 0) {
+      ready->emplace_back(req, req_cell);
+    }
+  }
+}
+
+template <typename I>
+void ImageRequestWQ<I>::send_io(ImageDispatchSpec<I> *req,
+                                BlockGuardCell *cell) {
+  std::list<std::pair<ImageDispatchSpec<I> *, BlockGuardCell *>> ready;
+  ready.emplace_back(req, cell);
+  while (!ready.empty()) {
+    req = ready.front().first;
+    cell = ready.front().second;
+    ready.pop_front();
+
+    req->send();
+    if (cell != nullptr) {
+      release_write(cell, &ready);
+    }
+
+    finish_queued_io(req);
+    if (req->is_write_op()) {
+      finish_in_flight_write();
+    }
+    delete req;
+
+    finish_in_flight_io();
+  }
 }
 
 template <typename I>
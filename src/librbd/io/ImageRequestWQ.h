@@ -5,6 +5,7 @@
 #define CEPH_LIBRBD_IO_IMAGE_REQUEST_WQ_H
 
 #include "include/Context.h"
+#include "common/Mutex.h"
 #include "common/RWLock.h"
 #include "common/Throttle.h"
 #include "common/WorkQueue.h"
@@ -16,6 +17,8 @@
 namespace librbd {
 
 class ImageCtx;
+template <typename> class BlockGuard;
+struct BlockGuardCell;
 
 namespace io {
 
@@ -88,6 +91,7 @@ protected:
 
 private:
   typedef std::list<Context *> Contexts;
+  typedef BlockGuard<ImageDispatchSpec<ImageCtxT> *> WriteGuard;
 
   struct C_AcquireLock;
   struct C_BlockedWrites;
@@ -107,6 +111,11 @@ private:
   std::atomic<unsigned> m_io_blockers { 0 };
   std::atomic<unsigned> m_io_throttled { 0 };
 
+  // with more than one op thread, queued writes to overlapping extents are
+  // still sent in order
+  Mutex m_write_guard_lock;
+  WriteGuard *m_write_guard;
+
   std::list<std::pair<uint64_t, TokenBucketThrottle*> > m_throttles;
   uint64_t m_qos_enabled_flag = 0;
 
@@ -126,6 +135,13 @@ private:
 
   bool needs_throttle(ImageDispatchSpec<ImageCtxT> *item);
 
+  bool detain_write(ImageDispatchSpec<ImageCtxT> *req, BlockGuardCell **cell);
+  void release_write(
+      BlockGuardCell *cell,
+      std::list<std::pair<ImageDispatchSpec<ImageCtxT> *,
+                          BlockGuardCell *>> *ready);
+  void send_io(ImageDispatchSpec<ImageCtxT> *req, BlockGuardCell *cell);
+
   void finish_queued_io(ImageDispatchSpec<ImageCtxT> *req);
   void finish_in_flight_write();
 
@@ -11,6 +11,7 @@
 #include "librbd/io/ObjectDispatcher.h"
 #include "librbd/io/Utils.h"
 
+#include <algorithm>
 #include <boost/accumulators/accumulators.hpp>
 #include <boost/accumulators/statistics/rolling_count.hpp>
 #include <boost/accumulators/statistics/rolling_sum.hpp>
@@ -28,6 +29,7 @@ using namespace boost::accumulators;
 using librbd::util::data_object_name;
 
 static const int LATENCY_STATS_WINDOW_SIZE = 10;
+static const uint64_t ADAPTIVE_DELAY_QUEUE_DEPTH = 4;
 
 class LatencyStats {
 private:
@@ -50,7 +52,7 @@ public:
     auto count = rolling_count(m_acc);
 
     if (count > 0) {
-      return rolling_sum(m_acc);
+      return rolling_sum(m_acc) / count;
     }
     return 0;
   }
@@ -367,7 +369,12 @@ bool SimpleSchedulerObjectDispatch<I>::try_delay_write(
   if (delayed && !object_requests->is_scheduled_dispatch()) {
     auto dispatch_time = ceph_clock_now();
     if (m_latency_stats) {
-      dispatch_time += utime_t(0, m_latency_stats->avg() / 2);
+      // wait up to half the observed latency, less if there are few other
+      // objects with writes in flight and hence little to gain by waiting
+      auto depth = std::min<uint64_t>(m_requests.size(),
+                                      ADAPTIVE_DELAY_QUEUE_DEPTH);
+      dispatch_time += utime_t(0, m_latency_stats->avg() * depth /
+                                    (2 * ADAPTIVE_DELAY_QUEUE_DEPTH));
     } else {
       dispatch_time += utime_t(0, m_max_delay * 1000000);
     }
@@ -465,6 +472,44 @@ void SimpleSchedulerObjectDispatch<I>::dispatch_delayed_requests(
   }
 }
 
+template <typename I>
+void SimpleSchedulerObjectDispatch<I>::dispatch_expired_delayed_requests() {
+  ceph_assert(m_lock.is_locked());
+  auto cct = m_image_ctx->cct;
+
+  // the timer fired for the first object in the queue: dispatch it along
+  // with all the others that are due by now, rather than one object per
+  // timer event
+  auto now = ceph_clock_now();
+  bool first = true;
+  while (!m_dispatch_queue.empty()) {
+    auto object_requests = m_dispatch_queue.front();
+    if (object_requests->is_scheduled_dispatch()) {
+      if (!first && object_requests->get_dispatch_time() > now) {
+        break;
+      }
+      first = false;
+    }
+    m_dispatch_queue.pop_front();
+
+    if (!object_requests->is_scheduled_dispatch()) {
+      ldout(cct, 20) << "garbage collecting " << object_requests << dendl;
+      continue;
+    }
+
+    auto object_no = object_requests->get_object_no();
+    ldout(cct, 20) << "object_no=" << object_no << ", "
+                   << object_requests->delayed_requests_size()
+                   << " requests" << dendl;
+
+    object_requests->dispatch_delayed_requests(
+        m_image_ctx, m_latency_stats.get(), &m_lock);
+    m_requests.erase(object_no);
+  }
+
+  schedule_dispatch_delayed_requests();
+}
+
 template <typename I>
 void SimpleSchedulerObjectDispatch<I>::schedule_dispatch_delayed_requests() {
   ceph_assert(m_lock.is_locked());
@@ -499,7 +544,7 @@ void SimpleSchedulerObjectDispatch<I>::schedule_dispatch_delayed_requests() {
   }
 
   m_timer_task = new FunctionContext(
-    [this, object_no=object_requests->get_object_no()](int r) {
+    [this](int r) {
       ceph_assert(m_timer_lock->is_locked());
       auto cct = m_image_ctx->cct;
       ldout(cct, 20) << "running timer task " << m_timer_task << dendl;
@@ -507,9 +552,9 @@ void SimpleSchedulerObjectDispatch<I>::schedule_dispatch_delayed_requests() {
       m_timer_task = nullptr;
       m_image_ctx->op_work_queue->queue(
           new FunctionContext(
-            [this, object_no](int r) {
+            [this](int r) {
               Mutex::Locker locker(m_lock);
-              dispatch_delayed_requests(object_no);
+              dispatch_expired_delayed_requests();
             }), 0);
     });
 
@@ -0,0 +1,190 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "librbd/object_map/DiffRequest.h"
+#include "common/dout.h"
+#include "common/errno.h"
+#include "cls/rbd/cls_rbd_client.h"
+#include "include/rbd/object_map_types.h"
+#include "librbd/ImageCtx.h"
+#include "librbd/ObjectMap.h"
+#include "librbd/Utils.h"
+#include "osdc/Striper.h"
+
+#define dout_subsys ceph_subsys_rbd
+#undef dout_prefix
+#define dout_prefix *_dout << "librbd::object_map::DiffRequest: " \
+                           << this << " " << __func__ << ": "
+
+namespace librbd {
+namespace object_map {
+
+using util::create_rados_callback;
+
+template <typename I>
+void DiffRequest<I>::send() {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 10) << "snap_id_start=" << m_snap_id_start << ", "
+                 << "snap_id_end=" << m_snap_id_end << dendl;
+
+  m_object_diff_state->clear();
+
+  int r = 0;
+  if (m_snap_id_start == 0 || m_snap_id_start >= m_snap_id_end) {
+    r = -EINVAL;
+  } else {
+    RWLock::RLocker image_locker(m_image_ctx->image_lock);
+    auto snap_it = m_image_ctx->snap_info.find(m_snap_id_start);
+    if (snap_it == m_image_ctx->snap_info.end()) {
+      r = -ENOENT;
+    } else {
+      for (; snap_it != m_image_ctx->snap_info.end() &&
+             snap_it->first <= m_snap_id_end; ++snap_it) {
+        m_snap_ids.push_back(snap_it->first);
+      }
+      if (m_snap_id_end == CEPH_NOSNAP) {
+        m_snap_ids.push_back(CEPH_NOSNAP);
+      }
+    }
+  }
+
+  if (r < 0) {
+    finish(r);
+    return;
+  }
+
+  load_object_map();
+}
+
+template <typename I>
+void DiffRequest<I>::load_object_map() {
+  auto cct = m_image_ctx->cct;
+
+  if (m_snap_ids.empty()) {
+    finish(0);
+    return;
+  }
+
+  m_current_snap_id = m_snap_ids.front();
+  m_snap_ids.pop_front();
+
+  uint64_t flags = 0;
+  int r = 0;
+  {
+    RWLock::RLocker image_locker(m_image_ctx->image_lock);
+    if (m_current_snap_id == CEPH_NOSNAP) {
+      m_current_size = m_image_ctx->size;
+    } else {
+      auto snap_it = m_image_ctx->snap_info.find(m_current_snap_id);
+      if (snap_it == m_image_ctx->snap_info.end()) {
+        r = -ENOENT;
+      } else {
+        m_current_size = snap_it->second.size;
+      }
+    }
+    if (r == 0) {
+      r = m_image_ctx->get_flags(m_current_snap_id, &flags);
+    }
+  }
+
+  if (r < 0) {
+    lderr(cct) << "failed to retrieve image flags for snap "
+               << m_current_snap_id << ": " << cpp_strerror(r) << dendl;
+    finish(r);
+    return;
+  }
+  if ((flags & RBD_FLAG_FAST_DIFF_INVALID) != 0) {
+    ldout(cct, 1) << "cannot perform fast diff on invalid object map for snap "
+                  << m_current_snap_id << dendl;
+    finish(-EINVAL);
+    return;
+  }
+
+  std::string oid(ObjectMap<>::object_map_name(m_image_ctx->id,
+                                               m_current_snap_id));
+  ldout(cct, 20) << "oid=" << oid << dendl;
+
+  librados::ObjectReadOperation op;
+  cls_client::object_map_load_start(&op);
+
+  m_out_bl.clear();
+  auto aio_comp = create_rados_callback<
+    DiffRequest<I>, &DiffRequest<I>::handle_load_object_map>(this);
+  r = m_image_ctx->md_ctx.aio_operate(oid, aio_comp, &op, &m_out_bl);
+  ceph_assert(r == 0);
+  aio_comp->release();
+}
+
+template <typename I>
+void DiffRequest<I>::handle_load_object_map(int r) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << "r=" << r << dendl;
+
+  BitVector<2> object_map;
+  if (r == 0) {
+    auto bl_it = m_out_bl.cbegin();
+    r = cls_client::object_map_load_finish(&bl_it, &object_map);
+  }
+
+  if (r < 0) {
+    lderr(cct) << "failed to load object map for snap " << m_current_snap_id
+               << ": " << cpp_strerror(r) << dendl;
+    finish(r);
+    return;
+  }
+
+  uint64_t num_objs = Striper::get_num_objects(m_image_ctx->layout,
+                                               m_current_size);
+  if (object_map.size() < num_objs) {
+    ldout(cct, 1) << "object map too small: " << object_map.size() << " < "
+                  << num_objs << dendl;
+    finish(-EINVAL);
+    return;
+  }
+  object_map.resize(num_objs);
+
+  if (!m_prev_object_map_valid) {
+    // the start snapshot: everything in it was already copied
+    m_object_diff_state->resize(num_objs);
+  } else {
+    // keep the objects that were shrunk away, as they have to be removed
+    uint64_t max_objs = std::max(num_objs, m_prev_object_map.size());
+    if (m_object_diff_state->size() < max_objs) {
+      m_object_diff_state->resize(max_objs);
+    }
+
+    for (uint64_t i = 0; i < max_objs; ++i) {
+      uint8_t state = (i < num_objs ? object_map[i] : OBJECT_NONEXISTENT);
+      uint8_t prev_state = (i < m_prev_object_map.size() ?
+                              m_prev_object_map[i] : OBJECT_NONEXISTENT);
+      if (state == OBJECT_NONEXISTENT) {
+        if (prev_state != OBJECT_NONEXISTENT) {
+          (*m_object_diff_state)[i] = DIFF_STATE_HOLE;
+        }
+      } else if (state == OBJECT_EXISTS ||
+                 (prev_state != state &&
+                  !(prev_state == OBJECT_EXISTS &&
+                    state == OBJECT_EXISTS_CLEAN))) {
+        (*m_object_diff_state)[i] = DIFF_STATE_UPDATED;
+      }
+    }
+  }
+
+  m_prev_object_map = object_map;
+  m_prev_object_map_valid = true;
+  load_object_map();
+}
+
+template <typename I>
+void DiffRequest<I>::finish(int r) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 10) << "r=" << r << dendl;
+
+  m_on_finish->complete(r);
+  delete this;
+}
+
+} // namespace object_map
+} // namespace librbd
+
+template class librbd::object_map::DiffRequest<librbd::ImageCtx>;
@@ -0,0 +1,98 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_LIBRBD_OBJECT_MAP_DIFF_REQUEST_H
+#define CEPH_LIBRBD_OBJECT_MAP_DIFF_REQUEST_H
+
+#include "include/int_types.h"
+#include "include/buffer.h"
+#include "common/bit_vector.hpp"
+#include <deque>
+
+class Context;
+
+namespace librbd {
+
+class ImageCtx;
+
+namespace object_map {
+
+enum DiffState {
+  DIFF_STATE_NONE    = 0,
+  DIFF_STATE_UPDATED = 1,
+  DIFF_STATE_HOLE    = 2
+};
+
+/**
+ * Computes which objects changed between two snapshots from the fast-diff
+ * object maps of the start snapshot, of every snapshot after it and, if
+ * the end is CEPH_NOSNAP, of the HEAD revision. An object is
+ * DIFF_STATE_NONE only if it was unchanged in each of them, so it needs
+ * no copying when an image is incrementally copied snapshot by snapshot.
+ * Fails with -EINVAL if one of the object maps is flagged invalid.
+ */
+template <typename ImageCtxT = ImageCtx>
+class DiffRequest {
+public:
+  static DiffRequest* create(ImageCtxT* image_ctx, uint64_t snap_id_start,
+                             uint64_t snap_id_end,
+                             ceph::BitVector<2>* object_diff_state,
+                             Context* on_finish) {
+    return new DiffRequest(image_ctx, snap_id_start, snap_id_end,
+                           object_diff_state, on_finish);
+  }
+
+  DiffRequest(ImageCtxT* image_ctx, uint64_t snap_id_start,
+              uint64_t snap_id_end, ceph::BitVector<2>* object_diff_state,
+              Context* on_finish)
+    : m_image_ctx(image_ctx), m_snap_id_start(snap_id_start),
+      m_snap_id_end(snap_id_end), m_object_diff_state(object_diff_state),
+      m_on_finish(on_finish) {
+  }
+
+  void send();
+
+private:
+  /**
+   * @verbatim
+   *
+   * <start>
+   *    |
+   *    |     /---------\
+   *    |     |         | (repeat for each snapshot)
+   *    v     v         |
+   * LOAD_OBJECT_MAP ---/
+   *    |
+   *    v
+   * <finish>
+   *
+   * @endverbatim
+   */
+  ImageCtxT* m_image_ctx;
+  uint64_t m_snap_id_start;
+  uint64_t m_snap_id_end;
+  ceph::BitVector<2>* m_object_diff_state;
+  Context* m_on_finish;
+
+  std::deque<uint64_t> m_snap_ids;
+  uint64_t m_current_snap_id = 0;
+  uint64_t m_current_size = 0;
+
+  ceph::BitVector<2> m_prev_object_map;
+  bool m_prev_object_map_valid = false;
+
+  bufferlist m_out_bl;
+
+  void load_object_map();
+  void handle_load_object_map(int r);
+
+  void finish(int r);
+
+};
+
+} // namespace object_map
+} // namespace librbd
+
+extern template class librbd::object_map::DiffRequest<librbd::ImageCtx>;
+
+#endif // CEPH_LIBRBD_OBJECT_MAP_DIFF_REQUEST_H
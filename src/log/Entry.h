@@ -12,6 +12,8 @@
 
 #include <pthread.h>
 
+#include <functional>
+#include <string>
 #include <string_view>
 
 namespace ceph {
@@ -37,6 +39,12 @@ public:
   virtual std::string_view strv() const = 0;
   virtual std::size_t size() const = 0;
 
+  using formatter_t = std::function<void(std::ostream&)>;
+  /// the formatter of an entry whose text is not rendered yet, if any
+  virtual formatter_t* deferred() {
+    return nullptr;
+  }
+
   time m_stamp;
   pthread_t m_thread;
   short m_prio, m_subsys;
@@ -76,6 +84,46 @@ private:
   CachedStackStringStream cos;
 };
 
+/* An entry which captures its arguments by value and renders them only if
+ * it is actually written out, by the log thread. Entries which are merely
+ * gathered into the recent ring never pay for formatting.
+ */
+class DeferredEntry : public Entry {
+public:
+  DeferredEntry() = delete;
+  template<typename F>
+  DeferredEntry(short pr, short sub, F&& f)
+    : Entry(pr, sub), format(std::forward<F>(f))
+  {}
+  DeferredEntry(const DeferredEntry&) = delete;
+  DeferredEntry& operator=(const DeferredEntry&) = delete;
+  ~DeferredEntry() override = default;
+
+  // normally moved into a ConcreteEntry and rendered by the log thread
+  std::string_view strv() const override {
+    render();
+    return text;
+  }
+  std::size_t size() const override {
+    return strv().size();
+  }
+  formatter_t* deferred() override {
+    return &format;
+  }
+
+private:
+  void render() const {
+    if (format) {
+      CachedStackStringStream cos;
+      format(*cos);
+      text = cos->strv();
+      format = nullptr;
+    }
+  }
+  mutable formatter_t format;
+  mutable std::string text;
+};
+
 class ConcreteEntry : public Entry {
 public:
   ConcreteEntry() = delete;
@@ -84,30 +132,57 @@ public:
     str.reserve(strv.size());
     str.insert(str.end(), strv.begin(), strv.end());
   }
+  ConcreteEntry(Entry&& e) : Entry(e) {
+    if (auto f = e.deferred(); f && *f) {
+      format = std::move(*f);
+    } else {
+      auto strv = e.strv();
+      str.reserve(strv.size());
+      str.insert(str.end(), strv.begin(), strv.end());
+    }
+  }
   ConcreteEntry& operator=(const Entry& e) {
     Entry::operator=(e);
     auto strv = e.strv();
     str.reserve(strv.size());
     str.assign(strv.begin(), strv.end());
+    format = nullptr;
     return *this;
   }
-  ConcreteEntry(ConcreteEntry&& e) : Entry(e), str(std::move(e.str)) {}
+  ConcreteEntry(ConcreteEntry&& e)
+    : Entry(e), str(std::move(e.str)), format(std::move(e.format)) {}
   ConcreteEntry& operator=(ConcreteEntry&& e) {
     Entry::operator=(e);
     str = std::move(e.str);
+    format = std::move(e.format);
     return *this;
   }
   ~ConcreteEntry() override = default;
 
   std::string_view strv() const override {
+    render();
     return std::string_view(str.data(), str.size());
   }
   std::size_t size() const override {
+    render();
     return str.size();
   }
+  formatter_t* deferred() override {
+    return format ? &format : nullptr;
+  }
 
 private:
-  boost::container::small_vector<char, 1024> str;
+  void render() const {
+    if (format) {
+      CachedStackStringStream cos;
+      format(*cos);
+      auto strv = cos->strv();
+      str.assign(strv.begin(), strv.end());
+      format = nullptr;
+    }
+  }
+  mutable boost::container::small_vector<char, 1024> str;
+  mutable formatter_t format; ///< set until a deferred entry is rendered
 };
 
 }
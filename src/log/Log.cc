@@ -20,6 +20,7 @@
 #include <fcntl.h>
 #include <syslog.h>
 
+#include <algorithm>
 #include <iostream>
 
 #define MAX_LOG_BUF 65536
@@ -37,10 +38,85 @@ static void log_on_exit(void *p)
   delete (Log **)p;// Delete allocated pointer (not Log object, the pointer only!)
 }
 
+/// a single-producer single-consumer ring of one logging thread; the
+/// flusher, holding m_flush_mutex, is the only consumer
+struct Log::ThreadQueue {
+  static constexpr std::size_t SIZE = 32;
+
+  std::atomic<std::size_t> head = 0; ///< next slot to drain
+  std::atomic<std::size_t> tail = 0; ///< next slot to fill
+  /// set once the thread exited or moved on to another Log; the
+  /// flusher frees the ring after draining it
+  std::atomic<bool> abandoned = false;
+  std::aligned_storage_t<sizeof(ConcreteEntry),
+			 alignof(ConcreteEntry)> slots[SIZE];
+
+  ~ThreadQueue() {
+    for (auto h = head.load(); h != tail.load(); ++h) {
+      slot(h)->~ConcreteEntry();
+    }
+  }
+  ConcreteEntry *slot(std::size_t i) {
+    return reinterpret_cast<ConcreteEntry*>(&slots[i % SIZE]);
+  }
+  bool push(Entry&& e) {
+    auto t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) == SIZE) {
+      return false;
+    }
+    new (slot(t)) ConcreteEntry(std::move(e));
+    // seq_cst, so that either we see m_flusher_waiting or the flusher
+    // sees this entry
+    tail.store(t + 1);
+    return true;
+  }
+  bool empty() const {
+    return head.load(std::memory_order_relaxed) == tail.load();
+  }
+  std::size_t drain(EntryVector& out) {
+    auto h = head.load(std::memory_order_relaxed);
+    const auto t = tail.load(std::memory_order_acquire);
+    for (; h != t; ++h) {
+      out.emplace_back(std::move(*slot(h)));
+      slot(h)->~ConcreteEntry();
+    }
+    const auto n = h - head.load(std::memory_order_relaxed);
+    head.store(h, std::memory_order_release);
+    return n;
+  }
+};
+
+/// a thread's hold on its ring; gives it up when the thread exits
+struct Log::ThreadQueueOwner {
+  uint64_t *cached_id;
+  ThreadQueue **cached_queue;
+  bool *exited;
+  // shared, so that a ring outliving its Log is still safe to let go of
+  std::shared_ptr<ThreadQueue> queue;
+
+  ~ThreadQueueOwner() {
+    // entries logged by thread_local destructors after this one take the
+    // locked path
+    *cached_id = 0;
+    *cached_queue = nullptr;
+    *exited = true;
+    release();
+  }
+  void release() {
+    if (queue) {
+      queue->abandoned.store(true, std::memory_order_release);
+      queue.reset();
+    }
+  }
+};
+
+static std::atomic<uint64_t> next_log_id = 1;
+
 Log::Log(const SubsystemMap *s)
   : m_indirect_this(nullptr),
     m_subs(s),
-    m_recent(DEFAULT_MAX_RECENT)
+    m_recent(DEFAULT_MAX_RECENT),
+    m_id(next_log_id++)
 {
   m_log_buf.reserve(MAX_LOG_BUF);
 }
@@ -175,14 +251,96 @@ void Log::stop_graylog()
   m_graylog.reset();
 }
 
-void Log::submit_entry(Entry&& e)
+Log::ThreadQueue *Log::_get_thread_queue()
 {
-  std::unique_lock lock(m_queue_mutex);
-  m_queue_mutex_holder = pthread_self();
+  // trivially destructible, so entries logged while this thread's
+  // thread_locals are being torn down are still safe
+  static thread_local uint64_t cached_id = 0;
+  static thread_local ThreadQueue *cached_queue = nullptr;
+  static thread_local bool exited = false;
+  if (likely(cached_id == m_id)) {
+    return cached_queue;
+  }
+  if (exited) {
+    return nullptr;
+  }
+  static thread_local ThreadQueueOwner owner{
+    &cached_id, &cached_queue, &exited, nullptr};
+  // a thread only keeps a ring in the Log it used last
+  owner.release();
+  std::scoped_lock lock(m_queue_mutex);
+  if (m_thread_queues.size() < MAX_THREAD_QUEUES) {
+    owner.queue = m_thread_queues.emplace_back(
+      std::make_shared<ThreadQueue>());
+  }
+  cached_id = m_id;
+  cached_queue = owner.queue.get();
+  return cached_queue;
+}
+
+bool Log::_have_thread_entries() const
+{
+  return std::any_of(m_thread_queues.begin(), m_thread_queues.end(),
+		     [](auto& q) { return !q->empty(); });
+}
+
+void Log::_gather_new()
+{
+  // a thread only spills into m_new while its ring is full, so its ring
+  // holds its older entries
+  ceph_assert(m_flush.empty());
+  unsigned sources = 0;
+  for (auto i = m_thread_queues.begin(); i != m_thread_queues.end(); ) {
+    // an abandoned ring gets no more entries once the flag is seen
+    const bool abandoned = (*i)->abandoned.load(std::memory_order_acquire);
+    if ((*i)->drain(m_flush)) {
+      sources++;
+    }
+    if (abandoned) {
+      i = m_thread_queues.erase(i);
+    } else {
+      ++i;
+    }
+  }
+  if (m_flush.empty()) {
+    m_flush.swap(m_new);
+    return;
+  }
+  if (!m_new.empty()) {
+    std::move(m_new.begin(), m_new.end(), std::back_inserter(m_flush));
+    m_new.clear();
+    sources++;
+  }
+  if (sources > 1) {
+    std::stable_sort(m_flush.begin(), m_flush.end(),
+		     [](const auto& a, const auto& b) {
+		       return a.m_stamp < b.m_stamp;
+		     });
+  }
+}
+
+std::size_t Log::get_num_thread_queues()
+{
+  std::scoped_lock lock(m_queue_mutex);
+  return m_thread_queues.size();
+}
 
+void Log::submit_entry(Entry&& e)
+{
   if (unlikely(m_inject_segv))
     *(volatile int *)(0) = 0xdead;
 
+  if (auto q = _get_thread_queue(); q && q->push(std::move(e))) {
+    if (m_flusher_waiting.load()) {
+      std::scoped_lock lock(m_queue_mutex);
+      m_cond_flusher.notify_all();
+    }
+    return;
+  }
+
+  std::unique_lock lock(m_queue_mutex);
+  m_queue_mutex_holder = pthread_self();
+
   // wait for flush to catch up
   while (is_started() &&
 	 m_new.size() > m_max_new) {
@@ -203,8 +361,7 @@ void Log::flush()
   {
     std::scoped_lock lock2(m_queue_mutex);
     m_queue_mutex_holder = pthread_self();
-    assert(m_flush.empty());
-    m_flush.swap(m_new);
+    _gather_new();
     m_cond_loggers.notify_all();
     m_queue_mutex_holder = 0;
   }
@@ -249,7 +406,6 @@ void Log::_flush(EntryVector& t, bool requeue, bool crash)
     auto stamp = e.m_stamp;
     auto sub = e.m_subsys;
     auto thread = e.m_thread;
-    auto str = e.strv();
 
     bool should_log = crash || m_subs->get_log_level(sub) >= prio;
     bool do_fd = m_fd >= 0 && should_log;
@@ -258,9 +414,11 @@ void Log::_flush(EntryVector& t, bool requeue, bool crash)
     bool do_graylog2 = m_graylog_crash >= prio && should_log;
 
     if (do_fd || do_syslog || do_stderr) {
+      // a deferred entry is rendered here, and only if it is written out
+      auto str = e.strv();
       const std::size_t cur = m_log_buf.size();
       std::size_t used = 0;
-      const std::size_t allocated = e.size() + 80;
+      const std::size_t allocated = str.size() + 80;
       m_log_buf.resize(cur + allocated);
 
       char* const start = m_log_buf.data();
@@ -340,8 +498,7 @@ void Log::dump_recent()
   {
     std::scoped_lock lock2(m_queue_mutex);
     m_queue_mutex_holder = pthread_self();
-    assert(m_flush.empty());
-    m_flush.swap(m_new);
+    _gather_new();
     m_queue_mutex_holder = 0;
   }
 
@@ -411,7 +568,7 @@ void *Log::entry()
     std::unique_lock lock(m_queue_mutex);
     m_queue_mutex_holder = pthread_self();
     while (!m_stop) {
-      if (!m_new.empty()) {
+      if (!m_new.empty() || _have_thread_entries()) {
         m_queue_mutex_holder = 0;
         lock.unlock();
         flush();
@@ -420,7 +577,11 @@ void *Log::entry()
         continue;
       }
 
-      m_cond_flusher.wait(lock);
+      m_flusher_waiting = true;
+      if (!_have_thread_entries()) {
+        m_cond_flusher.wait(lock);
+      }
+      m_flusher_waiting = false;
     }
     m_queue_mutex_holder = 0;
   }
@@ -6,6 +6,7 @@
 
 #include <boost/circular_buffer.hpp>
 
+#include <atomic>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
@@ -31,6 +32,10 @@ class Log : private Thread
 
   static const std::size_t DEFAULT_MAX_NEW = 100;
   static const std::size_t DEFAULT_MAX_RECENT = 10000;
+  static const std::size_t MAX_THREAD_QUEUES = 1024;
+
+  struct ThreadQueue;
+  struct ThreadQueueOwner;
 
   Log **m_indirect_this;
   log_clock clock;
@@ -49,6 +54,12 @@ class Log : private Thread
   EntryRing m_recent; ///< recent (less new) entries we've already written at low detail
   EntryVector m_flush; ///< entries to be flushed (here to optimize heap allocations)
 
+  /// per-thread rings which submit_entry() fills without taking
+  /// m_queue_mutex; m_new takes what does not fit
+  std::vector<std::shared_ptr<ThreadQueue>> m_thread_queues;
+  const uint64_t m_id; ///< tells the thread-local ring cache which Log it is for
+  std::atomic<bool> m_flusher_waiting = false;
+
   std::string m_log_file;
   int m_fd = -1;
   uid_t m_uid = 0;
@@ -79,6 +90,10 @@ class Log : private Thread
   void _flush_logbuf();
   void _flush(EntryVector& q, bool requeue, bool crash);
 
+  ThreadQueue *_get_thread_queue();
+  bool _have_thread_entries() const;
+  void _gather_new();
+
   void _log_message(const char *s, bool crash);
 
 public:
@@ -98,6 +113,8 @@ public:
   void set_log_stderr_prefix(std::string_view p);
 
   void flush();
+  /// rings currently kept for logging threads
+  std::size_t get_num_thread_queues();
 
   void dump_recent();
 
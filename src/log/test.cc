@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 
+#include <fstream>
+#include <thread>
+
 #include "log/Log.h"
 #include "common/Clock.h"
 #include "include/coredumpctl.h"
@@ -186,6 +189,111 @@ void do_segv()
   log.stop();
 }
 
+TEST(Log, ManyThreadsInOrder)
+{
+  static const char* test_file = "log_many_threads";
+  constexpr int nthreads = 8;
+  constexpr int nentries = 1000;
+  SubsystemMap subs;
+  subs.set_log_level(1, 20);
+  subs.set_gather_level(1, 10);
+  Log log(&subs);
+  log.start();
+  unlink(test_file);
+  log.set_log_file(test_file);
+  log.reopen_log_file();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nthreads; t++) {
+    threads.emplace_back([&log, t] {
+      for (int i = 0; i < nentries; i++) {
+	MutableEntry e(10, 1);
+	e.get_ostream() << "thread " << t << " entry " << i;
+	log.submit_entry(std::move(e));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  log.flush();
+  log.stop();
+
+  // every entry is written once, and each thread's entries in order
+  std::vector<int> next(nthreads, 0);
+  std::ifstream in(test_file);
+  std::string line;
+  while (std::getline(in, line)) {
+    auto pos = line.find("thread ");
+    ASSERT_NE(pos, std::string::npos);
+    int t, i;
+    ASSERT_EQ(sscanf(line.c_str() + pos, "thread %d entry %d", &t, &i), 2);
+    ASSERT_EQ(next[t], i);
+    next[t]++;
+  }
+  for (int t = 0; t < nthreads; t++) {
+    ASSERT_EQ(nentries, next[t]);
+  }
+}
+
+TEST(Log, DeferredEntry)
+{
+  SubsystemMap subs;
+  subs.set_log_level(1, 1);
+  subs.set_gather_level(1, 10);
+  Log log(&subs);
+  log.start();
+  log.set_log_file("foo");
+  log.reopen_log_file();
+
+  std::atomic<int> rendered = 0;
+  auto submit = [&](int lvl) {
+    log.submit_entry(DeferredEntry(lvl, 1, [&rendered, lvl] (std::ostream& out) {
+      rendered++;
+      out << "deferred " << lvl;
+    }));
+  };
+  submit(10);  // gathered only
+  log.flush();
+  ASSERT_EQ(0, rendered);
+  submit(1);   // written out
+  log.flush();
+  ASSERT_EQ(1, rendered);
+  log.dump_recent();
+  ASSERT_EQ(2, rendered);
+  log.stop();
+}
+
+TEST(Log, ThreadQueuesReclaimed)
+{
+  SubsystemMap subs;
+  subs.set_log_level(1, 20);
+  subs.set_gather_level(1, 10);
+  Log log(&subs);
+  log.start();
+  // more threads than there can be rings at once, one after another
+  for (int t = 0; t < 1100; t++) {
+    std::thread([&log, t] {
+      MutableEntry e(10, 1);
+      e.get_ostream() << "thread " << t;
+      log.submit_entry(std::move(e));
+    }).join();
+    if (t % 100 == 0) {
+      log.flush();
+    }
+  }
+  // the rings of exited threads are freed once drained
+  log.flush();
+  ASSERT_EQ(0u, log.get_num_thread_queues());
+  std::thread([&log] {
+    MutableEntry e(10, 1);
+    e.get_ostream() << "late thread";
+    log.submit_entry(std::move(e));
+    ASSERT_EQ(1u, log.get_num_thread_queues());
+  }).join();
+  log.flush();
+  log.stop();
+}
+
 TEST(Log, InternalSegv)
 {
   ASSERT_DEATH(do_segv(), ".*");
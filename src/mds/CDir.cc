@@ -1583,7 +1583,10 @@ public:
     if (omap.empty()) {
       omap.swap(omap_more);
     } else {
-      omap.insert(omap_more.begin(), omap_more.end());
+      // pages come back in key order, so each one goes at the end
+      for (auto& p : omap_more) {
+	omap.emplace_hint(omap.end(), p.first, std::move(p.second));
+      }
     }
     if (more) {
       dir->_omap_fetch_more(hdrbl, omap, fin);
@@ -174,6 +174,7 @@ class CInode : public MDSCacheObject, public InodeStoreBase, public Counter<CIno
   static const int PIN_DIRTYPARENT =      23;
   static const int PIN_DIRWAITER =        24;
   static const int PIN_SCRUBQUEUE =       25;
+  static const int PIN_SCATTERNUDGE =    -26;  // held across a scatter_tick() batch
 
   std::string_view pin_name(int p) const override {
     switch (p) {
@@ -199,6 +200,7 @@ class CInode : public MDSCacheObject, public InodeStoreBase, public Counter<CIno
     case PIN_DIRTYPARENT: return "dirtyparent";
     case PIN_DIRWAITER: return "dirwaiter";
     case PIN_SCRUBQUEUE: return "scrubqueue";
+    case PIN_SCATTERNUDGE: return "scatternudge";
     default: return generic_pin_name(p);
     }
   }
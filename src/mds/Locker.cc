@@ -2099,7 +2099,7 @@ int Locker::issue_caps(CInode *in, Capability *only_cap)
 					 mds->get_osd_epoch_barrier());
       in->encode_cap_message(m, cap);
 
-      mds->send_message_client_counted(m, cap->get_session());
+      mds->send_cap_message_client(m, cap->get_session());
     }
 
     if (only_cap)
@@ -4768,12 +4768,23 @@ void Locker::scatter_nudge(ScatterLock *lock, MDSContext *c, bool forcelockchang
   }
 }
 
+static unsigned inode_depth(CInode *in)
+{
+  unsigned depth = 0;
+  for (CDentry *dn = in->get_parent_dn(); dn;
+       dn = dn->get_dir()->get_inode()->get_parent_dn())
+    ++depth;
+  return depth;
+}
+
 void Locker::scatter_tick()
 {
   dout(10) << "scatter_tick" << dendl;
   
   // updated
   utime_t now = ceph_clock_now();
+  uint64_t max_nudge = g_conf().get_val<uint64_t>("mds_scatter_nudge_max_per_tick");
+  std::vector<std::pair<unsigned, ScatterLock*>> nudge;
   int n = updated_scatterlocks.size();
   while (!updated_scatterlocks.empty()) {
     ScatterLock *lock = updated_scatterlocks.front();
@@ -4788,8 +4799,24 @@ void Locker::scatter_tick()
     }
     if (now - lock->get_update_stamp() < g_conf()->mds_scatter_nudge_interval)
       break;
+    if (max_nudge && nudge.size() >= max_nudge) {
+      dout(10) << " nudged " << nudge.size() << " locks, leaving "
+	       << updated_scatterlocks.size() << " for the next tick" << dendl;
+      break;
+    }
     updated_scatterlocks.pop_front();
-    scatter_nudge(lock, 0);
+    CInode *in = static_cast<CInode*>(lock->get_parent());
+    in->get(CInode::PIN_SCATTERNUDGE);
+    nudge.emplace_back(inode_depth(in), lock);
+  }
+
+  // deepest first, so a parent's writebehind picks up what its children
+  // just propagated instead of being dirtied again by them
+  std::stable_sort(nudge.begin(), nudge.end(),
+		   [](const auto& a, const auto& b) { return a.first > b.first; });
+  for (auto& p : nudge) {
+    scatter_nudge(p.second, 0);
+    static_cast<CInode*>(p.second->get_parent())->put(CInode::PIN_SCATTERNUDGE);
   }
   mds->mdlog->flush();
 }
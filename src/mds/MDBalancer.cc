@@ -233,6 +233,12 @@ double mds_load_t::mds_load() const
   case 2:
     return cpu_load_avg;
 
+  case 3:
+    // requests in flight on average (rate * latency), so a rank that
+    // answers slowly counts as loaded even if its popularity is low,
+    // plus its CPU share in cores
+    return req_rate * req_latency + cpu_load_avg / 100.0 + queue_len;
+
   }
   ceph_abort();
   return 0;
@@ -286,11 +292,15 @@ mds_load_t MDBalancer::get_load()
 	load.req_rate = (num_requests - last_num_requests) / el;
       if (cpu_time > last_cpu_time)
 	load.cpu_load_avg = (cpu_time - last_cpu_time) / el;
+      if (num_req_latency > last_num_req_latency)
+	load.req_latency = (total_req_latency - last_total_req_latency) /
+			   (num_req_latency - last_num_req_latency);
     } else {
       auto p = mds_load.find(mds->get_nodeid());
       if (p != mds_load.end()) {
 	load.req_rate = p->second.req_rate;
 	load.cpu_load_avg = p->second.cpu_load_avg;
+	load.req_latency = p->second.req_latency;
       }
       if (num_requests >= last_num_requests && cpu_time >= last_cpu_time)
 	update_last = false;
@@ -300,6 +310,8 @@ mds_load_t MDBalancer::get_load()
   if (update_last) {
     last_num_requests = num_requests;
     last_cpu_time = cpu_time;
+    last_total_req_latency = total_req_latency;
+    last_num_req_latency = num_req_latency;
     last_get_load = now;
   }
 
@@ -632,7 +644,8 @@ void MDBalancer::prep_rebalance(int beat)
 
     dout(5) << " prep_rebalance: cluster loads are" << dendl;
 
-    mds->mdcache->migrator->clear_export_queue();
+    if (!planning)
+      mds->mdcache->migrator->clear_export_queue();
 
     // rescale!  turn my mds_load back into meta_load units
     double load_fac = 1.0;
@@ -800,7 +813,8 @@ int MDBalancer::mantle_prep_rebalance()
   /* prepare for balancing */
   int cluster_size = mds->get_mds_map()->get_num_in_mds();
   rebalance_time = clock::now();
-  mds->mdcache->migrator->clear_export_queue();
+  if (!planning)
+    mds->mdcache->migrator->clear_export_queue();
 
   /* fill in the metrics for each mds by grabbing load struct */
   vector < map<string, double> > metrics (cluster_size);
@@ -811,7 +825,8 @@ int MDBalancer::mantle_prep_rebalance()
                   {"all.meta_load", load.all.meta_load()},
                   {"req_rate", load.req_rate},
                   {"queue_len", load.queue_len},
-                  {"cpu_load_avg", load.cpu_load_avg}};
+                  {"cpu_load_avg", load.cpu_load_avg},
+                  {"req_latency", load.req_latency}};
   }
 
   /* execute the balancer */
@@ -851,6 +866,10 @@ void MDBalancer::try_rebalance(balance_state_t& state)
       continue;
     if (dir->is_freezing() || dir->is_frozen())
       continue;  // export pbly already in progress
+    if (recently_imported(dir)) {
+      dout(15) << "  recently imported " << *dir << ", leaving it" << dendl;
+      continue;
+    }
 
     mds_rank_t from = diri->authority().first;
     double pop = dir->pop_auth_subtree.meta_load();
@@ -860,7 +879,7 @@ void MDBalancer::try_rebalance(balance_state_t& state)
 	from != mds->get_nodeid()) {
       dout(5) << " exporting idle (" << pop << ") import " << *dir
 	      << " back to mds." << from << dendl;
-      mds->mdcache->migrator->export_dir_nicely(dir, from);
+      export_dir(dir, from);
       continue;
     }
 
@@ -907,7 +926,7 @@ void MDBalancer::try_rebalance(balance_state_t& state)
 	if (pop <= amount-have) {
 	  dout(5) << "reexporting " << *dir << " pop " << pop
 		  << " back to mds." << target << dendl;
-	  mds->mdcache->migrator->export_dir_nicely(dir, target);
+	  export_dir(dir, target);
 	  have += pop;
 	  import_from_map.erase(plast);
 	  for (auto q = import_pop_map.equal_range(pop);
@@ -951,7 +970,7 @@ void MDBalancer::try_rebalance(balance_state_t& state)
 	dout(0) << "reexporting " << *dir << " pop " << pop
 		<< " to mds." << target << dendl;
 	have += pop;
-	mds->mdcache->migrator->export_dir_nicely(dir, target);
+	export_dir(dir, target);
 	import_pop_map.erase(p++);
       } else {
 	++p;
@@ -990,7 +1009,7 @@ void MDBalancer::try_rebalance(balance_state_t& state)
       dout(5) << "   - exporting " << dir->pop_auth_subtree
 	      << " " << dir->pop_auth_subtree.meta_load()
 	      << " to mds." << target << " " << *dir << dendl;
-      mds->mdcache->migrator->export_dir_nicely(dir, target);
+      export_dir(dir, target);
     }
   }
 
@@ -998,6 +1017,38 @@ void MDBalancer::try_rebalance(balance_state_t& state)
   mds->mdcache->show_subtrees();
 }
 
+void MDBalancer::export_dir(CDir *dir, mds_rank_t target)
+{
+  if (planning) {
+    planned_exports.push_back({dir->dirfrag(), target,
+			       dir->pop_auth_subtree.meta_load(),
+			       estimate_export_size(dir)});
+    return;
+  }
+  mds->mdcache->migrator->export_dir_nicely(dir, target);
+}
+
+bool MDBalancer::recently_imported(CDir *dir)
+{
+  auto p = import_time.find(dir->dirfrag());
+  if (p == import_time.end())
+    return false;
+  auto cooldown = g_conf().get_val<double>("mds_bal_import_cooldown");
+  if (std::chrono::duration<double>(clock::now() - p->second).count() < cooldown)
+    return true;
+  import_time.erase(p);
+  return false;
+}
+
+/*
+ * What it costs to move a subtree: bounded by how many dentries and
+ * inodes lie under it, from the (possibly stale) recursive stats.
+ */
+uint64_t MDBalancer::estimate_export_size(const CDir *dir)
+{
+  return std::max<int64_t>(dir->fnode.rstat.rsize(), 0);
+}
+
 void MDBalancer::find_exports(CDir *dir,
                               double amount,
                               std::vector<CDir*>* exports,
@@ -1022,6 +1073,7 @@ void MDBalancer::find_exports(CDir *dir,
   double needmin = need * g_conf()->mds_bal_need_min;
   double midchunk = need * g_conf()->mds_bal_midchunk;
   double minchunk = need * g_conf()->mds_bal_minchunk;
+  auto max_export_size = g_conf().get_val<uint64_t>("mds_bal_max_export_entries");
 
   std::vector<CDir*> bigger_rep, bigger_unrep;
   multimap<double, CDir*> smaller;
@@ -1061,6 +1113,18 @@ void MDBalancer::find_exports(CDir *dir,
 	continue;
       }
 
+      // too big to move in one go?  look for pieces of it instead
+      if (max_export_size > 0 &&
+	  estimate_export_size(subdir) > max_export_size) {
+	dout(15) << "   too big to export " << estimate_export_size(subdir)
+		 << " " << *subdir << dendl;
+	if (subdir->is_rep())
+	  bigger_rep.push_back(subdir);
+	else
+	  bigger_unrep.push_back(subdir);
+	continue;
+      }
+
       // lucky find?
       if (pop > needmin && pop < needmax) {
 	exports->push_back(subdir);
@@ -1294,6 +1358,18 @@ void MDBalancer::add_import(CDir *dir)
 {
   dirfrag_load_vec_t subload = dir->pop_auth_subtree;
 
+  auto cooldown = g_conf().get_val<double>("mds_bal_import_cooldown");
+  if (cooldown > 0) {
+    auto now = clock::now();
+    for (auto p = import_time.begin(); p != import_time.end(); ) {
+      if (std::chrono::duration<double>(now - p->second).count() >= cooldown)
+	import_time.erase(p++);
+      else
+	++p;
+    }
+    import_time[dir->dirfrag()] = now;
+  }
+
   while (true) {
     dir = dir->inode->get_parent_dir();
     if (!dir) break;
@@ -1432,3 +1508,36 @@ int MDBalancer::dump_loads(Formatter *f) const
   f->close_section(); // loads
   return 0;
 }
+
+int MDBalancer::dump_plan(Formatter *f)
+{
+  if (!mds->is_active())
+    return -EAGAIN;
+  unsigned cluster_size = mds->get_mds_map()->get_num_in_mds();
+  if (mds_load.size() != cluster_size)
+    return -EAGAIN;  // no complete heartbeat round yet
+
+  planning = true;
+  planned_exports.clear();
+  if (mds->mdsmap->get_balancer() == "" || mantle_prep_rebalance() != 0)
+    prep_rebalance(beat_epoch);
+  planning = false;
+
+  f->open_object_section("plan");
+  f->dump_int("beat", beat_epoch);
+  f->dump_float("my_load", my_load);
+  f->dump_float("target_load", target_load);
+  f->open_array_section("exports");
+  for (const auto& e : planned_exports) {
+    f->open_object_section("export");
+    f->dump_stream("dirfrag") << e.df;
+    f->dump_int("target", e.target);
+    f->dump_float("pop", e.pop);
+    f->dump_unsigned("estimated_size", e.size);
+    f->close_section();
+  }
+  f->close_section(); // exports
+  f->close_section(); // plan
+  planned_exports.clear();
+  return 0;
+}
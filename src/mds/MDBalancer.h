@@ -63,6 +63,10 @@ public:
 
   void hit_inode(CInode *in, int type, int who=-1);
   void hit_dir(CDir *dir, int type, int who=-1, double amount=1.0);
+  void hit_request_latency(double lat) {
+    total_req_latency += lat;
+    num_req_latency++;
+  }
 
   void queue_split(const CDir *dir, bool fast);
   void queue_merge(CDir *dir);
@@ -79,6 +83,12 @@ public:
 
   int dump_loads(Formatter *f) const;
 
+  /**
+   * Run the balancer on the loads of the last heartbeat round without
+   * exporting anything, and dump the exports it would do.
+   */
+  int dump_plan(Formatter *f);
+
 private:
   bool bal_fragment_dirs;
   int64_t bal_fragment_interval;
@@ -127,6 +137,11 @@ private:
    */
   void try_rebalance(balance_state_t& state);
 
+  // export (or, when planning, just record) a subtree
+  void export_dir(CDir *dir, mds_rank_t target);
+  bool recently_imported(CDir *dir);
+  static uint64_t estimate_export_size(const CDir *dir);
+
   MDSRank *mds;
   Messenger *messenger;
   MonClient *mon_client;
@@ -142,6 +157,22 @@ private:
   time last_get_load = clock::zero();
   uint64_t last_num_requests = 0;
   uint64_t last_cpu_time = 0;
+  double total_req_latency = 0;
+  uint64_t num_req_latency = 0;
+  double last_total_req_latency = 0;
+  uint64_t last_num_req_latency = 0;
+
+  // when we imported each subtree, so it isn't bounced straight back
+  std::map<dirfrag_t, time> import_time;
+
+  struct planned_export_t {
+    dirfrag_t df;
+    mds_rank_t target;
+    double pop;
+    uint64_t size;
+  };
+  bool planning = false;
+  std::vector<planned_export_t> planned_exports;
 
   // Dirfrags which are marked to be passed on to MDCache::[split|merge]_dir
   // just as soon as a delayed context comes back and triggers it.
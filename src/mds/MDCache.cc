@@ -345,6 +345,14 @@ file_layout_t MDCache::gen_default_log_layout(const MDSMap &mdsmap)
     result.object_size = g_conf()->mds_log_segment_size;
     result.stripe_unit = g_conf()->mds_log_segment_size;
   }
+  // spread each journal write over several objects so they are written
+  // in parallel; only used when a new journal is created.
+  uint64_t stripe_count = g_conf().get_val<uint64_t>("mds_log_stripe_count");
+  if (stripe_count > 1 &&
+      result.object_size % (stripe_count * CEPH_MIN_STRIPE_UNIT) == 0) {
+    result.stripe_unit = result.object_size / stripe_count;
+    result.stripe_count = stripe_count;
+  }
   return result;
 }
 
@@ -9449,6 +9457,9 @@ void MDCache::request_cleanup(MDRequestRef& mdr)
 {
   dout(15) << "request_cleanup " << *mdr << dendl;
 
+  // forwarded or killed without a reply; the batched requests go on alone
+  mds->server->requeue_batch(mdr);
+
   if (mdr->has_more()) {
     if (mdr->more()->is_ambiguous_auth)
       mdr->clear_ambiguous_auth();
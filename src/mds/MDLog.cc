@@ -373,68 +373,85 @@ void MDLog::_submit_thread()
       continue;
     }
 
+    // take every event queued for this segment (up to the group limit)
+    // so they are appended back to back and share a single flush.
     int64_t features = mdsmap_up_features;
-    PendingEvent data = it->second.front();
-    it->second.pop_front();
+    uint64_t max_group = std::max<uint64_t>(
+      1, g_conf().get_val<uint64_t>("mds_log_group_commit_max_events"));
+    list<PendingEvent> group;
+    while (!it->second.empty() && group.size() < max_group) {
+      group.splice(group.end(), it->second, it->second.begin());
+    }
 
     submit_mutex.Unlock();
 
-    if (data.le) {
-      LogEvent *le = data.le;
-      LogSegment *ls = le->_segment;
-      // encode it, with event type
-      bufferlist bl;
-      le->encode_with_header(bl, features);
+    bool do_flush = false;
+    uint64_t group_unflushed = 0;
+    for (auto& data : group) {
+      if (data.le) {
+	LogEvent *le = data.le;
+	LogSegment *ls = le->_segment;
+	// encode it, with event type
+	bufferlist bl;
+	le->encode_with_header(bl, features);
 
-      uint64_t write_pos = journaler->get_write_pos();
+	uint64_t write_pos = journaler->get_write_pos();
 
-      le->set_start_off(write_pos);
-      if (le->get_type() == EVENT_SUBTREEMAP)
-	ls->offset = write_pos;
+	le->set_start_off(write_pos);
+	if (le->get_type() == EVENT_SUBTREEMAP)
+	  ls->offset = write_pos;
 
-      dout(5) << "_submit_thread " << write_pos << "~" << bl.length()
-	      << " : " << *le << dendl;
+	dout(5) << "_submit_thread " << write_pos << "~" << bl.length()
+		<< " : " << *le << dendl;
 
-      // journal it.
-      const uint64_t new_write_pos = journaler->append_entry(bl);  // bl is destroyed.
-      ls->end = new_write_pos;
+	// journal it.
+	const uint64_t new_write_pos = journaler->append_entry(bl);  // bl is destroyed.
+	ls->end = new_write_pos;
 
-      MDSLogContextBase *fin;
-      if (data.fin) {
-	fin = dynamic_cast<MDSLogContextBase*>(data.fin);
-	ceph_assert(fin);
-	fin->set_write_pos(new_write_pos);
-      } else {
-	fin = new C_MDL_Flushed(this, new_write_pos);
-      }
+	MDSLogContextBase *fin;
+	if (data.fin) {
+	  fin = dynamic_cast<MDSLogContextBase*>(data.fin);
+	  ceph_assert(fin);
+	  fin->set_write_pos(new_write_pos);
+	} else {
+	  fin = new C_MDL_Flushed(this, new_write_pos);
+	}
 
-      journaler->wait_for_flush(fin);
+	journaler->wait_for_flush(fin);
 
-      if (data.flush)
-	journaler->flush();
+	if (logger)
+	  logger->set(l_mdl_wrpos, ls->end);
 
-      if (logger)
-	logger->set(l_mdl_wrpos, ls->end);
+	delete le;
+      } else {
+	if (data.fin) {
+	  MDSContext* fin =
+		  dynamic_cast<MDSContext*>(data.fin);
+	  ceph_assert(fin);
+	  C_MDL_Flushed *fin2 = new C_MDL_Flushed(this, fin);
+	  fin2->set_write_pos(journaler->get_write_pos());
+	  journaler->wait_for_flush(fin2);
+	}
+      }
 
-      delete le;
-    } else {
-      if (data.fin) {
-	MDSContext* fin =
-		dynamic_cast<MDSContext*>(data.fin);
-	ceph_assert(fin);
-	C_MDL_Flushed *fin2 = new C_MDL_Flushed(this, fin);
-	fin2->set_write_pos(journaler->get_write_pos());
-	journaler->wait_for_flush(fin2);
+      if (data.flush) {
+	do_flush = true;
+	group_unflushed = 0;
+      } else if (data.le) {
+	group_unflushed++;
       }
-      if (data.flush)
-	journaler->flush();
     }
 
+    // one write for the whole group; the journaler stripes it over the
+    // objects of its layout.
+    if (do_flush)
+      journaler->flush();
+
     submit_mutex.Lock();
-    if (data.flush)
-      unflushed = 0;
-    else if (data.le)
-      unflushed++;
+    if (do_flush)
+      unflushed = group_unflushed;
+    else
+      unflushed += group_unflushed;
   }
 
   submit_mutex.Unlock();
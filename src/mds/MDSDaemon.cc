@@ -261,6 +261,11 @@ void MDSDaemon::set_up_admin_socket()
                                      asok_hook,
                                      "dump metadata loads");
   ceph_assert(r == 0);
+  r = admin_socket->register_command("dump balancer plan",
+                                     "dump balancer plan",
+                                     asok_hook,
+                                     "show the exports the balancer would do now, without doing them");
+  ceph_assert(r == 0);
   r = admin_socket->register_command("dump snaps",
                                      "dump snaps name=server,type=CephChoices,strings=--server,req=false",
                                      asok_hook,
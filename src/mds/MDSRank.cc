@@ -17,10 +17,12 @@
 #include "common/debug.h"
 #include "common/errno.h"
 
+#include "messages/MClientCapsBatch.h"
 #include "messages/MClientRequestForward.h"
 #include "messages/MMDSLoadTargets.h"
 #include "messages/MMDSTableRequest.h"
 
+#include "cephfs_features.h"
 #include "MDSDaemon.h"
 #include "MDSMap.h"
 #include "SnapClient.h"
@@ -765,6 +767,7 @@ void MDSRankDispatcher::tick()
 
   if (is_active()) {
     balancer->tick();
+    scrubstack->tick();
     mdcache->find_stale_fragment_freeze();
     mdcache->migrator->find_stale_export_freeze();
 
@@ -1432,6 +1435,9 @@ void MDSRank::send_message_client_counted(const ref_t<Message>& m, const Connect
 
 void MDSRank::send_message_client_counted(const ref_t<Message>& m, Session* session)
 {
+  if (!batched_cap_messages.empty())
+    flush_cap_messages(session->get_client());
+
   version_t seq = session->inc_push_seq();
   dout(10) << "send_message_client_counted " << session->info.inst.name << " seq "
 	   << seq << " " << *m << dendl;
@@ -1444,6 +1450,9 @@ void MDSRank::send_message_client_counted(const ref_t<Message>& m, Session* sess
 
 void MDSRank::send_message_client(const ref_t<Message>& m, Session* session)
 {
+  if (!batched_cap_messages.empty())
+    flush_cap_messages(session->get_client());
+
   dout(10) << "send_message_client " << session->info.inst << " " << *m << dendl;
   if (session->get_connection()) {
     session->get_connection()->send_message2(m);
@@ -1452,6 +1461,66 @@ void MDSRank::send_message_client(const ref_t<Message>& m, Session* session)
   }
 }
 
+void MDSRank::send_cap_message_client(const ref_t<MClientCaps>& m, Session* session)
+{
+  uint64_t max = g_conf().get_val<uint64_t>("mds_cap_messages_per_batch");
+  if (max <= 1 || !session->get_connection() ||
+      !session->info.has_feature(CEPHFS_FEATURE_BATCH_CAPS)) {
+    send_message_client_counted(m, session);
+    return;
+  }
+
+  version_t seq = session->inc_push_seq();
+  dout(10) << "send_cap_message_client " << session->info.inst.name << " seq "
+	   << seq << " " << *m << dendl;
+
+  if (batched_cap_messages.empty())
+    queue_waiter(new C_MDS_VoidFn(this, &MDSRank::flush_cap_messages));
+
+  client_t client = session->get_client();
+  auto& batch = batched_cap_messages[client];
+  batch.push_back(m);
+  if (batch.size() >= max)
+    flush_cap_messages(client);
+}
+
+void MDSRank::flush_cap_messages(client_t client)
+{
+  auto it = batched_cap_messages.find(client);
+  if (it == batched_cap_messages.end())
+    return;
+
+  auto batch = std::move(it->second);
+  batched_cap_messages.erase(it);
+
+  Session *session = sessionmap.get_session(entity_name_t::CLIENT(client.v));
+  if (!session) {
+    dout(10) << __func__ << " no session for client." << client << ", dropping "
+	     << batch.size() << " cap messages" << dendl;
+    return;
+  }
+  if (!session->get_connection()) {
+    for (auto& m : batch)
+      session->preopen_out_queue.push_back(m);
+    return;
+  }
+
+  dout(10) << __func__ << " sending " << batch.size() << " cap messages to "
+	   << session->info.inst.name << dendl;
+  if (batch.size() == 1) {
+    session->get_connection()->send_message2(batch.front());
+  } else {
+    session->get_connection()->send_message2(
+      make_message<MClientCapsBatch>(std::move(batch)));
+  }
+}
+
+void MDSRank::flush_cap_messages()
+{
+  while (!batched_cap_messages.empty())
+    flush_cap_messages(batched_cap_messages.begin()->first);
+}
+
 /**
  * This is used whenever a RADOS operation has been cancelled
  * or a RADOS client has been blacklisted, to cause the MDS and
@@ -2556,6 +2625,13 @@ bool MDSRankDispatcher::handle_asok_command(std::string_view command,
       ss << "Failed to dump loads: " << cpp_strerror(r);
       f->reset();
     }
+  } else if (command == "dump balancer plan") {
+    std::lock_guard l(mds_lock);
+    int r = balancer->dump_plan(f);
+    if (r != 0) {
+      ss << "Failed to plan exports: " << cpp_strerror(r);
+      f->reset();
+    }
   } else if (command == "dump snaps") {
     std::lock_guard l(mds_lock);
     string server;
@@ -22,6 +22,7 @@
 #include "common/Timer.h"
 #include "common/TrackedOp.h"
 
+#include "messages/MClientCaps.h"
 #include "messages/MClientRequest.h"
 #include "messages/MCommand.h"
 #include "messages/MMDSMap.h"
@@ -399,6 +400,15 @@ class MDSRank {
     void send_message_client(const ref_t<Message>& m, Session* session);
     void send_message(const ref_t<Message>& m, const ConnectionRef& c);
 
+    /**
+     * Send a cap message, batching it with the other cap messages for the
+     * same session that are generated before the MDS next gets around to
+     * its finished queue. Any other message to the session flushes the
+     * batch first, so ordering is preserved.
+     */
+    void send_cap_message_client(const ref_t<MClientCaps>& m, Session* session);
+    void flush_cap_messages();
+
     void wait_for_active_peer(mds_rank_t who, MDSContext *c) { 
       waiting_for_active_peer[who].push_back(c);
     }
@@ -577,6 +587,9 @@ class MDSRank {
 private:
     mono_time starttime = mono_clock::zero();
 
+    std::map<client_t, std::vector<ref_t<MClientCaps>>> batched_cap_messages;
+    void flush_cap_messages(client_t client);
+
 protected:
   Context *create_async_exec_context(C_ExecAndReply *ctx);
 };
@@ -284,6 +284,12 @@ struct MDRequestImpl : public MutationImpl {
   // indicator for vxattr osdmap update
   bool waited_for_osdmap;
 
+  // identical getattr/lookup requests that are answered along with this one
+  bool is_batch_head = false;
+  MDSCacheObject *batch_object = nullptr;
+  int batch_mask = 0;
+  vector<boost::intrusive_ptr<MDRequestImpl>> batch_reqs;
+
   // break rarely-used fields into a separately allocated structure 
   // to save memory for most ops
   struct More {
@@ -1081,7 +1081,107 @@ void OpenFileTable::_prefetch_dirfrags()
   }
 }
 
+bool OpenFileTable::_should_prefetch_inode(inodeno_t ino, RecoveredAnchor& anchor)
+{
+  if (destroyed_inos_set.count(ino))
+    return false;
+  if (anchor.d_type == DT_DIR) {
+    if (prefetch_state != DIR_INODES)
+      return false;
+    if (MDS_INO_IS_MDSDIR(ino)) {
+      anchor.auth = MDS_INO_MDSDIR_OWNER(ino);
+      return false;
+    }
+    if (MDS_INO_IS_STRAY(ino)) {
+      anchor.auth = MDS_INO_STRAY_OWNER(ino);
+      return false;
+    }
+  } else {
+    if (prefetch_state != FILE_INODES)
+      return false;
+    // load all file inodes for MDCache::identify_files_to_recover()
+  }
+  return !mds->mdcache->get_inode(ino);
+}
+
 void OpenFileTable::_prefetch_inodes()
+{
+  dout(10) << __func__ << " state " << prefetch_state << dendl;
+  ceph_assert(!num_opening_inodes);
+  ceph_assert(prefetch_state == DIR_INODES || prefetch_state == FILE_INODES);
+
+  MDCache *mdcache = mds->mdcache;
+
+  if (destroyed_inos_set.empty()) {
+    for (auto& it : logseg_destroyed_inos)
+      destroyed_inos_set.insert(it.second.begin(), it.second.end());
+  }
+
+  // Inodes whose parent directory is already in our cache are loaded by
+  // fetching the parent dirfrag, once for all of its anchored children,
+  // instead of by one backtrace lookup per inode.
+  std::set<CDir*> fetch_queue;
+  if (g_conf().get_val<bool>("mds_oft_prefetch_by_dirfrag")) {
+    CInode *last_in = nullptr;
+    for (auto& it : loaded_anchor_map) {
+      if (!_should_prefetch_inode(it.first, it.second))
+	continue;
+      CInode *diri;
+      if (last_in && last_in->ino() == it.second.dirino) {
+	diri = last_in;
+      } else {
+	diri = mdcache->get_inode(it.second.dirino);
+	if (!diri)
+	  continue;
+	last_in = diri;
+      }
+      if (!diri->is_auth() || !diri->is_dir() ||
+	  diri->state_test(CInode::STATE_REJOINUNDEF))
+	continue;
+      CDir *dir = diri->get_or_open_dirfrag(mdcache,
+					    diri->pick_dirfrag(it.second.d_name));
+      if (dir->is_auth() && !dir->is_complete() &&
+	  !dir->state_test(CDir::STATE_REJOINUNDEF))
+	fetch_queue.insert(dir);
+    }
+  }
+
+  if (fetch_queue.empty()) {
+    _open_prefetch_inodes();
+    return;
+  }
+
+  dout(10) << __func__ << " fetching " << fetch_queue.size()
+	   << " parent dirfrags" << dendl;
+  MDSGatherBuilder gather(g_ceph_context);
+  int num_opening_dirfrags = 0;
+  for (const auto& dir : fetch_queue) {
+    dir->fetch(gather.new_sub());
+
+    if (!(++num_opening_dirfrags % 1000))
+      mds->heartbeat_reset();
+  }
+  gather.set_finisher(
+      new MDSInternalContextWrapper(mds,
+	new FunctionContext([this](int r) {
+	  if (prefetch_state == DIR_INODES) {
+	    // remember which directories we loaded, as auth hints for
+	    // the backtrace lookups of their descendants
+	    for (auto& it : loaded_anchor_map) {
+	      if (it.second.d_type != DT_DIR ||
+		  it.second.auth != MDS_RANK_NONE)
+		continue;
+	      CInode *in = mds->mdcache->get_inode(it.first);
+	      if (in && in->is_auth())
+		it.second.auth = mds->get_nodeid();
+	    }
+	  }
+	  _open_prefetch_inodes();
+	})));
+  gather.activate();
+}
+
+void OpenFileTable::_open_prefetch_inodes()
 {
   dout(10) << __func__ << " state " << prefetch_state << dendl;
   ceph_assert(!num_opening_inodes);
@@ -1097,32 +1197,9 @@ void OpenFileTable::_prefetch_inodes()
 
   MDCache *mdcache = mds->mdcache;
 
-  if (destroyed_inos_set.empty()) {
-    for (auto& it : logseg_destroyed_inos)
-      destroyed_inos_set.insert(it.second.begin(), it.second.end());
-  }
-
+  // whatever the dirfrag fetches did not load is found by backtrace
   for (auto& it : loaded_anchor_map) {
-    if (destroyed_inos_set.count(it.first))
-	continue;
-    if (it.second.d_type == DT_DIR) {
-      if (prefetch_state != DIR_INODES)
-	continue;
-      if (MDS_INO_IS_MDSDIR(it.first)) {
-	it.second.auth = MDS_INO_MDSDIR_OWNER(it.first);
-	continue;
-      }
-      if (MDS_INO_IS_STRAY(it.first)) {
-	it.second.auth = MDS_INO_STRAY_OWNER(it.first);
-	continue;
-      }
-    } else {
-      if (prefetch_state != FILE_INODES)
-	continue;
-      // load all file inodes for MDCache::identify_files_to_recover()
-    }
-    CInode *in = mdcache->get_inode(it.first);
-    if (in)
+    if (!_should_prefetch_inode(it.first, it.second))
       continue;
 
     num_opening_inodes++;
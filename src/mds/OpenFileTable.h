@@ -132,7 +132,9 @@ protected:
   unsigned num_opening_inodes = 0;
   MDSContext::vec waiting_for_prefetch;
   void _open_ino_finish(inodeno_t ino, int r);
+  bool _should_prefetch_inode(inodeno_t ino, RecoveredAnchor& anchor);
   void _prefetch_inodes();
+  void _open_prefetch_inodes();
   void _prefetch_dirfrags();
 
   std::map<uint64_t, vector<inodeno_t> > logseg_destroyed_inos;
@@ -93,6 +93,7 @@ PurgeQueue::PurgeQueue(
     on_error(on_error_),
     ops_in_flight(0),
     max_purge_ops(0),
+    adaptive_purge_ops(0),
     drain_initial(0),
     draining(false),
     delayed_flush(nullptr),
@@ -123,6 +124,12 @@ void PurgeQueue::create_logger()
   pcb.add_u64(l_pq_executing_ops, "pq_executing_ops", "Purge queue ops in flight");
   pcb.add_u64(l_pq_executing, "pq_executing", "Purge queue tasks in flight");
   pcb.add_u64(l_pq_item_in_journal, "pq_item_in_journal", "Purge item left in journal");
+  pcb.add_u64_counter(l_pq_executed_ops, "pq_executed_ops",
+                      "Purge queue ops executed");
+  pcb.add_time_avg(l_pq_item_lat, "pq_item_lat",
+                   "Purge queue task completion latency");
+  pcb.add_u64(l_pq_ops_limit, "pq_ops_limit",
+              "Purge queue ops allowed in flight");
 
   logger.reset(pcb.create_perf_counters());
   g_ceph_context->get_perfcounters_collection()->add(logger.get());
@@ -372,7 +379,8 @@ bool PurgeQueue::_can_consume()
     return false;
   }
 
-  dout(20) << ops_in_flight << "/" << max_purge_ops << " ops, "
+  const uint64_t ops_limit = _get_ops_limit();
+  dout(20) << ops_in_flight << "/" << ops_limit << " ops, "
            << in_flight.size() << "/" << g_conf()->mds_max_purge_files
            << " files" << dendl;
 
@@ -384,9 +392,9 @@ bool PurgeQueue::_can_consume()
     return true;
   }
 
-  if (ops_in_flight >= max_purge_ops) {
+  if (ops_in_flight >= ops_limit) {
     dout(20) << "Throttling on op limit " << ops_in_flight << "/"
-             << max_purge_ops << dendl;
+             << ops_limit << dendl;
     return false;
   }
 
@@ -558,9 +566,21 @@ void PurgeQueue::_execute_item(
   }
   ceph_assert(gather.has_subs());
 
+  // Filer purges at most filer_max_purge_ops objects of a file at a time
+  uint64_t rounds = 1;
+  if (item.action != PurgeItem::PURGE_DIR && item.size > 0) {
+    uint64_t num = Striper::get_num_objects(item.layout, item.size);
+    uint64_t window = std::max<uint64_t>(1, g_conf()->filer_max_purge_ops);
+    rounds = (num + window - 1) / window;
+  }
+  auto start = ceph::coarse_mono_clock::now();
   gather.set_finisher(new C_OnFinisher(
-                      new FunctionContext([this, expire_to](int r){
+                      new FunctionContext([this, expire_to, ops, rounds, start](int r){
     std::lock_guard l(lock);
+    auto lat = ceph::coarse_mono_clock::now() - start;
+    logger->tinc(l_pq_item_lat, lat);
+    logger->inc(l_pq_executed_ops, ops);
+    _update_adaptive_limit(lat / rounds);
     _execute_item_complete(expire_to);
 
     _consume();
@@ -637,6 +657,38 @@ void PurgeQueue::_execute_item_complete(
   logger->inc(l_pq_executed);
 }
 
+uint64_t PurgeQueue::_get_ops_limit() const
+{
+  if (draining || !adaptive_purge_ops) {
+    return max_purge_ops;
+  }
+  return std::min(max_purge_ops, adaptive_purge_ops);
+}
+
+void PurgeQueue::_update_adaptive_limit(ceph::timespan op_lat)
+{
+  const double target = g_conf().get_val<double>("mds_purge_op_latency_target");
+  if (target <= 0 || max_purge_ops == 0) {
+    adaptive_purge_ops = 0;
+    logger->set(l_pq_ops_limit, max_purge_ops);
+    return;
+  }
+
+  // AIMD: ops slower than the target mean the OSDs are busy, so back
+  // off; otherwise creep back up to max_purge_ops.
+  uint64_t limit = adaptive_purge_ops ? adaptive_purge_ops : max_purge_ops;
+  limit = std::min(limit, max_purge_ops);
+  if (std::chrono::duration<double>(op_lat).count() > target) {
+    limit = std::max<uint64_t>(1, limit * 3 / 4);
+    dout(10) << "ops took " << op_lat << ", backing off to " << limit
+             << " ops" << dendl;
+  } else if (limit < max_purge_ops) {
+    ++limit;
+  }
+  adaptive_purge_ops = limit;
+  logger->set(l_pq_ops_limit, limit);
+}
+
 void PurgeQueue::update_op_limit(const MDSMap &mds_map)
 {
   std::lock_guard l(lock);
@@ -90,6 +90,9 @@ enum {
   l_pq_executing,
   l_pq_executed,
   l_pq_item_in_journal,
+  l_pq_executed_ops,
+  l_pq_item_lat,
+  l_pq_ops_limit,
   l_pq_last
 };
 
@@ -134,6 +137,13 @@ protected:
   // Dynamic op limit per MDS based on PG count
   uint64_t max_purge_ops;
 
+  // Share of max_purge_ops we are using, backed off while the OSDs are
+  // slow to complete our items
+  uint64_t adaptive_purge_ops;
+
+  uint64_t _get_ops_limit() const;
+  void _update_adaptive_limit(ceph::timespan op_lat);
+
   uint32_t _calculate_ops(const PurgeItem &item) const;
 
   bool _can_consume();
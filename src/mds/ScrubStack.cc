@@ -136,8 +136,13 @@ void ScrubStack::kick_off_scrubs()
               "progress and " << stack_size << " in the stack" << dendl;
   bool can_continue = true;
   elist<CInode*>::iterator i = inode_stack.begin();
-  while (g_conf()->mds_max_scrub_ops_in_progress > scrubs_in_progress &&
-         can_continue) {
+  const int max_scrub_ops = get_max_scrub_ops();
+  // a directory waiting on its children or on a dirfrag fetch stops the
+  // walk, which keeps the scrub depth first. Past a few ops in flight
+  // that leaves most of them idle in trees of small directories, so
+  // with pacing also start the directories below it on the stack.
+  const bool breadth = pacing_enabled();
+  while (max_scrub_ops > scrubs_in_progress && can_continue) {
     if (i.end()) {
       if (scrubs_in_progress == 0) {
         set_state(STATE_IDLE);
@@ -180,7 +185,7 @@ void ScrubStack::kick_off_scrubs()
         dout(20) << __func__ << " dir no-op" << dendl;
       }
 
-      can_continue = progress || terminal || completed;
+      can_continue = progress || terminal || completed || breadth;
     }
   }
 }
@@ -220,7 +225,8 @@ void ScrubStack::scrub_dir_inode(CInode *in,
     dout(20) << __func__ << " consuming from " << scrubbing_cdirs.size()
 	     << " scrubbing cdirs" << dendl;
 
-    while (g_conf()->mds_max_scrub_ops_in_progress > scrubs_in_progress) {
+    const int max_scrub_ops = get_max_scrub_ops();
+    while (max_scrub_ops > scrubs_in_progress) {
       // select next CDir
       CDir *cur_dir = NULL;
       if (!scrubbing_cdirs.empty()) {
@@ -599,6 +605,60 @@ void ScrubStack::scrub_status(Formatter *f) {
   f->close_section(); // result
 }
 
+bool ScrubStack::pacing_enabled() const {
+  return g_conf().get_val<int64_t>("mds_scrub_pacing_max_ops_in_progress") >
+    g_conf()->mds_max_scrub_ops_in_progress;
+}
+
+int ScrubStack::get_max_scrub_ops() const {
+  int base = g_conf()->mds_max_scrub_ops_in_progress;
+  if (!pacing_enabled()) {
+    return base;
+  }
+  return std::max(scrub_ops_limit, base);
+}
+
+void ScrubStack::tick() {
+  ceph_assert(mdcache->mds->mds_lock.is_locked_by_me());
+
+  PerfCounters *logger = mdcache->mds->logger;
+  if (!logger) {
+    return;
+  }
+  // average client reply latency since the last tick; 0 if there were none
+  auto cur = logger->get_tavg_ns(l_mds_reply_latency);
+  double client_lat = 0;
+  if (cur.first > reply_lat.first) {
+    client_lat = (double)(cur.second - reply_lat.second) /
+      (double)(cur.first - reply_lat.first) / 1000000000.0;
+  }
+  reply_lat = cur;
+
+  int base = g_conf()->mds_max_scrub_ops_in_progress;
+  if (!pacing_enabled()) {
+    scrub_ops_limit = base;
+    return;
+  }
+  int max = g_conf().get_val<int64_t>("mds_scrub_pacing_max_ops_in_progress");
+  double target = g_conf().get_val<double>("mds_scrub_pacing_client_latency");
+
+  // multiplicative decrease, additive increase
+  int limit = std::min(std::max(scrub_ops_limit, base), max);
+  if (target > 0 && client_lat > target) {
+    limit = std::max(limit / 2, base);
+  } else {
+    limit = std::min(limit + base, max);
+  }
+  dout(10) << __func__ << " client reply latency " << client_lat
+           << " (target " << target << "), scrub ops limit "
+           << scrub_ops_limit << " -> " << limit << dendl;
+  bool raised = limit > scrub_ops_limit;
+  scrub_ops_limit = limit;
+  if (raised && state == STATE_RUNNING) {
+    kick_off_scrubs();
+  }
+}
+
 void ScrubStack::abort_pending_scrubs() {
   ceph_assert(mdcache->mds->mds_lock.is_locked_by_me());
   ceph_assert(clear_inode_stack);
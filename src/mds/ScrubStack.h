@@ -126,6 +126,12 @@ public:
    */
   void scrub_status(Formatter *f);
 
+  /**
+   * Adjust how many scrub operations may be in flight from the client
+   * reply latency seen since the last tick (mds_scrub_pacing_*).
+   */
+  void tick();
+
 private:
   // scrub abort is _not_ a state, rather it's an operation that's
   // performed after in-progress scrubs are finished.
@@ -148,6 +154,19 @@ private:
   // to diplay out in `scrub status`.
   std::set<CInode *> scrub_origins;
 
+  // current limit on scrubs_in_progress while pacing; 0 until the first
+  // tick
+  int scrub_ops_limit = 0;
+  // l_mds_reply_latency (count, sum) as of the last tick
+  std::pair<uint64_t, uint64_t> reply_lat;
+
+  /**
+   * Pacing may raise the limit above mds_max_scrub_ops_in_progress, up
+   * to mds_scrub_pacing_max_ops_in_progress.
+   */
+  bool pacing_enabled() const;
+  int get_max_scrub_ops() const;
+
   /**
    * Put the inode at either the top or bottom of the stack, with
    * the given scrub params, and then try and kick off more scrubbing.
@@ -701,6 +701,7 @@ void Server::_session_logged(Session *session, uint64_t state_seq, bool open, ve
     ceph_assert(session->is_closing() || session->is_killing() ||
 	   session->is_opening()); // re-open closing session
     session->info.prealloc_inos.subtract(inos);
+    session->delegated_inos.clear();
     mds->inotable->apply_release_ids(inos);
     ceph_assert(mds->inotable->get_version() == piv);
   }
@@ -1756,6 +1757,8 @@ void Server::submit_mdlog_entry(LogEvent *le, MDSLogContextBase *fin, MDRequestR
 void Server::respond_to_request(MDRequestRef& mdr, int r)
 {
   if (mdr->client_request) {
+    if (mdr->is_batch_head)
+      respond_to_batch(mdr, r);
     reply_client_request(mdr, make_message<MClientReply>(*mdr->client_request, r));
   } else if (mdr->internal_op > -1) {
     dout(10) << "respond_to_request on internal request " << mdr << dendl;
@@ -1766,6 +1769,82 @@ void Server::respond_to_request(MDRequestRef& mdr, int r)
   }
 }
 
+/**
+ * Park a getattr/lookup behind an identical one (same inode or dentry, same
+ * mask) that is already being processed, so that the path traversal and
+ * lock acquisition are done once for all of them.
+ *
+ * @return true if mdr was parked and will be answered by the batch head
+ */
+bool Server::batch_client_request(MDRequestRef& mdr, MDSCacheObject *obj,
+				  int mask)
+{
+  ceph_assert(!mdr->is_batch_head);
+
+  auto em = batch_ops.emplace(std::make_pair(obj, mask), mdr);
+  if (em.second) {
+    mdr->is_batch_head = true;
+    mdr->batch_object = obj;
+    mdr->batch_mask = mask;
+    return false;
+  }
+
+  MDRequestRef& head = em.first->second;
+  dout(20) << __func__ << " " << *mdr << " waits for " << *head << dendl;
+  mdr->mark_event("batched behind identical request");
+  mdr->drop_local_auth_pins();
+  head->batch_reqs.push_back(mdr);
+  return true;
+}
+
+void Server::respond_to_batch(MDRequestRef& mdr, int r)
+{
+  if (r < 0) {
+    // errors such as -EACCES are specific to the request; let each of the
+    // batched requests find out on its own
+    requeue_batch(mdr);
+    return;
+  }
+
+  batch_ops.erase(std::make_pair(mdr->batch_object, mdr->batch_mask));
+  mdr->is_batch_head = false;
+
+  auto batch_reqs = std::move(mdr->batch_reqs);
+  mdr->batch_reqs.clear();
+  for (auto& m : batch_reqs) {
+    if (m->killed)
+      continue;
+    if (!check_access(m, mdr->tracei, MAY_READ))
+      continue;
+
+    dout(20) << __func__ << " " << *m << " along with " << *mdr << dendl;
+    m->set_mds_stamp(mdr->get_mds_stamp());
+    m->getattr_caps = mdr->getattr_caps;
+    m->tracei = mdr->tracei;
+    m->tracedn = mdr->tracedn;
+    mds->balancer->hit_inode(m->tracei, META_POP_IRD,
+			     m->client_request->get_source().num());
+    reply_client_request(m, make_message<MClientReply>(*m->client_request, r));
+  }
+}
+
+void Server::requeue_batch(MDRequestRef& mdr)
+{
+  if (!mdr->is_batch_head)
+    return;
+
+  dout(20) << __func__ << " " << *mdr << " requeueing "
+	   << mdr->batch_reqs.size() << " batched requests" << dendl;
+  batch_ops.erase(std::make_pair(mdr->batch_object, mdr->batch_mask));
+  mdr->is_batch_head = false;
+
+  for (auto& m : mdr->batch_reqs) {
+    if (!m->killed)
+      mds->queue_waiter(new C_MDS_RetryRequest(mdcache, m));
+  }
+  mdr->batch_reqs.clear();
+}
+
 // statistics mds req op number and latency 
 void Server::perf_gather_op_latency(const cref_t<MClientRequest> &req, utime_t lat)
 {
@@ -1923,6 +2002,7 @@ void Server::early_reply(MDRequestRef& mdr, CInode *tracei, CDentry *tracedn)
   mds->logger->inc(l_mds_reply);
   utime_t lat = ceph_clock_now() - req->get_recv_stamp();
   mds->logger->tinc(l_mds_reply_latency, lat);
+  mds->balancer->hit_request_latency(lat);
   if (client_inst.name.is_client()) {
     mds->sessionmap.hit_session(mdr->session);
   }
@@ -1983,6 +2063,7 @@ void Server::reply_client_request(MDRequestRef& mdr, const ref_t<MClientReply> &
     mds->logger->inc(l_mds_reply);
     utime_t lat = ceph_clock_now() - mdr->client_request->get_recv_stamp();
     mds->logger->tinc(l_mds_reply_latency, lat);
+    mds->balancer->hit_request_latency(lat);
     if (session && client_inst.name.is_client()) {
       mds->sessionmap.hit_session(session);
     }
@@ -3195,6 +3276,25 @@ CInode* Server::prepare_new_inode(MDRequestRef& mdr, CDir *dir, inodeno_t useino
   return in;
 }
 
+/*
+ * Tell the client which ino it created, then pass it some more
+ * preallocated inos it may put in head.ino of its next creates.
+ */
+void Server::encode_created_ino(MDRequestRef& mdr, CInode *newi)
+{
+  Session *session = mdr->session;
+  interval_set<inodeno_t> inos;
+  if (!session->is_opening()) {
+    unsigned want = std::min<uint64_t>(
+      g_conf().get_val<uint64_t>("mds_client_delegate_inos"),
+      g_conf()->mds_client_prealloc_inos / 2);
+    session->delegate_inos(want, inos);
+  }
+  dout(10) << __func__ << " " << newi->ino() << " delegating " << inos << dendl;
+  encode(newi->inode.ino, mdr->reply_extra_bl);
+  encode(inos, mdr->reply_extra_bl);
+}
+
 void Server::journal_allocated_inos(MDRequestRef& mdr, EMetaBlob *blob)
 {
   dout(20) << "journal_allocated_inos sessionmapv " << mds->sessionmap.get_projected()
@@ -3526,6 +3626,41 @@ CDir* Server::try_open_auth_dirfrag(CInode *diri, frag_t fg, MDRequestRef& mdr)
   return dir;
 }
 
+/**
+ * readdir walks the dirfrags in hash order, so when it has to fetch one,
+ * start fetching the ones after it too rather than one after the other.
+ */
+void Server::prefetch_dirfrags(CInode *diri, frag_t fg)
+{
+  int64_t max = g_conf().get_val<int64_t>("mds_dir_prefetch_frags");
+  if (max <= 0)
+    return;
+
+  frag_vec_t leaves;
+  diri->dirfragtree.get_leaves(leaves);
+  std::sort(leaves.begin(), leaves.end(),
+	    [](frag_t a, frag_t b) { return a.value() < b.value(); });
+
+  auto p = std::find(leaves.begin(), leaves.end(), fg);
+  if (p == leaves.end())
+    return;
+
+  for (++p; p != leaves.end() && max > 0; ++p, --max) {
+    CDir *dir = diri->get_dirfrag(*p);
+    if (!dir) {
+      if (!diri->is_auth() || diri->is_frozen())
+	continue;
+      dir = diri->get_or_open_dirfrag(mdcache, *p);
+    }
+    if (!dir->is_auth() || dir->is_complete() || dir->is_frozen() ||
+	dir->state_test(CDir::STATE_FETCHING))
+      continue;
+
+    dout(10) << __func__ << " " << *dir << dendl;
+    dir->fetch(nullptr);
+  }
+}
+
 
 // ===============================================================================
 // STAT
@@ -3566,28 +3701,59 @@ void Server::handle_client_getattr(MDRequestRef& mdr, bool is_lookup)
 	      mdr->snapid <= cap->client_follows))
     issued = cap->issued();
 
-  if ((mask & CEPH_CAP_LINK_SHARED) && !(issued & CEPH_CAP_LINK_EXCL))
-    lov.add_rdlock(&ref->linklock);
-  if ((mask & CEPH_CAP_AUTH_SHARED) && !(issued & CEPH_CAP_AUTH_EXCL))
-    lov.add_rdlock(&ref->authlock);
-  if ((mask & CEPH_CAP_XATTR_SHARED) && !(issued & CEPH_CAP_XATTR_EXCL))
-    lov.add_rdlock(&ref->xattrlock);
-  if ((mask & CEPH_CAP_FILE_SHARED) && !(issued & CEPH_CAP_FILE_EXCL)) {
-    // Don't wait on unstable filelock if client is allowed to read file size.
-    // This can reduce the response time of getattr in the case that multiple
-    // clients do stat(2) and there are writers.
-    // The downside of this optimization is that mds may not issue Fs caps along
-    // with getattr reply. Client may need to send more getattr requests.
-    if (mdr->is_rdlocked(&ref->filelock)) {
+  // a batch head answers for other clients too, so it must rdlock
+  // everything in the mask rather than trust its own client's caps
+  bool batch_head = mdr->is_batch_head;
+  bool all_rdlocked = true;
+  if (mask & CEPH_CAP_LINK_SHARED) {
+    if (batch_head || !(issued & CEPH_CAP_LINK_EXCL))
+      lov.add_rdlock(&ref->linklock);
+    else
+      all_rdlocked = false;
+  }
+  if (mask & CEPH_CAP_AUTH_SHARED) {
+    if (batch_head || !(issued & CEPH_CAP_AUTH_EXCL))
+      lov.add_rdlock(&ref->authlock);
+    else
+      all_rdlocked = false;
+  }
+  if (mask & CEPH_CAP_XATTR_SHARED) {
+    if (batch_head || !(issued & CEPH_CAP_XATTR_EXCL))
+      lov.add_rdlock(&ref->xattrlock);
+    else
+      all_rdlocked = false;
+  }
+  // Don't wait on unstable filelock if client is allowed to read file size.
+  // This can reduce the response time of getattr in the case that multiple
+  // clients do stat(2) and there are writers.
+  // The downside of this optimization is that mds may not issue Fs caps along
+  // with getattr reply. Client may need to send more getattr requests.
+  if (mask & CEPH_CAP_FILE_SHARED) {
+    if (!batch_head && (issued & CEPH_CAP_FILE_EXCL)) {
+      all_rdlocked = false;
+    } else if (mdr->is_rdlocked(&ref->filelock)) {
       lov.add_rdlock(&ref->filelock);
-    } else if (ref->filelock.is_stable() ||
+    } else if (batch_head ||
+	       ref->filelock.is_stable() ||
 	       ref->filelock.get_num_wrlocks() > 0 ||
 	       !ref->filelock.can_read(mdr->get_client())) {
       lov.add_rdlock(&ref->filelock);
       mdr->done_locking = false;
+    } else {
+      all_rdlocked = false;
     }
   }
 
+  if (all_rdlocked && !batch_head && mdr->snapid == CEPH_NOSNAP &&
+      mdr->locks.empty() &&
+      g_conf().get_val<bool>("mds_batch_getattr_lookup")) {
+    MDSCacheObject *obj = ref;
+    if (is_lookup)
+      obj = mdr->dn[0].back();
+    if (batch_client_request(mdr, obj, mask))
+      return;
+  }
+
   if (!mds->locker->acquire_locks(mdr, lov))
     return;
 
@@ -4203,7 +4369,9 @@ void Server::handle_client_openc(MDRequestRef& mdr)
 
   C_MDS_openc_finish *fin = new C_MDS_openc_finish(this, mdr, dn, in);
 
-  if (mdr->client_request->get_connection()->has_feature(CEPH_FEATURE_REPLY_CREATE_INODE)) {
+  if (mdr->session->info.has_feature(CEPHFS_FEATURE_DELEG_INO)) {
+    encode_created_ino(mdr, in);
+  } else if (mdr->client_request->get_connection()->has_feature(CEPH_FEATURE_REPLY_CREATE_INODE)) {
     dout(10) << "adding ino to reply to indicate inode was created" << dendl;
     // add the file created flag onto the reply if create_flags features is supported
     encode(in->inode.ino, mdr->reply_extra_bl);
@@ -4294,6 +4462,7 @@ void Server::handle_client_readdir(MDRequestRef& mdr)
     // fetch
     dout(10) << " incomplete dir contents for readdir on " << *dir << ", fetching" << dendl;
     dir->fetch(new C_MDS_RetryRequest(mdcache, mdr), true);
+    prefetch_dirfrags(diri, dir->get_frag());
     return;
   }
 
@@ -5780,6 +5949,9 @@ void Server::handle_client_mknod(MDRequestRef& mdr)
 				    PREDIRTY_PRIMARY|PREDIRTY_DIR, 1);
   le->metablob.add_primary_dentry(dn, newi, true, true, true);
 
+  if (mdr->session->info.has_feature(CEPHFS_FEATURE_DELEG_INO))
+    encode_created_ino(mdr, newi);
+
   journal_and_reply(mdr, newi, dn, le, new C_MDS_mknod_finish(this, mdr, dn, newi));
 }
 
@@ -5868,6 +6040,9 @@ void Server::handle_client_mkdir(MDRequestRef& mdr)
   // make sure this inode gets into the journal
   le->metablob.add_opened_ino(newi->ino());
 
+  if (mdr->session->info.has_feature(CEPHFS_FEATURE_DELEG_INO))
+    encode_created_ino(mdr, newi);
+
   journal_and_reply(mdr, newi, dn, le, new C_MDS_mknod_finish(this, mdr, dn, newi));
 
   // We hit_dir (via hit_inode) in our finish callback, but by then we might
@@ -5926,6 +6101,9 @@ void Server::handle_client_symlink(MDRequestRef& mdr)
   mdcache->predirty_journal_parents(mdr, &le->metablob, newi, dn->get_dir(), PREDIRTY_PRIMARY|PREDIRTY_DIR, 1);
   le->metablob.add_primary_dentry(dn, newi, true, true);
 
+  if (mdr->session->info.has_feature(CEPHFS_FEATURE_DELEG_INO))
+    encode_created_ino(mdr, newi);
+
   journal_and_reply(mdr, newi, dn, le, new C_MDS_mknod_finish(this, mdr, dn, newi));
 }
 
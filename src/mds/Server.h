@@ -188,6 +188,8 @@ public:
   void perf_gather_op_latency(const cref_t<MClientRequest> &req, utime_t lat);
   void early_reply(MDRequestRef& mdr, CInode *tracei, CDentry *tracedn);
   void respond_to_request(MDRequestRef& mdr, int r = 0);
+  bool batch_client_request(MDRequestRef& mdr, MDSCacheObject *obj, int mask);
+  void requeue_batch(MDRequestRef& mdr);
   void set_trace_dist(Session *session, const ref_t<MClientReply> &reply, CInode *in, CDentry *dn,
 		      snapid_t snapid,
 		      int num_dentries_wanted,
@@ -210,6 +212,7 @@ public:
   CDentry *prepare_stray_dentry(MDRequestRef& mdr, CInode *in);
   CInode* prepare_new_inode(MDRequestRef& mdr, CDir *dir, inodeno_t useino, unsigned mode,
 			    file_layout_t *layout=NULL);
+  void encode_created_ino(MDRequestRef& mdr, CInode *newi);
   void journal_allocated_inos(MDRequestRef& mdr, EMetaBlob *blob);
   void apply_allocated_inos(MDRequestRef& mdr, Session *session);
 
@@ -223,6 +226,7 @@ public:
 				    file_layout_t **layout=nullptr);
 
   CDir* try_open_auth_dirfrag(CInode *diri, frag_t fg, MDRequestRef& mdr);
+  void prefetch_dirfrags(CInode *diri, frag_t fg);
 
 
   // requests on existing inodes.
@@ -348,8 +352,12 @@ public:
 
 private:
   void reply_client_request(MDRequestRef& mdr, const ref_t<MClientReply> &reply);
+  void respond_to_batch(MDRequestRef& mdr, int r);
   void flush_session(Session *session, MDSGatherBuilder *gather);
 
+  // in-flight getattr/lookup requests, by inode or dentry and getattr mask
+  map<pair<MDSCacheObject*, int>, MDRequestRef> batch_ops;
+
   DecayCounter recall_throttle;
   time last_recall_state;
 };
@@ -181,6 +181,7 @@ public:
   size_t get_request_count();
 
   interval_set<inodeno_t> pending_prealloc_inos; // journaling prealloc, will be added to prealloc_inos
+  interval_set<inodeno_t> delegated_inos; // part of prealloc_inos the client may pick itself (not persisted)
 
   void notify_cap_release(size_t n_caps);
   uint64_t notify_recall_sent(size_t new_limit);
@@ -206,18 +207,47 @@ public:
     ceph_assert(!info.prealloc_inos.empty());
 
     if (ino) {
-      if (info.prealloc_inos.contains(ino))
+      if (info.prealloc_inos.contains(ino)) {
 	info.prealloc_inos.erase(ino);
-      else
+	if (delegated_inos.contains(ino))
+	  delegated_inos.erase(ino);
+      } else {
 	ino = 0;
+      }
     }
     if (!ino) {
-      ino = info.prealloc_inos.range_start();
+      // leave the delegated ones to the client
+      interval_set<inodeno_t> avail(info.prealloc_inos);
+      avail.subtract(delegated_inos);
+      if (!avail.empty()) {
+	ino = avail.range_start();
+      } else {
+	ino = info.prealloc_inos.range_start();
+	delegated_inos.erase(ino);
+      }
       info.prealloc_inos.erase(ino);
     }
     info.used_inos.insert(ino, 1);
     return ino;
   }
+  /**
+   * Hand up to @want of our preallocated inos, which are not delegated
+   * yet, to the client, so it can pick the numbers of the inodes it
+   * creates itself.
+   */
+  void delegate_inos(unsigned want, interval_set<inodeno_t>& inos) {
+    if (delegated_inos.size() >= want)
+      return;
+    want -= delegated_inos.size();
+    interval_set<inodeno_t> avail(info.prealloc_inos);
+    avail.subtract(delegated_inos);
+    for (auto p = avail.begin(); p != avail.end() && want > 0; ++p) {
+      uint64_t len = std::min<uint64_t>(p.get_len(), want);
+      inos.insert(p.get_start(), len);
+      want -= len;
+    }
+    delegated_inos.insert(inos);
+  }
   int get_num_projected_prealloc_inos() const {
     return info.prealloc_inos.size() + pending_prealloc_inos.size();
   }
@@ -432,6 +462,7 @@ public:
 
   void clear() {
     pending_prealloc_inos.clear();
+    delegated_inos.clear();
     info.clear_meta();
 
     cap_push_seq = 0;
@@ -34,6 +34,11 @@
 #define CEPHFS_FEATURE_NAUTILUS         12
 #define CEPHFS_FEATURE_OCTOPUS          13
 
+// The kernel client advertises bits 13 to 21 for its own features, so
+// bits for features it doesn't support must stay clear of them.
+#define CEPHFS_FEATURE_DELEG_INO        22
+#define CEPHFS_FEATURE_BATCH_CAPS       23
+
 #define CEPHFS_FEATURES_ALL {		\
   0, 1, 2, 3, 4,			\
   CEPHFS_FEATURE_JEWEL,			\
@@ -46,6 +51,8 @@
   CEPHFS_FEATURE_MULTI_RECONNECT,	\
   CEPHFS_FEATURE_NAUTILUS,              \
   CEPHFS_FEATURE_OCTOPUS,               \
+  CEPHFS_FEATURE_DELEG_INO,             \
+  CEPHFS_FEATURE_BATCH_CAPS,            \
 }
 
 #define CEPHFS_FEATURES_MDS_SUPPORTED CEPHFS_FEATURES_ALL
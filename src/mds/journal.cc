@@ -51,6 +51,7 @@
 #include "MDSTableServer.h"
 
 #include "Locker.h"
+#include "cephfs_features.h"
 
 #define dout_context g_ceph_context
 #define dout_subsys ceph_subsys_mds
@@ -1498,7 +1499,8 @@ void EMetaBlob::replay(MDSRank *mds, LogSegment *logseg, MDSlaveUpdate *slaveup)
 	  if (!session->info.prealloc_inos.empty()) {
 	    inodeno_t next = session->next_ino();
 	    inodeno_t i = session->take_ino(used_preallocated_ino);
-	    if (next != i)
+	    // clients with delegated inos use them in any order
+	    if (next != i && !session->info.has_feature(CEPHFS_FEATURE_DELEG_INO))
 	      mds->clog->warn() << " replayed op " << client_reqs << " used ino " << i
 			       << " but session next is " << next;
 	    ceph_assert(i == used_preallocated_ino);
@@ -1673,6 +1673,7 @@ struct mds_load_t {
   double queue_len = 0.0;
 
   double cpu_load_avg = 0.0;
+  double req_latency = 0.0;  // mean reply latency in seconds
 
   double mds_load() const;  // defiend in MDBalancer.cc
   void encode(bufferlist& bl) const;
@@ -1694,6 +1695,7 @@ inline std::ostream& operator<<(std::ostream& out, const mds_load_t& load)
              << ", hr " << load.cache_hit_rate
              << ", qlen " << load.queue_len
 	     << ", cpu " << load.cpu_load_avg
+	     << ", lat " << load.req_latency
              << ">";
 }
 
@@ -0,0 +1,76 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_MCLIENTCAPSBATCH_H
+#define CEPH_MCLIENTCAPSBATCH_H
+
+#include "msg/Message.h"
+#include "MClientCaps.h"
+
+/**
+ * Several MClientCaps for one client session, sent as a single message.
+ * The MDS only sends these to clients that advertise
+ * CEPHFS_FEATURE_BATCH_CAPS; the caps are handled in order.
+ */
+class MClientCapsBatch : public Message {
+private:
+  static constexpr int HEAD_VERSION = 1;
+  static constexpr int COMPAT_VERSION = 1;
+
+public:
+  std::vector<ref_t<MClientCaps>> caps;
+
+protected:
+  MClientCapsBatch() :
+    Message{CEPH_MSG_CLIENT_CAPS_BATCH, HEAD_VERSION, COMPAT_VERSION} {}
+  MClientCapsBatch(std::vector<ref_t<MClientCaps>>&& c) :
+    Message{CEPH_MSG_CLIENT_CAPS_BATCH, HEAD_VERSION, COMPAT_VERSION},
+    caps(std::move(c)) {}
+  ~MClientCapsBatch() override {}
+
+public:
+  std::string_view get_type_name() const override { return "client_caps_batch"; }
+  void print(ostream& out) const override {
+    out << "client_caps_batch(" << caps.size() << " caps)";
+  }
+
+  void encode_payload(uint64_t features) override {
+    using ceph::encode;
+    encode(static_cast<uint32_t>(caps.size()), payload);
+    for (auto& m : caps) {
+      encode_message(m.get(), features, payload);
+    }
+  }
+  void decode_payload() override {
+    using ceph::decode;
+    auto p = payload.cbegin();
+    uint32_t n;
+    decode(n, p);
+    caps.clear();
+    caps.reserve(n);
+    for (uint32_t i = 0; i < n; ++i) {
+      Message *m = decode_message(NULL, 0, p);
+      if (!m || m->get_type() != CEPH_MSG_CLIENT_CAPS) {
+	if (m)
+	  m->put();
+	throw buffer::malformed_input("bad message in client_caps_batch");
+      }
+      // decode_message hands us the only reference
+      caps.emplace_back(static_cast<MClientCaps*>(m), false);
+    }
+  }
+private:
+  template<class T, typename... Args>
+  friend boost::intrusive_ptr<T> ceph::make_message(Args&&... args);
+};
+
+#endif
@@ -24,7 +24,7 @@
 
 class MOSDRepOp : public MOSDFastDispatchOp {
 private:
-  static constexpr int HEAD_VERSION = 2;
+  static constexpr int HEAD_VERSION = 3;
   static constexpr int COMPAT_VERSION = 1;
 
 public:
@@ -56,6 +56,7 @@ public:
   eversion_t pg_trim_to;   // primary->replica: trim to here
   eversion_t pg_roll_forward_to;   // primary->replica: trim rollback
                                     // info to here
+  eversion_t min_last_complete_ondisk; // lower bound on committed version
 
   hobject_t new_temp_oid;      ///< new temp object that we must now start tracking
   hobject_t discard_temp_oid;  ///< previously used temp object that we can now stop tracking
@@ -111,6 +112,9 @@ public:
     decode(from, p);
     decode(updated_hit_set_history, p);
     decode(pg_roll_forward_to, p);
+    if (header.version >= 3) {
+      decode(min_last_complete_ondisk, p);
+    }
     final_decode_needed = false;
   }
 
@@ -138,6 +142,7 @@ public:
     encode(from, payload);
     encode(updated_hit_set_history, payload);
     encode(pg_roll_forward_to, payload);
+    encode(min_last_complete_ondisk, payload);
   }
 
   MOSDRepOp()
@@ -242,40 +242,47 @@ PyObject *ActivePyModules::get_python(const std::string &what)
         [&f, &tstate](const PGMap &pg_map) {
           PyEval_RestoreThread(tstate);
 
-          std::map<std::string, std::map<std::string, uint32_t> > osds;
-          std::map<std::string, std::map<std::string, uint32_t> > pools;
-          std::map<std::string, uint32_t> all;
+          // count by raw state bits and only turn the (few) distinct
+          // states into strings at the end; the per-pool and overall
+          // counts are kept up to date by the PGMap already
+          std::map<int32_t, std::map<uint64_t, uint32_t> > osds;
           for (const auto &i : pg_map.pg_stat) {
-            const auto pool = i.first.m_pool;
-            const std::string state = pg_state_string(i.second.state);
-            // Insert to per-pool map
-            pools[stringify(pool)][state]++;
             for (const auto &osd_id : i.second.acting) {
-              osds[stringify(osd_id)][state]++;
+              osds[osd_id][i.second.state]++;
             }
-            all[state]++;
           }
+          std::map<uint64_t, std::string> state_names;
+          auto state_name = [&state_names](uint64_t state) -> const char* {
+            auto p = state_names.find(state);
+            if (p == state_names.end()) {
+              p = state_names.emplace(state, pg_state_string(state)).first;
+            }
+            return p->second.c_str();
+          };
           f.open_object_section("by_osd");
           for (const auto &i : osds) {
-            f.open_object_section(i.first.c_str());
+            f.open_object_section(stringify(i.first).c_str());
             for (const auto &j : i.second) {
-              f.dump_int(j.first.c_str(), j.second);
+              f.dump_int(state_name(j.first), j.second);
             }
             f.close_section();
           }
           f.close_section();
           f.open_object_section("by_pool");
-          for (const auto &i : pools) {
-            f.open_object_section(i.first.c_str());
+          for (const auto &i : pg_map.num_pg_by_pool_state) {
+            if (i.second.empty()) {
+              continue;
+            }
+            f.open_object_section(stringify(i.first).c_str());
             for (const auto &j : i.second) {
-              f.dump_int(j.first.c_str(), j.second);
+              f.dump_int(state_name(j.first), j.second);
             }
             f.close_section();
           }
           f.close_section();
           f.open_object_section("all");
-          for (const auto &i : all) {
-            f.dump_int(i.first.c_str(), i.second);
+          for (const auto &i : pg_map.num_pg_by_state) {
+            f.dump_int(state_name(i.first), i.second);
           }
           f.close_section();
           f.open_object_section("pg_stats_sum");
@@ -800,6 +807,53 @@ PyObject* ActivePyModules::get_perf_schema_python(
   return f.get();
 }
 
+PyObject* ActivePyModules::get_perf_counters_python(
+    const std::string &svc_type,
+    int64_t prio_limit)
+{
+  PyThreadState *tstate = PyEval_SaveThread();
+  std::lock_guard l(lock);
+  PyEval_RestoreThread(tstate);
+
+  // schema and latest value of every counter in one pass, rather than
+  // one get_latest_counter() round trip per counter
+  PyFormatter f;
+  auto daemons = daemon_state.get_by_service(svc_type);
+  for (const auto& [key, state] : daemons) {
+    std::ostringstream daemon_name;
+    daemon_name << key.first << "." << key.second;
+    f.open_object_section(daemon_name.str().c_str());
+
+    std::lock_guard l(state->lock);
+    for (const auto& [counter_name, instance] :
+	   state->perf_counters.instances) {
+      const auto& type = state->perf_counters.types[counter_name];
+      if (type.priority < prio_limit) {
+	continue;
+      }
+      f.open_object_section(counter_name.c_str());
+      f.dump_string("description", type.description);
+      if (!type.nick.empty()) {
+	f.dump_string("nick", type.nick);
+      }
+      f.dump_unsigned("type", type.type);
+      f.dump_unsigned("priority", type.priority);
+      f.dump_unsigned("units", type.unit);
+      if (type.type & PERFCOUNTER_LONGRUNAVG) {
+	const auto& data = instance.get_data_avg();
+	f.dump_unsigned("value", data.empty() ? 0 : data.back().s);
+	f.dump_unsigned("count", data.empty() ? 0 : data.back().c);
+      } else {
+	const auto& data = instance.get_data();
+	f.dump_unsigned("value", data.empty() ? 0 : data.back().v);
+      }
+      f.close_section();
+    }
+    f.close_section();
+  }
+  return f.get();
+}
+
 PyObject *ActivePyModules::get_context()
 {
   PyThreadState *tstate = PyEval_SaveThread();
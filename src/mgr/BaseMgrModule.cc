@@ -608,6 +608,19 @@ get_perf_schema(BaseMgrModule *self, PyObject *args)
   return self->py_modules->get_perf_schema_python(type_str, svc_id);
 }
 
+static PyObject*
+get_perf_counters(BaseMgrModule *self, PyObject *args)
+{
+  char *type_str = nullptr;
+  int prio_limit = 0;
+  if (!PyArg_ParseTuple(args, "si:get_perf_counters", &type_str,
+                                                      &prio_limit)) {
+    return nullptr;
+  }
+
+  return self->py_modules->get_perf_counters_python(type_str, prio_limit);
+}
+
 static PyObject *
 ceph_get_osdmap(BaseMgrModule *self, PyObject *args)
 {
@@ -1050,6 +1063,9 @@ PyMethodDef BaseMgrModule_methods[] = {
   {"_ceph_get_perf_schema", (PyCFunction)get_perf_schema, METH_VARARGS,
     "Get the performance counter schema"},
 
+  {"_ceph_get_perf_counters", (PyCFunction)get_perf_counters, METH_VARARGS,
+    "Get the schema and latest value of every performance counter of a service type"},
+
   {"_ceph_log", (PyCFunction)ceph_log, METH_VARARGS,
    "Emit a (local) log message"},
 
@@ -24,9 +24,18 @@ enum class OSDPerfMetricSubKeyType : uint8_t {
 };
 
 struct OSDPerfMetricSubKeyDescriptor {
+  // the catch-all patterns the mgr modules use; on the OSD they are
+  // matched without running the regex engine
+  enum class MatchAll : uint8_t {
+    NONE = 0,
+    ANY = 1,        // "^(.*)$"
+    NON_EMPTY = 2,  // "^(.+)$"
+  };
+
   OSDPerfMetricSubKeyType type = static_cast<OSDPerfMetricSubKeyType>(-1);
   std::string regex_str;
   std::regex regex;
+  MatchAll match_all = MatchAll::NONE;
 
   bool is_supported() const {
     switch (type) {
@@ -52,6 +61,16 @@ struct OSDPerfMetricSubKeyDescriptor {
     : type(type), regex_str(regex) {
   }
 
+  void set_match_all() {
+    if (regex_str == "^(.*)$") {
+      match_all = MatchAll::ANY;
+    } else if (regex_str == "^(.+)$") {
+      match_all = MatchAll::NON_EMPTY;
+    } else {
+      match_all = MatchAll::NONE;
+    }
+  }
+
   bool operator<(const OSDPerfMetricSubKeyDescriptor &other) const {
     if (type < other.type) {
       return true;
@@ -121,6 +140,7 @@ struct denc_traits<OSDPerfMetricKeyDescriptor> {
         v.clear();
         return;
       }
+      d.set_match_all();
       v.push_back(std::move(d));
     }
   }
@@ -538,7 +538,7 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
       }
     } else {
       ceph_assert(!inc.have_crc);
-      put_version_full(t, osdmap.epoch, full_bl);
+      put_full_map(t, osdmap.epoch, full_bl);
     }
     put_version_latest_full(t, osdmap.epoch);
 
@@ -1570,7 +1570,7 @@ void OSDMonitor::encode_pending(MonitorDBStore::TransactionRef t)
     // include full map in the txn.  note that old monitors will
     // overwrite this.  new ones will now skip the local full map
     // encode and reload from this.
-    put_version_full(t, pending_inc.epoch, fullbl);
+    put_full_map(t, pending_inc.epoch, fullbl);
   }
 
   // encode
@@ -1841,7 +1841,7 @@ void OSDMonitor::encode_trim_extra(MonitorDBStore::TransactionRef tx,
   dout(10) << __func__ << " including full map for e " << first << dendl;
   bufferlist bl;
   get_version_full(first, bl);
-  put_version_full(tx, first, bl);
+  put_full_map(tx, first, bl);
 
   if (has_osdmap_manifest &&
       first > osdmap_manifest.get_first_pinned()) {
@@ -2684,15 +2684,8 @@ bool OSDMonitor::check_failure(utime_t now, int target_osd, failure_info_t& fi)
   for (map<int,failure_reporter_t>::iterator p = fi.reporters.begin();
 	p != fi.reporters.end();
 	++p) {
-    // get the parent bucket whose type matches with "reporter_subtree_level".
-    // fall back to OSD if the level doesn't exist.
-    map<string, string> reporter_loc = osdmap.crush->get_full_location(p->first);
-    map<string, string>::iterator iter = reporter_loc.find(reporter_subtree_level);
-    if (iter == reporter_loc.end()) {
-      reporters_by_subtree.insert("osd." + to_string(p->first));
-    } else {
-      reporters_by_subtree.insert(iter->second);
-    }
+    reporters_by_subtree.insert(
+      get_reporter_subtree(p->first, reporter_subtree_level));
     if (g_conf()->mon_osd_adjust_heartbeat_grace) {
       const osd_xinfo_t& xi = osdmap.get_xinfo(p->first);
       utime_t elapsed = now - xi.down_stamp;
@@ -2731,6 +2724,35 @@ bool OSDMonitor::check_failure(utime_t now, int target_osd, failure_info_t& fi)
   return false;
 }
 
+const string& OSDMonitor::get_reporter_subtree(int reporter,
+					       const string& level)
+{
+  // each report re-walks all of the target's reporters; looking up their
+  // crush location every time makes a report storm quadratic
+  if (reporter_subtree_epoch != osdmap.get_epoch() ||
+      reporter_subtree_level != level) {
+    reporter_subtree.clear();
+    reporter_subtree_epoch = osdmap.get_epoch();
+    reporter_subtree_level = level;
+  }
+  auto p = reporter_subtree.find(reporter);
+  if (p != reporter_subtree.end()) {
+    return p->second;
+  }
+
+  // get the parent bucket whose type matches with "reporter_subtree_level".
+  // fall back to OSD if the level doesn't exist.
+  map<string, string> reporter_loc = osdmap.crush->get_full_location(reporter);
+  map<string, string>::iterator iter = reporter_loc.find(level);
+  string subtree;
+  if (iter == reporter_loc.end()) {
+    subtree = "osd." + to_string(reporter);
+  } else {
+    subtree = iter->second;
+  }
+  return reporter_subtree.emplace(reporter, std::move(subtree)).first->second;
+}
+
 void OSDMonitor::force_failure(int target_osd, int by)
 {
   // already pending failure?
@@ -3843,10 +3865,18 @@ void OSDMonitor::send_incremental(epoch_t first,
     m->oldest_map = get_first_committed();
     m->newest_map = osdmap.get_epoch();
 
+    // clients only need the current map, so rather than a full map of the
+    // first committed epoch followed by every incremental since, jump them
+    // straight to the latest one.  osds need the complete history.
+    if (!session->name.is_osd() &&
+	g_conf().get_val<bool>("mon_osdmap_client_skip_to_latest")) {
+      m->oldest_map = osdmap.get_epoch();
+    }
+
     // share removed snaps during the gap
     get_removed_snaps_range(first, m->oldest_map, &m->gap_removed_snaps);
 
-    first = get_first_committed();
+    first = m->oldest_map;
     bufferlist bl;
     int err = get_version_full(first, features, bl);
     ceph_assert(err == 0);
@@ -3953,6 +3983,133 @@ void OSDMonitor::reencode_full_map(bufferlist& bl, uint64_t features)
   m.encode(bl, f | CEPH_FEATURE_RESERVED);
 }
 
+// a compressed full map starts with this byte, which no plain OSDMap
+// encoding (first byte: its struct_v) uses
+static constexpr uint8_t OSDMAP_FULL_COMPRESSED_MARKER = 0xff;
+
+CompressorRef OSDMonitor::get_full_map_compressor(CephContext *cct,
+						 CompressorRef *cached,
+						 int alg)
+{
+  if (!*cached || (*cached)->get_type() != alg) {
+    *cached = Compressor::create(cct, alg);
+  }
+  return *cached;
+}
+
+bool OSDMonitor::encode_compressed_full_map(Compressor *c, bufferlist& bl)
+{
+  bufferlist compressed;
+  int r = c->compress(bl, compressed);
+  if (r < 0 || compressed.length() >= bl.length()) {
+    return false;
+  }
+
+  bufferlist wrapped;
+  encode(OSDMAP_FULL_COMPRESSED_MARKER, wrapped);
+  ENCODE_START(1, 1, wrapped);
+  encode((uint8_t)c->get_type(), wrapped);
+  encode((uint32_t)bl.length(), wrapped);
+  encode(compressed, wrapped);
+  ENCODE_FINISH(wrapped);
+  bl.swap(wrapped);
+  return true;
+}
+
+int OSDMonitor::decode_compressed_full_map(CephContext *cct,
+					   CompressorRef *cached,
+					   bufferlist& bl)
+{
+  if (bl.length() == 0 ||
+      (uint8_t)bl[0] != OSDMAP_FULL_COMPRESSED_MARKER) {
+    return 0;
+  }
+
+  uint8_t alg;
+  uint32_t raw_len;
+  bufferlist compressed;
+  auto p = bl.cbegin();
+  try {
+    uint8_t marker;
+    decode(marker, p);
+    DECODE_START(1, p);
+    decode(alg, p);
+    decode(raw_len, p);
+    decode(compressed, p);
+    DECODE_FINISH(p);
+  } catch (buffer::error& e) {
+    return -EIO;
+  }
+
+  CompressorRef c = get_full_map_compressor(cct, cached, alg);
+  if (!c) {
+    return -EOPNOTSUPP;
+  }
+  bufferlist raw;
+  int r = c->decompress(compressed, raw);
+  if (r < 0 || raw.length() != raw_len) {
+    return -EIO;
+  }
+  bl.swap(raw);
+  return 0;
+}
+
+void OSDMonitor::compress_full_map(bufferlist& bl)
+{
+  auto alg_name = g_conf().get_val<std::string>("mon_osdmap_full_compression");
+  if (alg_name == "none") {
+    return;
+  }
+  // every monitor in the quorum has to be able to read it back
+  if (!mon->get_quorum_mon_features().contains_all(
+	ceph::features::mon::FEATURE_OCTOPUS)) {
+    return;
+  }
+  auto alg = Compressor::get_comp_alg_type(alg_name);
+  CompressorRef c = alg ?
+    get_full_map_compressor(g_ceph_context, &full_map_compressor, *alg) :
+    nullptr;
+  if (!c) {
+    dout(1) << __func__ << " unknown compression algorithm '" << alg_name
+	    << "', storing uncompressed" << dendl;
+    return;
+  }
+
+  auto raw_len = bl.length();
+  if (encode_compressed_full_map(c.get(), bl)) {
+    dout(20) << __func__ << " " << raw_len << " -> " << bl.length()
+	     << " bytes with " << alg_name << dendl;
+  }
+}
+
+int OSDMonitor::decompress_full_map(bufferlist& bl)
+{
+  int r = decode_compressed_full_map(g_ceph_context, &full_map_compressor, bl);
+  if (r < 0) {
+    derr << __func__ << " failed to decompress full map: "
+	 << cpp_strerror(r) << dendl;
+    return -EIO;
+  }
+  return 0;
+}
+
+void OSDMonitor::put_full_map(MonitorDBStore::TransactionRef t,
+			      version_t ver, bufferlist& bl)
+{
+  bufferlist stored_bl(bl);
+  compress_full_map(stored_bl);
+  put_version_full(t, ver, stored_bl);
+}
+
+int OSDMonitor::get_stored_full_map(version_t ver, bufferlist& bl)
+{
+  int r = PaxosService::get_version_full(ver, bl);
+  if (r < 0) {
+    return r;
+  }
+  return decompress_full_map(bl);
+}
+
 int OSDMonitor::get_version(version_t ver, uint64_t features, bufferlist& bl)
 {
   uint64_t significant_features = OSDMap::get_significant_features(features);
@@ -4021,7 +4178,7 @@ int OSDMonitor::get_full_from_pinned_map(version_t ver, bufferlist& bl)
   }
 
   if (!has_cached_osdmap) {
-    int err = PaxosService::get_version_full(closest_pinned, osdm_bl);
+    int err = get_stored_full_map(closest_pinned, osdm_bl);
     if (err != 0) {
       derr << __func__ << " closest pinned map ver " << closest_pinned
            << " not available! error: " << cpp_strerror(err) << dendl;
@@ -4104,7 +4261,7 @@ int OSDMonitor::get_version_full(version_t ver, uint64_t features,
   if (full_osd_cache.lookup({ver, significant_features}, &bl)) {
     return 0;
   }
-  int ret = PaxosService::get_version_full(ver, bl);
+  int ret = get_stored_full_map(ver, bl);
   if (ret == -ENOENT) {
     // build map?
     ret = get_full_from_pinned_map(ver, bl);
@@ -5487,7 +5644,7 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
 	    break;
 	  case HIT_SET_FPP:
 	    {
-	      if (p->hit_set_params.get_type() == HitSet::TYPE_BLOOM) {
+	      if (HitSet::is_bloom_type(p->hit_set_params.get_type())) {
 		BloomHitSet::Params *bloomp =
 		  static_cast<BloomHitSet::Params*>(p->hit_set_params.impl.get());
 		f->dump_float("hit_set_fpp", bloomp->get_fpp());
@@ -5630,7 +5787,7 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
 	    break;
 	  case HIT_SET_FPP:
 	    {
-	      if (p->hit_set_params.get_type() == HitSet::TYPE_BLOOM) {
+	      if (HitSet::is_bloom_type(p->hit_set_params.get_type())) {
 		BloomHitSet::Params *bloomp =
 		  static_cast<BloomHitSet::Params*>(p->hit_set_params.impl.get());
 		ss << "hit_set_fpp: " << bloomp->get_fpp() << "\n";
@@ -7511,6 +7668,14 @@ int OSDMonitor::prepare_command_pool_set(const cmdmap_t& cmdmap,
 	BloomHitSet::Params *bsp = new BloomHitSet::Params;
 	bsp->set_fpp(g_conf().get_val<double>("osd_pool_default_hit_set_bloom_fpp"));
 	p.hit_set_params = HitSet::Params(bsp);
+      } else if (val == "blocked_bloom") {
+	if (osdmap.require_osd_release < ceph_release_t::octopus) {
+	  ss << "octopus OSDs are required for hit_set_type blocked_bloom";
+	  return -EPERM;
+	}
+	BloomHitSet::Params *bsp = new BlockedBloomHitSet::Params;
+	bsp->set_fpp(g_conf().get_val<double>("osd_pool_default_hit_set_bloom_fpp"));
+	p.hit_set_params = HitSet::Params(bsp);
       } else if (val == "explicit_hash")
 	p.hit_set_params = HitSet::Params(new ExplicitHashHitSet::Params);
       else if (val == "explicit_object")
@@ -7546,7 +7711,7 @@ int OSDMonitor::prepare_command_pool_set(const cmdmap_t& cmdmap,
       ss << "hit_set_fpp should be in the range 0..1";
       return -EINVAL;
     }
-    if (p.hit_set_params.get_type() != HitSet::TYPE_BLOOM) {
+    if (!HitSet::is_bloom_type(p.hit_set_params.get_type())) {
       ss << "hit set is not of type Bloom; invalid to set a false positive rate!";
       return -EINVAL;
     }
@@ -12397,10 +12562,16 @@ bool OSDMonitor::prepare_command_impl(MonOpRequestRef op,
     HitSet::Params hsp;
     auto& cache_hit_set_type =
       g_conf().get_val<string>("osd_tier_default_cache_hit_set_type");
-    if (cache_hit_set_type == "bloom") {
+    if (cache_hit_set_type == "bloom" ||
+	(cache_hit_set_type == "blocked_bloom" &&
+	 osdmap.require_osd_release < ceph_release_t::octopus)) {
       BloomHitSet::Params *bsp = new BloomHitSet::Params;
       bsp->set_fpp(g_conf().get_val<double>("osd_pool_default_hit_set_bloom_fpp"));
       hsp = HitSet::Params(bsp);
+    } else if (cache_hit_set_type == "blocked_bloom") {
+      BloomHitSet::Params *bsp = new BlockedBloomHitSet::Params;
+      bsp->set_fpp(g_conf().get_val<double>("osd_pool_default_hit_set_bloom_fpp"));
+      hsp = HitSet::Params(bsp);
     } else if (cache_hit_set_type == "explicit_hash") {
       hsp = HitSet::Params(new ExplicitHashHitSet::Params);
     } else if (cache_hit_set_type == "explicit_object") {
@@ -27,6 +27,7 @@
 #include "include/types.h"
 #include "include/encoding.h"
 #include "common/simple_cache.hpp"
+#include "compressor/Compressor.h"
 #include "msg/Messenger.h"
 
 #include "osd/OSDMap.h"
@@ -219,6 +220,12 @@ public:
   map<int, bufferlist> pending_metadata;
   set<int>             pending_metadata_rm;
   map<int, failure_info_t> failure_info;
+
+  // reporter osd -> its mon_osd_reporter_subtree_level bucket, valid for
+  // one osdmap epoch and subtree level
+  map<int, string> reporter_subtree;
+  epoch_t reporter_subtree_epoch = 0;
+  string reporter_subtree_level;
   map<int,utime_t>    down_pending_out;  // osd down -> out
   bool priority_convert = false;
 
@@ -231,12 +238,14 @@ public:
                                    boost::hash<osdmap_key_t>>;
   osdmap_cache_t inc_osd_cache;
   osdmap_cache_t full_osd_cache;
+  CompressorRef full_map_compressor;
 
   bool has_osdmap_manifest;
   osdmap_manifest_t osdmap_manifest;
 
   bool check_failures(utime_t now);
   bool check_failure(utime_t now, int target_osd, failure_info_t& fi);
+  const string& get_reporter_subtree(int reporter, const string& level);
   void force_failure(int target_osd, int by);
 
   bool _have_pending_crush();
@@ -581,8 +590,23 @@ private:
 
   void reencode_incremental_map(bufferlist& bl, uint64_t features);
   void reencode_full_map(bufferlist& bl, uint64_t features);
+  void compress_full_map(bufferlist& bl);
+  int decompress_full_map(bufferlist& bl);
+  void put_full_map(MonitorDBStore::TransactionRef t, version_t ver,
+		    bufferlist& bl);
+  int get_stored_full_map(version_t ver, bufferlist& bl);
 public:
   void count_metadata(const string& field, map<string,int> *out);
+
+  static CompressorRef get_full_map_compressor(CephContext *cct,
+					       CompressorRef *cached,
+					       int alg);
+  /// compress a full map as stored, if that shrinks it
+  static bool encode_compressed_full_map(Compressor *c, bufferlist& bl);
+  /// decompress a stored full map; plain maps are left as they are
+  static int decode_compressed_full_map(CephContext *cct,
+					CompressorRef *cached,
+					bufferlist& bl);
 protected:
   int get_osd_objectstore_type(int osd, std::string *type);
   bool is_pool_currently_all_bluestore(int64_t pool_id, const pg_pool_t &pool,
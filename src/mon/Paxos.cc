@@ -15,6 +15,7 @@
 #include <sstream>
 #include "Paxos.h"
 #include "Monitor.h"
+#include "PaxosService.h"
 #include "messages/MMonPaxos.h"
 
 #include "mon/mon_types.h"
@@ -1526,6 +1527,16 @@ void Paxos::propose_pending()
   ceph_assert(is_active());
   ceph_assert(pending_proposal);
 
+  if (!plugged && g_conf().get_val<bool>("paxos_join_pending_proposals")) {
+    // let services still damping their updates ride along in this round;
+    // plugged, so their propose_pending() only adds to our transaction
+    plug();
+    for (auto& svc : mon->paxos_service) {
+      svc->maybe_join_proposal();
+    }
+    unplug();
+  }
+
   cancel_events();
 
   bufferlist bl;
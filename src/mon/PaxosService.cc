@@ -182,6 +182,15 @@ bool PaxosService::should_propose(double& delay)
 }
 
 
+void PaxosService::maybe_join_proposal()
+{
+  if (!proposal_timer || !have_pending || !is_active() || !mon->is_leader())
+    return;
+
+  dout(10) << __func__ << " joining the pending paxos proposal" << dendl;
+  propose_pending();
+}
+
 void PaxosService::propose_pending()
 {
   dout(10) << __func__ << dendl;
@@ -168,6 +168,14 @@ public:
    * This means that we will cancel our proposal_timer event, if any exists.
    */
   void restart();
+  /**
+   * Informs this instance that Paxos is about to start a new round.
+   *
+   * If we are holding pending changes behind our proposal_timer, cancel it
+   * and add them to the round now: it costs no extra commit, and spares
+   * them from waiting out another paxos_propose_interval.
+   */
+  void maybe_join_proposal();
   /**
    * Informs this instance that an election has finished.
    *
@@ -107,6 +107,27 @@ public:
     return ms_fast_preprocess(m.get());
   }
 
+  /**
+   * Provide the buffer a message's data payload is received into.
+   *
+   * Only asked of fast dispatchers, from the messenger thread, once the
+   * message header is known and before its data is read, so the
+   * payload lands in memory laid out the way the consumer wants it
+   * (e.g. page aligned so the object store can submit it with O_DIRECT
+   * as is). The buffer must be at least @p len bytes long.
+   *
+   * @param con The Connection the message arrives on
+   * @param type The message type
+   * @param len Bytes the messenger needs for the data payload
+   * @param bp [out] The buffer to receive into
+   * @return true if @p bp was filled in, false to let the messenger
+   * allocate
+   */
+  virtual bool ms_get_data_buffer(Connection *con, int type, unsigned len,
+				  ceph::bufferptr *bp) {
+    return false;
+  }
+
   /**
    * The Messenger calls this function to deliver a single message.
    *
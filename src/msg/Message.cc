@@ -120,6 +120,7 @@
 #include "messages/MClientLease.h"
 #include "messages/MClientSnap.h"
 #include "messages/MClientQuota.h"
+#include "messages/MClientCapsBatch.h"
 
 #include "messages/MMDSSlaveRequest.h"
 
@@ -643,6 +644,9 @@ Message *decode_message(CephContext *cct, int crcflags,
   case CEPH_MSG_CLIENT_QUOTA:
     m = make_message<MClientQuota>();
     break;
+  case CEPH_MSG_CLIENT_CAPS_BATCH:
+    m = make_message<MClientCapsBatch>();
+    break;
 
     // mds
   case MSG_MDS_SLAVE_REQUEST:
@@ -33,6 +33,7 @@ class MBackfillReserve;
 class MCacheExpire;
 class MClientCapRelease;
 class MClientCaps;
+class MClientCapsBatch;
 class MClientLease;
 class MClientQuota;
 class MClientReclaim;
@@ -678,6 +678,20 @@ public:
   /**
    *
    */
+  /**
+   * Ask the fast dispatchers for the buffer to receive a message's data
+   * payload into. See Dispatcher::ms_get_data_buffer.
+   *
+   * @return true if one of them provided @p bp
+   */
+  bool ms_deliver_get_data_buffer(Connection *con, int type, unsigned len,
+				  ceph::bufferptr *bp) {
+    for (const auto &dispatcher : fast_dispatchers) {
+      if (dispatcher->ms_get_data_buffer(con, type, len, bp))
+	return true;
+    }
+    return false;
+  }
   void ms_fast_preprocess(const ref_t<Message> &m) {
     for (const auto &dispatcher : fast_dispatchers) {
       dispatcher->ms_fast_preprocess2(m);
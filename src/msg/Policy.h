@@ -37,6 +37,13 @@ struct Policy {
   uint64_t features_supported;
   /// Specify features any remotes must have to talk to this endpoint.
   uint64_t features_required;
+
+  /// Copy runs of buffers no larger than this into one contiguous send
+  /// buffer instead of handing each to the kernel as its own iovec (0: off).
+  uint32_t send_coalesce_max = 0;
+  /// Send buffers at least this large with MSG_ZEROCOPY where the stack
+  /// supports it (0: off).
+  uint32_t send_zerocopy_min = 0;
   
   Policy()
     : lossy(false), server(false), standby(false), resetcheck(true),
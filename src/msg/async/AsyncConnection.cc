@@ -399,6 +399,7 @@ void AsyncConnection::process() {
         protocol->fault();
         return;
       }
+      cs.set_send_policy(policy.send_coalesce_max, policy.send_zerocopy_min);
 
       center->create_file_event(cs.fd(), EVENT_READABLE, read_handler);
       state = STATE_CONNECTING_RE;
@@ -616,6 +617,10 @@ void AsyncConnection::shutdown_socket() {
     center->delete_time_event(last_tick_id);
     last_tick_id = 0;
   }
+  if (cork_timer_id) {
+    center->delete_time_event(cork_timer_id);
+    cork_timer_id = 0;
+  }
   if (cs) {
     center->delete_file_event(cs.fd(), EVENT_READABLE | EVENT_WRITABLE);
     cs.shutdown();
@@ -190,6 +190,7 @@ class AsyncConnection : public Connection {
   ceph::coarse_mono_clock::time_point last_active;
   ceph::mono_clock::time_point recv_start_time;
   uint64_t last_tick_id = 0;
+  uint64_t cork_timer_id = 0;  ///< ProtocolV2 waiting for more messages
   const uint64_t connect_timeout_us;
   const uint64_t inactive_timeout_us;
 
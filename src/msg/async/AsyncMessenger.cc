@@ -173,6 +173,9 @@ void Processor::accept()
   opts.nodelay = msgr->cct->_conf->ms_tcp_nodelay;
   opts.rcbuf_size = msgr->cct->_conf->ms_tcp_rcvbuf;
   opts.priority = msgr->get_socket_priority();
+  const bool incoming_cpu =
+    msgr->hot_conf->affinity_incoming_cpu &&
+    !msgr->get_stack()->support_local_listen_table();
 
   for (auto& listen_socket : listen_sockets) {
     ldout(msgr->cct, 10) << __func__ << " listen_fd=" << listen_socket.fd()
@@ -192,6 +195,19 @@ void Processor::accept()
 	ldout(msgr->cct, 10) << __func__ << " accepted incoming on sd "
 			     << cli_socket.fd() << dendl;
 
+	if (incoming_cpu) {
+	  // serve the connection near the cpu taking its NIC queue interrupts
+	  int cpu = msgr->get_stack()->get_incoming_cpu(cli_socket);
+	  if (cpu >= 0) {
+	    if (Worker *near = msgr->get_stack()->get_worker_near(cpu)) {
+	      w->release_worker();
+	      w = near;
+	      ldout(msgr->cct, 10) << __func__ << " incoming cpu " << cpu
+				   << " -> worker " << w->id << dendl;
+	    }
+	  }
+	}
+
 	msgr->add_accept(
 	  w, std::move(cli_socket),
 	  msgr->get_myaddrs().v[listen_socket.get_addr_slot()],
@@ -274,6 +290,23 @@ class C_handle_reap : public EventCallback {
  * AsyncMessenger
  */
 
+async_msgr_conf_t::async_msgr_conf_t(const ConfigProxy& conf)
+  : affinity_incoming_cpu(conf.get_val<bool>("ms_async_affinity_incoming_cpu")),
+    cork_us(conf.get_val<uint64_t>("ms_async_cork_us")),
+    cork_max_bytes(conf.get_val<Option::size_t>("ms_async_cork_max_bytes"))
+{}
+
+const char** async_msgr_conf_t::get_tracked_conf_keys()
+{
+  static const char* keys[] = {
+    "ms_async_affinity_incoming_cpu",
+    "ms_async_cork_us",
+    "ms_async_cork_max_bytes",
+    nullptr
+  };
+  return keys;
+}
+
 AsyncMessenger::AsyncMessenger(CephContext *cct, entity_name_t name,
                                const std::string &type, string mname, uint64_t _nonce)
   : SimplePolicyMessenger(cct, name,mname, _nonce),
@@ -29,6 +29,7 @@
 #include "common/Mutex.h"
 #include "common/Cond.h"
 #include "common/Thread.h"
+#include "common/config_cacher.h"
 
 #include "msg/SimplePolicyMessenger.h"
 #include "msg/DispatchQueue.h"
@@ -39,6 +40,16 @@
 
 class AsyncMessenger;
 
+/// options read for every accepted and every msgr2 connection
+struct async_msgr_conf_t {
+  bool affinity_incoming_cpu;
+  uint64_t cork_us;
+  uint64_t cork_max_bytes;
+
+  explicit async_msgr_conf_t(const ConfigProxy& conf);
+  static const char** get_tracked_conf_keys();
+};
+
 /**
  * If the Messenger binds to a specific address, the Processor runs
  * and listens for incoming connections.
@@ -336,6 +347,8 @@ private:
 
 public:
 
+  md_config_snapshot_t<async_msgr_conf_t> hot_conf{cct->_conf};
+
   /// con used for sending messages to ourselves
   AsyncConnectionRef local_connection;
 
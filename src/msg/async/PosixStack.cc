@@ -19,8 +19,12 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <errno.h>
+#ifdef __linux__
+#include <linux/errqueue.h>
+#endif
 
 #include <algorithm>
+#include <deque>
 
 #include "PosixStack.h"
 
@@ -37,16 +41,52 @@
 #undef dout_prefix
 #define dout_prefix *_dout << "PosixStack "
 
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && \
+  defined(SO_EE_ORIGIN_ZEROCOPY)
+#define HAVE_MSG_ZEROCOPY
+#endif
+
 class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   NetHandler &handler;
   int _fd;
   entity_addr_t sa;
   bool connected;
 
+  // see set_send_policy(); both zero means send() hands every buffer to
+  // the kernel as is
+  uint32_t coalesce_max = 0;
+  uint32_t zerocopy_min = 0;
+  // small buffers are copied here; reallocated whenever a zero-copy send
+  // still holds on to the previous one
+  bufferptr scratch;
+  static constexpr unsigned scratch_len = 64 << 10;
+#ifdef HAVE_MSG_ZEROCOPY
+  // buffers the kernel may still read, by zero-copy notification id
+  std::deque<std::pair<uint32_t, bufferlist>> zc_pending;
+  uint32_t zc_next_id = 0;
+  bool zc_enabled = false;
+#endif
+
  public:
   explicit PosixConnectedSocketImpl(NetHandler &h, const entity_addr_t &sa, int f, bool connected)
       : handler(h), _fd(f), sa(sa), connected(connected) {}
 
+  void set_send_policy(uint32_t cmax, uint32_t zmin) override {
+    coalesce_max = cmax;
+#ifdef HAVE_MSG_ZEROCOPY
+    if (zmin && !zc_enabled) {
+      int one = 1;
+      if (::setsockopt(_fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) < 0) {
+	// older kernel, or not a TCP socket: just copy
+	zmin = 0;
+      } else {
+	zc_enabled = true;
+      }
+    }
+    zerocopy_min = zmin;
+#endif
+  }
+
   int is_connected() override {
     if (connected)
       return 1;
@@ -67,6 +107,10 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   }
 
   ssize_t read(char *buf, size_t len) override {
+#ifdef HAVE_MSG_ZEROCOPY
+    // completions raise EPOLLERR, which lands us here
+    reap_zerocopy();
+#endif
     ssize_t r = ::read(_fd, buf, len);
     if (r < 0)
       r = -errno;
@@ -75,21 +119,35 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
 
   // return the sent length
   // < 0 means error occurred
-  static ssize_t do_sendmsg(int fd, struct msghdr &msg, unsigned len, bool more)
+  // with MSG_ZEROCOPY in flags, *zc_calls counts the sendmsg calls that
+  // took a notification id
+  static ssize_t do_sendmsg(int fd, struct msghdr &msg, unsigned len, bool more,
+			    int flags = 0, unsigned *zc_calls = nullptr)
   {
     size_t sent = 0;
     while (1) {
       MSGR_SIGPIPE_STOPPER;
       ssize_t r;
-      r = ::sendmsg(fd, &msg, MSG_NOSIGNAL | (more ? MSG_MORE : 0));
+      r = ::sendmsg(fd, &msg, MSG_NOSIGNAL | (more ? MSG_MORE : 0) | flags);
       if (r < 0) {
         if (errno == EINTR) {
           continue;
         } else if (errno == EAGAIN) {
           break;
         }
+#ifdef HAVE_MSG_ZEROCOPY
+	if (errno == ENOBUFS && (flags & MSG_ZEROCOPY)) {
+	  // out of optmem for notifications; copy this one
+	  flags &= ~MSG_ZEROCOPY;
+	  continue;
+	}
+#endif
         return -errno;
       }
+#ifdef HAVE_MSG_ZEROCOPY
+      if (r > 0 && (flags & MSG_ZEROCOPY) && zc_calls)
+	++*zc_calls;
+#endif
 
       sent += r;
       if (len == sent) break;
@@ -110,7 +168,144 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
     return (ssize_t)sent;
   }
 
+#ifdef HAVE_MSG_ZEROCOPY
+  // drop our references to whatever the kernel has finished sending
+  void reap_zerocopy() {
+    while (!zc_pending.empty()) {
+      char control[CMSG_SPACE(sizeof(struct sock_extended_err)) + 64];
+      struct msghdr msg;
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof(control);
+      if (::recvmsg(_fd, &msg, MSG_ERRQUEUE) < 0) {
+	break;
+      }
+      for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm;
+	   cm = CMSG_NXTHDR(&msg, cm)) {
+	if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+	      (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))) {
+	  continue;
+	}
+	auto serr = reinterpret_cast<struct sock_extended_err*>(CMSG_DATA(cm));
+	if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+	  continue;
+	}
+	// completed ids [ee_info, ee_data], which may wrap
+	uint32_t lo = serr->ee_info, hi = serr->ee_data;
+	zc_pending.erase(
+	  std::remove_if(zc_pending.begin(), zc_pending.end(),
+			 [lo, hi](const auto& p) {
+			   return p.first - lo <= hi - lo;
+			 }),
+	  zc_pending.end());
+      }
+    }
+  }
+#endif
+
+  // coalescing and zero-copy send; see set_send_policy()
+  ssize_t send_batched(bufferlist &bl, bool more) {
+#ifdef HAVE_MSG_ZEROCOPY
+    reap_zerocopy();
+#endif
+    size_t sent_bytes = 0;
+    auto pb = std::cbegin(bl.buffers());
+    auto end = std::cend(bl.buffers());
+    while (pb != end) {
+      struct msghdr msg;
+      struct iovec msgvec[IOV_MAX];
+      bufferlist pinned;  // what a zero-copy send would leave in flight
+      [[maybe_unused]] bool zerocopy = false;
+      if (coalesce_max && (!scratch.have_raw() || scratch.raw_nref() > 1)) {
+	scratch = buffer::create(scratch_len);
+      }
+      unsigned scratch_used = 0;
+      bool last_in_scratch = false;
+      size_t iovlen = 0;
+      unsigned msglen = 0;
+      for (; pb != end; ++pb) {
+	unsigned len = pb->length();
+	if (!len) {
+	  continue;
+	}
+	if (len <= coalesce_max && scratch_used + len <= scratch.length()) {
+	  char *dst = scratch.c_str() + scratch_used;
+	  if (!last_in_scratch) {
+	    if (iovlen == IOV_MAX) {
+	      break;
+	    }
+	    msgvec[iovlen].iov_base = dst;
+	    msgvec[iovlen].iov_len = 0;
+	    ++iovlen;
+	    last_in_scratch = true;
+	  }
+	  memcpy(dst, pb->c_str(), len);
+	  msgvec[iovlen - 1].iov_len += len;
+	  scratch_used += len;
+	} else {
+	  if (iovlen == IOV_MAX) {
+	    break;
+	  }
+	  msgvec[iovlen].iov_base = (void*)(pb->c_str());
+	  msgvec[iovlen].iov_len = len;
+	  ++iovlen;
+	  last_in_scratch = false;
+	  if (zerocopy_min) {
+	    zerocopy |= len >= zerocopy_min;
+	    pinned.append(*pb);
+	  }
+	}
+	msglen += len;
+      }
+      if (!iovlen) {
+	break;
+      }
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_iovlen = iovlen;
+      msg.msg_iov = msgvec;
+      int flags = 0;
+      unsigned zc_calls = 0;
+#ifdef HAVE_MSG_ZEROCOPY
+      if (zerocopy) {
+	flags = MSG_ZEROCOPY;
+      }
+#endif
+      ssize_t r = do_sendmsg(_fd, msg, msglen, pb != end || more, flags,
+			     &zc_calls);
+      if (r < 0)
+        return r;
+#ifdef HAVE_MSG_ZEROCOPY
+      if (zc_calls) {
+	if (scratch_used) {
+	  pinned.append(bufferptr(scratch, 0, scratch_used));
+	}
+	for (unsigned i = 0; i < zc_calls; ++i) {
+	  zc_pending.emplace_back(zc_next_id++, pinned);
+	}
+      }
+#endif
+      sent_bytes += r;
+      if (static_cast<unsigned>(r) < msglen)
+        break;
+    }
+
+    if (sent_bytes) {
+      bufferlist swapped;
+      if (sent_bytes < bl.length()) {
+        bl.splice(sent_bytes, bl.length()-sent_bytes, &swapped);
+        bl.swap(swapped);
+      } else {
+        bl.clear();
+      }
+    }
+
+    return static_cast<ssize_t>(sent_bytes);
+  }
+
   ssize_t send(bufferlist &bl, bool more) override {
+    if (coalesce_max || zerocopy_min) {
+      return send_batched(bl, more);
+    }
     size_t sent_bytes = 0;
     auto pb = std::cbegin(bl.buffers());
     uint64_t left_pbrs = std::size(bl.buffers());
@@ -291,3 +486,15 @@ PosixNetworkStack::PosixNetworkStack(CephContext *c, const string &t)
     : NetworkStack(c, t)
 {
 }
+
+int PosixNetworkStack::get_incoming_cpu(ConnectedSocket &cs)
+{
+#ifdef SO_INCOMING_CPU
+  int cpu = -1;
+  socklen_t len = sizeof(cpu);
+  if (::getsockopt(cs.fd(), SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) == 0) {
+    return cpu;
+  }
+#endif
+  return -1;
+}
@@ -43,6 +43,8 @@ class PosixNetworkStack : public NetworkStack {
  public:
   explicit PosixNetworkStack(CephContext *c, const string &t);
 
+  int get_incoming_cpu(ConnectedSocket &cs) override;
+
   void spawn_worker(unsigned i, std::function<void ()> &&func) override {
     threads.resize(i+1);
     threads[i] = std::thread(func);
@@ -1927,6 +1927,8 @@ CtPtr ProtocolV1::handle_connect_message_2() {
 
   connection->set_peer_type(connect_msg.host_type);
   connection->policy = messenger->get_policy(connect_msg.host_type);
+  connection->cs.set_send_policy(connection->policy.send_coalesce_max,
+				 connection->policy.send_zerocopy_min);
 
   ldout(cct, 10) << __func__ << " accept of host_type " << connect_msg.host_type
                  << ", policy.lossy=" << connection->policy.lossy
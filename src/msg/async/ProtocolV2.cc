@@ -93,7 +93,9 @@ ProtocolV2::ProtocolV2(AsyncConnection *connection)
       can_write(false),
       bannerExchangeCallback(nullptr),
       next_tag(static_cast<Tag>(0)),
-      keepalive(false) {
+      keepalive(false),
+      cork_us(messenger->hot_conf->cork_us),
+      cork_bytes(messenger->hot_conf->cork_max_bytes) {
 }
 
 ProtocolV2::~ProtocolV2() {
@@ -521,16 +523,22 @@ ssize_t ProtocolV2::write_message(Message *m, bool more) {
                  << " src=" << entity_name_t(messenger->get_myname())
                  << " off=" << header2.data_off
                  << dendl;
-  ssize_t total_send_size = connection->outcoming_bl.length();
-  ssize_t rc = connection->_try_send(more);
-  if (rc < 0) {
-    ldout(cct, 1) << __func__ << " error sending " << m << ", "
-                  << cpp_strerror(rc) << dendl;
+  ++unflushed_frames;
+  ssize_t rc = 0;
+  if (more && connection->outcoming_bl.length() < cork_bytes) {
+    // more frames are coming; let them share the syscall
+    ldout(cct, 20) << __func__ << " corked " << m << ", "
+                   << connection->outcoming_bl.length() << " bytes pending"
+                   << dendl;
   } else {
-    connection->logger->inc(
-        l_msgr_send_bytes, total_send_size - connection->outcoming_bl.length());
-    ldout(cct, 10) << __func__ << " sending " << m
-                   << (rc ? " continuely." : " done.") << dendl;
+    rc = flush_frames(more);
+    if (rc < 0) {
+      ldout(cct, 1) << __func__ << " error sending " << m << ", "
+                    << cpp_strerror(rc) << dendl;
+    } else {
+      ldout(cct, 10) << __func__ << " sending " << m
+                     << (rc ? " continuely." : " done.") << dendl;
+    }
   }
 
 #if defined(WITH_LTTNG) && defined(WITH_EVENTTRACE)
@@ -544,6 +552,41 @@ ssize_t ProtocolV2::write_message(Message *m, bool more) {
   return rc;
 }
 
+ssize_t ProtocolV2::flush_frames(bool more) {
+  ssize_t total_send_size = connection->outcoming_bl.length();
+  ssize_t rc = connection->_try_send(more);
+  if (rc >= 0) {
+    connection->logger->inc(
+        l_msgr_send_bytes, total_send_size - connection->outcoming_bl.length());
+  }
+  if (unflushed_frames) {
+    connection->logger->inc(l_msgr_send_frames_per_flush, unflushed_frames);
+    unflushed_frames = 0;
+  }
+  last_flush = ceph::mono_clock::now();
+  return rc;
+}
+
+bool ProtocolV2::should_cork() {
+  ceph_assert(connection->center->in_thread());
+  if (connection->cork_timer_id) {
+    // woken by the cork timer, or by someone else meanwhile: flush now.
+    // a fired timer is already gone, so this is a no-op then.
+    connection->center->delete_time_event(connection->cork_timer_id);
+    connection->cork_timer_id = 0;
+    return false;
+  }
+  if (!cork_us || connection->is_queued() ||
+      ceph::mono_clock::now() - last_flush > std::chrono::microseconds(cork_us)) {
+    // a connection sending slower than one write per window gains nothing
+    // from waiting
+    return false;
+  }
+  connection->cork_timer_id = connection->center->create_time_event(
+    cork_us, connection->write_handler);
+  return true;
+}
+
 void ProtocolV2::append_keepalive() {
   ldout(cct, 10) << __func__ << dendl;
   auto keepalive_frame = KeepAliveFrame::Encode();
@@ -593,6 +636,13 @@ void ProtocolV2::write_event() {
       append_keepalive();
       keepalive = false;
     }
+    if (should_cork()) {
+      // write_in_progress stays set, so the messages queued meanwhile
+      // wait for the timer instead of scheduling writes of their own
+      ldout(cct, 20) << __func__ << " corking for " << cork_us << "us" << dendl;
+      connection->write_lock.unlock();
+      return;
+    }
 
     auto start = ceph::mono_clock::now();
     bool more;
@@ -699,6 +749,32 @@ uint32_t ProtocolV2::get_onwire_size(const uint32_t logical_size) const {
   }
 }
 
+// Let a fast dispatcher place the payload of the message being read,
+// sizing the buffer from the preamble and typing it from the header
+// segment, which has already been read (and decrypted) by now.
+bool ProtocolV2::get_rx_data_buffer(uint32_t onwire_len, ceph::bufferptr *bp)
+{
+  const auto& hdrbl = rx_segments_data[SegmentIndex::Msg::HEADER];
+  if (hdrbl.length() < sizeof(ceph_msg_header2)) {
+    return false;
+  }
+  ceph_msg_header2 header;
+  hdrbl.copy(0, sizeof(header), reinterpret_cast<char*>(&header));
+  if (!messenger->ms_deliver_get_data_buffer(connection, header.type,
+					     onwire_len, bp)) {
+    return false;
+  }
+  if (bp->length() < onwire_len) {
+    ldout(cct, 1) << __func__ << " dispatcher buffer of " << bp->length()
+		  << " bytes is short of " << onwire_len << ", ignoring"
+		  << dendl;
+    return false;
+  }
+  ldout(cct, 20) << __func__ << " type " << header.type << " len "
+		 << onwire_len << " into dispatcher buffer" << dendl;
+  return true;
+}
+
 uint32_t ProtocolV2::get_epilogue_size() const {
   // In secure mode size of epilogue is flexible and depends on particular
   // cipher implementation. See the comment for epilogue_secure_block_t or
@@ -943,6 +1019,8 @@ CtPtr ProtocolV2::handle_hello(ceph::bufferlist &payload)
 
     ceph_assert(state == HELLO_ACCEPTING);
     connection->policy = messenger->get_policy(hello.entity_type());
+    connection->cs.set_send_policy(connection->policy.send_coalesce_max,
+				   connection->policy.send_zerocopy_min);
     ldout(cct, 10) << __func__ << " accept of host_type "
                    << (int)hello.entity_type()
                    << ", policy.lossy=" << connection->policy.lossy
@@ -1152,6 +1230,23 @@ CtPtr ProtocolV2::read_frame_segment() {
   // description of current segment to read
   const auto& cur_rx_desc = rx_segments_desc.at(rx_segments_data.size());
   rx_buffer_t rx_buffer;
+  rx_data_dest = {};
+  if (next_tag == Tag::MESSAGE &&
+      rx_segments_data.size() == SegmentIndex::Msg::DATA &&
+      cur_rx_desc.length > 0) {
+    ceph::bufferptr dest;
+    const auto onwire_len = get_onwire_size(cur_rx_desc.length);
+    if (get_rx_data_buffer(onwire_len, &dest)) {
+      if (session_stream_handlers.rx) {
+	// the ciphertext is read as usual and decrypted into dest
+	rx_data_dest = std::move(dest);
+      } else {
+	rx_buffer = buffer::ptr_node::create(
+	  buffer::ptr(dest, 0, onwire_len));
+	return READ_RXBUF(std::move(rx_buffer), handle_read_frame_segment);
+      }
+    }
+  }
   try {
     rx_buffer = buffer::ptr_node::create(buffer::create_aligned(
       get_onwire_size(cur_rx_desc.length), cur_rx_desc.alignment));
@@ -1186,8 +1281,19 @@ CtPtr ProtocolV2::handle_read_frame_segment(rx_buffer_t &&rx_buffer, int r) {
 
     auto& new_seg = rx_segments_data.back();
     if (new_seg.length()) {
-      auto padded = session_stream_handlers.rx->authenticated_decrypt_update(
-          std::move(new_seg), segment_t::DEFAULT_ALIGNMENT);
+      ceph::bufferlist padded;
+      if (rx_data_dest.length()) {
+	session_stream_handlers.rx->authenticated_decrypt_update(
+	  std::move(new_seg), rx_data_dest);
+	padded.push_back(std::move(rx_data_dest));
+	rx_data_dest = {};
+      } else {
+	// keep the alignment the sender asked for (page alignment for
+	// message data) so the plaintext is as usable as in crc mode
+	padded = session_stream_handlers.rx->authenticated_decrypt_update(
+	  std::move(new_seg),
+	  rx_segments_desc[rx_segments_data.size() - 1].alignment);
+      }
       const auto idx = rx_segments_data.size() - 1;
       new_seg.clear();
       padded.splice(0, rx_segments_desc[idx].length, &new_seg);
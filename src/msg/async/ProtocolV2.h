@@ -101,6 +101,9 @@ private:
 				  ceph::msgr::v2::MAX_NUM_SEGMENTS> rx_segments_desc;
   boost::container::static_vector<ceph::bufferlist,
 				  ceph::msgr::v2::MAX_NUM_SEGMENTS> rx_segments_data;
+  // where a dispatcher asked the data segment of a secure mode message
+  // to be decrypted into
+  ceph::bufferptr rx_data_dest;
   ceph::msgr::v2::Tag next_tag;
   utime_t backoff;  // backoff time
   utime_t recv_stamp;
@@ -115,6 +118,13 @@ private:
   bool keepalive;
   bool write_in_progress = false;
 
+  // corking: hold small messages back for up to cork_us after a recent
+  // flush, and pack queued frames into writes of up to cork_bytes
+  const uint64_t cork_us;
+  const uint64_t cork_bytes;
+  unsigned unflushed_frames = 0;
+  ceph::mono_time last_flush;
+
   ostream &_conn_prefix(std::ostream *_dout);
   void run_continuation(Ct<ProtocolV2> *pcontinuation);
   void run_continuation(Ct<ProtocolV2> &continuation);
@@ -139,6 +149,8 @@ private:
   void prepare_send_message(uint64_t features, Message *m);
   out_queue_entry_t _get_next_outgoing();
   ssize_t write_message(Message *m, bool more);
+  ssize_t flush_frames(bool more);
+  bool should_cork();
   void append_keepalive();
   void append_keepalive_ack(utime_t &timestamp);
   void handle_message_ack(uint64_t seq);
@@ -251,6 +263,7 @@ private:
   Ct<ProtocolV2> *server_ready();
 
   uint32_t get_onwire_size(uint32_t logical_size) const;
+  bool get_rx_data_buffer(uint32_t onwire_len, ceph::bufferptr *bp);
   uint32_t get_epilogue_size() const;
   size_t get_current_msg_size() const;
 };
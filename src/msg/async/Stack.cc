@@ -19,6 +19,7 @@
 #include "include/compat.h"
 #include "common/Cond.h"
 #include "common/errno.h"
+#include "common/numa.h"
 #include "PosixStack.h"
 #ifdef HAVE_RDMA
 #include "rdma/RDMAStack.h"
@@ -41,6 +42,16 @@ std::function<void ()> NetworkStack::add_thread(unsigned i)
       char tp_name[16];
       sprintf(tp_name, "msgr-worker-%u", w->id);
       ceph_pthread_setname(pthread_self(), tp_name);
+      if (w->cpu >= 0) {
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	CPU_SET(w->cpu, &cpu_set);
+	if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) < 0) {
+	  int r = errno;
+	  lderr(cct) << __func__ << " failed to pin worker " << w->id
+		     << " to cpu " << w->cpu << ": " << cpp_strerror(r) << dendl;
+	}
+      }
       const unsigned EventMaxWaitUs = 30000000;
       w->center.set_owner();
       ldout(cct, 10) << __func__ << " starting" << dendl;
@@ -115,9 +126,30 @@ NetworkStack::NetworkStack(CephContext *c, const string &t): type(t), started(fa
     num_workers = EventCenter::MAX_EVENTCENTER;
   }
 
+  std::vector<int> cpus;
+  if (auto cores = cct->_conf.get_val<std::string>("ms_async_affinity_cores");
+      !cores.empty()) {
+    size_t cpu_set_size;
+    cpu_set_t cpu_set;
+    if (parse_cpu_set_list(cores.c_str(), &cpu_set_size, &cpu_set) < 0) {
+      lderr(cct) << __func__ << " unable to parse ms_async_affinity_cores '"
+		 << cores << "'" << dendl;
+    } else {
+      for (int cpu : cpu_set_to_set(cpu_set_size, &cpu_set)) {
+	cpus.push_back(cpu);
+      }
+    }
+  }
+
   for (unsigned i = 0; i < num_workers; ++i) {
     Worker *w = create_worker(cct, type, i);
     w->center.init(InitEventNumber, i, type);
+    if (!cpus.empty()) {
+      w->cpu = cpus[i % cpus.size()];
+      w->llc_domain = get_cpu_llc_domain(w->cpu);
+      ldout(cct, 10) << __func__ << " worker " << i << " cpu " << w->cpu
+		     << " llc domain " << w->llc_domain << dendl;
+    }
     workers.push_back(w);
   }
 }
@@ -169,6 +201,34 @@ Worker* NetworkStack::get_worker()
   return current_best;
 }
 
+Worker* NetworkStack::get_worker_near(int cpu)
+{
+  int llc_domain = get_cpu_llc_domain(cpu);
+  Worker *best = nullptr;
+  bool best_same_cpu = false;
+
+  pool_spin.lock();
+  for (unsigned i = 0; i < num_workers; ++i) {
+    Worker *w = workers[i];
+    bool same_cpu = w->cpu >= 0 && w->cpu == cpu;
+    if (!same_cpu && (llc_domain < 0 || w->llc_domain != llc_domain)) {
+      continue;
+    }
+    // a worker on the very cpu beats one merely sharing its cache
+    if (!best || (same_cpu && !best_same_cpu) ||
+	(same_cpu == best_same_cpu &&
+	 w->references.load() < best->references.load())) {
+      best = w;
+      best_same_cpu = same_cpu;
+    }
+  }
+  pool_spin.unlock();
+  if (best) {
+    ++best->references;
+  }
+  return best;
+}
+
 void NetworkStack::stop()
 {
   std::lock_guard<decltype(pool_spin)> lk(pool_spin);
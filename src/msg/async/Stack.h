@@ -30,6 +30,7 @@ class ConnectedSocketImpl {
   virtual ssize_t read(char*, size_t) = 0;
   virtual ssize_t zero_copy_read(bufferptr&) = 0;
   virtual ssize_t send(bufferlist &bl, bool more) = 0;
+  virtual void set_send_policy(uint32_t coalesce_max, uint32_t zerocopy_min) {}
   virtual void shutdown() = 0;
   virtual void close() = 0;
   virtual int fd() const = 0;
@@ -107,6 +108,15 @@ class ConnectedSocket {
   ssize_t send(bufferlist &bl, bool more) {
     return _csi->send(bl, more);
   }
+  /// Tunes how send() batches buffers.
+  ///
+  /// Buffers up to \c coalesce_max bytes are copied together into one
+  /// iovec; buffers of at least \c zerocopy_min bytes may be sent without
+  /// a copy and stay referenced until the kernel is done with them.  Zero
+  /// disables either.  Stacks that cannot do this ignore it.
+  void set_send_policy(uint32_t coalesce_max, uint32_t zerocopy_min) {
+    _csi->set_send_policy(coalesce_max, zerocopy_min);
+  }
   /// Disables output to the socket.
   ///
   /// Current or future writes that have not been successfully flushed
@@ -213,6 +223,7 @@ enum {
 
   l_msgr_send_messages_queue_lat,
   l_msgr_handle_ack_lat,
+  l_msgr_send_frames_per_flush,
 
   l_msgr_last,
 };
@@ -228,6 +239,8 @@ class Worker {
   CephContext *cct;
   PerfCounters *perf_logger;
   unsigned id;
+  int cpu = -1;         ///< pinned to this CPU (ms_async_affinity_cores)
+  int llc_domain = -1;  ///< last-level cache domain of cpu
 
   std::atomic_uint references;
   EventCenter center;
@@ -256,6 +269,7 @@ class Worker {
 
     plb.add_time_avg(l_msgr_send_messages_queue_lat, "msgr_send_messages_queue_lat", "Network sent messages lat");
     plb.add_time_avg(l_msgr_handle_ack_lat, "msgr_handle_ack_lat", "Connection handle ack lat");
+    plb.add_u64_avg(l_msgr_send_frames_per_flush, "msgr_send_frames_per_flush", "Message frames handed to the socket per send");
 
     perf_logger = plb.create_perf_counters();
     cct->get_perfcounters_collection()->add(perf_logger);
@@ -339,6 +353,9 @@ class NetworkStack {
   // need to let each thread do binding port.
   virtual bool support_local_listen_table() const { return false; }
   virtual bool nonblock_connect_need_writable_event() const { return true; }
+  // the CPU receiving the socket's packets, or -1 when the backend cannot
+  // tell; lets accept hand connections to a worker near that CPU
+  virtual int get_incoming_cpu(ConnectedSocket &cs) { return -1; }
 
   void start();
   void stop();
@@ -346,6 +363,9 @@ class NetworkStack {
   Worker *get_worker(unsigned i) {
     return workers[i];
   }
+  // least loaded worker pinned to cpu, else to cpu's cache domain; nullptr
+  // if no worker is near cpu
+  Worker *get_worker_near(int cpu);
   void drain();
   unsigned get_num_worker() const {
     return num_workers;
@@ -18,6 +18,11 @@ static constexpr const std::size_t AESGCM_IV_LEN{12};
 static constexpr const std::size_t AESGCM_TAG_LEN{16};
 static constexpr const std::size_t AESGCM_BLOCK_LEN{16};
 
+// plaintext buffers shorter than this are copied into the ciphertext
+// buffer and encrypted there, in place, together with their neighbours:
+// one EVP call on a few KB is much cheaper than one per tiny fragment.
+static constexpr const std::size_t AESGCM_GATHER_LEN{4096};
+
 struct nonce_t {
   std::uint32_t random_seq;
   std::uint64_t random_rest;
@@ -93,19 +98,37 @@ void AES128GCM_OnWireTxHandler::authenticated_encrypt_update(
 {
   auto filler = buffer.append_hole(plaintext.length());
 
-  for (const auto& plainbuf : plaintext.buffers()) {
+  auto encrypt = [this, &filler] (const char* in, unsigned len) {
     int update_len = 0;
 
     if(1 != EVP_EncryptUpdate(ectx.get(),
 	reinterpret_cast<unsigned char*>(filler.c_str()),
 	&update_len,
-	reinterpret_cast<const unsigned char*>(plainbuf.c_str()),
-	plainbuf.length())) {
+	reinterpret_cast<const unsigned char*>(in),
+	len)) {
       throw std::runtime_error("EVP_EncryptUpdate failed");
     }
     ceph_assert_always(update_len >= 0);
-    ceph_assert(static_cast<unsigned>(update_len) == plainbuf.length());
+    ceph_assert(static_cast<unsigned>(update_len) == len);
     filler.advance(update_len);
+  };
+
+  // gathered, not yet encrypted bytes sitting at filler.c_str()
+  unsigned gathered = 0;
+  for (const auto& plainbuf : plaintext.buffers()) {
+    if (plainbuf.length() < AESGCM_GATHER_LEN) {
+      ::memcpy(filler.c_str() + gathered, plainbuf.c_str(), plainbuf.length());
+      gathered += plainbuf.length();
+      continue;
+    }
+    if (gathered) {
+      encrypt(filler.c_str(), gathered);
+      gathered = 0;
+    }
+    encrypt(plainbuf.c_str(), plainbuf.length());
+  }
+  if (gathered) {
+    encrypt(filler.c_str(), gathered);
   }
 
   ldout(cct, 15) << __func__
@@ -179,6 +202,9 @@ public:
   ceph::bufferlist authenticated_decrypt_update(
     ceph::bufferlist&& ciphertext,
     std::uint32_t alignment) override;
+  void authenticated_decrypt_update(
+    ceph::bufferlist&& ciphertext,
+    ceph::bufferptr& plaintext) override;
   ceph::bufferlist authenticated_decrypt_update_final(
     ceph::bufferlist&& ciphertext,
     std::uint32_t alignment) override;
@@ -204,7 +230,20 @@ ceph::bufferlist AES128GCM_OnWireRxHandler::authenticated_decrypt_update(
   // OpenSSL's might sustain that but lack of clear confirmation postpones.
   auto plainnode = ceph::buffer::ptr_node::create(buffer::create_aligned(
     ciphertext.length(), alignment));
-  auto* plainbuf = reinterpret_cast<unsigned char*>(plainnode->c_str());
+  authenticated_decrypt_update(std::move(ciphertext), *plainnode);
+
+  ceph::bufferlist outbl;
+  outbl.push_back(std::move(plainnode));
+  return outbl;
+}
+
+void AES128GCM_OnWireRxHandler::authenticated_decrypt_update(
+  ceph::bufferlist&& ciphertext,
+  ceph::bufferptr& plaintext)
+{
+  ceph_assert(ciphertext.length() > 0);
+  ceph_assert(plaintext.length() >= ciphertext.length());
+  auto* plainbuf = reinterpret_cast<unsigned char*>(plaintext.c_str());
 
   for (const auto& cipherbuf : ciphertext.buffers()) {
     // XXX: Why int?
@@ -222,10 +261,6 @@ ceph::bufferlist AES128GCM_OnWireRxHandler::authenticated_decrypt_update(
 
     plainbuf += update_len;
   }
-
-  ceph::bufferlist outbl;
-  outbl.push_back(std::move(plainnode));
-  return outbl;
 }
 
 
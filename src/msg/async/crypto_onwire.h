@@ -96,6 +96,12 @@ public:
     ceph::bufferlist&& ciphertext,
     std::uint32_t alignment) = 0;
 
+  // As above but decrypt into the caller's buffer, which must hold at
+  // least ciphertext.length() bytes.
+  virtual void authenticated_decrypt_update(
+    ceph::bufferlist&& ciphertext,
+    ceph::bufferptr& plaintext) = 0;
+
   // Perform decryption of last cipertext's portion and verify signature
   // for overall decryption sequence.
   // Throws on integrity/authenticity checks
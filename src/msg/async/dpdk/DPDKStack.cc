@@ -101,7 +101,7 @@ void DPDKWorker::initialize()
     std::map<unsigned, float> cpu_weights;
     for (unsigned j = sdev->hw_queues_count() + i % sdev->hw_queues_count();
          j < cores; j+= sdev->hw_queues_count())
-      cpu_weights[i] = 1;
+      cpu_weights[j] = 1;
     cpu_weights[i] = cct->_conf->ms_dpdk_hw_queue_weight;
     qp->configure_proxies(cpu_weights);
     sdev->set_local_queue(i, std::move(qp));
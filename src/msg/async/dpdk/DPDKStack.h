@@ -54,8 +54,19 @@ class NativeConnectedSocketImpl : public ConnectedSocketImpl {
   typename Protocol::connection _conn;
   uint32_t _cur_frag = 0;
   uint32_t _cur_off = 0;
+  uint32_t _frag_off = 0;  // bytes already consumed from the current fragment
   Tub<Packet> _buf;
-  Tub<bufferptr> _cache_ptr;
+
+  void next_frag(uint32_t frag_size) {
+    _frag_off = 0;
+    if (++_cur_frag == _buf->nr_frags()) {
+      _cur_frag = 0;
+      _cur_off = 0;
+      _buf.destroy();
+    } else {
+      _cur_off += frag_size;
+    }
+  }
 
  public:
   explicit NativeConnectedSocketImpl(typename Protocol::connection conn)
@@ -67,34 +78,28 @@ class NativeConnectedSocketImpl : public ConnectedSocketImpl {
   }
 
   virtual ssize_t read(char *buf, size_t len) override {
-    size_t left = len;
-    ssize_t r = 0;
+    auto err = _conn.get_errno();
+    if (err <= 0)
+      return err;
+
+    // copy straight out of the packet fragments rather than wrapping each
+    // of them in a bufferptr first
     size_t off = 0;
-    while (left > 0) {
-      if (!_cache_ptr) {
-        _cache_ptr.construct();
-        r = zero_copy_read(*_cache_ptr);
-        if (r <= 0) {
-          _cache_ptr.destroy();
-          if (r == -EAGAIN)
-            break;
-          return r;
-        }
-      }
-      if (_cache_ptr->length() <= left) {
-        _cache_ptr->copy_out(0, _cache_ptr->length(), buf+off);
-        left -= _cache_ptr->length();
-        off += _cache_ptr->length();
-        _cache_ptr.destroy();
-      } else {
-        _cache_ptr->copy_out(0, left, buf+off);
-        _cache_ptr->set_offset(_cache_ptr->offset() + left);
-        _cache_ptr->set_length(_cache_ptr->length() - left);
-        left = 0;
-        break;
+    while (off < len) {
+      if (!_buf) {
+        _buf = std::move(_conn.read());
+        if (!_buf)
+          break;
       }
+      fragment &f = _buf->frag(_cur_frag);
+      size_t n = std::min<size_t>(f.size - _frag_off, len - off);
+      memcpy(buf + off, f.base + _frag_off, n);
+      off += n;
+      _frag_off += n;
+      if (_frag_off == f.size)
+        next_frag(f.size);
     }
-    return len - left ? len - left : -EAGAIN;
+    return off ? off : -EAGAIN;
   }
 
   virtual ssize_t zero_copy_read(bufferptr &data) override {
@@ -109,18 +114,13 @@ class NativeConnectedSocketImpl : public ConnectedSocketImpl {
     }
 
     fragment &f = _buf->frag(_cur_frag);
-    Packet p = _buf->share(_cur_off, f.size);
+    size_t len = f.size - _frag_off;
+    Packet p = _buf->share(_cur_off + _frag_off, len);
     auto del = std::bind(
             [](Packet &p) {}, std::move(p));
     data = buffer::claim_buffer(
-            f.size, f.base, make_deleter(std::move(del)));
-    if (++_cur_frag == _buf->nr_frags()) {
-      _cur_frag = 0;
-      _cur_off = 0;
-      _buf.destroy();
-    } else {
-      _cur_off += f.size;
-    }
+            len, f.base + _frag_off, make_deleter(std::move(del)));
+    next_frag(f.size);
     ceph_assert(data.length());
     return data.length();
   }
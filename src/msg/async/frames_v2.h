@@ -232,7 +232,9 @@ private:
     ceph::crypto::onwire::rxtx_t &session_stream_handlers,
     std::index_sequence<Is...>)
   {
-    session_stream_handlers.tx->reset_tx_handler({ segments[Is].length()... });
+    // the epilogue is encrypted into the same buffer
+    session_stream_handlers.tx->reset_tx_handler(
+      { segments[Is].length()..., FRAME_SECURE_EPILOGUE_SIZE });
   }
 
 public:
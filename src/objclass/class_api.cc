@@ -494,6 +494,25 @@ int cls_cxx_map_get_vals(cls_method_context_t hctx, const string &start_obj,
   return vals->size();
 }
 
+int cls_cxx_map_get_vals_batch(cls_method_context_t hctx,
+			       const string &start_obj,
+			       const string &filter_prefix,
+			       uint64_t max_to_get, uint64_t max_bytes,
+			       kv_batch_t *batch, bool *more)
+{
+  PrimaryLogPG::OpContext *ctx = *(PrimaryLogPG::OpContext **)hctx;
+
+  // read straight from the store rather than through an encoded OSDOp
+  ++ctx->num_read;
+  int ret = ctx->pg->do_omap_get_vals_batch(ctx, start_obj, filter_prefix,
+					    max_to_get, max_bytes, batch, more);
+  if (ret < 0)
+    return ret;
+  ctx->delta_stats.num_rd_kb += shift_round_up(batch->used, 10);
+  ctx->delta_stats.num_rd++;
+  return batch->size();
+}
+
 int cls_cxx_map_read_header(cls_method_context_t hctx, bufferlist *outbl)
 {
   PrimaryLogPG::OpContext **pctx = (PrimaryLogPG::OpContext **)hctx;
@@ -536,7 +555,7 @@ int cls_cxx_map_get_val(cls_method_context_t hctx, const string &key,
     if (iter == m.end())
       return -ENOENT;
 
-    *outbl = iter->second;
+    outbl->claim(iter->second);
   } catch (buffer::error& e) {
     return -EIO;
   }
@@ -12,6 +12,7 @@
 #include "common/ceph_time.h"
 #include "common/ceph_releases.h"
 #include "include/rados/objclass.h"
+#include "include/kv_batch.h"
 
 struct obj_list_watch_response_t;
 
@@ -139,6 +140,15 @@ extern int cls_cxx_map_get_vals(cls_method_context_t hctx,
                                 uint64_t max_to_get,
                                 std::map<std::string, ceph::buffer::list> *vals,
                                 bool *more);
+/// like cls_cxx_map_get_vals(), but the entries land in one buffer and
+/// are handed out as views into it
+extern int cls_cxx_map_get_vals_batch(cls_method_context_t hctx,
+                                      const std::string& start_after,
+                                      const std::string& filter_prefix,
+                                      uint64_t max_to_get,
+                                      uint64_t max_bytes,
+                                      kv_batch_t *batch,
+                                      bool *more);
 extern int cls_cxx_map_read_header(cls_method_context_t hctx, ceph::buffer::list *outbl);
 extern int cls_cxx_map_set_vals(cls_method_context_t hctx,
                                 const std::map<std::string, ceph::buffer::list> *map);
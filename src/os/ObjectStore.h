@@ -459,6 +459,33 @@ public:
      ceph::buffer::list& bl,
      uint32_t op_flags = 0) = 0;
 
+  /**
+   * data_digest -- crc32c of a range of an object's data
+   *
+   * Continues *crc over the range exactly as ceph::buffer::list::crc32c()
+   * would over the bytes read(), but lets a store that keeps crc32c
+   * checksums of its own derive it from those instead.  The store is
+   * still expected to verify the data against them.
+   *
+   * @param cid collection for object
+   * @param oid oid of object
+   * @param offset location offset of first byte
+   * @param len number of bytes
+   * @param crc in: initial crc, out: crc including the range
+   * @param op_flags is CEPH_OSD_OP_FLAG_*
+   * @returns number of bytes covered on success, -EOPNOTSUPP if the
+   * caller should read() the range instead, or another negative error.
+   */
+  virtual int data_digest(
+    CollectionHandle &c,
+    const ghobject_t& oid,
+    uint64_t offset,
+    size_t len,
+    uint32_t *crc,
+    uint32_t op_flags = 0) {
+    return -EOPNOTSUPP;
+  }
+
   /**
    * fiemap -- get extent std::map of data of an object
    *
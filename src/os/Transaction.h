@@ -520,12 +520,14 @@ public:
     on_applied_sync.splice(on_applied_sync.end(), other.on_applied_sync);
 
     //append coll_index & object_index
+    bool same_ids = true;
     std::vector<__le32> cm(other.coll_index.size());
     std::map<coll_t, __le32>::iterator coll_index_p;
     for (coll_index_p = other.coll_index.begin();
          coll_index_p != other.coll_index.end();
          ++coll_index_p) {
       cm[coll_index_p->second] = _get_coll_id(coll_index_p->first);
+      same_ids = same_ids && cm[coll_index_p->second] == coll_index_p->second;
     }
 
     std::vector<__le32> om(other.object_index.size());
@@ -534,6 +536,17 @@ public:
          object_index_p != other.object_index.end();
          ++object_index_p) {
       om[object_index_p->second] = _get_object_id(object_index_p->first);
+      same_ids = same_ids &&
+	om[object_index_p->second] == object_index_p->second;
+    }
+
+    if (same_ids) {
+      //typically when appending to an empty transaction: the ops of the
+      //other transaction keep their indexes, so share them instead of
+      //copying and rewriting each op
+      op_bl.append(other.op_bl);
+      data_bl.append(other.data_bl);
+      return;
     }
 
     //the other.op_bl SHOULD NOT be changes during append operation,
@@ -85,6 +85,11 @@ void BitmapAllocator::shutdown()
   _shutdown();
 }
 
+void BitmapAllocator::dump(std::function<void(uint64_t offset, uint64_t length)> notify)
+{
+  foreach_internal(notify);
+}
+
 void BitmapAllocator::dump()
 {
   // bin -> interval count
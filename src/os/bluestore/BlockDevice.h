@@ -159,6 +159,8 @@ public:
   static BlockDevice *create(
     CephContext* cct, const std::string& path, aio_callback_t cb, void *cbpriv, aio_callback_t d_cb, void *d_cbpriv);
   virtual bool supported_bdev_label() { return true; }
+  /// writes need not be block aligned and are persistent once they return
+  virtual bool supported_byte_writes() { return false; }
   virtual bool is_rotational() { return rotational; }
 
   virtual void aio_submit(IOContext *ioc) = 0;
@@ -240,6 +242,12 @@ protected:
             off < size &&
             off + len <= size);
   }
+  /// for devices with supported_byte_writes(), which need no alignment
+  bool is_valid_byte_io(uint64_t off, uint64_t len) const {
+    return (len > 0 &&
+            off < size &&
+            off + len <= size);
+  }
 };
 
 #endif //CEPH_OS_BLUESTORE_BLOCKDEVICE_H
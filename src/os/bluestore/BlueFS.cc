@@ -152,6 +152,13 @@ void BlueFS::_init_logger()
   b.add_u64_counter(l_bluefs_read_prefetch_bytes, "read_prefetch_bytes",
 		    "Bytes requested in prefetch read mode", NULL,
 		    PerfCountersBuilder::PRIO_USEFUL, unit_t(UNIT_BYTES));
+  b.add_u64_counter(l_bluefs_read_ahead_count, "read_ahead_count",
+		    "Async readahead requests issued for sequential readers");
+  b.add_u64_counter(l_bluefs_read_ahead_bytes, "read_ahead_bytes",
+		    "Bytes read ahead asynchronously", NULL,
+		    PerfCountersBuilder::PRIO_USEFUL, unit_t(UNIT_BYTES));
+  b.add_u64_counter(l_bluefs_read_ahead_hit_count, "read_ahead_hit_count",
+		    "Buffer refills served from async readahead");
 
   logger = b.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
@@ -1434,6 +1441,89 @@ int BlueFS::_read_random(
   return ret;
 }
 
+bool BlueFS::_claim_read_ahead(FileReaderBuffer *buf, uint64_t off)
+{
+  if (!buf->ra_bl.length()) {
+    return false;
+  }
+  bool hit = off >= buf->ra_off && off < buf->ra_off + buf->ra_bl.length();
+  dout(20) << __func__ << " 0x" << std::hex << off << " readahead 0x"
+	   << buf->ra_off << "~" << buf->ra_bl.length() << std::dec
+	   << (hit ? " hit" : " miss, dropping") << dendl;
+  // the buffers are owned by the aios until they complete
+  buf->ra_ioc->aio_wait();
+  buf->ra_ioc->release_running_aios();
+  if (hit) {
+    buf->bl = std::move(buf->ra_bl);
+    buf->bl_off = buf->ra_off;
+    logger->inc(l_bluefs_read_ahead_hit_count);
+  }
+  buf->ra_bl.clear();
+  buf->ra_bdev = -1;
+  return hit;
+}
+
+void BlueFS::_read_ahead(
+  FileReader *h,
+  FileReaderBuffer *buf,
+  uint64_t off,
+  uint64_t len)
+{
+  uint64_t end = round_up_to(std::min(off + len, h->file->fnode.size),
+			     super.block_size);
+  off &= super.block_mask();
+  if (off >= buf->bl_off && off < buf->get_buf_end()) {
+    off = buf->get_buf_end();
+  }
+  // keep a single contiguous window in flight
+  if (buf->ra_bl.length()) {
+    uint64_t ra_end = buf->ra_off + buf->ra_bl.length();
+    if (off < ra_end) {
+      off = ra_end;
+    }
+    if (off != ra_end) {
+      return;
+    }
+  }
+  if (off >= end) {
+    return;
+  }
+  uint64_t start = off;
+  uint64_t x_off = 0;
+  int dev = buf->ra_bdev;
+  auto p = h->file->fnode.seek(off, &x_off);
+  while (off < end && p != h->file->fnode.extents.end()) {
+    if (dev < 0) {
+      dev = p->bdev;
+    }
+    // one aio_submit() per window, and only where seeks hurt
+    if (p->bdev != dev || !bdev[dev]->is_rotational()) {
+      break;
+    }
+    uint64_t l = std::min(p->length - x_off, end - off);
+    dout(20) << __func__ << " 0x" << std::hex << off << "~" << l
+	     << " (0x" << x_off << " of " << *p << ")" << std::dec << dendl;
+    int r = bdev[dev]->aio_read(p->offset + x_off, l, &buf->ra_bl,
+				buf->ra_ioc.get());
+    ceph_assert(r == 0);
+    off += l;
+    x_off = 0;
+    ++p;
+  }
+  if (off == start) {
+    return;
+  }
+  if (buf->ra_bdev < 0) {
+    buf->ra_off = start;
+    buf->ra_bdev = dev;
+  }
+  logger->inc(l_bluefs_read_ahead_count);
+  logger->inc(l_bluefs_read_ahead_bytes, off - start);
+  if (buf->ra_ioc->has_pending_aios()) {
+    bdev[dev]->aio_submit(buf->ra_ioc.get());
+  }
+}
+
 int BlueFS::_read(
   FileReader *h,         ///< [in] read from here
   FileReaderBuffer *buf, ///< [in] reader state
@@ -1470,6 +1560,12 @@ int BlueFS::_read(
   if (outbl)
     outbl->clear();
 
+  // sequential streams get the next window read ahead asynchronously
+  Readahead::extent_t ra_extent(0, 0);
+  if (buf->ra_ioc && !h->random && !prefetch && len) {
+    ra_extent = buf->ra.update(off, len, h->file->fnode.size);
+  }
+
   int ret = 0;
   std::shared_lock s_lock(h->lock);
   while (len > 0) {
@@ -1477,25 +1573,27 @@ int BlueFS::_read(
     if (off < buf->bl_off || off >= buf->get_buf_end()) {
       s_lock.unlock();
       std::unique_lock u_lock(h->lock);
-      buf->bl.clear();
-      buf->bl_off = off & super.block_mask();
-      uint64_t x_off = 0;
-      auto p = h->file->fnode.seek(buf->bl_off, &x_off);
-      uint64_t want = round_up_to(len + (off & ~super.block_mask()),
-				  super.block_size);
-      want = std::max(want, buf->max_prefetch);
-      uint64_t l = std::min(p->length - x_off, want);
-      uint64_t eof_offset = round_up_to(h->file->fnode.size, super.block_size);
-      if (!h->ignore_eof &&
-	  buf->bl_off + l > eof_offset) {
-	l = eof_offset - buf->bl_off;
+      if (!_claim_read_ahead(buf, off)) {
+	buf->bl.clear();
+	buf->bl_off = off & super.block_mask();
+	uint64_t x_off = 0;
+	auto p = h->file->fnode.seek(buf->bl_off, &x_off);
+	uint64_t want = round_up_to(len + (off & ~super.block_mask()),
+				    super.block_size);
+	want = std::max(want, buf->max_prefetch);
+	uint64_t l = std::min(p->length - x_off, want);
+	uint64_t eof_offset = round_up_to(h->file->fnode.size, super.block_size);
+	if (!h->ignore_eof &&
+	    buf->bl_off + l > eof_offset) {
+	  l = eof_offset - buf->bl_off;
+	}
+	dout(20) << __func__ << " fetching 0x"
+		 << std::hex << x_off << "~" << l << std::dec
+		 << " of " << *p << dendl;
+	int r = bdev[p->bdev]->read(p->offset + x_off, l, &buf->bl, ioc[p->bdev],
+				    cct->_conf->bluefs_buffered_io);
+	ceph_assert(r == 0);
       }
-      dout(20) << __func__ << " fetching 0x"
-               << std::hex << x_off << "~" << l << std::dec
-               << " of " << *p << dendl;
-      int r = bdev[p->bdev]->read(p->offset + x_off, l, &buf->bl, ioc[p->bdev],
-				  cct->_conf->bluefs_buffered_io);
-      ceph_assert(r == 0);
       u_lock.unlock();
       s_lock.lock();
     }
@@ -1528,6 +1626,12 @@ int BlueFS::_read(
     buf->pos += r;
   }
 
+  if (ra_extent.second) {
+    s_lock.unlock();
+    std::unique_lock u_lock(h->lock);
+    _read_ahead(h, buf, ra_extent.first, ra_extent.second);
+  }
+
   dout(20) << __func__ << " got " << ret << dendl;
   ceph_assert(!outbl || (int)outbl->length() == ret);
   --h->file->num_reading;
@@ -1677,6 +1781,61 @@ void BlueFS::_compact_log_dump_metadata(bluefs_transaction_t *t,
   }
 }
 
+void BlueFS::_compact_log_snapshot(log_snapshot_t *snap)
+{
+  snap->block_all = block_all;
+  snap->fnodes.reserve(file_map.size());
+  for (auto& p : file_map) {
+    if (p.first == 1)
+      continue;
+    ceph_assert(p.first > 1);
+    snap->fnodes.push_back(p.second->fnode);
+  }
+  snap->dirs.reserve(dir_map.size());
+  for (auto& p : dir_map) {
+    snap->dirs.emplace_back(p.first, vector<pair<string, uint64_t>>());
+    auto& links = snap->dirs.back().second;
+    links.reserve(p.second->file_map.size());
+    for (auto& q : p.second->file_map) {
+      links.emplace_back(q.first, q.second->fnode.ino);
+    }
+  }
+}
+
+void BlueFS::_compact_log_encode_snapshot(const log_snapshot_t& snap,
+					  bluefs_transaction_t *t)
+{
+  // NOTE: this is safe to call without a lock.
+  t->seq = 1;
+  t->uuid = super.uuid;
+  dout(20) << __func__ << " op_init" << dendl;
+
+  t->op_init();
+  for (unsigned bdev = 0; bdev < snap.block_all.size(); ++bdev) {
+    for (auto q = snap.block_all[bdev].begin();
+	 q != snap.block_all[bdev].end();
+	 ++q) {
+      dout(20) << __func__ << " op_alloc_add " << bdev << " 0x"
+               << std::hex << q.get_start() << "~" << q.get_len() << std::dec
+               << dendl;
+      t->op_alloc_add(bdev, q.get_start(), q.get_len());
+    }
+  }
+  for (auto& fnode : snap.fnodes) {
+    dout(20) << __func__ << " op_file_update " << fnode << dendl;
+    t->op_file_update(fnode);
+  }
+  for (auto& p : snap.dirs) {
+    dout(20) << __func__ << " op_dir_create " << p.first << dendl;
+    t->op_dir_create(p.first);
+    for (auto& q : p.second) {
+      dout(20) << __func__ << " op_dir_link " << p.first << "/" << q.first
+	       << " to " << q.second << dendl;
+      t->op_dir_link(p.first, q.first, q.second);
+    }
+  }
+}
+
 void BlueFS::_compact_log_sync()
 {
   dout(10) << __func__ << dendl;
@@ -1778,21 +1937,27 @@ void BlueFS::_rewrite_log_sync(bool allocate_with_fallback,
  * old extent(s) won't be written to, and reflect everything to compact.
  * New events will be written to the new region that we'll keep.
  *
- * 2. While still holding the lock, encode a bufferlist that dumps all of the
- * in-memory fnodes and names.  This will become the new beginning of the
- * log.  The last event will jump to the log continuation extent from #1.
+ * 2. While still holding the lock, take a copy of all of the in-memory
+ * fnodes and names, and start the new log writer (this keeps racing log
+ * flushes from reallocating the log runway).
  *
- * 3. Queue a write to a new extent for the new beginnging of the log.
+ * 3. Drop the lock, encode a bufferlist from that copy.  This will become
+ * the new beginning of the log.  The last event will jump to the log
+ * continuation extent from #1.  Log flushes that race with us land in the
+ * continuation.
  *
- * 4. Drop lock and wait
+ * 4. Retake the lock, queue a write to a new extent for the new beginning
+ * of the log.
  *
- * 5. Retake the lock.
+ * 5. Drop lock and wait
  *
- * 6. Update the log_fnode to splice in the new beginning.
+ * 6. Retake the lock, wait for any racing log flush.
  *
- * 7. Write the new superblock.
+ * 7. Update the log_fnode to splice in the new beginning.
  *
- * 8. Release the old log space.  Clean up.
+ * 8. Write the new superblock.
+ *
+ * 9. Release the old log space.  Clean up.
  */
 void BlueFS::_compact_log_async(std::unique_lock<ceph::mutex>& l)
 {
@@ -1832,43 +1997,50 @@ void BlueFS::_compact_log_async(std::unique_lock<ceph::mutex>& l)
 
   _flush_and_sync_log(l, 0, old_log_jump_to);
 
-  // 2. prepare compacted log
-  bluefs_transaction_t t;
-  //avoid record two times in log_t and _compact_log_dump_metadata.
+  // 2. freeze the metadata
+  log_snapshot_t snap;
+  //avoid record two times in log_t and the compacted log.
   log_t.clear();
-  _compact_log_dump_metadata(&t, 0);
+  _compact_log_snapshot(&snap);
+  uint64_t jump_seq = log_seq;
+  new_log_writer = _create_writer(new_log);
+
+  // 3. prepare compacted log
+  l.unlock();
+  bluefs_transaction_t t;
+  _compact_log_encode_snapshot(snap, &t);
 
   // conservative estimate for final encoded size
   new_log_jump_to = round_up_to(t.op_bl.length() + super.block_size * 2,
                                 cct->_conf->bluefs_alloc_size);
-  t.op_jump(log_seq, new_log_jump_to);
-
-  // allocate
-  r = _allocate(BlueFS::BDEV_DB, new_log_jump_to,
-                    &new_log->fnode);
-  ceph_assert(r == 0);
-
-  // we might have some more ops in log_t due to _allocate call
-  t.claim_ops(log_t);
+  t.op_jump(jump_seq, new_log_jump_to);
 
   bufferlist bl;
   encode(t, bl);
   _pad_bl(bl);
+  l.lock();
 
   dout(10) << __func__ << " new_log_jump_to 0x" << std::hex << new_log_jump_to
 	   << std::dec << dendl;
 
-  new_log_writer = _create_writer(new_log);
+  // 4. allocate and flush
+  r = _allocate(BlueFS::BDEV_DB, new_log_jump_to,
+                    &new_log->fnode);
+  ceph_assert(r == 0);
   new_log_writer->append(bl);
-
-  // 3. flush
   r = _flush(new_log_writer, true);
   ceph_assert(r == 0);
 
-  // 4. wait
+  // 5. wait
   _flush_bdev_safely(new_log_writer);
 
-  // 5. update our log fnode
+  // 6. the log writer must be idle while we splice
+  while (log_flushing) {
+    dout(10) << __func__ << " log is currently flushing, waiting" << dendl;
+    log_cond.wait(l);
+  }
+
+  // 7. update our log fnode
   // discard first old_log_jump_to extents
   dout(10) << __func__ << " remove 0x" << std::hex << old_log_jump_to << std::dec
 	   << " of " << log_file->fnode.extents << dendl;
@@ -1908,7 +2080,7 @@ void BlueFS::_compact_log_async(std::unique_lock<ceph::mutex>& l)
   log_writer->pos = log_writer->file->fnode.size =
     log_writer->pos - old_log_jump_to + new_log_jump_to;
 
-  // 6. write the super block to reflect the changes
+  // 8. write the super block to reflect the changes
   dout(10) << __func__ << " writing super" << dendl;
   super.log_fnode = log_file->fnode;
   ++super.version;
@@ -1918,7 +2090,7 @@ void BlueFS::_compact_log_async(std::unique_lock<ceph::mutex>& l)
   flush_bdev();
   lock.lock();
 
-  // 7. release old space
+  // 9. release old space
   dout(10) << __func__ << " release old log extents " << old_extents << dendl;
   for (auto& r : old_extents) {
     pending_release[r.bdev].insert(r.offset, r.length);
@@ -2200,9 +2372,16 @@ int BlueFS::_flush_range(FileWriter *h, uint64_t offset, uint64_t length)
   dout(20) << __func__ << " in " << *p << " x_off 0x"
            << std::hex << x_off << std::dec << dendl;
 
+  // a byte-addressable device persists exactly the bytes we hand it, so
+  // an append that stays within this extent needs neither the partial
+  // tail block rewritten in front of it nor padding behind it.
+  bool byte_write = x_off + length <= p->length &&
+    bdev[p->bdev]->supported_byte_writes();
   unsigned partial = x_off & ~super.block_mask();
   bufferlist bl;
-  if (partial) {
+  if (partial && byte_write) {
+    ceph_assert(h->tail_block.length() == partial);
+  } else if (partial) {
     dout(20) << __func__ << " using partial tail 0x"
              << std::hex << partial << std::dec << dendl;
     ceph_assert(h->tail_block.length() == partial);
@@ -2217,7 +2396,7 @@ int BlueFS::_flush_range(FileWriter *h, uint64_t offset, uint64_t length)
       }
     }
   }
-  if (length == partial + h->buffer.length()) {
+  if (length == bl.length() + h->buffer.length()) {
     bl.claim_append_piecewise(h->buffer);
   } else {
     bufferlist t;
@@ -2244,7 +2423,18 @@ int BlueFS::_flush_range(FileWriter *h, uint64_t offset, uint64_t length)
   *_dout << dendl;
 
   h->pos = offset + length;
-  h->tail_block.clear();
+  if (byte_write) {
+    // keep the tail block current for a later flush on the block path
+    unsigned tail = (x_off + length) & ~super.block_mask();
+    if (tail > length) {
+      h->tail_block.append(bl);
+    } else {
+      h->tail_block.substr_of(bl, length - tail, tail);
+    }
+    ceph_assert(h->tail_block.length() == tail);
+  } else {
+    h->tail_block.clear();
+  }
 
   uint64_t bloff = 0;
   uint64_t bytes_written_slow = 0;
@@ -2253,7 +2443,7 @@ int BlueFS::_flush_range(FileWriter *h, uint64_t offset, uint64_t length)
     bufferlist t;
     t.substr_of(bl, bloff, x_len);
     unsigned tail = x_len & ~super.block_mask();
-    if (tail) {
+    if (tail && !byte_write) {
       size_t zlen = super.block_size - tail;
       dout(20) << __func__ << " caching tail of 0x"
                << std::hex << tail
@@ -2785,6 +2975,13 @@ int BlueFS::open_for_read(
 
   *h = new FileReader(file, random ? 4096 : cct->_conf->bluefs_max_prefetch,
 		      random, false);
+  if (!random && cct->_conf->bluefs_readahead_max) {
+    auto& ra = (*h)->buf.ra;
+    ra.set_trigger_requests(cct->_conf->bluefs_readahead_trigger_requests);
+    ra.set_min_readahead_size(cct->_conf->bluefs_max_prefetch);
+    ra.set_max_readahead_size(cct->_conf->bluefs_readahead_max);
+    (*h)->buf.ra_ioc = std::make_unique<IOContext>(cct, nullptr);
+  }
   dout(10) << __func__ << " h " << *h << " on " << file->fnode << dendl;
   return 0;
 }
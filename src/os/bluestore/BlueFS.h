@@ -8,6 +8,7 @@
 
 #include "bluefs_types.h"
 #include "common/RefCountedObj.h"
+#include "common/Readahead.h"
 #include "BlockDevice.h"
 
 #include "boost/intrusive/list.hpp"
@@ -49,6 +50,9 @@ enum {
   l_bluefs_read_bytes,
   l_bluefs_read_prefetch_count,
   l_bluefs_read_prefetch_bytes,
+  l_bluefs_read_ahead_count,
+  l_bluefs_read_ahead_bytes,
+  l_bluefs_read_ahead_hit_count,
 
   l_bluefs_last,
 };
@@ -201,10 +205,21 @@ public:
     uint64_t pos;           ///< current logical offset
     uint64_t max_prefetch;  ///< max allowed prefetch
 
+    Readahead ra;           ///< sequential stream detection
+    uint64_t ra_off = 0;    ///< async readahead logical offset
+    bufferlist ra_bl;       ///< async readahead, valid once ra_ioc is idle
+    int ra_bdev = -1;       ///< device ra_bl is read from
+    std::unique_ptr<IOContext> ra_ioc;
+
     explicit FileReaderBuffer(uint64_t mpf)
       : bl_off(0),
 	pos(0),
 	max_prefetch(mpf) {}
+    ~FileReaderBuffer() {
+      if (ra_ioc) {
+	ra_ioc->aio_wait();
+      }
+    }
 
     uint64_t get_buf_end() {
       return bl_off + bl.length();
@@ -347,6 +362,16 @@ private:
   };
   void _compact_log_dump_metadata(bluefs_transaction_t *t,
 				  int flags);
+
+  /// frozen copy of the metadata a compacted log has to describe
+  struct log_snapshot_t {
+    vector<interval_set<uint64_t>> block_all;
+    vector<bluefs_fnode_t> fnodes;
+    vector<pair<string, vector<pair<string, uint64_t>>>> dirs;
+  };
+  void _compact_log_snapshot(log_snapshot_t *snap);
+  void _compact_log_encode_snapshot(const log_snapshot_t& snap,
+				    bluefs_transaction_t *t);
   void _compact_log_sync();
   void _compact_log_async(std::unique_lock<ceph::mutex>& l);
 
@@ -365,6 +390,12 @@ private:
   int _preallocate(FileRef f, uint64_t off, uint64_t len);
   int _truncate(FileWriter *h, uint64_t off);
 
+  void _read_ahead(
+    FileReader *h,
+    FileReaderBuffer *buf,
+    uint64_t off,
+    uint64_t len);
+  bool _claim_read_ahead(FileReaderBuffer *buf, uint64_t off);
   int _read(
     FileReader *h,   ///< [in] read from here
     FileReaderBuffer *buf, ///< [in] reader state
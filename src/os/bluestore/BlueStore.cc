@@ -77,6 +77,7 @@ const string PREFIX_DEFERRED = "L";    // id -> deferred_transaction_t
 const string PREFIX_ALLOC = "B";       // u64 offset -> u64 length (freelist)
 const string PREFIX_ALLOC_BITMAP = "b";// (see BitmapFreelistManager)
 const string PREFIX_SHARED_BLOB = "X"; // u64 offset -> shared_blob_t
+const string PREFIX_ALLOC_SNAPSHOT = "a"; // u64 chunk -> free extents
 
 const string BLUESTORE_GLOBAL_STATFS_KEY = "bluestore_statfs";
 
@@ -568,6 +569,17 @@ static void get_omap_tail(uint64_t id, string *out)
   out->push_back('~');
 }
 
+// an iterator over the omap of object id only; the kv store need not step
+// over the keys, live or deleted, of the objects around it
+static KeyValueDB::Iterator get_omap_kv_iterator(
+  KeyValueDB *db, const string& prefix, uint64_t id, size_t readahead = 0)
+{
+  string head, tail;
+  get_omap_header(id, &head);
+  get_omap_tail(id, &tail);
+  return db->get_bounded_iterator(prefix, head, tail, readahead);
+}
+
 static void get_deferred_key(uint64_t seq, string *out)
 {
   _key_encode_u64(seq, out);
@@ -903,8 +915,36 @@ BlueStore::Cache *BlueStore::Cache::create(CephContext* cct, string type,
 
 void BlueStore::Cache::trim(uint64_t onode_max, uint64_t buffer_max)
 {
-  std::lock_guard l(lock);
-  _trim(onode_max, buffer_max);
+  // Trim in bounded steps and drop the lock in between, so that a large
+  // cut of the shard target does not stall every op on this shard behind
+  // one long _trim() pass.
+  uint64_t onode_batch = cct->_conf->bluestore_cache_trim_batch_onodes;
+  uint64_t buffer_batch = cct->_conf->bluestore_cache_trim_batch_bytes;
+  while (true) {
+    std::lock_guard l(lock);
+    uint64_t num_onodes = _get_num_onodes();
+    uint64_t buffer_bytes = _get_buffer_bytes();
+    if (num_onodes <= onode_max && buffer_bytes <= buffer_max) {
+      break;
+    }
+    uint64_t onode_target = onode_max;
+    if (onode_batch && num_onodes > onode_max + onode_batch) {
+      onode_target = num_onodes - onode_batch;
+    }
+    uint64_t buffer_target = buffer_max;
+    if (buffer_batch && buffer_bytes > buffer_max + buffer_batch) {
+      buffer_target = buffer_bytes - buffer_batch;
+    }
+    _trim(onode_target, buffer_target);
+    if (onode_target == onode_max && buffer_target == buffer_max) {
+      break;
+    }
+    if (_get_num_onodes() == num_onodes &&
+	_get_buffer_bytes() == buffer_bytes) {
+      // everything left is pinned
+      break;
+    }
+  }
 }
 
 void BlueStore::Cache::trim_all()
@@ -1432,6 +1472,8 @@ void BlueStore::BufferSpace::read(
   uint32_t want_bytes = length;
   uint32_t end = offset + length;
 
+  cache->buffer_demand += length;
+
   {
     std::lock_guard l(cache->lock);
     for (auto i = _data_lower_bound(offset);
@@ -1601,6 +1643,8 @@ BlueStore::OnodeRef BlueStore::OnodeSpace::lookup(const ghobject_t& oid)
   OnodeRef o;
   bool hit = false;
 
+  ++cache->onode_demand;
+
   {
     std::lock_guard l(cache->lock);
     ceph::unordered_map<ghobject_t,OnodeRef>::iterator p = onode_map.find(oid);
@@ -2127,6 +2171,22 @@ void BlueStore::ExtentMap::dup(BlueStore* b, TransContext* txc,
   uint32_t dirty_range_begin = 0;
   uint32_t dirty_range_end = 0;
   bool src_dirty = false;
+
+  // cloning an already cloned object bumps the refs of each of its shared
+  // blobs; fetch their ref maps together
+  {
+    vector<SharedBlobRef> sbs;
+    for (auto ep = oldo->extent_map.seek_lextent(srcoff);
+	 ep != oldo->extent_map.extent_map.end() && ep->logical_offset < end;
+	 ++ep) {
+      if (ep->blob->get_blob().is_shared() &&
+	  !ep->blob->shared_blob->is_loaded()) {
+	sbs.push_back(ep->blob->shared_blob);
+      }
+    }
+    c->load_shared_blobs(sbs);
+  }
+
   for (auto ep = oldo->extent_map.seek_lextent(srcoff);
     ep != oldo->extent_map.extent_map.end();
     ++ep) {
@@ -2911,6 +2971,29 @@ void BlueStore::ExtentMap::init_shards(bool loaded, bool dirty)
   }
 }
 
+void BlueStore::ExtentMap::read_shard(
+  KeyValueDB *db,
+  Shard *p,
+  bufferlist *v)
+{
+  auto cct = onode->c->store->cct; //used by dout
+  string key;
+  generate_extent_shard_key_and_apply(
+    onode->key, p->shard_info->offset, &key,
+    [&](const string& final_key) {
+      int r = db->get(PREFIX_OBJ, final_key, v);
+      if (r < 0) {
+	derr << __func__ << " missing shard 0x" << std::hex
+	     << p->shard_info->offset << std::dec << " for " << onode->oid
+	     << dendl;
+	ceph_assert(r >= 0);
+      }
+    }
+  );
+  ceph_assert(p->dirty == false);
+  ceph_assert(v->length() == p->shard_info->bytes);
+}
+
 void BlueStore::ExtentMap::fault_range(
   KeyValueDB *db,
   uint32_t offset,
@@ -2926,7 +3009,11 @@ void BlueStore::ExtentMap::fault_range(
     return;
 
   ceph_assert(last >= start);
-  string key;
+  if (num_shard_views) {
+    // whoever asks for full shards may modify the map: partially decoded
+    // blobs must not be visible to them
+    drop_shard_views(start, last);
+  }
   while (start <= last) {
     ceph_assert((size_t)start < shards.size());
     auto p = &shards[start];
@@ -2934,27 +3021,21 @@ void BlueStore::ExtentMap::fault_range(
       dout(30) << __func__ << " opening shard 0x" << std::hex
 	       << p->shard_info->offset << std::dec << dendl;
       bufferlist v;
-      generate_extent_shard_key_and_apply(
-	onode->key, p->shard_info->offset, &key,
-        [&](const string& final_key) {
-          int r = db->get(PREFIX_OBJ, final_key, &v);
-          if (r < 0) {
-	    derr << __func__ << " missing shard 0x" << std::hex
-		 << p->shard_info->offset << std::dec << " for " << onode->oid
-		 << dendl;
-	    ceph_assert(r >= 0);
-          }
-        }
-      );
+      if (p->view) {
+	v = std::move(p->view->bl);
+	p->view.reset();
+	--num_shard_views;
+	onode->c->store->logger->inc(l_bluestore_onode_shard_hits);
+      } else {
+	read_shard(db, p, &v);
+	onode->c->store->logger->inc(l_bluestore_onode_shard_misses);
+      }
       p->extents = decode_some(v);
       p->loaded = true;
       dout(20) << __func__ << " open shard 0x" << std::hex
 	       << p->shard_info->offset
 	       << " for range 0x" << offset << "~" << length << std::dec
 	       << " (" << v.length() << " bytes)" << dendl;
-      ceph_assert(p->dirty == false);
-      ceph_assert(v.length() == p->shard_info->bytes);
-      onode->c->store->logger->inc(l_bluestore_onode_shard_misses);
     } else {
       onode->c->store->logger->inc(l_bluestore_onode_shard_hits);
     }
@@ -2962,6 +3043,185 @@ void BlueStore::ExtentMap::fault_range(
   }
 }
 
+void BlueStore::ExtentMap::fault_range_for_read(
+  KeyValueDB *db,
+  uint32_t offset,
+  uint32_t length)
+{
+  auto cct = onode->c->store->cct; //used by dout
+  if (!cct->_conf->bluestore_extent_map_lazy_decode) {
+    fault_range(db, offset, length);
+    return;
+  }
+  dout(30) << __func__ << " 0x" << std::hex << offset << "~" << length
+	   << std::dec << dendl;
+  auto start = seek_shard(offset);
+  auto last = seek_shard(length ? offset + length - 1 : offset);
+
+  if (start < 0)
+    return;
+
+  ceph_assert(last >= start);
+  while (start <= last) {
+    ceph_assert((size_t)start < shards.size());
+    auto p = &shards[start];
+    if (p->loaded) {
+      onode->c->store->logger->inc(l_bluestore_onode_shard_hits);
+    } else {
+      if (!p->view) {
+	bufferlist v;
+	read_shard(db, p, &v);
+	index_shard(p, v);
+	dout(20) << __func__ << " indexed shard 0x" << std::hex
+		 << p->shard_info->offset
+		 << " for range 0x" << offset << "~" << length << std::dec
+		 << " (" << p->extents << " extents)" << dendl;
+	onode->c->store->logger->inc(l_bluestore_onode_shard_misses);
+      } else {
+	onode->c->store->logger->inc(l_bluestore_onode_shard_hits);
+      }
+      materialize_range(p, offset, length);
+    }
+    ++start;
+  }
+}
+
+void BlueStore::ExtentMap::index_shard(Shard *p, bufferlist& bl)
+{
+  ceph_assert(bl.get_num_buffers() <= 1);
+  auto v = std::make_shared<ShardView>();
+  v->bl = std::move(bl);
+  // no deep copies: the view keeps the whole buffer anyway
+  auto it = v->bl.front().begin();
+  denc(v->struct_v, it);
+  ceph_assert(v->struct_v == 1 || v->struct_v == 2);
+
+  uint32_t num;
+  denc_varint(num, it);
+  v->entries.reserve(num);
+  v->blob_pos.resize(num);
+  v->blobs.resize(num);
+  v->decoded.resize(num);
+  uint64_t pos = 0;
+  uint64_t prev_len = 0;
+  unsigned n = 0;
+
+  // same walk as decode_some(), but local blobs are only skipped over
+  while (!it.end()) {
+    uint64_t blobid;
+    denc_varint(blobid, it);
+    if ((blobid & BLOBID_FLAG_CONTIGUOUS) == 0) {
+      uint64_t gap;
+      denc_varint_lowz(gap, it);
+      pos += gap;
+    }
+    uint64_t blob_offset = 0;
+    if ((blobid & BLOBID_FLAG_ZEROOFFSET) == 0) {
+      denc_varint_lowz(blob_offset, it);
+    }
+    if ((blobid & BLOBID_FLAG_SAMELENGTH) == 0) {
+      denc_varint_lowz(prev_len, it);
+    }
+    ShardView::entry_t e;
+    e.logical_offset = pos;
+    e.blob_offset = blob_offset;
+    e.length = prev_len;
+    if (blobid & BLOBID_FLAG_SPANNING) {
+      e.blob = ~(int32_t)(blobid >> BLOBID_SHIFT_BITS);
+    } else {
+      blobid >>= BLOBID_SHIFT_BITS;
+      if (blobid) {
+	ceph_assert(blobid <= n);
+	e.blob = blobid - 1;
+      } else {
+	e.blob = n;
+	v->blob_pos[n] = it.get_offset();
+	bluestore_blob_t blob;
+	denc(blob, it, v->struct_v);
+	if (blob.is_shared()) {
+	  uint64_t sbid;
+	  denc(sbid, it);
+	}
+      }
+    }
+    v->entries.push_back(e);
+    pos += prev_len;
+    ++n;
+  }
+  ceph_assert(n == num);
+
+  p->extents = num;
+  p->view = std::move(v);
+  ++num_shard_views;
+}
+
+void BlueStore::ExtentMap::materialize_range(
+  Shard *p,
+  uint32_t offset,
+  uint32_t length)
+{
+  auto& v = *p->view;
+  uint64_t end = (uint64_t)offset + length;
+  auto i = std::upper_bound(
+    v.entries.begin(), v.entries.end(), offset,
+    [](uint32_t o, const ShardView::entry_t& e) {
+      return o < e.logical_offset + e.length;
+    });
+  for (; i != v.entries.end() && i->logical_offset < end; ++i) {
+    size_t n = i - v.entries.begin();
+    if (v.decoded[n]) {
+      continue;
+    }
+    BlobRef b;
+    if (i->blob < 0) {
+      b = get_spanning_blob(~i->blob);
+    } else {
+      b = v.blobs[i->blob];
+      if (!b) {
+	b = new Blob();
+	auto it = v.bl.front().begin(v.blob_pos[i->blob]);
+	uint64_t sbid = 0;
+	b->decode(onode->c, it, v.struct_v, &sbid, false);
+	onode->c->open_shared_blob(sbid, b);
+	v.blobs[i->blob] = b;
+      }
+      // partial: only covers the lextents materialized so far
+      b->get_ref(onode->c, i->blob_offset, i->length);
+    }
+    add(i->logical_offset, i->blob_offset, i->length, b);
+    v.decoded[n] = true;
+  }
+}
+
+void BlueStore::ExtentMap::drop_shard_views(int keep_start, int keep_last)
+{
+  for (int i = 0; i < (int)shards.size(); ++i) {
+    auto& s = shards[i];
+    if (!s.view) {
+      continue;
+    }
+    auto& v = *s.view;
+    for (size_t n = 0; n < v.entries.size(); ++n) {
+      if (v.decoded[n]) {
+	auto ep = find(v.entries[n].logical_offset);
+	ceph_assert(ep != extent_map.end());
+	rm(ep);
+      }
+    }
+    if (i >= keep_start && i <= keep_last) {
+      // about to be decoded in full; only the encoded shard is needed
+      v.entries.clear();
+      v.blob_pos.clear();
+      v.blobs.clear();
+      v.decoded.clear();
+    } else {
+      s.view.reset();
+      --num_shard_views;
+    }
+  }
+  ceph_assert(num_shard_views <= (unsigned)(keep_last - keep_start + 1));
+}
+
 void BlueStore::ExtentMap::dirty_range(
   uint32_t offset,
   uint32_t length)
@@ -3468,6 +3728,49 @@ void BlueStore::Collection::load_shared_blob(SharedBlobRef sb)
   }
 }
 
+void BlueStore::Collection::load_shared_blobs(const vector<SharedBlobRef>& sbs)
+{
+  map<string, SharedBlob*> to_load;
+  for (auto& sb : sbs) {
+    if (!sb->is_loaded()) {
+      string key;
+      get_shared_blob_key(sb->get_sbid(), &key);
+      to_load.emplace(std::move(key), sb.get());
+    }
+  }
+  if (to_load.size() < 2) {
+    if (!to_load.empty()) {
+      load_shared_blob(to_load.begin()->second);
+    }
+    return;
+  }
+
+  set<string> keys;
+  for (auto& p : to_load) {
+    keys.insert(p.first);
+  }
+  map<string, bufferlist> values;
+  store->db->get(PREFIX_SHARED_BLOB, keys, &values);
+  for (auto& [key, sb] : to_load) {
+    auto sbid = sb->get_sbid();
+    auto v = values.find(key);
+    if (v == values.end()) {
+      lderr(store->cct) << __func__ << " sbid 0x" << std::hex << sbid
+			<< std::dec << " not found at key "
+			<< pretty_binary_string(key) << dendl;
+      ceph_abort_msg("uh oh, missing shared_blob");
+    }
+    sb->loaded = true;
+    sb->persistent = new bluestore_shared_blob_t(sbid);
+    auto p = v->second.cbegin();
+    decode(*(sb->persistent), p);
+    ldout(store->cct, 10) << __func__ << " sbid 0x" << std::hex << sbid
+			  << std::dec << " loaded shared_blob " << *sb << dendl;
+  }
+  store->logger->inc(l_bluestore_shared_blob_batch_loads);
+  store->logger->inc(l_bluestore_shared_blob_batch_loaded, to_load.size());
+}
+
 void BlueStore::Collection::make_blob_shared(uint64_t sbid, BlobRef b)
 {
   ldout(store->cct, 10) << __func__ << " " << *b << dendl;
@@ -3552,6 +3855,8 @@ BlueStore::OnodeRef BlueStore::Collection::get_onode(
     for (auto& i : on->onode.attrs) {
       i.second.reassign_to_mempool(mempool::mempool_bluestore_cache_other);
     }
+    on->onode.inline_data.reassign_to_mempool(
+      mempool::mempool_bluestore_cache_other);
 
     // initialize extent_map
     on->extent_map.decode_spanning_blobs(p);
@@ -3673,6 +3978,7 @@ void *BlueStore::MempoolThread::entry()
     pcm->insert("kv", binned_kv_cache, true);
     pcm->insert("meta", meta_cache, true);
     pcm->insert("data", data_cache, true);
+    pcm->insert("decompressed", decompressed_cache, true);
   }
 
   utime_t next_balance = ceph_clock_now();
@@ -3691,6 +3997,7 @@ void *BlueStore::MempoolThread::entry()
       interval_stats_trim = true;
 
       if (pcm != nullptr) {
+        pcm->shift_bins();
         pcm->balance();
       }
 
@@ -3725,6 +4032,7 @@ void BlueStore::MempoolThread::_adjust_cache_settings()
   }
   meta_cache->set_cache_ratio(store->cache_meta_ratio);
   data_cache->set_cache_ratio(store->cache_data_ratio);
+  decompressed_cache->set_cache_ratio(store->cache_decompressed_ratio);
 }
 
 void BlueStore::MempoolThread::_trim_shards(bool interval_stats)
@@ -3735,6 +4043,7 @@ void BlueStore::MempoolThread::_trim_shards(bool interval_stats)
   int64_t kv_used = store->db->get_cache_usage();
   int64_t meta_used = meta_cache->_get_used_bytes();
   int64_t data_used = data_cache->_get_used_bytes();
+  int64_t decompressed_used = decompressed_cache->_get_used_bytes();
 
   uint64_t cache_size = store->cache_size;
   int64_t kv_alloc =
@@ -3743,12 +4052,15 @@ void BlueStore::MempoolThread::_trim_shards(bool interval_stats)
      static_cast<int64_t>(store->cache_meta_ratio * cache_size);
   int64_t data_alloc =
      static_cast<int64_t>(store->cache_data_ratio * cache_size);
+  int64_t decompressed_alloc =
+     static_cast<int64_t>(store->cache_decompressed_ratio * cache_size);
 
   if (pcm != nullptr && binned_kv_cache != nullptr) {
     cache_size = pcm->get_tuned_mem();
     kv_alloc = binned_kv_cache->get_committed_size();
     meta_alloc = meta_cache->get_committed_size();
     data_alloc = data_cache->get_committed_size();
+    decompressed_alloc = decompressed_cache->get_committed_size();
   }
   
   if (interval_stats) {
@@ -3758,7 +4070,9 @@ void BlueStore::MempoolThread::_trim_shards(bool interval_stats)
                   << " meta_alloc: " << meta_alloc
                   << " meta_used: " << meta_used
                   << " data_alloc: " << data_alloc
-                  << " data_used: " << data_used << dendl;
+                  << " data_used: " << data_used
+                  << " decompressed_alloc: " << decompressed_alloc
+                  << " decompressed_used: " << decompressed_used << dendl;
   } else {
     ldout(cct, 20) << __func__  << " cache_size: " << cache_size
                    << " kv_alloc: " << kv_alloc
@@ -3766,18 +4080,143 @@ void BlueStore::MempoolThread::_trim_shards(bool interval_stats)
                    << " meta_alloc: " << meta_alloc
                    << " meta_used: " << meta_used
                    << " data_alloc: " << data_alloc
-                   << " data_used: " << data_used << dendl;
+                   << " data_used: " << data_used
+                   << " decompressed_alloc: " << decompressed_alloc
+                   << " decompressed_used: " << decompressed_used << dendl;
+  }
+
+  uint64_t max_onodes = static_cast<uint64_t>(
+      meta_alloc / meta_cache->get_bytes_per_onode());
+
+  // Give every shard a fixed part of its even share and distribute the
+  // rest according to recent demand, so that the collections hashing to a
+  // hot shard are not trimmed as hard as the ones on an idle shard.
+  double min_ratio = cct->_conf->bluestore_cache_shard_min_ratio;
+  if (shard_onode_weight.size() != num_shards) {
+    shard_onode_weight.assign(num_shards, 0.0);
+    shard_buffer_weight.assign(num_shards, 0.0);
+  }
+  double onode_weight_total = 0.0;
+  double buffer_weight_total = 0.0;
+  for (size_t i = 0; i < num_shards; i++) {
+    auto shard = store->cache_shards[i];
+    // decay older samples; trim intervals are short and noisy
+    shard_onode_weight[i] = shard_onode_weight[i] * 0.9 +
+      shard->onode_demand.exchange(0);
+    shard_buffer_weight[i] = shard_buffer_weight[i] * 0.9 +
+      shard->buffer_demand.exchange(0);
+    onode_weight_total += shard_onode_weight[i];
+    buffer_weight_total += shard_buffer_weight[i];
   }
 
-  uint64_t max_shard_onodes = static_cast<uint64_t>(
-      (meta_alloc / (double) num_shards) / meta_cache->get_bytes_per_onode());
-  uint64_t max_shard_buffer = static_cast<uint64_t>(data_alloc / num_shards);
+  for (size_t i = 0; i < num_shards; i++) {
+    double onode_share = 1.0 / num_shards;
+    if (onode_weight_total > 0) {
+      onode_share = min_ratio / num_shards +
+	(1.0 - min_ratio) * shard_onode_weight[i] / onode_weight_total;
+    }
+    double buffer_share = 1.0 / num_shards;
+    if (buffer_weight_total > 0) {
+      buffer_share = min_ratio / num_shards +
+	(1.0 - min_ratio) * shard_buffer_weight[i] / buffer_weight_total;
+    }
+    uint64_t max_shard_onodes = static_cast<uint64_t>(max_onodes * onode_share);
+    uint64_t max_shard_buffer = static_cast<uint64_t>(data_alloc * buffer_share);
 
-  ldout(cct, 30) << __func__ << " max_shard_onodes: " << max_shard_onodes
-                 << " max_shard_buffer: " << max_shard_buffer << dendl;
+    ldout(cct, 30) << __func__ << " shard " << i
+		   << " max_shard_onodes: " << max_shard_onodes
+		   << " max_shard_buffer: " << max_shard_buffer << dendl;
 
-  for (auto i : store->cache_shards) {
-    i->trim(max_shard_onodes, max_shard_buffer);
+    store->cache_shards[i]->trim(max_shard_onodes, max_shard_buffer);
+  }
+  // only compressed pools ever fill it, so let a zero ratio disable it
+  store->decompressed_blobs.trim(
+    store->cache_decompressed_ratio > 0 ? decompressed_alloc : 0);
+}
+
+// =======================================================
+
+// DecompressedBlobCache
+
+bool BlueStore::DecompressedBlobCache::lookup(
+  const bluestore_blob_t& blob,
+  bufferlist *out)
+{
+  std::lock_guard l(lock);
+  auto p = entries.find(blob.get_extents().front().offset);
+  if (p == entries.end() ||
+      p->second.ondisk_length != blob.get_ondisk_length()) {
+    return false;
+  }
+  lru.splice(lru.begin(), lru, p->second.lru_pos);
+  *out = p->second.data;
+  return true;
+}
+
+void BlueStore::DecompressedBlobCache::insert(
+  const bluestore_blob_t& blob,
+  const bufferlist& data)
+{
+  std::lock_guard l(lock);
+  if (data.length() > max_bytes) {
+    return;
+  }
+  uint64_t offset = blob.get_extents().front().offset;
+  auto p = entries.find(offset);
+  if (p != entries.end()) {
+    _erase(p);
+  }
+  auto& e = entries[offset];
+  e.ondisk_length = blob.get_ondisk_length();
+  e.data = data;
+  lru.push_front(offset);
+  e.lru_pos = lru.begin();
+  bytes += e.data.length();
+  _trim(max_bytes);
+}
+
+void BlueStore::DecompressedBlobCache::invalidate(
+  const interval_set<uint64_t>& released)
+{
+  std::lock_guard l(lock);
+  if (entries.empty()) {
+    return;
+  }
+  for (auto r = released.begin(); r != released.end(); ++r) {
+    auto p = entries.lower_bound(r.get_start());
+    while (p != entries.end() && p->first < r.get_end()) {
+      _erase(p++);
+    }
+  }
+}
+
+void BlueStore::DecompressedBlobCache::trim(uint64_t target)
+{
+  std::lock_guard l(lock);
+  max_bytes = target;
+  _trim(target);
+}
+
+void BlueStore::DecompressedBlobCache::clear()
+{
+  std::lock_guard l(lock);
+  entries.clear();
+  lru.clear();
+  bytes = 0;
+}
+
+void BlueStore::DecompressedBlobCache::_erase(
+  std::map<uint64_t, entry_t>::iterator p)
+{
+  bytes -= p->second.data.length();
+  lru.erase(p->second.lru_pos);
+  entries.erase(p);
+}
+
+void BlueStore::DecompressedBlobCache::_trim(uint64_t target)
+{
+  while (bytes > target && !lru.empty()) {
+    _erase(entries.find(lru.back()));
   }
 }
 
@@ -3931,6 +4370,51 @@ bufferlist BlueStore::OmapIteratorImpl::value()
   return it->value();
 }
 
+int BlueStore::OmapIteratorImpl::next_batch(
+  const string& end, size_t max, size_t max_bytes, kv_batch_t *batch)
+{
+  RWLock::RLocker l(c->lock);
+  if (!o->onode.has_omap() || !it) {
+    return 0;
+  }
+  auto start1 = mono_clock::now();
+  if (!readahead && it->valid()) {
+    // a bulk reader will keep going; carry on from here with read-ahead
+    size_t ra = c->store->hot_conf->omap_readahead;
+    if (ra) {
+      string pos = it->raw_key().second;
+      it = get_omap_kv_iterator(
+	c->store->db,
+	o->onode.is_pgmeta_omap() ? PREFIX_PGMETA_OMAP : PREFIX_OMAP,
+	o->onode.nid, ra);
+      it->lower_bound(pos);
+    }
+    readahead = true;
+  }
+  string kv_end;
+  if (end.empty()) {
+    kv_end = tail;
+  } else {
+    get_omap_key(o->onode.nid, end, &kv_end);
+  }
+  size_t first = batch->size();
+  int r = it->next_batch(kv_end, max, max_bytes, batch);
+  // the kv keys lead with the object's omap head; hand out user keys
+  for (size_t i = first; i < batch->size(); ++i) {
+    batch->entries[i].key_off += head.size();
+    batch->entries[i].key_len -= head.size();
+  }
+  c->store->log_latency_fn(
+    __func__,
+    l_bluestore_omap_next_lat,
+    mono_clock::now() - start1,
+    [&] (const ceph::timespan& lat) {
+      return ", lat = " + timespan_str(lat) + _stringify();
+    }
+  );
+  return r;
+}
+
 
 // =====================================
 
@@ -3959,6 +4443,21 @@ void BlueStore::handle_discard(interval_set<uint64_t>& to_release)
   alloc->release(to_release);
 }
 
+bluestore_hot_conf_t::bluestore_hot_conf_t(const ConfigProxy& conf)
+  : omap_readahead(conf.get_val<Option::size_t>("bluestore_omap_readahead")),
+    bluefs_min_free(conf.get_val<Option::size_t>("bluestore_bluefs_min_free"))
+{}
+
+const char** bluestore_hot_conf_t::get_tracked_conf_keys()
+{
+  static const char* keys[] = {
+    "bluestore_omap_readahead",
+    "bluestore_bluefs_min_free",
+    nullptr
+  };
+  return keys;
+}
+
 BlueStore::BlueStore(CephContext *cct, const string& path)
   : ObjectStore(cct, path),
     throttle_bytes(cct, "bluestore_throttle_bytes",
@@ -4290,11 +4789,24 @@ int BlueStore::_set_cache_sizes()
     // deal with floating point imprecision
     cache_data_ratio = 0;
   }
-    
+
+  // decompressed blobs are object data too; carve their share out of it
+  cache_decompressed_ratio = cct->_conf->bluestore_cache_decompressed_ratio;
+  if (cache_decompressed_ratio < 0 || cache_decompressed_ratio > 1.0) {
+    derr << __func__ << " bluestore_cache_decompressed_ratio ("
+         << cache_decompressed_ratio << ") must be in range [0,1.0]" << dendl;
+    return -EINVAL;
+  }
+  if (cache_decompressed_ratio > cache_data_ratio) {
+    cache_decompressed_ratio = cache_data_ratio;
+  }
+  cache_data_ratio -= cache_decompressed_ratio;
+
   dout(1) << __func__ << " cache_size " << cache_size
           << " meta " << cache_meta_ratio
 	  << " kv " << cache_kv_ratio
 	  << " data " << cache_data_ratio
+	  << " decompressed " << cache_decompressed_ratio
 	  << dendl;
   return 0;
 }
@@ -4435,6 +4947,15 @@ void BlueStore::_init_logger()
 	    "Sum for bytes of read hit in the cache", NULL, 0, unit_t(UNIT_BYTES));
   b.add_u64_counter(l_bluestore_buffer_miss_bytes, "bluestore_buffer_miss_bytes",
 	    "Sum for bytes of read missed in the cache", NULL, 0, unit_t(UNIT_BYTES));
+  b.add_u64(l_bluestore_decompressed_cache_bytes,
+	    "bluestore_decompressed_cache_bytes",
+	    "Bytes of decompressed blobs in cache", NULL, 0, unit_t(UNIT_BYTES));
+  b.add_u64_counter(l_bluestore_decompressed_cache_hits,
+		    "bluestore_decompressed_cache_hits",
+		    "Compressed blob reads served without decompressing");
+  b.add_u64_counter(l_bluestore_decompressed_cache_misses,
+		    "bluestore_decompressed_cache_misses",
+		    "Compressed blob reads that had to decompress");
 
   b.add_u64_counter(l_bluestore_write_big, "bluestore_write_big",
 		    "Large aligned writes into fresh blobs");
@@ -4458,6 +4979,8 @@ void BlueStore::_init_logger()
 		    "cached) to fill out the block");
   b.add_u64_counter(l_bluestore_write_small_new, "bluestore_write_small_new",
 		    "Small write into new (sparse) blob");
+  b.add_u64_counter(l_bluestore_write_inline, "bluestore_write_inline",
+		    "Writes kept inline in the onode");
 
   b.add_u64_counter(l_bluestore_txc, "bluestore_txc", "Transactions committed");
   b.add_u64_counter(l_bluestore_onode_reshard, "bluestore_onode_reshard",
@@ -4469,6 +4992,12 @@ void BlueStore::_init_logger()
   b.add_u64_counter(l_bluestore_gc_merged, "bluestore_gc_merged",
 		    "Sum for extents that have been merged due to garbage "
 		    "collection");
+  b.add_u64_counter(l_bluestore_shared_blob_batch_loads,
+		    "bluestore_shared_blob_batch_loads",
+		    "Batched lookups of shared blob ref maps");
+  b.add_u64_counter(l_bluestore_shared_blob_batch_loaded,
+		    "bluestore_shared_blob_batch_loaded",
+		    "Shared blob ref maps loaded by batched lookups");
   b.add_u64_counter(l_bluestore_read_eio, "bluestore_read_eio",
                     "Read EIO errors propagated to high level callers");
   b.add_u64_counter(l_bluestore_reads_with_retries, "bluestore_reads_with_retries",
@@ -4885,25 +5414,177 @@ int BlueStore::_open_alloc()
   uint64_t num = 0, bytes = 0;
 
   dout(1) << __func__ << " opening allocation metadata" << dendl;
-  // initialize from freelist
-  fm->enumerate_reset();
-  uint64_t offset, length;
-  while (fm->enumerate_next(db, &offset, &length)) {
-    alloc->init_add_free(offset, length);
-    ++num;
-    bytes += length;
-  }
-  fm->enumerate_reset();
+  int r = -ENOENT;
+  if (cct->_conf.get_val<bool>("bluestore_alloc_snapshot")) {
+    r = _load_alloc_snapshot(&num, &bytes);
+  }
+  if (r < 0 && num) {
+    // a partially loaded snapshot is of no use; start over
+    alloc->shutdown();
+    delete alloc;
+    alloc = Allocator::create(cct, cct->_conf->bluestore_allocator,
+			      bdev->get_size(),
+			      min_alloc_size);
+    num = bytes = 0;
+  }
+  if (r < 0) {
+    // initialize from freelist
+    fm->enumerate_reset();
+    uint64_t offset, length;
+    while (fm->enumerate_next(db, &offset, &length)) {
+      alloc->init_add_free(offset, length);
+      ++num;
+      bytes += length;
+    }
+    fm->enumerate_reset();
+  }
   dout(1) << __func__ << " loaded " << byte_u_t(bytes)
 	  << " in " << num << " extents"
+	  << (r == 0 ? " from snapshot" : "")
 	  << dendl;
 
-  // also mark bluefs space as allocated
-  for (auto e = bluefs_extents.begin(); e != bluefs_extents.end(); ++e) {
-    alloc->init_rm_free(e.get_start(), e.get_len());
+  if (r < 0) {
+    // also mark bluefs space as allocated; the snapshot already has it so
+    for (auto e = bluefs_extents.begin(); e != bluefs_extents.end(); ++e) {
+      alloc->init_rm_free(e.get_start(), e.get_len());
+    }
+  }
+
+  return 0;
+}
+
+/*
+ * The allocator snapshot is the allocator's free space as of a clean
+ * umount, written to PREFIX_ALLOC_SNAPSHOT in chunks with a header in
+ * PREFIX_SUPER. It is removed as soon as the store is opened writable
+ * again, so a crash never leaves a stale snapshot behind; without one we
+ * rebuild from the freelist as before.
+ */
+int BlueStore::_load_alloc_snapshot(uint64_t *num, uint64_t *bytes)
+{
+  bufferlist bl;
+  int r = db->get(PREFIX_SUPER, "alloc_snapshot", &bl);
+  if (r < 0) {
+    dout(10) << __func__ << " no snapshot" << dendl;
+    return -ENOENT;
+  }
+  uint64_t bdev_size, fm_size, alloc_unit, num_chunks, free_bytes;
+  interval_set<uint64_t> snap_bluefs_extents;
+  try {
+    auto p = bl.cbegin();
+    DECODE_START(1, p);
+    decode(bdev_size, p);
+    decode(fm_size, p);
+    decode(alloc_unit, p);
+    decode(snap_bluefs_extents, p);
+    decode(num_chunks, p);
+    decode(free_bytes, p);
+    DECODE_FINISH(p);
+  } catch (buffer::error& e) {
+    derr << __func__ << " failed to decode snapshot header" << dendl;
+    return -EIO;
+  }
+  if (bdev_size != bdev->get_size() ||
+      fm_size != fm->get_size() ||
+      alloc_unit != min_alloc_size ||
+      !(snap_bluefs_extents == bluefs_extents)) {
+    dout(1) << __func__ << " snapshot does not match the device or bluefs"
+	    << " extents, ignoring it" << dendl;
+    return -ESTALE;
+  }
+
+  uint64_t chunks = 0;
+  KeyValueDB::Iterator it = db->get_iterator(PREFIX_ALLOC_SNAPSHOT);
+  for (it->lower_bound(string()); it->valid(); it->next()) {
+    std::vector<std::pair<uint64_t,uint64_t>> extents;
+    bufferlist v = it->value();
+    try {
+      auto p = v.cbegin();
+      decode(extents, p);
+    } catch (buffer::error& e) {
+      derr << __func__ << " failed to decode snapshot chunk "
+	   << pretty_binary_string(it->key()) << dendl;
+      return -EIO;
+    }
+    for (auto& e : extents) {
+      alloc->init_add_free(e.first, e.second);
+      ++(*num);
+      *bytes += e.second;
+    }
+    ++chunks;
+  }
+  if (chunks != num_chunks || *bytes != free_bytes) {
+    derr << __func__ << " snapshot has " << chunks << " chunks and "
+	 << *bytes << " free bytes, expected " << num_chunks << " and "
+	 << free_bytes << dendl;
+    return -EIO;
+  }
+  return 0;
+}
+
+void BlueStore::_write_alloc_snapshot()
+{
+  if (!bluefs_extents_reclaiming.empty()) {
+    // this space is neither bluefs' nor in the allocator yet
+    dout(1) << __func__ << " bluefs reclaim in progress, skipping" << dendl;
+    return;
+  }
+  // collect first: a kv write may need the allocator for bluefs
+  std::vector<std::pair<uint64_t,uint64_t>> extents;
+  uint64_t free_bytes = 0;
+  alloc->dump([&](uint64_t offset, uint64_t length) {
+      extents.emplace_back(offset, length);
+      free_bytes += length;
+    });
+
+  KeyValueDB::Transaction t = db->get_transaction();
+  t->rmkey(PREFIX_SUPER, "alloc_snapshot");
+  t->rmkeys_by_prefix(PREFIX_ALLOC_SNAPSHOT);
+  db->submit_transaction(t);
+
+  const size_t per_chunk = 65536;
+  uint64_t num_chunks = 0;
+  for (size_t i = 0; i < extents.size(); i += per_chunk) {
+    std::vector<std::pair<uint64_t,uint64_t>> chunk(
+      extents.begin() + i,
+      extents.begin() + std::min(i + per_chunk, extents.size()));
+    bufferlist bl;
+    encode(chunk, bl);
+    string key;
+    _key_encode_u64(num_chunks++, &key);
+    t = db->get_transaction();
+    t->set(PREFIX_ALLOC_SNAPSHOT, key, bl);
+    db->submit_transaction(t);
   }
 
-  return 0;
+  // the header goes last, so a partial snapshot is never used
+  bufferlist bl;
+  ENCODE_START(1, 1, bl);
+  encode(bdev->get_size(), bl);
+  encode(fm->get_size(), bl);
+  encode(min_alloc_size, bl);
+  encode(bluefs_extents, bl);
+  encode(num_chunks, bl);
+  encode(free_bytes, bl);
+  ENCODE_FINISH(bl);
+  t = db->get_transaction();
+  t->set(PREFIX_SUPER, "alloc_snapshot", bl);
+  db->submit_transaction_sync(t);
+  dout(1) << __func__ << " saved " << byte_u_t(free_bytes) << " in "
+	  << extents.size() << " extents" << dendl;
+}
+
+void BlueStore::_remove_alloc_snapshot()
+{
+  bufferlist bl;
+  if (db->get(PREFIX_SUPER, "alloc_snapshot", &bl) < 0) {
+    return;
+  }
+  dout(10) << __func__ << dendl;
+  KeyValueDB::Transaction t = db->get_transaction();
+  t->rmkey(PREFIX_SUPER, "alloc_snapshot");
+  t->rmkeys_by_prefix(PREFIX_ALLOC_SNAPSHOT);
+  db->submit_transaction_sync(t);
 }
 
 void BlueStore::_close_alloc()
@@ -5299,6 +5980,7 @@ int BlueStore::_open_db_and_around(bool read_only)
 	_close_fm();
 	return r;
       }
+      _remove_alloc_snapshot();
     }
   } else {
     r = _open_db(false, false);
@@ -5317,6 +5999,9 @@ int BlueStore::_open_db_and_around(bool read_only)
     r = _open_alloc();
     if (r < 0)
       goto out_fm;
+    if (!read_only) {
+      _remove_alloc_snapshot();
+    }
   }
   return 0;
 
@@ -5699,7 +6384,7 @@ int64_t BlueStore::_get_bluefs_size_delta(uint64_t bluefs_free, uint64_t bluefs_
       gift = g;
     reclaim = 0;
   }
-  uint64_t min_free = cct->_conf.get_val<Option::size_t>("bluestore_bluefs_min_free");
+  uint64_t min_free = hot_conf->bluefs_min_free;
   if (bluefs_free < min_free &&
       min_free < free_cap) {
     uint64_t g = min_free - bluefs_free;
@@ -6613,6 +7298,9 @@ int BlueStore::_mount(bool kv_only, bool open_db)
     // we can bypass db open exclusively in case of kv_only mode
     ceph_assert(kv_only);
     r = _open_db(false, true);
+    if (r == 0) {
+      _remove_alloc_snapshot();
+    }
   }
   if (r < 0) {
     goto out_bdev;
@@ -6673,6 +7361,9 @@ int BlueStore::umount()
     dout(20) << __func__ << " stopping kv thread" << dendl;
     _kv_stop();
     _flush_cache();
+    if (cct->_conf.get_val<bool>("bluestore_alloc_snapshot")) {
+      _write_alloc_snapshot();
+    }
     dout(20) << __func__ << " closing" << dendl;
 
   }
@@ -7089,6 +7780,61 @@ int BlueStore::_fsck(bool deep, bool repair)
     CollectionRef c;
     spg_t pgid;
     mempool::bluestore_fsck::list<string> expecting_shards;
+
+    auto read_object = [this](Collection* c, OnodeRef o,
+			      const ghobject_t& oid) {
+      bufferlist bl;
+      uint64_t max_read_block = cct->_conf->bluestore_fsck_read_bytes_cap;
+      uint64_t offset = 0;
+      do {
+	uint64_t l = std::min(uint64_t(o->onode.size - offset), max_read_block);
+	int r = _do_read(c, o, offset, l, bl,
+	  CEPH_OSD_OP_FLAG_FADVISE_NOCACHE);
+	if (r < 0) {
+	  derr << "fsck error: " << oid << std::hex
+	       << " error during read: "
+	       << " " << offset << "~" << l
+	       << " " << cpp_strerror(r) << std::dec
+	       << dendl;
+	  return 1;
+	}
+	offset += l;
+      } while (offset < o->onode.size);
+      return 0;
+    };
+
+    // deep reads dominate a deep fsck; overlap them with the walk
+    struct DeepReaders {
+      std::unique_ptr<ThreadPool> tp;
+      std::unique_ptr<ContextWQ> wq;
+      ceph::mutex lock = ceph::make_mutex("BlueStore::_fsck::DeepReaders");
+      ceph::condition_variable cond;
+      unsigned in_flight = 0;
+      unsigned max_in_flight = 0;
+      int errors = 0;
+
+      void wait_for(unsigned n) {
+	std::unique_lock l(lock);
+	cond.wait(l, [&] { return in_flight <= n; });
+      }
+      ~DeepReaders() {
+	if (tp) {
+	  wait_for(0);
+	  tp->stop();
+	}
+      }
+    } readers;
+    unsigned read_threads = cct->_conf.get_val<uint64_t>(
+      "bluestore_fsck_read_threads");
+    if (deep && read_threads > 0) {
+      readers.tp = std::make_unique<ThreadPool>(
+	cct, "BlueStore::fsck_tp", "bstore_fsck", read_threads);
+      readers.wq = std::make_unique<ContextWQ>(
+	"BlueStore::fsck_wq", 0, readers.tp.get());
+      readers.max_in_flight = read_threads * 4;
+      readers.tp->start();
+    }
+
     for (it->lower_bound(string()); it->valid(); it->next()) {
       if (g_conf()->bluestore_debug_fsck_abort) {
 	goto out_scan;
@@ -7185,6 +7931,10 @@ int BlueStore::_fsck(bool deep, bool repair)
       store_statfs_t onode_statfs;
       RWLock::RLocker l(c->lock);
       OnodeRef o = c->get_onode(oid, false);
+      if (o->onode.has_inline_data()) {
+	onode_statfs.allocated += o->onode.inline_data.length();
+	onode_statfs.data_stored += o->onode.inline_data.length();
+      }
       if (o->onode.nid) {
 	if (o->onode.nid > nid_max) {
 	  derr << "fsck error: " << oid << " nid " << o->onode.nid
@@ -7365,25 +8115,26 @@ int BlueStore::_fsck(bool deep, bool repair)
 					onode_statfs);
         }
       }
-      if (deep) {
-	bufferlist bl;
-	uint64_t max_read_block = cct->_conf->bluestore_fsck_read_bytes_cap;
-	uint64_t offset = 0;
-	do {
-	  uint64_t l = std::min(uint64_t(o->onode.size - offset), max_read_block);
-	  int r = _do_read(c.get(), o, offset, l, bl,
-	    CEPH_OSD_OP_FLAG_FADVISE_NOCACHE);
-	  if (r < 0) {
-	    ++errors;
-	    derr << "fsck error: " << oid << std::hex
-	         << " error during read: "
-		 << " " << offset << "~" << l
-		 << " " << cpp_strerror(r) << std::dec
-		 << dendl;
-	    break;
-	  }
-	  offset += l;
-	} while (offset < o->onode.size);
+      if (deep && readers.wq) {
+	readers.wait_for(readers.max_in_flight - 1);
+	{
+	  std::lock_guard l(readers.lock);
+	  ++readers.in_flight;
+	}
+	readers.wq->queue(new FunctionContext(
+	  [&readers, &read_object, c, o, oid](int) {
+	    int r;
+	    {
+	      RWLock::RLocker l(c->lock);
+	      r = read_object(c.get(), o, oid);
+	    }
+	    std::lock_guard l(readers.lock);
+	    readers.errors += r;
+	    --readers.in_flight;
+	    readers.cond.notify_all();
+	  }));
+      } else if (deep) {
+	errors += read_object(c.get(), o, oid);
       }
       // omap
       if (o->onode.has_omap()) {
@@ -7399,6 +8150,10 @@ int BlueStore::_fsck(bool deep, bool repair)
       }
       expected_statfs->add(onode_statfs);
     } // for (it->lower_bound(string()); it->valid(); it->next())
+    if (readers.wq) {
+      readers.wait_for(0);
+      errors += readers.errors;
+    }
   } // if (it)
 
   dout(1) << __func__ << " checking shared_blobs" << dendl;
@@ -8311,6 +9066,8 @@ void BlueStore::_update_cache_logger()
   logger->set(l_bluestore_blobs, num_blobs);
   logger->set(l_bluestore_buffers, num_buffers);
   logger->set(l_bluestore_buffer_bytes, num_buffer_bytes);
+  logger->set(l_bluestore_decompressed_cache_bytes,
+	      decompressed_blobs.get_bytes());
 }
 
 // ---------------
@@ -8443,7 +9200,7 @@ int BlueStore::read(
     if (offset == length && offset == 0)
       length = o->onode.size;
 
-    r = _do_read(c, o, offset, length, bl, op_flags);
+    r = _do_read(c, o, offset, length, bl, op_flags, 0, true);
     if (r == -EIO) {
       logger->inc(l_bluestore_read_eio);
     }
@@ -8468,6 +9225,108 @@ int BlueStore::read(
   return r;
 }
 
+int BlueStore::_csum_digest(
+  OnodeRef o,
+  uint64_t offset,
+  uint64_t length,
+  uint32_t *crc)
+{
+  // Each crc32c csum item is crc32c(-1, chunk).  Since crc32c is linear,
+  // crc32c(v, chunk) == item ^ crc32c(v ^ -1, zeros), so the digest of
+  // the range follows from the stored items, with holes reading as zeros.
+  uint32_t v = *crc;
+  uint64_t pos = offset;
+  uint64_t end = offset + length;
+  auto lp = o->extent_map.seek_lextent(offset);
+  while (pos < end) {
+    if (lp == o->extent_map.extent_map.end() || lp->logical_offset >= end) {
+      v = ceph_crc32c(v, NULL, end - pos);
+      break;
+    }
+    if (lp->logical_offset > pos) {
+      v = ceph_crc32c(v, NULL, lp->logical_offset - pos);
+      pos = lp->logical_offset;
+    }
+    const bluestore_blob_t& blob = lp->blob->get_blob();
+    if (blob.is_compressed() ||
+	blob.csum_type != Checksummer::CSUM_CRC32C) {
+      return -EOPNOTSUPP;
+    }
+    uint64_t chunk_size = blob.get_csum_chunk_size();
+    uint64_t b_off = lp->blob_offset + (pos - lp->logical_offset);
+    uint64_t l = std::min<uint64_t>(lp->logical_end(), end) - pos;
+    // a partial chunk (usually the object's tail) covers bytes we don't
+    // want in the digest
+    if (b_off % chunk_size || l % chunk_size) {
+      return -EOPNOTSUPP;
+    }
+    for (uint64_t i = b_off / chunk_size; l > 0; ++i, l -= chunk_size) {
+      v = blob.get_csum_item(i) ^ ceph_crc32c(v ^ -1, NULL, chunk_size);
+    }
+    pos = std::min<uint64_t>(lp->logical_end(), end);
+    ++lp;
+  }
+  *crc = v;
+  return 0;
+}
+
+int BlueStore::data_digest(
+  CollectionHandle &c_,
+  const ghobject_t& oid,
+  uint64_t offset,
+  size_t length,
+  uint32_t *crc,
+  uint32_t op_flags)
+{
+  Collection *c = static_cast<Collection *>(c_.get());
+  dout(15) << __func__ << " " << c->get_cid() << " " << oid
+	   << " 0x" << std::hex << offset << "~" << length << std::dec
+	   << dendl;
+  if (!c->exists)
+    return -ENOENT;
+
+  int r;
+  {
+    RWLock::RLocker l(c->lock);
+    OnodeRef o = c->get_onode(oid, false);
+    if (!o || !o->exists) {
+      return -ENOENT;
+    }
+    if (offset >= o->onode.size) {
+      return 0;
+    }
+    length = std::min<uint64_t>(length, o->onode.size - offset);
+    o->extent_map.fault_range(db, offset, length);
+    uint32_t v = *crc;
+    r = _csum_digest(o, offset, length, &v);
+    if (r < 0) {
+      dout(20) << __func__ << " " << oid << " can't use stored csums" << dendl;
+      return r;
+    }
+
+    // still read the range back so that _do_read checks it against the
+    // very same csums on the device; only the data's own crc is skipped
+    bufferlist bl;
+    r = _do_read(c, o, offset, length, bl, op_flags, 0, true);
+    if (r == -EIO) {
+      logger->inc(l_bluestore_read_eio);
+    }
+    if (r >= 0) {
+      ceph_assert((uint64_t)r == length);
+      *crc = v;
+    }
+  }
+  if (r >= 0 && _debug_data_eio(oid)) {
+    r = -EIO;
+    derr << __func__ << " " << c->cid << " " << oid << " INJECT EIO" << dendl;
+  }
+  dout(10) << __func__ << " " << c->get_cid() << " " << oid
+	   << " 0x" << std::hex << offset << "~" << length
+	   << " = " << std::dec << r << " crc 0x" << std::hex << *crc
+	   << std::dec << dendl;
+  return r;
+}
+
 // --------------------------------------------------------
 // intermediate data structures used while reading
 struct region_t {
@@ -8522,7 +9381,8 @@ int BlueStore::_do_read(
   size_t length,
   bufferlist& bl,
   uint32_t op_flags,
-  uint64_t retry_count)
+  uint64_t retry_count,
+  bool partial_fault)
 {
   FUNCTRACE(cct);
   int r = 0;
@@ -8554,8 +9414,25 @@ int BlueStore::_do_read(
     length = o->onode.size - offset;
   }
 
+  if (o->onode.has_inline_data()) {
+    uint64_t inline_len = o->onode.inline_data.length();
+    if (offset < inline_len) {
+      bl.substr_of(o->onode.inline_data, offset,
+		   std::min<uint64_t>(length, inline_len - offset));
+    }
+    bl.append_zero(length - bl.length());
+    dout(20) << __func__ << " 0x" << std::hex << offset << "~" << length
+	     << " from 0x" << inline_len << std::dec << " inline bytes"
+	     << dendl;
+    return bl.length();
+  }
+
   auto start = mono_clock::now();
-  o->extent_map.fault_range(db, offset, length);
+  if (partial_fault) {
+    o->extent_map.fault_range_for_read(db, offset, length);
+  } else {
+    o->extent_map.fault_range(db, offset, length);
+  }
   LOG_LATENCY(logger, cct, __func__,
     l_bluestore_read_onode_meta_lat, mono_clock::now() - start);
   _dump_onode<30>(cct, *o);
@@ -8665,6 +9542,8 @@ int BlueStore::_do_read(
                              // measure the whole block below.
                              // The error isn't that much...
   vector<bufferlist> compressed_blob_bls;
+  // set where compressed_blob_bls already holds the decompressed data
+  vector<bool> compressed_blob_cached;
   IOContext ioc(cct, NULL, true); // allow EIO
   for (auto& p : blobs2read) {
     const BlobRef& bptr = p.first;
@@ -8679,6 +9558,14 @@ int BlueStore::_do_read(
       }
       compressed_blob_bls.push_back(bufferlist());
       bufferlist& bl = compressed_blob_bls.back();
+      if (decompressed_blobs.lookup(bptr->get_blob(), &bl)) {
+	dout(20) << __func__ << "    decompressed cache hit" << dendl;
+	logger->inc(l_bluestore_decompressed_cache_hits);
+	compressed_blob_cached.push_back(true);
+	continue;
+      }
+      logger->inc(l_bluestore_decompressed_cache_misses);
+      compressed_blob_cached.push_back(false);
       r = bptr->get_blob().map(
 	0, bptr->get_blob().get_ondisk_length(),
 	[&](uint64_t offset, uint64_t length) {
@@ -8760,6 +9647,7 @@ int BlueStore::_do_read(
 
   // enumerate and decompress desired blobs
   auto p = compressed_blob_bls.begin();
+  auto cached = compressed_blob_cached.begin();
   blobs2read_t::iterator b2r_it = blobs2read.begin();
   while (b2r_it != blobs2read.end()) {
     const BlobRef& bptr = b2r_it->first;
@@ -8769,25 +9657,36 @@ int BlueStore::_do_read(
     if (bptr->get_blob().is_compressed()) {
       ceph_assert(p != compressed_blob_bls.end());
       bufferlist& compressed_bl = *p++;
-      if (_verify_csum(o, &bptr->get_blob(), 0, compressed_bl,
-        	       r2r.front().regs.front().logical_offset) < 0) {
-        // Handles spurious read errors caused by a kernel bug.
-        // We sometimes get all-zero pages as a result of the read under
-        // high memory pressure. Retrying the failing read succeeds in most 
-        // cases.
-        // See also: http://tracker.ceph.com/issues/22464
-        if (retry_count >= cct->_conf->bluestore_retry_disk_reads) {
-          return -EIO;
-        }
-        return _do_read(c, o, offset, length, bl, op_flags, retry_count + 1);
-      }
       bufferlist raw_bl;
-      r = _decompress(compressed_bl, &raw_bl);
-      if (r < 0)
-	return r;
-      if (buffered) {
-	bptr->shared_blob->bc.did_read(bptr->shared_blob->get_cache(), 0,
-				       raw_bl);
+      if (*cached++) {
+	raw_bl.claim(compressed_bl);
+      } else {
+	if (_verify_csum(o, &bptr->get_blob(), 0, compressed_bl,
+			 r2r.front().regs.front().logical_offset) < 0) {
+	  // Handles spurious read errors caused by a kernel bug.
+	  // We sometimes get all-zero pages as a result of the read under
+	  // high memory pressure. Retrying the failing read succeeds in most 
+	  // cases.
+	  // See also: http://tracker.ceph.com/issues/22464
+	  if (retry_count >= cct->_conf->bluestore_retry_disk_reads) {
+	    return -EIO;
+	  }
+	  return _do_read(c, o, offset, length, bl, op_flags, retry_count + 1,
+			   partial_fault);
+	}
+	r = _decompress(compressed_bl, &raw_bl);
+	if (r < 0)
+	  return r;
+	if (buffered) {
+	  // keep one copy of the whole blob rather than a buffer per object
+	  // sharing it; fall back to the buffer cache if the tier is disabled
+	  if (decompressed_blobs.get_max_bytes()) {
+	    decompressed_blobs.insert(bptr->get_blob(), raw_bl);
+	  } else {
+	    bptr->shared_blob->bc.did_read(bptr->shared_blob->get_cache(), 0,
+					   raw_bl);
+	  }
+	}
       }
       for (auto& req : r2r) {
         for (auto& r : req.regs) {
@@ -8807,7 +9706,8 @@ int BlueStore::_do_read(
           if (retry_count >= cct->_conf->bluestore_retry_disk_reads) {
             return -EIO;
           }
-          return _do_read(c, o, offset, length, bl, op_flags, retry_count + 1);
+          return _do_read(c, o, offset, length, bl, op_flags, retry_count + 1,
+			 partial_fault);
 	}
 	if (buffered) {
 	  bptr->shared_blob->bc.did_read(bptr->shared_blob->get_cache(),
@@ -8975,6 +9875,14 @@ int BlueStore::_fiemap(
       length = o->onode.size - offset;
     }
 
+    if (o->onode.has_inline_data()) {
+      uint64_t inline_len = o->onode.inline_data.length();
+      if (offset < inline_len) {
+	destset.insert(offset, std::min<uint64_t>(length, inline_len - offset));
+      }
+      goto out;
+    }
+
     o->extent_map.fault_range(db, offset, length);
     eend = o->extent_map.extent_map.end();
     ep = o->extent_map.seek_lextent(offset);
@@ -9353,7 +10261,7 @@ int BlueStore::omap_get(
   {
     const string& prefix =
       o->onode.is_pgmeta_omap() ? PREFIX_PGMETA_OMAP : PREFIX_OMAP;
-    KeyValueDB::Iterator it = db->get_iterator(prefix);
+    KeyValueDB::Iterator it = get_omap_kv_iterator(db, prefix, o->onode.nid);
     string head, tail;
     get_omap_header(o->onode.nid, &head);
     get_omap_tail(o->onode.nid, &tail);
@@ -9441,7 +10349,7 @@ int BlueStore::omap_get_keys(
   {
     const string& prefix =
       o->onode.is_pgmeta_omap() ? PREFIX_PGMETA_OMAP : PREFIX_OMAP;
-    KeyValueDB::Iterator it = db->get_iterator(prefix);
+    KeyValueDB::Iterator it = get_omap_kv_iterator(db, prefix, o->onode.nid);
     string head, tail;
     get_omap_key(o->onode.nid, string(), &head);
     get_omap_tail(o->onode.nid, &tail);
@@ -9574,8 +10482,9 @@ ObjectMap::ObjectMapIterator BlueStore::get_omap_iterator(
   }
   o->flush();
   dout(10) << __func__ << " has_omap = " << (int)o->onode.has_omap() <<dendl;
-  KeyValueDB::Iterator it = db->get_iterator(
-    o->onode.is_pgmeta_omap() ? PREFIX_PGMETA_OMAP : PREFIX_OMAP);
+  KeyValueDB::Iterator it = get_omap_kv_iterator(
+    db, o->onode.is_pgmeta_omap() ? PREFIX_PGMETA_OMAP : PREFIX_OMAP,
+    o->onode.nid);
   return ObjectMap::ObjectMapIterator(new OmapIteratorImpl(c, o, it));
 }
 
@@ -10224,6 +11133,8 @@ void BlueStore::_txc_finish(TransContext *txc)
 void BlueStore::_txc_release_alloc(TransContext *txc)
 {
   // it's expected we're called with lazy_release_lock already taken!
+  // drop decompressed copies before the space can be handed out again
+  decompressed_blobs.invalidate(txc->released);
   if (likely(!cct->_conf->bluestore_debug_no_reuse_blocks)) {
     int r = 0;
     if (cct->_conf->bdev_enable_discard && cct->_conf->bdev_async_discard) {
@@ -10401,6 +11312,16 @@ void BlueStore::_kv_start()
   finisher.start();
   kv_sync_thread.create("bstore_kv_sync");
   kv_finalize_thread.create("bstore_kv_final");
+
+  auto compress_threads =
+    cct->_conf.get_val<uint64_t>("bluestore_compression_threads");
+  if (compress_threads) {
+    compress_tp = std::make_unique<ThreadPool>(
+      cct, "BlueStore::compress_tp", "bstore_compress", compress_threads);
+    compress_wq = std::make_unique<ContextWQ>(
+      "BlueStore::compress_wq", 0, compress_tp.get());
+    compress_tp->start();
+  }
 }
 
 void BlueStore::_kv_stop()
@@ -10424,6 +11345,11 @@ void BlueStore::_kv_stop()
   }
   kv_sync_thread.join();
   kv_finalize_thread.join();
+  if (compress_tp) {
+    compress_tp->stop();
+    compress_wq.reset();
+    compress_tp.reset();
+  }
   ceph_assert(removed_collections.empty());
   {
     std::lock_guard l(kv_lock);
@@ -10803,6 +11729,20 @@ void BlueStore::deferred_try_submit()
   for (auto& osr : deferred_queue) {
     osrs.push_back(&osr);
   }
+  if (cct->_conf->bluestore_deferred_aggregate && bdev->is_rotational()) {
+    vector<OpSequencer*> ready;
+    for (auto& osr : osrs) {
+      if (osr->deferred_pending && !osr->deferred_running) {
+	ready.push_back(osr.get());
+      }
+    }
+    if (ready.size() > 1) {
+      if (_deferred_submit_aggregate_unlock(ready)) {
+	deferred_lock.lock();
+	return;
+      }
+    }
+  }
   for (auto& osr : osrs) {
     if (osr->deferred_pending) {
       if (!osr->deferred_running) {
@@ -10875,6 +11815,88 @@ void BlueStore::_deferred_submit_unlock(OpSequencer *osr)
   bdev->aio_submit(&b->ioc);
 }
 
+bool BlueStore::_deferred_submit_aggregate_unlock(vector<OpSequencer*>& osrs)
+{
+  // sort every pending io by device offset.  batches of different
+  // sequencers are not ordered against each other, so if any two of them
+  // overlap keep the per-osr submission and leave deferred_lock held.
+  map<uint64_t, DeferredBatch::deferred_io*> ios;
+  for (auto osr : osrs) {
+    for (auto& i : osr->deferred_pending->iomap) {
+      auto r = ios.emplace(i.first, &i.second);
+      if (!r.second) {
+	dout(20) << __func__ << " overlap at 0x" << std::hex << i.first
+		 << std::dec << ", not aggregating" << dendl;
+	return false;
+      }
+    }
+  }
+  uint64_t end = 0;
+  for (auto& i : ios) {
+    if (i.first < end) {
+      dout(20) << __func__ << " overlap at 0x" << std::hex << i.first
+	       << std::dec << ", not aggregating" << dendl;
+      return false;
+    }
+    end = i.first + i.second->bl.length();
+  }
+
+  dout(10) << __func__ << " " << osrs.size() << " osrs, "
+	   << ios.size() << " ios pending" << dendl;
+  auto agg = new DeferredAggregate(cct);
+  agg->osrs = osrs;
+  for (auto osr : osrs) {
+    deferred_queue_size -= osr->deferred_pending->seq_bytes.size();
+    osr->deferred_running = osr->deferred_pending;
+    osr->deferred_pending = nullptr;
+  }
+  ceph_assert(deferred_queue_size >= 0);
+
+  deferred_lock.unlock();
+
+  for (auto osr : osrs) {
+    for (auto& txc : osr->deferred_running->txcs) {
+      txc.log_state_latency(logger, l_bluestore_state_deferred_queued_lat);
+    }
+  }
+  uint64_t start = 0, pos = 0;
+  bufferlist bl;
+  auto i = ios.begin();
+  while (true) {
+    if (i == ios.end() || i->first != pos) {
+      if (bl.length()) {
+	dout(20) << __func__ << " write 0x" << std::hex
+		 << start << "~" << bl.length()
+		 << " crc " << bl.crc32c(-1) << std::dec << dendl;
+	if (!g_conf()->bluestore_debug_omit_block_device_write) {
+	  logger->inc(l_bluestore_deferred_write_ops);
+	  logger->inc(l_bluestore_deferred_write_bytes, bl.length());
+	  int r = bdev->aio_write(start, bl, &agg->ioc, false);
+	  ceph_assert(r == 0);
+	}
+      }
+      if (i == ios.end()) {
+	break;
+      }
+      start = 0;
+      pos = i->first;
+      bl.clear();
+    }
+    dout(20) << __func__ << "   seq " << i->second->seq << " 0x"
+	     << std::hex << pos << "~" << i->second->bl.length() << std::dec
+	     << dendl;
+    if (!bl.length()) {
+      start = pos;
+    }
+    pos += i->second->bl.length();
+    bl.claim_append(i->second->bl);
+    ++i;
+  }
+
+  bdev->aio_submit(&agg->ioc);
+  return true;
+}
+
 struct C_DeferredTrySubmit : public Context {
   BlueStore *store;
   C_DeferredTrySubmit(BlueStore *s) : store(s) {}
@@ -11008,6 +12030,11 @@ int BlueStore::queue_transactions(
   // prepare
   TransContext *txc = _txc_create(static_cast<Collection*>(ch.get()), osr,
 				  &on_commit);
+  const uint64_t op_events_sample = cct->_conf->bluestore_op_events_sample;
+  if (op && op_events_sample &&
+      op_events_seq++ % op_events_sample == 0) {
+    txc->op = op;
+  }
 
   for (vector<Transaction>::iterator p = tls.begin(); p != tls.end(); ++p) {
     txc->bytes += (*p).get_num_bytes();
@@ -11978,6 +13005,57 @@ void BlueStore::_do_write_big(
   }
 }
 
+void BlueStore::_do_compress_blobs(
+  CompressorRef c,
+  WriteContext *wctx,
+  vector<bufferlist> *compressed,
+  vector<int> *compress_r)
+{
+  vector<size_t> todo;
+  for (size_t i = 0; i < wctx->writes.size(); ++i) {
+    auto& wi = wctx->writes[i];
+    if (wi.blob_length > min_alloc_size) {
+      ceph_assert(wi.b_off == 0);
+      ceph_assert(wi.blob_length == wi.bl.length());
+      todo.push_back(i);
+    }
+  }
+
+  auto compress_one = [&](size_t i) {
+    auto start = mono_clock::now();
+    // FIXME: memory alignment here is bad
+    (*compress_r)[i] = c->compress(wctx->writes[i].bl, (*compressed)[i]);
+    LOG_LATENCY(logger, cct, "compress@_do_alloc_write",
+      l_bluestore_compress_lat,
+      mono_clock::now() - start);
+  };
+
+  if (!compress_wq || todo.size() < 2) {
+    for (auto i : todo) {
+      compress_one(i);
+    }
+    return;
+  }
+
+  // hand all but the last blob to the pool and do that one ourselves
+  ceph::mutex lock = ceph::make_mutex("BlueStore::_do_compress_blobs");
+  ceph::condition_variable cond;
+  size_t pending = todo.size() - 1;
+  for (size_t j = 0; j < todo.size() - 1; ++j) {
+    compress_wq->queue(new FunctionContext(
+      [&, i = todo[j]](int) {
+	compress_one(i);
+	std::lock_guard l(lock);
+	if (--pending == 0) {
+	  cond.notify_all();
+	}
+      }));
+  }
+  compress_one(todo.back());
+  std::unique_lock l(lock);
+  cond.wait(l, [&] { return pending == 0; });
+}
+
 int BlueStore::_do_alloc_write(
   TransContext *txc,
   CollectionRef coll,
@@ -12044,19 +13122,20 @@ int BlueStore::_do_alloc_write(
   );
 
   // compress (as needed) and calc needed space
+  vector<bufferlist> compressed;
+  vector<int> compress_r;
+  if (c) {
+    compressed.resize(wctx->writes.size());
+    compress_r.resize(wctx->writes.size(), 0);
+    _do_compress_blobs(c, wctx, &compressed, &compress_r);
+  }
   uint64_t need = 0;
   auto max_bsize = std::max(wctx->target_blob_size, min_alloc_size);
-  for (auto& wi : wctx->writes) {
+  for (size_t i = 0; i < wctx->writes.size(); ++i) {
+    auto& wi = wctx->writes[i];
     if (c && wi.blob_length > min_alloc_size) {
-      auto start = mono_clock::now();
-
-      // compress
-      ceph_assert(wi.b_off == 0);
-      ceph_assert(wi.blob_length == wi.bl.length());
-
-      // FIXME: memory alignment here is bad
-      bufferlist t;
-      int r = c->compress(wi.bl, t);
+      bufferlist& t = compressed[i];
+      int r = compress_r[i];
       uint64_t want_len_raw = wi.blob_length * crr;
       uint64_t want_len = p2roundup(want_len_raw, min_alloc_size);
       bool rejected = false;
@@ -12116,9 +13195,6 @@ int BlueStore::_do_alloc_write(
 	logger->inc(l_bluestore_compress_rejected_count);
 	need += wi.blob_length;
       }
-      LOG_LATENCY(logger, cct, "compress@_do_alloc_write",
-	l_bluestore_compress_lat,
-        mono_clock::now() - start);
     } else {
       need += wi.blob_length;
     }
@@ -12280,6 +13356,19 @@ void BlueStore::_wctx_finish(
   WriteContext *wctx,
   set<SharedBlob*> *maybe_unshared_blobs)
 {
+  // an overwrite of a cloned object usually releases extents of several
+  // shared blobs; fetch their ref maps together instead of one at a time
+  {
+    vector<SharedBlobRef> sbs;
+    for (auto& lo : wctx->old_extents) {
+      if (!lo.r.empty() && lo.e.blob->get_blob().is_shared() &&
+	  !lo.e.blob->shared_blob->is_loaded()) {
+	sbs.push_back(lo.e.blob->shared_blob);
+      }
+    }
+    c->load_shared_blobs(sbs);
+  }
+
   auto oep = wctx->old_extents.begin();
   while (oep != wctx->old_extents.end()) {
     auto &lo = *oep;
@@ -12547,6 +13636,70 @@ int BlueStore::_do_gc(
   return 0;
 }
 
+void BlueStore::_account_inline_data(TransContext *txc, int64_t delta)
+{
+  // the bytes live in the key/value store, but they are the object's data
+  // all the same, so the pool and the OSD are charged for them as if they
+  // had been allocated
+  txc->statfs_delta.allocated() += delta;
+  txc->statfs_delta.stored() += delta;
+}
+
+bool BlueStore::_can_inline_data(OnodeRef& o, uint64_t end)
+{
+  if (end > cct->_conf->bluestore_inline_data_max) {
+    return false;
+  }
+  // without shards the whole extent map is loaded with the onode
+  return o->onode.has_inline_data() ||
+    (o->onode.extent_map_shards.empty() &&
+     o->extent_map.extent_map.empty() &&
+     o->extent_map.spanning_blob_map.empty());
+}
+
+void BlueStore::_do_write_inline(TransContext *txc, OnodeRef& o,
+				 uint64_t offset, const bufferlist& bl)
+{
+  auto& inline_data = o->onode.inline_data;
+  uint64_t end = offset + bl.length();
+  uint64_t inline_len = inline_data.length();
+  uint64_t new_len = std::max(inline_len, end);
+  dout(20) << __func__ << " 0x" << std::hex << offset << "~" << bl.length()
+	   << " into 0x" << inline_len << " inline bytes" << std::dec << dendl;
+
+  bufferptr p = buffer::create_in_mempool(
+    new_len, mempool::mempool_bluestore_cache_other);
+  inline_data.begin().copy(inline_len, p.c_str());
+  if (new_len > inline_len) {
+    p.zero(inline_len, new_len - inline_len);
+  }
+  bl.begin().copy(bl.length(), p.c_str() + offset);
+  inline_data.clear();
+  inline_data.append(std::move(p));
+  o->onode.set_flag(bluestore_onode_t::FLAG_INLINE_DATA);
+  _account_inline_data(txc, new_len - inline_len);
+  if (end > o->onode.size) {
+    o->onode.size = end;
+  }
+  logger->inc(l_bluestore_write_inline);
+}
+
+int BlueStore::_uninline_data(TransContext *txc, CollectionRef& c,
+			      OnodeRef& o)
+{
+  if (!o->onode.has_inline_data()) {
+    return 0;
+  }
+  dout(20) << __func__ << " " << o->oid << " moving 0x" << std::hex
+	   << o->onode.inline_data.length() << std::dec
+	   << " inline bytes to extents" << dendl;
+  bufferlist bl;
+  bl.swap(o->onode.inline_data);
+  o->onode.clear_flag(bluestore_onode_t::FLAG_INLINE_DATA);
+  _account_inline_data(txc, -(int64_t)bl.length());
+  return _do_write(txc, c, o, 0, bl.length(), bl, 0, false);
+}
+
 int BlueStore::_do_write(
   TransContext *txc,
   CollectionRef& c,
@@ -12554,7 +13707,8 @@ int BlueStore::_do_write(
   uint64_t offset,
   uint64_t length,
   bufferlist& bl,
-  uint32_t fadvise_flags)
+  uint32_t fadvise_flags,
+  bool may_inline)
 {
   int r = 0;
 
@@ -12574,6 +13728,15 @@ int BlueStore::_do_write(
 
   uint64_t end = offset + length;
 
+  if (may_inline && _can_inline_data(o, end)) {
+    _do_write_inline(txc, o, offset, bl);
+    return 0;
+  }
+  r = _uninline_data(txc, c, o);
+  if (r < 0) {
+    return r;
+  }
+
   GarbageCollector gc(c->store->cct);
   int64_t benefit = 0;
   auto dirty_start = offset;
@@ -12695,6 +13858,20 @@ int BlueStore::_do_zero(TransContext *txc,
 
   _dump_onode<30>(cct, *o);
 
+  if (o->onode.has_inline_data() && length > 0) {
+    if (_can_inline_data(o, offset + length)) {
+      bufferlist zeros;
+      zeros.append_zero(length);
+      _do_write_inline(txc, o, offset, zeros);
+      txc->write_onode(o);
+      return 0;
+    }
+    r = _uninline_data(txc, c, o);
+    if (r < 0) {
+      return r;
+    }
+  }
+
   WriteContext wctx;
   o->extent_map.fault_range(db, offset, length);
   o->extent_map.punch_hole(c, offset, length, &wctx.old_extents);
@@ -12726,7 +13903,19 @@ void BlueStore::_do_truncate(
   if (offset == o->onode.size)
     return;
 
-  if (offset < o->onode.size) {
+  if (o->onode.has_inline_data()) {
+    auto& inline_data = o->onode.inline_data;
+    if (offset == 0) {
+      _account_inline_data(txc, -(int64_t)inline_data.length());
+      inline_data.clear();
+      o->onode.clear_flag(bluestore_onode_t::FLAG_INLINE_DATA);
+    } else if (offset < inline_data.length()) {
+      _account_inline_data(txc, (int64_t)offset - inline_data.length());
+      bufferlist t;
+      t.substr_of(inline_data, 0, offset);
+      inline_data.swap(t);
+    }
+  } else if (offset < o->onode.size) {
     WriteContext wctx;
     uint64_t length = o->onode.size - offset;
     o->extent_map.fault_range(db, offset, length);
@@ -13186,7 +14375,9 @@ int BlueStore::_clone(TransContext *txc,
   oldo->flush();
   _do_truncate(txc, c, newo, 0);
   if (cct->_conf->bluestore_clone_cow) {
-    _do_clone_range(txc, c, oldo, newo, 0, oldo->onode.size, 0);
+    r = _do_clone_range(txc, c, oldo, newo, 0, oldo->onode.size, 0);
+    if (r < 0)
+      goto out;
   } else {
     bufferlist bl;
     r = _do_read(c.get(), oldo, 0, oldo->onode.size, bl, 0);
@@ -13219,7 +14410,8 @@ int BlueStore::_clone(TransContext *txc,
     }
     const string& prefix =
       newo->onode.is_pgmeta_omap() ? PREFIX_PGMETA_OMAP : PREFIX_OMAP;
-    KeyValueDB::Iterator it = db->get_iterator(prefix);
+    KeyValueDB::Iterator it =
+      get_omap_kv_iterator(db, prefix, oldo->onode.nid);
     string head, tail;
     get_omap_header(oldo->onode.nid, &head);
     get_omap_tail(oldo->onode.nid, &tail);
@@ -13265,6 +14457,16 @@ int BlueStore::_do_clone_range(
 	   << " 0x" << dstoff << "~" << length << std::dec << dendl;
   oldo->extent_map.fault_range(db, srcoff, length);
   newo->extent_map.fault_range(db, dstoff, length);
+  if (oldo->onode.has_inline_data() || newo->onode.has_inline_data()) {
+    // there are no extents to share; copy the data instead
+    bufferlist bl;
+    int r = _do_read(c.get(), oldo, srcoff, length, bl, 0);
+    if (r < 0) {
+      return r;
+    }
+    return _do_write(txc, c, newo, dstoff, bl.length(), bl, 0);
+  }
+
   _dump_onode<30>(cct, *oldo);
   _dump_onode<30>(cct, *newo);
 
@@ -13299,8 +14501,12 @@ int BlueStore::_clone_range(TransContext *txc,
 
   if (length > 0) {
     if (cct->_conf->bluestore_clone_cow) {
-      _do_zero(txc, c, newo, dstoff, length);
-      _do_clone_range(txc, c, oldo, newo, srcoff, length, dstoff);
+      r = _do_zero(txc, c, newo, dstoff, length);
+      if (r < 0)
+	goto out;
+      r = _do_clone_range(txc, c, oldo, newo, srcoff, length, dstoff);
+      if (r < 0)
+	goto out;
     } else {
       bufferlist bl;
       r = _do_read(c.get(), oldo, srcoff, length, bl, 0);
@@ -13790,6 +14996,7 @@ void BlueStore::_flush_cache()
     i->trim_all();
     ceph_assert(i->empty());
   }
+  decompressed_blobs.clear();
   for (auto& p : coll_map) {
     if (!p.second->onode_map.empty()) {
       derr << __func__ << " stray onodes on " << p.first << dendl;
@@ -33,8 +33,10 @@
 #include "include/unordered_map.h"
 #include "include/mempool.h"
 #include "common/bloom_filter.hpp"
+#include "common/config_cacher.h"
 #include "common/Finisher.h"
 #include "common/Throttle.h"
+#include "common/WorkQueue.h"
 #include "common/perf_counters.h"
 #include "common/PriorityCache.h"
 #include "compressor/Compressor.h"
@@ -106,6 +108,9 @@ enum {
   l_bluestore_buffer_bytes,
   l_bluestore_buffer_hit_bytes,
   l_bluestore_buffer_miss_bytes,
+  l_bluestore_decompressed_cache_bytes,
+  l_bluestore_decompressed_cache_hits,
+  l_bluestore_decompressed_cache_misses,
   l_bluestore_write_big,
   l_bluestore_write_big_bytes,
   l_bluestore_write_big_blobs,
@@ -115,11 +120,14 @@ enum {
   l_bluestore_write_small_deferred,
   l_bluestore_write_small_pre_read,
   l_bluestore_write_small_new,
+  l_bluestore_write_inline,
   l_bluestore_txc,
   l_bluestore_onode_reshard,
   l_bluestore_blob_split,
   l_bluestore_extent_compress,
   l_bluestore_gc_merged,
+  l_bluestore_shared_blob_batch_loads,
+  l_bluestore_shared_blob_batch_loaded,
   l_bluestore_read_eio,
   l_bluestore_reads_with_retries,
   l_bluestore_fragmentation,
@@ -132,6 +140,15 @@ enum {
 
 #define META_POOL_ID ((uint64_t)-1ull)
 
+/// options read on the omap and bluefs balancing paths
+struct bluestore_hot_conf_t {
+  uint64_t omap_readahead;
+  uint64_t bluefs_min_free;
+
+  explicit bluestore_hot_conf_t(const ConfigProxy& conf);
+  static const char** get_tracked_conf_keys();
+};
+
 class BlueStore : public ObjectStore,
 		  public BlueFSDeviceExpander,
 		  public md_config_obs_t {
@@ -342,6 +359,7 @@ public:
 
     void write(Cache* cache, uint64_t seq, uint32_t offset, bufferlist& bl,
 	       unsigned flags) {
+      cache->buffer_demand += bl.length();
       std::lock_guard l(cache->lock);
       Buffer *b = new Buffer(this, Buffer::STATE_WRITING, seq, offset, bl,
 			     flags);
@@ -350,6 +368,7 @@ public:
     }
     void _finish_write(Cache* cache, uint64_t seq);
     void did_read(Cache* cache, uint32_t offset, bufferlist& bl) {
+      cache->buffer_demand += bl.length();
       std::lock_guard l(cache->lock);
       Buffer *b = new Buffer(this, Buffer::STATE_CLEAN, 0, offset, bl);
       b->cache_private = _discard(cache, offset, bl.length());
@@ -768,13 +787,32 @@ public:
     blob_map_t spanning_blob_map;   ///< blobs that span shards
     typedef boost::intrusive_ptr<Onode> OnodeRef;
 
+    /// compact index over an encoded shard (the kv buffer is kept, not
+    /// copied), so reads can materialize just the lextents they touch
+    struct ShardView {
+      struct entry_t {
+	uint32_t logical_offset;
+	uint32_t blob_offset;
+	uint32_t length;
+	int32_t blob;        ///< >= 0: local blob index, < 0: ~spanning blob id
+      };
+      bufferlist bl;         ///< encoded shard
+      __u8 struct_v = 0;
+      mempool::bluestore_cache_other::vector<entry_t> entries;
+      mempool::bluestore_cache_other::vector<uint32_t> blob_pos; ///< blob encoding offsets
+      mempool::bluestore_cache_other::vector<BlobRef> blobs;     ///< blobs decoded so far
+      mempool::bluestore_cache_other::vector<bool> decoded;      ///< entry is in extent_map
+    };
+
     struct Shard {
       bluestore_onode_t::shard_info *shard_info = nullptr;
       unsigned extents = 0;  ///< count extents in this shard
       bool loaded = false;   ///< true if shard is loaded
       bool dirty = false;    ///< true if shard is dirty and needs reencoding
+      std::shared_ptr<ShardView> view; ///< set if shard is partially decoded
     };
     mempool::bluestore_cache_other::vector<Shard> shards;    ///< shards
+    unsigned num_shard_views = 0; ///< shards with a view
 
     bufferlist inline_bl;    ///< cached encoded map, if unsharded; empty=>dirty
 
@@ -811,6 +849,7 @@ public:
     void clear() {
       extent_map.clear_and_dispose(DeleteDisposer());
       shards.clear();
+      num_shard_views = 0;
       inline_bl.clear();
       clear_needs_reshard();
     }
@@ -884,6 +923,21 @@ public:
     void fault_range(KeyValueDB *db,
 		     uint32_t offset, uint32_t length);
 
+    /// ensure the lextents overlapping a range are present, possibly
+    /// without loading whole shards.  read-only users only: the blobs of
+    /// partially decoded shards carry incomplete ref_maps.
+    void fault_range_for_read(KeyValueDB *db,
+			      uint32_t offset, uint32_t length);
+
+    /// fetch the encoded shard from the kv store
+    void read_shard(KeyValueDB *db, Shard *p, bufferlist *v);
+    /// build the index of an encoded shard
+    void index_shard(Shard *p, bufferlist& bl);
+    /// add the indexed lextents overlapping a range to extent_map
+    void materialize_range(Shard *p, uint32_t offset, uint32_t length);
+    /// drop all partially decoded lextents and views outside a shard range
+    void drop_shard_views(int keep_start, int keep_last);
+
     /// ensure a range of the map is marked dirty
     void dirty_range(uint32_t offset, uint32_t length);
 
@@ -1095,6 +1149,11 @@ public:
     std::atomic<uint64_t> num_extents = {0};
     std::atomic<uint64_t> num_blobs = {0};
 
+    /// onode lookups and buffer bytes read/written since the last cache
+    /// balancing pass; used to weight the per-shard trim targets
+    std::atomic<uint64_t> onode_demand = {0};
+    std::atomic<uint64_t> buffer_demand = {0};
+
     std::array<std::pair<ghobject_t, mono_clock::time_point>, 64> dumped_onodes;
 
     static Cache *create(CephContext* cct, string type, PerfCounters *logger);
@@ -1409,6 +1468,8 @@ public:
     //  loaded = SharedBlob::shared_blob_t is loaded from kv store
     void open_shared_blob(uint64_t sbid, BlobRef b);
     void load_shared_blob(SharedBlobRef sb);
+    /// load the ones not loaded yet with a single kv lookup
+    void load_shared_blobs(const vector<SharedBlobRef>& sbs);
     void make_blob_shared(uint64_t sbid, BlobRef b);
     uint64_t make_blob_unshared(SharedBlob *sb);
 
@@ -1443,6 +1504,7 @@ public:
     OnodeRef o;
     KeyValueDB::Iterator it;
     string head, tail;
+    bool readahead = false;  ///< it was reopened for a bulk scan
 
     string _stringify() const;
 
@@ -1455,11 +1517,52 @@ public:
     int next() override;
     string key() override;
     bufferlist value() override;
+    int next_batch(const string &end, size_t max, size_t max_bytes,
+		   kv_batch_t *batch) override;
     int status() override {
       return 0;
     }
   };
 
+  /// Decompressed contents of recently read compressed blobs.
+  ///
+  /// Entries are keyed by the blob's first physical offset.  Compressed
+  /// blobs are never written in place and their space is only released
+  /// as a whole, so an entry stays valid until _txc_release_alloc()
+  /// invalidates it.  Sized by the MempoolThread like the other caches.
+  class DecompressedBlobCache {
+    struct entry_t {
+      uint32_t ondisk_length = 0;
+      bufferlist data;
+      std::list<uint64_t>::iterator lru_pos;
+    };
+    ceph::mutex lock = ceph::make_mutex("BlueStore::DecompressedBlobCache::lock");
+    std::map<uint64_t, entry_t> entries;
+    std::list<uint64_t> lru;          ///< most recently used first
+    std::atomic<uint64_t> bytes = {0};
+    std::atomic<uint64_t> max_bytes = {0};
+
+    void _erase(std::map<uint64_t, entry_t>::iterator p);
+    void _trim(uint64_t target);
+  public:
+    bool lookup(const bluestore_blob_t& blob, bufferlist *out);
+    void insert(const bluestore_blob_t& blob, const bufferlist& data);
+    void invalidate(const interval_set<uint64_t>& released);
+    /// set the target size and trim down to it
+    void trim(uint64_t target);
+    void clear();
+    uint64_t get_bytes() const {
+      return bytes;
+    }
+    uint64_t get_max_bytes() const {
+      return max_bytes;
+    }
+    size_t get_num_entries() {
+      std::lock_guard l(lock);
+      return entries.size();
+    }
+  };
+
   struct volatile_statfs{
     enum {
       STATFS_ALLOCATED = 0,
@@ -1586,7 +1689,6 @@ public:
       return "???";
     }
 
-#if defined(WITH_LTTNG) && defined(WITH_EVENTTRACE)
     const char *get_state_latency_name(int state) {
       switch (state) {
       case l_bluestore_state_prepare_lat: return "prepare";
@@ -1602,12 +1704,15 @@ public:
       }
       return "???";
     }
-#endif
 
     utime_t log_state_latency(PerfCounters *logger, int state) {
       utime_t lat, now = ceph_clock_now();
       lat = now - last_stamp;
       logger->tinc(state, lat);
+      if (op) {
+	op->mark_event(std::string("bluestore_") +
+		       get_state_latency_name(state), now);
+      }
 #if defined(WITH_LTTNG) && defined(WITH_EVENTTRACE)
       if (state >= l_bluestore_state_prepare_lat && state <= l_bluestore_state_done_lat) {
         double usecs = (now.to_nsec()-last_stamp.to_nsec())/1000;
@@ -1621,6 +1726,7 @@ public:
     CollectionRef ch;
     OpSequencerRef osr;  // this should be ch->osr
     boost::intrusive::list_member_hook<> sequencer_item;
+    TrackedOpRef op;  ///< sampled op to record our states on, if any
 
     uint64_t bytes = 0, cost = 0;
 
@@ -1725,6 +1831,22 @@ public:
     }
   };
 
+  /// deferred batches of several sequencers submitted as one io set
+  struct DeferredAggregate final : public AioContext {
+    vector<OpSequencer*> osrs;  ///< sequencers whose running batch is ours
+    IOContext ioc;
+
+    DeferredAggregate(CephContext *cct)
+      : ioc(cct, this) {}
+
+    void aio_finish(BlueStore *store) override {
+      for (auto osr : osrs) {
+	store->_deferred_aio_finish(osr);
+      }
+      delete this;
+    }
+  };
+
   class OpSequencer : public RefCountedObject {
   public:
     ceph::mutex qlock = ceph::make_mutex("BlueStore::OpSequencer::qlock");
@@ -1915,6 +2037,7 @@ private:
   map<coll_t,CollectionRef> new_coll_map;
 
   vector<Cache*> cache_shards;
+  DecompressedBlobCache decompressed_blobs;
 
   /// protect zombie_osr_set
   ceph::mutex zombie_osr_lock = ceph::make_mutex("BlueStore::zombie_osr_lock");
@@ -1924,6 +2047,7 @@ private:
   std::atomic<uint64_t> nid_max = {0};
   std::atomic<uint64_t> blobid_last = {0};
   std::atomic<uint64_t> blobid_max = {0};
+  std::atomic<uint64_t> op_events_seq = {0};  ///< for bluestore_op_events_sample
 
   Throttle throttle_bytes;          ///< submit to commit
   Throttle throttle_deferred_bytes;  ///< submit to deferred complete
@@ -1938,6 +2062,11 @@ private:
   atomic_int deferred_aggressive = {0}; ///< aggressive wakeup of kv thread
   Finisher deferred_finisher, finisher;
 
+  // compresses the blobs of a write in parallel, see
+  // bluestore_compression_threads
+  std::unique_ptr<ThreadPool> compress_tp;
+  std::unique_ptr<ContextWQ> compress_wq;
+
   KVSyncThread kv_sync_thread;
   ceph::mutex kv_lock = ceph::make_mutex("BlueStore::kv_lock");
   ceph::condition_variable kv_cond;
@@ -2006,6 +2135,7 @@ private:
   double cache_meta_ratio = 0;   ///< cache ratio dedicated to metadata
   double cache_kv_ratio = 0;     ///< cache ratio dedicated to kv (e.g., rocksdb)
   double cache_data_ratio = 0;   ///< cache ratio dedicated to object data
+  double cache_decompressed_ratio = 0; ///< cache ratio for decompressed blobs
   bool cache_autotune = false;   ///< cache autotune setting
   double cache_autotune_interval = 0; ///< time to wait between cache rebalancing
   uint64_t osd_memory_target = 0;   ///< OSD memory target when autotuning cache
@@ -2013,6 +2143,7 @@ private:
   double osd_memory_expected_fragmentation = 0; ///< expected memory fragmentation
   uint64_t osd_memory_cache_min = 0; ///< Min memory to assign when autotuning cache
   double osd_memory_cache_resize_interval = 0; ///< Time to wait between cache resizing 
+  md_config_snapshot_t<bluestore_hot_conf_t> hot_conf{cct->_conf};
 
   typedef map<uint64_t, volatile_statfs> osd_pools_map;
 
@@ -2033,6 +2164,10 @@ private:
     std::shared_ptr<PriorityCache::PriCache> binned_kv_cache = nullptr;
     std::shared_ptr<PriorityCache::Manager> pcm = nullptr;
 
+    /// decayed per-shard onode/buffer demand, see _trim_shards()
+    std::vector<double> shard_onode_weight;
+    std::vector<double> shard_buffer_weight;
+
     struct MempoolCache : public PriorityCache::PriCache {
       BlueStore *store;
       int64_t cache_bytes[PriorityCache::Priority::LAST+1] = {0};
@@ -2135,11 +2270,24 @@ private:
     };
     std::shared_ptr<DataCache> data_cache;
 
+    struct DecompressedCache : public MempoolCache {
+      DecompressedCache(BlueStore *s) : MempoolCache(s) {};
+
+      virtual uint64_t _get_used_bytes() const {
+        return store->decompressed_blobs.get_bytes();
+      }
+      virtual string get_cache_name() const {
+        return "BlueStore Decompressed Cache";
+      }
+    };
+    std::shared_ptr<DecompressedCache> decompressed_cache;
+
   public:
     explicit MempoolThread(BlueStore *s)
       : store(s),
         meta_cache(new MetaCache(s)),
-        data_cache(new DataCache(s)) {}
+        data_cache(new DataCache(s)),
+        decompressed_cache(new DecompressedCache(s)) {}
 
     void *entry() override;
     void init() {
@@ -2226,6 +2374,9 @@ private:
   void _close_fm();
   int _open_alloc();
   void _close_alloc();
+  int _load_alloc_snapshot(uint64_t *num, uint64_t *bytes);
+  void _write_alloc_snapshot();
+  void _remove_alloc_snapshot();
   int _open_collections(int *errors=0);
   void _close_collections();
 
@@ -2303,6 +2454,7 @@ public:
   void deferred_try_submit();
 private:
   void _deferred_submit_unlock(OpSequencer *osr);
+  bool _deferred_submit_aggregate_unlock(vector<OpSequencer*>& osrs);
   void _deferred_aio_finish(OpSequencer *osr);
   int _deferred_replay();
 
@@ -2516,6 +2668,18 @@ public:
     size_t len,
     bufferlist& bl,
     uint32_t op_flags = 0) override;
+  int data_digest(
+    CollectionHandle &c,
+    const ghobject_t& oid,
+    uint64_t offset,
+    size_t len,
+    uint32_t *crc,
+    uint32_t op_flags = 0) override;
+  int _csum_digest(
+    OnodeRef o,
+    uint64_t offset,
+    uint64_t length,
+    uint32_t *crc);
   int _do_read(
     Collection *c,
     OnodeRef o,
@@ -2523,7 +2687,8 @@ public:
     size_t len,
     bufferlist& bl,
     uint32_t op_flags = 0,
-    uint64_t retry_count = 0);
+    uint64_t retry_count = 0,
+    bool partial_fault = false);
 
 private:
   int _fiemap(CollectionHandle &c_, const ghobject_t& oid,
@@ -2859,6 +3024,11 @@ private:
     uint64_t offset, uint64_t length,
     bufferlist::iterator& blp,
     WriteContext *wctx);
+  void _do_compress_blobs(
+    CompressorRef c,
+    WriteContext *wctx,
+    vector<bufferlist> *compressed,
+    vector<int> *compress_r);
   int _do_alloc_write(
     TransContext *txc,
     CollectionRef c,
@@ -2892,12 +3062,18 @@ private:
              uint64_t *dirty_start,
              uint64_t *dirty_end);
 
+  bool _can_inline_data(OnodeRef& o, uint64_t end);
+  void _account_inline_data(TransContext *txc, int64_t delta);
+  void _do_write_inline(TransContext *txc, OnodeRef& o, uint64_t offset,
+			const bufferlist& bl);
+  int _uninline_data(TransContext *txc, CollectionRef& c, OnodeRef& o);
   int _do_write(TransContext *txc,
 		CollectionRef &c,
 		OnodeRef o,
 		uint64_t offset, uint64_t length,
 		bufferlist& bl,
-		uint32_t fadvise_flags);
+		uint32_t fadvise_flags,
+		bool may_inline = true);
   void _do_write_data(TransContext *txc,
                       CollectionRef& c,
                       OnodeRef o,
@@ -23,6 +23,7 @@
 #include "include/utime.h"
 
 #include "ceph_aio.h"
+#include "ceph_io_uring.h"
 #include "BlockDevice.h"
 
 #ifndef RW_IO_MAX
@@ -47,7 +48,7 @@ class KernelDevice : public BlockDevice {
   std::atomic<bool> io_since_flush = {false};
   ceph::mutex flush_mutex = ceph::make_mutex("KernelDevice::flush_mutex");
 
-  aio_queue_t aio_queue;
+  std::unique_ptr<io_queue_t> io_queue;
   aio_callback_t discard_callback;
   void *discard_callback_priv;
   bool aio_stop;
@@ -38,6 +38,7 @@
 #include "common/errno.h"
 #include "common/debug.h"
 #include "common/perf_counters.h"
+#include "common/strtol.h"
 
 #include "NVMEDevice.h"
 
@@ -46,7 +47,8 @@
 #undef dout_prefix
 #define dout_prefix *_dout << "bdev(" << sn << ") "
 
-thread_local SharedDriverQueueData *queue_t;
+// each thread submits to, and polls, its own qpair of every device it uses
+thread_local std::map<NVMEDevice*, SharedDriverQueueData*> queue_t;
 
 static constexpr uint16_t data_buffer_default_num = 1024;
 
@@ -59,6 +61,7 @@ enum {
   l_bluestore_nvmedevice_write_lat,
   l_bluestore_nvmedevice_read_lat,
   l_bluestore_nvmedevice_flush_lat,
+  l_bluestore_nvmedevice_discard_lat,
   l_bluestore_nvmedevice_write_queue_lat,
   l_bluestore_nvmedevice_read_queue_lat,
   l_bluestore_nvmedevice_flush_queue_lat,
@@ -83,27 +86,36 @@ struct Task;
 class SharedDriverData {
   unsigned id;
   spdk_nvme_transport_id trid;
+  uint32_t nsid;
   spdk_nvme_ctrlr *ctrlr;
   spdk_nvme_ns *ns;
   uint32_t block_size = 0;
   uint64_t size = 0;
+  bool deallocate_supported = false;
 
   public:
   std::vector<NVMEDevice*> registered_devices;
   friend class SharedDriverQueueData;
+  friend class NVMEManager;
   SharedDriverData(unsigned id_, const spdk_nvme_transport_id& trid_,
-                   spdk_nvme_ctrlr *c, spdk_nvme_ns *ns_)
+                   uint32_t nsid_, spdk_nvme_ctrlr *c, spdk_nvme_ns *ns_)
       : id(id_),
         trid(trid_),
+        nsid(nsid_),
         ctrlr(c),
         ns(ns_) {
     block_size = spdk_nvme_ns_get_extended_sector_size(ns);
     size = spdk_nvme_ns_get_size(ns);
+    deallocate_supported =
+      spdk_nvme_ns_get_flags(ns) & SPDK_NVME_NS_DEALLOCATE_SUPPORTED;
   }
 
   bool is_equal(const spdk_nvme_transport_id& trid2) const {
     return spdk_nvme_transport_id_compare(&trid, &trid2) == 0;
   }
+  bool is_equal(const spdk_nvme_transport_id& trid2, uint32_t nsid2) const {
+    return is_equal(trid2) && nsid == nsid2;
+  }
   ~SharedDriverData() {
   }
 
@@ -126,6 +138,9 @@ class SharedDriverData {
   uint64_t get_size() {
     return size;
   }
+  bool support_discard() const {
+    return deallocate_supported;
+  }
 };
 
 class SharedDriverQueueData {
@@ -177,6 +192,7 @@ class SharedDriverQueueData {
     b.add_time_avg(l_bluestore_nvmedevice_write_lat, "write_lat", "Average write completing latency");
     b.add_time_avg(l_bluestore_nvmedevice_read_lat, "read_lat", "Average read completing latency");
     b.add_time_avg(l_bluestore_nvmedevice_flush_lat, "flush_lat", "Average flush completing latency");
+    b.add_time_avg(l_bluestore_nvmedevice_discard_lat, "discard_lat", "Average discard completing latency");
     b.add_u64(l_bluestore_nvmedevice_queue_ops, "queue_ops", "Operations in nvme queue");
     b.add_time_avg(l_bluestore_nvmedevice_polling_lat, "polling_lat", "Average polling latency");
     b.add_time_avg(l_bluestore_nvmedevice_write_queue_lat, "write_queue_lat", "Average queue write request latency");
@@ -220,6 +236,7 @@ struct Task {
   bufferlist bl;
   std::function<void()> fill_cb;
   Task *next = nullptr;
+  spdk_nvme_dsm_range dsm_range = {};
   int64_t return_code;
   ceph::coarse_real_clock::time_point start;
   IORequest io_request;
@@ -432,6 +449,21 @@ void SharedDriverQueueData::_aio_handle(Task *t, IOContext *ioc)
           }
           break;
         }
+        case IOCommand::DISCARD_COMMAND:
+        {
+          dout(20) << __func__ << " discard command issued " << lba_off << "~" << lba_count << dendl;
+          t->dsm_range.starting_lba = lba_off;
+          t->dsm_range.length = lba_count;
+          r = spdk_nvme_ns_cmd_dataset_management(
+              ns, qpair, SPDK_NVME_DSM_ATTR_DEALLOCATE, &t->dsm_range, 1,
+              io_complete, t);
+          if (r < 0) {
+            derr << __func__ << " failed to discard" << dendl;
+            delete t;
+            ceph_abort();
+          }
+          break;
+        }
         case IOCommand::FLUSH_COMMAND:
         {
           dout(20) << __func__ << " flush command issueed " << dendl;
@@ -470,6 +502,7 @@ class NVMEManager {
  public:
   struct ProbeContext {
     spdk_nvme_transport_id trid;
+    uint32_t nsid;
     NVMEManager *manager;
     SharedDriverData *driver;
     bool done;
@@ -484,6 +517,25 @@ class NVMEManager {
   ceph::condition_variable probe_queue_cond;
   std::list<ProbeContext*> probe_queue;
 
+  SharedDriverData *add_driver(const spdk_nvme_transport_id& trid,
+                               uint32_t nsid, spdk_nvme_ctrlr *c) {
+    ceph_assert(ceph_mutex_is_locked(lock));
+    int num_ns = spdk_nvme_ctrlr_get_num_ns(c);
+    spdk_nvme_ns *ns = nullptr;
+    if (nsid >= 1 && nsid <= (uint32_t)num_ns) {
+      ns = spdk_nvme_ctrlr_get_ns(c, nsid);
+    }
+    if (!ns || !spdk_nvme_ns_is_active(ns)) {
+      derr << __func__ << " no active namespace " << nsid << " on "
+           << trid.traddr << " (" << num_ns << " namespaces)" << dendl;
+      return nullptr;
+    }
+    // index 0 is occurred by master thread
+    shared_driver_datas.push_back(
+      new SharedDriverData(shared_driver_datas.size()+1, trid, nsid, c, ns));
+    return shared_driver_datas.back();
+  }
+
  public:
   NVMEManager() {}
   ~NVMEManager() {
@@ -497,27 +549,13 @@ class NVMEManager {
     dpdk_thread.join();
   }
 
-  int try_get(const spdk_nvme_transport_id& trid, SharedDriverData **driver);
-  void register_ctrlr(const spdk_nvme_transport_id& trid, spdk_nvme_ctrlr *c, SharedDriverData **driver) {
+  int try_get(const spdk_nvme_transport_id& trid, uint32_t nsid,
+              SharedDriverData **driver);
+  void register_ctrlr(const spdk_nvme_transport_id& trid, uint32_t nsid,
+                      spdk_nvme_ctrlr *c, SharedDriverData **driver) {
     ceph_assert(ceph_mutex_is_locked(lock));
-    spdk_nvme_ns *ns;
-    int num_ns = spdk_nvme_ctrlr_get_num_ns(c);
-    ceph_assert(num_ns >= 1);
-    if (num_ns > 1) {
-      dout(0) << __func__ << " namespace count larger than 1, currently only use the first namespace" << dendl;
-    }
-    ns = spdk_nvme_ctrlr_get_ns(c, 1);
-    if (!ns) {
-      derr << __func__ << " failed to get namespace at 1" << dendl;
-      ceph_abort();
-    }
     dout(1) << __func__ << " successfully attach nvme device at" << trid.traddr << dendl;
-
-    // only support one device per osd now!
-    ceph_assert(shared_driver_datas.empty());
-    // index 0 is occurred by master thread
-    shared_driver_datas.push_back(new SharedDriverData(shared_driver_datas.size()+1, trid, c, ns));
-    *driver = shared_driver_datas.back();
+    *driver = add_driver(trid, nsid, c);
   }
 };
 
@@ -547,18 +585,26 @@ static void attach_cb(void *cb_ctx, const struct spdk_nvme_transport_id *trid,
                       struct spdk_nvme_ctrlr *ctrlr, const struct spdk_nvme_ctrlr_opts *opts)
 {
   auto ctx = static_cast<NVMEManager::ProbeContext*>(cb_ctx);
-  ctx->manager->register_ctrlr(ctx->trid, ctrlr, &ctx->driver);
+  ctx->manager->register_ctrlr(ctx->trid, ctx->nsid, ctrlr, &ctx->driver);
 }
 
-int NVMEManager::try_get(const spdk_nvme_transport_id& trid, SharedDriverData **driver)
+int NVMEManager::try_get(const spdk_nvme_transport_id& trid, uint32_t nsid,
+                         SharedDriverData **driver)
 {
   std::lock_guard l(lock);
   for (auto &&it : shared_driver_datas) {
-    if (it->is_equal(trid)) {
+    if (it->is_equal(trid, nsid)) {
       *driver = it;
       return 0;
     }
   }
+  // another namespace of a controller we already attached
+  for (auto &&it : shared_driver_datas) {
+    if (it->is_equal(trid)) {
+      *driver = add_driver(trid, nsid, it->ctrlr);
+      return *driver ? 0 : -ENOENT;
+    }
+  }
 
   auto coremask_arg = g_conf().get_val<std::string>("bluestore_spdk_coremask");
   int m_core_arg = -1;
@@ -579,10 +625,11 @@ int NVMEManager::try_get(const spdk_nvme_transport_id& trid, SharedDriverData **
   m_core_arg -= 1;
 
   uint32_t mem_size_arg = (uint32_t)g_conf().get_val<Option::size_t>("bluestore_spdk_mem");
+  int shm_id_arg = (int)g_conf().get_val<int64_t>("bluestore_spdk_shm_id");
 
   if (!dpdk_thread.joinable()) {
     dpdk_thread = std::thread(
-      [this, coremask_arg, m_core_arg, mem_size_arg]() {
+      [this, coremask_arg, m_core_arg, mem_size_arg, shm_id_arg]() {
         static struct spdk_env_opts opts;
         int r;
 
@@ -591,6 +638,9 @@ int NVMEManager::try_get(const spdk_nvme_transport_id& trid, SharedDriverData **
         opts.core_mask = coremask_arg.c_str();
         opts.master_core = m_core_arg;
         opts.mem_size = mem_size_arg;
+        // processes sharing an id share the controllers, each with its
+        // own qpairs
+        opts.shm_id = shm_id_arg;
         spdk_env_init(&opts);
         spdk_unaffinitize_thread();
 
@@ -621,7 +671,7 @@ int NVMEManager::try_get(const spdk_nvme_transport_id& trid, SharedDriverData **
     );
   }
 
-  ProbeContext ctx{trid, this, nullptr, false};
+  ProbeContext ctx{trid, nsid, this, nullptr, false};
   {
     std::unique_lock l(probe_queue_lock);
     probe_queue.push_back(&ctx);
@@ -682,6 +732,18 @@ void io_complete(void *t, const struct spdk_nvme_cpl *completion)
       task->return_code = 0;
       ctx->try_aio_wake();
     }
+  } else if (task->command == IOCommand::DISCARD_COMMAND) {
+    queue->logger->tinc(l_bluestore_nvmedevice_discard_lat, dur);
+    ceph_assert(!spdk_nvme_cpl_is_error(completion));
+    dout(20) << __func__ << " discard op successfully" << dendl;
+    if (ctx->priv) {
+      if (!--ctx->num_running) {
+        task->device->aio_callback(task->device->aio_callback_priv, ctx->priv);
+      }
+    } else {
+      ctx->try_aio_wake();
+    }
+    delete task;
   } else {
     ceph_assert(task->command == IOCommand::FLUSH_COMMAND);
     ceph_assert(!spdk_nvme_cpl_is_error(completion));
@@ -712,14 +774,30 @@ int NVMEDevice::open(const string& p)
   }
   string val;
   std::getline(ifs, val);
+  // "ns:<id>" is ours, spdk does not know it; the first namespace by default
+  uint32_t nsid = 1;
+  if (auto pos = val.find("ns:"); pos != string::npos &&
+      (pos == 0 || isspace(val[pos - 1]))) {
+    auto end = val.find_first_of(" \t", pos);
+    string id = val.substr(pos + 3, end == string::npos ? end : end - pos - 3);
+    string err;
+    nsid = strict_strtol(id.c_str(), 10, &err);
+    if (!err.empty() || nsid == 0) {
+      derr << __func__ << " invalid namespace id '" << id << "' in " << p
+	   << dendl;
+      return -EINVAL;
+    }
+    val.erase(pos, end == string::npos ? end : end - pos);
+  }
   spdk_nvme_transport_id trid;
   if (int r = spdk_nvme_transport_id_parse(&trid, val.c_str()); r) {
     derr << __func__ << " unable to read " << p << ": " << cpp_strerror(r)
 	 << dendl;
     return r;
   }
-  if (int r = manager.try_get(trid, &driver); r < 0) {
-    derr << __func__ << " failed to get nvme device with transport address " << trid.traddr << dendl;
+  if (int r = manager.try_get(trid, nsid, &driver); r < 0) {
+    derr << __func__ << " failed to get nvme device with transport address "
+	 << trid.traddr << " namespace " << nsid << dendl;
     return r;
   }
 
@@ -727,9 +805,13 @@ int NVMEDevice::open(const string& p)
   block_size = driver->get_block_size();
   size = driver->get_size();
   name = trid.traddr;
+  if (nsid != 1) {
+    name += "/ns" + stringify(nsid);
+  }
 
   //nvme is non-rotational device.
   rotational = false;
+  support_discard = driver->support_discard();
 
   // round size down to an even block
   size &= ~(block_size - 1);
@@ -746,8 +828,10 @@ void NVMEDevice::close()
 {
   dout(1) << __func__ << dendl;
 
-  delete queue_t;
-  queue_t = nullptr;
+  if (auto q = queue_t.find(this); q != queue_t.end()) {
+    delete q->second;
+    queue_t.erase(q);
+  }
   name.clear();
   driver->remove_device(this);
 
@@ -763,6 +847,7 @@ int NVMEDevice::collect_metadata(const string& prefix, map<string,string> *pm) c
   (*pm)[prefix + "type"] = "nvme";
   (*pm)[prefix + "access_mode"] = "spdk";
   (*pm)[prefix + "nvme_serial_number"] = name;
+  (*pm)[prefix + "support_discard"] = stringify((int)(bool)support_discard);
 
   return 0;
 }
@@ -772,6 +857,37 @@ int NVMEDevice::flush()
   return 0;
 }
 
+int NVMEDevice::discard(uint64_t offset, uint64_t len)
+{
+  if (!support_discard) {
+    return 0;
+  }
+  dout(10) << __func__ << " " << offset << "~" << len << dendl;
+  ceph_assert(is_valid_io(offset, len));
+
+  // a dsm range covers at most 2^32-1 blocks
+  uint64_t split_size =
+    (uint64_t)std::numeric_limits<uint32_t>::max() * block_size;
+  IOContext ioc(cct, NULL);
+  Task *last = nullptr;
+  while (len > 0) {
+    uint64_t l = std::min(len, split_size);
+    Task *t = new Task(this, IOCommand::DISCARD_COMMAND, offset, l);
+    t->ctx = &ioc;
+    if (last)
+      last->next = t;
+    else
+      ioc.nvme_task_first = t;
+    ioc.nvme_task_last = last = t;
+    ++ioc.num_pending;
+    offset += l;
+    len -= l;
+  }
+  aio_submit(&ioc);
+  ioc.aio_wait();
+  return 0;
+}
+
 void NVMEDevice::aio_submit(IOContext *ioc)
 {
   dout(20) << __func__ << " ioc " << ioc << " pending "
@@ -785,9 +901,10 @@ void NVMEDevice::aio_submit(IOContext *ioc)
     ceph_assert(ioc->num_pending.load() == 0);  // we should be only thread doing this
     // Only need to push the first entry
     ioc->nvme_task_first = ioc->nvme_task_last = nullptr;
-    if (!queue_t)
-	queue_t = new SharedDriverQueueData(this, driver);
-    queue_t->_aio_handle(t, ioc);
+    auto& queue = queue_t[this];
+    if (!queue)
+      queue = new SharedDriverQueueData(this, driver);
+    queue->_aio_handle(t, ioc);
   }
 }
 
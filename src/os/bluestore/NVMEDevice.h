@@ -32,7 +32,8 @@
 enum class IOCommand {
   READ_COMMAND,
   WRITE_COMMAND,
-  FLUSH_COMMAND
+  FLUSH_COMMAND,
+  DISCARD_COMMAND
 };
 
 class SharedDriverData;
@@ -71,6 +72,7 @@ class NVMEDevice : public BlockDevice {
 		int write_hint = WRITE_LIFE_NOT_SET) override;
   int write(uint64_t off, bufferlist& bl, bool buffered, int write_hint = WRITE_LIFE_NOT_SET) override;
   int flush() override;
+  int discard(uint64_t offset, uint64_t len) override;
   int read_random(uint64_t off, uint64_t len, char *buf, bool buffered) override;
 
   // for managing buffered readers/writers
@@ -188,7 +188,7 @@ int PMEMDevice::write(uint64_t off, bufferlist& bl, bool buffered, int write_hin
 {
   uint64_t len = bl.length();
   dout(20) << __func__ << " " << off << "~" << len  << dendl;
-  ceph_assert(is_valid_io(off, len));
+  ceph_assert(is_valid_byte_io(off, len));
 
   dout(40) << "data: ";
   bl.hexdump(*_dout);
@@ -254,7 +254,7 @@ int PMEMDevice::aio_read(uint64_t off, uint64_t len, bufferlist *pbl,
 int PMEMDevice::read_random(uint64_t off, uint64_t len, char *buf, bool buffered)
 {
   dout(5) << __func__ << " " << off << "~" << len << dendl;
-  ceph_assert(is_valid_io(off, len));
+  ceph_assert(is_valid_byte_io(off, len));
 
   memcpy(buf, addr + off, len);
   return 0;
@@ -1055,11 +1055,19 @@ void bluestore_onode_t::dump(Formatter *f) const
   f->dump_unsigned("expected_object_size", expected_object_size);
   f->dump_unsigned("expected_write_size", expected_write_size);
   f->dump_unsigned("alloc_hint_flags", alloc_hint_flags);
+  if (has_inline_data()) {
+    f->dump_unsigned("inline_data_len", inline_data.length());
+  }
 }
 
 void bluestore_onode_t::generate_test_instances(list<bluestore_onode_t*>& o)
 {
   o.push_back(new bluestore_onode_t());
+  o.push_back(new bluestore_onode_t());
+  o.back()->nid = 1;
+  o.back()->size = 8;
+  o.back()->set_flag(FLAG_INLINE_DATA);
+  o.back()->inline_data.append("abc");
   // FIXME
 }
 
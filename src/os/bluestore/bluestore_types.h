@@ -910,9 +910,13 @@ struct bluestore_onode_t {
 
   uint8_t flags = 0;
 
+  /// object data, if FLAG_INLINE_DATA; bytes past its end are zeros
+  bufferlist inline_data;
+
   enum {
     FLAG_OMAP = 1,       ///< object may have omap data
     FLAG_PGMETA_OMAP = 2,  ///< omap data is in meta omap prefix
+    FLAG_INLINE_DATA = 4,  ///< data is in inline_data, not in blobs
   };
 
   string get_flags_string() const {
@@ -920,6 +924,12 @@ struct bluestore_onode_t {
     if (flags & FLAG_OMAP) {
       s = "omap";
     }
+    if (flags & FLAG_INLINE_DATA) {
+      if (!s.empty()) {
+	s += "+";
+      }
+      s += "inline_data";
+    }
     return s;
   }
 
@@ -950,8 +960,13 @@ struct bluestore_onode_t {
     clear_flag(FLAG_OMAP);
   }
 
+  bool has_inline_data() const {
+    return has_flag(FLAG_INLINE_DATA);
+  }
+
   DENC(bluestore_onode_t, v, p) {
-    DENC_START(1, 1, p);
+    // older releases must not mistake an inline object for an empty one
+    DENC_START(2, v.has_inline_data() ? 2 : 1, p);
     denc_varint(v.nid, p);
     denc_varint(v.size, p);
     denc(v.attrs, p);
@@ -960,6 +975,9 @@ struct bluestore_onode_t {
     denc_varint(v.expected_object_size, p);
     denc_varint(v.expected_write_size, p);
     denc_varint(v.alloc_hint_flags, p);
+    if (struct_v >= 2 && v.has_inline_data()) {
+      denc(v.inline_data, p);
+    }
     DENC_FINISH(p);
   }
   void dump(Formatter *f) const;
@@ -544,3 +544,34 @@ void AllocatorLevel01Loose::collect_stats(
     bins_overall[cbits(free_seq_cnt) - 1]++;
   }
 }
+
+void AllocatorLevel01Loose::foreach_internal(
+  std::function<void(uint64_t offset, uint64_t length)> notify)
+{
+  uint64_t start = 0;
+  uint64_t len = 0;
+  for (size_t i = 0; i < l0.size(); i++) {
+    auto slot = l0[i];
+    if (slot == all_slot_set) {
+      if (!len) {
+	start = i * bits_per_slot;
+      }
+      len += bits_per_slot;
+      continue;
+    }
+    for (size_t j = 0; j < bits_per_slot; j++) {
+      if (slot & (slot_t(1) << j)) {
+	if (!len) {
+	  start = i * bits_per_slot + j;
+	}
+	++len;
+      } else if (len) {
+	notify(start * l0_granularity, len * l0_granularity);
+	len = 0;
+      }
+    }
+  }
+  if (len) {
+    notify(start * l0_granularity, len * l0_granularity);
+  }
+}
@@ -12,6 +12,7 @@
 
 #include <vector>
 #include <algorithm>
+#include <functional>
 #include <mutex>
 
 typedef uint64_t slot_t;
@@ -469,6 +470,8 @@ public:
   }
   void collect_stats(
     std::map<size_t, size_t>& bins_overall) override;
+  void foreach_internal(
+    std::function<void(uint64_t offset, uint64_t length)> notify);
 };
 
 class AllocatorLevel01Compact : public AllocatorLevel01
@@ -517,6 +520,11 @@ public:
       std::lock_guard l(lock);
       l1.collect_stats(bins_overall);
   }
+  void foreach_internal(
+    std::function<void(uint64_t offset, uint64_t length)> notify) {
+    std::lock_guard l(lock);
+    l1.foreach_internal(notify);
+  }
 
 protected:
   ceph::mutex lock = ceph::make_mutex("AllocatorLevel02::lock");
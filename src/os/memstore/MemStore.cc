@@ -1569,7 +1569,8 @@ struct MemStore::PageSetObject : public Object {
   static thread_local PageSet::page_vector tls_pages;
 #endif
 
-  explicit PageSetObject(size_t page_size) : data(page_size), data_len(0) {}
+  PageSetObject(size_t page_size, bool hugepages)
+    : data(page_size, hugepages), data_len(0) {}
 
   size_t get_size() const override { return data_len; }
 
@@ -1796,6 +1797,7 @@ int MemStore::PageSetObject::truncate(uint64_t size)
 
 MemStore::ObjectRef MemStore::Collection::create_object() const {
   if (use_page_set)
-    return new PageSetObject(cct->_conf->memstore_page_size);
+    return new PageSetObject(cct->_conf->memstore_page_size,
+                             cct->_conf->memstore_page_hugepages);
   return new BufferlistObject();
 }
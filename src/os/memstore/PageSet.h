@@ -18,17 +18,105 @@
 #include <algorithm>
 #include <atomic>
 #include <cassert>
+#include <map>
 #include <mutex>
+#include <thread>
 #include <vector>
-#include <boost/intrusive/avl_set.hpp>
+#include <sys/mman.h>
 #include <boost/intrusive_ptr.hpp>
 
 #include "include/encoding.h"
 
+/**
+ * Hands out page buffers carved from 2MB chunks that are mapped with
+ * transparent huge pages, so that large MemStore data sets don't spend
+ * their time in TLB misses. Freed buffers are kept for reuse; the chunks
+ * are never returned to the system.
+ *
+ * The pool is split in shards picked by thread, so that the threads
+ * writing to different objects don't all meet on one mutex. A buffer goes
+ * back to the shard of the thread that frees it.
+ */
+class PagePool {
+  static constexpr size_t chunk_size = 2 << 20;
+  static constexpr size_t num_shards = 16;
+
+  struct alignas(64) Shard {
+    std::mutex mutex;
+    std::map<size_t, std::vector<char*>> free_buffers; // by buffer size
+    char *chunk = nullptr;
+    size_t chunk_left = 0;
+  };
+  Shard shards[num_shards];
+
+  PagePool() = default;
+
+  Shard& get_shard() {
+    auto id = std::hash<std::thread::id>()(std::this_thread::get_id());
+    return shards[id % num_shards];
+  }
+
+  static char *map(size_t size) {
+    void *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+      throw std::bad_alloc();
+    return static_cast<char*>(p);
+  }
+
+  // THP can only back a range that is aligned to the huge page size, so
+  // map twice as much and unmap what sticks out either side
+  static char *alloc_chunk() {
+    auto p = map(chunk_size * 2);
+    auto addr = reinterpret_cast<uintptr_t>(p);
+    auto head = ((addr + chunk_size - 1) & ~(chunk_size - 1)) - addr;
+    if (head)
+      ::munmap(p, head);
+    ::munmap(p + head + chunk_size, chunk_size - head);
+    p += head;
+#ifdef MADV_HUGEPAGE
+    ::madvise(p, chunk_size, MADV_HUGEPAGE);
+#endif
+    return p;
+  }
+
+ public:
+  static PagePool& instance() {
+    static PagePool pool;
+    return pool;
+  }
+
+  char *alloc(size_t size) {
+    auto &shard = get_shard();
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto &buffers = shard.free_buffers[size];
+    if (!buffers.empty()) {
+      auto p = buffers.back();
+      buffers.pop_back();
+      return p;
+    }
+    if (size > chunk_size / 2) // would waste most of a chunk
+      return map(size);
+    if (shard.chunk_left < size) {
+      shard.chunk = alloc_chunk();
+      shard.chunk_left = chunk_size;
+    }
+    auto p = shard.chunk;
+    shard.chunk += size;
+    shard.chunk_left -= size;
+    return p;
+  }
+  void release(char *p, size_t size) {
+    auto &shard = get_shard();
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.free_buffers[size].push_back(p);
+  }
+};
+
 struct Page {
   char *const data;
-  boost::intrusive::avl_set_member_hook<> hook;
   uint64_t offset;
+  const size_t pool_size; ///< size of the PagePool buffer, 0 if not pooled
 
   // avoid RefCountedObject because it has a virtual destructor
   std::atomic<uint16_t> nrefs;
@@ -39,18 +127,6 @@ struct Page {
   friend void intrusive_ptr_add_ref(Page *p) { p->get(); }
   friend void intrusive_ptr_release(Page *p) { p->put(); }
 
-  // key-value comparison functor for avl
-  struct Less {
-    bool operator()(uint64_t offset, const Page &page) const {
-      return offset < page.offset;
-    }
-    bool operator()(const Page &page, uint64_t offset) const {
-      return page.offset < offset;
-    }
-    bool operator()(const Page &lhs, const Page &rhs) const {
-      return lhs.offset < rhs.offset;
-    }
-  };
   void encode(bufferlist &bl, size_t page_size) const {
     using ceph::encode;
     bl.append(buffer::copy(data, page_size));
@@ -62,14 +138,18 @@ struct Page {
     decode(offset, p);
   }
 
-  static Ref create(size_t page_size, uint64_t offset = 0) {
+  static Ref create(size_t page_size, uint64_t offset = 0,
+                    bool pooled = false) {
     // ensure proper alignment of the Page
     const auto align = alignof(Page);
     page_size = (page_size + align - 1) & ~(align - 1);
     // allocate the Page and its data in a single buffer
-    auto buffer = new char[page_size + sizeof(Page)];
+    const size_t size = page_size + sizeof(Page);
+    auto buffer = pooled ? PagePool::instance().alloc(size) : new char[size];
     // place the Page structure at the end of the buffer
-    return new (buffer + page_size) Page(buffer, offset);
+    return Ref(new (buffer + page_size) Page(buffer, offset,
+                                             pooled ? size : 0),
+               false);
   }
 
   // copy disabled
@@ -77,41 +157,172 @@ struct Page {
   const Page& operator=(const Page&) = delete;
 
  private: // private constructor, use create() instead
-  Page(char *data, uint64_t offset) : data(data), offset(offset), nrefs(1) {}
+  Page(char *data, uint64_t offset, size_t pool_size)
+    : data(data), offset(offset), pool_size(pool_size), nrefs(1) {}
 
   static void operator delete(void *p) {
-    delete[] reinterpret_cast<Page*>(p)->data;
+    auto page = reinterpret_cast<Page*>(p);
+    if (page->pool_size)
+      PagePool::instance().release(page->data, page->pool_size);
+    else
+      delete[] page->data;
   }
 };
 
+/**
+ * The pages of an object, indexed by a radix tree of page numbers.
+ *
+ * Readers walk the tree without taking the mutex: nodes and pages are
+ * published with release stores, and nodes are only freed with the
+ * PageSet. Pages that are removed from the tree are only dropped once
+ * all the readers that might have seen them are done, using two reader
+ * counts that alternate between grace periods.
+ */
 class PageSet {
  public:
   // alloc_range() and get_range() return page refs in a vector
   typedef std::vector<Page::Ref> page_vector;
 
  private:
-  // store pages in a boost intrusive avl_set
-  typedef Page::Less page_cmp;
-  typedef boost::intrusive::member_hook<Page,
-          boost::intrusive::avl_set_member_hook<>,
-          &Page::hook> member_option;
-  typedef boost::intrusive::avl_set<Page,
-          boost::intrusive::compare<page_cmp>, member_option> page_set;
+  static constexpr unsigned node_bits = 6;
+  static constexpr unsigned node_slots = 1 << node_bits;
 
-  typedef typename page_set::iterator iterator;
+  struct Node {
+    const unsigned height; ///< 0 for leaves, whose slots point to pages
+    std::atomic<void*> slots[node_slots];
+
+    explicit Node(unsigned height) : height(height) {
+      for (auto &slot : slots)
+        slot.store(nullptr, std::memory_order_relaxed);
+    }
+  };
 
-  page_set pages;
+  std::atomic<Node*> root = {nullptr};
+  std::atomic<size_t> count = {0};
   uint64_t page_size;
+  unsigned page_shift;
+  bool pooled;
 
   typedef std::mutex lock_type;
-  lock_type mutex;
+  lock_type mutex; // serializes the updates of the tree
 
-  void free_pages(iterator cur, iterator end) {
-    while (cur != end) {
-      Page *page = &*cur;
-      cur = pages.erase(cur);
-      page->put();
+  std::atomic<unsigned> reader_epoch = {0};
+  std::atomic<int> readers[2] = {};
+
+  static unsigned shift_of(uint64_t page_size) {
+    return page_size > 1 ? 64 - __builtin_clzll(page_size - 1) : 0;
+  }
+
+  // whether a node of the given height covers the page index
+  static bool covers(unsigned height, uint64_t index) {
+    const unsigned bits = node_bits * (height + 1);
+    return bits >= 64 || (index >> bits) == 0;
+  }
+  static unsigned slot_of(unsigned height, uint64_t index) {
+    return (index >> (node_bits * height)) & (node_slots - 1);
+  }
+
+  unsigned read_lock() {
+    while (true) {
+      unsigned epoch = reader_epoch.load();
+      readers[epoch & 1].fetch_add(1);
+      if (reader_epoch.load() == epoch)
+        return epoch;
+      readers[epoch & 1].fetch_sub(1);
+    }
+  }
+  void read_unlock(unsigned epoch) {
+    readers[epoch & 1].fetch_sub(1, std::memory_order_release);
+  }
+  // wait for the readers that might still see removed pages
+  void synchronize_readers() {
+    unsigned epoch = reader_epoch.fetch_add(1);
+    while (readers[epoch & 1].load(std::memory_order_acquire) != 0)
+      std::this_thread::yield();
+  }
+
+  // call f(slot, page) for the pages in [first,last], in order
+  template <typename F>
+  static void visit(Node *node, uint64_t base, uint64_t first, uint64_t last,
+                    F &&f) {
+    const unsigned shift = node_bits * node->height;
+    const uint64_t span = uint64_t(1) << shift;
+    // the top node may only have part of its slots in the index space
+    const unsigned slots = shift + node_bits > 64 ?
+      1u << (64 - shift) : node_slots;
+    for (unsigned i = 0; i < slots; i++) {
+      const uint64_t start = base + i * span;
+      if (start + (span - 1) < first)
+        continue;
+      if (start > last)
+        break;
+      void *p = node->slots[i].load(std::memory_order_acquire);
+      if (!p)
+        continue;
+      if (node->height == 0)
+        f(node->slots[i], static_cast<Page*>(p));
+      else
+        visit(static_cast<Node*>(p), start, first, last, f);
+    }
+  }
+  template <typename F>
+  void visit(uint64_t first, uint64_t last, F &&f) const {
+    Node *node = root.load(std::memory_order_acquire);
+    if (node)
+      visit(node, 0, first, last, f);
+  }
+
+  static void free_node(Node *node) {
+    for (auto &slot : node->slots) {
+      void *p = slot.load(std::memory_order_relaxed);
+      if (!p)
+        continue;
+      if (node->height == 0)
+        static_cast<Page*>(p)->put();
+      else
+        free_node(static_cast<Node*>(p));
+    }
+    delete node;
+  }
+
+  // find or create the leaf slot of a page index, with the mutex held
+  std::atomic<void*> &get_slot(uint64_t index) {
+    Node *node = root.load(std::memory_order_relaxed);
+    if (!node) {
+      node = new Node(0);
+      root.store(node, std::memory_order_release);
     }
+    while (!covers(node->height, index)) {
+      auto parent = new Node(node->height + 1);
+      parent->slots[0].store(node, std::memory_order_relaxed);
+      root.store(parent, std::memory_order_release);
+      node = parent;
+    }
+    while (node->height > 0) {
+      auto &slot = node->slots[slot_of(node->height, index)];
+      auto child = static_cast<Node*>(slot.load(std::memory_order_relaxed));
+      if (!child) {
+        child = new Node(node->height - 1);
+        slot.store(child, std::memory_order_release);
+      }
+      node = child;
+    }
+    return node->slots[slot_of(0, index)];
+  }
+
+  void free_pages(uint64_t first_index) {
+    std::vector<Page*> removed;
+    visit(first_index, UINT64_MAX, [&removed] (std::atomic<void*> &slot,
+                                               Page *page) {
+        slot.store(nullptr, std::memory_order_release);
+        removed.push_back(page);
+      });
+    if (removed.empty())
+      return;
+    count -= removed.size();
+    synchronize_readers();
+    for (auto page : removed)
+      page->put();
   }
 
   int count_pages(uint64_t offset, uint64_t len) const {
@@ -129,40 +340,42 @@ class PageSet {
   }
 
  public:
-  explicit PageSet(size_t page_size) : page_size(page_size) {}
+  explicit PageSet(size_t page_size, bool pooled = false)
+    : page_size(page_size), page_shift(shift_of(page_size)), pooled(pooled) {}
   PageSet(PageSet &&rhs)
-    : pages(std::move(rhs.pages)), page_size(rhs.page_size) {}
+    : root(rhs.root.exchange(nullptr)), count(rhs.count.exchange(0)),
+      page_size(rhs.page_size), page_shift(rhs.page_shift),
+      pooled(rhs.pooled) {}
   ~PageSet() {
-    free_pages(pages.begin(), pages.end());
+    Node *node = root.load(std::memory_order_relaxed);
+    if (node)
+      free_node(node);
   }
 
   // disable copy
   PageSet(const PageSet&) = delete;
   const PageSet& operator=(const PageSet&) = delete;
 
-  bool empty() const { return pages.empty(); }
-  size_t size() const { return pages.size(); }
+  bool empty() const { return count == 0; }
+  size_t size() const { return count; }
   size_t get_page_size() const { return page_size; }
 
   // allocate all pages that intersect the range [offset,length)
   void alloc_range(uint64_t offset, uint64_t length, page_vector &range) {
-    // loop in reverse so we can provide hints to avl_set::insert_check()
-    //	and get O(1) insertions after the first
-    uint64_t position = offset + length - 1;
-
     range.resize(count_pages(offset, length));
-    auto out = range.rbegin();
+    if (!length)
+      return;
+    auto out = range.begin();
 
-    std::lock_guard<lock_type> lock(mutex);
-    iterator cur = pages.end();
-    while (length) {
-      const uint64_t page_offset = position & ~(page_size-1);
+    const uint64_t first = offset >> page_shift;
+    const uint64_t last = (offset + length - 1) >> page_shift;
 
-      typename page_set::insert_commit_data commit;
-      auto insert = pages.insert_check(cur, page_offset, page_cmp(), commit);
-      if (insert.second) {
-        auto page = Page::create(page_size, page_offset);
-        cur = pages.insert_commit(*page, commit);
+    std::lock_guard<lock_type> lock(mutex);
+    for (uint64_t index = first; index <= last; index++) {
+      auto &slot = get_slot(index);
+      auto page = static_cast<Page*>(slot.load(std::memory_order_relaxed));
+      if (!page) {
+        page = Page::create(page_size, index << page_shift, pooled).detach();
 
         // assume that the caller will write to the range [offset,length),
         //  so we only need to zero memory outside of this range
@@ -174,57 +387,64 @@ class PageSet {
         // zero front of page between page_offset and offset
         if (offset > page->offset)
           std::fill(page->data, page->data + offset - page->offset, 0);
-      } else { // exists
-        cur = insert.first;
+
+        slot.store(page, std::memory_order_release);
+        ++count;
       }
       // add a reference to output vector
-      out->reset(&*cur);
+      out->reset(page);
       ++out;
-
-      auto c = std::min(length, (position & (page_size-1)) + 1);
-      position -= c;
-      length -= c;
     }
     // make sure we sized the vector correctly
-    ceph_assert(out == range.rend());
+    ceph_assert(out == range.end());
   }
 
   // return all allocated pages that intersect the range [offset,length)
   void get_range(uint64_t offset, uint64_t length, page_vector &range) {
-    auto cur = pages.lower_bound(offset & ~(page_size-1), page_cmp());
-    while (cur != pages.end() && cur->offset < offset + length)
-      range.push_back(&*cur++);
+    if (!length)
+      return;
+    const uint64_t first = offset >> page_shift;
+    const uint64_t last = (offset + length - 1) >> page_shift;
+
+    const unsigned epoch = read_lock();
+    visit(first, last, [&range] (std::atomic<void*>&, Page *page) {
+        range.push_back(page);
+      });
+    read_unlock(epoch);
   }
 
   void free_pages_after(uint64_t offset) {
     std::lock_guard<lock_type> lock(mutex);
-    auto cur = pages.lower_bound(offset & ~(page_size-1), page_cmp());
-    if (cur == pages.end())
-      return;
-    if (cur->offset < offset)
-      cur++;
-    free_pages(cur, pages.end());
+    free_pages((offset + page_size - 1) >> page_shift);
   }
 
   void encode(bufferlist &bl) const {
     using ceph::encode;
     encode(page_size, bl);
+    std::vector<const Page*> pages;
+    visit(0, UINT64_MAX, [&pages] (std::atomic<void*>&, const Page *page) {
+        pages.push_back(page);
+      });
     unsigned count = pages.size();
     encode(count, bl);
     for (auto p = pages.rbegin(); p != pages.rend(); ++p)
-      p->encode(bl, page_size);
+      (*p)->encode(bl, page_size);
   }
   void decode(bufferlist::const_iterator &p) {
     using ceph::decode;
     ceph_assert(empty());
     decode(page_size, p);
+    page_shift = shift_of(page_size);
     unsigned count;
     decode(count, p);
-    auto cur = pages.end();
+    std::lock_guard<lock_type> lock(mutex);
     for (unsigned i = 0; i < count; i++) {
-      auto page = Page::create(page_size);
+      auto page = Page::create(page_size, 0, pooled);
       page->decode(p, page_size);
-      cur = pages.insert_before(cur, *page);
+      auto &slot = get_slot(page->offset >> page_shift);
+      ceph_assert(slot.load(std::memory_order_relaxed) == nullptr);
+      slot.store(page.detach(), std::memory_order_release);
+      ++this->count;
     }
   }
 };
@@ -146,6 +146,19 @@ public:
             ceph_abort_msg("unknown counter type");
           }
 
+          // "." does not match line terminators, so only skip the regex
+          // for strings without them
+          if (d.match_all != OSDPerfMetricSubKeyDescriptor::MatchAll::NONE &&
+              match_string.find_first_of("\r\n") == std::string::npos) {
+            if (match_string.empty() &&
+                d.match_all ==
+                  OSDPerfMetricSubKeyDescriptor::MatchAll::NON_EMPTY) {
+              return false;
+            }
+            sub_key->push_back(std::move(match_string));
+            return true;
+          }
+
           std::smatch match;
           if (!std::regex_search(match_string, match, d.regex)) {
             return false;
@@ -154,8 +154,11 @@ ostream &operator<<(ostream &lhs, const ECBackend::Op &rhs)
       << " pending_apply=" << rhs.pending_apply
       << " pending_commit=" << rhs.pending_commit
       << " plan.to_read=" << rhs.plan.to_read
-      << " plan.will_write=" << rhs.plan.will_write
-      << ")";
+      << " plan.will_write=" << rhs.plan.will_write;
+  if (rhs.parity_delta) {
+    lhs << " plan.delta_chunks=" << rhs.plan.delta_chunks;
+  }
+  lhs << ")";
   return lhs;
 }
 
@@ -197,6 +200,10 @@ ECBackend::ECBackend(
   ErasureCodeInterfaceRef ec_impl,
   uint64_t stripe_width)
   : PGBackend(cct, pg, store, coll, ch),
+    recent_stripes_max(
+      cct->_conf.get_val<Option::size_t>("osd_ec_stripe_cache_size") /
+      stripe_width),
+    recent_stripes(recent_stripes_max),
     ec_impl(ec_impl),
     sinfo(ec_impl->get_data_chunk_count(), stripe_width) {
   ceph_assert((ec_impl->get_data_chunk_count() *
@@ -955,6 +962,7 @@ void ECBackend::handle_sub_write(
     op.updated_hit_set_history,
     op.trim_to,
     op.roll_forward_to,
+    op.roll_forward_to,
     !op.backfill_or_async_recovery,
     localt,
     async);
@@ -1428,6 +1436,10 @@ void ECBackend::on_change()
     cache.release_write_pin(op.second.pin);
   }
   tid_to_op_map.clear();
+  // whatever was in flight may be rolled back
+  recent_stripes.set_size(0);
+  recent_stripes.set_size(recent_stripes_max);
+  recent_stripes_writer.clear();
 
   for (map<ceph_tid_t, ReadOp>::iterator i = tid_to_read_map.begin();
        i != tid_to_read_map.end();
@@ -1629,6 +1641,7 @@ int ECBackend::get_remaining_shards(
   const set<int> &avail,
   const set<int> &want,
   const read_result_t &result,
+  const map<pg_shard_t, vector<pair<int, int>>> &already_read,
   map<pg_shard_t, vector<pair<int, int>>> *to_read,
   bool for_recovery)
 {
@@ -1651,10 +1664,19 @@ int ECBackend::get_remaining_shards(
     return -EIO;
   }
 
+  // the new shards only need the subchunks minimum_to_decode asked for
+  // (e.g. a clay repair) if the shards we already read from are wanted for
+  // the same subchunks; otherwise read whole chunks
+  bool partial = true;
   set<int> shards_left;
-  for (auto p : need) {
+  for (auto &p : need) {
     if (avail.find(p.first) == avail.end()) {
       shards_left.insert(p.first);
+    } else {
+      auto q = already_read.find(shards[shard_id_t(p.first)]);
+      if (q == already_read.end() || q->second != p.second) {
+	partial = false;
+      }
     }
   }
 
@@ -1665,7 +1687,8 @@ int ECBackend::get_remaining_shards(
        ++i) {
     ceph_assert(shards.count(shard_id_t(*i)));
     ceph_assert(avail.find(*i) == avail.end());
-    to_read->insert(make_pair(shards[shard_id_t(*i)], subchunks));
+    to_read->insert(make_pair(shards[shard_id_t(*i)],
+			      partial ? need[*i] : subchunks));
   }
   return 0;
 }
@@ -1847,12 +1870,183 @@ void ECBackend::start_rmw(Op *op, PGTransactionUPtr &&t)
     },
     get_parent()->get_dpp());
 
+  if (cct->_conf.get_val<bool>("osd_ec_parity_delta_writes") &&
+      get_parent()->get_pool().allows_ecoverwrites() &&
+      ec_impl->supports_parity_delta()) {
+    op->plan.delta_chunks = ECTransaction::get_delta_chunks(sinfo, op->plan);
+    op->parity_delta = can_parity_delta(*op);
+    if (!op->parity_delta) {
+      op->plan.delta_chunks.clear();
+    }
+  }
+
   dout(10) << __func__ << ": " << *op << dendl;
 
   waiting_state.push_back(*op);
   check_ops();
 }
 
+bool ECBackend::can_parity_delta(const Op &op)
+{
+  const set<int> &chunks = op.plan.delta_chunks;
+  if (chunks.empty() || op.plan.to_read.begin()->first != op.hoid)
+    return false;
+
+  // reading the changed data chunks and the coding chunks should not
+  // cost more than reading the data chunks of the stripe
+  if (chunks.size() + ec_impl->get_coding_chunk_count() >
+      ec_impl->get_data_chunk_count())
+    return false;
+
+  // the chunks are read and rewritten in place, so every shard has to
+  // hold a current copy of the object
+  set<int> have;
+  map<shard_id_t, pg_shard_t> shards;
+  set<pg_shard_t> error_shards;
+  get_all_avail_shards(op.hoid, error_shards, have, shards, false);
+  return have.size() == ec_impl->get_chunk_count();
+}
+
+bool ECBackend::parity_delta_blocked(const Op &op)
+{
+  // A parity delta op neither reads through nor updates the cache: it
+  // has to wait for the writes already in flight on its object to be
+  // on disk, and later ops on that object have to wait for it.
+  auto blocks = [&op](const Op &other) {
+    if (op.parity_delta) {
+      return other.plan.will_write.count(op.hoid) > 0;
+    }
+    return other.parity_delta && op.plan.will_write.count(other.hoid) > 0;
+  };
+  for (auto &&other : waiting_reads) {
+    if (blocks(other))
+      return true;
+  }
+  for (auto &&other : waiting_commit) {
+    if (blocks(other))
+      return true;
+  }
+  return false;
+}
+
+struct FinishParityDeltaRead :
+  public GenContext<pair<RecoveryMessages*, ECBackend::read_result_t& > &> {
+  ECBackend *ec;
+  ECBackend::Op *op;
+  set<int> want;
+  FinishParityDeltaRead(
+    ECBackend *ec,
+    ECBackend::Op *op,
+    const set<int> &want)
+    : ec(ec), op(op), want(want) {}
+  void finish(pair<RecoveryMessages *, ECBackend::read_result_t &> &in) override {
+    ec->finish_parity_delta_read(op, want, in.second);
+  }
+};
+
+void ECBackend::finish_parity_delta_read(
+  Op *op,
+  const set<int> &want,
+  read_result_t &res)
+{
+  op->delta_read_in_progress = false;
+  bool complete = res.r == 0;
+  for (auto &&read : res.returned) {
+    if (!complete)
+      break;
+    uint64_t chunk_off =
+      sinfo.aligned_logical_offset_to_chunk_offset(read.get<0>());
+    uint64_t chunk_len =
+      sinfo.aligned_logical_offset_to_chunk_offset(read.get<1>());
+    set<int> got;
+    for (auto &&j : read.get<2>()) {
+      if (!want.count(j.first.shard) || j.second.length() != chunk_len)
+	continue;
+      got.insert(j.first.shard);
+      op->delta_read_result[j.first.shard].insert(
+	chunk_off, chunk_len, j.second);
+    }
+    complete = got == want;
+  }
+  if (!complete) {
+    // some shard failed us, read and encode the whole stripes instead
+    dout(10) << __func__ << ": incomplete read r=" << res.r
+	     << ", falling back to a full stripe rmw for " << *op << dendl;
+    op->delta_read_result.clear();
+    op->plan.delta_chunks.clear();
+    op->remote_read = op->plan.to_read;
+    start_remote_read(op);
+    return;
+  }
+  check_ops();
+}
+
+void ECBackend::start_parity_delta_read(Op *op)
+{
+  ceph_assert(op->plan.to_read.size() == 1);
+  set<int> want;
+  for (int chunk : op->plan.delta_chunks) {
+    want.insert(ECTransaction::chunk_to_shard(ec_impl, chunk));
+  }
+  for (unsigned i = ec_impl->get_data_chunk_count();
+       i < ec_impl->get_chunk_count();
+       ++i) {
+    want.insert(ECTransaction::chunk_to_shard(ec_impl, i));
+  }
+
+  set<int> have;
+  map<shard_id_t, pg_shard_t> shards;
+  set<pg_shard_t> error_shards;
+  get_all_avail_shards(op->hoid, error_shards, have, shards, false);
+
+  vector<pair<int, int>> subchunks;
+  subchunks.push_back(make_pair(0, ec_impl->get_sub_chunk_count()));
+  map<pg_shard_t, vector<pair<int, int>>> need;
+  for (int i : want) {
+    ceph_assert(shards.count(shard_id_t(i)));
+    need[shards[shard_id_t(i)]] = subchunks;
+  }
+
+  list<boost::tuple<uint64_t, uint64_t, uint32_t> > to_read;
+  const extent_set &partial_stripes = op->plan.to_read.begin()->second;
+  for (auto &&extent : partial_stripes) {
+    to_read.push_back(boost::make_tuple(extent.first, extent.second, 0));
+  }
+
+  map<hobject_t, read_request_t> for_read_op;
+  for_read_op.insert(
+    make_pair(
+      op->hoid,
+      read_request_t(
+	to_read,
+	need,
+	false,
+	new FinishParityDeltaRead(this, op, want))));
+  map<hobject_t, set<int>> obj_want_to_read;
+  obj_want_to_read.insert(make_pair(op->hoid, want));
+
+  op->delta_read_in_progress = true;
+  start_read_op(
+    CEPH_MSG_PRIO_DEFAULT,
+    obj_want_to_read,
+    for_read_op,
+    OpRequestRef(),
+    false, false);
+}
+
+void ECBackend::start_remote_read(Op *op)
+{
+  ceph_assert(get_parent()->get_pool().allows_ecoverwrites());
+  objects_read_async_no_cache(
+    op->remote_read,
+    [this, op](map<hobject_t,pair<int, extent_map> > &&results) {
+      for (auto &&i: results) {
+	op->remote_read_result.emplace(i.first, i.second.second);
+      }
+      check_ops();
+    });
+}
+
 bool ECBackend::try_state_to_reads()
 {
   if (waiting_state.empty())
@@ -1868,7 +2062,13 @@ bool ECBackend::try_state_to_reads()
     return false;
   }
 
-  if (!pipeline_state.caching_enabled()) {
+  if (parity_delta_blocked(*op)) {
+    dout(20) << __func__ << ": blocking " << *op
+	     << " behind a write to the same object" << dendl;
+    return false;
+  }
+
+  if (!pipeline_state.caching_enabled() || op->parity_delta) {
     op->using_cache = false;
   } else if (op->invalidates_cache()) {
     dout(20) << __func__ << ": invalidating cache after this op"
@@ -1899,6 +2099,19 @@ bool ECBackend::try_state_to_reads()
       extent_set pending_read = to_read_plan;
       pending_read.subtract(remote_read);
 
+      extent_map recent;
+      if (!remote_read.empty() && recent_stripes_max &&
+	  recent_stripes.lookup(hpair.first, &recent)) {
+	extent_map found;
+	for (auto r = remote_read.begin(); r != remote_read.end(); ++r) {
+	  found.insert(recent.intersect(r.get_start(), r.get_len()));
+	}
+	if (!found.empty()) {
+	  remote_read.subtract(found.get_interval_set());
+	  op->recent_read[hpair.first] = std::move(found);
+	}
+      }
+
       if (!remote_read.empty()) {
 	op->remote_read[hpair.first] = std::move(remote_read);
       }
@@ -1906,22 +2119,24 @@ bool ECBackend::try_state_to_reads()
 	op->pending_read[hpair.first] = std::move(pending_read);
       }
     }
-  } else {
+  } else if (!op->parity_delta) {
     op->remote_read = op->plan.to_read;
   }
 
+  if (recent_stripes_max && op->plan.t) {
+    // refilled in try_reads_to_commit() if this op writes through the cache
+    for (auto &&i: op->plan.t->op_map) {
+      recent_stripes.clear(i.first);
+      recent_stripes_writer[i.first] = op->tid;
+    }
+  }
+
   dout(10) << __func__ << ": " << *op << dendl;
 
-  if (!op->remote_read.empty()) {
-    ceph_assert(get_parent()->get_pool().allows_ecoverwrites());
-    objects_read_async_no_cache(
-      op->remote_read,
-      [this, op](map<hobject_t,pair<int, extent_map> > &&results) {
-	for (auto &&i: results) {
-	  op->remote_read_result.emplace(i.first, i.second.second);
-	}
-	check_ops();
-      });
+  if (op->parity_delta) {
+    start_parity_delta_read(op);
+  } else if (!op->remote_read.empty()) {
+    start_remote_read(op);
   }
 
   return true;
@@ -1953,8 +2168,13 @@ bool ECBackend::try_reads_to_commit()
 	  hpair.second));
     }
     op->pending_read.clear();
+    for (auto &&hpair: op->recent_read) {
+      op->remote_read_result[hpair.first].insert(std::move(hpair.second));
+    }
+    op->recent_read.clear();
   } else {
     ceph_assert(op->pending_read.empty());
+    ceph_assert(op->recent_read.empty());
   }
 
   map<shard_id_t, ObjectStore::Transaction> trans;
@@ -1980,7 +2200,8 @@ bool ECBackend::try_reads_to_commit()
       &trans,
       &(op->temp_added),
       &(op->temp_cleared),
-      get_parent()->get_dpp());
+      get_parent()->get_dpp(),
+      op->delta_read_result);
   }
 
   dout(20) << __func__ << ": " << cache << dendl;
@@ -2002,16 +2223,32 @@ bool ECBackend::try_reads_to_commit()
     written_set[i.first] = i.second.get_interval_set();
   }
   dout(20) << __func__ << ": written_set: " << written_set << dendl;
-  ceph_assert(written_set == op->plan.will_write);
+  // a parity delta does not produce the stripes it changes
+  ceph_assert(!op->plan.delta_chunks.empty() ||
+	      written_set == op->plan.will_write);
 
   if (op->using_cache) {
     for (auto &&hpair: written) {
       dout(20) << __func__ << ": " << hpair << dendl;
       cache.present_rmw_update(hpair.first, op->pin, hpair.second);
     }
+    if (recent_stripes_max) {
+      for (auto &&hpair: written) {
+	auto w = recent_stripes_writer.find(hpair.first);
+	if (hpair.second.empty() ||
+	    w == recent_stripes_writer.end() || w->second != op->tid)
+	  continue;
+	// an append only needs the stripe the last one ended in
+	uint64_t end = hpair.second.get_interval_set().range_end();
+	uint64_t start = end - std::min<uint64_t>(end, sinfo.get_stripe_width());
+	recent_stripes.add(hpair.first,
+			   hpair.second.intersect(start, end - start));
+      }
+    }
   }
   op->remote_read.clear();
   op->remote_read_result.clear();
+  op->delta_read_result.clear();
 
   ObjectStore::Transaction empty;
   bool should_write_local = false;
@@ -2121,6 +2358,13 @@ bool ECBackend::try_finish_rmw()
   if (op->using_cache) {
     cache.release_write_pin(op->pin);
   }
+  if (recent_stripes_max && op->plan.t) {
+    for (auto &&i: op->plan.t->op_map) {
+      auto w = recent_stripes_writer.find(i.first);
+      if (w != recent_stripes_writer.end() && w->second == op->tid)
+	recent_stripes_writer.erase(w);
+    }
+  }
   tid_to_op_map.erase(op->tid);
 
   if (waiting_reads.empty() &&
@@ -2393,7 +2637,9 @@ int ECBackend::send_all_remaining_reads(
   dout(10) << __func__ << " have/error shards=" << already_read << dendl;
   map<pg_shard_t, vector<pair<int, int>>> shards;
   int r = get_remaining_shards(hoid, already_read, rop.want_to_read[hoid],
-			       rop.complete[hoid], &shards, rop.for_recovery);
+			       rop.complete[hoid],
+			       rop.to_read.find(hoid)->second.need,
+			       &shards, rop.for_recovery);
   if (r)
     return r;
 
@@ -2484,30 +2730,25 @@ int ECBackend::be_deep_scrub(
   if (stride % sinfo.get_chunk_size())
     stride += sinfo.get_chunk_size() - (stride % sinfo.get_chunk_size());
 
-  bufferlist bl;
-  r = store->read(
-    ch,
-    ghobject_t(
-      poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
+  r = be_deep_scrub_data(
+    poid,
     pos.data_pos,
-    stride, bl,
-    fadvise_flags);
+    stride,
+    fadvise_flags,
+    &pos.data_hash);
   if (r < 0) {
     dout(20) << __func__ << "  " << poid << " got "
 	     << r << " on read, read_error" << dendl;
     o.read_error = true;
     return 0;
   }
-  if (bl.length() % sinfo.get_chunk_size()) {
+  if (r % sinfo.get_chunk_size()) {
     dout(20) << __func__ << "  " << poid << " got "
 	     << r << " on read, not chunk size " << sinfo.get_chunk_size() << " aligned"
 	     << dendl;
     o.read_error = true;
     return 0;
   }
-  if (r > 0) {
-    pos.data_hash << bl;
-  }
   pos.data_pos += r;
   if (r == (int)stride) {
     return -EINPROGRESS;
@@ -24,6 +24,7 @@
 #include "ECUtil.h"
 #include "ECTransaction.h"
 #include "ExtentCache.h"
+#include "common/simple_cache.hpp"
 
 //forward declaration
 struct ECSubWrite;
@@ -485,8 +486,15 @@ public:
     map<hobject_t,extent_set> pending_read; // subset already being read
     map<hobject_t,extent_set> remote_read;  // subset we must read
     map<hobject_t,extent_map> remote_read_result;
+    map<hobject_t,extent_map> recent_read;  // subset found in recent_stripes
+
+    /// parity delta update of plan.delta_chunks, see try_state_to_reads
+    bool parity_delta = false;
+    bool delta_read_in_progress = false;
+    map<int,extent_map> delta_read_result; // by shard, chunk offsets
     bool read_in_progress() const {
-      return !remote_read.empty() && remote_read_result.empty();
+      return delta_read_in_progress ||
+	(!remote_read.empty() && remote_read_result.empty());
     }
 
     /// In progress write state.
@@ -517,6 +525,20 @@ public:
   ExtentCache cache;
   map<ceph_tid_t, Op> tid_to_op_map; /// Owns Op structure
 
+  /**
+   * The last stripe written to recently written objects, so that
+   * sequential partial-stripe appends need not read it back.  The cache
+   * above only holds extents while writes to them are in flight; these
+   * outlive the write, and are dropped as soon as a later op touches the
+   * object in any other way.  Entries are updated in pipeline order, so
+   * they match what is on disk until the next interval change.
+   */
+  size_t recent_stripes_max;
+  SimpleLRU<hobject_t, extent_map> recent_stripes;
+  /// latest op in the pipeline to touch each object, only that one may
+  /// cache what it writes
+  map<hobject_t, ceph_tid_t> recent_stripes_writer;
+
   /**
    * We model the possible rmw states as a set of waitlists.
    * All writes at this time complete in order, so a write blocked
@@ -565,6 +587,14 @@ public:
   eversion_t completed_to;
   eversion_t committed_to;
   void start_rmw(Op *op, PGTransactionUPtr &&t);
+  bool can_parity_delta(const Op &op);
+  bool parity_delta_blocked(const Op &op);
+  void start_parity_delta_read(Op *op);
+  void finish_parity_delta_read(
+    Op *op,
+    const set<int> &want,
+    read_result_t &res);
+  void start_remote_read(Op *op);
   bool try_state_to_reads();
   bool try_reads_to_commit();
   bool try_finish_rmw();
@@ -660,6 +690,7 @@ public:
     const set<int> &avail,
     const set<int> &want,
     const read_result_t &result,
+    const map<pg_shard_t, vector<pair<int, int>>> &already_read, ///< [in] subchunks requested so far
     map<pg_shard_t, vector<pair<int, int>>> *to_read,
     bool for_recovery);
 
@@ -81,6 +81,128 @@ void encode_and_write(
   }
 }
 
+int ECTransaction::chunk_to_shard(
+  const ErasureCodeInterfaceRef &ecimpl,
+  unsigned chunk)
+{
+  const vector<int> &mapping = ecimpl->get_chunk_mapping();
+  return mapping.size() > chunk ? mapping[chunk] : chunk;
+}
+
+void encode_delta_and_write(
+  pg_t pgid,
+  const hobject_t &oid,
+  const ECUtil::stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ecimpl,
+  const set<int> &delta_chunks,
+  const map<int, extent_map> &delta_reads,
+  uint64_t offset,
+  const extent_map &to_write,
+  uint32_t flags,
+  map<shard_id_t, ObjectStore::Transaction> *transactions,
+  DoutPrefixProvider *dpp) {
+  ceph_assert(sinfo.logical_offset_is_stripe_aligned(offset));
+  const uint64_t chunk_size = sinfo.get_chunk_size();
+  const uint64_t chunk_off =
+    sinfo.aligned_logical_offset_to_chunk_offset(offset);
+
+  // private copy of the current content of a chunk, it gets modified
+  auto read_chunk = [&](int shard) {
+    auto iter = delta_reads.find(shard);
+    ceph_assert(iter != delta_reads.end());
+    auto chunk = iter->second.intersect(chunk_off, chunk_size);
+    ceph_assert(chunk.ext_count() == 1);
+    ceph_assert(chunk.begin().get_off() == chunk_off);
+    ceph_assert(chunk.begin().get_len() == chunk_size);
+    bufferptr bp(buffer::create_page_aligned(chunk_size));
+    chunk.begin().get_val().begin().copy(chunk_size, bp.c_str());
+    return bp;
+  };
+  auto write_chunk = [&](int shard, bufferptr &bp) {
+    auto iter = transactions->find(shard_id_t(shard));
+    if (iter == transactions->end())
+      return;
+    bufferlist bl;
+    bl.append(bp);
+    iter->second.write(
+      coll_t(spg_t(pgid, iter->first)),
+      ghobject_t(oid, ghobject_t::NO_GEN, iter->first),
+      chunk_off,
+      bl.length(),
+      bl,
+      flags);
+  };
+
+  map<int, bufferptr> deltas;
+  for (int chunk : delta_chunks) {
+    uint64_t chunk_start = offset + chunk * chunk_size;
+    auto updates = to_write.intersect(chunk_start, chunk_size);
+    if (updates.empty())
+      continue;
+    int shard = ECTransaction::chunk_to_shard(ecimpl, chunk);
+    bufferptr old_data = read_chunk(shard);
+    bufferptr new_data(buffer::create_page_aligned(chunk_size));
+    new_data.copy_in(0, chunk_size, old_data.c_str());
+    for (auto &&update : updates) {
+      update.get_val().begin().copy(
+	update.get_len(),
+	new_data.c_str() + (update.get_off() - chunk_start));
+    }
+    ecimpl->encode_delta(old_data, new_data, &deltas[shard]);
+    ldpp_dout(dpp, 20) << __func__ << ": " << oid
+		       << " chunk " << chunk << " shard " << shard
+		       << " at " << chunk_off << dendl;
+    write_chunk(shard, new_data);
+  }
+  ceph_assert(!deltas.empty());
+
+  map<int, bufferptr> parity;
+  for (unsigned i = ecimpl->get_data_chunk_count();
+       i < ecimpl->get_chunk_count();
+       ++i) {
+    int shard = ECTransaction::chunk_to_shard(ecimpl, i);
+    parity[shard] = read_chunk(shard);
+  }
+  int r = ecimpl->apply_delta(deltas, &parity);
+  ceph_assert(r == 0);
+  for (auto &&p : parity) {
+    write_chunk(p.first, p.second);
+  }
+}
+
+set<int> ECTransaction::get_delta_chunks(
+  const ECUtil::stripe_info_t &sinfo,
+  const WritePlan &plan)
+{
+  set<int> chunks;
+  if (!plan.t ||
+      plan.invalidates_cache ||
+      plan.t->op_map.size() != 1 ||
+      plan.to_read.size() != 1)
+    return chunks;
+  const hobject_t &oid = plan.t->op_map.begin()->first;
+  const PGTransaction::ObjectOperation &op = plan.t->op_map.begin()->second;
+  if (oid.is_temp() ||
+      !op.is_none() ||
+      op.truncate ||
+      op.buffer_updates.empty() ||
+      plan.to_read.begin()->first != oid ||
+      !(plan.will_write.at(oid) == plan.to_read.at(oid)))
+    return chunks;
+
+  const uint64_t chunk_size = sinfo.get_chunk_size();
+  const uint64_t stripe_width = sinfo.get_stripe_width();
+  for (auto &&extent : op.buffer_updates) {
+    uint64_t end = extent.get_off() + extent.get_len();
+    for (uint64_t off = p2align(extent.get_off(), chunk_size);
+	 off < end && chunks.size() < stripe_width / chunk_size;
+	 off += chunk_size) {
+      chunks.insert((off % stripe_width) / chunk_size);
+    }
+  }
+  return chunks;
+}
+
 bool ECTransaction::requires_overwrite(
   uint64_t prev_size,
   const PGTransaction::ObjectOperation &op) {
@@ -105,7 +227,8 @@ void ECTransaction::generate_transactions(
   map<shard_id_t, ObjectStore::Transaction> *transactions,
   set<hobject_t> *temp_added,
   set<hobject_t> *temp_removed,
-  DoutPrefixProvider *dpp)
+  DoutPrefixProvider *dpp,
+  const map<int,extent_map> &delta_reads)
 {
   ceph_assert(written_map);
   ceph_assert(transactions);
@@ -539,35 +662,70 @@ void ECTransaction::generate_transactions(
       ldpp_dout(dpp, 20) << __func__ << ": to_overwrite: "
 			 << to_overwrite
 			 << dendl;
+      auto save_rollback = [&](uint64_t off, uint64_t len) {
+	uint64_t restore_from = sinfo.aligned_logical_offset_to_chunk_offset(
+	  off);
+	uint64_t restore_len = sinfo.aligned_logical_offset_to_chunk_offset(
+	  len);
+	ldpp_dout(dpp, 20) << __func__ << ": overwriting "
+			   << restore_from << "~" << restore_len
+			   << dendl;
+	if (rollback_extents.empty()) {
+	  for (auto &&st : *transactions) {
+	    st.second.touch(
+	      coll_t(spg_t(pgid, st.first)),
+	      ghobject_t(oid, entry->version.version, st.first));
+	  }
+	}
+	rollback_extents.emplace_back(make_pair(restore_from, restore_len));
+	for (auto &&st : *transactions) {
+	  st.second.clone_range(
+	    coll_t(spg_t(pgid, st.first)),
+	    ghobject_t(oid, ghobject_t::NO_GEN, st.first),
+	    ghobject_t(oid, entry->version.version, st.first),
+	    restore_from,
+	    restore_len,
+	    restore_from);
+	}
+      };
+      if (!plan.delta_chunks.empty()) {
+	/* Every stripe written is a partial one which was read, see
+	 * get_delta_chunks.  The whole stripe is still saved for rollback
+	 * on all shards as rollback_extents apply to every shard alike,
+	 * but only the changed data chunks and the coding chunks are
+	 * rewritten. */
+	ceph_assert(entry);
+	ceph_assert(to_write.intersect(
+		      append_after,
+		      std::numeric_limits<uint64_t>::max() - append_after).empty());
+	const extent_set &partial_stripes = plan.to_read.at(oid);
+	for (auto &&extent: partial_stripes) {
+	  save_rollback(extent.first, extent.second);
+	  for (uint64_t off = extent.first;
+	       off < extent.first + extent.second;
+	       off += sinfo.get_stripe_width()) {
+	    encode_delta_and_write(
+	      pgid,
+	      oid,
+	      sinfo,
+	      ecimpl,
+	      plan.delta_chunks,
+	      delta_reads,
+	      off,
+	      to_overwrite,
+	      fadvise_flags,
+	      transactions,
+	      dpp);
+	  }
+	}
+	to_overwrite.clear();
+      }
       for (auto &&extent: to_overwrite) {
 	ceph_assert(extent.get_off() + extent.get_len() <= append_after);
 	ceph_assert(sinfo.logical_offset_is_stripe_aligned(extent.get_off()));
 	ceph_assert(sinfo.logical_offset_is_stripe_aligned(extent.get_len()));
 	if (entry) {
-	  uint64_t restore_from = sinfo.aligned_logical_offset_to_chunk_offset(
-	    extent.get_off());
-	  uint64_t restore_len = sinfo.aligned_logical_offset_to_chunk_offset(
-	    extent.get_len());
-	  ldpp_dout(dpp, 20) << __func__ << ": overwriting "
-			     << restore_from << "~" << restore_len
-			     << dendl;
-	  if (rollback_extents.empty()) {
-	    for (auto &&st : *transactions) {
-	      st.second.touch(
-		coll_t(spg_t(pgid, st.first)),
-		ghobject_t(oid, entry->version.version, st.first));
-	    }
-	  }
-	  rollback_extents.emplace_back(make_pair(restore_from, restore_len));
-	  for (auto &&st : *transactions) {
-	    st.second.clone_range(
-	      coll_t(spg_t(pgid, st.first)),
-	      ghobject_t(oid, ghobject_t::NO_GEN, st.first),
-	      ghobject_t(oid, entry->version.version, st.first),
-	      restore_from,
-	      restore_len,
-	      restore_from);
-	  }
+	  save_rollback(extent.get_off(), extent.get_len());
 	}
 	encode_and_write(
 	  pgid,
@@ -30,6 +30,10 @@ namespace ECTransaction {
     map<hobject_t,extent_set> will_write; // superset of to_read
 
     map<hobject_t,ECUtil::HashInfoRef> hash_infos;
+
+    /// data chunks of the partial stripes to update with a parity delta
+    /// instead of a full stripe rmw, empty unless chosen by the backend
+    set<int> delta_chunks;
   };
 
   bool requires_overwrite(
@@ -182,6 +186,29 @@ namespace ECTransaction {
     return plan;
   }
 
+  /**
+   * Return the data chunk positions touched by the writes of a plan
+   * which qualifies for a parity delta update, or an empty set.  The
+   * plan must overwrite a single existing object in place, with every
+   * stripe it writes being a partial one (so no truncate, append,
+   * clone or delete), to_read then covers exactly the stripes whose
+   * parity needs updating.
+   */
+  set<int> get_delta_chunks(
+    const ECUtil::stripe_info_t &sinfo,
+    const WritePlan &plan);
+
+  /**
+   * Map a chunk position (data chunks first, in order) to the shard
+   * holding it, according to the plugin chunk mapping.
+   */
+  int chunk_to_shard(
+    const ErasureCodeInterfaceRef &ecimpl,
+    unsigned chunk);
+
+  /// delta_reads holds, when plan.delta_chunks is not empty, the current
+  /// content of to_read for the delta chunks and the coding chunks, keyed
+  /// by shard and chunk offset
   void generate_transactions(
     WritePlan &plan,
     ErasureCodeInterfaceRef &ecimpl,
@@ -193,7 +220,8 @@ namespace ECTransaction {
     map<shard_id_t, ObjectStore::Transaction> *transactions,
     set<hobject_t> *temp_added,
     set<hobject_t> *temp_removed,
-    DoutPrefixProvider *dpp);
+    DoutPrefixProvider *dpp,
+    const map<int,extent_map> &delta_reads = map<int,extent_map>());
 };
 
 #endif
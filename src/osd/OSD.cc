@@ -224,6 +224,7 @@ OSDService::OSDService(OSD *osd) :
   class_handler(osd->class_handler),
   osd_max_object_size(cct->_conf, "osd_max_object_size"),
   osd_skip_data_digest(cct->_conf, "osd_skip_data_digest"),
+  hot_conf(cct->_conf),
   publish_lock{ceph::make_mutex("OSDService::publish_lock")},
   pre_publish_lock{ceph::make_mutex("OSDService::pre_publish_lock")},
   max_oldest_map(0),
@@ -674,6 +675,112 @@ void OSDService::promote_throttle_recalibrate()
   promote_max_bytes = target_bytes_sec * osd->OSD_TICK_INTERVAL * 2;
 }
 
+osd_hot_conf_t::osd_hot_conf_t(const ConfigProxy& conf)
+  : scrub_pacing(conf.get_val<bool>("osd_scrub_pacing")),
+    scrub_pacing_client_latency(
+      conf.get_val<double>("osd_scrub_pacing_client_latency")),
+    scrub_pacing_store_latency(
+      conf.get_val<double>("osd_scrub_pacing_store_latency")),
+    scrub_pacing_max_sleep(conf.get_val<double>("osd_scrub_pacing_max_sleep")),
+    recovery_sleep_hybrid(conf.get_val<double>("osd_recovery_sleep_hybrid")),
+    delete_sleep(conf.get_val<double>("osd_delete_sleep")),
+    delete_sleep_ssd(conf.get_val<double>("osd_delete_sleep_ssd")),
+    delete_sleep_hybrid(conf.get_val<double>("osd_delete_sleep_hybrid")),
+    delete_sleep_hdd(conf.get_val<double>("osd_delete_sleep_hdd"))
+{}
+
+const char** osd_hot_conf_t::get_tracked_conf_keys()
+{
+  static const char* keys[] = {
+    "osd_scrub_pacing",
+    "osd_scrub_pacing_client_latency",
+    "osd_scrub_pacing_store_latency",
+    "osd_scrub_pacing_max_sleep",
+    "osd_recovery_sleep_hybrid",
+    "osd_delete_sleep",
+    "osd_delete_sleep_ssd",
+    "osd_delete_sleep_hybrid",
+    "osd_delete_sleep_hdd",
+    nullptr
+  };
+  return keys;
+}
+
+void OSDService::scrub_pacing_recalibrate()
+{
+  auto conf = hot_conf.get();
+  if (!conf->scrub_pacing) {
+    scrub_pace_millis = 1000;
+    logger->set(l_osd_scrub_pace, 1000);
+    return;
+  }
+  double target_client = conf->scrub_pacing_client_latency;
+  double target_store = conf->scrub_pacing_store_latency;
+
+  // average client op latency since the last tick; 0 if there were none
+  auto cur = logger->get_tavg_ns(l_osd_op_lat);
+  double client_lat = 0;
+  if (cur.first > scrub_pacing_op_lat.first) {
+    client_lat = (double)(cur.second - scrub_pacing_op_lat.second) /
+      (double)(cur.first - scrub_pacing_op_lat.first) / 1000000000.0;
+  }
+  scrub_pacing_op_lat = cur;
+  // the store keeps its own recent average
+  double store_lat = store->get_cur_stats().os_commit_latency_ns /
+    1000000000.0;
+
+  // multiplicative decrease, additive increase
+  unsigned min_pace = 10;
+  unsigned pace = scrub_pace_millis;
+  if ((target_client > 0 && client_lat > target_client) ||
+      (target_store > 0 && store_lat > target_store)) {
+    pace = std::max(pace / 2, min_pace);
+  } else {
+    pace = std::min(pace + 100, 1000u);
+  }
+  dout(10) << __func__ << " client op latency " << client_lat
+	   << " (target " << target_client << "), store latency " << store_lat
+	   << " (target " << target_store << "), pace "
+	   << scrub_pace_millis << " -> " << pace << dendl;
+  scrub_pace_millis = pace;
+  logger->set(l_osd_scrub_pace, pace);
+}
+
+int OSDService::get_scrub_chunk_max(int chunk_min, int chunk_max) const
+{
+  unsigned pace = scrub_pace_millis;
+  if (pace >= 1000 || chunk_max <= chunk_min) {
+    return chunk_max;
+  }
+  return chunk_min + (int)((int64_t)(chunk_max - chunk_min) * pace / 1000);
+}
+
+uint64_t OSDService::get_target_pg_log_entries() const
+{
+  auto num_pgs = osd->get_num_pgs();
+  auto target = cct->_conf->osd_target_pg_log_entries_per_osd;
+  uint64_t most = cct->_conf->osd_min_pg_log_entries;
+  if (num_pgs > 0 && target > 0) {
+    // spread the budget evenly; we only control the log length of the PGs
+    // we are primary for, but with a normal mix of primary and replica PGs
+    // that works out
+    uint64_t least = std::min<uint64_t>(
+      cct->_conf->osd_target_pg_log_entries_min, most);
+    return std::clamp<uint64_t>(target / num_pgs, least, most);
+  }
+  return most;
+}
+
+double OSDService::get_scrub_sleep() const
+{
+  double sleep = cct->_conf->osd_scrub_sleep;
+  unsigned pace = scrub_pace_millis;
+  if (pace < 1000) {
+    sleep += hot_conf->scrub_pacing_max_sleep * (1000 - pace) / 1000.0;
+  }
+  return sleep;
+}
+
 // -------------------------------------
 
 float OSDService::get_failsafe_full_ratio()
@@ -2107,6 +2214,15 @@ OSD::OSD(CephContext *cct_, ObjectStore *store_,
   test_ops_hook(NULL),
   op_queue(get_io_queue()),
   op_prio_cutoff(get_io_prio_cut()),
+  op_queue_steal(cct->_conf.get_val<bool>("osd_op_queue_work_stealing")),
+  op_queue_steal_min_depth(
+    cct->_conf.get_val<uint64_t>("osd_op_queue_steal_min_depth")),
+  op_queue_steal_interval(make_timespan(
+    cct->_conf.get_val<double>("osd_op_queue_steal_interval"))),
+  op_thread_spin_usec(
+    cct->_conf.get_val<uint64_t>("osd_op_thread_spin_usec")),
+  op_pg_batch_max(
+    cct->_conf.get_val<uint64_t>("osd_op_pg_batch_max")),
   op_shardedwq(
     this,
     cct->_conf->osd_op_thread_timeout,
@@ -2287,6 +2403,42 @@ int OSD::set_numa_affinity()
   return 0;
 }
 
+void OSD::set_shard_affinity()
+{
+  if (!cct->_conf.get_val<bool>("osd_op_thread_affinity_llc")) {
+    return;
+  }
+  auto cores = cct->_conf.get_val<std::string>("ms_async_affinity_cores");
+  size_t cpu_set_size;
+  cpu_set_t cpu_set;
+  if (cores.empty() ||
+      parse_cpu_set_list(cores.c_str(), &cpu_set_size, &cpu_set) < 0) {
+    dout(1) << __func__ << " ms_async_affinity_cores not set, not pinning"
+	    << dendl;
+    return;
+  }
+  // shard i follows messenger worker i, which NetworkStack pins to the
+  // i-th of these cpus
+  std::vector<int> cpus;
+  for (int cpu : cpu_set_to_set(cpu_set_size, &cpu_set)) {
+    cpus.push_back(cpu);
+  }
+  for (uint32_t i = 0; i < num_shards; i++) {
+    OSDShard *sdata = shards[i];
+    int cpu = cpus[i % cpus.size()];
+    int r = get_cpu_llc_cpu_set(cpu, &sdata->cpu_set_size, &sdata->cpu_set);
+    if (r < 0) {
+      dout(1) << __func__ << " unable to find llc cpus of cpu " << cpu
+	      << ": " << cpp_strerror(r) << dendl;
+      sdata->cpu_set_size = 0;
+      continue;
+    }
+    dout(1) << __func__ << " shard " << i << " cpus "
+	    << cpu_set_to_str_list(sdata->cpu_set_size, &sdata->cpu_set)
+	    << dendl;
+  }
+}
+
 // asok
 
 class OSDSocketHook : public AdminSocketHook {
@@ -2667,26 +2819,80 @@ int OSD::get_num_op_threads()
 
 float OSD::get_osd_recovery_sleep()
 {
+  // the scheduler already paces recovery against client io
+  if (mclock_profile_active)
+    return 0;
   if (cct->_conf->osd_recovery_sleep)
     return cct->_conf->osd_recovery_sleep;
   if (!store_is_rotational && !journal_is_rotational)
     return cct->_conf->osd_recovery_sleep_ssd;
   else if (store_is_rotational && !journal_is_rotational)
-    return cct->_conf.get_val<double>("osd_recovery_sleep_hybrid");
+    return service.hot_conf->recovery_sleep_hybrid;
   else
     return cct->_conf->osd_recovery_sleep_hdd;
 }
 
+void OSD::set_mclock_capacity()
+{
+  if (op_queue != io_queue::mclock_opclass &&
+      op_queue != io_queue::mclock_client) {
+    return;
+  }
+  if (cct->_conf.get_val<std::string>("osd_mclock_profile") == "custom") {
+    return;
+  }
+
+  double iops = cct->_conf.get_val<double>("osd_mclock_max_capacity_iops");
+  double bandwidth =
+    cct->_conf.get_val<double>("osd_mclock_max_capacity_bandwidth");
+  if (iops <= 0) {
+    int64_t bsize = 4096;
+    int64_t count =
+      bsize * cct->_conf.get_val<uint64_t>("osd_mclock_bench_ops");
+    double elapsed = run_osd_bench_test(count, bsize, 0, 0);
+    iops = elapsed > 0 ? count / bsize / elapsed : 0;
+  }
+  if (bandwidth <= 0) {
+    int64_t bsize = 4 << 20;
+    int64_t count =
+      cct->_conf.get_val<Option::size_t>("osd_mclock_bench_bytes");
+    count = std::max(count, bsize);
+    double elapsed = run_osd_bench_test(count, bsize, 0, 0);
+    bandwidth = elapsed > 0 ? count / elapsed : 0;
+  }
+  dout(1) << __func__ << " measured " << iops << " iops, "
+	  << byte_u_t(bandwidth) << "/s" << dendl;
+
+  for (auto shard : shards) {
+    // every shard runs the same share of the device's work
+    if (!shard->set_mclock_capacity(iops / num_shards,
+				    bandwidth / num_shards)) {
+      derr << __func__ << " unable to apply osd_mclock_profile, keeping "
+	   << "the osd_op_queue_mclock_* settings" << dendl;
+      return;
+    }
+  }
+  mclock_profile_active = true;
+}
+
 float OSD::get_osd_delete_sleep()
 {
-  float osd_delete_sleep = cct->_conf.get_val<double>("osd_delete_sleep");
-  if (osd_delete_sleep > 0)
-    return osd_delete_sleep;
+  auto conf = service.hot_conf.get();
+  if (conf->delete_sleep > 0)
+    return conf->delete_sleep;
   if (!store_is_rotational && !journal_is_rotational)
-    return cct->_conf.get_val<double>("osd_delete_sleep_ssd");
+    return conf->delete_sleep_ssd;
   if (store_is_rotational && !journal_is_rotational)
-    return cct->_conf.get_val<double>("osd_delete_sleep_hybrid");
-  return cct->_conf.get_val<double>("osd_delete_sleep_hdd");
+    return conf->delete_sleep_hybrid;
+  return conf->delete_sleep_hdd;
+}
+
+float OSD::get_osd_snap_trim_sleep()
+{
+  // snap trim work has its own class in the scheduler
+  if (mclock_profile_active)
+    return 0;
+  return cct->_conf->osd_snap_trim_sleep;
 }
 
 int OSD::init()
@@ -2892,6 +3098,9 @@ int OSD::init()
   dout(0) << "using " << op_queue << " op queue with priority op cut off at " <<
     op_prio_cutoff << "." << dendl;
 
+  // op threads aren't running yet, so the store is all ours to measure
+  set_mclock_capacity();
+
   create_logger();
 
   // prime osd stats
@@ -2990,6 +3199,7 @@ int OSD::init()
     }
   }
 
+  set_shard_affinity();
   osd_op_tp.start();
   command_tp.start();
 
@@ -3952,7 +4162,7 @@ void OSD::load_pgs()
     derr << "failed to list pgs: " << cpp_strerror(-r) << dendl;
   }
 
-  int num = 0;
+  vector<PGRef> pgs;
   for (vector<coll_t>::iterator it = ls.begin();
        it != ls.end();
        ++it) {
@@ -4006,19 +4216,51 @@ void OSD::load_pgs()
       continue;
     }
 
-    // there can be no waiters here, so we don't call _wake_pg_slot
-
-    pg->lock();
     pg->ch = store->open_collection(pg->coll);
+    pgs.push_back(pg);
+  }
+
+  // read pg state, log.  this is most of the time spent here, and the pgs
+  // don't depend on each other, so spread them over a few threads.
+  unsigned num_threads = cct->_conf.get_val<uint64_t>("osd_load_pgs_threads");
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  num_threads = std::min<size_t>(num_threads, pgs.size());
+  std::atomic<size_t> next_pg = {0};
+  auto read_pgs = [this, &pgs, &next_pg]() {
+    for (size_t i = next_pg++; i < pgs.size(); i = next_pg++) {
+      pgs[i]->lock();
+      pgs[i]->read_state(store);
+      pgs[i]->unlock();
+    }
+  };
+  if (num_threads > 1) {
+    dout(10) << __func__ << " reading " << pgs.size() << " pgs with "
+	     << num_threads << " threads" << dendl;
+    vector<std::thread> threads;
+    for (unsigned i = 0; i < num_threads; ++i) {
+      threads.push_back(make_named_thread("load_pgs", read_pgs));
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+  } else {
+    read_pgs();
+  }
 
-    // read pg state, log
-    pg->read_state(store);
+  int num = 0;
+  for (auto& pg : pgs) {
+    spg_t pgid = pg->pg_id;
 
+    // there can be no waiters here, so we don't call _wake_pg_slot
+
+    pg->lock();
     if (pg->dne())  {
-      dout(10) << "load_pgs " << *it << " deleting dne" << dendl;
+      dout(10) << "load_pgs " << pg->coll << " deleting dne" << dendl;
       pg->ch = nullptr;
       pg->unlock();
-      recursive_remove_collection(cct, store, pgid, *it);
+      recursive_remove_collection(cct, store, pgid, pg->coll);
       continue;
     }
     {
@@ -4679,11 +4921,23 @@ void OSD::handle_osd_ping(MOSDPing *m)
 
 void OSD::heartbeat_entry()
 {
-  std::lock_guard l(heartbeat_lock);
+  std::unique_lock l(heartbeat_lock);
   if (is_stopping())
     return;
   while (!heartbeat_stop) {
-    heartbeat();
+    vector<pair<ConnectionRef, Message*>> pings;
+    heartbeat(&pings);
+
+    // hundreds of peers' worth of pings; don't hold up handle_osd_ping
+    // (and its replies) while the messengers queue them
+    l.unlock();
+    for (auto& [con, m] : pings) {
+      con->send_message(m);
+    }
+    pings.clear();
+    l.lock();
+    if (is_stopping())
+      return;
 
     double wait = .5 + ((float)(rand() % 10)/10.0) * (float)cct->_conf->osd_heartbeat_interval;
     utime_t w;
@@ -4745,7 +4999,7 @@ void OSD::heartbeat_check()
   }
 }
 
-void OSD::heartbeat()
+void OSD::heartbeat(vector<pair<ConnectionRef, Message*>> *pings)
 {
   ceph_assert(heartbeat_lock.is_locked_by_me());
   dout(30) << "heartbeat" << dendl;
@@ -4799,16 +5053,20 @@ void OSD::heartbeat()
     i->second.ping_history[now] = make_pair(deadline,
       HeartbeatInfo::HEARTBEAT_MAX_CONN);
     dout(30) << "heartbeat sending ping to osd." << peer << dendl;
-    i->second.con_back->send_message(new MOSDPing(monc->get_fsid(),
-					  service.get_osdmap_epoch(),
-					  MOSDPing::PING, now,
-					  cct->_conf->osd_heartbeat_min_size));
-
+    auto send_ping = [&](const ConnectionRef& con) {
+      Message *m = new MOSDPing(monc->get_fsid(),
+				service.get_osdmap_epoch(),
+				MOSDPing::PING, now,
+				cct->_conf->osd_heartbeat_min_size);
+      if (pings) {
+	pings->emplace_back(con, m);
+      } else {
+	con->send_message(m);
+      }
+    };
+    send_ping(i->second.con_back);
     if (i->second.con_front)
-      i->second.con_front->send_message(new MOSDPing(monc->get_fsid(),
-					     service.get_osdmap_epoch(),
-					     MOSDPing::PING, now,
-					  cct->_conf->osd_heartbeat_min_size));
+      send_ping(i->second.con_front);
   }
 
   logger->set(l_osd_hb_to, heartbeat_peers.size());
@@ -4956,6 +5214,7 @@ void OSD::tick_without_osd_lock()
       sched_scrub();
     }
     service.promote_throttle_recalibrate();
+    service.scrub_pacing_recalibrate();
     resume_creating_pg();
     bool need_send_beacon = false;
     const auto now = ceph::coarse_mono_clock::now();
@@ -6048,6 +6307,84 @@ namespace {
   };
 }
 
+double OSD::run_osd_bench_test(int64_t count, int64_t bsize,
+			       int64_t osize, int64_t onum)
+{
+  dout(1) << " bench count " << count
+          << " bsize " << byte_u_t(bsize) << dendl;
+
+  ObjectStore::Transaction cleanupt;
+
+  if (osize && onum) {
+    bufferlist bl;
+    bufferptr bp(osize);
+    bp.zero();
+    bl.push_back(std::move(bp));
+    bl.rebuild_page_aligned();
+    for (int i=0; i<onum; ++i) {
+      char nm[30];
+      snprintf(nm, sizeof(nm), "disk_bw_test_%d", i);
+      object_t oid(nm);
+      hobject_t soid(sobject_t(oid, 0));
+      ObjectStore::Transaction t;
+      t.write(coll_t(), ghobject_t(soid), 0, osize, bl);
+      store->queue_transaction(service.meta_ch, std::move(t), NULL);
+      cleanupt.remove(coll_t(), ghobject_t(soid));
+    }
+  }
+
+  bufferlist bl;
+  bufferptr bp(bsize);
+  bp.zero();
+  bl.push_back(std::move(bp));
+  bl.rebuild_page_aligned();
+
+  {
+    C_SaferCond waiter;
+    if (!service.meta_ch->flush_commit(&waiter)) {
+      waiter.wait();
+    }
+  }
+
+  utime_t start = ceph_clock_now();
+  for (int64_t pos = 0; pos < count; pos += bsize) {
+    char nm[30];
+    unsigned offset = 0;
+    if (onum && osize) {
+      snprintf(nm, sizeof(nm), "disk_bw_test_%d", (int)(rand() % onum));
+      offset = rand() % (osize / bsize) * bsize;
+    } else {
+      snprintf(nm, sizeof(nm), "disk_bw_test_%lld", (long long)pos);
+    }
+    object_t oid(nm);
+    hobject_t soid(sobject_t(oid, 0));
+    ObjectStore::Transaction t;
+    t.write(coll_t::meta(), ghobject_t(soid), offset, bsize, bl);
+    store->queue_transaction(service.meta_ch, std::move(t), NULL);
+    if (!onum || !osize)
+      cleanupt.remove(coll_t::meta(), ghobject_t(soid));
+  }
+
+  {
+    C_SaferCond waiter;
+    if (!service.meta_ch->flush_commit(&waiter)) {
+      waiter.wait();
+    }
+  }
+  utime_t end = ceph_clock_now();
+
+  // clean up
+  store->queue_transaction(service.meta_ch, std::move(cleanupt), NULL);
+  {
+    C_SaferCond waiter;
+    if (!service.meta_ch->flush_commit(&waiter)) {
+      waiter.wait();
+    }
+  }
+
+  return end - start;
+}
+
 int OSD::_do_command(
   Connection *con, cmdmap_t& cmdmap, ceph_tid_t tid, bufferlist& data,
   bufferlist& odata, stringstream& ss, stringstream& ds)
@@ -6289,79 +6626,7 @@ int OSD::_do_command(
     if (osize && bsize > osize)
       bsize = osize;
 
-    dout(1) << " bench count " << count
-            << " bsize " << byte_u_t(bsize) << dendl;
-
-    ObjectStore::Transaction cleanupt;
-
-    if (osize && onum) {
-      bufferlist bl;
-      bufferptr bp(osize);
-      bp.zero();
-      bl.push_back(std::move(bp));
-      bl.rebuild_page_aligned();
-      for (int i=0; i<onum; ++i) {
-	char nm[30];
-	snprintf(nm, sizeof(nm), "disk_bw_test_%d", i);
-	object_t oid(nm);
-	hobject_t soid(sobject_t(oid, 0));
-	ObjectStore::Transaction t;
-	t.write(coll_t(), ghobject_t(soid), 0, osize, bl);
-	store->queue_transaction(service.meta_ch, std::move(t), NULL);
-	cleanupt.remove(coll_t(), ghobject_t(soid));
-      }
-    }
-
-    bufferlist bl;
-    bufferptr bp(bsize);
-    bp.zero();
-    bl.push_back(std::move(bp));
-    bl.rebuild_page_aligned();
-
-    {
-      C_SaferCond waiter;
-      if (!service.meta_ch->flush_commit(&waiter)) {
-	waiter.wait();
-      }
-    }
-
-    utime_t start = ceph_clock_now();
-    for (int64_t pos = 0; pos < count; pos += bsize) {
-      char nm[30];
-      unsigned offset = 0;
-      if (onum && osize) {
-	snprintf(nm, sizeof(nm), "disk_bw_test_%d", (int)(rand() % onum));
-	offset = rand() % (osize / bsize) * bsize;
-      } else {
-	snprintf(nm, sizeof(nm), "disk_bw_test_%lld", (long long)pos);
-      }
-      object_t oid(nm);
-      hobject_t soid(sobject_t(oid, 0));
-      ObjectStore::Transaction t;
-      t.write(coll_t::meta(), ghobject_t(soid), offset, bsize, bl);
-      store->queue_transaction(service.meta_ch, std::move(t), NULL);
-      if (!onum || !osize)
-	cleanupt.remove(coll_t::meta(), ghobject_t(soid));
-    }
-
-    {
-      C_SaferCond waiter;
-      if (!service.meta_ch->flush_commit(&waiter)) {
-	waiter.wait();
-      }
-    }
-    utime_t end = ceph_clock_now();
-
-    // clean up
-    store->queue_transaction(service.meta_ch, std::move(cleanupt), NULL);
-    {
-      C_SaferCond waiter;
-      if (!service.meta_ch->flush_commit(&waiter)) {
-	waiter.wait();
-      }
-    }
-
-    double elapsed = end - start;
+    double elapsed = run_osd_bench_test(count, bsize, osize, onum);
     double rate = count / elapsed;
     double iops = rate / bsize;
     if (f) {
@@ -6694,6 +6959,19 @@ void OSD::dispatch_session_waiting(SessionRef session, OSDMapRef osdmap)
   }
 }
 
+bool OSD::ms_get_data_buffer(Connection *con, int type, unsigned len,
+			     bufferptr *bp)
+{
+  // client write payloads go to the object store as they are; have them
+  // page aligned so the block device can take them without a bounce
+  // copy, whichever on-wire mode the connection uses
+  if (type != CEPH_MSG_OSD_OP) {
+    return false;
+  }
+  *bp = buffer::create_page_aligned(len);
+  return true;
+}
+
 void OSD::ms_fast_dispatch(Message *m)
 {
   FUNCTRACE(cct);
@@ -7511,14 +7789,28 @@ void OSD::handle_osd_map(MOSDMap *m)
 
       OSDMap *o = new OSDMap;
       if (e > 1) {
-	bufferlist obl;
-        bool got = get_map_bl(e - 1, obl);
-	if (!got) {
-	  auto p = added_maps_bl.find(e - 1);
-	  ceph_assert(p != added_maps_bl.end());
-	  obl = p->second;
+	// build on the previous epoch rather than decoding it again; o
+	// shares every container the incremental leaves alone, and so do
+	// the buffers encode() produces for them below
+	OSDMapRef prev;
+	auto a = added_maps.find(e - 1);
+	if (a != added_maps.end()) {
+	  prev = a->second;
+	} else {
+	  prev = service.try_get_map(e - 1);
+	}
+	if (prev) {
+	  o->share_from(*prev);
+	} else {
+	  bufferlist obl;
+	  bool got = get_map_bl(e - 1, obl);
+	  if (!got) {
+	    auto p = added_maps_bl.find(e - 1);
+	    ceph_assert(p != added_maps_bl.end());
+	    obl = p->second;
+	  }
+	  o->decode(obl);
 	}
-	o->decode(obl);
       }
 
       OSDMap::Incremental inc;
@@ -8652,7 +8944,15 @@ void OSD::dispatch_context(PeeringCtx &ctx, PG *pg, OSDMapRef curmap,
     dout(20) << __func__ << " not up in osdmap" << dendl;
   } else if (!is_active()) {
     dout(20) << __func__ << " not active" << dendl;
+  } else if (pg &&
+	     cct->_conf.get_val<uint64_t>("osd_peering_msg_batch_pgs") > 1) {
+    queue_peering_msgs(ctx, pg);
   } else {
+    if (pg) {
+      // batching was just turned off; don't overtake what is left
+      maybe_send_peering_msgs(shards[pg->pg_id.hash_to_shard(num_shards)],
+			      true);
+    }
     do_notifies(ctx.notify_list, curmap);
     do_queries(ctx.query_map, curmap);
     do_infos(ctx.info_map, curmap);
@@ -8765,6 +9065,80 @@ void OSD::do_infos(map<int,
   info_map.clear();
 }
 
+/** queue_peering_msgs
+ * Let the peering messages of a pg wait in its shard, so that those of
+ * the next pgs peering with the same osds go out in the same messages.
+ */
+void OSD::queue_peering_msgs(PeeringCtx &ctx, PG *pg)
+{
+  if (ctx.query_map.empty() && ctx.info_map.empty() &&
+      ctx.notify_list.empty()) {
+    return;
+  }
+  OSDShard *sdata = shards[pg->pg_id.hash_to_shard(num_shards)];
+  std::lock_guard l(sdata->peering_msgs_lock);
+  auto& msgs = sdata->peering_msgs;
+  for (auto& [target, qmap] : ctx.query_map) {
+    auto& omap = msgs.query_map[target];
+    for (auto& [pgid, query] : qmap) {
+      omap[pgid] = query;
+    }
+  }
+  for (auto& [target, ivec] : ctx.info_map) {
+    auto& ovec = msgs.info_map[target];
+    ovec.insert(ovec.end(), ivec.begin(), ivec.end());
+  }
+  for (auto& [target, nlist] : ctx.notify_list) {
+    auto& ovec = msgs.notify_list[target];
+    ovec.insert(ovec.end(), nlist.begin(), nlist.end());
+  }
+  ctx.query_map.clear();
+  ctx.info_map.clear();
+  ctx.notify_list.clear();
+  if (sdata->peering_msgs_pgs++ == 0) {
+    sdata->peering_msgs_since = ceph::mono_clock::now();
+  }
+  _maybe_send_peering_msgs(sdata);
+}
+
+void OSD::maybe_send_peering_msgs(OSDShard *sdata, bool force)
+{
+  if (!sdata->peering_msgs_pgs) {
+    return;
+  }
+  std::lock_guard l(sdata->peering_msgs_lock);
+  _maybe_send_peering_msgs(sdata, force);
+}
+
+/// send the batch once the shard runs out of work, it is full or it is
+/// older than osd_peering_msg_batch_max_delay
+void OSD::_maybe_send_peering_msgs(OSDShard *sdata, bool force)
+{
+  ceph_assert(ceph_mutex_is_locked(sdata->peering_msgs_lock));
+  if (!sdata->peering_msgs_pgs) {
+    return;
+  }
+  if (!force &&
+      sdata->queue_depth > 0 &&
+      sdata->peering_msgs_pgs <
+	cct->_conf.get_val<uint64_t>("osd_peering_msg_batch_pgs") &&
+      ceph::mono_clock::now() - sdata->peering_msgs_since <
+	ceph::make_timespan(
+	  cct->_conf.get_val<double>("osd_peering_msg_batch_max_delay"))) {
+    return;
+  }
+  dout(20) << __func__ << " shard " << sdata->shard_id << " sending for "
+	   << sdata->peering_msgs_pgs << " pgs" << dendl;
+  OSDMapRef curmap = sdata->get_osdmap();
+  if (curmap->is_up(whoami) && is_active()) {
+    do_notifies(sdata->peering_msgs.notify_list, curmap);
+    do_queries(sdata->peering_msgs.query_map, curmap);
+    do_infos(sdata->peering_msgs.info_map, curmap);
+  }
+  sdata->peering_msgs = BufferedRecoveryMessages();
+  sdata->peering_msgs_pgs = 0;
+}
+
 void OSD::handle_fast_pg_create(MOSDPGCreate2 *m)
 {
   dout(7) << __func__ << " " << *m << " from " << m->get_source() << dendl;
@@ -9868,6 +10242,18 @@ epoch_t OSDShard::get_max_waiting_epoch()
   return r;
 }
 
+bool OSDShard::set_mclock_capacity(double iops, double bandwidth)
+{
+  std::lock_guard l(shard_lock);
+  if (auto q = dynamic_cast<ceph::mClockOpClassQueue*>(pqueue.get())) {
+    return q->set_capacity(cct, iops, bandwidth);
+  }
+  if (auto q = dynamic_cast<ceph::mClockClientQueue*>(pqueue.get())) {
+    return q->set_capacity(cct, iops, bandwidth);
+  }
+  return false;
+}
+
 void OSDShard::consume_map(
   OSDMapRef& new_osdmap,
   unsigned *pushes_to_free)
@@ -9985,6 +10371,7 @@ void OSDShard::_wake_pg_slot(
     }
   }
   slot->waiting_peering.clear();
+  slot->handed_off = 0;
   ++slot->requeue_seq;
 }
 
@@ -10205,10 +10592,85 @@ void OSD::ShardedOpWQ::_add_slot_waiter(
 #undef dout_prefix
 #define dout_prefix *_dout << "osd." << osd->whoami << " op_wq(" << shard_index << ") "
 
+void OSD::ShardedOpWQ::_thread_start(uint32_t thread_index)
+{
+  uint32_t shard_index = thread_index % osd->num_shards;
+  auto sdata = osd->shards[shard_index];
+  if (sdata->cpu_set_size &&
+      sched_setaffinity(0, sizeof(sdata->cpu_set), &sdata->cpu_set) < 0) {
+    int r = errno;
+    derr << __func__ << " failed to pin to "
+	 << cpu_set_to_str_list(sdata->cpu_set_size, &sdata->cpu_set)
+	 << ": " << cpp_strerror(r) << dendl;
+  }
+}
+
+void OSD::ShardedOpWQ::_spin_for_work(OSDShard *sdata,
+					 bool is_smallest_thread_index)
+{
+  // a single spinner per shard is enough to pick up the next item without
+  // a futex round trip; more would only burn cpus
+  bool expected = false;
+  if (!sdata->spinning.compare_exchange_strong(expected, true)) {
+    return;
+  }
+  const unsigned max_usec = osd->op_thread_spin_usec;
+  const unsigned min_usec = std::max(max_usec / 8, 1u);
+  unsigned budget = sdata->spin_usec;
+  if (budget == 0) {
+    budget = max_usec;
+  }
+
+  auto deadline = ceph::mono_clock::now() + std::chrono::microseconds(budget);
+  bool found = false;
+  do {
+    if (sdata->queue_depth > 0 ||
+	(is_smallest_thread_index && !sdata->context_queue.empty())) {
+      found = true;
+      break;
+    }
+  } while (ceph::mono_clock::now() < deadline);
+
+  // shrink the budget while the shard stays idle, so a quiet osd does not
+  // keep a core per shard busy; grow it back once spinning pays off
+  if (found) {
+    sdata->spin_usec = std::min(budget * 2, max_usec);
+    sdata->logger->inc(l_osd_shard_spin_hits);
+  } else {
+    sdata->spin_usec = std::max(budget / 2, min_usec);
+    sdata->logger->inc(l_osd_shard_spin_misses);
+  }
+  sdata->spinning = false;
+}
+
+OSDShard *OSD::ShardedOpWQ::_steal_shard(uint32_t shard_index)
+{
+  OSDShard *victim = nullptr;
+  unsigned victim_depth = osd->op_queue_steal_min_depth;
+  for (uint32_t i = 1; i < osd->num_shards; ++i) {
+    OSDShard *s = osd->shards[(shard_index + i) % osd->num_shards];
+    unsigned depth = s->queue_depth;
+    if (depth >= victim_depth && depth > 0) {
+      victim = s;
+      victim_depth = depth;
+    }
+  }
+  if (!victim) {
+    return nullptr;
+  }
+  victim->shard_lock.lock();
+  if (victim->pqueue->empty()) {
+    // drained by its own threads in the meantime
+    victim->shard_lock.unlock();
+    return nullptr;
+  }
+  return victim;
+}
+
 void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
 {
   uint32_t shard_index = thread_index % osd->num_shards;
-  auto& sdata = osd->shards[shard_index];
+  OSDShard *sdata = osd->shards[shard_index];
   ceph_assert(sdata);
 
   // If all threads of shards do oncommits, there is a out-of-order
@@ -10217,8 +10679,41 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
   // callback.
   bool is_smallest_thread_index = thread_index < osd->num_shards;
 
+  // flush batched peering messages before we go to sleep or when they
+  // have waited long enough behind other work
+  osd->maybe_send_peering_msgs(sdata);
+
   // peek at spg_t
   sdata->shard_lock.lock();
+  if (osd->op_queue_steal &&
+      sdata->pqueue->empty() &&
+      (!is_smallest_thread_index || sdata->context_queue.empty())) {
+    // Nothing to do here; act as one more thread of a backed up shard.
+    // Everything below runs under that shard's lock and pg slots, exactly
+    // as for its own threads, so per-PG ordering is unaffected.  Its
+    // oncommits stay with its own smallest thread.
+    sdata->shard_lock.unlock();
+    OSDShard *victim = _steal_shard(shard_index);
+    if (victim) {
+      dout(20) << __func__ << " shard " << shard_index << " stealing from "
+	       << victim->shard_id << dendl;
+      sdata->logger->inc(l_osd_shard_steals);
+      victim->logger->inc(l_osd_shard_stolen);
+      sdata = victim;
+      is_smallest_thread_index = false;
+    } else {
+      sdata->shard_lock.lock();
+    }
+  }
+  if (osd->op_thread_spin_usec &&
+      sdata->pqueue->empty() &&
+      (!is_smallest_thread_index || sdata->context_queue.empty())) {
+    // on fast devices the next op is often only a few usec away; poll for
+    // it before paying for a sleep and wakeup on sdata_cond
+    sdata->shard_lock.unlock();
+    _spin_for_work(sdata, is_smallest_thread_index);
+    sdata->shard_lock.lock();
+  }
   if (sdata->pqueue->empty() &&
       (!is_smallest_thread_index || sdata->context_queue.empty())) {
     std::unique_lock wait_lock{sdata->sdata_wait_lock};
@@ -10229,7 +10724,12 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
       dout(20) << __func__ << " empty q, waiting" << dendl;
       osd->cct->get_heartbeat_map()->clear_timeout(hb);
       sdata->shard_lock.unlock();
-      sdata->sdata_cond.wait(wait_lock);
+      if (osd->op_queue_steal) {
+	// wake up now and then to look at the other shards
+	sdata->sdata_cond.wait_for(wait_lock, osd->op_queue_steal_interval);
+      } else {
+	sdata->sdata_cond.wait(wait_lock);
+      }
       wait_lock.unlock();
       sdata->shard_lock.lock();
       if (sdata->pqueue->empty() &&
@@ -10266,7 +10766,7 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
     return;
   }
 
-  OpQueueItem item = sdata->pqueue->dequeue();
+  OpQueueItem item = sdata->_dequeue();
   if (osd->is_stopping()) {
     sdata->shard_lock.unlock();
     for (auto c : oncommits) {
@@ -10291,6 +10791,19 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
   slot->to_process.push_back(std::move(item));
   dout(20) << __func__ << " " << slot->to_process.back()
 	   << " queued" << dendl;
+  if (slot->batching &&
+      slot->to_process.size() == slot->handed_off + 1 &&
+      slot->to_process.back().maybe_get_op()) {
+    // the thread holding the pg lock runs it after its own op; only
+    // when nothing with a thread of its own is queued ahead, so each
+    // waiting thread still finds an item to pop
+    ++slot->handed_off;
+    dout(20) << __func__ << " " << token << " handed off, "
+	     << slot->handed_off << " pending" << dendl;
+    sdata->shard_lock.unlock();
+    handle_oncommits(oncommits);
+    return;
+  }
 
  retry_pg:
   PGRef pg = slot->pg;
@@ -10452,6 +10965,18 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
       return;
     }
   }
+  std::optional<OpRequestRef> batch_op;
+  uint64_t batch_requeue_seq = 0;
+  if (pg && osd->op_pg_batch_max > 1) {
+    batch_op = qi.maybe_get_op();
+    if (batch_op) {
+      ceph_assert(!slot->batching);
+      slot->batching = true;
+      // keeps the slot from being pruned while we run
+      ++slot->num_running;
+      batch_requeue_seq = slot->requeue_seq;
+    }
+  }
   sdata->shard_lock.unlock();
 
   if (!new_children.empty()) {
@@ -10483,7 +11008,11 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
   delete f;
   *_dout << dendl;
 
-  qi.run(osd, sdata, pg, tp_handle);
+  if (batch_op) {
+    _run_op_batch(sdata, token, pg, *batch_op, batch_requeue_seq, tp_handle);
+  } else {
+    qi.run(osd, sdata, pg, tp_handle);
+  }
 
   {
 #ifdef WITH_LTTNG
@@ -10499,23 +11028,76 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
   handle_oncommits(oncommits);
 }
 
+void OSD::ShardedOpWQ::_run_op_batch(
+  OSDShard *sdata,
+  spg_t token,
+  PGRef& pg,
+  OpRequestRef op,
+  uint64_t requeue_seq,
+  ThreadPool::TPHandle& tp_handle)
+{
+  unsigned ran = 0;
+  unsigned requeued = 0;
+  while (true) {
+    osd->dequeue_op(pg, op, tp_handle);
+    ++ran;
+    tp_handle.reset_tp_timeout();
+
+    std::lock_guard l{sdata->shard_lock};
+    auto q = sdata->pg_slots.find(token);
+    if (q == sdata->pg_slots.end()) {
+      // unprime_split_children requeued whatever was handed off to us
+      break;
+    }
+    OSDShardPGSlot *slot = q->second.get();
+    if (slot->handed_off > 0 &&
+	ran < osd->op_pg_batch_max &&
+	slot->requeue_seq == requeue_seq &&
+	slot->pg == pg &&
+	!osd->is_stopping()) {
+      if (auto next = slot->to_process.front().maybe_get_op(); next) {
+	dout(20) << __func__ << " " << token << " "
+		 << slot->to_process.front() << dendl;
+	op = *next;
+	slot->to_process.pop_front();
+	--slot->handed_off;
+	sdata->logger->inc(l_osd_shard_batched_ops);
+	continue;
+      }
+    }
+    slot->batching = false;
+    --slot->num_running;
+    // the threads of what is left gave up on it; like _enqueue_front,
+    // requeue from the back so the threads still waiting for the pg lock
+    // take the older items and nothing is reordered
+    while (slot->handed_off > 0) {
+      sdata->_enqueue_front(std::move(slot->to_process.back()),
+			    osd->op_prio_cutoff);
+      slot->to_process.pop_back();
+      --slot->handed_off;
+      ++requeued;
+    }
+    break;
+  }
+  dout(20) << __func__ << " " << token << " ran " << ran
+	   << ", requeued " << requeued << dendl;
+  pg->unlock();
+  if (requeued) {
+    std::lock_guard l{sdata->sdata_wait_lock};
+    sdata->sdata_cond.notify_all();
+  }
+}
+
 void OSD::ShardedOpWQ::_enqueue(OpQueueItem&& item) {
   uint32_t shard_index =
     item.get_ordering_token().hash_to_shard(osd->shards.size());
 
   OSDShard* sdata = osd->shards[shard_index];
   assert (NULL != sdata);
-  unsigned priority = item.get_priority();
-  unsigned cost = item.get_cost();
   sdata->shard_lock.lock();
 
   dout(20) << __func__ << " " << item << dendl;
-  if (priority >= osd->op_prio_cutoff)
-    sdata->pqueue->enqueue_strict(
-      item.get_owner(), priority, std::move(item));
-  else
-    sdata->pqueue->enqueue(
-      item.get_owner(), priority, cost, std::move(item));
+  sdata->_enqueue(std::move(item), osd->op_prio_cutoff);
   sdata->shard_lock.unlock();
 
   std::lock_guard l{sdata->sdata_wait_lock};
@@ -104,6 +104,22 @@ class MOSDForceRecovery;
 
 class OSD;
 
+/// options read on the op, scrub and recovery paths
+struct osd_hot_conf_t {
+  bool scrub_pacing;
+  double scrub_pacing_client_latency;
+  double scrub_pacing_store_latency;
+  double scrub_pacing_max_sleep;
+  double recovery_sleep_hybrid;
+  double delete_sleep;
+  double delete_sleep_ssd;
+  double delete_sleep_hybrid;
+  double delete_sleep_hdd;
+
+  explicit osd_hot_conf_t(const ConfigProxy& conf);
+  static const char** get_tracked_conf_keys();
+};
+
 class OSDService {
 public:
   OSD *osd;
@@ -125,6 +141,7 @@ public:
 
   md_config_cacher_t<Option::size_t> osd_max_object_size;
   md_config_cacher_t<bool> osd_skip_data_digest;
+  md_config_snapshot_t<osd_hot_conf_t> hot_conf;
 
   void enqueue_back(OpQueueItem&& qi);
   void enqueue_front(OpQueueItem&& qi);
@@ -492,6 +509,10 @@ private:
   utime_t last_recalibrate;
   unsigned long promote_max_objects, promote_max_bytes;
 
+  /// scrub pacing, in thousandths of full speed. one word.
+  std::atomic<unsigned int> scrub_pace_millis{1000};
+  std::pair<uint64_t, uint64_t> scrub_pacing_op_lat; ///< (count, ns) at last tick
+
 public:
   bool promote_throttle() {
     // NOTE: lockless!  we rely on the probability being a single word.
@@ -511,6 +532,14 @@ public:
   }
   void promote_throttle_recalibrate();
 
+  /// back scrub off while clients or the store are slow; called per tick
+  void scrub_pacing_recalibrate();
+  /// chunk size to use for a chunky scrub given the configured range
+  int get_scrub_chunk_max(int chunk_min, int chunk_max) const;
+  uint64_t get_target_pg_log_entries() const;
+  /// delay between scrub chunks
+  double get_scrub_sleep() const;
+
   // -- Objecter, for tiering reads/writes from/to other OSDs --
   Objecter *objecter;
   int m_objecter_finishers;
@@ -967,6 +996,13 @@ struct OSDShardPGSlot {
 
   /// waiting for a merge (source or target) by this epoch
   epoch_t waiting_for_merge_epoch = 0;
+
+  /// set while a _process thread holding the pg lock takes on the ops
+  /// queued behind its own (osd_op_pg_batch_max)
+  bool batching = false;
+  /// items in to_process whose _process thread left them to the batching
+  /// thread instead of waiting for the pg lock
+  unsigned handed_off = 0;
 };
 
 struct OSDShard {
@@ -1017,10 +1053,49 @@ struct OSDShard {
   /// priority queue
   std::unique_ptr<OpQueue<OpQueueItem, uint64_t>> pqueue;
 
+  /// items in pqueue; updated under shard_lock, read without it by
+  /// threads of other shards looking for work to steal
+  std::atomic<unsigned> queue_depth = {0};
+
+  /// set while one of this shard's threads polls queue_depth before
+  /// blocking (osd_op_thread_spin_usec); the others block right away
+  std::atomic<bool> spinning = {false};
+  /// current spin budget (usec): halved when a spin finds nothing, doubled
+  /// up to osd_op_thread_spin_usec when it does
+  std::atomic<unsigned> spin_usec = {0};
+
+  /// CPUs this shard's threads run on (osd_op_thread_affinity_llc); empty
+  /// when unpinned
+  size_t cpu_set_size = 0;
+  cpu_set_t cpu_set;
+
+  PerfCounters *logger = nullptr;
+
   bool stop_waiting = false;
 
   ContextQueue context_queue;
 
+  /// peering messages of this shard's pgs, batched per peer osd across
+  /// pgs (osd_peering_msg_batch_pgs); sent under the lock to keep them
+  /// in order
+  ceph::mutex peering_msgs_lock =
+    ceph::make_mutex("OSDShard::peering_msgs_lock");
+  BufferedRecoveryMessages peering_msgs;
+  std::atomic<unsigned> peering_msgs_pgs = {0};
+  ceph::mono_time peering_msgs_since;
+
+  void _enqueue(OpQueueItem&& item, unsigned cutoff) {
+    unsigned priority = item.get_priority();
+    unsigned cost = item.get_cost();
+    if (priority >= cutoff)
+      pqueue->enqueue_strict(
+	item.get_owner(), priority, std::move(item));
+    else
+      pqueue->enqueue(
+	item.get_owner(), priority, cost, std::move(item));
+    logger->set(l_osd_shard_queue_depth, ++queue_depth);
+  }
+
   void _enqueue_front(OpQueueItem&& item, unsigned cutoff) {
     unsigned priority = item.get_priority();
     unsigned cost = item.get_cost();
@@ -1032,6 +1107,12 @@ struct OSDShard {
       pqueue->enqueue_front(
 	item.get_owner(),
 	priority, cost, std::move(item));
+    logger->set(l_osd_shard_queue_depth, ++queue_depth);
+  }
+
+  OpQueueItem _dequeue() {
+    logger->set(l_osd_shard_queue_depth, --queue_depth);
+    return pqueue->dequeue();
   }
 
   void _attach_pg(OSDShardPGSlot *slot, PG *pg);
@@ -1044,6 +1125,9 @@ struct OSDShard {
   /// return newest epoch we are waiting for
   epoch_t get_max_waiting_epoch();
 
+  /// apply osd_mclock_profile for this share of the store's capacity
+  bool set_mclock_capacity(double iops, double bandwidth);
+
   /// push osdmap into shard
   void consume_map(
     OSDMapRef& osdmap,
@@ -1093,6 +1177,12 @@ struct OSDShard {
     } else if (opqueue == io_queue::mclock_client) {
       pqueue = std::make_unique<ceph::mClockClientQueue>(cct);
     }
+    logger = build_osd_shard_logger(cct, id);
+    cct->get_perfcounters_collection()->add(logger);
+  }
+  ~OSDShard() {
+    cct->get_perfcounters_collection()->remove(logger);
+    delete logger;
   }
 };
 
@@ -1454,7 +1544,9 @@ private:
   void heartbeat_clear_peers_need_update() {
     heartbeat_need_update.store(false);
   }
-  void heartbeat();
+  /// send pings to all peers; if @pings is given, queue them there for
+  /// the caller to send once heartbeat_lock is dropped
+  void heartbeat(vector<pair<ConnectionRef, Message*>> *pings = nullptr);
   void heartbeat_check();
   void heartbeat_entry();
   void need_heartbeat_peer_update();
@@ -1532,6 +1624,14 @@ private:
   const io_queue op_queue;
 public:
   const unsigned int op_prio_cutoff;
+  /// idle shard threads may take queued items from backed up shards
+  const bool op_queue_steal;
+  const unsigned op_queue_steal_min_depth;
+  const ceph::timespan op_queue_steal_interval;
+  /// idle shard threads poll for this long before blocking
+  const unsigned op_thread_spin_usec;
+  /// ops run for a pg per pg lock hold
+  const unsigned op_pg_batch_max;
 protected:
 
   /*
@@ -1578,6 +1678,21 @@ protected:
       OSDShardPGSlot *slot,
       OpQueueItem&& qi);
 
+    /// find the most backed up shard other than ours; returns it locked
+    OSDShard *_steal_shard(uint32_t shard_index);
+
+    /// busy-poll an empty shard for a while; called without shard_lock
+    void _spin_for_work(OSDShard *sdata, bool is_smallest_thread_index);
+
+    /// run op, then the ops handed off to us for the same pg, and unlock
+    /// the pg; called without shard_lock
+    void _run_op_batch(OSDShard *sdata, spg_t token, PGRef& pg,
+		       OpRequestRef op, uint64_t requeue_seq,
+		       ThreadPool::TPHandle& tp_handle);
+
+    /// pin the thread next to its shard's messenger workers
+    void _thread_start(uint32_t thread_index) override;
+
     /// try to do some work
     void _process(uint32_t thread_index, heartbeat_handle_d *hb) override;
 
@@ -1870,6 +1985,9 @@ protected:
   void do_infos(map<int,
 		    vector<pair<pg_notify_t, PastIntervals> > >& info_map,
 		OSDMapRef map);
+  void queue_peering_msgs(PeeringCtx &ctx, PG *pg);
+  void maybe_send_peering_msgs(OSDShard *sdata, bool force = false);
+  void _maybe_send_peering_msgs(OSDShard *sdata, bool force = false);
 
   bool require_mon_peer(const Message *m);
   bool require_mon_or_mgr_peer(const Message *m);
@@ -2026,6 +2144,8 @@ private:
     }
   }
   void ms_fast_dispatch(Message *m) override;
+  bool ms_get_data_buffer(Connection *con, int type, unsigned len,
+			  bufferptr *bp) override;
   bool ms_dispatch(Message *m) override;
   void ms_handle_connect(Connection *con) override;
   void ms_handle_fast_connect(Connection *con) override;
@@ -2116,8 +2236,19 @@ private:
   int get_num_op_shards();
   int get_num_op_threads();
 
+  /// benchmark the store (see the "bench" command); returns seconds
+  double run_osd_bench_test(int64_t count, int64_t bsize,
+			    int64_t osize, int64_t onum);
+  /// size the mclock queues from osd_mclock_profile, measuring the store
+  /// unless its capacity is configured
+  void set_mclock_capacity();
+  /// set once a profile has taken over from the osd_op_queue_mclock_*
+  /// settings and osd_recovery_sleep
+  bool mclock_profile_active = false;
+
   float get_osd_recovery_sleep();
   float get_osd_delete_sleep();
+  float get_osd_snap_trim_sleep();
 
   void probe_smart(const string& devid, ostream& ss);
 
@@ -2137,6 +2268,7 @@ public:
 
   int enable_disable_fuse(bool stop);
   int set_numa_affinity();
+  void set_shard_affinity();
 
   void suicide(int exitcode);
   int shutdown();
@@ -1324,15 +1324,16 @@ void OSDMap::set_max_osd(int m)
     osd_state[o] = 0;
     osd_weight[o] = CEPH_OSD_OUT;
   }
-  osd_info.resize(m);
+  _cow(osd_info, osd_info_enc).resize(m);
   osd_xinfo.resize(m);
-  osd_addrs->client_addrs.resize(m);
-  osd_addrs->cluster_addrs.resize(m);
-  osd_addrs->hb_back_addrs.resize(m);
-  osd_addrs->hb_front_addrs.resize(m);
-  osd_uuid->resize(m);
+  auto& addrs = _cow(osd_addrs);
+  addrs.client_addrs.resize(m);
+  addrs.cluster_addrs.resize(m);
+  addrs.hb_back_addrs.resize(m);
+  addrs.hb_front_addrs.resize(m);
+  _cow(osd_uuid).resize(m);
   if (osd_primary_affinity)
-    osd_primary_affinity->resize(m, CEPH_OSD_DEFAULT_PRIMARY_AFFINITY);
+    _cow(osd_primary_affinity).resize(m, CEPH_OSD_DEFAULT_PRIMARY_AFFINITY);
 
   calc_num_osds();
 }
@@ -1659,55 +1660,78 @@ void OSDMap::dedup(const OSDMap *o, OSDMap *n)
   int diff = 0;
 
   // do addrs match?
-  if (o->max_osd != n->max_osd)
-    diff++;
-  for (int i = 0; i < o->max_osd && i < n->max_osd; i++) {
-    if ( n->osd_addrs->client_addrs[i] &&  o->osd_addrs->client_addrs[i] &&
-	*n->osd_addrs->client_addrs[i] == *o->osd_addrs->client_addrs[i])
-      n->osd_addrs->client_addrs[i] = o->osd_addrs->client_addrs[i];
-    else
-      diff++;
-    if ( n->osd_addrs->cluster_addrs[i] &&  o->osd_addrs->cluster_addrs[i] &&
-	*n->osd_addrs->cluster_addrs[i] == *o->osd_addrs->cluster_addrs[i])
-      n->osd_addrs->cluster_addrs[i] = o->osd_addrs->cluster_addrs[i];
-    else
+  if (o->osd_addrs != n->osd_addrs) {
+    if (o->max_osd != n->max_osd)
       diff++;
-    if ( n->osd_addrs->hb_back_addrs[i] &&  o->osd_addrs->hb_back_addrs[i] &&
-	*n->osd_addrs->hb_back_addrs[i] == *o->osd_addrs->hb_back_addrs[i])
-      n->osd_addrs->hb_back_addrs[i] = o->osd_addrs->hb_back_addrs[i];
-    else
-      diff++;
-    if ( n->osd_addrs->hb_front_addrs[i] &&  o->osd_addrs->hb_front_addrs[i] &&
-	*n->osd_addrs->hb_front_addrs[i] == *o->osd_addrs->hb_front_addrs[i])
-      n->osd_addrs->hb_front_addrs[i] = o->osd_addrs->hb_front_addrs[i];
-    else
-      diff++;
-  }
-  if (diff == 0) {
-    // zoinks, no differences at all!
-    n->osd_addrs = o->osd_addrs;
+    // n may share its addrs with yet another epoch
+    _cow(n->osd_addrs);
+    for (int i = 0; i < o->max_osd && i < n->max_osd; i++) {
+      if ( n->osd_addrs->client_addrs[i] &&  o->osd_addrs->client_addrs[i] &&
+	  *n->osd_addrs->client_addrs[i] == *o->osd_addrs->client_addrs[i])
+	n->osd_addrs->client_addrs[i] = o->osd_addrs->client_addrs[i];
+      else
+	diff++;
+      if ( n->osd_addrs->cluster_addrs[i] &&  o->osd_addrs->cluster_addrs[i] &&
+	  *n->osd_addrs->cluster_addrs[i] == *o->osd_addrs->cluster_addrs[i])
+	n->osd_addrs->cluster_addrs[i] = o->osd_addrs->cluster_addrs[i];
+      else
+	diff++;
+      if ( n->osd_addrs->hb_back_addrs[i] &&  o->osd_addrs->hb_back_addrs[i] &&
+	  *n->osd_addrs->hb_back_addrs[i] == *o->osd_addrs->hb_back_addrs[i])
+	n->osd_addrs->hb_back_addrs[i] = o->osd_addrs->hb_back_addrs[i];
+      else
+	diff++;
+      if ( n->osd_addrs->hb_front_addrs[i] &&  o->osd_addrs->hb_front_addrs[i] &&
+	  *n->osd_addrs->hb_front_addrs[i] == *o->osd_addrs->hb_front_addrs[i])
+	n->osd_addrs->hb_front_addrs[i] = o->osd_addrs->hb_front_addrs[i];
+      else
+	diff++;
+    }
+    if (diff == 0) {
+      // zoinks, no differences at all!
+      n->osd_addrs = o->osd_addrs;
+    }
   }
 
+  // maps built by share_from() already share whatever did not change,
+  // so compare pointers before contents
+
   // does crush match?
-  ceph::buffer::list oc, nc;
-  encode(*o->crush, oc, CEPH_FEATURES_SUPPORTED_DEFAULT);
-  encode(*n->crush, nc, CEPH_FEATURES_SUPPORTED_DEFAULT);
-  if (oc.contents_equal(nc)) {
-    n->crush = o->crush;
+  if (o->crush != n->crush) {
+    ceph::buffer::list oc, nc;
+    encode(*o->crush, oc, CEPH_FEATURES_SUPPORTED_DEFAULT);
+    encode(*n->crush, nc, CEPH_FEATURES_SUPPORTED_DEFAULT);
+    if (oc.contents_equal(nc)) {
+      n->crush = o->crush;
+    }
   }
 
   // does pg_temp match?
-  if (*o->pg_temp == *n->pg_temp)
+  if (o->pg_temp != n->pg_temp &&
+      *o->pg_temp == *n->pg_temp) {
     n->pg_temp = o->pg_temp;
+    n->pg_temp_enc = o->pg_temp_enc;
+  }
 
   // does primary_temp match?
-  if (o->primary_temp->size() == n->primary_temp->size()) {
-    if (*o->primary_temp == *n->primary_temp)
+  if (o->primary_temp != n->primary_temp &&
+      o->primary_temp->size() == n->primary_temp->size()) {
+    if (*o->primary_temp == *n->primary_temp) {
       n->primary_temp = o->primary_temp;
+      n->primary_temp_enc = o->primary_temp_enc;
+    }
+  }
+
+  // does osd_info match?
+  if (o->osd_info != n->osd_info &&
+      *o->osd_info == *n->osd_info) {
+    n->osd_info = o->osd_info;
+    n->osd_info_enc = o->osd_info_enc;
   }
 
   // do uuids match?
-  if (o->osd_uuid->size() == n->osd_uuid->size() &&
+  if (o->osd_uuid != n->osd_uuid &&
+      o->osd_uuid->size() == n->osd_uuid->size() &&
       *o->osd_uuid == *n->osd_uuid)
     n->osd_uuid = o->osd_uuid;
 }
@@ -2086,20 +2110,35 @@ int OSDMap::apply_incremental(const Incremental &inc)
     set_erasure_code_profile(profile.first, profile.second);
   }
   
+  // containers we may share with the previous epoch (see share_from())
+  // are copied before they are changed, and only if they are changed
+  if (!inc.new_state.empty() || !inc.new_up_client.empty() ||
+      !inc.new_up_thru.empty() || !inc.new_last_clean_interval.empty() ||
+      !inc.new_lost.empty()) {
+    _cow(osd_info, osd_info_enc);
+  }
+  if (!inc.new_state.empty() || !inc.new_up_client.empty() ||
+      !inc.new_up_cluster.empty()) {
+    _cow(osd_addrs);
+  }
+  if (!inc.new_state.empty() || !inc.new_uuid.empty()) {
+    _cow(osd_uuid);
+  }
+
   // up/down
   for (const auto &state : inc.new_state) {
     const auto osd = state.first;
     int s = state.second ? state.second : CEPH_OSD_UP;
     if ((osd_state[osd] & CEPH_OSD_UP) &&
 	(s & CEPH_OSD_UP)) {
-      osd_info[osd].down_at = epoch;
+      (*osd_info)[osd].down_at = epoch;
       osd_xinfo[osd].down_stamp = modified;
     }
     if ((osd_state[osd] & CEPH_OSD_EXISTS) &&
 	(s & CEPH_OSD_EXISTS)) {
       // osd is destroyed; clear out anything interesting.
       (*osd_uuid)[osd] = uuid_d();
-      osd_info[osd] = osd_info_t();
+      (*osd_info)[osd] = osd_info_t();
       osd_xinfo[osd] = osd_xinfo_t();
       set_primary_affinity(osd, CEPH_OSD_DEFAULT_PRIMARY_AFFINITY);
       osd_addrs->client_addrs[osd].reset(new entity_addrvec_t());
@@ -2122,7 +2161,7 @@ int OSDMap::apply_incremental(const Incremental &inc)
     osd_addrs->hb_front_addrs[client.first].reset(
       new entity_addrvec_t(inc.new_hb_front_up.find(client.first)->second));
 
-    osd_info[client.first].up_from = epoch;
+    (*osd_info)[client.first].up_from = epoch;
   }
 
   for (const auto &cluster : inc.new_up_cluster)
@@ -2131,15 +2170,15 @@ int OSDMap::apply_incremental(const Incremental &inc)
 
   // info
   for (const auto &thru : inc.new_up_thru)
-    osd_info[thru.first].up_thru = thru.second;
+    (*osd_info)[thru.first].up_thru = thru.second;
   
   for (const auto &interval : inc.new_last_clean_interval) {
-    osd_info[interval.first].last_clean_begin = interval.second.first;
-    osd_info[interval.first].last_clean_end = interval.second.second;
+    (*osd_info)[interval.first].last_clean_begin = interval.second.first;
+    (*osd_info)[interval.first].last_clean_end = interval.second.second;
   }
   
   for (const auto &lost : inc.new_lost)
-    osd_info[lost.first].lost_at = lost.second;
+    (*osd_info)[lost.first].lost_at = lost.second;
 
   // xinfo
   for (const auto &xinfo : inc.new_xinfo)
@@ -2150,22 +2189,26 @@ int OSDMap::apply_incremental(const Incremental &inc)
     (*osd_uuid)[uuid.first] = uuid.second;
 
   // pg rebuild
-  for (const auto &pg : inc.new_pg_temp) {
-    if (pg.second.empty())
-      pg_temp->erase(pg.first);
-    else
-      pg_temp->set(pg.first, pg.second);
-  }
   if (!inc.new_pg_temp.empty()) {
+    auto& temp = _cow(pg_temp, pg_temp_enc);
+    for (const auto &pg : inc.new_pg_temp) {
+      if (pg.second.empty())
+	temp.erase(pg.first);
+      else
+	temp.set(pg.first, pg.second);
+    }
     // make sure pg_temp is efficiently stored
-    pg_temp->rebuild();
+    temp.rebuild();
   }
 
-  for (const auto &pg : inc.new_primary_temp) {
-    if (pg.second == -1)
-      primary_temp->erase(pg.first);
-    else
-      (*primary_temp)[pg.first] = pg.second;
+  if (!inc.new_primary_temp.empty()) {
+    auto& temp = _cow(primary_temp, primary_temp_enc);
+    for (const auto &pg : inc.new_primary_temp) {
+      if (pg.second == -1)
+	temp.erase(pg.first);
+      else
+	temp[pg.first] = pg.second;
+    }
   }
 
   for (auto& p : inc.new_pg_upmap) {
@@ -2573,7 +2616,8 @@ void OSDMap::pg_to_raw_up(pg_t pg, vector<int> *up, int *primary) const
 void OSDMap::_pg_to_up_acting_osds(
   const pg_t& pg, vector<int> *up, int *up_primary,
   vector<int> *acting, int *acting_primary,
-  bool raw_pg_to_pg) const
+  bool raw_pg_to_pg,
+  vector<int> *raw_upmap) const
 {
   const pg_pool_t *pool = get_pg_pool(pg.pool());
   if (!pool ||
@@ -2586,6 +2630,8 @@ void OSDMap::_pg_to_up_acting_osds(
       acting->clear();
     if (acting_primary)
       *acting_primary = -1;
+    if (raw_upmap)
+      raw_upmap->clear();
     return;
   }
   vector<int> raw;
@@ -2595,10 +2641,12 @@ void OSDMap::_pg_to_up_acting_osds(
   int _acting_primary;
   ps_t pps;
   _get_temp_osds(*pool, pg, &_acting, &_acting_primary);
-  if (_acting.empty() || up || up_primary) {
+  if (_acting.empty() || up || up_primary || raw_upmap) {
     _pg_to_raw_osds(*pool, pg, &raw, &pps);
     _apply_upmap(*pool, pg, &raw);
     _raw_to_up_osds(*pool, raw, &_up);
+    if (raw_upmap)
+      *raw_upmap = raw;
     _up_primary = _pick_primary(_up);
     _apply_primary_affinity(pps, *pool, &_up, &_up_primary);
     if (_acting.empty()) {
@@ -2788,7 +2836,7 @@ void OSDMap::encode_classic(ceph::buffer::list& bl, uint64_t features) const
   __u16 ev = 10;
   encode(ev, bl);
   encode(osd_addrs->hb_back_addrs, bl, features);
-  encode(osd_info, bl);
+  encode(*osd_info, bl);
   encode(blacklist, bl, features);
   encode(osd_addrs->cluster_addrs, bl, features);
   encode(cluster_snapshot_epoch, bl);
@@ -2802,6 +2850,25 @@ void OSDMap::encode_classic(ceph::buffer::list& bl, uint64_t features) const
  * refer to
  *    doc/dev/osd_internals/osdmap_versions.txt
  */
+template<typename T>
+void OSDMap::_encode_section(const T& v, encoded_section_t *enc,
+			     ceph::buffer::list& bl)
+{
+  using ceph::encode;
+  if (!enc) {
+    encode(v, bl);
+    return;
+  }
+  std::lock_guard l(enc->lock);
+  if (!enc->valid) {
+    enc->bl.clear();
+    encode(v, enc->bl);
+    enc->valid = true;
+  }
+  // shares the buffers, so the crc below is mostly cache hits
+  bl.append(enc->bl);
+}
+
 void OSDMap::encode(ceph::buffer::list& bl, uint64_t features) const
 {
   using ceph::encode;
@@ -2877,8 +2944,8 @@ void OSDMap::encode(ceph::buffer::list& bl, uint64_t features) const
       encode_addrvec_pvec_as_addr(osd_addrs->client_addrs, bl, features);
     }
 
-    encode(*pg_temp, bl);
-    encode(*primary_temp, bl);
+    _encode_section(*pg_temp, pg_temp_enc.get(), bl);
+    _encode_section(*primary_temp, primary_temp_enc.get(), bl);
     if (osd_primary_affinity) {
       encode(*osd_primary_affinity, bl);
     } else {
@@ -2930,7 +2997,7 @@ void OSDMap::encode(ceph::buffer::list& bl, uint64_t features) const
     } else {
       encode(osd_addrs->hb_back_addrs, bl, features);
     }
-    encode(osd_info, bl);
+    _encode_section(*osd_info, osd_info_enc.get(), bl);
     {
       // put this in a sorted, ordered map<> so that we encode in a
       // deterministic order.
@@ -3092,7 +3159,7 @@ void OSDMap::decode_classic(ceph::buffer::list::const_iterator& p)
   if (v >= 5)
     decode(ev, p);
   decode(osd_addrs->hb_back_addrs, p);
-  decode(osd_info, p);
+  decode(*osd_info, p);
   if (v < 5)
     decode(pool_name, p);
 
@@ -3130,6 +3197,18 @@ void OSDMap::decode_classic(ceph::buffer::list::const_iterator& p)
 void OSDMap::decode(ceph::buffer::list::const_iterator& bl)
 {
   using ceph::decode;
+
+  // never decode into containers another epoch may be sharing
+  osd_addrs = std::make_shared<addrs_s>();
+  pg_temp = std::make_shared<PGTempMap>();
+  primary_temp = std::make_shared<mempool::osdmap::map<pg_t,int32_t>>();
+  osd_info = std::make_shared<mempool::osdmap::vector<osd_info_t>>();
+  osd_uuid = std::make_shared<mempool::osdmap::vector<uuid_d>>();
+  crush = std::make_shared<CrushWrapper>();
+  pg_temp_enc = std::make_shared<encoded_section_t>();
+  primary_temp_enc = std::make_shared<encoded_section_t>();
+  osd_info_enc = std::make_shared<encoded_section_t>();
+
   /**
    * Older encodings of the OSDMap had a single struct_v which
    * covered the whole encoding, and was prior to our modern
@@ -3234,7 +3313,7 @@ void OSDMap::decode(ceph::buffer::list::const_iterator& bl)
   {
     DECODE_START(9, bl); // extended, osd-only data
     decode(osd_addrs->hb_back_addrs, bl);
-    decode(osd_info, bl);
+    decode(*osd_info, bl);
     decode(blacklist, bl);
     decode(osd_addrs->cluster_addrs, bl);
     decode(cluster_snapshot_epoch, bl);
@@ -4619,7 +4698,18 @@ int OSDMap::calc_pg_upmaps(
 
     set<pg_t> to_unmap;
     map<pg_t, mempool::osdmap::vector<pair<int32_t,int32_t>>> to_upmap;
-    auto temp_pgs_by_osd = pgs_by_osd;
+    // copy-on-write overlay of pgs_by_osd: a candidate change only
+    // touches a few osds, so don't copy every osd's pg set for each try
+    map<int,set<pg_t>> temp_pgs_by_osd;
+    auto temp_pgs = [&](int osd) -> set<pg_t>& {
+      auto t = temp_pgs_by_osd.find(osd);
+      if (t == temp_pgs_by_osd.end()) {
+        auto q = pgs_by_osd.find(osd);
+        t = temp_pgs_by_osd.emplace(
+          osd, q != pgs_by_osd.end() ? q->second : set<pg_t>()).first;
+      }
+      return t->second;
+    };
     // always start with fullest, break if we find any changes to make
     for (auto p = deviation_osd.rbegin(); p != deviation_osd.rend(); ++p) {
       if (skip_overfull) {
@@ -4668,8 +4758,8 @@ int OSDMap::calc_pg_upmaps(
                            << " which remapped " << pg
                            << " into overfull osd." << osd
                            << dendl;
-            temp_pgs_by_osd[q.second].erase(pg);
-            temp_pgs_by_osd[q.first].insert(pg);
+            temp_pgs(q.second).erase(pg);
+            temp_pgs(q.first).insert(pg);
           } else {
             new_upmap_items.push_back(q);
           }
@@ -4750,8 +4840,8 @@ int OSDMap::calc_pg_upmaps(
                          << dendl;
           existing.insert(orig[i]);
           existing.insert(out[i]);
-          temp_pgs_by_osd[orig[i]].erase(pg);
-          temp_pgs_by_osd[out[i]].insert(pg);
+          temp_pgs(orig[i]).erase(pg);
+          temp_pgs(out[i]).insert(pg);
           ceph_assert(new_upmap_items.size() < (size_t)pg_pool_size);
           new_upmap_items.push_back(make_pair(orig[i], out[i]));
           // append new remapping pairs slowly
@@ -4814,8 +4904,8 @@ int OSDMap::calc_pg_upmaps(
                            << " which remapped " << pg
                            << " out from underfull osd." << osd
                            << dendl;
-            temp_pgs_by_osd[j.second].erase(pg);
-            temp_pgs_by_osd[j.first].insert(pg);
+            temp_pgs(j.second).erase(pg);
+            temp_pgs(j.first).insert(pg);
           } else {
             new_upmap_items.push_back(j);
           }
@@ -4871,10 +4961,15 @@ int OSDMap::calc_pg_upmaps(
     for (auto& i : temp_pgs_by_osd) {
       // make sure osd is still there (belongs to this crush-tree)
       ceph_assert(osd_weight.count(i.first));
+    }
+    for (auto& i : pgs_by_osd) {
+      auto t = temp_pgs_by_osd.find(i.first);
+      size_t num_pgs = (t != temp_pgs_by_osd.end() ? t->second.size() :
+                        i.second.size());
       float target = osd_weight[i.first] * pgs_per_weight;
-      float deviation = (float)i.second.size() - target;
+      float deviation = (float)num_pgs - target;
       ldout(cct, 20) << " osd." << i.first
-                     << "\tpgs " << i.second.size()
+                     << "\tpgs " << num_pgs
                      << "\ttarget " << target
                      << "\tdeviation " << deviation
                      << dendl;
@@ -4914,7 +5009,9 @@ int OSDMap::calc_pg_upmaps(
     // ready to go
     ceph_assert(new_stddev < stddev);
     stddev = new_stddev;
-    pgs_by_osd = temp_pgs_by_osd;
+    for (auto& i : temp_pgs_by_osd) {
+      pgs_by_osd[i.first].swap(i.second);
+    }
     osd_deviation = temp_osd_deviation;
     deviation_osd = temp_deviation_osd;
     for (auto& i : to_unmap) {
@@ -33,6 +33,7 @@
 #include <boost/smart_ptr/local_shared_ptr.hpp>
 #include "include/btree_map.h"
 #include "include/types.h"
+#include "common/ceph_mutex.h"
 #include "common/ceph_releases.h"
 #include "osd_types.h"
 
@@ -81,6 +82,15 @@ struct osd_info_t {
   void encode(ceph::buffer::list& bl) const;
   void decode(ceph::buffer::list::const_iterator& bl);
   static void generate_test_instances(std::list<osd_info_t*>& o);
+
+  friend bool operator==(const osd_info_t& l, const osd_info_t& r) {
+    return l.last_clean_begin == r.last_clean_begin &&
+      l.last_clean_end == r.last_clean_end &&
+      l.up_from == r.up_from &&
+      l.up_thru == r.up_thru &&
+      l.down_at == r.down_at &&
+      l.lost_at == r.lost_at;
+  }
 };
 WRITE_CLASS_ENCODER(osd_info_t)
 
@@ -553,7 +563,7 @@ private:
   entity_addrvec_t _blank_addrvec;
 
   mempool::osdmap::vector<__u32>   osd_weight;   // 16.16 fixed point, 0x10000 = "in", 0 = "out"
-  mempool::osdmap::vector<osd_info_t> osd_info;
+  std::shared_ptr< mempool::osdmap::vector<osd_info_t> > osd_info;
   std::shared_ptr<PGTempMap> pg_temp;  // temp pg mapping (e.g. while we rebuild)
   std::shared_ptr< mempool::osdmap::map<pg_t,int32_t > > primary_temp;  // temp primary mapping (e.g. while we rebuild)
   std::shared_ptr< mempool::osdmap::vector<__u32> > osd_primary_affinity; ///< 16.16 fixed point, 0x10000 = baseline
@@ -600,6 +610,43 @@ private:
   mutable bool crc_defined;
   mutable uint32_t crc;
 
+  /**
+   * The encoding of a shared container, filled on first encode.
+   *
+   * It travels with the container, so epochs that share the container
+   * also share its encoded buffers, and the crc those buffers cache:
+   * re-encoding a map whose big containers did not change costs little
+   * more than encoding what did.
+   */
+  struct encoded_section_t {
+    ceph::mutex lock = ceph::make_mutex("OSDMap::encoded_section_t");
+    bool valid = false;
+    ceph::buffer::list bl;
+  };
+  std::shared_ptr<encoded_section_t> pg_temp_enc;
+  std::shared_ptr<encoded_section_t> primary_temp_enc;
+  std::shared_ptr<encoded_section_t> osd_info_enc;
+
+  template<typename T>
+  static void _encode_section(const T& v, encoded_section_t *enc,
+			      ceph::buffer::list& bl);
+
+  /// get a container we can change, copying it if another epoch shares it
+  template<typename T>
+  static T& _cow(std::shared_ptr<T>& p) {
+    if (p.use_count() > 1)
+      p = std::make_shared<T>(*p);
+    return *p;
+  }
+  /// ...and forget its encoding
+  template<typename T>
+  static T& _cow(std::shared_ptr<T>& p,
+		 std::shared_ptr<encoded_section_t>& enc) {
+    if (!enc || enc.use_count() > 1 || enc->valid)
+      enc = std::make_shared<encoded_section_t>();
+    return _cow(p);
+  }
+
   void _calc_up_osd_features();
 
  public:
@@ -611,6 +658,7 @@ private:
   uint32_t crush_version = 1;
 
   friend class OSDMonitor;
+  friend class OSDMapMapping;
 
  public:
   OSDMap() : epoch(0), 
@@ -619,6 +667,7 @@ private:
 	     num_osd(0), num_up_osd(0), num_in_osd(0),
 	     max_osd(0),
 	     osd_addrs(std::make_shared<addrs_s>()),
+	     osd_info(std::make_shared<mempool::osdmap::vector<osd_info_t>>()),
 	     pg_temp(std::make_shared<PGTempMap>()),
 	     primary_temp(std::make_shared<mempool::osdmap::map<pg_t,int32_t>>()),
 	     osd_uuid(std::make_shared<mempool::osdmap::vector<uuid_d>>()),
@@ -657,6 +706,13 @@ public:
     // allocate a new CrushWrapper, though.
   }
 
+  /// share every container with o.  apply_incremental() copies only
+  /// the ones it changes, so a run of epochs built this way costs about
+  /// one map plus the deltas.
+  void share_from(const OSDMap& o) {
+    *this = o;
+  }
+
   // map info
   const uuid_d& get_fsid() const { return fsid; }
   void set_fsid(uuid_d& f) { fsid = f; }
@@ -770,7 +826,7 @@ public:
       osd_primary_affinity.reset(
 	new mempool::osdmap::vector<__u32>(
 	  max_osd, CEPH_OSD_DEFAULT_PRIMARY_AFFINITY));
-    (*osd_primary_affinity)[o] = w;
+    _cow(osd_primary_affinity)[o] = w;
   }
   unsigned get_primary_affinity(int o) const {
     ceph_assert(o < max_osd);
@@ -961,19 +1017,19 @@ public:
 
   const epoch_t& get_up_from(int osd) const {
     ceph_assert(exists(osd));
-    return osd_info[osd].up_from;
+    return (*osd_info)[osd].up_from;
   }
   const epoch_t& get_up_thru(int osd) const {
     ceph_assert(exists(osd));
-    return osd_info[osd].up_thru;
+    return (*osd_info)[osd].up_thru;
   }
   const epoch_t& get_down_at(int osd) const {
     ceph_assert(exists(osd));
-    return osd_info[osd].down_at;
+    return (*osd_info)[osd].down_at;
   }
   const osd_info_t& get_info(int osd) const {
     ceph_assert(osd < max_osd);
-    return osd_info[osd];
+    return (*osd_info)[osd];
   }
 
   const osd_xinfo_t& get_xinfo(int osd) const {
@@ -1179,7 +1235,8 @@ private:
    */
   void _pg_to_up_acting_osds(const pg_t& pg, std::vector<int> *up, int *up_primary,
                              std::vector<int> *acting, int *acting_primary,
-			     bool raw_pg_to_pg = true) const;
+			     bool raw_pg_to_pg = true,
+			     std::vector<int> *raw_upmap = nullptr) const;
 
 public:
   /***
@@ -1219,6 +1276,17 @@ public:
     int up_primary, acting_primary;
     pg_to_up_acting_osds(pg, &up, &up_primary, &acting, &acting_primary);
   }
+  /**
+   * as above, and also return the raw set (crush output with upmaps
+   * applied) that the up set was derived from.
+   */
+  void pg_to_raw_up_acting_osds(pg_t pg, std::vector<int> *raw_upmap,
+				std::vector<int> *up, int *up_primary,
+				std::vector<int> *acting,
+				int *acting_primary) const {
+    _pg_to_up_acting_osds(pg, up, up_primary, acting, acting_primary, true,
+			  raw_upmap);
+  }
   bool pg_is_ec(pg_t pg) const {
     auto i = pools.find(pg.pool());
     ceph_assert(i != pools.end());
@@ -1477,8 +1545,8 @@ public:
   int validate_crush_rules(CrushWrapper *crush, std::ostream *ss) const;
 
   void clear_temp() {
-    pg_temp->clear();
-    primary_temp->clear();
+    _cow(pg_temp, pg_temp_enc).clear();
+    _cow(primary_temp, primary_temp_enc).clear();
   }
 
 private:
@@ -42,11 +42,169 @@ void OSDMapMapping::_init_mappings(const OSDMap& osdmap)
   ceph_assert(pools.size() == osdmap.get_pools().size());
 }
 
+// Work out which pgs the new map can have moved since the last complete
+// update.  Only osd up/down and primary affinity changes are tracked per
+// pg; crush, weight, existence and max_osd changes can redirect any crush
+// descent, so they (and a previous update that was aborted) dirty every
+// pool.  @return false if everything needs remapping.
+bool OSDMapMapping::_get_dirty(
+  const OSDMap& osdmap,
+  std::set<int64_t> *dirty_pools,
+  std::vector<pg_t> *dirty_pgs) const
+{
+  auto all = [&]() {
+    for (auto& p : osdmap.get_pools()) {
+      dirty_pools->insert(p.first);
+    }
+    return false;
+  };
+  if (!last.complete ||
+      last.crush != osdmap.crush ||
+      last.crush_version != osdmap.get_crush_version() ||
+      last.max_osd != osdmap.get_max_osd() ||
+      last.osd_weight != osdmap.osd_weight) {
+    return all();
+  }
+
+  // osds whose up state or primary affinity changed
+  std::vector<char> raw_mask(osdmap.get_max_osd(), 0);
+  std::vector<char> up_mask(osdmap.get_max_osd(), 0);
+  bool any_osd = false;
+  for (int o = 0; o < osdmap.get_max_osd(); ++o) {
+    uint32_t changed = last.osd_state[o] ^ osdmap.osd_state[o];
+    if (changed & CEPH_OSD_EXISTS) {
+      return all();
+    }
+    if (changed & CEPH_OSD_UP) {
+      raw_mask[o] = 1;
+      any_osd = true;
+    }
+    auto affinity = [o](const auto& pa) {
+      return pa ? (*pa)[o] : CEPH_OSD_DEFAULT_PRIMARY_AFFINITY;
+    };
+    if (affinity(last.osd_primary_affinity) !=
+	affinity(osdmap.osd_primary_affinity)) {
+      up_mask[o] = 1;
+      any_osd = true;
+    }
+  }
+
+  std::set<pg_t> pgs;
+  for (auto& p : osdmap.get_pools()) {
+    auto q = pools.find(p.first);
+    ceph_assert(q != pools.end());
+    if (q->second.stale ||
+	q->second.last_change != p.second.last_change) {
+      dirty_pools->insert(p.first);
+      continue;
+    }
+    if (!any_osd) {
+      continue;
+    }
+    for (unsigned ps = 0; ps < q->second.pg_num; ++ps) {
+      if (q->second.uses(ps, raw_mask, up_mask)) {
+	pgs.insert(pg_t(ps, p.first));
+      }
+    }
+  }
+
+  // pg_temp members are filtered by up state too
+  if (any_osd) {
+    for (auto p : *osdmap.pg_temp) {
+      for (auto o : p.second) {
+	if (o >= 0 && o < osdmap.get_max_osd() && raw_mask[o]) {
+	  pgs.insert(p.first);
+	  break;
+	}
+      }
+    }
+  }
+
+  // explicit mappings that were added, removed or changed
+  auto diff = [&pgs](const auto& a, const auto& b) {
+    auto i = a.begin();
+    auto j = b.begin();
+    while (i != a.end() || j != b.end()) {
+      if (j == b.end() || (i != a.end() && (*i).first < (*j).first)) {
+	pgs.insert((*i).first);
+	++i;
+      } else if (i == a.end() || (*j).first < (*i).first) {
+	pgs.insert((*j).first);
+	++j;
+      } else {
+	if (!((*i).second == (*j).second)) {
+	  pgs.insert((*i).first);
+	}
+	++i;
+	++j;
+      }
+    }
+  };
+  if (last.pg_temp != osdmap.pg_temp) {
+    diff(*last.pg_temp, *osdmap.pg_temp);
+  }
+  if (last.primary_temp != osdmap.primary_temp) {
+    diff(*last.primary_temp, *osdmap.primary_temp);
+  }
+  diff(last.pg_upmap, osdmap.pg_upmap);
+  diff(last.pg_upmap_items, osdmap.pg_upmap_items);
+
+  for (auto pgid : pgs) {
+    auto q = pools.find(pgid.pool());
+    if (q == pools.end() ||
+	dirty_pools->count(pgid.pool()) ||
+	pgid.ps() >= q->second.pg_num) {
+      continue;
+    }
+    dirty_pgs->push_back(pgid);
+  }
+  return true;
+}
+
+void OSDMapMapping::_save_inputs(const OSDMap& osdmap)
+{
+  last.complete = false;  // until _finish
+  last.max_osd = osdmap.get_max_osd();
+  last.crush_version = osdmap.get_crush_version();
+  last.crush = osdmap.crush;
+  last.osd_state = osdmap.osd_state;
+  last.osd_weight = osdmap.osd_weight;
+  last.osd_primary_affinity = osdmap.osd_primary_affinity;
+  last.pg_temp = osdmap.pg_temp;
+  last.primary_temp = osdmap.primary_temp;
+  last.pg_upmap = osdmap.pg_upmap;
+  last.pg_upmap_items = osdmap.pg_upmap_items;
+  for (auto& p : osdmap.get_pools()) {
+    auto& pm = pools.at(p.first);
+    pm.stale = false;
+    pm.last_change = p.second.last_change;
+  }
+}
+
+uint64_t OSDMapMapping::_count(
+  const std::set<int64_t>& dirty_pools,
+  const std::vector<pg_t>& dirty_pgs) const
+{
+  uint64_t n = dirty_pgs.size();
+  for (auto pool : dirty_pools) {
+    n += pools.at(pool).pg_num;
+  }
+  return n;
+}
+
 void OSDMapMapping::update(const OSDMap& osdmap)
 {
+  std::set<int64_t> dirty_pools;
+  std::vector<pg_t> dirty_pgs;
   _start(osdmap);
-  for (auto& p : osdmap.get_pools()) {
-    _update_range(osdmap, p.first, 0, p.second.get_pg_num());
+  _get_dirty(osdmap, &dirty_pools, &dirty_pgs);
+  _save_inputs(osdmap);
+  num_remapped = _count(dirty_pools, dirty_pgs);
+  for (auto pool : dirty_pools) {
+    _update_range(osdmap, pool, 0, osdmap.get_pg_pool(pool)->get_pg_num());
+  }
+  for (auto pgid : dirty_pgs) {
+    update(osdmap, pgid);
   }
   _finish(osdmap);
   //_dump();  // for debugging
@@ -57,6 +215,31 @@ void OSDMapMapping::update(const OSDMap& osdmap, pg_t pgid)
   _update_range(osdmap, pgid.pool(), pgid.ps(), pgid.ps() + 1);
 }
 
+std::unique_ptr<OSDMapMapping::MappingJob> OSDMapMapping::start_update(
+  const OSDMap& map,
+  ParallelPGMapper& mapper,
+  unsigned pgs_per_item)
+{
+  std::unique_ptr<MappingJob> job(new MappingJob(&map, this));
+  std::set<int64_t> dirty_pools;
+  std::vector<pg_t> dirty_pgs;
+  bool incremental = _get_dirty(map, &dirty_pools, &dirty_pgs);
+  ldout(mapper.cct, 10) << __func__ << " e" << map.get_epoch()
+			<< (incremental ? " incremental" : " full")
+			<< ", remapping pools " << dirty_pools
+			<< " and " << dirty_pgs.size() << " pgs" << dendl;
+  _save_inputs(map);
+  num_remapped = _count(dirty_pools, dirty_pgs);
+  if (dirty_pools.empty() && dirty_pgs.empty()) {
+    // nothing can have moved, and no shard will call complete() for us
+    job->finish = ceph_clock_now();
+    _finish(map);
+    return job;
+  }
+  mapper.queue(job.get(), pgs_per_item, dirty_pools, dirty_pgs);
+  return job;
+}
+
 void OSDMapMapping::_build_rmap(const OSDMap& osdmap)
 {
   acting_rmap.resize(osdmap.get_max_osd());
@@ -73,8 +256,8 @@ void OSDMapMapping::_build_rmap(const OSDMap& osdmap)
       pgid.set_ps(ps);
       int32_t *row = &p.second.table[p.second.row_size() * ps];
       for (int i = 0; i < row[2]; ++i) {
-	if (row[4 + i] != CRUSH_ITEM_NONE) {
-	  acting_rmap[row[4 + i]].push_back(pgid);
+	if (row[5 + i] != CRUSH_ITEM_NONE) {
+	  acting_rmap[row[5 + i]].push_back(pgid);
 	}
       }
       //for (int i = 0; i < row[3]; ++i) {
@@ -88,6 +271,7 @@ void OSDMapMapping::_finish(const OSDMap& osdmap)
 {
   _build_rmap(osdmap);
   epoch = osdmap.get_epoch();
+  last.complete = true;
 }
 
 void OSDMapMapping::_dump()
@@ -113,13 +297,12 @@ void OSDMapMapping::_update_range(
   ceph_assert(pg_begin <= pg_end);
   ceph_assert(pg_end <= i->second.pg_num);
   for (unsigned ps = pg_begin; ps < pg_end; ++ps) {
-    std::vector<int> up, acting;
+    std::vector<int> raw, up, acting;
     int up_primary, acting_primary;
-    osdmap.pg_to_up_acting_osds(
+    osdmap.pg_to_raw_up_acting_osds(
       pg_t(ps, pool),
-      &up, &up_primary, &acting, &acting_primary);
-    i->second.set(ps, std::move(up), up_primary,
-		  std::move(acting), acting_primary);
+      &raw, &up, &up_primary, &acting, &acting_primary);
+    i->second.set(ps, raw, up, up_primary, acting, acting_primary);
   }
 }
 
@@ -203,3 +386,28 @@ void ParallelPGMapper::queue(
   }
   ceph_assert(any);
 }
+
+void ParallelPGMapper::queue(
+  Job *job,
+  unsigned pgs_per_item,
+  const std::set<int64_t>& input_pools,
+  const vector<pg_t>& input_pgs)
+{
+  for (auto pool : input_pools) {
+    auto p = job->osdmap->get_pools().find(pool);
+    ceph_assert(p != job->osdmap->get_pools().end());
+    for (unsigned ps = 0; ps < p->second.get_pg_num(); ps += pgs_per_item) {
+      unsigned ps_end = std::min(ps + pgs_per_item, p->second.get_pg_num());
+      job->start_one();
+      wq.queue(new Item(job, p->first, ps, ps_end));
+      ldout(cct, 20) << __func__ << " " << job << " " << p->first << " [" << ps
+		     << "," << ps_end << ")" << dendl;
+    }
+  }
+  for (unsigned i = 0; i < input_pgs.size(); i += pgs_per_item) {
+    auto end = std::min<size_t>(i + pgs_per_item, input_pgs.size());
+    job->start_one();
+    wq.queue(new Item(job, vector<pg_t>(input_pgs.begin() + i,
+					input_pgs.begin() + end)));
+  }
+}
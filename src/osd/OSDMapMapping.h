@@ -7,12 +7,15 @@
 
 #include <vector>
 #include <map>
+#include <set>
 
 #include "osd/osd_types.h"
 #include "common/WorkQueue.h"
 #include "common/Cond.h"
 
 class OSDMap;
+class CrushWrapper;
+struct PGTempMap;
 
 /// work queue to perform work on batches of pgids on multiple CPUs
 class ParallelPGMapper {
@@ -36,6 +39,8 @@ public:
     virtual void process(const vector<pg_t>& pgs) = 0;
     virtual void process(int64_t poolid, unsigned ps_begin, unsigned ps_end) = 0;
     virtual void complete() = 0;
+    /// called once an aborted job has no shards left
+    virtual void aborted_job() {}
 
     void set_finish_event(Context *fin) {
       lock.Lock();
@@ -84,6 +89,7 @@ public:
 	while (shards > 0) {
 	  cond.Wait(lock);
 	}
+	aborted_job();
       }
       if (fin) {
 	fin->complete(-ECANCELED);
@@ -99,6 +105,7 @@ public:
 
 protected:
   CephContext *cct;
+  friend class OSDMapMapping;
 
   struct Item {
     Job *job;
@@ -164,6 +171,13 @@ public:
     unsigned pgs_per_item,
     const vector<pg_t>& input_pgs);
 
+  /// queue every pg of the given pools plus the given pgs; may queue nothing
+  void queue(
+    Job *job,
+    unsigned pgs_per_item,
+    const std::set<int64_t>& input_pools,
+    const vector<pg_t>& input_pgs);
+
   void drain() {
     wq.drain();
   }
@@ -182,6 +196,8 @@ private:
     unsigned size = 0;
     unsigned pg_num = 0;
     bool erasure = false;
+    bool stale = true;        ///< not mapped since the pool was (re)created
+    epoch_t last_change = 0;  ///< pool's last_change when last mapped
     mempool::osdmap_mapping::vector<int32_t> table;
 
     size_t row_size() const {
@@ -190,8 +206,10 @@ private:
 	1 + // up_primary
 	1 + // num acting
 	1 + // num up
+	1 + // num raw, -1 if it did not fit
 	size + // acting
-	size;  // up
+	size + // up
+	size;  // raw (crush + upmap, before dropping down osds)
     }
 
     PoolMapping(int s, int p, bool e)
@@ -216,18 +234,19 @@ private:
       if (acting) {
 	acting->resize(row[2]);
 	for (int i = 0; i < row[2]; ++i) {
-	  (*acting)[i] = row[4 + i];
+	  (*acting)[i] = row[5 + i];
 	}
       }
       if (up) {
 	up->resize(row[3]);
 	for (int i = 0; i < row[3]; ++i) {
-	  (*up)[i] = row[4 + size + i];
+	  (*up)[i] = row[5 + size + i];
 	}
       }
     }
 
     void set(size_t ps,
+	     const std::vector<int>& raw,
 	     const std::vector<int>& up,
 	     int up_primary,
 	     const std::vector<int>& acting,
@@ -240,13 +259,43 @@ private:
       // accurate in this case--this is just to avoid crashing.
       row[2] = std::min<int32_t>(acting.size(), size);
       row[3] = std::min<int32_t>(up.size(), size);
+      // a raw set we cannot hold makes the pg dirty on any osd change
+      row[4] = raw.size() <= size ? (int32_t)raw.size() : -1;
       for (int i = 0; i < row[2]; ++i) {
-	row[4 + i] = acting[i];
+	row[5 + i] = acting[i];
       }
       for (int i = 0; i < row[3]; ++i) {
-	row[4 + size + i] = up[i];
+	row[5 + size + i] = up[i];
+      }
+      for (int i = 0; i < row[4]; ++i) {
+	row[5 + 2 * size + i] = raw[i];
       }
     }
+
+    /// true if the pg's raw set uses an osd flagged in raw_mask or its up
+    /// set uses one flagged in up_mask
+    bool uses(size_t ps,
+	      const std::vector<char>& raw_mask,
+	      const std::vector<char>& up_mask) const {
+      const int32_t *row = &table[row_size() * ps];
+      if (row[4] < 0) {
+	return true;
+      }
+      auto flagged = [](const std::vector<char>& mask, int32_t osd) {
+	return osd >= 0 && (size_t)osd < mask.size() && mask[osd];
+      };
+      for (int i = 0; i < row[4]; ++i) {
+	if (flagged(raw_mask, row[5 + 2 * size + i])) {
+	  return true;
+	}
+      }
+      for (int i = 0; i < row[3]; ++i) {
+	if (flagged(up_mask, row[5 + size + i])) {
+	  return true;
+	}
+      }
+      return false;
+    }
   };
 
   mempool::osdmap_mapping::map<int64_t,PoolMapping> pools;
@@ -255,8 +304,33 @@ private:
   //unused: mempool::osdmap_mapping::vector<std::vector<pg_t>> up_rmap;  // osd -> pg
   epoch_t epoch = 0;
   uint64_t num_pgs = 0;
+  uint64_t num_remapped = 0;  ///< pgs the last update ran crush for
+
+  // what the last complete update mapped, so that the next one can tell
+  // which pgs a new map may have moved.  The shared containers are
+  // copy-on-write in OSDMap, so holding a reference pins their contents.
+  struct inputs_t {
+    bool complete = false;
+    int max_osd = 0;
+    uint32_t crush_version = 0;
+    std::shared_ptr<CrushWrapper> crush;
+    std::vector<uint32_t> osd_state;
+    mempool::osdmap::vector<__u32> osd_weight;
+    std::shared_ptr<mempool::osdmap::vector<__u32>> osd_primary_affinity;
+    std::shared_ptr<PGTempMap> pg_temp;
+    std::shared_ptr<mempool::osdmap::map<pg_t,int32_t>> primary_temp;
+    mempool::osdmap::map<pg_t,mempool::osdmap::vector<int32_t>> pg_upmap;
+    mempool::osdmap::map<pg_t,
+      mempool::osdmap::vector<std::pair<int32_t,int32_t>>> pg_upmap_items;
+  } last;
 
   void _init_mappings(const OSDMap& osdmap);
+  bool _get_dirty(const OSDMap& osdmap,
+		  std::set<int64_t> *dirty_pools,
+		  std::vector<pg_t> *dirty_pgs) const;
+  void _save_inputs(const OSDMap& osdmap);
+  uint64_t _count(const std::set<int64_t>& dirty_pools,
+		  const std::vector<pg_t>& dirty_pgs) const;
   void _update_range(
     const OSDMap& map,
     int64_t pool,
@@ -279,13 +353,21 @@ private:
       : Job(osdmap), mapping(m) {
       mapping->_start(*osdmap);
     }
-    void process(const vector<pg_t>& pgs) override {}
+    void process(const vector<pg_t>& pgs) override {
+      for (auto pgid : pgs) {
+	mapping->update(*osdmap, pgid);
+      }
+    }
     void process(int64_t pool, unsigned ps_begin, unsigned ps_end) override {
       mapping->_update_range(*osdmap, pool, ps_begin, ps_end);
     }
     void complete() override {
       mapping->_finish(*osdmap);
     }
+    void aborted_job() override {
+      // some rows may be left from the previous map
+      mapping->last.complete = false;
+    }
   };
 
 public:
@@ -333,11 +415,7 @@ public:
   std::unique_ptr<MappingJob> start_update(
     const OSDMap& map,
     ParallelPGMapper& mapper,
-    unsigned pgs_per_item) {
-    std::unique_ptr<MappingJob> job(new MappingJob(&map, this));
-    mapper.queue(job.get(), pgs_per_item, {});
-    return job;
-  }
+    unsigned pgs_per_item);
 
   epoch_t get_epoch() const {
     return epoch;
@@ -346,6 +424,9 @@ public:
   uint64_t get_num_pgs() const {
     return num_pgs;
   }
+  uint64_t get_num_remapped() const {
+    return num_remapped;
+  }
 };
 
 
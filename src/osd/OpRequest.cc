@@ -142,11 +142,12 @@ void OpRequest::set_skip_handle_cache() { set_rmw_flags(CEPH_OSD_RMW_FLAG_SKIP_H
 void OpRequest::set_skip_promote() { set_rmw_flags(CEPH_OSD_RMW_FLAG_SKIP_PROMOTE); }
 void OpRequest::set_force_rwordered() { set_rmw_flags(CEPH_OSD_RMW_FLAG_RWORDERED); }
 
-void OpRequest::mark_flag_point(uint8_t flag, const char *s) {
+void OpRequest::mark_flag_point(uint8_t flag, op_event_t event) {
 #ifdef WITH_LTTNG
   uint8_t old_flags = hit_flag_points;
+  const char *s = op_event_name(event);
 #endif
-  mark_event(s);
+  mark_event(event);
   hit_flag_points |= flag;
   latest_flag_point = flag;
   tracepoint(oprequest, mark_flag_point, reqid.name._type,
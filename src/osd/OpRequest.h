@@ -135,22 +135,22 @@ public:
   }
 
   void mark_queued_for_pg() {
-    mark_flag_point(flag_queued_for_pg, "queued_for_pg");
+    mark_flag_point(flag_queued_for_pg, op_event_t::queued_for_pg);
   }
   void mark_reached_pg() {
-    mark_flag_point(flag_reached_pg, "reached_pg");
+    mark_flag_point(flag_reached_pg, op_event_t::reached_pg);
   }
   void mark_delayed(const std::string& s) {
     mark_flag_point_string(flag_delayed, s);
   }
   void mark_started() {
-    mark_flag_point(flag_started, "started");
+    mark_flag_point(flag_started, op_event_t::started);
   }
   void mark_sub_op_sent(const std::string& s) {
     mark_flag_point_string(flag_sub_op_sent, s);
   }
   void mark_commit_sent() {
-    mark_flag_point(flag_commit_sent, "commit_sent");
+    mark_flag_point(flag_commit_sent, op_event_t::commit_sent);
   }
 
   utime_t get_dequeued_time() const {
@@ -168,7 +168,7 @@ public:
 
 private:
   void set_rmw_flags(int flags);
-  void mark_flag_point(uint8_t flag, const char *s);
+  void mark_flag_point(uint8_t flag, op_event_t event);
   void mark_flag_point_string(uint8_t flag, const std::string& s);
 };
 
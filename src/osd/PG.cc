@@ -2388,7 +2388,8 @@ void PG::replica_scrub(
  */
 void PG::scrub(epoch_t queued, ThreadPool::TPHandle &handle)
 {
-  if (cct->_conf->osd_scrub_sleep > 0 &&
+  double scrub_sleep = osd->get_scrub_sleep();
+  if (scrub_sleep > 0 &&
       (scrubber.state == PG::Scrubber::NEW_CHUNK ||
        scrubber.state == PG::Scrubber::INACTIVE) &&
        scrubber.needs_sleep) {
@@ -2421,7 +2422,7 @@ void PG::scrub(epoch_t queued, ThreadPool::TPHandle &handle)
           pg->unlock();
         });
     std::lock_guard l(osd->sleep_lock);
-    osd->sleep_timer.add_event_after(cct->_conf->osd_scrub_sleep,
+    osd->sleep_timer.add_event_after(scrub_sleep,
                                            scrub_requeue_callback);
     scrubber.sleeping = true;
     scrubber.sleep_start = ceph_clock_now();
@@ -2585,6 +2586,8 @@ void PG::chunky_scrub(ThreadPool::TPHandle &handle)
         // Don't include temporary objects when scrubbing
         scrubber.start = info.pgid.pgid.get_hobj_start();
         scrubber.state = PG::Scrubber::NEW_CHUNK;
+        scrubber.started = ceph_clock_now();
+	scrub_read_checkpoint();
 
 	{
 	  bool repair = state_test(PG_STATE_REPAIR);
@@ -2635,6 +2638,7 @@ void PG::chunky_scrub(ThreadPool::TPHandle &handle)
 				      scrubber.preempt_divisor);
 	  int max = std::max<int64_t>(min, cct->_conf->osd_scrub_chunk_max /
                                       scrubber.preempt_divisor);
+	  max = osd->get_scrub_chunk_max(min, max);
           hobject_t start = scrubber.start;
 	  hobject_t candidate_end;
 	  vector<hobject_t> objects;
@@ -2810,6 +2814,9 @@ void PG::chunky_scrub(ThreadPool::TPHandle &handle)
         scrub_compare_maps();
 	scrubber.start = scrubber.end;
 	scrubber.run_callbacks();
+	if (!scrubber.end.is_max()) {
+	  scrub_write_checkpoint();
+	}
 
         // requeue the writes from the chunk that just finished
         requeue_ops(waiting_for_scrub);
@@ -3106,6 +3113,88 @@ bool PG::ops_blocked_by_scrub() const {
 }
 
 // the part that actually finalizes a scrub
+bool PG::scrub_checkpoint_wanted() const
+{
+  // a repair has to see every object in one pass
+  return scrubber.deep && !state_test(PG_STATE_REPAIR) &&
+    cct->_conf.get_val<double>("osd_deep_scrub_checkpoint_interval") > 0;
+}
+
+void PG::scrub_read_checkpoint()
+{
+  if (!scrub_checkpoint_wanted()) {
+    return;
+  }
+  map<string,bufferlist> values;
+  int r = osd->store->omap_get_values(
+    ch, pgmeta_oid, {string(scrub_checkpoint_key)}, &values);
+  if (r < 0 || values.empty()) {
+    return;
+  }
+  scrubber.checkpoint_present = true;
+
+  pg_scrub_checkpoint_t ckpt;
+  try {
+    auto p = values.begin()->second.cbegin();
+    decode(ckpt, p);
+  } catch (buffer::error& e) {
+    derr << __func__ << " failed to decode scrub checkpoint: " << e.what()
+	 << dendl;
+    return;
+  }
+  utime_t now = ceph_clock_now();
+  if (ckpt.pg_num != pool.info.get_pg_num() ||
+      ckpt.started < info.history.last_deep_scrub_stamp ||
+      now - ckpt.started > cct->_conf->osd_deep_scrub_interval ||
+      ckpt.pos <= scrubber.start ||
+      ckpt.pos >= info.pgid.pgid.get_hobj_end(pool.info.get_pg_num())) {
+    dout(10) << __func__ << " ignoring stale " << ckpt << dendl;
+    return;
+  }
+
+  dout(10) << __func__ << " resuming from " << ckpt << dendl;
+  scrubber.start = ckpt.pos;
+  scrubber.started = ckpt.started;
+  scrubber.last_checkpoint = now;
+  scrubber.shallow_errors = ckpt.shallow_errors;
+  scrubber.deep_errors = ckpt.deep_errors;
+  scrubber.omap_stats.large_omap_objects = ckpt.large_omap_objects;
+  scrubber.omap_stats.omap_bytes = ckpt.omap_bytes;
+  scrubber.omap_stats.omap_keys = ckpt.omap_keys;
+  scrubber.resumed = true;
+}
+
+void PG::scrub_write_checkpoint()
+{
+  if (!scrub_checkpoint_wanted()) {
+    return;
+  }
+  utime_t now = ceph_clock_now();
+  if (now - scrubber.last_checkpoint <
+      cct->_conf.get_val<double>("osd_deep_scrub_checkpoint_interval")) {
+    return;
+  }
+  scrubber.last_checkpoint = now;
+
+  pg_scrub_checkpoint_t ckpt;
+  ckpt.pos = scrubber.start;
+  ckpt.started = scrubber.started;
+  ckpt.pg_num = pool.info.get_pg_num();
+  ckpt.shallow_errors = scrubber.shallow_errors;
+  ckpt.deep_errors = scrubber.deep_errors;
+  ckpt.large_omap_objects = scrubber.omap_stats.large_omap_objects;
+  ckpt.omap_bytes = scrubber.omap_stats.omap_bytes;
+  ckpt.omap_keys = scrubber.omap_stats.omap_keys;
+  dout(20) << __func__ << " " << ckpt << dendl;
+
+  ObjectStore::Transaction t;
+  map<string,bufferlist> km;
+  encode(ckpt, km[string(scrub_checkpoint_key)]);
+  t.omap_setkeys(coll, pgmeta_oid, km);
+  osd->store->queue_transaction(ch, std::move(t), nullptr);
+  scrubber.checkpoint_present = true;
+}
+
 void PG::scrub_finish() 
 {
   dout(20) << __func__ << dendl;
@@ -3226,6 +3315,10 @@ void PG::scrub_finish()
 	return true;
       },
       &t);
+    if (scrubber.checkpoint_present) {
+      t.omap_rmkeys(coll, pgmeta_oid, {string(scrub_checkpoint_key)});
+      scrubber.checkpoint_present = false;
+    }
     int tr = osd->store->queue_transaction(ch, std::move(t), NULL);
     ceph_assert(tr == 0);
   }
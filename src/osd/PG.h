@@ -405,6 +405,10 @@ public:
     return snap_trimq.size();
   }
 
+  uint64_t get_target_pg_log_entries() const override {
+    return osd->get_target_pg_log_entries();
+  }
+
   void clear_publish_stats() override;
   void clear_primary_state() override;
 
@@ -1187,6 +1191,12 @@ public:
     int preempt_left;
     int preempt_divisor;
 
+    // deep scrub checkpoints
+    utime_t started;          ///< when this scrub began, if resumed the original
+    utime_t last_checkpoint;
+    bool resumed = false;     ///< we skipped what a previous run covered
+    bool checkpoint_present = false; ///< there is one to remove when done
+
     list<Context*> callbacks;
     void add_callback(Context *context) {
       callbacks.push_back(context);
@@ -1261,6 +1271,10 @@ public:
       sleeping = false;
       needs_sleep = true;
       sleep_start = utime_t();
+      started = utime_t();
+      last_checkpoint = utime_t();
+      resumed = false;
+      checkpoint_present = false;
     }
 
     void create_results(const hobject_t& obj);
@@ -1297,6 +1311,10 @@ protected:
   bool ops_blocked_by_scrub() const;
   void scrub_finish();
   void scrub_clear_state(bool keep_repair = false);
+  /// deep scrub progress, see osd_deep_scrub_checkpoint_interval
+  bool scrub_checkpoint_wanted() const;
+  void scrub_read_checkpoint();
+  void scrub_write_checkpoint();
   void _scan_snaps(ScrubMap &map);
   void _repair_oinfo_oid(ScrubMap &map);
   void _scan_rollback_obs(const vector<ghobject_t> &rollback_obs);
@@ -568,6 +568,34 @@ PGBackend *PGBackend::build_pg_backend(
   }
 }
 
+int PGBackend::be_deep_scrub_data(
+  const hobject_t &poid,
+  uint64_t off,
+  uint64_t len,
+  uint32_t fadvise_flags,
+  bufferhash *h)
+{
+  ghobject_t oid(poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard);
+  if (cct->_conf.get_val<bool>("osd_deep_scrub_store_csum")) {
+    // the store checks the data against its checksums and derives the
+    // digest from them, sparing us a pass over the data
+    uint32_t crc = h->digest();
+    int r = store->data_digest(ch, oid, off, len, &crc, fadvise_flags);
+    if (r != -EOPNOTSUPP) {
+      if (r >= 0) {
+	*h = bufferhash(crc);
+      }
+      return r;
+    }
+  }
+  bufferlist bl;
+  int r = store->read(ch, oid, off, len, bl, fadvise_flags);
+  if (r > 0) {
+    *h << bl;
+  }
+  return r;
+}
+
 int PGBackend::be_scan_list(
   ScrubMap &map,
   ScrubMapBuilder &pos)
@@ -235,9 +235,11 @@ typedef std::shared_ptr<const OSDMap> OSDMapRef;
        const std::optional<pg_hit_set_history_t> &hset_history,
        const eversion_t &trim_to,
        const eversion_t &roll_forward_to,
+       const eversion_t &min_last_complete_ondisk,
        bool transaction_applied,
        ObjectStore::Transaction &t,
-       bool async = false) = 0;
+       bool async = false,
+       const vector<bufferlist> *encoded_entries = nullptr) = 0;
 
      virtual void pgb_set_object_snap_mapping(
        const hobject_t &soid,
@@ -609,6 +611,14 @@ typedef std::shared_ptr<const OSDMap> OSDMapRef;
      ScrubMap &map,
      ScrubMapBuilder &pos,
      ScrubMap::object &o) = 0;
+   /// feed [off, off+len) of our shard of oid into *h, as read() would
+   /// return it; see osd_deep_scrub_store_csum
+   int be_deep_scrub_data(
+     const hobject_t &oid,
+     uint64_t off,
+     uint64_t len,
+     uint32_t fadvise_flags,
+     bufferhash *h);
    void be_omap_checks(
      const map<pg_shard_t,ScrubMap*> &maps,
      const set<hobject_t> &master_set,
@@ -645,7 +645,8 @@ void PGLog::write_log_and_missing(
       dirty_from_dups,
       write_from_dups,
       &may_include_deletes_in_missing_dirty,
-      (pg_log_debug ? &log_keys_debug : nullptr));
+      (pg_log_debug ? &log_keys_debug : nullptr),
+      &encoded_entries);
     undirty();
   } else {
     dout(10) << "log is not dirty" << dendl;
@@ -829,23 +830,52 @@ void PGLog::_write_log_and_missing(
   eversion_t dirty_from_dups,
   eversion_t write_from_dups,
   bool *may_include_deletes_in_missing_dirty, // in/out param
-  set<string> *log_keys_debug
+  set<string> *log_keys_debug,
+  const map<eversion_t, bufferlist> *encoded_entries
   ) {
   set<string> to_remove;
-  to_remove.swap(trimmed_dups);
-  for (auto& t : trimmed) {
-    string key = t.get_key_name();
-    if (log_keys_debug) {
-      auto it = log_keys_debug->find(key);
+  if (log_keys_debug) {
+    for (auto& t : trimmed) {
+      auto it = log_keys_debug->find(t.get_key_name());
       ceph_assert(it != log_keys_debug->end());
       log_keys_debug->erase(it);
     }
-    to_remove.emplace(std::move(key));
   }
-  trimmed.clear();
 
   if (touch_log)
     t.touch(coll, log_oid);
+
+  // Trimming always takes the oldest entries and dups, so what was
+  // trimmed is a run of keys with nothing live in between and can go in
+  // one range delete rather than a key at a time.  Keys sort as
+  // "%010u.%020llu" and (epoch, version + 1) caps the last one.
+  if (!trimmed.empty()) {
+    eversion_t first = *trimmed.begin();
+    eversion_t last = *trimmed.rbegin();
+    if (log.log.empty() || log.log.front().version > last) {
+      t.omap_rmkeyrange(
+	coll, log_oid,
+	first.get_key_name(),
+	eversion_t(last.epoch, last.version + 1).get_key_name());
+    } else {
+      for (auto& t : trimmed) {
+	to_remove.emplace(t.get_key_name());
+      }
+    }
+    trimmed.clear();
+  }
+  if (!trimmed_dups.empty()) {
+    if (log.dups.empty() ||
+	log.dups.front().get_key_name() > *trimmed_dups.rbegin()) {
+      // nothing sorts between a key and the same key plus a NUL
+      string end = *trimmed_dups.rbegin();
+      end.push_back('\0');
+      t.omap_rmkeyrange(coll, log_oid, *trimmed_dups.begin(), end);
+    } else {
+      to_remove.swap(trimmed_dups);
+    }
+    trimmed_dups.clear();
+  }
   if (dirty_to != eversion_t()) {
     t.omap_rmkeyrange(
       coll, log_oid,
@@ -860,12 +890,24 @@ void PGLog::_write_log_and_missing(
     clear_after(log_keys_debug, dirty_from.get_key_name());
   }
 
+  auto write_entry = [&](const pg_log_entry_t& e) {
+    char key[32];
+    e.version.get_key_name(key);
+    bufferlist& bl = (*km)[string(key, sizeof(key) - 1)];
+    if (encoded_entries) {
+      if (auto i = encoded_entries->find(e.version);
+	  i != encoded_entries->end()) {
+	pg_log_entry_t::encode_with_checksum(i->second, bl);
+	return;
+      }
+    }
+    e.encode_with_checksum(bl);
+  };
+
   for (list<pg_log_entry_t>::iterator p = log.log.begin();
        p != log.log.end() && p->version <= dirty_to;
        ++p) {
-    bufferlist bl(sizeof(*p) * 2);
-    p->encode_with_checksum(bl);
-    (*km)[p->get_key_name()].claim(bl);
+    write_entry(*p);
   }
 
   for (list<pg_log_entry_t>::reverse_iterator p = log.log.rbegin();
@@ -873,9 +915,7 @@ void PGLog::_write_log_and_missing(
 	 (p->version >= dirty_from || p->version >= writeout_from) &&
 	 p->version >= dirty_to;
        ++p) {
-    bufferlist bl(sizeof(*p) * 2);
-    p->encode_with_checksum(bl);
-    (*km)[p->get_key_name()].claim(bl);
+    write_entry(*p);
   }
 
   if (log_keys_debug) {
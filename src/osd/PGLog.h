@@ -250,6 +250,15 @@ public:
       return objects.count(oid);
     }
 
+    /// true if the newest logged write to oid is newer than bound
+    bool has_write_since(const hobject_t &oid, const eversion_t &bound) const {
+      if (!(indexed_data & PGLOG_INDEXED_OBJECTS)) {
+         index_objects();
+      }
+      auto p = objects.find(oid);
+      return p != objects.end() && p->second->version > bound;
+    }
+
     bool logged_req(const osd_reqid_t &r) const {
       if (!(indexed_data & PGLOG_INDEXED_CALLER_OPS)) {
         index_caller_ops();
@@ -574,6 +583,9 @@ protected:
   eversion_t dirty_from_dups;  ///< must clear/writeout all dups >= dirty_from_dups
   eversion_t write_from_dups;  ///< must write keys >= write_from_dups
   set<string> trimmed_dups;    ///< must clear keys in trimmed_dups
+  /// entries of the log as they were encoded for the replicas, reused
+  /// when they are written out; dropped by undirty()
+  map<eversion_t, bufferlist> encoded_entries;
   CephContext *cct;
   bool pg_log_debug;
   /// Log is clean on [dirty_to, dirty_from)
@@ -658,6 +670,7 @@ protected:
     dirty_log = false;
     trimmed.clear();
     trimmed_dups.clear();
+    encoded_entries.clear();
     writeout_from = eversion_t::max();
     check();
     missing.flush();
@@ -721,6 +734,13 @@ public:
     log.add(e, applied);
   }
 
+  /// add an entry along with its pg_log_entry_t::encode() output
+  void add(const pg_log_entry_t& e, const bufferlist& encoded,
+	   bool applied = true) {
+    add(e, applied);
+    encoded_entries[e.version] = encoded;
+  }
+
   void reset_recovery_pointers() { log.reset_recovery_pointers(); }
 
   static void clear_info_log(
@@ -774,8 +794,12 @@ public:
     missing.split_into(child_pgid, split_bits, &(opg_log->missing));
     opg_log->mark_dirty_to(eversion_t::max());
     opg_log->mark_dirty_to_dups(eversion_t::max());
-    mark_dirty_to(eversion_t::max());
-    mark_dirty_to_dups(eversion_t::max());
+    // the entries we keep and all of our dups are unchanged, so only clear
+    // the keys of the entries that moved to the child instead of rewriting
+    // the whole log
+    for (auto& e : opg_log->log.log) {
+      trimmed.insert(e.version);
+    }
     if (missing.may_include_deletes) {
       opg_log->set_missing_may_contain_deletes();
     }
@@ -1322,7 +1346,8 @@ public:
     eversion_t dirty_from_dups,
     eversion_t write_from_dups,
     bool *may_include_deletes_in_missing_dirty,
-    set<string> *log_keys_debug
+    set<string> *log_keys_debug,
+    const map<eversion_t, bufferlist> *encoded_entries = nullptr
     );
 
   void read_log_and_missing(
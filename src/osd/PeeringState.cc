@@ -3530,7 +3530,8 @@ void PeeringState::merge_new_log_entries(
   }
 }
 
-void PeeringState::add_log_entry(const pg_log_entry_t& e, bool applied)
+void PeeringState::add_log_entry(const pg_log_entry_t& e, bool applied,
+				 const bufferlist *encoded)
 {
   // raise last_complete only if we were previously up to date
   if (info.last_complete == info.last_update)
@@ -3546,7 +3547,11 @@ void PeeringState::add_log_entry(const pg_log_entry_t& e, bool applied)
     info.last_user_version = e.user_version;
 
   // log mutation
-  pg_log.add(e, applied);
+  if (encoded) {
+    pg_log.add(e, *encoded, applied);
+  } else {
+    pg_log.add(e, applied);
+  }
   psdout(10) << "add_log_entry " << e << dendl;
 }
 
@@ -3555,9 +3560,11 @@ void PeeringState::append_log(
   const vector<pg_log_entry_t>& logv,
   eversion_t trim_to,
   eversion_t roll_forward_to,
+  eversion_t mlcod,
   ObjectStore::Transaction &t,
   bool transaction_applied,
-  bool async)
+  bool async,
+  const vector<bufferlist> *encoded_entries)
 {
   /* The primary has sent an info updating the history, but it may not
    * have arrived yet.  We want to make sure that we cannot remember this
@@ -3589,7 +3596,9 @@ void PeeringState::append_log(
   for (vector<pg_log_entry_t>::const_iterator p = logv.begin();
        p != logv.end();
        ++p) {
-    add_log_entry(*p, transaction_applied);
+    add_log_entry(*p, transaction_applied,
+		  encoded_entries ?
+		  &(*encoded_entries)[p - logv.begin()] : nullptr);
 
     /* We don't want to leave the rollforward artifacts around
      * here past last_backfill.  It's ok for the same reason as
@@ -3599,6 +3608,13 @@ void PeeringState::append_log(
       pg_log.roll_forward(handler.get());
     }
   }
+  /* Remember the primary's min_last_complete_ondisk so that we can tell
+   * which objects are safe to serve balanced reads for.  Replicated
+   * backends roll forward to the op's own version, so roll_forward_to
+   * says nothing about what the other shards have committed. */
+  if (!is_primary() && mlcod > min_last_complete_ondisk) {
+    min_last_complete_ondisk = mlcod;
+  }
   if (transaction_applied && roll_forward_to > pg_log.get_can_rollback_to()) {
     pg_log.roll_forward_to(
       roll_forward_to,
@@ -3620,6 +3636,19 @@ void PeeringState::append_log(
   write_if_dirty(t);
 }
 
+bool PeeringState::can_serve_replica_read(const hobject_t &hoid) const
+{
+  ceph_assert(!is_primary());
+  /* A write newer than what the primary has seen committed everywhere
+   * may still be rolled back, and other replicas may not have it yet. */
+  if (pg_log.get_log().has_write_since(hoid, min_last_complete_ondisk)) {
+    psdout(20) << __func__ << " " << hoid << " has unstable writes past "
+	       << min_last_complete_ondisk << dendl;
+    return false;
+  }
+  return true;
+}
+
 void PeeringState::recover_got(
   const hobject_t &oid, eversion_t v,
   bool is_delete,
@@ -3807,7 +3836,7 @@ void PeeringState::complete_write(eversion_t v, eversion_t lc)
 
 void PeeringState::calc_trim_to()
 {
-  size_t target = cct->_conf->osd_min_pg_log_entries;
+  size_t target = pl->get_target_pg_log_entries();
   if (is_degraded() ||
       state_test(PG_STATE_RECOVERING |
                  PG_STATE_RECOVERY_WAIT |
@@ -3849,7 +3878,7 @@ void PeeringState::calc_trim_to()
 
 void PeeringState::calc_trim_to_aggressive()
 {
-  size_t target = cct->_conf->osd_min_pg_log_entries;
+  size_t target = pl->get_target_pg_log_entries();
   if (is_degraded() ||
       state_test(PG_STATE_RECOVERING |
 		 PG_STATE_RECOVERY_WAIT |
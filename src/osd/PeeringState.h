@@ -118,6 +118,9 @@ public:
     /// Return current snap_trimq size
     virtual uint64_t get_snap_trimq_size() const = 0;
 
+    /// Return the number of log entries to keep while the PG is clean
+    virtual uint64_t get_target_pg_log_entries() const = 0;
+
     /// Send cluster message to osd
     virtual void send_cluster_message(
       int osd, Message *m, epoch_t epoch, bool share_map_update=false) = 0;
@@ -1460,7 +1463,8 @@ public:
   void update_blocked_by();
   void update_calc_stats();
 
-  void add_log_entry(const pg_log_entry_t& e, bool applied);
+  void add_log_entry(const pg_log_entry_t& e, bool applied,
+		     const bufferlist *encoded = nullptr);
 
   void calc_trim_to();
   void calc_trim_to_aggressive();
@@ -1614,14 +1618,20 @@ public:
 
   /**
    * Updates local log to reflect new write from primary.
+   *
+   * encoded_entries, if given, holds the encode() output of each entry
+   * so that it need not be encoded again when the log is written out.
+   * mlcod is the primary's min_last_complete_ondisk.
    */
   void append_log(
     const vector<pg_log_entry_t>& logv,
     eversion_t trim_to,
     eversion_t roll_forward_to,
+    eversion_t mlcod,
     ObjectStore::Transaction &t,
     bool transaction_applied,
-    bool async);
+    bool async,
+    const vector<bufferlist> *encoded_entries = nullptr);
 
   /**
    * Updates local log/missing to reflect new oob log update from primary
@@ -1872,6 +1882,8 @@ public:
   bool is_primary() const {
     return pg_whoami == primary;
   }
+  /// true if a replica may serve a balanced read of hoid
+  bool can_serve_replica_read(const hobject_t &hoid) const;
   bool pg_has_reset_since(epoch_t e) const {
     return deleted || e < get_last_peering_reset();
   }
@@ -1765,7 +1765,10 @@ void PrimaryLogPG::do_op(OpRequestRef& op)
     m->clear_payload();
   }
 
-  dout(20) << __func__ << ": op " << *m << dendl;
+  // formatted by the log thread, if at all; op keeps m alive
+  ldout_deferred(cct, 20, ([op, pgid = info.pgid] (std::ostream& out) {
+    out << "pg[" << pgid << "] do_op: op " << *op->get_req();
+  }));
 
   hobject_t head = m->get_hobj();
   head.snap = CEPH_NOSNAP;
@@ -1933,13 +1936,16 @@ void PrimaryLogPG::do_op(OpRequestRef& op)
     }
   }
 
-  dout(10) << "do_op " << *m
-	   << (op->may_write() ? " may_write" : "")
-	   << (op->may_read() ? " may_read" : "")
-	   << (op->may_cache() ? " may_cache" : "")
-	   << " -> " << (write_ordered ? "write-ordered" : "read-ordered")
-	   << " flags " << ceph_osd_flag_string(m->get_flags())
-	   << dendl;
+  ldout_deferred(cct, 10, ([op, pgid = info.pgid, write_ordered]
+			   (std::ostream& out) {
+    auto m = static_cast<const MOSDOp*>(op->get_req());
+    out << "pg[" << pgid << "] do_op " << *m
+	<< (op->may_write() ? " may_write" : "")
+	<< (op->may_read() ? " may_read" : "")
+	<< (op->may_cache() ? " may_cache" : "")
+	<< " -> " << (write_ordered ? "write-ordered" : "read-ordered")
+	<< " flags " << ceph_osd_flag_string(m->get_flags());
+  }));
 
   // missing object?
   if (is_unreadable_object(head)) {
@@ -1959,6 +1965,16 @@ void PrimaryLogPG::do_op(OpRequestRef& op)
     return;
   }
 
+  if (!is_primary()) {
+    if (!recovery_state.can_serve_replica_read(head)) {
+      dout(20) << __func__ << ": unstable write on replica, bouncing to primary "
+	       << *m << dendl;
+      osd->reply_op_error(op, -EAGAIN);
+      return;
+    }
+    dout(20) << __func__ << ": serving replica read on oid " << head << dendl;
+  }
+
   if (write_ordered) {
     // degraded object?
     if (is_degraded_or_backfilling_object(head)) {
@@ -7261,35 +7277,24 @@ int PrimaryLogPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	}
 	tracepoint(osd, do_osd_op_pre_omapgetvals, soid.oid.name.c_str(), soid.snap.val, start_after.c_str(), max_return, filter_prefix.c_str());
 
-	uint32_t num = 0;
 	bool truncated = false;
-	bufferlist bl;
-	if (oi.is_omap()) {
-	  ObjectMap::ObjectMapIterator iter = osd->store->get_omap_iterator(
-	    ch, ghobject_t(soid)
-	    );
-          if (!iter) {
-            result = -ENOENT;
-            goto fail;
-          }
-	  iter->upper_bound(start_after);
-	  if (filter_prefix > start_after) iter->lower_bound(filter_prefix);
-	  for (num = 0;
-	       iter->valid() &&
-		 iter->key().substr(0, filter_prefix.size()) == filter_prefix;
-	       ++num, iter->next()) {
-	    dout(20) << "Found key " << iter->key() << dendl;
-	    if (num >= max_return ||
-		bl.length() >= cct->_conf->osd_max_omap_bytes_per_request) {
-	      truncated = true;
-	      break;
-	    }
-	    encode(iter->key(), bl);
-	    encode(iter->value(), bl);
-	  }
-	} // else return empty out_set
+	kv_batch_t batch;
+	result = do_omap_get_vals_batch(
+	  ctx, start_after, filter_prefix, max_return,
+	  cct->_conf->osd_max_omap_bytes_per_request, &batch, &truncated);
+	if (result < 0) {
+	  goto fail;
+	}
+	uint32_t num = batch.size();
 	encode(num, osd_op.outdata);
-	osd_op.outdata.claim_append(bl);
+	for (size_t i = 0; i < batch.size(); ++i) {
+	  dout(20) << "Found key " << batch.key(i) << dendl;
+	  encode(batch.key(i), osd_op.outdata);
+	  // values go out as views of the batch arena
+	  bufferptr v = batch.value_ptr(i);
+	  encode((uint32_t)v.length(), osd_op.outdata);
+	  osd_op.outdata.append(std::move(v));
+	}
 	encode(truncated, osd_op.outdata);
 	ctx->delta_stats.num_rd_kb += shift_round_up(osd_op.outdata.length(), 10);
 	ctx->delta_stats.num_rd++;
@@ -7618,6 +7623,51 @@ int PrimaryLogPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
   return result;
 }
 
+int PrimaryLogPG::do_omap_get_vals_batch(
+  OpContext *ctx,
+  const string& start_after,
+  const string& filter_prefix,
+  uint64_t max_return,
+  uint64_t max_bytes,
+  kv_batch_t *batch,
+  bool *truncated)
+{
+  const object_info_t& oi = ctx->obs->oi;
+  *truncated = false;
+  if (!oi.is_omap()) {
+    return 0;
+  }
+  if (max_return > cct->_conf->osd_max_omap_entries_per_request) {
+    max_return = cct->_conf->osd_max_omap_entries_per_request;
+  }
+  if (max_bytes > cct->_conf->osd_max_omap_bytes_per_request) {
+    max_bytes = cct->_conf->osd_max_omap_bytes_per_request;
+  }
+  ObjectMap::ObjectMapIterator iter = osd->store->get_omap_iterator(
+    ch, ghobject_t(oi.soid));
+  if (!iter) {
+    return -ENOENT;
+  }
+  iter->upper_bound(start_after);
+  if (filter_prefix > start_after) {
+    iter->lower_bound(filter_prefix);
+  }
+  // keys carrying filter_prefix sort below its successor
+  string end = filter_prefix;
+  while (!end.empty() && (unsigned char)end.back() == 0xff) {
+    end.pop_back();
+  }
+  if (!end.empty()) {
+    ++end.back();
+  }
+  int r = iter->next_batch(end, max_return, max_bytes, batch);
+  if (r < 0) {
+    return r;
+  }
+  *truncated = iter->valid() && (end.empty() || iter->key() < end);
+  return 0;
+}
+
 int PrimaryLogPG::_get_tmap(OpContext *ctx, bufferlist *header, bufferlist *vals)
 {
   if (ctx->new_obs.oi.size == 0) {
@@ -8233,13 +8283,21 @@ void PrimaryLogPG::do_osd_op_effects(OpContext *ctx, const ConnectionRef& conn)
       dout(10) << "notify_ack " << make_pair(*(p->watch_cookie), p->notify_id) << dendl;
     else
       dout(10) << "notify_ack " << make_pair("NULL", p->notify_id) << dendl;
+    if (p->watch_cookie) {
+      // look the watch up directly rather than walking every watcher; with
+      // thousands of watchers each ack would otherwise cost a full scan
+      auto i = ctx->obc->watchers.find(make_pair(*(p->watch_cookie), entity));
+      if (i != ctx->obc->watchers.end()) {
+	dout(10) << "acking notify on watch " << i->first << dendl;
+	i->second->notify_ack(p->notify_id, p->reply_bl);
+      }
+      continue;
+    }
     for (map<pair<uint64_t, entity_name_t>, WatchRef>::iterator i =
 	   ctx->obc->watchers.begin();
 	 i != ctx->obc->watchers.end();
 	 ++i) {
       if (i->first.second != entity) continue;
-      if (p->watch_cookie &&
-	  *(p->watch_cookie) != i->first.first) continue;
       dout(10) << "acking notify on watch " << i->first << dendl;
       i->second->notify_ack(p->notify_id, p->reply_bl);
     }
@@ -13401,7 +13459,7 @@ void PrimaryLogPG::hit_set_create()
   HitSet::Params params(pool.info.hit_set_params);
 
   dout(20) << __func__ << " " << params << dendl;
-  if (pool.info.hit_set_params.get_type() == HitSet::TYPE_BLOOM) {
+  if (HitSet::is_bloom_type(pool.info.hit_set_params.get_type())) {
     BloomHitSet::Params *p =
       static_cast<BloomHitSet::Params*>(params.impl.get());
 
@@ -14867,6 +14925,13 @@ void PrimaryLogPG::_scrub_finish()
   bool deep_scrub = state_test(PG_STATE_DEEP_SCRUB);
   const char *mode = (repair ? "repair": (deep_scrub ? "deep-scrub" : "scrub"));
 
+  if (scrubber.resumed) {
+    // scrub_cstat only covers the objects this run got to
+    dout(10) << mode << " resumed from a checkpoint, not checking stats"
+	     << dendl;
+    return;
+  }
+
   if (info.stats.stats_invalid) {
     recovery_state.update_stats(
       [=](auto &history, auto &stats) {
@@ -447,9 +447,11 @@ public:
     const std::optional<pg_hit_set_history_t> &hset_history,
     const eversion_t &trim_to,
     const eversion_t &roll_forward_to,
+    const eversion_t &min_last_complete_ondisk,
     bool transaction_applied,
     ObjectStore::Transaction &t,
-    bool async = false) override {
+    bool async = false,
+    const vector<bufferlist> *encoded_entries = nullptr) override {
     if (hset_history) {
       recovery_state.update_hset(*hset_history);
     }
@@ -462,7 +464,8 @@ public:
       projected_log.trim(cct, last->version, nullptr, nullptr, nullptr);
     }
     recovery_state.append_log(
-      logv, trim_to, roll_forward_to, t, transaction_applied, async);
+      logv, trim_to, roll_forward_to, min_last_complete_ondisk,
+      t, transaction_applied, async, encoded_entries);
   }
 
   void op_applied(const eversion_t &applied_version) override;
@@ -1501,6 +1504,13 @@ public:
   void kick_snap_trim() override;
   void snap_trimmer_scrub_complete() override;
   int do_osd_ops(OpContext *ctx, vector<OSDOp>& ops);
+  int do_omap_get_vals_batch(OpContext *ctx,
+			     const string& start_after,
+			     const string& filter_prefix,
+			     uint64_t max_return,
+			     uint64_t max_bytes,
+			     kv_batch_t *batch,
+			     bool *truncated);
 
   int _get_tmap(OpContext *ctx, bufferlist *header, bufferlist *vals);
   int do_tmap2omap(OpContext *ctx, unsigned flags);
@@ -1658,10 +1668,11 @@ private:
 	}
       };
       auto *pg = context< SnapTrimmer >().pg;
-      if (pg->cct->_conf->osd_snap_trim_sleep > 0) {
+      float osd_snap_trim_sleep = pg->osd->osd->get_osd_snap_trim_sleep();
+      if (osd_snap_trim_sleep > 0) {
 	std::lock_guard l(pg->osd->sleep_lock);
 	wakeup = pg->osd->sleep_timer.add_event_after(
-	  pg->cct->_conf->osd_snap_trim_sleep,
+	  osd_snap_trim_sleep,
 	  new OnTimer{pg, pg->get_osdmap_epoch()});
       } else {
 	post_event(SnapTrimTimerReady());
@@ -276,6 +276,39 @@ public:
   }
 };
 
+// encode as encode(vector<pg_log_entry_t>) does, keeping each entry's
+// bytes so that our own log can reuse them
+static void encode_log_entries(
+  const vector<pg_log_entry_t> &log_entries,
+  bufferlist &bl,
+  vector<bufferlist> *encoded)
+{
+  encode((__u32)log_entries.size(), bl);
+  encoded->resize(log_entries.size());
+  for (size_t i = 0; i < log_entries.size(); ++i) {
+    unsigned off = bl.length();
+    log_entries[i].encode(bl);
+    (*encoded)[i].substr_of(bl, off, bl.length() - off);
+  }
+}
+
+static void decode_log_entries(
+  const bufferlist &bl,
+  vector<pg_log_entry_t> *log_entries,
+  vector<bufferlist> *encoded)
+{
+  auto p = bl.cbegin();
+  __u32 n;
+  decode(n, p);
+  log_entries->resize(n);
+  encoded->resize(n);
+  for (__u32 i = 0; i < n; ++i) {
+    unsigned off = p.get_off();
+    decode((*log_entries)[i], p);
+    (*encoded)[i].substr_of(bl, off, p.get_off() - off);
+  }
+}
+
 void generate_transaction(
   PGTransactionUPtr &pgt,
   const coll_t &coll,
@@ -468,6 +501,13 @@ void ReplicatedBackend::submit_transaction(
     parent->get_acting_recovery_backfill_shards().begin(),
     parent->get_acting_recovery_backfill_shards().end());
 
+  // encode the entries once, for the replicas and for our own log
+  bufferlist logs;
+  vector<bufferlist> encoded_entries;
+  encode_log_entries(log_entries, logs, &encoded_entries);
+
+  // replicated pools can roll forward right away; the roll_forward_to
+  // we are handed is the primary's min_last_complete_ondisk
   issue_op(
     soid,
     at_version,
@@ -475,9 +515,10 @@ void ReplicatedBackend::submit_transaction(
     reqid,
     trim_to,
     at_version,
+    roll_forward_to,
     added.size() ? *(added.begin()) : hobject_t(),
     removed.size() ? *(removed.begin()) : hobject_t(),
-    log_entries,
+    logs,
     hset_history,
     &op,
     op_t);
@@ -490,8 +531,11 @@ void ReplicatedBackend::submit_transaction(
     hset_history,
     trim_to,
     at_version,
+    roll_forward_to,
     true,
-    op_t);
+    op_t,
+    false,
+    &encoded_entries);
   
   op_t.register_on_commit(
     parent->bless_context(
@@ -612,23 +656,18 @@ int ReplicatedBackend::be_deep_scrub(
       pos.data_hash = bufferhash(-1);
     }
 
-    bufferlist bl;
-    r = store->read(
-      ch,
-      ghobject_t(
-	poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
+    r = be_deep_scrub_data(
+      poid,
       pos.data_pos,
-      cct->_conf->osd_deep_scrub_stride, bl,
-      fadvise_flags);
+      cct->_conf->osd_deep_scrub_stride,
+      fadvise_flags,
+      &pos.data_hash);
     if (r < 0) {
       dout(20) << __func__ << "  " << poid << " got "
 	       << r << " on read, read_error" << dendl;
       o.read_error = true;
       return 0;
     }
-    if (r > 0) {
-      pos.data_hash << bl;
-    }
     pos.data_pos += r;
     if (r == cct->_conf->osd_deep_scrub_stride) {
       dout(20) << __func__ << "  " << poid << " more data, digest so far 0x"
@@ -898,11 +937,13 @@ Message * ReplicatedBackend::generate_subop(
   osd_reqid_t reqid,
   eversion_t pg_trim_to,
   eversion_t pg_roll_forward_to,
+  eversion_t min_last_complete_ondisk,
   hobject_t new_temp_oid,
   hobject_t discard_temp_oid,
   const bufferlist &log_entries,
   std::optional<pg_hit_set_history_t> &hset_hist,
   ObjectStore::Transaction &op_t,
+  bufferlist *encoded_op_t,
   pg_shard_t peer,
   const pg_info_t &pinfo)
 {
@@ -921,7 +962,12 @@ Message * ReplicatedBackend::generate_subop(
     ObjectStore::Transaction t;
     encode(t, wr->get_data());
   } else {
-    encode(op_t, wr->get_data());
+    // every replica gets the same transaction: encode it once and let
+    // the messages share the buffers
+    if (encoded_op_t->length() == 0) {
+      encode(op_t, *encoded_op_t);
+    }
+    wr->get_data().append(*encoded_op_t);
     wr->get_header().data_off = op_t.get_data_alignment();
   }
 
@@ -934,6 +980,7 @@ Message * ReplicatedBackend::generate_subop(
 
   wr->pg_trim_to = pg_trim_to;
   wr->pg_roll_forward_to = pg_roll_forward_to;
+  wr->min_last_complete_ondisk = min_last_complete_ondisk;
 
   wr->new_temp_oid = new_temp_oid;
   wr->discard_temp_oid = discard_temp_oid;
@@ -948,9 +995,10 @@ void ReplicatedBackend::issue_op(
   osd_reqid_t reqid,
   eversion_t pg_trim_to,
   eversion_t pg_roll_forward_to,
+  eversion_t min_last_complete_ondisk,
   hobject_t new_temp_oid,
   hobject_t discard_temp_oid,
-  const vector<pg_log_entry_t> &log_entries,
+  const bufferlist &logs,
   std::optional<pg_hit_set_history_t> &hset_hist,
   InProgressOp *op,
   ObjectStore::Transaction &op_t)
@@ -965,10 +1013,7 @@ void ReplicatedBackend::issue_op(
       op->op->mark_sub_op_sent(ss.str());
     }
 
-    // avoid doing the same work in generate_subop
-    bufferlist logs;
-    encode(log_entries, logs);
-
+    bufferlist encoded_op_t;
     for (const auto& shard : get_parent()->get_acting_recovery_backfill_shards()) {
       if (shard == parent->whoami_shard()) continue;
       const pg_info_t &pinfo = parent->get_shard_info().find(shard)->second;
@@ -981,11 +1026,13 @@ void ReplicatedBackend::issue_op(
 	  reqid,
 	  pg_trim_to,
 	  pg_roll_forward_to,
+	  min_last_complete_ondisk,
 	  new_temp_oid,
 	  discard_temp_oid,
 	  logs,
 	  hset_hist,
 	  op_t,
+	  &encoded_op_t,
 	  shard,
 	  pinfo);
       if (op->op && op->op->pg_trace)
@@ -1049,8 +1096,9 @@ void ReplicatedBackend::do_repop(OpRequestRef op)
     clear_temp_obj(m->discard_temp_oid);
   }
 
-  p = const_cast<bufferlist&>(m->logbl).begin();
-  decode(log, p);
+  // keep the entries' bytes; our log writes them out as they are
+  vector<bufferlist> encoded_entries;
+  decode_log_entries(m->logbl, &log, &encoded_entries);
   rm->opt.set_fadvise_flag(CEPH_OSD_OP_FLAG_FADVISE_DONTNEED);
 
   bool update_snaps = false;
@@ -1081,9 +1129,11 @@ void ReplicatedBackend::do_repop(OpRequestRef op)
     m->updated_hit_set_history,
     m->pg_trim_to,
     m->pg_roll_forward_to,
+    m->min_last_complete_ondisk,
     update_snaps,
     rm->localt,
-    async);
+    async,
+    &encoded_entries);
 
   rm->opt.register_on_commit(
     parent->bless_context(
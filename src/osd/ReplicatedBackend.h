@@ -377,11 +377,13 @@ private:
     osd_reqid_t reqid,
     eversion_t pg_trim_to,
     eversion_t pg_roll_forward_to,
+    eversion_t min_last_complete_ondisk,
     hobject_t new_temp_oid,
     hobject_t discard_temp_oid,
     const bufferlist &log_entries,
     std::optional<pg_hit_set_history_t> &hset_history,
     ObjectStore::Transaction &op_t,
+    bufferlist *encoded_op_t,
     pg_shard_t peer,
     const pg_info_t &pinfo);
   void issue_op(
@@ -391,9 +393,10 @@ private:
     osd_reqid_t reqid,
     eversion_t pg_trim_to,
     eversion_t pg_roll_forward_to,
+    eversion_t min_last_complete_ondisk,
     hobject_t new_temp_oid,
     hobject_t discard_temp_oid,
-    const vector<pg_log_entry_t> &log_entries,
+    const bufferlist &logs,
     std::optional<pg_hit_set_history_t> &hset_history,
     InProgressOp *op,
     ObjectStore::Transaction &op_t);
@@ -106,16 +106,25 @@ void Notify::do_timeout()
   _watchers.swap(watchers);
   lock.Unlock();
 
+  // the watchers of a notify all watch the same object, so take the pg
+  // lock once for the lot instead of once per straggler
+  NotifyRef self_ref = self.lock();
+  boost::intrusive_ptr<PrimaryLogPG> pg;
   for (set<WatchRef>::iterator i = _watchers.begin();
        i != _watchers.end();
        ++i) {
-    boost::intrusive_ptr<PrimaryLogPG> pg((*i)->get_pg());
-    pg->lock();
+    if (pg != (*i)->get_pg()) {
+      if (pg)
+	pg->unlock();
+      pg = (*i)->get_pg();
+      pg->lock();
+    }
     if (!(*i)->is_discarded()) {
-      (*i)->cancel_notify(self.lock());
+      (*i)->cancel_notify(self_ref);
     }
-    pg->unlock();
   }
+  if (pg)
+    pg->unlock();
 }
 
 void Notify::register_cb()
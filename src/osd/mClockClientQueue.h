@@ -57,6 +57,11 @@ namespace ceph {
       return queue.get_size_slow();
     }
 
+    /// derive the op class parameters from osd_mclock_profile
+    bool set_capacity(CephContext *cct, double iops, double bandwidth) {
+      return client_info_mgr.set_capacity(cct, iops, bandwidth);
+    }
+
     // Ops of this priority should be deleted immediately
     inline void remove_by_class(Client cl,
 				std::list<Request> *out) override final {
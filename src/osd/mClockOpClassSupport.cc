@@ -13,6 +13,8 @@
  */
 
 
+#include <algorithm>
+
 #include "common/dout.h"
 #include "osd/mClockOpClassSupport.h"
 #include "osd/OpQueueItem.h"
@@ -74,6 +76,77 @@ namespace ceph {
 	rep_op_msg_bitset.to_string() << dendl;
     }
 
+    namespace {
+      // share of an op class in a profile; reservation and limit are
+      // fractions of the capacity, a limit of 0 means no limit
+      struct profile_alloc_t {
+	double res;
+	double wgt;
+	double lim;
+      };
+
+      struct profile_t {
+	const char *name;
+	profile_alloc_t client;     ///< client ops and their replication
+	profile_alloc_t recovery;   ///< recovery and backfill
+	profile_alloc_t best_effort; ///< scrub, snap trimming, pg deletion
+      };
+
+      constexpr profile_t profiles[] = {
+	{ "high_client_ops",   {.6, 2, 0}, {.2, 1, .5},  {0, 1, .2} },
+	{ "balanced",          {.4, 1, 0}, {.4, 1, .8},  {0, 1, .3} },
+	{ "high_recovery_ops", {.3, 1, 0}, {.6, 2, 0},   {0, 1, .3} },
+      };
+
+      crimson::dmclock::ClientInfo profile_info(const profile_alloc_t& a,
+						double capacity) {
+	return crimson::dmclock::ClientInfo(
+	  a.res * capacity, a.wgt, a.lim * capacity);
+      }
+    }
+
+    bool OpClassClientInfoMgr::set_capacity(CephContext *cct,
+					    double iops,
+					    double bandwidth) {
+      auto name = cct->_conf.get_val<std::string>("osd_mclock_profile");
+      const profile_t *profile = nullptr;
+      for (auto& p : profiles) {
+	if (name == p.name) {
+	  profile = &p;
+	}
+      }
+      if (!profile || iops <= 0) {
+	return false;
+      }
+
+      // a recovery op moves up to a whole chunk, so it is bandwidth that
+      // bounds how many of them the device can take
+      double recovery_iops = iops;
+      if (bandwidth > 0 && cct->_conf->osd_recovery_max_chunk > 0) {
+	recovery_iops = std::min(
+	  iops, bandwidth / cct->_conf->osd_recovery_max_chunk);
+      }
+
+      client_op = profile_info(profile->client, iops);
+      osd_rep_op = profile_info(profile->client, iops);
+      recov = profile_info(profile->recovery, recovery_iops);
+      scrub = profile_info(profile->best_effort, iops);
+      snaptrim = profile_info(profile->best_effort, iops);
+      pg_delete = profile_info(profile->best_effort, iops);
+
+      lgeneric_subdout(cct, osd, 1) <<
+	"mClock profile " << name << " for " << iops << " iops, " <<
+	bandwidth << " bytes/s:: " <<
+	"client_op:" << client_op <<
+	"; osd_rep_op:" << osd_rep_op <<
+	"; snaptrim:" << snaptrim <<
+	"; recov:" << recov <<
+	"; scrub:" << scrub <<
+	"; pg_delete:" << pg_delete <<
+	dendl;
+      return true;
+    }
+
     void OpClassClientInfoMgr::add_rep_op_msg(int message_code) {
       ceph_assert(message_code >= 0 && message_code < int(rep_op_msg_bitset_size));
       rep_op_msg_bitset.set(message_code);
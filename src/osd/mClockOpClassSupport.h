@@ -49,6 +49,11 @@ namespace ceph {
 
       OpClassClientInfoMgr(CephContext *cct);
 
+      /// replace the configured parameters with those osd_mclock_profile
+      /// derives from the measured capacity of the store (ops/s for small
+      /// writes, bytes/s for large ones); false with the custom profile
+      bool set_capacity(CephContext *cct, double iops, double bandwidth);
+
       inline const crimson::dmclock::ClientInfo*
       get_client_info(osd_op_type_t type) {
 	switch(type) {
@@ -2,9 +2,12 @@
 // vim: ts=8 sw=2 smarttab
 
 #include "osd_perf_counters.h"
+#include "include/stringify.h"
 
 PerfCounters *build_osd_logger(CephContext *cct) {
   PerfCountersBuilder osd_plb(cct, "osd", l_osd_first, l_osd_last);
+  // updated by every op thread
+  osd_plb.set_sharded(true);
 
   // Latency axis configuration for op histograms, values are in nanoseconds
   PerfHistogramCommon::axis_config_d op_hist_x_axis_config{
@@ -276,6 +279,10 @@ PerfCounters *build_osd_logger(CephContext *cct) {
   osd_plb.add_u64_counter(
     l_osd_pg_biginfo, "osd_pg_biginfo", "PG updated its biginfo attr");
 
+  osd_plb.add_u64(
+    l_osd_scrub_pace, "scrub_pace",
+    "Scrub pace in thousandths (1000 = unthrottled)");
+
   return osd_plb.create_perf_counters();
 }
  
@@ -317,3 +324,30 @@ PerfCounters *build_recoverystate_perf(CephContext *cct) {
 
   return rs_perf.create_perf_counters();
 }
+
+PerfCounters *build_osd_shard_logger(CephContext *cct, unsigned shard_id) {
+  PerfCountersBuilder shard_plb(cct, "osd_shard_" + stringify(shard_id),
+				l_osd_shard_first, l_osd_shard_last);
+
+  shard_plb.add_u64(
+    l_osd_shard_queue_depth, "queue_depth",
+    "Items waiting in the shard's op queue", "qd",
+    PerfCountersBuilder::PRIO_INTERESTING);
+  shard_plb.add_u64_counter(
+    l_osd_shard_steals, "steals",
+    "Items this shard's threads took from other shards");
+  shard_plb.add_u64_counter(
+    l_osd_shard_stolen, "stolen",
+    "Items other shards' threads took from this shard");
+  shard_plb.add_u64_counter(
+    l_osd_shard_spin_hits, "spin_hits",
+    "Idle spins that found work before blocking");
+  shard_plb.add_u64_counter(
+    l_osd_shard_spin_misses, "spin_misses",
+    "Idle spins that ran out of budget and blocked");
+  shard_plb.add_u64_counter(
+    l_osd_shard_batched_ops, "batched_ops",
+    "Ops run under a pg lock taken for an earlier op");
+
+  return shard_plb.create_perf_counters();
+}
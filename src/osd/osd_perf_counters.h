@@ -117,6 +117,8 @@ enum {
   l_osd_pg_fastinfo,
   l_osd_pg_biginfo,
 
+  l_osd_scrub_pace,
+
   l_osd_last,
 };
 
@@ -160,3 +162,17 @@ enum {
 };
 
 PerfCounters *build_recoverystate_perf(CephContext *cct);
+
+// OSDShard perf counters
+enum {
+  l_osd_shard_first = 21000,
+  l_osd_shard_queue_depth,
+  l_osd_shard_steals,
+  l_osd_shard_stolen,
+  l_osd_shard_spin_hits,
+  l_osd_shard_spin_misses,
+  l_osd_shard_batched_ops,
+  l_osd_shard_last,
+};
+
+PerfCounters *build_osd_shard_logger(CephContext *cct, unsigned shard_id);
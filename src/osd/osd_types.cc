@@ -4406,9 +4406,15 @@ string pg_log_entry_t::get_key_name() const
 
 void pg_log_entry_t::encode_with_checksum(ceph::buffer::list& bl) const
 {
-  using ceph::encode;
   ceph::buffer::list ebl(sizeof(*this)*2);
   this->encode(ebl);
+  encode_with_checksum(ebl, bl);
+}
+
+void pg_log_entry_t::encode_with_checksum(const ceph::buffer::list& ebl,
+					  ceph::buffer::list& bl)
+{
+  using ceph::encode;
   __u32 crc = ebl.crc32c(0);
   encode(ebl, bl);
   encode(crc, bl);
@@ -455,21 +455,13 @@ struct pg_t {
   hobject_t get_hobj_start() const;
   hobject_t get_hobj_end(unsigned pg_num) const;
 
-  void encode(ceph::buffer::list& bl) const {
-    using ceph::encode;
-    __u8 v = 1;
-    encode(v, bl);
-    encode(m_pool, bl);
-    encode(m_seed, bl);
-    encode((int32_t)-1, bl); // was preferred
-  }
-  void decode(ceph::buffer::list::const_iterator& bl) {
-    using ceph::decode;
-    __u8 v;
-    decode(v, bl);
-    decode(m_pool, bl);
-    decode(m_seed, bl);
-    bl.advance(sizeof(int32_t)); // was preferred
+  DENC(pg_t, v, p) {
+    __u8 struct_v = 1;
+    denc(struct_v, p);
+    denc(v.m_pool, p);
+    denc(v.m_seed, p);
+    int32_t preferred = -1; // was preferred
+    denc(preferred, p);
   }
   void decode_old(ceph::buffer::list::const_iterator& bl) {
     using ceph::decode;
@@ -480,7 +472,7 @@ struct pg_t {
   void dump(ceph::Formatter *f) const;
   static void generate_test_instances(std::list<pg_t*>& o);
 };
-WRITE_CLASS_ENCODER(pg_t)
+WRITE_CLASS_DENC_BOUNDED(pg_t)
 
 inline bool operator<(const pg_t& l, const pg_t& r) {
   return l.pool() < r.pool() ||
@@ -863,30 +855,18 @@ public:
     ritoa<uint32_t, 10, 10>(epoch, key + 10);
   }
 
-  void encode(ceph::buffer::list &bl) const {
-#if defined(CEPH_LITTLE_ENDIAN)
-    bl.append((char *)this, sizeof(version_t) + sizeof(epoch_t));
-#else
-    using ceph::encode;
-    encode(version, bl);
-    encode(epoch, bl);
-#endif
-  }
-  void decode(ceph::buffer::list::const_iterator &bl) {
-#if defined(CEPH_LITTLE_ENDIAN)
-    bl.copy(sizeof(version_t) + sizeof(epoch_t), (char *)this);
-#else
-    using ceph::decode;
-    decode(version, bl);
-    decode(epoch, bl);
-#endif
-  }
-  void decode(ceph::buffer::list& bl) {
-    auto p = std::cbegin(bl);
-    decode(p);
+  DENC(eversion_t, v, p) {
+    denc(v.version, p);
+    denc(v.epoch, p);
   }
+  void decode(ceph::buffer::list& bl);
 };
-WRITE_CLASS_ENCODER(eversion_t)
+WRITE_CLASS_DENC_BOUNDED(eversion_t)
+
+inline void eversion_t::decode(ceph::buffer::list& bl) {
+  auto p = std::cbegin(bl);
+  ceph::decode(*this, p);
+}
 
 inline bool operator==(const eversion_t& l, const eversion_t& r) {
   return (l.epoch == r.epoch) && (l.version == r.version);
@@ -3930,6 +3910,9 @@ struct pg_log_entry_t {
 
   std::string get_key_name() const;
   void encode_with_checksum(ceph::buffer::list& bl) const;
+  /// same as above for an entry already encoded with encode()
+  static void encode_with_checksum(const ceph::buffer::list& ebl,
+				   ceph::buffer::list& bl);
   void decode_with_checksum(ceph::buffer::list::const_iterator& p);
 
   void encode(ceph::buffer::list &bl) const;
@@ -4060,15 +4043,18 @@ public:
 
     eversion_t old_tail;
     unsigned mask = ~((~0)<<split_bits);
+    // move the entries over rather than copying them; they can carry
+    // sizable mod_desc and snaps bufferlists
     for (auto i = oldlog.begin();
 	 i != oldlog.end();
       ) {
+      auto next = std::next(i);
       if ((i->soid.get_hash() & mask) == child_pgid.m_seed) {
-	childlog.push_back(*i);
+	childlog.splice(childlog.end(), oldlog, i);
       } else {
-	log.push_back(*i);
+	log.splice(log.end(), oldlog, i);
       }
-      oldlog.erase(i++);
+      i = next;
     }
 
     // osd_reqid is unique, so it doesn't matter if there are extra
@@ -6013,6 +5999,72 @@ struct pool_pg_num_history_t {
 };
 WRITE_CLASS_ENCODER(pool_pg_num_history_t)
 
+/**
+ * how far a deep scrub of a pg got, persisted by the primary in its
+ * pgmeta object so that the scrub can pick up from there after a restart
+ */
+struct pg_scrub_checkpoint_t {
+  hobject_t pos;             ///< everything before this has been scrubbed
+  utime_t started;           ///< when the interrupted scrub began
+  uint32_t pg_num = 0;       ///< pool pg_num the positions refer to
+  int32_t shallow_errors = 0;
+  int32_t deep_errors = 0;
+  int32_t large_omap_objects = 0;
+  int64_t omap_bytes = 0;
+  int64_t omap_keys = 0;
+
+  void encode(ceph::buffer::list& bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(pos, bl);
+    encode(started, bl);
+    encode(pg_num, bl);
+    encode(shallow_errors, bl);
+    encode(deep_errors, bl);
+    encode(large_omap_objects, bl);
+    encode(omap_bytes, bl);
+    encode(omap_keys, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(ceph::buffer::list::const_iterator& p) {
+    DECODE_START(1, p);
+    decode(pos, p);
+    decode(started, p);
+    decode(pg_num, p);
+    decode(shallow_errors, p);
+    decode(deep_errors, p);
+    decode(large_omap_objects, p);
+    decode(omap_bytes, p);
+    decode(omap_keys, p);
+    DECODE_FINISH(p);
+  }
+  void dump(ceph::Formatter *f) const {
+    f->dump_stream("pos") << pos;
+    f->dump_stream("started") << started;
+    f->dump_unsigned("pg_num", pg_num);
+    f->dump_int("shallow_errors", shallow_errors);
+    f->dump_int("deep_errors", deep_errors);
+    f->dump_int("large_omap_objects", large_omap_objects);
+    f->dump_int("omap_bytes", omap_bytes);
+    f->dump_int("omap_keys", omap_keys);
+  }
+  static void generate_test_instances(std::list<pg_scrub_checkpoint_t*>& ls) {
+    ls.push_back(new pg_scrub_checkpoint_t);
+    ls.push_back(new pg_scrub_checkpoint_t);
+    ls.back()->pos = hobject_t(object_t("foo"), "", 123, 456, 1, "");
+    ls.back()->started = utime_t(1, 2);
+    ls.back()->pg_num = 64;
+    ls.back()->shallow_errors = 1;
+    ls.back()->deep_errors = 2;
+  }
+  friend std::ostream& operator<<(std::ostream& out,
+				  const pg_scrub_checkpoint_t& c) {
+    return out << "scrub_checkpoint(" << c.pos << " started " << c.started
+	       << " pg_num " << c.pg_num << " errors "
+	       << c.shallow_errors << "/" << c.deep_errors << ")";
+  }
+};
+WRITE_CLASS_ENCODER(pg_scrub_checkpoint_t)
+
 // prefix pgmeta_oid keys with _ so that PGLog::read_log_and_missing() can
 // easily skip them
 static const string_view infover_key = "_infover"sv;
@@ -6020,6 +6072,7 @@ static const string_view info_key = "_info"sv;
 static const string_view biginfo_key = "_biginfo"sv;
 static const string_view epoch_key = "_epoch"sv;
 static const string_view fastinfo_key = "_fastinfo"sv;
+static const string_view scrub_checkpoint_key = "_scrub_ckpt"sv;
 
 static const __u8 pg_latest_struct_v = 10;
 // v10 is the new past_intervals encoding
@@ -13,6 +13,7 @@
 
 #define MAX_FLUSH_UNDER_LOCK 20  ///< max bh's we start writeback on
 #define BUFFER_MEMORY_WEIGHT CEPH_PAGE_SHIFT  // memory usage of BufferHead, count in (1<<n)
+#define MAX_CLEAN_BH_BUFFERS 16  ///< fragments a clean bh may keep before compaction
 
 using std::chrono::seconds;
 				 /// while holding the lock
@@ -242,7 +243,18 @@ void ObjectCacher::Object::maybe_rebuild_buffer(BufferHead *bh)
 
   auto wasted = bl.get_wasted_space();
   if (wasted * 2 > bl.length() &&
-      wasted > (1U << BUFFER_MEMORY_WEIGHT))
+      wasted > (1U << BUFFER_MEMORY_WEIGHT)) {
+    bl.rebuild();
+    return;
+  }
+
+  // a clean bh that was assembled from many small writes (or reads) is
+  // walked fragment by fragment on every cache hit; compact it once,
+  // unless the fragments are large enough that the walk is cheap anyway.
+  if (bh->is_clean() &&
+      bl.get_num_buffers() > MAX_CLEAN_BH_BUFFERS &&
+      bl.length() / bl.get_num_buffers() <
+        (MAX_CLEAN_BH_BUFFERS << BUFFER_MEMORY_WEIGHT))
     bl.rebuild();
 }
 
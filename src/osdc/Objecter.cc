@@ -13,6 +13,7 @@
  */
 
 #include <cerrno>
+#include <limits>
 
 #include "Objecter.h"
 #include "osd/OSDMap.h"
@@ -94,6 +95,8 @@ enum {
   l_osdc_op_send_bytes,
   l_osdc_op_resend,
   l_osdc_op_reply,
+  l_osdc_op_hedge,
+  l_osdc_op_hedge_win,
 
   l_osdc_op,
   l_osdc_op_r,
@@ -169,6 +172,7 @@ enum {
 
 static const char *config_keys[] = {
   "crush_location",
+  "objecter_localize_reads_policy",
   NULL
 };
 
@@ -240,6 +244,9 @@ void Objecter::handle_conf_change(const ConfigProxy& conf,
   if (changed.count("crush_location")) {
     update_crush_location();
   }
+  if (changed.count("objecter_localize_reads_policy")) {
+    update_localize_reads_policy();
+  }
 }
 
 void Objecter::update_crush_location()
@@ -248,6 +255,12 @@ void Objecter::update_crush_location()
   crush_location = cct->crush_location.get_location();
 }
 
+void Objecter::update_localize_reads_policy()
+{
+  localize_reads_by_latency = cct->_conf.get_val<std::string>(
+    "objecter_localize_reads_policy") == "latency";
+}
+
 // messages ------------------------------
 
 /*
@@ -267,6 +280,10 @@ void Objecter::init()
     pcb.add_u64_counter(l_osdc_op_send_bytes, "op_send_bytes", "Sent data", NULL, 0, unit_t(UNIT_BYTES));
     pcb.add_u64_counter(l_osdc_op_resend, "op_resend", "Resent operations");
     pcb.add_u64_counter(l_osdc_op_reply, "op_reply", "Operation reply");
+    pcb.add_u64_counter(l_osdc_op_hedge, "op_hedge",
+			"Slow reads also sent to a replica");
+    pcb.add_u64_counter(l_osdc_op_hedge_win, "op_hedge_win",
+			"Hedged reads answered by the replica first");
 
     pcb.add_u64_counter(l_osdc_op, "op", "Operations");
     pcb.add_u64_counter(l_osdc_op_r, "op_r", "Read operations", "rd",
@@ -396,6 +413,7 @@ void Objecter::init()
   }
 
   update_crush_location();
+  update_localize_reads_policy();
 
   cct->_conf.add_observer(this);
 
@@ -412,6 +430,7 @@ void Objecter::start(const OSDMap* o)
   start_tick();
   if (o) {
     osdmap->deepish_copy_from(*o);
+    invalidate_pg_mapping(osdmap->get_epoch());
     prune_pg_mapping(osdmap->get_pools());
   } else if (osdmap->get_epoch() == 0) {
     _maybe_request_map();
@@ -1151,6 +1170,44 @@ void Objecter::_scan_requests(
   }
 }
 
+bool Objecter::_inc_may_remap_pgs(const OSDMap::Incremental& inc) const
+{
+  // anything that feeds OSDMap::pg_to_up_acting_osds()
+  if (inc.fullmap.length() || inc.crush.length() ||
+      inc.new_max_osd >= 0 ||
+      !inc.new_up_client.empty() ||
+      !inc.new_state.empty() ||
+      !inc.new_weight.empty() ||
+      !inc.new_primary_affinity.empty() ||
+      !inc.new_pg_temp.empty() ||
+      !inc.new_primary_temp.empty() ||
+      !inc.new_pg_upmap.empty() ||
+      !inc.old_pg_upmap.empty() ||
+      !inc.new_pg_upmap_items.empty() ||
+      !inc.old_pg_upmap_items.empty() ||
+      !inc.old_pools.empty()) {
+    return true;
+  }
+  // pool updates are mostly snaps and quotas; only the placement
+  // fields matter here
+  for (auto& [id, pool] : inc.new_pools) {
+    auto old = osdmap->get_pg_pool(id);
+    if (!old) {
+      continue;
+    }
+    if (old->get_type() != pool.get_type() ||
+	old->get_size() != pool.get_size() ||
+	old->get_crush_rule() != pool.get_crush_rule() ||
+	old->get_pg_num() != pool.get_pg_num() ||
+	old->get_pgp_num() != pool.get_pgp_num() ||
+	old->has_flag(pg_pool_t::FLAG_HASHPSPOOL) !=
+	  pool.has_flag(pg_pool_t::FLAG_HASHPSPOOL)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void Objecter::handle_osd_map(MOSDMap *m)
 {
   shunique_lock sul(rwlock, acquire_unique);
@@ -1201,7 +1258,11 @@ void Objecter::handle_osd_map(MOSDMap *m)
 	  ldout(cct, 3) << "handle_osd_map decoding incremental epoch " << e
 			<< dendl;
 	  OSDMap::Incremental inc(m->incremental_maps[e]);
+	  bool remap = _inc_may_remap_pgs(inc);
 	  osdmap->apply_incremental(inc);
+	  if (remap) {
+	    invalidate_pg_mapping(osdmap->get_epoch());
+	  }
 
           emit_blacklist_events(inc);
 
@@ -1214,6 +1275,7 @@ void Objecter::handle_osd_map(MOSDMap *m)
 
           emit_blacklist_events(*osdmap, *new_osdmap);
           osdmap = std::move(new_osdmap);
+	  invalidate_pg_mapping(osdmap->get_epoch());
 
 	  logger->inc(l_osdc_map_full);
 	}
@@ -1280,6 +1342,7 @@ void Objecter::handle_osd_map(MOSDMap *m)
 	ldout(cct, 3) << "handle_osd_map decoding full epoch "
 		      << m->get_last() << dendl;
 	osdmap->decode(m->maps[m->get_last()]);
+	invalidate_pg_mapping(osdmap->get_epoch());
         prune_pg_mapping(osdmap->get_pools());
 
 	_scan_requests(homeless_session, false, false, NULL,
@@ -2194,6 +2257,8 @@ void Objecter::tick()
   logger->set(l_osdc_op_laggy, laggy_ops);
   logger->set(l_osdc_osd_laggy, toping.size());
 
+  _update_hedge_delay();
+
   if (!toping.empty()) {
     // send a ping to these osds, to ensure we detect any session resets
     // (osd reply message policy is lossy)
@@ -2285,7 +2350,11 @@ void Objecter::_op_submit_with_budget(Op *op, shunique_lock& sul,
   ceph_assert(op->ops.size() == op->out_handler.size());
 
   // throttle.  before we look at any state, because
-  // _take_op_budget() may drop our lock while it blocks.
+  // _throttle_op_osd() and _take_op_budget() may drop our lock while
+  // they block.
+  if (osd_inflight_ops) {
+    _throttle_op_osd(op, sul);
+  }
   if (!op->ctx_budgeted || (ctx_budget && (*ctx_budget == -1))) {
     int op_budget = _take_op_budget(op, sul);
     // take and pass out the budget for the first OP
@@ -2304,9 +2373,128 @@ void Objecter::_op_submit_with_budget(Op *op, shunique_lock& sul,
 				      op_cancel(tid, -ETIMEDOUT); });
   }
 
+  if (hedge_reads && _op_can_hedge(op)) {
+    if (op->tid == 0)
+      op->tid = ++last_tid;
+    op->hedge_stamp = ceph::mono_clock::now();
+    if (auto delay = hedge_delay.load(); delay > 0) {
+      auto tid = op->tid;
+      op->onhedge = timer.add_event(ceph::timespan(delay),
+				    [this, tid]() {
+				      hedge_read(tid); });
+    }
+  }
+
   _op_submit(op, sul, ptid);
 }
 
+bool Objecter::_op_can_hedge(const Op *op) const
+{
+  // rwlock is locked
+
+  // only plain reads that somebody is waiting for; balanced and
+  // localized reads already picked their replica
+  int flags = op->target.flags;
+  if ((flags & (CEPH_OSD_FLAG_READ | CEPH_OSD_FLAG_WRITE)) !=
+      CEPH_OSD_FLAG_READ ||
+      (flags & (CEPH_OSD_FLAG_PGOP |
+		CEPH_OSD_FLAG_RWORDERED |
+		CEPH_OSD_FLAG_BALANCE_READS |
+		CEPH_OSD_FLAG_LOCALIZE_READS)) ||
+      !op->onfinish ||
+      op->target.precalc_pgid) {
+    return false;
+  }
+  // erasure coded pools have fast_read for this
+  const pg_pool_t *pi = osdmap->get_pg_pool(op->target.base_oloc.pool);
+  return pi && pi->is_replicated() && pi->get_size() > 1;
+}
+
+void Objecter::_record_read_latency(ceph::timespan lat)
+{
+  std::lock_guard l(hedge_lock);
+  if (read_latencies.size() < hedge_history) {
+    read_latencies.push_back(lat);
+  } else {
+    read_latencies[read_latency_pos] = lat;
+    read_latency_pos = (read_latency_pos + 1) % hedge_history;
+  }
+}
+
+void Objecter::_update_hedge_delay()
+{
+  double pct = cct->_conf.get_val<double>("objecter_hedged_read_percentile");
+  hedge_reads = pct > 0;
+  if (!hedge_reads) {
+    hedge_delay = 0;
+    return;
+  }
+
+  std::vector<ceph::timespan> lat;
+  {
+    std::lock_guard l(hedge_lock);
+    lat = read_latencies;
+  }
+  if (lat.size() < hedge_min_samples) {
+    // not enough history to tell a slow read from a normal one
+    hedge_delay = 0;
+    return;
+  }
+  auto nth = lat.begin() + std::min(
+    static_cast<size_t>(lat.size() * pct / 100.0), lat.size() - 1);
+  std::nth_element(lat.begin(), nth, lat.end());
+  auto min_delay = ceph::make_timespan(
+    cct->_conf.get_val<double>("objecter_hedged_read_min_delay"));
+  hedge_delay = std::max(*nth, min_delay).count();
+  ldout(cct, 10) << __func__ << " p" << pct << " of " << lat.size()
+		 << " reads is " << *nth << ", hedging after "
+		 << ceph::timespan(hedge_delay) << dendl;
+}
+
+void Objecter::hedge_read(ceph_tid_t tid)
+{
+  shunique_lock sul(rwlock, ceph::acquire_unique);
+  if (!initialized) {
+    return;
+  }
+
+  OSDSession *s = nullptr;
+  Op *op = _find_op(tid, &s);
+  if (!op) {
+    return;
+  }
+  OSDSession::unique_lock sl(s->lock);
+  op->onhedge = 0;
+  if (!op->onfinish || op->hedge_tid || s->is_homeless() ||
+      op->target.paused || op->target.acting.size() < 2 ||
+      (op->target.flags & CEPH_OSD_FLAG_REDIRECTED)) {
+    return;
+  }
+
+  // the replica bounces the read back with EAGAIN unless it is safe
+  // to serve, see PeeringState::can_serve_replica_read()
+  vector<OSDOp> ops = op->ops;
+  Op *h = new Op(op->target.base_oid, op->target.base_oloc, ops,
+		 op->target.flags | CEPH_OSD_FLAG_BALANCE_READS,
+		 nullptr, nullptr);
+  h->target.hedge = true;
+  h->snapid = op->snapid;
+  h->snapc = op->snapc;
+  h->mtime = op->mtime;
+  h->priority = op->priority;
+  h->features = op->features;
+  h->tid = ++last_tid;
+  h->hedge_of = tid;
+  op->hedge_tid = h->tid;
+  sl.unlock();
+
+  ldout(cct, 10) << __func__ << " tid " << tid << " slower than "
+		 << ceph::timespan(hedge_delay) << ", hedging with tid "
+		 << h->tid << dendl;
+  logger->inc(l_osdc_op_hedge);
+  _op_submit(h, sul, nullptr);
+}
+
 void Objecter::_send_op_account(Op *op)
 {
   inflight_ops++;
@@ -2846,13 +3034,18 @@ int Objecter::_calc_target(op_target_t *t, Connection *con, bool any_change)
     ceph_assert(t->base_oid.name.empty()); // make sure this is a pg op
     ceph_assert(t->base_oloc.pool == (int64_t)t->base_pgid.pool());
     pgid = t->base_pgid;
+  } else if (t->target_oloc.hash >= 0) {
+    pgid = pg_t(t->target_oloc.hash, t->target_oloc.pool);
   } else {
-    int ret = osdmap->object_locator_to_pg(t->target_oid, t->target_oloc,
-					   pgid);
-    if (ret == -ENOENT) {
-      t->osd = -1;
-      return RECALC_OP_TARGET_POOL_DNE;
+    // every resend maps the same name again, only rehash it if the
+    // (tier) pool hashes names differently
+    if (t->raw_hash_type != pi->get_object_hash()) {
+      t->raw_hash = pi->hash_key(t->target_oloc.key.empty() ?
+				   t->target_oid.name : t->target_oloc.key,
+				 t->target_oloc.nspace);
+      t->raw_hash_type = pi->get_object_hash();
     }
+    pgid = pg_t(t->raw_hash, t->target_oloc.pool);
   }
   ldout(cct,20) << __func__ << " target " << t->target_oid << " "
 		<< t->target_oloc << " -> pgid " << pgid << dendl;
@@ -2958,13 +3151,59 @@ int Objecter::_calc_target(op_target_t *t, Connection *con, bool any_change)
     } else {
       int osd;
       bool read = is_read && !is_write;
-      if (read && (t->flags & CEPH_OSD_FLAG_BALANCE_READS)) {
+      if (read && t->hedge && acting.size() > 1) {
+	// any replica but the primary, which already has the read
+	vector<int> replicas;
+	for (auto o : acting) {
+	  if (o != acting_primary && o != CRUSH_ITEM_NONE)
+	    replicas.push_back(o);
+	}
+	if (replicas.empty()) {
+	  osd = acting_primary;
+	} else {
+	  osd = replicas[rand() % replicas.size()];
+	  t->used_replica = true;
+	}
+	ldout(cct, 10) << " chose hedge osd." << osd << " of " << acting
+		       << dendl;
+      } else if (read && (t->flags & CEPH_OSD_FLAG_BALANCE_READS)) {
 	int p = rand() % acting.size();
 	if (p)
 	  t->used_replica = true;
 	osd = acting[p];
 	ldout(cct, 10) << " chose random osd." << osd << " of " << acting
 		       << dendl;
+      } else if (read && (t->flags & CEPH_OSD_FLAG_LOCALIZE_READS) &&
+		 acting.size() > 1 && localize_reads_by_latency) {
+	// go to the osd that has been answering fastest.  osds we have not
+	// heard from yet are tried first, and an occasional random pick
+	// keeps the averages of the others from going stale.
+	int best = 0;
+	if (rand() % localize_explore_ratio == 0) {
+	  best = rand() % acting.size();
+	} else {
+	  uint64_t best_rtt = std::numeric_limits<uint64_t>::max();
+	  for (unsigned i = 0; i < acting.size(); ++i) {
+	    if (acting[i] == CRUSH_ITEM_NONE)
+	      continue;
+	    auto p = osd_sessions.find(acting[i]);
+	    uint64_t rtt = p == osd_sessions.end() ? 0 : p->second->rtt_ewma.load();
+	    ldout(cct, 20) << __func__ << " localize: rank " << i
+			   << " osd." << acting[i]
+			   << " rtt " << ceph::timespan(rtt) << dendl;
+	    if (rtt < best_rtt) {
+	      best = i;
+	      best_rtt = rtt;
+	    }
+	  }
+	}
+	if (acting[best] == CRUSH_ITEM_NONE)
+	  best = 0;
+	if (best)
+	  t->used_replica = true;
+	osd = acting[best];
+	ldout(cct, 10) << " chose fastest osd." << osd << " of " << acting
+		       << dendl;
       } else if (read && (t->flags & CEPH_OSD_FLAG_LOCALIZE_READS) &&
 		 acting.size() > 1) {
 	// look for a local replica.  prefer the primary if the
@@ -3041,6 +3280,9 @@ void Objecter::_session_op_remove(OSDSession *from, Op *op)
   }
 
   from->ops.erase(op->tid);
+  if (from->num_ops_waiters) {
+    from->ops_cond.notify_all();
+  }
   put_session(from);
   op->session = NULL;
 
@@ -3172,6 +3414,22 @@ void Objecter::_finish_op(Op *op, int r)
   if (op->ontimeout && r != -ETIMEDOUT)
     timer.cancel_event(op->ontimeout);
 
+  if (op->onhedge)
+    timer.cancel_event(op->onhedge);
+
+  if (op->hedge_tid) {
+    // our hedge lost the race (or no longer matters); cancel it once we
+    // are out from under this session's lock
+    auto hedge_tid = op->hedge_tid;
+    op->hedge_tid = 0;
+    timer.add_event(ceph::timespan::zero(),
+		    [this, hedge_tid]() {
+		      unique_lock wl(rwlock);
+		      if (initialized)
+			_op_cancel(hedge_tid, -ECANCELED);
+		    });
+  }
+
   if (op->session) {
     _session_op_remove(op->session, op);
   }
@@ -3185,6 +3443,26 @@ void Objecter::_finish_op(Op *op, int r)
   op->put();
 }
 
+Objecter::Op *Objecter::_find_op(ceph_tid_t tid, OSDSession **ps)
+{
+  // rwlock is locked
+  for (auto& [osd, s] : osd_sessions) {
+    OSDSession::shared_lock sl(s->lock);
+    auto p = s->ops.find(tid);
+    if (p != s->ops.end()) {
+      *ps = s;
+      return p->second;
+    }
+  }
+  OSDSession::shared_lock sl(homeless_session->lock);
+  auto p = homeless_session->ops.find(tid);
+  if (p != homeless_session->ops.end()) {
+    *ps = homeless_session;
+    return p->second;
+  }
+  return nullptr;
+}
+
 MOSDOp *Objecter::_prepare_osd_op(Op *op)
 {
   // rwlock is locked
@@ -3201,6 +3479,7 @@ MOSDOp *Objecter::_prepare_osd_op(Op *op)
 
   op->target.paused = false;
   op->stamp = ceph::coarse_mono_clock::now();
+  op->send_stamp = ceph::mono_clock::now();
 
   hobject_t hobj = op->target.get_hobj();
   MOSDOp *m = new MOSDOp(client_inc, op->tid,
@@ -3359,6 +3638,45 @@ void Objecter::_throttle_op(Op *op,
   }
 }
 
+void Objecter::_throttle_op_osd(Op *op, shunique_lock& sul)
+{
+  ceph_assert(sul && sul.mutex() == &rwlock);
+
+  // calculate on a copy, _op_submit() still needs to see whether the
+  // target changed
+  op_target_t target = op->target;
+  _calc_target(&target, nullptr);
+  auto p = osd_sessions.find(target.osd);
+  if (p == osd_sessions.end()) {
+    return;
+  }
+
+  OSDSession *s = p->second;
+  OSDSession::unique_lock sl(s->lock);
+  if (s->ops.size() < osd_inflight_ops) {
+    return;
+  }
+  ldout(cct, 10) << __func__ << " osd." << s->osd << " has " << s->ops.size()
+		 << " ops in flight, waiting" << dendl;
+
+  // only ops to this osd queue up behind it; the rest of the global
+  // budget stays available to the others
+  get_session(s);
+  bool locked_for_write = sul.owns_lock();
+  sl.unlock();
+  sul.unlock();
+  sl.lock();
+  ++s->num_ops_waiters;
+  s->ops_cond.wait(sl, [this, s] { return s->ops.size() < osd_inflight_ops; });
+  --s->num_ops_waiters;
+  sl.unlock();
+  put_session(s);
+  if (locked_for_write)
+    sul.lock();
+  else
+    sul.lock_shared();
+}
+
 int Objecter::take_linger_budget(LingerOp *info)
 {
   return 1;
@@ -3372,7 +3690,10 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
   // get pio
   ceph_tid_t tid = m->get_tid();
 
-  shunique_lock sul(rwlock, ceph::acquire_shared);
+  // the common case only needs the session lock; rwlock is taken (before
+  // the session lock, as everywhere else) only if the op has to be
+  // resubmitted or its hedge looked up.
+  shunique_lock sul(rwlock, std::defer_lock);
   if (!initialized) {
     m->put();
     return;
@@ -3381,15 +3702,39 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
   ConnectionRef con = m->get_connection();
   auto priv = con->get_priv();
   auto s = static_cast<OSDSession*>(priv.get());
-  if (!s || s->con != con) {
+  if (!s) {
     ldout(cct, 7) << __func__ << " no session on con " << con << dendl;
     m->put();
     return;
   }
 
-  OSDSession::unique_lock sl(s->lock);
+  OSDSession::unique_lock sl(s->lock, std::defer_lock);
+  map<ceph_tid_t, Op *>::iterator iter;
+
+ relookup:
+  sl.lock();
+  if (s->con != con) {
+    ldout(cct, 7) << __func__ << " no session on con " << con << dendl;
+    sl.unlock();
+    m->put();
+    return;
+  }
 
-  map<ceph_tid_t, Op *>::iterator iter = s->ops.find(tid);
+  iter = s->ops.find(tid);
+  if (iter != s->ops.end() && !sul.owns_lock_shared() &&
+      (iter->second->hedge_of ||
+       (retry_writes_after_first_reply && iter->second->attempts == 1 &&
+	(iter->second->target.flags & CEPH_OSD_FLAG_WRITE)) ||
+       m->is_redirect_reply() ||
+       m->get_result() == -EAGAIN)) {
+    sl.unlock();
+    sul.lock_shared();
+    if (!initialized) {
+      m->put();
+      return;
+    }
+    goto relookup;
+  }
   if (iter == s->ops.end()) {
     ldout(cct, 7) << "handle_osd_op_reply " << tid
 		  << (m->is_ondisk() ? " ondisk" : (m->is_onnvram() ?
@@ -3409,6 +3754,46 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
 		<< dendl;
   Op *op = iter->second;
   op->trace.event("osd op reply");
+  if (op->send_stamp != ceph::mono_time()) {
+    s->update_rtt(ceph::mono_clock::now() - op->send_stamp);
+  }
+
+  bool hedged = false;
+  if (op->hedge_of) {
+    // whichever copy of a hedged read answers first completes it
+    ceph_tid_t orig_tid = op->hedge_of;
+    bool usable = !m->is_redirect_reply() && m->get_result() != -EAGAIN;
+    _finish_op(op, 0);
+    sl.unlock();
+    if (!usable) {
+      ldout(cct, 7) << " hedge tid " << tid << " declined by osd." << s->osd
+		    << dendl;
+      m->put();
+      return;
+    }
+
+    OSDSession *orig_s = nullptr;
+    if (_find_op(orig_tid, &orig_s)) {
+      sl = OSDSession::unique_lock(orig_s->lock);
+      iter = orig_s->ops.find(orig_tid);
+    }
+    if (!orig_s || iter == orig_s->ops.end()) {
+      ldout(cct, 7) << " hedge tid " << tid << " lost to tid " << orig_tid
+		    << dendl;
+      if (sl.owns_lock())
+	sl.unlock();
+      m->put();
+      return;
+    }
+    ldout(cct, 7) << " hedge tid " << tid << " completes tid " << orig_tid
+		  << dendl;
+    get_session(orig_s);
+    s = orig_s;
+    op = iter->second;
+    op->hedge_tid = 0;
+    hedged = true;
+    logger->inc(l_osdc_op_hedge_win);
+  }
 
   if (retry_writes_after_first_reply && op->attempts == 1 &&
       (op->target.flags & CEPH_OSD_FLAG_WRITE)) {
@@ -3424,7 +3809,7 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
     return;
   }
 
-  if (m->get_retry_attempt() >= 0) {
+  if (!hedged && m->get_retry_attempt() >= 0) {
     if (m->get_retry_attempt() != (op->attempts - 1)) {
       ldout(cct, 7) << " ignoring reply from attempt "
 		    << m->get_retry_attempt()
@@ -3481,7 +3866,8 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
     return;
   }
 
-  sul.unlock();
+  if (sul.owns_lock_shared())
+    sul.unlock();
 
   if (op->objver)
     *op->objver = m->get_user_version();
@@ -3559,6 +3945,10 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
   }
   logger->inc(l_osdc_op_reply);
 
+  if (op->hedge_stamp != ceph::mono_time()) {
+    _record_read_latency(ceph::mono_clock::now() - op->hedge_stamp);
+  }
+
   /* get it before we call _finish_op() */
   auto completion_lock = s->get_lock(op->target.base_oid);
 
@@ -3580,6 +3970,9 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
   if (completion_lock.mutex()) {
     completion_lock.unlock();
   }
+  if (hedged) {
+    put_session(s);
+  }
 
   m->put();
 }
@@ -4986,6 +5379,8 @@ Objecter::Objecter(CephContext *cct_, Messenger *m, MonClient *mc,
   op_throttle_bytes(cct, "objecter_bytes",
 		    cct->_conf->objecter_inflight_op_bytes),
   op_throttle_ops(cct, "objecter_ops", cct->_conf->objecter_inflight_ops),
+  osd_inflight_ops(
+    cct->_conf.get_val<uint64_t>("objecter_inflight_ops_per_osd")),
   retry_writes_after_first_reply(cct->_conf->objecter_retry_writes_after_first_reply)
 {}
 
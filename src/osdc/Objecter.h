@@ -1230,6 +1230,10 @@ private:
 public:
   using Dispatcher::cct;
   std::multimap<std::string,std::string> crush_location;
+  /// localized reads go to the replica with the lowest observed latency
+  std::atomic<bool> localize_reads_by_latency{false};
+  /// one in this many latency-localized reads goes to a random replica
+  static constexpr int localize_explore_ratio = 16;
 
   std::atomic<bool> initialized{false};
 
@@ -1264,6 +1268,9 @@ private:
   std::shared_mutex pg_mapping_lock;
   // pool -> pg mapping
   std::map<int64_t, std::vector<pg_mapping_t>> pg_mappings;
+  // mappings computed before this epoch may be stale; it only moves
+  // forward on maps that can change how pgs are mapped
+  epoch_t pg_mapping_epoch = 0;
 
   // convenient accessors
   bool lookup_pg_mapping(const pg_t& pg, pg_mapping_t* pg_mapping) {
@@ -1274,7 +1281,9 @@ private:
     auto& mapping_array = it->second;
     if (pg.ps() >= mapping_array.size())
       return false;
-    if (mapping_array[pg.ps()].epoch != pg_mapping->epoch) // stale
+    auto epoch = mapping_array[pg.ps()].epoch;
+    if (epoch == 0 || epoch < pg_mapping_epoch ||
+	epoch > pg_mapping->epoch) // stale
       return false;
     *pg_mapping = mapping_array[pg.ps()];
     return true;
@@ -1285,6 +1294,11 @@ private:
     ceph_assert(pg.ps() < mapping_array.size());
     mapping_array[pg.ps()] = std::move(pg_mapping);
   }
+  void invalidate_pg_mapping(epoch_t epoch) {
+    std::lock_guard l{pg_mapping_lock};
+    pg_mapping_epoch = epoch;
+  }
+  bool _inc_may_remap_pgs(const OSDMap::Incremental& inc) const;
   void prune_pg_mapping(const mempool::osdmap::map<int64_t,pg_pool_t>& pools) {
     std::lock_guard l{pg_mapping_lock};
     for (auto& pool : pools) {
@@ -1330,6 +1344,7 @@ private:
   void start_tick();
   void tick();
   void update_crush_location();
+  void update_localize_reads_policy();
 
   class RequestStateHook;
 
@@ -1360,6 +1375,12 @@ public:
     ///< explcit pg target, if any
     pg_t base_pgid;
 
+    ///< cached hash of target_oid (or its locator key), which does not
+    ///< change across osdmaps; valid while raw_hash_type matches the
+    ///< target pool's object_hash
+    uint32_t raw_hash = 0;
+    int raw_hash_type = -1;
+
     pg_t pgid; ///< last (raw) pg we mapped to
     spg_t actual_pgid; ///< last (actual) spg_t we mapped to
     unsigned pg_num = 0; ///< last pg_num we mapped to
@@ -1375,6 +1396,7 @@ public:
     bool recovery_deletes = false; ///< whether the deletes are performed during recovery instead of peering
 
     bool used_replica = false;
+    bool hedge = false; ///< read from a replica other than the primary
     bool paused = false;
 
     int osd = -1;      ///< the final target osd, or -1
@@ -1436,6 +1458,11 @@ public:
     int priority;
     Context *onfinish;
     uint64_t ontimeout;
+    uint64_t onhedge = 0;
+
+    ceph_tid_t hedge_tid = 0; ///< our hedge read on a replica, if sent
+    ceph_tid_t hedge_of = 0;  ///< the read this op is a hedge for
+    ceph::mono_time hedge_stamp; ///< submit time of a hedgeable read
 
     ceph_tid_t tid;
     int attempts;
@@ -1444,6 +1471,7 @@ public:
     epoch_t *reply_epoch;
 
     ceph::coarse_mono_time stamp;
+    ceph::mono_time send_stamp; ///< precise send time, for the session rtt
 
     epoch_t map_dne_bound;
 
@@ -1917,6 +1945,10 @@ public:
     std::map<spg_t,std::map<hobject_t,OSDBackoff>> backoffs;
     std::map<uint64_t,OSDBackoff*> backoffs_by_id;
 
+    // submitters waiting for ops to drain below objecter_inflight_ops_per_osd
+    std::condition_variable_any ops_cond;
+    int num_ops_waiters = 0;
+
     int osd;
     int incarnation;
     ConnectionRef con;
@@ -1925,6 +1957,14 @@ public:
     using unique_completion_lock = std::unique_lock<
       decltype(completion_locks)::element_type>;
 
+    /// moving average of op reply latency in ns, 0 until the first reply
+    std::atomic<uint64_t> rtt_ewma{0};
+    void update_rtt(ceph::timespan rtt) {
+      uint64_t sample = std::max<uint64_t>(rtt.count(), 1);
+      uint64_t avg = rtt_ewma;
+      rtt_ewma = avg ? avg - avg / 8 + sample / 8 : sample;
+    }
+
 
     OSDSession(CephContext *cct, int o) :
       osd(o), incarnation(0), con(NULL),
@@ -1981,6 +2021,21 @@ public:
   void _send_op_account(Op *op);
   void _cancel_linger_op(Op *op);
   void _finish_op(Op *op, int r);
+  Op *_find_op(ceph_tid_t tid, OSDSession **ps);
+
+  // hedged reads
+  static constexpr size_t hedge_history = 1024;
+  static constexpr size_t hedge_min_samples = 32;
+  std::atomic<bool> hedge_reads{false};
+  std::atomic<uint64_t> hedge_delay{0}; ///< ns before a read is hedged
+  std::mutex hedge_lock;   ///< protects read_latencies
+  std::vector<ceph::timespan> read_latencies; ///< ring of recent reads
+  size_t read_latency_pos = 0;
+
+  bool _op_can_hedge(const Op *op) const;
+  void _record_read_latency(ceph::timespan lat);
+  void _update_hedge_delay();
+  void hedge_read(ceph_tid_t tid);
   static bool is_pg_changed(
     int oldprimary,
     const std::vector<int>& oldacting,
@@ -2066,6 +2121,7 @@ private:
    */
   int calc_op_budget(const std::vector<OSDOp>& ops);
   void _throttle_op(Op *op, shunique_lock& sul, int op_size = 0);
+  void _throttle_op_osd(Op *op, shunique_lock& sul);
   int _take_op_budget(Op *op, shunique_lock& sul) {
     ceph_assert(sul && sul.mutex() == &rwlock);
     int op_budget = calc_op_budget(op->ops);
@@ -2087,6 +2143,8 @@ private:
   }
   void put_nlist_context_budget(NListContext *list_context);
   Throttle op_throttle_bytes, op_throttle_ops;
+  // max in-flight ops per osd session, 0 for no limit
+  const uint64_t osd_inflight_ops;
 
  public:
   Objecter(CephContext *cct_, Messenger *m, MonClient *mc,
@@ -0,0 +1,338 @@
+"""
+Cluster-wide recovery and backfill scheduling.
+
+Each OSD grants recovery/backfill reservations on its own, up to
+osd_max_backfills, so after a failure the OSDs holding the most degraded
+PGs finish last while other OSDs sit idle.  This module looks at the
+pending recovery work reported in the PG stats and spreads the same total
+number of reservation slots across the OSDs in proportion to that work,
+by setting per-OSD osd_max_backfills overrides in the config database.
+Degraded objects weigh more than misplaced ones, so the OSDs gating the
+return to full redundancy get the extra slots.
+"""
+
+import errno
+import json
+from collections import defaultdict
+from threading import Event
+
+from mgr_module import MgrModule
+
+# pg states whose reservations we are scheduling; the *_toofull states
+# cannot make progress with more slots
+PENDING_STATES = ('recovery_wait', 'recovering',
+                  'backfill_wait', 'backfilling')
+
+# CRUSH_ITEM_NONE, a hole in an EC pg's up/acting set
+NONE_OSD = 0x7fffffff
+
+
+class Module(MgrModule):
+    MODULE_OPTIONS = [
+        {
+            'name': 'active',
+            'default': True,
+            'type': 'bool',
+            'desc': 'assign per-OSD recovery concurrency',
+            'runtime': True,
+        },
+        {
+            'name': 'sleep_interval',
+            'default': 10,
+            'type': 'secs',
+            'desc': 'how frequently to look at pending recovery work',
+            'runtime': True,
+        },
+        {
+            'name': 'min_backfills',
+            'default': 1,
+            'type': 'int',
+            'desc': 'fewest reservation slots given to an OSD with pending work',
+            'runtime': True,
+        },
+        {
+            'name': 'max_backfills',
+            'default': 8,
+            'type': 'int',
+            'desc': 'most reservation slots given to a single OSD',
+            'runtime': True,
+        },
+        {
+            'name': 'degraded_weight',
+            'default': 10,
+            'type': 'int',
+            'desc': 'how much more a degraded object counts than a misplaced one',
+            'runtime': True,
+        },
+        {
+            'name': 'min_change',
+            'default': 2,
+            'type': 'int',
+            'desc': 'smallest change of an OSD\'s slots worth updating its '
+                    'override for',
+            'runtime': True,
+        },
+        {
+            'name': 'max_updates',
+            'default': 20,
+            'type': 'int',
+            'desc': 'most osd_max_backfills overrides set or removed per pass '
+                    '(0 for no limit)',
+            'runtime': True,
+        },
+    ]
+
+    NATIVE_OPTIONS = [
+        'osd_max_backfills',
+    ]
+
+    COMMANDS = [
+        {
+            "cmd": "recovery-scheduler status",
+            "desc": "Show pending recovery work and assigned concurrency per OSD",
+            "perm": "r",
+        },
+        {
+            "cmd": "recovery-scheduler on",
+            "desc": "Enable cluster-wide recovery scheduling",
+            "perm": "rw",
+        },
+        {
+            "cmd": "recovery-scheduler off",
+            "desc": "Disable cluster-wide recovery scheduling and remove "
+                    "the per-OSD overrides it set",
+            "perm": "rw",
+        },
+    ]
+
+    def __init__(self, *args, **kwargs):
+        super(Module, self).__init__(*args, **kwargs)
+
+        # populate options (just until serve() runs)
+        for opt in self.MODULE_OPTIONS:
+            setattr(self, opt['name'], opt['default'])
+        self.osd_max_backfills = 1
+
+        self.run = True
+        self.event = Event()
+
+        # osd id -> osd_max_backfills we set for it
+        self.applied = {}
+        # osd id -> weighted pending work, as of the last pass
+        self.work = {}
+
+    def config_notify(self):
+        for opt in self.MODULE_OPTIONS:
+            setattr(self,
+                    opt['name'],
+                    self.get_module_option(opt['name']))
+            self.log.debug(' %s = %s', opt['name'], getattr(self, opt['name']))
+
+    def get_osd_max_backfills(self):
+        """
+        osd_max_backfills as the OSDs have it without our overrides.  Our
+        own value is no guide: it may come from a mgr section, and the
+        config database is where the OSDs would get theirs from.  Masked
+        settings are left out, there is no single value for them.
+        """
+        r, outb, outs = self.mon_command({
+            'prefix': 'config dump',
+            'format': 'json',
+        })
+        if r == 0:
+            found = {}
+            for opt in json.loads(outb):
+                if opt.get('name') == 'osd_max_backfills' and \
+                   not opt.get('mask'):
+                    found[opt.get('section')] = opt.get('value')
+            for section in ('osd', 'global'):
+                if section in found:
+                    return int(found[section])
+        else:
+            self.log.warn('failed to read the config database: %s', outs)
+        # the default, unless ceph.conf says otherwise
+        return int(self.get_ceph_option('osd_max_backfills'))
+
+    def handle_command(self, _, cmd):
+        if cmd['prefix'] == 'recovery-scheduler status':
+            return 0, json.dumps(self.get_status(), indent=4), ''
+        elif cmd['prefix'] == 'recovery-scheduler on':
+            self.set_module_option('active', True)
+            self.event.set()
+            return 0, '', ''
+        elif cmd['prefix'] == 'recovery-scheduler off':
+            self.set_module_option('active', False)
+            self.event.set()
+            return 0, '', ''
+        else:
+            # mgr should respect our self.COMMANDS and not call us for
+            # any prefix we don't advertise
+            raise NotImplementedError(cmd['prefix'])
+
+    def get_status(self):
+        return {
+            'active': self.active,
+            'base_backfills': self.osd_max_backfills,
+            'osds': [
+                {
+                    'osd': osd,
+                    'work': self.work.get(osd, 0),
+                    'max_backfills': self.applied.get(osd,
+                                                      self.osd_max_backfills),
+                }
+                for osd in sorted(set(self.work) | set(self.applied))
+            ],
+        }
+
+    def serve(self):
+        self.log.info('Starting')
+        self.config_notify()
+        self.load_applied()
+
+        while self.run:
+            if self.active:
+                self.osd_max_backfills = self.get_osd_max_backfills()
+                self.work = self.get_pending_work()
+                self.apply(self.assign(self.work), int(self.max_updates))
+            else:
+                self.work = {}
+                self.apply({})
+
+            sleep_interval = int(self.sleep_interval) or 10
+            self.log.debug('Sleeping for %d seconds', sleep_interval)
+            self.event.wait(sleep_interval)
+            self.event.clear()
+
+    def shutdown(self):
+        self.log.info('Stopping')
+        self.run = False
+        self.event.set()
+
+    def get_pending_work(self):
+        """
+        Weighted recovery work each OSD takes part in, summed over the PGs
+        waiting for or holding reservations.  An OSD counts for every PG
+        it is in the up or acting set of, since both ends of a recovery
+        need a slot.
+        """
+        work = defaultdict(int)
+        degraded_weight = int(self.degraded_weight)
+        for pg in self.get('pg_dump').get('pg_stats', []):
+            states = pg['state'].split('+')
+            if not any(s in states for s in PENDING_STATES):
+                continue
+            stat_sum = pg['stat_sum']
+            # a pg whose stats have not caught up yet still needs a slot
+            pg_work = 1 + \
+                stat_sum.get('num_objects_degraded', 0) * degraded_weight + \
+                stat_sum.get('num_objects_misplaced', 0)
+            for osd in set(pg['up']) | set(pg['acting']):
+                if osd != NONE_OSD:
+                    work[osd] += pg_work
+        return dict(work)
+
+    def assign(self, work):
+        """
+        Split the slots the busy OSDs would get without us (base each)
+        in proportion to their work, within [min_backfills,
+        max_backfills].  Returns the OSDs whose share differs from base.
+        """
+        base = int(self.osd_max_backfills)
+        lo = max(1, int(self.min_backfills))
+        hi = max(lo, int(self.max_backfills))
+        total_work = sum(work.values())
+        if not total_work:
+            return {}
+
+        budget = base * len(work)
+        targets = {}
+        for osd, w in work.items():
+            slots = int(round(float(budget) * w / total_work))
+            slots = min(max(slots, lo), hi)
+            if slots != base:
+                targets[osd] = slots
+        return targets
+
+    def get_updates(self, targets):
+        """
+        The overrides worth changing, most urgent first: those of OSDs that
+        are done come first, then the biggest moves.  Small moves are left
+        alone, as the shares shift a little with every pass and each
+        update is a config database write that every OSD hears about.
+        """
+        base = int(self.osd_max_backfills)
+        min_change = max(1, int(self.min_change))
+        updates = []
+        for osd in self.applied:
+            if osd not in self.work:
+                updates.append((float('inf'), osd, None))
+        for osd in self.work:
+            current = self.applied.get(osd, base)
+            target = targets.get(osd, base)
+            if abs(target - current) < min_change:
+                continue
+            updates.append((abs(target - current), osd,
+                            target if target != base else None))
+        updates.sort(key=lambda u: u[0], reverse=True)
+        return [(osd, slots) for _, osd, slots in updates]
+
+    def apply(self, targets, max_updates=0):
+        """
+        Set the overrides of targets and remove the others.  Only while
+        active does that go through get_updates(); turning the module off
+        removes everything at once.
+        """
+        if self.active:
+            updates = self.get_updates(targets)
+        else:
+            updates = [(osd, None) for osd in self.applied]
+        if max_updates and len(updates) > max_updates:
+            self.log.debug('deferring %d overrides to the next pass',
+                           len(updates) - max_updates)
+            updates = updates[:max_updates]
+
+        changed = False
+        for osd, slots in [u for u in updates if u[1] is not None]:
+            self.log.info('osd.%d: osd_max_backfills %d (work %d)',
+                          osd, slots, self.work.get(osd, 0))
+            r, outb, outs = self.mon_command({
+                'prefix': 'config set',
+                'who': 'osd.%d' % osd,
+                'name': 'osd_max_backfills',
+                'value': str(slots),
+            })
+            if r != 0:
+                self.log.warn('failed to set osd_max_backfills on osd.%d: %s',
+                              osd, outs)
+                continue
+            self.applied[osd] = slots
+            changed = True
+
+        for osd in [u[0] for u in updates if u[1] is None]:
+            if osd not in self.applied:
+                continue
+            self.log.info('osd.%d: back to default osd_max_backfills', osd)
+            r, outb, outs = self.mon_command({
+                'prefix': 'config rm',
+                'who': 'osd.%d' % osd,
+                'name': 'osd_max_backfills',
+            })
+            if r != 0 and r != -errno.ENOENT:
+                self.log.warn('failed to remove osd_max_backfills on osd.%d: %s',
+                              osd, outs)
+                continue
+            del self.applied[osd]
+            changed = True
+
+        if changed:
+            self.save_applied()
+
+    def load_applied(self):
+        # overrides left behind by a previous active mgr
+        stored = self.get_store('applied')
+        if stored:
+            self.applied = dict((int(k), v)
+                                for k, v in json.loads(stored).items())
+
+    def save_applied(self):
+        self.set_store('applied', json.dumps(self.applied))
@@ -26,8 +26,11 @@ void rbd_replay_pending_io_callback(librbd::completion_t cb, void *arg) {
 }
 
 PendingIO::PendingIO(action_id_t id,
+		     const char *type,
 		     ActionCtx &worker)
   : m_id(id),
+    m_type(type),
+    m_start_time(std::chrono::steady_clock::now()),
     m_completion(new librbd::RBD::AioCompletion(this, rbd_replay_pending_io_callback)),
     m_worker(worker) {
     }
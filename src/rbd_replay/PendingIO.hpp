@@ -16,6 +16,7 @@
 #define _INCLUDED_RBD_REPLAY_PENDINGIO_HPP
 
 #include <boost/enable_shared_from_this.hpp>
+#include <chrono>
 #include "actions.hpp"
 
 /// Do not call outside of rbd_replay::PendingIO.
@@ -32,6 +33,7 @@ public:
   typedef boost::shared_ptr<PendingIO> ptr;
 
   PendingIO(action_id_t id,
+            const char *type,
             ActionCtx &worker);
 
   ~PendingIO();
@@ -48,12 +50,23 @@ public:
     return *m_completion;
   }
 
+  /// Name of the action that started the IO.
+  const char *type() const {
+    return m_type;
+  }
+
+  std::chrono::steady_clock::time_point start_time() const {
+    return m_start_time;
+  }
+
 private:
   void completed(librbd::completion_t cb);
 
   friend void ::rbd_replay_pending_io_callback(librbd::completion_t cb, void *arg);
 
   const action_id_t m_id;
+  const char *m_type;
+  const std::chrono::steady_clock::time_point m_start_time;
   ceph::bufferlist m_bl;
   librbd::RBD::AioCompletion *m_completion;
   ActionCtx &m_worker;
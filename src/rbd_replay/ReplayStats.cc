@@ -0,0 +1,121 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "ReplayStats.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include "common/TextTable.h"
+
+using namespace rbd_replay;
+
+namespace {
+
+const unsigned SUB_BITS = 3;
+const unsigned SUB_BUCKETS = 1 << SUB_BITS;
+
+const double PERCENTILES[] = {50, 90, 99, 99.9};
+
+void add_row(TextTable &tbl, const std::string &name,
+	     const LatencyHistogram &h) {
+  tbl << name << h.count();
+  for (double p : PERCENTILES) {
+    tbl << h.percentile(p);
+  }
+  tbl << h.max() << TextTable::endrow;
+}
+
+} // anonymous namespace
+
+unsigned LatencyHistogram::bucket_for(uint64_t usec) {
+  if (usec < SUB_BUCKETS) {
+    return usec;
+  }
+  unsigned msb = 63 - __builtin_clzll(usec);
+  unsigned shift = msb - SUB_BITS;
+  return SUB_BUCKETS + shift * SUB_BUCKETS +
+    ((usec >> shift) & (SUB_BUCKETS - 1));
+}
+
+uint64_t LatencyHistogram::bucket_upper(unsigned bucket) {
+  if (bucket < SUB_BUCKETS) {
+    return bucket;
+  }
+  unsigned shift = (bucket - SUB_BUCKETS) / SUB_BUCKETS;
+  uint64_t sub = (bucket - SUB_BUCKETS) % SUB_BUCKETS;
+  uint64_t lower = (1ull << (shift + SUB_BITS)) + (sub << shift);
+  return lower + (1ull << shift) - 1;
+}
+
+void LatencyHistogram::add(uint64_t usec) {
+  unsigned bucket = bucket_for(usec);
+  if (bucket >= m_buckets.size()) {
+    m_buckets.resize(bucket + 1);
+  }
+  ++m_buckets[bucket];
+  ++m_count;
+  m_max = std::max(m_max, usec);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other) {
+  if (other.m_buckets.size() > m_buckets.size()) {
+    m_buckets.resize(other.m_buckets.size());
+  }
+  for (size_t i = 0; i < other.m_buckets.size(); i++) {
+    m_buckets[i] += other.m_buckets[i];
+  }
+  m_count += other.m_count;
+  m_max = std::max(m_max, other.m_max);
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+  if (m_count == 0) {
+    return 0;
+  }
+  uint64_t target = std::max<uint64_t>(
+    1, static_cast<uint64_t>(std::ceil(p / 100 * m_count)));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < m_buckets.size(); i++) {
+    seen += m_buckets[i];
+    if (seen >= target) {
+      return std::min(bucket_upper(i), m_max);
+    }
+  }
+  return m_max;
+}
+
+void ReplayStats::merge(const ReplayStats &other) {
+  for (auto &p : other.latencies) {
+    latencies[p.first].merge(p.second);
+  }
+  drift.merge(other.drift);
+}
+
+void ReplayStats::print(std::ostream &out) const {
+  TextTable tbl;
+  tbl.define_column("ACTION", TextTable::LEFT, TextTable::LEFT);
+  tbl.define_column("COUNT", TextTable::LEFT, TextTable::RIGHT);
+  for (double p : PERCENTILES) {
+    std::ostringstream name;
+    name << "P" << p << "(us)";
+    tbl.define_column(name.str(), TextTable::LEFT, TextTable::RIGHT);
+  }
+  tbl.define_column("MAX(us)", TextTable::LEFT, TextTable::RIGHT);
+
+  for (auto &p : latencies) {
+    add_row(tbl, p.first, p.second);
+  }
+  // a late start means the replay could not keep up with the trace
+  add_row(tbl, "start drift", drift);
+  out << tbl;
+}
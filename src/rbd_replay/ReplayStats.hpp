@@ -0,0 +1,72 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef _INCLUDED_RBD_REPLAY_REPLAYSTATS_HPP
+#define _INCLUDED_RBD_REPLAY_REPLAYSTATS_HPP
+
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+#include "include/int_types.h"
+
+namespace rbd_replay {
+
+/**
+   Distribution of durations in microseconds.  Values below 8 are kept
+   exactly; above that every power of two is split into 8 buckets, so a
+   percentile is off by at most an eighth of its value.
+ */
+class LatencyHistogram {
+public:
+  void add(uint64_t usec);
+
+  void merge(const LatencyHistogram &other);
+
+  uint64_t count() const {
+    return m_count;
+  }
+
+  uint64_t max() const {
+    return m_max;
+  }
+
+  /// Upper bound of the bucket holding the p-th percentile (0 < p <= 100).
+  uint64_t percentile(double p) const;
+
+private:
+  static unsigned bucket_for(uint64_t usec);
+  static uint64_t bucket_upper(unsigned bucket);
+
+  std::vector<uint64_t> m_buckets;
+  uint64_t m_count = 0;
+  uint64_t m_max = 0;
+};
+
+/**
+   What a replay measured: the latency of each action type, from submit to
+   completion, and how late actions were started against the schedule the
+   trace asks for (the completion of their dependencies plus the original
+   gaps, scaled by the latency multiplier).
+ */
+struct ReplayStats {
+  std::map<std::string, LatencyHistogram> latencies;
+  LatencyHistogram drift;
+
+  void merge(const ReplayStats &other);
+
+  void print(std::ostream &out) const;
+};
+
+}
+
+#endif
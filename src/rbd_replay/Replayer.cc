@@ -18,6 +18,7 @@
 #include "rbd_replay/ActionTypes.h"
 #include "rbd_replay/BufferReader.h"
 #include <boost/foreach.hpp>
+#include <algorithm>
 #include <chrono>
 #include <condition_variable>
 #include <thread>
@@ -89,7 +90,11 @@ void Worker::run() {
   while (!m_done) {
     Action::ptr action;
     m_buffer.pop_back(&action);
-    m_replayer.wait_for_actions(action->predecessors());
+    std::chrono::microseconds drift;
+    if (m_replayer.wait_for_actions(action->predecessors(), &drift)) {
+      std::scoped_lock lock{m_stats_mutex};
+      m_stats.drift.add(std::max<int64_t>(drift.count(), 0));
+    }
     action->perform(*this);
     m_replayer.set_action_complete(action->id());
   }
@@ -115,6 +120,12 @@ void Worker::run() {
 void Worker::remove_pending(PendingIO::ptr io) {
   ceph_assert(io);
   m_replayer.set_action_complete(io->id());
+  auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - io->start_time());
+  {
+    std::scoped_lock lock{m_stats_mutex};
+    m_stats.latencies[io->type()].add(latency.count());
+  }
   std::scoped_lock lock{m_pending_ios_mutex};
   size_t num_erased = m_pending_ios.erase(io->id());
   assertf(num_erased == 1, "id = %d", io->id());
@@ -166,6 +177,7 @@ Replayer::Replayer(int num_action_trackers)
   : m_rbd(NULL), m_ioctx(0),
     m_latency_multiplier(1.0),
     m_readonly(false), m_dump_perf_counters(false),
+    m_report_latencies(false),
     m_num_action_trackers(num_action_trackers),
     m_action_trackers(new action_tracker_d[m_num_action_trackers]) {
   assertf(num_action_trackers > 0, "num_action_trackers = %d", num_action_trackers);
@@ -264,11 +276,16 @@ void Replayer::run(const std::string& replay_file) {
       }
 
       dout(THREAD_LEVEL) << "Waiting for workers to die" << dendl;
+      ReplayStats stats;
       pair<thread_id_t, Worker*> w;
       BOOST_FOREACH(w, workers) {
 	w.second->join();
+	stats.merge(w.second->stats());
 	delete w.second;
       }
+      if (m_report_latencies) {
+	stats.print(std::cout);
+      }
       clear_images();
       delete m_rbd;
       m_rbd = NULL;
@@ -327,22 +344,30 @@ bool Replayer::is_action_complete(action_id_t id) {
   return tracker.actions.count(id) > 0;
 }
 
-void Replayer::wait_for_actions(const action::Dependencies &deps) {
+bool Replayer::wait_for_actions(const action::Dependencies &deps,
+				std::chrono::microseconds *drift) {
+  if (deps.empty()) {
+    return false;
+  }
   auto release_time = std::chrono::time_point<std::chrono::system_clock>::min();
   for(auto& dep : deps) {
     dout(DEPGRAPH_LEVEL) << "Waiting for " << dep.id << dendl;
     auto start_time = std::chrono::system_clock::now();
     action_tracker_d &tracker = tracker_for(dep.id);
-    std::unique_lock lock{tracker.mutex};
+    // waiters only read the tracker, so they do not serialize on each
+    // other; only set_action_complete() takes it exclusively
+    std::shared_lock lock{tracker.mutex};
     bool first_time = true;
-    while (tracker.actions.count(dep.id) == 0) {
+    auto completed = tracker.actions.find(dep.id);
+    while (completed == tracker.actions.end()) {
       if (!first_time) {
 	dout(DEPGRAPH_LEVEL) << "Still waiting for " << dep.id << dendl;
       }
       tracker.condition.wait_for(lock, std::chrono::seconds(1));
       first_time = false;
+      completed = tracker.actions.find(dep.id);
     }
-    auto action_completed_time(tracker.actions[dep.id]);
+    auto action_completed_time(completed->second);
     lock.unlock();
     auto end_time = std::chrono::system_clock::now();
     auto micros = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
@@ -362,6 +387,9 @@ void Replayer::wait_for_actions(const action::Dependencies &deps) {
 		      << " microseconds" << dendl;
     std::this_thread::sleep_until(release_time);
   }
+  *drift = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::system_clock::now() - release_time);
+  return true;
 }
 
 void Replayer::clear_images() {
@@ -23,6 +23,7 @@
 #include "BoundedBuffer.hpp"
 #include "ImageNameMap.hpp"
 #include "PendingIO.hpp"
+#include "ReplayStats.hpp"
 
 namespace rbd_replay {
 
@@ -64,6 +65,11 @@ public:
 
   rbd_loc map_image_name(std::string image_name, std::string snap_name) const override;
 
+  /// Only valid once the worker was joined.
+  const ReplayStats &stats() const {
+    return m_stats;
+  }
+
 private:
   void run();
 
@@ -73,6 +79,9 @@ private:
   std::map<action_id_t, PendingIO::ptr> m_pending_ios;
   std::mutex m_pending_ios_mutex;
   std::condition_variable_any m_pending_ios_empty;
+  /// Updated by the worker thread and IO completions alike.
+  ReplayStats m_stats;
+  std::mutex m_stats_mutex;
   bool m_done;
 };
 
@@ -103,7 +112,13 @@ public:
 
   bool is_action_complete(action_id_t id);
 
-  void wait_for_actions(const action::Dependencies &deps);
+  /**
+     Waits until the action with the given dependencies is due.  Returns
+     false if it has no dependencies and so is due right away; otherwise
+     sets drift to how much later than due it was when this returned.
+   */
+  bool wait_for_actions(const action::Dependencies &deps,
+			std::chrono::microseconds *drift);
 
   std::string pool_name() const;
 
@@ -123,6 +138,10 @@ public:
     m_dump_perf_counters = dump_perf_counters;
   }
 
+  void set_report_latencies(bool report_latencies) {
+    m_report_latencies = report_latencies;
+  }
+
   const ImageNameMap &image_name_map() const {
     return m_image_name_map;
   }
@@ -151,6 +170,7 @@ private:
   bool m_readonly;
   ImageNameMap m_image_name_map;
   bool m_dump_perf_counters;
+  bool m_report_latencies;
 
   std::map<imagectx_id_t, librbd::Image*> m_images;
   std::shared_mutex m_images_mutex;
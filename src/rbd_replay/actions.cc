@@ -110,7 +110,7 @@ void AioReadAction::perform(ActionCtx &worker) {
   dout(ACTION_LEVEL) << "Performing " << *this << dendl;
   librbd::Image *image = worker.get_image(m_action.imagectx_id);
   ceph_assert(image);
-  PendingIO::ptr io(new PendingIO(pending_io_id(), worker));
+  PendingIO::ptr io(new PendingIO(pending_io_id(), get_action_name(), worker));
   worker.add_pending(io);
   int r = image->aio_read(m_action.offset, m_action.length, io->bufferlist(), &io->completion());
   assertf(r >= 0, "id = %d, r = %d", id(), r);
@@ -119,7 +119,7 @@ void AioReadAction::perform(ActionCtx &worker) {
 void ReadAction::perform(ActionCtx &worker) {
   dout(ACTION_LEVEL) << "Performing " << *this << dendl;
   librbd::Image *image = worker.get_image(m_action.imagectx_id);
-  PendingIO::ptr io(new PendingIO(pending_io_id(), worker));
+  PendingIO::ptr io(new PendingIO(pending_io_id(), get_action_name(), worker));
   worker.add_pending(io);
   ssize_t r = image->read(m_action.offset, m_action.length, io->bufferlist());
   assertf(r >= 0, "id = %d, r = %d", id(), r);
@@ -130,7 +130,7 @@ void AioWriteAction::perform(ActionCtx &worker) {
   static const std::string fake_data(create_fake_data());
   dout(ACTION_LEVEL) << "Performing " << *this << dendl;
   librbd::Image *image = worker.get_image(m_action.imagectx_id);
-  PendingIO::ptr io(new PendingIO(pending_io_id(), worker));
+  PendingIO::ptr io(new PendingIO(pending_io_id(), get_action_name(), worker));
   uint64_t remaining = m_action.length;
   while (remaining > 0) {
     uint64_t n = std::min(remaining, (uint64_t)fake_data.length());
@@ -149,7 +149,7 @@ void AioWriteAction::perform(ActionCtx &worker) {
 void WriteAction::perform(ActionCtx &worker) {
   dout(ACTION_LEVEL) << "Performing " << *this << dendl;
   librbd::Image *image = worker.get_image(m_action.imagectx_id);
-  PendingIO::ptr io(new PendingIO(pending_io_id(), worker));
+  PendingIO::ptr io(new PendingIO(pending_io_id(), get_action_name(), worker));
   worker.add_pending(io);
   io->bufferlist().append_zero(m_action.length);
   if (!worker.readonly()) {
@@ -162,7 +162,7 @@ void WriteAction::perform(ActionCtx &worker) {
 void AioDiscardAction::perform(ActionCtx &worker) {
   dout(ACTION_LEVEL) << "Performing " << *this << dendl;
   librbd::Image *image = worker.get_image(m_action.imagectx_id);
-  PendingIO::ptr io(new PendingIO(pending_io_id(), worker));
+  PendingIO::ptr io(new PendingIO(pending_io_id(), get_action_name(), worker));
   worker.add_pending(io);
   if (worker.readonly()) {
     worker.remove_pending(io);
@@ -175,7 +175,7 @@ void AioDiscardAction::perform(ActionCtx &worker) {
 void DiscardAction::perform(ActionCtx &worker) {
   dout(ACTION_LEVEL) << "Performing " << *this << dendl;
   librbd::Image *image = worker.get_image(m_action.imagectx_id);
-  PendingIO::ptr io(new PendingIO(pending_io_id(), worker));
+  PendingIO::ptr io(new PendingIO(pending_io_id(), get_action_name(), worker));
   worker.add_pending(io);
   if (!worker.readonly()) {
     ssize_t r = image->discard(m_action.offset, m_action.length);
@@ -186,7 +186,7 @@ void DiscardAction::perform(ActionCtx &worker) {
 
 void OpenImageAction::perform(ActionCtx &worker) {
   dout(ACTION_LEVEL) << "Performing " << *this << dendl;
-  PendingIO::ptr io(new PendingIO(pending_io_id(), worker));
+  PendingIO::ptr io(new PendingIO(pending_io_id(), get_action_name(), worker));
   worker.add_pending(io);
   librbd::Image *image = new librbd::Image();
   librbd::RBD *rbd = worker.rbd();
@@ -211,14 +211,16 @@ void OpenImageAction::perform(ActionCtx &worker) {
 
 void CloseImageAction::perform(ActionCtx &worker) {
   dout(ACTION_LEVEL) << "Performing " << *this << dendl;
+  PendingIO::ptr io(new PendingIO(pending_io_id(), get_action_name(), worker));
+  worker.add_pending(io);
   worker.erase_image(m_action.imagectx_id);
-  worker.set_action_complete(pending_io_id());
+  worker.remove_pending(io);
 }
 
 void AioOpenImageAction::perform(ActionCtx &worker) {
   dout(ACTION_LEVEL) << "Performing " << *this << dendl;
   // TODO: Make it async
-  PendingIO::ptr io(new PendingIO(pending_io_id(), worker));
+  PendingIO::ptr io(new PendingIO(pending_io_id(), get_action_name(), worker));
   worker.add_pending(io);
   librbd::Image *image = new librbd::Image();
   librbd::RBD *rbd = worker.rbd();
@@ -244,6 +246,8 @@ void AioOpenImageAction::perform(ActionCtx &worker) {
 void AioCloseImageAction::perform(ActionCtx &worker) {
   dout(ACTION_LEVEL) << "Performing " << *this << dendl;
   // TODO: Make it async
+  PendingIO::ptr io(new PendingIO(pending_io_id(), get_action_name(), worker));
+  worker.add_pending(io);
   worker.erase_image(m_action.imagectx_id);
-  worker.set_action_complete(pending_io_id());
+  worker.remove_pending(io);
 }
@@ -186,7 +186,7 @@ public:
 
 protected:
   const char *get_action_name() const override {
-    return "StartThreadAction";
+    return "StopThreadAction";
   }
 };
 
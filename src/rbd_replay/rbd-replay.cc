@@ -41,6 +41,9 @@ static void usage(const char* program) {
   cout << "  --read-only                     Only perform non-destructive operations." << std::endl;
   cout << "  --map-image <rule>              Add a rule to map image names in the trace to" << std::endl;
   cout << "                                  image names in the replay cluster." << std::endl;
+  cout << "  --report-latencies              Print latency percentiles per action type, and how" << std::endl;
+  cout << "                                  late actions started against the trace's timing," << std::endl;
+  cout << "                                  once the replay is done." << std::endl;
   cout << "  --dump-perf-counters            *Experimental*" << std::endl;
   cout << "                                  Dump performance counters to standard out before" << std::endl;
   cout << "                                  an image is closed. Performance counters may be dumped" << std::endl;
@@ -77,6 +80,7 @@ int main(int argc, const char **argv) {
   std::string val;
   std::ostringstream err;
   bool dump_perf_counters = false;
+  bool report_latencies = false;
   for (i = args.begin(); i != args.end(); ) {
     if (ceph_argparse_double_dash(args, i)) {
       break;
@@ -100,6 +104,8 @@ int main(int argc, const char **argv) {
       }
     } else if (ceph_argparse_flag(args, i, "--dump-perf-counters", (char*)NULL)) {
       dump_perf_counters = true;
+    } else if (ceph_argparse_flag(args, i, "--report-latencies", (char*)NULL)) {
+      report_latencies = true;
     } else if (get_remainder(*i, "-")) {
       cerr << "Unrecognized argument: " << *i << std::endl;
       return 1;
@@ -127,5 +133,6 @@ int main(int argc, const char **argv) {
   replayer.set_readonly(readonly);
   replayer.set_image_name_map(image_name_map);
   replayer.set_dump_perf_counters(dump_perf_counters);
+  replayer.set_report_latencies(report_latencies);
   replayer.run(replay_file);
 }
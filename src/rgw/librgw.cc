@@ -627,7 +627,7 @@ namespace rgw {
 
   int RGWLibIO::set_uid(RGWRados *store, const rgw_user& uid)
   {
-    int ret = rgw_get_user_info_by_uid(store, uid, user_info, NULL);
+    int ret = rgw_get_user_info_by_uid(store, uid, user_info, null_yield, NULL);
     if (ret < 0) {
       derr << "ERROR: failed reading user info: uid=" << uid << " ret="
 	   << ret << dendl;
@@ -313,7 +313,7 @@ static int parse_grantee_str(RGWRados *store, string& grantee_str,
     grant.set_canon(info.user_id, info.display_name, rgw_perm);
   } else if (strcasecmp(id_type.c_str(), "id") == 0) {
     rgw_user user(id_val);
-    ret = rgw_get_user_info_by_uid(store, user, info);
+    ret = rgw_get_user_info_by_uid(store, user, info, null_yield);
     if (ret < 0)
       return ret;
 
@@ -487,7 +487,7 @@ int RGWAccessControlPolicy_S3::rebuild(RGWRados *store, ACLOwner *owner, RGWAcce
   }
 
   RGWUserInfo owner_info;
-  if (rgw_get_user_info_by_uid(store, owner->get_id(), owner_info) < 0) {
+  if (rgw_get_user_info_by_uid(store, owner->get_id(), owner_info, null_yield) < 0) {
     ldout(cct, 10) << "owner info does not exist" << dendl;
     return -EINVAL;
   }
@@ -535,7 +535,7 @@ int RGWAccessControlPolicy_S3::rebuild(RGWRados *store, ACLOwner *owner, RGWAcce
           }
         }
     
-        if (grant_user.user_id.empty() && rgw_get_user_info_by_uid(store, uid, grant_user) < 0) {
+        if (grant_user.user_id.empty() && rgw_get_user_info_by_uid(store, uid, grant_user, null_yield) < 0) {
           ldout(cct, 10) << "grant user does not exist:" << uid << dendl;
           return -EINVAL;
         } else {
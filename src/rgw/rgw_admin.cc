@@ -56,6 +56,7 @@ extern "C" {
 #include "rgw_zone.h"
 #include "rgw_pubsub.h"
 #include "rgw_sync_module_pubsub.h"
+#include "rgw_dmclock.h"
 
 #include "services/svc_sync_modules.h"
 
@@ -129,6 +130,9 @@ void usage()
   cout << "  period list                list all periods\n";
   cout << "  period update              update the staging period\n";
   cout << "  period commit              commit the staging period\n";
+  cout << "  qos set                    set the QoS of a bucket or user\n";
+  cout << "  qos get                    get the QoS of a bucket or user\n";
+  cout << "  qos rm                     remove the QoS of a bucket or user\n";
   cout << "  quota set                  set quota params\n";
   cout << "  quota enable               enable quota\n";
   cout << "  quota disable              disable quota\n";
@@ -357,6 +361,10 @@ void usage()
   cout << "   --max-objects             specify max objects (negative value to disable)\n";
   cout << "   --max-size                specify max size (in B/K/M/G/T, negative value to disable)\n";
   cout << "   --quota-scope             scope of quota (bucket, user)\n";
+  cout << "\nQoS options:\n";
+  cout << "   --qos-reservation         requests/s guaranteed to the bucket or user (0 for none)\n";
+  cout << "   --qos-weight              share of the requests beyond the reservations\n";
+  cout << "   --qos-limit               max requests/s of the bucket or user (0 for unlimited)\n";
   cout << "\nOrphans search options:\n";
   cout << "   --num-shards              num of shards to use for keeping the temporary scan info\n";
   cout << "   --orphan-stale-secs       num of seconds to wait before declaring an object to be an orphan (default: 86400)\n";
@@ -440,6 +448,9 @@ enum {
   OPT_QUOTA_SET,
   OPT_QUOTA_ENABLE,
   OPT_QUOTA_DISABLE,
+  OPT_QOS_SET,
+  OPT_QOS_GET,
+  OPT_QOS_RM,
   OPT_GC_LIST,
   OPT_GC_PROCESS,
   OPT_LC_LIST,
@@ -594,6 +605,7 @@ static int get_cmd(const char *cmd, const char *prev_cmd, const char *prev_prev_
       strcmp(cmd, "pool") == 0 ||
       strcmp(cmd, "pools") == 0 ||
       strcmp(cmd, "pubsub") == 0 ||
+      strcmp(cmd, "qos") == 0 ||
       strcmp(cmd, "quota") == 0 ||
       strcmp(cmd, "realm") == 0 ||
       strcmp(cmd, "role") == 0 ||
@@ -854,6 +866,13 @@ static int get_cmd(const char *cmd, const char *prev_cmd, const char *prev_prev_
       return OPT_ZONEGROUP_REMOVE;
     if (strcmp(cmd, "rename") == 0)
       return OPT_ZONEGROUP_RENAME;
+  } else if (strcmp(prev_cmd, "qos") == 0) {
+    if (strcmp(cmd, "set") == 0)
+      return OPT_QOS_SET;
+    if (strcmp(cmd, "get") == 0)
+      return OPT_QOS_GET;
+    if (match_str(cmd, "rm", "remove"))
+      return OPT_QOS_RM;
   } else if (strcmp(prev_cmd, "quota") == 0) {
     if (strcmp(cmd, "set") == 0)
       return OPT_QUOTA_SET;
@@ -2832,6 +2851,10 @@ int main(int argc, const char **argv)
   int64_t max_size = -1;
   bool have_max_objects = false;
   bool have_max_size = false;
+  rgw::dmclock::QoSInfo qos_info;
+  bool have_qos_reservation = false;
+  bool have_qos_weight = false;
+  bool have_qos_limit = false;
   int include_all = false;
   int allow_unordered = false;
 
@@ -2994,6 +3017,27 @@ int main(int argc, const char **argv)
         return EINVAL;
       }
       have_max_objects = true;
+    } else if (ceph_argparse_witharg(args, i, &val, "--qos-reservation", (char*)NULL)) {
+      qos_info.reservation = strict_strtod(val.c_str(), &err);
+      if (!err.empty()) {
+        cerr << "ERROR: failed to parse qos reservation: " << err << std::endl;
+        return EINVAL;
+      }
+      have_qos_reservation = true;
+    } else if (ceph_argparse_witharg(args, i, &val, "--qos-weight", (char*)NULL)) {
+      qos_info.weight = strict_strtod(val.c_str(), &err);
+      if (!err.empty()) {
+        cerr << "ERROR: failed to parse qos weight: " << err << std::endl;
+        return EINVAL;
+      }
+      have_qos_weight = true;
+    } else if (ceph_argparse_witharg(args, i, &val, "--qos-limit", (char*)NULL)) {
+      qos_info.limit = strict_strtod(val.c_str(), &err);
+      if (!err.empty()) {
+        cerr << "ERROR: failed to parse qos limit: " << err << std::endl;
+        return EINVAL;
+      }
+      have_qos_limit = true;
     } else if (ceph_argparse_witharg(args, i, &val, "--date", "--time", (char*)NULL)) {
       date = val;
       if (end_date.empty())
@@ -3407,6 +3451,7 @@ int main(int argc, const char **argv)
 			 OPT_PERIOD_GET_CURRENT,
 			 OPT_PERIOD_LIST,
 			 OPT_GLOBAL_QUOTA_GET,
+			 OPT_QOS_GET,
 			 OPT_SYNC_STATUS,
 			 OPT_ROLE_GET,
 			 OPT_ROLE_LIST,
@@ -6756,7 +6801,7 @@ next:
     }
 
     cls_user_header header;
-    int ret = store->cls_user_get_header(user_str, &header);
+    int ret = store->cls_user_get_header(user_str, &header, null_yield);
     if (ret < 0) {
       if (ret == -ENOENT) { /* in case of ENOENT */
         cerr << "User has not been initialized or user does not exist" << std::endl;
@@ -7657,6 +7702,86 @@ next:
     }
   }
 
+  if (opt_cmd == OPT_QOS_SET || opt_cmd == OPT_QOS_GET || opt_cmd == OPT_QOS_RM) {
+    if (bucket_name.empty() && user_id.empty()) {
+      cerr << "ERROR: bucket name or uid is required for qos operation" << std::endl;
+      return EINVAL;
+    }
+
+    map<string, bufferlist> attrs;
+    RGWBucketInfo bucket_info;
+    RGWUserInfo user_info;
+    RGWObjVersionTracker objv_tracker;
+    if (!bucket_name.empty()) {
+      ret = init_bucket(tenant, bucket_name, bucket_id, bucket_info, bucket, &attrs);
+    } else {
+      ret = rgw_get_user_info_by_uid(store, user_id, user_info, null_yield,
+                                     &objv_tracker, nullptr, nullptr, &attrs);
+    }
+    if (ret < 0) {
+      cerr << "ERROR: could not read the bucket or user info: " << cpp_strerror(-ret) << std::endl;
+      return -ret;
+    }
+
+    // a removed QoS is left empty, as the attrs are only ever added to
+    rgw::dmclock::QoSInfo qos;
+    auto iter = attrs.find(RGW_ATTR_QOS);
+    const bool have_qos = iter != attrs.end() && iter->second.length() > 0;
+    if (have_qos) {
+      try {
+        auto p = iter->second.cbegin();
+        decode(qos, p);
+      } catch (buffer::error& err) {
+        cerr << "ERROR: failed to decode the qos" << std::endl;
+        return EIO;
+      }
+    }
+
+    if (opt_cmd == OPT_QOS_GET) {
+      if (!have_qos) {
+        cerr << "ERROR: no qos is set" << std::endl;
+        return ENOENT;
+      }
+      encode_json("qos", qos, formatter);
+      formatter->flush(cout);
+      return 0;
+    }
+
+    bufferlist bl;
+    if (opt_cmd == OPT_QOS_SET) {
+      if (have_qos_reservation) {
+        qos.reservation = qos_info.reservation;
+      }
+      if (have_qos_weight) {
+        qos.weight = qos_info.weight;
+      }
+      if (have_qos_limit) {
+        qos.limit = qos_info.limit;
+      }
+      if (qos.reservation < 0 || qos.weight <= 0 || qos.limit < 0) {
+        cerr << "ERROR: the qos reservation and limit can not be negative, "
+                "and its weight must be positive" << std::endl;
+        return EINVAL;
+      }
+      encode(qos, bl);
+    } else if (!have_qos) {
+      return 0;
+    }
+    attrs[RGW_ATTR_QOS] = bl;
+
+    if (!bucket_name.empty()) {
+      ret = store->put_bucket_instance_info(bucket_info, false, real_time(), &attrs);
+    } else {
+      ret = rgw_store_user_info(store, user_info, &user_info, &objv_tracker,
+                                real_time(), false, &attrs);
+    }
+    if (ret < 0) {
+      cerr << "ERROR: failed to store the qos: " << cpp_strerror(-ret) << std::endl;
+      return -ret;
+    }
+    return 0;
+  }
+
   if (opt_cmd == OPT_MFA_CREATE) {
     rados::cls::otp::otp_info_t config;
 
@@ -21,6 +21,7 @@
 #endif
 
 #include "rgw_dmclock_async_scheduler.h"
+#include "rgw_dmclock_qos_exchange.h"
 
 #define dout_subsys ceph_subsys_rgw
 
@@ -89,6 +90,7 @@ void handle_connection(boost::asio::io_context& context,
                        boost::beast::flat_buffer& buffer, bool is_ssl,
                        SharedMutex& pause_mutex,
                        rgw::dmclock::Scheduler *scheduler,
+                       rgw::dmclock::TenantScheduler *tenant_scheduler,
                        boost::system::error_code& ec,
                        boost::asio::yield_context yield)
 {
@@ -158,7 +160,8 @@ void handle_connection(boost::asio::io_context& context,
       RGWRestfulIO client(cct, &real_client_io);
       auto y = optional_yield{context, yield};
       process_request(env.store, env.rest, &req, env.uri_prefix,
-                      *env.auth_registry, &client, env.olog, y, scheduler);
+                      *env.auth_registry, &client, env.olog, y, scheduler,
+                      nullptr, tenant_scheduler);
     }
 
     if (!parser.keep_alive()) {
@@ -236,6 +239,8 @@ class AsioFrontend {
 #endif
   SharedMutex pause_mutex;
   std::unique_ptr<rgw::dmclock::Scheduler> scheduler;
+  std::unique_ptr<rgw::dmclock::AsyncTenantScheduler> tenant_scheduler;
+  std::unique_ptr<rgw::dmclock::QoSExchange> qos_exchange;
 
   struct Listener {
     tcp::endpoint endpoint;
@@ -277,6 +282,11 @@ class AsioFrontend {
                                               sched_ctx.get_dmc_client_config(),
                                               *sched_ctx.get_dmc_client_config(),
                                               dmc::AtLimit::Reject));
+      if (ctx()->_conf.get_val<bool>("rgw_dmclock_tenant_qos")) {
+        tenant_scheduler.reset(new dmc::AsyncTenantScheduler(ctx(), context));
+        qos_exchange.reset(new dmc::QoSExchange(ctx(),
+                                                tenant_scheduler.get()));
+      }
       break;
     case dmc::scheduler_t::none:
       lderr(ctx()) << "Got invalid scheduler type for beast, defaulting to throttler" << dendl;
@@ -597,7 +607,8 @@ void AsioFrontend::accept(Listener& l, boost::system::error_code ec)
         }
         buffer.consume(bytes);
         handle_connection(context, env, stream, buffer, true, pause_mutex,
-                          scheduler.get(), ec, yield);
+                          scheduler.get(), tenant_scheduler.get(), ec,
+                          yield);
         if (!ec) {
           // ssl shutdown (ignoring errors)
           stream.async_shutdown(yield[ec]);
@@ -615,7 +626,8 @@ void AsioFrontend::accept(Listener& l, boost::system::error_code ec)
         boost::beast::flat_buffer buffer;
         boost::system::error_code ec;
         handle_connection(context, env, s, buffer, false, pause_mutex,
-                          scheduler.get(), ec, yield);
+                          scheduler.get(), tenant_scheduler.get(), ec,
+                          yield);
         s.shutdown(tcp::socket::shutdown_both, ec);
       });
   }
@@ -641,6 +653,9 @@ int AsioFrontend::run()
       context.run(ec);
     });
   }
+  if (qos_exchange) {
+    qos_exchange->start(env.store);
+  }
   return 0;
 }
 
@@ -658,6 +673,9 @@ void AsioFrontend::stop()
   // close all connections
   connections.close(ec);
   pause_mutex.cancel();
+  if (qos_exchange) {
+    qos_exchange->stop();
+  }
 }
 
 void AsioFrontend::join()
@@ -687,6 +705,11 @@ void AsioFrontend::pause()
   // pause and wait for outstanding requests to complete
   pause_mutex.lock(ec);
 
+  // the exchange uses the store that is about to be replaced
+  if (qos_exchange) {
+    qos_exchange->stop();
+  }
+
   if (ec) {
     ldout(ctx(), 1) << "frontend failed to pause: " << ec.message() << dendl;
   } else {
@@ -699,6 +722,9 @@ void AsioFrontend::unpause(RGWRados* const store,
 {
   env.store = store;
   env.auth_registry = std::move(auth_registry);
+  if (qos_exchange) {
+    qos_exchange->start(store);
+  }
 
   // unpause to unblock connections
   pause_mutex.unlock();
@@ -501,13 +501,13 @@ void rgw::auth::RemoteApplier::load_acct_info(const DoutPrefixProvider* dpp, RGW
   if (acct_user.tenant.empty()) {
     const rgw_user tenanted_uid(acct_user.id, acct_user.id);
 
-    if (rgw_get_user_info_by_uid(store, tenanted_uid, user_info) >= 0) {
+    if (rgw_get_user_info_by_uid(store, tenanted_uid, user_info, null_yield) >= 0) {
       /* Succeeded. */
       return;
     }
   }
 
-  if (rgw_get_user_info_by_uid(store, acct_user, user_info) < 0) {
+  if (rgw_get_user_info_by_uid(store, acct_user, user_info, null_yield) < 0) {
     ldpp_dout(dpp, 0) << "NOTICE: couldn't map swift user " << acct_user << dendl;
     create_account(dpp, acct_user, user_info);
   }
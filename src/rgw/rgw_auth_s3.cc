@@ -40,6 +40,8 @@ static const auto signed_subresources = {
   "response-content-language",
   "response-content-type",
   "response-expires",
+  "select",
+  "select-type",
   "tagging",
   "torrent",
   "uploadId",
@@ -890,24 +892,41 @@ AWSv4ComplMulti::ChunkMeta::create_next(CephContext* const cct,
                         semicolon_pos + 83);
 }
 
-std::string
-AWSv4ComplMulti::calc_chunk_signature(const std::string& payload_hash) const
+void AWSv4ComplMulti::calc_chunk_signature(const char* const payload_hash,
+                                           char* const signature)
 {
-  const auto string_to_sign = string_join_reserve("\n",
-    AWS4_HMAC_SHA256_PAYLOAD_STR,
-    date,
-    credential_scope,
-    prev_chunk_signature,
-    AWS4_EMPTY_PAYLOAD_HASH,
-    payload_hash);
-
-  ldout(cct, 20) << "AWSv4ComplMulti: string_to_sign=\n" << string_to_sign
-                 << dendl;
+  ldout(cct, 20) << "AWSv4ComplMulti: string_to_sign=\n"
+                 << AWS4_HMAC_SHA256_PAYLOAD_STR << "\n"
+                 << date << "\n"
+                 << credential_scope << "\n"
+                 << prev_chunk_signature << "\n"
+                 << AWS4_EMPTY_PAYLOAD_HASH << "\n"
+                 << payload_hash << dendl;
+
+  /* Feed the parts of the string to sign directly instead of joining them
+   * first. The HMAC context keeps the signing key across chunks. */
+  const auto update = [this](const boost::string_view& part) {
+    hmac.Update(reinterpret_cast<const unsigned char*>(part.data()),
+                part.size());
+  };
+  const boost::string_view sep("\n");
+  update(AWS4_HMAC_SHA256_PAYLOAD_STR);
+  update(sep);
+  update(date);
+  update(sep);
+  update(credential_scope);
+  update(sep);
+  update(prev_chunk_signature);
+  update(sep);
+  update(AWS4_EMPTY_PAYLOAD_HASH);
+  update(sep);
+  update(boost::string_view(payload_hash, ChunkMeta::SIG_SIZE));
 
   /* new chunk signature */
-  const auto sig = calc_hmac_sha256(signing_key, string_to_sign);
-  /* FIXME(rzarzynski): std::string here is really unnecessary. */
-  return sig.to_str();
+  sha256_digest_t sig;
+  hmac.Final(sig.v);
+  hmac.Restart();
+  buf_to_hex(sig.v, sig.SIZE, signature);
 }
 
 
@@ -915,8 +934,15 @@ bool AWSv4ComplMulti::is_signature_mismatched()
 {
   /* The validity of previous chunk can be verified only after getting meta-
    * data of the next one. */
-  const auto payload_hash = calc_hash_sha256_restart_stream(&sha256_hash);
-  const auto calc_signature = calc_chunk_signature(payload_hash);
+  unsigned char digest[CEPH_CRYPTO_SHA256_DIGESTSIZE];
+  sha256_hash.Final(digest);
+  sha256_hash.Restart();
+
+  char payload_hash[ChunkMeta::SIG_SIZE + 1];
+  buf_to_hex(digest, sizeof(digest), payload_hash);
+
+  char calc_signature[ChunkMeta::SIG_SIZE + 1];
+  calc_chunk_signature(payload_hash, calc_signature);
 
   if (chunk_meta.get_signature() != calc_signature) {
     ldout(cct, 20) << "AWSv4ComplMulti: ERROR: chunk signature mismatch"
@@ -934,6 +960,24 @@ bool AWSv4ComplMulti::is_signature_mismatched()
 }
 
 size_t AWSv4ComplMulti::recv_body(char* const buf, const size_t buf_max)
+{
+  /* Fill the whole buffer with the data of as many chunks as fit. The data
+   * is read and hashed in place, only the few bytes that come along with
+   * the metadata of a chunk are copied. */
+  size_t buf_pos = 0;
+  while (buf_pos < buf_max && !stream_done) {
+    const size_t received = recv_chunk_data(buf + buf_pos, buf_max - buf_pos);
+    if (received == 0) {
+      break;
+    }
+    buf_pos += received;
+  }
+
+  dout(20) << "AWSv4ComplMulti: filled=" << buf_pos << dendl;
+  return buf_pos;
+}
+
+size_t AWSv4ComplMulti::recv_chunk_data(char* const buf, const size_t buf_max)
 {
   /* Buffer stores only parsed stream. Raw values reflect the stream
    * we're getting from a client. */
@@ -974,6 +1018,12 @@ size_t AWSv4ComplMulti::recv_body(char* const buf, const size_t buf_max)
      * can be chunk's data plus possibly beginning of next chunks' metadata. */
     parsing_buf.erase(std::begin(parsing_buf),
                       std::begin(parsing_buf) + consumed);
+
+    if (chunk_meta.get_data_size(stream_pos - parsing_buf.size()) == 0) {
+      /* Its signature is verified in complete(). */
+      stream_done = true;
+      return 0;
+    }
   }
 
   size_t stream_pos_was = stream_pos - parsing_buf.size();
@@ -994,7 +1044,7 @@ size_t AWSv4ComplMulti::recv_body(char* const buf, const size_t buf_max)
     std::copy(std::begin(parsing_buf), data_end_iter, buf);
     parsing_buf.erase(std::begin(parsing_buf), data_end_iter);
 
-    calc_hash_sha256_update_stream(sha256_hash, buf, data_len);
+    sha256_hash.Update(reinterpret_cast<const unsigned char*>(buf), data_len);
 
     to_extract -= data_len;
     buf_pos += data_len;
@@ -1010,14 +1060,14 @@ size_t AWSv4ComplMulti::recv_body(char* const buf, const size_t buf_max)
       break;
     }
 
-    calc_hash_sha256_update_stream(sha256_hash, buf + buf_pos, received);
+    sha256_hash.Update(reinterpret_cast<const unsigned char*>(buf + buf_pos),
+                       received);
 
     buf_pos += received;
     stream_pos += received;
     to_extract -= received;
   }
 
-  dout(20) << "AWSv4ComplMulti: filled=" << buf_pos << dendl;
   return buf_pos;
 }
 
@@ -320,11 +320,16 @@ class AWSv4ComplMulti : public rgw::auth::Completer,
 
   size_t stream_pos;
   boost::container::static_vector<char, ChunkMeta::META_MAX_SIZE> parsing_buf;
-  ceph::crypto::SHA256* sha256_hash;
+  /* Both contexts are reused across the chunks of the stream. */
+  ceph::crypto::SHA256 sha256_hash;
+  ceph::crypto::HMACSHA256 hmac;
   std::string prev_chunk_signature;
+  /* The last, zero-length chunk has been parsed. */
+  bool stream_done = false;
 
   bool is_signature_mismatched();
-  std::string calc_chunk_signature(const std::string& payload_hash) const;
+  void calc_chunk_signature(const char* payload_hash, char* signature);
+  size_t recv_chunk_data(char* buf, size_t max);
 
 public:
   /* We need the constructor to be public because of the std::make_shared that
@@ -343,16 +348,10 @@ public:
       /* The evolving state. */
       chunk_meta(ChunkMeta::create_first(seed_signature)),
       stream_pos(0),
-      sha256_hash(calc_hash_sha256_open_stream()),
+      hmac(signing_key.v, signing_key_t::SIZE),
       prev_chunk_signature(std::move(seed_signature)) {
   }
 
-  ~AWSv4ComplMulti() {
-    if (sha256_hash) {
-      calc_hash_sha256_close_stream(&sha256_hash);
-    }
-  }
-
   /* rgw::io::DecoratedRestfulClient. */
   size_t recv_body(char* buf, size_t max) override;
 
@@ -211,7 +211,7 @@ int rgw_link_bucket(RGWRados* const store,
   RGWSysObjectCtx obj_ctx = store->svc.sysobj->init_obj_ctx();
 
   if (update_entrypoint) {
-    ret = store->get_bucket_entrypoint_info(obj_ctx, tenant_name, bucket_name, ep, &ot, NULL, &attrs);
+    ret = store->get_bucket_entrypoint_info(obj_ctx, tenant_name, bucket_name, ep, &ot, NULL, &attrs, null_yield);
     if (ret < 0 && ret != -ENOENT) {
       ldout(store->ctx(), 0) << "ERROR: store->get_bucket_entrypoint_info() returned: "
                              << cpp_strerror(-ret) << dendl;
@@ -272,7 +272,7 @@ int rgw_unlink_bucket(RGWRados *store, const rgw_user& user_id, const string& te
   RGWObjVersionTracker ot;
   map<string, bufferlist> attrs;
   RGWSysObjectCtx obj_ctx = store->svc.sysobj->init_obj_ctx();
-  ret = store->get_bucket_entrypoint_info(obj_ctx, tenant_name, bucket_name, ep, &ot, NULL, &attrs);
+  ret = store->get_bucket_entrypoint_info(obj_ctx, tenant_name, bucket_name, ep, &ot, NULL, &attrs, null_yield);
   if (ret == -ENOENT)
     return 0;
   if (ret < 0)
@@ -534,7 +534,7 @@ int rgw_remove_bucket(RGWRados *store, rgw_bucket& bucket, bool delete_children)
   if (ret < 0)
     return ret;
 
-  ret = store->get_bucket_stats(info, RGW_NO_SHARD, &bucket_ver, &master_ver, stats, NULL);
+  ret = store->get_bucket_stats(info, RGW_NO_SHARD, &bucket_ver, &master_ver, stats, NULL, null_yield);
   if (ret < 0)
     return ret;
 
@@ -640,7 +640,7 @@ int rgw_remove_bucket_bypass_gc(RGWRados *store, rgw_bucket& bucket,
   if (ret < 0)
     return ret;
 
-  ret = store->get_bucket_stats(info, RGW_NO_SHARD, &bucket_ver, &master_ver, stats, NULL);
+  ret = store->get_bucket_stats(info, RGW_NO_SHARD, &bucket_ver, &master_ver, stats, NULL, null_yield);
   if (ret < 0)
     return ret;
 
@@ -807,7 +807,7 @@ int RGWBucket::init(RGWRados *storage, RGWBucketAdminOpState& op_state)
   }
 
   if (!user_id.empty()) {
-    int r = rgw_get_user_info_by_uid(store, user_id, user_info);
+    int r = rgw_get_user_info_by_uid(store, user_id, user_info, null_yield);
     if (r < 0)
       return r;
 
@@ -1435,7 +1435,7 @@ static int bucket_stats(RGWRados *store, const std::string& tenant_name, std::st
 
   string bucket_ver, master_ver;
   string max_marker;
-  int ret = store->get_bucket_stats(bucket_info, RGW_NO_SHARD, &bucket_ver, &master_ver, stats, &max_marker);
+  int ret = store->get_bucket_stats(bucket_info, RGW_NO_SHARD, &bucket_ver, &master_ver, stats, &max_marker, null_yield);
   if (ret < 0) {
     cerr << "error getting bucket stats ret=" << ret << std::endl;
     return ret;
@@ -1544,7 +1544,7 @@ int RGWBucketAdminOp::limit_check(RGWRados *store,
 	string bucket_ver, master_ver;
 	std::map<RGWObjCategory, RGWStorageStats> stats;
 	ret = store->get_bucket_stats(info, RGW_NO_SHARD, &bucket_ver,
-				      &master_ver, stats, nullptr);
+				      &master_ver, stats, nullptr, null_yield);
 
 	if (ret < 0)
 	  continue;
@@ -2531,7 +2531,7 @@ public:
 
     string tenant_name, bucket_name;
     parse_bucket(entry, &tenant_name, &bucket_name);
-    int ret = store->get_bucket_entrypoint_info(obj_ctx, tenant_name, bucket_name, be, &ot, &mtime, &attrs);
+    int ret = store->get_bucket_entrypoint_info(obj_ctx, tenant_name, bucket_name, be, &ot, &mtime, &attrs, null_yield);
     if (ret < 0)
       return ret;
 
@@ -2559,7 +2559,7 @@ public:
 
     string tenant_name, bucket_name;
     parse_bucket(entry, &tenant_name, &bucket_name);
-    int ret = store->get_bucket_entrypoint_info(obj_ctx, tenant_name, bucket_name, old_be, &old_ot, &orig_mtime, &attrs);
+    int ret = store->get_bucket_entrypoint_info(obj_ctx, tenant_name, bucket_name, old_be, &old_ot, &orig_mtime, &attrs, null_yield);
     if (ret < 0 && ret != -ENOENT)
       return ret;
 
@@ -2598,7 +2598,7 @@ public:
 
     string tenant_name, bucket_name;
     parse_bucket(entry, &tenant_name, &bucket_name);
-    int ret = store->get_bucket_entrypoint_info(obj_ctx, tenant_name, bucket_name, be, &objv_tracker, NULL, NULL);
+    int ret = store->get_bucket_entrypoint_info(obj_ctx, tenant_name, bucket_name, be, &objv_tracker, NULL, NULL, null_yield);
     if (ret < 0)
       return ret;
 
@@ -2761,7 +2761,7 @@ public:
     RGWBucketEntryPoint be;
     auto obj_ctx = store->svc.sysobj->init_obj_ctx();
     map<string, bufferlist> attrs;
-    int ret = store->get_bucket_entrypoint_info(obj_ctx, tenant_name, bucket_name, be, &objv_tracker, &mtime, &attrs);
+    int ret = store->get_bucket_entrypoint_info(obj_ctx, tenant_name, bucket_name, be, &objv_tracker, &mtime, &attrs, null_yield);
     if (ret < 0) {
         return ret;
     }
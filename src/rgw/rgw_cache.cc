@@ -24,8 +24,8 @@ int ObjectCache::get(const string& name, ObjectCacheInfo& info, uint32_t mask, r
       perfcounter->inc(l_rgw_cache_miss);
     return -ENOENT;
   }
-  if (expiry.count() &&
-       (ceph::coarse_mono_clock::now() - iter->second.info.time_added) > expiry) {
+  auto age = ceph::coarse_mono_clock::now() - iter->second.info.time_added;
+  if (expiry.count() && age > expiry) {
     ldout(cct, 10) << "cache get: name=" << name << " : expiry miss" << dendl;
     lock.unlock();
     lock.get_write();
@@ -82,6 +82,10 @@ int ObjectCache::get(const string& name, ObjectCacheInfo& info, uint32_t mask, r
     cache_info->cache_locator = name;
     cache_info->gen = entry->gen;
   }
+  if (lease.count() && age > lease) {
+    ldout(cct, 10) << "cache get: name=" << name << " : lease expired" << dendl;
+    return -ESTALE;
+  }
   if(perfcounter) perfcounter->inc(l_rgw_cache_hit);
 
   return 0;
@@ -157,6 +161,8 @@ void ObjectCache::put(const string& name, ObjectCacheInfo& info, rgw_cache_entry
   touch_lru(name, entry, entry.lru_iter);
 
   target.status = info.status;
+  // unknown (0) after local writes, which do not learn the new epoch
+  target.epoch = info.epoch;
 
   if (info.status < 0) {
     target.flags = 0;
@@ -202,6 +208,26 @@ void ObjectCache::put(const string& name, ObjectCacheInfo& info, rgw_cache_entry
     target.version = info.version;
 }
 
+bool ObjectCache::renew(const string& name, uint64_t epoch)
+{
+  RWLock::WLocker l(lock);
+
+  if (!enabled || epoch == 0) {
+    return false;
+  }
+
+  auto iter = cache_map.find(name);
+  if (iter == cache_map.end() || iter->second.info.epoch != epoch) {
+    return false;
+  }
+
+  ldout(cct, 10) << "renewing lease of " << name << dendl;
+  iter->second.info.time_added = ceph::coarse_mono_clock::now();
+  if (perfcounter)
+    perfcounter->inc(l_rgw_cache_hit);
+  return true;
+}
+
 bool ObjectCache::remove(const string& name)
 {
   RWLock::WLocker l(lock);
@@ -16,6 +16,9 @@
 enum {
   UPDATE_OBJ,
   REMOVE_OBJ,
+  REMOVE_DATA, // unused, the data cache only holds tails, which are never rewritten
+  UPDATE_STATS, // apply the bucket stats deltas of another gateway
+  INVALIDATE_OBJS, // drop objs, a batch of remote writes
 };
 
 #define CACHE_FLAG_DATA           0x01
@@ -100,25 +103,40 @@ struct RGWCacheNotifyInfo {
   ObjectCacheInfo obj_info;
   off_t ofs;
   string ns;
+  std::vector<rgw_raw_obj> data_objs; // unused, see REMOVE_DATA
+  bufferlist stats; // opaque to the cache, see RGWSI_SysObj_Cache_StatsCB
+  std::vector<rgw_raw_obj> objs;
 
   RGWCacheNotifyInfo() : op(0), ofs(0) {}
 
   void encode(bufferlist& obl) const {
-    ENCODE_START(2, 2, obl);
+    ENCODE_START(5, 2, obl);
     encode(op, obl);
     encode(obj, obl);
     encode(obj_info, obl);
     encode(ofs, obl);
     encode(ns, obl);
+    encode(data_objs, obl);
+    encode(stats, obl);
+    encode(objs, obl);
     ENCODE_FINISH(obl);
   }
   void decode(bufferlist::const_iterator& ibl) {
-    DECODE_START_LEGACY_COMPAT_LEN(2, 2, 2, ibl);
+    DECODE_START_LEGACY_COMPAT_LEN(5, 2, 2, ibl);
     decode(op, ibl);
     decode(obj, ibl);
     decode(obj_info, ibl);
     decode(ofs, ibl);
     decode(ns, ibl);
+    if (struct_v >= 3) {
+      decode(data_objs, ibl);
+    }
+    if (struct_v >= 4) {
+      decode(stats, ibl);
+    }
+    if (struct_v >= 5) {
+      decode(objs, ibl);
+    }
     DECODE_FINISH(ibl);
   }
   void dump(Formatter *f) const;
@@ -167,6 +185,7 @@ class ObjectCache {
 
   bool enabled;
   ceph::timespan expiry;
+  ceph::timespan lease;
 
   void touch_lru(const string& name, ObjectCacheEntry& entry,
 		 std::list<string>::iterator& lru_iter);
@@ -178,6 +197,7 @@ class ObjectCache {
 public:
   ObjectCache() : lru_size(0), lru_counter(0), lru_window(0), lock("ObjectCache"), cct(NULL), enabled(false) { }
   ~ObjectCache();
+  /// returns -ESTALE, with bl filled in, if the entry outlived its lease
   int get(const std::string& name, ObjectCacheInfo& bl, uint32_t mask, rgw_cache_entry_info *cache_info);
   std::optional<ObjectCacheInfo> get(const std::string& name) {
     std::optional<ObjectCacheInfo> info{std::in_place};
@@ -200,11 +220,18 @@ public:
 
   void put(const std::string& name, ObjectCacheInfo& bl, rgw_cache_entry_info *cache_info);
   bool remove(const std::string& name);
+  /// starts a new lease if the object is still at the cached epoch
+  bool renew(const std::string& name, uint64_t epoch);
   void set_ctx(CephContext *_cct) {
     cct = _cct;
     lru_window = cct->_conf->rgw_cache_lru_size / 2;
     expiry = std::chrono::seconds(cct->_conf.get_val<uint64_t>(
 						"rgw_cache_expiry_interval"));
+    lease = std::chrono::seconds(cct->_conf.get_val<uint64_t>(
+						"rgw_cache_lease_interval"));
+  }
+  bool has_lease() const {
+    return lease.count() != 0;
   }
   bool chain_cache_entry(std::initializer_list<rgw_cache_entry_info*> cache_info_entries,
 			 RGWChainedCache::Entry *chained_entry);
@@ -112,6 +112,7 @@ using ceph::crypto::MD5;
 /* IAM Policy */
 #define RGW_ATTR_IAM_POLICY	RGW_ATTR_PREFIX "iam-policy"
 #define RGW_ATTR_USER_POLICY    RGW_ATTR_PREFIX "user-policy"
+#define RGW_ATTR_QOS            RGW_ATTR_PREFIX "qos"
 
 /* RGW File Attributes */
 #define RGW_ATTR_UNIX_KEY1      RGW_ATTR_PREFIX "unix-key1"
@@ -520,6 +521,7 @@ enum RGWOpType {
   RGW_OP_GET_BUCKET_TAGGING,
   RGW_OP_PUT_BUCKET_TAGGING,
   RGW_OP_DELETE_BUCKET_TAGGING,
+  RGW_OP_SELECT_OBJ_CONTENT,
 };
 
 class RGWAccessControlPolicy;
@@ -2023,6 +2025,8 @@ struct req_state : DoutPrefixProvider {
   rgw::IAM::Environment env;
   boost::optional<rgw::IAM::Policy> iam_policy;
   vector<rgw::IAM::Policy> iam_user_policies;
+  /// the requester's RGW_ATTR_QOS, if any
+  bufferlist user_qos;
 
   /* Is the request made by an user marked as a system one?
    * Being system user means we also have the admin status. */
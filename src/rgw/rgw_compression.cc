@@ -7,42 +7,48 @@
 
 //------------RGWPutObj_Compress---------------
 
-int RGWPutObj_Compress::process(bufferlist&& in, uint64_t logical_offset)
+RGWPutObj_Compress::RGWPutObj_Compress(CephContext* cct_,
+                                       CompressorRef compressor,
+                                       rgw::putobj::DataProcessor *next,
+                                       optional_yield y)
+  : ParallelPipe(cct_, next,
+                 [compressor] (bufferlist& in, uint64_t, bufferlist& out) {
+                   return compressor->compress(in, out);
+                 }, 1, y,
+                 cct_->_conf.get_val<Option::size_t>("rgw_compression_block_size")),
+    cct(cct_)
+{}
+
+int RGWPutObj_Compress::commit(bufferlist& in, uint64_t logical_offset,
+                               bufferlist& out, int r)
 {
-  bufferlist out;
-  if (in.length() > 0) {
-    // compression stuff
-    if ((logical_offset > 0 && compressed) || // if previous part was compressed
-        (logical_offset == 0)) {              // or it's the first part
-      ldout(cct, 10) << "Compression for rgw is enabled, compress part " << in.length() << dendl;
-      int cr = compressor->compress(in, out);
-      if (cr < 0) {
-        if (logical_offset > 0) {
-          lderr(cct) << "Compression failed with exit code " << cr
-              << " for next part, compression process failed" << dendl;
-          return -EIO;
-        }
-        compressed = false;
-        ldout(cct, 5) << "Compression failed with exit code " << cr
-            << " for first part, storing uncompressed" << dendl;
-        out.claim(in);
-      } else {
-        compressed = true;
-    
-        compression_block newbl;
-        size_t bs = blocks.size();
-        newbl.old_ofs = logical_offset;
-        newbl.new_ofs = bs > 0 ? blocks[bs-1].len + blocks[bs-1].new_ofs : 0;
-        newbl.len = out.length();
-        blocks.push_back(newbl);
-      }
-    } else {
-      compressed = false;
-      out.claim(in);
+  if (logical_offset > 0 && !compressed) {
+    // the first part was stored uncompressed, so are the rest of them
+    out.claim(in);
+    return 0;
+  }
+  ldout(cct, 10) << "Compression for rgw is enabled, compress part " << in.length() << dendl;
+  if (r < 0) {
+    if (logical_offset > 0) {
+      lderr(cct) << "Compression failed with exit code " << r
+          << " for next part, compression process failed" << dendl;
+      return -EIO;
     }
-    // end of compression stuff
+    compressed = false;
+    ldout(cct, 5) << "Compression failed with exit code " << r
+        << " for first part, storing uncompressed" << dendl;
+    out.claim(in);
+    return 0;
   }
-  return Pipe::process(std::move(out), logical_offset);
+  compressed = true;
+
+  compression_block newbl;
+  size_t bs = blocks.size();
+  newbl.old_ofs = logical_offset;
+  newbl.new_ofs = bs > 0 ? blocks[bs-1].len + blocks[bs-1].new_ofs : 0;
+  newbl.len = out.length();
+  blocks.push_back(newbl);
+  return 0;
 }
 
 //----------------RGWGetObj_Decompress---------------------
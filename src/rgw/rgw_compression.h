@@ -8,6 +8,7 @@
 
 #include "compressor/Compressor.h"
 #include "rgw_putobj.h"
+#include "rgw_putobj_parallel.h"
 #include "rgw_op.h"
 
 class RGWGetObj_Decompress : public RGWGetObj_Filter
@@ -32,18 +33,20 @@ public:
 
 };
 
-class RGWPutObj_Compress : public rgw::putobj::Pipe
+// compresses each block of rgw_compression_block_size, or each chunk of
+// input when it is 0, on its own
+class RGWPutObj_Compress : public rgw::putobj::ParallelPipe
 {
   CephContext* cct;
   bool compressed{false};
-  CompressorRef compressor;
   std::vector<compression_block> blocks;
+protected:
+  int commit(bufferlist& in, uint64_t logical_offset,
+             bufferlist& out, int r) override;
 public:
   RGWPutObj_Compress(CephContext* cct_, CompressorRef compressor,
-                     rgw::putobj::DataProcessor *next)
-    : Pipe(next), cct(cct_), compressor(compressor) {}
-
-  int process(bufferlist&& data, uint64_t logical_offset) override;
+                     rgw::putobj::DataProcessor *next,
+                     optional_yield y = null_yield);
 
   bool is_compressed() { return compressed; }
   vector<compression_block>& get_compression_blocks() { return blocks; }
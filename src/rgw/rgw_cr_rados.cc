@@ -587,6 +587,7 @@ int RGWAsyncFetchRemoteObj::_send_request()
   rgw_obj dest_obj(bucket_info.bucket, dest_key.value_or(key));
 
   std::optional<uint64_t> bytes_transferred;
+  const auto start = ceph::mono_clock::now();
   int r = store->fetch_remote_obj(obj_ctx,
                        user_id,
                        NULL, /* req_info */
@@ -625,6 +626,7 @@ int RGWAsyncFetchRemoteObj::_send_request()
   } else if (counters) {
     if (bytes_transferred) {
       counters->inc(sync_counters::l_fetch, *bytes_transferred);
+      counters->tinc(sync_counters::l_fetch_lat, ceph::mono_clock::now() - start);
     } else {
       counters->inc(sync_counters::l_fetch_not_modified);
     }
@@ -678,48 +678,25 @@ int RGWGetObj_BlockDecrypt::flush() {
   return res;
 }
 
-RGWPutObj_BlockEncrypt::RGWPutObj_BlockEncrypt(CephContext* cct,
-                                               rgw::putobj::DataProcessor *next,
-                                               std::unique_ptr<BlockCrypt> crypt)
-  : Pipe(next),
-    cct(cct),
-    crypt(std::move(crypt)),
-    block_size(this->crypt->get_block_size())
-{
-}
-
-int RGWPutObj_BlockEncrypt::process(bufferlist&& data, uint64_t logical_offset)
+static rgw::putobj::ParallelPipe::Transform
+make_encrypt_transform(CephContext* cct, std::shared_ptr<BlockCrypt> crypt)
 {
-  ldout(cct, 25) << "Encrypt " << data.length() << " bytes" << dendl;
-
-  // adjust logical offset to beginning of cached data
-  ceph_assert(logical_offset >= cache.length());
-  logical_offset -= cache.length();
-
-  const bool flush = (data.length() == 0);
-  cache.claim_append(data);
-
-  uint64_t proc_size = cache.length() & ~(block_size - 1);
-  if (flush) {
-    proc_size = cache.length();
-  }
-  if (proc_size > 0) {
-    bufferlist in, out;
-    cache.splice(0, proc_size, &in);
-    if (!crypt->encrypt(in, 0, proc_size, out, logical_offset)) {
+  return [cct, crypt] (bufferlist& in, uint64_t logical_offset, bufferlist& out) {
+    ldout(cct, 25) << "Encrypt " << in.length() << " bytes" << dendl;
+    if (!crypt->encrypt(in, 0, in.length(), out, logical_offset)) {
       return -ERR_INTERNAL_ERROR;
     }
-    int r = Pipe::process(std::move(out), logical_offset);
-    logical_offset += proc_size;
-    if (r < 0)
-      return r;
-  }
+    return 0;
+  };
+}
 
-  if (flush) {
-    /*replicate 0-sized handle_data*/
-    return Pipe::process({}, logical_offset);
-  }
-  return 0;
+RGWPutObj_BlockEncrypt::RGWPutObj_BlockEncrypt(CephContext* cct,
+                                               rgw::putobj::DataProcessor *next,
+                                               std::shared_ptr<BlockCrypt> crypt,
+                                               optional_yield y)
+  : ParallelPipe(cct, next, make_encrypt_transform(cct, crypt),
+                 crypt->get_block_size(), y)
+{
 }
 
 
@@ -12,6 +12,7 @@
 #include <rgw/rgw_rest.h>
 #include <rgw/rgw_rest_s3.h>
 #include "rgw_putobj.h"
+#include "rgw_putobj_parallel.h"
 #include <boost/utility/string_view.hpp>
 
 /**
@@ -118,19 +119,16 @@ public:
 }; /* RGWGetObj_BlockDecrypt */
 
 
-class RGWPutObj_BlockEncrypt : public rgw::putobj::Pipe
+class RGWPutObj_BlockEncrypt : public rgw::putobj::ParallelPipe
 {
-  CephContext* cct;
-  std::unique_ptr<BlockCrypt> crypt; /**< already configured stateless BlockCrypt
-                                          for operations when enough data is accumulated */
-  bufferlist cache; /**< stores extra data that could not (yet) be processed by BlockCrypt */
-  const size_t block_size; /**< snapshot of \ref BlockCrypt.get_block_size() */
 public:
+  /* crypt is an already configured stateless BlockCrypt, shared by the
+   * chunks encrypted at the same time. they are all a multiple of its
+   * block size except the last one */
   RGWPutObj_BlockEncrypt(CephContext* cct,
                          rgw::putobj::DataProcessor *next,
-                         std::unique_ptr<BlockCrypt> crypt);
-
-  int process(bufferlist&& data, uint64_t logical_offset) override;
+                         std::shared_ptr<BlockCrypt> crypt,
+                         optional_yield y = null_yield);
 }; /* RGWPutObj_BlockEncrypt */
 
 
@@ -2801,7 +2801,65 @@ done:
   }
 };
 
-#define BUCKET_SYNC_SPAWN_WINDOW 20
+// how often the spawn window looks at the fetch latency again
+static constexpr auto SPAWN_WINDOW_UPDATE_INTERVAL = std::chrono::seconds(10);
+
+RGWSyncSpawnWindow::RGWSyncSpawnWindow(CephContext *cct, PerfCounters *counters)
+  : counters(counters),
+    min_window(cct->_conf.get_val<uint64_t>("rgw_bucket_sync_spawn_window")),
+    max_window(std::max(min_window,
+                        cct->_conf.get_val<uint64_t>("rgw_bucket_sync_spawn_window_max"))),
+    window(min_window),
+    next_update(ceph::coarse_mono_clock::now() + SPAWN_WINDOW_UPDATE_INTERVAL)
+{
+  if (counters) {
+    last_avg = counters->get_tavg_ns(sync_counters::l_fetch_lat);
+  }
+}
+
+size_t RGWSyncSpawnWindow::get()
+{
+  std::lock_guard l{lock};
+  if (!counters || min_window == max_window) {
+    return window;
+  }
+  const auto now = ceph::coarse_mono_clock::now();
+  if (now < next_update) {
+    return window;
+  }
+  next_update = now + SPAWN_WINDOW_UPDATE_INTERVAL;
+
+  const auto avg = counters->get_tavg_ns(sync_counters::l_fetch_lat);
+  const uint64_t count = avg.first - last_avg.first;
+  if (count < window) {
+    // too few fetches completed to tell anything, keep on accumulating
+    return window;
+  }
+  const uint64_t latency = (avg.second - last_avg.second) / count;
+  last_avg = avg;
+
+  if (best_latency == 0 || latency < best_latency) {
+    best_latency = latency;
+  } else {
+    // let the reference follow slowly, object sizes change over time
+    best_latency += (latency - best_latency) / 16;
+  }
+
+  if (latency <= best_latency + best_latency / 2) {
+    window = std::min(max_window, window + std::max<size_t>(window / 4, 1));
+  } else if (latency > best_latency * 2) {
+    window = std::max(min_window, window / 2);
+  }
+  return window;
+}
+
+size_t RGWDataSyncEnv::get_spawn_window()
+{
+  if (!spawn_window) {
+    return cct->_conf.get_val<uint64_t>("rgw_bucket_sync_spawn_window");
+  }
+  return spawn_window->get();
+}
 
 class RGWBucketShardFullSyncCR : public RGWCoroutine {
   RGWDataSyncEnv *sync_env;
@@ -2815,6 +2873,11 @@ class RGWBucketShardFullSyncCR : public RGWCoroutine {
   rgw_obj_key list_marker;
   bucket_list_entry *entry{nullptr};
 
+  // the next page of the listing, requested while the current one syncs
+  bucket_list_result next_list_result;
+  boost::intrusive_ptr<RGWListBucketShardCR> list_cr;
+  boost::intrusive_ptr<RGWCoroutinesStack> list_stack;
+
   int total_entries{0};
 
   int sync_status{0};
@@ -2824,6 +2887,8 @@ class RGWBucketShardFullSyncCR : public RGWCoroutine {
   rgw_zone_set zones_trace;
 
   RGWSyncTraceNodeRef tn;
+
+  void collect_children();
 public:
   RGWBucketShardFullSyncCR(RGWDataSyncEnv *_sync_env, const rgw_bucket_shard& bs,
                            RGWBucketInfo *_bucket_info,
@@ -2844,30 +2909,54 @@ public:
   int operate() override;
 };
 
-int RGWBucketShardFullSyncCR::operate()
+void RGWBucketShardFullSyncCR::collect_children()
 {
   int ret;
+  RGWCoroutinesStack *child;
+  while (collect_next(&ret, &child)) {
+    if (child == list_stack.get()) {
+      /* the listing result is checked once its entries are needed */
+      continue;
+    }
+    if (ret < 0) {
+      tn->log(10, "a sync operation returned error");
+      sync_status = ret;
+      /* we have reported this error */
+    }
+  }
+}
+
+int RGWBucketShardFullSyncCR::operate()
+{
   reenter(this) {
     list_marker = sync_info.full_marker.position;
 
     total_entries = sync_info.full_marker.count;
+    set_status("listing remote bucket");
+    tn->log(20, "listing bucket for full sync");
+    yield call(new RGWListBucketShardCR(sync_env, bs, list_marker,
+                                        &list_result));
     do {
-      if (!lease_cr->is_locked()) {
-        drain_all();
-        return set_cr_error(-ECANCELED);
-      }
-      set_status("listing remote bucket");
-      tn->log(20, "listing bucket for full sync");
-      yield call(new RGWListBucketShardCR(sync_env, bs, list_marker,
-                                          &list_result));
       if (retcode < 0 && retcode != -ENOENT) {
         set_status("failed bucket listing, going down");
         drain_all();
         return set_cr_error(retcode);
       }
+      if (!lease_cr->is_locked()) {
+        drain_all();
+        return set_cr_error(-ECANCELED);
+      }
       if (list_result.entries.size() > 0) {
         tn->set_flag(RGW_SNS_FLAG_ACTIVE); /* actually have entries to sync */
       }
+      if (list_result.is_truncated && !list_result.entries.empty()) {
+        /* list the next page while this one is being fetched */
+        tn->log(20, "listing bucket ahead for full sync");
+        list_cr.reset(new RGWListBucketShardCR(sync_env, bs,
+                                               list_result.entries.back().key,
+                                               &next_list_result));
+        list_stack.reset(spawn(list_cr.get(), false));
+      }
       entries_iter = list_result.entries.begin();
       for (; entries_iter != list_result.entries.end(); ++entries_iter) {
         if (!lease_cr->is_locked()) {
@@ -2890,34 +2979,40 @@ int RGWBucketShardFullSyncCR::operate()
                                  entry->key, &marker_tracker, zones_trace, tn),
                       false);
         }
-        while (num_spawned() > BUCKET_SYNC_SPAWN_WINDOW) {
+        while (num_spawned() > sync_env->get_spawn_window()) {
           yield wait_for_child();
-          bool again = true;
-          while (again) {
-            again = collect(&ret, nullptr);
-            if (ret < 0) {
-              tn->log(10, "a sync operation returned error");
-              sync_status = ret;
-              /* we have reported this error */
-            }
-          }
+          collect_children();
         }
       }
-    } while (list_result.is_truncated && sync_status == 0);
+      if (!list_result.is_truncated || sync_status < 0) {
+        break;
+      }
+      if (list_stack) {
+        set_status("waiting for remote bucket listing");
+        while (!list_stack->is_done()) {
+          yield wait_for_child();
+          collect_children();
+        }
+        /* make sure it was collected before dropping our reference */
+        collect_children();
+        retcode = list_cr->get_ret_status();
+        list_stack.reset();
+        list_cr.reset();
+        std::swap(list_result, next_list_result);
+        next_list_result = bucket_list_result();
+      } else {
+        yield call(new RGWListBucketShardCR(sync_env, bs, list_marker,
+                                            &list_result));
+      }
+    } while (sync_status == 0);
     set_status("done iterating over all objects");
     /* wait for all operations to complete */
     while (num_spawned()) {
       yield wait_for_child();
-      bool again = true;
-      while (again) {
-        again = collect(&ret, nullptr);
-        if (ret < 0) {
-          tn->log(10, "a sync operation returned error");
-          sync_status = ret;
-          /* we have reported this error */
-        }
-      }
+      collect_children();
     }
+    list_stack.reset();
+    list_cr.reset();
     tn->unset_flag(RGW_SNS_FLAG_ACTIVE);
     if (!lease_cr->is_locked()) {
       return set_cr_error(-ECANCELED);
@@ -3171,7 +3266,7 @@ int RGWBucketShardIncrementalSyncCR::operate()
                   false);
           }
         // }
-        while (num_spawned() > BUCKET_SYNC_SPAWN_WINDOW) {
+        while (num_spawned() > sync_env->get_spawn_window()) {
           set_status() << "num_spawned() > spawn_window";
           yield wait_for_child();
           bool again = true;
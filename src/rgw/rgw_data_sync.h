@@ -7,6 +7,7 @@
 #include "include/encoding.h"
 
 #include "common/RWLock.h"
+#include "common/ceph_mutex.h"
 #include "common/ceph_json.h"
 
 
@@ -233,6 +234,31 @@ struct rgw_bucket_entry_owner {
 class RGWSyncErrorLogger;
 class RGWRESTConn;
 
+/**
+ * the number of objects that a bucket shard sync fetches concurrently
+ *
+ * Starts at rgw_bucket_sync_spawn_window and grows, up to
+ * rgw_bucket_sync_spawn_window_max, while the average fetch latency from the
+ * sync counters stays close to the best one seen. It backs off once the
+ * latency rises, i.e. when the source zone or the local cluster saturates.
+ */
+class RGWSyncSpawnWindow {
+  PerfCounters *counters;
+  const size_t min_window;
+  const size_t max_window;
+
+  ceph::mutex lock = ceph::make_mutex("RGWSyncSpawnWindow::lock");
+  size_t window;
+  ceph::coarse_mono_time next_update;
+  std::pair<uint64_t, uint64_t> last_avg; ///< count and sum of the fetch latencies
+  uint64_t best_latency{0}; ///< in ns
+
+public:
+  RGWSyncSpawnWindow(CephContext *cct, PerfCounters *counters);
+
+  size_t get();
+};
+
 struct RGWDataSyncEnv {
   const DoutPrefixProvider *dpp{nullptr};
   CephContext *cct{nullptr};
@@ -245,6 +271,7 @@ struct RGWDataSyncEnv {
   string source_zone;
   RGWSyncModuleInstanceRef sync_module{nullptr};
   PerfCounters* counters{nullptr};
+  std::shared_ptr<RGWSyncSpawnWindow> spawn_window;
 
   RGWDataSyncEnv() {}
 
@@ -264,8 +291,11 @@ struct RGWDataSyncEnv {
     source_zone = _source_zone;
     sync_module = _sync_module;
     counters = _counters;
+    spawn_window = std::make_shared<RGWSyncSpawnWindow>(cct, counters);
   }
 
+  size_t get_spawn_window();
+
   string shard_obj_name(int shard_id);
   string status_oid();
 };
@@ -0,0 +1,201 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "common/errno.h"
+#include "include/Context.h"
+
+#include "rgw_datacache.h"
+#include "rgw_perf_counters.h"
+
+#define dout_context cct
+#define dout_subsys ceph_subsys_rgw
+#undef dout_prefix
+#define dout_prefix *_dout << "datacache: "
+
+RGWDataCache::RGWDataCache(CephContext *cct)
+  : cct(cct),
+    path(cct->_conf.get_val<std::string>("rgw_datacache_path")),
+    max_size(cct->_conf.get_val<Option::size_t>("rgw_datacache_size")),
+    writer(cct, "rgw_datacache", "rgw_dcache")
+{}
+
+RGWDataCache::~RGWDataCache()
+{
+  shutdown();
+}
+
+int RGWDataCache::init()
+{
+  if (::mkdir(path.c_str(), 0700) < 0 && errno != EEXIST) {
+    int r = -errno;
+    lderr(cct) << "failed to create " << path << ": " << cpp_strerror(r)
+	       << dendl;
+    return r;
+  }
+  // the entries are not persisted, so whatever is there is garbage
+  DIR *dir = ::opendir(path.c_str());
+  if (!dir) {
+    int r = -errno;
+    lderr(cct) << "failed to open " << path << ": " << cpp_strerror(r)
+	       << dendl;
+    return r;
+  }
+  while (struct dirent *de = ::readdir(dir)) {
+    if (de->d_name[0] == '.') {
+      continue;
+    }
+    std::string fn = path + "/" + de->d_name;
+    if (::unlink(fn.c_str()) < 0) {
+      ldout(cct, 1) << "failed to remove stale " << fn << ": "
+		    << cpp_strerror(errno) << dendl;
+    }
+  }
+  ::closedir(dir);
+  writer.start();
+  started = true;
+  ldout(cct, 1) << "caching up to " << byte_u_t(max_size) << " in " << path
+		<< dendl;
+  return 0;
+}
+
+void RGWDataCache::shutdown()
+{
+  if (started) {
+    writer.wait_for_empty();
+    writer.stop();
+    started = false;
+  }
+}
+
+std::string RGWDataCache::obj_prefix(const rgw_raw_obj& obj)
+{
+  std::string key = obj.pool.to_str();
+  key.push_back('/');
+  key.append(obj.oid);
+  key.push_back('/');
+  return key;
+}
+
+std::string RGWDataCache::make_key(const rgw_raw_obj& obj, uint64_t ofs,
+				   uint64_t len)
+{
+  return obj_prefix(obj) + std::to_string(ofs) + "." + std::to_string(len);
+}
+
+std::string RGWDataCache::file_path(uint64_t file_id) const
+{
+  return path + "/" + std::to_string(file_id);
+}
+
+void RGWDataCache::_erase(std::map<std::string, entry_t>::iterator i)
+{
+  if (i->second.ready) {
+    // a fill still in flight removes its own file, see fill()
+    ::unlink(file_path(i->second.file_id).c_str());
+  }
+  cur_size -= i->second.size;
+  lru.erase(i->second.lru_pos);
+  entries.erase(i);
+}
+
+bool RGWDataCache::get(const rgw_raw_obj& obj, uint64_t ofs, uint64_t len,
+		       bufferlist *bl)
+{
+  uint64_t file_id;
+  {
+    std::lock_guard l(lock);
+    auto i = entries.find(make_key(obj, ofs, len));
+    if (i == entries.end() || !i->second.ready) {
+      if (perfcounter) perfcounter->inc(l_rgw_datacache_miss);
+      return false;
+    }
+    lru.splice(lru.begin(), lru, i->second.lru_pos);
+    file_id = i->second.file_id;
+  }
+  // file ids are never reused, so at worst the file was just evicted
+  std::string err;
+  bufferlist data;
+  if (data.read_file(file_path(file_id).c_str(), &err) < 0) {
+    ldout(cct, 10) << "failed to read cached " << obj << " " << ofs << "~"
+		   << len << ": " << err << dendl;
+    if (perfcounter) perfcounter->inc(l_rgw_datacache_miss);
+    return false;
+  }
+  if (perfcounter) {
+    perfcounter->inc(l_rgw_datacache_hit);
+    perfcounter->inc(l_rgw_datacache_hit_b, data.length());
+  }
+  bl->claim_append(data);
+  return true;
+}
+
+void RGWDataCache::put(const rgw_raw_obj& obj, uint64_t ofs, uint64_t len,
+		       const bufferlist& bl)
+{
+  if (bl.length() == 0 || bl.length() > max_size) {
+    return;
+  }
+  std::string key = make_key(obj, ofs, len);
+  uint64_t file_id;
+  {
+    std::lock_guard l(lock);
+    if (entries.count(key)) {
+      return;
+    }
+    while (!lru.empty() && cur_size + bl.length() > max_size) {
+      _erase(entries.find(lru.back()));
+      if (perfcounter) perfcounter->inc(l_rgw_datacache_evict);
+    }
+    file_id = next_file_id++;
+    lru.push_front(key);
+    auto& e = entries[key];
+    e.file_id = file_id;
+    e.size = bl.length();
+    e.lru_pos = lru.begin();
+    cur_size += e.size;
+  }
+  writer.queue(make_lambda_context(
+    [this, key=std::move(key), file_id, bl=bl] () mutable {
+      fill(key, file_id, bl);
+    }));
+}
+
+void RGWDataCache::fill(const std::string& key, uint64_t file_id,
+			bufferlist& bl)
+{
+  const std::string fn = file_path(file_id);
+  int r = bl.write_file(fn.c_str(), 0600);
+  std::lock_guard l(lock);
+  auto i = entries.find(key);
+  bool wanted = i != entries.end() && i->second.file_id == file_id;
+  if (r < 0 || !wanted) {
+    if (r < 0) {
+      ldout(cct, 1) << "failed to write " << fn << ": " << cpp_strerror(r)
+		    << dendl;
+    }
+    ::unlink(fn.c_str());
+    if (wanted) {
+      _erase(i);
+    }
+    return;
+  }
+  i->second.ready = true;
+}
+
+void RGWDataCache::invalidate(const rgw_raw_obj& obj)
+{
+  const std::string prefix = obj_prefix(obj);
+  std::lock_guard l(lock);
+  auto i = entries.lower_bound(prefix);
+  while (i != entries.end() &&
+	 i->first.compare(0, prefix.size(), prefix) == 0) {
+    ldout(cct, 20) << "invalidating " << i->first << dendl;
+    _erase(i++);
+  }
+}
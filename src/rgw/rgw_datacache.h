@@ -0,0 +1,71 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <string>
+
+#include "include/buffer.h"
+#include "common/ceph_mutex.h"
+#include "common/Finisher.h"
+#include "rgw_common.h"
+
+/**
+ * a read-through cache of object data on a local device
+ *
+ * Caches the tail stripes read by GET requests, one file per read, under
+ * rgw_datacache_path. Misses are filled asynchronously once the RADOS read
+ * completes; the least recently read stripes are evicted to stay within
+ * rgw_datacache_size. Head objects are never cached as they are rewritten
+ * in place, while tail objects get new names whenever an object is
+ * rewritten: a random prefix for atomic and append uploads, and for
+ * multipart uploads a prefix whose part head was created exclusively. So
+ * a cached stripe never goes stale and no gateway has to tell the others
+ * about uploads.
+ */
+class RGWDataCache {
+  CephContext *cct;
+  std::string path;
+  uint64_t max_size;
+
+  struct entry_t {
+    uint64_t file_id;
+    uint64_t size;
+    bool ready = false;	///< the file is fully written
+    std::list<std::string>::iterator lru_pos;
+  };
+
+  ceph::mutex lock = ceph::make_mutex("RGWDataCache::lock");
+  std::map<std::string, entry_t> entries; ///< sorted, for prefix invalidation
+  std::list<std::string> lru;	///< most recently read first
+  uint64_t cur_size = 0;		///< includes the fills in flight
+  uint64_t next_file_id = 0;
+
+  Finisher writer;	///< fills the cache off the read path
+  bool started = false;
+
+  static std::string obj_prefix(const rgw_raw_obj& obj);
+  static std::string make_key(const rgw_raw_obj& obj, uint64_t ofs,
+			      uint64_t len);
+  std::string file_path(uint64_t file_id) const;
+  void _erase(std::map<std::string, entry_t>::iterator i);
+  void fill(const std::string& key, uint64_t file_id, bufferlist& bl);
+
+public:
+  explicit RGWDataCache(CephContext *cct);
+  ~RGWDataCache();
+
+  int init();
+  void shutdown();
+
+  /// @return true and the data if read [ofs, ofs+len) of obj is cached
+  bool get(const rgw_raw_obj& obj, uint64_t ofs, uint64_t len,
+	   bufferlist *bl);
+  /// cache the result of reading [ofs, ofs+len) of obj
+  void put(const rgw_raw_obj& obj, uint64_t ofs, uint64_t len,
+	   const bufferlist& bl);
+  /// drop everything cached for obj
+  void invalidate(const rgw_raw_obj& obj);
+};
@@ -17,6 +17,8 @@
 #ifndef RGW_DMCLOCK_H
 #define RGW_DMCLOCK_H
 #include "dmclock/src/dmclock_server.h"
+#include "include/encoding.h"
+#include "common/Formatter.h"
 
 namespace rgw::dmclock {
 // TODO: implement read vs write
@@ -32,6 +34,41 @@ enum class client_id {
 using crimson::dmclock::Cost;
 using crimson::dmclock::ClientInfo;
 
+/// the dmclock parameters of a bucket or user, kept in its RGW_ATTR_QOS
+/// attribute. requests for buckets and users with a QoSInfo are scheduled
+/// by a TenantScheduler once they are authenticated
+struct QoSInfo {
+  double reservation = 0; //< requests/s, 0 for none
+  double weight = 1;
+  double limit = 0; //< requests/s, 0 for unlimited
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(reservation, bl);
+    encode(weight, bl);
+    encode(limit, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(bufferlist::const_iterator& bl) {
+    DECODE_START(1, bl);
+    decode(reservation, bl);
+    decode(weight, bl);
+    decode(limit, bl);
+    DECODE_FINISH(bl);
+  }
+  void dump(Formatter *f) const {
+    f->dump_float("reservation", reservation);
+    f->dump_float("weight", weight);
+    f->dump_float("limit", limit);
+  }
+  bool operator==(const QoSInfo& o) const {
+    return reservation == o.reservation && weight == o.weight &&
+      limit == o.limit;
+  }
+  bool operator!=(const QoSInfo& o) const { return !(*this == o); }
+};
+WRITE_CLASS_ENCODER(QoSInfo)
+
 enum class scheduler_t {
                         none,
                         throttler,
@@ -172,4 +172,177 @@ void AsyncScheduler::process(const Time& now)
   }
 }
 
+AsyncTenantScheduler::AsyncTenantScheduler(CephContext *cct,
+                                           boost::asio::io_context& context)
+  : last_collect(get_time()),
+    queue([this] (const std::string& tenant) { return get_info(tenant); },
+          AtLimit::Reject),
+    timer(context), cct(cct),
+    max_requests(cct->_conf.get_val<int64_t>("rgw_dmclock_tenant_max_requests"))
+{
+  if (max_requests <= 0) {
+    max_requests = std::numeric_limits<int64_t>::max();
+  }
+  cct->_conf.add_observer(this);
+}
+
+AsyncTenantScheduler::~AsyncTenantScheduler()
+{
+  cancel();
+  cct->_conf.remove_observer(this);
+}
+
+const char** AsyncTenantScheduler::get_tracked_conf_keys() const
+{
+  static const char* keys[] = { "rgw_dmclock_tenant_max_requests", nullptr };
+  return keys;
+}
+
+void AsyncTenantScheduler::handle_conf_change(const ConfigProxy& conf,
+                                              const std::set<std::string>& changed)
+{
+  if (changed.count("rgw_dmclock_tenant_max_requests")) {
+    auto new_max = conf.get_val<int64_t>("rgw_dmclock_tenant_max_requests");
+    max_requests = new_max > 0 ? new_max : std::numeric_limits<int64_t>::max();
+    schedule(crimson::dmclock::TimeZero);
+  }
+}
+
+int AsyncTenantScheduler::schedule_request_impl(const std::string& tenant,
+                                                const QoSInfo& qos,
+                                                const client_id& client,
+                                                const Time& time,
+                                                const Cost& cost,
+                                                optional_yield yield_ctx)
+{
+  ceph_assert(yield_ctx);
+
+  auto &yield = yield_ctx.get_yield_context();
+  boost::system::error_code ec;
+  async_request(tenant, qos, client, time, cost, yield[ec]);
+
+  if (ec) {
+    if (ec == boost::system::errc::resource_unavailable_try_again)
+      return -EAGAIN;
+    else
+      return -ec.value();
+  }
+  return 0;
+}
+
+void AsyncTenantScheduler::request_complete()
+{
+  --outstanding_requests;
+  schedule(crimson::dmclock::TimeZero);
+}
+
+void AsyncTenantScheduler::cancel()
+{
+  queue.remove_by_req_filter([&] (RequestRef&& request) {
+      auto c = static_cast<Completion*>(request.release());
+      Completion::dispatch(std::unique_ptr<Completion>{c},
+                           boost::asio::error::operation_aborted,
+                           PhaseType::priority);
+      return true;
+    });
+  timer.cancel();
+}
+
+std::map<std::string, double> AsyncTenantScheduler::collect_rates()
+{
+  std::map<std::string, double> rates;
+  const auto now = get_time();
+  std::lock_guard l{tenant_lock};
+  const double elapsed = std::max(now - last_collect, 0.001);
+  last_collect = now;
+  for (auto& [name, t] : tenants) {
+    rates[name] = t.requests / elapsed;
+    t.requests = 0;
+  }
+  return rates;
+}
+
+void AsyncTenantScheduler::set_shares(const std::map<std::string, double>& shares)
+{
+  std::vector<std::unique_ptr<ClientInfo>> retired;
+  {
+    std::lock_guard l{tenant_lock};
+    for (auto& [name, share] : shares) {
+      auto t = tenants.find(name);
+      if (t == tenants.end() || t->second.share == share) {
+        continue;
+      }
+      t->second.share = share;
+      retired.push_back(set_info(t->second));
+    }
+  }
+  if (!retired.empty()) {
+    update_infos(std::move(retired));
+  }
+}
+
+std::unique_ptr<ClientInfo> AsyncTenantScheduler::set_info(tenant_t& tenant)
+{
+  const auto& qos = tenant.qos;
+  auto info = std::make_unique<ClientInfo>(qos.reservation * tenant.share,
+                                           qos.weight > 0 ? qos.weight : 1,
+                                           qos.limit * tenant.share);
+  std::swap(info, tenant.info);
+  return info;
+}
+
+void AsyncTenantScheduler::update_infos(std::vector<std::unique_ptr<ClientInfo>>&& retired)
+{
+  // the queue looks up the infos of all its clients again, after which it no
+  // longer refers to the retired ones
+  queue.update_client_infos();
+  retired.clear();
+  schedule(crimson::dmclock::TimeZero);
+}
+
+const ClientInfo* AsyncTenantScheduler::get_info(const std::string& tenant)
+{
+  static const ClientInfo unknown{0, 1, 0};
+  std::lock_guard l{tenant_lock};
+  auto t = tenants.find(tenant);
+  if (t == tenants.end() || !t->second.info) {
+    return &unknown;
+  }
+  return t->second.info.get();
+}
+
+void AsyncTenantScheduler::schedule(const Time& time)
+{
+  timer.expires_at(Clock::from_double(time));
+  timer.async_wait([this] (boost::system::error_code ec) {
+      if (ec != boost::asio::error::operation_aborted) {
+        process(get_time());
+      }
+    });
+}
+
+void AsyncTenantScheduler::process(const Time& now)
+{
+  assert(get_executor().running_in_this_thread());
+
+  while (outstanding_requests < max_requests) {
+    auto pull = queue.pull_request(now);
+
+    if (pull.is_none()) {
+      timer.cancel();
+      break;
+    }
+    if (pull.is_future()) {
+      schedule(pull.getTime());
+      break;
+    }
+    ++outstanding_requests;
+
+    auto& r = pull.get_retn();
+    auto c = static_cast<Completion*>(r.request.release());
+    Completion::post(std::unique_ptr<Completion>{c},
+                     boost::system::error_code{}, r.phase);
+  }
+}
+
 } // namespace rgw::dmclock
@@ -16,7 +16,11 @@
 #define RGW_DMCLOCK_ASYNC_SCHEDULER_H
 
 #include "common/async/completion.h"
+#include "common/ceph_mutex.h"
 
+#include <map>
+#include <memory>
+#include <vector>
 #include <boost/asio.hpp>
 #include "rgw_dmclock_scheduler.h"
 #include "rgw_dmclock_scheduler_ctx.h"
@@ -163,6 +167,156 @@ auto AsyncScheduler::async_request(const client_id& client,
   return init.result.get();
 }
 
+/*
+ * A dmclock scheduler for the buckets and users with their own QoSInfo.
+ *
+ * Every tenant is a dmclock client of its own, enforcing its QoSInfo between
+ * the tenants that are sharing the gateway. As the same tenant is usually
+ * served by several gateways, its reservation and limit are scaled by this
+ * gateway's share of the tenant's requests, see set_shares().
+ */
+class AsyncTenantScheduler : public md_config_obs_t, public TenantScheduler {
+ public:
+  AsyncTenantScheduler(CephContext *cct, boost::asio::io_context& context);
+  ~AsyncTenantScheduler();
+
+  using executor_type = boost::asio::io_context::executor_type;
+
+  /// return the default executor for async_request() callbacks
+  executor_type get_executor() noexcept {
+    return timer.get_executor();
+  }
+
+  /// submit an async request for the tenant, as with
+  /// AsyncScheduler::async_request(). the tenant's ClientInfo is updated
+  /// whenever its QoSInfo changes
+  template <typename CompletionToken>
+  auto async_request(const std::string& tenant, const QoSInfo& qos,
+                     const client_id& client, const Time& time, Cost cost,
+                     CompletionToken&& token);
+
+  /// returns a throttle unit granted by async_request()
+  void request_complete() override;
+
+  /// cancel all queued requests, invoking their completion handlers with an
+  /// operation_aborted error and default-constructed result
+  void cancel();
+
+  /// return the requests/s of every tenant since the last call
+  std::map<std::string, double> collect_rates();
+
+  /// scale the reservation and limit of the given tenants by their share of
+  /// the requests across all gateways, in (0, 1]
+  void set_shares(const std::map<std::string, double>& shares);
+
+  const char** get_tracked_conf_keys() const override;
+  void handle_conf_change(const ConfigProxy& conf,
+                          const std::set<std::string>& changed) override;
+
+ private:
+  int schedule_request_impl(const std::string& tenant, const QoSInfo& qos,
+                            const client_id& client, const Time& time,
+                            const Cost& cost,
+                            optional_yield yield_ctx) override;
+
+  struct tenant_t {
+    QoSInfo qos;
+    double share = 1;
+    std::unique_ptr<ClientInfo> info; //< referenced by the queue
+    uint64_t requests = 0; //< since the last collect_rates()
+  };
+  ceph::mutex tenant_lock =
+    ceph::make_mutex("AsyncTenantScheduler::tenant_lock");
+  /// tenants are never removed, as the queue may still refer to their info.
+  /// only the buckets and users with a QoSInfo ever get here
+  std::map<std::string, tenant_t> tenants;
+  Time last_collect;
+
+  /// rebuild the tenant's ClientInfo, returning the previous one. that one
+  /// has to stay around until the queue is updated, see update_infos()
+  std::unique_ptr<ClientInfo> set_info(tenant_t& tenant);
+  void update_infos(std::vector<std::unique_ptr<ClientInfo>>&& retired);
+  const ClientInfo* get_info(const std::string& tenant);
+
+  static constexpr bool IsDelayed = false;
+  using Queue = crimson::dmclock::PullPriorityQueue<std::string, Request, IsDelayed>;
+  using RequestRef = typename Queue::RequestRef;
+  Queue queue; //< dmclock priority queue
+
+  using Signature = void(boost::system::error_code, PhaseType);
+  using Completion = async::Completion<Signature, async::AsBase<Request>>;
+
+  using Clock = ceph::coarse_real_clock;
+#if BOOST_VERSION < 107000
+  using Timer = boost::asio::basic_waitable_timer<Clock>;
+#else
+  using Timer = boost::asio::basic_waitable_timer<Clock,
+        boost::asio::wait_traits<Clock>, executor_type>;
+#endif
+  Timer timer; //< timer for the next scheduled request
+
+  CephContext *const cct;
+
+  /// max request throttle, so that the weights apply
+  std::atomic<int64_t> max_requests;
+  std::atomic<int64_t> outstanding_requests = 0;
+
+  /// set a timer to process the next request
+  void schedule(const Time& time);
+
+  /// process ready requests, then schedule the next pending request
+  void process(const Time& now);
+};
+
+template <typename CompletionToken>
+auto AsyncTenantScheduler::async_request(const std::string& tenant,
+                                         const QoSInfo& qos,
+                                         const client_id& client,
+                                         const Time& time, Cost cost,
+                                         CompletionToken&& token)
+{
+  boost::asio::async_completion<CompletionToken, Signature> init(token);
+
+  std::unique_ptr<ClientInfo> retired;
+  {
+    std::lock_guard l{tenant_lock};
+    auto& t = tenants[tenant];
+    t.requests++;
+    if (!t.info || t.qos != qos) {
+      t.qos = qos;
+      retired = set_info(t);
+    }
+  }
+  if (retired) {
+    std::vector<std::unique_ptr<ClientInfo>> v;
+    v.push_back(std::move(retired));
+    update_infos(std::move(v));
+  }
+
+  auto ex1 = get_executor();
+  auto& handler = init.completion_handler;
+
+  // allocate the Request and add it to the queue
+  auto completion = Completion::create(ex1, std::move(handler),
+                                       Request{client, time, cost});
+  // cast to unique_ptr<Request>
+  auto req = RequestRef{std::move(completion)};
+  int r = queue.add_request(std::move(req), tenant, ReqParams{}, time, cost);
+  if (r == 0) {
+    // schedule an immediate call to process() on the executor
+    schedule(crimson::dmclock::TimeZero);
+  } else {
+    // post the error code
+    boost::system::error_code ec(r, boost::system::system_category());
+    // cast back to Completion
+    auto completion = static_cast<Completion*>(req.release());
+    async::post(std::unique_ptr<Completion>{completion},
+                ec, PhaseType::priority);
+  }
+
+  return init.result.get();
+}
+
 class SimpleThrottler : public md_config_obs_t, public dmclock::Scheduler {
 public:
   SimpleThrottler(CephContext *cct) :
@@ -0,0 +1,188 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "rgw_dmclock_qos_exchange.h"
+
+#include "common/errno.h"
+#include "common/Thread.h"
+#include "rgw_rados.h"
+#include "rgw_tools.h"
+#include "rgw_zone.h"
+#include "services/svc_zone.h"
+
+#define dout_context cct
+#define dout_subsys ceph_subsys_rgw
+#undef dout_prefix
+#define dout_prefix *_dout << "dmclock qos exchange: "
+
+namespace rgw::dmclock {
+
+static const std::string qos_oid = "dmclock.qos";
+
+QoSExchange::QoSExchange(CephContext *cct, AsyncTenantScheduler *scheduler)
+  : cct(cct), scheduler(scheduler)
+{}
+
+QoSExchange::~QoSExchange()
+{
+  stop();
+}
+
+void QoSExchange::start(RGWRados *s)
+{
+  store = s;
+  stopping = false;
+  thread = make_named_thread("dmclock_qos", &QoSExchange::entry, this);
+}
+
+void QoSExchange::stop()
+{
+  if (!thread.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard l{lock};
+    stopping = true;
+    cond.notify_all();
+  }
+  thread.join();
+}
+
+void QoSExchange::entry()
+{
+  std::unique_lock l{lock};
+  while (!stopping) {
+    const auto interval = cct->_conf.get_val<int64_t>(
+      "rgw_dmclock_tenant_exchange_interval");
+    cond.wait_for(l, std::chrono::seconds(interval));
+    if (stopping) {
+      break;
+    }
+    l.unlock();
+    const auto rates = scheduler->collect_rates();
+    if (!rates.empty()) {
+      std::map<std::string, double> shares;
+      int r = exchange(rates, &shares);
+      if (r < 0) {
+        ldout(cct, 1) << "failed to exchange request rates: "
+                      << cpp_strerror(r) << dendl;
+      } else {
+        scheduler->set_shares(shares);
+      }
+    }
+    l.lock();
+  }
+}
+
+int QoSExchange::exchange(const std::map<std::string, double>& rates,
+                          std::map<std::string, double> *shares)
+{
+  using ceph::encode;
+  using ceph::decode;
+  librados::IoCtx ioctx;
+  int r = rgw_init_ioctx(store->get_rados_handle(),
+                         store->svc.zone->get_zone_params().log_pool,
+                         ioctx, true);
+  if (r < 0) {
+    return r;
+  }
+
+  // keys are <tenant>|<gateway>, as neither bucket names nor host ids
+  // contain a '|'
+  const std::string& gateway = store->host_id;
+  const auto now = ceph::real_clock::now();
+  std::map<std::string, bufferlist> mine;
+  for (const auto& [tenant, rate] : rates) {
+    if (rate <= 0) {
+      continue;
+    }
+    bufferlist bl;
+    encode(rate, bl);
+    encode(now, bl);
+    mine[tenant + "|" + gateway] = std::move(bl);
+  }
+  if (!mine.empty()) {
+    librados::ObjectWriteOperation op;
+    op.omap_set(mine);
+    r = rgw_rados_operate(ioctx, qos_oid, &op, null_yield);
+    if (r < 0) {
+      return r;
+    }
+  }
+
+  const auto interval = ceph::make_timespan(
+    cct->_conf.get_val<int64_t>("rgw_dmclock_tenant_exchange_interval"));
+  std::map<std::string, double> others; //< the rate on the other gateways
+  std::map<std::string, unsigned> peers; //< the other gateways serving it
+  std::set<std::string> expired;
+  std::string marker;
+  bool more = true;
+  while (more) {
+    std::map<std::string, bufferlist> vals;
+    librados::ObjectReadOperation op;
+    op.omap_get_vals2(marker, 1000, &vals, &more, nullptr);
+    r = rgw_rados_operate(ioctx, qos_oid, &op, nullptr, null_yield);
+    if (r < 0) {
+      return r;
+    }
+    if (vals.empty()) {
+      break;
+    }
+    marker = vals.rbegin()->first;
+    for (auto& [key, bl] : vals) {
+      auto pos = key.rfind('|');
+      if (pos == std::string::npos) {
+        expired.insert(key);
+        continue;
+      }
+      double rate;
+      ceph::real_time stamp;
+      try {
+        auto p = bl.cbegin();
+        decode(rate, p);
+        decode(stamp, p);
+      } catch (buffer::error&) {
+        expired.insert(key);
+        continue;
+      }
+      if (now - stamp > interval * 10) {
+        expired.insert(key);
+        continue;
+      }
+      if (now - stamp > interval * 3 ||
+          key.compare(pos + 1, std::string::npos, gateway) == 0) {
+        continue;
+      }
+      std::string tenant = key.substr(0, pos);
+      if (rates.count(tenant)) {
+        others[tenant] += rate;
+        peers[tenant]++;
+      }
+    }
+  }
+  if (!expired.empty()) {
+    librados::ObjectWriteOperation op;
+    op.omap_rm_keys(expired);
+    r = rgw_rados_operate(ioctx, qos_oid, &op, null_yield);
+    if (r < 0) {
+      ldout(cct, 5) << "failed to remove expired rates: " << cpp_strerror(r)
+                    << dendl;
+    }
+  }
+
+  for (const auto& [tenant, rate] : rates) {
+    double share = 1;
+    if (rate > 0) {
+      share = rate / (rate + others[tenant]);
+    } else if (peers[tenant] > 0) {
+      // idle here, leave room for the requests to come
+      share = 1.0 / (peers[tenant] + 1);
+    }
+    ldout(cct, 20) << tenant << " rate=" << rate << " others="
+                   << others[tenant] << " share=" << share << dendl;
+    (*shares)[tenant] = share;
+  }
+  return 0;
+}
+
+} // namespace rgw::dmclock
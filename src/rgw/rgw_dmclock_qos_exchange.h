@@ -0,0 +1,53 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef RGW_DMCLOCK_QOS_EXCHANGE_H
+#define RGW_DMCLOCK_QOS_EXCHANGE_H
+
+#include <map>
+#include <string>
+#include <thread>
+
+#include "common/ceph_mutex.h"
+#include "rgw_dmclock_async_scheduler.h"
+
+class RGWRados;
+
+namespace rgw::dmclock {
+
+/*
+ * Shares the request rates of the tenants between the gateways of a zone.
+ *
+ * Every rgw_dmclock_tenant_exchange_interval seconds, each gateway writes
+ * the per tenant request rates of its AsyncTenantScheduler to the omap of
+ * a shared object in the zone's log pool, reads back those of the other
+ * gateways, and gives each tenant the share of its QoSInfo that matches
+ * this gateway's share of the tenant's requests. Rates not refreshed for
+ * three intervals are ignored, and removed after ten.
+ */
+class QoSExchange {
+  CephContext *const cct;
+  AsyncTenantScheduler *const scheduler;
+  RGWRados *store = nullptr;
+
+  ceph::mutex lock = ceph::make_mutex("QoSExchange::lock");
+  ceph::condition_variable cond;
+  bool stopping = false;
+  std::thread thread;
+
+  void entry();
+  /// publish our rates, then compute the shares from those of all gateways
+  int exchange(const std::map<std::string, double>& rates,
+               std::map<std::string, double> *shares);
+
+ public:
+  QoSExchange(CephContext *cct, AsyncTenantScheduler *scheduler);
+  ~QoSExchange();
+
+  void start(RGWRados *store);
+  void stop();
+};
+
+} // namespace rgw::dmclock
+
+#endif // RGW_DMCLOCK_QOS_EXCHANGE_H
@@ -84,6 +84,30 @@ private:
 				    optional_yield) = 0;
 };
 
+/// schedules requests of the buckets and users that have their own QoSInfo,
+/// on top of the per client_id Scheduler. the tenant is an opaque key, e.g.
+/// "bucket:<name>" or "user:<id>"
+class TenantScheduler {
+public:
+  auto schedule_request(const std::string& tenant, const QoSInfo& qos,
+			const client_id& client, const Time& time,
+			const Cost& cost, optional_yield yield)
+  {
+    int r = schedule_request_impl(tenant, qos, client, time, cost, yield);
+    if (r < 0) {
+      return std::make_pair(r, SchedulerCompleter{});
+    }
+    return std::make_pair(r,SchedulerCompleter(std::bind(&TenantScheduler::request_complete,this)));
+  }
+  virtual void request_complete() {};
+
+  virtual ~TenantScheduler() {};
+private:
+  virtual int schedule_request_impl(const std::string&, const QoSInfo&,
+				    const client_id&, const Time&,
+				    const Cost&, optional_yield) = 0;
+};
+
 } // namespace rgw::dmclock
 
 #endif // RGW_DMCLOCK_SCHEDULER_H
@@ -125,6 +125,24 @@ namespace rgw {
 
     std::string obj_path = parent->format_child_name(path, false);
 
+    if (type != RGW_FS_TYPE_DIRECTORY &&
+	cct->_conf.get_val<uint64_t>("rgw_nfs_readdir_attr_ttl") > 0) {
+      /* listed by a recent readdir? */
+      fhr = lookup_fh(parent->make_fhk(path));
+      RGWFileHandle* rgw_fh = get<0>(fhr);
+      if (rgw_fh) {
+	if (rgw_fh->is_file() && rgw_fh->listed()) {
+	  return fhr;
+	}
+	unref(rgw_fh);
+	get<0>(fhr) = nullptr;
+      }
+    }
+
+    if (is_missing(parent, path)) {
+      return fhr;
+    }
+
     for (auto ix : { 0, 1, 2 }) {
       switch (ix) {
       case 0:
@@ -240,9 +258,74 @@ namespace rgw {
       }
     }
   done:
+    if (! get<0>(fhr)) {
+      set_missing(parent, path);
+    }
     return fhr;
   } /* RGWLibFS::stat_leaf */
 
+  static std::string missing_key(RGWFileHandle* parent, const char *name)
+  {
+    return parent->bucket_name() + "/" + parent->format_child_name(name, false);
+  }
+
+  bool RGWLibFS::is_missing(RGWFileHandle* parent, const char *name)
+  {
+    if (cct->_conf.get_val<uint64_t>("rgw_nfs_negative_cache_ttl") == 0)
+      return false;
+    ceph::coarse_mono_time until;
+    if (! negative_cache.find(missing_key(parent, name), until))
+      return false;
+    return ceph::coarse_mono_clock::now() < until;
+  }
+
+  void RGWLibFS::set_missing(RGWFileHandle* parent, const char *name)
+  {
+    const auto ttl = cct->_conf.get_val<uint64_t>("rgw_nfs_negative_cache_ttl");
+    if (ttl == 0)
+      return;
+    auto until = ceph::coarse_mono_clock::now() + std::chrono::seconds(ttl);
+    negative_cache.add(missing_key(parent, name), until);
+  }
+
+  void RGWLibFS::forget_missing(RGWFileHandle* parent, const char *name)
+  {
+    if (cct->_conf.get_val<uint64_t>("rgw_nfs_negative_cache_ttl") == 0)
+      return;
+    negative_cache.erase(missing_key(parent, name));
+  }
+
+  void RGWLibFS::cache_listed_attrs(RGWFileHandle* parent,
+				    const std::string& name,
+				    const rgw_bucket_dir_entry_meta& meta)
+  {
+    using std::get;
+
+    const auto ttl = cct->_conf.get_val<uint64_t>("rgw_nfs_readdir_attr_ttl");
+    LookupFHResult fhr = lookup_fh(parent, name.c_str(),
+				   RGWFileHandle::FLAG_CREATE);
+    RGWFileHandle* rgw_fh = get<0>(fhr);
+    if (! rgw_fh)
+      return;
+    {
+      lock_guard guard(rgw_fh->mtx);
+      if (rgw_fh->is_file()) {
+	rgw_fh->set_size(meta.accounted_size);
+	if (get<1>(fhr) & RGWFileHandle::FLAG_CREATE) {
+	  rgw_fh->set_times(meta.mtime);
+	} else {
+	  rgw_fh->set_mtime(real_clock::to_timespec(meta.mtime));
+	}
+	buffer::list etag;
+	etag.append(meta.etag.c_str(), meta.etag.size() + 1);
+	rgw_fh->set_etag(etag);
+	rgw_fh->set_listed(ceph::coarse_mono_clock::now() +
+			   std::chrono::seconds(ttl));
+      }
+    }
+    unref(rgw_fh);
+  } /* RGWLibFS::cache_listed_attrs */
+
   int RGWLibFS::read(RGWFileHandle* rgw_fh, uint64_t offset, size_t length,
 		     size_t* bytes_read, void* buffer, uint32_t flags)
   {
@@ -1532,7 +1615,7 @@ namespace rgw {
     }
 
     op_ret = get_store()->check_quota(s->bucket_owner.get_id(), s->bucket,
-                                      user_quota, bucket_quota, real_ofs, true);
+                                      user_quota, bucket_quota, real_ofs, null_yield, true);
     /* max_size exceed */
     if (op_ret < 0)
       return -EIO;
@@ -1575,7 +1658,7 @@ namespace rgw {
     }
 
     op_ret = get_store()->check_quota(s->bucket_owner.get_id(), s->bucket,
-				      user_quota, bucket_quota, s->obj_size, true);
+				      user_quota, bucket_quota, s->obj_size, null_yield, true);
     /* max_size exceed */
     if (op_ret < 0) {
       goto done;
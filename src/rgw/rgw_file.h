@@ -29,6 +29,7 @@
 #include "include/buffer.h"
 #include "common/cohort_lru.h"
 #include "common/ceph_timer.h"
+#include "common/lru_map.h"
 #include "rgw_common.h"
 #include "rgw_user.h"
 #include "rgw_lib.h"
@@ -256,6 +257,10 @@ namespace rgw {
     ceph::buffer::list etag;
     ceph::buffer::list acls;
 
+    /* size, mtime and etag came from a bucket listing, and do for a stat
+     * until then */
+    ceph::coarse_mono_time listed_until;
+
   public:
     const static std::string root_name;
 
@@ -670,6 +675,14 @@ namespace rgw {
       acls = _acls;
     }
 
+    void set_listed(ceph::coarse_mono_time until) {
+      listed_until = until;
+    }
+
+    bool listed() const {
+      return ceph::coarse_mono_clock::now() < listed_until;
+    }
+
     void encode(buffer::list& bl) const {
       ENCODE_START(2, 1, bl);
       encode(uint32_t(fh.fh_type), bl);
@@ -842,6 +855,9 @@ namespace rgw {
 
     RGWFileHandle::FHCache fh_cache;
     RGWFileHandle::FhLRU fh_lru;
+
+    /* object paths recently found not to exist, until when */
+    lru_map<std::string, ceph::coarse_mono_time> negative_cache;
     
     std::string uid; // should match user.user_id, iiuc
 
@@ -926,6 +942,7 @@ namespace rgw {
 		 cct->_conf->rgw_nfs_fhcache_size),
 	fh_lru(cct->_conf->rgw_nfs_lru_lanes,
 	       cct->_conf->rgw_nfs_lru_lane_hiwat),
+	negative_cache(cct->_conf.get_val<uint64_t>("rgw_nfs_negative_cache_size")),
 	uid(_uid), key(_user_id, _key) {
 
       if (!root || !strcmp(root, "/")) {
@@ -974,7 +991,7 @@ namespace rgw {
     }
 
     int authorize(RGWRados* store) {
-      int ret = rgw_get_user_info_by_access_key(store, key.id, user);
+      int ret = rgw_get_user_info_by_access_key(store, key.id, user, null_yield);
       if (ret == 0) {
 	RGWAccessKey* k = user.get_key(key.id);
 	if (!k || (k->key != key.key))
@@ -993,7 +1010,7 @@ namespace rgw {
 	}
 	if (token.valid() && (ldh->auth(token.id, token.key) == 0)) {
 	  /* try to store user if it doesn't already exist */
-	  if (rgw_get_user_info_by_uid(store, token.id, user) < 0) {
+	  if (rgw_get_user_info_by_uid(store, token.id, user, null_yield) < 0) {
 	    int ret = rgw_store_user_info(store, user, NULL, NULL, real_time(),
 					  true);
 	    if (ret < 0) {
@@ -1077,6 +1094,10 @@ namespace rgw {
       std::string key_name{parent->make_key_name(name)};
       fh_key fhk = parent->make_fhk(obj_name);
 
+      if (flags & RGWFileHandle::FLAG_CREATE) {
+	forget_missing(parent, name);
+      }
+
       lsubdout(get_context(), rgw, 10)
 	<< __func__ << " lookup called on "
 	<< parent->object_name() << " for " << key_name
@@ -1157,6 +1178,16 @@ namespace rgw {
       return fhr;
     } /*  lookup_fh(RGWFileHandle*, const char *, const uint32_t) */
 
+    /* negative lookup cache, see rgw_nfs_negative_cache_ttl */
+    bool is_missing(RGWFileHandle* parent, const char *name);
+    void set_missing(RGWFileHandle* parent, const char *name);
+    void forget_missing(RGWFileHandle* parent, const char *name);
+
+    /* readdirplus: stand-in stat of a listed object, see
+     * rgw_nfs_readdir_attr_ttl */
+    void cache_listed_attrs(RGWFileHandle* parent, const std::string& name,
+			    const rgw_bucket_dir_entry_meta& meta);
+
     inline void unref(RGWFileHandle* fh) {
       if (likely(! fh->is_mount())) {
 	(void) fh_lru.unref(fh, cohort::lru::FLAG_NONE);
@@ -1272,7 +1303,7 @@ namespace rgw {
 
     void update_user() {
       RGWUserInfo _user = user;
-      int ret = rgw_get_user_info_by_access_key(rgwlib.get_store(), key.id, user);
+      int ret = rgw_get_user_info_by_access_key(rgwlib.get_store(), key.id, user, null_yield);
       if (ret != 0)
         user = _user;
     }
@@ -1553,6 +1584,11 @@ public:
 			     << " (" << sref << ")" << ""
 			     << dendl;
 
+      if (cct->_conf.get_val<uint64_t>("rgw_nfs_readdir_attr_ttl") > 0) {
+	rgw_fh->get_fs()->cache_listed_attrs(rgw_fh, sref.to_string(),
+					     iter.meta);
+      }
+
       if(! this->operator()(sref, next_marker, RGW_FS_TYPE_FILE)) {
 	/* caller cannot accept more */
 	lsubdout(cct, rgw, 5) << "readdir rcb failed"
@@ -9,7 +9,10 @@
 #include "cls/lock/cls_lock_client.h"
 #include "include/random.h"
 
+#include <boost/algorithm/string/predicate.hpp>
+
 #include <list>
+#include <set>
 #include <sstream>
 
 #define dout_context g_ceph_context
@@ -19,6 +22,8 @@ using namespace librados;
 
 static string gc_oid_prefix = "gc";
 static string gc_index_lock_name = "gc_process";
+/* prefix of the list markers pointing into the queue of a shard */
+static string gc_queue_marker_prefix = "q:";
 
 
 void RGWGC::initialize(CephContext *_cct, RGWRados *_store) {
@@ -35,6 +40,26 @@ void RGWGC::initialize(CephContext *_cct, RGWRados *_store) {
     snprintf(buf, 32, ".%d", i);
     obj_names[i].append(buf);
   }
+
+  use_queue = true;
+  const uint64_t queue_size = cct->_conf.get_val<Option::size_t>("rgw_gc_max_queue_size");
+  for (int i = 0; i < max_objs; i++) {
+    ObjectWriteOperation op;
+    cls_rgw_gc_queue_init(op, queue_size);
+    int ret = store->gc_operate(obj_names[i], &op);
+    if (ret == -EOPNOTSUPP) {
+      ldpp_dout(this, 0) << "WARNING: the OSDs do not support the gc queue, "
+        "keeping the gc chains in omap" << dendl;
+      use_queue = false;
+      break;
+    }
+    if (ret < 0) {
+      ldpp_dout(this, 0) << "WARNING: failed to initialize the gc queue on "
+        << obj_names[i] << ", ret=" << ret << dendl;
+      use_queue = false;
+      break;
+    }
+  }
 }
 
 void RGWGC::finalize()
@@ -53,7 +78,12 @@ void RGWGC::add_chain(ObjectWriteOperation& op, cls_rgw_obj_chain& chain, const
   info.chain = chain;
   info.tag = tag;
 
-  cls_rgw_gc_set_entry(op, cct->_conf->rgw_gc_obj_min_wait, info);
+  if (use_queue) {
+    /* a full queue falls back to the omap index, see cls_rgw */
+    cls_rgw_gc_queue_enqueue(op, cct->_conf->rgw_gc_obj_min_wait, info);
+  } else {
+    cls_rgw_gc_set_entry(op, cct->_conf->rgw_gc_obj_min_wait, info);
+  }
 }
 
 int RGWGC::send_chain(cls_rgw_obj_chain& chain, const string& tag, bool sync)
@@ -72,7 +102,12 @@ int RGWGC::send_chain(cls_rgw_obj_chain& chain, const string& tag, bool sync)
 int RGWGC::defer_chain(const string& tag, bool sync)
 {
   ObjectWriteOperation op;
-  cls_rgw_gc_defer_entry(op, cct->_conf->rgw_gc_obj_min_wait, tag);
+  if (use_queue) {
+    /* also covers the chains in the omap index */
+    cls_rgw_gc_queue_defer_entry(op, cct->_conf->rgw_gc_obj_min_wait, tag);
+  } else {
+    cls_rgw_gc_defer_entry(op, cct->_conf->rgw_gc_obj_min_wait, tag);
+  }
 
   int i = tag_index(tag);
 
@@ -89,6 +124,41 @@ int RGWGC::remove(int index, const std::vector<string>& tags, AioCompletion **pc
   return store->gc_aio_operate(obj_names[index], &op, pc);
 }
 
+/* each shard lists its omap index, followed by its queue */
+int RGWGC::list_shard(int index, string& marker, uint32_t max, bool expired_only,
+                      std::list<cls_rgw_gc_obj_info>& entries, bool *truncated,
+                      string& next_marker)
+{
+  string queue_marker;
+  if (boost::algorithm::starts_with(marker, gc_queue_marker_prefix)) {
+    queue_marker = marker.substr(gc_queue_marker_prefix.size());
+  } else {
+    int ret = cls_rgw_gc_list(store->gc_pool_ctx, obj_names[index], marker, max, expired_only, entries, truncated, next_marker);
+    if (!use_queue || ret < 0 || *truncated) {
+      return ret;
+    }
+    if (entries.size() >= max) {
+      *truncated = true;
+      next_marker = gc_queue_marker_prefix;
+      return 0;
+    }
+    max -= entries.size();
+  }
+
+  std::list<cls_rgw_gc_obj_info> queued;
+  int ret = cls_rgw_gc_queue_list(store->gc_pool_ctx, obj_names[index], queue_marker, max, expired_only, queued, truncated, next_marker);
+  if (ret == -ENOENT) {
+    *truncated = false;
+    return 0;
+  }
+  if (ret < 0) {
+    return ret;
+  }
+  next_marker = gc_queue_marker_prefix + next_marker;
+  entries.splice(entries.end(), queued);
+  return 0;
+}
+
 int RGWGC::list(int *index, string& marker, uint32_t max, bool expired_only, std::list<cls_rgw_gc_obj_info>& result, bool *truncated)
 {
   result.clear();
@@ -96,7 +166,7 @@ int RGWGC::list(int *index, string& marker, uint32_t max, bool expired_only, std
 
   for (; *index < max_objs && result.size() < max; (*index)++, marker.clear()) {
     std::list<cls_rgw_gc_obj_info> entries;
-    int ret = cls_rgw_gc_list(store->gc_pool_ctx, obj_names[*index], marker, max - result.size(), expired_only, entries, truncated, next_marker);
+    int ret = list_shard(*index, marker, max - result.size(), expired_only, entries, truncated, next_marker);
     if (ret == -ENOENT)
       continue;
     if (ret < 0)
@@ -139,6 +209,7 @@ class RGWGCIOManager {
       UnknownIO = 0,
       TailIO = 1,
       IndexIO = 2,
+      QueueTailIO = 3,
     } type{UnknownIO};
     librados::AioCompletion *c{nullptr};
     string oid;
@@ -148,6 +219,9 @@ class RGWGCIOManager {
 
   deque<IO> ios;
   vector<std::vector<string> > remove_tags;
+  /* the queued chains are removed from their shard as a whole, keep track
+   * of the ones that need another attempt instead */
+  std::set<string> failed_queue_tags;
 
 #define MAX_AIO_DEFAULT 10
   size_t max_aio{MAX_AIO_DEFAULT};
@@ -167,7 +241,7 @@ public:
   }
 
   int schedule_io(IoCtx *ioctx, const string& oid, ObjectWriteOperation *op,
-		  int index, const string& tag) {
+		  int index, const string& tag, bool queued = false) {
     while (ios.size() > max_aio) {
       if (gc->going_down()) {
         return 0;
@@ -180,7 +254,7 @@ public:
     if (ret < 0) {
       return ret;
     }
-    ios.push_back(IO{IO::TailIO, c, oid, index, tag});
+    ios.push_back(IO{queued ? IO::QueueTailIO : IO::TailIO, c, oid, index, tag});
 
     return 0;
   }
@@ -207,6 +281,13 @@ public:
     if (ret < 0) {
       ldpp_dout(dpp, 0) << "WARNING: gc could not remove oid=" << io.oid <<
 	", ret=" << ret << dendl;
+      if (io.type == IO::QueueTailIO) {
+        failed_queue_tags.insert(io.tag);
+      }
+      goto done;
+    }
+
+    if (io.type == IO::QueueTailIO) {
       goto done;
     }
 
@@ -230,6 +311,10 @@ public:
     }
   }
 
+  std::set<string>& get_failed_queue_tags() {
+    return failed_queue_tags;
+  }
+
   void drain_ios() {
     while (!ios.empty()) {
       if (gc->going_down()) {
@@ -392,6 +477,14 @@ int RGWGC::process(int index, int max_secs, bool expired_only,
     } // entries loop
   } while (truncated);
 
+  if (use_queue) {
+    ret = process_queue(index, end, expired_only, io_manager);
+    if (ret < 0) {
+      ldpp_dout(this, 0) << "WARNING: failed to process the gc queue of " <<
+        obj_names[index] << ", ret=" << ret << dendl;
+    }
+  }
+
 done:
   /* we don't drain here, because if we're going down we don't want to
    * hold the system if backend is unresponsive
@@ -402,6 +495,122 @@ done:
   return 0;
 }
 
+int RGWGC::process_queue(int index, utime_t end, bool expired_only,
+                         RGWGCIOManager& io_manager)
+{
+  const uint32_t max = cct->_conf.get_val<uint64_t>("rgw_gc_queue_batch_size");
+  string marker;
+  bool truncated;
+  do {
+    std::list<cls_rgw_gc_obj_info> entries;
+    string next_marker;
+    int ret = cls_rgw_gc_queue_list(store->gc_pool_ctx, obj_names[index], marker,
+                                    max, expired_only, entries, &truncated,
+                                    next_marker);
+    ldpp_dout(this, 20) <<
+      "RGWGC::process_queue cls_rgw_gc_queue_list returned with returned:" <<
+      ret << ", entries.size=" << entries.size() << ", truncated=" <<
+      truncated << ", next_marker='" << next_marker << "'" << dendl;
+    if (ret == -ENOENT) {
+      return 0;
+    }
+    if (ret < 0) {
+      return ret;
+    }
+    if (entries.empty()) {
+      return 0;
+    }
+
+    /* delete the tails of the whole batch at once */
+    const real_time now = real_clock::now();
+    std::list<cls_rgw_gc_obj_info> requeue;
+    IoCtx ctx;
+    string last_pool;
+    for (auto& info : entries) {
+      if (expired_only && info.time > now) {
+        /* deferred since it was queued */
+        requeue.push_back(std::move(info));
+        continue;
+      }
+      for (auto& obj : info.chain.objs) {
+        if (obj.pool != last_pool) {
+          ctx.close();
+          ret = rgw_init_ioctx(store->get_rados_handle(), obj.pool, ctx);
+          if (ret < 0) {
+            last_pool = "";
+            ldpp_dout(this, 0) << "ERROR: failed to create ioctx pool=" <<
+              obj.pool << dendl;
+            io_manager.get_failed_queue_tags().insert(info.tag);
+            continue;
+          }
+          last_pool = obj.pool;
+        }
+
+        ctx.locator_set_key(obj.loc);
+
+        const string& oid = obj.key.name; /* just stored raw oid there */
+
+        ldpp_dout(this, 5) << "RGWGC::process_queue removing " << obj.pool <<
+          ":" << obj.key.name << dendl;
+        ObjectWriteOperation op;
+        cls_refcount_put(op, info.tag, true);
+
+        ret = io_manager.schedule_io(&ctx, oid, &op, index, info.tag, true);
+        if (ret < 0) {
+          ldpp_dout(this, 0) <<
+            "WARNING: failed to schedule deletion for oid=" << oid << dendl;
+          io_manager.get_failed_queue_tags().insert(info.tag);
+        }
+        if (going_down()) {
+          /* the batch stays queued */
+          return 0;
+        }
+      }
+    }
+    io_manager.drain_ios();
+    if (going_down()) {
+      return 0;
+    }
+
+    /* queue what needs another round again before removing the batch, the
+     * tails are reference counted by tag so deleting them twice is harmless */
+    auto& failed = io_manager.get_failed_queue_tags();
+    for (auto& info : entries) {
+      if (failed.count(info.tag)) {
+        info.time = now + make_timespan(cct->_conf->rgw_gc_processor_period);
+        requeue.push_back(std::move(info));
+      }
+    }
+    failed.clear();
+    for (auto& info : requeue) {
+      ObjectWriteOperation op;
+      uint32_t secs = 0;
+      if (info.time > now) {
+        secs = std::chrono::ceil<std::chrono::seconds>(info.time - now).count();
+      }
+      cls_rgw_gc_queue_enqueue(op, secs, info);
+      ret = store->gc_operate(obj_names[index], &op);
+      if (ret < 0) {
+        ldpp_dout(this, 0) << "ERROR: failed to requeue gc tag=" << info.tag <<
+          " on " << obj_names[index] << ", ret=" << ret << dendl;
+        return ret;
+      }
+    }
+
+    ObjectWriteOperation op;
+    cls_rgw_gc_queue_remove(op, next_marker);
+    ret = store->gc_operate(obj_names[index], &op);
+    if (ret < 0) {
+      ldpp_dout(this, 0) << "ERROR: failed to remove entries from the gc queue of " <<
+        obj_names[index] << ", ret=" << ret << dendl;
+      return ret;
+    }
+    marker = next_marker;
+  } while (truncated && ceph_clock_now() < end);
+
+  return 0;
+}
+
 int RGWGC::process(bool expired_only)
 {
   int max_secs = cct->_conf->rgw_gc_processor_max_time;
@@ -24,8 +24,16 @@ class RGWGC : public DoutPrefixProvider {
   int max_objs;
   string *obj_names;
   std::atomic<bool> down_flag = { false };
+  /// the chains go to the queue in the data of the gc objects, rather than
+  /// to their omap index
+  bool use_queue = false;
 
   int tag_index(const string& tag);
+  int list_shard(int index, string& marker, uint32_t max, bool expired_only,
+                 std::list<cls_rgw_gc_obj_info>& entries, bool *truncated,
+                 string& next_marker);
+  int process_queue(int index, utime_t end, bool expired_only,
+                    RGWGCIOManager& io_manager);
 
   class GCWorker : public Thread {
     const DoutPrefixProvider *dpp;
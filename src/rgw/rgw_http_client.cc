@@ -20,6 +20,7 @@
 #include "rgw_tools.h"
 
 #include <atomic>
+#include <mutex>
 
 #define dout_context g_ceph_context
 #define dout_subsys ceph_subsys_rgw
@@ -273,16 +274,69 @@ static void do_curl_easy_cleanup(RGWCurlHandle *curl_handle)
 // XXX make this part of the token cache?  (but that's swift-only;
 //	and this especially needs to integrates with s3...)
 
+/*
+ * the DNS and TLS session caches are shared by all the easy handles, so
+ * that a request on a new connection, e.g. of a short-lived manager, can
+ * resume a session rather than do a full handshake. the connections
+ * themselves stay with the multi handle of each RGWHTTPManager, as libcurl
+ * does not support sharing them between threads
+ */
+static CURLSH *curl_share;
+static std::mutex curl_share_locks[CURL_LOCK_DATA_LAST];
+
+static void curl_share_lock(CURL *handle, curl_lock_data data,
+                            curl_lock_access access, void *userptr)
+{
+  curl_share_locks[data].lock();
+}
+
+static void curl_share_unlock(CURL *handle, curl_lock_data data,
+                              void *userptr)
+{
+  curl_share_locks[data].unlock();
+}
+
+static void rgw_setup_curl_share(CephContext *cct)
+{
+  if (!cct->_conf.get_val<bool>("rgw_http_client_share_sessions")) {
+    return;
+  }
+  curl_share = curl_share_init();
+  if (!curl_share) {
+    ldout(cct, 0) << "WARNING: curl_share_init() failed, not sharing sessions" << dendl;
+    return;
+  }
+  curl_share_setopt(curl_share, CURLSHOPT_LOCKFUNC, curl_share_lock);
+  curl_share_setopt(curl_share, CURLSHOPT_UNLOCKFUNC, curl_share_unlock);
+  curl_share_setopt(curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+}
+
+// only once every easy handle that may reference the share is gone
+static void rgw_cleanup_curl_share()
+{
+  if (curl_share) {
+    CURLSHcode r = curl_share_cleanup(curl_share);
+    if (r != CURLSHE_OK) {
+      dout(0) << "ERROR: curl_share_cleanup() failed: "
+              << curl_share_strerror(r) << dendl;
+    }
+    curl_share = nullptr;
+  }
+}
+
 void rgw_setup_saved_curl_handles()
 {
   handles = new RGWCurlHandles();
   handles->create("rgw_curl");
+  rgw_setup_curl_share(g_ceph_context);
 }
 
 void rgw_release_all_curl_handles()
 {
   handles->flush_curl_handles();
   delete handles;
+  rgw_cleanup_curl_share();
 }
 
 void RGWIOProvider::assign_io(RGWIOIDProvider& io_id_provider, int io_type)
@@ -548,6 +602,10 @@ int RGWHTTPClient::init_request(rgw_http_req_data *_req_data)
     dout(20) << "ssl verification is set to off" << dendl;
   }
   curl_easy_setopt(easy_handle, CURLOPT_PRIVATE, (void *)req_data);
+  curl_easy_setopt(easy_handle, CURLOPT_TCP_KEEPALIVE, 1L);
+  if (curl_share) {
+    curl_easy_setopt(easy_handle, CURLOPT_SHARE, curl_share);
+  }
 
   return 0;
 }
@@ -806,6 +864,24 @@ RGWHTTPManager::RGWHTTPManager(CephContext *_cct, RGWCompletionManager *_cm) : c
   multi_handle = (void *)curl_multi_init();
   thread_pipe[0] = -1;
   thread_pipe[1] = -1;
+
+  if (multi_handle) {
+    /* idle connections kept for reuse, rather than 4 times the number of
+     * requests in flight */
+    const auto max_idle = cct->_conf.get_val<uint64_t>("rgw_http_client_max_idle_connections");
+    curl_multi_setopt((CURLM *)multi_handle, CURLMOPT_MAXCONNECTS, (long)max_idle);
+    const auto max_host = cct->_conf.get_val<uint64_t>("rgw_http_client_max_host_connections");
+    if (max_host > 0) {
+      curl_multi_setopt((CURLM *)multi_handle, CURLMOPT_MAX_HOST_CONNECTIONS, (long)max_host);
+    }
+#if LIBCURL_VERSION_NUM >= 0x072f00 /* 7.47.0 */
+    /* managers driven by coroutines carry the multisite sync requests */
+    if (completion_mgr && cct->_conf.get_val<bool>("rgw_sync_http2")) {
+      multiplex = true;
+      curl_multi_setopt((CURLM *)multi_handle, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    }
+#endif
+  }
 }
 
 RGWHTTPManager::~RGWHTTPManager() {
@@ -882,6 +958,14 @@ void RGWHTTPManager::_set_req_state(set_state& ss)
 int RGWHTTPManager::link_request(rgw_http_req_data *req_data)
 {
   ldout(cct, 20) << __func__ << " req_data=" << req_data << " req_data->id=" << req_data->id << ", curl_handle=" << req_data->curl_handle << dendl;
+#if LIBCURL_VERSION_NUM >= 0x072f00 /* 7.47.0 */
+  if (multiplex) {
+    CURL *easy_handle = req_data->get_easy_handle();
+    curl_easy_setopt(easy_handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+    /* wait for a connection that can multiplex rather than open another */
+    curl_easy_setopt(easy_handle, CURLOPT_PIPEWAIT, 1L);
+  }
+#endif
   CURLMcode mstatus = curl_multi_add_handle((CURLM *)multi_handle, req_data->get_easy_handle());
   if (mstatus) {
     dout(0) << "ERROR: failed on curl_multi_add_handle, status=" << mstatus << dendl;
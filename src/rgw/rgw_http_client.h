@@ -317,6 +317,7 @@ class RGWHTTPManager {
   int64_t num_reqs;
   int64_t max_threaded_req;
   int thread_pipe[2];
+  bool multiplex{false}; /* requests go over HTTP/2 where the peer has it */
 
   void register_request(rgw_http_req_data *req_data);
   void complete_request(rgw_http_req_data *req_data);
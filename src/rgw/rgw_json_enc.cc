@@ -275,6 +275,8 @@ void RGWCacheNotifyInfo::dump(Formatter *f) const
   encode_json("obj_info", obj_info, f);
   encode_json("ofs", ofs, f);
   encode_json("ns", ns, f);
+  encode_json("data_objs", data_objs, f);
+  encode_json("objs", objs, f);
 }
 
 void RGWAccessKey::dump(Formatter *f) const
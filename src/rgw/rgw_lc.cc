@@ -4,6 +4,7 @@
 #include <string.h>
 #include <iostream>
 #include <map>
+#include <thread>
 
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string.hpp>
@@ -179,6 +180,36 @@ bool RGWLifecycleConfiguration::valid()
   return true;
 }
 
+static int lc_secs_to_next_start(CephContext *cct, utime_t& start, utime_t& now)
+{
+  int secs;
+
+  if (cct->_conf->rgw_lc_debug_interval > 0) {
+	secs = start + cct->_conf->rgw_lc_debug_interval - now;
+	if (secs < 0)
+	  secs = 0;
+	return (secs);
+  }
+
+  int start_hour;
+  int start_minute;
+  int end_hour;
+  int end_minute;
+  string worktime = cct->_conf->rgw_lifecycle_work_time;
+  sscanf(worktime.c_str(),"%d:%d-%d:%d",&start_hour, &start_minute, &end_hour, &end_minute);
+  struct tm bdt;
+  time_t tt = now.sec();
+  time_t nt;
+  localtime_r(&tt, &bdt);
+  bdt.tm_hour = start_hour;
+  bdt.tm_min = start_minute;
+  bdt.tm_sec = 0;
+  nt = mktime(&bdt);
+  secs = nt - tt;
+
+  return secs>0 ? secs : secs+24*60*60;
+}
+
 void *RGWLC::LCWorker::entry() {
   do {
     utime_t start = ceph_clock_now();
@@ -434,6 +465,10 @@ public:
     list_op.params.prefix = prefix;
   }
 
+  void set_shard_id(int shard_id) {
+    target.set_shard_id(shard_id);
+  }
+
   int init() {
     return fetch();
   }
@@ -936,7 +971,145 @@ int LCOpRule::process(rgw_bucket_dir_entry& o, const DoutPrefixProvider *dpp)
 
 }
 
-int RGWLC::bucket_lc_process(string& shard_id)
+int RGWLC::bucket_lc_process_shard(RGWBucketInfo& bucket_info,
+				   multimap<string, lc_op>& prefix_map,
+				   int shard_id)
+{
+  int ret;
+  for(auto prefix_iter = prefix_map.begin(); prefix_iter != prefix_map.end(); ++prefix_iter) {
+    auto& op = prefix_iter->second;
+    if (!is_valid_op(op)) {
+      continue;
+    }
+    ldpp_dout(this, 20) << __func__ << "(): prefix=" << prefix_iter->first <<
+      " shard_id=" << shard_id << dendl;
+
+    LCObjsLister ol(store, bucket_info);
+    ol.set_prefix(prefix_iter->first);
+    ol.set_shard_id(shard_id);
+
+    ret = ol.init();
+
+    if (ret < 0) {
+      if (ret == (-ENOENT))
+        return 0;
+      ldpp_dout(this, 0) << "ERROR: store->list_objects():" <<dendl;
+      return ret;
+    }
+
+    op_env oenv(op, store, this, bucket_info, ol);
+
+    LCOpRule orule(oenv);
+
+    orule.build();
+
+    rgw_bucket_dir_entry o;
+    for (; ol.get_obj(&o); ol.next()) {
+      ldpp_dout(this, 20) << __func__ << "(): key=" << o.key << dendl;
+      int ret = orule.process(o, this);
+      if (ret < 0) {
+        ldpp_dout(this, 20) << "ERROR: orule.process() returned ret="
+			    << ret
+			    << dendl;
+      }
+
+      if (going_down()) {
+        return 0;
+      }
+    }
+  }
+
+
+  return 0;
+}
+
+/*
+ * The index shards of a bucket are the units of work. They are spread over
+ * rgw_lc_max_wp_worker threads here, as well as over the workers of other
+ * gateways that run out of buckets, see help_processing(). A worker takes a
+ * shard by locking its index object, and keeps the lock until it is done
+ * with the whole bucket, so that no one processes the shard twice while
+ * the bucket is in progress. The locks are released before the worker
+ * moves on to the next bucket; at worst a late helper then redoes a shard
+ * before the bucket is marked complete, which expires nothing new.
+ */
+int RGWLC::bucket_lc_process_shards(RGWBucketInfo& bucket_info,
+				    multimap<string, lc_op>& prefix_map)
+{
+  librados::IoCtx index_ctx;
+  map<int, string> oids;
+  int ret = store->open_bucket_index(bucket_info, index_ctx, oids);
+  if (ret < 0) {
+    ldpp_dout(this, 0) << "ERROR: failed to open bucket index of "
+		       << bucket_info.bucket << ", ret=" << ret << dendl;
+    return ret;
+  }
+
+  const vector<pair<int, string>> shards(oids.begin(), oids.end());
+  // only bounds how long a crashed worker keeps its shards
+  utime_t now = ceph_clock_now();
+  int secs = lc_secs_to_next_start(cct, now, now);
+  const utime_t max_duration(std::max(secs - secs / 10, 1), 0);
+
+  std::atomic<size_t> next{0};
+  std::atomic<int> error{0};
+  ceph::mutex done_lock = ceph::make_mutex("RGWLC::bucket_lc_process_shards");
+  vector<string> done; // the shards we hold the lock of
+  auto process_shards = [&] {
+    for (size_t i = next++; i < shards.size() && !going_down(); i = next++) {
+      const int shard_id = shards[i].first;
+      const string& oid = shards[i].second;
+
+      rados::cls::lock::Lock l(lc_index_lock_name);
+      l.set_cookie(cookie);
+      l.set_duration(max_duration);
+      int r = l.lock_exclusive(&index_ctx, oid);
+      if (r == -EBUSY || r == -EEXIST) {
+	ldpp_dout(this, 20) << __func__ << "(): " << bucket_info.bucket
+			    << " shard_id=" << shard_id
+			    << " is taken by another worker" << dendl;
+	continue;
+      }
+      if (r >= 0) {
+	r = bucket_lc_process_shard(bucket_info, prefix_map, shard_id);
+      }
+      if (r < 0 || going_down()) {
+	/* let someone else have a go */
+	l.unlock(&index_ctx, oid);
+      } else {
+	std::lock_guard dl{done_lock};
+	done.push_back(oid);
+      }
+      if (r < 0) {
+	ldpp_dout(this, 0) << "ERROR: failed to process " << bucket_info.bucket
+			   << " shard_id=" << shard_id << ", ret=" << r << dendl;
+	error = r;
+      }
+    }
+  };
+
+  const size_t num_threads = std::min<size_t>(
+    std::max<int64_t>(cct->_conf.get_val<int64_t>("rgw_lc_max_wp_worker"), 1),
+    shards.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; i++) {
+    threads.push_back(make_named_thread("lc_wp", process_shards));
+  }
+  process_shards();
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  for (const auto& oid : done) {
+    rados::cls::lock::Lock l(lc_index_lock_name);
+    l.set_cookie(cookie);
+    l.unlock(&index_ctx, oid);
+  }
+
+  return error;
+}
+
+int RGWLC::bucket_lc_process(string& shard_id, bool helper)
 {
   RGWLifecycleConfiguration  config(cct);
   RGWBucketInfo bucket_info;
@@ -982,53 +1155,9 @@ int RGWLC::bucket_lc_process(string& shard_id)
 		      << prefix_map.size()
 		      << dendl;
 
-  rgw_obj_key pre_marker;
-  rgw_obj_key next_marker;
-  for(auto prefix_iter = prefix_map.begin(); prefix_iter != prefix_map.end(); ++prefix_iter) {
-    auto& op = prefix_iter->second;
-    if (!is_valid_op(op)) {
-      continue;
-    }
-    ldpp_dout(this, 20) << __func__ << "(): prefix=" << prefix_iter->first << dendl;
-    if (prefix_iter != prefix_map.begin() && 
-        (prefix_iter->first.compare(0, prev(prefix_iter)->first.length(), prev(prefix_iter)->first) == 0)) {
-      next_marker = pre_marker;
-    } else {
-      pre_marker = next_marker;
-    }
-
-    LCObjsLister ol(store, bucket_info);
-    ol.set_prefix(prefix_iter->first);
-
-    ret = ol.init();
-
-    if (ret < 0) {
-      if (ret == (-ENOENT))
-        return 0;
-      ldpp_dout(this, 0) << "ERROR: store->list_objects():" <<dendl;
-      return ret;
-    }
-
-    op_env oenv(op, store, this, bucket_info, ol);
-
-    LCOpRule orule(oenv);
-
-    orule.build();
-
-    rgw_bucket_dir_entry o;
-    for (; ol.get_obj(&o); ol.next()) {
-      ldpp_dout(this, 20) << __func__ << "(): key=" << o.key << dendl;
-      int ret = orule.process(o, this);
-      if (ret < 0) {
-        ldpp_dout(this, 20) << "ERROR: orule.process() returned ret="
-			    << ret
-			    << dendl;
-      }
-
-      if (going_down()) {
-        return 0;
-      }
-    }
+  ret = bucket_lc_process_shards(bucket_info, prefix_map);
+  if (ret < 0 || helper || going_down()) {
+    return ret;
   }
 
   ret = handle_multipart_expiration(&target, prefix_map);
@@ -1168,8 +1297,11 @@ int RGWLC::process(int index, int max_lock_secs)
       goto exit;
     }
 
-    if (entry.first.empty())
-      goto exit;
+    if (entry.first.empty()) {
+      l.unlock(&store->lc_pool_ctx, obj_names[index]);
+      help_processing(index);
+      return 0;
+    }
 
     entry.second = lc_processing;
     ret = cls_rgw_lc_set_entry(store->lc_pool_ctx, obj_names[index],  entry);
@@ -1195,21 +1327,49 @@ exit:
     return 0;
 }
 
+/* the other buckets of the shard are taken, lend a hand to the workers
+ * still processing some */
+void RGWLC::help_processing(int index)
+{
+  string marker;
+  map<string, int> entries;
+  do {
+    int ret = cls_rgw_lc_list(store->lc_pool_ctx, obj_names[index], marker, MAX_LC_LIST_ENTRIES, entries);
+    if (ret < 0)
+      return;
+    for (auto& entry : entries) {
+      if (going_down())
+        return;
+      if (entry.second != lc_processing)
+        continue;
+      string bucket = entry.first;
+      ldpp_dout(this, 20) << "RGWLC::help_processing() " << bucket << dendl;
+      bucket_lc_process(bucket, true);
+    }
+
+    if (!entries.empty()) {
+      marker = std::move(entries.rbegin()->first);
+    }
+  } while (!entries.empty());
+}
+
 void RGWLC::start_processor()
 {
-  worker = new LCWorker(this, cct, this);
-  worker->create("lifecycle_thr");
+  auto max_workers = cct->_conf.get_val<int64_t>("rgw_lc_max_worker");
+  for (int64_t i = 0; i < max_workers; i++) {
+    workers.emplace_back(std::make_unique<LCWorker>(this, cct, this));
+    workers.back()->create("lifecycle_thr");
+  }
 }
 
 void RGWLC::stop_processor()
 {
   down_flag = true;
-  if (worker) {
+  for (auto& worker : workers) {
     worker->stop();
     worker->join();
   }
-  delete worker;
-  worker = NULL;
+  workers.clear();
 }
 
 
@@ -1260,34 +1420,10 @@ bool RGWLC::LCWorker::should_work(utime_t& now)
 
 int RGWLC::LCWorker::schedule_next_start_time(utime_t &start, utime_t& now)
 {
-  int secs;
-
-  if (cct->_conf->rgw_lc_debug_interval > 0) {
-	secs = start + cct->_conf->rgw_lc_debug_interval - now;
-	if (secs < 0)
-	  secs = 0;
-	return (secs);
-  }
-
-  int start_hour;
-  int start_minute;
-  int end_hour;
-  int end_minute;
-  string worktime = cct->_conf->rgw_lifecycle_work_time;
-  sscanf(worktime.c_str(),"%d:%d-%d:%d",&start_hour, &start_minute, &end_hour, &end_minute);
-  struct tm bdt;
-  time_t tt = now.sec();
-  time_t nt;
-  localtime_r(&tt, &bdt);
-  bdt.tm_hour = start_hour;
-  bdt.tm_min = start_minute;
-  bdt.tm_sec = 0;
-  nt = mktime(&bdt);
-  secs = nt - tt;
-
-  return secs>0 ? secs : secs+24*60*60;
+  return lc_secs_to_next_start(cct, start, now);
 }
 
+
 void RGWLifecycleConfiguration::generate_test_instances(list<RGWLifecycleConfiguration*>& o)
 {
   o.push_back(new RGWLifecycleConfiguration);
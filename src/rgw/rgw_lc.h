@@ -475,8 +475,8 @@ class RGWLC : public DoutPrefixProvider {
   };
   
   public:
-  LCWorker *worker;
-  RGWLC() : cct(NULL), store(NULL), worker(NULL) {}
+  std::vector<std::unique_ptr<LCWorker>> workers;
+  RGWLC() : cct(NULL), store(NULL) {}
   ~RGWLC() {
     stop_processor();
     finalize();
@@ -490,7 +490,9 @@ class RGWLC : public DoutPrefixProvider {
   bool if_already_run_today(time_t& start_date);
   int list_lc_progress(const string& marker, uint32_t max_entries, map<string, int> *progress_map);
   int bucket_lc_prepare(int index);
-  int bucket_lc_process(string& shard_id);
+  /* the helpers only process the bucket index shards no other worker took */
+  int bucket_lc_process(string& shard_id, bool helper = false);
+  void help_processing(int index);
   int bucket_lc_post(int index, int max_lock_sec, pair<string, int >& entry, int& result);
   bool going_down();
   void start_processor();
@@ -509,6 +511,10 @@ class RGWLC : public DoutPrefixProvider {
 
   int handle_multipart_expiration(RGWRados::Bucket *target,
 				  const multimap<string, lc_op>& prefix_map);
+  int bucket_lc_process_shards(RGWBucketInfo& bucket_info,
+			       multimap<string, lc_op>& prefix_map);
+  int bucket_lc_process_shard(RGWBucketInfo& bucket_info,
+			      multimap<string, lc_op>& prefix_map, int shard_id);
 };
 
 namespace rgw::lc {
@@ -1,8 +1,13 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab
 
+#include <array>
+#include <atomic>
+#include <fstream>
+
 #include "common/Clock.h"
 #include "common/Timer.h"
+#include "common/errno.h"
 #include "common/utf8.h"
 #include "common/OutputDataSocket.h"
 #include "common/Formatter.h"
@@ -88,14 +93,21 @@ string render_log_object_name(const string& format,
 
 /* usage logger */
 class UsageLogger {
+  // requests only contend on the shard of their user and bucket, and the
+  // shards are swapped out one at a time on flush
+  static constexpr size_t num_shards = 16;
+  struct Shard {
+    Mutex lock{"UsageLogger::Shard"};
+    map<rgw_user_bucket, RGWUsageBatch> usage_map;
+  };
+
   CephContext *cct;
   RGWRados *store;
-  map<rgw_user_bucket, RGWUsageBatch> usage_map;
-  Mutex lock;
-  int32_t num_entries;
+  std::array<Shard, num_shards> shards;
+  std::atomic<int32_t> num_entries{0};
   Mutex timer_lock;
   SafeTimer timer;
-  utime_t round_timestamp;
+  std::atomic<time_t> round_timestamp{0};
 
   class C_UsageLogTimeout : public Context {
     UsageLogger *logger;
@@ -112,7 +124,7 @@ class UsageLogger {
   }
 public:
 
-  UsageLogger(CephContext *_cct, RGWRados *_store) : cct(_cct), store(_store), lock("UsageLogger"), num_entries(0), timer_lock("UsageLogger::timer_lock"), timer(cct, timer_lock) {
+  UsageLogger(CephContext *_cct, RGWRados *_store) : cct(_cct), store(_store), timer_lock("UsageLogger::timer_lock"), timer(cct, timer_lock) {
     timer.init();
     Mutex::Locker l(timer_lock);
     set_timer();
@@ -128,23 +140,27 @@ public:
   }
 
   void recalc_round_timestamp(utime_t& ts) {
-    round_timestamp = ts.round_to_hour();
+    round_timestamp = ts.round_to_hour().sec();
   }
 
   void insert_user(utime_t& timestamp, const rgw_user& user, rgw_usage_log_entry& entry) {
-    lock.Lock();
     if (timestamp.sec() > round_timestamp + 3600)
       recalc_round_timestamp(timestamp);
-    entry.epoch = round_timestamp.sec();
+    utime_t round(round_timestamp.load(), 0);
+    entry.epoch = round.sec();
     bool account;
     string u = user.to_str();
     rgw_user_bucket ub(u, entry.bucket);
-    real_time rt = round_timestamp.to_real_time();
-    usage_map[ub].insert(rt, entry, &account);
+    real_time rt = round.to_real_time();
+
+    auto& shard = shards[std::hash<string>{}(ub.user + ub.bucket) % num_shards];
+    shard.lock.Lock();
+    shard.usage_map[ub].insert(rt, entry, &account);
+    shard.lock.Unlock();
+
+    bool need_flush = false;
     if (account)
-      num_entries++;
-    bool need_flush = (num_entries > cct->_conf->rgw_usage_log_flush_threshold);
-    lock.Unlock();
+      need_flush = (++num_entries > cct->_conf->rgw_usage_log_flush_threshold);
     if (need_flush) {
       Mutex::Locker l(timer_lock);
       flush();
@@ -161,26 +177,161 @@ public:
 
   void flush() {
     map<rgw_user_bucket, RGWUsageBatch> old_map;
-    lock.Lock();
-    old_map.swap(usage_map);
     num_entries = 0;
-    lock.Unlock();
+    for (auto& shard : shards) {
+      map<rgw_user_bucket, RGWUsageBatch> shard_map;
+      shard.lock.Lock();
+      shard_map.swap(shard.usage_map);
+      shard.lock.Unlock();
+      // the shards don't share keys
+      old_map.merge(shard_map);
+    }
 
     store->log_usage(old_map);
   }
 };
 
+/* batches the entries of the ops log per log object, so that busy buckets
+ * append them to rados in a few large writes rather than one per request,
+ * and copies them, as lines of json, to rgw_ops_log_file_path */
+class OpsLogWriter {
+  CephContext *cct;
+  RGWRados *store;
+  Mutex lock;
+  map<string, bufferlist> pending; // by log object
+  uint64_t pending_bytes = 0;
+  bufferlist file_pending;
+  std::ofstream file;
+  Mutex flush_lock;
+  Mutex timer_lock;
+  SafeTimer timer;
+
+  class C_OpsLogTimeout : public Context {
+    OpsLogWriter *writer;
+  public:
+    explicit C_OpsLogTimeout(OpsLogWriter *_w) : writer(_w) {}
+    void finish(int r) override {
+      writer->flush();
+      writer->set_timer();
+    }
+  };
+
+  void set_timer() {
+    timer.add_event_after(cct->_conf.get_val<double>("rgw_ops_log_flush_interval"),
+                          new C_OpsLogTimeout(this));
+  }
+
+  int append(const string& oid, bufferlist& bl) {
+    rgw_raw_obj obj(store->svc.zone->get_zone_params().log_pool, oid);
+    int ret = store->append_async(obj, bl.length(), bl);
+    if (ret == -ENOENT) {
+      ret = store->create_pool(store->svc.zone->get_zone_params().log_pool);
+      if (ret < 0)
+        return ret;
+      // retry
+      ret = store->append_async(obj, bl.length(), bl);
+    }
+    return ret;
+  }
+
+public:
+  OpsLogWriter(CephContext *_cct, RGWRados *_store)
+    : cct(_cct), store(_store), lock("OpsLogWriter"),
+      flush_lock("OpsLogWriter::flush_lock"),
+      timer_lock("OpsLogWriter::timer_lock"), timer(cct, timer_lock) {
+    const auto& path = cct->_conf.get_val<string>("rgw_ops_log_file_path");
+    if (!path.empty()) {
+      file.open(path, std::ofstream::out | std::ofstream::app);
+      if (!file) {
+        lderr(cct) << "ERROR: failed to open ops log file " << path << dendl;
+      }
+    }
+    timer.init();
+    Mutex::Locker l(timer_lock);
+    set_timer();
+  }
+
+  ~OpsLogWriter() {
+    Mutex::Locker l(timer_lock);
+    flush();
+    timer.cancel_all_events();
+    timer.shutdown();
+  }
+
+  bool batching() const {
+    return cct->_conf.get_val<Option::size_t>("rgw_ops_log_batch_size") > 0;
+  }
+  bool has_file() const {
+    return file.is_open();
+  }
+
+  int log(const string& oid, bufferlist& bl) {
+    if (!batching()) {
+      return append(oid, bl);
+    }
+    lock.Lock();
+    pending_bytes += bl.length();
+    pending[oid].claim_append(bl);
+    bool need_flush = (pending_bytes >=
+        cct->_conf.get_val<Option::size_t>("rgw_ops_log_batch_size"));
+    lock.Unlock();
+    if (need_flush) {
+      flush();
+    }
+    return 0;
+  }
+
+  void log_to_file(struct rgw_log_entry& entry) {
+    JSONFormatter formatter;
+    rgw_format_ops_log_entry(entry, &formatter);
+    std::stringstream ss;
+    formatter.flush(ss);
+    ss << "\n";
+    lock.Lock();
+    file_pending.append(ss.str());
+    lock.Unlock();
+  }
+
+  void flush() {
+    map<string, bufferlist> old_pending;
+    bufferlist old_file;
+    lock.Lock();
+    old_pending.swap(pending);
+    pending_bytes = 0;
+    old_file.claim(file_pending);
+    lock.Unlock();
+
+    // keep the batches of concurrent flushes in order
+    Mutex::Locker l(flush_lock);
+    for (auto& [oid, bl] : old_pending) {
+      int ret = append(oid, bl);
+      if (ret < 0) {
+        ldout(cct, 0) << "ERROR: failed to write ops log batch to " << oid
+            << ": " << cpp_strerror(ret) << dendl;
+      }
+    }
+    if (old_file.length() > 0) {
+      old_file.write_stream(file);
+      file.flush();
+    }
+  }
+};
+
 static UsageLogger *usage_logger = NULL;
+static OpsLogWriter *ops_log_writer = NULL;
 
 void rgw_log_usage_init(CephContext *cct, RGWRados *store)
 {
   usage_logger = new UsageLogger(cct, store);
+  ops_log_writer = new OpsLogWriter(cct, store);
 }
 
 void rgw_log_usage_finalize()
 {
   delete usage_logger;
   usage_logger = NULL;
+  delete ops_log_writer;
+  ops_log_writer = NULL;
 }
 
 static void log_usage(struct req_state *s, const string& op_name)
@@ -443,18 +594,27 @@ int rgw_log_op(RGWRados *store, RGWREST* const rest, struct req_state *s,
     string oid = render_log_object_name(s->cct->_conf->rgw_log_object_name, &bdt,
 				        s->bucket.bucket_id, entry.bucket);
 
-    rgw_raw_obj obj(store->svc.zone->get_zone_params().log_pool, oid);
-
-    ret = store->append_async(obj, bl.length(), bl);
-    if (ret == -ENOENT) {
-      ret = store->create_pool(store->svc.zone->get_zone_params().log_pool);
+    if (ops_log_writer) {
+      ret = ops_log_writer->log(oid, bl);
       if (ret < 0)
         goto done;
-      // retry
+    } else {
+      rgw_raw_obj obj(store->svc.zone->get_zone_params().log_pool, oid);
+
       ret = store->append_async(obj, bl.length(), bl);
+      if (ret == -ENOENT) {
+        ret = store->create_pool(store->svc.zone->get_zone_params().log_pool);
+        if (ret < 0)
+          goto done;
+        // retry
+        ret = store->append_async(obj, bl.length(), bl);
+      }
     }
   }
 
+  if (ops_log_writer && ops_log_writer->has_file()) {
+    ops_log_writer->log_to_file(entry);
+  }
   if (olog) {
     olog->log(entry);
   }
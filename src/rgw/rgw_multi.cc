@@ -11,7 +11,9 @@
 #include "rgw_xml.h"
 #include "rgw_multi.h"
 #include "rgw_op.h"
+#include "rgw_aio_throttle.h"
 
+#include "services/svc_rados.h"
 #include "services/svc_sys_obj.h"
 
 #define dout_subsys ceph_subsys_rgw
@@ -214,6 +216,127 @@ int list_multipart_parts(RGWRados *store, struct req_state *s,
   return list_multipart_parts(store, s->bucket_info, s->cct, upload_id, meta_oid, num_parts, marker, parts, next_marker, truncated, assume_unsorted);
 }
 
+static int list_multipart_parts_serial(RGWRados *store, struct req_state *s,
+                                       const string& upload_id,
+                                       const string& meta_oid, int page_size,
+                                       map<uint32_t, RGWUploadPartInfo>& parts)
+{
+  map<uint32_t, RGWUploadPartInfo> page;
+  int marker = 0;
+  bool truncated;
+  parts.clear();
+  do {
+    int ret = list_multipart_parts(store, s, upload_id, meta_oid, page_size,
+                                   marker, page, &marker, &truncated);
+    if (ret < 0) {
+      return ret;
+    }
+    parts.insert(page.begin(), page.end());
+  } while (truncated);
+  return 0;
+}
+
+/*
+ * v2 uploads key their parts by the zero padded part number, so for parts
+ * 1..n the first part of every page is known before reading the previous
+ * one, and all the pages can be requested at once.
+ */
+int list_all_multipart_parts(RGWRados *store, struct req_state *s,
+                             const string& upload_id,
+                             const string& meta_oid, int page_size,
+                             int expected_parts,
+                             map<uint32_t, RGWUploadPartInfo>& parts)
+{
+  if (!is_v2_upload_id(upload_id) || expected_parts <= page_size) {
+    return list_multipart_parts_serial(store, s, upload_id, meta_oid,
+                                       page_size, parts);
+  }
+
+  rgw_obj obj;
+  obj.init_ns(s->bucket_info.bucket, meta_oid, RGW_OBJ_NS_MULTIPART);
+  obj.set_in_extra_data(true);
+
+  rgw_raw_obj raw_obj;
+  store->obj_to_raw(s->bucket_info.placement_rule, obj, &raw_obj);
+
+  auto rados_obj = store->svc.rados->obj(raw_obj);
+  int ret = rados_obj.open();
+  if (ret < 0) {
+    return ret;
+  }
+
+  struct page_t {
+    map<string, bufferlist> vals;
+    bool more = false;
+    int rval = 0;
+  };
+  const int num_pages = (expected_parts + page_size - 1) / page_size;
+  std::vector<page_t> pages(num_pages);
+
+  auto aio = rgw::make_throttle(
+      s->cct->_conf.get_val<uint64_t>("rgw_multipart_list_max_aio"), s->yield);
+  for (int i = 0; i < num_pages; i++) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "part.%08d", i * page_size);
+    // ask the last page for one more part, to tell whether there are extra
+    // parts past the expected ones
+    const int num = (i == num_pages - 1 ?
+                     expected_parts - i * page_size + 1 : page_size);
+    librados::ObjectReadOperation op;
+    op.omap_get_vals2(buf, "", num, &pages[i].vals, &pages[i].more,
+                      &pages[i].rval);
+    ret = rgw::check_for_errors(
+      aio->get(rados_obj, rgw::Aio::librados_op(std::move(op), s->yield),
+               1, i));
+    if (ret < 0) {
+      break;
+    }
+  }
+  int r = rgw::check_for_errors(aio->drain());
+  if (ret == 0) {
+    ret = r;
+  }
+  if (ret < 0) {
+    return ret;
+  }
+
+  parts.clear();
+  uint32_t expected_next = 1;
+  for (auto& page : pages) {
+    if (page.rval < 0) {
+      return page.rval;
+    }
+    for (auto& [key, bl] : page.vals) {
+      RGWUploadPartInfo info;
+      try {
+        auto bli = bl.cbegin();
+        decode(info, bli);
+      } catch (buffer::error& err) {
+        ldout(s->cct, 0) << "ERROR: could not part info, caught buffer::error" << dendl;
+        return -EIO;
+      }
+      if (info.num != expected_next) {
+        /* a hole in the part numbers, or a gateway that doesn't sort the
+         * part keys, the pages did not cover the parts we expected */
+        ldout(s->cct, 10) << "part " << info.num << " found where "
+                          << expected_next << " was expected, listing the "
+                          << "parts one page at a time" << dendl;
+        return list_multipart_parts_serial(store, s, upload_id, meta_oid,
+                                           page_size, parts);
+      }
+      expected_next++;
+      parts[info.num] = std::move(info);
+    }
+  }
+
+  if (pages.back().more) {
+    /* more parts than expected, let the caller see all of them */
+    return list_multipart_parts_serial(store, s, upload_id, meta_oid,
+                                       page_size, parts);
+  }
+  return 0;
+}
+
 int abort_multipart_upload(RGWRados *store, CephContext *cct, RGWObjectCtx *obj_ctx, RGWBucketInfo& bucket_info, RGWMPObj& mp_obj)
 {
   rgw_obj meta_obj;
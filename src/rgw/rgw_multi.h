@@ -98,6 +98,18 @@ extern int list_multipart_parts(RGWRados *store, struct req_state *s,
                                 int *next_marker, bool *truncated,
                                 bool assume_unsorted = false);
 
+/**
+ * List all the parts of an upload, in pages of page_size parts.
+ *
+ * If the upload is expected to consist of parts 1..expected_parts, the
+ * pages are read concurrently, otherwise one after the other.
+ */
+extern int list_all_multipart_parts(RGWRados *store, struct req_state *s,
+                                    const string& upload_id,
+                                    const string& meta_oid, int page_size,
+                                    int expected_parts,
+                                    map<uint32_t, RGWUploadPartInfo>& parts);
+
 extern int abort_multipart_upload(RGWRados *store, CephContext *cct, RGWObjectCtx *obj_ctx,
                                 RGWBucketInfo& bucket_info, RGWMPObj& mp_obj);
 
@@ -9,6 +9,8 @@
 #include <sstream>
 
 #include <boost/algorithm/string/predicate.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
 #include <boost/bind.hpp>
 #include <boost/optional.hpp>
 #include <boost/utility/in_place_factory.hpp>
@@ -208,7 +210,8 @@ static int get_bucket_instance_policy_from_attr(CephContext *cct,
 						RGWRados *store,
 						RGWBucketInfo& bucket_info,
 						map<string, bufferlist>& bucket_attrs,
-						RGWAccessControlPolicy *policy)
+						RGWAccessControlPolicy *policy,
+						optional_yield y)
 {
   map<string, bufferlist>::iterator aiter = bucket_attrs.find(RGW_ATTR_ACL);
 
@@ -220,7 +223,7 @@ static int get_bucket_instance_policy_from_attr(CephContext *cct,
     ldout(cct, 0) << "WARNING: couldn't find acl header for bucket, generating default" << dendl;
     RGWUserInfo uinfo;
     /* object exists, but policy is broken */
-    int r = rgw_get_user_info_by_uid(store, bucket_info.owner, uinfo);
+    int r = rgw_get_user_info_by_uid(store, bucket_info.owner, uinfo, y);
     if (r < 0)
       return r;
 
@@ -236,7 +239,8 @@ static int get_obj_policy_from_attr(CephContext *cct,
 				    map<string, bufferlist>& bucket_attrs,
 				    RGWAccessControlPolicy *policy,
                                     string *storage_class,
-				    rgw_obj& obj)
+				    rgw_obj& obj,
+				    optional_yield y)
 {
   bufferlist bl;
   int ret = 0;
@@ -253,7 +257,7 @@ static int get_obj_policy_from_attr(CephContext *cct,
     /* object exists, but policy is broken */
     ldout(cct, 0) << "WARNING: couldn't find acl header for object, generating default" << dendl;
     RGWUserInfo uinfo;
-    ret = rgw_get_user_info_by_uid(store, bucket_info.owner, uinfo);
+    ret = rgw_get_user_info_by_uid(store, bucket_info.owner, uinfo, y);
     if (ret < 0)
       return ret;
 
@@ -285,9 +289,10 @@ int rgw_op_get_bucket_policy_from_attr(CephContext *cct,
                                        RGWRados *store,
                                        RGWBucketInfo& bucket_info,
                                        map<string, bufferlist>& bucket_attrs,
-                                       RGWAccessControlPolicy *policy)
+                                       RGWAccessControlPolicy *policy,
+                                       optional_yield y)
 {
-  return get_bucket_instance_policy_from_attr(cct, store, bucket_info, bucket_attrs, policy);
+  return get_bucket_instance_policy_from_attr(cct, store, bucket_info, bucket_attrs, policy, y);
 }
 
 static boost::optional<Policy> get_iam_policy_from_attr(CephContext* cct,
@@ -473,7 +478,7 @@ static int read_bucket_policy(RGWRados *store,
     return 0;
   }
 
-  int ret = rgw_op_get_bucket_policy_from_attr(s->cct, store, bucket_info, bucket_attrs, policy);
+  int ret = rgw_op_get_bucket_policy_from_attr(s->cct, store, bucket_info, bucket_attrs, policy, s->yield);
   if (ret == -ENOENT) {
       ret = -ERR_NO_SUCH_BUCKET;
   }
@@ -514,12 +519,14 @@ static int read_obj_policy(RGWRados *store,
 
   RGWObjectCtx *obj_ctx = static_cast<RGWObjectCtx *>(s->obj_ctx);
   int ret = get_obj_policy_from_attr(s->cct, store, *obj_ctx,
-                                     bucket_info, bucket_attrs, acl, storage_class, obj);
+                                     bucket_info, bucket_attrs, acl, storage_class, obj,
+                                     s->yield);
   if (ret == -ENOENT) {
     /* object does not exist checking the bucket's ACL to make sure
        that we send a proper error code */
     RGWAccessControlPolicy bucket_policy(s->cct);
-    ret = rgw_op_get_bucket_policy_from_attr(s->cct, store, bucket_info, bucket_attrs, &bucket_policy);
+    ret = rgw_op_get_bucket_policy_from_attr(s->cct, store, bucket_info, bucket_attrs, &bucket_policy,
+                                             s->yield);
     if (ret < 0) {
       return ret;
     }
@@ -691,7 +698,7 @@ int rgw_build_bucket_policies(RGWRados* store, struct req_state* s)
   /* handle user ACL only for those APIs which support it */
   if (s->user_acl) {
     map<string, bufferlist> uattrs;
-    ret = rgw_get_user_attrs_by_uid(store, acct_acl_user.uid, uattrs);
+    ret = rgw_get_user_attrs_by_uid(store, acct_acl_user.uid, uattrs, s->yield);
     if (!ret) {
       ret = get_user_policy_from_attr(s->cct, store, uattrs, *s->user_acl);
     }
@@ -717,7 +724,11 @@ int rgw_build_bucket_policies(RGWRados* store, struct req_state* s)
   if (! s->user->user_id.empty() && s->auth.identity->get_identity_type() != TYPE_ROLE) {
     try {
       map<string, bufferlist> uattrs;
-      if (ret = rgw_get_user_attrs_by_uid(store, s->user->user_id, uattrs); ! ret) {
+      if (ret = rgw_get_user_attrs_by_uid(store, s->user->user_id, uattrs, s->yield); ! ret) {
+        if (auto q = uattrs.find(RGW_ATTR_QOS); q != uattrs.end()) {
+          // empty once removed, which leaves the user unscheduled
+          s->user_qos = q->second;
+        }
         if (s->iam_user_policies.empty()) {
           s->iam_user_policies = get_iam_user_policy_from_attr(s->cct, store, uattrs, s->user->user_id.tenant);
         } else {
@@ -931,7 +942,7 @@ template<typename F>
 int retry_raced_bucket_write(RGWRados* g, req_state* s, const F& f) {
   auto r = f();
   for (auto i = 0u; i < 15u && r == -ECANCELED; ++i) {
-    r = g->try_refresh_bucket_info(s->bucket_info, nullptr,
+    r = g->try_refresh_bucket_info(s->bucket_info, nullptr, s->yield,
 				   &s->bucket_attrs);
     if (r >= 0) {
       r = f();
@@ -1270,7 +1281,7 @@ int RGWOp::init_quota()
   if (s->user->user_id == s->bucket_owner.get_id()) {
     uinfo = s->user;
   } else {
-    int r = rgw_get_user_info_by_uid(store, s->bucket_info.owner, owner_info);
+    int r = rgw_get_user_info_by_uid(store, s->bucket_info.owner, owner_info, s->yield);
     if (r < 0)
       return r;
     uinfo = &owner_info;
@@ -2272,7 +2283,7 @@ void RGWListBuckets::execute()
   }
 
   if (supports_account_metadata()) {
-    op_ret = rgw_get_user_attrs_by_uid(store, s->user->user_id, attrs);
+    op_ret = rgw_get_user_attrs_by_uid(store, s->user->user_id, attrs, s->yield);
     if (op_ret < 0) {
       goto send_end;
     }
@@ -2406,7 +2417,7 @@ void RGWGetUsage::execute()
   }
 
   string user_str = s->user->user_id.to_str();
-  op_ret = store->cls_user_get_header(user_str, &header);
+  op_ret = store->cls_user_get_header(user_str, &header, s->yield);
   if (op_ret < 0) {
     ldpp_dout(this, 0) << "ERROR: can't read user header"  << dendl;
     return;
@@ -3078,7 +3089,7 @@ void RGWCreateBucket::execute()
   s->bucket_owner.set_name(s->user->display_name);
   if (s->bucket_exists) {
     int r = rgw_op_get_bucket_policy_from_attr(s->cct, store, s->bucket_info,
-                                               s->bucket_attrs, &old_policy);
+                                               s->bucket_attrs, &old_policy, s->yield);
     if (r >= 0)  {
       if (old_policy.get_owner().get_id().compare(s->user->user_id) != 0) {
         op_ret = -EEXIST;
@@ -3688,7 +3699,7 @@ void RGWPutObj::execute()
   if (!chunked_upload) { /* with chunked upload we don't know how big is the upload.
                             we also check sizes at the end anyway */
     op_ret = store->check_quota(s->bucket_owner.get_id(), s->bucket,
-				user_quota, bucket_quota, s->content_length);
+				user_quota, bucket_quota, s->content_length, s->yield);
     if (op_ret < 0) {
       ldpp_dout(this, 20) << "check_quota() returned ret=" << op_ret << dendl;
       return;
@@ -3826,7 +3837,7 @@ void RGWPutObj::execute()
       ldpp_dout(this, 1) << "Cannot load plugin for compression type "
           << compression_type << dendl;
     } else {
-      compressor.emplace(s->cct, plugin, filter);
+      compressor.emplace(s->cct, plugin, filter, s->yield);
       filter = &*compressor;
     }
   }
@@ -3892,7 +3903,7 @@ void RGWPutObj::execute()
   }
 
   op_ret = store->check_quota(s->bucket_owner.get_id(), s->bucket,
-                              user_quota, bucket_quota, s->obj_size);
+                              user_quota, bucket_quota, s->obj_size, s->yield);
   if (op_ret < 0) {
     ldpp_dout(this, 20) << "second check_quota() returned op_ret=" << op_ret << dendl;
     return;
@@ -4058,7 +4069,8 @@ void RGWPostObj::execute()
                                 s->bucket,
                                 user_quota,
                                 bucket_quota,
-                                s->content_length);
+                                s->content_length,
+                                s->yield);
     if (op_ret < 0) {
       return;
     }
@@ -4121,7 +4133,7 @@ void RGWPostObj::execute()
           ldpp_dout(this, 1) << "Cannot load plugin for compression type "
                            << compression_type << dendl;
         } else {
-          compressor.emplace(s->cct, plugin, filter);
+          compressor.emplace(s->cct, plugin, filter, s->yield);
           filter = &*compressor;
         }
       }
@@ -4167,7 +4179,7 @@ void RGWPostObj::execute()
 
 
     op_ret = store->check_quota(s->bucket_owner.get_id(), s->bucket,
-                                user_quota, bucket_quota, s->obj_size);
+                                user_quota, bucket_quota, s->obj_size, s->yield);
     if (op_ret < 0) {
       return;
     }
@@ -4264,7 +4276,7 @@ int RGWPutMetadataAccount::init_processing()
     return op_ret;
   }
 
-  op_ret = rgw_get_user_attrs_by_uid(store, s->user->user_id, orig_attrs,
+  op_ret = rgw_get_user_attrs_by_uid(store, s->user->user_id, orig_attrs, s->yield,
                                      &acct_op_tracker);
   if (op_ret < 0) {
     return op_ret;
@@ -4326,7 +4338,7 @@ void RGWPutMetadataAccount::execute()
 {
   /* Params have been extracted earlier. See init_processing(). */
   RGWUserInfo new_uinfo;
-  op_ret = rgw_get_user_info_by_uid(store, s->user->user_id, new_uinfo,
+  op_ret = rgw_get_user_info_by_uid(store, s->user->user_id, new_uinfo, s->yield,
                                     &acct_op_tracker);
   if (op_ret < 0) {
     return;
@@ -5719,8 +5731,6 @@ void RGWCompleteMultipart::execute()
   int total_parts = 0;
   int handled_parts = 0;
   int max_parts = 1000;
-  int marker = 0;
-  bool truncated;
   RGWCompressionInfo cs_info;
   bool compressed = false;
   uint64_t accounted_size = 0;
@@ -5766,106 +5776,104 @@ void RGWCompleteMultipart::execute()
     return;
   }
 
-  do {
-    op_ret = list_multipart_parts(store, s, upload_id, meta_oid, max_parts,
-				  marker, obj_parts, &marker, &truncated);
-    if (op_ret == -ENOENT) {
-      op_ret = -ERR_NO_SUCH_UPLOAD;
-    }
-    if (op_ret < 0)
+  op_ret = list_all_multipart_parts(store, s, upload_id, meta_oid, max_parts,
+                                    parts->parts.size(), obj_parts);
+  if (op_ret == -ENOENT) {
+    op_ret = -ERR_NO_SUCH_UPLOAD;
+  }
+  if (op_ret < 0)
+    return;
+
+  total_parts = obj_parts.size();
+  if (total_parts != (int)parts->parts.size()) {
+    ldpp_dout(this, 0) << "NOTICE: total parts mismatch: have: " << total_parts
+		     << " expected: " << parts->parts.size() << dendl;
+    op_ret = -ERR_INVALID_PART;
+    return;
+  }
+
+  for (obj_iter = obj_parts.begin(); iter != parts->parts.end() && obj_iter != obj_parts.end(); ++iter, ++obj_iter, ++handled_parts) {
+    uint64_t part_size = obj_iter->second.accounted_size;
+    if (handled_parts < (int)parts->parts.size() - 1 &&
+        part_size < min_part_size) {
+      op_ret = -ERR_TOO_SMALL;
       return;
+    }
 
-    total_parts += obj_parts.size();
-    if (!truncated && total_parts != (int)parts->parts.size()) {
-      ldpp_dout(this, 0) << "NOTICE: total parts mismatch: have: " << total_parts
-		       << " expected: " << parts->parts.size() << dendl;
+    char petag[CEPH_CRYPTO_MD5_DIGESTSIZE];
+    if (iter->first != (int)obj_iter->first) {
+      ldpp_dout(this, 0) << "NOTICE: parts num mismatch: next requested: "
+		       << iter->first << " next uploaded: "
+		       << obj_iter->first << dendl;
+      op_ret = -ERR_INVALID_PART;
+      return;
+    }
+    string part_etag = rgw_string_unquote(iter->second);
+    if (part_etag.compare(obj_iter->second.etag) != 0) {
+      ldpp_dout(this, 0) << "NOTICE: etag mismatch: part: " << iter->first
+		       << " etag: " << iter->second << dendl;
       op_ret = -ERR_INVALID_PART;
       return;
     }
 
-    for (obj_iter = obj_parts.begin(); iter != parts->parts.end() && obj_iter != obj_parts.end(); ++iter, ++obj_iter, ++handled_parts) {
-      uint64_t part_size = obj_iter->second.accounted_size;
-      if (handled_parts < (int)parts->parts.size() - 1 &&
-          part_size < min_part_size) {
-        op_ret = -ERR_TOO_SMALL;
-        return;
-      }
-
-      char petag[CEPH_CRYPTO_MD5_DIGESTSIZE];
-      if (iter->first != (int)obj_iter->first) {
-        ldpp_dout(this, 0) << "NOTICE: parts num mismatch: next requested: "
-			 << iter->first << " next uploaded: "
-			 << obj_iter->first << dendl;
-        op_ret = -ERR_INVALID_PART;
-        return;
-      }
-      string part_etag = rgw_string_unquote(iter->second);
-      if (part_etag.compare(obj_iter->second.etag) != 0) {
-        ldpp_dout(this, 0) << "NOTICE: etag mismatch: part: " << iter->first
-			 << " etag: " << iter->second << dendl;
-        op_ret = -ERR_INVALID_PART;
-        return;
-      }
+    hex_to_buf(obj_iter->second.etag.c_str(), petag,
+	      CEPH_CRYPTO_MD5_DIGESTSIZE);
+    hash.Update((const unsigned char *)petag, sizeof(petag));
 
-      hex_to_buf(obj_iter->second.etag.c_str(), petag,
-		CEPH_CRYPTO_MD5_DIGESTSIZE);
-      hash.Update((const unsigned char *)petag, sizeof(petag));
+    RGWUploadPartInfo& obj_part = obj_iter->second;
 
-      RGWUploadPartInfo& obj_part = obj_iter->second;
+    /* update manifest for part */
+    string oid = mp.get_part(obj_iter->second.num);
+    rgw_obj src_obj;
+    src_obj.init_ns(s->bucket, oid, mp_ns);
 
-      /* update manifest for part */
-      string oid = mp.get_part(obj_iter->second.num);
-      rgw_obj src_obj;
-      src_obj.init_ns(s->bucket, oid, mp_ns);
+    if (obj_part.manifest.empty()) {
+      ldpp_dout(this, 0) << "ERROR: empty manifest for object part: obj="
+		       << src_obj << dendl;
+      op_ret = -ERR_INVALID_PART;
+      return;
+    } else {
+      manifest.append(obj_part.manifest, store->svc.zone);
+    }
 
-      if (obj_part.manifest.empty()) {
-        ldpp_dout(this, 0) << "ERROR: empty manifest for object part: obj="
-			 << src_obj << dendl;
+    bool part_compressed = (obj_part.cs_info.compression_type != "none");
+    if ((obj_iter != obj_parts.begin()) &&
+        ((part_compressed != compressed) ||
+          (cs_info.compression_type != obj_part.cs_info.compression_type))) {
+        ldpp_dout(this, 0) << "ERROR: compression type was changed during multipart upload ("
+                         << cs_info.compression_type << ">>" << obj_part.cs_info.compression_type << ")" << dendl;
         op_ret = -ERR_INVALID_PART;
-        return;
-      } else {
-        manifest.append(obj_part.manifest, store->svc.zone);
-      }
-
-      bool part_compressed = (obj_part.cs_info.compression_type != "none");
-      if ((obj_iter != obj_parts.begin()) &&
-          ((part_compressed != compressed) ||
-            (cs_info.compression_type != obj_part.cs_info.compression_type))) {
-          ldpp_dout(this, 0) << "ERROR: compression type was changed during multipart upload ("
-                           << cs_info.compression_type << ">>" << obj_part.cs_info.compression_type << ")" << dendl;
-          op_ret = -ERR_INVALID_PART;
-          return; 
-      }
+        return; 
+    }
       
-      if (part_compressed) {
-        int64_t new_ofs; // offset in compression data for new part
-        if (cs_info.blocks.size() > 0)
-          new_ofs = cs_info.blocks.back().new_ofs + cs_info.blocks.back().len;
-        else
-          new_ofs = 0;
-        for (const auto& block : obj_part.cs_info.blocks) {
-          compression_block cb;
-          cb.old_ofs = block.old_ofs + cs_info.orig_size;
-          cb.new_ofs = new_ofs;
-          cb.len = block.len;
-          cs_info.blocks.push_back(cb);
-          new_ofs = cb.new_ofs + cb.len;
-        } 
-        if (!compressed)
-          cs_info.compression_type = obj_part.cs_info.compression_type;
-        cs_info.orig_size += obj_part.cs_info.orig_size;
-        compressed = true;
-      }
+    if (part_compressed) {
+      int64_t new_ofs; // offset in compression data for new part
+      if (cs_info.blocks.size() > 0)
+        new_ofs = cs_info.blocks.back().new_ofs + cs_info.blocks.back().len;
+      else
+        new_ofs = 0;
+      for (const auto& block : obj_part.cs_info.blocks) {
+        compression_block cb;
+        cb.old_ofs = block.old_ofs + cs_info.orig_size;
+        cb.new_ofs = new_ofs;
+        cb.len = block.len;
+        cs_info.blocks.push_back(cb);
+        new_ofs = cb.new_ofs + cb.len;
+      } 
+      if (!compressed)
+        cs_info.compression_type = obj_part.cs_info.compression_type;
+      cs_info.orig_size += obj_part.cs_info.orig_size;
+      compressed = true;
+    }
 
-      rgw_obj_index_key remove_key;
-      src_obj.key.get_index_key(&remove_key);
+    rgw_obj_index_key remove_key;
+    src_obj.key.get_index_key(&remove_key);
 
-      remove_objs.push_back(remove_key);
+    remove_objs.push_back(remove_key);
 
-      ofs += obj_part.size;
-      accounted_size += obj_part.accounted_size;
-    }
-  } while (truncated);
+    ofs += obj_part.size;
+    accounted_size += obj_part.accounted_size;
+  }
   hash.Final((unsigned char *)final_etag);
 
   buf_to_hex((unsigned char *)final_etag, sizeof(final_etag), final_etag_str);
@@ -6156,12 +6164,40 @@ void RGWDeleteMultiObj::pre_exec()
   rgw_bucket_object_pre_exec(s);
 }
 
+namespace {
+
+// runs the object deletes of multi-object delete requests
+struct MultiDelPool {
+  std::unique_ptr<boost::asio::thread_pool> pool;
+
+  explicit MultiDelPool(CephContext *cct) {
+    const auto threads = cct->_conf.get_val<uint64_t>("rgw_multi_obj_del_threads");
+    if (threads > 0) {
+      pool = std::make_unique<boost::asio::thread_pool>(threads);
+    }
+  }
+  ~MultiDelPool() {
+    if (pool) {
+      pool->join();
+    }
+  }
+};
+
+struct MultiDelEntry {
+  rgw_obj_key key;
+  bool delete_marker = false;
+  string version_id;
+  int ret = 0;
+  bool done = false;
+};
+
+} // anonymous namespace
+
 void RGWDeleteMultiObj::execute()
 {
   RGWMultiDelDelete *multi_delete;
   vector<rgw_obj_key>::iterator iter;
   RGWMultiDelXMLParser parser;
-  RGWObjectCtx *obj_ctx = static_cast<RGWObjectCtx *>(s->obj_ctx);
   char* buf;
 
   op_ret = get_params();
@@ -6225,54 +6261,115 @@ void RGWDeleteMultiObj::execute()
     goto done;
   }
 
-  for (iter = multi_delete->objects.begin();
-        iter != multi_delete->objects.end();
-        ++iter) {
-    rgw_obj obj(bucket, *iter);
-    if (s->iam_policy || ! s->iam_user_policies.empty()) {
-      auto usr_policy_res = eval_user_policies(s->iam_user_policies, s->env,
-                                              boost::none,
-                                              iter->instance.empty() ?
-                                              rgw::IAM::s3DeleteObject :
-                                              rgw::IAM::s3DeleteObjectVersion,
-                                              ARN(obj));
-      if (usr_policy_res == Effect::Deny) {
-        send_partial_response(*iter, false, "", -EACCES);
-        continue;
+  /* the deletes run on the pool, up to rgw_multi_obj_del_max_aio of them at
+   * once, and their results are sent in request order as they come in */
+  {
+    auto pool = s->cct->lookup_or_create_singleton_object<MultiDelPool>(
+      "rgw::MultiDelPool", false, s->cct).pool.get();
+    const auto max_aio = s->cct->_conf.get_val<uint64_t>("rgw_multi_obj_del_max_aio");
+    ceph::mutex mutex = ceph::make_mutex("RGWDeleteMultiObj");
+    ceph::condition_variable cond;
+    std::deque<std::unique_ptr<MultiDelEntry>> entries;
+    uint64_t in_flight = 0;
+
+    auto send_done = [&] (bool wait) {
+      std::unique_lock lock{mutex};
+      while (!entries.empty()) {
+        MultiDelEntry& e = *entries.front();
+        if (!e.done) {
+          if (!wait) {
+            break;
+          }
+          cond.wait(lock, [&e] { return e.done; });
+        }
+        lock.unlock();
+        send_partial_response(e.key, e.delete_marker, e.version_id, e.ret);
+        entries.pop_front();
+        lock.lock();
       }
+    };
+
+    for (iter = multi_delete->objects.begin();
+          iter != multi_delete->objects.end();
+          ++iter) {
+      entries.push_back(std::make_unique<MultiDelEntry>());
+      MultiDelEntry& entry = *entries.back();
+      entry.key = *iter;
+
+      rgw_obj obj(bucket, *iter);
+      if (s->iam_policy || ! s->iam_user_policies.empty()) {
+        auto usr_policy_res = eval_user_policies(s->iam_user_policies, s->env,
+                                                boost::none,
+                                                iter->instance.empty() ?
+                                                rgw::IAM::s3DeleteObject :
+                                                rgw::IAM::s3DeleteObjectVersion,
+                                                ARN(obj));
+        if (usr_policy_res == Effect::Deny) {
+          entry.ret = -EACCES;
+          entry.done = true;
+          continue;
+        }
 
-      rgw::IAM::Effect e = Effect::Pass;
-      if (s->iam_policy) {
-        e = s->iam_policy->eval(s->env,
-				   *s->auth.identity,
-				   iter->instance.empty() ?
-				   rgw::IAM::s3DeleteObject :
-				   rgw::IAM::s3DeleteObjectVersion,
-				   ARN(obj));
-      }
-      if ((e == Effect::Deny) ||
-	  (usr_policy_res == Effect::Pass && e == Effect::Pass && !acl_allowed)) {
-	send_partial_response(*iter, false, "", -EACCES);
-	continue;
+        rgw::IAM::Effect e = Effect::Pass;
+        if (s->iam_policy) {
+          e = s->iam_policy->eval(s->env,
+				     *s->auth.identity,
+				     iter->instance.empty() ?
+				     rgw::IAM::s3DeleteObject :
+				     rgw::IAM::s3DeleteObjectVersion,
+				     ARN(obj));
+        }
+        if ((e == Effect::Deny) ||
+	    (usr_policy_res == Effect::Pass && e == Effect::Pass && !acl_allowed)) {
+	  entry.ret = -EACCES;
+	  entry.done = true;
+	  continue;
+        }
       }
-    }
-
-    obj_ctx->set_atomic(obj);
 
-    RGWRados::Object del_target(store, s->bucket_info, *obj_ctx, obj);
-    RGWRados::Object::Delete del_op(&del_target);
+      /* each delete gets its own copy of the bucket info, which a reshard
+       * that the delete runs into updates, and its own object context */
+      auto del = [this, &entry, &mutex, &cond, &in_flight, obj,
+		  bucket_info = s->bucket_info,
+		  bucket_owner = s->bucket_owner.get_id(),
+		  obj_owner = s->owner] () mutable {
+        RGWObjectCtx obj_ctx(store, s);
+        obj_ctx.set_atomic(obj);
+
+        RGWRados::Object del_target(store, bucket_info, obj_ctx, obj);
+        RGWRados::Object::Delete del_op(&del_target);
+
+        del_op.params.bucket_owner = bucket_owner;
+        del_op.params.versioning_status = bucket_info.versioning_status();
+        del_op.params.obj_owner = obj_owner;
+
+        int r = del_op.delete_obj();
+        if (r == -ENOENT) {
+          r = 0;
+        }
 
-    del_op.params.bucket_owner = s->bucket_owner.get_id();
-    del_op.params.versioning_status = s->bucket_info.versioning_status();
-    del_op.params.obj_owner = s->owner;
+        std::lock_guard lock{mutex};
+        entry.delete_marker = del_op.result.delete_marker;
+        entry.version_id = del_op.result.version_id;
+        entry.ret = r;
+        entry.done = true;
+        --in_flight;
+        cond.notify_all();
+      };
 
-    op_ret = del_op.delete_obj();
-    if (op_ret == -ENOENT) {
-      op_ret = 0;
+      {
+        std::unique_lock lock{mutex};
+        cond.wait(lock, [&] { return in_flight < max_aio; });
+        ++in_flight;
+      }
+      if (pool) {
+        boost::asio::post(*pool, std::move(del));
+      } else {
+        del();
+      }
+      send_done(false);
     }
-
-    send_partial_response(*iter, del_op.result.delete_marker,
-			  del_op.result.version_id, op_ret);
+    send_done(true);
   }
 
   /*  set the return code to zero, errors at this point will be
@@ -6614,7 +6711,7 @@ int RGWBulkUploadOp::handle_dir(const boost::string_ref path)
   if (bucket_exists) {
     RGWAccessControlPolicy old_policy(s->cct);
     int r = rgw_op_get_bucket_policy_from_attr(s->cct, store, binfo,
-                                               battrs, &old_policy);
+                                               battrs, &old_policy, s->yield);
     if (r >= 0)  {
       if (old_policy.get_owner().get_id().compare(s->user->user_id) != 0) {
         op_ret = -EEXIST;
@@ -6815,7 +6912,7 @@ int RGWBulkUploadOp::handle_file(const boost::string_ref path,
   }
 
   op_ret = store->check_quota(bowner.get_id(), binfo.bucket,
-                              user_quota, bucket_quota, size);
+                              user_quota, bucket_quota, size, s->yield);
   if (op_ret < 0) {
     return op_ret;
   }
@@ -6859,7 +6956,7 @@ int RGWBulkUploadOp::handle_file(const boost::string_ref path,
       ldpp_dout(this, 1) << "Cannot load plugin for rgw_compression_type "
           << compression_type << dendl;
     } else {
-      compressor.emplace(s->cct, plugin, filter);
+      compressor.emplace(s->cct, plugin, filter, s->yield);
       filter = &*compressor;
     }
   }
@@ -6902,7 +6999,7 @@ int RGWBulkUploadOp::handle_file(const boost::string_ref path,
   }
 
   op_ret = store->check_quota(bowner.get_id(), binfo.bucket,
-			      user_quota, bucket_quota, size);
+			      user_quota, bucket_quota, size, s->yield);
   if (op_ret < 0) {
     ldpp_dout(this, 20) << "quota exceeded for path=" << path << dendl;
     return op_ret;
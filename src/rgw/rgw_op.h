@@ -72,7 +72,8 @@ int rgw_op_get_bucket_policy_from_attr(CephContext *cct,
                                        RGWRados *store,
                                        RGWBucketInfo& bucket_info,
                                        map<string, bufferlist>& bucket_attrs,
-                                       RGWAccessControlPolicy *policy);
+                                       RGWAccessControlPolicy *policy,
+                                       optional_yield y);
 
 class RGWHandler {
 protected:
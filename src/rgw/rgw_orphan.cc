@@ -1,12 +1,16 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab
 
+#include <atomic>
+#include <functional>
 #include <string>
+#include <thread>
 
 
 #include "common/config.h"
 #include "common/Formatter.h"
 #include "common/errno.h"
+#include "common/Thread.h"
 
 #include "rgw_rados.h"
 #include "rgw_orphan.h"
@@ -20,6 +24,42 @@
 
 #define DEFAULT_NUM_SHARDS 64
 
+/* the pool is listed in more slices than threads so that a few large
+ * pgs do not leave the other threads idle at the end */
+#define LIST_SLICES_PER_THREAD 4
+#define MAX_ORPHAN_THREADS 64
+
+/*
+ * calls process(i) for every i in [0, count) from up to num_threads
+ * threads, and returns the first error
+ */
+static int run_parallel(const char *name, size_t count, size_t num_threads,
+                        const std::function<int(size_t)>& process)
+{
+  std::atomic<size_t> next{0};
+  std::atomic<int> error{0};
+  auto worker = [&] {
+    for (size_t i = next++; i < count && error == 0; i = next++) {
+      int r = process(i);
+      if (r < 0) {
+        int expected = 0;
+        error.compare_exchange_strong(expected, r);
+      }
+    }
+  };
+
+  num_threads = std::min(num_threads, count);
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; i++) {
+    threads.push_back(make_named_thread(name, worker));
+  }
+  worker();
+  for (auto& t : threads) {
+    t.join();
+  }
+  return error;
+}
+
 static string obj_fingerprint(const string& oid, const char *force_ns = NULL)
 {
   ssize_t pos = oid.find('_');
@@ -289,81 +329,111 @@ int RGWOrphanSearch::log_oids(map<int, string>& log_shards, map<int, list<string
   return 0;
 }
 
-int RGWOrphanSearch::build_all_oids_index()
+size_t RGWOrphanSearch::get_num_threads() const
 {
-  librados::IoCtx ioctx;
+  return std::min<size_t>(std::max<int>(max_concurrent_ios, 1),
+                          MAX_ORPHAN_THREADS);
+}
 
-  int ret = rgw_init_ioctx(store->get_rados_handle(), search_info.pool, ioctx);
-  if (ret < 0) {
-    lderr(store->ctx()) << __func__ << ": rgw_init_ioctx() returned ret=" << ret << dendl;
-    return ret;
-  }
+int RGWOrphanSearch::list_pool_slice(librados::IoCtx& ioctx, size_t slice,
+                                     size_t num_slices,
+                                     std::atomic<uint64_t>& total)
+{
+  librados::ObjectCursor cursor;
+  librados::ObjectCursor end;
+  ioctx.object_list_slice(ioctx.object_list_begin(), ioctx.object_list_end(),
+                          slice, num_slices, &cursor, &end);
 
-  ioctx.set_namespace(librados::all_nspaces);
-  librados::NObjectIterator i = ioctx.nobjects_begin();
-  librados::NObjectIterator i_end = ioctx.nobjects_end();
+  while (cursor < end) {
+    std::vector<librados::ObjectItem> result;
+#define COUNT_BEFORE_FLUSH 1000
+    int ret = ioctx.object_list(cursor, end, COUNT_BEFORE_FLUSH, bufferlist(),
+                                &result, &cursor);
+    if (ret < 0) {
+      lderr(store->ctx()) << __func__ << ": ERROR: object_list() returned ret="
+                          << ret << dendl;
+      return ret;
+    }
 
-  map<int, list<string> > oids;
+    map<int, list<string> > oids;
+    for (auto& item : result) {
+      const string& oid = item.oid;
+
+      ssize_t pos = oid.find('_');
+      if (pos < 0) {
+        std::lock_guard l{output_lock};
+        cout << "unidentified oid: " << oid << ", skipping" << std::endl;
+        /* what is this object, oids should be in the format of <bucket marker>_<obj>,
+         * skip this entry
+         */
+        continue;
+      }
+      string stripped_oid = oid.substr(pos + 1);
+      rgw_obj_key key;
+      if (!rgw_obj_key::parse_raw_oid(stripped_oid, &key)) {
+        std::lock_guard l{output_lock};
+        cout << "cannot parse oid: " << oid << ", skipping" << std::endl;
+        continue;
+      }
 
-  int count = 0;
-  uint64_t total = 0;
+      if (key.ns.empty()) {
+        /* skipping head objects, we don't want to remove these as they are mutable and
+         * cleaning them up is racy (can race with object removal and a later recreation)
+         */
+        std::lock_guard l{output_lock};
+        cout << "skipping head object: oid=" << oid << std::endl;
+        continue;
+      }
 
-  cout << "logging all objects in the pool" << std::endl;
+      string oid_fp = obj_fingerprint(oid);
 
-  for (; i != i_end; ++i) {
-    string nspace = i->get_nspace();
-    string oid = i->get_oid();
-    string locator = i->get_locator();
-
-    ssize_t pos = oid.find('_');
-    if (pos < 0) {
-      cout << "unidentified oid: " << oid << ", skipping" << std::endl;
-      /* what is this object, oids should be in the format of <bucket marker>_<obj>,
-       * skip this entry
-       */
-      continue;
-    }
-    string stripped_oid = oid.substr(pos + 1);
-    rgw_obj_key key;
-    if (!rgw_obj_key::parse_raw_oid(stripped_oid, &key)) {
-      cout << "cannot parse oid: " << oid << ", skipping" << std::endl;
-      continue;
+      ldout(store->ctx(), 20) << "oid_fp=" << oid_fp << dendl;
+
+      int shard = orphan_shard(oid_fp);
+      oids[shard].push_back(oid);
     }
 
-    if (key.ns.empty()) {
-      /* skipping head objects, we don't want to remove these as they are mutable and
-       * cleaning them up is racy (can race with object removal and a later recreation)
-       */
-      cout << "skipping head object: oid=" << oid << std::endl;
-      continue;
+    ret = log_oids(all_objs_index, oids);
+    if (ret < 0) {
+      cerr << __func__ << ": ERROR: log_oids() returned ret=" << ret << std::endl;
+      return ret;
     }
 
-    string oid_fp = obj_fingerprint(oid);
+    uint64_t listed = (total += result.size());
+    ldout(store->ctx(), 1) << "iterated through " << listed << " objects" << dendl;
+  }
 
-    ldout(store->ctx(), 20) << "oid_fp=" << oid_fp << dendl;
+  return 0;
+}
 
-    int shard = orphan_shard(oid_fp);
-    oids[shard].push_back(oid);
+int RGWOrphanSearch::build_all_oids_index()
+{
+  librados::IoCtx ioctx;
 
-#define COUNT_BEFORE_FLUSH 1000
-    ++total;
-    if (++count >= COUNT_BEFORE_FLUSH) {
-      ldout(store->ctx(), 1) << "iterated through " << total << " objects" << dendl;
-      ret = log_oids(all_objs_index, oids);
-      if (ret < 0) {
-        cerr << __func__ << ": ERROR: log_oids() returned ret=" << ret << std::endl;
-        return ret;
-      }
-      count = 0;
-      oids.clear();
-    }
+  int ret = rgw_init_ioctx(store->get_rados_handle(), search_info.pool, ioctx);
+  if (ret < 0) {
+    lderr(store->ctx()) << __func__ << ": rgw_init_ioctx() returned ret=" << ret << dendl;
+    return ret;
   }
-  ret = log_oids(all_objs_index, oids);
+
+  ioctx.set_namespace(librados::all_nspaces);
+
+  /* each thread lists its own slices of the pool's pgs */
+  size_t num_threads = get_num_threads();
+  size_t num_slices = num_threads * LIST_SLICES_PER_THREAD;
+  std::atomic<uint64_t> total{0};
+
+  cout << "logging all objects in the pool" << std::endl;
+
+  ret = run_parallel("orphan_list", num_slices, num_threads,
+    [&](size_t slice) {
+      return list_pool_slice(ioctx, slice, num_slices, total);
+    });
   if (ret < 0) {
-    cerr << __func__ << ": ERROR: log_oids() returned ret=" << ret << std::endl;
     return ret;
   }
-  
+
+  ldout(store->ctx(), 1) << "listed " << total << " objects" << dendl;
   return 0;
 }
 
@@ -729,77 +799,86 @@ int OMAPReader::get_next(string *key, bufferlist *pbl, bool *done)
   return get_next(key, pbl, done);
 }
 
-int RGWOrphanSearch::compare_oid_indexes()
+int RGWOrphanSearch::compare_oid_shard(librados::IoCtx& data_ioctx,
+                                       const string& linked_oid,
+                                       const string& all_oid)
 {
-  ceph_assert(linked_objs_index.size() == all_objs_index.size());
-
   librados::IoCtx& ioctx = orphan_store.get_ioctx();
-
-  librados::IoCtx data_ioctx;
-
-  int ret = rgw_init_ioctx(store->get_rados_handle(), search_info.pool, data_ioctx);
-  if (ret < 0) {
-    lderr(store->ctx()) << __func__ << ": rgw_init_ioctx() returned ret=" << ret << dendl;
-    return ret;
-  }
-
   uint64_t time_threshold = search_info.start_time.sec() - stale_secs;
 
-  map<int, string>::iterator liter = linked_objs_index.begin();
-  map<int, string>::iterator aiter = all_objs_index.begin();
+  OMAPReader linked_entries(ioctx, linked_oid);
+  OMAPReader all_entries(ioctx, all_oid);
 
-  for (; liter != linked_objs_index.end(); ++liter, ++aiter) {
-    OMAPReader linked_entries(ioctx, liter->second);
-    OMAPReader all_entries(ioctx, aiter->second);
+  bool done;
 
-    bool done;
+  string cur_linked;
+  bool linked_done = false;
 
-    string cur_linked;
-    bool linked_done = false;
 
+  do {
+    string key;
+    int r = all_entries.get_next(&key, NULL, &done);
+    if (r < 0) {
+      return r;
+    }
+    if (done) {
+      break;
+    }
+
+    string key_fp = obj_fingerprint(key);
 
-    do {
-      string key;
-      int r = all_entries.get_next(&key, NULL, &done);
+    while (cur_linked < key_fp && !linked_done) {
+      r = linked_entries.get_next(&cur_linked, NULL, &linked_done);
       if (r < 0) {
         return r;
       }
-      if (done) {
-        break;
-      }
+    }
 
-      string key_fp = obj_fingerprint(key);
+    if (cur_linked == key_fp) {
+      ldout(store->ctx(), 20) << "linked: " << key << dendl;
+      continue;
+    }
 
-      while (cur_linked < key_fp && !linked_done) {
-        r = linked_entries.get_next(&cur_linked, NULL, &linked_done);
-        if (r < 0) {
-          return r;
-        }
+    time_t mtime;
+    r = data_ioctx.stat(key, NULL, &mtime);
+    if (r < 0) {
+      if (r != -ENOENT) {
+        lderr(store->ctx()) << "ERROR: ioctx.stat(" << key << ") returned ret=" << r << dendl;
       }
+      continue;
+    }
+    if (stale_secs && (uint64_t)mtime >= time_threshold) {
+      ldout(store->ctx(), 20) << "skipping: " << key << " (mtime=" << mtime << " threshold=" << time_threshold << ")" << dendl;
+      continue;
+    }
+    ldout(store->ctx(), 20) << "leaked: " << key << dendl;
+    std::lock_guard l{output_lock};
+    cout << "leaked: " << key << std::endl;
+  } while (!done);
 
-      if (cur_linked == key_fp) {
-        ldout(store->ctx(), 20) << "linked: " << key << dendl;
-        continue;
-      }
+  return 0;
+}
 
-      time_t mtime;
-      r = data_ioctx.stat(key, NULL, &mtime);
-      if (r < 0) {
-        if (r != -ENOENT) {
-          lderr(store->ctx()) << "ERROR: ioctx.stat(" << key << ") returned ret=" << r << dendl;
-        }
-        continue;
-      }
-      if (stale_secs && (uint64_t)mtime >= time_threshold) {
-        ldout(store->ctx(), 20) << "skipping: " << key << " (mtime=" << mtime << " threshold=" << time_threshold << ")" << dendl;
-        continue;
-      }
-      ldout(store->ctx(), 20) << "leaked: " << key << dendl;
-      cout << "leaked: " << key << std::endl;
-    } while (!done);
+int RGWOrphanSearch::compare_oid_indexes()
+{
+  ceph_assert(linked_objs_index.size() == all_objs_index.size());
+
+  librados::IoCtx data_ioctx;
+
+  int ret = rgw_init_ioctx(store->get_rados_handle(), search_info.pool, data_ioctx);
+  if (ret < 0) {
+    lderr(store->ctx()) << __func__ << ": rgw_init_ioctx() returned ret=" << ret << dendl;
+    return ret;
   }
 
-  return 0;
+  /* the shards are independent merge joins, each stats its unlinked
+   * candidates synchronously */
+  return run_parallel("orphan_compare", search_info.num_shards,
+                      get_num_threads(),
+    [&](size_t shard) {
+      return compare_oid_shard(data_ioctx, linked_objs_index.at(shard),
+                               all_objs_index.at(shard));
+    });
 }
 
 int RGWOrphanSearch::run()
@@ -16,6 +16,9 @@
 #ifndef CEPH_RGW_ORPHAN_H
 #define CEPH_RGW_ORPHAN_H
 
+#include <atomic>
+
+#include "common/ceph_mutex.h"
 #include "common/config.h"
 #include "common/Formatter.h"
 #include "common/errno.h"
@@ -167,6 +170,9 @@ class RGWOrphanSearch {
 
   bool detailed_mode;
 
+  /* serializes what the listing and compare threads print */
+  ceph::mutex output_lock = ceph::make_mutex("RGWOrphanSearch::output_lock");
+
   struct log_iter_info {
     string oid;
     list<string>::iterator cur;
@@ -184,6 +190,12 @@ class RGWOrphanSearch {
   int pop_and_handle_stat_op(map<int, list<string> >& oids, std::deque<RGWRados::Object::Stat>& ops);
 
 
+  size_t get_num_threads() const;
+  int list_pool_slice(librados::IoCtx& ioctx, size_t slice, size_t num_slices,
+                      std::atomic<uint64_t>& total);
+  int compare_oid_shard(librados::IoCtx& data_ioctx, const string& linked_oid,
+                        const string& all_oid);
+
   int remove_index(map<int, string>& index);
 public:
   RGWOrphanSearch(RGWRados *_store, int _max_ios, uint64_t _stale_secs) : store(_store), orphan_store(store), max_concurrent_ios(_max_ios), stale_secs(_stale_secs) {}
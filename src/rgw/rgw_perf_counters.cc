@@ -31,6 +31,12 @@ int rgw_perf_start(CephContext *cct)
   plb.add_u64_counter(l_rgw_cache_hit, "cache_hit", "Cache hits");
   plb.add_u64_counter(l_rgw_cache_miss, "cache_miss", "Cache miss");
 
+  plb.add_u64_counter(l_rgw_datacache_hit, "datacache_hit", "Data cache hits");
+  plb.add_u64_counter(l_rgw_datacache_hit_b, "datacache_hit_b", "Size of data cache hits");
+  plb.add_u64_counter(l_rgw_datacache_miss, "datacache_miss", "Data cache miss");
+  plb.add_u64_counter(l_rgw_datacache_evict, "datacache_evict",
+                      "Stripes evicted from the data cache");
+
   plb.add_u64_counter(l_rgw_keystone_token_cache_hit, "keystone_token_cache_hit", "Keystone token cache hits");
   plb.add_u64_counter(l_rgw_keystone_token_cache_miss, "keystone_token_cache_miss", "Keystone token cache miss");
 
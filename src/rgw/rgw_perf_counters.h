@@ -30,6 +30,11 @@ enum {
   l_rgw_cache_hit,
   l_rgw_cache_miss,
 
+  l_rgw_datacache_hit,
+  l_rgw_datacache_hit_b,
+  l_rgw_datacache_miss,
+  l_rgw_datacache_evict,
+
   l_rgw_keystone_token_cache_hit,
   l_rgw_keystone_token_cache_miss,
 
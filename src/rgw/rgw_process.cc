@@ -22,6 +22,7 @@
 #define dout_subsys ceph_subsys_rgw
 
 using rgw::dmclock::Scheduler;
+using rgw::dmclock::TenantScheduler;
 
 void RGWProcess::RGWWQ::_dump_queue()
 {
@@ -56,6 +57,49 @@ auto schedule_request(Scheduler *scheduler, req_state *s, RGWOp *op)
                                      s->yield);
 }
 
+auto schedule_tenant_request(TenantScheduler *scheduler, req_state *s,
+                             RGWOp *op)
+{
+  using rgw::dmclock::SchedulerCompleter;
+  using rgw::dmclock::client_id;
+  auto unscheduled = std::make_pair(0, SchedulerCompleter{});
+  const auto client = op->dmclock_client();
+  if (!scheduler || (client != client_id::data &&
+                     client != client_id::metadata)) {
+    return unscheduled;
+  }
+
+  // the bucket's QoS takes precedence over the user's
+  std::string tenant;
+  const bufferlist *bl;
+  if (auto i = s->bucket_attrs.find(RGW_ATTR_QOS);
+      i != s->bucket_attrs.end() && i->second.length() > 0) {
+    tenant = "bucket:" + s->bucket.get_key();
+    bl = &i->second;
+  } else if (s->user_qos.length() > 0) {
+    tenant = "user:" + s->user->user_id.to_str();
+    bl = &s->user_qos;
+  } else {
+    return unscheduled;
+  }
+  rgw::dmclock::QoSInfo qos;
+  try {
+    auto p = bl->cbegin();
+    decode(qos, p);
+  } catch (buffer::error& err) {
+    ldpp_dout(op, 0) << "ERROR: failed to decode the QoS of " << tenant
+                     << dendl;
+    return unscheduled;
+  }
+
+  const auto cost = op->dmclock_cost();
+  ldpp_dout(op,10) << "scheduling with dmclock tenant=" << tenant
+		   << " cost=" << cost << dendl;
+  return scheduler->schedule_request(tenant, qos, client,
+                                     req_state::Clock::to_double(s->time),
+                                     cost, s->yield);
+}
+
 bool RGWProcess::RGWWQ::_enqueue(RGWRequest* req) {
   process->m_req_queue.push_back(req);
   perfcounter->inc(l_rgw_qlen);
@@ -86,7 +130,8 @@ int rgw_process_authenticated(RGWHandler_REST * const handler,
                               RGWOp *& op,
                               RGWRequest * const req,
                               req_state * const s,
-                              const bool skip_retarget)
+                              const bool skip_retarget,
+                              TenantScheduler * const tenant_scheduler)
 {
   ldpp_dout(op, 2) << "init permissions" << dendl;
   int ret = handler->init_permissions(op);
@@ -154,6 +199,16 @@ int rgw_process_authenticated(RGWHandler_REST * const handler,
     return ret;
   }
 
+  rgw::dmclock::SchedulerCompleter c;
+  std::tie(ret, c) = schedule_tenant_request(tenant_scheduler, s, op);
+  if (ret < 0) {
+    if (ret == -EAGAIN) {
+      ret = -ERR_RATE_LIMITED;
+    }
+    ldpp_dout(op, 0) << "Scheduling request failed with " << ret << dendl;
+    return ret;
+  }
+
   ldpp_dout(op, 2) << "pre-executing" << dendl;
   op->pre_exec();
 
@@ -175,7 +230,8 @@ int process_request(RGWRados* const store,
                     OpsLogSocket* const olog,
                     optional_yield yield,
 		    rgw::dmclock::Scheduler *scheduler,
-                    int* http_ret)
+                    int* http_ret,
+                    TenantScheduler *tenant_scheduler)
 {
   int ret = client_io->init(g_ceph_context);
 
@@ -275,7 +331,8 @@ int process_request(RGWRados* const store,
       goto done;
     }
 
-    ret = rgw_process_authenticated(handler, op, req, s);
+    ret = rgw_process_authenticated(handler, op, req, s, false,
+                                    tenant_scheduler);
     if (ret < 0) {
       abort_early(s, op, ret, handler);
       goto done;
@@ -30,6 +30,7 @@ extern void signal_shutdown();
 
 namespace rgw::dmclock {
   class Scheduler;
+  class TenantScheduler;
 }
 
 struct RGWProcessEnv {
@@ -182,13 +183,15 @@ extern int process_request(RGWRados* store,
                            OpsLogSocket* olog,
                            optional_yield y,
                            rgw::dmclock::Scheduler *scheduler,
-                           int* http_ret = nullptr);
+                           int* http_ret = nullptr,
+                           rgw::dmclock::TenantScheduler *tenant_scheduler = nullptr);
 
 extern int rgw_process_authenticated(RGWHandler_REST* handler,
                                      RGWOp*& op,
                                      RGWRequest* req,
                                      req_state* s,
-                                     bool skip_retarget = false);
+                                     bool skip_retarget = false,
+                                     rgw::dmclock::TenantScheduler *tenant_scheduler = nullptr);
 
 #if defined(def_dout_subsys)
 #undef def_dout_subsys
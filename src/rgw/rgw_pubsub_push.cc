@@ -30,6 +30,28 @@ std::string json_format_pubsub_event(const EventType& event) {
   return ss.str();
 }
 
+template<typename EventType>
+std::string json_format_pubsub_events(const std::vector<std::shared_ptr<EventType>>& events) {
+  if (events.size() == 1) {
+    return json_format_pubsub_event(*events.front());
+  }
+  std::stringstream ss;
+  JSONFormatter f(false);
+  f.open_object_section("");
+  {
+    Formatter::ArraySection s(f, EventType::json_type_plural);
+    for (const auto& event : events) {
+      encode_json(EventType::json_type_single, *event, &f);
+    }
+  }
+  f.close_section();
+  f.flush(ss);
+  return ss.str();
+}
+
+template std::string json_format_pubsub_events(const std::vector<std::shared_ptr<rgw_pubsub_event>>&);
+template std::string json_format_pubsub_events(const std::vector<std::shared_ptr<rgw_pubsub_s3_record>>&);
+
 class RGWPubSubHTTPEndpoint : public RGWPubSubEndpoint {
 private:
   const std::string endpoint;
@@ -125,6 +147,10 @@ public:
     return new PostCR(json_format_pubsub_event(record), env, endpoint, ack_level, verify_ssl);
   }
 
+  RGWCoroutine* send_to_completion_async(const std::string& message, RGWDataSyncEnv* env) override {
+    return new PostCR(message, env, endpoint, ack_level, verify_ssl);
+  }
+
   std::string to_str() const override {
     std::string str("HTTP/S Endpoint");
     str += "\nURI: " + endpoint;
@@ -294,6 +320,14 @@ public:
     }
   }
 
+  RGWCoroutine* send_to_completion_async(const std::string& message, RGWDataSyncEnv* env) override {
+    if (ack_level == ACK_LEVEL_NONE) {
+      return new NoAckPublishCR(env, topic, conn, message);
+    } else {
+      return new AckPublishCR(env, topic, conn, message, ack_level);
+    }
+  }
+
   std::string to_str() const override {
     std::string str("AMQP(0.9.1) Endpoint");
     str += "\nURI: " + endpoint;
@@ -5,6 +5,7 @@
 #include <string>
 #include <memory>
 #include <stdexcept>
+#include <vector>
 #include "include/buffer_fwd.h"
 
 // TODO the env should be used as a template parameter to differentiate the source that triggers the pushes
@@ -38,6 +39,11 @@ public:
   // in async manner via a coroutine
   virtual RGWCoroutine* send_to_completion_async(const rgw_pubsub_s3_record& record, RGWDataSyncEnv* env) = 0;
 
+  // this method is used in order to send an already formatted message, e.g. a batch of
+  // notifications, see json_format_pubsub_events(), and wait for completion
+  // in async manner via a coroutine
+  virtual RGWCoroutine* send_to_completion_async(const std::string& message, RGWDataSyncEnv* env) = 0;
+
   // present as string
   virtual std::string to_str() const { return ""; }
   
@@ -50,3 +56,8 @@ public:
   };
 };
 
+// formats events as a single message: the array of all of them, or one event
+// as it is sent on its own
+template<typename EventType>
+std::string json_format_pubsub_events(const std::vector<std::shared_ptr<EventType>>& events);
+
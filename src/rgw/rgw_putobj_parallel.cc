@@ -0,0 +1,221 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#include <algorithm>
+
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/post.hpp>
+
+#include "common/ceph_context.h"
+#include "rgw_putobj_parallel.h"
+
+namespace rgw::putobj {
+
+namespace {
+
+struct TransformPoolSingleton {
+  std::unique_ptr<TransformPool> pool;
+
+  explicit TransformPoolSingleton(CephContext *cct) {
+    const auto threads = cct->_conf.get_val<uint64_t>("rgw_put_obj_filter_threads");
+    if (threads > 0) {
+      pool = std::make_unique<TransformPool>(threads);
+    }
+  }
+};
+
+} // anonymous namespace
+
+TransformPool::~TransformPool()
+{
+  pool.join();
+}
+
+void TransformPool::post(std::function<void()>&& job)
+{
+  boost::asio::post(pool, std::move(job));
+}
+
+TransformPool* TransformPool::get(CephContext *cct)
+{
+  auto& singleton = cct->lookup_or_create_singleton_object<
+    TransformPoolSingleton>("rgw::putobj::TransformPool", false, cct);
+  return singleton.pool.get();
+}
+
+ParallelPipe::ParallelPipe(CephContext *cct, DataProcessor *next,
+                           Transform&& transform, uint64_t align,
+                           optional_yield y, uint64_t max_chunk)
+  : Pipe(next), transform(std::move(transform)),
+    pool(TransformPool::get(cct)), align(align), y(y)
+{
+  if (max_chunk) {
+    chunk_size = std::max<uint64_t>(align, max_chunk / align * align);
+  }
+  if (pool) {
+    const uint64_t pool_chunk = std::max<uint64_t>(align,
+        cct->_conf->rgw_max_chunk_size / align * align);
+    window = cct->_conf.get_val<uint64_t>("rgw_put_obj_filter_window");
+    if (chunk_size && chunk_size < pool_chunk) {
+      // keep the same amount of data in flight with the smaller chunks
+      window *= pool_chunk / chunk_size;
+    } else {
+      chunk_size = pool_chunk;
+    }
+  }
+}
+
+ParallelPipe::~ParallelPipe()
+{
+  std::unique_lock lock{mutex};
+  cond.wait(lock, [this] {
+      return std::all_of(jobs.begin(), jobs.end(),
+                         [] (const auto& job) { return job->done; });
+    });
+}
+
+void ParallelPipe::submit(bufferlist&& in, uint64_t offset)
+{
+  auto job = std::make_shared<Job>();
+  job->in = std::move(in);
+  job->offset = offset;
+  jobs.push_back(job);
+
+  pool->post([this, job] {
+      job->result = transform(job->in, job->offset, job->out);
+
+      std::unique_ptr<Completion> c;
+      {
+        std::lock_guard lock{mutex};
+        job->done = true;
+        if (waiting_for == job.get()) {
+          c = std::move(completion);
+        }
+        cond.notify_all();
+      }
+      if (c) {
+        ceph::async::post(std::move(c), boost::system::error_code{});
+      }
+    });
+}
+
+void ParallelPipe::wait(Job& job)
+{
+  std::unique_lock lock{mutex};
+#ifdef HAVE_BOOST_CONTEXT
+  if (y) {
+    // suspend the coroutine rather than block its thread
+    using Signature = void(boost::system::error_code);
+    while (!job.done) {
+      boost::system::error_code ec;
+      auto token = y.get_yield_context()[ec];
+      boost::asio::async_completion<decltype(token), Signature> init(token);
+      completion = Completion::create(y.get_io_context().get_executor(),
+                                      std::move(init.completion_handler));
+      waiting_for = &job;
+      lock.unlock();
+      init.result.get();
+      lock.lock();
+    }
+    waiting_for = nullptr;
+    return;
+  }
+#endif
+  cond.wait(lock, [&job] { return job.done; });
+}
+
+int ParallelPipe::complete_front()
+{
+  auto job = jobs.front();
+  wait(*job);
+  jobs.pop_front();
+
+  int r = commit(job->in, job->offset, job->out, job->result);
+  if (r < 0) {
+    return r;
+  }
+  return Pipe::process(std::move(job->out), job->offset);
+}
+
+int ParallelPipe::process(bufferlist&& data, uint64_t offset)
+{
+  // adjust the offset to the beginning of the pending data
+  ceph_assert(offset >= pending.length());
+  uint64_t position = offset - pending.length();
+
+  const bool flush = (data.length() == 0);
+  pending.claim_append(data);
+
+  if (!pool) {
+    while (pending.length() > 0) {
+      uint64_t size = flush ? pending.length() :
+          pending.length() / align * align;
+      if (chunk_size) {
+        if (!flush && pending.length() < chunk_size) {
+          break;
+        }
+        size = std::min(size, chunk_size);
+      }
+      if (size == 0) {
+        break;
+      }
+      bufferlist in, out;
+      pending.splice(0, size, &in);
+      int r = transform(in, position, out);
+      r = commit(in, position, out, r);
+      if (r < 0) {
+        return r;
+      }
+      r = Pipe::process(std::move(out), position);
+      if (r < 0) {
+        return r;
+      }
+      position += size;
+    }
+  } else {
+    while (pending.length() >= chunk_size || (flush && pending.length() > 0)) {
+      if (jobs.size() >= window) {
+        int r = complete_front();
+        if (r < 0) {
+          return r;
+        }
+      }
+      const uint64_t size = std::min<uint64_t>(chunk_size, pending.length());
+      bufferlist in;
+      pending.splice(0, size, &in);
+      submit(std::move(in), position);
+      position += size;
+    }
+
+    // pass on the chunks that are ready, or all of them on flush
+    while (!jobs.empty()) {
+      if (!flush) {
+        std::lock_guard lock{mutex};
+        if (!jobs.front()->done) {
+          break;
+        }
+      }
+      int r = complete_front();
+      if (r < 0) {
+        return r;
+      }
+    }
+  }
+
+  if (flush) {
+    return Pipe::process({}, offset);
+  }
+  return 0;
+}
+
+} // namespace rgw::putobj
@@ -0,0 +1,103 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+
+#include <boost/asio/thread_pool.hpp>
+
+#include "common/async/completion.h"
+#include "common/async/yield_context.h"
+#include "common/ceph_mutex.h"
+#include "rgw_putobj.h"
+
+class CephContext;
+
+namespace rgw::putobj {
+
+// the threads that ParallelPipes hand their chunks to, shared by all requests
+class TransformPool {
+  boost::asio::thread_pool pool;
+ public:
+  explicit TransformPool(size_t threads) : pool(threads) {}
+  ~TransformPool();
+
+  void post(std::function<void()>&& job);
+
+  // returns the pool of the context, or nullptr if rgw_put_obj_filter_threads
+  // is 0 and transforms run inline
+  static TransformPool* get(CephContext *cct);
+};
+
+// pipe that transforms its input one chunk at a time. with a TransformPool,
+// up to rgw_put_obj_filter_window chunks of rgw_max_chunk_size are
+// transformed at once on its threads, and the results are still passed on
+// to the next processor in order. without it, the input is transformed on the
+// calling thread as it arrives. a non-zero max_chunk caps the size of the
+// chunks, for transforms whose output is indexed by chunk
+class ParallelPipe : public Pipe {
+ public:
+  // transforms the chunk at the given offset. may run on any thread at the
+  // same time as the other chunks, so it can't touch the pipe
+  using Transform = std::function<int(bufferlist& in, uint64_t offset,
+                                      bufferlist& out)>;
+ private:
+  struct Job {
+    bufferlist in;
+    bufferlist out;
+    uint64_t offset = 0;
+    int result = 0;
+    bool done = false;
+  };
+  using Completion = ceph::async::Completion<void(boost::system::error_code)>;
+
+  const Transform transform;
+  TransformPool *pool;
+  const uint64_t align; // chunks other than the last are a multiple of this
+  uint64_t chunk_size = 0; // 0 for whatever arrives
+  size_t window = 0;
+  optional_yield y;
+
+  bufferlist pending; // input not yet handed to a transform
+
+  ceph::mutex mutex = ceph::make_mutex("ParallelPipe");
+  ceph::condition_variable cond;
+  std::deque<std::shared_ptr<Job>> jobs; // in offset order
+  Job *waiting_for = nullptr;
+  std::unique_ptr<Completion> completion; // wakes the coroutine waiting_for
+
+  void submit(bufferlist&& in, uint64_t offset);
+  void wait(Job& job);
+  int complete_front();
+
+ protected:
+  // called on the calling thread in offset order with the transform's
+  // result r, once all the chunks before it were passed on. leaves what to
+  // pass on in out
+  virtual int commit(bufferlist& in, uint64_t offset, bufferlist& out, int r) {
+    return r;
+  }
+
+ public:
+  ParallelPipe(CephContext *cct, DataProcessor *next, Transform&& transform,
+               uint64_t align, optional_yield y, uint64_t max_chunk = 0);
+  // waits for the transforms still running, i.e. after an error
+  ~ParallelPipe() override;
+
+  int process(bufferlist&& data, uint64_t offset) override;
+};
+
+} // namespace rgw::putobj
@@ -28,6 +28,7 @@
 #include "rgw_user.h"
 
 #include "services/svc_sys_obj.h"
+#include "services/svc_sys_obj_cache.h"
 
 #include <atomic>
 
@@ -47,6 +48,7 @@ protected:
   RGWRados *store;
   lru_map<T, RGWQuotaCacheStats> stats_map;
   RefCountedWaitObject *async_refcount;
+  std::atomic<bool> peer_updates{false};
 
   class StatsAsyncTestSet : public lru_map<T, RGWQuotaCacheStats>::UpdateContext {
     int objs_delta;
@@ -64,7 +66,7 @@ protected:
     }
   };
 
-  virtual int fetch_stats_from_storage(const rgw_user& user, const rgw_bucket& bucket, RGWStorageStats& stats) = 0;
+  virtual int fetch_stats_from_storage(const rgw_user& user, const rgw_bucket& bucket, RGWStorageStats& stats, optional_yield y) = 0;
 
   virtual bool map_find(const rgw_user& user, const rgw_bucket& bucket, RGWQuotaCacheStats& qs) = 0;
 
@@ -80,8 +82,14 @@ public:
     async_refcount->put_wait(); /* wait for all pending async requests to complete */
   }
 
-  int get_stats(const rgw_user& user, const rgw_bucket& bucket, RGWStorageStats& stats, RGWQuotaInfo& quota);
+  int get_stats(const rgw_user& user, const rgw_bucket& bucket, RGWStorageStats& stats, RGWQuotaInfo& quota, optional_yield y);
   void adjust_stats(const rgw_user& user, rgw_bucket& bucket, int objs_delta, uint64_t added_bytes, uint64_t removed_bytes);
+  /* applies the writes of another gateway, which it keeps the backend up to
+   * date with itself */
+  void adjust_cached_stats(const rgw_user& user, const rgw_bucket& bucket, int objs_delta, uint64_t added_bytes, uint64_t removed_bytes);
+  /* the other gateways push their writes, so cached stats only need to be
+   * fetched again once they expire */
+  void set_peer_updates(bool enabled) { peer_updates = enabled; }
 
   virtual bool can_use_cached_stats(RGWQuotaInfo& quota, RGWStorageStats& stats);
 
@@ -195,11 +203,11 @@ void RGWQuotaCache<T>::set_stats(const rgw_user& user, const rgw_bucket& bucket,
 }
 
 template<class T>
-int RGWQuotaCache<T>::get_stats(const rgw_user& user, const rgw_bucket& bucket, RGWStorageStats& stats, RGWQuotaInfo& quota) {
+int RGWQuotaCache<T>::get_stats(const rgw_user& user, const rgw_bucket& bucket, RGWStorageStats& stats, RGWQuotaInfo& quota, optional_yield y) {
   RGWQuotaCacheStats qs;
   utime_t now = ceph_clock_now();
   if (map_find(user, bucket, qs)) {
-    if (qs.async_refresh_time.sec() > 0 && now >= qs.async_refresh_time) {
+    if (!peer_updates && qs.async_refresh_time.sec() > 0 && now >= qs.async_refresh_time) {
       int r = async_refresh(user, bucket, qs);
       if (r < 0) {
         ldout(store->ctx(), 0) << "ERROR: quota async refresh returned ret=" << r << dendl;
@@ -215,7 +223,7 @@ int RGWQuotaCache<T>::get_stats(const rgw_user& user, const rgw_bucket& bucket,
     }
   }
 
-  int ret = fetch_stats_from_storage(user, bucket, stats);
+  int ret = fetch_stats_from_storage(user, bucket, stats, y);
   if (ret < 0 && ret != -ENOENT)
     return ret;
 
@@ -270,12 +278,19 @@ template<class T>
 void RGWQuotaCache<T>::adjust_stats(const rgw_user& user, rgw_bucket& bucket, int objs_delta,
                                  uint64_t added_bytes, uint64_t removed_bytes)
 {
-  RGWQuotaStatsUpdate<T> update(objs_delta, added_bytes, removed_bytes);
-  map_find_and_update(user, bucket, &update);
+  adjust_cached_stats(user, bucket, objs_delta, added_bytes, removed_bytes);
 
   data_modified(user, bucket);
 }
 
+template<class T>
+void RGWQuotaCache<T>::adjust_cached_stats(const rgw_user& user, const rgw_bucket& bucket, int objs_delta,
+                                           uint64_t added_bytes, uint64_t removed_bytes)
+{
+  RGWQuotaStatsUpdate<T> update(objs_delta, added_bytes, removed_bytes);
+  map_find_and_update(user, bucket, &update);
+}
+
 class BucketAsyncRefreshHandler : public RGWQuotaCache<rgw_bucket>::AsyncRefreshHandler,
                                   public RGWGetBucketStats_CB {
   rgw_user user;
@@ -350,7 +365,7 @@ protected:
     stats_map.add(bucket, qs);
   }
 
-  int fetch_stats_from_storage(const rgw_user& user, const rgw_bucket& bucket, RGWStorageStats& stats) override;
+  int fetch_stats_from_storage(const rgw_user& user, const rgw_bucket& bucket, RGWStorageStats& stats, optional_yield y) override;
 
 public:
   explicit RGWBucketStatsCache(RGWRados *_store) : RGWQuotaCache<rgw_bucket>(_store, _store->ctx()->_conf->rgw_bucket_quota_cache_size) {
@@ -361,13 +376,13 @@ public:
   }
 };
 
-int RGWBucketStatsCache::fetch_stats_from_storage(const rgw_user& user, const rgw_bucket& bucket, RGWStorageStats& stats)
+int RGWBucketStatsCache::fetch_stats_from_storage(const rgw_user& user, const rgw_bucket& bucket, RGWStorageStats& stats, optional_yield y)
 {
   RGWBucketInfo bucket_info;
 
   RGWSysObjectCtx obj_ctx = store->svc.sysobj->init_obj_ctx();
 
-  int r = store->get_bucket_instance_info(obj_ctx, bucket, bucket_info, NULL, NULL, null_yield);
+  int r = store->get_bucket_instance_info(obj_ctx, bucket, bucket_info, NULL, NULL, y);
   if (r < 0) {
     ldout(store->ctx(), 0) << "could not get bucket info for bucket=" << bucket << " r=" << r << dendl;
     return r;
@@ -378,7 +393,7 @@ int RGWBucketStatsCache::fetch_stats_from_storage(const rgw_user& user, const rg
 
   map<RGWObjCategory, RGWStorageStats> bucket_stats;
   r = store->get_bucket_stats(bucket_info, RGW_NO_SHARD, &bucket_ver,
-                                  &master_ver, bucket_stats, nullptr);
+                                  &master_ver, bucket_stats, nullptr, y);
   if (r < 0) {
     ldout(store->ctx(), 0) << "could not get bucket stats for bucket="
                            << bucket.name << dendl;
@@ -547,7 +562,7 @@ protected:
     stats_map.add(user, qs);
   }
 
-  int fetch_stats_from_storage(const rgw_user& user, const rgw_bucket& bucket, RGWStorageStats& stats) override;
+  int fetch_stats_from_storage(const rgw_user& user, const rgw_bucket& bucket, RGWStorageStats& stats, optional_yield y) override;
   int sync_bucket(const rgw_user& rgw_user, rgw_bucket& bucket);
   int sync_user(const rgw_user& user);
   int sync_all_users();
@@ -613,9 +628,9 @@ public:
   }
 };
 
-int RGWUserStatsCache::fetch_stats_from_storage(const rgw_user& user, const rgw_bucket& bucket, RGWStorageStats& stats)
+int RGWUserStatsCache::fetch_stats_from_storage(const rgw_user& user, const rgw_bucket& bucket, RGWStorageStats& stats, optional_yield y)
 {
-  int r = store->get_user_stats(user, stats);
+  int r = store->get_user_stats(user, stats, y);
   if (r < 0) {
     ldout(store->ctx(), 0) << "could not get user stats for user=" << user << dendl;
     return r;
@@ -649,7 +664,7 @@ int RGWUserStatsCache::sync_user(const rgw_user& user)
 {
   cls_user_header header;
   string user_str = user.to_str();
-  int ret = store->cls_user_get_header(user_str, &header);
+  int ret = store->cls_user_get_header(user_str, &header, null_yield);
   if (ret < 0) {
     ldout(store->ctx(), 5) << "ERROR: can't read user header: ret=" << ret << dendl;
     return ret;
@@ -881,11 +896,100 @@ const RGWQuotaInfoApplier& RGWQuotaInfoApplier::get_instance(
 }
 
 
-class RGWQuotaHandlerImpl : public RGWQuotaHandler {
+/* the writes a gateway made to a bucket since it last pushed them to the
+ * other gateways */
+struct rgw_quota_stats_delta {
+  rgw_user user;
+  rgw_bucket bucket;
+  int64_t objs_delta = 0;
+  uint64_t added_bytes = 0;
+  uint64_t removed_bytes = 0;
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(user, bl);
+    encode(bucket, bl);
+    encode(objs_delta, bl);
+    encode(added_bytes, bl);
+    encode(removed_bytes, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(bufferlist::const_iterator& bl) {
+    DECODE_START(1, bl);
+    decode(user, bl);
+    decode(bucket, bl);
+    decode(objs_delta, bl);
+    decode(added_bytes, bl);
+    decode(removed_bytes, bl);
+    DECODE_FINISH(bl);
+  }
+};
+WRITE_CLASS_ENCODER(rgw_quota_stats_delta)
+
+class RGWQuotaHandlerImpl : public RGWQuotaHandler,
+                            public RGWSI_SysObj_Cache_StatsCB {
   RGWRados *store;
   RGWBucketStatsCache bucket_stats_cache;
   RGWUserStatsCache user_stats_cache;
 
+  /* pushes the writes of this gateway to the others every
+   * rgw_quota_stats_notify_interval, so that their cached stats stay current
+   * without fetching the bucket index headers */
+  class StatsNotifyThread : public Thread {
+    RGWQuotaHandlerImpl *handler;
+    Mutex lock;
+    Cond cond;
+    bool stopping = false;
+  public:
+    explicit StatsNotifyThread(RGWQuotaHandlerImpl *_h) : handler(_h), lock("RGWQuotaHandlerImpl::StatsNotifyThread") {}
+
+    void *entry() override {
+      CephContext *cct = handler->store->ctx();
+      Mutex::Locker l(lock);
+      while (!stopping) {
+        utime_t interval;
+        interval.set_from_double(cct->_conf.get_val<double>("rgw_quota_stats_notify_interval"));
+        cond.WaitInterval(lock, interval);
+        lock.Unlock();
+        handler->notify_stats();
+        lock.Lock();
+      }
+      return NULL;
+    }
+
+    void stop() {
+      Mutex::Locker l(lock);
+      stopping = true;
+      cond.Signal();
+    }
+  };
+
+  uint64_t instance_id = 0; // tells our own notifications apart
+  Mutex deltas_lock{"RGWQuotaHandlerImpl::deltas_lock"};
+  map<rgw_bucket, rgw_quota_stats_delta> deltas;
+  StatsNotifyThread *notify_thread = nullptr;
+
+  void notify_stats() {
+    map<rgw_bucket, rgw_quota_stats_delta> out;
+    deltas_lock.Lock();
+    out.swap(deltas);
+    deltas_lock.Unlock();
+    if (out.empty()) {
+      return;
+    }
+
+    bufferlist bl;
+    encode(instance_id, bl);
+    encode((uint32_t)out.size(), bl);
+    for (const auto& i : out) {
+      encode(i.second, bl);
+    }
+    int r = store->svc.cache->distribute_stats(bl, null_yield);
+    if (r < 0) {
+      ldout(store->ctx(), 0) << "WARNING: failed to distribute quota stats: r=" << r << dendl;
+    }
+  }
+
   int check_quota(const char * const entity,
                   const RGWQuotaInfo& quota,
                   const RGWStorageStats& stats,
@@ -918,14 +1022,56 @@ class RGWQuotaHandlerImpl : public RGWQuotaHandler {
 public:
   RGWQuotaHandlerImpl(RGWRados *_store, bool quota_threads) : store(_store),
                                     bucket_stats_cache(_store),
-                                    user_stats_cache(_store, quota_threads) {}
+                                    user_stats_cache(_store, quota_threads) {
+    if (quota_threads && store->svc.cache &&
+        store->ctx()->_conf.get_val<double>("rgw_quota_stats_notify_interval") > 0) {
+      store->ctx()->random()->get_bytes(reinterpret_cast<char*>(&instance_id),
+                                        sizeof(instance_id));
+      bucket_stats_cache.set_peer_updates(true);
+      user_stats_cache.set_peer_updates(true);
+      store->svc.cache->set_stats_cb(this);
+      notify_thread = new StatsNotifyThread(this);
+      notify_thread->create("rgw_quota_ntfy");
+    }
+  }
+  ~RGWQuotaHandlerImpl() override {
+    if (notify_thread) {
+      store->svc.cache->set_stats_cb(nullptr);
+      notify_thread->stop();
+      notify_thread->join();
+      delete notify_thread;
+    }
+  }
+
+  void handle_stats(bufferlist& bl) override {
+    uint64_t sender;
+    uint32_t count;
+    try {
+      auto p = bl.cbegin();
+      decode(sender, p);
+      if (sender == instance_id) {
+        return;
+      }
+      decode(count, p);
+      for (uint32_t i = 0; i < count; i++) {
+        rgw_quota_stats_delta d;
+        decode(d, p);
+        bucket_stats_cache.adjust_cached_stats(d.user, d.bucket, d.objs_delta,
+                                               d.added_bytes, d.removed_bytes);
+        user_stats_cache.adjust_cached_stats(d.user, d.bucket, d.objs_delta,
+                                             d.added_bytes, d.removed_bytes);
+      }
+    } catch (buffer::error& err) {
+      ldout(store->ctx(), 0) << "ERROR: failed to decode quota stats notification" << dendl;
+    }
+  }
 
   int check_quota(const rgw_user& user,
                           rgw_bucket& bucket,
                           RGWQuotaInfo& user_quota,
                           RGWQuotaInfo& bucket_quota,
                           uint64_t num_objs,
-                          uint64_t size) override {
+                          uint64_t size, optional_yield y) override {
 
     if (!bucket_quota.enabled && !user_quota.enabled) {
       return 0;
@@ -941,7 +1087,7 @@ public:
     if (bucket_quota.enabled) {
       RGWStorageStats bucket_stats;
       int ret = bucket_stats_cache.get_stats(user, bucket, bucket_stats,
-                                           bucket_quota);
+                                           bucket_quota, y);
       if (ret < 0) {
         return ret;
       }
@@ -953,7 +1099,7 @@ public:
 
     if (user_quota.enabled) {
       RGWStorageStats user_stats;
-      int ret = user_stats_cache.get_stats(user, bucket, user_stats, user_quota);
+      int ret = user_stats_cache.get_stats(user, bucket, user_stats, user_quota, y);
       if (ret < 0) {
         return ret;
       }
@@ -968,6 +1114,18 @@ public:
   void update_stats(const rgw_user& user, rgw_bucket& bucket, int obj_delta, uint64_t added_bytes, uint64_t removed_bytes) override {
     bucket_stats_cache.adjust_stats(user, bucket, obj_delta, added_bytes, removed_bytes);
     user_stats_cache.adjust_stats(user, bucket, obj_delta, added_bytes, removed_bytes);
+
+    if (notify_thread) {
+      Mutex::Locker l(deltas_lock);
+      auto& d = deltas[bucket];
+      if (d.bucket.name.empty()) {
+        d.user = user;
+        d.bucket = bucket;
+      }
+      d.objs_delta += obj_delta;
+      d.added_bytes += added_bytes;
+      d.removed_bytes += removed_bytes;
+    }
   }
 
   int check_bucket_shards(uint64_t max_objs_per_shard, uint64_t num_shards,
@@ -976,7 +1134,7 @@ public:
   {
     RGWStorageStats bucket_stats;
     int ret = bucket_stats_cache.get_stats(user, bucket, bucket_stats,
-                                           bucket_quota);
+                                           bucket_quota, null_yield);
     if (ret < 0) {
       return ret;
     }
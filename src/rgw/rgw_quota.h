@@ -28,6 +28,7 @@ static inline int64_t rgw_rounded_kb(int64_t bytes)
 }
 
 class RGWRados;
+class optional_yield;
 class JSONObj;
 
 struct RGWQuotaInfo {
@@ -103,7 +104,7 @@ public:
   }
   virtual int check_quota(const rgw_user& bucket_owner, rgw_bucket& bucket,
                           RGWQuotaInfo& user_quota, RGWQuotaInfo& bucket_quota,
-			  uint64_t num_objs, uint64_t size) = 0;
+			  uint64_t num_objs, uint64_t size, optional_yield y) = 0;
 
   virtual int check_bucket_shards(uint64_t max_objs_per_shard, uint64_t num_shards,
 				  const rgw_user& bucket_owner, const rgw_bucket& bucket,
@@ -22,6 +22,7 @@
 #include "rgw_rados.h"
 #include "rgw_zone.h"
 #include "rgw_cache.h"
+#include "rgw_datacache.h"
 #include "rgw_acl.h"
 #include "rgw_acl_s3.h" /* for dumping s3policy in debug log */
 #include "rgw_aio_throttle.h"
@@ -1343,6 +1344,9 @@ void RGWRados::finalize()
 
   svc.shutdown();
 
+  delete datacache;
+  datacache = nullptr;
+
   delete meta_mgr;
   delete binfo_cache;
   delete obj_tombstone_cache;
@@ -1625,6 +1629,16 @@ int RGWRados::init_complete()
 
   index_completion_manager = new RGWIndexCompletionManager(this);
   ret = index_completion_manager->start();
+  if (ret < 0)
+    return ret;
+
+  if (cct->_conf.get_val<bool>("rgw_datacache_enabled")) {
+    datacache = new RGWDataCache(cct);
+    ret = datacache->init();
+    if (ret < 0) {
+      return ret;
+    }
+  }
 
   return ret;
 }
@@ -6729,11 +6743,23 @@ struct get_obj_data {
   uint64_t offset; // next offset to write to client
   rgw::AioResultList completed; // completed read results, sorted by offset
   optional_yield yield;
+  RGWDataCache* datacache = nullptr;
+  // reads to copy into the data cache once they complete, by result id
+  std::map<uint64_t, std::pair<rgw_raw_obj, uint64_t>> fills;
 
   get_obj_data(RGWRados* store, RGWGetDataCB* cb, rgw::Aio* aio,
                uint64_t offset, optional_yield yield)
     : store(store), client_cb(cb), aio(aio), offset(offset), yield(yield) {}
 
+  void fill_cache(uint64_t id, const bufferlist& bl) {
+    auto i = fills.find(id);
+    if (i == fills.end()) {
+      return;
+    }
+    datacache->put(i->second.first, i->second.second, bl.length(), bl);
+    fills.erase(i);
+  }
+
   int flush(rgw::AioResultList&& results) {
     int r = rgw::check_for_errors(results);
     if (r < 0) {
@@ -6747,6 +6773,9 @@ struct get_obj_data {
     while (!completed.empty() && completed.front().id == offset) {
       auto bl = std::move(completed.front().data);
       completed.pop_front_and_dispose(std::default_delete<rgw::AioResultEntry>{});
+      if (!fills.empty()) {
+        fill_cache(offset, bl);
+      }
 
       offset += bl.length();
       int r = client_cb->handle_data(bl, 0, bl.length());
@@ -6824,12 +6853,25 @@ int RGWRados::get_obj_iterate_cb(const rgw_raw_obj& read_obj, off_t obj_ofs,
     return r;
   }
 
-  ldout(cct, 20) << "rados->get_obj_iterate_cb oid=" << read_obj.oid << " obj-ofs=" << obj_ofs << " read_ofs=" << read_ofs << " len=" << len << dendl;
-  op.read(read_ofs, len, nullptr, nullptr);
-
   const uint64_t cost = len;
   const uint64_t id = obj_ofs; // use logical object offset for sorting replies
 
+  // head objects are rewritten in place, only the tail stripes are cached
+  if (d->datacache && !is_head_obj) {
+    auto c = std::make_unique<rgw::AioResultEntry>();
+    if (d->datacache->get(read_obj, read_ofs, len, &c->data)) {
+      ldout(cct, 20) << "datacache hit oid=" << read_obj.oid << " obj-ofs=" << obj_ofs << " read_ofs=" << read_ofs << " len=" << len << dendl;
+      c->id = id;
+      rgw::AioResultList completed;
+      completed.push_back(*c.release());
+      return d->flush(std::move(completed));
+    }
+    d->fills[id] = {read_obj, read_ofs};
+  }
+
+  ldout(cct, 20) << "rados->get_obj_iterate_cb oid=" << read_obj.oid << " obj-ofs=" << obj_ofs << " read_ofs=" << read_ofs << " len=" << len << dendl;
+  op.read(read_ofs, len, nullptr, nullptr);
+
   auto completed = d->aio->get(obj, rgw::Aio::librados_op(std::move(op), d->yield), cost, id);
 
   return d->flush(std::move(completed));
@@ -6846,6 +6888,7 @@ int RGWRados::Object::Read::iterate(int64_t ofs, int64_t end, RGWGetDataCB *cb,
 
   auto aio = rgw::make_throttle(window_size, y);
   get_obj_data data(store, cb, &*aio, ofs, y);
+  data.datacache = store->datacache;
 
   int r = store->iterate_obj(obj_ctx, source->get_bucket_info(), state.obj,
                              ofs, end, chunk_size, _get_obj_iterate_cb, &data);
@@ -7117,7 +7160,7 @@ int RGWRados::block_while_resharding(RGWRados::BucketShard *bs,
     [this, bucket_info](const std::string& log_tag,
 			std::string* new_bucket_id) -> int {
       RGWBucketInfo fresh_bucket_info = bucket_info;
-      int ret = try_refresh_bucket_info(fresh_bucket_info, nullptr);
+      int ret = try_refresh_bucket_info(fresh_bucket_info, nullptr, null_yield);
       if (ret < 0) {
 	ldout(cct, 0) << __func__ <<
 	  " ERROR: failed to refresh bucket info after reshard at " <<
@@ -7202,13 +7245,59 @@ int RGWRados::block_while_resharding(RGWRados::BucketShard *bs,
   return -ERR_BUSY_RESHARDING;
 }
 
+/*
+ * apply an olh modification to the bucket index shard. if log_ret is given,
+ * the olh log is read back within the same round trip: the read is ordered
+ * after the write, so it already includes the entry the write added. the
+ * log is only valid when *have_log is set, a failed read is not an error as
+ * update_olh() can still read the log on its own.
+ */
+static int olh_index_operate(librados::IoCtx& ioctx, const string& oid,
+                             librados::ObjectWriteOperation& op,
+                             const cls_rgw_obj_key& olh_key, const string& olh_tag,
+                             rgw_cls_read_olh_log_ret *log_ret, bool *have_log)
+{
+  if (!log_ret) {
+    return ioctx.operate(oid, &op);
+  }
+  *have_log = false;
+  *log_ret = rgw_cls_read_olh_log_ret();
+
+  librados::ObjectReadOperation rop;
+  cls_rgw_guard_bucket_resharding(rop, -ERR_BUSY_RESHARDING);
+  int log_op_ret = 0;
+  cls_rgw_get_olh_log(rop, olh_key, 0, olh_tag, *log_ret, log_op_ret);
+
+  AioCompletion *wc = librados::Rados::aio_create_completion(NULL, NULL, NULL);
+  int r = ioctx.aio_operate(oid, wc, &op);
+  if (r < 0) {
+    wc->release();
+    return r;
+  }
+  AioCompletion *rc = librados::Rados::aio_create_completion(NULL, NULL, NULL);
+  int rr = ioctx.aio_operate(oid, rc, &rop, librados::OPERATION_ORDER_READS_WRITES, NULL);
+
+  wc->wait_for_complete();
+  r = wc->get_return_value();
+  wc->release();
+  if (rr >= 0) {
+    rc->wait_for_complete();
+    rr = rc->get_return_value();
+  }
+  rc->release();
+
+  *have_log = (r >= 0 && rr >= 0 && log_op_ret >= 0);
+  return r;
+}
+
 int RGWRados::bucket_index_link_olh(const RGWBucketInfo& bucket_info, RGWObjState& olh_state, const rgw_obj& obj_instance,
                                     bool delete_marker,
                                     const string& op_tag,
                                     struct rgw_bucket_dir_entry_meta *meta,
                                     uint64_t olh_epoch,
                                     real_time unmod_since, bool high_precision_time,
-                                    rgw_zone_set *_zones_trace, bool log_data_change)
+                                    rgw_zone_set *_zones_trace, bool log_data_change,
+                                    rgw_cls_read_olh_log_ret *log_ret, bool *have_log)
 {
   rgw_rados_ref ref;
   int r = get_obj_head_ref(bucket_info, obj_instance, &ref);
@@ -7225,14 +7314,17 @@ int RGWRados::bucket_index_link_olh(const RGWBucketInfo& bucket_info, RGWObjStat
   BucketShard bs(this);
 
   cls_rgw_obj_key key(obj_instance.key.get_index_key_name(), obj_instance.key.instance);
+  cls_rgw_obj_key olh_key(obj_instance.key.get_index_key_name(), string());
+  string olh_tag = rgw_bl_str(olh_state.olh_tag);
   r = guard_reshard(&bs, obj_instance, bucket_info,
 		    [&](BucketShard *bs) -> int {
 		      librados::ObjectWriteOperation op;
 		      cls_rgw_guard_bucket_resharding(op, -ERR_BUSY_RESHARDING);
-		      return cls_rgw_bucket_link_olh(bs->index_ctx, op,
-						     bs->bucket_obj, key, olh_state.olh_tag, delete_marker, op_tag, meta, olh_epoch,
-						     unmod_since, high_precision_time,
-						     svc.zone->get_zone().log_data, zones_trace);
+		      cls_rgw_bucket_link_olh(op, key, olh_state.olh_tag, delete_marker, op_tag, meta, olh_epoch,
+					      unmod_since, high_precision_time,
+					      svc.zone->get_zone().log_data, zones_trace);
+		      return olh_index_operate(bs->index_ctx, bs->bucket_obj, op,
+					       olh_key, olh_tag, log_ret, have_log);
                     });
   if (r < 0) {
     ldout(cct, 20) << "cls_rgw_bucket_link_olh() returned r=" << r << dendl;
@@ -7253,7 +7345,8 @@ void RGWRados::bucket_index_guard_olh_op(RGWObjState& olh_state, ObjectOperation
 }
 
 int RGWRados::bucket_index_unlink_instance(const RGWBucketInfo& bucket_info, const rgw_obj& obj_instance,
-                                           const string& op_tag, const string& olh_tag, uint64_t olh_epoch, rgw_zone_set *_zones_trace)
+                                           const string& op_tag, const string& olh_tag, uint64_t olh_epoch, rgw_zone_set *_zones_trace,
+                                           rgw_cls_read_olh_log_ret *log_ret, bool *have_log)
 {
   rgw_rados_ref ref;
   int r = get_obj_head_ref(bucket_info, obj_instance, &ref);
@@ -7270,12 +7363,15 @@ int RGWRados::bucket_index_unlink_instance(const RGWBucketInfo& bucket_info, con
   BucketShard bs(this);
 
   cls_rgw_obj_key key(obj_instance.key.get_index_key_name(), obj_instance.key.instance);
+  cls_rgw_obj_key olh_key(obj_instance.key.get_index_key_name(), string());
   r = guard_reshard(&bs, obj_instance, bucket_info,
 		    [&](BucketShard *bs) -> int {
 		      librados::ObjectWriteOperation op;
 		      cls_rgw_guard_bucket_resharding(op, -ERR_BUSY_RESHARDING);
-		      return cls_rgw_bucket_unlink_instance(bs->index_ctx, op, bs->bucket_obj, key, op_tag,
-							    olh_tag, olh_epoch, svc.zone->get_zone().log_data, zones_trace);
+		      cls_rgw_bucket_unlink_instance(op, key, op_tag, olh_tag, olh_epoch,
+						     svc.zone->get_zone().log_data, zones_trace);
+		      return olh_index_operate(bs->index_ctx, bs->bucket_obj, op,
+					       olh_key, olh_tag, log_ret, have_log);
                     });
   if (r < 0) {
     ldout(cct, 20) << "cls_rgw_bucket_link_olh() returned r=" << r << dendl;
@@ -7378,7 +7474,8 @@ int RGWRados::repair_olh(RGWObjState* state, const RGWBucketInfo& bucket_info,
   return 0;
 }
 
-int RGWRados::bucket_index_trim_olh_log(const RGWBucketInfo& bucket_info, RGWObjState& state, const rgw_obj& obj_instance, uint64_t ver)
+int RGWRados::bucket_index_trim_olh_log(const RGWBucketInfo& bucket_info, RGWObjState& state, const rgw_obj& obj_instance, uint64_t ver,
+                                        bool async)
 {
   rgw_rados_ref ref;
   int r = get_obj_head_ref(bucket_info, obj_instance, &ref);
@@ -7403,6 +7500,12 @@ int RGWRados::bucket_index_trim_olh_log(const RGWBucketInfo& bucket_info, RGWObj
 			ObjectWriteOperation op;
 			cls_rgw_guard_bucket_resharding(op, -ERR_BUSY_RESHARDING);
 			cls_rgw_trim_olh_log(op, key, ver, olh_tag);
+			if (async) {
+			  AioCompletion *c = librados::Rados::aio_create_completion(NULL, NULL, NULL);
+			  int r = pbs->index_ctx.aio_operate(pbs->bucket_obj, c, &op);
+			  c->release();
+			  return r;
+			}
 			return pbs->index_ctx.operate(pbs->bucket_obj, &op);
                       });
   if (ret < 0) {
@@ -7545,7 +7648,12 @@ int RGWRados::apply_olh_log(RGWObjectCtx& obj_ctx, RGWObjState& state, const RGW
     return r;
   }
 
-  r = bucket_index_trim_olh_log(bucket_info, state, obj, last_ver);
+  /*
+   * the trim only drops entries that are already applied, and a later trim
+   * takes care of them if this one is lost. don't wait for it unless the
+   * olh entry is about to be cleared
+   */
+  r = bucket_index_trim_olh_log(bucket_info, state, obj, last_ver, !need_to_remove);
   if (r < 0) {
     ldout(cct, 0) << "ERROR: could not trim olh log, r=" << r << dendl;
     return r;
@@ -7580,18 +7688,26 @@ int RGWRados::apply_olh_log(RGWObjectCtx& obj_ctx, RGWObjState& state, const RGW
 /*
  * read olh log and apply it
  */
-int RGWRados::update_olh(RGWObjectCtx& obj_ctx, RGWObjState *state, const RGWBucketInfo& bucket_info, const rgw_obj& obj, rgw_zone_set *zones_trace)
+int RGWRados::update_olh(RGWObjectCtx& obj_ctx, RGWObjState *state, const RGWBucketInfo& bucket_info, const rgw_obj& obj, rgw_zone_set *zones_trace,
+                         rgw_cls_read_olh_log_ret *first_log)
 {
   map<uint64_t, vector<rgw_bucket_olh_log_entry> > log;
   bool is_truncated;
   uint64_t ver_marker = 0;
 
   do {
-    int ret = bucket_index_read_olh_log(bucket_info, *state, obj, ver_marker, &log, &is_truncated);
-    if (ret < 0) {
-      return ret;
+    if (first_log) {
+      /* already read along with the index modification */
+      log.swap(first_log->log);
+      is_truncated = first_log->is_truncated;
+      first_log = nullptr;
+    } else {
+      int ret = bucket_index_read_olh_log(bucket_info, *state, obj, ver_marker, &log, &is_truncated);
+      if (ret < 0) {
+        return ret;
+      }
     }
-    ret = apply_olh_log(obj_ctx, *state, bucket_info, obj, state->olh_tag, log, &ver_marker, zones_trace);
+    int ret = apply_olh_log(obj_ctx, *state, bucket_info, obj, state->olh_tag, log, &ver_marker, zones_trace);
     if (ret < 0) {
       return ret;
     }
@@ -7610,6 +7726,8 @@ int RGWRados::set_olh(RGWObjectCtx& obj_ctx, RGWBucketInfo& bucket_info, const r
   olh_obj.key.instance.clear();
 
   RGWObjState *state = NULL;
+  rgw_cls_read_olh_log_ret olh_log;
+  bool have_log = false;
 
   int ret = 0;
   int i;
@@ -7635,7 +7753,7 @@ int RGWRados::set_olh(RGWObjectCtx& obj_ctx, RGWBucketInfo& bucket_info, const r
     }
     ret = bucket_index_link_olh(bucket_info, *state, target_obj, delete_marker,
                                 op_tag, meta, olh_epoch, unmod_since, high_precision_time,
-                                zones_trace, log_data_change);
+                                zones_trace, log_data_change, &olh_log, &have_log);
     if (ret < 0) {
       ldout(cct, 20) << "bucket_index_link_olh() target_obj=" << target_obj << " delete_marker=" << (int)delete_marker << " returned " << ret << dendl;
       if (ret == -ECANCELED) {
@@ -7657,7 +7775,8 @@ int RGWRados::set_olh(RGWObjectCtx& obj_ctx, RGWBucketInfo& bucket_info, const r
     return -EIO;
   }
 
-  ret = update_olh(obj_ctx, state, bucket_info, olh_obj);
+  ret = update_olh(obj_ctx, state, bucket_info, olh_obj, nullptr,
+                   (have_log ? &olh_log : nullptr));
   if (ret == -ECANCELED) { /* already did what we needed, no need to retry, raced with another user */
     ret = 0;
   }
@@ -7678,6 +7797,8 @@ int RGWRados::unlink_obj_instance(RGWObjectCtx& obj_ctx, RGWBucketInfo& bucket_i
   olh_obj.key.instance.clear();
 
   RGWObjState *state = NULL;
+  rgw_cls_read_olh_log_ret olh_log;
+  bool have_log = false;
 
   int ret = 0;
   int i;
@@ -7702,7 +7823,8 @@ int RGWRados::unlink_obj_instance(RGWObjectCtx& obj_ctx, RGWBucketInfo& bucket_i
 
     string olh_tag(state->olh_tag.c_str(), state->olh_tag.length());
 
-    ret = bucket_index_unlink_instance(bucket_info, target_obj, op_tag, olh_tag, olh_epoch, zones_trace);
+    ret = bucket_index_unlink_instance(bucket_info, target_obj, op_tag, olh_tag, olh_epoch, zones_trace,
+                                       &olh_log, &have_log);
     if (ret < 0) {
       ldout(cct, 20) << "bucket_index_unlink_instance() target_obj=" << target_obj << " returned " << ret << dendl;
       if (ret == -ECANCELED) {
@@ -7718,7 +7840,8 @@ int RGWRados::unlink_obj_instance(RGWObjectCtx& obj_ctx, RGWBucketInfo& bucket_i
     return -EIO;
   }
 
-  ret = update_olh(obj_ctx, state, bucket_info, olh_obj, zones_trace);
+  ret = update_olh(obj_ctx, state, bucket_info, olh_obj, zones_trace,
+                   (have_log ? &olh_log : nullptr));
   if (ret == -ECANCELED) { /* already did what we needed, no need to retry, raced with another user */
     return 0;
   }
@@ -7936,11 +8059,11 @@ int RGWRados::raw_obj_stat(rgw_raw_obj& obj, uint64_t *psize, real_time *pmtime,
 }
 
 int RGWRados::get_bucket_stats(RGWBucketInfo& bucket_info, int shard_id, string *bucket_ver, string *master_ver,
-    map<RGWObjCategory, RGWStorageStats>& stats, string *max_marker, bool *syncstopped)
+    map<RGWObjCategory, RGWStorageStats>& stats, string *max_marker, optional_yield y, bool *syncstopped)
 {
   vector<rgw_bucket_dir_header> headers;
   map<int, string> bucket_instance_ids;
-  int r = cls_bucket_head(bucket_info, shard_id, headers, &bucket_instance_ids);
+  int r = cls_bucket_head(bucket_info, shard_id, headers, y, &bucket_instance_ids);
   if (r < 0) {
     return r;
   }
@@ -7980,7 +8103,7 @@ int RGWRados::get_bi_log_status(RGWBucketInfo& bucket_info, int shard_id,
 {
   vector<rgw_bucket_dir_header> headers;
   map<int, string> bucket_instance_ids;
-  int r = cls_bucket_head(bucket_info, shard_id, headers, &bucket_instance_ids);
+  int r = cls_bucket_head(bucket_info, shard_id, headers, null_yield, &bucket_instance_ids);
   if (r < 0)
     return r;
 
@@ -8079,12 +8202,13 @@ public:
   }
 };
 
-int RGWRados::get_user_stats(const rgw_user& user, RGWStorageStats& stats)
+int RGWRados::get_user_stats(const rgw_user& user, RGWStorageStats& stats,
+                             optional_yield y)
 {
   string user_str = user.to_str();
 
   cls_user_header header;
-  int r = cls_user_get_header(user_str, &header);
+  int r = cls_user_get_header(user_str, &header, y);
   if (r < 0)
     return r;
 
@@ -8192,6 +8316,7 @@ int RGWRados::get_bucket_entrypoint_info(RGWSysObjectCtx& obj_ctx,
                                          RGWObjVersionTracker *objv_tracker,
                                          real_time *pmtime,
                                          map<string, bufferlist> *pattrs,
+                                         optional_yield y,
                                          rgw_cache_entry_info *cache_info,
 					 boost::optional<obj_version> refresh_version)
 {
@@ -8200,7 +8325,7 @@ int RGWRados::get_bucket_entrypoint_info(RGWSysObjectCtx& obj_ctx,
 
   rgw_make_bucket_entry_name(tenant_name, bucket_name, bucket_entry);
   int ret = rgw_get_system_obj(this, obj_ctx, svc.zone->get_zone_params().domain_root,
-			       bucket_entry, bl, objv_tracker, pmtime, null_yield, pattrs,
+			       bucket_entry, bl, objv_tracker, pmtime, y, pattrs,
 			       cache_info, refresh_version);
   if (ret < 0) {
     return ret;
@@ -8228,7 +8353,7 @@ int RGWRados::convert_old_bucket_info(RGWSysObjectCtx& obj_ctx,
 
   ldout(cct, 10) << "RGWRados::convert_old_bucket_info(): bucket=" << bucket_name << dendl;
 
-  int ret = get_bucket_entrypoint_info(obj_ctx, tenant_name, bucket_name, entry_point, &ot, &ep_mtime, &attrs);
+  int ret = get_bucket_entrypoint_info(obj_ctx, tenant_name, bucket_name, entry_point, &ot, &ep_mtime, &attrs, null_yield);
   if (ret < 0) {
     ldout(cct, 0) << "ERROR: get_bucket_entrypoint_info() returned " << ret << " bucket=" << bucket_name << dendl;
     return ret;
@@ -8290,7 +8415,7 @@ int RGWRados::_get_bucket_info(RGWSysObjectCtx& obj_ctx,
   RGWObjVersionTracker ot;
   rgw_cache_entry_info entry_cache_info;
   int ret = get_bucket_entrypoint_info(obj_ctx, tenant, bucket_name,
-				       entry_point, &ot, &ep_mtime, pattrs,
+				       entry_point, &ot, &ep_mtime, pattrs, y,
 				       &entry_cache_info, refresh_version);
   if (ret < 0) {
     /* only init these fields */
@@ -8369,12 +8494,13 @@ int RGWRados::get_bucket_info(RGWSysObjectCtx& obj_ctx,
 
 int RGWRados::try_refresh_bucket_info(RGWBucketInfo& info,
                                       ceph::real_time *pmtime,
+                                      optional_yield y,
                                       map<string, bufferlist> *pattrs)
 {
   RGWSysObjectCtx obj_ctx = svc.sysobj->init_obj_ctx();
 
   return _get_bucket_info(obj_ctx, info.bucket.tenant, info.bucket.name,
-                          info, pmtime, pattrs, info.objv_tracker.read_version, null_yield);
+                          info, pmtime, pattrs, info.objv_tracker.read_version, y);
 }
 
 int RGWRados::put_bucket_entrypoint_info(const string& tenant_name, const string& bucket_name, RGWBucketEntryPoint& entry_point,
@@ -8466,7 +8592,7 @@ int RGWRados::update_containers_stats(map<string, RGWBucketEnt>& m)
       return ret;
     }
 
-    int r = cls_bucket_head(bucket_info, RGW_NO_SHARD, headers);
+    int r = cls_bucket_head(bucket_info, RGW_NO_SHARD, headers, null_yield);
     if (r < 0)
       return r;
 
@@ -9088,6 +9214,9 @@ int RGWRados::cls_obj_set_bucket_tag_timeout(RGWBucketInfo& bucket_info, uint64_
 }
 
 
+// the least number of entries an ordered listing asks from each shard
+static constexpr uint32_t MIN_LIST_ENTRIES_PER_SHARD = 8;
+
 int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
 				      int shard_id,
 				      const rgw_obj_index_key& start,
@@ -9113,8 +9242,16 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
   if (r < 0)
     return r;
 
+  // Rather than asking every shard for a whole page, start with a share of
+  // it and read more from the shards that run out while the page is being
+  // merged. Only those shards contribute to the page, so on buckets with
+  // many shards this avoids fetching (and decoding) shards x num_entries.
+  const uint32_t num_shards = oids.size();
+  const uint32_t per_shard = std::min(num_entries,
+    std::max(MIN_LIST_ENTRIES_PER_SHARD, num_entries * 2 / num_shards));
+
   cls_rgw_obj_key start_key(start.name, start.instance);
-  r = CLSRGWIssueBucketList(index_ctx, start_key, prefix, num_entries,
+  r = CLSRGWIssueBucketList(index_ctx, start_key, prefix, per_shard,
 			    list_versions, oids, list_results,
 			    cct->_conf->rgw_bucket_index_max_aio)();
   if (r < 0)
@@ -9124,16 +9261,63 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
   vector<map<string, struct rgw_bucket_dir_entry>::iterator> vcurrents;
   vector<map<string, struct rgw_bucket_dir_entry>::iterator> vends;
   vector<string> vnames;
+  vector<int> vshards;
+  // the number of entries last requested from each shard
+  vector<uint32_t> vfetch(list_results.size(), per_shard);
   vcurrents.reserve(list_results.size());
   vends.reserve(list_results.size());
   vnames.reserve(list_results.size());
+  vshards.reserve(list_results.size());
   map<int, struct rgw_cls_list_ret>::iterator iter = list_results.begin();
-  *is_truncated = false;
   for (; iter != list_results.end(); ++iter) {
     vcurrents.push_back(iter->second.dir.m.begin());
     vends.push_back(iter->second.dir.m.end());
     vnames.push_back(oids[iter->first]);
-    *is_truncated = (*is_truncated || iter->second.is_truncated);
+    vshards.push_back(iter->first);
+  }
+
+  // read the next batch from the shard at pos, which ran out of entries
+  // after key; a shard that drains while truncated has to be refilled
+  // before anything past its last entry can be selected
+  auto refill = [&](size_t pos, const cls_rgw_obj_key& key) {
+    const int shard = vshards[pos];
+    vfetch[pos] = std::min(num_entries, vfetch[pos] * 2);
+    map<int, string> shard_oid{{shard, vnames[pos]}};
+    map<int, struct rgw_cls_list_ret> shard_result;
+    int ret = CLSRGWIssueBucketList(index_ctx, key, prefix, vfetch[pos],
+				    list_versions, shard_oid, shard_result,
+				    1)();
+    if (ret < 0) {
+      return ret;
+    }
+    ldout(cct, 20) << "RGWRados::cls_bucket_list_ordered: read "
+		   << shard_result[shard].dir.m.size() << " more from shard "
+		   << shard << dendl;
+    list_results[shard] = std::move(shard_result[shard]);
+    vcurrents[pos] = list_results[shard].dir.m.begin();
+    vends[pos] = list_results[shard].dir.m.end();
+    return 0;
+  };
+  // a batch of entries that the shard filtered out comes back empty but
+  // truncated, keep growing it until something turns up
+  auto refill_nonempty = [&](size_t pos, const cls_rgw_obj_key& key) {
+    do {
+      int ret = refill(pos, key);
+      if (ret < 0) {
+	return ret;
+      }
+    } while (vcurrents[pos] == vends[pos] &&
+	     list_results[vshards[pos]].is_truncated &&
+	     vfetch[pos] < num_entries);
+    return 0;
+  };
+
+  for (size_t i = 0; i < vcurrents.size(); ++i) {
+    if (vcurrents[i] == vends[i] && list_results[vshards[i]].is_truncated) {
+      r = refill_nonempty(i, start_key);
+      if (r < 0)
+	return r;
+    }
   }
 
   // Create a map to track the next candidate entry from each shard, if the entry
@@ -9155,6 +9339,12 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
     const string& name = vcurrents[pos]->first;
     struct rgw_bucket_dir_entry& dirent = vcurrents[pos]->second;
 
+    std::optional<cls_rgw_obj_key> refill_key;
+    if (std::next(vcurrents[pos]) == vends[pos] &&
+	list_results[vshards[pos]].is_truncated) {
+      refill_key = dirent.key;
+    }
+
     bool force_check = force_check_filter &&
         force_check_filter(dirent.key.name);
     if ((!dirent.exists && !dirent.is_delete_marker()) ||
@@ -9180,6 +9370,12 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
     // Refresh the candidates map
     candidates.erase(candidates.begin());
     ++vcurrents[pos];
+    if (refill_key && count < num_entries) {
+      r = refill_nonempty(pos, *refill_key);
+      if (r < 0) {
+	return r;
+      }
+    }
     if (vcurrents[pos] != vends[pos]) {
       candidates[vcurrents[pos]->first] = pos;
     }
@@ -9199,8 +9395,10 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
   }
 
   // Check if all the returned entries are consumed or not
+  *is_truncated = false;
   for (size_t i = 0; i < vcurrents.size(); ++i) {
-    if (vcurrents[i] != vends[i]) {
+    if (vcurrents[i] != vends[i] ||
+	list_results[vshards[i]].is_truncated) {
       *is_truncated = true;
       break;
     }
@@ -9570,7 +9768,8 @@ int RGWRados::check_disk_state(librados::IoCtx io_ctx,
   return 0;
 }
 
-int RGWRados::cls_bucket_head(const RGWBucketInfo& bucket_info, int shard_id, vector<rgw_bucket_dir_header>& headers, map<int, string> *bucket_instance_ids)
+int RGWRados::cls_bucket_head(const RGWBucketInfo& bucket_info, int shard_id, vector<rgw_bucket_dir_header>& headers, optional_yield y,
+                              map<int, string> *bucket_instance_ids)
 {
   librados::IoCtx index_ctx;
   map<int, string> oids;
@@ -9582,7 +9781,12 @@ int RGWRados::cls_bucket_head(const RGWBucketInfo& bucket_info, int shard_id, ve
     return r;
   }
 
-  r = CLSRGWIssueGetDirHeader(index_ctx, oids, list_results, cct->_conf->rgw_bucket_index_max_aio)();
+  if (y) {
+    // suspend the coroutine rather than the thread while the shards reply
+    r = cls_bucket_head_yield(index_ctx, oids, list_results, y);
+  } else {
+    r = CLSRGWIssueGetDirHeader(index_ctx, oids, list_results, cct->_conf->rgw_bucket_index_max_aio)();
+  }
   if (r < 0) {
     ldout(cct, 20) << "cls_bucket_head: CLSRGWIssueGetDirHeader() returned "
                    << r << dendl;
@@ -9596,6 +9800,35 @@ int RGWRados::cls_bucket_head(const RGWBucketInfo& bucket_info, int shard_id, ve
   return 0;
 }
 
+int RGWRados::cls_bucket_head_yield(librados::IoCtx& index_ctx,
+                                    const map<int, string>& oids,
+                                    map<int, struct rgw_cls_list_ret>& list_results,
+                                    optional_yield y)
+{
+  rgw_pool pool(index_ctx.get_pool_name(), index_ctx.get_namespace());
+  auto aio = rgw::make_throttle(cct->_conf->rgw_bucket_index_max_aio, y);
+  int ret = 0;
+  for (const auto& [shard_id, oid] : oids) {
+    auto obj = svc.rados->obj(rgw_raw_obj(pool, oid));
+    int r = obj.open();
+    if (r < 0) {
+      ret = r;
+      break;
+    }
+    librados::ObjectReadOperation op;
+    cls_rgw_bucket_list_op(op, cls_rgw_obj_key(), "", 0, false,
+                           &list_results[shard_id]);
+    r = rgw::check_for_errors(
+      aio->get(obj, rgw::Aio::librados_op(std::move(op), y), 1, shard_id));
+    if (r < 0 && ret == 0) {
+      ret = r;
+    }
+  }
+  // the replies decode into list_results, so wait for all of them
+  int r = rgw::check_for_errors(aio->drain());
+  return ret < 0 ? ret : r;
+}
+
 int RGWRados::cls_bucket_head_async(const RGWBucketInfo& bucket_info, int shard_id, RGWGetDirHeader_CB *ctx, int *num_aio)
 {
   librados::IoCtx index_ctx;
@@ -9617,7 +9850,8 @@ int RGWRados::cls_bucket_head_async(const RGWBucketInfo& bucket_info, int shard_
   return r;
 }
 
-int RGWRados::cls_user_get_header(const string& user_id, cls_user_header *header)
+int RGWRados::cls_user_get_header(const string& user_id, cls_user_header *header,
+                                  optional_yield y)
 {
   string buckets_obj_id;
   rgw_get_buckets_obj(user_id, buckets_obj_id);
@@ -9633,7 +9867,7 @@ int RGWRados::cls_user_get_header(const string& user_id, cls_user_header *header
   int rc;
   ::cls_user_get_header(op, header, &rc);
   bufferlist ibl;
-  r = ref.ioctx.operate(ref.obj.oid, &op, &ibl);
+  r = rgw_rados_operate(ref.ioctx, ref.obj.oid, &op, &ibl, y);
   if (r < 0)
     return r;
   if (rc < 0)
@@ -9682,7 +9916,7 @@ int RGWRados::cls_user_sync_bucket_stats(rgw_raw_obj& user_obj,
 					 const RGWBucketInfo& bucket_info)
 {
   vector<rgw_bucket_dir_header> headers;
-  int r = cls_bucket_head(bucket_info, RGW_NO_SHARD, headers);
+  int r = cls_bucket_head(bucket_info, RGW_NO_SHARD, headers, null_yield);
   if (r < 0) {
     ldout(cct, 20) << "cls_bucket_header() returned " << r << dendl;
     return r;
@@ -9726,7 +9960,7 @@ int RGWRados::cls_user_get_bucket_stats(const rgw_bucket& bucket, cls_user_bucke
     return ret;
   }
 
-  ret = cls_bucket_head(bucket_info, RGW_NO_SHARD, headers);
+  ret = cls_bucket_head(bucket_info, RGW_NO_SHARD, headers, null_yield);
   if (ret < 0) {
     ldout(cct, 20) << "cls_bucket_header() returned " << ret << dendl;
     return ret;
@@ -9896,13 +10130,14 @@ int RGWRados::add_bucket_to_reshard(const RGWBucketInfo& bucket_info, uint32_t n
 }
 
 int RGWRados::check_quota(const rgw_user& bucket_owner, rgw_bucket& bucket,
-                          RGWQuotaInfo& user_quota, RGWQuotaInfo& bucket_quota, uint64_t obj_size, bool check_size_only)
+                          RGWQuotaInfo& user_quota, RGWQuotaInfo& bucket_quota, uint64_t obj_size,
+                          optional_yield y, bool check_size_only)
 {
   // if we only check size, then num_objs will set to 0
   if(check_size_only)
-    return quota_handler->check_quota(bucket_owner, bucket, user_quota, bucket_quota, 0, obj_size);
+    return quota_handler->check_quota(bucket_owner, bucket, user_quota, bucket_quota, 0, obj_size, y);
 
-  return quota_handler->check_quota(bucket_owner, bucket, user_quota, bucket_quota, 1, obj_size);
+  return quota_handler->check_quota(bucket_owner, bucket, user_quota, bucket_quota, 1, obj_size, y);
 }
 
 void RGWRados::get_bucket_index_objects(const string& bucket_oid_base,
@@ -8,10 +8,12 @@
 #include "rgw_zone.h"
 #include "rgw_bucket.h"
 #include "rgw_reshard.h"
+#include "rgw_aio_throttle.h"
 #include "cls/rgw/cls_rgw_client.h"
 #include "cls/lock/cls_lock_client.h"
 #include "common/errno.h"
 #include "common/ceph_json.h"
+#include "common/Thread.h"
 
 #include "common/dout.h"
 
@@ -31,59 +33,35 @@ class BucketReshardShard {
   const RGWBucketInfo& bucket_info;
   int num_shard;
   RGWRados::BucketShard bs;
+  RGWSI_RADOS::Obj obj;
+  bool obj_opened{false};
   vector<rgw_cls_bi_entry> entries;
   map<RGWObjCategory, rgw_bucket_category_stats> stats;
-  deque<librados::AioCompletion *>& aio_completions;
-  uint64_t max_aio_completions;
+  rgw::Aio& aio;
   uint64_t reshard_shard_batch_size;
 
-  int wait_next_completion() {
-    librados::AioCompletion *c = aio_completions.front();
-    aio_completions.pop_front();
-
-    c->wait_for_safe();
-
-    int ret = c->get_return_value();
-    c->release();
-
-    if (ret < 0) {
-      derr << "ERROR: reshard rados operation failed: " << cpp_strerror(-ret) << dendl;
-      return ret;
-    }
-
-    return 0;
-  }
-
-  int get_completion(librados::AioCompletion **c) {
-    if (aio_completions.size() >= max_aio_completions) {
-      int ret = wait_next_completion();
-      if (ret < 0) {
-        return ret;
-      }
-    }
-
-    *c = librados::Rados::aio_create_completion(nullptr, nullptr, nullptr);
-    aio_completions.push_back(*c);
-
-    return 0;
-  }
-
 public:
   BucketReshardShard(RGWRados *_store, const RGWBucketInfo& _bucket_info,
-                     int _num_shard,
-                     deque<librados::AioCompletion *>& _completions) :
-    store(_store), bucket_info(_bucket_info), bs(store),
-    aio_completions(_completions)
+                     int _num_shard, rgw::Aio& _aio) :
+    store(_store), bucket_info(_bucket_info), bs(store), aio(_aio)
   {
     num_shard = (bucket_info.num_shards > 0 ? _num_shard : -1);
     bs.init(bucket_info.bucket, num_shard, nullptr /* no RGWBucketInfo */);
 
-    max_aio_completions =
-      store->ctx()->_conf.get_val<uint64_t>("rgw_reshard_max_aio");
     reshard_shard_batch_size =
       store->ctx()->_conf.get_val<uint64_t>("rgw_reshard_batch_size");
   }
 
+  static int process_completed(const rgw::AioResultList& completed) {
+    for (auto& r : completed) {
+      if (r.result < 0) {
+        derr << "ERROR: reshard rados operation failed: " << cpp_strerror(-r.result) << dendl;
+        return r.result;
+      }
+    }
+    return 0;
+  }
+
   int get_num_shard() {
     return num_shard;
   }
@@ -113,36 +91,27 @@ public:
       return 0;
     }
 
+    if (!obj_opened) {
+      rgw_pool pool(bs.index_ctx.get_pool_name(), bs.index_ctx.get_namespace());
+      obj = store->svc.rados->obj(rgw_raw_obj(pool, bs.bucket_obj));
+      int ret = obj.open();
+      if (ret < 0) {
+        derr << "ERROR: failed to open target bucket shard (bs=" << bs.bucket << "/" << bs.shard_id << ") error=" << cpp_strerror(-ret) << dendl;
+        return ret;
+      }
+      obj_opened = true;
+    }
+
     librados::ObjectWriteOperation op;
     for (auto& entry : entries) {
       store->bi_put(op, bs, entry);
     }
     cls_rgw_bucket_update_stats(op, false, stats);
 
-    librados::AioCompletion *c;
-    int ret = get_completion(&c);
-    if (ret < 0) {
-      return ret;
-    }
-    ret = bs.index_ctx.aio_operate(bs.bucket_obj, c, &op);
-    if (ret < 0) {
-      derr << "ERROR: failed to store entries in target bucket shard (bs=" << bs.bucket << "/" << bs.shard_id << ") error=" << cpp_strerror(-ret) << dendl;
-      return ret;
-    }
     entries.clear();
     stats.clear();
-    return 0;
-  }
-
-  int wait_all_aio() {
-    int ret = 0;
-    while (!aio_completions.empty()) {
-      int r = wait_next_completion();
-      if (r < 0) {
-        ret = r;
-      }
-    }
-    return ret;
+    return process_completed(
+      aio.get(obj, rgw::Aio::librados_op(std::move(op), null_yield), 1, 0));
   }
 }; // class BucketReshardShard
 
@@ -150,7 +119,8 @@ public:
 class BucketReshardManager {
   RGWRados *store;
   const RGWBucketInfo& target_bucket_info;
-  deque<librados::AioCompletion *> completions;
+  // bounds the writes in flight to all target shards
+  rgw::BlockingAioThrottle aio;
   int num_target_shards;
   vector<BucketReshardShard *> target_shards;
 
@@ -159,21 +129,23 @@ public:
 		       const RGWBucketInfo& _target_bucket_info,
 		       int _num_target_shards) :
     store(_store), target_bucket_info(_target_bucket_info),
+    aio(store->ctx()->_conf.get_val<uint64_t>("rgw_reshard_max_aio")),
     num_target_shards(_num_target_shards)
   {
     target_shards.resize(num_target_shards);
     for (int i = 0; i < num_target_shards; ++i) {
-      target_shards[i] = new BucketReshardShard(store, target_bucket_info, i, completions);
+      target_shards[i] = new BucketReshardShard(store, target_bucket_info, i, aio);
     }
   }
 
   ~BucketReshardManager() {
+    int ret = BucketReshardShard::process_completed(aio.drain());
+    if (ret < 0) {
+      ldout(store->ctx(), 20) << __func__ <<
+	": draining the target shard writes returned ret=" << ret << dendl;
+    }
     for (auto& shard : target_shards) {
-      int ret = shard->wait_all_aio();
-      if (ret < 0) {
-        ldout(store->ctx(), 20) << __func__ <<
-	  ": shard->wait_all_aio() returned ret=" << ret << dendl;
-      }
+      delete shard;
     }
   }
 
@@ -200,12 +172,12 @@ public:
         ret = r;
       }
     }
+    int r = BucketReshardShard::process_completed(aio.drain());
+    if (r < 0) {
+      derr << "ERROR: waiting for the target shard writes returned error: " << cpp_strerror(-r) << dendl;
+      ret = r;
+    }
     for (auto& shard : target_shards) {
-      int r = shard->wait_all_aio();
-      if (r < 0) {
-        derr << "ERROR: target_shards[" << shard->get_num_shard() << "].wait_all_aio() returned error: " << cpp_strerror(-r) << dendl;
-        ret = r;
-      }
       delete shard;
     }
     target_shards.clear();
@@ -484,15 +456,382 @@ int RGWBucketReshardLock::renew(const Clock::time_point& now) {
 }
 
 
+int RGWBucketReshard::renew_locks(const Clock::time_point& now)
+{
+  if (!reshard_lock.should_renew(now)) {
+    return 0;
+  }
+  // assume outer locks have timespans at least the size of ours, so
+  // can call inside conditional
+  if (outer_reshard_lock) {
+    int ret = outer_reshard_lock->renew(now);
+    if (ret < 0) {
+      return ret;
+    }
+  }
+  int ret = reshard_lock.renew(now);
+  if (ret < 0) {
+    lderr(store->ctx()) << "Error renewing bucket lock: " << ret << dendl;
+    return ret;
+  }
+  return 0;
+}
+
+// copy the entries of one source shard to the target shards
+static int copy_index_shard(RGWRados *store,
+			    const RGWBucketInfo& bucket_info, int shard_id,
+			    const RGWBucketInfo& new_bucket_info,
+			    BucketReshardManager& target_shards_mgr,
+			    int max_entries, Formatter *formatter, ostream *out,
+			    std::atomic<uint64_t>& total_entries,
+			    const std::atomic<int>& error)
+{
+  rgw_bucket bucket = bucket_info.bucket;
+  list<rgw_cls_bi_entry> entries;
+  string marker;
+  bool is_truncated = true;
+  while (is_truncated && error == 0) {
+    entries.clear();
+    int ret = store->bi_list(bucket, shard_id, string(), marker,
+			     max_entries, &entries, &is_truncated);
+    if (ret < 0 && ret != -ENOENT) {
+      derr << "ERROR: bi_list(): " << cpp_strerror(-ret) << dendl;
+      return ret;
+    }
+
+    for (auto iter = entries.begin(); iter != entries.end(); ++iter) {
+      rgw_cls_bi_entry& entry = *iter;
+      if (formatter) {
+	formatter->open_object_section("entry");
+
+	encode_json("shard_id", shard_id, formatter);
+	encode_json("num_entry", total_entries.load(), formatter);
+	encode_json("entry", entry, formatter);
+      }
+      total_entries++;
+
+      marker = entry.idx;
+
+      int target_shard_id;
+      cls_rgw_obj_key cls_key;
+      RGWObjCategory category;
+      rgw_bucket_category_stats stats;
+      bool account = entry.get_info(&cls_key, &category, &stats);
+      rgw_obj_key key(cls_key);
+      rgw_obj obj(new_bucket_info.bucket, key);
+      int ret = store->get_target_shard_id(new_bucket_info, obj.get_hash_object(), &target_shard_id);
+      if (ret < 0) {
+	lderr(store->ctx()) << "ERROR: get_target_shard_id() returned ret=" << ret << dendl;
+	return ret;
+      }
+
+      int shard_index = (target_shard_id > 0 ? target_shard_id : 0);
+
+      ret = target_shards_mgr.add_entry(shard_index, entry, account,
+					category, stats);
+      if (ret < 0) {
+	return ret;
+      }
+
+      if (formatter) {
+	formatter->close_section();
+	if (out) {
+	  formatter->flush(*out);
+	}
+      }
+    } // entries loop
+  }
+  return 0;
+}
+
+int RGWBucketReshard::copy_index(const RGWBucketInfo& new_bucket_info,
+				 int max_entries, bool verbose, ostream *out,
+				 Formatter *formatter, uint64_t *total_entries)
+{
+  const int num_source_shards =
+    (bucket_info.num_shards > 0 ? bucket_info.num_shards : 1);
+  const int num_target_shards =
+    (new_bucket_info.num_shards > 0 ? new_bucket_info.num_shards : 1);
+  // the formatter cannot be shared between the copiers
+  const int num_copiers = verbose ? 1 : std::min<int>(num_source_shards,
+    store->ctx()->_conf.get_val<uint64_t>("rgw_reshard_copy_threads"));
+
+  std::atomic<int> next_shard{0};
+  std::atomic<uint64_t> copied{0};
+  std::atomic<int> error{0};
+  auto set_error = [&error](int r) {
+    int expected = 0;
+    error.compare_exchange_strong(expected, r);
+  };
+
+  ceph::mutex lock = ceph::make_mutex("RGWBucketReshard::copy_index");
+  ceph::condition_variable cond;
+  int running = num_copiers;
+
+  // each copier takes the next source shard until none is left, and has
+  // its own batches and throttle for the target shards
+  auto copier = [&] {
+    int r = 0;
+    {
+      BucketReshardManager target_shards_mgr(store, new_bucket_info,
+					     num_target_shards);
+      for (int i = next_shard++; i < num_source_shards && error == 0;
+	   i = next_shard++) {
+	r = copy_index_shard(store, bucket_info, i, new_bucket_info,
+			     target_shards_mgr, max_entries,
+			     verbose ? formatter : nullptr, out, copied, error);
+	if (r < 0) {
+	  break;
+	}
+      }
+      if (r >= 0) {
+	r = target_shards_mgr.finish();
+	if (r < 0) {
+	  lderr(store->ctx()) << "ERROR: failed to reshard" << dendl;
+	  r = -EIO;
+	}
+      }
+    }
+    if (r < 0) {
+      set_error(r);
+    }
+    std::lock_guard l{lock};
+    --running;
+    cond.notify_all();
+  };
+
+  std::vector<std::thread> copiers;
+  for (int i = 0; i < num_copiers; ++i) {
+    copiers.push_back(make_named_thread("reshard_copy", copier));
+  }
+
+  // the locks are renewed from here, on behalf of all the copiers
+  uint64_t reported = 0;
+  std::unique_lock l{lock};
+  while (running > 0) {
+    cond.wait_for(l, std::chrono::seconds(1));
+    if (!verbose && out && copied / 1000 > reported / 1000) {
+      reported = copied;
+      (*out) << " " << reported;
+    }
+    if (error == 0) {
+      l.unlock();
+      int r = renew_locks(Clock::now());
+      if (r < 0) {
+	set_error(r);
+      }
+      l.lock();
+    }
+  }
+  l.unlock();
+  for (auto& t : copiers) {
+    t.join();
+  }
+
+  *total_entries = copied;
+  return error;
+}
+
+static int list_object_entries(RGWRados *store, RGWRados::BucketShard& bs,
+			       const string& name,
+			       list<rgw_cls_bi_entry> *entries)
+{
+  string marker;
+  bool is_truncated = true;
+  while (is_truncated) {
+    list<rgw_cls_bi_entry> chunk;
+    int ret = store->bi_list(bs, name, marker, 1000, &chunk, &is_truncated);
+    if (ret == -ENOENT) {
+      break;
+    }
+    if (ret < 0) {
+      return ret;
+    }
+    if (chunk.empty()) {
+      break;
+    }
+    marker = chunk.back().idx;
+    entries->splice(entries->end(), chunk);
+  }
+  return 0;
+}
+
+/*
+ * make the entries of an object in the target shard match the ones in the
+ * source shard; the stats are applied as a delta, whose unsigned fields
+ * wrap around for what is removed
+ */
+static int copy_object_entries(RGWRados *store, RGWRados::BucketShard& src,
+			       const string& name,
+			       const RGWBucketInfo& new_bucket_info)
+{
+  list<rgw_cls_bi_entry> src_entries;
+  int ret = list_object_entries(store, src, name, &src_entries);
+  if (ret < 0) {
+    return ret;
+  }
+
+  rgw_obj_key key(cls_rgw_obj_key{name});
+  rgw_obj obj(new_bucket_info.bucket, key);
+  int target_shard_id;
+  ret = store->get_target_shard_id(new_bucket_info, obj.get_hash_object(),
+				   &target_shard_id);
+  if (ret < 0) {
+    return ret;
+  }
+  RGWRados::BucketShard dst(store);
+  ret = dst.init(new_bucket_info.bucket,
+		 (new_bucket_info.num_shards > 0 ? target_shard_id : -1),
+		 nullptr /* no RGWBucketInfo */);
+  if (ret < 0) {
+    return ret;
+  }
+  list<rgw_cls_bi_entry> dst_entries;
+  ret = list_object_entries(store, dst, name, &dst_entries);
+  if (ret < 0) {
+    return ret;
+  }
+
+  map<RGWObjCategory, rgw_bucket_category_stats> stats;
+  std::set<string> keep;
+  for (auto& entry : src_entries) {
+    keep.insert(entry.idx);
+  }
+  std::set<string> stale;
+  for (auto& entry : dst_entries) {
+    cls_rgw_obj_key cls_key;
+    RGWObjCategory category;
+    rgw_bucket_category_stats s;
+    if (entry.get_info(&cls_key, &category, &s)) {
+      auto& delta = stats[category];
+      delta.num_entries -= s.num_entries;
+      delta.total_size -= s.total_size;
+      delta.total_size_rounded -= s.total_size_rounded;
+      delta.actual_size -= s.actual_size;
+    }
+    if (!keep.count(entry.idx)) {
+      stale.insert(entry.idx);
+    }
+  }
+
+  librados::ObjectWriteOperation op;
+  if (!stale.empty()) {
+    op.omap_rm_keys(stale);
+  }
+  for (auto& entry : src_entries) {
+    cls_rgw_obj_key cls_key;
+    RGWObjCategory category;
+    rgw_bucket_category_stats s;
+    if (entry.get_info(&cls_key, &category, &s)) {
+      auto& delta = stats[category];
+      delta.num_entries += s.num_entries;
+      delta.total_size += s.total_size;
+      delta.total_size_rounded += s.total_size_rounded;
+      delta.actual_size += s.actual_size;
+    }
+    store->bi_put(op, dst, entry);
+  }
+  cls_rgw_bucket_update_stats(op, false, stats);
+  return dst.index_ctx.operate(dst.bucket_obj, &op);
+}
+
+int RGWBucketReshard::replay_reshard_log(const RGWBucketInfo& new_bucket_info,
+					 uint64_t *replayed)
+{
+  const int num_source_shards =
+    (bucket_info.num_shards > 0 ? bucket_info.num_shards : 1);
+  *replayed = 0;
+  for (int i = 0; i < num_source_shards; ++i) {
+    RGWRados::BucketShard bs(store);
+    int ret = bs.init(bucket_info.bucket,
+		      (bucket_info.num_shards > 0 ? i : -1),
+		      nullptr /* no RGWBucketInfo */);
+    if (ret < 0) {
+      return ret;
+    }
+    string marker;
+    bool is_truncated = true;
+    while (is_truncated) {
+      list<string> names;
+      ret = cls_rgw_reshard_log_list(bs.index_ctx, bs.bucket_obj, marker,
+				     1000, &names, &is_truncated);
+      if (ret < 0) {
+	lderr(store->ctx()) << "ERROR: failed to list the reshard log of " <<
+	  bs.bucket_obj << ": " << cpp_strerror(-ret) << dendl;
+	return ret;
+      }
+      if (names.empty()) {
+	break;
+      }
+      marker = names.back();
+      // trim before copying: an object changed after this is logged again
+      // and copied by the next pass
+      librados::ObjectWriteOperation op;
+      cls_rgw_reshard_log_trim(op, names);
+      ret = bs.index_ctx.operate(bs.bucket_obj, &op);
+      if (ret < 0) {
+	return ret;
+      }
+      for (auto& name : names) {
+	ret = copy_object_entries(store, bs, name, new_bucket_info);
+	if (ret < 0) {
+	  lderr(store->ctx()) << "ERROR: failed to copy the entries of " <<
+	    name << ": " << cpp_strerror(-ret) << dendl;
+	  return ret;
+	}
+      }
+      *replayed += names.size();
+      ret = renew_locks(Clock::now());
+      if (ret < 0) {
+	return ret;
+      }
+    }
+  }
+  ldout(store->ctx(), 10) << __func__ << ": copied " << *replayed <<
+    " changed objects again" << dendl;
+  return 0;
+}
+
+int RGWBucketReshard::trim_reshard_log(RGWRados* store,
+				       const RGWBucketInfo& bucket_info)
+{
+  librados::IoCtx index_ctx;
+  map<int, string> bucket_objs;
+  int ret = store->open_bucket_index(bucket_info, index_ctx, bucket_objs);
+  if (ret < 0) {
+    return ret;
+  }
+  for (auto& i : bucket_objs) {
+    bool is_truncated = true;
+    while (is_truncated) {
+      list<string> names;
+      ret = cls_rgw_reshard_log_list(index_ctx, i.second, string(), 1000,
+				     &names, &is_truncated);
+      if (ret < 0) {
+	return ret;
+      }
+      if (names.empty()) {
+	break;
+      }
+      librados::ObjectWriteOperation op;
+      cls_rgw_reshard_log_trim(op, names);
+      ret = index_ctx.operate(i.second, &op);
+      if (ret < 0) {
+	return ret;
+      }
+    }
+  }
+  return 0;
+}
+
 int RGWBucketReshard::do_reshard(int num_shards,
 				 RGWBucketInfo& new_bucket_info,
 				 int max_entries,
+				 bool online,
 				 bool verbose,
 				 ostream *out,
 				 Formatter *formatter)
 {
-  rgw_bucket& bucket = bucket_info.bucket;
-
   int ret = 0;
 
   if (out) {
@@ -504,9 +843,6 @@ int RGWBucketReshard::do_reshard(int num_shards,
       std::endl;
   }
 
-  /* update bucket info -- in progress*/
-  list<rgw_cls_bi_entry> entries;
-
   if (max_entries < 0) {
     ldout(store->ctx(), 0) << __func__ <<
       ": can't reshard, negative max_entries" << dendl;
@@ -517,16 +853,15 @@ int RGWBucketReshard::do_reshard(int num_shards,
   // complete successfully
   BucketInfoReshardUpdate bucket_info_updater(store, bucket_info, bucket_attrs, new_bucket_info.bucket.bucket_id);
 
-  ret = bucket_info_updater.start();
-  if (ret < 0) {
-    ldout(store->ctx(), 0) << __func__ << ": failed to update bucket info ret=" << ret << dendl;
-    return ret;
+  /* update bucket info -- in progress*/
+  if (!online) {
+    ret = bucket_info_updater.start();
+    if (ret < 0) {
+      ldout(store->ctx(), 0) << __func__ << ": failed to update bucket info ret=" << ret << dendl;
+      return ret;
+    }
   }
 
-  int num_target_shards = (new_bucket_info.num_shards > 0 ? new_bucket_info.num_shards : 1);
-
-  BucketReshardManager target_shards_mgr(store, new_bucket_info, num_target_shards);
-
   verbose = verbose && (formatter != nullptr);
 
   if (verbose) {
@@ -539,81 +874,10 @@ int RGWBucketReshard::do_reshard(int num_shards,
     cout << "total entries:";
   }
 
-  const int num_source_shards =
-    (bucket_info.num_shards > 0 ? bucket_info.num_shards : 1);
-  string marker;
-  for (int i = 0; i < num_source_shards; ++i) {
-    bool is_truncated = true;
-    marker.clear();
-    while (is_truncated) {
-      entries.clear();
-      ret = store->bi_list(bucket, i, string(), marker, max_entries, &entries, &is_truncated);
-      if (ret < 0 && ret != -ENOENT) {
-	derr << "ERROR: bi_list(): " << cpp_strerror(-ret) << dendl;
-	return ret;
-      }
-
-      for (auto iter = entries.begin(); iter != entries.end(); ++iter) {
-	rgw_cls_bi_entry& entry = *iter;
-	if (verbose) {
-	  formatter->open_object_section("entry");
-
-	  encode_json("shard_id", i, formatter);
-	  encode_json("num_entry", total_entries, formatter);
-	  encode_json("entry", entry, formatter);
-	}
-	total_entries++;
-
-	marker = entry.idx;
-
-	int target_shard_id;
-	cls_rgw_obj_key cls_key;
-	RGWObjCategory category;
-	rgw_bucket_category_stats stats;
-	bool account = entry.get_info(&cls_key, &category, &stats);
-	rgw_obj_key key(cls_key);
-	rgw_obj obj(new_bucket_info.bucket, key);
-	int ret = store->get_target_shard_id(new_bucket_info, obj.get_hash_object(), &target_shard_id);
-	if (ret < 0) {
-	  lderr(store->ctx()) << "ERROR: get_target_shard_id() returned ret=" << ret << dendl;
-	  return ret;
-	}
-
-	int shard_index = (target_shard_id > 0 ? target_shard_id : 0);
-
-	ret = target_shards_mgr.add_entry(shard_index, entry, account,
-					  category, stats);
-	if (ret < 0) {
-	  return ret;
-	}
-
-	Clock::time_point now = Clock::now();
-	if (reshard_lock.should_renew(now)) {
-	  // assume outer locks have timespans at least the size of ours, so
-	  // can call inside conditional
-	  if (outer_reshard_lock) {
-	    ret = outer_reshard_lock->renew(now);
-	    if (ret < 0) {
-	      return ret;
-	    }
-	  }
-	  ret = reshard_lock.renew(now);
-	  if (ret < 0) {
-	    lderr(store->ctx()) << "Error renewing bucket lock: " << ret << dendl;
-	    return ret;
-	  }
-	}
-
-	if (verbose) {
-	  formatter->close_section();
-	  if (out) {
-	    formatter->flush(*out);
-	  }
-	} else if (out && !(total_entries % 1000)) {
-	  (*out) << " " << total_entries;
-	}
-      } // entries loop
-    }
+  ret = copy_index(new_bucket_info, max_entries, verbose, out, formatter,
+		   &total_entries);
+  if (ret < 0) {
+    return ret;
   }
 
   if (verbose) {
@@ -625,10 +889,42 @@ int RGWBucketReshard::do_reshard(int num_shards,
     (*out) << " " << total_entries << std::endl;
   }
 
-  ret = target_shards_mgr.finish();
-  if (ret < 0) {
-    lderr(store->ctx()) << "ERROR: failed to reshard" << dendl;
-    return -EIO;
+  if (online) {
+    // catch up with the writes that landed during the copy while writes
+    // are still accepted, so that the last pass has little left to do
+    constexpr int max_catchup_passes = 5;
+    const uint64_t batch_size =
+      store->ctx()->_conf.get_val<uint64_t>("rgw_reshard_batch_size");
+    uint64_t replayed = 0;
+    for (int i = 0; i < max_catchup_passes; ++i) {
+      ret = replay_reshard_log(new_bucket_info, &replayed);
+      if (ret < 0) {
+	return ret;
+      }
+      if (replayed < batch_size) {
+	break;
+      }
+    }
+
+    // block the writes to the old shards for the last pass
+    ret = set_resharding_status(new_bucket_info.bucket.bucket_id,
+				num_shards, CLS_RGW_RESHARD_IN_PROGRESS);
+    if (ret < 0) {
+      return ret;
+    }
+    ret = bucket_info_updater.start();
+    if (ret < 0) {
+      ldout(store->ctx(), 0) << __func__ << ": failed to update bucket info ret=" << ret << dendl;
+      return ret;
+    }
+    ret = replay_reshard_log(new_bucket_info, &replayed);
+    if (ret < 0) {
+      return ret;
+    }
+    if (out) {
+      (*out) << "changed objects copied while writes were blocked: " <<
+	replayed << std::endl;
+    }
   }
 
   ret = rgw_link_bucket(store, new_bucket_info.owner, new_bucket_info.bucket, bucket_info.creation_time);
@@ -682,6 +978,21 @@ int RGWBucketReshard::execute(int num_shards, int max_op_entries,
     return ret;
   }
 
+  bool online = store->ctx()->_conf.get_val<bool>("rgw_reshard_online");
+  if (online) {
+    // whatever an earlier, interrupted reshard logged is of no use
+    ret = trim_reshard_log(store, bucket_info);
+    if (ret == -EOPNOTSUPP) {
+      ldout(store->ctx(), 1) << __func__ << " INFO: the OSDs cannot log "
+	"the changes to the bucket index, writes are blocked for the "
+	"whole reshard" << dendl;
+      online = false;
+    } else if (ret < 0) {
+      reshard_lock.unlock();
+      return ret;
+    }
+  }
+
   RGWBucketInfo new_bucket_info;
   ret = create_new_bucket_instance(num_shards, new_bucket_info);
   if (ret < 0) {
@@ -697,9 +1008,11 @@ int RGWBucketReshard::execute(int num_shards, int max_op_entries,
   }
 
   // set resharding status of current bucket_info & shards with
-  // information about planned resharding
-  ret = set_resharding_status(new_bucket_info.bucket.bucket_id,
-			      num_shards, CLS_RGW_RESHARD_IN_PROGRESS);
+  // information about planned resharding; when online, the shards keep
+  // taking writes and log them until do_reshard() blocks them
+  ret = set_resharding_status(new_bucket_info.bucket.bucket_id, num_shards,
+			      (online ? CLS_RGW_RESHARD_LOGGING :
+			       CLS_RGW_RESHARD_IN_PROGRESS));
   if (ret < 0) {
     reshard_lock.unlock();
     return ret;
@@ -708,6 +1021,7 @@ int RGWBucketReshard::execute(int num_shards, int max_op_entries,
   ret = do_reshard(num_shards,
 		   new_bucket_info,
 		   max_op_entries,
+		   online,
                    verbose, out, formatter);
   if (ret < 0) {
     goto error_out;
@@ -748,6 +1062,22 @@ int RGWBucketReshard::execute(int num_shards, int max_op_entries,
 
 error_out:
 
+  if (online) {
+    // stop the old shards from logging, and drop what they logged
+    int ret2 = clear_index_shard_reshard_status();
+    if (ret2 < 0) {
+      lderr(store->ctx()) << "Error: " << __func__ <<
+	" failed to clear the reshard status of the old shards; " <<
+	"returned " << ret2 << dendl;
+    }
+    ret2 = trim_reshard_log(store, bucket_info);
+    if (ret2 < 0) {
+      lderr(store->ctx()) << "Error: " << __func__ <<
+	" failed to trim the reshard log of the old shards; " <<
+	"returned " << ret2 << dendl;
+    }
+  }
+
   reshard_lock.unlock();
 
   // since the real problem is the issue that led to this error code
@@ -73,9 +73,16 @@ private:
 
   int create_new_bucket_instance(int new_num_shards,
 				 RGWBucketInfo& new_bucket_info);
+  int renew_locks(const Clock::time_point& now);
+  int copy_index(const RGWBucketInfo& new_bucket_info, int max_entries,
+		 bool verbose, ostream *out, Formatter *formatter,
+		 uint64_t *total_entries);
+  int replay_reshard_log(const RGWBucketInfo& new_bucket_info,
+			 uint64_t *replayed);
   int do_reshard(int num_shards,
 		 RGWBucketInfo& new_bucket_info,
 		 int max_entries,
+		 bool online,
                  bool verbose,
                  ostream *os,
 		 Formatter *formatter);
@@ -102,6 +109,9 @@ public:
   int clear_index_shard_reshard_status() {
     return clear_index_shard_reshard_status(store, bucket_info);
   }
+  // drop the changes logged by the shards of an online reshard
+  static int trim_reshard_log(RGWRados* store,
+			      const RGWBucketInfo& bucket_info);
   static int set_resharding_status(RGWRados* store,
 				   const RGWBucketInfo& bucket_info,
 				   const string& new_instance_id,
@@ -385,6 +385,240 @@ int RGWGetObj_ObjStore_S3::get_decrypt_filter(std::unique_ptr<RGWGetObj_Filter>
   return res;
 }
 
+struct s3select_csv_xml {
+  string file_header_info;
+  string record_delimiter;
+  string field_delimiter;
+  string quote_character;
+  string quote_escape_character;
+  string comments;
+  string quote_fields;
+
+  void decode_xml(XMLObj *obj) {
+    RGWXMLDecoder::decode_xml("FileHeaderInfo", file_header_info, obj);
+    RGWXMLDecoder::decode_xml("RecordDelimiter", record_delimiter, obj);
+    RGWXMLDecoder::decode_xml("FieldDelimiter", field_delimiter, obj);
+    RGWXMLDecoder::decode_xml("QuoteCharacter", quote_character, obj);
+    RGWXMLDecoder::decode_xml("QuoteEscapeCharacter", quote_escape_character, obj);
+    RGWXMLDecoder::decode_xml("Comments", comments, obj);
+    RGWXMLDecoder::decode_xml("QuoteFields", quote_fields, obj);
+  }
+
+  int to_format(rgw::s3select::CSVFormat& format, string& err) const {
+    using rgw::s3select::CSVFormat;
+    const std::pair<const string&, char&> chars[] = {
+      {record_delimiter, format.record_delimiter},
+      {field_delimiter, format.field_delimiter},
+      {quote_character, format.quote},
+      {quote_escape_character, format.quote_escape},
+      {comments, format.comments},
+    };
+    for (auto& [value, c] : chars) {
+      if (value.size() > 1) {
+        err = "only single character delimiters and quotes are supported";
+        return -EINVAL;
+      }
+      if (!value.empty()) {
+        c = value[0];
+      }
+    }
+    if (file_header_info.empty() || file_header_info == "NONE") {
+      format.header = CSVFormat::Header::None;
+    } else if (file_header_info == "IGNORE") {
+      format.header = CSVFormat::Header::Ignore;
+    } else if (file_header_info == "USE") {
+      format.header = CSVFormat::Header::Use;
+    } else {
+      err = "invalid FileHeaderInfo";
+      return -EINVAL;
+    }
+    if (quote_fields == "ALWAYS") {
+      format.quote_always = true;
+    } else if (!quote_fields.empty() && quote_fields != "ASNEEDED") {
+      err = "invalid QuoteFields";
+      return -EINVAL;
+    }
+    return 0;
+  }
+};
+
+struct s3select_serialization_xml {
+  string compression_type;
+  bool has_csv = false;
+  bool has_other = false; // JSON or Parquet
+  s3select_csv_xml csv;
+
+  void decode_xml(XMLObj *obj) {
+    RGWXMLDecoder::decode_xml("CompressionType", compression_type, obj);
+    has_csv = RGWXMLDecoder::decode_xml("CSV", csv, obj);
+    has_other = obj->find_first("JSON") || obj->find_first("Parquet");
+  }
+};
+
+struct s3select_request_xml {
+  string expression;
+  string expression_type;
+  s3select_serialization_xml input;
+  s3select_serialization_xml output;
+
+  void decode_xml(XMLObj *obj) {
+    RGWXMLDecoder::decode_xml("Expression", expression, obj, true);
+    RGWXMLDecoder::decode_xml("ExpressionType", expression_type, obj, true);
+    RGWXMLDecoder::decode_xml("InputSerialization", input, obj, true);
+    RGWXMLDecoder::decode_xml("OutputSerialization", output, obj, true);
+  }
+};
+
+int RGWSelectObj_ObjStore_S3::get_params()
+{
+  int r = 0;
+  bufferlist data;
+  std::tie(r, data) =
+    rgw_rest_read_all_input(s, s->cct->_conf->rgw_max_put_param_size, false);
+  if (r < 0) {
+    return r;
+  }
+
+  r = do_aws4_auth_completion();
+  if (r < 0) {
+    return r;
+  }
+
+  RGWXMLDecoder::XMLParser parser;
+  if (!parser.init()) {
+    ldpp_dout(this, 0) << "ERROR: failed to initialize parser" << dendl;
+    return -EIO;
+  }
+  if (!parser.parse(data.c_str(), data.length(), 1)) {
+    return -ERR_MALFORMED_XML;
+  }
+
+  s3select_request_xml request;
+  try {
+    RGWXMLDecoder::decode_xml("SelectObjectContentRequest", request, &parser, true);
+  } catch (RGWXMLDecoder::err& err) {
+    ldpp_dout(this, 5) << "Malformed select request: " << err << dendl;
+    return -ERR_MALFORMED_XML;
+  }
+
+  if (request.expression_type != "SQL") {
+    s->err.message = "ExpressionType must be SQL";
+    return -EINVAL;
+  }
+  for (auto serialization : {&request.input, &request.output}) {
+    if (!serialization->compression_type.empty() &&
+        serialization->compression_type != "NONE") {
+      s->err.message = "only uncompressed objects can be queried";
+      return -ERR_NOT_IMPLEMENTED;
+    }
+    if (!serialization->has_csv) {
+      s->err.message = serialization->has_other ?
+        "only the CSV serialization is supported" :
+        "missing serialization";
+      return serialization->has_other ? -ERR_NOT_IMPLEMENTED : -EINVAL;
+    }
+  }
+
+  string err;
+  r = request.input.csv.to_format(csv_in, err);
+  if (r == 0) {
+    r = request.output.csv.to_format(csv_out, err);
+  }
+  if (r == 0) {
+    r = rgw::s3select::parse_query(request.expression, query, err);
+  }
+  if (r < 0) {
+    s->err.message = err;
+    return r;
+  }
+  // the object is scanned as a whole, Range does not apply
+  r = RGWGetObj_ObjStore_S3::get_params();
+  range_str = nullptr;
+  csv = std::make_unique<rgw::s3select::CSVSelect>(query, csv_in, csv_out);
+  return r;
+}
+
+int RGWSelectObj_ObjStore_S3::send_events(const string& records, bool end)
+{
+  string out;
+  if (!records.empty()) {
+    rgw::s3select::encode_records_event(records, out);
+  }
+  if (end) {
+    rgw::s3select::encode_stats_event(csv->bytes_scanned, csv->bytes_scanned,
+                                      csv->bytes_returned, out);
+    rgw::s3select::encode_end_event(out);
+    finished = true;
+  }
+  if (out.empty()) {
+    return 0;
+  }
+  return dump_body(s, out);
+}
+
+int RGWSelectObj_ObjStore_S3::send_response_data_error()
+{
+  if (finished && csv->done()) {
+    // stopped reading once LIMIT was reached, not an error
+    op_ret = 0;
+    return 0;
+  }
+  bufferlist bl;
+  return send_response_data(bl, 0, 0);
+}
+
+int RGWSelectObj_ObjStore_S3::send_response_data(bufferlist& bl, off_t bl_ofs,
+                                                 off_t bl_len)
+{
+  if (!sent_header) {
+    set_req_state_err(s, op_ret);
+    dump_errno(s);
+    if (op_ret < 0) {
+      end_header(s, this);
+      sent_header = true;
+      return 0;
+    }
+    end_header(s, this, "application/octet-stream", CHUNKED_TRANSFER_ENCODING);
+    sent_header = true;
+  }
+  if (finished) {
+    return 0;
+  }
+  if (op_ret < 0) {
+    // the records are already on their way, report it in the stream
+    string out;
+    rgw::s3select::encode_error_event("InternalError",
+                                      "failed to read the object", out);
+    finished = true;
+    return dump_body(s, out);
+  }
+
+  string records;
+  string err;
+  int r;
+  if (bl_len > 0) {
+    r = csv->process(std::string_view(bl.c_str() + bl_ofs, bl_len), records, err);
+  } else {
+    r = csv->finish(records, err);
+  }
+  if (r < 0) {
+    ldpp_dout(this, 5) << "select failed: " << err << dendl;
+    string out;
+    rgw::s3select::encode_error_event("InvalidArgument", err, out);
+    finished = true;
+    dump_body(s, out);
+    return r;
+  }
+
+  const bool end = bl_len == 0 || csv->done();
+  r = send_events(records, end);
+  if (r < 0) {
+    return r;
+  }
+  // nothing left to return, stop reading the object
+  return (end && bl_len > 0) ? -ECANCELED : 0;
+}
+
 void RGWGetObjTags_ObjStore_S3::send_response_data(bufferlist& bl)
 {
   dump_errno(s);
@@ -1708,7 +1942,7 @@ int RGWPutObj_ObjStore_S3::get_encrypt_filter(
        * We use crypto mode that configured as if we were decrypting. */
       res = rgw_s3_prepare_decrypt(s, xattrs, &block_crypt, crypt_http_responses);
       if (res == 0 && block_crypt != nullptr)
-        filter->reset(new RGWPutObj_BlockEncrypt(s->cct, cb, std::move(block_crypt)));
+        filter->reset(new RGWPutObj_BlockEncrypt(s->cct, cb, std::move(block_crypt), s->yield));
     }
     /* it is ok, to not have encryption at all */
   }
@@ -1717,7 +1951,7 @@ int RGWPutObj_ObjStore_S3::get_encrypt_filter(
     std::unique_ptr<BlockCrypt> block_crypt;
     res = rgw_s3_prepare_encrypt(s, attrs, nullptr, &block_crypt, crypt_http_responses);
     if (res == 0 && block_crypt != nullptr) {
-      filter->reset(new RGWPutObj_BlockEncrypt(s->cct, cb, std::move(block_crypt)));
+      filter->reset(new RGWPutObj_BlockEncrypt(s->cct, cb, std::move(block_crypt), s->yield));
     }
   }
   return res;
@@ -2233,7 +2467,7 @@ int RGWPostObj_ObjStore_S3::get_encrypt_filter(
   int res = rgw_s3_prepare_encrypt(s, attrs, &parts, &block_crypt,
                                    crypt_http_responses);
   if (res == 0 && block_crypt != nullptr) {
-    filter->reset(new RGWPutObj_BlockEncrypt(s->cct, cb, std::move(block_crypt)));
+    filter->reset(new RGWPutObj_BlockEncrypt(s->cct, cb, std::move(block_crypt), s->yield));
   }
   return res;
 }
@@ -3400,6 +3634,13 @@ RGWOp *RGWHandler_REST_Obj_S3::op_post()
   if (s->info.args.exists("uploads"))
     return new RGWInitMultipart_ObjStore_S3;
 
+  if (s->info.args.exists("select") &&
+      s->info.args.get("select-type") == "2") {
+    RGWSelectObj_ObjStore_S3 *op = new RGWSelectObj_ObjStore_S3;
+    op->set_get_data(true);
+    return op;
+  }
+
   return new RGWPostObj_ObjStore_S3;
 }
 
@@ -4487,7 +4728,7 @@ rgw::auth::s3::LDAPEngine::authenticate(
   //return error.
   /*RGWUserInfo user_info;
   user_info.user_id = base64_token.id;
-  if (rgw_get_user_info_by_uid(store, user_info.user_id, user_info) >= 0) {
+  if (rgw_get_user_info_by_uid(store, user_info.user_id, user_info, null_yield) >= 0) {
     if (user_info.type != TYPE_LDAP) {
       ldpp_dout(dpp, 10) << "ERROR: User id of type: " << user_info.type << " is already present" << dendl;
       return nullptr;
@@ -4526,7 +4767,7 @@ rgw::auth::s3::LocalEngine::authenticate(
   RGWUserInfo user_info;
   /* TODO(rzarzynski): we need to have string-view taking variant. */
   const std::string access_key_id = _access_key_id.to_string();
-  if (rgw_get_user_info_by_access_key(store, access_key_id, user_info) < 0) {
+  if (rgw_get_user_info_by_access_key(store, access_key_id, user_info, null_yield) < 0) {
       ldpp_dout(dpp, 5) << "error reading user info, uid=" << access_key_id
               << " can't authenticate" << dendl;
       return result_t::deny(-ERR_INVALID_ACCESS_KEY);
@@ -4707,7 +4948,7 @@ rgw::auth::s3::STSEngine::authenticate(
 
   if (! token.user.empty() && token.acct_type != TYPE_ROLE) {
     // get user info
-    int ret = rgw_get_user_info_by_uid(store, token.user, user_info, NULL);
+    int ret = rgw_get_user_info_by_uid(store, token.user, user_info, s->yield, NULL);
     if (ret < 0) {
       ldpp_dout(dpp, 5) << "ERROR: failed reading user info: uid=" << token.user << dendl;
       return result_t::reject(-EPERM);
@@ -18,6 +18,7 @@
 #include "rgw_acl_s3.h"
 #include "rgw_policy_s3.h"
 #include "rgw_lc_s3.h"
+#include "rgw_s3select.h"
 #include "rgw_keystone.h"
 #include "rgw_rest_conn.h"
 #include "rgw_ldap.h"
@@ -56,6 +57,27 @@ public:
                          bufferlist* manifest_bl) override;
 };
 
+class RGWSelectObj_ObjStore_S3 : public RGWGetObj_ObjStore_S3
+{
+  rgw::s3select::Query query;
+  rgw::s3select::CSVFormat csv_in;
+  rgw::s3select::CSVFormat csv_out;
+  std::unique_ptr<rgw::s3select::CSVSelect> csv;
+  bool finished = false;
+
+  int send_events(const std::string& records, bool end);
+public:
+  RGWSelectObj_ObjStore_S3() {}
+  ~RGWSelectObj_ObjStore_S3() override {}
+
+  int get_params() override;
+  int send_response_data_error() override;
+  int send_response_data(bufferlist& bl, off_t ofs, off_t len) override;
+
+  const char* name() const override { return "select_obj_content"; }
+  RGWOpType get_type() override { return RGW_OP_SELECT_OBJ_CONTENT; }
+};
+
 class RGWGetObjTags_ObjStore_S3 : public RGWGetObjTags_ObjStore
 {
 public:
@@ -118,14 +118,14 @@ void RGWPutUserPolicy::execute()
 
   RGWUserInfo info;
   rgw_user user_id(user_name);
-  op_ret = rgw_get_user_info_by_uid(store, user_id, info);
+  op_ret = rgw_get_user_info_by_uid(store, user_id, info, s->yield);
   if (op_ret < 0) {
     op_ret = -ERR_NO_SUCH_ENTITY;
     return;
   }
 
   map<string, bufferlist> uattrs;
-  op_ret = rgw_get_user_attrs_by_uid(store, user_id, uattrs);
+  op_ret = rgw_get_user_attrs_by_uid(store, user_id, uattrs, s->yield);
   if (op_ret == -ENOENT) {
     op_ret = -ERR_NO_SUCH_ENTITY;
     return;
@@ -190,7 +190,7 @@ void RGWGetUserPolicy::execute()
 
   rgw_user user_id(user_name);
   map<string, bufferlist> uattrs;
-  op_ret = rgw_get_user_attrs_by_uid(store, user_id, uattrs);
+  op_ret = rgw_get_user_attrs_by_uid(store, user_id, uattrs, s->yield);
   if (op_ret == -ENOENT) {
     ldout(s->cct, 0) << "ERROR: attrs not found for user" << user_name << dendl;
     op_ret = -ERR_NO_SUCH_ENTITY;
@@ -254,7 +254,7 @@ void RGWListUserPolicies::execute()
 
   rgw_user user_id(user_name);
   map<string, bufferlist> uattrs;
-  op_ret = rgw_get_user_attrs_by_uid(store, user_id, uattrs);
+  op_ret = rgw_get_user_attrs_by_uid(store, user_id, uattrs, s->yield);
   if (op_ret == -ENOENT) {
     ldout(s->cct, 0) << "ERROR: attrs not found for user" << user_name << dendl;
     op_ret = -ERR_NO_SUCH_ENTITY;
@@ -316,14 +316,14 @@ void RGWDeleteUserPolicy::execute()
 
   RGWUserInfo info;
   rgw_user user_id(user_name);
-  op_ret = rgw_get_user_info_by_uid(store, user_id, info);
+  op_ret = rgw_get_user_info_by_uid(store, user_id, info, s->yield);
   if (op_ret < 0) {
     op_ret = -ERR_NO_SUCH_ENTITY;
     return;
   }
 
   map<string, bufferlist> uattrs;
-  op_ret = rgw_get_user_attrs_by_uid(store, user_id, uattrs);
+  op_ret = rgw_get_user_attrs_by_uid(store, user_id, uattrs, s->yield);
   if (op_ret == -ENOENT) {
     op_ret = -ERR_NO_SUCH_ENTITY;
     return;
@@ -0,0 +1,1010 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+#include <boost/crc.hpp>
+
+#include "rgw_s3select.h"
+
+namespace rgw::s3select {
+
+namespace {
+
+struct Token {
+  enum class Type { Word, QuotedName, String, Number, Symbol, End };
+  Type type;
+  std::string text;
+};
+
+bool is_word_char(char c)
+{
+  return isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+int tokenize(std::string_view sql, std::vector<Token>& tokens, std::string& err)
+{
+  size_t i = 0;
+  while (i < sql.size()) {
+    const char c = sql[i];
+    if (isspace(static_cast<unsigned char>(c))) {
+      ++i;
+    } else if (c == '\'' || c == '"') {
+      // '' and "" stand for the quote itself
+      std::string text;
+      ++i;
+      for (;;) {
+        if (i == sql.size()) {
+          err = "unterminated quoted string";
+          return -EINVAL;
+        }
+        if (sql[i] == c) {
+          if (i + 1 < sql.size() && sql[i + 1] == c) {
+            text.push_back(c);
+            i += 2;
+            continue;
+          }
+          ++i;
+          break;
+        }
+        text.push_back(sql[i++]);
+      }
+      tokens.push_back({c == '\'' ? Token::Type::String : Token::Type::QuotedName,
+                        std::move(text)});
+    } else if (isdigit(static_cast<unsigned char>(c)) ||
+               (c == '.' && i + 1 < sql.size() &&
+                isdigit(static_cast<unsigned char>(sql[i + 1])))) {
+      size_t j = i;
+      while (j < sql.size() &&
+             (isdigit(static_cast<unsigned char>(sql[j])) || sql[j] == '.')) {
+        ++j;
+      }
+      tokens.push_back({Token::Type::Number, std::string(sql.substr(i, j - i))});
+      i = j;
+    } else if (is_word_char(c)) {
+      size_t j = i;
+      while (j < sql.size() && is_word_char(sql[j])) {
+        ++j;
+      }
+      tokens.push_back({Token::Type::Word, std::string(sql.substr(i, j - i))});
+      i = j;
+    } else if ((c == '<' || c == '>' || c == '!') &&
+               i + 1 < sql.size() && (sql[i + 1] == '=' ||
+                                      (c == '<' && sql[i + 1] == '>'))) {
+      tokens.push_back({Token::Type::Symbol, std::string(sql.substr(i, 2))});
+      i += 2;
+    } else if (strchr("*,().=<>-[]", c)) {
+      tokens.push_back({Token::Type::Symbol, std::string(1, c)});
+      ++i;
+    } else {
+      err = std::string("unexpected character '") + c + "'";
+      return -EINVAL;
+    }
+  }
+  tokens.push_back({Token::Type::End, {}});
+  return 0;
+}
+
+bool parse_column_index(std::string_view name, int& column)
+{
+  if (name.size() < 2 || name[0] != '_') {
+    return false;
+  }
+  int n = 0;
+  for (auto c : name.substr(1)) {
+    if (!isdigit(static_cast<unsigned char>(c)) || n > 100000) {
+      return false;
+    }
+    n = n * 10 + (c - '0');
+  }
+  if (n < 1) {
+    return false;
+  }
+  column = n - 1;
+  return true;
+}
+
+class Parser {
+  std::vector<Token> tokens;
+  size_t pos = 0;
+  std::string alias;
+  std::string& err;
+
+  const Token& peek() const { return tokens[pos]; }
+
+  bool is_keyword(const Token& t, const char *word) const {
+    return t.type == Token::Type::Word && strcasecmp(t.text.c_str(), word) == 0;
+  }
+  bool accept_keyword(const char *word) {
+    if (is_keyword(peek(), word)) {
+      ++pos;
+      return true;
+    }
+    return false;
+  }
+  bool accept_symbol(const char *symbol) {
+    if (peek().type == Token::Type::Symbol && peek().text == symbol) {
+      ++pos;
+      return true;
+    }
+    return false;
+  }
+  int expected(const char *what) {
+    err = std::string("expected ") + what;
+    if (peek().type != Token::Type::End) {
+      err += " near '" + peek().text + "'";
+    }
+    return -EINVAL;
+  }
+
+  int parse_column(std::unique_ptr<Expr>& e);
+  int parse_operand(std::unique_ptr<Expr>& e);
+  int parse_predicate(std::unique_ptr<Expr>& e);
+  int parse_not(std::unique_ptr<Expr>& e);
+  int parse_and(std::unique_ptr<Expr>& e);
+  int parse_or(std::unique_ptr<Expr>& e);
+  int parse_from();
+
+public:
+  explicit Parser(std::string& err) : err(err) {}
+
+  int parse(std::string_view sql, Query& query);
+};
+
+int Parser::parse_column(std::unique_ptr<Expr>& e)
+{
+  auto t = peek();
+  if (t.type != Token::Type::Word && t.type != Token::Type::QuotedName) {
+    return expected("a column");
+  }
+  ++pos;
+  if (accept_symbol(".")) {
+    if ((alias.empty() || strcasecmp(t.text.c_str(), alias.c_str()) != 0) &&
+        strcasecmp(t.text.c_str(), "s3object") != 0) {
+      err = "unknown table '" + t.text + "'";
+      return -EINVAL;
+    }
+    t = peek();
+    if (t.type != Token::Type::Word && t.type != Token::Type::QuotedName) {
+      return expected("a column");
+    }
+    ++pos;
+  }
+  e = std::make_unique<Expr>(Expr::Type::Column);
+  if (t.type == Token::Type::QuotedName || !parse_column_index(t.text, e->column)) {
+    e->name = t.text;
+  }
+  return 0;
+}
+
+int Parser::parse_operand(std::unique_ptr<Expr>& e)
+{
+  const auto& t = peek();
+  const bool negative = accept_symbol("-");
+  if (peek().type == Token::Type::Number) {
+    e = std::make_unique<Expr>(Expr::Type::Number);
+    char *end;
+    e->number = strtod(peek().text.c_str(), &end);
+    if (*end) {
+      return expected("a number");
+    }
+    if (negative) {
+      e->number = -e->number;
+    }
+    ++pos;
+    return 0;
+  }
+  if (negative) {
+    return expected("a number");
+  }
+  if (t.type == Token::Type::String) {
+    e = std::make_unique<Expr>(Expr::Type::String);
+    e->name = t.text;
+    ++pos;
+    return 0;
+  }
+  if (is_keyword(t, "cast") && tokens[pos + 1].text == "(") {
+    pos += 2;
+    std::unique_ptr<Expr> column;
+    int r = parse_column(column);
+    if (r < 0) {
+      return r;
+    }
+    if (!accept_keyword("as")) {
+      return expected("AS");
+    }
+    if (accept_keyword("int") || accept_keyword("integer") ||
+        accept_keyword("float") || accept_keyword("decimal") ||
+        accept_keyword("numeric")) {
+      e = std::make_unique<Expr>(Expr::Type::Cast);
+      e->left = std::move(column);
+    } else if (accept_keyword("string") || accept_keyword("varchar")) {
+      e = std::move(column);
+    } else {
+      return expected("a type");
+    }
+    if (!accept_symbol(")")) {
+      return expected("')'");
+    }
+    return 0;
+  }
+  return parse_column(e);
+}
+
+int Parser::parse_predicate(std::unique_ptr<Expr>& e)
+{
+  if (accept_symbol("(")) {
+    int r = parse_or(e);
+    if (r < 0) {
+      return r;
+    }
+    if (!accept_symbol(")")) {
+      return expected("')'");
+    }
+    return 0;
+  }
+  std::unique_ptr<Expr> left;
+  int r = parse_operand(left);
+  if (r < 0) {
+    return r;
+  }
+  if (accept_keyword("is")) {
+    const bool negate = accept_keyword("not");
+    if (!accept_keyword("null")) {
+      return expected("NULL");
+    }
+    e = std::make_unique<Expr>(negate ? Expr::Type::IsNotNull : Expr::Type::IsNull);
+    e->left = std::move(left);
+    return 0;
+  }
+  const bool negate = accept_keyword("not");
+  if (accept_keyword("like")) {
+    if (peek().type != Token::Type::String) {
+      return expected("a LIKE pattern");
+    }
+    e = std::make_unique<Expr>(negate ? Expr::Type::NotLike : Expr::Type::Like);
+    e->left = std::move(left);
+    e->name = peek().text;
+    ++pos;
+    return 0;
+  }
+  if (negate) {
+    return expected("LIKE");
+  }
+  static const std::pair<const char*, Expr::Type> ops[] = {
+    {"=", Expr::Type::Eq}, {"<>", Expr::Type::Ne}, {"!=", Expr::Type::Ne},
+    {"<", Expr::Type::Lt}, {"<=", Expr::Type::Le},
+    {">", Expr::Type::Gt}, {">=", Expr::Type::Ge},
+  };
+  for (const auto& [symbol, type] : ops) {
+    if (accept_symbol(symbol)) {
+      e = std::make_unique<Expr>(type);
+      e->left = std::move(left);
+      return parse_operand(e->right);
+    }
+  }
+  return expected("a comparison");
+}
+
+int Parser::parse_not(std::unique_ptr<Expr>& e)
+{
+  if (accept_keyword("not")) {
+    e = std::make_unique<Expr>(Expr::Type::Not);
+    return parse_not(e->left);
+  }
+  return parse_predicate(e);
+}
+
+int Parser::parse_and(std::unique_ptr<Expr>& e)
+{
+  int r = parse_not(e);
+  while (r == 0 && accept_keyword("and")) {
+    auto node = std::make_unique<Expr>(Expr::Type::And);
+    node->left = std::move(e);
+    r = parse_not(node->right);
+    e = std::move(node);
+  }
+  return r;
+}
+
+int Parser::parse_or(std::unique_ptr<Expr>& e)
+{
+  int r = parse_and(e);
+  while (r == 0 && accept_keyword("or")) {
+    auto node = std::make_unique<Expr>(Expr::Type::Or);
+    node->left = std::move(e);
+    r = parse_and(node->right);
+    e = std::move(node);
+  }
+  return r;
+}
+
+int Parser::parse_from()
+{
+  if (!accept_keyword("s3object")) {
+    return expected("S3Object");
+  }
+  // S3Object[*] is the JSON form, accept it here as well
+  if (accept_symbol("[")) {
+    if (!accept_symbol("*") || !accept_symbol("]")) {
+      return expected("[*]");
+    }
+  }
+  const bool as = accept_keyword("as");
+  const auto& t = peek();
+  if (t.type == Token::Type::Word && !is_keyword(t, "where") &&
+      !is_keyword(t, "limit")) {
+    alias = t.text;
+    ++pos;
+  } else if (as) {
+    return expected("an alias");
+  }
+  return 0;
+}
+
+int Parser::parse(std::string_view sql, Query& query)
+{
+  int r = tokenize(sql, tokens, err);
+  if (r < 0) {
+    return r;
+  }
+  if (!accept_keyword("select")) {
+    return expected("SELECT");
+  }
+  // the alias is needed to parse the projection, so read FROM first
+  const size_t projection = pos;
+  while (peek().type != Token::Type::End && !is_keyword(peek(), "from")) {
+    ++pos;
+  }
+  if (!accept_keyword("from")) {
+    return expected("FROM");
+  }
+  r = parse_from();
+  if (r < 0) {
+    return r;
+  }
+  const size_t rest = pos;
+
+  pos = projection;
+  if (accept_symbol("*")) {
+    query.select_all = true;
+  } else if (is_keyword(peek(), "count") && tokens[pos + 1].text == "(") {
+    pos += 2;
+    if (!accept_symbol("*") || !accept_symbol(")")) {
+      return expected("COUNT(*)");
+    }
+    query.count = true;
+  } else {
+    do {
+      std::unique_ptr<Expr> column;
+      r = parse_column(column);
+      if (r < 0) {
+        return r;
+      }
+      query.columns.push_back(std::move(column));
+    } while (accept_symbol(","));
+  }
+  if (!is_keyword(peek(), "from")) {
+    return expected("FROM");
+  }
+
+  pos = rest;
+  if (accept_keyword("where")) {
+    r = parse_or(query.where);
+    if (r < 0) {
+      return r;
+    }
+  }
+  if (accept_keyword("limit")) {
+    char *end;
+    const auto& t = peek();
+    if (t.type != Token::Type::Number) {
+      return expected("a LIMIT");
+    }
+    query.limit = strtoull(t.text.c_str(), &end, 10);
+    if (*end) {
+      return expected("a LIMIT");
+    }
+    ++pos;
+  }
+  if (peek().type != Token::Type::End) {
+    return expected("the end of the statement");
+  }
+  return 0;
+}
+
+bool to_number(std::string_view s, double& n)
+{
+  char buf[64];
+  while (!s.empty() && isspace(static_cast<unsigned char>(s.front()))) {
+    s.remove_prefix(1);
+  }
+  while (!s.empty() && isspace(static_cast<unsigned char>(s.back()))) {
+    s.remove_suffix(1);
+  }
+  if (s.empty() || s.size() >= sizeof(buf)) {
+    return false;
+  }
+  memcpy(buf, s.data(), s.size());
+  buf[s.size()] = '\0';
+  char *end;
+  n = strtod(buf, &end);
+  return *end == '\0';
+}
+
+bool like(std::string_view s, std::string_view pattern)
+{
+  // the usual wildcard matching, backtracking to the last '%'
+  size_t i = 0, p = 0;
+  size_t star = std::string_view::npos, mark = 0;
+  while (i < s.size()) {
+    if (p < pattern.size() && (pattern[p] == '_' || pattern[p] == s[i])) {
+      ++i;
+      ++p;
+    } else if (p < pattern.size() && pattern[p] == '%') {
+      star = p++;
+      mark = i;
+    } else if (star != std::string_view::npos) {
+      p = star + 1;
+      i = ++mark;
+    } else {
+      return false;
+    }
+  }
+  while (p < pattern.size() && pattern[p] == '%') {
+    ++p;
+  }
+  return p == pattern.size();
+}
+
+bool is_numeric(const Expr& e)
+{
+  return e.type == Expr::Type::Number || e.type == Expr::Type::Cast;
+}
+
+bool compare(Expr::Type op, int c)
+{
+  switch (op) {
+  case Expr::Type::Eq: return c == 0;
+  case Expr::Type::Ne: return c != 0;
+  case Expr::Type::Lt: return c < 0;
+  case Expr::Type::Le: return c <= 0;
+  case Expr::Type::Gt: return c > 0;
+  case Expr::Type::Ge: return c >= 0;
+  default: return false;
+  }
+}
+
+std::optional<std::string_view> string_value(const Expr& e, const Batch& batch,
+                                             uint32_t record)
+{
+  if (e.type == Expr::Type::Column) {
+    return batch.field(record, e.column);
+  }
+  return std::string_view(e.name);
+}
+
+std::optional<double> number_value(const Expr& e, const Batch& batch,
+                                   uint32_t record)
+{
+  if (e.type == Expr::Type::Number) {
+    return e.number;
+  }
+  const Expr& column = e.type == Expr::Type::Cast ? *e.left : e;
+  auto field = batch.field(record, column.column);
+  double n;
+  if (!field || !to_number(*field, n)) {
+    return std::nullopt;
+  }
+  return n;
+}
+
+/// keeps the records of selection for which pred(record) is true
+template <typename Pred>
+void keep_if(std::vector<uint32_t>& selection, Pred&& pred)
+{
+  selection.erase(std::remove_if(selection.begin(), selection.end(),
+                                 [&pred] (uint32_t r) { return !pred(r); }),
+                  selection.end());
+}
+
+void filter_compare(const Expr& e, const Batch& batch,
+                    std::vector<uint32_t>& selection)
+{
+  const Expr& l = *e.left;
+  const Expr& r = *e.right;
+  if (is_numeric(l) || is_numeric(r)) {
+    if (r.type == Expr::Type::Number) {
+      const double value = r.number;
+      keep_if(selection, [&] (uint32_t i) {
+          auto n = number_value(l, batch, i);
+          return n && compare(e.type, *n < value ? -1 : (*n > value ? 1 : 0));
+        });
+      return;
+    }
+    keep_if(selection, [&] (uint32_t i) {
+        auto a = number_value(l, batch, i);
+        auto b = number_value(r, batch, i);
+        return a && b && compare(e.type, *a < *b ? -1 : (*a > *b ? 1 : 0));
+      });
+    return;
+  }
+  if (l.type == Expr::Type::Column && r.type == Expr::Type::String) {
+    const std::string_view value = r.name;
+    keep_if(selection, [&] (uint32_t i) {
+        auto s = batch.field(i, l.column);
+        return s && compare(e.type, s->compare(value));
+      });
+    return;
+  }
+  keep_if(selection, [&] (uint32_t i) {
+      auto a = string_value(l, batch, i);
+      auto b = string_value(r, batch, i);
+      return a && b && compare(e.type, a->compare(*b));
+    });
+}
+
+/// the records of all that are not in some, both sorted
+std::vector<uint32_t> difference(const std::vector<uint32_t>& all,
+                                 const std::vector<uint32_t>& some)
+{
+  std::vector<uint32_t> result;
+  result.reserve(all.size() - some.size());
+  std::set_difference(all.begin(), all.end(), some.begin(), some.end(),
+                      std::back_inserter(result));
+  return result;
+}
+
+void append_event_header(std::string& out, std::string_view name,
+                         std::string_view value)
+{
+  out.push_back(static_cast<char>(name.size()));
+  out.append(name);
+  out.push_back(7); // string
+  out.push_back(static_cast<char>((value.size() >> 8) & 0xff));
+  out.push_back(static_cast<char>(value.size() & 0xff));
+  out.append(value);
+}
+
+void append_be32(std::string& out, uint32_t v)
+{
+  out.push_back(static_cast<char>((v >> 24) & 0xff));
+  out.push_back(static_cast<char>((v >> 16) & 0xff));
+  out.push_back(static_cast<char>((v >> 8) & 0xff));
+  out.push_back(static_cast<char>(v & 0xff));
+}
+
+uint32_t crc32(const char *data, size_t len)
+{
+  boost::crc_32_type crc;
+  crc.process_bytes(data, len);
+  return crc.checksum();
+}
+
+void encode_event(const std::string& headers, std::string_view payload,
+                  std::string& out)
+{
+  const size_t start = out.size();
+  append_be32(out, 12 + headers.size() + payload.size() + 4);
+  append_be32(out, headers.size());
+  append_be32(out, crc32(out.data() + start, 8));
+  out.append(headers);
+  out.append(payload);
+  append_be32(out, crc32(out.data() + start, out.size() - start));
+}
+
+} // anonymous namespace
+
+int parse_query(std::string_view sql, Query& query, std::string& err)
+{
+  Parser parser(err);
+  return parser.parse(sql, query);
+}
+
+std::optional<std::string_view> Batch::field(uint32_t record, int column) const
+{
+  const uint32_t begin = record_begin[record];
+  const uint32_t end = record + 1 < record_begin.size() ?
+      record_begin[record + 1] : fields.size();
+  if (column < 0 || begin + column >= end) {
+    return std::nullopt;
+  }
+  return fields[begin + column];
+}
+
+void Batch::clear()
+{
+  fields.clear();
+  record_begin.clear();
+  unquoted.clear();
+}
+
+void filter(const Expr& e, const Batch& batch, std::vector<uint32_t>& selection)
+{
+  if (selection.empty()) {
+    return;
+  }
+  switch (e.type) {
+  case Expr::Type::And:
+    // the right side only looks at the records the left one kept
+    filter(*e.left, batch, selection);
+    filter(*e.right, batch, selection);
+    break;
+  case Expr::Type::Or:
+    {
+      std::vector<uint32_t> left = selection;
+      filter(*e.left, batch, left);
+      std::vector<uint32_t> right = difference(selection, left);
+      filter(*e.right, batch, right);
+      selection.clear();
+      std::merge(left.begin(), left.end(), right.begin(), right.end(),
+                 std::back_inserter(selection));
+    }
+    break;
+  case Expr::Type::Not:
+    {
+      // unknown (null) comparisons count as false here, so NOT of them holds
+      std::vector<uint32_t> matched = selection;
+      filter(*e.left, batch, matched);
+      selection = difference(selection, matched);
+    }
+    break;
+  case Expr::Type::Eq: case Expr::Type::Ne:
+  case Expr::Type::Lt: case Expr::Type::Le:
+  case Expr::Type::Gt: case Expr::Type::Ge:
+    filter_compare(e, batch, selection);
+    break;
+  case Expr::Type::Like: case Expr::Type::NotLike:
+    {
+      const bool negate = e.type == Expr::Type::NotLike;
+      keep_if(selection, [&] (uint32_t i) {
+          auto s = string_value(*e.left, batch, i);
+          return s && like(*s, e.name) != negate;
+        });
+    }
+    break;
+  case Expr::Type::IsNull: case Expr::Type::IsNotNull:
+    {
+      const bool negate = e.type == Expr::Type::IsNotNull;
+      const Expr& column = e.left->type == Expr::Type::Cast ? *e.left->left : *e.left;
+      if (column.type != Expr::Type::Column) {
+        // literals are never null
+        if (!negate) {
+          selection.clear();
+        }
+        break;
+      }
+      keep_if(selection, [&] (uint32_t i) {
+          auto s = batch.field(i, column.column);
+          return (!s || s->empty()) != negate;
+        });
+    }
+    break;
+  default:
+    // a lone operand isn't a condition, the parser doesn't produce it
+    selection.clear();
+    break;
+  }
+}
+
+CSVSelect::CSVSelect(Query& query, const CSVFormat& in, const CSVFormat& out)
+  : query(query), in(in), out(out),
+    header_done(in.header == CSVFormat::Header::None)
+{}
+
+size_t CSVSelect::split(std::string_view data, bool last)
+{
+  size_t pos = 0;
+  while (pos < data.size()) {
+    const size_t record = pos;
+    const size_t first_field = batch.fields.size();
+    bool complete = false;
+    while (!complete) {
+      if (pos < data.size() && data[pos] == in.quote) {
+        // quoted field, unquoted in place unless it has escaped quotes
+        const size_t begin = ++pos;
+        std::string *unquoted = nullptr;
+        bool closed = false;
+        while (pos < data.size()) {
+          const char c = data[pos];
+          if (c == in.quote_escape && pos + 1 < data.size() &&
+              data[pos + 1] == in.quote) {
+            if (!unquoted) {
+              unquoted = &batch.unquoted.emplace_back(data.substr(begin, pos - begin));
+            }
+            unquoted->push_back(in.quote);
+            pos += 2;
+          } else if (c == in.quote) {
+            closed = true;
+            break;
+          } else {
+            if (unquoted) {
+              unquoted->push_back(c);
+            }
+            ++pos;
+          }
+        }
+        if (!closed) {
+          if (!last) {
+            break;
+          }
+          // unterminated at the end of the object, take what's there
+        }
+        batch.fields.push_back(unquoted ? std::string_view(*unquoted) :
+                               data.substr(begin, pos - begin));
+        if (closed) {
+          ++pos;
+        }
+        // skip anything between the closing quote and the delimiter
+        while (pos < data.size() && data[pos] != in.field_delimiter &&
+               data[pos] != in.record_delimiter) {
+          ++pos;
+        }
+      } else {
+        const size_t begin = pos;
+        while (pos < data.size() && data[pos] != in.field_delimiter &&
+               data[pos] != in.record_delimiter) {
+          ++pos;
+        }
+        auto field = data.substr(begin, pos - begin);
+        if (in.record_delimiter == '\n' && pos < data.size() &&
+            data[pos] == '\n' && !field.empty() && field.back() == '\r') {
+          field.remove_suffix(1);
+        }
+        batch.fields.push_back(field);
+      }
+      if (pos == data.size()) {
+        complete = last;
+        break;
+      }
+      if (data[pos++] == in.record_delimiter) {
+        complete = true;
+      }
+    }
+    if (!complete) {
+      // wait for the rest of the record
+      batch.fields.resize(first_field);
+      return record;
+    }
+
+    const auto first = batch.fields[first_field];
+    if ((batch.fields.size() == first_field + 1 && first.empty()) ||
+        (in.comments && data[record] == in.comments)) {
+      batch.fields.resize(first_field);
+    } else if (!header_done) {
+      header_done = true;
+      if (in.header == CSVFormat::Header::Use) {
+        for (size_t i = first_field; i < batch.fields.size(); ++i) {
+          header.emplace_back(batch.fields[i]);
+        }
+      }
+      batch.fields.resize(first_field);
+    } else {
+      batch.record_begin.push_back(first_field);
+    }
+  }
+  return pos;
+}
+
+int CSVSelect::resolve(Expr& e, std::string& err) const
+{
+  if (e.type == Expr::Type::Column && e.column < 0) {
+    auto i = std::find_if(header.begin(), header.end(),
+                          [&e] (const std::string& h) {
+                            return strcasecmp(h.c_str(), e.name.c_str()) == 0;
+                          });
+    if (i == header.end()) {
+      err = "unknown column '" + e.name + "'";
+      return -EINVAL;
+    }
+    e.column = i - header.begin();
+  }
+  for (auto child : {e.left.get(), e.right.get()}) {
+    if (child) {
+      int r = resolve(*child, err);
+      if (r < 0) {
+        return r;
+      }
+    }
+  }
+  return 0;
+}
+
+void CSVSelect::write_field(std::string_view field, std::string& result) const
+{
+  const bool quote = out.quote_always ||
+      field.find_first_of(std::string{out.field_delimiter, out.record_delimiter,
+                                      out.quote, '\r', '\n'}) != field.npos;
+  if (!quote) {
+    result.append(field);
+    return;
+  }
+  result.push_back(out.quote);
+  for (auto c : field) {
+    if (c == out.quote) {
+      result.push_back(out.quote_escape);
+    }
+    result.push_back(c);
+  }
+  result.push_back(out.quote);
+}
+
+int CSVSelect::select(std::string& result, std::string& err)
+{
+  if (batch.size() == 0) {
+    batch.clear();
+    return 0;
+  }
+  if (!header.empty() || in.header != CSVFormat::Header::Use) {
+    // names resolve once the header is known, _<n> columns already are
+    for (auto& c : query.columns) {
+      int r = resolve(*c, err);
+      if (r < 0) {
+        return r;
+      }
+    }
+    if (query.where) {
+      int r = resolve(*query.where, err);
+      if (r < 0) {
+        return r;
+      }
+    }
+  }
+
+  selection.resize(batch.size());
+  for (uint32_t i = 0; i < selection.size(); ++i) {
+    selection[i] = i;
+  }
+  if (query.where) {
+    filter(*query.where, batch, selection);
+  }
+  if (query.count) {
+    matches += selection.size();
+    batch.clear();
+    return 0;
+  }
+
+  const size_t start = result.size();
+  for (auto i : selection) {
+    if (done()) {
+      break;
+    }
+    if (query.select_all) {
+      const uint32_t begin = batch.record_begin[i];
+      const uint32_t end = i + 1 < batch.size() ?
+          batch.record_begin[i + 1] : batch.fields.size();
+      for (uint32_t f = begin; f < end; ++f) {
+        if (f > begin) {
+          result.push_back(out.field_delimiter);
+        }
+        write_field(batch.fields[f], result);
+      }
+    } else {
+      bool first = true;
+      for (const auto& c : query.columns) {
+        if (!first) {
+          result.push_back(out.field_delimiter);
+        }
+        first = false;
+        if (auto field = batch.field(i, c->column); field) {
+          write_field(*field, result);
+        }
+      }
+    }
+    result.push_back(out.record_delimiter);
+    ++returned;
+  }
+  bytes_returned += result.size() - start;
+  batch.clear();
+  return 0;
+}
+
+int CSVSelect::process(std::string_view data, std::string& result,
+                       std::string& err)
+{
+  bytes_scanned += data.size();
+  if (done()) {
+    return 0;
+  }
+  if (!carry.empty()) {
+    // complete the record left over by the previous chunk on its own, so the
+    // rest of the chunk is split in place rather than copied after it
+    size_t end = 0;
+    for (;;) {
+      end = data.find(in.record_delimiter, end);
+      if (end == data.npos) {
+        carry.append(data);
+        return 0;
+      }
+      ++end;
+      const size_t carried = carry.size();
+      carry.append(data.substr(0, end));
+      if (split(carry, false) == carry.size()) {
+        break;
+      }
+      batch.clear();
+      carry.resize(carried);
+    }
+    int r = select(result, err);
+    if (r < 0) {
+      return r;
+    }
+    carry.clear();
+    data.remove_prefix(end);
+  }
+
+  const size_t consumed = split(data, false);
+  int r = select(result, err);
+  if (r < 0) {
+    return r;
+  }
+  carry.assign(data.substr(consumed));
+  return 0;
+}
+
+int CSVSelect::finish(std::string& result, std::string& err)
+{
+  if (!carry.empty() && !done()) {
+    split(carry, true);
+    int r = select(result, err);
+    if (r < 0) {
+      return r;
+    }
+    carry.clear();
+  }
+  if (query.count) {
+    const size_t start = result.size();
+    result.append(std::to_string(matches));
+    result.push_back(out.record_delimiter);
+    bytes_returned += result.size() - start;
+  }
+  return 0;
+}
+
+void encode_records_event(std::string_view payload, std::string& out)
+{
+  std::string headers;
+  append_event_header(headers, ":event-type", "Records");
+  append_event_header(headers, ":content-type", "application/octet-stream");
+  append_event_header(headers, ":message-type", "event");
+  encode_event(headers, payload, out);
+}
+
+void encode_stats_event(uint64_t scanned, uint64_t processed,
+                        uint64_t returned, std::string& out)
+{
+  std::string headers;
+  append_event_header(headers, ":event-type", "Stats");
+  append_event_header(headers, ":content-type", "text/xml");
+  append_event_header(headers, ":message-type", "event");
+  const std::string payload =
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?><Stats><BytesScanned>" +
+      std::to_string(scanned) + "</BytesScanned><BytesProcessed>" +
+      std::to_string(processed) + "</BytesProcessed><BytesReturned>" +
+      std::to_string(returned) + "</BytesReturned></Stats>";
+  encode_event(headers, payload, out);
+}
+
+void encode_end_event(std::string& out)
+{
+  std::string headers;
+  append_event_header(headers, ":event-type", "End");
+  append_event_header(headers, ":message-type", "event");
+  encode_event(headers, {}, out);
+}
+
+void encode_error_event(std::string_view code, std::string_view message,
+                        std::string& out)
+{
+  std::string headers;
+  append_event_header(headers, ":error-code", code);
+  append_event_header(headers, ":error-message", message);
+  append_event_header(headers, ":message-type", "error");
+  encode_event(headers, {}, out);
+}
+
+} // namespace rgw::s3select
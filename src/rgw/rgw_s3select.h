@@ -0,0 +1,140 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_RGW_S3SELECT_H
+#define CEPH_RGW_S3SELECT_H
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * S3 Select: the SQL subset of SelectObjectContent evaluated over CSV
+ * objects, as they are read, and the event stream framing of its results.
+ *
+ * The supported statements are
+ *
+ *   SELECT * | COUNT(*) | <column>[, <column>...]
+ *   FROM S3Object [[AS] <alias>] [WHERE <condition>] [LIMIT <n>]
+ *
+ * where a column is _<n> (1-based), a header name when FileHeaderInfo is
+ * USE, or either of them prefixed with the alias. Conditions combine
+ * =, <>, !=, <, <=, >, >=, [NOT] LIKE and IS [NOT] NULL with AND, OR, NOT
+ * and parentheses. A comparison with a number, or with CAST(<column> AS
+ * INT|FLOAT|DECIMAL), compares numerically.
+ *
+ * Records are split and filtered one input chunk at a time: a condition is
+ * applied to the whole batch of records of a chunk, each node of the
+ * expression narrowing down the selection of rows the next one looks at.
+ */
+namespace rgw::s3select {
+
+struct Expr {
+  enum class Type {
+    Column, ///< a column of the record, or null
+    String,
+    Number,
+    Cast,   ///< the column of the left operand, as a number
+    Eq, Ne, Lt, Le, Gt, Ge,
+    Like, NotLike,
+    IsNull, IsNotNull,
+    And, Or, Not,
+  };
+  Type type;
+  int column = -1;  ///< 0-based, resolved from name when negative
+  std::string name; ///< column name, or the string literal / like pattern
+  double number = 0;
+  std::unique_ptr<Expr> left;
+  std::unique_ptr<Expr> right;
+
+  explicit Expr(Type type) : type(type) {}
+};
+
+struct Query {
+  bool select_all = false;
+  bool count = false;
+  std::vector<std::unique_ptr<Expr>> columns; ///< when neither of the above
+  std::unique_ptr<Expr> where;
+  std::optional<uint64_t> limit;
+};
+
+/// parses sql into query, or returns -EINVAL with the reason in err
+int parse_query(std::string_view sql, Query& query, std::string& err);
+
+struct CSVFormat {
+  enum class Header { None, Ignore, Use };
+
+  char field_delimiter = ',';
+  char record_delimiter = '\n';
+  char quote = '"';
+  char quote_escape = '"';
+  char comments = 0;            ///< input only, records starting with it are skipped
+  Header header = Header::None; ///< input only
+  bool quote_always = false;    ///< output only, QuoteFields ALWAYS
+};
+
+/// the records of one input chunk, split into fields
+struct Batch {
+  std::vector<std::string_view> fields;
+  std::vector<uint32_t> record_begin; ///< index of each record's first field
+  std::deque<std::string> unquoted;   ///< storage of the fields that had quotes
+
+  size_t size() const { return record_begin.size(); }
+  std::optional<std::string_view> field(uint32_t record, int column) const;
+  void clear();
+};
+
+class CSVSelect {
+  Query& query;
+  const CSVFormat in;
+  const CSVFormat out;
+
+  bool header_done;
+  std::vector<std::string> header;
+  std::string carry; ///< the start of a record left over by the previous chunk
+  Batch batch;
+  std::vector<uint32_t> selection;
+  uint64_t returned = 0; ///< records output so far
+  uint64_t matches = 0;  ///< for COUNT(*)
+
+  size_t split(std::string_view data, bool last);
+  int resolve(Expr& e, std::string& err) const;
+  int select(std::string& result, std::string& err);
+  void write_field(std::string_view field, std::string& result) const;
+
+public:
+  uint64_t bytes_scanned = 0;
+  uint64_t bytes_returned = 0;
+
+  CSVSelect(Query& query, const CSVFormat& in, const CSVFormat& out);
+
+  /// selects the records of the next chunk of the object, appending them to
+  /// result. returns -EINVAL with err set if the query does not apply
+  int process(std::string_view data, std::string& result, std::string& err);
+  /// flushes the last record, if it had no delimiter, and the COUNT(*) result
+  int finish(std::string& result, std::string& err);
+  /// true once LIMIT records are out, the rest of the object can be skipped
+  bool done() const { return query.limit && returned >= *query.limit; }
+};
+
+/// keeps the records of selection for which e holds, in order
+void filter(const Expr& e, const Batch& batch, std::vector<uint32_t>& selection);
+
+/*
+ * messages of the application/vnd.amazon.eventstream encoding:
+ * prelude (total and headers length, crc), headers, payload, crc
+ */
+void encode_records_event(std::string_view payload, std::string& out);
+void encode_stats_event(uint64_t scanned, uint64_t processed,
+                        uint64_t returned, std::string& out);
+void encode_end_event(std::string& out);
+void encode_error_event(std::string_view code, std::string_view message,
+                        std::string& out);
+
+} // namespace rgw::s3select
+
+#endif
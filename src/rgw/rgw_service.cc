@@ -136,10 +136,11 @@ void RGWServices_Def::shutdown()
 
   sysobj->shutdown();
   sysobj_core->shutdown();
-  notify->shutdown();
+  // flushes the pending cache invalidations, so must precede notify
   if (sysobj_cache) {
     sysobj_cache->shutdown();
   }
+  notify->shutdown();
   quota->shutdown();
   zone_utils->shutdown();
   zone->shutdown();
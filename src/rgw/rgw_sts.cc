@@ -270,7 +270,7 @@ int STSService::storeARN(string& arn)
 {
   int ret = 0;
   RGWUserInfo info;
-  if (ret = rgw_get_user_info_by_uid(store, user_id, info); ret < 0) {
+  if (ret = rgw_get_user_info_by_uid(store, user_id, info, null_yield); ret < 0) {
     return -ERR_NO_SUCH_ENTITY;
   }
 
@@ -13,6 +13,7 @@ enum {
   l_fetch,
   l_fetch_not_modified,
   l_fetch_err,
+  l_fetch_lat,
 
   l_poll,
   l_poll_err,
@@ -10,6 +10,7 @@
 #include "rgw_sync_module_es_rest.h"
 #include "rgw_rest_conn.h"
 #include "rgw_cr_rest.h"
+#include "rgw_http_errors.h"
 #include "rgw_op.h"
 #include "rgw_es_query.h"
 #include "rgw_zone.h"
@@ -109,6 +110,8 @@ public:
 
 #define ES_NUM_SHARDS_DEFAULT 16
 #define ES_NUM_REPLICAS_DEFAULT 1
+#define ES_BULK_MAX_ENTRIES_DEFAULT 500
+#define ES_BULK_FLUSH_INTERVAL_MS_DEFAULT 100
 
 using ESVersion = std::pair<int,int>;
 static constexpr ESVersion ES_V5{5,0};
@@ -170,7 +173,10 @@ struct ElasticConfig {
   ItemList allow_owners;
   uint32_t num_shards{0};
   uint32_t num_replicas{0};
+  uint32_t bulk_max_entries{0};
+  uint32_t bulk_flush_interval_ms{0};
   std::map <string,string> default_headers = {{ "Content-Type", "application/json" }};
+  std::map <string,string> bulk_headers;
 
   void init(CephContext *cct, const JSONFormattable& config) {
     string elastic_endpoint = config["endpoint"];
@@ -190,7 +196,10 @@ struct ElasticConfig {
       auto auth_string = user + ":" + pw;
       default_headers.emplace("AUTHORIZATION", "Basic " + rgw::to_base64(auth_string));
     }
-
+    bulk_max_entries = config["bulk_max_entries"](ES_BULK_MAX_ENTRIES_DEFAULT);
+    bulk_flush_interval_ms = config["bulk_flush_interval_ms"](ES_BULK_FLUSH_INTERVAL_MS_DEFAULT);
+    bulk_headers = default_headers;
+    bulk_headers["Content-Type"] = "application/x-ndjson";
   }
 
   void init_instance(const RGWRealm& realm, uint64_t instance_id) {
@@ -215,8 +224,16 @@ struct ElasticConfig {
     return default_headers;
   }
 
+  string get_obj_id(const RGWBucketInfo& bucket_info, const rgw_obj_key& key) {
+    return bucket_info.bucket.bucket_id + ":" + key.name + ":" + (key.instance.empty() ? "null" : key.instance);
+  }
+
   string get_obj_path(const RGWBucketInfo& bucket_info, const rgw_obj_key& key) {
-    return index_path +  "/object/" + url_encode(bucket_info.bucket.bucket_id + ":" + key.name + ":" + (key.instance.empty() ? "null" : key.instance));
+    return index_path +  "/object/" + url_encode(get_obj_id(bucket_info, key));
+  }
+
+  bool use_bulk() const {
+    return bulk_max_entries > 1;
   }
 
   bool should_handle_operation(RGWBucketInfo& bucket_info) {
@@ -707,14 +724,212 @@ public:
 
 };
 
+struct es_bulk_item_result {
+  int status{0};
+  string error_type;
+  string error_reason;
+
+  void decode_json(JSONObj *obj) {
+    /* a single member, named after the action */
+    JSONObjIter iter = obj->find_first();
+    if (iter.end()) {
+      return;
+    }
+    JSONObj *action = *iter;
+    JSONDecoder::decode_json("status", status, action);
+    JSONObj *error = action->find_obj("error");
+    if (error) {
+      JSONDecoder::decode_json("type", error_type, error);
+      JSONDecoder::decode_json("reason", error_reason, error);
+    }
+  }
+};
+
+struct es_bulk_response {
+  bool errors{false};
+  vector<es_bulk_item_result> items;
+
+  void decode_json(JSONObj *obj) {
+    JSONDecoder::decode_json("errors", errors, obj);
+    JSONDecoder::decode_json("items", items, obj);
+  }
+};
+
+/*
+ * index and delete actions sent to elasticsearch in a single _bulk request
+ */
+struct ElasticBulkBatch {
+  bufferlist body;
+  size_t num_entries{0};
+  bool full{false};
+  bool done{false};
+  int ret{0};
+  es_bulk_response response;
+
+  /* the first entry's coroutine sends the batch, the others wait for it */
+  RGWCoroutinesStack *leader{nullptr};
+  vector<RGWCoroutinesStack *> waiters;
+
+  int get_result(size_t pos, string *err) const {
+    if (ret < 0) {
+      return ret;
+    }
+    if (pos >= response.items.size()) {
+      *err = "missing result";
+      return -EIO;
+    }
+    auto& item = response.items[pos];
+    if (!item.error_type.empty()) {
+      *err = item.error_type + ": " + item.error_reason;
+    }
+    return rgw_http_error_to_errno(item.status);
+  }
+};
+using ElasticBulkBatchRef = std::shared_ptr<ElasticBulkBatch>;
+
+/*
+ * Collects the entries of the objects synced concurrently into batches.
+ * Only the coroutines of a single data sync env (and thus of a single
+ * coroutines manager) use a given queue.
+ */
+class ElasticBulkQueue {
+  uint32_t max_entries;
+  ElasticBulkBatchRef current;
+public:
+  explicit ElasticBulkQueue(uint32_t _max_entries) : max_entries(_max_entries) {}
+
+  ElasticBulkBatchRef add(bufferlist& entry, RGWCoroutinesStack *stack, size_t *pos) {
+    if (!current) {
+      current = std::make_shared<ElasticBulkBatch>();
+      current->leader = stack;
+    } else {
+      current->waiters.push_back(stack);
+    }
+    auto batch = current;
+    *pos = batch->num_entries++;
+    batch->body.claim_append(entry);
+    if (batch->num_entries >= max_entries) {
+      batch->full = true;
+      current.reset();
+      if (*pos > 0) {
+        /* cut the leader's flush interval short */
+        batch->leader->wakeup();
+      }
+    }
+    return batch;
+  }
+
+  void close(const ElasticBulkBatchRef& batch) {
+    if (current == batch) {
+      current.reset();
+    }
+  }
+};
+using ElasticBulkQueueRef = std::shared_ptr<ElasticBulkQueue>;
+
+static void es_bulk_encode_action(const char *action, const string& id, bufferlist *bl)
+{
+  JSONFormatter jf;
+  jf.open_object_section("");
+  jf.open_object_section(action);
+  ::encode_json("_type", "object", &jf);
+  ::encode_json("_id", id, &jf);
+  jf.close_section();
+  jf.close_section();
+  std::stringstream ss;
+  jf.flush(ss);
+  bl->append(ss.str());
+  bl->append('\n');
+}
+
+template <class T>
+static void es_bulk_encode_doc(const T& doc, bufferlist *bl)
+{
+  JSONFormatter jf;
+  ::encode_json("data", doc, &jf);
+  std::stringstream ss;
+  jf.flush(ss);
+  bl->append(ss.str());
+  bl->append('\n');
+}
+
+/*
+ * Adds an entry to the current batch and completes once the batch, sent
+ * by its first entry after bulk_flush_interval_ms or as soon as it is
+ * full, was handled by elasticsearch.
+ */
+class RGWElasticBulkCR : public RGWCoroutine {
+  RGWDataSyncEnv *sync_env;
+  ElasticConfigRef conf;
+  ElasticBulkQueueRef queue;
+  bufferlist entry;
+  ElasticBulkBatchRef batch;
+  size_t pos{0};
+  string err;
+public:
+  RGWElasticBulkCR(RGWDataSyncEnv *_sync_env, ElasticConfigRef _conf,
+                   ElasticBulkQueueRef _queue, bufferlist& _entry) : RGWCoroutine(_sync_env->cct),
+                                                                     sync_env(_sync_env),
+                                                                     conf(_conf), queue(_queue) {
+    entry.claim(_entry);
+  }
+
+  int operate() override {
+    reenter(this) {
+      batch = queue->add(entry, get_stack(), &pos);
+      if (pos == 0) {
+        if (!batch->full) {
+          /* let the objects synced concurrently join the batch */
+          yield {
+            utime_t interval;
+            interval.set_from_double(conf->bulk_flush_interval_ms / 1000.0);
+            wait(interval);
+          }
+          queue->close(batch);
+        }
+        ldout(sync_env->cct, 20) << "elasticsearch: sending bulk request with "
+                                 << batch->num_entries << " entries" << dendl;
+        yield call(new RGWPostRawRESTResourceCR<es_bulk_response, int>(sync_env->cct,
+                                                                       conf->conn.get(),
+                                                                       sync_env->http_manager,
+                                                                       conf->get_index_path() + "/_bulk",
+                                                                       nullptr /* params */,
+                                                                       &(conf->bulk_headers),
+                                                                       batch->body,
+                                                                       &batch->response));
+        batch->ret = retcode;
+        batch->done = true;
+        for (auto stack : batch->waiters) {
+          stack->set_sleeping(false);
+        }
+      } else {
+        while (!batch->done) {
+          yield set_sleeping(true);
+        }
+      }
+      retcode = batch->get_result(pos, &err);
+      if (retcode < 0) {
+        ldout(sync_env->cct, 5) << "elasticsearch: bulk entry failed: ret=" << retcode
+                                << " " << err << dendl;
+        return set_cr_error(retcode);
+      }
+      return set_cr_done();
+    }
+    return 0;
+  }
+};
+
 class RGWElasticHandleRemoteObjCBCR : public RGWStatRemoteObjCBCR {
   ElasticConfigRef conf;
+  ElasticBulkQueueRef bulk_queue;
   uint64_t versioned_epoch;
 public:
   RGWElasticHandleRemoteObjCBCR(RGWDataSyncEnv *_sync_env,
                           RGWBucketInfo& _bucket_info, rgw_obj_key& _key,
-                          ElasticConfigRef _conf, uint64_t _versioned_epoch) : RGWStatRemoteObjCBCR(_sync_env, _bucket_info, _key), conf(_conf),
-                                                                               versioned_epoch(_versioned_epoch) {}
+                          ElasticConfigRef _conf, ElasticBulkQueueRef _bulk_queue,
+                          uint64_t _versioned_epoch) : RGWStatRemoteObjCBCR(_sync_env, _bucket_info, _key), conf(_conf),
+                                                       bulk_queue(_bulk_queue),
+                                                       versioned_epoch(_versioned_epoch) {}
   int operate() override {
     reenter(this) {
       ldout(sync_env->cct, 10) << ": stat of remote obj: z=" << sync_env->source_zone
@@ -725,11 +940,18 @@ public:
         string path = conf->get_obj_path(bucket_info, key);
         es_obj_metadata doc(sync_env->cct, conf, bucket_info, key, mtime, size, attrs, versioned_epoch);
 
-        call(new RGWPutRESTResourceCR<es_obj_metadata, int>(sync_env->cct, conf->conn.get(),
-                                                            sync_env->http_manager,
-                                                            path, nullptr /* params */,
-                                                            &(conf->default_headers),
-                                                            doc, nullptr /* result */));
+        if (bulk_queue) {
+          bufferlist entry;
+          es_bulk_encode_action("index", conf->get_obj_id(bucket_info, key), &entry);
+          es_bulk_encode_doc(doc, &entry);
+          call(new RGWElasticBulkCR(sync_env, conf, bulk_queue, entry));
+        } else {
+          call(new RGWPutRESTResourceCR<es_obj_metadata, int>(sync_env->cct, conf->conn.get(),
+                                                              sync_env->http_manager,
+                                                              path, nullptr /* params */,
+                                                              &(conf->default_headers),
+                                                              doc, nullptr /* result */));
+        }
 
       }
       if (retcode < 0) {
@@ -743,18 +965,21 @@ public:
 
 class RGWElasticHandleRemoteObjCR : public RGWCallStatRemoteObjCR {
   ElasticConfigRef conf;
+  ElasticBulkQueueRef bulk_queue;
   uint64_t versioned_epoch;
 public:
   RGWElasticHandleRemoteObjCR(RGWDataSyncEnv *_sync_env,
                         RGWBucketInfo& _bucket_info, rgw_obj_key& _key,
-                        ElasticConfigRef _conf, uint64_t _versioned_epoch) : RGWCallStatRemoteObjCR(_sync_env, _bucket_info, _key),
-                                                           conf(_conf), versioned_epoch(_versioned_epoch) {
+                        ElasticConfigRef _conf, ElasticBulkQueueRef _bulk_queue,
+                        uint64_t _versioned_epoch) : RGWCallStatRemoteObjCR(_sync_env, _bucket_info, _key),
+                                                     conf(_conf), bulk_queue(_bulk_queue),
+                                                     versioned_epoch(_versioned_epoch) {
   }
 
   ~RGWElasticHandleRemoteObjCR() override {}
 
   RGWStatRemoteObjCBCR *allocate_callback() override {
-    return new RGWElasticHandleRemoteObjCBCR(sync_env, bucket_info, key, conf, versioned_epoch);
+    return new RGWElasticHandleRemoteObjCBCR(sync_env, bucket_info, key, conf, bulk_queue, versioned_epoch);
   }
 };
 
@@ -764,22 +989,29 @@ class RGWElasticRemoveRemoteObjCBCR : public RGWCoroutine {
   rgw_obj_key key;
   ceph::real_time mtime;
   ElasticConfigRef conf;
+  ElasticBulkQueueRef bulk_queue;
 public:
   RGWElasticRemoveRemoteObjCBCR(RGWDataSyncEnv *_sync_env,
                           RGWBucketInfo& _bucket_info, rgw_obj_key& _key, const ceph::real_time& _mtime,
-                          ElasticConfigRef _conf) : RGWCoroutine(_sync_env->cct), sync_env(_sync_env),
+                          ElasticConfigRef _conf, ElasticBulkQueueRef _bulk_queue) : RGWCoroutine(_sync_env->cct), sync_env(_sync_env),
                                                         bucket_info(_bucket_info), key(_key),
-                                                        mtime(_mtime), conf(_conf) {}
+                                                        mtime(_mtime), conf(_conf), bulk_queue(_bulk_queue) {}
   int operate() override {
     reenter(this) {
       ldout(sync_env->cct, 10) << ": remove remote obj: z=" << sync_env->source_zone
                                << " b=" << bucket_info.bucket << " k=" << key << " mtime=" << mtime << dendl;
       yield {
-        string path = conf->get_obj_path(bucket_info, key);
+        if (bulk_queue) {
+          bufferlist entry;
+          es_bulk_encode_action("delete", conf->get_obj_id(bucket_info, key), &entry);
+          call(new RGWElasticBulkCR(sync_env, conf, bulk_queue, entry));
+        } else {
+          string path = conf->get_obj_path(bucket_info, key);
 
-        call(new RGWDeleteRESTResourceCR(sync_env->cct, conf->conn.get(),
-                                         sync_env->http_manager,
-                                         path, nullptr /* params */));
+          call(new RGWDeleteRESTResourceCR(sync_env->cct, conf->conn.get(),
+                                           sync_env->http_manager,
+                                           path, nullptr /* params */));
+        }
       }
       if (retcode < 0) {
         return set_cr_error(retcode);
@@ -793,6 +1025,21 @@ public:
 
 class RGWElasticDataSyncModule : public RGWDataSyncModule {
   ElasticConfigRef conf;
+
+  ceph::mutex bulk_lock = ceph::make_mutex("RGWElasticDataSyncModule::bulk_lock");
+  map<RGWDataSyncEnv *, ElasticBulkQueueRef> bulk_queues;
+
+  ElasticBulkQueueRef get_bulk_queue(RGWDataSyncEnv *sync_env) {
+    if (!conf->use_bulk()) {
+      return nullptr;
+    }
+    std::lock_guard l{bulk_lock};
+    auto& queue = bulk_queues[sync_env];
+    if (!queue) {
+      queue = std::make_shared<ElasticBulkQueue>(conf->bulk_max_entries);
+    }
+    return queue;
+  }
 public:
   RGWElasticDataSyncModule(CephContext *cct, const JSONFormattable& config) : conf(std::make_shared<ElasticConfig>()) {
     conf->init(cct, config);
@@ -801,6 +1048,10 @@ public:
 
   void init(RGWDataSyncEnv *sync_env, uint64_t instance_id) override {
     conf->init_instance(sync_env->store->svc.zone->get_realm(), instance_id);
+
+    /* batches left open by a previous run of this sync env are gone */
+    std::lock_guard l{bulk_lock};
+    bulk_queues.erase(sync_env);
   }
 
   RGWCoroutine *init_sync(RGWDataSyncEnv *sync_env) override {
@@ -813,7 +1064,8 @@ public:
       ldout(sync_env->cct, 10) << conf->id << ": skipping operation (bucket not approved)" << dendl;
       return nullptr;
     }
-    return new RGWElasticHandleRemoteObjCR(sync_env, bucket_info, key, conf, versioned_epoch.value_or(0));
+    return new RGWElasticHandleRemoteObjCR(sync_env, bucket_info, key, conf, get_bulk_queue(sync_env),
+                                           versioned_epoch.value_or(0));
   }
   RGWCoroutine *remove_object(RGWDataSyncEnv *sync_env, RGWBucketInfo& bucket_info, rgw_obj_key& key, real_time& mtime, bool versioned, uint64_t versioned_epoch, rgw_zone_set *zones_trace) override {
     /* versioned and versioned epoch params are useless in the elasticsearch backend case */
@@ -822,7 +1074,7 @@ public:
       ldout(sync_env->cct, 10) << conf->id << ": skipping operation (bucket not approved)" << dendl;
       return nullptr;
     }
-    return new RGWElasticRemoveRemoteObjCBCR(sync_env, bucket_info, key, mtime, conf);
+    return new RGWElasticRemoveRemoteObjCBCR(sync_env, bucket_info, key, mtime, conf, get_bulk_queue(sync_env));
   }
   RGWCoroutine *create_delete_marker(RGWDataSyncEnv *sync_env, RGWBucketInfo& bucket_info, rgw_obj_key& key, real_time& mtime,
                                      rgw_bucket_entry_owner& owner, bool versioned, uint64_t versioned_epoch, rgw_zone_set *zones_trace) override {
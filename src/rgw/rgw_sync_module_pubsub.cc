@@ -26,6 +26,7 @@
 
 
 #define PUBSUB_EVENTS_RETENTION_DEFAULT 7
+#define PUBSUB_PUSH_BATCH_POLL_MS 10
 
 /*
 
@@ -476,10 +477,14 @@ static void make_s3_record_ref(CephContext *cct, const rgw_bucket& bucket,
 class PSManager;
 using PSManagerRef = std::shared_ptr<PSManager>;
 
+struct PSPushQueue;
+using PSPushQueueRef = std::shared_ptr<PSPushQueue>;
+
 struct PSEnv {
   PSConfigRef conf;
   shared_ptr<RGWUserInfo> data_user_info;
   PSManagerRef manager;
+  std::map<std::string, PSPushQueueRef> push_queues; // by endpoint
 
   PSEnv() : conf(make_shared<PSConfig>()),
             data_user_info(make_shared<RGWUserInfo>()) {}
@@ -605,6 +610,101 @@ public:
 };
 
 
+template<typename EventType>
+class PSPushBatchCR;
+
+/*
+ * the pushes to one endpoint. while a batch of events is being pushed, the
+ * events of the other subscriptions and buckets of the endpoint gather into
+ * the next batch, which is sent as a single message
+ */
+struct PSPushQueue {
+  bool in_flight{false};
+  PSPushBatchCR<rgw_pubsub_event> *event_batch{nullptr};
+  PSPushBatchCR<rgw_pubsub_s3_record> *record_batch{nullptr};
+
+  ~PSPushQueue();
+
+  template<typename EventType>
+  PSPushBatchCR<EventType>*& open_batch() {
+    if constexpr (std::is_same_v<EventType, rgw_pubsub_event>) {
+      return event_batch;
+    } else {
+      return record_batch;
+    }
+  }
+};
+
+template<typename EventType>
+class PSPushBatchCR : public RGWSingletonCR<bool> {
+  RGWDataSyncEnv* const sync_env;
+  const PSPushQueueRef queue;
+  const PSSubConfigRef sub_conf; // keeps the endpoint
+  std::vector<EventRef<EventType>> events;
+  bool closed{false};
+  int tries{0};
+
+public:
+  PSPushBatchCR(RGWDataSyncEnv* const _sync_env,
+                const PSPushQueueRef& _queue,
+                const PSSubConfigRef& _sub_conf) : RGWSingletonCR<bool>(_sync_env->cct),
+                                                   sync_env(_sync_env),
+                                                   queue(_queue),
+                                                   sub_conf(_sub_conf) {}
+
+  bool add(const EventRef<EventType>& event) {
+    if (closed || events.size() >= cct->_conf.get_val<uint64_t>("rgw_pubsub_push_batch_size")) {
+      return false;
+    }
+    events.push_back(event);
+    return true;
+  }
+
+  int operate() override {
+    reenter(this) {
+      if (cct->_conf.get_val<uint64_t>("rgw_pubsub_push_batch_size") > 1) {
+        while (queue->in_flight) {
+          // gather the events until the previous batch is acked
+          yield wait(utime_t(0, PUBSUB_PUSH_BATCH_POLL_MS * 1000000));
+        }
+      }
+      closed = true;
+      queue->in_flight = true;
+      for (tries = 0; ; ++tries) {
+        yield call(sub_conf->push_endpoint->send_to_completion_async(
+              json_format_pubsub_events(events), sync_env));
+        if (retcode >= 0 || tries >= (int)cct->_conf.get_val<uint64_t>("rgw_pubsub_push_max_retries")) {
+          break;
+        }
+        ldout(cct, 10) << "failed to push " << events.size() << " events to endpoint: "
+          << sub_conf->push_endpoint_name << " ret=" << retcode << ", retrying" << dendl;
+        yield {
+          // back off exponentially
+          utime_t backoff;
+          backoff.set_from_double(cct->_conf.get_val<double>("rgw_pubsub_push_retry_backoff") * (1 << tries));
+          wait(backoff);
+        }
+      }
+      queue->in_flight = false;
+      if (retcode < 0) {
+        return set_cr_error(retcode);
+      }
+      return set_cr_done();
+    }
+    return 0;
+  }
+};
+
+PSPushQueue::~PSPushQueue()
+{
+  if (event_batch) {
+    event_batch->put();
+  }
+  if (record_batch) {
+    record_batch->put();
+  }
+}
+
 class PSSubscription;
 using PSSubscriptionRef = std::shared_ptr<PSSubscription>;
 
@@ -825,23 +925,52 @@ class PSSubscription {
   template<typename EventType>
   class PushEventCR : public RGWCoroutine {
     RGWDataSyncEnv* const sync_env;
+    const PSEnvRef env;
     const EventRef<EventType> event;
-    const PSSubConfigRef& sub_conf;
+    const PSSubConfigRef sub_conf;
+    PSPushBatchCR<EventType> *batch{nullptr};
 
   public:
     PushEventCR(RGWDataSyncEnv* const _sync_env,
                  const PSSubscriptionRef& _sub,
                  const EventRef<EventType>& _event) : RGWCoroutine(_sync_env->cct),
                                      sync_env(_sync_env),
+                                     env(_sub->env),
                                      event(_event),
                                      sub_conf(_sub->sub_conf) {
     }
+    ~PushEventCR() override {
+      if (batch) {
+        batch->put();
+      }
+    }
 
     int operate() override {
       reenter(this) {
         ceph_assert(sub_conf->push_endpoint);
-        yield call(sub_conf->push_endpoint->send_to_completion_async(*event.get(), sync_env));
-      
+        yield {
+          // join the batch of the endpoint that is still gathering events, or
+          // start the next one
+          auto& queue = env->push_queues[sub_conf->topic + "@" +
+                                         sub_conf->push_endpoint_name + "?" +
+                                         sub_conf->push_endpoint_args];
+          if (!queue) {
+            queue = std::make_shared<PSPushQueue>();
+          }
+          auto& open = queue->open_batch<EventType>();
+          if (!open || !open->add(event)) {
+            if (open) {
+              open->put();
+            }
+            open = new PSPushBatchCR<EventType>(sync_env, queue, sub_conf);
+            open->get();
+            open->add(event);
+          }
+          batch = open;
+          batch->get();
+          batch->execute(this);
+        }
+
         if (retcode < 0) {
           ldout(sync_env->cct, 10) << "failed to push event: " << event->id <<
             " to endpoint: " << sub_conf->push_endpoint_name << " ret=" << retcode << dendl;
@@ -187,7 +187,7 @@ int rgw_store_user_info(RGWRados *store,
       RGWAccessKey& k = iter->second;
       if (old_info && old_info->access_keys.count(iter->first) != 0)
         continue;
-      int r = rgw_get_user_info_by_access_key(store, k.id, inf);
+      int r = rgw_get_user_info_by_access_key(store, k.id, inf, null_yield);
       if (r >= 0 && inf.user_id.compare(info.user_id) != 0) {
         ldout(store->ctx(), 0) << "WARNING: can't store user info, access key already mapped to another user" << dendl;
         return -EEXIST;
@@ -263,6 +263,7 @@ int rgw_get_user_info_from_index(RGWRados * const store,
                                  const string& key,
                                  const rgw_pool& pool,
                                  RGWUserInfo& info,
+                                 optional_yield y,
                                  RGWObjVersionTracker * const objv_tracker,
                                  real_time * const pmtime)
 {
@@ -280,7 +281,7 @@ int rgw_get_user_info_from_index(RGWRados * const store,
   RGWUID uid;
   auto obj_ctx = store->svc.sysobj->init_obj_ctx();
 
-  int ret = rgw_get_system_obj(store, obj_ctx, pool, key, bl, NULL, &e.mtime, null_yield);
+  int ret = rgw_get_system_obj(store, obj_ctx, pool, key, bl, NULL, &e.mtime, y);
   if (ret < 0)
     return ret;
 
@@ -289,7 +290,7 @@ int rgw_get_user_info_from_index(RGWRados * const store,
   auto iter = bl.cbegin();
   try {
     decode(uid, iter);
-    int ret = rgw_get_user_info_by_uid(store, uid.user_id, e.info, &e.objv_tracker, NULL, &cache_info);
+    int ret = rgw_get_user_info_by_uid(store, uid.user_id, e.info, y, &e.objv_tracker, NULL, &cache_info);
     if (ret < 0) {
       return ret;
     }
@@ -316,6 +317,7 @@ int rgw_get_user_info_from_index(RGWRados * const store,
 int rgw_get_user_info_by_uid(RGWRados *store,
                              const rgw_user& uid,
                              RGWUserInfo& info,
+                             optional_yield y,
                              RGWObjVersionTracker * const objv_tracker,
                              real_time * const pmtime,
                              rgw_cache_entry_info * const cache_info,
@@ -326,7 +328,7 @@ int rgw_get_user_info_by_uid(RGWRados *store,
 
   auto obj_ctx = store->svc.sysobj->init_obj_ctx();
   string oid = uid.to_str();
-  int ret = rgw_get_system_obj(store, obj_ctx, store->svc.zone->get_zone_params().user_uid_pool, oid, bl, objv_tracker, pmtime, null_yield, pattrs, cache_info);
+  int ret = rgw_get_system_obj(store, obj_ctx, store->svc.zone->get_zone_params().user_uid_pool, oid, bl, objv_tracker, pmtime, y, pattrs, cache_info);
   if (ret < 0) {
     return ret;
   }
@@ -356,7 +358,7 @@ int rgw_get_user_info_by_uid(RGWRados *store,
 int rgw_get_user_info_by_email(RGWRados *store, string& email, RGWUserInfo& info,
                                RGWObjVersionTracker *objv_tracker, real_time *pmtime)
 {
-  return rgw_get_user_info_from_index(store, email, store->svc.zone->get_zone_params().user_email_pool, info, objv_tracker, pmtime);
+  return rgw_get_user_info_from_index(store, email, store->svc.zone->get_zone_params().user_email_pool, info, null_yield, objv_tracker, pmtime);
 }
 
 /**
@@ -371,7 +373,7 @@ extern int rgw_get_user_info_by_swift(RGWRados * const store,
 {
   return rgw_get_user_info_from_index(store, swift_name,
                                       store->svc.zone->get_zone_params().user_swift_pool,
-                                      info, objv_tracker, pmtime);
+                                      info, null_yield, objv_tracker, pmtime);
 }
 
 /**
@@ -381,17 +383,19 @@ extern int rgw_get_user_info_by_swift(RGWRados * const store,
 extern int rgw_get_user_info_by_access_key(RGWRados* store,
                                            const std::string& access_key,
                                            RGWUserInfo& info,
+                                           optional_yield y,
                                            RGWObjVersionTracker* objv_tracker,
                                            real_time *pmtime)
 {
   return rgw_get_user_info_from_index(store, access_key,
                                       store->svc.zone->get_zone_params().user_keys_pool,
-                                      info, objv_tracker, pmtime);
+                                      info, y, objv_tracker, pmtime);
 }
 
 int rgw_get_user_attrs_by_uid(RGWRados *store,
                               const rgw_user& user_id,
                               map<string, bufferlist>& attrs,
+                              optional_yield y,
                               RGWObjVersionTracker *objv_tracker)
 {
   auto obj_ctx = store->svc.sysobj->init_obj_ctx();
@@ -401,7 +405,7 @@ int rgw_get_user_attrs_by_uid(RGWRados *store,
   return src.rop()
             .set_attrs(&attrs)
             .set_objv_tracker(objv_tracker)
-            .stat(null_yield);
+            .stat(y);
 }
 
 int rgw_remove_key_index(RGWRados *store, RGWAccessKey& access_key)
@@ -416,7 +420,7 @@ int rgw_remove_uid_index(RGWRados *store, rgw_user& uid)
 {
   RGWObjVersionTracker objv_tracker;
   RGWUserInfo info;
-  int ret = rgw_get_user_info_by_uid(store, uid, info, &objv_tracker, NULL);
+  int ret = rgw_get_user_info_by_uid(store, uid, info, null_yield, &objv_tracker, NULL);
   if (ret < 0)
     return ret;
 
@@ -968,7 +972,7 @@ int RGWAccessKeyPool::generate_key(RGWUserAdminOpState& op_state, std::string *e
       }
       break;
     case KEY_TYPE_S3:
-      if (rgw_get_user_info_by_access_key(store, id, duplicate_check) >= 0) {
+      if (rgw_get_user_info_by_access_key(store, id, duplicate_check, null_yield) >= 0) {
         set_err_msg(err_msg, "existing S3 key in RGW system:" + id);
         return -ERR_KEY_EXIST;
       }
@@ -1008,7 +1012,7 @@ int RGWAccessKeyPool::generate_key(RGWUserAdminOpState& op_state, std::string *e
       if (!validate_access_key(id))
         continue;
 
-    } while (!rgw_get_user_info_by_access_key(store, id, duplicate_check));
+    } while (!rgw_get_user_info_by_access_key(store, id, duplicate_check, null_yield));
   }
 
   if (key_type == KEY_TYPE_SWIFT) {
@@ -1801,7 +1805,7 @@ int RGWUser::init(RGWUserAdminOpState& op_state)
   }
 
   if (!user_id.empty() && (user_id.compare(RGW_USER_ANON_ID) != 0)) {
-    found = (rgw_get_user_info_by_uid(store, user_id, user_info, &op_state.objv) >= 0);
+    found = (rgw_get_user_info_by_uid(store, user_id, user_info, null_yield, &op_state.objv) >= 0);
     op_state.found_by_uid = found;
   }
   if (!user_email.empty() && !found) {
@@ -1813,7 +1817,7 @@ int RGWUser::init(RGWUserAdminOpState& op_state)
     op_state.found_by_key = found;
   }
   if (!access_key.empty() && !found) {
-    found = (rgw_get_user_info_by_access_key(store, access_key, user_info, &op_state.objv) >= 0);
+    found = (rgw_get_user_info_by_access_key(store, access_key, user_info, null_yield, &op_state.objv) >= 0);
     op_state.found_by_key = found;
   }
   
@@ -2453,7 +2457,7 @@ int RGWUserAdminOp_User::info(RGWRados *store, RGWUserAdminOpState& op_state,
   RGWStorageStats stats;
   RGWStorageStats *arg_stats = NULL;
   if (op_state.fetch_stats) {
-    int ret = store->get_user_stats(info.user_id, stats);
+    int ret = store->get_user_stats(info.user_id, stats, null_yield);
     if (ret < 0 && ret != -ENOENT) {
       return ret;
     }
@@ -2804,7 +2808,7 @@ public:
 
     rgw_user uid(entry);
 
-    int ret = rgw_get_user_info_by_uid(store, uid, uci.info, &objv_tracker,
+    int ret = rgw_get_user_info_by_uid(store, uid, uci.info, null_yield, &objv_tracker,
                                        &mtime, NULL, &uci.attrs);
     if (ret < 0) {
       return ret;
@@ -2835,7 +2839,7 @@ public:
 
     RGWUserInfo old_info;
     real_time orig_mtime;
-    int ret = rgw_get_user_info_by_uid(store, uid, old_info, &objv_tracker, &orig_mtime);
+    int ret = rgw_get_user_info_by_uid(store, uid, old_info, null_yield, &objv_tracker, &orig_mtime);
     if (ret < 0 && ret != -ENOENT)
       return ret;
 
@@ -2864,7 +2868,7 @@ public:
 
     rgw_user uid(entry);
 
-    int ret = rgw_get_user_info_by_uid(store, uid, info, &objv_tracker);
+    int ret = rgw_get_user_info_by_uid(store, uid, info, null_yield, &objv_tracker);
     if (ret < 0)
       return ret;
 
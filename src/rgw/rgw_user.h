@@ -76,6 +76,7 @@ extern int rgw_store_user_info(RGWRados *store,
 extern int rgw_get_user_info_by_uid(RGWRados *store,
                                     const rgw_user& user_id,
                                     RGWUserInfo& info,
+                                    optional_yield y,
                                     RGWObjVersionTracker *objv_tracker = NULL,
                                     real_time *pmtime                     = NULL,
                                     rgw_cache_entry_info *cache_info   = NULL,
@@ -102,6 +103,7 @@ extern int rgw_get_user_info_by_swift(RGWRados *store,
 extern int rgw_get_user_info_by_access_key(RGWRados* store,
                                            const std::string& access_key,
                                            RGWUserInfo& info,
+                                           optional_yield y,
                                            RGWObjVersionTracker* objv_tracker = nullptr,
                                            real_time* pmtime = nullptr);
 /**
@@ -112,6 +114,7 @@ extern int rgw_get_user_info_by_access_key(RGWRados* store,
 extern int rgw_get_user_attrs_by_uid(RGWRados *store,
                                      const rgw_user& user_id,
                                      map<string, bufferlist>& attrs,
+                                     optional_yield y,
                                      RGWObjVersionTracker *objv_tracker = NULL);
 /**
  * Given an RGWUserInfo, deletes the user and its bucket ACLs.
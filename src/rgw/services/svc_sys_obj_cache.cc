@@ -5,6 +5,8 @@
 #include "svc_zone.h"
 #include "svc_notify.h"
 
+#include "common/Thread.h"
+
 #include "rgw/rgw_zone.h"
 #include "rgw/rgw_tools.h"
 
@@ -45,9 +47,34 @@ int RGWSI_SysObj_Cache::do_start()
 
   notify_svc->register_watch_cb(cb.get());
 
+  if (cache.has_lease()) {
+    invalidate_thread = make_named_thread("rgw_cache_inval",
+                                          &RGWSI_SysObj_Cache::invalidate_entry,
+                                          this);
+  }
+
   return 0;
 }
 
+void RGWSI_SysObj_Cache::shutdown()
+{
+  if (!invalidate_thread.joinable()) {
+    return;
+  }
+
+  {
+    std::lock_guard l{invalidate_lock};
+    invalidate_stop = true;
+  }
+  invalidate_cond.notify_all();
+  invalidate_thread.join();
+}
+
+RGWSI_SysObj_Cache::~RGWSI_SysObj_Cache()
+{
+  shutdown();
+}
+
 static string normal_name(rgw_pool& pool, const std::string& oid) {
   std::string buf;
   buf.reserve(pool.name.size() + pool.ns.size() + oid.size() + 2);
@@ -119,7 +146,11 @@ int RGWSI_SysObj_Cache::read(RGWSysObjectCtxBase& obj_ctx,
   if (attrs)
     flags |= CACHE_FLAG_XATTRS;
 
-  if ((cache.get(name, info, flags, cache_info) == 0) &&
+  int r = cache.get(name, info, flags, cache_info);
+  if (r == -ESTALE && revalidate(obj, name, info, y)) {
+    r = 0;
+  }
+  if ((r == 0) &&
       (!refresh_version || !info.version.compare(&(*refresh_version)))) {
     if (info.status < 0)
       return info.status;
@@ -144,7 +175,7 @@ int RGWSI_SysObj_Cache::read(RGWSysObjectCtxBase& obj_ctx,
   }
 
   map<string, bufferlist> unfiltered_attrset;
-  int r = RGWSI_SysObj_Core::read(obj_ctx, read_state, objv_tracker,
+  r = RGWSI_SysObj_Core::read(obj_ctx, read_state, objv_tracker,
                          obj, obl, ofs, end,
 			 (attrs ? &unfiltered_attrset : nullptr),
 			 true, /* cache unfiltered attrs */
@@ -171,6 +202,7 @@ int RGWSI_SysObj_Cache::read(RGWSysObjectCtxBase& obj_ctx,
 
   info.status = 0;
   info.flags = flags;
+  info.epoch = read_state.last_ver;
   if (objv_tracker) {
     info.version = objv_tracker->read_version;
   }
@@ -201,7 +233,11 @@ int RGWSI_SysObj_Cache::get_attr(const rgw_raw_obj& obj,
 
   uint32_t flags = CACHE_FLAG_XATTRS;
 
-  if (cache.get(name, info, flags, nullptr) == 0) {
+  int r = cache.get(name, info, flags, nullptr);
+  if (r == -ESTALE && revalidate(obj, name, info, y)) {
+    r = 0;
+  }
+  if (r == 0) {
     if (info.status < 0)
       return info.status;
 
@@ -357,6 +393,9 @@ int RGWSI_SysObj_Cache::raw_stat(const rgw_raw_obj& obj, uint64_t *psize, real_t
   if (objv_tracker)
     flags |= CACHE_FLAG_OBJV;
   int r = cache.get(name, info, flags, NULL);
+  if (r == -ESTALE && revalidate(obj, name, info, y)) {
+    r = 0;
+  }
   if (r == 0) {
     if (info.status < 0)
       return info.status;
@@ -404,6 +443,13 @@ int RGWSI_SysObj_Cache::distribute_cache(const string& normal_name,
                                          ObjectCacheInfo& obj_info, int op,
                                          optional_yield y)
 {
+  if (cache.has_lease()) {
+    // the other gateways only have to learn about the change eventually,
+    // their copies are revalidated when the lease ends
+    queue_invalidate(obj);
+    return 0;
+  }
+
   RGWCacheNotifyInfo info;
   info.op = op;
   info.obj_info = obj_info;
@@ -413,6 +459,119 @@ int RGWSI_SysObj_Cache::distribute_cache(const string& normal_name,
   return notify_svc->distribute(normal_name, bl, y);
 }
 
+void RGWSI_SysObj_Cache::queue_invalidate(const rgw_raw_obj& obj)
+{
+  bool wake;
+  {
+    std::lock_guard l{invalidate_lock};
+    pending_invalidations.insert(obj);
+    wake = (pending_invalidations.size() >= max_invalidate_batch);
+  }
+  if (wake) {
+    invalidate_cond.notify_one();
+  }
+}
+
+void RGWSI_SysObj_Cache::invalidate_entry()
+{
+  auto interval = std::chrono::milliseconds(
+    cct->_conf.get_val<uint64_t>("rgw_cache_invalidate_batch_interval"));
+
+  std::unique_lock l{invalidate_lock};
+  while (true) {
+    invalidate_cond.wait_for(l, interval, [this] {
+        return invalidate_stop ||
+          pending_invalidations.size() >= max_invalidate_batch;
+      });
+    if (pending_invalidations.empty()) {
+      if (invalidate_stop) {
+        break;
+      }
+      continue;
+    }
+
+    std::set<rgw_raw_obj> objs;
+    objs.swap(pending_invalidations);
+    l.unlock();
+    int r = distribute_invalidations(objs);
+    if (r < 0) {
+      ldout(cct, 0) << "ERROR: failed to distribute " << objs.size()
+                    << " cache invalidations: r=" << r << dendl;
+    }
+    l.lock();
+  }
+}
+
+int RGWSI_SysObj_Cache::distribute_invalidations(const std::set<rgw_raw_obj>& objs)
+{
+  ldout(cct, 10) << "distributing " << objs.size() << " invalidations" << dendl;
+
+  RGWCacheNotifyInfo info;
+  bufferlist bl;
+  if (!cct->_conf.get_val<bool>("rgw_cache_invalidate_batch")) {
+    // gateways before INVALIDATE_OBJS only know one object per notify
+    int ret = 0;
+    info.op = REMOVE_OBJ;
+    for (const auto& obj : objs) {
+      info.obj = obj;
+      bl.clear();
+      encode(info, bl);
+      rgw_pool pool = obj.pool;
+      int r = notify_svc->distribute(normal_name(pool, obj.oid), bl,
+                                     null_yield);
+      if (r < 0) {
+        ret = r;
+      }
+    }
+    return ret;
+  }
+
+  info.op = INVALIDATE_OBJS;
+  info.objs.assign(objs.begin(), objs.end());
+  encode(info, bl);
+  // any control object will do, every gateway watches all of them
+  rgw_pool pool = objs.begin()->pool;
+  return notify_svc->distribute(normal_name(pool, objs.begin()->oid), bl,
+                                null_yield);
+}
+
+bool RGWSI_SysObj_Cache::revalidate(const rgw_raw_obj& obj, const string& name,
+                                    const ObjectCacheInfo& info,
+                                    optional_yield y)
+{
+  // entries the local writes left without an epoch are simply re-read
+  if (info.status < 0 || info.epoch == 0) {
+    return false;
+  }
+
+  RGWSI_RADOS::Obj rados_obj;
+  int r = get_rados_obj(zone_svc, obj, &rados_obj);
+  if (r < 0) {
+    return false;
+  }
+
+  librados::ObjectReadOperation op;
+  op.stat2(nullptr, nullptr, nullptr);
+  r = rados_obj.operate(&op, nullptr, y);
+  if (r < 0 || rados_obj.get_last_version() != info.epoch) {
+    ldout(cct, 10) << "cache entry " << name << " changed (r=" << r
+                   << "), re-reading it" << dendl;
+    return false;
+  }
+
+  return cache.renew(name, info.epoch);
+}
+
+int RGWSI_SysObj_Cache::distribute_stats(bufferlist& stats, optional_yield y)
+{
+  RGWCacheNotifyInfo info;
+  info.op = UPDATE_STATS;
+  info.stats.claim(stats);
+  bufferlist bl;
+  encode(info, bl);
+  return notify_svc->distribute("quota_stats", bl, y);
+}
+
 int RGWSI_SysObj_Cache::watch_cb(uint64_t notify_id,
                                  uint64_t cookie,
                                  uint64_t notifier_id,
@@ -443,6 +602,20 @@ int RGWSI_SysObj_Cache::watch_cb(uint64_t notify_id,
   case REMOVE_OBJ:
     cache.remove(name);
     break;
+  case INVALIDATE_OBJS:
+    for (const auto& obj : info.objs) {
+      normalize_pool_and_obj(obj.pool, obj.oid, pool, oid);
+      cache.remove(normal_name(pool, oid));
+    }
+    break;
+  case REMOVE_DATA:
+    // no longer sent, the data cache never needs invalidating
+    break;
+  case UPDATE_STATS:
+    if (auto scb = stats_cb.load(); scb) {
+      scb->handle_stats(info.stats);
+    }
+    break;
   default:
     ldout(cct, 0) << "WARNING: got unknown notification op: " << info.op << dendl;
     return -EINVAL;
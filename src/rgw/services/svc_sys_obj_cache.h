@@ -8,10 +8,22 @@
 
 #include "svc_sys_obj_core.h"
 
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+
 class RGWSI_Notify;
 
 class RGWSI_SysObj_Cache_CB;
 
+/// receives the UPDATE_STATS notifications of the other gateways
+class RGWSI_SysObj_Cache_StatsCB {
+public:
+  virtual ~RGWSI_SysObj_Cache_StatsCB() {}
+  virtual void handle_stats(bufferlist& bl) = 0;
+};
+
 class RGWSI_SysObj_Cache : public RGWSI_SysObj_Core
 {
   friend class RGWSI_SysObj_Cache_CB;
@@ -22,6 +34,28 @@ class RGWSI_SysObj_Cache : public RGWSI_SysObj_Core
 
   std::shared_ptr<RGWSI_SysObj_Cache_CB> cb;
 
+  std::atomic<RGWSI_SysObj_Cache_StatsCB*> stats_cb{nullptr};
+
+  /*
+   * With rgw_cache_lease_interval set, writes do not push each update to
+   * all the gateways: the entries of the other gateways are revalidated
+   * against the object epoch when their lease ends, and the writes are
+   * announced as batched invalidations from invalidate_thread.
+   */
+  static constexpr size_t max_invalidate_batch = 1000;
+  std::mutex invalidate_lock;
+  std::condition_variable invalidate_cond;
+  std::set<rgw_raw_obj> pending_invalidations;
+  bool invalidate_stop = false;
+  std::thread invalidate_thread;
+
+  void queue_invalidate(const rgw_raw_obj& obj);
+  void invalidate_entry();
+  int distribute_invalidations(const std::set<rgw_raw_obj>& objs);
+
+  bool revalidate(const rgw_raw_obj& obj, const string& name,
+                  const ObjectCacheInfo& info, optional_yield y);
+
   void normalize_pool_and_obj(const rgw_pool& src_pool, const string& src_obj, rgw_pool& dst_pool, string& dst_obj);
 protected:
   void init(RGWSI_RADOS *_rados_svc,
@@ -32,6 +66,7 @@ protected:
   }
 
   int do_start() override;
+  void shutdown() override;
 
   int raw_stat(const rgw_raw_obj& obj, uint64_t *psize, real_time *pmtime, uint64_t *epoch,
                map<string, bufferlist> *attrs, bufferlist *first_chunk,
@@ -93,12 +128,19 @@ public:
   RGWSI_SysObj_Cache(CephContext *cct) : RGWSI_SysObj_Core(cct) {
     cache.set_ctx(cct);
   }
+  ~RGWSI_SysObj_Cache();
 
   bool chain_cache_entry(std::initializer_list<rgw_cache_entry_info *> cache_info_entries,
                          RGWChainedCache::Entry *chained_entry);
   void register_chained_cache(RGWChainedCache *cc);
   void unregister_chained_cache(RGWChainedCache *cc);
 
+  /// the handler of the UPDATE_STATS notifications
+  void set_stats_cb(RGWSI_SysObj_Cache_StatsCB *cb) {
+    stats_cb = cb;
+  }
+  int distribute_stats(bufferlist& stats, optional_yield y);
+
   void call_list(const std::optional<std::string>& filter, Formatter* f);
   int call_inspect(const std::string& target, Formatter* f);
   int call_erase(const std::string& target);
@@ -1268,6 +1268,50 @@ TEST(BufferList, BenchAlloc) {
   bench_bufferlist_alloc(4, 100000, 16);
 }
 
+TEST(BufferList, ptr_node_recycling) {
+  // a message's worth of segments, all sharing one raw buffer; they are
+  // spaced apart so append() cannot merge them
+  bufferptr bp(buffer::create(4096));
+  constexpr unsigned segments = 16;
+  std::set<const void*> nodes;
+  {
+    bufferlist bl;
+    for (unsigned i = 0; i < segments; ++i) {
+      bl.append(bp, i * 16, 8);
+    }
+    for (const auto& node : bl.buffers()) {
+      nodes.insert(&node);
+    }
+  }
+  ASSERT_EQ(segments, nodes.size());
+  // the nodes freed above are handed out again instead of fresh ones
+  for (int round = 0; round < 100; ++round) {
+    bufferlist bl;
+    for (unsigned i = 0; i < segments; ++i) {
+      bl.append(bp, i * 16, 8);
+    }
+    for (const auto& node : bl.buffers()) {
+      ASSERT_EQ(1u, nodes.count(&node));
+    }
+  }
+}
+
+TEST(BufferList, BenchSegments) {
+  bufferptr bp(buffer::create(4096));
+  for (unsigned per = 1; per <= 64; per *= 4) {
+    constexpr int rounds = 1000000;
+    const utime_t start = ceph_clock_now();
+    for (int r = 0; r < rounds; ++r) {
+      bufferlist bl;
+      for (unsigned j = 0; j < per; ++j) {
+	bl.append(bp, j * 16, 8);
+      }
+    }
+    cout << rounds << " lists of " << per << " shared segments in "
+	 << (ceph_clock_now() - start) << std::endl;
+  }
+}
+
 TEST(BufferList, append_bench_with_size_hint) {
   std::array<char, 1048576> src = { 0, };
 
@@ -1725,6 +1769,53 @@ TEST(BufferList, rebuild) {
   }
 }
 
+TEST(BufferList, rebuild_large) {
+  // big enough for the streaming copy of a device rebuild, with
+  // misaligned segments
+  bufferlist bl;
+  std::string expected;
+  for (unsigned i = 0; expected.size() < (1u << 20); ++i) {
+    std::string seg(CEPH_PAGE_SIZE + 7 + i % 13, 'a' + i % 26);
+    bl.append(seg.c_str(), seg.size());
+    expected += seg;
+  }
+  bufferlist copy(bl);
+  copy.rebuild();
+  EXPECT_EQ(1U, copy.get_num_buffers());
+  EXPECT_EQ(0, memcmp(expected.c_str(), copy.c_str(), expected.size()));
+
+  EXPECT_TRUE(bl.rebuild_aligned_for_device(CEPH_PAGE_SIZE, CEPH_PAGE_SIZE));
+  EXPECT_EQ(1U, bl.get_num_buffers());
+  EXPECT_TRUE(bl.is_page_aligned());
+  EXPECT_EQ(expected.size(), bl.length());
+  EXPECT_EQ(0, memcmp(expected.c_str(), bl.c_str(), expected.size()));
+}
+
+TEST(BufferRaw, page_pool) {
+  // empty this thread's pool of what earlier tests left there
+  std::vector<bufferptr> held;
+  for (unsigned pages = 1; pages <= 16; ++pages) {
+    for (unsigned i = 0; i < 4; ++i) {
+      held.emplace_back(buffer::create_page_aligned(pages * CEPH_PAGE_SIZE));
+    }
+  }
+  // a freed aligned buffer of a few pages is handed out again
+  const char *data;
+  size_t bytes;
+  {
+    bufferptr p(buffer::create_aligned(3 * CEPH_PAGE_SIZE - 100, 512));
+    EXPECT_TRUE(p.is_page_aligned());
+    data = p.c_str();
+    bytes = mempool::buffer_anon::allocated_bytes();
+  }
+  // the whole block stays accounted for while it is cached
+  EXPECT_EQ(bytes + 100, mempool::buffer_anon::allocated_bytes());
+  bufferptr p(buffer::create_page_aligned(3 * CEPH_PAGE_SIZE));
+  EXPECT_EQ(data, p.c_str());
+  EXPECT_EQ(3 * CEPH_PAGE_SIZE, p.length());
+  EXPECT_EQ(bytes + 100, mempool::buffer_anon::allocated_bytes());
+}
+
 TEST(BufferList, rebuild_page_aligned) {
   {
     bufferlist bl;
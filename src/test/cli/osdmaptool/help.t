@@ -12,6 +12,9 @@
      --test-map-pgs [--pool <poolid>] [--pg_num <pg_num>] [--range-first <first> --range-last <last>] map all pgs
      --test-map-pgs-dump [--pool <poolid>] [--range-first <first> --range-last <last>] map all pgs
      --test-map-pgs-dump-all [--pool <poolid>] [--range-first <first> --range-last <last>] map all pgs to osds
+     --test-map-pgs-diff <mapfilename> [--pool <poolid>] [--threads <n>]
+                             map all pgs with both maps and report pg movement
+     --threads <n>           map pgs with <n> threads [default: 0, no threads]
      --mark-up-in            mark osds up and in (but do not persist)
      --mark-out <osdid>      mark an osd as out (but do not persist)
      --with-default-pool     include default pool when creating map
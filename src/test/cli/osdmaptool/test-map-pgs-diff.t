@@ -0,0 +1,26 @@
+  $ osdmaptool --createsimple 16 myosdmap --with-default-pool
+  osdmaptool: osdmap file 'myosdmap'
+  osdmaptool: writing epoch 1 to myosdmap
+
+#
+# a map against itself moves nothing, with or without threads
+#
+  $ osdmaptool myosdmap --test-map-pgs-diff myosdmap | grep remapped
+  osdmaptool: osdmap file 'myosdmap'
+   remapped 0 pgs, moved 0 pg shards
+  $ osdmaptool myosdmap --test-map-pgs-diff myosdmap --threads 4 | grep remapped
+  osdmaptool: osdmap file 'myosdmap'
+   remapped 0 pgs, moved 0 pg shards
+
+#
+# --test-map-pgs-diff / --pool
+#
+  $ osdmaptool myosdmap --test-map-pgs-diff myosdmap --pool 123
+  osdmaptool: osdmap file 'myosdmap'
+  There is no pool 123
+  [1]
+
+  $ osdmaptool myosdmap --test-map-pgs-diff nonexistent
+  osdmaptool: osdmap file 'myosdmap'
+  osdmaptool: couldn't open nonexistent: can't open nonexistent: (2) No such file or directory
+  [1]
@@ -49,6 +49,9 @@
     period list                list all periods
     period update              update the staging period
     period commit              commit the staging period
+    qos set                    set the QoS of a bucket or user
+    qos get                    get the QoS of a bucket or user
+    qos rm                     remove the QoS of a bucket or user
     quota set                  set quota params
     quota enable               enable quota
     quota disable              disable quota
@@ -279,6 +282,11 @@
      --max-size                specify max size (in B/K/M/G/T, negative value to disable)
      --quota-scope             scope of quota (bucket, user)
   
+  QoS options:
+     --qos-reservation         requests/s guaranteed to the bucket or user (0 for none)
+     --qos-weight              share of the requests beyond the reservations
+     --qos-limit               max requests/s of the bucket or user (0 for unlimited)
+  
   Orphans search options:
      --num-shards              num of shards to use for keeping the temporary scan info
      --orphan-stale-secs       num of seconds to wait before declaring an object to be an orphan (default: 86400)
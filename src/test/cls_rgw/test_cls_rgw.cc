@@ -551,6 +551,77 @@ TEST(cls_rgw, bi_list)
   ASSERT_EQ(is_truncated, false);
 }
 
+TEST(cls_rgw, reshard_log)
+{
+  string bucket_oid = str_int("bucket", 6);
+
+  OpMgr mgr;
+
+  ObjectWriteOperation *op = mgr.write_op();
+  cls_rgw_bucket_init_index(*op);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, op));
+
+  uint64_t epoch = 1;
+  rgw_bucket_dir_entry_meta meta;
+  meta.category = RGWObjCategory::None;
+  meta.size = 1024;
+
+  auto write_obj = [&] (int i) {
+    string obj = str_int("obj", i);
+    string tag = str_int("tag", i);
+    string loc = str_int("loc", i);
+    index_prepare(mgr, ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, obj, loc);
+    index_complete(mgr, ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, epoch, obj, meta);
+  };
+
+  // nothing is logged outside of a reshard
+  write_obj(0);
+  list<string> names;
+  bool is_truncated;
+  ASSERT_EQ(0, cls_rgw_reshard_log_list(ioctx, bucket_oid, string(), 10,
+					&names, &is_truncated));
+  ASSERT_TRUE(names.empty());
+
+  cls_rgw_bucket_instance_entry entry;
+  entry.set_status("new_instance", 4, CLS_RGW_RESHARD_LOGGING);
+  ASSERT_EQ(0, cls_rgw_set_bucket_resharding(ioctx, bucket_oid, entry));
+
+  // writes go through while logging
+  ObjectWriteOperation guarded;
+  cls_rgw_guard_bucket_resharding(guarded, -EBUSY);
+  guarded.create(false);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &guarded));
+  write_obj(1);
+  write_obj(2);
+  write_obj(1);
+
+  ASSERT_EQ(0, cls_rgw_reshard_log_list(ioctx, bucket_oid, string(), 10,
+					&names, &is_truncated));
+  ASSERT_EQ(2u, names.size());
+  ASSERT_EQ(str_int("obj", 1), names.front());
+  ASSERT_EQ(str_int("obj", 2), names.back());
+  ASSERT_FALSE(is_truncated);
+
+  // the log does not show up in listings
+  list<rgw_cls_bi_entry> entries;
+  ASSERT_EQ(0, cls_rgw_bi_list(ioctx, bucket_oid, string(), string(), 10,
+			       &entries, &is_truncated));
+  ASSERT_EQ(3u, entries.size());
+
+  ASSERT_EQ(0, cls_rgw_reshard_log_list(ioctx, bucket_oid, names.front(), 10,
+					&names, &is_truncated));
+  ASSERT_EQ(1u, names.size());
+
+  op = mgr.write_op();
+  cls_rgw_reshard_log_trim(*op, {str_int("obj", 1), str_int("obj", 2)});
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, op));
+  ASSERT_EQ(0, cls_rgw_reshard_log_list(ioctx, bucket_oid, string(), 10,
+					&names, &is_truncated));
+  ASSERT_TRUE(names.empty());
+
+  ASSERT_EQ(0, cls_rgw_clear_bucket_resharding(ioctx, bucket_oid));
+}
+
 /* test garbage collection */
 static void create_obj(cls_rgw_obj& obj, int i, int j)
 {
@@ -805,6 +876,121 @@ TEST(cls_rgw, gc_defer)
   ASSERT_EQ(0, destroy_one_pool_pp(gc_pool_name, rados));
 }
 
+TEST(cls_rgw, gc_queue)
+{
+  string oid = "gc_queue";
+  const uint64_t queue_size = 4096;
+
+  /* the queue has to be initialized first */
+  list<cls_rgw_gc_obj_info> entries;
+  bool truncated;
+  string marker;
+  string next_marker;
+  ASSERT_EQ(-ENOENT, cls_rgw_gc_queue_list(ioctx, oid, marker, 8, true, entries, &truncated, next_marker));
+
+  librados::ObjectWriteOperation init_op;
+  cls_rgw_gc_queue_init(init_op, queue_size);
+  ASSERT_EQ(0, ioctx.operate(oid, &init_op));
+  /* again, as every gateway does on startup */
+  librados::ObjectWriteOperation init_op2;
+  cls_rgw_gc_queue_init(init_op2, queue_size);
+  ASSERT_EQ(0, ioctx.operate(oid, &init_op2));
+
+  auto enqueue = [&] (int i) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "chain-%d", i);
+    cls_rgw_gc_obj_info info;
+    cls_rgw_obj obj1, obj2;
+    create_obj(obj1, i, 1);
+    create_obj(obj2, i, 2);
+    info.chain.objs.push_back(obj1);
+    info.chain.objs.push_back(obj2);
+    info.tag = buf;
+    librados::ObjectWriteOperation op;
+    cls_rgw_gc_queue_enqueue(op, 0, info);
+    return ioctx.operate(oid, &op);
+  };
+
+  for (int i = 0; i < 10; i++) {
+    ASSERT_EQ(0, enqueue(i));
+  }
+
+  /* list chains, verify truncated */
+  ASSERT_EQ(0, cls_rgw_gc_queue_list(ioctx, oid, marker, 8, true, entries, &truncated, next_marker));
+  ASSERT_EQ(8, (int)entries.size());
+  ASSERT_EQ(1, truncated);
+
+  marker = next_marker;
+  list<cls_rgw_gc_obj_info> entries2;
+  ASSERT_EQ(0, cls_rgw_gc_queue_list(ioctx, oid, marker, 8, true, entries2, &truncated, next_marker));
+  ASSERT_EQ(2, (int)entries2.size());
+  ASSERT_EQ(0, truncated);
+  entries.splice(entries.end(), entries2);
+
+  /* verify the chains come out in the order they were queued */
+  auto iter = entries.begin();
+  for (int i = 0; i < 10; i++, ++iter) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "chain-%d", i);
+    ASSERT_EQ(string(buf), iter->tag);
+    ASSERT_EQ(2, (int)iter->chain.objs.size());
+    cls_rgw_obj obj1;
+    create_obj(obj1, i, 1);
+    ASSERT_EQ(1, (int)cmp_objs(obj1, iter->chain.objs.front()));
+  }
+
+  /* remove the whole batch at once */
+  librados::ObjectWriteOperation remove_op;
+  cls_rgw_gc_queue_remove(remove_op, next_marker);
+  ASSERT_EQ(0, ioctx.operate(oid, &remove_op));
+
+  marker.clear();
+  entries.clear();
+  ASSERT_EQ(0, cls_rgw_gc_queue_list(ioctx, oid, marker, 8, true, entries, &truncated, next_marker));
+  ASSERT_EQ(0, (int)entries.size());
+  ASSERT_EQ(0, truncated);
+
+  /* overfill the queue, wrapping around the end of the object; the chains
+   * that do not fit go to the omap index */
+  const int count = 40;
+  for (int i = 0; i < count; i++) {
+    ASSERT_EQ(0, enqueue(i));
+  }
+  ASSERT_EQ(0, cls_rgw_gc_queue_list(ioctx, oid, marker, 100, true, entries, &truncated, next_marker));
+  ASSERT_EQ(0, truncated);
+  ASSERT_LT(0, (int)entries.size());
+  ASSERT_GT(count, (int)entries.size());
+  iter = entries.begin();
+  for (int i = 0; iter != entries.end(); i++, ++iter) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "chain-%d", i);
+    ASSERT_EQ(string(buf), iter->tag);
+    ASSERT_EQ(2, (int)iter->chain.objs.size());
+  }
+
+  list<cls_rgw_gc_obj_info> omap_entries;
+  string omap_marker;
+  ASSERT_EQ(0, cls_rgw_gc_list(ioctx, oid, omap_marker, 100, true, omap_entries, &truncated, next_marker));
+  ASSERT_EQ(count, (int)(entries.size() + omap_entries.size()));
+
+  /* a deferred chain is listed with its new expiration */
+  string tag = entries.front().tag;
+  librados::ObjectWriteOperation defer_op;
+  cls_rgw_gc_queue_defer_entry(defer_op, 60, tag);
+  ASSERT_EQ(0, ioctx.operate(oid, &defer_op));
+
+  entries.clear();
+  ASSERT_EQ(0, cls_rgw_gc_queue_list(ioctx, oid, marker, 1, true, entries, &truncated, next_marker));
+  ASSERT_EQ(1, (int)entries.size());
+  ASSERT_EQ(tag, entries.front().tag);
+  ASSERT_LT(ceph::real_clock::now(), entries.front().time);
+
+  /* markers must point at an entry */
+  librados::ObjectWriteOperation bad_remove_op;
+  cls_rgw_gc_queue_remove(bad_remove_op, std::to_string(queue_size * 10));
+  ASSERT_EQ(-EINVAL, ioctx.operate(oid, &bad_remove_op));
+}
+
 auto populate_usage_log_info(std::string user, std::string payer, int total_usage_entries)
 {
   rgw_usage_log_info info;
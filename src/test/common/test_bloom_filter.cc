@@ -303,3 +303,56 @@ TEST(BloomFilter, Assignement) {
   ASSERT_EQ(2U, bf1.element_count());
   ASSERT_EQ(1U, bf2.element_count());
 }
+
+TEST(BlockedBloomFilter, Basic) {
+  blocked_bloom_filter bf(100, .01, 1);
+  for (uint32_t i = 0; i < 100; ++i)
+    bf.insert(i);
+  for (uint32_t i = 0; i < 100; ++i)
+    ASSERT_TRUE(bf.contains(i));
+  ASSERT_EQ(100U, bf.element_count());
+  ASSERT_TRUE(bf.is_full());
+
+  // consecutive values are fine, the filter remixes them
+  int hit = 0;
+  for (uint32_t i = 1000; i < 101000; ++i)
+    if (bf.contains(i))
+      hit++;
+  ASSERT_LT(hit, 100000 * .03);
+}
+
+TEST(BlockedBloomFilter, Empty) {
+  blocked_bloom_filter bf;
+  for (uint32_t i = 0; i < 100; ++i)
+    ASSERT_FALSE(bf.contains(i));
+  ASSERT_EQ(0.0, bf.density());
+}
+
+TEST(BlockedBloomFilter, Fold) {
+  blocked_bloom_filter bf(1000, .01, 1);
+  for (uint32_t i = 0; i < 100; ++i)
+    bf.insert(i * 7919);
+  size_t size = bf.size();
+  double density = bf.density();
+  ASSERT_TRUE(bf.fold());
+  ASSERT_EQ(size / 2, bf.size());
+  ASSERT_GT(bf.density(), density);
+  for (uint32_t i = 0; i < 100; ++i)
+    ASSERT_TRUE(bf.contains(i * 7919));
+}
+
+TEST(BlockedBloomFilter, EncodeDecode) {
+  blocked_bloom_filter bf(100, .01, 7), bf2;
+  for (uint32_t i = 0; i < 50; ++i)
+    bf.insert(i);
+  bufferlist bl;
+  encode(bf, bl);
+  auto p = bl.cbegin();
+  decode(bf2, p);
+  ASSERT_EQ(bf.size(), bf2.size());
+  ASSERT_EQ(bf.element_count(), bf2.element_count());
+  for (uint32_t i = 0; i < 50; ++i)
+    ASSERT_TRUE(bf2.contains(i));
+  for (uint32_t i = 50; i < 1000; ++i)
+    ASSERT_EQ(bf.contains(i), bf2.contains(i));
+}
@@ -20,6 +20,7 @@
  *
  */
 #include "common/config_proxy.h"
+#include "common/config_cacher.h"
 #include "common/errno.h"
 #include "gtest/gtest.h"
 #include "common/hostname.h"
@@ -258,6 +259,45 @@ TEST(md_config_t, set_val)
   }
 }
 
+namespace {
+struct snapshot_conf_t {
+  uint64_t mgr_osd_bytes;
+  double mgr_tick_period;
+
+  explicit snapshot_conf_t(const ConfigProxy& conf)
+    : mgr_osd_bytes(conf.get_val<Option::size_t>("mgr_osd_bytes")),
+      mgr_tick_period(conf.get_val<std::chrono::seconds>(
+        "mgr_tick_period").count())
+  {}
+  static const char** get_tracked_conf_keys() {
+    static const char* keys[] = {
+      "mgr_osd_bytes",
+      "mgr_tick_period",
+      nullptr
+    };
+    return keys;
+  }
+};
+}
+
+TEST(md_config_snapshot_t, apply_changes)
+{
+  ConfigProxy conf{false};
+  md_config_snapshot_t<snapshot_conf_t> snap{conf};
+  const snapshot_conf_t* before = snap.get();
+  EXPECT_EQ(conf.get_val<Option::size_t>("mgr_osd_bytes"),
+            snap->mgr_osd_bytes);
+
+  EXPECT_EQ(0, conf.set_val("mgr_osd_bytes", "256M", nullptr));
+  // nothing changes until the change is applied
+  EXPECT_EQ(before, snap.get());
+  conf.apply_changes(nullptr);
+  EXPECT_NE(before, snap.get());
+  EXPECT_EQ(256u << 20, snap->mgr_osd_bytes);
+  // a reader holding the old snapshot still sees a consistent view
+  EXPECT_EQ(512u << 20, before->mgr_osd_bytes);
+}
+
 TEST(Option, validation)
 {
   Option opt_int("foo", Option::TYPE_INT, Option::LEVEL_BASIC);
@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <string.h>
+#include <vector>
 
 #include "include/types.h"
 #include "include/crc32c.h"
@@ -44,6 +45,61 @@ TEST(Crc32c, Big) {
   free(a);
 }
 
+TEST(Crc32c, Segments) {
+  // mix of tiny, word-straddling and multi-KB segments, so the streams
+  // get split both inside segments and right next to their ends
+  std::vector<std::vector<unsigned char>> bufs;
+  std::vector<ceph_crc32c_segment> segs;
+  for (unsigned len : {0u, 1u, 7u, 3000u, 13u, 0u, 64u, 9u, 4096u, 5u,
+		       100u, 8u, 2000u, 3u, 17u}) {
+    bufs.emplace_back(len + 1);
+    for (auto& c : bufs.back()) {
+      c = rand();
+    }
+    segs.push_back({bufs.back().data(), len});
+  }
+  for (unsigned n = 0; n <= segs.size(); n++) {
+    uint32_t expected = 1234;
+    for (unsigned i = 0; i < n; i++) {
+      expected = ceph_crc32c(expected, segs[i].data, segs[i].length);
+    }
+    ASSERT_EQ(expected, ceph_crc32c_segments(1234, segs.data(), n));
+  }
+}
+
+TEST(Crc32c, SegmentsPerformance) {
+  constexpr unsigned seg_len = 200;
+  constexpr unsigned num_segs = 64;
+  std::vector<unsigned char> buf(seg_len * num_segs);
+  for (unsigned i = 0; i < buf.size(); i++) {
+    buf[i] = i & 0xff;
+  }
+  std::vector<ceph_crc32c_segment> segs;
+  for (unsigned i = 0; i < num_segs; i++) {
+    segs.push_back({buf.data() + i * seg_len, seg_len});
+  }
+  constexpr int rounds = 100000;
+  uint32_t chained = 0;
+  utime_t start = ceph_clock_now();
+  for (int r = 0; r < rounds; r++) {
+    for (auto& seg : segs) {
+      chained = ceph_crc32c(chained, seg.data, seg.length);
+    }
+  }
+  utime_t end = ceph_clock_now();
+  std::cout << "chained: " << (double)buf.size() * rounds / (1024*1024) /
+    (double)(end - start) << " MB/sec" << std::endl;
+  uint32_t stitched = 0;
+  start = ceph_clock_now();
+  for (int r = 0; r < rounds; r++) {
+    stitched = ceph_crc32c_segments(stitched, segs.data(), segs.size());
+  }
+  end = ceph_clock_now();
+  std::cout << "stitched: " << (double)buf.size() * rounds / (1024*1024) /
+    (double)(end - start) << " MB/sec" << std::endl;
+  ASSERT_EQ(chained, stitched);
+}
+
 TEST(Crc32c, Performance) {
   int len = 1000 * 1024 * 1024;
   char *a = (char *)malloc(len);
@@ -0,0 +1,79 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "common/Finisher.h"
+#include "global/global_context.h"
+
+namespace {
+  // records the order in which its sequence completes
+  struct C_Record : public Context {
+    std::vector<int>& seen;
+    int i;
+    C_Record(std::vector<int>& seen, int i) : seen(seen), i(i) {}
+    void finish(int r) override {
+      seen.push_back(i);
+    }
+  };
+}
+
+TEST(Finisher, ManyProducersInOrder)
+{
+  Finisher finisher(g_ceph_context);
+  finisher.start();
+  constexpr int producers = 8;
+  constexpr int per_producer = 10000;
+  // only the finisher thread touches these
+  std::vector<std::vector<int>> seen(producers);
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; p++) {
+    threads.emplace_back([&, p] {
+      for (int i = 0; i < per_producer; i++) {
+	if (i % 3) {
+	  finisher.queue(new C_Record(seen[p], i));
+	} else {
+	  std::list<Context*> ls{new C_Record(seen[p], i)};
+	  finisher.queue(ls);
+	}
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  finisher.wait_for_empty();
+  finisher.stop();
+  for (auto& s : seen) {
+    ASSERT_EQ(per_producer, (int)s.size());
+    for (int i = 0; i < per_producer; i++) {
+      ASSERT_EQ(i, s[i]);
+    }
+  }
+}
+
+TEST(ShardedFinisher, SameKeyInOrder)
+{
+  ShardedFinisher finisher(g_ceph_context, "test_sharded", "fn-test", 4);
+  ASSERT_EQ(4u, finisher.get_num_shards());
+  finisher.start();
+  constexpr int keys = 16;
+  constexpr int per_key = 1000;
+  std::vector<std::vector<int>> seen(keys);
+  for (int i = 0; i < per_key; i++) {
+    for (int k = 0; k < keys; k++) {
+      finisher.queue(k, new C_Record(seen[k], i));
+    }
+  }
+  finisher.wait_for_empty();
+  finisher.stop();
+  for (auto& s : seen) {
+    ASSERT_EQ(per_key, (int)s.size());
+    for (int i = 0; i < per_key; i++) {
+      ASSERT_EQ(i, s[i]);
+    }
+  }
+}
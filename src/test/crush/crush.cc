@@ -15,6 +15,7 @@
 #include "include/stringify.h"
 
 #include "crush/CrushWrapper.h"
+#include "crush/hash_simd.h"
 #include "osd/osd_types.h"
 
 #include <set>
@@ -509,6 +510,73 @@ TEST(CRUSH, straw2_stddev)
   }
 }
 
+TEST(CRUSH, straw2_hash_batch) {
+  // the vector kernel, if this CPU has one, must match the scalar hash
+  // lane for lane, including the tails that do not fill a vector
+  crush_hash32_rjenkins1_3_batch_func_t batch = crush_choose_hash_batch();
+  if (!batch) {
+    GTEST_SKIP() << "no batched crush hash on this CPU";
+  }
+  __s32 ids[CRUSH_HASH_BATCH];
+  __u32 out[CRUSH_HASH_BATCH];
+  for (int t = 0; t < 1000; ++t) {
+    unsigned n = 1 + rand() % CRUSH_HASH_BATCH;
+    __u32 x = rand();
+    __u32 r = rand() % 50;
+    for (unsigned i = 0; i < n; ++i) {
+      ids[i] = (rand() % 2) ? i : -1 - (int)i;
+    }
+    batch(x, ids, r, n, out);
+    for (unsigned i = 0; i < n; ++i) {
+      ASSERT_EQ(crush_hash32_3(CRUSH_HASH_RJENKINS1, x, ids[i], r), out[i]);
+    }
+  }
+}
+
+TEST(CRUSH, straw2_batch_same) {
+  // batched and item-by-item straw2 must pick the same items; use
+  // more items than one batch, zero weights and duplicate weights so
+  // that ties and S64_MIN draws cross the batch boundary
+  const int n = CRUSH_HASH_BATCH * 2 + 7;
+  int weights[n];
+  int items[n];
+  for (int i = 0; i < n; ++i) {
+    items[i] = i;
+    weights[i] = (i % 11 == 0) ? 0 : 0x10000 * (1 + i % 3);
+  }
+
+  std::unique_ptr<CrushWrapper> c(new CrushWrapper);
+  c->set_type_name(1, "root");
+  c->set_type_name(0, "osd");
+  c->set_max_devices(n);
+  int root;
+  crush_bucket *b = crush_make_bucket(c->get_crush_map(),
+				      CRUSH_BUCKET_STRAW2, CRUSH_HASH_RJENKINS1,
+				      1, n, items, weights);
+  EXPECT_EQ(0, crush_add_bucket(c->get_crush_map(), 0, b, &root));
+  EXPECT_EQ(0, c->set_item_name(root, "root"));
+  int rule = c->add_simple_rule("rule", "root", "osd", "",
+				"firstn", pg_pool_t::TYPE_REPLICATED);
+  EXPECT_EQ(0, rule);
+  c->finalize();
+
+  vector<unsigned> reweight(n, 0x10000);
+  const int total = 10000;
+  vector<vector<int>> batched(total), scalar(total);
+  crush_hash32_rjenkins1_3_batch_func_t saved = crush_hash32_rjenkins1_3_batch;
+  for (int i = 0; i < total; ++i) {
+    c->do_rule(rule, i, batched[i], 3, reweight, 0);
+  }
+  crush_hash32_rjenkins1_3_batch = nullptr;
+  for (int i = 0; i < total; ++i) {
+    c->do_rule(rule, i, scalar[i], 3, reweight, 0);
+  }
+  crush_hash32_rjenkins1_3_batch = saved;
+  for (int i = 0; i < total; ++i) {
+    ASSERT_EQ(scalar[i], batched[i]);
+  }
+}
+
 TEST(CRUSH, straw2_reweight) {
   // when we adjust the weight of an item in a straw2 bucket,
   // we should *only* see movement from or to that item, never
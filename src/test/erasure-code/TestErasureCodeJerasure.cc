@@ -277,6 +277,66 @@ TEST(ErasureCodeTest, encode)
   }
 }
 
+template <typename T>
+void check_parity_delta(const char *w)
+{
+  T jerasure;
+  ErasureCodeProfile profile;
+  profile["k"] = "4";
+  profile["m"] = "2";
+  profile["w"] = w;
+  ASSERT_EQ(0, jerasure.init(profile, &cerr));
+  ASSERT_TRUE(jerasure.supports_parity_delta());
+
+  set<int> want_to_encode;
+  for (unsigned i = 0; i < jerasure.get_chunk_count(); i++)
+    want_to_encode.insert(i);
+  unsigned object_size = jerasure.get_alignment() * 4;
+  bufferlist in;
+  for (unsigned i = 0; i < object_size; i++)
+    in.append((char)(i * 7 + 3));
+  map<int,bufferlist> encoded;
+  ASSERT_EQ(0, jerasure.encode(want_to_encode, in, &encoded));
+  unsigned chunk_size = encoded[0].length();
+
+  // change the second and the last data chunk
+  bufferlist changed;
+  for (unsigned i = 0; i < object_size; i++) {
+    unsigned chunk = i / chunk_size;
+    changed.append((chunk == 1 || chunk == 3) ? (char)(i * 13 + 1) : in[i]);
+  }
+  map<int,bufferlist> reencoded;
+  ASSERT_EQ(0, jerasure.encode(want_to_encode, changed, &reencoded));
+
+  map<int,bufferptr> deltas;
+  for (int chunk : { 1, 3 }) {
+    bufferptr old_data(encoded[chunk].c_str(), chunk_size);
+    bufferptr new_data(reencoded[chunk].c_str(), chunk_size);
+    jerasure.encode_delta(old_data, new_data, &deltas[chunk]);
+  }
+  map<int,bufferptr> parity;
+  for (int chunk : { 4, 5 }) {
+    parity[chunk] = bufferptr(encoded[chunk].c_str(), chunk_size);
+  }
+  ASSERT_EQ(0, jerasure.apply_delta(deltas, &parity));
+  for (int chunk : { 4, 5 }) {
+    EXPECT_EQ(0, memcmp(parity[chunk].c_str(), reencoded[chunk].c_str(),
+			chunk_size));
+  }
+}
+
+TEST(ErasureCodeTest, parity_delta)
+{
+  check_parity_delta<ErasureCodeJerasureReedSolomonVandermonde>("8");
+  check_parity_delta<ErasureCodeJerasureReedSolomonVandermonde>("16");
+  check_parity_delta<ErasureCodeJerasureReedSolomonVandermonde>("32");
+  check_parity_delta<ErasureCodeJerasureReedSolomonRAID6>("8");
+  check_parity_delta<ErasureCodeJerasureReedSolomonRAID6>("16");
+
+  ErasureCodeJerasureCauchyGood cauchy;
+  EXPECT_FALSE(cauchy.supports_parity_delta());
+}
+
 TEST(ErasureCodeTest, create_rule)
 {
   std::unique_ptr<CrushWrapper> c = std::make_unique<CrushWrapper>();
@@ -12,6 +12,7 @@
 #include "messages/MOSDOp.h"
 #include "messages/MOSDOpReply.h"
 #include "common/perf_counters.h"
+#include "common/perf_histogram.h"
 #include "auth/DummyAuth.h"
 #include "ring_buffer.h"
 
@@ -32,6 +33,17 @@ enum ceph_msgr_type {
 const char *ceph_msgr_types[] = { "undef", "async+posix",
 				  "async+dpdk", "async+rdma" };
 
+enum ceph_msgr_protocol {
+  CEPH_MSGR_PROTOCOL_UNDEF,
+  CEPH_MSGR_PROTOCOL_V1,
+  CEPH_MSGR_PROTOCOL_V2,
+};
+
+enum ceph_msgr_mode {
+  CEPH_MSGR_MODE_CRC,
+  CEPH_MSGR_MODE_SECURE,
+};
+
 struct ceph_msgr_options {
   struct thread_data *td__;
   unsigned int is_receiver;
@@ -40,13 +52,28 @@ struct ceph_msgr_options {
   const char *hostname;
   const char *conffile;
   enum ceph_msgr_type ms_type;
+  enum ceph_msgr_protocol ms_protocol;
+  enum ceph_msgr_mode ms_mode;
+  unsigned int connections;
 };
 
 class FioDispatcher;
 
+/*
+ * Sender side latency histogram: round trip time in usec (log2) by
+ * message size in bytes (log2).
+ */
+static PerfHistogramCommon::axis_config_d lat_axis_config{
+  "Latency (usec)", PerfHistogramCommon::SCALE_LOG2, 0, 1, 32,
+};
+static PerfHistogramCommon::axis_config_d size_axis_config{
+  "Request size (bytes)", PerfHistogramCommon::SCALE_LOG2, 0, 512, 16,
+};
+
 struct ceph_msgr_data {
   ceph_msgr_data(struct ceph_msgr_options *o_, unsigned iodepth) :
-    o(o_) {
+    o(o_),
+    lat_hist{lat_axis_config, size_axis_config} {
     INIT_FLIST_HEAD(&io_inflight_list);
     INIT_FLIST_HEAD(&io_pending_list);
     ring_buffer_init(&io_completed_q, iodepth);
@@ -55,7 +82,11 @@ struct ceph_msgr_data {
 
   struct ceph_msgr_options *o;
   Messenger *msgr = NULL;
+  /* Further sender messengers, one connection each, see 'connections' */
+  std::vector<Messenger *> extra_msgrs;
+  unsigned int next_msgr = 0;
   FioDispatcher *disp = NULL;
+  PerfHistogram<2> lat_hist;
   pthread_spinlock_t spin;
   struct ring_buffer io_completed_q;
   struct flist_head io_inflight_list;
@@ -69,6 +100,7 @@ struct ceph_msgr_io {
   struct ceph_msgr_data *data;
   struct io_u *io_u;
   MOSDOp *req_msg; /** Cached request, valid only for sender */
+  uint64_t start_ns; /** Submission time, valid only for sender */
 };
 
 struct ceph_msgr_reply_io {
@@ -94,7 +126,70 @@ static std::string ptr_to_str(void *ptr)
  * global context refcounter, sigh.
  */
 static std::atomic<int> ctx_ref(1);
-static DummyAuthClientServer *g_dummy_auth;
+
+/*
+ * No real authentication, but either end agrees on the connection mode
+ * requested by the job and, for secure mode, on a fixed connection secret,
+ * so that msgr2 encryption can be measured without a monitor.
+ */
+class FioAuthClientServer : public DummyAuthClientServer {
+  uint32_t con_mode;
+
+  void set_secret(AuthConnectionMeta *auth_meta, std::string *secret) {
+    if (con_mode == CEPH_CON_MODE_SECURE)
+      secret->assign(auth_meta->get_connection_secret_length(), 'x');
+  }
+
+public:
+  FioAuthClientServer(CephContext *cct, uint32_t mode) :
+    DummyAuthClientServer(cct),
+    con_mode(mode) {
+  }
+
+  int get_auth_request(
+    Connection *con,
+    AuthConnectionMeta *auth_meta,
+    uint32_t *method,
+    std::vector<uint32_t> *preferred_modes,
+    bufferlist *out) override {
+    *method = CEPH_AUTH_NONE;
+    *preferred_modes = { con_mode };
+    return 0;
+  }
+
+  int handle_auth_done(
+    Connection *con,
+    AuthConnectionMeta *auth_meta,
+    uint64_t global_id,
+    uint32_t mode,
+    const bufferlist& bl,
+    CryptoKey *session_key,
+    std::string *connection_secret) override {
+    auth_meta->con_mode = mode;
+    set_secret(auth_meta, connection_secret);
+    return 0;
+  }
+
+  uint32_t pick_con_mode(
+    int peer_type,
+    uint32_t auth_method,
+    const std::vector<uint32_t>& preferred_modes) override {
+    return con_mode;
+  }
+
+  int handle_auth_request(
+    Connection *con,
+    AuthConnectionMeta *auth_meta,
+    bool more,
+    uint32_t auth_method,
+    const bufferlist& bl,
+    bufferlist *reply) override {
+    set_secret(auth_meta, &auth_meta->connection_secret);
+    return 1;
+  }
+};
+
+static FioAuthClientServer *g_dummy_auth;
 
 static void create_or_get_ceph_context(struct ceph_msgr_options *o)
 {
@@ -118,7 +213,9 @@ static void create_or_get_ceph_context(struct ceph_msgr_options *o)
 
   common_init_finish(g_ceph_context);
   g_ceph_context->_conf.apply_changes(NULL);
-  g_dummy_auth = new DummyAuthClientServer(g_ceph_context);
+  g_dummy_auth = new FioAuthClientServer(g_ceph_context,
+    o->ms_mode == CEPH_MSGR_MODE_SECURE ?
+    CEPH_CON_MODE_SECURE : CEPH_CON_MODE_CRC);
   g_dummy_auth->auth_registry.refresh_config();
 }
 
@@ -280,11 +377,16 @@ static entity_addr_t hostname_to_addr(struct ceph_msgr_options *o)
   addr.parse(o->hostname);
   addr.set_port(o->port);
   addr.set_nonce(0);
+  if (o->ms_protocol == CEPH_MSGR_PROTOCOL_V1)
+    addr.set_type(entity_addr_t::TYPE_LEGACY);
+  else if (o->ms_protocol == CEPH_MSGR_PROTOCOL_V2)
+    addr.set_type(entity_addr_t::TYPE_MSGR2);
 
   return addr;
 }
 
-static Messenger *create_messenger(struct ceph_msgr_options *o)
+static Messenger *create_messenger(struct ceph_msgr_options *o,
+				   unsigned int idx = 0)
 {
   entity_name_t ename = o->is_receiver ?
     entity_name_t::OSD(0) : entity_name_t::CLIENT(0);
@@ -300,8 +402,10 @@ static Messenger *create_messenger(struct ceph_msgr_options *o)
     ceph_msgr_types[o->ms_type] :
     g_ceph_context->_conf.get_val<std::string>("ms_type");
 
-  /* o->td__>pid doesn't set value, so use getpid() instead*/
-  auto nonce = o->is_receiver ? 0 : (getpid() + o->td__->thread_number);
+  /* o->td__>pid doesn't set value, so use getpid() instead.
+   * entity_addr_t nonces are 32 bits, so idx must go into the low bits */
+  uint32_t nonce = o->is_receiver ? 0 :
+    (((uint32_t)getpid() << 16) ^ (o->td__->thread_number << 8) ^ idx);
   Messenger *msgr = Messenger::create(g_ceph_context, ms_type.c_str(),
 				      ename, lname, nonce, flags);
   if (o->is_receiver) {
@@ -347,6 +451,16 @@ static void init_messenger(struct ceph_msgr_data *data)
      * Messenger instance per FIO thread
      */
     msgr = create_messenger(o);
+
+    /*
+     * Each sender messenger holds a single connection to the receiver,
+     * so more connections per thread need more messengers.
+     */
+    for (unsigned int i = 1; !o->is_receiver && i < o->connections; i++) {
+      Messenger *extra = create_messenger(o, i);
+      extra->add_dispatcher_head(disp);
+      data->extra_msgrs.push_back(extra);
+    }
   }
   msgr->add_dispatcher_head(disp);
 
@@ -359,6 +473,31 @@ static void free_messenger(struct ceph_msgr_data *data)
   data->msgr->shutdown();
   data->msgr->wait();
   delete data->msgr;
+
+  for (auto msgr : data->extra_msgrs) {
+    msgr->shutdown();
+    msgr->wait();
+    delete msgr;
+  }
+  data->extra_msgrs.clear();
+}
+
+static void dump_latency_histogram(struct ceph_msgr_data *data)
+{
+  ostringstream ostr;
+  Formatter* f;
+
+  f = Formatter::create("json-pretty");
+  f->open_object_section("latency_histogram");
+  data->lat_hist.dump_formatted(f);
+  f->close_section();
+  ostr << ">>>>>>>>>>>>> LATENCY HISTOGRAM BEGIN <<<<<<<<<<<<" << std::endl;
+  f->flush(ostr);
+  ostr << ">>>>>>>>>>>>>  LATENCY HISTOGRAM END  <<<<<<<<<<<<" << std::endl;
+
+  delete f;
+  dout(0) << "thread " << data->o->td__->thread_number << " "
+	  << ostr.str() << dendl;
 }
 
 static void put_messenger(struct ceph_msgr_data *data)
@@ -410,6 +549,8 @@ static void fio_ceph_msgr_cleanup(struct thread_data *td)
   unsigned nr;
 
   data = (decltype(data))td->io_ops_data;
+  if (!data->o->is_receiver)
+    dump_latency_histogram(data);
   put_messenger(data);
 
   nr = ring_buffer_used_size(&data->io_completed_q);
@@ -451,7 +592,10 @@ static int fio_ceph_msgr_io_u_init(struct thread_data *td, struct io_u *io_u)
     spg_t spgid(pgid);
     entity_inst_t dest(entity_name_t::OSD(0), hostname_to_addr(o));
 
-    Messenger *msgr = io->data->msgr;
+    /* Spread io_u's over the connections of this thread */
+    struct ceph_msgr_data *data = io->data;
+    unsigned int idx = data->next_msgr++ % (data->extra_msgrs.size() + 1);
+    Messenger *msgr = idx ? data->extra_msgrs[idx - 1] : data->msgr;
     ConnectionRef con = msgr->connect_to(dest.name.type(),
 					 entity_addrvec_t(dest.addr));
 
@@ -495,6 +639,7 @@ static enum fio_q_status ceph_msgr_sender_queue(struct thread_data *td,
 
   /* Here we do not care about direction, always send as write */
   io->req_msg->write(0, io_u->buflen, buflist);
+  io->start_ns = ceph::mono_clock::now().time_since_epoch().count();
   /* Keep message alive */
   io->req_msg->get();
   io->req_msg->get_connection()->send_message(io->req_msg);
@@ -541,6 +686,10 @@ static struct io_u *fio_ceph_msgr_event(struct thread_data *td, int event)
   data = (decltype(data))td->io_ops_data;
   io = (decltype(io))ring_buffer_dequeue(&data->io_completed_q);
 
+  if (!data->o->is_receiver) {
+    uint64_t now = ceph::mono_clock::now().time_since_epoch().count();
+    data->lat_hist.inc((now - io->start_ns) / 1000, io->io_u->buflen);
+  }
   return io->io_u;
 }
 
@@ -663,6 +812,51 @@ static std::vector<fio_option> options {
     o.posval[3].oval = CEPH_MSGR_TYPE_RDMA;
     o.posval[3].help = "RDMA";
   }),
+  make_option([] (fio_option& o) {
+    o.name  = "ms_protocol";
+    o.lname = "CEPH messenger protocol: v1, v2";
+    o.type  = FIO_OPT_STR;
+    o.off1  = offsetof(struct ceph_msgr_options, ms_protocol);
+    o.help  = "Wire protocol, overrides a 'v1:' or 'v2:' hostname prefix";
+    o.def   = "undef";
+
+    o.posval[0].ival = "undef";
+    o.posval[0].oval = CEPH_MSGR_PROTOCOL_UNDEF;
+
+    o.posval[1].ival = "v1";
+    o.posval[1].oval = CEPH_MSGR_PROTOCOL_V1;
+    o.posval[1].help = "Legacy protocol";
+
+    o.posval[2].ival = "v2";
+    o.posval[2].oval = CEPH_MSGR_PROTOCOL_V2;
+    o.posval[2].help = "msgr2 protocol";
+  }),
+  make_option([] (fio_option& o) {
+    o.name  = "ms_mode";
+    o.lname = "CEPH messenger v2 connection mode: crc, secure";
+    o.type  = FIO_OPT_STR;
+    o.off1  = offsetof(struct ceph_msgr_options, ms_mode);
+    o.help  = "Connection mode for protocol v2, must match on both ends";
+    o.def   = "crc";
+
+    o.posval[0].ival = "crc";
+    o.posval[0].oval = CEPH_MSGR_MODE_CRC;
+    o.posval[0].help = "Integrity checks only";
+
+    o.posval[1].ival = "secure";
+    o.posval[1].oval = CEPH_MSGR_MODE_SECURE;
+    o.posval[1].help = "AES-GCM encryption";
+  }),
+  make_option([] (fio_option& o) {
+    o.name   = "connections";
+    o.lname  = "CEPH messenger connections per sender thread";
+    o.type   = FIO_OPT_INT;
+    o.off1   = offsetof(struct ceph_msgr_options, connections);
+    o.minval = 1;
+    o.help   = "Number of connections each sender thread spreads its IOs over, "
+	       "ignored with single_instance";
+    o.def    = "1";
+  }),
   make_option([] (fio_option& o) {
     o.name  = "ceph_conf_file";
     o.lname = "CEPH configuration file";
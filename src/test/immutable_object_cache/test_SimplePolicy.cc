@@ -233,3 +233,55 @@ TEST_F(TestSimplePolicy, test_evict_list_10) {
     m_promoted_lru.erase(m_promoted_lru.begin());
   }
 }
+
+TEST_F(TestSimplePolicy, test_admission_scan_resistance) {
+  // go past the watermark, where promoting means evicting
+  uint64_t left_entry_num = m_cache_size * 0.95 - m_promoted_lru.size();
+  for (uint64_t i = 0; i < left_entry_num; i++, ++m_entry_index) {
+    insert_entry_into_promoted_lru(generate_file_name(m_entry_index));
+  }
+  // make the cached entries hot, keeping their lru order
+  for (int round = 0; round < 3; round++) {
+    for (auto& file_name : m_promoted_lru) {
+      ASSERT_EQ(OBJ_CACHE_PROMOTED, m_simple_policy->lookup_object(file_name));
+    }
+  }
+
+  // objects seen once are not admitted over the hot ones
+  for (uint64_t i = 0; i < 10; i++) {
+    std::string scan_file_name = "scan_file_" + std::to_string(i);
+    ASSERT_EQ(OBJ_CACHE_SKIP, m_simple_policy->lookup_object(scan_file_name));
+    ASSERT_EQ(OBJ_CACHE_NONE, m_simple_policy->get_status(scan_file_name));
+  }
+  ASSERT_EQ(0u, m_simple_policy->get_promoting_entry_num());
+
+  // an object looked up as often as the next victim is admitted
+  for (int round = 0; round < 2; round++) {
+    ASSERT_EQ(OBJ_CACHE_SKIP, m_simple_policy->lookup_object("scan_file_0"));
+  }
+  ASSERT_EQ(OBJ_CACHE_NONE, m_simple_policy->lookup_object("scan_file_0"));
+  m_simple_policy->update_status("scan_file_0", OBJ_CACHE_NONE);
+}
+
+TEST_F(TestSimplePolicy, test_pool_quota) {
+  // a pool may use 20% of the cache
+  SimplePolicy policy(g_ceph_context, m_cache_size, 128, 0.1, 0.2);
+  const uint64_t quota = m_cache_size / 5;
+  for (uint64_t i = 0; i < quota; i++) {
+    std::string file_name = "pool_1_file_" + std::to_string(i);
+    ASSERT_EQ(OBJ_CACHE_NONE, policy.lookup_object(file_name, 1));
+    policy.update_status(file_name, OBJ_CACHE_PROMOTED, 1);
+  }
+  ASSERT_EQ(quota, policy.get_pool_size(1));
+
+  // pool 1 is at its quota, other pools are not affected
+  ASSERT_EQ(OBJ_CACHE_SKIP, policy.lookup_object("pool_1_file_x", 1));
+  ASSERT_EQ(OBJ_CACHE_NONE, policy.lookup_object("pool_2_file_0", 2));
+  policy.update_status("pool_2_file_0", OBJ_CACHE_PROMOTED, 1);
+  ASSERT_EQ(1u, policy.get_pool_size(2));
+
+  // evicting frees up the pool's quota again
+  policy.evict_entry("pool_1_file_0");
+  ASSERT_EQ(quota - 1, policy.get_pool_size(1));
+  ASSERT_EQ(OBJ_CACHE_NONE, policy.lookup_object("pool_1_file_x", 1));
+}
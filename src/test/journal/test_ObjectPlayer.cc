@@ -4,6 +4,7 @@
 #include "journal/ObjectPlayer.h"
 #include "journal/Entry.h"
 #include "include/stringify.h"
+#include "common/AsyncOpTracker.h"
 #include "common/Mutex.h"
 #include "common/Timer.h"
 #include "gtest/gtest.h"
@@ -205,6 +206,33 @@ TYPED_TEST(TestObjectPlayer, FetchAppend) {
   ASSERT_EQ(expected_entries, entries);
 }
 
+TYPED_TEST(TestObjectPlayer, FetchReadAhead) {
+  std::string oid = this->get_temp_oid();
+
+  journal::ObjectPlayer::Entries expected_entries;
+  bufferlist bl;
+  for (uint64_t entry_tid = 123; entry_tid < 133; ++entry_tid) {
+    journal::Entry entry(234, entry_tid,
+                         this->create_payload(std::string(24, '1')));
+    encode(entry, bl);
+    expected_entries.push_back(entry);
+  }
+  ASSERT_EQ(0, this->append(this->get_object_name(oid), bl));
+
+  AsyncOpTracker async_op_tracker;
+  journal::ObjectPlayerPtr object = this->create_object(oid, 14);
+  object->enable_read_ahead(&async_op_tracker);
+  ASSERT_LE(0, this->fetch(object));
+
+  C_SaferCond ctx;
+  async_op_tracker.wait_for_ops(&ctx);
+  ASSERT_EQ(0, ctx.wait());
+
+  journal::ObjectPlayer::Entries entries;
+  object->get_entries(&entries);
+  ASSERT_EQ(expected_entries, entries);
+}
+
 TYPED_TEST(TestObjectPlayer, PopEntry) {
   std::string oid = this->get_temp_oid();
 
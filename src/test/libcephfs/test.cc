@@ -35,6 +35,8 @@
 #include <map>
 #include <vector>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
 
 TEST(LibCephFS, OpenEmptyComponent) {
 
@@ -1202,6 +1204,91 @@ TEST(LibCephFS, LlreadvLlwritev) {
   ceph_shutdown(cmount);
 }
 
+struct AsyncIOWaiter {
+  std::mutex lock;
+  std::condition_variable cond;
+  int pending = 0;
+
+  static void callback(struct ceph_ll_io_info *io_info) {
+    auto waiter = static_cast<AsyncIOWaiter*>(io_info->priv);
+    std::lock_guard l(waiter->lock);
+    waiter->pending--;
+    waiter->cond.notify_all();
+  }
+  void wait() {
+    std::unique_lock l(lock);
+    cond.wait(l, [this] { return pending == 0; });
+  }
+};
+
+TEST(LibCephFS, LlNonblockingReadvWritev) {
+  struct ceph_mount_info *cmount;
+  ASSERT_EQ(ceph_create(&cmount, NULL), 0);
+  ASSERT_EQ(ceph_conf_read_file(cmount, NULL), 0);
+  ASSERT_EQ(0, ceph_conf_parse_env(cmount, NULL));
+  ASSERT_EQ(ceph_mount(cmount, NULL), 0);
+
+  char filename[256];
+  sprintf(filename, "test_llnonblockingreadvwritev%u", getpid());
+
+  Inode *root, *file;
+  ASSERT_EQ(ceph_ll_lookup_root(cmount, &root), 0);
+
+  Fh *fh;
+  struct ceph_statx stx;
+  UserPerm *perms = ceph_mount_perms(cmount);
+  ASSERT_EQ(ceph_ll_create(cmount, root, filename, 0666,
+		    O_RDWR|O_CREAT|O_TRUNC, &file, &fh, &stx, 0, 0, perms), 0);
+
+  // several writes in flight at once, to different offsets
+  const int num_ios = 8;
+  char out[num_ios][16];
+  struct iovec iov_out[num_ios];
+  struct ceph_ll_io_info io_out[num_ios];
+  AsyncIOWaiter waiter;
+  waiter.pending = num_ios;
+  for (int i = 0; i < num_ios; i++) {
+    memset(out[i], 'a' + i, sizeof(out[i]));
+    iov_out[i] = {out[i], sizeof(out[i])};
+    io_out[i] = {};
+    io_out[i].callback = AsyncIOWaiter::callback;
+    io_out[i].priv = &waiter;
+    io_out[i].fh = fh;
+    io_out[i].iov = &iov_out[i];
+    io_out[i].iovcnt = 1;
+    io_out[i].off = i * sizeof(out[i]);
+    io_out[i].write = true;
+    ASSERT_EQ(0, ceph_ll_nonblocking_readv_writev(cmount, &io_out[i]));
+  }
+  waiter.wait();
+  for (int i = 0; i < num_ios; i++)
+    ASSERT_EQ((int64_t)sizeof(out[i]), io_out[i].result);
+
+  // read it all back with one vectored read
+  char in[num_ios][16];
+  struct iovec iov_in[num_ios];
+  for (int i = 0; i < num_ios; i++)
+    iov_in[i] = {in[i], sizeof(in[i])};
+  struct ceph_ll_io_info io_in = {};
+  io_in.callback = AsyncIOWaiter::callback;
+  io_in.priv = &waiter;
+  io_in.fh = fh;
+  io_in.iov = iov_in;
+  io_in.iovcnt = num_ios;
+  io_in.off = 0;
+  io_in.write = false;
+  waiter.pending = 1;
+  ASSERT_EQ(0, ceph_ll_nonblocking_readv_writev(cmount, &io_in));
+  waiter.wait();
+  ASSERT_EQ((int64_t)sizeof(in), io_in.result);
+  for (int i = 0; i < num_ios; i++)
+    ASSERT_EQ(0, memcmp(in[i], out[i], sizeof(in[i])));
+
+  ceph_ll_close(cmount, fh);
+  ceph_ll_unlink(cmount, root, filename, perms);
+  ceph_shutdown(cmount);
+}
+
 TEST(LibCephFS, StripeUnitGran) {
   struct ceph_mount_info *cmount;
   ASSERT_EQ(ceph_create(&cmount, NULL), 0);
@@ -362,6 +362,44 @@ TEST_F(AsioRados, AsyncWriteOperationYield)
 }
 #endif
 
+TEST_F(AsioRados, AsyncWriteOperationBatchCallback)
+{
+  boost::asio::io_service service;
+
+  bufferlist bl;
+  bl.append("hello");
+
+  {
+    librados::ObjectWriteOperation op1, op2;
+    op1.write_full(bl);
+    op2.write_full(bl);
+    auto success_cb = [&] (boost::system::error_code ec) {
+      EXPECT_FALSE(ec);
+    };
+    librados::async_operate(service, io, {{"exist", &op1}, {"batch", &op2}},
+                            0, success_cb);
+  }
+  {
+    librados::ObjectWriteOperation op;
+    op.write_full(bl);
+    auto failure_cb = [&] (boost::system::error_code ec) {
+      EXPECT_EQ(boost::system::errc::read_only_file_system, ec);
+    };
+    librados::async_operate(service, snapio, {{"exist", &op}}, 0, failure_cb);
+  }
+  {
+    auto empty_cb = [&] (boost::system::error_code ec) {
+      EXPECT_FALSE(ec);
+    };
+    librados::async_operate(service, io, {}, 0, empty_cb);
+  }
+  service.run();
+
+  bufferlist out;
+  EXPECT_EQ(5, io.read("batch", out, 0, 0));
+  EXPECT_EQ("hello", out.to_str());
+}
+
 int main(int argc, char **argv)
 {
   vector<const char*> args;
@@ -1312,6 +1312,29 @@ int cls_cxx_map_get_vals(cls_method_context_t hctx, const string &start_obj,
   return vals->size();
 }
 
+int cls_cxx_map_get_vals_batch(cls_method_context_t hctx,
+                               const string &start_obj,
+                               const string &filter_prefix,
+                               uint64_t max_to_get, uint64_t max_bytes,
+                               kv_batch_t *batch, bool *more) {
+  librados::TestClassHandler::MethodContext *ctx =
+    reinterpret_cast<librados::TestClassHandler::MethodContext*>(hctx);
+  std::map<string, bufferlist> vals;
+  int r = ctx->io_ctx_impl->omap_get_vals2(ctx->oid, start_obj, filter_prefix,
+					  max_to_get, &vals, more);
+  if (r < 0) {
+    return r;
+  }
+  for (auto& p : vals) {
+    if (!batch->append(p.first.data(), p.first.size(),
+                       p.second.c_str(), p.second.length(), max_bytes)) {
+      *more = true;
+      break;
+    }
+  }
+  return batch->size();
+}
+
 int cls_cxx_map_remove_key(cls_method_context_t hctx, const string &key) {
   std::set<std::string> keys;
   keys.insert(key);
@@ -0,0 +1,95 @@
+#include "include/rados/librados.hpp"
+#include "include/radosstriper/libradosstriper.hpp"
+#include "cls/lock/cls_lock_client.h"
+#include "test/librados/test.h"
+#include "test/libradosstriper/TestCase.h"
+
+#include <errno.h>
+#include <unistd.h>
+#include "gtest/gtest.h"
+
+using namespace librados;
+using namespace libradosstriper;
+using std::string;
+
+static const int LEASE = 2;
+
+class StriperTestLeasePP : public StriperTestPP {
+protected:
+  void SetUp() override {
+    ASSERT_EQ(0, cluster.conf_set("rados_striper_lock_lease",
+				  std::to_string(LEASE).c_str()));
+    StriperTestPP::SetUp();
+  }
+  void TearDown() override {
+    ASSERT_EQ(0, cluster.conf_set("rados_striper_lock_lease", "0"));
+  }
+
+  map<rados::cls::lock::locker_id_t, rados::cls::lock::locker_info_t>
+  get_lockers(const string& soid) {
+    map<rados::cls::lock::locker_id_t, rados::cls::lock::locker_info_t> lockers;
+    ClsLockType type;
+    string tag;
+    int r = rados::cls::lock::get_lock_info(&ioctx, soid + ".0000000000000000",
+					    "striper.lock", &lockers, &type, &tag);
+    EXPECT_EQ(0, r);
+    return lockers;
+  }
+
+  void write(const string& soid) {
+    bufferlist bl;
+    bl.append(string(128, 'x'));
+    ASSERT_EQ(0, striper.write(soid, bl, bl.length(), 0));
+  }
+
+  void read(const string& soid) {
+    bufferlist bl;
+    ASSERT_EQ(128, striper.read(soid, &bl, 128, 0));
+  }
+};
+
+TEST_F(StriperTestLeasePP, KeptPP) {
+  write("KeptPP");
+  auto lockers = get_lockers("KeptPP");
+  ASSERT_EQ(1u, lockers.size());
+  // the next operation reuses it
+  read("KeptPP");
+  auto again = get_lockers("KeptPP");
+  ASSERT_EQ(1u, again.size());
+  ASSERT_EQ(lockers.begin()->first.cookie, again.begin()->first.cookie);
+}
+
+TEST_F(StriperTestLeasePP, RenewedPP) {
+  write("RenewedPP");
+  auto lockers = get_lockers("RenewedPP");
+  ASSERT_EQ(1u, lockers.size());
+  // past the half of the lease it is renewed rather than taken anew
+  usleep(LEASE * 600000);
+  read("RenewedPP");
+  auto again = get_lockers("RenewedPP");
+  ASSERT_EQ(1u, again.size());
+  ASSERT_EQ(lockers.begin()->first.cookie, again.begin()->first.cookie);
+  ASSERT_GT(again.begin()->second.expiration,
+	    lockers.begin()->second.expiration);
+}
+
+TEST_F(StriperTestLeasePP, ExpiresPP) {
+  write("ExpiresPP");
+  RadosStriper other;
+  ASSERT_EQ(0, RadosStriper::striper_create(ioctx, &other));
+  // our lease keeps others from removing the object
+  ASSERT_EQ(-EBUSY, other.remove("ExpiresPP"));
+  // unused leases are not renewed
+  sleep(LEASE + 1);
+  ASSERT_EQ(0u, get_lockers("ExpiresPP").size());
+  ASSERT_EQ(0, other.remove("ExpiresPP"));
+}
+
+TEST_F(StriperTestLeasePP, OwnRemovePP) {
+  write("OwnRemovePP");
+  // our own lease doesn't get in the way of truncating or removing
+  ASSERT_EQ(0, striper.trunc("OwnRemovePP", 64));
+  bufferlist bl;
+  ASSERT_EQ(64, striper.read("OwnRemovePP", &bl, 128, 0));
+  ASSERT_EQ(0, striper.remove("OwnRemovePP"));
+}
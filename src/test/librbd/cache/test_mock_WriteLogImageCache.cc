@@ -0,0 +1,389 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "test/librbd/test_mock_fixture.h"
+#include "test/librbd/test_support.h"
+#include "test/librbd/mock/MockImageCtx.h"
+#include "include/rbd/librbd.hpp"
+#include "cls/rbd/cls_rbd_client.h"
+#include "common/Mutex.h"
+#include "include/stringify.h"
+#include "librbd/cache/ImageWriteback.h"
+#include <stdlib.h>
+#include <unistd.h>
+#include <functional>
+#include <list>
+
+namespace librbd {
+namespace {
+
+struct MockTestImageCtx : public MockImageCtx {
+  MockTestImageCtx(ImageCtx &image_ctx) : MockImageCtx(image_ctx) {
+  }
+};
+
+/// the image the cache writes back to, which can hold back or fail writes
+struct FakeImage {
+  Mutex lock{"FakeImage::lock"};
+  std::string data;
+  bool hold = false;
+  int write_result = 0;
+  std::list<std::function<void()>> held;
+
+  explicit FakeImage(uint64_t size) : data(size, '\0') {
+  }
+
+  void write(uint64_t off, const bufferlist &bl) {
+    bl.copy(0, bl.length(), &data[off]);
+  }
+
+  void set_hold(bool h) {
+    Mutex::Locker locker(lock);
+    hold = h;
+  }
+
+  void set_write_result(int r) {
+    Mutex::Locker locker(lock);
+    write_result = r;
+  }
+
+  size_t num_held() {
+    Mutex::Locker locker(lock);
+    return held.size();
+  }
+
+  void release(bool keep_holding) {
+    std::list<std::function<void()>> ls;
+    {
+      Mutex::Locker locker(lock);
+      hold = keep_holding;
+      ls.swap(held);
+    }
+    for (auto &f : ls) {
+      f();
+    }
+  }
+
+  std::string read(uint64_t off, uint64_t len) {
+    Mutex::Locker locker(lock);
+    return data.substr(off, len);
+  }
+};
+
+FakeImage *s_fake_image = nullptr;
+
+} // anonymous namespace
+
+namespace cache {
+
+template <>
+struct ImageWriteback<MockTestImageCtx> {
+  typedef std::vector<std::pair<uint64_t,uint64_t> > Extents;
+
+  explicit ImageWriteback(MockTestImageCtx &) {
+  }
+
+  void aio_read(Extents &&image_extents, ceph::bufferlist *bl,
+                int fadvise_flags, Context *on_finish) {
+    for (auto &extent : image_extents) {
+      bl->append(s_fake_image->read(extent.first, extent.second));
+    }
+    on_finish->complete(0);
+  }
+  void aio_write(Extents &&image_extents, ceph::bufferlist&& bl,
+                 int fadvise_flags, Context *on_finish) {
+    ceph_assert(image_extents.size() == 1);
+    uint64_t off = image_extents[0].first;
+    auto f = [off, bl=std::move(bl), on_finish]() {
+      int r;
+      {
+        Mutex::Locker locker(s_fake_image->lock);
+        r = s_fake_image->write_result;
+        if (r == 0) {
+          s_fake_image->write(off, bl);
+        }
+      }
+      on_finish->complete(r);
+    };
+    {
+      Mutex::Locker locker(s_fake_image->lock);
+      if (s_fake_image->hold) {
+        s_fake_image->held.push_back(std::move(f));
+        return;
+      }
+    }
+    f();
+  }
+  void aio_discard(uint64_t offset, uint64_t length,
+                   uint32_t discard_granularity_bytes, Context *on_finish) {
+    on_finish->complete(0);
+  }
+  void aio_flush(Context *on_finish) {
+    on_finish->complete(0);
+  }
+  void aio_writesame(uint64_t offset, uint64_t length,
+                     ceph::bufferlist&& bl,
+                     int fadvise_flags, Context *on_finish) {
+    on_finish->complete(0);
+  }
+  void aio_compare_and_write(Extents &&image_extents,
+                             ceph::bufferlist&& cmp_bl,
+                             ceph::bufferlist&& bl,
+                             uint64_t *mismatch_offset,
+                             int fadvise_flags, Context *on_finish) {
+    on_finish->complete(0);
+  }
+};
+
+} // namespace cache
+} // namespace librbd
+
+#include "librbd/cache/WriteLogImageCache.cc"
+
+namespace librbd {
+namespace cache {
+
+using ::testing::_;
+using ::testing::Invoke;
+
+static const uint64_t BLOCK = 4096;
+
+struct TestMockCacheWriteLogImageCache : public TestMockFixture {
+  typedef WriteLogImageCache<librbd::MockTestImageCtx> MockWriteLogImageCache;
+
+  std::string m_dir;
+  librbd::ImageCtx *m_ictx = nullptr;
+  std::unique_ptr<FakeImage> m_fake_image;
+
+  void SetUp() override {
+    TestMockFixture::SetUp();
+
+    char tmpl[] = "/tmp/test_rbd_wlog.XXXXXX";
+    ASSERT_TRUE(::mkdtemp(tmpl));
+    m_dir = tmpl;
+
+    ASSERT_EQ(0, open_image(m_image_name, &m_ictx));
+    m_ictx->config.set_val("rbd_persistent_cache_path", m_dir);
+    m_ictx->config.set_val("rbd_persistent_cache_size", "1M");
+
+    m_fake_image.reset(new FakeImage(m_image_size));
+    s_fake_image = m_fake_image.get();
+  }
+
+  void TearDown() override {
+    s_fake_image = nullptr;
+    ::unlink(log_path().c_str());
+    ::rmdir(m_dir.c_str());
+    TestMockFixture::TearDown();
+  }
+
+  void expect_op_work_queue(MockTestImageCtx &mock_image_ctx) {
+    // on a thread of its own, as the shut down joins the cache threads
+    EXPECT_CALL(*mock_image_ctx.op_work_queue, queue(_, _))
+      .WillRepeatedly(Invoke([this](Context* ctx, int r) {
+                        m_ictx->op_work_queue->queue(ctx, r);
+                      }));
+  }
+
+  static bufferlist make_data(char c, uint64_t len) {
+    bufferlist bl;
+    bl.append(std::string(len, c));
+    return bl;
+  }
+
+  int init(MockWriteLogImageCache &cache) {
+    C_SaferCond ctx;
+    cache.init(&ctx);
+    return ctx.wait();
+  }
+
+  int shut_down(MockWriteLogImageCache &cache) {
+    C_SaferCond ctx;
+    cache.shut_down(&ctx);
+    return ctx.wait();
+  }
+
+  int write(MockWriteLogImageCache &cache, uint64_t off, char c,
+            uint64_t len = BLOCK) {
+    C_SaferCond ctx;
+    cache.aio_write({{off, len}}, make_data(c, len), 0, &ctx);
+    return ctx.wait();
+  }
+
+  std::string read(MockWriteLogImageCache &cache, uint64_t off,
+                   uint64_t len = BLOCK) {
+    C_SaferCond ctx;
+    bufferlist bl;
+    cache.aio_read({{off, len}}, &bl, 0, &ctx);
+    EXPECT_EQ(0, ctx.wait());
+    return bl.to_str();
+  }
+
+  int writeback(MockWriteLogImageCache &cache) {
+    C_SaferCond ctx;
+    cache.flush(&ctx);
+    return ctx.wait();
+  }
+
+  void wait_for_held(size_t n) {
+    for (int i = 0; i < 1000 && m_fake_image->num_held() < n; i++) {
+      ::usleep(1000);
+    }
+    ASSERT_EQ(n, m_fake_image->num_held());
+  }
+
+  std::string log_path() {
+    return m_dir + "/rbd-wlog." + stringify(m_ictx->md_ctx.get_id()) + "." +
+      m_ictx->id;
+  }
+
+  bool has_state() {
+    std::string value;
+    return cls_client::metadata_get(&m_ictx->md_ctx, m_ictx->header_oid,
+                                    STATE_KEY, &value) == 0;
+  }
+};
+
+TEST_F(TestMockCacheWriteLogImageCache, Append) {
+  MockTestImageCtx mock_image_ctx(*m_ictx);
+  expect_op_work_queue(mock_image_ctx);
+
+  MockWriteLogImageCache cache(mock_image_ctx);
+  ASSERT_EQ(0, init(cache));
+  ASSERT_TRUE(has_state());
+  ASSERT_EQ(0, ::access(log_path().c_str(), F_OK));
+
+  // acked once in the log, before anything is written back
+  m_fake_image->set_hold(true);
+  ASSERT_EQ(0, write(cache, 0, 'a'));
+  ASSERT_EQ(0, write(cache, 3 * BLOCK, 'b', 2 * BLOCK));
+  ASSERT_EQ(std::string(BLOCK, '\0'), m_fake_image->read(0, BLOCK));
+
+  // reads lay the log over the image
+  ASSERT_EQ(std::string(BLOCK, 'a'), read(cache, 0));
+  ASSERT_EQ(std::string(BLOCK, '\0') + std::string(BLOCK, 'b'),
+            read(cache, 2 * BLOCK, 2 * BLOCK));
+  ASSERT_EQ(std::string(BLOCK, '\0'), read(cache, BLOCK));
+
+  m_fake_image->release(false);
+  ASSERT_EQ(0, shut_down(cache));
+  ASSERT_EQ(std::string(BLOCK, 'a'), m_fake_image->read(0, BLOCK));
+  ASSERT_EQ(std::string(2 * BLOCK, 'b'),
+            m_fake_image->read(3 * BLOCK, 2 * BLOCK));
+
+  // clean, so neither the state nor the log are left
+  ASSERT_FALSE(has_state());
+  ASSERT_NE(0, ::access(log_path().c_str(), F_OK));
+}
+
+TEST_F(TestMockCacheWriteLogImageCache, Destage) {
+  MockTestImageCtx mock_image_ctx(*m_ictx);
+  expect_op_work_queue(mock_image_ctx);
+
+  MockWriteLogImageCache cache(mock_image_ctx);
+  ASSERT_EQ(0, init(cache));
+
+  m_fake_image->set_hold(true);
+  ASSERT_EQ(0, write(cache, 0, 'a'));
+  ASSERT_EQ(0, write(cache, BLOCK / 2, 'b', BLOCK));
+  ASSERT_EQ(0, write(cache, 4 * BLOCK, 'c'));
+
+  // the second overlaps the first, so it waits for it, and the third is
+  // written back in order after the second
+  ASSERT_NO_FATAL_FAILURE(wait_for_held(1));
+  ::usleep(10000);
+  ASSERT_EQ(1u, m_fake_image->num_held());
+  m_fake_image->release(true);
+  ASSERT_NO_FATAL_FAILURE(wait_for_held(2));
+  ASSERT_EQ(std::string(BLOCK, 'a'), m_fake_image->read(0, BLOCK));
+
+  C_SaferCond flush_ctx;
+  cache.flush(&flush_ctx);
+  m_fake_image->release(false);
+  ASSERT_EQ(0, flush_ctx.wait());
+  ASSERT_EQ(std::string(BLOCK / 2, 'a') + std::string(BLOCK, 'b'),
+            m_fake_image->read(0, BLOCK + BLOCK / 2));
+  ASSERT_EQ(std::string(BLOCK, 'c'), m_fake_image->read(4 * BLOCK, BLOCK));
+
+  ASSERT_EQ(0, shut_down(cache));
+}
+
+TEST_F(TestMockCacheWriteLogImageCache, RecoverAfterCrash) {
+  MockTestImageCtx mock_image_ctx(*m_ictx);
+  expect_op_work_queue(mock_image_ctx);
+
+  {
+    MockWriteLogImageCache cache(mock_image_ctx);
+    ASSERT_EQ(0, init(cache));
+    m_fake_image->set_write_result(-EIO);
+    ASSERT_EQ(0, write(cache, 0, 'a'));
+    ASSERT_EQ(0, write(cache, BLOCK, 'b'));
+    ASSERT_EQ(0, write(cache, 0, 'c'));
+    // nothing could be written back, the log and the state stay
+    ASSERT_EQ(-EIO, shut_down(cache));
+  }
+  ASSERT_TRUE(has_state());
+  ASSERT_EQ(std::string(2 * BLOCK, '\0'), m_fake_image->read(0, 2 * BLOCK));
+
+  m_fake_image->set_write_result(0);
+  m_fake_image->set_hold(true);
+  MockWriteLogImageCache cache(mock_image_ctx);
+  ASSERT_EQ(0, init(cache));
+  ASSERT_EQ(std::string(BLOCK, 'c') + std::string(BLOCK, 'b'),
+            read(cache, 0, 2 * BLOCK));
+
+  m_fake_image->release(false);
+  ASSERT_EQ(0, writeback(cache));
+  ASSERT_EQ(std::string(BLOCK, 'c') + std::string(BLOCK, 'b'),
+            m_fake_image->read(0, 2 * BLOCK));
+  ASSERT_EQ(0, shut_down(cache));
+  ASSERT_FALSE(has_state());
+}
+
+TEST_F(TestMockCacheWriteLogImageCache, RingWrap) {
+  MockTestImageCtx mock_image_ctx(*m_ictx);
+  expect_op_work_queue(mock_image_ctx);
+
+  // each entry takes a header and a block, a 1M log holds about 250
+  const uint64_t first = 200;
+  const uint64_t second = 100;
+  {
+    MockWriteLogImageCache cache(mock_image_ctx);
+    ASSERT_EQ(0, init(cache));
+    for (uint64_t i = 0; i < first; i++) {
+      ASSERT_EQ(0, write(cache, i * BLOCK, 'A' + i % 26));
+    }
+    ASSERT_EQ(0, writeback(cache));
+
+    // these go past the end of the ring and start over at its beginning
+    m_fake_image->set_write_result(-EIO);
+    for (uint64_t i = 0; i < second; i++) {
+      ASSERT_EQ(0, write(cache, (first + i) * BLOCK, 'a' + i % 26));
+    }
+    ASSERT_EQ(-EIO, shut_down(cache));
+  }
+
+  m_fake_image->set_write_result(0);
+  m_fake_image->set_hold(true);
+  MockWriteLogImageCache cache(mock_image_ctx);
+  ASSERT_EQ(0, init(cache));
+  for (uint64_t i = 0; i < second; i++) {
+    ASSERT_EQ(std::string(BLOCK, 'a' + i % 26),
+              read(cache, (first + i) * BLOCK));
+  }
+
+  m_fake_image->release(false);
+  ASSERT_EQ(0, writeback(cache));
+  for (uint64_t i = 0; i < first; i++) {
+    ASSERT_EQ(std::string(BLOCK, 'A' + i % 26),
+              m_fake_image->read(i * BLOCK, BLOCK));
+  }
+  for (uint64_t i = 0; i < second; i++) {
+    ASSERT_EQ(std::string(BLOCK, 'a' + i % 26),
+              m_fake_image->read((first + i) * BLOCK, BLOCK));
+  }
+  ASSERT_EQ(0, shut_down(cache));
+}
+
+} // namespace cache
+} // namespace librbd
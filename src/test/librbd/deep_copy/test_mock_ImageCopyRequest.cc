@@ -11,6 +11,7 @@
 #include "librbd/image/CloseRequest.h"
 #include "librbd/image/OpenRequest.h"
 #include "librbd/internal.h"
+#include "librbd/object_map/DiffRequest.h"
 #include "test/librados_test_stub/MockTestMemIoCtxImpl.h"
 #include "test/librbd/mock/MockImageCtx.h"
 #include "test/librbd/test_support.h"
@@ -119,6 +120,34 @@ OpenRequest<MockTestImageCtx>* OpenRequest<MockTestImageCtx>::s_instance = nullp
 
 } // namespace image
 
+namespace object_map {
+
+template <>
+struct DiffRequest<MockTestImageCtx> {
+  BitVector<2>* object_diff_state = nullptr;
+  Context* on_finish = nullptr;
+  static DiffRequest* s_instance;
+  static DiffRequest* create(MockTestImageCtx *image_ctx,
+                             uint64_t snap_id_start, uint64_t snap_id_end,
+                             BitVector<2>* object_diff_state,
+                             Context* on_finish) {
+    ceph_assert(s_instance != nullptr);
+    s_instance->object_diff_state = object_diff_state;
+    s_instance->on_finish = on_finish;
+    return s_instance;
+  }
+
+  MOCK_METHOD0(send, void());
+
+  DiffRequest() {
+    s_instance = this;
+  }
+};
+
+DiffRequest<MockTestImageCtx>* DiffRequest<MockTestImageCtx>::s_instance = nullptr;
+
+} // namespace object_map
+
 } // namespace librbd
 
 // template definitions
@@ -130,12 +159,14 @@ namespace deep_copy {
 
 using ::testing::_;
 using ::testing::InSequence;
+using ::testing::Invoke;
 using ::testing::Return;
 
 class TestMockDeepCopyImageCopyRequest : public TestMockFixture {
 public:
   typedef ImageCopyRequest<librbd::MockTestImageCtx> MockImageCopyRequest;
   typedef ObjectCopyRequest<librbd::MockTestImageCtx> MockObjectCopyRequest;
+  typedef object_map::DiffRequest<librbd::MockTestImageCtx> MockDiffRequest;
 
   librbd::ImageCtx *m_src_image_ctx;
   librbd::ImageCtx *m_dst_image_ctx;
@@ -164,6 +195,17 @@ public:
       .WillOnce(Return(size)).RetiresOnSaturation();
   }
 
+  void expect_diff_send(MockDiffRequest &mock_diff_request,
+                        const BitVector<2> &diff_state, int r) {
+    EXPECT_CALL(mock_diff_request, send())
+      .WillOnce(Invoke([this, &mock_diff_request, diff_state, r]() {
+                  if (r >= 0) {
+                    *mock_diff_request.object_diff_state = diff_state;
+                  }
+                  m_work_queue->queue(mock_diff_request.on_finish, r);
+                }));
+  }
+
   void expect_object_copy_send(MockObjectCopyRequest &mock_object_copy_request) {
     EXPECT_CALL(mock_object_copy_request, send());
   }
@@ -353,6 +395,63 @@ TEST_F(TestMockDeepCopyImageCopyRequest, OutOfOrder) {
   ASSERT_EQ(0, ctx.wait());
 }
 
+TEST_F(TestMockDeepCopyImageCopyRequest, SharedConcurrentObjects) {
+  std::string max_ops_str;
+  ASSERT_EQ(0, _rados.conf_get("rbd_concurrent_management_ops", max_ops_str));
+  ASSERT_EQ(0, _rados.conf_set("rbd_concurrent_management_ops", "10"));
+  ASSERT_EQ(0, _rados.conf_set("rbd_deep_copy_shared_concurrent_objects",
+                               "2"));
+  BOOST_SCOPE_EXIT( (max_ops_str) ) {
+    ASSERT_EQ(0, _rados.conf_set("rbd_concurrent_management_ops",
+                                 max_ops_str.c_str()));
+    ASSERT_EQ(0, _rados.conf_set("rbd_deep_copy_shared_concurrent_objects",
+                                 "0"));
+  } BOOST_SCOPE_EXIT_END;
+
+  librados::snap_t snap_id_end;
+  ASSERT_EQ(0, create_snap("copy", &snap_id_end));
+
+  uint64_t object_count = 5;
+
+  librbd::MockTestImageCtx mock_src_image_ctx(*m_src_image_ctx);
+  librbd::MockTestImageCtx mock_dst_image_ctx(*m_dst_image_ctx);
+  MockObjectCopyRequest mock_object_copy_request;
+
+  expect_get_image_size(mock_src_image_ctx,
+                        object_count * (1 << m_src_image_ctx->order));
+  expect_get_image_size(mock_src_image_ctx, 0);
+
+  EXPECT_CALL(mock_object_copy_request, send()).Times(object_count);
+
+  librbd::NoOpProgressContext no_op;
+  C_SaferCond ctx;
+  auto request = new MockImageCopyRequest(&mock_src_image_ctx,
+                                          &mock_dst_image_ctx,
+                                          0, snap_id_end, false, boost::none,
+                                          m_snap_seqs, &no_op, &ctx);
+  request->send();
+
+  ASSERT_EQ(m_snap_map, wait_for_snap_map(mock_object_copy_request));
+  Context *object_ctx0;
+  Context *object_ctx1;
+  ASSERT_TRUE(complete_object_copy(mock_object_copy_request, 0, &object_ctx0,
+                                   0));
+  ASSERT_TRUE(complete_object_copy(mock_object_copy_request, 1, &object_ctx1,
+                                   0));
+  {
+    Mutex::Locker locker(mock_object_copy_request.lock);
+    ASSERT_EQ(0U, mock_object_copy_request.object_contexts.count(2));
+  }
+
+  object_ctx0->complete(0);
+  object_ctx1->complete(0);
+  for (uint64_t i = 2; i < object_count; ++i) {
+    ASSERT_TRUE(complete_object_copy(mock_object_copy_request, i, nullptr, 0));
+  }
+
+  ASSERT_EQ(0, ctx.wait());
+}
+
 TEST_F(TestMockDeepCopyImageCopyRequest, SnapshotSubset) {
   librados::snap_t snap_id_start;
   librados::snap_t snap_id_end;
@@ -363,8 +462,15 @@ TEST_F(TestMockDeepCopyImageCopyRequest, SnapshotSubset) {
   librbd::MockTestImageCtx mock_src_image_ctx(*m_src_image_ctx);
   librbd::MockTestImageCtx mock_dst_image_ctx(*m_dst_image_ctx);
   MockObjectCopyRequest mock_object_copy_request;
+  MockDiffRequest mock_diff_request;
 
   InSequence seq;
+  if (m_src_image_ctx->test_features(RBD_FEATURE_FAST_DIFF)) {
+    BitVector<2> diff_state;
+    diff_state.resize(1);
+    diff_state[0] = object_map::DIFF_STATE_UPDATED;
+    expect_diff_send(mock_diff_request, diff_state, 0);
+  }
   expect_get_image_size(mock_src_image_ctx, 1 << m_src_image_ctx->order);
   expect_get_image_size(mock_src_image_ctx, 0);
   expect_get_image_size(mock_src_image_ctx, 0);
@@ -388,6 +494,42 @@ TEST_F(TestMockDeepCopyImageCopyRequest, SnapshotSubset) {
   ASSERT_EQ(0, ctx.wait());
 }
 
+TEST_F(TestMockDeepCopyImageCopyRequest, SnapshotSubsetFastDiff) {
+  REQUIRE_FEATURE(RBD_FEATURE_FAST_DIFF);
+
+  librados::snap_t snap_id_start;
+  librados::snap_t snap_id_end;
+  ASSERT_EQ(0, create_snap("snap1", &snap_id_start));
+  ASSERT_EQ(0, create_snap("copy", &snap_id_end));
+
+  librbd::MockTestImageCtx mock_src_image_ctx(*m_src_image_ctx);
+  librbd::MockTestImageCtx mock_dst_image_ctx(*m_dst_image_ctx);
+  MockObjectCopyRequest mock_object_copy_request;
+  MockDiffRequest mock_diff_request;
+
+  InSequence seq;
+  BitVector<2> diff_state;
+  diff_state.resize(3);
+  diff_state[1] = object_map::DIFF_STATE_UPDATED;
+  expect_diff_send(mock_diff_request, diff_state, 0);
+  expect_get_image_size(mock_src_image_ctx, 3 * (1 << m_src_image_ctx->order));
+  expect_get_image_size(mock_src_image_ctx, 0);
+  expect_get_image_size(mock_src_image_ctx, 0);
+  expect_object_copy_send(mock_object_copy_request);
+
+  librbd::NoOpProgressContext no_op;
+  C_SaferCond ctx;
+  auto request = new MockImageCopyRequest(&mock_src_image_ctx,
+                                          &mock_dst_image_ctx,
+                                          snap_id_start, snap_id_end, false,
+                                          boost::none, m_snap_seqs, &no_op,
+                                          &ctx);
+  request->send();
+
+  ASSERT_TRUE(complete_object_copy(mock_object_copy_request, 1, nullptr, 0));
+  ASSERT_EQ(0, ctx.wait());
+}
+
 TEST_F(TestMockDeepCopyImageCopyRequest, RestartPartialSync) {
   librados::snap_t snap_id_end;
   ASSERT_EQ(0, create_snap("copy", &snap_id_end));
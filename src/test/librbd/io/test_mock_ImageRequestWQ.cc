@@ -59,6 +59,7 @@ struct ImageDispatchSpec<librbd::MockTestImageCtx> {
   }
 
   MOCK_CONST_METHOD0(is_write_op, bool());
+  MOCK_CONST_METHOD0(get_image_extents, const Extents&());
   MOCK_CONST_METHOD0(start_op, void());
   MOCK_CONST_METHOD0(send, void());
   MOCK_CONST_METHOD1(fail, void(int));
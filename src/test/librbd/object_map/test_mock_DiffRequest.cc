@@ -0,0 +1,179 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "test/librbd/test_mock_fixture.h"
+#include "test/librbd/test_support.h"
+#include "test/librbd/mock/MockImageCtx.h"
+#include "test/librados_test_stub/MockTestMemIoCtxImpl.h"
+#include "common/bit_vector.hpp"
+#include "include/rbd/object_map_types.h"
+#include "include/stringify.h"
+#include "librbd/ObjectMap.h"
+#include "librbd/object_map/DiffRequest.h"
+
+// template definitions
+#include "librbd/object_map/DiffRequest.cc"
+
+namespace librbd {
+namespace object_map {
+
+using ::testing::_;
+using ::testing::DoAll;
+using ::testing::InSequence;
+using ::testing::Return;
+using ::testing::SetArgPointee;
+using ::testing::StrEq;
+using ::testing::WithArg;
+
+class TestMockObjectMapDiffRequest : public TestMockFixture {
+public:
+  typedef DiffRequest<MockImageCtx> MockDiffRequest;
+
+  static const uint64_t START_SNAP_ID = 100;
+  static const uint64_t END_SNAP_ID = 101;
+
+  void add_snap(MockImageCtx &mock_image_ctx, uint64_t snap_id,
+                uint64_t size) {
+    mock_image_ctx.snap_info.insert(
+      {snap_id, {"snap" + stringify(snap_id), cls::rbd::UserSnapshotNamespace{},
+                 size, {}, 0, 0, {}}});
+  }
+
+  void expect_get_flags(MockImageCtx &mock_image_ctx, uint64_t snap_id,
+                        uint64_t flags, int r) {
+    EXPECT_CALL(mock_image_ctx, get_flags(snap_id, _))
+      .WillOnce(DoAll(SetArgPointee<1>(flags), Return(r)));
+  }
+
+  void expect_object_map_load(MockImageCtx &mock_image_ctx, uint64_t snap_id,
+                              BitVector<2> *object_map, int r) {
+    std::string oid(ObjectMap<>::object_map_name(mock_image_ctx.id, snap_id));
+    auto &expect = EXPECT_CALL(get_mock_io_ctx(mock_image_ctx.md_ctx),
+                               exec(oid, _, StrEq("rbd"),
+                                    StrEq("object_map_load"), _, _, _));
+    if (r < 0) {
+      expect.WillOnce(Return(r));
+    } else {
+      object_map->set_crc_enabled(false);
+
+      bufferlist bl;
+      encode(*object_map, bl);
+
+      std::string str(bl.c_str(), bl.length());
+      expect.WillOnce(DoAll(WithArg<5>(CopyInBufferlist(str)), Return(0)));
+    }
+  }
+};
+
+TEST_F(TestMockObjectMapDiffRequest, Snapshots) {
+  REQUIRE_FEATURE(RBD_FEATURE_FAST_DIFF);
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockImageCtx mock_image_ctx(*ictx);
+  uint64_t object_size = 1 << ictx->order;
+  mock_image_ctx.snap_info.clear();
+  add_snap(mock_image_ctx, START_SNAP_ID, 4 * object_size);
+  add_snap(mock_image_ctx, END_SNAP_ID, 3 * object_size);
+
+  BitVector<2> start_object_map;
+  start_object_map.resize(4);
+  start_object_map[0] = OBJECT_EXISTS_CLEAN;
+  start_object_map[1] = OBJECT_EXISTS_CLEAN;
+  start_object_map[2] = OBJECT_EXISTS_CLEAN;
+  start_object_map[3] = OBJECT_EXISTS_CLEAN;
+
+  BitVector<2> end_object_map;
+  end_object_map.resize(3);
+  end_object_map[0] = OBJECT_EXISTS_CLEAN;
+  end_object_map[1] = OBJECT_EXISTS;
+  end_object_map[2] = OBJECT_NONEXISTENT;
+
+  InSequence seq;
+  expect_get_flags(mock_image_ctx, START_SNAP_ID, 0, 0);
+  expect_object_map_load(mock_image_ctx, START_SNAP_ID, &start_object_map, 0);
+  expect_get_flags(mock_image_ctx, END_SNAP_ID, 0, 0);
+  expect_object_map_load(mock_image_ctx, END_SNAP_ID, &end_object_map, 0);
+
+  BitVector<2> object_diff_state;
+  C_SaferCond ctx;
+  auto req = new MockDiffRequest(&mock_image_ctx, START_SNAP_ID, END_SNAP_ID,
+                                 &object_diff_state, &ctx);
+  req->send();
+  ASSERT_EQ(0, ctx.wait());
+
+  ASSERT_EQ(4U, object_diff_state.size());
+  ASSERT_EQ(DIFF_STATE_NONE, object_diff_state[0]);
+  ASSERT_EQ(DIFF_STATE_UPDATED, object_diff_state[1]);
+  ASSERT_EQ(DIFF_STATE_HOLE, object_diff_state[2]);
+  ASSERT_EQ(DIFF_STATE_HOLE, object_diff_state[3]);
+}
+
+TEST_F(TestMockObjectMapDiffRequest, InvalidObjectMap) {
+  REQUIRE_FEATURE(RBD_FEATURE_FAST_DIFF);
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockImageCtx mock_image_ctx(*ictx);
+  mock_image_ctx.snap_info.clear();
+  add_snap(mock_image_ctx, START_SNAP_ID, 1 << ictx->order);
+  add_snap(mock_image_ctx, END_SNAP_ID, 1 << ictx->order);
+
+  BitVector<2> start_object_map;
+  start_object_map.resize(1);
+
+  InSequence seq;
+  expect_get_flags(mock_image_ctx, START_SNAP_ID, 0, 0);
+  expect_object_map_load(mock_image_ctx, START_SNAP_ID, &start_object_map, 0);
+  expect_get_flags(mock_image_ctx, END_SNAP_ID, RBD_FLAG_FAST_DIFF_INVALID, 0);
+
+  BitVector<2> object_diff_state;
+  C_SaferCond ctx;
+  auto req = new MockDiffRequest(&mock_image_ctx, START_SNAP_ID, END_SNAP_ID,
+                                 &object_diff_state, &ctx);
+  req->send();
+  ASSERT_EQ(-EINVAL, ctx.wait());
+}
+
+TEST_F(TestMockObjectMapDiffRequest, LoadObjectMapError) {
+  REQUIRE_FEATURE(RBD_FEATURE_FAST_DIFF);
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockImageCtx mock_image_ctx(*ictx);
+  mock_image_ctx.snap_info.clear();
+  add_snap(mock_image_ctx, START_SNAP_ID, 1 << ictx->order);
+  add_snap(mock_image_ctx, END_SNAP_ID, 1 << ictx->order);
+
+  InSequence seq;
+  expect_get_flags(mock_image_ctx, START_SNAP_ID, 0, 0);
+  expect_object_map_load(mock_image_ctx, START_SNAP_ID, nullptr, -EIO);
+
+  BitVector<2> object_diff_state;
+  C_SaferCond ctx;
+  auto req = new MockDiffRequest(&mock_image_ctx, START_SNAP_ID, END_SNAP_ID,
+                                 &object_diff_state, &ctx);
+  req->send();
+  ASSERT_EQ(-EIO, ctx.wait());
+}
+
+TEST_F(TestMockObjectMapDiffRequest, StartSnapDNE) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockImageCtx mock_image_ctx(*ictx);
+  mock_image_ctx.snap_info.clear();
+
+  BitVector<2> object_diff_state;
+  C_SaferCond ctx;
+  auto req = new MockDiffRequest(&mock_image_ctx, START_SNAP_ID, CEPH_NOSNAP,
+                                 &object_diff_state, &ctx);
+  req->send();
+  ASSERT_EQ(-ENOENT, ctx.wait());
+}
+
+} // namespace object_map
+} // namespace librbd
@@ -219,10 +219,7 @@ TEST_F(TestMockObjectMap, DetainedUpdate) {
                 1, 3, 1, {}, false, &finish_update_2);
   Context *finish_update_3 = nullptr;
   expect_update(mock_image_ctx, mock_update_request, CEPH_NOSNAP,
-                2, 3, 1, {}, false, &finish_update_3);
-  Context *finish_update_4 = nullptr;
-  expect_update(mock_image_ctx, mock_update_request, CEPH_NOSNAP,
-                0, 2, 1, {}, false, &finish_update_4);
+                0, 3, 1, {}, false, &finish_update_3);
 
   MockUnlockRequest mock_unlock_request;
   expect_unlock(mock_image_ctx, mock_unlock_request, 0);
@@ -256,14 +253,12 @@ TEST_F(TestMockObjectMap, DetainedUpdate) {
   // updates 3 and 4 are blocked on update 2
   ASSERT_NE(nullptr, finish_update_2);
   ASSERT_EQ(nullptr, finish_update_3);
-  ASSERT_EQ(nullptr, finish_update_4);
   finish_update_2->complete(0);
   ASSERT_EQ(0, update_ctx2.wait());
 
+  // adjacent updates 3 and 4 are coalesced into a single update
   ASSERT_NE(nullptr, finish_update_3);
-  ASSERT_NE(nullptr, finish_update_4);
   finish_update_3->complete(0);
-  finish_update_4->complete(0);
   ASSERT_EQ(0, update_ctx3.wait());
   ASSERT_EQ(0, update_ctx4.wait());
 
@@ -0,0 +1,89 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "mds/cephfs_features.h"
+#include "mds/mdstypes.h"
+
+#include "gtest/gtest.h"
+
+// the bits the kernel client advertises past CEPHFS_FEATURE_OCTOPUS
+static const std::vector<size_t> kernel_bits = {
+  14, 15, 16, 17, 18, 19, 20, 21,
+};
+
+// the features this tree adds that the kernel client doesn't know about
+static const std::vector<size_t> own_bits = {
+  CEPHFS_FEATURE_DELEG_INO,
+  CEPHFS_FEATURE_BATCH_CAPS,
+};
+
+TEST(CephFSFeatures, Sorted)
+{
+  std::vector<size_t> all = CEPHFS_FEATURES_ALL;
+  ASSERT_TRUE(std::is_sorted(all.begin(), all.end()));
+
+  // asserts on bits that are out of order
+  feature_bitset_t features(all);
+  for (auto bit : all) {
+    ASSERT_TRUE(features.test(bit));
+  }
+}
+
+TEST(CephFSFeatures, Unique)
+{
+  std::vector<size_t> all = CEPHFS_FEATURES_ALL;
+  for (auto bit : own_bits) {
+    ASSERT_EQ(1, std::count(all.begin(), all.end(), bit));
+  }
+}
+
+TEST(CephFSFeatures, KernelClient)
+{
+  for (auto bit : own_bits) {
+    ASSERT_EQ(kernel_bits.end(),
+	      std::find(kernel_bits.begin(), kernel_bits.end(), bit));
+  }
+
+  // a kernel client advertising all of its features gets neither
+  // delegated inodes nor batches
+  std::vector<size_t> kernel = {
+    CEPHFS_FEATURE_MIMIC,
+    CEPHFS_FEATURE_REPLY_ENCODING,
+    CEPHFS_FEATURE_RECLAIM_CLIENT,
+    CEPHFS_FEATURE_LAZY_CAP_WANTED,
+    CEPHFS_FEATURE_MULTI_RECONNECT,
+    CEPHFS_FEATURE_OCTOPUS,
+  };
+  kernel.insert(kernel.end(), kernel_bits.begin(), kernel_bits.end());
+  feature_bitset_t features(kernel);
+  for (auto bit : own_bits) {
+    ASSERT_FALSE(features.test(bit));
+  }
+}
+
+TEST(CephFSFeatures, EncodeDecode)
+{
+  std::vector<size_t> all = CEPHFS_FEATURES_ALL;
+  feature_bitset_t features(all);
+  bufferlist bl;
+  encode(features, bl);
+
+  feature_bitset_t decoded;
+  auto p = bl.cbegin();
+  decode(decoded, p);
+  for (auto bit : own_bits) {
+    ASSERT_TRUE(decoded.test(bit));
+  }
+}
@@ -156,3 +156,42 @@ TEST(pgmap, dump_object_stat_sum_2)
   ASSERT_EQ(percentify(0), tbl.get(0, col++));
   ASSERT_EQ(stringify(byte_u_t(avail/pool.size)), tbl.get(0, col++));
 }
+
+TEST(pgmap, apply_incremental_pg_by_osd)
+{
+  PGMap pg_map;
+  pg_t pgid(0, 1);
+  pg_stat_t s;
+  s.state = PG_STATE_ACTIVE | PG_STATE_CLEAN;
+  s.up = s.acting = {0, 1};
+  s.up_primary = s.acting_primary = 0;
+
+  auto apply = [&pg_map, &pgid](const pg_stat_t& stat) {
+    PGMap::Incremental inc;
+    inc.version = pg_map.version + 1;
+    inc.pg_stat_updates[pgid] = stat;
+    pg_map.apply_incremental(nullptr, inc);
+  };
+
+  apply(s);
+  ASSERT_EQ(1u, pg_map.get_num_pg_by_osd(0));
+  ASSERT_EQ(1u, pg_map.get_num_pg_by_osd(1));
+  ASSERT_EQ(1, pg_map.get_num_primary_pg_by_osd(0));
+
+  // counters only: the per-osd view must not change
+  s.stats.sum.num_objects = 10;
+  apply(s);
+  ASSERT_EQ(1u, pg_map.get_num_pg_by_osd(0));
+  ASSERT_EQ(1u, pg_map.get_num_pg_by_osd(1));
+  ASSERT_EQ(10, pg_map.pg_sum.stats.sum.num_objects);
+
+  // remapped
+  s.up = s.acting = {2, 1};
+  s.up_primary = s.acting_primary = 2;
+  apply(s);
+  ASSERT_EQ(0u, pg_map.get_num_pg_by_osd(0));
+  ASSERT_EQ(1u, pg_map.get_num_pg_by_osd(1));
+  ASSERT_EQ(1u, pg_map.get_num_pg_by_osd(2));
+  ASSERT_EQ(0, pg_map.get_num_primary_pg_by_osd(0));
+  ASSERT_EQ(1, pg_map.get_num_primary_pg_by_osd(2));
+}
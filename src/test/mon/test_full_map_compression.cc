@@ -0,0 +1,107 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "mon/OSDMonitor.h"
+#include "osd/OSDMap.h"
+#include "global/global_context.h"
+
+#include "gtest/gtest.h"
+
+class FullMapCompression : public ::testing::Test {
+public:
+  bufferlist full_bl;
+  CompressorRef zlib;
+
+  void SetUp() override {
+    OSDMap osdmap;
+    uuid_d fsid;
+    fsid.generate_random();
+    osdmap.build_simple(g_ceph_context, 1, fsid, 16);
+    osdmap.encode(full_bl, CEPH_FEATURES_ALL | CEPH_FEATURE_RESERVED);
+
+    zlib = Compressor::create(g_ceph_context, "zlib");
+    ASSERT_TRUE(zlib);
+  }
+};
+
+TEST_F(FullMapCompression, RoundTrip)
+{
+  // plain maps can't be mistaken for compressed ones
+  ASSERT_NE(0xff, (uint8_t)full_bl[0]);
+
+  bufferlist bl(full_bl);
+  ASSERT_TRUE(OSDMonitor::encode_compressed_full_map(zlib.get(), bl));
+  ASSERT_EQ(0xff, (uint8_t)bl[0]);
+  ASSERT_LT(bl.length(), full_bl.length());
+
+  CompressorRef cached;
+  ASSERT_EQ(0, OSDMonitor::decode_compressed_full_map(g_ceph_context,
+						      &cached, bl));
+  ASSERT_TRUE(bl.contents_equal(full_bl));
+  ASSERT_TRUE(cached);
+  ASSERT_EQ(zlib->get_type(), cached->get_type());
+
+  OSDMap decoded;
+  decoded.decode(bl);
+  ASSERT_EQ(1u, decoded.get_epoch());
+  ASSERT_EQ(16, decoded.get_max_osd());
+}
+
+TEST_F(FullMapCompression, Plain)
+{
+  bufferlist bl(full_bl);
+  CompressorRef cached;
+  ASSERT_EQ(0, OSDMonitor::decode_compressed_full_map(g_ceph_context,
+						      &cached, bl));
+  ASSERT_TRUE(bl.contents_equal(full_bl));
+  ASSERT_FALSE(cached);
+}
+
+TEST_F(FullMapCompression, OtherAlgorithm)
+{
+  CompressorRef snappy = Compressor::create(g_ceph_context, "snappy");
+  if (!snappy) {
+    // skip the test if the plugin is not ready
+    return;
+  }
+
+  // stored with whatever the option said at the time
+  bufferlist bl(full_bl);
+  ASSERT_TRUE(OSDMonitor::encode_compressed_full_map(zlib.get(), bl));
+
+  CompressorRef cached = snappy;
+  ASSERT_EQ(0, OSDMonitor::decode_compressed_full_map(g_ceph_context,
+						      &cached, bl));
+  ASSERT_TRUE(bl.contents_equal(full_bl));
+  ASSERT_EQ(zlib->get_type(), cached->get_type());
+}
+
+TEST_F(FullMapCompression, Incompressible)
+{
+  bufferlist bl;
+  bl.append("\x01\x02\x03", 3);
+  bufferlist orig(bl);
+  ASSERT_FALSE(OSDMonitor::encode_compressed_full_map(zlib.get(), bl));
+  ASSERT_TRUE(bl.contents_equal(orig));
+}
+
+TEST_F(FullMapCompression, Corrupt)
+{
+  bufferlist bl(full_bl);
+  ASSERT_TRUE(OSDMonitor::encode_compressed_full_map(zlib.get(), bl));
+
+  bufferlist truncated;
+  truncated.substr_of(bl, 0, bl.length() / 2);
+  CompressorRef cached;
+  ASSERT_EQ(-EIO, OSDMonitor::decode_compressed_full_map(g_ceph_context,
+							 &cached, truncated));
+}
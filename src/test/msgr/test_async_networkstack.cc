@@ -274,6 +274,105 @@ TEST_P(NetworkWorkerTest, SimpleTest) {
   });
 }
 
+TEST_P(NetworkWorkerTest, CoalesceSendTest) {
+  entity_addr_t bind_addr;
+  ASSERT_TRUE(bind_addr.parse(get_addr().c_str()));
+  std::atomic_bool accepted(false);
+  std::atomic_bool *accepted_p = &accepted;
+
+  // many small fragments around one that is too large to be copied
+  bufferlist expected;
+  for (unsigned i = 0; i < 300; ++i) {
+    unsigned len = 1 + i % 31;
+    if (i == 150) {
+      len = 8192;
+    }
+    bufferptr bp(len);
+    memset(bp.c_str(), 'a' + i % 26, len);
+    expected.push_back(std::move(bp));
+  }
+  // small enough to fit the socket buffer in one send()
+  ASSERT_LT(expected.length(), 16u << 10);
+  const bufferlist *expected_p = &expected;
+
+  exec_events([this, accepted_p, bind_addr, expected_p](Worker *worker) mutable {
+    entity_addr_t cli_addr;
+    SocketOptions options;
+    ServerSocket bind_socket;
+    EventCenter *center = &worker->center;
+    ssize_t r = 0;
+    if (stack->support_local_listen_table() || worker->id == 0)
+      r = worker->listen(bind_addr, 0, options, &bind_socket);
+    ASSERT_EQ(0, r);
+
+    ConnectedSocket cli_socket, srv_socket;
+    if (worker->id == 0) {
+      r = worker->connect(bind_addr, options, &cli_socket);
+      ASSERT_EQ(0, r);
+    }
+
+    bool is_my_accept = false;
+    if (bind_socket) {
+      C_poll cb(center);
+      center->create_file_event(bind_socket.fd(), EVENT_READABLE, &cb);
+      if (cb.poll(500)) {
+        *accepted_p = true;
+        is_my_accept = true;
+      }
+      ASSERT_TRUE(*accepted_p);
+      center->delete_file_event(bind_socket.fd(), EVENT_READABLE);
+    }
+
+    if (is_my_accept) {
+      r = bind_socket.accept(&srv_socket, options, &cli_addr, worker);
+      ASSERT_EQ(0, r);
+      ASSERT_TRUE(srv_socket.fd() > 0);
+    }
+
+    if (worker->id == 0) {
+      C_poll cb(center);
+      center->create_file_event(cli_socket.fd(), EVENT_READABLE, &cb);
+      r = cli_socket.is_connected();
+      if (r == 0) {
+        ASSERT_EQ(true, cb.poll(500));
+        r = cli_socket.is_connected();
+      }
+      ASSERT_EQ(1, r);
+      center->delete_file_event(cli_socket.fd(), EVENT_READABLE);
+
+      cli_socket.set_send_policy(4096, 0);
+      bufferlist bl = *expected_p;
+      r = cli_socket.send(bl, false);
+      ASSERT_EQ((ssize_t)expected_p->length(), r);
+      ASSERT_EQ(0u, bl.length());
+    }
+
+    if (is_my_accept) {
+      C_poll cb(center);
+      center->create_file_event(srv_socket.fd(), EVENT_READABLE, &cb);
+      bufferlist got;
+      char buf[4096];
+      while (got.length() < expected_p->length()) {
+        r = srv_socket.read(buf, sizeof(buf));
+        if (r == -EAGAIN) {
+          ASSERT_TRUE(cb.poll(500));
+          cb.reset();
+          continue;
+        }
+        ASSERT_GT(r, 0);
+        got.append(buf, r);
+      }
+      ASSERT_TRUE(got.contents_equal(*expected_p));
+      center->delete_file_event(srv_socket.fd(), EVENT_READABLE);
+      bind_socket.abort_accept();
+      srv_socket.close();
+    }
+    if (worker->id == 0) {
+      cli_socket.close();
+    }
+  });
+}
+
 TEST_P(NetworkWorkerTest, ConnectFailedTest) {
   entity_addr_t bind_addr;
   ASSERT_TRUE(bind_addr.parse(get_addr().c_str()));
@@ -38,6 +38,7 @@ public:
   }
   void doOverwriteTest(uint64_t capacity, uint64_t prefill,
     uint64_t overwrite);
+  void doFragmentedReplayTest(uint64_t capacity, uint64_t ops);
 };
 
 const uint64_t _1m = 1024 * 1024;
@@ -327,7 +328,98 @@ TEST_P(AllocTest, test_alloc_bench_10_300)
   doOverwriteTest(capacity, prefill, overwrite);
 }
 
+/*
+ * Replay the same allocate/release request stream against a heavily
+ * fragmented allocator.  The stream is driven by a fixed seed so that
+ * every allocator type sees identical requests and the timings are
+ * comparable.
+ */
+void AllocTest::doFragmentedReplayTest(uint64_t capacity, uint64_t ops)
+{
+  uint64_t alloc_unit = 4096;
+  PExtentVector tmp;
+  AllocTracker at(capacity, alloc_unit);
+
+  init_alloc(capacity, alloc_unit);
+  alloc->init_add_free(0, capacity);
+
+  gen_type rng(0);
+  boost::uniform_int<> u1(0, 4); // 4K-64K
+  boost::uniform_int<> u2(0, 9); // 4K-2M
+  boost::uniform_int<> u3(0, 1);
+
+  // fill the device with small extents and punch random holes into it
+  // to get the free space fragmented into short runs
+  for (uint64_t i = 0; i < capacity; ) {
+    uint32_t want = alloc_unit << u1(rng);
+    tmp.clear();
+    auto r = alloc->allocate(want, alloc_unit, 0, 0, &tmp);
+    if (r <= 0) {
+      break;
+    }
+    i += r;
+    for (auto a : tmp) {
+      if (u3(rng)) {
+	interval_set<uint64_t> release_set;
+	release_set.insert(a.offset, a.length);
+	alloc->release(release_set);
+      } else {
+	bool full = !at.push(a.offset, a.length);
+	EXPECT_EQ(full, false);
+      }
+    }
+  }
+  std::cout << "Fragmentation after prefill: "
+	    << alloc->get_fragmentation(alloc_unit) << std::endl;
+
+  uint64_t failed = 0;
+  uint64_t extents = 0;
+  utime_t start = ceph_clock_now();
+  for (uint64_t n = 0; n < ops; ++n) {
+    uint32_t want = alloc_unit << u2(rng);
+    tmp.clear();
+    auto r = alloc->allocate(want, alloc_unit, 0, 0, &tmp);
+    if (r < (int64_t)want) {
+      ++failed;
+    }
+    extents += tmp.size();
+    for (auto a : tmp) {
+      bool full = !at.push(a.offset, a.length);
+      EXPECT_EQ(full, false);
+    }
+
+    uint64_t want_release = alloc_unit << u2(rng);
+    uint64_t released = 0;
+    do {
+      uint64_t o = 0;
+      uint32_t l = 0;
+      interval_set<uint64_t> release_set;
+      if (!at.pop_random(rng, &o, &l, want_release - released)) {
+	break;
+      }
+      release_set.insert(o, l);
+      alloc->release(release_set);
+      released += l;
+    } while (released < want_release);
+  }
+  std::cout << "Executed in " << ceph_clock_now() - start << std::endl;
+  std::cout << "Extents per allocation "
+	    << (double)extents / ops << std::endl;
+  std::cout << "Short allocations " << failed << " of " << ops << std::endl;
+  std::cout << "Fragmentation " << alloc->get_fragmentation(alloc_unit)
+	    << std::endl;
+  std::cout << "Avail " << alloc->get_free() / _1m << " MB" << std::endl;
+
+  dump_mempools();
+}
+
+TEST_P(AllocTest, test_alloc_bench_fragmented_replay)
+{
+  uint64_t capacity = uint64_t(64) * 1024 * 1024 * 1024;
+  doFragmentedReplayTest(capacity, 1000000);
+}
+
 INSTANTIATE_TEST_SUITE_P(
   Allocator,
   AllocTest,
-  ::testing::Values("stupid", "bitmap"));
+  ::testing::Values("stupid", "bitmap", "avl"));
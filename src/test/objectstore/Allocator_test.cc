@@ -326,7 +326,42 @@ TEST_P(AllocTest, test_alloc_bug_24598)
   EXPECT_EQ(0x200000u, tmp[0].length);
 }
 
+TEST_P(AllocTest, test_dump_free_extents)
+{
+  uint64_t capacity = 1024 * 1024 * 1024ull;
+  uint64_t alloc_unit = 4096;
+  init_alloc(capacity, alloc_unit);
+
+  interval_set<uint64_t> expected;
+  for (uint64_t off = 0; off < capacity; off += 3 * 1024 * 1024) {
+    alloc->init_add_free(off, 1024 * 1024);
+    expected.insert(off, 1024 * 1024);
+  }
+  PExtentVector extents;
+  EXPECT_EQ(alloc_unit * 16,
+	    (uint64_t)alloc->allocate(alloc_unit * 16, alloc_unit, 0, 0,
+				      &extents));
+  for (auto& e : extents) {
+    expected.erase(e.offset, e.length);
+  }
+
+  interval_set<uint64_t> dumped;
+  alloc->dump([&](uint64_t offset, uint64_t length) {
+      dumped.insert(offset, length);
+    });
+  EXPECT_EQ(expected, dumped);
+  EXPECT_EQ(alloc->get_free(), dumped.size());
+
+  // what was dumped restores the same free space
+  uint64_t free = alloc->get_free();
+  init_alloc(capacity, alloc_unit);
+  for (auto p = dumped.begin(); p != dumped.end(); ++p) {
+    alloc->init_add_free(p.get_start(), p.get_len());
+  }
+  EXPECT_EQ(free, alloc->get_free());
+}
+
 INSTANTIATE_TEST_SUITE_P(
   Allocator,
   AllocTest,
-  ::testing::Values("stupid", "bitmap"));
+  ::testing::Values("stupid", "bitmap", "avl"));
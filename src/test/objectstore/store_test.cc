@@ -1830,6 +1830,114 @@ TEST_P(StoreTestSpecificAUSize, BluestoreStatFSTest) {
   }
 }
 
+TEST_P(StoreTestSpecificAUSize, BluestoreInlineData) {
+  if(string(GetParam()) != "bluestore")
+    return;
+  StartDeferred(65536);
+  SetVal(g_conf(), "bluestore_inline_data_max", "4096");
+  SetVal(g_conf(), "bluestore_fsck_on_umount", "true");
+  g_conf().apply_changes(nullptr);
+  int r;
+
+  coll_t cid;
+  ghobject_t hoid(hobject_t(sobject_t("Object 1", CEPH_NOSNAP)));
+  ghobject_t hoid2(hobject_t(sobject_t("Object 2", CEPH_NOSNAP)));
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  bufferlist expected;
+  {
+    ObjectStore::Transaction t;
+    bufferlist bl;
+    bl.append("abcde");
+    t.write(cid, hoid, 0, bl.length(), bl);
+    bl.clear();
+    bl.append("xyz");
+    t.write(cid, hoid, 10, bl.length(), bl);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+    expected.append("abcde");
+    expected.append_zero(5);
+    expected.append("xyz");
+
+    // charged for the inline bytes, not for an allocation unit
+    struct store_statfs_t statfs;
+    r = store->statfs(&statfs);
+    ASSERT_EQ(r, 0);
+    ASSERT_EQ(13u, statfs.allocated);
+    ASSERT_EQ(13u, statfs.data_stored);
+  }
+  {
+    ch.reset();
+    EXPECT_EQ(store->umount(), 0);
+    EXPECT_EQ(store->mount(), 0);
+    ch = store->open_collection(cid);
+
+    bufferlist bl;
+    r = store->read(ch, hoid, 0, 100, bl);
+    ASSERT_EQ(13, r);
+    ASSERT_TRUE(bl_eq(expected, bl));
+    bl.clear();
+    r = store->read(ch, hoid, 3, 4, bl);
+    ASSERT_EQ(4, r);
+    ASSERT_EQ(0, memcmp("de\0\0", bl.c_str(), 4));
+  }
+  {
+    // a clone of an inline object and a truncate past its data
+    ObjectStore::Transaction t;
+    t.clone(cid, hoid, hoid2);
+    t.truncate(cid, hoid2, 8192);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+
+    bufferlist bl, exp2 = expected;
+    exp2.append_zero(8192 - expected.length());
+    r = store->read(ch, hoid2, 0, 8192, bl);
+    ASSERT_EQ(8192, r);
+    ASSERT_TRUE(bl_eq(exp2, bl));
+
+    struct store_statfs_t statfs;
+    r = store->statfs(&statfs);
+    ASSERT_EQ(r, 0);
+    ASSERT_EQ(26u, statfs.allocated);
+    ASSERT_EQ(26u, statfs.data_stored);
+  }
+  {
+    // growing past the limit moves the data to a blob
+    ObjectStore::Transaction t;
+    bufferlist bl;
+    bl.append(std::string(8192, 'q'));
+    t.write(cid, hoid, 4096, bl.length(), bl);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+    expected.append_zero(4096 - expected.length());
+    expected.append(bl);
+
+    bufferlist rbl;
+    r = store->read(ch, hoid, 0, expected.length(), rbl);
+    ASSERT_EQ((int)expected.length(), r);
+    ASSERT_TRUE(bl_eq(expected, rbl));
+
+    struct store_statfs_t statfs;
+    r = store->statfs(&statfs);
+    ASSERT_EQ(r, 0);
+    ASSERT_EQ(0x10000u + 13u, statfs.allocated);
+    ASSERT_EQ(13u + 8192u + 13u, statfs.data_stored);
+  }
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    t.remove(cid, hoid2);
+    t.remove_collection(cid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
 TEST_P(StoreTestSpecificAUSize, BluestoreFragmentedBlobTest) {
   if(string(GetParam()) != "bluestore")
     return;
@@ -4610,6 +4718,82 @@ TEST_P(StoreTestSpecificAUSize, BlueFSExtenderTest) {
   bstore->mount();
 }
 
+TEST_P(StoreTestSpecificAUSize, BluestoreAllocSnapshot) {
+  if(string(GetParam()) != "bluestore")
+    return;
+
+  SetVal(g_conf(), "bluestore_alloc_snapshot", "true");
+  // keep bluefs from gifting or reclaiming space between the checks
+  SetVal(g_conf(), "bluestore_bluefs_balance_interval", "100000");
+  g_conf().apply_changes(nullptr);
+
+  StartDeferred(65536);
+
+  int r;
+  coll_t cid;
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  // leave holes between the objects so there is more than one extent
+  for (unsigned i = 0; i < 16; ++i) {
+    ObjectStore::Transaction t;
+    bufferlist bl;
+    bl.append(std::string(256 * 1024, 'a' + i));
+    ghobject_t hoid(hobject_t(sobject_t("Object " + stringify(i),
+					CEPH_NOSNAP)));
+    t.write(cid, hoid, 0, bl.length(), bl);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+    if (i % 2) {
+      ObjectStore::Transaction t;
+      ghobject_t prev(hobject_t(sobject_t("Object " + stringify(i - 1),
+					  CEPH_NOSNAP)));
+      t.remove(cid, prev);
+      r = queue_transaction(store, ch, std::move(t));
+      ASSERT_EQ(r, 0);
+    }
+  }
+  ch.reset();
+
+  struct store_statfs_t before;
+  ASSERT_EQ(0, store->statfs(&before));
+
+  // saved on umount, loaded on mount
+  ASSERT_EQ(0, store->umount());
+  ASSERT_EQ(0, store->mount());
+  {
+    struct store_statfs_t statfs;
+    ASSERT_EQ(0, store->statfs(&statfs));
+    ASSERT_EQ(before.available, statfs.available);
+    ASSERT_EQ(before.allocated, statfs.allocated);
+  }
+
+  // and again, from a snapshot of a store that was loaded from one
+  ASSERT_EQ(0, store->umount());
+  ASSERT_EQ(0, store->mount());
+  {
+    struct store_statfs_t statfs;
+    ASSERT_EQ(0, store->statfs(&statfs));
+    ASSERT_EQ(before.available, statfs.available);
+  }
+
+  // the freelist agrees
+  ASSERT_EQ(0, store->umount());
+  SetVal(g_conf(), "bluestore_alloc_snapshot", "false");
+  g_conf().apply_changes(nullptr);
+  ASSERT_EQ(0, store->fsck(false));
+  ASSERT_EQ(0, store->mount());
+  {
+    struct store_statfs_t statfs;
+    ASSERT_EQ(0, store->statfs(&statfs));
+    ASSERT_EQ(before.available, statfs.available);
+  }
+}
+
 #if defined(WITH_BLUESTORE)
 TEST_P(StoreTestSpecificAUSize, SyntheticMatrixSharding) {
   if (string(GetParam()) != "bluestore")
@@ -5284,6 +5468,70 @@ TEST_P(StoreTest, OMapIterator) {
   }
 }
 
+TEST_P(StoreTest, OMapIteratorBatch) {
+  coll_t cid;
+  ghobject_t hoid(hobject_t("tesomap", "", CEPH_NOSNAP, 0, 0, ""));
+  ghobject_t hoid2(hobject_t("tesomap2", "", CEPH_NOSNAP, 0, 0, ""));
+  auto ch = store->create_new_collection(cid);
+  int r;
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    t.touch(cid, hoid);
+    t.touch(cid, hoid2);
+    map<string, bufferlist> to_add;
+    for (int i = 0; i < 100; i++) {
+      char buf[16];
+      snprintf(buf, sizeof(buf), "key-%03d", i);
+      to_add[buf].append(stringify(i));
+    }
+    t.omap_setkeys(cid, hoid, to_add);
+    // a neighbour whose keys must not leak into the batch
+    t.omap_setkeys(cid, hoid2, to_add);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  {
+    ObjectMap::ObjectMapIterator iter = store->get_omap_iterator(ch, hoid);
+    iter->seek_to_first();
+    int n = 0;
+    while (iter->valid()) {
+      kv_batch_t batch;
+      ASSERT_EQ(0, iter->next_batch(string(), 30, 1 << 20, &batch));
+      ASSERT_LE(batch.size(), 30u);
+      ASSERT_FALSE(batch.empty());
+      for (size_t i = 0; i < batch.size(); ++i, ++n) {
+	char buf[16];
+	snprintf(buf, sizeof(buf), "key-%03d", n);
+	ASSERT_EQ(string(buf), string(batch.key(i)));
+	ASSERT_EQ(stringify(n), string(batch.value(i)));
+	ASSERT_EQ(stringify(n).size(), batch.value_ptr(i).length());
+      }
+    }
+    ASSERT_EQ(100, n);
+  }
+  {
+    // stop before an end key
+    ObjectMap::ObjectMapIterator iter = store->get_omap_iterator(ch, hoid);
+    iter->lower_bound("key-010");
+    kv_batch_t batch;
+    ASSERT_EQ(0, iter->next_batch("key-020", 1000, 1 << 20, &batch));
+    ASSERT_EQ(10u, batch.size());
+    ASSERT_EQ("key-010", string(batch.key(0)));
+    ASSERT_EQ("key-019", string(batch.key(9)));
+    ASSERT_TRUE(iter->valid());
+    ASSERT_EQ("key-020", iter->key());
+  }
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    t.remove(cid, hoid2);
+    t.remove_collection(cid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
 TEST_P(StoreTest, XattrTest) {
   coll_t cid;
   ghobject_t hoid(hobject_t("tesomap", "", CEPH_NOSNAP, 0, 0, ""));
@@ -6573,6 +6821,167 @@ TEST_P(StoreTestSpecificAUSize, BlobReuseOnOverwrite) {
   }
 }
 
+TEST_P(StoreTestSpecificAUSize, DecompressedBlobCache) {
+
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  size_t block_size = 4096;
+  StartDeferred(block_size);
+  SetVal(g_conf(), "bluestore_compression_mode", "force");
+  SetVal(g_conf(), "bluestore_max_blob_size", "65536");
+  g_conf().apply_changes(nullptr);
+
+  int r;
+  coll_t cid;
+  ghobject_t hoid(hobject_t("test_decompressed", "", CEPH_NOSNAP, 0, -1, ""));
+
+  const PerfCounters* logger = store->get_perf_counters();
+
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  {
+    ObjectStore::Transaction t;
+    bufferlist bl;
+
+    bl.append(std::string(block_size * 16, 'a'));
+    t.write(cid, hoid, 0, bl.length(), bl);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  // let the mempool thread size the cache
+  sleep(1);
+  uint64_t hits = logger->get(l_bluestore_decompressed_cache_hits);
+  {
+    bufferlist bl, expected;
+    r = store->read(ch, hoid, 0, block_size, bl,
+		    CEPH_OSD_OP_FLAG_FADVISE_WILLNEED);
+    ASSERT_EQ(r, (int)block_size);
+    expected.append(string(block_size, 'a'));
+    ASSERT_TRUE(bl_eq(expected, bl));
+  }
+  {
+    bufferlist bl, expected;
+    r = store->read(ch, hoid, block_size * 8, block_size * 2, bl);
+    ASSERT_EQ(r, (int)block_size * 2);
+    expected.append(string(block_size * 2, 'a'));
+    ASSERT_TRUE(bl_eq(expected, bl));
+  }
+  ASSERT_EQ(logger->get(l_bluestore_decompressed_cache_hits), hits + 1);
+  {
+    // replacing the blob releases its space and drops the cached copy
+    ObjectStore::Transaction t;
+    bufferlist bl;
+
+    bl.append(std::string(block_size * 16, 'b'));
+    t.write(cid, hoid, 0, bl.length(), bl);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  {
+    bufferlist bl, expected;
+    r = store->read(ch, hoid, block_size * 8, block_size * 2, bl);
+    ASSERT_EQ(r, (int)block_size * 2);
+    expected.append(string(block_size * 2, 'b'));
+    ASSERT_TRUE(bl_eq(expected, bl));
+  }
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    t.remove_collection(cid);
+    cerr << "Cleaning" << std::endl;
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
+TEST_P(StoreTestSpecificAUSize, DataDigest) {
+
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  size_t block_size = 4096;
+  StartDeferred(block_size);
+  SetVal(g_conf(), "bluestore_compression_mode", "none");
+  SetVal(g_conf(), "bluestore_csum_type", "crc32c");
+  g_conf().apply_changes(nullptr);
+
+  int r;
+  coll_t cid;
+  ghobject_t hoid(hobject_t("test_digest", "", CEPH_NOSNAP, 0, -1, ""));
+  ghobject_t hoid2(hobject_t("test_digest_tail", "", CEPH_NOSNAP, 0, -1, ""));
+
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  {
+    // data, a hole, more data
+    ObjectStore::Transaction t;
+    bufferlist bl, bl2, bl3;
+    for (unsigned i = 0; i < block_size * 16; ++i) {
+      bl.append((char)(i * 7));
+    }
+    t.write(cid, hoid, 0, bl.length(), bl);
+    bl2.append(std::string(block_size * 4, 'q'));
+    t.write(cid, hoid, block_size * 32, bl2.length(), bl2);
+    bl3.append(std::string(block_size + 100, 'z'));
+    t.write(cid, hoid2, 0, bl3.length(), bl3);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  {
+    bufferlist bl;
+    r = store->read(ch, hoid, 0, block_size * 36, bl);
+    ASSERT_EQ(r, (int)block_size * 36);
+    uint32_t crc = -1;
+    r = store->data_digest(ch, hoid, 0, block_size * 36, &crc);
+    ASSERT_EQ(r, (int)block_size * 36);
+    ASSERT_EQ(bl.crc32c(-1), crc);
+
+    // continuing from a previous stride, and clamped at the end
+    uint32_t expected = bl.crc32c(-1);
+    crc = -1;
+    r = store->data_digest(ch, hoid, 0, block_size * 20, &crc);
+    ASSERT_EQ(r, (int)block_size * 20);
+    r = store->data_digest(ch, hoid, block_size * 20, block_size * 20, &crc);
+    ASSERT_EQ(r, (int)block_size * 16);
+    ASSERT_EQ(expected, crc);
+
+    r = store->data_digest(ch, hoid, block_size * 36, block_size, &crc);
+    ASSERT_EQ(r, 0);
+  }
+  {
+    // the tail's csum chunk covers padding
+    uint32_t crc = -1;
+    r = store->data_digest(ch, hoid2, 0, block_size * 2, &crc);
+    ASSERT_EQ(r, -EOPNOTSUPP);
+    crc = -1;
+    r = store->data_digest(ch, hoid2, 0, block_size, &crc);
+    ASSERT_EQ(r, (int)block_size);
+    bufferlist expected;
+    expected.append(std::string(block_size, 'z'));
+    ASSERT_EQ(expected.crc32c(-1), crc);
+  }
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    t.remove(cid, hoid2);
+    t.remove_collection(cid);
+    cerr << "Cleaning" << std::endl;
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
 TEST_P(StoreTestSpecificAUSize, BlobReuseOnOverwriteReverse) {
 
   if (string(GetParam()) != "bluestore")
@@ -7860,6 +8269,101 @@ TEST_P(StoreTestSpecificAUSize, ReproNoBlobMultiTest) {
   }
 }
 
+TEST_P(StoreTestSpecificAUSize, LazyExtentMapDecode) {
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  SetVal(g_conf(), "bluestore_extent_map_shard_max_size", "200");
+  SetVal(g_conf(), "bluestore_extent_map_shard_target_size", "100");
+  SetVal(g_conf(), "bluestore_extent_map_shard_min_size", "50");
+  SetVal(g_conf(), "bluestore_extent_map_lazy_decode", "true");
+  g_conf().apply_changes(nullptr);
+
+  StartDeferred(4096);
+
+  int r;
+  coll_t cid;
+  ghobject_t hoid(hobject_t(sobject_t("Object 1", CEPH_NOSNAP)));
+  const uint64_t block = 4096;
+  const unsigned nblocks = 512;
+  bufferlist expected;
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  // one blob per block, written out of order so nothing gets merged
+  for (unsigned stride = 0; stride < 2; ++stride) {
+    ObjectStore::Transaction t;
+    for (unsigned i = stride; i < nblocks; i += 2) {
+      bufferlist bl;
+      bl.append(string(block, 'a' + i % 26));
+      t.write(cid, hoid, i * block, bl.length(), bl);
+    }
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  for (unsigned i = 0; i < nblocks; ++i) {
+    expected.append(string(block, 'a' + i % 26));
+  }
+
+  auto remount = [&]() {
+    ch.reset();
+    store->umount();
+    ASSERT_EQ(store->fsck(false), 0);
+    store->mount();
+    ch = store->open_collection(cid);
+  };
+  remount();
+
+  // small reads fault lextents in one at a time
+  for (unsigned i = 0; i < nblocks; i += 37) {
+    bufferlist bl, exp;
+    r = store->read(ch, hoid, i * block + 100, block, bl);
+    ASSERT_EQ(r, (int)block);
+    exp.substr_of(expected, i * block + 100, block);
+    ASSERT_TRUE(bl_eq(exp, bl));
+  }
+  // overwrite a block inside a partially decoded shard
+  {
+    ObjectStore::Transaction t;
+    bufferlist bl;
+    bl.append(string(block, 'Z'));
+    t.write(cid, hoid, 37 * block, bl.length(), bl);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+    bufferlist tmp;
+    tmp.substr_of(expected, 0, 37 * block);
+    tmp.append(bl);
+    bufferlist tail;
+    tail.substr_of(expected, 38 * block, (nblocks - 38) * block);
+    tmp.append(tail);
+    expected.swap(tmp);
+  }
+  {
+    bufferlist bl;
+    r = store->read(ch, hoid, 0, nblocks * block, bl);
+    ASSERT_EQ(r, (int)(nblocks * block));
+    ASSERT_TRUE(bl_eq(expected, bl));
+  }
+  remount();
+  {
+    bufferlist bl;
+    r = store->read(ch, hoid, 0, nblocks * block, bl);
+    ASSERT_EQ(r, (int)(nblocks * block));
+    ASSERT_TRUE(bl_eq(expected, bl));
+  }
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    t.remove_collection(cid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
 #endif  // WITH_BLUESTORE
 
 int main(int argc, char **argv) {
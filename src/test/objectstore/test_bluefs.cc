@@ -135,6 +135,52 @@ TEST(BlueFS, small_appends) {
   rm_temp_bdev(fn);
 }
 
+TEST(BlueFS, unaligned_append_remount) {
+#if defined(HAVE_PMEM)
+  // libpmem takes any mapping for pmem with this set, so that the plain
+  // file below gets a PMEMDevice and the byte-wise write path
+  ::setenv("PMEM_IS_PMEM_FORCE", "1", 1);
+#endif
+  uint64_t size = 1048576 * 128;
+  string fn = get_temp_bdev(size);
+  BlueFS fs(g_ceph_context);
+  ASSERT_EQ(0, fs.add_block_device(BlueFS::BDEV_DB, fn, false));
+  fs.add_block_extent(BlueFS::BDEV_DB, 1048576, size - 1048576);
+  uuid_d fsid;
+  ASSERT_EQ(0, fs.mkfs(fsid));
+  ASSERT_EQ(0, fs.mount());
+
+  // appends of odd sizes, each flushed on its own, so they start and end
+  // within blocks and cross block boundaries
+  auto data = gen_buffer(1048576);
+  uint64_t written = 0;
+  {
+    BlueFS::FileWriter *h;
+    ASSERT_EQ(0, fs.mkdir("dir"));
+    ASSERT_EQ(0, fs.open_for_write("dir", "file", &h, false));
+    for (unsigned i = 1; written + i < 65536; i += 7) {
+      h->append(data.get() + written, i);
+      written += i;
+      ASSERT_EQ(0, fs.fsync(h));
+    }
+    fs.close_writer(h);
+  }
+  fs.umount();
+
+  ASSERT_EQ(0, fs.mount());
+  {
+    BlueFS::FileReader *h;
+    ASSERT_EQ(0, fs.open_for_read("dir", "file", &h));
+    bufferlist bl;
+    BlueFS::FileReaderBuffer buf(4096);
+    ASSERT_EQ((int)written, fs.read(h, &buf, 0, written, &bl, NULL));
+    ASSERT_EQ(0, memcmp(data.get(), bl.c_str(), written));
+    delete h;
+  }
+  fs.umount();
+  rm_temp_bdev(fn);
+}
+
 TEST(BlueFS, very_large_write) {
   // we'll write a ~3G file, so allocate more than that for the whole fs
   uint64_t size = 1048576 * 1024 * 8ull;
@@ -299,6 +345,61 @@ void join_all(std::vector<std::thread>& v)
 #define NUM_SINGLE_FILE_WRITERS 1
 #define NUM_MULTIPLE_FILE_WRITERS 2
 
+TEST(BlueFS, sequential_read_ahead) {
+  uint64_t size = 1048576 * 256ull;
+  string fn = get_temp_bdev(size);
+  BlueFS fs(g_ceph_context);
+
+  bool old = g_ceph_context->_conf.get_val<bool>("bluefs_buffered_io");
+  g_ceph_context->_conf.set_val("bluefs_buffered_io", "false");
+
+  ASSERT_EQ(0, fs.add_block_device(BlueFS::BDEV_DB, fn, false));
+  fs.add_block_extent(BlueFS::BDEV_DB, 1048576, size - 1048576);
+  uuid_d fsid;
+  ASSERT_EQ(0, fs.mkfs(fsid));
+  ASSERT_EQ(0, fs.mount());
+  const uint64_t file_size = 64 * 1048576ull;
+  char buf[65536];
+  {
+    BlueFS::FileWriter *h;
+    ASSERT_EQ(0, fs.mkdir("dir"));
+    ASSERT_EQ(0, fs.open_for_write("dir", "seqfile", &h, false));
+    for (uint64_t off = 0; off < file_size; off += sizeof(buf)) {
+      for (unsigned i = 0; i < sizeof(buf); ++i) {
+	buf[i] = (off + i) * 31 / 7;
+      }
+      h->append(buf, sizeof(buf));
+    }
+    fs.fsync(h);
+    fs.close_writer(h);
+  }
+  {
+    BlueFS::FileReader *h;
+    ASSERT_EQ(0, fs.open_for_read("dir", "seqfile", &h));
+    // small sequential reads, with a jump in the middle to drop the
+    // readahead window and start a new stream
+    uint64_t off = 0;
+    const size_t len = 12345;
+    while (off + len < file_size) {
+      bufferlist bl;
+      ASSERT_EQ((int)len, fs.read(h, &h->buf, off, len, &bl, NULL));
+      for (unsigned i = 0; i < len; ++i) {
+	ASSERT_EQ((char)((off + i) * 31 / 7), bl[i]);
+      }
+      off += len;
+      if (off > file_size / 3 && off < file_size / 3 + len) {
+	off = file_size / 2 + 17;
+      }
+    }
+    delete h;
+  }
+  fs.umount();
+
+  g_ceph_context->_conf.set_val("bluefs_buffered_io", stringify((int)old));
+
+  rm_temp_bdev(fn);
+}
+
 TEST(BlueFS, test_flush_1) {
   uint64_t size = 1048576 * 128;
   string fn = get_temp_bdev(size);
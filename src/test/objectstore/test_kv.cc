@@ -19,6 +19,7 @@
 #include <sys/mount.h>
 #include "kv/KeyValueDB.h"
 #include "include/Context.h"
+#include "include/stringify.h"
 #include "common/ceph_argparse.h"
 #include "global/global_init.h"
 #include "common/Mutex.h"
@@ -415,6 +416,75 @@ TEST_P(KVTest, RocksDBIteratorTest) {
   fini();
 }
 
+TEST_P(KVTest, RocksDBShardedColumnFamilyTest) {
+  if(string(GetParam()) != "rocksdb")
+    return;
+
+  std::vector<KeyValueDB::ColumnFamily> cfs;
+  cfs.push_back(KeyValueDB::ColumnFamily("cf1(4)", ""));
+  cfs.push_back(KeyValueDB::ColumnFamily("cf2(3,0-4)", ""));
+  ASSERT_EQ(0, db->init(g_conf()->bluestore_rocksdb_options));
+  cout << "creating two sharded column families and opening them" << std::endl;
+  ASSERT_EQ(0, db->create_and_open(cout, cfs));
+  {
+    KeyValueDB::Transaction t = db->get_transaction();
+    for (unsigned i = 0; i < 100; ++i) {
+      bufferlist bl;
+      bl.append(stringify(i));
+      char key[8];
+      snprintf(key, sizeof(key), "key%03u", i);
+      t->set("cf1", key, bl);
+      t->set("cf2", key, bl);
+    }
+    ASSERT_EQ(0, db->submit_transaction_sync(t));
+  }
+  fini();
+
+  init();
+  // a different sharding on reopen is ignored
+  cfs[0] = KeyValueDB::ColumnFamily("cf1(2)", "");
+  ASSERT_EQ(0, db->open(cout, cfs));
+  for (auto prefix : {"cf1", "cf2"}) {
+    cout << "iterating " << prefix << " across shards" << std::endl;
+    KeyValueDB::Iterator iter = db->get_iterator(prefix);
+    unsigned i = 0;
+    for (iter->seek_to_first(); iter->valid(); iter->next(), ++i) {
+      char key[8];
+      snprintf(key, sizeof(key), "key%03u", i);
+      ASSERT_EQ(key, iter->key());
+      ASSERT_EQ(stringify(i), _bl_to_str(iter->value()));
+    }
+    ASSERT_EQ(100u, i);
+    iter->lower_bound("key050");
+    ASSERT_TRUE(iter->valid());
+    ASSERT_EQ("key050", iter->key());
+    ASSERT_EQ(0, iter->prev());
+    ASSERT_EQ("key049", iter->key());
+    ASSERT_EQ(0, iter->next());
+    ASSERT_EQ("key050", iter->key());
+    iter->seek_to_last();
+    ASSERT_EQ("key099", iter->key());
+  }
+  {
+    bufferlist v;
+    ASSERT_EQ(0, db->get("cf1", "key042", &v));
+    ASSERT_EQ("42", _bl_to_str(v));
+  }
+  {
+    KeyValueDB::Transaction t = db->get_transaction();
+    t->rmkey("cf1", "key042");
+    t->rm_range_keys("cf2", "key010", "key090");
+    ASSERT_EQ(0, db->submit_transaction_sync(t));
+  }
+  {
+    bufferlist v1, v2, v3;
+    ASSERT_EQ(-ENOENT, db->get("cf1", "key042", &v1));
+    ASSERT_EQ(-ENOENT, db->get("cf2", "key050", &v2));
+    ASSERT_EQ(0, db->get("cf2", "key090", &v3));
+  }
+  fini();
+}
+
 TEST_P(KVTest, RocksDBCFMerge) {
   if(string(GetParam()) != "rocksdb")
     return;
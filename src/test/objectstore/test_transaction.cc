@@ -137,6 +137,57 @@ TEST(Transaction, MoveRangesDelSrcObj)
   t.write(c, o2, 1, bl.length(), bl);
 }
 
+TEST(Transaction, Append)
+{
+  coll_t c1(spg_t(pg_t(1,2), shard_id_t::NO_SHARD));
+  coll_t c2(spg_t(pg_t(3,2), shard_id_t::NO_SHARD));
+  ghobject_t o1(hobject_t("obj", "", 123, 456, -1, ""));
+  ghobject_t o2(hobject_t("obj2", "", 123, 456, -1, ""));
+
+  bufferlist bl;
+  bl.append("some data");
+
+  auto a = ObjectStore::Transaction{};
+  a.touch(c1, o1);
+  auto b = ObjectStore::Transaction{};
+  b.write(c2, o2, 0, bl.length(), bl);
+  b.clone(c2, o2, o1);
+
+  // appending to an empty transaction keeps the indexes as they are
+  auto t = ObjectStore::Transaction{};
+  t.append(a);
+  // ... appending to a non-empty one remaps them
+  t.append(b);
+  ASSERT_EQ(3, t.get_num_ops());
+  ASSERT_EQ(1, a.get_num_ops());
+  ASSERT_EQ(2, b.get_num_ops());
+
+  auto i = t.begin();
+  auto op = i.decode_op();
+  ASSERT_EQ(ObjectStore::Transaction::OP_TOUCH, op->op);
+  ASSERT_EQ(c1, i.get_cid(op->cid));
+  ASSERT_EQ(o1, i.get_oid(op->oid));
+  op = i.decode_op();
+  ASSERT_EQ(ObjectStore::Transaction::OP_WRITE, op->op);
+  ASSERT_EQ(c2, i.get_cid(op->cid));
+  ASSERT_EQ(o2, i.get_oid(op->oid));
+  bufferlist data;
+  i.decode_bl(data);
+  ASSERT_TRUE(data.contents_equal(bl));
+  op = i.decode_op();
+  ASSERT_EQ(ObjectStore::Transaction::OP_CLONE, op->op);
+  ASSERT_EQ(c2, i.get_cid(op->cid));
+  ASSERT_EQ(o2, i.get_oid(op->oid));
+  ASSERT_EQ(o1, i.get_oid(op->dest_oid));
+  ASSERT_FALSE(i.have_op());
+
+  // the appended transactions are left as they were
+  auto j = b.begin();
+  op = j.decode_op();
+  ASSERT_EQ(c2, j.get_cid(op->cid));
+  ASSERT_EQ(o2, j.get_oid(op->oid));
+}
+
 TEST(Transaction, GetNumBytes)
 {
   auto a = ObjectStore::Transaction{};
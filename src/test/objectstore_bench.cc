@@ -14,6 +14,7 @@
 
 #include "common/strtol.h"
 #include "common/ceph_argparse.h"
+#include "common/perf_counters_collection.h"
 
 #define dout_context g_ceph_context
 #define dout_subsys ceph_subsys_filestore
@@ -30,7 +31,12 @@ static void usage()
       "	 --threads\n"
       "	       number of threads to carry out this workload\n"
       "	 --multi-object\n"
-    "	       have each thread write to a separate object\n" << std::endl;
+      "	       have each thread write to a separate object\n"
+      "	 --op write|append|omap|clone\n"
+      "	       overwrite blocks (the default), append them, store them\n"
+      "	       as omap values, or clone the object before each write cycle\n"
+    "	 --stage-latency\n"
+    "	       report the time transactions spent in each store state\n" << std::endl;
   generic_server_usage();
 }
 
@@ -74,10 +80,12 @@ struct Config {
   int repeats;
   int threads;
   bool multi_object;
+  std::string op;
+  bool stage_latency;
   Config()
     : size(1048576), block_size(4096),
       repeats(1), threads(1),
-      multi_object(false) {}
+      multi_object(false), op("write"), stage_latency(false) {}
 };
 
 class C_NotifyCond : public Context {
@@ -110,23 +118,45 @@ void osbench_worker(ObjectStore *os, const Config &cfg,
   ObjectStore::CollectionHandle ch = os->open_collection(cid);
   ceph_assert(ch);
 
+  std::vector<ghobject_t> clones;
+
   for (int i = 0; i < cfg.repeats; ++i) {
     uint64_t offset = starting_offset;
     size_t len = cfg.size;
+    // appends go past what the earlier cycles wrote
+    if (cfg.op == "append")
+      offset += i * cfg.size;
 
     vector<ObjectStore::Transaction> tls;
 
     std::cout << "Write cycle " << i << std::endl;
+    if (cfg.op == "clone") {
+      // the overwrites below then have to unshare the cloned blobs
+      std::stringstream oss;
+      oss << oid.hobj.oid.name << "-clone-" << starting_offset << "-" << i;
+      clones.emplace_back(hobject_t(sobject_t(oss.str(), CEPH_NOSNAP)));
+      ObjectStore::Transaction t;
+      t.clone(cid, oid, clones.back());
+      tls.push_back(std::move(t));
+    }
     while (len) {
       size_t count = len < cfg.block_size ? len : (size_t)cfg.block_size;
 
       auto t = new ObjectStore::Transaction;
-      t->write(cid, oid, offset, count, data);
+      if (cfg.op == "omap") {
+        char key[32];
+        snprintf(key, sizeof(key), "%016llx", (unsigned long long)offset);
+        map<string, bufferlist> kv;
+        kv[key].substr_of(data, 0, count);
+        t->omap_setkeys(cid, oid, kv);
+      } else {
+        t->write(cid, oid, offset, count, data);
+      }
       tls.push_back(std::move(*t));
       delete t;
 
       offset += count;
-      if (offset > cfg.size)
+      if (offset > cfg.size && cfg.op != "append")
         offset -= cfg.size;
       len -= count;
     }
@@ -143,6 +173,35 @@ void osbench_worker(ObjectStore *os, const Config &cfg,
     cond.wait(lock, [&done](){ return done; });
     lock.unlock();
   }
+
+  if (!clones.empty()) {
+    ObjectStore::Transaction t;
+    for (const auto &clone : clones)
+      t.remove(cid, clone);
+    os->queue_transaction(ch, std::move(t));
+  }
+}
+
+// print the average time the transactions spent in each state
+static void dump_stage_latency()
+{
+  static const std::string prefix = "bluestore.state_";
+  g_ceph_context->get_perfcounters_collection()->with_counters(
+    [](const PerfCountersCollectionImpl::CounterMap &by_path) {
+      bool found = false;
+      for (auto p = by_path.lower_bound(prefix);
+           p != by_path.end() && p->first.compare(0, prefix.size(), prefix) == 0;
+           ++p) {
+        auto avg = p->second.data->read_avg();
+        double avg_us = avg.second ? (double)avg.first / avg.second / 1000 : 0;
+        dout(0) << p->first.substr(prefix.size()) << ": " << avg.second
+                << " txcs, avg " << avg_us << "us, total "
+                << avg.first / 1000 << "us" << dendl;
+        found = true;
+      }
+      if (!found)
+        dout(0) << "no per-state latency counters for this objectstore" << dendl;
+    });
 }
 
 int main(int argc, const char *argv[])
@@ -190,6 +249,14 @@ int main(int argc, const char *argv[])
       cfg.threads = atoi(val.c_str());
     } else if (ceph_argparse_flag(args, i, "--multi-object", (char*)nullptr)) {
       cfg.multi_object = true;
+    } else if (ceph_argparse_witharg(args, i, &val, "--op", (char*)nullptr)) {
+      if (val != "write" && val != "append" && val != "omap" && val != "clone") {
+        derr << "error parsing op: " << val << dendl;
+        exit(1);
+      }
+      cfg.op = val;
+    } else if (ceph_argparse_flag(args, i, "--stage-latency", (char*)nullptr)) {
+      cfg.stage_latency = true;
     } else {
       derr << "Error: can't understand argument: " << *i << "\n" << dendl;
       exit(1);
@@ -206,6 +273,7 @@ int main(int argc, const char *argv[])
   dout(0) << "block-size " << cfg.block_size << dendl;
   dout(0) << "repeats " << cfg.repeats << dendl;
   dout(0) << "threads " << cfg.threads << dendl;
+  dout(0) << "op " << cfg.op << dendl;
 
   auto os = std::unique_ptr<ObjectStore>(
       ObjectStore::create(g_ceph_context,
@@ -294,6 +362,10 @@ int main(int argc, const char *argv[])
     ceph_assert(r == 0);
   }
 
+  // only account for the transactions of the workload
+  if (cfg.stage_latency)
+    g_ceph_context->get_perfcounters_collection()->reset("all");
+
   // run the worker threads
   std::vector<std::thread> workers;
   workers.reserve(cfg.threads);
@@ -317,6 +389,8 @@ int main(int argc, const char *argv[])
   dout(0) << "Wrote " << total << " in "
       << duration.count() << "us, at a rate of " << rate << "/s and "
       << iops << " iops" << dendl;
+  if (cfg.stage_latency)
+    dump_stage_latency();
 
   // remove the objects
   ObjectStore::Transaction t;
@@ -361,6 +361,174 @@ TEST_F(OSDMapTest, PrimaryTempRespected) {
   EXPECT_EQ(acting_primary, acting_osds[1]);
 }
 
+TEST_F(OSDMapTest, ShareFromIncremental) {
+  set_up_map();
+
+  const uint64_t features =
+    CEPH_FEATURES_SUPPORTED_DEFAULT | CEPH_FEATURE_RESERVED;
+  bufferlist prev_bl;
+  osdmap.encode(prev_bl, features);
+
+  pg_t pgid = osdmap.raw_pg_to_pg(pg_t(0, my_rep_pool));
+  vector<int> up_osds, acting_osds;
+  int up_primary, acting_primary;
+  osdmap.pg_to_up_acting_osds(pgid, &up_osds, &up_primary,
+                              &acting_osds, &acting_primary);
+  vector<int> new_acting_osds(acting_osds.rbegin(), acting_osds.rend());
+  epoch_t up_thru = osdmap.get_up_thru(0);
+
+  OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+  inc.fsid = osdmap.get_fsid();
+  inc.new_pg_temp[pgid] = mempool::osdmap::vector<int>(
+    new_acting_osds.begin(), new_acting_osds.end());
+  inc.new_up_thru[0] = osdmap.get_epoch();
+
+  // the old way: decode the previous epoch and apply on top of it
+  OSDMap decoded;
+  decoded.decode(prev_bl);
+  ASSERT_EQ(0, decoded.apply_incremental(inc));
+  bufferlist decoded_bl;
+  decoded.encode(decoded_bl, features);
+
+  // sharing the previous epoch's containers encodes the same
+  OSDMap shared;
+  shared.share_from(osdmap);
+  ASSERT_EQ(0, shared.apply_incremental(inc));
+  bufferlist shared_bl;
+  shared.encode(shared_bl, features);
+  ASSERT_TRUE(decoded_bl.contents_equal(shared_bl));
+  ASSERT_EQ(decoded.get_crc(), shared.get_crc());
+
+  shared.pg_to_up_acting_osds(pgid, &up_osds, &up_primary,
+                              &acting_osds, &acting_primary);
+  EXPECT_EQ(new_acting_osds, acting_osds);
+  EXPECT_EQ(osdmap.get_epoch(), shared.get_up_thru(0));
+
+  // ...and leaves the previous epoch alone
+  osdmap.pg_to_up_acting_osds(pgid, &up_osds, &up_primary,
+                              &acting_osds, &acting_primary);
+  EXPECT_NE(new_acting_osds, acting_osds);
+  EXPECT_EQ(up_thru, osdmap.get_up_thru(0));
+  bufferlist again_bl;
+  osdmap.encode(again_bl, features);
+  EXPECT_TRUE(prev_bl.contents_equal(again_bl));
+}
+
+TEST_F(OSDMapTest, MappingIncremental) {
+  set_up_map();
+
+  // the incrementally updated mapping must match one built from scratch
+  auto check = [this]() {
+    mapping.update(osdmap);
+    OSDMapMapping full;
+    full.update(osdmap);
+    ASSERT_EQ(osdmap.get_epoch(), mapping.get_epoch());
+    for (auto& p : osdmap.get_pools()) {
+      for (unsigned ps = 0; ps < p.second.get_pg_num(); ++ps) {
+	pg_t pgid(ps, p.first);
+	vector<int> up, acting, up2, acting2;
+	int up_primary, acting_primary, up_primary2, acting_primary2;
+	full.get(pgid, &up, &up_primary, &acting, &acting_primary);
+	mapping.get(pgid, &up2, &up_primary2, &acting2, &acting_primary2);
+	ASSERT_EQ(up, up2) << pgid;
+	ASSERT_EQ(up_primary, up_primary2) << pgid;
+	ASSERT_EQ(acting, acting2) << pgid;
+	ASSERT_EQ(acting_primary, acting_primary2) << pgid;
+      }
+    }
+  };
+  check();
+  ASSERT_EQ(mapping.get_num_pgs(), mapping.get_num_remapped());
+
+  // the same map again moves nothing
+  mapping.update(osdmap);
+  ASSERT_EQ(0u, mapping.get_num_remapped());
+
+  pg_t pgid = osdmap.raw_pg_to_pg(pg_t(0, my_rep_pool));
+  vector<int> up;
+  int up_primary;
+  osdmap.pg_to_raw_up(pgid, &up, &up_primary);
+  ASSERT_FALSE(up.empty());
+
+  // an osd goes down: only the pgs it is mapped to are recomputed...
+  {
+    uint64_t with_osd = 0;
+    for (auto& p : osdmap.get_pools()) {
+      for (unsigned ps = 0; ps < p.second.get_pg_num(); ++ps) {
+	vector<int> raw;
+	int primary;
+	osdmap.pg_to_raw_up(pg_t(ps, p.first), &raw, &primary);
+	if (std::find(raw.begin(), raw.end(), up[0]) != raw.end()) {
+	  ++with_osd;
+	}
+      }
+    }
+    ASSERT_GT(with_osd, 0u);
+    ASSERT_LT(with_osd, mapping.get_num_pgs());
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[up[0]] = CEPH_OSD_UP;
+    osdmap.apply_incremental(inc);
+    ASSERT_TRUE(osdmap.is_down(up[0]));
+    check();
+    ASSERT_EQ(with_osd, mapping.get_num_remapped());
+  }
+  // ...a pg_temp points at it while down...
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_pg_temp[pgid] = mempool::osdmap::vector<int>(up.rbegin(),
+							  up.rend());
+    osdmap.apply_incremental(inc);
+    check();
+    ASSERT_EQ(1u, mapping.get_num_remapped());
+  }
+  // ...and it comes back up
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    entity_addrvec_t sample_addrs;
+    sample_addrs.v.push_back(entity_addr_t());
+    inc.new_up_client[up[0]] = sample_addrs;
+    inc.new_up_cluster[up[0]] = sample_addrs;
+    inc.new_hb_back_up[up[0]] = sample_addrs;
+    inc.new_hb_front_up[up[0]] = sample_addrs;
+    osdmap.apply_incremental(inc);
+    ASSERT_TRUE(osdmap.is_up(up[0]));
+    check();
+  }
+  // primary affinity, upmap and pg_temp removal
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_primary_affinity[up[1]] = 0;
+    inc.new_pg_temp[pgid] = mempool::osdmap::vector<int>();
+    int spare = 0;
+    while (std::find(up.begin(), up.end(), spare) != up.end()) {
+      ++spare;
+    }
+    inc.new_pg_upmap_items[pgid] =
+      mempool::osdmap::vector<pair<int32_t,int32_t>>{{up[0], spare}};
+    osdmap.apply_incremental(inc);
+    check();
+  }
+  // a weight change remaps everything
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_weight[up[2]] = CEPH_OSD_OUT;
+    osdmap.apply_incremental(inc);
+    check();
+    ASSERT_EQ(mapping.get_num_pgs(), mapping.get_num_remapped());
+  }
+  // and a pool change remaps that pool
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    pg_pool_t p = *osdmap.get_pg_pool(my_rep_pool);
+    p.set_pg_num(p.get_pg_num() * 2);
+    p.set_pgp_num(p.get_pgp_num() * 2);
+    inc.new_pools[my_rep_pool] = p;
+    osdmap.apply_incremental(inc);
+    check();
+    ASSERT_EQ(p.get_pg_num(), mapping.get_num_remapped());
+  }
+}
+
 TEST_F(OSDMapTest, CleanTemps) {
   set_up_map();
 
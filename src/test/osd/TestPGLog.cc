@@ -24,6 +24,7 @@
 #include "gtest/gtest.h"
 #include "osd/PGLog.h"
 #include "osd/OSDMap.h"
+#include "messages/MOSDRepOp.h"
 #include "include/coredumpctl.h"
 #include "../objectstore/store_test_fixture.h"
 
@@ -2291,6 +2292,28 @@ TEST_F(PGLogTest, split_into_preserves_may_include_deletes) {
   }
 }
 
+TEST_F(PGLogTest, split_into_only_clears_moved_entries) {
+  clear();
+
+  for (unsigned i = 1; i <= 4; ++i) {
+    log.add(mk_ple_mod(mk_obj(i), mk_evt(10, i), mk_evt(10, i - 1)));
+  }
+  undirty();
+
+  PGLog child_log(cct);
+  split_into(pg_t(1, 1), 1, &child_log);
+
+  ASSERT_EQ(2u, log.log.size());
+  ASSERT_EQ(2u, child_log.get_log().log.size());
+  for (auto& e : child_log.get_log().log) {
+    ASSERT_EQ(1u, e.soid.get_hash() & 1);
+  }
+  // the parent keeps its remaining keys and dups as they are
+  ASSERT_EQ(eversion_t(), dirty_to);
+  ASSERT_EQ(eversion_t(), dirty_to_dups);
+  ASSERT_EQ((set<eversion_t>{mk_evt(10, 1), mk_evt(10, 3)}), trimmed);
+}
+
 class PGLogTestRebuildMissing : public PGLogTest, public StoreTestFixture {
 public:
   PGLogTestRebuildMissing() : PGLogTest(), StoreTestFixture("memstore") {}
@@ -2672,6 +2695,99 @@ TEST_F(PGLogMergeDupsTest, Superset) {
 }
 
 
+class PGLogTrimOnDiskTest : protected PGLog, public PGLogTestBase,
+			    public StoreTestFixture {
+public:
+  PGLogTrimOnDiskTest() : PGLog(g_ceph_context), StoreTestFixture("memstore") {}
+
+  void SetUp() override {
+    StoreTestFixture::SetUp();
+    ObjectStore::Transaction t;
+    test_coll = coll_t(spg_t(pg_t(1, 1)));
+    ch = store->create_new_collection(test_coll);
+    t.create_collection(test_coll, 0);
+    store->queue_transaction(ch, std::move(t));
+    log_oid = ghobject_t(hobject_t(sobject_t("log", CEPH_NOSNAP)));
+  }
+
+  void TearDown() override {
+    clear();
+    StoreTestFixture::TearDown();
+  }
+
+  void write() {
+    ObjectStore::Transaction t;
+    map<string, bufferlist> km;
+    write_log_and_missing(t, &km, test_coll, log_oid, false);
+    if (!km.empty()) {
+      t.omap_setkeys(test_coll, log_oid, km);
+    }
+    ASSERT_EQ(0, store->queue_transaction(ch, std::move(t)));
+  }
+
+  void check_roundtrip() {
+    list<pg_log_entry_t> orig = log.log;
+    pg_info_t info;
+    info.log_tail = log.tail;
+    clear();
+    ostringstream err;
+    read_log_and_missing(store.get(), ch, log_oid, info, err, false);
+    ASSERT_EQ(orig.size(), log.log.size());
+    auto i = log.log.begin();
+    for (auto& e : orig) {
+      ASSERT_EQ(e.version, i->version);
+      ASSERT_EQ(e.soid, i->soid);
+      ++i;
+    }
+  }
+
+  coll_t test_coll;
+  ghobject_t log_oid;
+};
+
+TEST_F(PGLogTrimOnDiskTest, TrimRemovesKeys) {
+  entity_name_t client = entity_name_t::CLIENT(777);
+  pg_info_t info;
+  for (unsigned v = 1; v <= 10; ++v) {
+    pg_log_entry_t e = mk_ple_mod(mk_obj(v), mk_evt(10, v),
+				  mk_evt(10, v - 1), osd_reqid_t(client, 8, v));
+    if (v % 2) {
+      bufferlist bl;
+      e.encode(bl);
+      add(e, bl);
+    } else {
+      add(e);
+    }
+  }
+  write();
+  info.last_complete = info.last_update = log.head;
+
+  trim(mk_evt(10, 4), info);
+  write();
+  check_roundtrip();
+  ASSERT_EQ(6u, log.log.size());
+  EXPECT_EQ(mk_evt(10, 5), log.log.front().version);
+}
+
+TEST_F(PGLogTrimOnDiskTest, TrimAcrossEpochs) {
+  entity_name_t client = entity_name_t::CLIENT(777);
+  pg_info_t info;
+  eversion_t prior;
+  for (unsigned v = 1; v <= 9; ++v) {
+    eversion_t ev = mk_evt(10 + v / 3, v);
+    add(mk_ple_mod(mk_obj(v), ev, prior, osd_reqid_t(client, 8, v)));
+    prior = ev;
+  }
+  write();
+  info.last_complete = info.last_update = log.head;
+
+  trim(mk_evt(11, 5), info);
+  write();
+  check_roundtrip();
+  ASSERT_EQ(4u, log.log.size());
+  EXPECT_EQ(mk_evt(12, 6), log.log.front().version);
+}
+
 struct PGLogTrimTest :
   public ::testing::Test,
   public PGLogTestBase,
@@ -3240,6 +3356,65 @@ TEST_F(PGLogTrimTest, TestCopyAfter2) {
   EXPECT_EQ(7u, copy.dups.size()) << copy;
 }
 
+TEST_F(PGLogTrimTest, TestHasWriteSince) {
+  SetUp(20);
+  PGLog::IndexedLog log;
+  log.tail = mk_evt(9, 99);
+  log.head = mk_evt(9, 99);
+
+  entity_name_t client = entity_name_t::CLIENT(777);
+
+  log.add(mk_ple_mod(mk_obj(1), mk_evt(10, 100), mk_evt(9, 99),
+		     osd_reqid_t(client, 8, 1)));
+  log.add(mk_ple_mod(mk_obj(2), mk_evt(10, 101), mk_evt(10, 100),
+		     osd_reqid_t(client, 8, 2)));
+  log.add(mk_ple_mod(mk_obj(1), mk_evt(11, 102), mk_evt(10, 101),
+		     osd_reqid_t(client, 8, 3)));
+
+  // only the newest write to an object counts
+  EXPECT_TRUE(log.has_write_since(mk_obj(1), mk_evt(10, 101)));
+  EXPECT_FALSE(log.has_write_since(mk_obj(1), mk_evt(11, 102)));
+  EXPECT_TRUE(log.has_write_since(mk_obj(2), mk_evt(10, 100)));
+  EXPECT_FALSE(log.has_write_since(mk_obj(2), mk_evt(10, 101)));
+  // objects that are not in the log have nothing unstable
+  EXPECT_FALSE(log.has_write_since(mk_obj(3), eversion_t()));
+}
+
+TEST_F(PGLogTrimTest, TestReplicaReadOfUncommittedWrite) {
+  SetUp(20);
+  entity_name_t client = entity_name_t::CLIENT(777);
+  eversion_t committed = mk_evt(10, 100);
+  eversion_t v = mk_evt(10, 101);
+
+  // the primary sends the write at v while only committed is everywhere
+  auto m = ceph::make_message<MOSDRepOp>(
+    osd_reqid_t(client, 8, 2), pg_shard_t(0), spg_t(pg_t(1, 1)), mk_obj(1),
+    0, 10, 10, 1, v);
+  m->pg_roll_forward_to = v;
+  m->min_last_complete_ondisk = committed;
+  bufferlist bl;
+  encode_message(m.get(), CEPH_FEATURES_ALL, bl);
+  auto p = bl.cbegin();
+  auto rm = boost::static_pointer_cast<MOSDRepOp>(
+    MessageRef(decode_message(g_ceph_context, 0, p), false));
+  ASSERT_TRUE(rm);
+  rm->finish_decode();
+  EXPECT_EQ(committed, rm->min_last_complete_ondisk);
+
+  PGLog::IndexedLog log;
+  log.tail = mk_evt(9, 99);
+  log.head = mk_evt(9, 99);
+  log.add(mk_ple_mod(mk_obj(1), mk_evt(10, 100), mk_evt(9, 99),
+		     osd_reqid_t(client, 8, 1)));
+  log.add(mk_ple_mod(mk_obj(1), v, mk_evt(10, 100),
+		     osd_reqid_t(client, 8, 2)));
+
+  // a replica read of the object must go back to the primary
+  EXPECT_TRUE(log.has_write_since(mk_obj(1), rm->min_last_complete_ondisk));
+  // which the op's own roll_forward_to would not have told
+  EXPECT_FALSE(log.has_write_since(mk_obj(1), rm->pg_roll_forward_to));
+}
+
 // Local Variables:
 // compile-command: "cd ../.. ; make unittest_pglog ; ./unittest_pglog --log-to-stderr=true  --debug-osd=20 # --gtest_filter=*.* "
 // End:
@@ -122,6 +122,82 @@ TEST_F(BloomHitSetTest, RejectsNoMatch) {
   EXPECT_LT(matches, 2);
 }
 
+class BlockedBloomHitSetTest : public testing::Test, public HitSetTestStrap {
+public:
+
+  BlockedBloomHitSetTest() : HitSetTestStrap(new HitSet(new BlockedBloomHitSet)) {}
+
+  void rebuild(double fp, uint64_t target, uint64_t seed) {
+    HitSet::Params param(new BlockedBloomHitSet::Params(fp, target, seed));
+    HitSet new_set(param);
+    *hitset = new_set;
+  }
+};
+
+TEST_F(BlockedBloomHitSetTest, Params) {
+  HitSet::Params params(new BlockedBloomHitSet::Params(0.01, 100, 5));
+  bufferlist bl;
+  encode(params, bl);
+  HitSet::Params p2;
+  auto iter = bl.cbegin();
+  decode(p2, iter);
+  ASSERT_EQ(HitSet::TYPE_BLOCKED_BLOOM, p2.get_type());
+  ASSERT_TRUE(HitSet::is_bloom_type(p2.get_type()));
+  auto bp = static_cast<BloomHitSet::Params*>(p2.impl.get());
+  EXPECT_EQ(.01, bp->get_fpp());
+  EXPECT_EQ((unsigned)100, bp->target_size);
+  EXPECT_EQ((unsigned)5, bp->seed);
+}
+
+TEST_F(BlockedBloomHitSetTest, InsertsMatch) {
+  rebuild(0.1, 100, 1);
+  ASSERT_EQ(hitset->impl->get_type(), HitSet::TYPE_BLOCKED_BLOOM);
+  fill(50);
+  EXPECT_TRUE(hitset->approx_unique_insert_count() >= 40 &&
+              hitset->approx_unique_insert_count() <= 60);
+  verify_fill(50);
+  EXPECT_FALSE(hitset->is_full());
+}
+
+TEST_F(BlockedBloomHitSetTest, SealAndEncode) {
+  rebuild(0.001, 1000, 1);
+  fill(100);
+  hitset->seal();
+  verify_fill(100);
+
+  bufferlist bl;
+  encode(*hitset, bl);
+  HitSet h2;
+  auto iter = bl.cbegin();
+  decode(h2, iter);
+  ASSERT_EQ(h2.impl->get_type(), HitSet::TYPE_BLOCKED_BLOOM);
+  EXPECT_EQ(100u, h2.insert_count());
+  char buf[50];
+  for (unsigned i = 0; i < 100; ++i) {
+    sprintf(buf, "hitsettest_%u", i);
+    hobject_t obj(object_t(buf), "", 0, i, 0, "");
+    EXPECT_TRUE(h2.contains(obj));
+  }
+}
+
+TEST_F(BlockedBloomHitSetTest, RejectsNoMatch) {
+  rebuild(0.001, 100, 1);
+  fill(100);
+  verify_fill(100);
+  EXPECT_TRUE(hitset->is_full());
+
+  char buf[50];
+  int matches = 0;
+  for (int i = 100; i < 200; ++i) {
+    sprintf(buf, "hitsettest_%d", i);
+    hobject_t obj(object_t(buf), "", 0, i, 0, "");
+    if (hitset->contains(obj))
+      ++matches;
+  }
+  // we set a 1 in 1000 false positive; allow one in our 100
+  EXPECT_LT(matches, 2);
+}
+
 class ExplicitHashHitSetTest : public testing::Test, public HitSetTestStrap {
 public:
 
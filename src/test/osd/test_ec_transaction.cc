@@ -122,3 +122,48 @@ TEST(ectransaction, many_writes)
   ASSERT_EQ(0u, plan.to_read.size());
   ASSERT_EQ(1u, plan.will_write.size());
 }
+
+TEST(ectransaction, delta_chunks)
+{
+  hobject_t h;
+  ECUtil::stripe_info_t sinfo(4, 16384);
+  auto get_plan = [&](uint64_t off, uint64_t len) {
+    PGTransactionUPtr t(new PGTransaction);
+    bufferlist bl;
+    bl.append_zero(len);
+    t->write(h, off, bl.length(), bl, 0);
+    return ECTransaction::get_write_plan(
+      sinfo,
+      std::move(t),
+      [&](const hobject_t &i) {
+	ECUtil::HashInfoRef ref(new ECUtil::HashInfo(6));
+	ref->set_projected_total_logical_size(sinfo, 65536);
+	return ref;
+      },
+      &dpp);
+  };
+
+  // inside the second data chunk of the second stripe
+  {
+    auto plan = get_plan(16384 + 4096 + 10, 100);
+    ASSERT_EQ(1u, plan.to_read.size());
+    ASSERT_EQ(set<int>{1}, ECTransaction::get_delta_chunks(sinfo, plan));
+  }
+  // across the boundary between two stripes
+  {
+    auto plan = get_plan(32768 - 100, 200);
+    ASSERT_EQ(1u, plan.to_read.size());
+    ASSERT_EQ((set<int>{0, 3}), ECTransaction::get_delta_chunks(sinfo, plan));
+  }
+  // a full stripe in between needs no read
+  {
+    auto plan = get_plan(16384 - 100, 16384 + 200);
+    ASSERT_TRUE(ECTransaction::get_delta_chunks(sinfo, plan).empty());
+  }
+  // past the end of the object
+  {
+    auto plan = get_plan(65536 + 10, 100);
+    ASSERT_TRUE(plan.to_read.empty());
+    ASSERT_TRUE(ECTransaction::get_delta_chunks(sinfo, plan).empty());
+  }
+}
@@ -1888,6 +1888,61 @@ TEST_F(PITest, past_intervals_ec_lost) {
 }
 
 
+TEST(eversion_t, denc)
+{
+  static_assert(denc_traits<eversion_t>::bounded);
+  static_assert(denc_traits<pg_t>::bounded);
+  static_assert(denc_traits<shard_id_t>::bounded);
+
+  eversion_t v(123, 456789);
+  size_t len = 0;
+  denc(v, len);
+  bufferlist bl;
+  encode(v, bl);
+  // same layout as the old memcpy()ed encoding: version, then epoch
+  ASSERT_EQ(len, bl.length());
+  ASSERT_EQ(sizeof(version_t) + sizeof(epoch_t), bl.length());
+  auto p = bl.cbegin();
+  version_t version;
+  epoch_t epoch;
+  decode(version, p);
+  decode(epoch, p);
+  ASSERT_EQ(v.version, version);
+  ASSERT_EQ(v.epoch, epoch);
+}
+
+TEST(pg_t, denc_fragmented)
+{
+  // decode a run of bounded values from a list with a segment per byte
+  pg_t pgid(0x1234, 17);
+  eversion_t v(5, 6);
+  bufferlist flat;
+  encode(pgid, flat);
+  encode(v, flat);
+  encode(shard_id_t(3), flat);
+  size_t len = 0;
+  denc(pgid, len);
+  ASSERT_EQ(len + sizeof(version_t) + sizeof(epoch_t) + 1, flat.length());
+
+  bufferlist bl;
+  for (unsigned i = 0; i < flat.length(); ++i) {
+    bl.append(buffer::copy(flat.c_str() + i, 1));
+  }
+  ASSERT_EQ(flat.length(), bl.get_num_buffers());
+  auto p = bl.cbegin();
+  pg_t pgid2;
+  eversion_t v2;
+  shard_id_t shard;
+  decode(pgid2, p);
+  decode(v2, p);
+  decode(shard, p);
+  ASSERT_TRUE(p.end());
+  ASSERT_EQ(pgid, pgid2);
+  ASSERT_EQ(v, v2);
+  ASSERT_EQ(shard_id_t(3), shard);
+}
+
+
 /*
  * Local Variables:
  * compile-command: "cd ../.. ;
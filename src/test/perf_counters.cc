@@ -223,7 +223,8 @@ static std::shared_ptr<PerfCounters> setup_test_perfcounter3(CephContext* cct) {
   return p;
 }
 
-static void counters_inc_test(std::shared_ptr<PerfCounters> fake_pf) {
+static void counters_inc_test_n(std::shared_ptr<PerfCounters> fake_pf,
+				int idx) {
   int i = 100000;
   utime_t t;
 
@@ -231,20 +232,29 @@ static void counters_inc_test(std::shared_ptr<PerfCounters> fake_pf) {
   t.set_from_double(0.000000001);
   while (i--) {
     // increase by one, make sure data.u64 equal to data.avgcount
-    fake_pf->tinc(TEST_PERFCOUNTERS3_ELEMENT_READ, t);
+    fake_pf->tinc(idx, t);
   }
 }
 
-static void counters_readavg_test(std::shared_ptr<PerfCounters> fake_pf) {
+static void counters_inc_test(std::shared_ptr<PerfCounters> fake_pf) {
+  counters_inc_test_n(fake_pf, TEST_PERFCOUNTERS3_ELEMENT_READ);
+}
+
+static void counters_readavg_test_n(std::shared_ptr<PerfCounters> fake_pf,
+				    int idx) {
   int i = 100000;
 
   while (i--) {
-    std::pair<uint64_t, uint64_t> dat = fake_pf->get_tavg_ns(TEST_PERFCOUNTERS3_ELEMENT_READ);
+    std::pair<uint64_t, uint64_t> dat = fake_pf->get_tavg_ns(idx);
     // sum and count should be identical as we increment TEST_PERCOUNTERS_ELEMENT_READ by 1 nsec eveytime
     ASSERT_EQ(dat.first, dat.second);
   }
 }
 
+static void counters_readavg_test(std::shared_ptr<PerfCounters> fake_pf) {
+  counters_readavg_test_n(fake_pf, TEST_PERFCOUNTERS3_ELEMENT_READ);
+}
+
 TEST(PerfCounters, read_avg) {
   std::shared_ptr<PerfCounters> fake_pf = setup_test_perfcounter3(g_ceph_context);
 
@@ -252,4 +262,101 @@ TEST(PerfCounters, read_avg) {
   std::thread t2(counters_readavg_test, fake_pf);
   t2.join();
   t1.join();
-}
\ No newline at end of file
+}
+
+enum {
+  TEST_PERFCOUNTERS4_ELEMENT_FIRST = 500,
+  TEST_PERFCOUNTERS4_ELEMENT_COUNT,
+  TEST_PERFCOUNTERS4_ELEMENT_READ,
+  TEST_PERFCOUNTERS4_ELEMENT_LAST,
+};
+
+TEST(PerfCounters, sharded) {
+  PerfCountersBuilder bld(g_ceph_context, "test_perfcounter_4",
+      TEST_PERFCOUNTERS4_ELEMENT_FIRST, TEST_PERFCOUNTERS4_ELEMENT_LAST);
+  bld.set_sharded(true);
+  bld.add_u64_counter(TEST_PERFCOUNTERS4_ELEMENT_COUNT, "count");
+  bld.add_time_avg(TEST_PERFCOUNTERS4_ELEMENT_READ, "read_avg");
+  std::shared_ptr<PerfCounters> pf(bld.create_perf_counters());
+
+  constexpr int nthreads = 8;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < nthreads; i++) {
+    threads.emplace_back([pf] {
+      for (int j = 0; j < 10000; j++) {
+        pf->inc(TEST_PERFCOUNTERS4_ELEMENT_COUNT);
+      }
+      counters_inc_test_n(pf, TEST_PERFCOUNTERS4_ELEMENT_READ);
+    });
+  }
+  // each shard is read consistently, so is their sum
+  std::thread reader(counters_readavg_test_n, pf,
+		     TEST_PERFCOUNTERS4_ELEMENT_READ);
+  for (auto& t : threads) {
+    t.join();
+  }
+  reader.join();
+  ASSERT_EQ(nthreads * 10000u, pf->get(TEST_PERFCOUNTERS4_ELEMENT_COUNT));
+  auto [count, sum] = pf->get_tavg_ns(TEST_PERFCOUNTERS4_ELEMENT_READ);
+  ASSERT_EQ(nthreads * 100000u, count);
+  ASSERT_EQ(count, sum);
+
+  pf->set(TEST_PERFCOUNTERS4_ELEMENT_COUNT, 3);
+  ASSERT_EQ(3u, pf->get(TEST_PERFCOUNTERS4_ELEMENT_COUNT));
+  pf->reset();
+  ASSERT_EQ(0u, pf->get(TEST_PERFCOUNTERS4_ELEMENT_COUNT));
+}
+
+TEST(PerfCounters, BinaryDump) {
+  PerfCountersCollection coll(g_ceph_context);
+  PerfCounters* fake_pf = setup_test_perfcounters1(g_ceph_context);
+  coll.add(fake_pf);
+  fake_pf->inc(TEST_PERFCOUNTERS1_ELEMENT_1);
+  fake_pf->tset(TEST_PERFCOUNTERS1_ELEMENT_2, utime_t(0, 500000000));
+  fake_pf->tinc(TEST_PERFCOUNTERS1_ELEMENT_3, utime_t(100, 0));
+
+  bufferlist bl;
+  coll.encode_binary(bl);
+  auto p = bl.cbegin();
+  uint64_t version;
+  uint32_t n;
+  decode(version, p);
+  decode(n, p);
+  ASSERT_EQ(3u, n);
+  auto varint = [&p] {
+    uint64_t v = 0;
+    int shift = 0;
+    uint8_t b;
+    do {
+      b = *p;
+      ++p;
+      v |= uint64_t(b & 0x7f) << shift;
+      shift += 7;
+    } while (b & 0x80);
+    return v;
+  };
+  ASSERT_EQ(1u, varint());
+  ASSERT_EQ(500000000u, varint());
+  ASSERT_EQ(100000000000u, varint());
+  ASSERT_EQ(1u, varint());
+  ASSERT_TRUE(p.end());
+
+  // the layout changes with the set of counters
+  PerfCounters* other_pf = setup_test_perfcounters1(g_ceph_context);
+  coll.add(other_pf);
+  bl.clear();
+  coll.encode_binary(bl);
+  p = bl.cbegin();
+  uint64_t new_version;
+  decode(new_version, p);
+  ASSERT_NE(version, new_version);
+
+  // and only with it, so another process with the same counters agrees
+  coll.remove(other_pf);
+  delete other_pf;
+  bl.clear();
+  coll.encode_binary(bl);
+  p = bl.cbegin();
+  decode(new_version, p);
+  ASSERT_EQ(version, new_version);
+}
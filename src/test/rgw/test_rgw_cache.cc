@@ -0,0 +1,97 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "rgw/rgw_cache.h"
+
+#include <errno.h>
+#include <unistd.h>
+#include "common/ceph_context.h"
+#include "global/global_context.h"
+#include <gtest/gtest.h>
+
+static const int LEASE = 1;
+
+class ObjectCacheLeaseTest : public ::testing::Test {
+protected:
+  ObjectCache cache;
+
+  void SetUp() override {
+    g_ceph_context->_conf.set_val_or_die("rgw_cache_lease_interval",
+					 std::to_string(LEASE));
+    cache.set_ctx(g_ceph_context);
+    cache.set_enabled(true);
+  }
+  void TearDown() override {
+    g_ceph_context->_conf.set_val_or_die("rgw_cache_lease_interval", "0");
+  }
+
+  void put(const std::string& name, uint64_t epoch, const char *data) {
+    ObjectCacheInfo info;
+    info.flags = CACHE_FLAG_DATA;
+    info.epoch = epoch;
+    info.data.append(data);
+    cache.put(name, info, nullptr);
+  }
+
+  void outlive_lease() {
+    ::usleep((LEASE * 1000 + 200) * 1000);
+  }
+};
+
+TEST_F(ObjectCacheLeaseTest, Expires)
+{
+  put("obj", 5, "abc");
+  ObjectCacheInfo info;
+  ASSERT_EQ(0, cache.get("obj", info, CACHE_FLAG_DATA, nullptr));
+
+  outlive_lease();
+  // the entry is still handed out for revalidation
+  info = ObjectCacheInfo();
+  ASSERT_EQ(-ESTALE, cache.get("obj", info, CACHE_FLAG_DATA, nullptr));
+  ASSERT_EQ(5u, info.epoch);
+  ASSERT_EQ("abc", info.data.to_str());
+}
+
+TEST_F(ObjectCacheLeaseTest, RenewSameEpoch)
+{
+  put("obj", 5, "abc");
+  rgw_cache_entry_info cache_info;
+  ObjectCacheInfo info;
+  ASSERT_EQ(0, cache.get("obj", info, CACHE_FLAG_DATA, &cache_info));
+  auto gen = cache_info.gen;
+
+  outlive_lease();
+  ASSERT_EQ(-ESTALE, cache.get("obj", info, CACHE_FLAG_DATA, nullptr));
+  ASSERT_TRUE(cache.renew("obj", 5));
+  // a renewed entry is a hit again, and keeps its generation
+  ASSERT_EQ(0, cache.get("obj", info, CACHE_FLAG_DATA, &cache_info));
+  ASSERT_EQ(gen, cache_info.gen);
+  ASSERT_EQ("abc", info.data.to_str());
+}
+
+TEST_F(ObjectCacheLeaseTest, RefetchChangedEpoch)
+{
+  put("obj", 5, "abc");
+  outlive_lease();
+  ObjectCacheInfo info;
+  ASSERT_EQ(-ESTALE, cache.get("obj", info, CACHE_FLAG_DATA, nullptr));
+  // the object moved on, so the entry stays stale until it is re-read
+  ASSERT_FALSE(cache.renew("obj", 6));
+  ASSERT_EQ(-ESTALE, cache.get("obj", info, CACHE_FLAG_DATA, nullptr));
+
+  put("obj", 6, "def");
+  info = ObjectCacheInfo();
+  ASSERT_EQ(0, cache.get("obj", info, CACHE_FLAG_DATA, nullptr));
+  ASSERT_EQ(6u, info.epoch);
+  ASSERT_EQ("def", info.data.to_str());
+}
+
+TEST_F(ObjectCacheLeaseTest, LocalWriteNotRenewed)
+{
+  // local writes don't learn the new epoch, so they are always re-read
+  put("obj", 0, "abc");
+  outlive_lease();
+  ObjectCacheInfo info;
+  ASSERT_EQ(-ESTALE, cache.get("obj", info, CACHE_FLAG_DATA, nullptr));
+  ASSERT_FALSE(cache.renew("obj", 0));
+}
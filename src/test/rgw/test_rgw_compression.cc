@@ -182,3 +182,53 @@ TEST(Compress, BillionZeros)
 
   ASSERT_EQ(d_sink.get_sink().length() , size*1000);
 }
+
+TEST(Compress, RangeReadsNeededBlocks)
+{
+  CompressorRef plugin;
+  plugin = Compressor::create(g_ceph_context, Compressor::COMP_ALG_ZLIB);
+  ASSERT_NE(plugin.get(), nullptr);
+
+  constexpr size_t block_size = 64 * 1024;
+  g_ceph_context->_conf.set_val("rgw_compression_block_size",
+                                std::to_string(block_size));
+
+  constexpr size_t size = 1000000;
+  bufferlist orig;
+  for (size_t i = 0; i < size; i++) {
+    orig.append(static_cast<char>(i % 251));
+  }
+
+  ut_put_sink c_sink;
+  RGWPutObj_Compress compressor(g_ceph_context, plugin, &c_sink);
+  compressor.process(bufferlist{orig}, 0);
+  compressor.process({}, size); // flush
+
+  g_ceph_context->_conf.set_val("rgw_compression_block_size", "0");
+
+  RGWCompressionInfo cs_info;
+  cs_info.compression_type = plugin->get_type_name();
+  cs_info.orig_size = size;
+  cs_info.blocks = move(compressor.get_compression_blocks());
+  ASSERT_EQ((size + block_size - 1) / block_size, cs_info.blocks.size());
+
+  // a range within the fourth block only reads that block
+  ut_get_sink d_sink;
+  RGWGetObj_Decompress decompress(g_ceph_context, &cs_info, true, &d_sink);
+  off_t f_begin = 3 * block_size + 100;
+  off_t f_end = 3 * block_size + 199;
+  decompress.fixup_range(f_begin, f_end);
+  const auto& block = cs_info.blocks[3];
+  ASSERT_EQ(block.new_ofs, (uint64_t)f_begin);
+  ASSERT_EQ(block.new_ofs + block.len - 1, (uint64_t)f_end);
+
+  bufferlist compressed;
+  compressed.substr_of(c_sink.get_sink(), f_begin, f_end - f_begin + 1);
+  decompress.handle_data(compressed, 0, compressed.length());
+  bufferlist empty;
+  decompress.handle_data(empty, 0, 0);
+
+  bufferlist expected;
+  expected.substr_of(orig, 3 * block_size + 100, 100);
+  ASSERT_TRUE(expected.contents_equal(d_sink.get_sink()));
+}
@@ -0,0 +1,113 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "rgw/rgw_datacache.h"
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "common/ceph_context.h"
+#include "global/global_context.h"
+#include <gtest/gtest.h>
+
+class DataCacheTest : public ::testing::Test {
+protected:
+  std::string dir;
+
+  void SetUp() override {
+    char tmpl[] = "/tmp/test_rgw_datacache.XXXXXX";
+    ASSERT_TRUE(::mkdtemp(tmpl));
+    dir = tmpl;
+    g_ceph_context->_conf.set_val_or_die("rgw_datacache_path", dir);
+    g_ceph_context->_conf.set_val_or_die("rgw_datacache_size", "8192");
+  }
+  void TearDown() override {
+    // the cache leaves its files behind, init() removes them on startup
+    if (DIR *d = ::opendir(dir.c_str()); d) {
+      while (struct dirent *de = ::readdir(d)) {
+        if (de->d_name[0] != '.') {
+          ::unlink((dir + "/" + de->d_name).c_str());
+        }
+      }
+      ::closedir(d);
+    }
+    ASSERT_EQ(0, ::rmdir(dir.c_str()));
+  }
+};
+
+static bufferlist make_bl(char c, size_t len)
+{
+  bufferlist bl;
+  bl.append(std::string(len, c));
+  return bl;
+}
+
+// fills are asynchronous, so poll until they land
+static bool wait_get(RGWDataCache& cache, const rgw_raw_obj& obj,
+		     uint64_t ofs, uint64_t len, bufferlist *bl)
+{
+  for (int i = 0; i < 100; i++) {
+    if (cache.get(obj, ofs, len, bl)) {
+      return true;
+    }
+    ::usleep(10000);
+  }
+  return false;
+}
+
+TEST_F(DataCacheTest, PutGet)
+{
+  RGWDataCache cache(g_ceph_context);
+  ASSERT_EQ(0, cache.init());
+  rgw_raw_obj obj{rgw_pool{"data"}, "tail.1"};
+  bufferlist bl;
+  EXPECT_FALSE(cache.get(obj, 0, 4096, &bl));
+  cache.put(obj, 0, 4096, make_bl('a', 4096));
+  ASSERT_TRUE(wait_get(cache, obj, 0, 4096, &bl));
+  EXPECT_TRUE(bl.contents_equal(make_bl('a', 4096)));
+  // a different extent of the same object is a different entry
+  bl.clear();
+  EXPECT_FALSE(cache.get(obj, 4096, 4096, &bl));
+  cache.shutdown();
+}
+
+TEST_F(DataCacheTest, Invalidate)
+{
+  RGWDataCache cache(g_ceph_context);
+  ASSERT_EQ(0, cache.init());
+  rgw_raw_obj obj{rgw_pool{"data"}, "tail.1"};
+  rgw_raw_obj other{rgw_pool{"data"}, "tail.10"};
+  cache.put(obj, 0, 1024, make_bl('a', 1024));
+  cache.put(obj, 1024, 1024, make_bl('b', 1024));
+  cache.put(other, 0, 1024, make_bl('c', 1024));
+  bufferlist bl;
+  ASSERT_TRUE(wait_get(cache, obj, 1024, 1024, &bl));
+  ASSERT_TRUE(wait_get(cache, other, 0, 1024, &bl));
+  cache.invalidate(obj);
+  EXPECT_FALSE(cache.get(obj, 0, 1024, &bl));
+  EXPECT_FALSE(cache.get(obj, 1024, 1024, &bl));
+  // tail.10 shares a name prefix with tail.1 but is not invalidated
+  EXPECT_TRUE(cache.get(other, 0, 1024, &bl));
+  cache.invalidate(other);
+  cache.shutdown();
+}
+
+TEST_F(DataCacheTest, EvictLRU)
+{
+  RGWDataCache cache(g_ceph_context);
+  ASSERT_EQ(0, cache.init());
+  rgw_raw_obj obj{rgw_pool{"data"}, "tail.1"};
+  bufferlist bl;
+  cache.put(obj, 0, 4096, make_bl('a', 4096));
+  ASSERT_TRUE(wait_get(cache, obj, 0, 4096, &bl));
+  cache.put(obj, 4096, 4096, make_bl('b', 4096));
+  ASSERT_TRUE(wait_get(cache, obj, 4096, 4096, &bl));
+  // touch the first extent so the second is the least recently read
+  ASSERT_TRUE(cache.get(obj, 0, 4096, &bl));
+  cache.put(obj, 8192, 4096, make_bl('c', 4096));
+  ASSERT_TRUE(wait_get(cache, obj, 8192, 4096, &bl));
+  EXPECT_TRUE(cache.get(obj, 0, 4096, &bl));
+  EXPECT_FALSE(cache.get(obj, 4096, 4096, &bl));
+  cache.invalidate(obj);
+  cache.shutdown();
+}
@@ -138,6 +138,67 @@ TEST(Queue, RateLimit)
   EXPECT_EQ(0u, counters(client_id::auth)->get(queue_counters::l_cancel));
 }
 
+TEST(Queue, TenantRateLimit)
+{
+  boost::asio::io_context context;
+  AsyncTenantScheduler queue(g_ceph_context, context);
+
+  const QoSInfo limited{0, 1, 1};
+  const QoSInfo unlimited{0, 1, 0};
+  const QoSInfo halved{0, 1, 2};
+  std::optional<error_code> ec1, ec2, ec3, ec4;
+  std::optional<PhaseType> p1, p2, p3, p4;
+
+  auto now = get_time();
+  queue.async_request("a", limited, client_id::data, now, 1, capture(ec1, p1));
+  queue.async_request("a", limited, client_id::data, now, 1, capture(ec2, p2));
+  queue.async_request("b", unlimited, client_id::data, now, 1, capture(ec3, p3));
+  queue.async_request("b", unlimited, client_id::data, now, 1, capture(ec4, p4));
+
+  context.poll();
+  EXPECT_TRUE(context.stopped());
+
+  ASSERT_TRUE(ec1);
+  EXPECT_EQ(boost::system::errc::success, *ec1);
+  ASSERT_TRUE(ec2);
+  EXPECT_EQ(boost::system::errc::resource_unavailable_try_again, *ec2);
+  ASSERT_TRUE(ec3);
+  EXPECT_EQ(boost::system::errc::success, *ec3);
+  ASSERT_TRUE(ec4);
+  EXPECT_EQ(boost::system::errc::success, *ec4);
+
+  auto rates = queue.collect_rates();
+  ASSERT_EQ(2u, rates.size());
+  EXPECT_LT(0, rates["a"]);
+  EXPECT_LT(0, rates["b"]);
+
+  // another gateway serves half of d's requests, leaving it 1 request/s here
+  std::optional<error_code> ec5, ec6, ec7, ec8;
+  std::optional<PhaseType> p5, p6, p7, p8;
+  queue.async_request("c", halved, client_id::data, now, 1, capture(ec5, p5));
+  queue.async_request("d", halved, client_id::data, now, 1, capture(ec7, p7));
+  queue.set_shares({{"d", 0.5}});
+  queue.async_request("c", halved, client_id::data, now + 0.6, 1, capture(ec6, p6));
+  queue.async_request("d", halved, client_id::data, now + 0.6, 1, capture(ec8, p8));
+
+  // waits for the second request of c to be within its limit
+  context.restart();
+  context.run();
+
+  ASSERT_TRUE(ec5);
+  EXPECT_EQ(boost::system::errc::success, *ec5);
+  ASSERT_TRUE(ec6);
+  EXPECT_EQ(boost::system::errc::success, *ec6);
+  ASSERT_TRUE(ec7);
+  EXPECT_EQ(boost::system::errc::success, *ec7);
+  ASSERT_TRUE(ec8);
+  EXPECT_EQ(boost::system::errc::resource_unavailable_try_again, *ec8);
+
+  for (int i = 0; i < 6; i++) {
+    queue.request_complete();
+  }
+}
+
 TEST(Queue, AsyncRequest)
 {
   boost::asio::io_context context;
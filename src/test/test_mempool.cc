@@ -301,6 +301,31 @@ TEST(mempool, dump)
     std::string::npos);
 }
 
+TEST(mempool, sample_sites)
+{
+  auto dump_sites = [] {
+    ostringstream ostr;
+    std::unique_ptr<Formatter> f(Formatter::create("json"));
+    f->open_object_section("sites");
+    mempool::dump_sites(f.get());
+    f->close_section();
+    f->flush(ostr);
+    return ostr.str();
+  };
+  // every allocation is sampled
+  mempool::set_sample_rate(1);
+  {
+    mempool::unittest_2::vector<char> v;
+    v.reserve(123456);
+    auto sites = dump_sites();
+    EXPECT_NE(sites.find("\"pool\":\"unittest_2\""), std::string::npos);
+    EXPECT_NE(sites.find("\"live_sampled_bytes\":123456"), std::string::npos);
+  }
+  // freed samples are no longer reported
+  EXPECT_EQ(dump_sites().find("unittest_2"), std::string::npos);
+  mempool::set_sample_rate(0);
+}
+
 TEST(mempool, unordered_map)
 {
   mempool::osdmap::unordered_map<int,obj> h;
@@ -2,6 +2,8 @@
 // vim: ts=8 sw=2 smarttab
 #include "gtest/gtest.h"
 
+#include <thread>
+
 #include "os/memstore/PageSet.h"
 
 template <typename T>
@@ -281,3 +283,100 @@ TEST(PageSet, FreeHoles)
   pages.get_range(0, 8, range);
   ASSERT_EQ(0u, range.size());
 }
+
+TEST(PageSet, LargeOffsets)
+{
+  // pages far apart force a tall page table
+  PageSet pages(4096);
+  PageSet::page_vector range;
+  const uint64_t far = 1ull << 62;
+  for (uint64_t offset : {uint64_t(0), uint64_t(1) << 30, far, far * 3}) {
+    pages.alloc_range(offset, 4096, range);
+    ASSERT_EQ(1u, range.size());
+    ASSERT_EQ(offset, range[0]->offset);
+    range.clear();
+  }
+  ASSERT_EQ(4u, pages.size());
+
+  pages.get_range(0, far + 4096, range);
+  ASSERT_EQ(3u, range.size());
+  ASSERT_EQ(0u, range[0]->offset);
+  ASSERT_EQ(1ull << 30, range[1]->offset);
+  ASSERT_EQ(far, range[2]->offset);
+  range.clear();
+
+  // free everything past offset 1
+  pages.free_pages_after(1);
+  ASSERT_EQ(1u, pages.size());
+  pages.get_range(0, far + 4096, range);
+  ASSERT_EQ(1u, range.size());
+  ASSERT_EQ(0u, range[0]->offset);
+}
+
+TEST(PageSet, Pooled)
+{
+  PageSet pages(4096, true);
+  PageSet::page_vector range;
+  pages.alloc_range(4096, 8192, range);
+  ASSERT_EQ(2u, range.size());
+  ASSERT_TRUE(is_aligned(range[0].get()));
+  std::fill(range[0]->data, range[0]->data + 4096, 'a');
+  range.clear();
+
+  // freed buffers are reused
+  pages.free_pages_after(0);
+  ASSERT_TRUE(pages.empty());
+  pages.alloc_range(4096, 4096, range);
+  ASSERT_EQ(1u, range.size());
+  ASSERT_EQ(4096u, range[0]->offset);
+}
+
+TEST(PageSet, PooledThreads)
+{
+  // each thread fills its own pages, whichever shard they come from
+  std::vector<std::thread> writers;
+  for (int i = 0; i < 8; i++) {
+    writers.emplace_back([i] {
+        for (int n = 0; n < 100; n++) {
+          PageSet pages(4096, true);
+          PageSet::page_vector range;
+          pages.alloc_range(0, 16 * 4096, range);
+          ASSERT_EQ(16u, range.size());
+          for (auto &page : range)
+            std::fill(page->data, page->data + 4096, 'a' + i);
+          for (auto &page : range)
+            ASSERT_EQ(4096, std::count(page->data, page->data + 4096, 'a' + i));
+        }
+      });
+  }
+  for (auto &t : writers)
+    t.join();
+}
+
+TEST(PageSet, ConcurrentReads)
+{
+  // readers walk the page table while pages are allocated and freed
+  PageSet pages(1);
+  std::atomic<bool> done = {false};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&pages, &done] {
+        PageSet::page_vector range;
+        while (!done) {
+          pages.get_range(0, 256, range);
+          for (auto &page : range)
+            ASSERT_LT(page->offset, 256u);
+          range.clear();
+        }
+      });
+  }
+  PageSet::page_vector range;
+  for (int i = 0; i < 256; i++) {
+    pages.alloc_range(0, 256, range);
+    range.clear();
+    pages.free_pages_after(i);
+  }
+  done = true;
+  for (auto &t : readers)
+    t.join();
+}
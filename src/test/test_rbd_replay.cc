@@ -18,6 +18,7 @@
 #include <boost/foreach.hpp>
 #include <cstdarg>
 #include "rbd_replay/ImageNameMap.hpp"
+#include "rbd_replay/ReplayStats.hpp"
 #include "rbd_replay/ios.hpp"
 #include "rbd_replay/rbd_loc.hpp"
 
@@ -132,3 +133,28 @@ TEST(RBDReplay, rbd_loc_parse) {
   EXPECT_FALSE(m.parse("a@b/c"));
 }
 
+TEST(RBDReplay, LatencyHistogram) {
+  LatencyHistogram h;
+  EXPECT_EQ(0u, h.percentile(50));
+  for (uint64_t i = 1; i <= 1000; i++) {
+    h.add(i);
+  }
+  EXPECT_EQ(1000u, h.count());
+  EXPECT_EQ(1000u, h.max());
+  EXPECT_EQ(1000u, h.percentile(100));
+  // buckets are at most an eighth of their value wide
+  EXPECT_GE(h.percentile(50), 500u);
+  EXPECT_LE(h.percentile(50), 500u + 500u / 8);
+  EXPECT_GE(h.percentile(99), 990u);
+
+  LatencyHistogram small;
+  small.add(3);
+  small.add(5);
+  EXPECT_EQ(3u, small.percentile(50));
+  EXPECT_EQ(5u, small.percentile(99));
+
+  h.merge(small);
+  EXPECT_EQ(1002u, h.count());
+  // 1, 2 and both 3s
+  EXPECT_EQ(3u, h.percentile(0.3));
+}
@@ -18,6 +18,7 @@
 #include "include/types.h"
 #include "common/Formatter.h"
 #include "common/ceph_argparse.h"
+#include "common/ceph_time.h"
 #include "common/errno.h"
 #include "denc_registry.h"
 
@@ -49,6 +50,18 @@ void usage(ostream &out)
   out << "  count_tests         print number of generated test objects (to stdout)\n";
   out << "  select_test <n>     select generated test object as in-memory object\n";
   out << "  is_deterministic    exit w/ success if type encodes deterministically\n";
+  out << "\n";
+  out << "  bench_encode <n>    time <n> encodes of in-memory object (to stdout)\n";
+  out << "  bench_decode <n>    time <n> decodes of encoded data (to stdout)\n";
+}
+
+static void print_bench(const char *what, int n, size_t bytes,
+			ceph::timespan elapsed)
+{
+  double secs = std::max(std::chrono::duration<double>(elapsed).count(), 1e-9);
+  cout << n << " " << what << " of " << bytes << " bytes in " << secs << " s, "
+       << n / secs << " ops/s, "
+       << (double)n * bytes / secs / MB(1) << " MB/s" << std::endl;
 }
   
 int main(int argc, const char **argv)
@@ -209,6 +222,41 @@ int main(int argc, const char **argv)
       }
       int n = atoi(*i);
       err = den->select_generated(n);
+    } else if (*i == string("bench_encode") ||
+	       *i == string("bench_decode")) {
+      if (!den) {
+	cerr << "must first select type with 'type <name>'" << std::endl;
+	exit(1);
+      }
+      bool is_encode = *i == string("bench_encode");
+      ++i;
+      if (i == args.end()) {
+	cerr << "expecting iteration count" << std::endl;
+	exit(1);
+      }
+      int n = atoi(*i);
+      if (n <= 0) {
+	cerr << "iteration count must be positive" << std::endl;
+	exit(1);
+      }
+      size_t bytes = 0;
+      auto start = ceph::mono_clock::now();
+      if (is_encode) {
+	for (int j = 0; j < n && err.empty(); ++j) {
+	  bufferlist bl;
+	  den->encode(bl, features | CEPH_FEATURE_RESERVED);
+	  bytes = bl.length();
+	}
+      } else {
+	bytes = encbl.length() > skip ? encbl.length() - skip : 0;
+	for (int j = 0; j < n && err.empty(); ++j) {
+	  err = den->decode(encbl, skip);
+	}
+      }
+      if (err.empty()) {
+	print_bench(is_encode ? "encodes" : "decodes", n, bytes,
+		    ceph::mono_clock::now() - start);
+      }
     } else if (*i == string("is_deterministic")) {
       if (!den) {
 	cerr << "must first select type with 'type <name>'" << std::endl;
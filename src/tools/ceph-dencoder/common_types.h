@@ -30,6 +30,7 @@ TYPE(BitVector<2>)
 #include "common/bloom_filter.hpp"
 TYPE(bloom_filter)
 TYPE(compressible_bloom_filter)
+TYPE(blocked_bloom_filter)
 
 #include "common/DecayCounter.h"
 TYPE(DecayCounter)
@@ -103,6 +104,9 @@ MESSAGE(MClientCapRelease)
 #include "messages/MClientCaps.h"
 MESSAGE(MClientCaps)
 
+#include "messages/MClientCapsBatch.h"
+MESSAGE(MClientCapsBatch)
+
 #include "messages/MClientLease.h"
 MESSAGE(MClientLease)
 
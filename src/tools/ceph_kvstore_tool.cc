@@ -48,6 +48,8 @@ void usage(const char *pname)
     << "  compact-range <prefix> <start> <end>\n"
     << "  destructive-repair  (use only as last resort! may corrupt healthy data)\n"
     << "  stats\n"
+    << "  replay <trace file>  (creates the store if needed; a new rocksdb\n"
+    << "                        store uses bluestore_rocksdb_options)\n"
     << std::endl;
 }
 
@@ -99,7 +101,8 @@ int main(int argc, const char *argv[])
 
   bool need_open_db = (cmd != "destructive-repair");
   bool need_stats = (cmd == "stats");
-  StoreTool st(type, path, need_open_db, need_stats);
+  bool need_create = (cmd == "replay");
+  StoreTool st(type, path, need_open_db, need_stats, need_create);
 
   if (cmd == "destructive-repair") {
     int ret = st.destructive_repair();
@@ -347,6 +350,14 @@ int main(int argc, const char *argv[])
     st.compact_range(prefix, start, end);
   } else if (cmd == "stats") {
     st.print_stats();
+  } else if (cmd == "replay") {
+    if (argc < 5) {
+      usage(argv[0]);
+      return 1;
+    }
+    int ret = st.replay(argv[4]);
+    if (ret < 0)
+      return 1;
   } else {
     std::cerr << "Unrecognized command: " << cmd << std::endl;
     return 1;
@@ -15,8 +15,11 @@
 #include "include/compat.h"
 #include "common/errno.h"
 #include "common/ceph_argparse.h"
+#include <atomic>
 #include <fstream>
+#include <thread>
 #include "include/util.h"
+#include "include/stringify.h"
 
 #include "mds/CInode.h"
 #include "mds/InoTable.h"
@@ -36,8 +39,8 @@ void DataScan::usage()
 {
   std::cout << "Usage: \n"
     << "  cephfs-data-scan init [--force-init]\n"
-    << "  cephfs-data-scan scan_extents [--force-pool] [--worker_n N --worker_m M] <data pool name>\n"
-    << "  cephfs-data-scan scan_inodes [--force-pool] [--force-corrupt] [--worker_n N --worker_m M] <data pool name>\n"
+    << "  cephfs-data-scan scan_extents [--force-pool] [--worker_n N --worker_m M] [--threads T] [--checkpoint] <data pool name>\n"
+    << "  cephfs-data-scan scan_inodes [--force-pool] [--force-corrupt] [--worker_n N --worker_m M] [--threads T] [--checkpoint] <data pool name>\n"
     << "  cephfs-data-scan pg_files <path> <pg id> [<pg id>...]\n"
     << "  cephfs-data-scan scan_links\n"
     << "\n"
@@ -46,6 +49,9 @@ void DataScan::usage()
     << "    --force-pool: use data pool even if it is not in FSMap\n"
     << "    --worker_m: Maximum number of workers\n"
     << "    --worker_n: Worker number, range 0-(worker_m-1)\n"
+    << "    --threads: Number of objects a worker processes in parallel\n"
+    << "    --checkpoint: Record progress in the scanned pool, and resume from\n"
+    << "                  it if an earlier run of the same worker was interrupted\n"
     << "\n"
     << "  cephfs-data-scan scan_frags [--force-corrupt]\n"
     << "  cephfs-data-scan cleanup <data pool name>\n"
@@ -93,6 +99,15 @@ bool DataScan::parse_kwarg(
       return false;
     }
     return true;
+  } else if (arg == std::string("--threads")) {
+    std::string err;
+    n_threads = strict_strtoll(val.c_str(), 10, &err);
+    if (!err.empty() || n_threads == 0) {
+      std::cerr << "Invalid thread count '" << val << "'" << std::endl;
+      *r = -EINVAL;
+      return false;
+    }
+    return true;
   } else if (arg == std::string("--filter-tag")) {
     filter_tag = val;
     dout(10) << "Applying tag filter: '" << filter_tag << "'" << dendl;
@@ -128,6 +143,9 @@ bool DataScan::parse_arg(
   } else if (arg == "--force-init") {
     force_init = true;
     return true;
+  } else if (arg == "--checkpoint") {
+    checkpoint = true;
+    return true;
   } else {
     return false;
   }
@@ -153,6 +171,7 @@ int DataScan::main(const std::vector<const char*> &args)
 
   std::string const &command = args[0];
   std::string data_pool_name;
+  checkpoint_name = command;
 
   std::string pg_files_path;
   std::set<pg_t> pg_files_pgs;
@@ -582,68 +601,139 @@ int DataScan::forall_objects(
     }
   }
 
-  int r = 0;
+  std::string checkpoint_key;
+  if (checkpoint) {
+    checkpoint_key = checkpoint_name + "." + stringify(n) + "." +
+                     stringify(m);
+    bufferlist cursor_bl;
+    int r = ioctx.getxattr(CHECKPOINT_OID, checkpoint_key.c_str(), cursor_bl);
+    if (r >= 0) {
+      librados::ObjectCursor resume;
+      if (!resume.from_str(cursor_bl.to_str()) ||
+          resume < range_i || range_end < resume) {
+        derr << "Invalid checkpoint '" << checkpoint_key << "' in "
+             << CHECKPOINT_OID << dendl;
+        return -EINVAL;
+      }
+      std::cout << "Resuming " << checkpoint_key << " from checkpoint"
+                << std::endl;
+      range_i = resume;
+    } else if (r != -ENOENT && r != -ENODATA) {
+      derr << "Unexpected error loading checkpoint: " << cpp_strerror(r)
+           << dendl;
+      return r;
+    }
+  }
+
+  auto handle_object = [&](const std::string &oid) {
+    uint64_t obj_name_ino = 0;
+    uint64_t obj_name_offset = 0;
+    int r = parse_oid(oid, &obj_name_ino, &obj_name_offset);
+    if (r != 0) {
+      dout(4) << "Bad object name '" << oid << "', skipping" << dendl;
+      return;
+    }
+
+    if (untagged_only && legacy_filtering) {
+      dout(20) << "Applying filter to " << oid << dendl;
+
+      // We are only interested in 0th objects during this phase: we touched
+      // the other objects during scan_extents
+      if (obj_name_offset != 0) {
+        dout(20) << "Non-zeroth object" << dendl;
+        return;
+      }
+
+      bufferlist scrub_tag_bl;
+      r = ioctx.getxattr(oid, "scrub_tag", scrub_tag_bl);
+      if (r >= 0) {
+        std::string read_tag;
+        auto q = scrub_tag_bl.cbegin();
+        try {
+          decode(read_tag, q);
+          if (read_tag == filter_tag) {
+            dout(20) << "skipping " << oid << " because it has the filter_tag"
+                     << dendl;
+            return;
+          }
+        } catch (const buffer::error &err) {
+        }
+        dout(20) << "read non-matching tag '" << read_tag << "'" << dendl;
+      } else {
+        dout(20) << "no tag read (" << r << ")" << dendl;
+      }
+
+    } else if (untagged_only) {
+      ceph_assert(obj_name_offset == 0);
+      dout(20) << "OSD matched oid " << oid << dendl;
+    }
+
+    // the handlers log their own failures, which do not stop the scan
+    handler(oid, obj_name_ino, obj_name_offset);
+  };
+
   while(range_i < range_end) {
     std::vector<librados::ObjectItem> result;
-    int r = ioctx.object_list(range_i, range_end, 1,
+    int r = ioctx.object_list(range_i, range_end, LIST_BATCH,
                                 filter_bl, &result, &range_i);
     if (r < 0) {
       derr << "Unexpected error listing objects: " << cpp_strerror(r) << dendl;
       return r;
     }
 
-    for (const auto &i : result) {
-      const std::string &oid = i.oid;
-      uint64_t obj_name_ino = 0;
-      uint64_t obj_name_offset = 0;
-      r = parse_oid(oid, &obj_name_ino, &obj_name_offset);
-      if (r != 0) {
-        dout(4) << "Bad object name '" << oid << "', skipping" << dendl;
-        continue;
+    // The handlers only issue synchronous RADOS calls, so spread each batch
+    // over n_threads; the batch is complete before the checkpoint moves past
+    // it.
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+      for (size_t i = next++; i < result.size(); i = next++) {
+        handle_object(result[i].oid);
       }
+    };
+    std::vector<std::thread> threads;
+    for (uint32_t t = 1; t < std::min<size_t>(n_threads, result.size()); ++t) {
+      threads.emplace_back(work);
+    }
+    work();
+    for (auto &t : threads) {
+      t.join();
+    }
 
-      if (untagged_only && legacy_filtering) {
-        dout(20) << "Applying filter to " << oid << dendl;
-
-        // We are only interested in 0th objects during this phase: we touched
-        // the other objects during scan_extents
-        if (obj_name_offset != 0) {
-          dout(20) << "Non-zeroth object" << dendl;
-          continue;
-        }
-
-        bufferlist scrub_tag_bl;
-        int r = ioctx.getxattr(oid, "scrub_tag", scrub_tag_bl);
-        if (r >= 0) {
-          std::string read_tag;
-          auto q = scrub_tag_bl.cbegin();
-          try {
-            decode(read_tag, q);
-            if (read_tag == filter_tag) {
-              dout(20) << "skipping " << oid << " because it has the filter_tag"
-                       << dendl;
-              continue;
-            }
-          } catch (const buffer::error &err) {
-          }
-          dout(20) << "read non-matching tag '" << read_tag << "'" << dendl;
-        } else {
-          dout(20) << "no tag read (" << r << ")" << dendl;
-        }
-
-      } else if (untagged_only) {
-        ceph_assert(obj_name_offset == 0);
-        dout(20) << "OSD matched oid " << oid << dendl;
+    if (checkpoint) {
+      bufferlist cursor_bl;
+      cursor_bl.append(range_i.to_str());
+      r = ioctx.setxattr(CHECKPOINT_OID, checkpoint_key.c_str(), cursor_bl);
+      if (r < 0) {
+        derr << "Unexpected error saving checkpoint: " << cpp_strerror(r)
+             << dendl;
+        return r;
       }
+    }
+  }
+
+  if (checkpoint) {
+    int r = ioctx.rmxattr(CHECKPOINT_OID, checkpoint_key.c_str());
+    if (r < 0 && r != -ENOENT && r != -ENODATA) {
+      derr << "Failed to remove checkpoint: " << cpp_strerror(r) << dendl;
+    }
 
-      int this_oid_r = handler(oid, obj_name_ino, obj_name_offset);
-      if (r == 0 && this_oid_r < 0) {
-        r = this_oid_r;
+    // drop the object once no worker has a checkpoint in it; the version
+    // guard keeps a checkpoint that another worker just saved
+    std::map<std::string, bufferlist> xattrs;
+    r = ioctx.getxattrs(CHECKPOINT_OID, xattrs);
+    if (r >= 0 && xattrs.empty()) {
+      librados::ObjectWriteOperation op;
+      op.assert_version(ioctx.get_last_version());
+      op.remove();
+      r = ioctx.operate(CHECKPOINT_OID, &op);
+      if (r < 0 && r != -ENOENT && r != -ERANGE && r != -EOVERFLOW) {
+        derr << "Failed to remove " << CHECKPOINT_OID << ": "
+             << cpp_strerror(r) << dendl;
       }
     }
   }
 
-  return r;
+  return 0;
 }
 
 int DataScan::scan_inodes()
@@ -254,6 +254,16 @@ class DataScan : public MDSUtility, public MetadataTool
 
     uint32_t n;
     uint32_t m;
+    // Objects processed in parallel by this worker
+    uint32_t n_threads;
+
+    // Object (in the scanned pool) whose xattrs hold the listing cursor of
+    // each command and worker, and the number of objects listed per cursor
+    // update
+    static constexpr const char *CHECKPOINT_OID = "datascan.checkpoint";
+    static const int LIST_BATCH = 1024;
+    bool checkpoint;
+    std::string checkpoint_name;
 
     /**
      * Scan data pool for backtraces, and inject inodes to metadata pool
@@ -314,7 +324,9 @@ class DataScan : public MDSUtility, public MetadataTool
     /**
      * Apply a function to all objects in an ioctx's pool, optionally
      * restricted to only those objects with a 00000000 offset and
-     * no tag matching DataScan::scrub_tag.
+     * no tag matching DataScan::scrub_tag.  The objects of each listing
+     * batch are handled by n_threads threads, so the handler must be
+     * thread safe.
      */
     int forall_objects(
         librados::IoCtx &ioctx,
@@ -327,7 +339,7 @@ class DataScan : public MDSUtility, public MetadataTool
 
     DataScan()
       : driver(NULL), fscid(FS_CLUSTER_ID_NONE),
-	data_pool_id(-1), n(0), m(1),
+	data_pool_id(-1), n(0), m(1), n_threads(1), checkpoint(false),
         force_pool(false), force_corrupt(false),
         force_init(false)
     {
@@ -0,0 +1,80 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_CACHE_FREQUENCY_SKETCH_H
+#define CEPH_CACHE_FREQUENCY_SKETCH_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace ceph {
+namespace immutable_obj_cache {
+
+// A count-min sketch of 4 bit counters estimating how often each object
+// was looked up recently (TinyLFU). All counters are halved once
+// 10 * width lookups have been recorded, so old popularity fades.
+class FrequencySketch {
+ public:
+  explicit FrequencySketch(uint64_t width) {
+    uint64_t w = 16;
+    while (w < width) {
+      w <<= 1;
+    }
+    m_mask = w - 1;
+    m_sample_size = w * 10;
+    m_table.resize(w * DEPTH);
+  }
+
+  void increment(const std::string& key) {
+    uint64_t hash = std::hash<std::string>{}(key);
+    for (int row = 0; row < DEPTH; row++) {
+      uint8_t& counter = m_table[row * (m_mask + 1) + index(hash, row)];
+      if (counter < MAX_COUNT) {
+        counter++;
+      }
+    }
+    if (++m_additions >= m_sample_size) {
+      reset();
+    }
+  }
+
+  uint8_t estimate(const std::string& key) const {
+    uint64_t hash = std::hash<std::string>{}(key);
+    uint8_t count = MAX_COUNT;
+    for (int row = 0; row < DEPTH; row++) {
+      count = std::min(count, m_table[row * (m_mask + 1) + index(hash, row)]);
+    }
+    return count;
+  }
+
+ private:
+  static constexpr int DEPTH = 4;
+  static constexpr uint8_t MAX_COUNT = 15;
+
+  std::vector<uint8_t> m_table;
+  uint64_t m_mask;
+  uint64_t m_sample_size;
+  uint64_t m_additions = 0;
+
+  uint64_t index(uint64_t hash, int row) const {
+    static constexpr uint64_t seeds[DEPTH] = {
+      0xc3a5c85c97cb3127ull, 0xb492b66fbe98f273ull,
+      0x9ae16a3b2f90404full, 0xcbf29ce484222325ull};
+    uint64_t h = (hash + seeds[row]) * 0x9e3779b97f4a7c15ull;
+    return (h ^ (h >> 32)) & m_mask;
+  }
+
+  void reset() {
+    for (auto& counter : m_table) {
+      counter >>= 1;
+    }
+    m_additions /= 2;
+  }
+};
+
+}  // namespace immutable_obj_cache
+}  // namespace ceph
+#endif  // CEPH_CACHE_FREQUENCY_SKETCH_H
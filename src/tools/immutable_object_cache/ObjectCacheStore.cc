@@ -18,7 +18,9 @@ namespace immutable_obj_cache {
 
 ObjectCacheStore::ObjectCacheStore(CephContext *cct)
       : m_cct(cct), m_rados(new librados::Rados()),
-        m_ioctx_map_lock("ceph::cache::ObjectCacheStore::m_ioctx_map_lock") {
+        m_ioctx_map_lock("ceph::cache::ObjectCacheStore::m_ioctx_map_lock"),
+        m_promote_budget_lock(
+          "ceph::cache::ObjectCacheStore::m_promote_budget_lock") {
 
   m_cache_root_dir =
     m_cct->_conf.get_val<std::string>("immutable_object_cache_path");
@@ -36,8 +38,16 @@ ObjectCacheStore::ObjectCacheStore(CephContext *cct)
   uint64_t max_inflight_ops =
     m_cct->_conf.get_val<uint64_t>("immutable_object_cache_max_inflight_ops");
 
+  double max_pool_ratio =
+    m_cct->_conf.get_val<double>("immutable_object_cache_max_pool_ratio");
+
   m_policy = new SimplePolicy(m_cct, cache_max_size, max_inflight_ops,
-                              cache_watermark);
+                              cache_watermark, max_pool_ratio);
+
+  m_promote_bps =
+    m_cct->_conf.get_val<Option::size_t>("immutable_object_cache_promote_bps");
+  m_promote_budget = m_promote_bps;
+  m_promote_budget_stamp = ceph::mono_clock::now();
 }
 
 ObjectCacheStore::~ObjectCacheStore() {
@@ -166,6 +176,8 @@ int ObjectCacheStore::handle_promote_callback(int ret, bufferlist* read_buf,
     return ret;
   }
 
+  charge_promote_budget(read_buf->length());
+
   // update metadata
   ceph_assert(OBJ_CACHE_SKIP == m_policy->get_status(cache_file_name));
   m_policy->update_status(cache_file_name, OBJ_CACHE_PROMOTED, read_buf->length());
@@ -189,10 +201,16 @@ int ObjectCacheStore::lookup_object(std::string pool_nspace,
   std::string cache_file_name = std::move(get_cache_file_name(pool_nspace,
                                             pool_id, snap_id, object_name));
 
-  cache_status_t ret = m_policy->lookup_object(cache_file_name);
+  cache_status_t ret = m_policy->lookup_object(cache_file_name, pool_id);
 
   switch (ret) {
     case OBJ_CACHE_NONE: {
+      if (!get_promote_budget()) {
+        ldout(m_cct, 20) << "promotion budget used up, not promoting "
+                         << cache_file_name << dendl;
+        m_policy->update_status(cache_file_name, OBJ_CACHE_NONE);
+        return OBJ_CACHE_SKIP;
+      }
       pret = do_promote(pool_nspace, pool_id, snap_id, object_name);
       if (pret < 0) {
         lderr(m_cct) << "fail to start promote" << dendl;
@@ -227,6 +245,30 @@ int ObjectCacheStore::promote_object(librados::IoCtx* ioctx,
   return ret;
 }
 
+bool ObjectCacheStore::get_promote_budget() {
+  if (m_promote_bps == 0) {
+    return true;
+  }
+
+  Mutex::Locker locker(m_promote_budget_lock);
+  auto now = ceph::mono_clock::now();
+  auto elapsed = std::chrono::duration<double>(now - m_promote_budget_stamp);
+  m_promote_budget_stamp = now;
+  // refill, allowing bursts of up to one second worth of promotions
+  m_promote_budget = std::min<int64_t>(
+    m_promote_budget + elapsed.count() * m_promote_bps, m_promote_bps);
+  return m_promote_budget > 0;
+}
+
+void ObjectCacheStore::charge_promote_budget(uint64_t bytes) {
+  if (m_promote_bps == 0) {
+    return;
+  }
+
+  Mutex::Locker locker(m_promote_budget_lock);
+  m_promote_budget -= bytes;
+}
+
 int ObjectCacheStore::evict_objects() {
   ldout(m_cct, 20) << dendl;
 
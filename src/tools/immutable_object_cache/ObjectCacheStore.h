@@ -5,6 +5,7 @@
 #define CEPH_CACHE_OBJECT_CACHE_STORE_H
 
 #include "common/ceph_context.h"
+#include "common/ceph_time.h"
 #include "common/Mutex.h"
 #include "include/rados/librados.hpp"
 
@@ -46,6 +47,8 @@ class ObjectCacheStore {
                      Context* on_finish);
   int handle_promote_callback(int, bufferlist*, std::string);
   int do_evict(std::string cache_file);
+  bool get_promote_budget();
+  void charge_promote_budget(uint64_t bytes);
 
   CephContext *m_cct;
   RadosRef m_rados;
@@ -53,6 +56,13 @@ class ObjectCacheStore {
   Mutex m_ioctx_map_lock;
   Policy* m_policy;
   std::string m_cache_root_dir;
+
+  // promotions are charged after the fact; new ones may start while the
+  // budget is positive
+  Mutex m_promote_budget_lock;
+  uint64_t m_promote_bps;
+  int64_t m_promote_budget;
+  ceph::mono_time m_promote_budget_stamp;
 };
 
 }  // namespace immutable_obj_cache
@@ -20,7 +20,7 @@ class Policy {
  public:
   Policy() {}
   virtual ~Policy() {}
-  virtual cache_status_t lookup_object(std::string) = 0;
+  virtual cache_status_t lookup_object(std::string, uint64_t pool_id = 0) = 0;
   virtual int evict_entry(std::string) = 0;
   virtual void update_status(std::string, cache_status_t,
                              uint64_t size = 0) = 0;
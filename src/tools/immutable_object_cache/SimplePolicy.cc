@@ -14,14 +14,20 @@ namespace ceph {
 namespace immutable_obj_cache {
 
 SimplePolicy::SimplePolicy(CephContext *cct, uint64_t cache_size,
-                           uint64_t max_inflight, double watermark)
+                           uint64_t max_inflight, double watermark,
+                           double max_pool_ratio)
   : cct(cct), m_watermark(watermark), m_max_inflight_ops(max_inflight),
     m_max_cache_size(cache_size),
-    m_cache_map_lock("rbd::cache::SimplePolicy::m_cache_map_lock") {
+    m_cache_map_lock("rbd::cache::SimplePolicy::m_cache_map_lock"),
+    m_max_pool_size(cache_size * std::min(max_pool_ratio, 1.0)),
+    m_sketch_lock("rbd::cache::SimplePolicy::m_sketch_lock"),
+    // about four counters per 4M object that fits in the cache
+    m_sketch(std::max<uint64_t>(cache_size >> 20, 1024)) {
 
   ldout(cct, 20) << "max cache size= " << m_max_cache_size
                  << " ,watermark= " << m_watermark
-                 << " ,max inflight ops= " << m_max_inflight_ops << dendl;
+                 << " ,max inflight ops= " << m_max_inflight_ops
+                 << " ,max pool size= " << m_max_pool_size << dendl;
 
   m_cache_size = 0;
 
@@ -36,7 +42,8 @@ SimplePolicy::~SimplePolicy() {
   }
 }
 
-cache_status_t SimplePolicy::alloc_entry(std::string file_name) {
+cache_status_t SimplePolicy::alloc_entry(std::string file_name,
+                                         uint64_t pool_id) {
   ldout(cct, 20) << "alloc entry for: " << file_name << dendl;
 
   RWLock::WLocker wlocker(m_cache_map_lock);
@@ -47,10 +54,18 @@ cache_status_t SimplePolicy::alloc_entry(std::string file_name) {
     return OBJ_CACHE_SKIP;
   }
 
+  auto pool_it = m_pool_size.find(pool_id);
+  if (pool_it != m_pool_size.end() && pool_it->second >= m_max_pool_size) {
+    ldout(cct, 20) << "pool " << pool_id << " is over its quota" << dendl;
+    return OBJ_CACHE_SKIP;
+  }
+
   if ((m_cache_size < m_max_cache_size) &&
-      (inflight_ops < m_max_inflight_ops)) {
+      (inflight_ops < m_max_inflight_ops) &&
+      admit(file_name)) {
     Entry* entry = new Entry();
     ceph_assert(entry != nullptr);
+    entry->pool_id = pool_id;
     m_cache_map[file_name] = entry;
     wlocker.unlock();
     update_status(file_name, OBJ_CACHE_SKIP);
@@ -61,16 +76,47 @@ cache_status_t SimplePolicy::alloc_entry(std::string file_name) {
   return OBJ_CACHE_SKIP;
 }
 
-cache_status_t SimplePolicy::lookup_object(std::string file_name) {
+// TinyLFU admission: once promoting means evicting, the candidate has to
+// be looked up at least as often as the object that would go next.
+// called with m_cache_map_lock held
+bool SimplePolicy::admit(const std::string& file_name) {
+  if (m_cache_size < m_max_cache_size * (1 - m_watermark)) {
+    return true;
+  }
+  Entry* victim = reinterpret_cast<Entry*>(
+    m_promoted_lru.lru_get_next_expire());
+  if (victim == nullptr) {
+    return true;
+  }
+
+  Mutex::Locker locker(m_sketch_lock);
+  uint8_t freq = m_sketch.estimate(file_name);
+  uint8_t victim_freq = m_sketch.estimate(victim->file_name);
+  if (freq < victim_freq) {
+    ldout(cct, 20) << "not admitting " << file_name << " (freq " << (int)freq
+                   << ") over " << victim->file_name << " (freq "
+                   << (int)victim_freq << ")" << dendl;
+    return false;
+  }
+  return true;
+}
+
+cache_status_t SimplePolicy::lookup_object(std::string file_name,
+                                           uint64_t pool_id) {
   ldout(cct, 20) << "lookup: " << file_name << dendl;
 
+  {
+    Mutex::Locker locker(m_sketch_lock);
+    m_sketch.increment(file_name);
+  }
+
   RWLock::RLocker rlocker(m_cache_map_lock);
 
   auto entry_it = m_cache_map.find(file_name);
-  // simply promote on first lookup
+  // promote on first lookup, unless the admission filter says otherwise
   if (entry_it == m_cache_map.end()) {
       rlocker.unlock();
-      return alloc_entry(file_name);
+      return alloc_entry(file_name, pool_id);
   }
 
   Entry* entry = entry_it->second;
@@ -112,6 +158,7 @@ void SimplePolicy::update_status(std::string file_name,
     entry->status = new_status;
     entry->size = size;
     m_cache_size += entry->size;
+    m_pool_size[entry->pool_id] += entry->size;
     inflight_ops--;
     return;
   }
@@ -139,6 +186,13 @@ void SimplePolicy::update_status(std::string file_name,
     m_promoted_lru.lru_remove(entry);
     m_cache_map.erase(entry_it);
     m_cache_size -= size;
+    auto pool_it = m_pool_size.find(entry->pool_id);
+    if (pool_it != m_pool_size.end()) {
+      pool_it->second -= size;
+      if (pool_it->second == 0) {
+        m_pool_size.erase(pool_it);
+      }
+    }
     delete entry;
     return;
   }
@@ -203,6 +257,12 @@ uint64_t SimplePolicy::get_promoted_entry_num() {
   return m_promoted_lru.lru_get_size();
 }
 
+uint64_t SimplePolicy::get_pool_size(uint64_t pool_id) {
+  RWLock::RLocker rlocker(m_cache_map_lock);
+  auto it = m_pool_size.find(pool_id);
+  return it == m_pool_size.end() ? 0 : it->second;
+}
+
 std::string SimplePolicy::get_evict_entry() {
   Entry* entry = reinterpret_cast<Entry*>(m_promoted_lru.lru_get_next_expire());
   if (entry == nullptr) {
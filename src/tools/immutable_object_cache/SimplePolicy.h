@@ -8,8 +8,10 @@
 #include "common/RWLock.h"
 #include "common/Mutex.h"
 #include "include/lru.h"
+#include "FrequencySketch.h"
 #include "Policy.h"
 
+#include <map>
 #include <unordered_map>
 #include <string>
 
@@ -19,10 +21,10 @@ namespace immutable_obj_cache {
 class SimplePolicy : public Policy {
  public:
   SimplePolicy(CephContext *cct, uint64_t block_num, uint64_t max_inflight,
-               double watermark);
+               double watermark, double max_pool_ratio = 1.0);
   ~SimplePolicy();
 
-  cache_status_t lookup_object(std::string file_name);
+  cache_status_t lookup_object(std::string file_name, uint64_t pool_id = 0);
   cache_status_t get_status(std::string file_name);
 
   void update_status(std::string file_name,
@@ -37,9 +39,11 @@ class SimplePolicy : public Policy {
   uint64_t get_promoting_entry_num();
   uint64_t get_promoted_entry_num();
   std::string get_evict_entry();
+  uint64_t get_pool_size(uint64_t pool_id);
 
  private:
-  cache_status_t alloc_entry(std::string file_name);
+  cache_status_t alloc_entry(std::string file_name, uint64_t pool_id);
+  bool admit(const std::string& file_name);
 
   class Entry : public LRUObject {
    public:
@@ -47,6 +51,7 @@ class SimplePolicy : public Policy {
     Entry() : status(OBJ_CACHE_NONE) {}
     std::string file_name;
     uint64_t size;
+    uint64_t pool_id = 0;
   };
 
   CephContext* cct;
@@ -60,7 +65,16 @@ class SimplePolicy : public Policy {
 
   std::atomic<uint64_t> m_cache_size;
 
+  // promoted bytes per pool, against the m_max_pool_size quota
+  uint64_t m_max_pool_size;
+  std::map<uint64_t, uint64_t> m_pool_size;
+
   LRU m_promoted_lru;
+
+  // lookups of cached and uncached objects alike, to keep one-off scans
+  // from pushing out the objects that are read again and again
+  Mutex m_sketch_lock;
+  FrequencySketch m_sketch;
 };
 
 }  // namespace immutable_obj_cache
@@ -3,7 +3,9 @@
 
 #include "kvstore_tool.h"
 
+#include <fstream>
 #include <iostream>
+#include <sstream>
 
 #include "common/errno.h"
 #include "common/url_escape.h"
@@ -13,7 +15,8 @@
 StoreTool::StoreTool(const string& type,
 		     const string& path,
 		     bool need_open_db,
-		     bool need_stats)
+		     bool need_stats,
+		     bool need_create)
   : store_path(path)
 {
 
@@ -32,7 +35,20 @@ StoreTool::StoreTool(const string& type,
 #endif
   } else {
     auto db_ptr = KeyValueDB::create(g_ceph_context, type, path);
-    if (need_open_db) {
+    if (need_create) {
+      // a store created from scratch gets the options BlueStore would use
+      if (type == "rocksdb" &&
+	  db_ptr->init(g_conf()->bluestore_rocksdb_options) < 0) {
+        cerr << "failed to parse bluestore_rocksdb_options" << std::endl;
+        exit(1);
+      }
+      if (int r = db_ptr->create_and_open(std::cerr); r < 0) {
+        cerr << "failed to create type " << type << " path " << path << ": "
+             << cpp_strerror(r) << std::endl;
+        exit(1);
+      }
+      db.reset(db_ptr);
+    } else if (need_open_db) {
       if (int r = db_ptr->open(std::cerr); r < 0) {
         cerr << "failed to open type " << type << " path " << path << ": "
              << cpp_strerror(r) << std::endl;
@@ -314,3 +330,101 @@ int StoreTool::destructive_repair()
 {
   return db->repair(std::cout);
 }
+
+// key of the given length standing for the traced key with that hash
+static string replay_key(const string& hash, size_t len)
+{
+  string key;
+  key.reserve(len);
+  while (key.size() < len) {
+    key.append(hash, 0, std::min(hash.size(), len - key.size()));
+  }
+  return key;
+}
+
+int StoreTool::replay(const string& trace_path)
+{
+  std::ifstream trace(trace_path);
+  if (!trace) {
+    std::cerr << "failed to open trace " << trace_path << std::endl;
+    return -ENOENT;
+  }
+
+  uint64_t total_txs = 0, total_ops = 0, skipped_ops = 0, total_size = 0;
+  KeyValueDB::Transaction tx;
+  bool sync = false;
+  auto submit = [&] {
+    if (!tx)
+      return 0;
+    int r = sync ? db->submit_transaction_sync(tx) : db->submit_transaction(tx);
+    tx.reset();
+    total_txs++;
+    return r;
+  };
+
+  auto start = coarse_mono_clock::now();
+  string line;
+  while (std::getline(trace, line)) {
+    std::istringstream is(line);
+    string op, prefix, hash;
+    size_t keylen = 0;
+    uint64_t vallen = 0;
+    is >> op;
+    if (op == "txn") {
+      if (int r = submit(); r < 0) {
+        std::cerr << "failed to submit transaction: " << cpp_strerror(r)
+                  << std::endl;
+        return r;
+      }
+      int s = 0;
+      is >> s;
+      sync = s;
+      tx = db->get_transaction();
+      continue;
+    }
+    is >> prefix >> hash >> keylen;
+    if (!is || !tx) {
+      std::cerr << "malformed trace line: " << line << std::endl;
+      return -EINVAL;
+    }
+    string key = replay_key(hash, keylen);
+    if (op == "set" || op == "merge") {
+      // merges are replayed as sets, as the store may lack the merge
+      // operators of the traced one
+      is >> vallen;
+      bufferlist bl;
+      bl.append_zero(vallen);
+      tx->set(prefix, key, bl);
+      total_size += vallen;
+    } else if (op == "rm") {
+      tx->rmkey(prefix, key);
+    } else if (op == "rm_single") {
+      tx->rm_single_key(prefix, key);
+    } else if (op == "rm_prefix") {
+      tx->rmkeys_by_prefix(prefix);
+    } else {
+      // the bounds of ranges are not traced
+      skipped_ops++;
+      continue;
+    }
+    total_ops++;
+  }
+  if (int r = submit(); r < 0) {
+    std::cerr << "failed to submit transaction: " << cpp_strerror(r)
+              << std::endl;
+    return r;
+  }
+
+  auto elapsed = std::chrono::duration<double>(coarse_mono_clock::now() - start);
+  std::cout << "replayed " << total_txs << " transactions, " << total_ops
+            << " ops, " << byte_u_t(total_size) << " of values in "
+            << elapsed.count() << " seconds";
+  if (elapsed.count() > 0) {
+    std::cout << " (" << total_txs / elapsed.count() << " transactions/s)";
+  }
+  std::cout << std::endl;
+  if (skipped_ops) {
+    std::cout << "skipped " << skipped_ops << " range removals" << std::endl;
+  }
+  return 0;
+}
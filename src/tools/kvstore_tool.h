@@ -44,7 +44,8 @@ public:
   StoreTool(const std::string& type,
 	    const std::string& path,
 	    bool need_open_db = true,
-	    bool need_stats = false);
+	    bool need_stats = false,
+	    bool need_create = false);
   int load_bluestore(const std::string& path, bool need_open_db);
   uint32_t traverse(const std::string& prefix,
                     const bool do_crc,
@@ -75,6 +76,7 @@ public:
 		     const std::string& start,
 		     const std::string& end);
   int destructive_repair();
+  int replay(const std::string& trace_path);
 
   int print_stats() const;
 };
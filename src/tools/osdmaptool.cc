@@ -20,8 +20,10 @@
 #include "common/safe_io.h"
 #include "mon/health_check.h"
 
+#include "common/WorkQueue.h"
 #include "global/global_init.h"
 #include "osd/OSDMap.h"
+#include "osd/OSDMapMapping.h"
 
 
 void usage()
@@ -38,6 +40,9 @@ void usage()
   cout << "   --test-map-pgs [--pool <poolid>] [--pg_num <pg_num>] [--range-first <first> --range-last <last>] map all pgs" << std::endl;
   cout << "   --test-map-pgs-dump [--pool <poolid>] [--range-first <first> --range-last <last>] map all pgs" << std::endl;
   cout << "   --test-map-pgs-dump-all [--pool <poolid>] [--range-first <first> --range-last <last>] map all pgs to osds" << std::endl;
+  cout << "   --test-map-pgs-diff <mapfilename> [--pool <poolid>] [--threads <n>]" << std::endl;
+  cout << "                           map all pgs with both maps and report pg movement" << std::endl;
+  cout << "   --threads <n>           map pgs with <n> threads [default: 0, no threads]" << std::endl;
   cout << "   --mark-up-in            mark osds up and in (but do not persist)" << std::endl;
   cout << "   --mark-out <osdid>      mark an osd as out (but do not persist)" << std::endl;
   cout << "   --with-default-pool     include default pool when creating map" << std::endl;
@@ -146,6 +151,8 @@ int main(int argc, const char **argv)
   std::set<std::string> upmap_pools;
   int64_t pg_num = -1;
   bool test_map_pgs_dump_all = false;
+  std::string test_map_pgs_diff;
+  int num_threads = 0;
 
   std::string val;
   std::ostringstream err;
@@ -201,6 +208,12 @@ int main(int argc, const char **argv)
       test_map_pgs_dump = true;
     } else if (ceph_argparse_flag(args, i, "--test-map-pgs-dump-all", (char*)NULL)) {
       test_map_pgs_dump_all = true;
+    } else if (ceph_argparse_witharg(args, i, &test_map_pgs_diff, "--test-map-pgs-diff", (char*)NULL)) {
+    } else if (ceph_argparse_witharg(args, i, &num_threads, err, "--threads", (char*)NULL)) {
+      if (!err.str().empty()) {
+	cerr << err.str() << std::endl;
+	exit(EXIT_FAILURE);
+      }
     } else if (ceph_argparse_flag(args, i, "--test-random", (char*)NULL)) {
       test_random = true;
     } else if (ceph_argparse_flag(args, i, "--clobber", (char*)NULL)) {
@@ -614,6 +627,167 @@ int main(int argc, const char **argv)
         cout << "size " << i << "\t" << size[i] << std::endl;
     }
   }
+  if (!test_map_pgs_diff.empty()) {
+    if (pool != -1 && !osdmap.have_pg_pool(pool)) {
+      cerr << "There is no pool " << pool << std::endl;
+      exit(1);
+    }
+    OSDMap newmap;
+    {
+      bufferlist nbl;
+      std::string error;
+      r = nbl.read_file(test_map_pgs_diff.c_str(), &error);
+      if (r < 0) {
+	cerr << me << ": couldn't open " << test_map_pgs_diff << ": " << error
+	     << std::endl;
+	exit(1);
+      }
+      try {
+	newmap.decode(nbl);
+      } catch (const buffer::error &e) {
+	cerr << me << ": error decoding osdmap '" << test_map_pgs_diff << "'"
+	     << std::endl;
+	exit(1);
+      }
+    }
+
+    // map both epochs up front with the same engine the mon and mgr use
+    OSDMapMapping old_mapping, new_mapping;
+    utime_t start = ceph_clock_now();
+    if (num_threads > 0) {
+      ThreadPool tp(g_ceph_context, "osdmaptool::mapper", "tp_osdmaptool",
+		    num_threads);
+      ParallelPGMapper mapper(g_ceph_context, &tp);
+      tp.start();
+      auto old_job = old_mapping.start_update(osdmap, mapper, 128);
+      auto new_job = new_mapping.start_update(newmap, mapper, 128);
+      old_job->wait();
+      new_job->wait();
+      tp.stop();
+    } else {
+      old_mapping.update(osdmap);
+      new_mapping.update(newmap);
+    }
+    utime_t elapsed = ceph_clock_now() - start;
+
+    int n = std::max(osdmap.get_max_osd(), newmap.get_max_osd());
+    vector<int> old_count(n, 0), new_count(n, 0);
+    vector<int> in_count(n, 0), out_count(n, 0);
+    uint64_t num_pgs = 0, remapped = 0, moved = 0;
+    for (auto& [poolid, pi] : newmap.get_pools()) {
+      if (pool != -1 && poolid != pool)
+	continue;
+      const pg_pool_t *old_pi = osdmap.get_pg_pool(poolid);
+      if (!old_pi)
+	continue;
+      for (unsigned ps = 0; ps < pi.get_pg_num(); ++ps) {
+	// a pg that does not exist yet is still where its parent is
+	pg_t pgid(ps, poolid);
+	pg_t old_pgid(ceph_stable_mod(ps, old_pi->get_pg_num(),
+				      old_pi->get_pg_num_mask()),
+		      poolid);
+	vector<int> old_up, new_up;
+	old_mapping.get(old_pgid, &old_up, nullptr, nullptr, nullptr);
+	new_mapping.get(pgid, &new_up, nullptr, nullptr, nullptr);
+	++num_pgs;
+	for (auto osd : old_up) {
+	  if (osd >= 0 && osd < n)
+	    old_count[osd]++;
+	}
+	for (auto osd : new_up) {
+	  if (osd >= 0 && osd < n)
+	    new_count[osd]++;
+	}
+	if (old_up == new_up)
+	  continue;
+	++remapped;
+	for (unsigned i = 0; i < new_up.size(); ++i) {
+	  int osd = new_up[i];
+	  if (osd == CRUSH_ITEM_NONE)
+	    continue;
+	  // ec shards are positional, replicas are not
+	  bool had = pi.is_erasure() ?
+	    (i < old_up.size() && old_up[i] == osd) :
+	    std::find(old_up.begin(), old_up.end(), osd) != old_up.end();
+	  if (had)
+	    continue;
+	  ++moved;
+	  in_count[osd]++;
+	  int from = -1;
+	  if (pi.is_erasure()) {
+	    if (i < old_up.size())
+	      from = old_up[i];
+	  } else {
+	    for (auto o : old_up) {
+	      if (std::find(new_up.begin(), new_up.end(), o) == new_up.end()) {
+		from = o;
+		break;
+	      }
+	    }
+	  }
+	  if (from >= 0 && from < n)
+	    out_count[from]++;
+	}
+      }
+    }
+
+    // deviation of each osd from its weighted share of the pg shards
+    auto deviation = [n](const OSDMap& m, const vector<int>& count,
+			 double *max_dev) {
+      double total_weight = 0;
+      uint64_t total = 0;
+      for (int i = 0; i < n && i < m.get_max_osd(); i++) {
+	if (!m.is_in(i) || m.crush->get_item_weight(i) <= 0)
+	  continue;
+	total_weight += m.crush->get_item_weightf(i) * m.get_weightf(i);
+	total += count[i];
+      }
+      double dev = 0;
+      int in = 0;
+      *max_dev = 0;
+      for (int i = 0; i < n && i < m.get_max_osd(); i++) {
+	if (!m.is_in(i) || m.crush->get_item_weight(i) <= 0)
+	  continue;
+	double target = total_weight > 0 ? (double)total *
+	  m.crush->get_item_weightf(i) * m.get_weightf(i) / total_weight : 0;
+	double d = (double)count[i] - target;
+	dev += d * d;
+	*max_dev = std::max(*max_dev, std::abs(d));
+	in++;
+      }
+      return in ? sqrt(dev / in) : 0;
+    };
+
+    cout << "#osd	before	after	in	out" << std::endl;
+    int max_backfill = 0;
+    for (int i = 0; i < n; i++) {
+      if (!old_count[i] && !new_count[i])
+	continue;
+      cout << "osd." << i
+	   << "\t" << old_count[i]
+	   << "\t" << new_count[i]
+	   << "\t" << in_count[i]
+	   << "\t" << out_count[i]
+	   << std::endl;
+      max_backfill = std::max({max_backfill, in_count[i], out_count[i]});
+    }
+    double old_max_dev, new_max_dev;
+    double old_dev = deviation(osdmap, old_count, &old_max_dev);
+    double new_dev = deviation(newmap, new_count, &new_max_dev);
+    uint64_t backfills = std::max<uint64_t>(
+      1, g_conf().get_val<uint64_t>("osd_max_backfills"));
+    cout << " mapped " << num_pgs << " pgs twice in " << elapsed
+	 << " with " << num_threads << " threads" << std::endl;
+    cout << " remapped " << remapped << " pgs, moved " << moved
+	 << " pg shards" << std::endl;
+    cout << " weighted stddev before " << old_dev << " (max " << old_max_dev
+	 << "), after " << new_dev << " (max " << new_max_dev << ")"
+	 << std::endl;
+    // every osd takes part in at most osd_max_backfills moves at a time
+    cout << " at least " << (max_backfill + backfills - 1) / backfills
+	 << " rounds of backfill with osd_max_backfills " << backfills
+	 << std::endl;
+  }
   if (test_crush) {
     int pass = 0;
     while (1) {
@@ -649,6 +823,7 @@ int main(int argc, const char **argv)
       export_crush.empty() && import_crush.empty() && 
       test_map_pg.empty() && test_map_object.empty() &&
       !test_map_pgs && !test_map_pgs_dump && !test_map_pgs_dump_all &&
+      test_map_pgs_diff.empty() &&
       !upmap && !upmap_cleanup) {
     cerr << me << ": no action specified?" << std::endl;
     usage();
@@ -59,6 +59,48 @@ int RadosImport::import(std::string pool, bool no_overwrite)
 }
 
 int RadosImport::import(librados::IoCtx &io_ctx, bool no_overwrite)
+{
+  int ret = do_import(io_ctx, no_overwrite);
+  int r = wait_inflight(0);
+  return ret ? ret : r;
+}
+
+int RadosImport::write_data(librados::IoCtx &ioctx, const std::string &oid,
+                            const bufferlist &bl, uint64_t len, uint64_t off)
+{
+  int ret = wait_inflight(max_inflight - 1);
+  if (ret)
+    return ret;
+
+  bufferlist wbl;
+  wbl.substr_of(bl, 0, len);
+  librados::AioCompletion *c = librados::Rados::aio_create_completion();
+  ret = ioctx.aio_write(oid, c, wbl, len, off);
+  if (ret) {
+    c->release();
+    return ret;
+  }
+  inflight.push_back(c);
+  return 0;
+}
+
+int RadosImport::wait_inflight(unsigned max)
+{
+  while (inflight.size() > max) {
+    librados::AioCompletion *c = inflight.front();
+    inflight.pop_front();
+    c->wait_for_complete();
+    int r = c->get_return_value();
+    c->release();
+    if (r < 0 && !first_error) {
+      cerr << "write failed: " << cpp_strerror(r) << std::endl;
+      first_error = r;
+    }
+  }
+  return first_error;
+}
+
+int RadosImport::do_import(librados::IoCtx &io_ctx, bool no_overwrite)
 {
   bufferlist ebl;
   pg_info_t info;
@@ -304,7 +346,8 @@ int RadosImport::get_object_rados(librados::IoCtx &ioctx, bufferlist &bl, bool n
           uint64_t rndlen = uint64_t(databl.length() / alignment) * alignment;
           dout(10) << "write offset=" << out_offset << " len=" << rndlen << dendl;
           if (!dry_run && !skipping) {
-            ret = ioctx.write(ob.hoid.hobj.oid.name, databl, rndlen, out_offset);
+            ret = write_data(ioctx, ob.hoid.hobj.oid.name, databl, rndlen,
+                             out_offset);
             if (ret) {
               cerr << "write failed: " << cpp_strerror(ret) << std::endl;
               return ret;
@@ -321,7 +364,8 @@ int RadosImport::get_object_rados(librados::IoCtx &ioctx, bufferlist &bl, bool n
         break;
       }
       if (!dry_run && !skipping) {
-        ret = ioctx.write(ob.hoid.hobj.oid.name, ds.databl, ds.len, ds.offset);
+        ret = write_data(ioctx, ob.hoid.hobj.oid.name, ds.databl, ds.len,
+                         ds.offset);
         if (ret) {
           cerr << "write failed: " << cpp_strerror(ret) << std::endl;
           return ret;
@@ -382,7 +426,8 @@ int RadosImport::get_object_rados(librados::IoCtx &ioctx, bufferlist &bl, bool n
         dout(10) << "END write offset=" << out_offset << " len=" << databl.length() << dendl;
         if (dry_run || skipping)
           break;
-        ret = ioctx.write(ob.hoid.hobj.oid.name, databl, databl.length(), out_offset);
+        ret = write_data(ioctx, ob.hoid.hobj.oid.name, databl,
+                         databl.length(), out_offset);
         if (ret) {
           cerr << "write failed: " << cpp_strerror(ret) << std::endl;
           return ret;
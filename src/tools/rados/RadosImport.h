@@ -15,6 +15,8 @@
 #ifndef RADOS_IMPORT_H_
 #define RADOS_IMPORT_H_
 
+#include <algorithm>
+#include <list>
 #include <string>
 
 #include "include/rados/librados.hpp"
@@ -31,11 +33,24 @@ class RadosImport : public RadosDump
 {
   protected:
     uint64_t align;
+    // Object data is written asynchronously, with up to max_inflight
+    // writes outstanding.  Writes to one object stay ordered with the
+    // xattr and omap updates that follow them.
+    unsigned max_inflight;
+    std::list<librados::AioCompletion*> inflight;
+    int first_error = 0;
+
+    int do_import(librados::IoCtx &io_ctx, bool no_overwrite);
     int get_object_rados(librados::IoCtx &ioctx, bufferlist &bl, bool no_overwrite);
+    int write_data(librados::IoCtx &ioctx, const std::string &oid,
+                   const bufferlist &bl, uint64_t len, uint64_t off);
+    int wait_inflight(unsigned max);
 
   public:
-    RadosImport(int file_fd_, uint64_t align_, bool dry_run_)
-      : RadosDump(file_fd_, dry_run_), align(align_)
+    RadosImport(int file_fd_, uint64_t align_, bool dry_run_,
+                unsigned max_inflight_ = 1)
+      : RadosDump(file_fd_, dry_run_), align(align_),
+        max_inflight(std::max(max_inflight_, 1u))
     {}
 
     int import(std::string pool, bool no_overwrite);
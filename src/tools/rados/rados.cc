@@ -135,7 +135,7 @@ void usage(ostream& out)
 "IMPORT AND EXPORT\n"
 "   export [filename]\n"
 "       Serialize pool contents to a file or standard out.\n"
-"   import [--dry-run] [--no-overwrite] < filename | - >\n"
+"   import [--dry-run] [--no-overwrite] [-t concurrent_operations] < filename | - >\n"
 "       Load pool contents from a file or standard in\n"
 "\n"
 "ADVISORY LOCKS\n"
@@ -3838,7 +3838,8 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
       }
     }
 
-    ret = RadosImport(file_fd, 0, dry_run).import(io_ctx, no_overwrite);
+    ret = RadosImport(file_fd, 0, dry_run, concurrent_ios).import(io_ctx,
+                                                                  no_overwrite);
 
     if (file_fd != STDIN_FILENO) {
       VOID_TEMP_FAILURE_RETRY(::close(file_fd));
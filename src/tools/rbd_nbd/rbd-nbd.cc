@@ -41,6 +41,7 @@
 #include <iostream>
 #include <memory>
 #include <regex>
+#include <vector>
 #include <boost/algorithm/string/predicate.hpp>
 
 #include "common/Formatter.h"
@@ -73,6 +74,7 @@ struct Config {
   int nbds_max = 0;
   int max_part = 255;
   int timeout = -1;
+  int num_connections = 1;
 
   bool exclusive = false;
   bool readonly = false;
@@ -101,6 +103,7 @@ static void usage()
             << "  --max_part <limit>      Override for module param max_part\n"
             << "  --exclusive             Forbid writes by other clients\n"
             << "  --timeout <seconds>     Set nbd request timeout\n"
+            << "  --connections <num>     Number of nbd connections (default: 1)\n"
             << "  --try-netlink           Use the nbd netlink interface\n"
             << "\n"
             << "List options:\n"
@@ -124,6 +127,10 @@ static Command cmd = None;
 
 #define RBD_NBD_BLKSIZE 512UL
 
+#ifndef NBD_FLAG_CAN_MULTI_CONN
+#define NBD_FLAG_CAN_MULTI_CONN (1 << 8)
+#endif
+
 #define HELP_INFO 1
 #define VERSION_INFO 2
 
@@ -159,6 +166,7 @@ public:
 private:
   Mutex disconnect_lock;
   Cond disconnect_cond;
+  bool disconnected = false;
   std::atomic<bool> terminated = { false };
 
   void shutdown()
@@ -347,6 +355,7 @@ private:
 
 signal:
     Mutex::Locker l(disconnect_lock);
+    disconnected = true;
     disconnect_cond.Signal();
   }
 
@@ -422,7 +431,8 @@ public:
       return;
 
     Mutex::Locker l(disconnect_lock);
-    disconnect_cond.Wait(disconnect_lock);
+    while (!disconnected)
+      disconnect_cond.Wait(disconnect_lock);
   }
 
   ~NBDServer()
@@ -666,9 +676,11 @@ static int parse_nbd_index(const std::string& devpath)
   return index;
 }
 
-static int try_ioctl_setup(Config *cfg, int fd, uint64_t size, uint64_t flags)
+static int try_ioctl_setup(Config *cfg, const std::vector<int> &fds,
+                           uint64_t size, uint64_t flags)
 {
   int index = 0, r;
+  int fd = fds[0];
 
   if (cfg->devpath.empty()) {
     char dev[64];
@@ -729,6 +741,16 @@ static int try_ioctl_setup(Config *cfg, int fd, uint64_t size, uint64_t flags)
     }
   }
 
+  for (size_t i = 1; i < fds.size(); ++i) {
+    r = ioctl(nbd, NBD_SET_SOCK, fds[i]);
+    if (r < 0) {
+      r = -errno;
+      cerr << "rbd-nbd: failed to add connection " << i << ": "
+           << cpp_strerror(r) << std::endl;
+      goto close_nbd;
+    }
+  }
+
   r = ioctl(nbd, NBD_SET_BLKSIZE, RBD_NBD_BLKSIZE);
   if (r < 0) {
     r = -errno;
@@ -890,8 +912,9 @@ static int netlink_connect_cb(struct nl_msg *msg, void *arg)
   return NL_OK;
 }
 
-static int netlink_connect(Config *cfg, struct nl_sock *sock, int nl_id, int fd,
-                           uint64_t size, uint64_t flags)
+static int netlink_connect(Config *cfg, struct nl_sock *sock, int nl_id,
+                           const std::vector<int> &fds, uint64_t size,
+                           uint64_t flags)
 {
   struct nlattr *sock_attr;
   struct nlattr *sock_opt;
@@ -933,14 +956,16 @@ static int netlink_connect(Config *cfg, struct nl_sock *sock, int nl_id, int fd,
     goto free_msg;
   }
 
-  sock_opt = nla_nest_start(msg, NBD_SOCK_ITEM);
-  if (!sock_opt) {
-    cerr << "rbd-nbd: Could not init sock in netlink message." << std::endl;
-    goto free_msg;
-  }
+  for (auto fd : fds) {
+    sock_opt = nla_nest_start(msg, NBD_SOCK_ITEM);
+    if (!sock_opt) {
+      cerr << "rbd-nbd: Could not init sock in netlink message." << std::endl;
+      goto free_msg;
+    }
 
-  NLA_PUT_U32(msg, NBD_SOCK_FD, fd);
-  nla_nest_end(msg, sock_opt);
+    NLA_PUT_U32(msg, NBD_SOCK_FD, fd);
+    nla_nest_end(msg, sock_opt);
+  }
   nla_nest_end(msg, sock_attr);
 
   ret = nl_send_sync(sock, msg);
@@ -959,7 +984,8 @@ free_msg:
   return -EIO;
 }
 
-static int try_netlink_setup(Config *cfg, int fd, uint64_t size, uint64_t flags)
+static int try_netlink_setup(Config *cfg, const std::vector<int> &fds,
+                             uint64_t size, uint64_t flags)
 {
   struct nl_sock *sock;
   int nl_id, ret;
@@ -973,7 +999,7 @@ static int try_netlink_setup(Config *cfg, int fd, uint64_t size, uint64_t flags)
 
   dout(10) << "netlink interface supported." << dendl;
 
-  ret = netlink_connect(cfg, sock, nl_id, fd, size, flags);
+  ret = netlink_connect(cfg, sock, nl_id, fds, size, flags);
   netlink_cleanup(sock);
 
   if (ret != 0)
@@ -1012,31 +1038,36 @@ static void handle_signal(int signum)
   }
 }
 
-static NBDServer *start_server(int fd, librbd::Image& image)
+static void start_servers(const std::vector<int> &fds, librbd::Image& image,
+                          std::vector<std::unique_ptr<NBDServer>> *servers)
 {
-  NBDServer *server;
-
-  server = new NBDServer(fd, image);
-  server->start();
+  // one reader/writer pair per connection, so that the kernel can spread
+  // requests over its hardware queues
+  for (auto fd : fds) {
+    servers->emplace_back(new NBDServer(fd, image));
+    servers->back()->start();
+  }
 
   init_async_signal_handler();
   register_async_signal_handler(SIGHUP, sighup_handler);
   register_async_signal_handler_oneshot(SIGINT, handle_signal);
   register_async_signal_handler_oneshot(SIGTERM, handle_signal);
-
-  return server;
 }
 
-static void run_server(Preforker& forker, NBDServer *server, bool netlink_used)
+static void run_servers(Preforker& forker,
+                        std::vector<std::unique_ptr<NBDServer>> &servers,
+                        bool netlink_used)
 {
   if (g_conf()->daemonize) {
     global_init_postfork_finish(g_ceph_context);
     forker.daemonize();
   }
 
-  if (netlink_used)
-    server->wait_for_disconnect();
-  else
+  if (netlink_used) {
+    for (auto &server : servers) {
+      server->wait_for_disconnect();
+    }
+  } else
     ioctl(nbd, NBD_DO_IT);
 
   unregister_async_signal_handler(SIGHUP, sighup_handler);
@@ -1059,12 +1090,13 @@ static int do_map(int argc, const char *argv[], Config *cfg)
   unsigned long size;
   bool use_netlink;
 
-  int fd[2];
+  std::vector<int> nbd_fds;
+  std::vector<int> server_fds;
 
   librbd::image_info_t info;
 
   Preforker forker;
-  NBDServer *server;
+  std::vector<std::unique_ptr<NBDServer>> servers;
 
   vector<const char*> args;
   argv_to_vec(argc, argv, args);
@@ -1101,9 +1133,14 @@ static int do_map(int argc, const char *argv[], Config *cfg)
   common_init_finish(g_ceph_context);
   global_init_chdir(g_ceph_context);
 
-  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fd) == -1) {
-    r = -errno;
-    goto close_ret;
+  for (int i = 0; i < cfg->num_connections; ++i) {
+    int fd[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fd) == -1) {
+      r = -errno;
+      goto close_fd;
+    }
+    nbd_fds.push_back(fd[0]);
+    server_fds.push_back(fd[1]);
   }
 
   r = rados.init_with_context(g_ceph_context);
@@ -1144,6 +1181,10 @@ static int do_map(int argc, const char *argv[], Config *cfg)
     goto close_fd;
 
   flags = NBD_FLAG_SEND_FLUSH | NBD_FLAG_SEND_TRIM | NBD_FLAG_HAS_FLAGS;
+  if (cfg->num_connections > 1) {
+    // a flush is an image-wide librbd flush, whichever connection it is on
+    flags |= NBD_FLAG_CAN_MULTI_CONN;
+  }
   if (!cfg->snapname.empty() || cfg->readonly) {
     flags |= NBD_FLAG_READ_ONLY;
     read_only = 1;
@@ -1162,11 +1203,11 @@ static int do_map(int argc, const char *argv[], Config *cfg)
   if (r < 0)
     goto close_fd;
 
-  server = start_server(fd[1], image);
+  start_servers(server_fds, image, &servers);
 
   use_netlink = cfg->try_netlink;
   if (use_netlink) {
-    r = try_netlink_setup(cfg, fd[0], size, flags);
+    r = try_netlink_setup(cfg, nbd_fds, size, flags);
     if (r < 0) {
       goto free_server;
     } else if (r == 1) {
@@ -1175,7 +1216,7 @@ static int do_map(int argc, const char *argv[], Config *cfg)
   }
 
   if (!use_netlink) {
-    r = try_ioctl_setup(cfg, fd[0], size, flags);
+    r = try_ioctl_setup(cfg, nbd_fds, size, flags);
     if (r < 0)
       goto free_server;
   }
@@ -1200,7 +1241,7 @@ static int do_map(int argc, const char *argv[], Config *cfg)
 
     cout << cfg->devpath << std::endl;
 
-    run_server(forker, server, use_netlink);
+    run_servers(forker, servers, use_netlink);
 
     r = image.update_unwatch(handle);
     ceph_assert(r == 0);
@@ -1218,11 +1259,14 @@ close_nbd:
   }
   close(nbd);
 free_server:
-  delete server;
+  servers.clear();
 close_fd:
-  close(fd[0]);
-  close(fd[1]);
-close_ret:
+  for (auto fd : nbd_fds) {
+    close(fd);
+  }
+  for (auto fd : server_fds) {
+    close(fd);
+  }
   image.close();
   io_ctx.close();
   rados.shutdown();
@@ -1420,6 +1464,16 @@ static int parse_args(vector<const char*>& args, std::ostream *err_msg,
         *err_msg << "rbd-nbd: Invalid argument for timeout!";
         return -EINVAL;
       }
+    } else if (ceph_argparse_witharg(args, i, &cfg->num_connections, err,
+                                     "--connections", (char *)NULL)) {
+      if (!err.str().empty()) {
+        *err_msg << "rbd-nbd: " << err.str();
+        return -EINVAL;
+      }
+      if (cfg->num_connections < 1) {
+        *err_msg << "rbd-nbd: Invalid argument for connections!";
+        return -EINVAL;
+      }
     } else if (ceph_argparse_witharg(args, i, &cfg->format, err, "--format",
                                      (char *)NULL)) {
     } else if (ceph_argparse_flag(args, i, "--pretty-format", (char *)NULL)) {